@@ -0,0 +1,298 @@
+/**
+ ******************************************************************************
+ * @file    acq_tune.h
+ * @brief   Acquisition autotuner: the fastest scan that keeps a target ENOB
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * The fastest scan a board can hold depends on its sensors' source
+ * impedance, the ADC's own noise and what else the CPU has to do, so a
+ * fixed default either leaves rate on the table or misses frames on a
+ * loaded unit. The tuner runs the live pipeline over a grid of candidates:
+ *
+ *   - resolution:         ACQ_TUNE_BITS (12, 10, 8, 6 bits)
+ *   - settling accuracy:  ACQ_TUNE_ACCURACY, every channel's profile, which
+ *                         sets the sampling times (analogSensor_
+ *                         setChannelProfile())
+ *   - ADC DMA FIFO:       direct, half / 4 beats, full / 8 beats
+ *                         (dma_tuning.h)
+ *
+ * Each candidate starts at its fastest frame rate (analogSensor_
+ * getMaxFrameRate(), capped by the caller's limit) and is judged on the
+ * whole system at that rate:
+ *
+ *   1. After ACQ_TUNE_SETTLE_MS, the busiest CPU slice over ACQ_TUNE_LOAD_MS
+ *      (cpu_load.h). Above 100 % minus the headroom the rate is scaled down
+ *      in proportion and measured again, at most ACQ_TUNE_RESCALES times.
+ *   2. A DAC loopback run (dac_loopback.h) on the live scan: its fitted
+ *      ENOB must reach the target.
+ *   3. No conversion error and no ring overflow throughout.
+ *
+ * The winner is the passing candidate with the highest rate, then the
+ * highest ENOB. Candidates run fastest bound first, and one whose bound is
+ * below the best rate found so far is skipped, since it cannot win. The
+ * scan is left on the winner, or back on the settings it had before
+ * acqTune_start() when none passes or the run is stopped.
+ *
+ * The clock profile (and the ADCCLK prescaler in it) is not swept: it is
+ * set at boot and also clocks the links; adc_bench.h compares the profiles
+ * with the same loopback.
+ *
+ * Usage Example:
+ *   const AcqTune_Config_t cfg = {.target_enob_centi = 1000,  // 10.00 bits
+ *                                 .headroom_centi_pct = 2500, // 25 % free
+ *                                 .configure = app_configure,
+ *                                 .start = app_start};
+ *   acqTune_start(&cfg);
+ *
+ *   // main loop, after dacLoop_poll()
+ *   if (acqTune_poll() == ACQ_TUNE_EVENT_DONE) {
+ *     AcqTune_Status_t st;
+ *     acqTune_getStatus(&st);           // st.best, acqTune_getResult()
+ *   }
+ *
+ * @note Main loop only. The scan belongs to the tuner while it runs.
+ ******************************************************************************
+ */
+
+#ifndef ACQ_TUNE_H
+#define ACQ_TUNE_H
+
+#include "dma_tuning.h"
+#include "stm32f7xx_hal.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+
+/**
+ * @brief Set to 1 to build the autotuner (needs DAC_LOOPBACK_ENABLE)
+ */
+#ifndef ACQ_TUNE_ENABLE
+#define ACQ_TUNE_ENABLE 0
+#endif
+
+/**
+ * @brief Set to 1 to tune at the first boot, before any result is saved
+ */
+#ifndef ACQ_TUNE_AT_BOOT
+#define ACQ_TUNE_AT_BOOT 0
+#endif
+
+/**
+ * @brief Targets of a boot-time run: ENOB in 0.01 bit, CPU headroom in
+ *        0.01 %
+ */
+#ifndef ACQ_TUNE_BOOT_ENOB_CENTI
+#define ACQ_TUNE_BOOT_ENOB_CENTI 900
+#endif
+#ifndef ACQ_TUNE_BOOT_HEADROOM_CENTI
+#define ACQ_TUNE_BOOT_HEADROOM_CENTI 2500U
+#endif
+
+/**
+ * @brief Wait after a start before measuring: the pipeline's filters and
+ *        the CPU load window fill
+ */
+#ifndef ACQ_TUNE_SETTLE_MS
+#define ACQ_TUNE_SETTLE_MS 250U
+#endif
+
+/**
+ * @brief CPU load window per rate
+ */
+#ifndef ACQ_TUNE_LOAD_MS
+#define ACQ_TUNE_LOAD_MS 1000U
+#endif
+
+/**
+ * @brief Longest loopback run before the candidate fails
+ */
+#ifndef ACQ_TUNE_LOOP_TIMEOUT_MS
+#define ACQ_TUNE_LOOP_TIMEOUT_MS 10000U
+#endif
+
+/**
+ * @brief Rate reductions per candidate for the CPU budget
+ */
+#ifndef ACQ_TUNE_RESCALES
+#define ACQ_TUNE_RESCALES 2U
+#endif
+
+/**
+ * @brief Rates are rounded down to a multiple of this
+ */
+#ifndef ACQ_TUNE_RATE_STEP_HZ
+#define ACQ_TUNE_RATE_STEP_HZ 100U
+#endif
+
+/**
+ * @brief Grid sizes: resolutions x accuracies x DMA presets
+ */
+#define ACQ_TUNE_BITS_COUNT 4U
+#define ACQ_TUNE_ACCURACY_COUNT 3U
+#define ACQ_TUNE_DMA_PRESETS 3U
+#define ACQ_TUNE_CANDIDATES                                                   \
+  (ACQ_TUNE_BITS_COUNT * ACQ_TUNE_ACCURACY_COUNT * ACQ_TUNE_DMA_PRESETS)
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief One point of the grid; also the record the application saves
+ */
+typedef struct {
+  uint8_t bits;          ///< Scan resolution, 12/10/8/6
+  uint8_t accuracy_bits; ///< Settling accuracy of every channel, 6..12
+  uint8_t dma;           ///< ADC DMA preset, see acqTune_getDmaPreset()
+} AcqTune_Candidate_t;
+
+/**
+ * @brief Why a candidate passed or not
+ */
+typedef enum {
+  ACQ_TUNE_PASS = 0,
+  ACQ_TUNE_SKIPPED,       ///< Its bound is below the best rate so far
+  ACQ_TUNE_FAIL_START,    ///< Configure or start refused
+  ACQ_TUNE_FAIL_ERRORS,   ///< Conversion errors or ring overflows
+  ACQ_TUNE_FAIL_LOAD,     ///< Over the CPU budget at every rate tried
+  ACQ_TUNE_FAIL_LOOPBACK, ///< The loopback did not complete
+  ACQ_TUNE_FAIL_ENOB      ///< Below the target ENOB
+} AcqTune_Verdict_t;
+
+/**
+ * @brief Outcome of one candidate
+ */
+typedef struct {
+  AcqTune_Candidate_t cand;
+  uint32_t max_hz;         ///< Fastest rate of its sampling times
+  uint32_t rate_hz;        ///< Rate it was judged at
+  uint16_t load_centi_pct; ///< Mean CPU load at rate_hz, 0.01 %
+  uint16_t peak_centi_pct; ///< Busiest slice at rate_hz
+  int32_t enob_centi;      ///< Loopback ENOB, 0.01 bit
+  uint32_t errors;         ///< Errors and overflows while it ran
+  AcqTune_Verdict_t verdict;
+} AcqTune_Result_t;
+
+/**
+ * @brief Progress of a run
+ */
+typedef struct {
+  uint8_t running;     ///< Candidates still to judge
+  uint32_t candidates; ///< In the grid
+  uint32_t judged;     ///< Done so far, skipped ones included
+  int32_t best;        ///< Index of the winner so far, -1 = none
+  int32_t last;        ///< Index of the latest result, -1 = none
+} AcqTune_Status_t;
+
+/**
+ * @brief poll() outcome
+ */
+typedef enum {
+  ACQ_TUNE_EVENT_NONE = 0,
+  ACQ_TUNE_EVENT_RESULT, ///< A candidate was judged (AcqTune_Status_t.last)
+  ACQ_TUNE_EVENT_DONE    ///< The run finished, the scan is on the winner
+} AcqTune_Event_t;
+
+/**
+ * @brief Targets and the application's hooks
+ */
+typedef struct {
+  int32_t target_enob_centi;   ///< Lowest loopback ENOB, 0.01 bit
+  uint16_t headroom_centi_pct; ///< CPU share kept free, 0.01 %
+  uint32_t limit_hz;           ///< Application ceiling, 0 = none
+  /**
+   * Stop the scan and apply a candidate's resolution, then
+   * acqTune_applyAnalog(); NULL asks for the settings from before the run.
+   * The scan stays stopped.
+   */
+  HAL_StatusTypeDef (*configure)(const AcqTune_Candidate_t *cand, void *ctx);
+  /** Start (or restart) the scan at a rate */
+  HAL_StatusTypeDef (*start)(uint32_t rate_hz, void *ctx);
+  void *ctx;
+} AcqTune_Config_t;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief Start a run over the grid, from the current settings
+ *
+ * @param cfg Targets and hooks (copied)
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Running
+ *   @retval HAL_BUSY  A run or a loopback test is in progress
+ *   @retval HAL_ERROR Built without ACQ_TUNE_ENABLE, NULL pointer or hook,
+ *                     or a headroom of 100 % or more
+ */
+HAL_StatusTypeDef acqTune_start(const AcqTune_Config_t *cfg);
+
+/**
+ * @brief Abandon a run; the scan goes back to the settings before it
+ */
+void acqTune_stop(void);
+
+/**
+ * @brief Advance the run
+ *
+ * @return AcqTune_Event_t What happened in this call
+ */
+AcqTune_Event_t acqTune_poll(void);
+
+/**
+ * @brief Run in progress
+ */
+uint8_t acqTune_isRunning(void);
+
+/**
+ * @brief Progress of the current or last run
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer
+ */
+HAL_StatusTypeDef acqTune_getStatus(AcqTune_Status_t *status);
+
+/**
+ * @brief Outcome of a candidate of the current or last run
+ *
+ * @param index  Candidate, 0..ACQ_TUNE_CANDIDATES - 1
+ * @param result Receives it
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_BUSY  Not judged yet
+ *   @retval HAL_ERROR Index out of range or NULL pointer
+ */
+HAL_StatusTypeDef acqTune_getResult(uint32_t index, AcqTune_Result_t *result);
+
+/**
+ * @brief Set every channel's settling accuracy and the ADC DMA preset of a
+ *        candidate (the resolution is the application's); scan stopped
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Applied, from the next scan start
+ *   @retval HAL_BUSY  The scan is running
+ *   @retval HAL_ERROR NULL pointer, accuracy outside 6..12 or no such preset
+ */
+HAL_StatusTypeDef acqTune_applyAnalog(const AcqTune_Candidate_t *cand);
+
+/**
+ * @brief DMA FIFO setting of a preset, NULL if there is none
+ */
+const DmaTuning_Config_t *acqTune_getDmaPreset(uint8_t preset);
+
+/**
+ * @brief Verdict as a short word for report lines
+ */
+const char *acqTune_verdictName(AcqTune_Verdict_t verdict);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ACQ_TUNE_H */
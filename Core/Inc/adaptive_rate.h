@@ -0,0 +1,208 @@
+/**
+ ******************************************************************************
+ * @file    adaptive_rate.h
+ * @brief   Activity-driven frame rate: scan slowly while the machine is quiet
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * A stopped machine does not need 4 kHz. The controller watches the AC RMS
+ * of the selected channels, per block from the raw statistics (dsp_stats.h)
+ * and optionally from outside (spectral RMS, adaptiveRate_noteActivity()),
+ * and moves along a table of {frame rate, stream decimation} levels:
+ *
+ *   level 0: 4 kHz / 8 -> 500 Hz stream   (filter fc 200 Hz)
+ *   level 1: 1 kHz / 4 -> 250 Hz stream   (fc 50 Hz)
+ *   level 2: 250 Hz / 2 -> 125 Hz stream  (fc 12.5 Hz)
+ *
+ * The stream filter's corner scales with the scan rate, so each level's
+ * decimation keeps the stream alias-free.
+ *
+ * Hysteresis: activity at or above step_up_codes goes straight back to
+ * level 0; activity below step_down_codes for quiet_ms steps one level
+ * down; anything in between holds the level and restarts the quiet time.
+ * adaptiveRate_wake() (a trigger, a host command) also returns to level 0.
+ *
+ * adaptiveRate_poll() decides on the change in the main loop and stages
+ * the new rate with analogSensor_stageConfig(). The DMA interrupt swaps it
+ * in at the next block boundary. Right after the last block at the old
+ * rate it calls timeSync_setFrameRate() (the sync discipline owns ARR when
+ * it runs) and the apply callback, which retunes the stages that depend on
+ * the rate. No block is processed at a mix of rates. Without a timer-paced
+ * scan the rate is set at once, with interrupts masked.
+ *
+ * Step-up latency is one block at the slow rate plus a poll: about 1 s at
+ * 250 Hz with 256-frame blocks.
+ *
+ * Usage Example:
+ *   const AdaptiveRate_Config_t cfg = {.levels = NULL,   // defaults
+ *                                      .channel_mask = 0x07,
+ *                                      .step_up_codes = 40.0f,
+ *                                      .step_down_codes = 10.0f,
+ *                                      .quiet_ms = 10000,
+ *                                      .apply = App_ApplyRate};
+ *   adaptiveRate_init(&cfg, analogSensor_getBlockChannelMap());
+ *
+ *   // in the block callback (ISR)
+ *   adaptiveRate_processBlock(block, frame_count);
+ *
+ *   // main loop
+ *   AdaptiveRate_Status_t st;
+ *   if (adaptiveRate_poll(&st) == HAL_OK) {
+ *     // st.frame_rate_hz / st.decimation from st.first_frame on
+ *   }
+ *
+ * @note Build with ADAPTIVE_RATE_ENABLE=1 to run it from main.c.
+ ******************************************************************************
+ */
+
+#ifndef ADAPTIVE_RATE_H
+#define ADAPTIVE_RATE_H
+
+#include "adc_conversions.h"
+#include "stm32f7xx_hal.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+
+/**
+ * @brief Set to 1 to let main.c lower the scan rate while the machine is
+ *        quiet
+ */
+#ifndef ADAPTIVE_RATE_ENABLE
+#define ADAPTIVE_RATE_ENABLE 0
+#endif
+
+/**
+ * @brief Largest level table
+ */
+#ifndef ADAPTIVE_RATE_MAX_LEVELS
+#define ADAPTIVE_RATE_MAX_LEVELS 4U
+#endif
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief One operating point
+ */
+typedef struct {
+  uint32_t frame_rate_hz; ///< Scan rate (TIM2), a multiple of the sync rate
+  uint16_t decimation;    ///< Stream decimation at that rate
+} AdaptiveRate_Level_t;
+
+/**
+ * @brief Retune the rate-dependent stages; called from the DMA interrupt
+ *        at the block boundary of the change (or by adaptiveRate_poll()
+ *        with interrupts masked), so keep it short
+ *
+ * @param level New operating point
+ * @param ctx   Pointer given in the configuration
+ */
+typedef void (*AdaptiveRate_ApplyCallback_t)(const AdaptiveRate_Level_t *level,
+                                             void *ctx);
+
+/**
+ * @brief Controller settings
+ */
+typedef struct {
+  const AdaptiveRate_Level_t *levels; ///< Fastest first, NULL = defaults
+  uint8_t level_count;  ///< Entries in levels (ignored for the defaults)
+  ADC_ChannelMask_t channel_mask; ///< Channels watched (bit n = channel n)
+  float step_up_codes;   ///< AC RMS that returns to level 0
+  float step_down_codes; ///< AC RMS below which the machine is quiet
+  uint32_t quiet_ms;     ///< Quiet time before each step down
+  AdaptiveRate_ApplyCallback_t apply; ///< May be NULL
+  void *ctx;                          ///< Passed to apply
+} AdaptiveRate_Config_t;
+
+/**
+ * @brief Current operating point and counters
+ */
+typedef struct {
+  uint8_t level;          ///< Index into the level table, 0 = fastest
+  uint32_t frame_rate_hz; ///< Rate of that level
+  uint16_t decimation;    ///< Decimation of that level
+  float activity;         ///< AC RMS of the last poll window (codes)
+  uint32_t first_frame;   ///< First frame at the new rate
+  uint32_t changed_ms;    ///< HAL tick of the last change
+  uint32_t steps_up;      ///< Returns to level 0
+  uint32_t steps_down;    ///< Single steps down
+} AdaptiveRate_Status_t;
+
+/* Exported variables --------------------------------------------------------*/
+
+/**
+ * @brief Default levels for the 4 kHz scan and dspFilter_lowpass200Hz
+ */
+extern const AdaptiveRate_Level_t adaptiveRate_defaultLevels[3];
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief Configure the controller; starts at level 0
+ *
+ * @param cfg         Settings; copied (the level table is kept by pointer)
+ * @param channel_map Raw block slot -> channel (NULL = identity)
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL config, no channel, empty or oversized table,
+ *                     zero rate or decimation, step_down above step_up
+ *
+ * @note Level 0 must be the rate the scan was started at.
+ */
+HAL_StatusTypeDef adaptiveRate_init(const AdaptiveRate_Config_t *cfg,
+                                    const uint8_t *channel_map);
+
+/**
+ * @brief Measure the activity of one block of raw frames (ISR)
+ *
+ * @param block  Interleaved frames
+ * @param frames Frames in the block
+ */
+void adaptiveRate_processBlock(const uint16_t *block, uint32_t frames);
+
+/**
+ * @brief Add an activity measure from another stage, e.g. a spectrum RMS
+ *
+ * @param rms_codes AC RMS in ADC codes
+ */
+void adaptiveRate_noteActivity(float rms_codes);
+
+/**
+ * @brief Return to level 0 at the next poll, whatever the activity
+ */
+void adaptiveRate_wake(void);
+
+/**
+ * @brief Evaluate the activity since the previous poll and change the rate
+ *        if due; call from the main loop
+ *
+ * @param status Receives the new operating point on a change, may be NULL
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Rate changed
+ *   @retval HAL_BUSY  No change
+ *   @retval HAL_ERROR Not initialised, or TIM2 refused the rate (level kept)
+ */
+HAL_StatusTypeDef adaptiveRate_poll(AdaptiveRate_Status_t *status);
+
+/**
+ * @brief Copy the current operating point and counters
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    status filled
+ *   @retval HAL_ERROR status is NULL
+ */
+HAL_StatusTypeDef adaptiveRate_getStatus(AdaptiveRate_Status_t *status);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ADAPTIVE_RATE_H */
@@ -0,0 +1,220 @@
+/**
+ ******************************************************************************
+ * @file    adc_bench.h
+ * @brief   On-target benchmark scenarios of the acquisition and DSP chain
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * Built into the ADC_6_channels_bench image (ADC_BENCH_BUILD=1), which runs
+ * the scenarios right after the CubeMX initialisation instead of the
+ * application loop. Every scenario is measured on the DWT cycle counter at
+ * the active clock profile and printed over USART3 as one text line:
+ *
+ *   BENCH <name> cyc_frame=<n> max_hz=<n> load_pct=<n.nn> ram=<bytes>
+ *
+ *   - cyc_frame: CPU cycles spent per frame (every channel)
+ *   - max_hz:    highest frame rate the scenario sustains, the lower of the
+ *                CPU bound (HCLK / cyc_frame) and the ADC bound of the scan
+ *   - load_pct:  CPU share at the nominal ADC_BENCH_FRAME_RATE_HZ
+ *   - ram:       static RAM of the stage (buffers and state), in bytes
+ *
+ * A "BENCH begin" line with the profile and HCLK opens the report and
+ * "BENCH end" closes it, so a host script can cut one report per run and
+ * compare releases or clock profiles line by line.
+ *
+ * Scenarios: poll_hal, poll_ll, dma_scan, multi_adc, filter, fft, framing,
+ * codec, cal_separate, fused, deinterleave, deinterleave_dma2d, multirate.
+ * The DSP ones run on blocks converted by the ADC at the start of the run, so
+ * they see the real signal.
+ *
+ * poll_hal, filter, fft and framing are then repeated in every flash mode
+ * (flash_mode.h), fetched over AXIM or the ITCM flash interface with ART
+ * and prefetch on or off, as cycles per frame on one line per mode:
+ *
+ *   BENCH flash mode=<name> poll_hal=<n> filter=<n> fft=<n> framing=<n>
+ *         total=<n>
+ *   BENCH flash best=<name> default=<name>
+ *
+ * Next, the streams are given each FIFO preset of dma_tuning.h (direct,
+ * half FIFO with 4-beat bursts, full FIFO with 8-beat bursts) and the pool
+ * scan is stepped down from its ADC bound in eighths, ADC_BENCH_DMA_RUN_MS
+ * per step, while USART3 is kept full of "BENCH dma fill" lines and DMA2
+ * stream 1 copies memory in word bursts, standing in for the SDMMC and
+ * Ethernet traffic. The first rate without an overrun, a dropped block or
+ * a DMA error is the sustainable one; its line gives the bandwidth of each
+ * stream and the total the bus matrix carried:
+ *
+ *   BENCH dma preset=<name> adc_hz=<n> adc_Bps=<n> uart_Bps=<n>
+ *         bus_Bps=<n> total_Bps=<n>
+ *
+ * The CPU then reads a 4 kB buffer in each RAM bank (adc_sections.h), the
+ * D-cache invalidated before every pass, once idle and once beside the
+ * full-rate pool scan, the bus load (both SRAM1) and USART3 (SRAM2), as
+ * cycles per kB:
+ *
+ *   BENCH sram bank=<dtcm|sram1|sram2> idle_cyc_kb=<n> load_cyc_kb=<n>
+ *         bus_Bps=<n>
+ *
+ * Last come the copy bandwidths: 4 kB copied 1024 times by memcpy() and by
+ * memory-to-memory DMA on DMA2 stream 1, within each RAM bank and from
+ * flash into DTCM, once idle and once beside the full-rate pool scan and a
+ * full USART3, in bytes per second. Flash is read over AXIM and, by the
+ * CPU only, over the ITCM interface in the active flash mode:
+ *
+ *   BENCH memcpy region=<dtcm|sram1|sram2|flash_axim|flash_itcm>
+ *         idle_Bps=<n> load_Bps=<n>
+ *   BENCH m2m region=<dtcm|sram1|sram2|flash_axim> idle_Bps=<n>
+ *         load_Bps=<n>
+ *
+ * Then the interrupt entry: the spare HDMI-CEC vector is pended from
+ * NVIC->STIR and its naked handler reads CYCCNT as its first load. The
+ * thread runs without FP context, with it and lazy stacking, and with it
+ * and stacking at entry (irq_priority.h), each with an FPU-free handler and
+ * with one whose first FP instruction is timed. In CPU cycles, the NVIC
+ * write included:
+ *
+ *   BENCH irq_entry ctx=<int|fp_lazy|fp_full> min=<n> mean=<n>
+ *         fp_min=<n> fp_mean=<n> fp_first=<n>
+ *
+ *   - min/mean:       STIR write to that load
+ *   - fp_min/fp_mean: the same, the handler using the FPU
+ *   - fp_first:       mean cycles of that handler's first FP instruction,
+ *                     where lazy preservation writes the registers
+ *
+ * With DAC_LOOPBACK_ENABLE the DAC loopback self-test (dac_loopback.h)
+ * runs last, in every clock profile and at 6, 9 and 12 bits of settling on
+ * the test channel, and the active profile is restored afterwards:
+ *
+ *   BENCH loopback profile=<id> bits=<n> adcclk=<hz> smp=<cycles>
+ *         rate_mhz=<n> max_hz=<n> sample_us=<n> react_us=<n>
+ *         total_max_us=<n> enob=<n.nn> snr=<dB> thd=<dB> sfdr=<dB>
+ *         fft_enob=<n.nn>
+ *
+ *   - max_hz:   fastest scan at that clock and those sampling times
+ *               (analogSensor_getMaxFrameRate()), the throughput side
+ *   - enob:     from the sine fit of the tone frames
+ *   - snr..fft_enob: the same frames through dsp_quality.h; the SNR leaves
+ *               out the harmonics, where the DAC's staircase lands
+ * Plotted as ENOB against max_hz, the lines give the speed/accuracy Pareto
+ * front of the configurations.
+ *
+ * With ADC_BENCH_QUALITY_ENABLE an external generator's tone on
+ * ADC_BENCH_QUALITY_CHANNEL is taken by the interleaved capture in every
+ * clock profile, the fastest the ADCs can sample one input:
+ *
+ *   BENCH quality profile=<id> ch=<n> max_hz=<capture rate> tone_hz=<n>
+ *         amp=<codes> snr=<dB> sinad=<dB> thd=<dB> sfdr=<dB> enob=<n.nn>
+ *
+ * Usage Example:
+ *   // main.c, after the peripherals are initialised
+ *   #if ADC_BENCH_BUILD
+ *   adcBench_main();    // never returns; any USART3 byte repeats the run
+ *   #endif
+ *
+ ******************************************************************************
+ */
+
+#ifndef ADC_BENCH_H
+#define ADC_BENCH_H
+
+#include "stm32f7xx_hal.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+
+/**
+ * @brief Set to 1 (by the ADC_6_channels_bench target) to build the
+ *        benchmark image instead of the application
+ */
+#ifndef ADC_BENCH_BUILD
+#define ADC_BENCH_BUILD 0
+#endif
+
+/**
+ * @brief Vector pended by the interrupt entry scenario (unused on this
+ *        board)
+ */
+#ifndef ADC_BENCH_IRQn
+#define ADC_BENCH_IRQn CEC_IRQn
+#endif
+
+/**
+ * @brief Frame rate the CPU load figures refer to (the application's rate)
+ */
+#ifndef ADC_BENCH_FRAME_RATE_HZ
+#define ADC_BENCH_FRAME_RATE_HZ 4000U
+#endif
+
+/**
+ * @brief Duration of each DMA scenario
+ */
+#ifndef ADC_BENCH_DMA_RUN_MS
+#define ADC_BENCH_DMA_RUN_MS 500U
+#endif
+
+/**
+ * @brief Polling rounds (frames) of the poll_hal / poll_ll scenarios
+ */
+#ifndef ADC_BENCH_POLL_ROUNDS
+#define ADC_BENCH_POLL_ROUNDS 200U
+#endif
+
+/**
+ * @brief Set to 1 to add the external-generator quality lines; the channel
+ *        must be wired to all three ADCs
+ */
+#ifndef ADC_BENCH_QUALITY_ENABLE
+#define ADC_BENCH_QUALITY_ENABLE 0
+#endif
+#ifndef ADC_BENCH_QUALITY_CHANNEL
+#define ADC_BENCH_QUALITY_CHANNEL ADC_CH_SENSOR1_X
+#endif
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief Result of one scenario
+ */
+typedef struct {
+  uint32_t cycles_per_frame; ///< CPU cycles per frame (every channel)
+  uint32_t max_rate_hz;      ///< Sustainable frame rate
+  uint32_t load_centi_pct;   ///< CPU load at ADC_BENCH_FRAME_RATE_HZ, 0.01 %
+  uint32_t ram_bytes;        ///< Static RAM of the stage
+} ADC_BenchResult_t;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief Run every scenario once and queue the report on the telemetry link
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    All scenarios ran
+ *   @retval HAL_ERROR A scenario could not start; its line reports "error"
+ */
+HAL_StatusTypeDef adcBench_run(void);
+
+/**
+ * @brief Benchmark image main loop: run, then repeat on any USART3 byte
+ *
+ * @note Expects telemetry_init() to have been called; does not return
+ */
+void adcBench_main(void);
+
+/**
+ * @brief Interrupt entry scenario: body of the vector's naked handler
+ *
+ * @param stamp CYCCNT read by the handler's first instruction
+ */
+void adcBench_irqEntry(uint32_t stamp);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ADC_BENCH_H */
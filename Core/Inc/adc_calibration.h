@@ -0,0 +1,166 @@
+/**
+ ******************************************************************************
+ * @file    adc_calibration.h
+ * @brief   Per-channel calibration and fixed-point conversion to mg
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * Every three channels form a 3-axis group (0-2, 3-5, ...; two groups with
+ * the default table). Each channel has a zero-g offset in ADC codes. Each
+ * group has a 3x3 matrix that folds the per-axis gain (mg per code) and the
+ * cross-axis sensitivity together:
+ *
+ *   mg[i] = sum_j M[i][j] * (code[j] - offset[j])
+ *
+ * M is stored as q15 with ADC_CAL_MATRIX_FRAC_BITS fractional bits
+ * (+-4 mg/code). The block converters compute each output with two SMLAD
+ * dual-MACs and saturate it. The q15 output is mg with a 1 mg LSB; the q31
+ * output has the same +-32768 mg full scale with 2^-16 mg resolution.
+ *
+ * The table lives in flash sector 7 (0x080C0000, kept out of the firmware
+ * image by the linker script), with a magic word, a version and a CRC-32.
+ * adcCal_init() loads it at boot and falls back to nominal values when
+ * the record is missing or corrupt.
+ *
+ * Usage Example:
+ *   adcCal_init();
+ *
+ *   // in the block callback or the main loop
+ *   static int16_t mg[ADC_CONVERSIONS_BLOCK_SAMPLES];
+ *   adcCal_convertBlock_q15(block, frame_count,
+ *                           analogSensor_getBlockChannelMap(), mg);
+ *   // mg[frame * ADC_CONVERSIONS_CHANNEL_COUNT + channel]
+ *
+ *   // after a calibration run
+ *   ADC_CalTable_t table = *adcCal_getTable();
+ *   table.offset[2] = 2071;
+ *   adcCal_setTable(&table);
+ *   adcCal_save();   // erases and rewrites sector 7, ~1-2 s
+ *
+ ******************************************************************************
+ */
+
+#ifndef ADC_CALIBRATION_H
+#define ADC_CALIBRATION_H
+
+#include "adc_conversions.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+
+#define ADC_CAL_AXES 3U         ///< Channels per sensor group
+/** Groups: channels 0-2 and 3-5 */
+#define ADC_CAL_GROUP_COUNT (ADC_CONVERSIONS_CHANNEL_COUNT / ADC_CAL_AXES)
+#define ADC_CAL_MATRIX_FRAC_BITS 13U ///< q15 matrix: mg/code x 2^13
+
+/**
+ * @brief Nominal LISXXXALH scale: Vdd/5 per g at 12 bit -> 819 codes/g
+ */
+#define ADC_CAL_NOMINAL_MG_PER_CODE 1.2207f
+#define ADC_CAL_NOMINAL_OFFSET 2048 ///< Ratiometric zero g: Vdd / 2
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief Calibration of all channels (stored as-is in flash)
+ */
+typedef struct {
+  int16_t offset[ADC_CONVERSIONS_CHANNEL_COUNT]; ///< Zero-g code per channel
+  int16_t matrix[ADC_CAL_GROUP_COUNT][ADC_CAL_AXES][ADC_CAL_AXES]; ///< q15
+} ADC_CalTable_t;
+
+/**
+ * @brief Where the active table came from
+ */
+typedef enum {
+  ADC_CAL_SOURCE_DEFAULT = 0, ///< Nominal values, no valid flash record
+  ADC_CAL_SOURCE_FLASH,       ///< Loaded from sector 7
+  ADC_CAL_SOURCE_RUNTIME      ///< Set by adcCal_setTable(), not yet saved
+} ADC_CalSource_t;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief Load the table from flash, or the nominal table if none is stored
+ *
+ * @return ADC_CalSource_t Source of the active table
+ */
+ADC_CalSource_t adcCal_init(void);
+
+/**
+ * @brief Active table
+ */
+const ADC_CalTable_t *adcCal_getTable(void);
+
+/**
+ * @brief Source of the active table
+ */
+ADC_CalSource_t adcCal_getSource(void);
+
+/**
+ * @brief Replace the active table (RAM only, see adcCal_save())
+ *
+ * @param table New calibration
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer
+ */
+HAL_StatusTypeDef adcCal_setTable(const ADC_CalTable_t *table);
+
+/**
+ * @brief Write the active table to flash sector 7
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Written and read back
+ *   @retval HAL_ERROR Erase, program or verify failed
+ *
+ * @note Blocks for the sector erase (up to ~2 s); flash reads (code)
+ *       stall meanwhile, so run it with acquisition stopped.
+ */
+HAL_StatusTypeDef adcCal_save(void);
+
+/**
+ * @brief Build a matrix entry for a gain in mg per code
+ *
+ * @param mg_per_code Gain, within +-4 mg/code
+ *
+ * @return int16_t q15 matrix coefficient
+ */
+int16_t adcCal_gainToQ15(float mg_per_code);
+
+/**
+ * @brief Convert interleaved raw frames to mg, q15 (1 mg LSB)
+ *
+ * @param block       Raw frames
+ * @param frames      Number of frames
+ * @param channel_map Raw block slot -> channel (NULL = identity)
+ * @param out         frames x ADC_CONVERSIONS_CHANNEL_COUNT results, in
+ *                    channel order
+ */
+void adcCal_convertBlock_q15(const uint16_t *block, uint32_t frames,
+                             const uint8_t *channel_map, int16_t *out);
+
+/**
+ * @brief Convert interleaved raw frames to mg, q31 (2^-16 mg LSB)
+ *
+ * @param block       Raw frames
+ * @param frames      Number of frames
+ * @param channel_map Raw block slot -> channel (NULL = identity)
+ * @param out         frames x ADC_CONVERSIONS_CHANNEL_COUNT results, in
+ *                    channel order
+ */
+void adcCal_convertBlock_q31(const uint16_t *block, uint32_t frames,
+                             const uint8_t *channel_map, int32_t *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ADC_CALIBRATION_H */
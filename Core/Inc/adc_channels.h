@@ -0,0 +1,192 @@
+/**
+ ******************************************************************************
+ * @file    adc_channels.h
+ * @brief   Compile-time description of the acquired ADC channels
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * ADC_CHANNELS_TABLE() is the only place a channel is declared. One row per
+ * channel, in channel-index order:
+ *
+ *   X(name, adc_channel, source_ohms, accuracy_bits, adcs, triple_slot)
+ *
+ *   - name:          suffix of the ADC_CH_<name> index
+ *   - adc_channel:   ADC_CHANNEL_x of the input pin
+ *   - source_ohms:   output impedance of what drives the pin (R_AIN)
+ *   - accuracy_bits: settling required before the conversion, 6..12 bits;
+ *                    with source_ohms it sets the sampling time (see
+ *                    analogSensor_setChannelProfile())
+ *   - adcs:          ADCs wired to the pin (ADC_CHANNELS_ADC123 / _ADC12)
+ *   - triple_slot:   position in a triple-simultaneous frame; slot s is
+ *                    converted by ADC (s % 3) + 1 at rank (s / 3) + 1
+ *
+ * Everything sized or ordered by channel is expanded from it: the index
+ * enum, ADC_CONVERSIONS_CHANNEL_COUNT (and with it the DMA, ring, capture
+ * and telemetry sizes and the per-channel DSP state), the sConfig[] used
+ * for the scan and polling sequences, the default channel profiles, and
+ * the DMA slot order of every multimode layout. adc_conversions.c refuses
+ * to build when a row does not fit: more than ADC_CHANNELS_MAX channels,
+ * adcs that do not match the pin, triple slots that are not a permutation,
+ * a slot given to an ADC that is not wired to the pin, or a table no
+ * multimode layout can scan. A layout that cannot split the count evenly,
+ * needs more than 16 ranks per ADC, or an ADC not wired to every channel
+ * is rejected by analogSensor_setMultimode().
+ *
+ * The board may bring its own table: define ADC_CHANNELS_TABLE() before
+ * this header is included (a -include of a board header, for instance).
+ * The F746 has 24 external inputs, IN0-IN15 on ADC1/2 (PA0-PA7, PB0-PB1,
+ * PC0-PC5, IN0-IN3 and IN10-IN13 on ADC3 as well) and eight more on ADC3
+ * alone (port F); ADC_CHANNELS_PIN_PORT()/_PIN_NUMBER() give the pin of a
+ * row and adc.c sets exactly those pins to analog. Tables of more than 16
+ * channels, or with ADC3-only pins, run the triple-simultaneous scan (a
+ * multiple of 3 channels, at most 16 ranks on each ADC), e.g. 18 inputs:
+ *
+ *   X(S1_X, ADC_CHANNEL_0, 50U, 12U, ADC_CHANNELS_ADC123, 0)
+ *   X(S1_Y, ADC_CHANNEL_4, 50U, 12U, ADC_CHANNELS_ADC12, 1)
+ *   X(S1_Z, ADC_CHANNEL_4, 50U, 12U, ADC_CHANNELS_ADC3, 2)   // PF6
+ *   ...
+ *
+ * Polling reads convert ADC3-only channels on ADC3, everything else on
+ * ADC1.
+ *
+ * Usage Example:
+ *   #define MY_PIN(name, channel, ohms, bits, adcs, slot) (channel),
+ *   static const uint32_t pins[] = {ADC_CHANNELS_TABLE(MY_PIN)};
+ *
+ *   analogSensor_operation(ADC_CH_SENSOR2_X);
+ *
+ ******************************************************************************
+ */
+
+#ifndef ADC_CHANNELS_H
+#define ADC_CHANNELS_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+
+#define ADC_CHANNELS_ADC1 (1U << 0)
+#define ADC_CHANNELS_ADC2 (1U << 1)
+#define ADC_CHANNELS_ADC3 (1U << 2)
+#define ADC_CHANNELS_ADC12 (ADC_CHANNELS_ADC1 | ADC_CHANNELS_ADC2)
+#define ADC_CHANNELS_ADC123 (ADC_CHANNELS_ADC12 | ADC_CHANNELS_ADC3)
+
+/**
+ * @brief External ADC inputs of the F746 (16 on ADC1/2, 8 on ADC3 alone)
+ */
+#define ADC_CHANNELS_MAX 24U
+
+/* GPIO ports of the analog pins (GPIOA + port * 0x400) */
+#define ADC_CHANNELS_PORT_A 0U
+#define ADC_CHANNELS_PORT_B 1U
+#define ADC_CHANNELS_PORT_C 2U
+#define ADC_CHANNELS_PORT_F 5U
+
+/**
+ * @brief Two LISXXXALH 3-axis accelerometers on PA0-PA5: sensor 1 behind
+ *        op-amp buffers, sensor 2 through the 10 kOhm of its RC filter
+ * @note IN4/IN5 (PA4/PA5) are ADC1/2 only, so in the triple scan they go
+ *       to ADC1/ADC2 at rank 2 and channel 3 moves to ADC3
+ */
+#ifndef ADC_CHANNELS_TABLE
+#define ADC_CHANNELS_TABLE(X)                                                \
+  X(SENSOR1_X, ADC_CHANNEL_0, 50U, 12U, ADC_CHANNELS_ADC123, 0)              \
+  X(SENSOR1_Y, ADC_CHANNEL_1, 50U, 12U, ADC_CHANNELS_ADC123, 1)              \
+  X(SENSOR1_Z, ADC_CHANNEL_2, 50U, 12U, ADC_CHANNELS_ADC123, 2)              \
+  X(SENSOR2_X, ADC_CHANNEL_3, 10000U, 12U, ADC_CHANNELS_ADC123, 5)           \
+  X(SENSOR2_Y, ADC_CHANNEL_4, 10000U, 12U, ADC_CHANNELS_ADC12, 3)            \
+  X(SENSOR2_Z, ADC_CHANNEL_5, 10000U, 12U, ADC_CHANNELS_ADC12, 4)
+#endif
+
+/**
+ * @brief Pin of an input: ADC1/2 IN0-7 on PA0-7, IN8-9 on PB0-1, IN10-15
+ *        on PC0-5; ADC3-only IN4-8 on PF6-10, IN9 on PF3, IN14-15 on PF4-5
+ */
+#define ADC_CHANNELS_PIN_PORT(channel, adcs)                                 \
+  ((((adcs) & ADC_CHANNELS_ADC12) == 0U) ? ADC_CHANNELS_PORT_F               \
+   : ((channel) < 8U)                    ? ADC_CHANNELS_PORT_A               \
+   : ((channel) < 10U)                   ? ADC_CHANNELS_PORT_B               \
+                                         : ADC_CHANNELS_PORT_C)
+#define ADC_CHANNELS_PIN_NUMBER(channel, adcs)                               \
+  ((((adcs) & ADC_CHANNELS_ADC12) == 0U)                                     \
+       ? (((channel) == 9U)    ? 3U                                          \
+          : ((channel) >= 14U) ? (channel) - 10U                             \
+                               : (channel) + 2U)                             \
+   : ((channel) < 8U)  ? (channel)                                           \
+   : ((channel) < 10U) ? (channel) - 8U                                      \
+                       : (channel) - 10U)
+#define ADC_CHANNELS_PIN_BIT(port, channel, adcs)                            \
+  ((ADC_CHANNELS_PIN_PORT(channel, adcs) == (port))                          \
+       ? (1UL << ADC_CHANNELS_PIN_NUMBER(channel, adcs))                     \
+       : 0UL)
+
+/* Expanders -----------------------------------------------------------------*/
+
+#define ADC_CHANNELS_X_ONE(name, channel, ohms, bits, adcs, slot) +1
+#define ADC_CHANNELS_X_ID(name, channel, ohms, bits, adcs, slot) ADC_CH_##name,
+#define ADC_CHANNELS_X_ADC12(name, channel, ohms, bits, adcs, slot)          \
+  &&(((adcs) & ADC_CHANNELS_ADC12) == ADC_CHANNELS_ADC12)
+#define ADC_CHANNELS_X_PIN_A(name, channel, ohms, bits, adcs, slot)          \
+  | ADC_CHANNELS_PIN_BIT(ADC_CHANNELS_PORT_A, channel, adcs)
+#define ADC_CHANNELS_X_PIN_B(name, channel, ohms, bits, adcs, slot)          \
+  | ADC_CHANNELS_PIN_BIT(ADC_CHANNELS_PORT_B, channel, adcs)
+#define ADC_CHANNELS_X_PIN_C(name, channel, ohms, bits, adcs, slot)          \
+  | ADC_CHANNELS_PIN_BIT(ADC_CHANNELS_PORT_C, channel, adcs)
+#define ADC_CHANNELS_X_PIN_F(name, channel, ohms, bits, adcs, slot)          \
+  | ADC_CHANNELS_PIN_BIT(ADC_CHANNELS_PORT_F, channel, adcs)
+
+/**
+ * @brief Number of channels; a plain integer expression, usable in #if
+ */
+#define ADC_CHANNELS_COUNT (0 ADC_CHANNELS_TABLE(ADC_CHANNELS_X_ONE))
+
+/**
+ * @brief 1 when every channel is wired to ADC1 and ADC2 (usable in #if)
+ */
+#define ADC_CHANNELS_ALL_ADC12 (1 ADC_CHANNELS_TABLE(ADC_CHANNELS_X_ADC12))
+
+/**
+ * @brief Analog pins per port (GPIO_PIN_x bits)
+ */
+#define ADC_CHANNELS_PINS_A (0UL ADC_CHANNELS_TABLE(ADC_CHANNELS_X_PIN_A))
+#define ADC_CHANNELS_PINS_B (0UL ADC_CHANNELS_TABLE(ADC_CHANNELS_X_PIN_B))
+#define ADC_CHANNELS_PINS_C (0UL ADC_CHANNELS_TABLE(ADC_CHANNELS_X_PIN_C))
+#define ADC_CHANNELS_PINS_F (0UL ADC_CHANNELS_TABLE(ADC_CHANNELS_X_PIN_F))
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief Channel indices, as used by analogSensor_operation() and the
+ *        per-channel arrays
+ */
+typedef enum { ADC_CHANNELS_TABLE(ADC_CHANNELS_X_ID) } ADC_ChannelId_t;
+
+/**
+ * @brief One bit per channel (bit n = channel n), as narrow as the table
+ *        allows: uint8_t up to 8 channels
+ */
+#if ADC_CHANNELS_COUNT <= 8
+typedef uint8_t ADC_ChannelMask_t;
+#elif ADC_CHANNELS_COUNT <= 16
+typedef uint16_t ADC_ChannelMask_t;
+#else
+typedef uint32_t ADC_ChannelMask_t;
+#endif
+
+/**
+ * @brief Mask of every channel
+ */
+#define ADC_CHANNELS_MASK_ALL                                                \
+  ((ADC_ChannelMask_t)((1UL << ADC_CHANNELS_COUNT) - 1UL))
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ADC_CHANNELS_H */
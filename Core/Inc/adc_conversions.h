@@ -14,8 +14,8 @@
  * initialized and calibrated.
  *
  * Assumptions to guide this design:
- *   - The code was targeting STM32H7 series with HAL library per the HAL
- macros.
+ *   - The original code was written against the STM32H7 HAL; it now builds
+ *     for the STM32F746 only (see "Targets" in README.md)
  *   - The sensors is MEMS accelerometer LISXXXALH series.
  *   - The code using private LISXXXALH.h header for sensor-specific settings.
  *   - ADC is configured for single-ended input
@@ -28,7 +28,8 @@
  * 
  * Bug fixes and improvements:
  *   - Fixed overflow writing to raw_LISXXXALH[] when snsrID invalid
- *   - Fixed runtime mutation of sConfig (optimizer-safe)
+ *   - Fixed runtime mutation of sConfig (optimizer-safe); generated from
+ *     ADC_CHANNELS_TABLE() in adc_channels.h
  *   - Reduce complexity and if/else checks. using fall through method.
  *   - Added return checks for HAL functions, with error tracking
  *   - Fixed missing channel config per AN2834
@@ -39,21 +40,120 @@
  *
  * Features:
  *   - Simple polling-based operation (blocking)
+ *   - Circular-DMA scan mode: the rank sequence programmed by MX_ADC1_Init()
+ *     is started once and DMA2 Stream0 fills a ping-pong block buffer
+ *   - Block API: each half of the DMA buffer (analogSensor_getBlockFrames()
+ *     interleaved frames) is handed off through a callback or a ready flag
+ *   - Timer-paced scan mode: TIM2 TRGO starts each scan at a fixed rate, so
+ *     the sample period no longer depends on main-loop timing
  *   - Full error tracking and diagnostics
  *   - Error codes stored in data array for easy detection
  *   - Lightweight and easy to debug
  * 
+ *   - Packed frame storage: 16-bit samples with a per-frame failed-channel
+ *     bitmask and error code kept out of band (ADC_Frame_t)
+ *   - Shock capture: ADC1/2/3 triple-interleaved on one input (~5.4 MSPS)
+ *     fill a dedicated one-shot buffer; selectable at runtime instead of the
+ *     6-channel scan
+ *   - Multi-ADC simultaneous scan: ADC1+ADC2 (3 ranks each) or
+ *     ADC1+ADC2+ADC3 (2 ranks each) convert in lock-step through the common
+ *     ADC registers, so channels 0/1/2 are sampled at the same instant
+ *   - Streaming statistics: mean, variance, RMS, min/max and crest factor
+ *     per channel, accumulated in one integer pass over every DMA block
+ *   - Fast register mode (ADC_CONVERSIONS_FAST_CONFIG): the polling path
+ *     selects a channel with two register stores built once from sConfig[]
+ *   - Channel profiles: sampling time per channel derived from its source
+ *     impedance and required accuracy, with the resulting frame-rate limit
+ *     reported per ADC prescaler
+ *   - LL polling backend (ADC_CONVERSIONS_LL_POLLING): the polling read
+ *     drives the ADC1 registers directly, with a cycle-count EOC timeout;
+ *     analogSensor_benchmarkBackends() times both backends on the DWT
+ *   - Injected reads: analogSensor_operation() and
+ *     analogSensor_readInjected() convert one channel through the injected
+ *     group, which pre-empts the regular scan for a single conversion, so
+ *     control-loop reads no longer stop the DMA stream
+ *   - Fast DMA interrupt (ADC_CONVERSIONS_FAST_DMA_ISR): the scan's half
+ *     and full transfer flags are handled without the HAL dispatch, with
+ *     the cycles of both paths timed per half-block
+ *   - Asynchronous reads: analogSensor_operation_async() queues
+ *     single-channel conversions that run back-to-back from the ADC
+ *     interrupt and report through a callback, so the caller never spins on
+ *     EOC
+ *   - Analog watchdog: out-of-window alarms for up to one guarded channel
+ *     per ADC in the scan, raised by the hardware at no CPU cost per sample
+ *   - Block timestamps: each DMA block is stamped once with the 64-bit
+ *     timebase (timebase.h) next to its first frame index, and the stamps
+ *     feed a frame-rate / drift / jitter estimator
+ *   - Internal sources: the temperature sensor and VREFINT through the
+ *     injected group, and a q14 gain applied to each DMA block in place
+ *     (ratiometric supply correction, adc_supply.h)
+ *   - Overrun recovery: an OVR of the DMA scan is repaired in the ADC
+ *     interrupt by restarting the stream at the frame due next, without
+ *     re-initialising the ADCs; the lost frames are flagged in the ring
+ *   - Conversion timing: the EOC wait of a polling read is bounded by a
+ *     small multiple of the channel's expected conversion time in CPU
+ *     cycles, and the observed times are kept as a histogram
+ *   - Weighted sequence: a channel mask and per-channel weights mapped to
+ *     the 16 regular ranks of ADC1, so critical channels are converted
+ *     several times per scan and disabled ones not at all
+ *   - Grouped scan: ADC1's sequence split into discontinuous groups (one
+ *     tri-axis device each by default), one TIM2 trigger and one hand-off
+ *     per group, so the first device's samples are out a group period
+ *     before the last one's
+ *   - Staged reconfiguration: a new frame rate and channel profiles are
+ *     swapped into the running timer-paced scan at the next block boundary
+ *     by the DMA interrupt, and the first frame under them is flagged
+ *   - Instances: ADC_SensorCtx_t holds the handle, channel table, newest
+ *     frame and error matrix of one ADC; the analogSensor_ctx*() calls poll
+ *     ADC2/ADC3 with their own tables while ADC1 runs the default instance,
+ *     which the global API wraps
+ *   - Block subscribers: analogSensor_subscribe() adds consumers with their
+ *     own channel mask and block decimation, run by
+ *     analogSensor_dispatchBlock() in the DSP context
+ *   - Bulk read: analogSensor_readFrames() drains up to N consecutive
+ *     frames from the ring in one call, with the first sequence number
+ *   - Latest-frame snapshot: analogSensor_getLatestFrame() copies the newest
+ *     complete frame with its sequence number and timestamp under a
+ *     sequence counter, consistent across all channels without masking
+ *     interrupts
+ *   - Replay: analogSensor_startReplay() stops using the ADCs and hands
+ *     blocks from a recording through the same DMA interrupt hand-off, at
+ *     the scan rate or as fast as the pipeline takes them (adc_replay.h)
+ *   - Resolution per ADC: 10, 8 or 6 bits take 2, 4 or 6 ADCCLK cycles
+ *     less per conversion; every mode rescales the codes to 12 bits (top
+ *     bits repeated below, so the rails stay 0 and 4095) before anything
+ *     reads them, and the rate limits follow
+ *   - Sensor range hook: a function told each block before the ring marks
+ *     the sensor range its frames were taken on, and voids the samples a
+ *     range switch leaves settling (adc_range.h)
+ *
  * Usage Example:
  *   // Read single channel
  *   analogSensor_operation(0);
+ *   ADC_Frame_t frame;
+ *   analogSensor_getFrame(&frame);
+ *   if ((frame.error_mask & (1U << 0)) == 0) {
+ *     // Valid ADC value in frame.samples[0]
+ *   } else {
+ *     // Error occurred, reason in frame.error_code
+ *   }
+ *
+ *   // Legacy view (ADC_CONVERSIONS_LEGACY_VIEW): values >= 0xFFFC are errors
  *   if (raw_LISXXXALH[0] <= 4095) {
  *     // Valid ADC value
- *   } else {
- *     // Error occurred (value >= 0xFFFC)
  *   }
  *
  *   // Read all channels
- *   analogSensor_operation_all_channels(6);
+ *   analogSensor_operation_all_channels(ADC_CONVERSIONS_CHANNEL_COUNT);
+ *
+ *   // Or let DMA refresh all channels in the background
+ *   analogSensor_startDMA();
+ *   // ... raw_LISXXXALH[] now holds the newest frame of each block ...
+ *   const uint16_t *block = analogSensor_getReadyBlock();
+ *   if (block != NULL) {
+ *     // block[frame * ADC_CONVERSIONS_CHANNEL_COUNT + channel]
+ *   }
+ *   analogSensor_stopDMA();
  *
  *   // Check for errors
  *   if (analogSensor_getErrorCount() > 0) {
@@ -68,9 +168,16 @@
 #ifndef ADC_CONVERSIONS_H
 #define ADC_CONVERSIONS_H
 
+#include "adc_channels.h"
 #include "stm32f7xx_hal.h"
 #include <stdint.h>
 
+/* The register-level paths (scan, multimode, LL polling, DMA2 streams) are
+ * written for the F7 ADC; another family needs its own port, not a define */
+#ifndef STM32F7
+#error "adc_conversions: only the STM32F7 ADC is supported"
+#endif
+
 
 #ifdef __cplusplus
 extern "C" {
@@ -79,26 +186,680 @@ extern "C" {
 /* Exported constants --------------------------------------------------------*/
 
 /**
- * @brief Number of ADC channels
+ * @brief Number of ADC channels (rows of ADC_CHANNELS_TABLE())
+ */
+#define ADC_CONVERSIONS_CHANNEL_COUNT ADC_CHANNELS_COUNT
+
+/**
+ * @brief Keep the uint32_t raw_LISXXXALH[] sentinel view next to ADC_Frame_t
+ * @note Set to 0 at build time once no caller reads raw_LISXXXALH[]
+ */
+#ifndef ADC_CONVERSIONS_LEGACY_VIEW
+#define ADC_CONVERSIONS_LEGACY_VIEW 1
+#endif
+
+/**
+ * @brief Polling reads load precomputed SQR3/SMPR2 images instead of calling
+ *        HAL_ADC_ConfigChannel() for every channel
+ * @note Set to 0 at build time to go back to the HAL path
+ */
+#ifndef ADC_CONVERSIONS_FAST_CONFIG
+#define ADC_CONVERSIONS_FAST_CONFIG 1
+#endif
+
+/**
+ * @brief Polling backend of analogSensor_operation(): 0 = HAL
+ *        (HAL_ADC_Start / EOC wait / HAL_ADC_Stop),
+ *        1 = LL (SWSTART, EOC poll and data read on the ADC1 registers)
+ * @note The LL backend keeps ADC1 enabled in single-conversion mode between
+ *       reads; both bound the EOC wait by DWT->CYCCNT, not HAL_GetTick()
+ */
+#ifndef ADC_CONVERSIONS_LL_POLLING
+#define ADC_CONVERSIONS_LL_POLLING 0
+#endif
+
+/**
+ * @brief EOC timeout of a polling read, as a multiple of the channel's
+ *        expected conversion time (sampling + resolution ADCCLK cycles)
+ * @note Both backends use it; a dead conversion costs a few microseconds
+ *       per channel instead of milliseconds
+ */
+#ifndef ADC_CONVERSIONS_TIMEOUT_FACTOR
+#define ADC_CONVERSIONS_TIMEOUT_FACTOR 4U
+#endif
+
+/**
+ * @brief CPU cycles added to every EOC timeout, for the start latency and
+ *        the polling loop itself (108 = 0.5 us at 216 MHz)
+ */
+#ifndef ADC_CONVERSIONS_TIMEOUT_MARGIN_CYCLES
+#define ADC_CONVERSIONS_TIMEOUT_MARGIN_CYCLES 108U
+#endif
+
+/**
+ * @brief Histogram bins of the observed conversion time, a quarter of the
+ *        expected time each; the last bin also counts longer waits
+ */
+#define ADC_CONV_TIMING_BINS (4U * ADC_CONVERSIONS_TIMEOUT_FACTOR)
+
+/**
+ * @brief Frames per DMA half-buffer (one block) in the DMA modes, the most;
+ *        analogSensor_setBlockFrames() shortens the blocks at run time
+ * @note Override at build time; the ping-pong buffer holds two blocks
+ * @note A block must span whole 32-byte D-cache lines (checked at build time)
+ */
+#ifndef ADC_CONVERSIONS_BLOCK_FRAMES
+#define ADC_CONVERSIONS_BLOCK_FRAMES 256U
+#endif
+
+/**
+ * @brief Shortest block analogSensor_setBlockFrames() accepts
+ */
+#ifndef ADC_CONVERSIONS_MIN_BLOCK_FRAMES
+#define ADC_CONVERSIONS_MIN_BLOCK_FRAMES 8U
+#endif
+
+/**
+ * @brief Samples per block (frames x channels, interleaved by frame)
+ */
+#define ADC_CONVERSIONS_BLOCK_SAMPLES                                          \
+  (ADC_CONVERSIONS_BLOCK_FRAMES * ADC_CONVERSIONS_CHANNEL_COUNT)
+
+/**
+ * @brief Samples per shock capture (even, whole 32-byte cache lines)
+ */
+#ifndef ADC_CONVERSIONS_CAPTURE_SAMPLES
+#define ADC_CONVERSIONS_CAPTURE_SAMPLES 12288U
+#endif
+
+/**
+ * @brief Most samples of one burst (analogSensor_startBurst()): 65535
+ *        32-bit DMA words, in whole cache lines
+ */
+#define ADC_CONVERSIONS_BURST_MAX_SAMPLES ((65535U * 2U) & ~15U)
+
+/**
+ * @brief Block subscribers (analogSensor_subscribe())
+ */
+#ifndef ADC_CONVERSIONS_MAX_SUBSCRIBERS
+#define ADC_CONVERSIONS_MAX_SUBSCRIBERS 8U
+#endif
+
+/**
+ * @brief Set to 0 to leave every DMA2 Stream0 interrupt to
+ *        HAL_DMA_IRQHandler() (analogSensor_dmaIrqFast() then only times it)
+ */
+#ifndef ADC_CONVERSIONS_FAST_DMA_ISR
+#define ADC_CONVERSIONS_FAST_DMA_ISR 1
+#endif
+
+/**
+ * @brief Requests analogSensor_operation_async() can hold, the one in flight
+ *        included
+ */
+#ifndef ADC_CONVERSIONS_ASYNC_DEPTH
+#define ADC_CONVERSIONS_ASYNC_DEPTH 8U
+#endif
+
+/**
+ * @brief Regular ranks of one ADC, the longest weighted sequence
+ */
+#define ADC_SEQUENCE_MAX_RANKS 16U
+
+/**
+ * @brief Scans per half of the weighted-sequence DMA buffer
+ * @note A multiple of 16, so each half spans whole 32-byte D-cache lines
+ *       whatever the sequence length
+ */
+#ifndef ADC_CONVERSIONS_SEQUENCE_SCANS
+#define ADC_CONVERSIONS_SEQUENCE_SCANS 32U
+#endif
+
+/**
+ * @brief Channels per group of the grouped scan: the three axes of one
+ *        LISXXXALH device
+ */
+#ifndef ADC_CONVERSIONS_GROUP_SIZE
+#define ADC_CONVERSIONS_GROUP_SIZE 3U
+#endif
+
+/**
+ * @brief Longest group: conversions per trigger in discontinuous mode
+ */
+#define ADC_GROUP_MAX_SIZE 8U
+
+/**
+ * @brief Channel indices of the internal sources, as reported to the
+ *        injected callback by analogSensor_startInternal()
+ */
+#define ADC_INTERNAL_TEMPSENSOR ADC_CONVERSIONS_CHANNEL_COUNT
+#define ADC_INTERNAL_VREFINT (ADC_CONVERSIONS_CHANNEL_COUNT + 1U)
+
+/**
+ * @brief Block gain format (q14): ADC_BLOCK_GAIN_UNITY leaves blocks as
+ *        converted
+ */
+#define ADC_BLOCK_GAIN_FRAC_BITS 14U
+#define ADC_BLOCK_GAIN_UNITY (1U << ADC_BLOCK_GAIN_FRAC_BITS)
+
+/**
+ * @brief Set to 0 to drop the saturation check from the DMA block hand-off
+ */
+#ifndef ADC_CONVERSIONS_CLIP_DETECT
+#define ADC_CONVERSIONS_CLIP_DETECT 1
+#endif
+
+/**
+ * @brief Codes at which a DMA sample counts as clipped: at or below the low
+ *        rail, at or above the high one
  */
-#define ADC_CONVERSIONS_CHANNEL_COUNT 6
+#ifndef ADC_CLIP_LOW_CODE
+#define ADC_CLIP_LOW_CODE 0U
+#endif
+#ifndef ADC_CLIP_HIGH_CODE
+#define ADC_CLIP_HIGH_CODE 4095U
+#endif
 
 /* Exported types ------------------------------------------------------------*/
 
 /**
- * @brief ADC error information structure (simplified tracking)
+ * @brief Acquisition mode of the ADC helper
+ */
+typedef enum {
+  ADC_ACQ_MODE_POLLING = 0, ///< One blocking conversion per channel request
+  ADC_ACQ_MODE_DMA_CIRCULAR, ///< Free-running scan streamed by circular DMA
+  ADC_ACQ_MODE_DMA_TIMER,    ///< TIM2-triggered scan streamed by circular DMA
+  ADC_ACQ_MODE_CAPTURE,      ///< Triple-interleaved single-channel capture
+  ADC_ACQ_MODE_SEQUENCE,     ///< TIM2-triggered weighted rank sequence
+  ADC_ACQ_MODE_REPLAY,       ///< Recorded blocks instead of the ADCs
+  ADC_ACQ_MODE_GROUPED       ///< TIM2-triggered discontinuous groups
+} ADC_AcqMode_t;
+
+/**
+ * @brief Start event of the timer-paced scan
+ *
+ * TIM2 sets the rate itself. The TRGO2 sources are timers run by someone
+ * else (see pwm_sync.h); TIM2 then stays idle and the scan follows their
+ * events at whatever rate they produce.
+ */
+typedef enum {
+  ADC_SCAN_TRIGGER_TIM2 = 0,   ///< TIM2 TRGO (update), rate set here
+  ADC_SCAN_TRIGGER_TIM1_TRGO2, ///< TIM1 TRGO2
+  ADC_SCAN_TRIGGER_TIM8_TRGO2  ///< TIM8 TRGO2
+} ADC_ScanTrigger_t;
+
+/**
+ * @brief Shock capture completion callback
+ *
+ * @param samples Captured codes in time order (ADC1, ADC2, ADC3, ADC1, ...)
+ * @param count   Number of samples (ADC_CONVERSIONS_CAPTURE_SAMPLES, or
+ *                the burst's)
+ * @param ctx     User context given to analogSensor_startCapture()
+ *
+ * @note Runs in DMA interrupt context
+ */
+typedef void (*ADC_CaptureCallback_t)(const uint16_t *samples, uint32_t count,
+                                      void *ctx);
+
+/**
+ * @brief Rank sequence of the weighted scan
+ *
+ * channel[r] is converted at rank r + 1. The repetitions of a channel are
+ * spread evenly over the scan, so its samples are close to equally spaced
+ * in time: at weight w it is sampled w times per scan.
+ */
+typedef struct {
+  uint8_t ranks;                                  ///< Sequence length, 1..16
+  ADC_ChannelMask_t mask;                         ///< Channels converted
+  uint8_t weight[ADC_CONVERSIONS_CHANNEL_COUNT];  ///< Ranks per channel
+  uint8_t channel[ADC_SEQUENCE_MAX_RANKS];        ///< Channel of each rank
+} ADC_ScanSequence_t;
+
+/**
+ * @brief Weighted-sequence completion callback, once per half buffer
+ *
+ * @param scans      scan_count scans of seq->ranks codes each, in rank order
+ * @param scan_count ADC_CONVERSIONS_SEQUENCE_SCANS
+ * @param seq        The running sequence (rank -> channel)
+ * @param ctx        User context given to analogSensor_startSequence()
+ *
+ * @note Runs in DMA interrupt context; the scans stay valid for one half
+ *       buffer period and have already been invalidated in the D-cache
+ */
+typedef void (*ADC_SequenceCallback_t)(const uint16_t *scans,
+                                       uint32_t scan_count,
+                                       const ADC_ScanSequence_t *seq,
+                                       void *ctx);
+
+/**
+ * @brief Grouped-scan completion callback, once per group
+ *
+ * @param group   Group index; group g holds channels g * count and up
+ * @param samples count codes, in channel order
+ * @param count   Group size given to analogSensor_startGrouped()
+ * @param frame   Frame the group belongs to, 0 = the first after the start
+ * @param ctx     User context given to analogSensor_startGrouped()
+ *
+ * @note Runs in DMA interrupt context; the samples stay valid for one group
+ *       period and have already been invalidated in the D-cache
+ */
+typedef void (*ADC_GroupCallback_t)(uint8_t group, const uint16_t *samples,
+                                    uint8_t count, uint32_t frame, void *ctx);
+
+/**
+ * @brief Injected conversion completion callback
+ *
+ * @param channel Converted channel
+ * @param value   12-bit code
+ * @param ctx     User context given to analogSensor_startInjected()
+ *
+ * @note Runs in ADC interrupt context
+ */
+typedef void (*ADC_InjectedCallback_t)(uint8_t channel, uint16_t value,
+                                       void *ctx);
+
+/**
+ * @brief Analog watchdog alarm callback
+ *
+ * @param channel   Guarded channel that left its window
+ * @param low       Low threshold of the window (codes)
+ * @param high      High threshold of the window (codes)
+ * @param timestamp HAL tick of the alarm
+ * @param ctx       User context given to analogSensor_registerWatchdogCallback()
+ *
+ * @note Runs in ADC interrupt context
+ */
+typedef void (*ADC_WatchdogCallback_t)(uint8_t channel, uint16_t low,
+                                       uint16_t high, uint32_t timestamp,
+                                       void *ctx);
+
+/**
+ * @brief ADC instances sharing the scan (regular simultaneous multimode,
+ *        combined with injected simultaneous for analogSensor_startInjected())
+ *
+ * Channel to ADC/rank assignment of the default table (PA4/PA5 are not
+ * routed to ADC3):
+ *   - Independent: ADC1 = 0,1,2,3,4,5
+ *   - Dual:        ADC1 = 0,2,4   ADC2 = 1,3,5
+ *   - Triple:      ADC1 = 0,4     ADC2 = 1,5     ADC3 = 2,3
+ *
+ * Independent and dual take the table in order and need every channel on
+ * ADC1/2 (and at most 16 ranks per ADC); triple follows triple_slot and is
+ * the only layout for tables with ADC3-only pins or more than 16 channels,
+ * and then the default one. analogSensor_setMultimode() rejects the
+ * layouts a table cannot run.
+ */
+typedef enum {
+  ADC_MULTI_INDEPENDENT = 0, ///< ADC1 alone, one rank per channel
+  ADC_MULTI_DUAL_SIMULT,     ///< ADC1+ADC2, count / 2 simultaneous pairs
+  ADC_MULTI_TRIPLE_SIMULT    ///< ADC1+ADC2+ADC3, count / 3 triples
+} ADC_Multimode_t;
+
+/**
+ * @brief What drives a channel's pin; sets its sampling time
+ */
+typedef struct {
+  uint32_t source_ohms;  ///< Source impedance R_AIN, <= 50 kOhm
+  uint8_t accuracy_bits; ///< Settling accuracy N, 6..12 bits
+} ADC_ChannelProfile_t;
+
+/**
+ * @brief Fields of ADC_ScanConfig_t to change
+ */
+#define ADC_SCAN_CONFIG_RATE 0x01U     ///< frame_rate_hz (TIM2 ARR)
+#define ADC_SCAN_CONFIG_PROFILES 0x02U ///< profile[] (SMPR1/SMPR2)
+
+/**
+ * @brief Staged configuration swapped in (DMA interrupt context)
+ *
+ * @param first_frame Sequence number of the first frame under it
+ * @param ctx         User context of the configuration
+ */
+typedef void (*ADC_ConfigAppliedCallback_t)(uint32_t first_frame, void *ctx);
+
+/**
+ * @brief Configuration staged for the running scan
+ */
+typedef struct {
+  uint8_t fields;         ///< ADC_SCAN_CONFIG_x bits; others left as they are
+  uint32_t frame_rate_hz; ///< New frame rate
+  ADC_ChannelProfile_t profile[ADC_CONVERSIONS_CHANNEL_COUNT]; ///< Per channel
+  ADC_ConfigAppliedCallback_t applied; ///< Called after the swap (NULL ok)
+  void *ctx;                           ///< Passed to applied
+} ADC_ScanConfig_t;
+
+/**
+ * @brief Per-sample failure reason, stored out of band in ADC_Frame_t
+ */
+typedef enum {
+  ADC_SAMPLE_OK = 0,
+  ADC_SAMPLE_ERROR_CONFIG,  ///< HAL_ADC_ConfigChannel() failed
+  ADC_SAMPLE_ERROR_START,   ///< HAL_ADC_Start() failed
+  ADC_SAMPLE_ERROR_TIMEOUT, ///< Conversion did not complete in time
+  ADC_SAMPLE_ERROR_OVERRUN, ///< Frame lost in a DMA overrun (holds the last)
+  ADC_SAMPLE_ERROR_SETTLING ///< Sensor settling after a range switch
+} ADC_SampleError_t;
+
+/**
+ * @brief Asynchronous conversion completion callback
+ *
+ * @param channel Converted channel
+ * @param value   12-bit code (0 on error)
+ * @param error   ADC_SAMPLE_OK, or why the request failed
+ * @param ctx     User context given to analogSensor_operation_async()
+ *
+ * @note Runs in ADC interrupt context, or in the caller's on a start failure
+ * @note May queue the next request
+ */
+typedef void (*ADC_AsyncCallback_t)(uint8_t channel, uint16_t value,
+                                    ADC_SampleError_t error, void *ctx);
+
+/**
+ * @brief Packed frame: one 16-bit sample per channel plus error flags
+ *
+ * Samples are always plain 12-bit codes; a set bit n in error_mask marks
+ * samples[n] as invalid and error_code keeps the reason of the last failure
+ * in the frame. 14 bytes instead of 24 for the uint32_t sentinel layout
+ * with the 6-channel table.
+ */
+typedef struct {
+  uint16_t samples[ADC_CONVERSIONS_CHANNEL_COUNT]; ///< Right-aligned codes
+  ADC_ChannelMask_t error_mask; ///< Bit n set = channel n failed
+  uint8_t error_code; ///< ADC_SampleError_t of the last failed channel
+} ADC_Frame_t;
+
+/**
+ * @brief Newest complete frame with its place in time, published as a whole
+ *
+ * Written by the DMA interrupt at each block (its last frame), at each half
+ * buffer of the weighted sequence, and by the polling frame reads
+ * (analogSensor_operation_all_channels() / _channels()).
+ */
+typedef struct {
+  ADC_Frame_t frame;  ///< Channel order
+  uint32_t sequence;  ///< Stream sequence number; frame count when polling
+  uint64_t timestamp; ///< timebase_now() when the frame was complete (ticks)
+} ADC_LatestFrame_t;
+
+/**
+ * @brief Block-ready callback
+ *
+ * @param block       First sample of the block, interleaved frames
+ * @param frame_count Number of frames in the block
+ * @param ctx         User context given at registration
+ *
+ * @note Runs in DMA interrupt context. The block stays valid only until the
+ *       DMA wraps back to it, i.e. for one block period.
+ * @note With the block pool (analogSensor_setBlockPool()) the block is a
+ *       pool block: blockPool_retain(blockPool_fromData(block)) keeps it
+ *       valid until the matching blockPool_release().
+ * @note The block has already been invalidated in the D-cache.
+ */
+typedef void (*ADC_BlockCallback_t)(const uint16_t *block,
+                                    uint32_t frame_count, void *ctx);
+
+/**
+ * @brief In-place block filter, run from the DMA interrupt before anything
+ *        reads the block (see analogSensor_setBlockFilter())
+ *
+ * @param block       Interleaved frames in scan slot order, writable
+ * @param frame_count Number of frames in the block
+ * @param ctx         Pointer passed to analogSensor_setBlockFilter()
+ */
+typedef void (*ADC_BlockFilter_t)(uint16_t *block, uint32_t frame_count,
+                                  void *ctx);
+
+/**
+ * @brief What a range hook reports of a block
+ */
+typedef struct {
+  uint8_t range; ///< Copied into ADC_RingEntry_t.range of every frame
+  uint16_t settle[ADC_CONVERSIONS_CHANNEL_COUNT]; ///< Leading frames void
+} ADC_BlockRange_t;
+
+/**
+ * @brief Sensor range hook, run from the DMA interrupt after the block
+ *        filter (see analogSensor_setRangeHook())
+ *
+ * @param block       Interleaved frames in scan slot order
+ * @param frame_count Number of frames in the block
+ * @param order       Slot -> channel of the block
+ * @param out         Range bits and settling frames per channel, zeroed
+ * @param ctx         Pointer passed to analogSensor_setRangeHook()
+ */
+typedef void (*ADC_RangeHook_t)(const uint16_t *block, uint32_t frame_count,
+                                const uint8_t *order, ADC_BlockRange_t *out,
+                                void *ctx);
+
+/**
+ * @brief What a subscriber is given of a block
+ *
+ * The samples stay interleaved as the DMA wrote them: sample of channel ch
+ * in frame f is block[f * ADC_CONVERSIONS_CHANNEL_COUNT + slot[ch]], see
+ * analogSensor_viewSample(). Only the channels in channel_mask are meant
+ * for the subscriber; the others are left unread.
+ */
+typedef struct {
+  const uint16_t *block; ///< Interleaved frames, as for ADC_BlockCallback_t
+  uint32_t frame_count;  ///< Frames in the block
+  uint32_t blocks;       ///< Blocks dispatched since the previous call
+  ADC_ChannelMask_t channel_mask; ///< Bit n = channel n, as subscribed
+  const uint8_t *slot;   ///< Channel -> slot of a frame
+} ADC_BlockView_t;
+
+/**
+ * @brief Block subscriber
+ *
+ * @param view Block, valid for the call only (see ADC_BlockCallback_t)
+ * @param ctx  User context given at subscription
+ *
+ * @note Runs in the context calling analogSensor_dispatchBlock()
+ */
+typedef void (*ADC_SubscriberCallback_t)(const ADC_BlockView_t *view,
+                                         void *ctx);
+
+/**
+ * @brief Time and position of one DMA block in the stream
+ *
+ * The timestamp is latched on entry to the DMA interrupt of the block, i.e.
+ * when its last frame has landed (plus the interrupt latency). Frame n of
+ * the block was therefore converted about (frame_count - 1 - n) frame
+ * periods earlier.
+ */
+typedef struct {
+  uint32_t first_frame;      ///< Sequence number of the block's first frame
+  uint32_t frame_count;      ///< Frames in the block
+  uint64_t timestamp;        ///< timebase_now() at block completion (ticks)
+  ADC_ChannelMask_t clipped; ///< Channels with a clipped sample (bit n = n)
+} ADC_BlockInfo_t;
+
+/**
+ * @brief Frame timing measured from the block timestamps since the start
+ */
+typedef struct {
+  uint32_t blocks;          ///< Blocks stamped since the DMA start
+  uint32_t nominal_mhz;     ///< Configured frame rate (mHz, 0 = free-running)
+  uint32_t measured_mhz;    ///< Frames / elapsed time, first to newest block
+  float drift_ppm;          ///< (measured - nominal) / nominal, in ppm
+  uint32_t jitter_ticks;    ///< Longest minus shortest block interval
+  uint64_t first_timestamp; ///< Stamp of the first block (ticks)
+  uint64_t last_timestamp;  ///< Stamp of the newest block (ticks)
+} ADC_TimingInfo_t;
+
+/**
+ * @brief Error kinds counted per channel
+ */
+typedef enum {
+  ADC_ERROR_KIND_CONFIG = 0, ///< Channel, sequence or watchdog setup failed
+  ADC_ERROR_KIND_START,      ///< ADC, DMA or timer start failed
+  ADC_ERROR_KIND_TIMEOUT,    ///< Polled conversion did not complete in time
+  ADC_ERROR_KIND_OVERRUN,    ///< OVR: a conversion was lost before DMA read
+  ADC_ERROR_KIND_DMA,        ///< DMA transfer error
+  ADC_ERROR_KIND_COUNT
+} ADC_ErrorKind_t;
+
+/**
+ * @brief Rows of the error matrix: one per channel, then the scan row for
+ *        errors of the scan as a whole (DMA, overrun, sequence start)
+ */
+#define ADC_ERROR_ROW_SCAN ADC_CONVERSIONS_CHANNEL_COUNT
+#define ADC_ERROR_ROWS (ADC_CONVERSIONS_CHANNEL_COUNT + 1U)
+
+/**
+ * @brief ADC error information structure
  */
 typedef struct {
   uint32_t total_errors;               ///< Total conversion failures
   HAL_StatusTypeDef last_error_status; ///< Last HAL error status
   uint8_t last_failed_channel;         ///< Which channel failed (0xFF = none)
+  uint32_t counts[ADC_ERROR_ROWS][ADC_ERROR_KIND_COUNT]; ///< Row x kind
 } ADC_ErrorInfo_t;
 
+/**
+ * @brief One ADC and the state of its polling reads (an instance)
+ *
+ * The default instance is ADC1 with the ADC_CHANNELS_TABLE() channels: the
+ * global API (analogSensor_operation(), _getFrame(), _getErrors() ...) is
+ * that instance, and everything beyond polling (DMA scans, injected reads,
+ * capture) belongs to it alone. Further instances poll ADC2 or ADC3 with a
+ * channel table of their own while ADC1 is idle or runs the independent
+ * scan. Each instance is used from one context at a time; different
+ * instances share no state, so they may run in different tasks.
+ *
+ * Fields are owned by the driver once analogSensor_ctxInit() has run.
+ */
+typedef struct {
+  ADC_HandleTypeDef *hadc;                ///< ADC converting the channels
+  const ADC_ChannelConfTypeDef *channels; ///< Channel n = channels[n]
+  uint8_t channel_count;                  ///< 1..ADC_CONVERSIONS_CHANNEL_COUNT
+  uint32_t timeout_cycles[ADC_CONVERSIONS_CHANNEL_COUNT]; ///< EOC limits
+  uint32_t timeout_hclk;           ///< Core clock of the limits, 0 = stale
+  volatile ADC_Frame_t frame;      ///< Latest result of every channel
+  ADC_ErrorInfo_t errors;          ///< Written under error_seq
+  volatile uint32_t error_seq;     ///< Odd while errors is updated
+  ADC_LatestFrame_t published;     ///< Written under published_seq
+  volatile uint32_t published_seq; ///< Odd while published is updated
+  uint32_t frames;                 ///< Polled frames published
+} ADC_SensorCtx_t;
+
+/**
+ * @brief Overruns of the DMA scan repaired in place since the last start
+ *
+ * A gap is the run of frames between the last one transferred and the one
+ * the restarted stream receives first. Frames inside the block are queued
+ * with ADC_SAMPLE_ERROR_OVERRUN; a stall beyond the block end skips the rest
+ * in the sequence numbers.
+ */
+typedef struct {
+  uint32_t recoveries;        ///< Overruns repaired
+  uint32_t frames_lost;       ///< Gap frames, flagged or skipped
+  uint32_t last_gap_sequence; ///< Sequence number of the newest gap's start
+  uint32_t last_gap_frames;   ///< Length of the newest gap
+  uint32_t last_cycles;       ///< CPU cycles, stream stop to restart
+  uint32_t max_cycles;        ///< Longest recovery
+} ADC_OverrunInfo_t;
+
+/**
+ * @brief Switches from the timed scan to a shock capture and back
+ *        (analogSensor_switchToCapture()) since power-up
+ *
+ * The enter time runs from the DMA interrupt of the scan's last block to
+ * the capture's DMA start, the leave time from the capture's completion to
+ * the scan armed for its next TIM2 trigger. Either above one frame period
+ * counts in over_target.
+ */
+typedef struct {
+  uint32_t switches;          ///< Round trips back on the scan
+  uint32_t failures;          ///< Switches that ended in polling mode
+  uint32_t gap_sequence;      ///< First scan frame the newest capture took
+  uint32_t gap_frames;        ///< Scan frames it took, skipped in sequence
+  uint8_t channel;            ///< Channel it captured
+  uint64_t capture_start;     ///< Its DMA start (timebase ticks)
+  uint64_t capture_end;       ///< Its DMA completion (timebase ticks)
+  uint32_t enter_us;          ///< Newest scan-to-capture transition
+  uint32_t leave_us;          ///< Newest capture-to-scan transition
+  uint32_t enter_max_us;      ///< Longest scan-to-capture transition
+  uint32_t leave_max_us;      ///< Longest capture-to-scan transition
+  uint32_t frame_period_us;   ///< Target of each transition
+  uint32_t over_target;       ///< Transitions longer than the target
+} ADC_SwitchInfo_t;
+
+/**
+ * @brief EOC waits of the polling reads since the last reset
+ *
+ * Times are CPU cycles from the conversion start to EOC. Bin i of the
+ * histogram counts waits of i/4 to (i+1)/4 of the channel's expected time,
+ * so a healthy converter fills bins 3-5.
+ */
+typedef struct {
+  uint32_t expected_cycles[ADC_CONVERSIONS_CHANNEL_COUNT]; ///< Per channel
+  uint32_t timeout_cycles[ADC_CONVERSIONS_CHANNEL_COUNT];  ///< EOC limit
+  uint32_t histogram[ADC_CONV_TIMING_BINS]; ///< Observed / expected, 1/4 steps
+  uint32_t min_cycles; ///< Fastest conversion (0 = none yet)
+  uint32_t max_cycles; ///< Slowest conversion
+  uint32_t count;      ///< Conversions timed
+  uint32_t timeouts;   ///< Waits abandoned at timeout_cycles
+} ADC_ConvTiming_t;
+
+/**
+ * @brief Per-channel signal statistics over the DMA blocks since a reset
+ *
+ * Codes are raw 12-bit ADC values. rms is taken around the mean (AC RMS,
+ * the square root of variance); crest_factor is the largest deviation from
+ * the mean divided by rms. skewness and kurtosis are the third and fourth
+ * standardised moments: kurtosis is 3 for Gaussian noise, 1.5 for a sine
+ * and grows with impacts.
+ */
+typedef struct {
+  uint32_t count;        ///< Samples included
+  uint16_t min;          ///< Smallest code
+  uint16_t max;          ///< Largest code
+  uint16_t peak_to_peak; ///< max - min
+  float mean;            ///< Mean code
+  float variance;        ///< Population variance (codes^2)
+  float rms;             ///< AC RMS (codes)
+  float crest_factor;    ///< Peak deviation / rms (0 if rms is 0)
+  float skewness;        ///< m3 / rms^3 (0 if rms is 0)
+  float kurtosis;        ///< m4 / rms^4, not excess (0 if rms is 0)
+} ADC_ChannelStats_t;
+
+/**
+ * @brief Per-channel saturation counters of the DMA blocks since a reset
+ *
+ * An episode is a run of consecutive clipped frames of the channel; one
+ * that spans two blocks counts once.
+ */
+typedef struct {
+  uint32_t samples;  ///< Samples at or beyond a rail
+  uint32_t episodes; ///< Runs of clipped samples started
+  uint8_t active;    ///< Newest frame of the channel was clipped
+} ADC_ClipStats_t;
+
+/**
+ * @brief Scan DMA interrupt dispatch paths (analogSensor_dmaIrqFast())
+ */
+typedef enum {
+  ADC_DMA_DISPATCH_HAL = 0, ///< HAL_DMA_IRQHandler() and the HAL callbacks
+  ADC_DMA_DISPATCH_FAST,    ///< Flags read and cleared directly
+  ADC_DMA_DISPATCH_COUNT
+} ADC_DmaDispatch_t;
+
+/**
+ * @brief Cycles of one dispatch path, from the vector to the block hand-off
+ */
+typedef struct {
+  uint32_t count; ///< Half-blocks dispatched
+  uint32_t max;   ///< Longest dispatch
+  uint64_t total; ///< Sum, mean = total / count
+} ADC_DmaDispatchStats_t;
+
 /* Exported variables --------------------------------------------------------*/
 
+#if ADC_CONVERSIONS_LEGACY_VIEW
 /**
  * @brief ADC sample array (volatile for ISR/main access), declared here, use as
  * global in main.c.
+ * @note Compatibility view of the packed frame, see analogSensor_getFrame()
  * @note Values 0-4095 are valid ADC readings (12-bit)
  * @note Values >= 0xFFFC indicate errors:
  *       - 0xFFFE: Configuration error
@@ -106,15 +867,23 @@ typedef struct {
  *       - 0xFFFC: Timeout error
  */
 extern volatile uint32_t raw_LISXXXALH[ADC_CONVERSIONS_CHANNEL_COUNT];
+#endif
 /* Exported functions --------------------------------------------------------*/
 
 /**
- * @brief Acquire one ADC channel (blocking, polling mode)
+ * @brief Acquire one ADC channel (blocking)
+ *
+ * In polling mode the channel is converted through the regular group. While
+ * a DMA scan runs it is converted through the injected group instead (see
+ * analogSensor_readInjected()), so the scan keeps streaming.
  *
  * @param snsrID Channel index (0..5)
  *
  * @note Result stored in raw_LISXXXALH[snsrID]
- * @note Not reentrant / not thread-safe
+ * @note Not reentrant: the default instance is polled from one context;
+ *       other ADCs get instances of their own (analogSensor_ctxInit())
+ * @note In DMA mode the next block overwrites the stored frame again
+ * @note No-op during a shock capture
  */
 void analogSensor_operation(uint8_t snsrID);
 
@@ -124,23 +893,1051 @@ void analogSensor_operation(uint8_t snsrID);
  * @param total_channels Number of channels to read (typically 6)
  *
  * @note Results stored in raw_LISXXXALH[] array
+ * @note No-op while DMA mode is running (all slots are refreshed by hardware)
  */
 void analogSensor_operation_all_channels(uint8_t total_channels);
 
 /**
- * @brief Get total error count
+ * @brief Read the channels of a bitmask sequentially
  *
- * @return uint32_t Total number of conversion errors
+ * @param channel_mask Bit n selects channel n; other channels are not
+ *                     converted and keep their last value
+ *
+ * @note Same context and storage as analogSensor_operation_all_channels()
  */
-uint32_t analogSensor_getErrorCount(void);
+void analogSensor_operation_channels(ADC_ChannelMask_t channel_mask);
 
 /**
- * @brief Get complete error information
+ * @brief Queue one channel conversion and return at once
  *
- * @param error_info Pointer to receive error info
+ * Requests run one at a time in queue order, each started from the ADC
+ * interrupt that ended the previous one. In polling mode an ADC1 channel is
+ * converted through the regular group (HAL_ADC_Start_IT()); while a scan
+ * runs, and for ADC3's own pins, through the injected group as
+ * analogSensor_startInjected() does. The result is stored as
+ * analogSensor_operation() stores it, then passed to the callback.
+ *
+ * @param channel  Channel index
+ * @param callback Called with the result (NULL ok)
+ * @param ctx      Passed back to the callback
  *
  * @return HAL_StatusTypeDef
- *   @retval HAL_OK    Success
+ *   @retval HAL_OK    Queued (the callback may already have run)
+ *   @retval HAL_BUSY  Queue full or shock capture active
+ *   @retval HAL_ERROR Invalid channel
+ *
+ * @note Any context. A request that gets no result within the polling
+ *       timeout fails with ADC_SAMPLE_ERROR_TIMEOUT, noticed at the next
+ *       call or blocking read.
+ * @note analogSensor_operation() waits for the request in flight and holds
+ *       the rest of the queue until its own read is done. Other users of the
+ *       injected group may see HAL_BUSY meanwhile.
+ */
+HAL_StatusTypeDef analogSensor_operation_async(uint8_t channel,
+                                               ADC_AsyncCallback_t callback,
+                                               void *ctx);
+
+/**
+ * @brief Asynchronous requests not yet reported, the one in flight included
+ */
+uint32_t analogSensor_asyncPending(void);
+
+/**
+ * @brief Time the HAL and LL polling backends against each other
+ *
+ * Reads every channel @p rounds times through the HAL backend, then as
+ * often through the LL backend, into PROFILER_PROBE_READ_HAL and
+ * PROFILER_PROBE_READ_LL (whole read, selection to data). The samples are
+ * discarded; latest_frame is left untouched. Dump the probes afterwards
+ * with profiler_dump().
+ *
+ * @param rounds Reads per channel and backend
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    All reads succeeded
+ *   @retval HAL_BUSY  Not in polling mode
+ *   @retval HAL_ERROR At least one read failed
+ *
+ * @note Main-loop context; blocks for roughly rounds x channels x 2 reads.
+ *       Meaningless with PROFILER_ENABLE = 0.
+ */
+HAL_StatusTypeDef analogSensor_benchmarkBackends(uint16_t rounds);
+
+/**
+ * @brief Start continuous scan acquisition through circular DMA
+ *
+ * Restores the full scan sequence (channel n at rank n+1), then starts ADC1
+ * with DMA2 Stream0 in circular mode writing half-words into the two-block
+ * ping-pong buffer. On every half/full-transfer interrupt the finished block
+ * is handed off (see analogSensor_registerBlockCallback()) and its newest
+ * frame is copied to raw_LISXXXALH[].
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    DMA acquisition running
+ *   @retval HAL_BUSY  DMA acquisition already running
+ *   @retval HAL_ERROR Channel configuration or DMA start failed
+ */
+HAL_StatusTypeDef analogSensor_startDMA(void);
+
+/**
+ * @brief Start timer-paced scan acquisition through circular DMA
+ *
+ * Same data path as analogSensor_startDMA(), but ADC1 runs one scan per
+ * TIM2 update event (ExternalTrigConv = TIM2 TRGO, rising edge) instead of
+ * converting back-to-back, giving a jitter-free frame clock.
+ *
+ * @param frame_rate_hz Scan (frame) rate in Hz, see analogSensor_setSampleRate()
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Timer-paced acquisition running
+ *   @retval HAL_BUSY  An acquisition is already running
+ *   @retval HAL_ERROR Rate out of range or peripheral start failed
+ */
+HAL_StatusTypeDef analogSensor_startTimedDMA(uint32_t frame_rate_hz);
+
+/**
+ * @brief Set the frame rate of the timer-paced mode
+ *
+ * May be called while the timer-paced mode is running; the new period is
+ * loaded through the ARR preload register at the next update event, so no
+ * short or long period is produced.
+ *
+ * @param frame_rate_hz Requested rate in Hz (1 .. one scan time)
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Rate applied (see analogSensor_getSampleRate())
+ *   @retval HAL_ERROR Rate is zero or faster than one scan sequence, or
+ *                     the scan trigger is not TIM2
+ */
+HAL_StatusTypeDef analogSensor_setSampleRate(uint32_t frame_rate_hz);
+
+/**
+ * @brief Select the start event of the timer-paced scan
+ *
+ * With any source but TIM2, analogSensor_startTimedDMA() takes its rate as
+ * the rate the source runs at (for the scan length check and
+ * analogSensor_getSampleRate()) and leaves TIM2 stopped, and
+ * analogSensor_setSampleRate(), rate changes through
+ * analogSensor_stageConfig() and analogSensor_startSequence() are refused.
+ *
+ * @param source Trigger for the next analogSensor_startTimedDMA()
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Selected
+ *   @retval HAL_BUSY  An acquisition is running
+ *   @retval HAL_ERROR Unknown source
+ */
+HAL_StatusTypeDef analogSensor_setScanTrigger(ADC_ScanTrigger_t source);
+
+/**
+ * @brief Get the start event of the timer-paced scan
+ */
+ADC_ScanTrigger_t analogSensor_getScanTrigger(void);
+
+/**
+ * @brief Get the frame rate actually produced by TIM2
+ *
+ * @return uint32_t Rate in Hz after period rounding (0 = never configured)
+ */
+uint32_t analogSensor_getSampleRate(void);
+
+/**
+ * @brief Change the ADCCLK prescaler of ADC1/2/3
+ *
+ * The sampling times are re-derived for the new ADCCLK at the next scan
+ * start or polling read.
+ *
+ * @param clock_prescaler ADC_CLOCK_SYNC_PCLK_DIVx
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_BUSY  A DMA mode or capture is running
+ *   @retval HAL_ERROR Invalid prescaler, ADCCLK above 36 MHz at the current
+ *                     PCLK2, or HAL failure
+ */
+HAL_StatusTypeDef analogSensor_setClockPrescaler(uint32_t clock_prescaler);
+
+/**
+ * @brief Set the source impedance and accuracy of a channel
+ *
+ * The sampling time is the shortest of 3..480 ADCCLK cycles k satisfying the
+ * datasheet settling condition
+ *   R_AIN <= (k - 0.5) / (f_ADC * C_ADC * ln(2^(N + 2))) - R_ADC
+ * with R_ADC = 6 kOhm and C_ADC = 4 pF, re-derived for the ADCCLK in use at
+ * every scan start and before the first polling read. In the dual/triple
+ * scans the ADCs converting the same rank all use the slowest of their
+ * channels' times, so they stay in lock-step.
+ *
+ * @param channel Channel index
+ * @param profile New profile (defaults come from ADC_CHANNELS_TABLE())
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success, effective from the next conversion set-up
+ *   @retval HAL_BUSY  A DMA mode or capture is running
+ *   @retval HAL_ERROR Invalid channel, NULL pointer, source above 50 kOhm
+ *                     or accuracy outside 6..12 bits
+ */
+HAL_StatusTypeDef analogSensor_setChannelProfile(
+    uint8_t channel, const ADC_ChannelProfile_t *profile);
+
+/**
+ * @brief Get the profile of a channel
+ *
+ * @param channel Channel index
+ * @param profile Receives the profile
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR Invalid channel or NULL pointer
+ */
+HAL_StatusTypeDef analogSensor_getChannelProfile(uint8_t channel,
+                                                 ADC_ChannelProfile_t *profile);
+
+/**
+ * @brief Sampling phase a channel's profile needs at a given ADC prescaler
+ *
+ * @param channel         Channel index
+ * @param clock_prescaler ADC_CLOCK_SYNC_PCLK_DIVx, at the current PCLK2
+ *
+ * @return uint32_t ADCCLK cycles (3..480) of a polling read, 0 = invalid
+ *         argument; 480 also when even 480 cycles cannot settle the input
+ */
+uint32_t analogSensor_getSamplingCycles(uint8_t channel,
+                                        uint32_t clock_prescaler);
+
+/**
+ * @brief Fastest frame rate of the selected multimode layout at a given
+ *        ADC prescaler, with the sampling times the profiles need there
+ *
+ * A faster ADCCLK shortens every cycle but may push high-impedance channels
+ * to a longer sampling time, so the fastest prescaler is not always the
+ * fastest scan.
+ *
+ * @param clock_prescaler ADC_CLOCK_SYNC_PCLK_DIVx, at the current PCLK2
+ *
+ * @return uint32_t Frames per second, 0 = invalid prescaler
+ */
+uint32_t analogSensor_getMaxFrameRate(uint32_t clock_prescaler);
+
+/**
+ * @brief Sampling instant of each channel in a scan of the selected
+ *        multimode layout: the end of its rank's sampling phase, after the
+ *        frame trigger, at the current ADCCLK and profiles
+ *
+ * Channels converted together in multimode share an instant. This is the
+ * skew dsp_deskew.h compensates.
+ *
+ * @param skew_ns Receives ADC_CONVERSIONS_CHANNEL_COUNT values, channel order
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer
+ */
+HAL_StatusTypeDef analogSensor_getScanSkew(float *skew_ns);
+
+/**
+ * @brief Stage a configuration for the running timer-paced scan
+ *
+ * The DMA interrupt of the block in progress swaps it in: SMPR1/SMPR2 of the
+ * scan ADCs and the TIM2 ARR are rewritten while the ADCs wait for the next
+ * trigger, so the next block is converted entirely under the new sampling
+ * times. ARR takes effect through its preload one period later, so only
+ * the first frame of that block keeps the old spacing. That frame carries
+ * ADC_RING_FLAG_CONFIG in the ring. The frame timing estimate restarts with
+ * it when the rate changes. A configuration staged again before the swap
+ * replaces the pending one.
+ *
+ * @param cfg         Configuration; checked against the rate limit of
+ *                    the resulting sampling times
+ * @param first_frame Receives the sequence number of the first frame under
+ *                    it (NULL ok)
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Staged
+ *   @retval HAL_BUSY  No timer-paced scan running
+ *   @retval HAL_ERROR NULL pointer, invalid profile, or a rate above the
+ *                     limit of the sampling times or below the TIM2 range
+ *
+ * @note The applied callback runs in the DMA interrupt after the block
+ *       callback of the last block under the old configuration
+ */
+HAL_StatusTypeDef analogSensor_stageConfig(const ADC_ScanConfig_t *cfg,
+                                           uint32_t *first_frame);
+
+/**
+ * @brief Whether a staged configuration still waits for its block boundary
+ */
+uint8_t analogSensor_isConfigPending(void);
+
+/**
+ * @brief Stop continuous DMA acquisition and return to polling mode
+ *
+ * Also ends or aborts a shock capture or the weighted sequence and restores
+ * the scan configuration.
+ *
+ * @return HAL_StatusTypeDef Status of HAL_ADC_Stop_DMA()
+ */
+HAL_StatusTypeDef analogSensor_stopDMA(void);
+
+/**
+ * @brief Register the block-ready callback for the DMA modes
+ *
+ * @param callback Function called from the DMA ISR per block (NULL = none)
+ * @param ctx      Passed back to the callback
+ *
+ * @note While a callback is registered, analogSensor_getReadyBlock() always
+ *       returns NULL: the callback is the consumer.
+ */
+void analogSensor_registerBlockCallback(ADC_BlockCallback_t callback,
+                                        void *ctx);
+
+/**
+ * @brief Set the in-place block filter of the DMA modes
+ *
+ * The filter runs after the block gain and before the latest frame, the
+ * ring, the channel statistics and the block callback, so every consumer
+ * (recorders included) sees its output. The lines are cleaned afterwards.
+ *
+ * @param filter Function called from the DMA ISR per block (NULL = none)
+ * @param ctx    Passed back to the filter
+ */
+void analogSensor_setBlockFilter(ADC_BlockFilter_t filter, void *ctx);
+
+/**
+ * @brief Set the sensor range hook of the DMA modes
+ *
+ * Runs after the block filter. Its range bits go into every ring entry of
+ * the block; the first settle[ch] frames of a channel are queued with the
+ * channel in error_mask, ADC_SAMPLE_ERROR_SETTLING and
+ * ADC_RING_FLAG_SETTLING (unless an overrun lost them).
+ *
+ * @param hook Function called from the DMA ISR per block (NULL = none)
+ * @param ctx  Passed back to the hook
+ */
+void analogSensor_setRangeHook(ADC_RangeHook_t hook, void *ctx);
+
+/**
+ * @brief Subscribe a consumer to the block stream
+ *
+ * Each subscriber keeps its own block counter and is called on every
+ * every_n_blocks-th block handed to analogSensor_dispatchBlock(), so a
+ * control loop can take every block and telemetry one in eight from the
+ * same acquisition. Subscribing the same callback and context again
+ * changes its mask and interval and restarts its count.
+ *
+ * @param callback       Consumer
+ * @param ctx            Passed back to the callback
+ * @param channel_mask   Channels the consumer reads (bit n = channel n)
+ * @param every_n_blocks Decimation, 1 = every block
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Subscribed, from the next dispatched block
+ *   @retval HAL_BUSY  ADC_CONVERSIONS_MAX_SUBSCRIBERS already subscribed
+ *   @retval HAL_ERROR NULL callback, empty mask or zero interval
+ */
+HAL_StatusTypeDef analogSensor_subscribe(ADC_SubscriberCallback_t callback,
+                                         void *ctx,
+                                         ADC_ChannelMask_t channel_mask,
+                                         uint32_t every_n_blocks);
+
+/**
+ * @brief Remove a subscriber
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Removed; not called again after the current dispatch
+ *   @retval HAL_ERROR Not subscribed
+ */
+HAL_StatusTypeDef analogSensor_unsubscribe(ADC_SubscriberCallback_t callback,
+                                           void *ctx);
+
+/**
+ * @brief Run the subscribers due for one block
+ *
+ * Called by the application from its DSP context: the block callback in
+ * the superloop build, the DSP task in the RTOS build. The stream is not
+ * dispatched by the driver itself, so no subscriber runs in the DMA
+ * interrupt unless the application calls this from there.
+ *
+ * @param block       Block from the block callback or the block pool
+ * @param frame_count Frames in block
+ *
+ * @note One dispatching context at a time
+ */
+void analogSensor_dispatchBlock(const uint16_t *block, uint32_t frame_count);
+
+/**
+ * @brief Sample of a channel in a subscriber's block
+ */
+static inline uint16_t analogSensor_viewSample(const ADC_BlockView_t *view,
+                                               uint32_t frame, uint8_t ch) {
+  return view->block[frame * ADC_CONVERSIONS_CHANNEL_COUNT + view->slot[ch]];
+}
+
+/**
+ * @brief Scale every sample of each DMA block before it is handed off
+ *
+ * Applied in place in the DMA ISR, ahead of the newest frame, the ring, the
+ * channel statistics and the block callback, so every consumer sees the
+ * corrected codes (saturated to 12 bits). Used for the ratiometric supply
+ * correction (adc_supply.h).
+ *
+ * @param gain_q14 Gain, ADC_BLOCK_GAIN_UNITY = none (the default)
+ */
+void analogSensor_setBlockGain(uint16_t gain_q14);
+
+/**
+ * @brief Gain applied to the DMA blocks
+ *
+ * @return uint16_t q14, see analogSensor_setBlockGain()
+ */
+uint16_t analogSensor_getBlockGain(void);
+
+/**
+ * @brief Polling consumer: take the newest completed block, if any
+ *
+ * @return const uint16_t* Block of analogSensor_getBlockFrames() frames, or
+ *         NULL if no block completed since the previous call
+ *
+ * @note The block must be processed within one block period. Blocks that
+ *       completed while the consumer was late are counted, see
+ *       analogSensor_getDroppedBlocks().
+ */
+const uint16_t *analogSensor_getReadyBlock(void);
+
+/**
+ * @brief Number of blocks the polling consumer never picked up
+ *
+ * @return uint32_t Dropped block count since start
+ */
+uint32_t analogSensor_getDroppedBlocks(void);
+
+/**
+ * @brief Let the timed DMA scan fill reference-counted pool blocks
+ *        (block_pool.h) instead of the fixed ping-pong buffer
+ *
+ * The DMA then runs in double-buffer mode and a free block is swapped in at
+ * every completion, so stages keep blocks by reference instead of copying.
+ * Takes effect at the next analogSensor_startTimedDMA();
+ * analogSensor_startDMA() always uses the ping-pong buffer.
+ *
+ * @param enable 1 = pool blocks, 0 = ping-pong buffer (default)
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK   Set
+ *   @retval HAL_BUSY Acquisition running; stop it first
+ */
+HAL_StatusTypeDef analogSensor_setBlockPool(uint8_t enable);
+
+/**
+ * @brief Blocks the DMA filled into its own buffer because every pool block
+ *        was held
+ *
+ * @return uint32_t Count since the last timed DMA start
+ */
+uint32_t analogSensor_getPoolStarved(void);
+
+/**
+ * @brief Frames per block of the ping-pong, pool and replay blocks
+ *
+ * Shorter blocks cut the wait for a block and raise the block rate: each
+ * block pays the hand-off (cache maintenance, latest frame, timing stamp,
+ * statistics merge, callback) once, however short. The consumers take any
+ * count up to ADC_CONVERSIONS_BLOCK_FRAMES. Takes effect at the next start.
+ *
+ * @param frames ADC_CONVERSIONS_MIN_BLOCK_FRAMES to
+ *               ADC_CONVERSIONS_BLOCK_FRAMES, spanning whole D-cache lines
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Set
+ *   @retval HAL_BUSY  Acquisition running; stop it first
+ *   @retval HAL_ERROR Out of range, or not whole cache lines
+ */
+HAL_StatusTypeDef analogSensor_setBlockFrames(uint32_t frames);
+
+/**
+ * @brief Frames per block, see analogSensor_setBlockFrames()
+ */
+uint32_t analogSensor_getBlockFrames(void);
+
+/**
+ * @brief Replay source: the next block of a recording
+ *
+ * @param block       Destination, frame_count frames in scan slot order
+ * @param frame_count analogSensor_getBlockFrames()
+ * @param ctx         Pointer given to analogSensor_startReplay()
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Block filled
+ *   @retval HAL_BUSY  Not available yet (e.g. flash busy), asked again
+ *   @retval HAL_ERROR End of the recording, the replay stops
+ *
+ * @note Called from analogSensor_pollReplay(), i.e. the main loop
+ */
+typedef HAL_StatusTypeDef (*ADC_ReplaySource_t)(uint16_t *block,
+                                                uint32_t frame_count,
+                                                void *ctx);
+
+/**
+ * @brief Progress of a replay
+ */
+typedef struct {
+  uint8_t running;        ///< Replay mode active
+  uint8_t finished;       ///< The source ended
+  uint8_t paced;          ///< Blocks at the scan rate (else back to back)
+  uint32_t blocks;        ///< Blocks handed off
+  uint32_t late;          ///< Paced blocks a block period or more overdue
+  uint32_t waits;         ///< Polls the source had no block ready
+  uint64_t elapsed_ticks; ///< timebase ticks, first to last hand-off
+} ADC_ReplayStats_t;
+
+/**
+ * @brief Feed blocks from a recording through the block hand-off instead
+ *        of the ADCs
+ *
+ * Every block goes through the same steps as a DMA block: gain, filter,
+ * latest frame, timing, ring, clip and statistics pass, block callback.
+ * The hand-off runs in the ADC DMA interrupt (DMA2 Stream0), pended by
+ * analogSensor_pollReplay(), so the stages run in the context and at the
+ * priority they do with the ADCs. Blocks come from the pool while it is
+ * enabled (analogSensor_setBlockPool()), or alternate between the halves
+ * of the ping-pong buffer, so they last as long as DMA blocks do. Frame
+ * sequence numbers continue from the last scan.
+ *
+ * @param frame_rate_hz Rate reported as the sample rate; paced blocks are
+ *                      analogSensor_getBlockFrames() frames of it apart
+ * @param paced         1 = at frame_rate_hz, 0 = the next block as soon
+ *                      as the previous one was handed off
+ * @param source        Block source
+ * @param ctx           Passed back to source
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Replaying
+ *   @retval HAL_BUSY  Acquisition running; stop it first
+ *   @retval HAL_ERROR NULL source or zero rate
+ *
+ * @note analogSensor_stopDMA() ends the replay
+ */
+HAL_StatusTypeDef analogSensor_startReplay(uint32_t frame_rate_hz,
+                                           uint8_t paced,
+                                           ADC_ReplaySource_t source,
+                                           void *ctx);
+
+/**
+ * @brief Fill the next replay block and pend its hand-off when it is due
+ * @note Call from the main loop; does nothing outside replay mode
+ */
+void analogSensor_pollReplay(void);
+
+/**
+ * @brief Hand off a pended replay block; call first in
+ *        DMA2_Stream0_IRQHandler()
+ */
+void analogSensor_replayIrqHandler(void);
+
+/**
+ * @brief Handle the scan DMA's half and full transfer flags without the HAL
+ *        dispatch; call first in DMA2_Stream0_IRQHandler()
+ *
+ * HAL_DMA_IRQHandler() reaches the block hand-off through the stream
+ * state, the error and double-buffer checks of every flag and two indirect
+ * calls. For the circular scans (DMA circular, timed, weighted sequence)
+ * this reads LISR once, clears HTIF0/TCIF0 and hands the half off itself.
+ * Transfer and direct-mode errors, the pool's double-buffer stream, a
+ * realigning pass and the other modes are left to the HAL. Either way the
+ * cycles from here to the hand-off are filed per path, see
+ * analogSensor_getDmaDispatch().
+ *
+ * @return 1 if the interrupt was handled (skip HAL_DMA_IRQHandler()), else 0
+ */
+uint8_t analogSensor_dmaIrqFast(void);
+
+/**
+ * @brief Choose the path of analogSensor_dmaIrqFast() at run time, e.g. to
+ *        time both under the same load
+ *
+ * @param enable 0 = always the HAL (ignored if ADC_CONVERSIONS_FAST_DMA_ISR
+ *               is 0)
+ */
+void analogSensor_setFastDmaIsr(uint8_t enable);
+
+/**
+ * @brief Dispatch cycles of one path since the last reset
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR Invalid path or NULL pointer
+ */
+HAL_StatusTypeDef analogSensor_getDmaDispatch(ADC_DmaDispatch_t path,
+                                              ADC_DmaDispatchStats_t *stats);
+
+/**
+ * @brief Clear the dispatch statistics of both paths
+ */
+void analogSensor_resetDmaDispatch(void);
+
+/**
+ * @brief Get the progress of the current or last replay
+ *
+ * @param stats Destination
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer
+ */
+HAL_StatusTypeDef analogSensor_getReplayStats(ADC_ReplayStats_t *stats);
+
+/**
+ * @brief Timestamp and frame index of the newest completed block
+ *
+ * Called from the block callback it describes the block being handed off.
+ *
+ * @param info Receives the block description
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer, or no block since the DMA start
+ */
+HAL_StatusTypeDef analogSensor_getBlockInfo(ADC_BlockInfo_t *info);
+
+/**
+ * @brief Frame rate, drift and interrupt jitter from the block timestamps
+ *
+ * The rate is taken over the whole run (first to newest block), so its
+ * resolution improves with time and costs nothing per frame. Drift is
+ * against the rate reported by analogSensor_getSampleRate(), measured in
+ * timebase ticks: TIM2 and TIM5 share one oscillator, so this shows the
+ * period rounding and any missed triggers, not the oscillator error.
+ *
+ * @param info Receives the estimate
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_BUSY  Fewer than two blocks so far
+ *   @retval HAL_ERROR NULL pointer
+ */
+HAL_StatusTypeDef analogSensor_getTiming(ADC_TimingInfo_t *info);
+
+/**
+ * @brief Conversion time of a frame, from the newest block stamp and the
+ *        measured frame rate
+ *
+ * @param sequence Frame sequence number (ring or block index)
+ *
+ * @return uint64_t Timebase ticks, 0 if fewer than two blocks are stamped
+ */
+uint64_t analogSensor_getFrameTime(uint32_t sequence);
+
+/**
+ * @brief Get the current acquisition mode
+ *
+ * @return ADC_AcqMode_t Active mode
+ */
+ADC_AcqMode_t analogSensor_getMode(void);
+
+/**
+ * @brief Select how many ADCs share the scan in the DMA modes
+ *
+ * Takes effect at the next analogSensor_startDMA() / _startTimedDMA(). The
+ * per-frame scan time shrinks to 1/2 or 1/3, which also raises the maximum
+ * rate accepted by analogSensor_setSampleRate().
+ *
+ * @param mode Multimode layout
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_BUSY  A DMA mode is running, stop it first
+ *   @retval HAL_ERROR Invalid mode, or one the channel table cannot run
+ *                     (count not split evenly over its ADCs, more than 16
+ *                     ranks per ADC, or a channel not wired to them)
+ *
+ * @note Clears every analog watchdog guard, since the channel to ADC
+ *       assignment changes
+ */
+HAL_StatusTypeDef analogSensor_setMultimode(ADC_Multimode_t mode);
+
+/**
+ * @brief Get the selected multimode layout
+ *
+ * @return ADC_Multimode_t Selected layout
+ */
+ADC_Multimode_t analogSensor_getMultimode(void);
+
+/**
+ * @brief Set the conversion resolution of one ADC
+ *
+ * Polling reads and instances on that ADC use it at once; the scan, the
+ * weighted sequence and the grouped scan from their next start. The ADCs
+ * of a simultaneous layout convert their ranks together, so the scan needs
+ * them all at one resolution (analogSensor_startDMA() fails otherwise);
+ * different resolutions pay off on ADC1 alone (independent layout, the
+ * sequence and the grouped scan) and on the ADC2/ADC3 instances. Shock
+ * captures always run at 12 bits.
+ *
+ * @param adc        0 = ADC1, 1 = ADC2, 2 = ADC3
+ * @param resolution ADC_RESOLUTION_12B, _10B, _8B or _6B
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_BUSY  An acquisition mode or an asynchronous read is active
+ *   @retval HAL_ERROR Invalid ADC or resolution
+ */
+HAL_StatusTypeDef analogSensor_setResolution(uint8_t adc, uint32_t resolution);
+
+/**
+ * @brief Resolution of one ADC (ADC_RESOLUTION_xB), 0 for an invalid ADC
+ */
+uint32_t analogSensor_getResolution(uint8_t adc);
+
+/**
+ * @brief Channel stored at each position of a raw DMA frame
+ *
+ * Frames in the ring and in analogSensor_getFrame() are always in channel
+ * order. Raw blocks handed to the block callback keep the DMA order, which
+ * in triple mode is 0,1,2,4,5,3. Reflects the layout selected with
+ * analogSensor_setMultimode(), so it can be read before the start.
+ *
+ * @return const uint8_t* ADC_CONVERSIONS_CHANNEL_COUNT channel indices
+ */
+const uint8_t *analogSensor_getBlockChannelMap(void);
+
+/**
+ * @brief Start a one-shot high-rate capture of a single input
+ *
+ * ADC1/2/3 convert the same channel in triple-interleaved mode (ADCCLK
+ * raised to PCLK2/4, 3-cycle sampling, 5-cycle phase delay) and DMA fills
+ * the dedicated capture buffer once. The scan must be stopped first; call
+ * analogSensor_stopDMA() afterwards to restore the scan/polling setup.
+ *
+ * @param channel  Channel index of a pin wired to all three ADCs
+ *                 (ADC_CHANNELS_ADC123; PA4/PA5 are not routed to ADC3)
+ * @param callback Called from the DMA ISR when the buffer is full (NULL ok)
+ * @param ctx      Passed back to the callback
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Capture running
+ *   @retval HAL_BUSY  Scan or capture already active
+ *   @retval HAL_ERROR Invalid channel or HAL failure
+ */
+HAL_StatusTypeDef analogSensor_startCapture(uint8_t channel,
+                                            ADC_CaptureCallback_t callback,
+                                            void *ctx);
+
+/**
+ * @brief Start the shock capture into a caller's buffer instead of the
+ *        dedicated one: a transient recorder as long as the RAM given
+ *
+ * Same conversions, rate and completion as analogSensor_startCapture();
+ * only the DMA touches the buffer until it is full. It is cleaned and
+ * invalidated from the D-cache first, so a cacheable region does not need
+ * to be clean. analogSensor_getCapture() returns it once full.
+ *
+ * @param channel  As analogSensor_startCapture()
+ * @param buffer   32-byte aligned, DMA-reachable (SRAM1, SRAM2 or DTCM)
+ * @param samples  Whole cache lines (a multiple of 16), up to
+ *                 ADC_CONVERSIONS_BURST_MAX_SAMPLES
+ * @param callback As analogSensor_startCapture()
+ * @param ctx      Passed back to the callback
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Capture running
+ *   @retval HAL_BUSY  Scan or capture already active
+ *   @retval HAL_ERROR Invalid channel, buffer or count, or HAL failure
+ */
+HAL_StatusTypeDef analogSensor_startBurst(uint8_t channel, uint16_t *buffer,
+                                          uint32_t samples,
+                                          ADC_CaptureCallback_t callback,
+                                          void *ctx);
+
+/**
+ * @brief Take a shock capture out of the running timed scan and go back to
+ *        the scan without restarting its timeline
+ *
+ * At the end of the next block the DMA interrupt stops the scan and starts
+ * the capture of analogSensor_startCapture(); TIM2 keeps running. The
+ * capture's completion re-arms the scan on the same TIM2 grid, so its
+ * frames land where they would have without the capture. The sequence
+ * numbers skip the scan frames the capture took, the ring, the counters
+ * and the timing estimate carry on, and the first frame back carries
+ * ADC_RING_FLAG_MODE. analogSensor_getCapture() returns the capture once
+ * the scan is back; analogSensor_getSwitchInfo() has the gap and the
+ * transition times.
+ *
+ * @param channel  As analogSensor_startCapture()
+ * @param callback Called from the DMA ISR with the full buffer, after the
+ *                 scan is re-armed (NULL ok)
+ * @param ctx      Passed back to the callback
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Switch pending, at the next block boundary
+ *   @retval HAL_BUSY  Not in the timed scan, block pool on, or a switch
+ *                     already pending or running
+ *   @retval HAL_ERROR Invalid channel
+ */
+HAL_StatusTypeDef analogSensor_switchToCapture(uint8_t channel,
+                                               ADC_CaptureCallback_t callback,
+                                               void *ctx);
+
+/**
+ * @brief Set the weighted rank sequence used by analogSensor_startSequence()
+ *
+ * Each selected channel takes as many of the 16 regular ranks as its
+ * weight; the default is every channel at weight 1. The sequence runs on
+ * ADC1 in the independent layout, so tables that layout cannot run (see
+ * ADC_Multimode_t) have none.
+ *
+ * @param channel_mask Bit n selects channel n
+ * @param weights      Ranks per channel, indexed by channel (NULL = all 1);
+ *                     entries of unselected channels are ignored
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Sequence stored
+ *   @retval HAL_BUSY  Not in polling mode
+ *   @retval HAL_ERROR Empty mask, a selected weight of 0 or more than
+ *                     ADC_SEQUENCE_MAX_RANKS ranks in total
+ */
+HAL_StatusTypeDef analogSensor_setSequence(ADC_ChannelMask_t channel_mask,
+                                           const uint8_t *weights);
+
+/**
+ * @brief Copy the weighted rank sequence
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer
+ */
+HAL_StatusTypeDef analogSensor_getSequence(ADC_ScanSequence_t *seq);
+
+/**
+ * @brief Highest scan rate of the weighted sequence at the current ADCCLK
+ *
+ * @return uint32_t Scans per second; channel n is sampled weight[n] times
+ *         as often
+ */
+uint32_t analogSensor_getSequenceMaxRate(void);
+
+/**
+ * @brief Start the weighted sequence on ADC1, one scan per TIM2 trigger
+ *
+ * The scans stream by circular DMA into their own buffer, handed off half
+ * by half to the callback; the newest value of each channel also updates
+ * the packed frame. The 6-slot block stream (ring, statistics, block
+ * callback) is not fed in this mode. Stop with analogSensor_stopDMA().
+ *
+ * @param scan_rate_hz Scans per second
+ * @param callback     Called from the DMA ISR per half buffer (NULL ok)
+ * @param ctx          Passed back to the callback
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Sequence running
+ *   @retval HAL_BUSY  Another acquisition is active
+ *   @retval HAL_ERROR Multimode layout selected, scan trigger not TIM2,
+ *                     rate above analogSensor_getSequenceMaxRate() or HAL
+ *                     failure
+ */
+HAL_StatusTypeDef analogSensor_startSequence(uint32_t scan_rate_hz,
+                                             ADC_SequenceCallback_t callback,
+                                             void *ctx);
+
+/**
+ * @brief Highest frame rate of the grouped scan at the current ADCCLK
+ *
+ * @param group_size Channels per group
+ *
+ * @return uint32_t Frames per second: each trigger period must hold the
+ *         longest group; 0 if the size does not split the table
+ */
+uint32_t analogSensor_getGroupedMaxRate(uint8_t group_size);
+
+/**
+ * @brief Start the table's channels on ADC1 in discontinuous groups, one
+ *        group per TIM2 trigger
+ *
+ * The regular sequence is the table order, split into groups of group_size
+ * (DISCNUM): each trigger converts the next group, and the DMA interrupt
+ * at its end hands it off, so group 0 is out (groups - 1) trigger periods
+ * before the frame completes. The DMA buffer holds two groups: every half
+ * and full transfer is a group. Each group updates the packed frame, which
+ * is published at the last one. The block stream is not fed in this mode.
+ * Stop with analogSensor_stopDMA().
+ *
+ * @param frame_rate_hz Frames per second; TIM2 runs at frame_rate_hz times
+ *                      the group count
+ * @param group_size    Channels per group, 1..ADC_GROUP_MAX_SIZE, dividing
+ *                      the channel count
+ * @param callback      Called from the DMA ISR per group (NULL ok)
+ * @param ctx           Passed back to the callback
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Groups running
+ *   @retval HAL_BUSY  Another acquisition is active
+ *   @retval HAL_ERROR Multimode layout selected, scan trigger not TIM2,
+ *                     group size that does not split the table, rate above
+ *                     analogSensor_getGroupedMaxRate() or HAL failure
+ */
+HAL_StatusTypeDef analogSensor_startGrouped(uint32_t frame_rate_hz,
+                                            uint8_t group_size,
+                                            ADC_GroupCallback_t callback,
+                                            void *ctx);
+
+/**
+ * @brief Start one injected conversion of a channel
+ *
+ * The injected group pre-empts the regular scan for one conversion (about
+ * sampling time + 12 ADCCLK), then the scan resumes where it stopped. In
+ * multimode every scan ADC converts an injected channel simultaneously so
+ * the ADCs stay in lock-step; only the requested one is reported. Works in
+ * polling mode too (ADC1).
+ *
+ * @param channel  Channel index
+ * @param callback Called from the ADC ISR with the result (NULL ok)
+ * @param ctx      Passed back to the callback
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Conversion started
+ *   @retval HAL_BUSY  Injected conversion pending or shock capture active
+ *   @retval HAL_ERROR Invalid channel or HAL failure
+ */
+HAL_StatusTypeDef analogSensor_startInjected(uint8_t channel,
+                                             ADC_InjectedCallback_t callback,
+                                             void *ctx);
+
+/**
+ * @brief Convert one channel through the injected group and wait for it
+ *
+ * @param channel Channel index
+ * @param value   Receives the 12-bit code
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK      Success, typically a few microseconds
+ *   @retval HAL_BUSY    See analogSensor_startInjected()
+ *   @retval HAL_TIMEOUT No result within the polling timeout
+ *   @retval HAL_ERROR   Invalid channel, NULL pointer or HAL failure
+ *
+ * @note Main-loop context only: the result arrives through the ADC interrupt
+ */
+HAL_StatusTypeDef analogSensor_readInjected(uint8_t channel, uint16_t *value);
+
+/**
+ * @brief Start one injected conversion of the temperature sensor or VREFINT
+ *
+ * Converted by ADC1 with 112 cycles of sampling, above the 10 us both
+ * sources need; in multimode the slave ADCs convert their scan channel with
+ * the same sampling time, so the lock-step holds. The first call connects
+ * the sources (TSVREFE, VBAT off: they share ADC1_IN18), so its result may
+ * be taken before the sensor has settled.
+ *
+ * @param which    ADC_INTERNAL_TEMPSENSOR or ADC_INTERNAL_VREFINT, also the
+ *                 channel passed to the callback
+ * @param callback Called from the ADC ISR with the result (NULL ok)
+ * @param ctx      Passed back to the callback
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Conversion started
+ *   @retval HAL_BUSY  Injected conversion pending or shock capture active
+ *   @retval HAL_ERROR Invalid source or HAL failure
+ */
+HAL_StatusTypeDef analogSensor_startInternal(uint8_t which,
+                                             ADC_InjectedCallback_t callback,
+                                             void *ctx);
+
+/**
+ * @brief Get the finished capture
+ *
+ * @param samples Receives the capture buffer
+ * @param count   Receives the number of samples
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Capture complete, buffer valid until the next start
+ *   @retval HAL_BUSY  Still converting
+ *   @retval HAL_ERROR No capture started or NULL pointer
+ *
+ * @note A capture of analogSensor_switchToCapture() reads HAL_BUSY until
+ *       the scan is back
+ */
+HAL_StatusTypeDef analogSensor_getCapture(const uint16_t **samples,
+                                          uint32_t *count);
+
+/**
+ * @brief Sample rate of the shock capture for the current clock tree
+ *
+ * @return uint32_t Samples per second
+ */
+uint32_t analogSensor_getCaptureRate(void);
+
+/**
+ * @brief Copy the newest packed frame
+ *
+ * @param frame Destination
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer
+ *
+ * @note In polling mode the frame collects the latest result of every
+ *       channel; in DMA mode it is the newest frame of the last block.
+ */
+HAL_StatusTypeDef analogSensor_getFrame(ADC_Frame_t *frame);
+
+/**
+ * @brief Copy the newest complete frame, all channels from the same frame
+ *
+ * The writer makes a sequence counter odd while it updates the snapshot and
+ * even again after; the reader copies and retries if the counter was odd or
+ * moved. An update takes well under a microsecond, so a retry is rare and
+ * the copy takes a few dozen cycles. Interrupts are never masked, so it may
+ * be called from any priority, including above the DMA interrupt.
+ *
+ * @param latest Destination
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_BUSY  No frame published yet
+ *   @retval HAL_ERROR NULL pointer
+ *
+ * @note The frame is at most one block period old in the DMA scans; a
+ *       single-channel analogSensor_operation() does not publish.
+ */
+HAL_StatusTypeDef analogSensor_getLatestFrame(ADC_LatestFrame_t *latest);
+
+/**
+ * @brief Take up to max_frames queued frames from the ring in one call
+ *
+ * The frames are copied out of the ring slots in place (adcRing_peek()), one
+ * index publish per batch. dst[i] is frame first_sequence + i: the batch
+ * stops before a sequence gap (frames dropped on a full ring), which the
+ * next call then starts after.
+ *
+ * @param dst            Destination, max_frames frames in channel order
+ * @param max_frames     Most frames to take
+ * @param first_sequence Receives the sequence number of dst[0] (may be NULL)
+ *
+ * @return uint32_t Frames copied (0 = ring empty or NULL destination)
+ *
+ * @note Ring consumer side: do not mix with adcRing_pop() from another
+ *       context. Zero-copy callers use adcRing_peek() / adcRing_consume()
+ *       directly, or the block pool for whole blocks.
+ */
+uint32_t analogSensor_readFrames(ADC_Frame_t *dst, uint32_t max_frames,
+                                 uint32_t *first_sequence);
+
+/**
+ * @brief Get total error count
+ *
+ * @return uint32_t Total number of conversion errors
+ */
+uint32_t analogSensor_getErrorCount(void);
+
+/**
+ * @brief Get complete error information
+ *
+ * Lock-free: the copy is retried if an error was counted meanwhile, so the
+ * total, the matrix and the last error always belong together. Interrupts
+ * stay enabled while copying; callable from any context.
+ *
+ * @param error_info Pointer to receive error info
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
  *   @retval HAL_ERROR NULL pointer
  */
 HAL_StatusTypeDef analogSensor_getErrors(ADC_ErrorInfo_t *error_info);
@@ -150,6 +1947,233 @@ HAL_StatusTypeDef analogSensor_getErrors(ADC_ErrorInfo_t *error_info);
  */
 void analogSensor_resetErrors(void);
 
+/**
+ * @brief The default instance: ADC1 and the ADC_CHANNELS_TABLE() channels
+ *
+ * @return ADC_SensorCtx_t* Instance behind the global API
+ */
+ADC_SensorCtx_t *analogSensor_defaultCtx(void);
+
+/**
+ * @brief Set up an instance polling another ADC
+ *
+ * The channel table is used, not copied: Rank is ignored (every read uses
+ * rank 1) and SamplingTime is taken as given. The ADC is put into
+ * single-conversion mode for each read only, so a later multimode scan or
+ * capture still finds it as MX_ADCx_Init() left it.
+ *
+ * @param ctx           Instance to initialise
+ * @param hadc          Initialised ADC2 or ADC3 handle
+ * @param channels      Channel table, channel_count entries
+ * @param channel_count 1..ADC_CONVERSIONS_CHANNEL_COUNT
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer, count out of range, or ADC1 (the
+ *                     default instance's)
+ */
+HAL_StatusTypeDef analogSensor_ctxInit(ADC_SensorCtx_t *ctx,
+                                       ADC_HandleTypeDef *hadc,
+                                       const ADC_ChannelConfTypeDef *channels,
+                                       uint8_t channel_count);
+
+/**
+ * @brief Acquire one channel of an instance (blocking)
+ *
+ * The EOC wait is bounded by ADC_CONVERSIONS_TIMEOUT_FACTOR times the
+ * channel's conversion time, as for the default instance. On the default
+ * instance this is analogSensor_operation().
+ *
+ * @param ctx     Instance
+ * @param channel Index into the instance's channel table
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK      Result in the instance frame
+ *   @retval HAL_BUSY    The ADC is taking part in a multimode scan or capture
+ *   @retval HAL_TIMEOUT No EOC in time (counted, channel flagged)
+ *   @retval HAL_ERROR   Invalid instance or channel, or HAL failure
+ */
+HAL_StatusTypeDef analogSensor_ctxOperation(ADC_SensorCtx_t *ctx,
+                                            uint8_t channel);
+
+/**
+ * @brief Acquire the channels of a mask and publish the frame
+ *
+ * @param ctx          Instance
+ * @param channel_mask Bit n = channel n of the instance
+ *
+ * @return HAL_StatusTypeDef Status of the last failed channel, HAL_OK if none
+ */
+HAL_StatusTypeDef analogSensor_ctxOperationChannels(
+    ADC_SensorCtx_t *ctx, ADC_ChannelMask_t channel_mask);
+
+/**
+ * @brief Newest complete frame of an instance, see
+ *        analogSensor_getLatestFrame()
+ */
+HAL_StatusTypeDef analogSensor_ctxGetLatestFrame(ADC_SensorCtx_t *ctx,
+                                                 ADC_LatestFrame_t *latest);
+
+/**
+ * @brief Error matrix of an instance, see analogSensor_getErrors()
+ */
+HAL_StatusTypeDef analogSensor_ctxGetErrors(ADC_SensorCtx_t *ctx,
+                                            ADC_ErrorInfo_t *error_info);
+
+/**
+ * @brief Clear the error matrix of an instance
+ */
+void analogSensor_ctxResetErrors(ADC_SensorCtx_t *ctx);
+
+/**
+ * @brief Copy the overrun recovery statistics of the running scan
+ *
+ * @param info Receives the statistics
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer
+ */
+HAL_StatusTypeDef analogSensor_getOverrunInfo(ADC_OverrunInfo_t *info);
+
+/**
+ * @brief Copy the statistics of the scan-to-capture switches
+ *
+ * @param info Receives the statistics
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer
+ */
+HAL_StatusTypeDef analogSensor_getSwitchInfo(ADC_SwitchInfo_t *info);
+
+/**
+ * @brief Copy the conversion-time table and histogram of the polling reads
+ *
+ * @param timing Receives the timing; the table is built if stale
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer
+ */
+HAL_StatusTypeDef analogSensor_getConvTiming(ADC_ConvTiming_t *timing);
+
+/**
+ * @brief Clear the conversion-time histogram and counters
+ */
+void analogSensor_resetConvTiming(void);
+
+/**
+ * @brief Get the per-channel statistics of the DMA blocks since the last
+ *        reset
+ *
+ * @param stats ADC_CONVERSIONS_CHANNEL_COUNT entries, in channel order
+ * @param reset Non-zero to restart the statistics in the same critical
+ *              section, so no block is lost between two reads
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer
+ *
+ * @note Accumulated by the DMA block hand-off in every scan mode; the
+ *       interrupt is held off only for the copy of the integer totals
+ */
+HAL_StatusTypeDef analogSensor_getChannelStats(ADC_ChannelStats_t *stats,
+                                               uint8_t reset);
+
+/**
+ * @brief Restart the per-channel statistics
+ */
+void analogSensor_resetChannelStats(void);
+
+/**
+ * @brief Get the per-channel saturation counters
+ *
+ * Every frame the DMA block hand-off queues is checked against
+ * ADC_CLIP_LOW_CODE / ADC_CLIP_HIGH_CODE, after the block gain and filter.
+ * A frame with a clipped sample carries ADC_RING_FLAG_CLIPPED in the ring,
+ * and ADC_BlockInfo_t.clipped marks the channels of a clipped block.
+ *
+ * @param stats ADC_CONVERSIONS_CHANNEL_COUNT entries, in channel order
+ * @param reset Non-zero to clear the counters in the same critical section
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer
+ */
+HAL_StatusTypeDef analogSensor_getClipStats(ADC_ClipStats_t *stats,
+                                            uint8_t reset);
+
+/**
+ * @brief Guard a channel with its ADC's analog watchdog
+ *
+ * The watchdog compares every regular conversion of the channel against
+ * [low, high] in hardware and interrupts on the first one outside it. Each
+ * ADC has one watchdog, so at most one channel per ADC of the selected
+ * layout (see ADC_Multimode_t) can be guarded. Applied at the next
+ * analogSensor_startDMA() / _startTimedDMA().
+ *
+ * @param channel Channel index
+ * @param low     Low threshold (codes, 0..4095)
+ * @param high    High threshold (codes, low..4095)
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_BUSY  A DMA mode is running, stop it first
+ *   @retval HAL_ERROR Invalid channel or thresholds, or the channel's ADC
+ *                     already guards another channel
+ */
+HAL_StatusTypeDef analogSensor_configWatchdog(uint8_t channel, uint16_t low,
+                                              uint16_t high);
+
+/**
+ * @brief Remove the watchdog guard of a channel
+ *
+ * @param channel Channel index
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_BUSY  A DMA mode is running, stop it first
+ *   @retval HAL_ERROR Invalid channel
+ */
+HAL_StatusTypeDef analogSensor_clearWatchdog(uint8_t channel);
+
+/**
+ * @brief Register the watchdog alarm callback
+ *
+ * @param callback Function called from the ADC ISR per alarm (NULL = none)
+ * @param ctx      Passed back to the callback
+ */
+void analogSensor_registerWatchdogCallback(ADC_WatchdogCallback_t callback,
+                                           void *ctx);
+
+/**
+ * @brief Re-enable the watchdog alarms
+ *
+ * An alarm disables its ADC's watchdog interrupt, since a channel stuck
+ * outside its window would otherwise interrupt on every frame. Call this
+ * once the alarm has been handled; the scan keeps running meanwhile.
+ */
+void analogSensor_armWatchdog(void);
+
+/**
+ * @brief Number of watchdog alarms since the last DMA start
+ *
+ * @return uint32_t Alarm count
+ */
+uint32_t analogSensor_getWatchdogAlarms(void);
+
+/**
+ * @brief Channel that a scan ADC's watchdog guards in the running layout
+ *
+ * Set at the DMA start; cheap enough for the ADC interrupt.
+ *
+ * @param adc 0 = ADC1, 1 = ADC2, 2 = ADC3
+ *
+ * @return uint8_t Channel index, or 0xFF if that watchdog is off
+ */
+uint8_t analogSensor_getWatchdogChannel(uint8_t adc);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,164 @@
+/**
+ ******************************************************************************
+ * @file    adc_linearity.h
+ * @brief   Per-code INL/DNL correction tables of the three ADCs, built from
+ *          a DAC loopback sweep
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * The F7 ADC's transfer curve bows and steps by a few codes (INL up to
+ * +-3 LSB in the datasheet, with DNL steps at the major carries). Gain and
+ * offset are the calibration matrix's job (adc_calibration.h); what is left
+ * is a function of the code alone, so one table per ADC maps every raw
+ * code to the code a linear ADC with the same gain and offset would give:
+ *
+ *   table[adc][code] = corrected code x 2^ADC_LIN_FRAC_BITS   (q15)
+ *
+ * The two fractional bits keep the sub-LSB part of the correction while
+ * three products of a matrix row (dsp_fused.h) still fit 32 bits. The
+ * tables are 8 kB each and live in DTCM (ADC_FAST_BSS), so the lookup is a
+ * single-cycle load per sample; they start as the identity.
+ *
+ * adcLin_build() makes a table from a sweep: the mean ADC code (x16) at
+ * each of a run of DAC codes, from dacLoop_startSweep(). It fits a line to
+ * the curve (least squares, DAC code -> ADC code), inverts the curve at
+ * every ADC code (its running maximum, so a noisy step back cannot fold
+ * it) and stores the line's value there. Codes beyond the swept range keep
+ * the correction of the nearest swept code. The DAC is the reference, so
+ * its own INL (+-2 LSB max, typically well under the ADC's) stays in the
+ * result.
+ *
+ * The sweep only reaches the ADC that converts the DAC pin (PA4) in the
+ * layout running: ADC1 with the default table in every layout. The other
+ * tables stay the identity unless a board table puts PA4 on their slots.
+ *
+ * Usage Example:
+ *   adcLin_init();
+ *   // after dacLoop_poll() has ended a sweep
+ *   DacLoop_Sweep_t sw;
+ *   dacLoop_getSweep(&sw);
+ *   adcLin_build(adcLin_slotAdc(sw.slot), sw.mean_x16, sw.first, sw.step,
+ *                sw.points);
+ *   dspFused_attachLinearity(&fused, 1);   // one lookup per sample
+ *
+ * @note Not persisted: a table is 8 kB and the sweep takes about four
+ *       minutes at 4 kHz, so it is run again after a reset when wanted.
+ ******************************************************************************
+ */
+
+#ifndef ADC_LINEARITY_H
+#define ADC_LINEARITY_H
+
+#include "stm32f7xx_hal.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+
+/**
+ * @brief Set to 1 to reserve the tables (24 kB of DTCM)
+ */
+#ifndef ADC_LIN_ENABLE
+#define ADC_LIN_ENABLE 0
+#endif
+
+/**
+ * @brief Entries per table: every 12-bit code
+ */
+#define ADC_LIN_CODES 4096U
+
+/**
+ * @brief Fractional bits of an entry
+ */
+#define ADC_LIN_FRAC_BITS 2U
+
+/**
+ * @brief One table per ADC: ADC1, ADC2, ADC3
+ */
+#define ADC_LIN_ADCS 3U
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief What a table was built from
+ */
+typedef struct {
+  uint8_t calibrated;     ///< Built from a sweep (0 = identity)
+  uint16_t first;         ///< First DAC code swept
+  uint16_t last;          ///< Last DAC code swept
+  uint16_t code_lo;       ///< ADC codes the sweep covered
+  uint16_t code_hi;
+  uint16_t inl_code;      ///< Code of the largest correction
+  int32_t inl_max_centi;  ///< That correction, 0.01 LSB (signed)
+  int32_t dnl_max_centi;  ///< Widest |DNL| of the mean curve, 0.01 LSB
+  uint32_t folds;         ///< Points below an earlier one (non-monotonic)
+  int32_t gain_ppm;       ///< Fitted ADC codes per DAC code - 1, ppm
+  int32_t offset_centi;   ///< Fitted ADC code at DAC code 0, 0.01 LSB
+} AdcLin_Info_t;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief All tables to the identity
+ */
+void adcLin_init(void);
+
+/**
+ * @brief Table of one ADC (0 = ADC1), NULL without ADC_LIN_ENABLE
+ */
+const int16_t *adcLin_getTable(uint8_t adc);
+
+/**
+ * @brief ADC that converts a block slot in the multimode layout running
+ *        (0 = ADC1)
+ */
+uint8_t adcLin_slotAdc(uint8_t slot);
+
+/**
+ * @brief Build the table of one ADC from a sweep
+ *
+ * @param adc      0 = ADC1 .. 2 = ADC3
+ * @param mean_x16 Mean ADC code x 16 at each point
+ * @param first    DAC code of point 0
+ * @param step     DAC codes between points
+ * @param points   Points, at least 16
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Table replaced
+ *   @retval HAL_ERROR Tables not built in, NULL pointer, a sweep beyond the
+ *                     12-bit range, or a flat curve
+ *
+ * @note The table is rewritten in place: do not call it while a kernel
+ *       reads it (the block path is still running). Takes a few ms.
+ */
+HAL_StatusTypeDef adcLin_build(uint8_t adc, const uint16_t *mean_x16,
+                               uint16_t first, uint16_t step, uint16_t points);
+
+/**
+ * @brief One table back to the identity
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR Tables not built in or bad ADC
+ */
+HAL_StatusTypeDef adcLin_reset(uint8_t adc);
+
+/**
+ * @brief How a table was built
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer or bad ADC
+ */
+HAL_StatusTypeDef adcLin_getInfo(uint8_t adc, AdcLin_Info_t *info);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ADC_LINEARITY_H */
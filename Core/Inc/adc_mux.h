@@ -0,0 +1,271 @@
+/**
+ ******************************************************************************
+ * @file    adc_mux.h
+ * @brief   External analog multiplexers on the scan inputs: select lines
+ *          switched by DMA after each scan, frames demultiplexed
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * Each of the six inputs (PA0-PA5 on the Nucleo) is fed by an 8:1 analog
+ * multiplexer (CD4051, ADG708, ...). The muxes share their select lines,
+ * so every scan reads the same position p of all six, and
+ * ADC_MUX_POSITIONS consecutive scans read every sensor once: 48
+ * channels from the existing inputs. Sensor input * ADC_MUX_POSITIONS + p
+ * is on input `input`, position p. The select lines are consecutive pins
+ * of one port:
+ *
+ *   PE7 S0  PE8 S1  PE9 S2  (defaults, push-pull outputs)
+ *
+ * No CPU time goes into the switching. The chain is:
+ *
+ *   TIM2 TRGO -> TIM1 (ITR1, trigger + one-pulse mode)
+ *     CC4 once per trigger, when the last rank has finished sampling
+ *       -> DMA2 Stream4 ch6: next BSRR word into the select port
+ *          (circular over the positions)
+ *
+ * The switch comes after the end of the last sampling phase
+ * (analogSensor_getScanSkew()) plus ADC_MUX_SWITCH_MARGIN_NS, while the
+ * ADCs convert what they hold. The muxes then have until the next trigger
+ * to settle; adcMux_getMaxFrameRate() keeps that gap at least the
+ * configured settle time (adcMux_setSettle()). Each sensor is read at the
+ * scan rate / ADC_MUX_POSITIONS.
+ *
+ * adcMux_processBlock() takes the raw blocks and writes each scan into its
+ * position of a mux frame: ADC_MUX_CHANNELS codes in sensor order, the
+ * frame format of a block at that width. Blocks of ADC_MUX_BLOCK_FRAMES
+ * mux frames go to the registered callback. Mux frame n holds scans
+ * n * ADC_MUX_POSITIONS + phase and up; a frame a gap in the scan cut into
+ * is dropped, counted.
+ *
+ * Position check: at each block the position the DMA has reached is
+ * compared with the one the frame count expects. It is exact while the
+ * block is handed over before the next trigger (otherwise the block is not
+ * checked). A switch lost or doubled (a retriggered TIM2 update the ADC
+ * ignored) moves the phase, which is counted and followed from that block.
+ * With two positions only a lost scan shows up.
+ *
+ * Usage Example:
+ *   adcMux_init();                           // once, after MX_DMA_Init()
+ *   adcMux_registerBlockCallback(onMuxBlock, NULL);
+ *
+ *   analogSensor_startTimedDMA(rate_hz);
+ *   adcMux_start(rate_hz);                   // before the first trigger
+ *
+ *   // block callback (ISR), raw slot order
+ *   adcMux_processBlock(block, frames, analogSensor_getBlockChannelMap());
+ *
+ *   void onMuxBlock(const AdcMux_Block_t *b, void *ctx) {
+ *     uint16_t code = adcMux_getSample(b, 0, 8 * 2 + 5); // input 2, pos 5
+ *   }
+ *
+ * @note TIM1 and DMA2 Stream4 are taken while ADC_MUX_ENABLE is set, so
+ *       PWM_SYNC_ENABLE cannot share TIM1. Block filters that work across
+ *       frames (dsp_despike.h, dsp_deskew.h) would mix the positions.
+ ******************************************************************************
+ */
+
+#ifndef ADC_MUX_H
+#define ADC_MUX_H
+
+#include "adc_conversions.h"
+#include "stm32f7xx_hal.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+
+/**
+ * @brief Set to 1 when the multiplexers are fitted
+ */
+#ifndef ADC_MUX_ENABLE
+#define ADC_MUX_ENABLE 0
+#endif
+
+/**
+ * @brief Positions per mux (2, 4 or 8): 1, 2 or 3 select lines
+ */
+#ifndef ADC_MUX_POSITIONS
+#define ADC_MUX_POSITIONS 8U
+#endif
+
+/**
+ * @brief Port and first pin of the select lines (S0 = first pin)
+ */
+#ifndef ADC_MUX_SELECT_PORT
+#define ADC_MUX_SELECT_PORT GPIOE
+#endif
+#ifndef ADC_MUX_SELECT_SHIFT
+#define ADC_MUX_SELECT_SHIFT 7U
+#endif
+#ifndef ADC_MUX_SELECT_CLK_ENABLE
+#define ADC_MUX_SELECT_CLK_ENABLE() __HAL_RCC_GPIOE_CLK_ENABLE()
+#endif
+
+/**
+ * @brief Settle time of a mux and its input network after a switch, until
+ *        adcMux_setSettle()
+ */
+#ifndef ADC_MUX_SETTLE_NS
+#define ADC_MUX_SETTLE_NS 2000U
+#endif
+
+/**
+ * @brief Switch delay after the end of the last sampling phase; under the
+ *        12 ADCCLK of a conversion, so the switch precedes the block's DMA
+ */
+#ifndef ADC_MUX_SWITCH_MARGIN_NS
+#define ADC_MUX_SWITCH_MARGIN_NS 100U
+#endif
+
+/**
+ * @brief Mux frames per demultiplexed block
+ */
+#ifndef ADC_MUX_BLOCK_FRAMES
+#define ADC_MUX_BLOCK_FRAMES (ADC_CONVERSIONS_BLOCK_FRAMES / ADC_MUX_POSITIONS)
+#endif
+
+/**
+ * @brief Sensors behind the inputs
+ */
+#define ADC_MUX_CHANNELS (ADC_CONVERSIONS_CHANNEL_COUNT * ADC_MUX_POSITIONS)
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief One block of mux frames
+ */
+typedef struct {
+  uint32_t first_frame;   ///< Mux frame number of the first frame
+  uint32_t first_scan;    ///< Scan frame of its position 0
+  uint32_t frame_count;   ///< ADC_MUX_BLOCK_FRAMES
+  const uint16_t *frames; ///< frame_count x ADC_MUX_CHANNELS, sensor order
+} AdcMux_Block_t;
+
+/**
+ * @brief Block callback (the context of adcMux_processBlock()). The frames
+ *        stay valid until the next block is complete.
+ */
+typedef void (*AdcMux_BlockCallback_t)(const AdcMux_Block_t *block, void *ctx);
+
+/**
+ * @brief Counters, reset by adcMux_start()
+ */
+typedef struct {
+  uint8_t running;     ///< Chain armed
+  uint8_t phase;       ///< Scan frame of position 0, modulo the positions
+  uint32_t switch_ns;  ///< Trigger -> switch
+  uint32_t settle_ns;  ///< Switch -> next trigger required (next start)
+  uint32_t frames;     ///< Mux frames complete
+  uint32_t blocks;     ///< Blocks handed over
+  uint32_t dropped;    ///< Mux frames cut by a gap in the scan
+  uint32_t checked;    ///< Blocks whose position was checked
+  uint32_t realigned;  ///< Of them, found off the expected phase
+  uint32_t dma_errors; ///< Transfer errors of the select stream
+} AdcMux_Stats_t;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief Set up the select pins (position 0), TIM1 and the DMA stream (not
+ *        armed)
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Ready (or ADC_MUX_ENABLE = 0)
+ *   @retval HAL_ERROR A HAL init failed
+ */
+HAL_StatusTypeDef adcMux_init(void);
+
+/**
+ * @brief Arm the chain for the scan started at frame 0
+ *
+ * Call right after analogSensor_startTimedDMA(), within one frame period:
+ * the first TIM2 update after the call is taken as frame 0, at position 0.
+ * The switch instant follows the sampling times in use.
+ *
+ * @param frame_rate_hz Scan rate, for the settle check
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Armed
+ *   @retval HAL_ERROR Not initialised, the rate is above
+ *                     adcMux_getMaxFrameRate(), or the switch delay does not
+ *                     fit the TIM1 counter
+ */
+HAL_StatusTypeDef adcMux_start(uint32_t frame_rate_hz);
+
+/**
+ * @brief Disarm the chain, select lines back to position 0
+ */
+void adcMux_stop(void);
+
+/**
+ * @brief Settle time to keep between a switch and the next trigger, from
+ *        the next adcMux_start()
+ */
+void adcMux_setSettle(uint32_t settle_ns);
+
+/**
+ * @brief Highest scan rate that leaves the settle time after each switch,
+ *        at the sampling times in use
+ */
+uint32_t adcMux_getMaxFrameRate(void);
+
+/**
+ * @brief Demultiplex one raw block (block callback); ignored unless armed
+ *        and the scan is the timer-paced stream
+ *
+ * @param block       Interleaved frames, slot order
+ * @param frame_count Frames in the block
+ * @param channel_map Raw slot -> input (NULL = identity)
+ */
+void adcMux_processBlock(const uint16_t *block, uint32_t frame_count,
+                         const uint8_t *channel_map);
+
+/**
+ * @brief Register the block callback (NULL to remove)
+ */
+void adcMux_registerBlockCallback(AdcMux_BlockCallback_t callback, void *ctx);
+
+/**
+ * @brief Newest complete mux frame
+ *
+ * @param samples Receives ADC_MUX_CHANNELS codes, sensor order
+ * @param frame   Receives its mux frame number (may be NULL)
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Copied
+ *   @retval HAL_BUSY  No frame complete yet
+ *   @retval HAL_ERROR NULL pointer
+ */
+HAL_StatusTypeDef adcMux_getLatest(uint16_t *samples, uint32_t *frame);
+
+/**
+ * @brief Code of one sensor in one frame of a block
+ *
+ * @param block  Block passed to the callback
+ * @param frame  0..frame_count - 1
+ * @param sensor 0..ADC_MUX_CHANNELS - 1
+ */
+static inline uint16_t adcMux_getSample(const AdcMux_Block_t *block,
+                                        uint32_t frame, uint8_t sensor) {
+  return block->frames[frame * ADC_MUX_CHANNELS + sensor];
+}
+
+/**
+ * @brief Get the counters
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer
+ */
+HAL_StatusTypeDef adcMux_getStats(AdcMux_Stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ADC_MUX_H */
@@ -0,0 +1,210 @@
+/**
+ ******************************************************************************
+ * @file    adc_range.h
+ * @brief   Automatic gain ranging on the LISXXXALH full-scale select pin
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * The LIS344ALH-class parts measure +-2 g with their FS pin low and +-6 g
+ * with it high, at a third of the sensitivity. Each tri-axis group
+ * (adc_calibration.h) gets its own FS line, and a hook in the DMA interrupt
+ * (analogSensor_setRangeHook()) picks the range from the group's peak
+ * deviation from zero g, block by block:
+ *
+ *   - +-2 g -> +-6 g: a sample at a rail, or a peak beyond ADC_RANGE_UP_MG,
+ *     switches at once
+ *   - +-6 g -> +-2 g: peaks below ADC_RANGE_DOWN_MG for ADC_RANGE_HOLD_MS
+ *     switch back; the gap between the two thresholds is the hysteresis
+ *
+ * The pin changes while the DMA converts the next block, so the first
+ * ADC_RANGE_SETTLE_US of frames from there on (the rest of the old range
+ * and the sensor output settling) are queued void: the group's channels in
+ * error_mask with ADC_SAMPLE_ERROR_SETTLING and ADC_RING_FLAG_SETTLING.
+ * Every ring entry carries the range of each group (ADC_RingEntry_t.range),
+ * and adcRange_convertEntry_q15() / adcRange_convertBlock_q15() give mg on
+ * one scale whatever the range, through the active calibration.
+ *
+ * Two ranges in one sensor stretch the dynamic range by the range ratio
+ * for the cost of a peak scan per block, where oversampling would take 9x
+ * the conversions for the same 1.6 bits.
+ *
+ * Usage Example:
+ *   const AdcRange_Config_t cfg = {.port = GPIOG,
+ *                                  .pins = {GPIO_PIN_4, GPIO_PIN_5}};
+ *   adcRange_init(&cfg);               // +-2 g, automatic
+ *   analogSensor_startTimedDMA(4000);
+ *
+ *   // main loop, per ring entry
+ *   int16_t mg[ADC_CONVERSIONS_CHANNEL_COUNT];
+ *   if (!(entry.flags & ADC_RING_FLAG_SETTLING)) {
+ *     adcRange_convertEntry_q15(&entry, mg);
+ *   }
+ *
+ * @note Codes read straight from the blocks or the ring change scale with
+ *       the range; the thresholds use the nominal sensitivity and the zero-g
+ *       offsets of the calibration active at adcRange_init(). The port's
+ *       clock must be running (MX_GPIO_Init()).
+ ******************************************************************************
+ */
+
+#ifndef ADC_RANGE_H
+#define ADC_RANGE_H
+
+#include "adc_calibration.h"
+#include "adc_ring.h"
+#include "stm32f7xx_hal.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+
+/**
+ * @brief Set to 1 when the FS pins are wired to GPIOs
+ */
+#ifndef ADC_RANGE_ENABLE
+#define ADC_RANGE_ENABLE 0
+#endif
+
+/**
+ * @brief Wide range over narrow in sensitivity (6 g / 2 g), q8
+ */
+#ifndef ADC_RANGE_WIDE_SCALE_Q8
+#define ADC_RANGE_WIDE_SCALE_Q8 768U
+#endif
+
+/**
+ * @brief Peak from zero g that switches a group up from +-2 g
+ */
+#ifndef ADC_RANGE_UP_MG
+#define ADC_RANGE_UP_MG 1800U
+#endif
+
+/**
+ * @brief Peaks below this for ADC_RANGE_HOLD_MS switch a group back down
+ */
+#ifndef ADC_RANGE_DOWN_MG
+#define ADC_RANGE_DOWN_MG 1200U
+#endif
+
+/**
+ * @brief Quiet time on +-6 g before switching down
+ */
+#ifndef ADC_RANGE_HOLD_MS
+#define ADC_RANGE_HOLD_MS 500U
+#endif
+
+/**
+ * @brief Frames voided after a switch, in time: 5 R_out C_load of the
+ *        sensor output (110 kOhm, 10 nF)
+ */
+#ifndef ADC_RANGE_SETTLE_US
+#define ADC_RANGE_SETTLE_US 5500U
+#endif
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief How the range is chosen
+ */
+typedef enum {
+  ADC_RANGE_AUTO = 0, ///< From the peaks
+  ADC_RANGE_NARROW,   ///< Fixed at +-2 g
+  ADC_RANGE_WIDE      ///< Fixed at +-6 g
+} AdcRange_Mode_t;
+
+/**
+ * @brief FS pins, one per group, on one port; high selects +-6 g
+ */
+typedef struct {
+  GPIO_TypeDef *port;
+  uint16_t pins[ADC_CAL_GROUP_COUNT]; ///< GPIO_PIN_x of group g
+} AdcRange_Config_t;
+
+/**
+ * @brief Switching statistics, since adcRange_init()
+ */
+typedef struct {
+  AdcRange_Mode_t mode;
+  uint8_t range;            ///< Bit g: group g on +-6 g
+  uint32_t switches_up;
+  uint32_t switches_down;
+  uint32_t settle_frames;   ///< Frames per switch voided at the current rate
+  uint32_t voided;          ///< Group frames voided
+  uint16_t peak_mg[ADC_CAL_GROUP_COUNT]; ///< Peak of the last block
+} AdcRange_Stats_t;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief Drive the FS pins to +-2 g and start ranging in the scan blocks
+ *
+ * @param cfg Pins (copied)
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Hook installed
+ *   @retval HAL_ERROR Built without ADC_RANGE_ENABLE, NULL pointer or no
+ *                     port
+ */
+HAL_StatusTypeDef adcRange_init(const AdcRange_Config_t *cfg);
+
+/**
+ * @brief Stop ranging: the hook removed, the pins back to +-2 g
+ */
+void adcRange_deinit(void);
+
+/**
+ * @brief Automatic or a fixed range, from the next block
+ */
+void adcRange_setMode(AdcRange_Mode_t mode);
+
+/**
+ * @brief Current mode
+ */
+AdcRange_Mode_t adcRange_getMode(void);
+
+/**
+ * @brief Groups on +-6 g, bit g = group g
+ */
+uint8_t adcRange_getRange(void);
+
+/**
+ * @brief One ring entry in mg, q15 (1 mg LSB), the same scale on either
+ *        range
+ *
+ * @param entry Ring entry
+ * @param out   ADC_CONVERSIONS_CHANNEL_COUNT results, channel order
+ */
+void adcRange_convertEntry_q15(const ADC_RingEntry_t *entry, int16_t *out);
+
+/**
+ * @brief adcCal_convertBlock_q15() for a block taken on the given ranges
+ *
+ * @param block       Raw frames
+ * @param frames      Number of frames
+ * @param channel_map Raw block slot -> channel (NULL = identity)
+ * @param range       Bit g: group g on +-6 g
+ * @param out         frames x ADC_CONVERSIONS_CHANNEL_COUNT results
+ */
+void adcRange_convertBlock_q15(const uint16_t *block, uint32_t frames,
+                               const uint8_t *channel_map, uint8_t range,
+                               int16_t *out);
+
+/**
+ * @brief Get the switching statistics
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer
+ */
+HAL_StatusTypeDef adcRange_getStats(AdcRange_Stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ADC_RANGE_H */
@@ -0,0 +1,122 @@
+/**
+ ******************************************************************************
+ * @file    adc_replay.h
+ * @brief   Virtual ADC: recorded waveforms fed through the block pipeline
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * Replays a recording in place of the ADCs, through the replay mode of
+ * adc_conversions.h: each block goes through the same hand-off as a DMA
+ * block, in the same interrupt, so the trigger, the DSP stages, the ring
+ * and the streams see deterministic input without knowing it. Paced, the
+ * blocks come at the scan rate; unpaced, each block follows as soon as the
+ * previous one has been handed off, which measures the DSP ceiling apart
+ * from the ADC.
+ *
+ * Inputs:
+ *   - Vector: an ADC_ReplayImage_t linked into the firmware as
+ *     adc_replay_image. The default is an empty weak definition; a strong
+ *     one from a generated C file replaces it. The vector can be played
+ *     several times over; the passes join without a gap.
+ *   - QSPI history: the newest pages of the black-box recorder
+ *     (qspi_recorder.h), oldest first.
+ *
+ * Recordings are in channel order and are laid out in the scan slot order
+ * of the current multimode on the way into the block. A replay plays whole
+ * blocks: a tail shorter than a block at the end is not played.
+ *
+ * Concurrency model: adcReplay_start() and the block source run in the main
+ * loop (analogSensor_pollReplay()); the hand-off runs in the DMA interrupt.
+ *
+ * Usage Example:
+ *   analogSensor_stopDMA();
+ *   adcReplay_start(ADC_REPLAY_VECTOR, 10, rate_hz, 0); // 10 passes, flat out
+ *
+ *   // main loop
+ *   analogSensor_pollReplay();
+ *   ADC_ReplayStats_t st;
+ *   analogSensor_getReplayStats(&st);
+ *   if (st.finished) {
+ *     // st.blocks * ADC_CONVERSIONS_BLOCK_FRAMES frames in st.elapsed_ticks
+ *     analogSensor_stopDMA();
+ *     analogSensor_startTimedDMA(rate_hz);
+ *   }
+ ******************************************************************************
+ */
+
+#ifndef ADC_REPLAY_H
+#define ADC_REPLAY_H
+
+#include "adc_conversions.h"
+#include "stm32f7xx_hal.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+
+#define ADC_REPLAY_MAGIC 0x594C5052U ///< "RPLY"
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief Where the replayed blocks come from
+ */
+typedef enum {
+  ADC_REPLAY_VECTOR = 0, ///< adc_replay_image, linked into the firmware
+  ADC_REPLAY_QSPI        ///< History pages of the QSPI recorder
+} ADC_ReplayInput_t;
+
+/**
+ * @brief Test vector in flash, little-endian
+ */
+typedef struct {
+  uint32_t magic;         ///< ADC_REPLAY_MAGIC
+  uint16_t channels;      ///< Samples per frame, ADC_CONVERSIONS_CHANNEL_COUNT
+  uint16_t reserved;
+  uint32_t frame_count;   ///< Frames in samples[]
+  uint32_t frame_rate_hz; ///< Rate it was recorded at, for reference
+  uint16_t samples[];     ///< Frames in channel order
+} ADC_ReplayImage_t;
+
+/* Exported variables --------------------------------------------------------*/
+
+/**
+ * @brief The linked test vector; weak and empty unless one is provided
+ */
+extern const ADC_ReplayImage_t adc_replay_image;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief Start replaying in place of the stopped acquisition
+ *
+ * @param input         Vector or QSPI history
+ * @param count         Vector: passes (0 = 1). QSPI: newest pages to play
+ *                      (0 = all that are recorded)
+ * @param frame_rate_hz Scan rate the replay reports and paces at
+ * @param paced         1 = at frame_rate_hz, 0 = as fast as possible
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Replaying; analogSensor_stopDMA() ends it
+ *   @retval HAL_BUSY  Acquisition running, stop it first
+ *   @retval HAL_ERROR No vector linked, channel count mismatch or recorder
+ *                     not ready
+ */
+HAL_StatusTypeDef adcReplay_start(ADC_ReplayInput_t input, uint32_t count,
+                                  uint32_t frame_rate_hz, uint8_t paced);
+
+/**
+ * @brief Whether a replay is running (the ADCs are not in use)
+ */
+uint8_t adcReplay_isActive(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ADC_REPLAY_H */
@@ -0,0 +1,329 @@
+/**
+ ******************************************************************************
+ * @file    adc_ring.h
+ * @brief   Lock-free single-producer/multi-consumer ring of ADC frames
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * Decouples acquisition from the consumers: the DMA block callback pushes
+ * timestamped frames, the main loop (or a task) pops them. A slow UART or SD
+ * write then delays only the consumer, and the high-water mark shows how much
+ * headroom is left before frames are lost.
+ *
+ * Concurrency model:
+ *   - Exactly one producer (ISR) and one consumer (thread) context per
+ *     cursor.
+ *   - The producer only writes head, a consumer only writes its cursor's
+ *     tail; both are free-running 32-bit counters, so every update is a
+ *     single aligned store.
+ *   - No interrupt masking: a data memory barrier orders the slot write
+ *     before the index publish.
+ *   - When full, the newest frame is dropped and counted (the consumer's
+ *     data is never overwritten under its feet).
+ *
+ * More consumers: every frame is written once and each consumer reads the
+ * same slots through its own cursor (adcRing_attach()), so a second
+ * stream costs a cursor, not a copy. A required consumer holds the
+ * producer back like the default one: the slowest required cursor sets how
+ * far the producer may get before it drops. An optional one never does;
+ * once the producer laps it, its next adcRing_peekFor() jumps to the
+ * newest half of the ring and raises its overrun flag, and
+ * adcRing_consumeFor() reports a span overwritten while it was lent. The
+ * default consumer (ADC_RING_DEFAULT_CONSUMER) is required and is the one
+ * adcRing_pop() / adcRing_peek() / adcRing_consume() read. Each cursor
+ * keeps its lag (frames behind the producer) and worst lag.
+ *
+ * Usage Example:
+ *   // Producer (DMA callback)
+ *   adcRing_push(&entry);
+ *
+ *   // Consumer (main loop)
+ *   ADC_RingEntry_t entry;
+ *   while (adcRing_pop(&entry) == HAL_OK) {
+ *     process(&entry);
+ *   }
+ *
+ *   // Or borrow the queued slots in place, a contiguous span at a time
+ *   const ADC_RingEntry_t *span;
+ *   uint32_t n;
+ *   while ((n = adcRing_peek(&span, ADC_RING_CAPACITY)) != 0U) {
+ *     process_many(span, n);
+ *     adcRing_consume(n);
+ *   }
+ *
+ *   // A second reader that may fall behind
+ *   uint8_t id;
+ *   adcRing_attach(0, &id);
+ *   while ((n = adcRing_peekFor(id, &span, ADC_RING_CAPACITY)) != 0U) {
+ *     if (adcRing_takeOverrun(id)) {
+ *       restart(); // frames were skipped
+ *     }
+ *     process_many(span, n);
+ *     adcRing_consumeFor(id, n);
+ *   }
+ *
+ * @note adcRing_attach() / adcRing_detach() belong to one thread context;
+ *       each cursor is read from one context only.
+ ******************************************************************************
+ */
+
+#ifndef ADC_RING_H
+#define ADC_RING_H
+
+#include "adc_conversions.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+
+/**
+ * @brief Ring capacity in frames (must be a power of two)
+ */
+#ifndef ADC_RING_CAPACITY
+#define ADC_RING_CAPACITY 1024U
+#endif
+
+/**
+ * @brief Cursors, the default consumer's included
+ */
+#ifndef ADC_RING_MAX_CONSUMERS
+#define ADC_RING_MAX_CONSUMERS 4U
+#endif
+
+/**
+ * @brief The cursor of adcRing_pop() / adcRing_peek() / adcRing_consume()
+ */
+#define ADC_RING_DEFAULT_CONSUMER 0U
+
+/**
+ * @brief Entry flags: first frame converted under a staged configuration
+ *        (analogSensor_stageConfig())
+ */
+#define ADC_RING_FLAG_CONFIG 0x01U
+
+/**
+ * @brief Entry flags: a sample of the frame is at or beyond a rail
+ *        (ADC_CLIP_LOW_CODE / ADC_CLIP_HIGH_CODE)
+ */
+#define ADC_RING_FLAG_CLIPPED 0x02U
+
+/**
+ * @brief Entry flags: first scan frame after a shock capture taken out of
+ *        the scan (analogSensor_switchToCapture()); its sequence number
+ *        skips the frames the capture took
+ */
+#define ADC_RING_FLAG_MODE 0x04U
+
+/**
+ * @brief Entry flags: samples of the frame are void, the sensor settling
+ *        after a range switch (error_mask has their channels)
+ */
+#define ADC_RING_FLAG_SETTLING 0x08U
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief One ring slot: a packed frame plus its sequence number and time
+ */
+typedef struct {
+  uint32_t sequence;  ///< Frame index since the acquisition started
+  uint32_t timestamp; ///< Capture time of the frame's block (HAL tick, ms)
+  ADC_Frame_t frame;  ///< Samples and error flags
+  uint8_t flags;      ///< ADC_RING_FLAG_x
+  uint8_t range;      ///< Bit g: sensor group g on its wide range
+} ADC_RingEntry_t;
+
+/**
+ * @brief Ring occupancy statistics
+ */
+typedef struct {
+  uint32_t count;      ///< Frames queued for the default consumer
+  uint32_t high_water; ///< Most frames held for the required consumers
+  uint32_t overflows;  ///< Frames dropped because the ring was full
+} ADC_RingStats_t;
+
+/**
+ * @brief One consumer's cursor statistics, since its attach or the reset
+ */
+typedef struct {
+  uint8_t active;    ///< Attached
+  uint8_t required;  ///< Holds the producer back
+  uint8_t overrun;   ///< Overrun flag, until adcRing_takeOverrun()
+  uint32_t lag;      ///< Frames behind the producer
+  uint32_t max_lag;  ///< Worst lag seen by adcRing_peekFor()
+  uint32_t overruns; ///< Times the producer lapped it
+  uint32_t lost;     ///< Frames skipped or overwritten under it
+} ADC_RingConsumerStats_t;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief Empty the ring and clear the statistics
+ *
+ * @note Call only while the producer is stopped; the consumers stay
+ *       attached
+ */
+void adcRing_reset(void);
+
+/**
+ * @brief Queue one frame (producer side)
+ *
+ * @param entry Frame to copy into the ring
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Frame queued
+ *   @retval HAL_ERROR Ring full, frame dropped and counted
+ */
+HAL_StatusTypeDef adcRing_push(const ADC_RingEntry_t *entry);
+
+/**
+ * @brief Dequeue the oldest frame (consumer side)
+ *
+ * @param entry Destination
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Frame copied out
+ *   @retval HAL_ERROR Ring empty or NULL pointer
+ */
+HAL_StatusTypeDef adcRing_pop(ADC_RingEntry_t *entry);
+
+/**
+ * @brief Dequeue up to max_entries of the oldest frames in one call
+ *        (consumer side)
+ *
+ * One index read, one copy per contiguous run (two across the wrap) and
+ * one index publish for the whole batch.
+ *
+ * @param entries     Destination, max_entries slots
+ * @param max_entries Most frames to take
+ *
+ * @return uint32_t Frames copied out (0 = ring empty or NULL pointer)
+ */
+uint32_t adcRing_popBulk(ADC_RingEntry_t *entries, uint32_t max_entries);
+
+/**
+ * @brief Lend the oldest queued frames without copying (consumer side)
+ *
+ * The span stops at the end of the slot array, so a second call after
+ * adcRing_consume() returns the frames past the wrap. The producer never
+ * writes a slot that is queued, so the span stays valid until it is
+ * consumed.
+ *
+ * @param span        Receives the first lent slot (unchanged if empty)
+ * @param max_entries Most frames to lend
+ *
+ * @return uint32_t Frames in the span (0 = ring empty or NULL pointer)
+ */
+uint32_t adcRing_peek(const ADC_RingEntry_t **span, uint32_t max_entries);
+
+/**
+ * @brief Hand lent frames back to the producer (consumer side)
+ *
+ * @param count Frames to release, at most the span last returned
+ */
+void adcRing_consume(uint32_t count);
+
+/**
+ * @brief Number of frames currently queued
+ *
+ * @return uint32_t Occupancy (0..ADC_RING_CAPACITY)
+ */
+uint32_t adcRing_count(void);
+
+/**
+ * @brief Add a consumer, its cursor at the newest frame
+ *
+ * @param required 1 to hold the producer back, 0 to be overrun instead
+ * @param id       Receives the cursor
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Attached
+ *   @retval HAL_BUSY  All ADC_RING_MAX_CONSUMERS cursors in use
+ *   @retval HAL_ERROR NULL pointer
+ */
+HAL_StatusTypeDef adcRing_attach(uint8_t required, uint8_t *id);
+
+/**
+ * @brief Remove a consumer (not the default one)
+ */
+void adcRing_detach(uint8_t id);
+
+/**
+ * @brief adcRing_peek() for one consumer's cursor
+ *
+ * An optional consumer the producer has lapped first jumps to the newest
+ * ADC_RING_CAPACITY / 2 frames: the skipped ones count as lost and the
+ * overrun flag is raised.
+ *
+ * @param id          Cursor
+ * @param span        Receives the first lent slot (unchanged if empty)
+ * @param max_entries Most frames to lend
+ *
+ * @return uint32_t Frames in the span (0 = none, NULL pointer or no cursor)
+ */
+uint32_t adcRing_peekFor(uint8_t id, const ADC_RingEntry_t **span,
+                         uint32_t max_entries);
+
+/**
+ * @brief adcRing_consume() for one consumer's cursor
+ *
+ * @param id    Cursor
+ * @param count Frames to release, at most the span last returned
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    The frames were read as written
+ *   @retval HAL_ERROR An optional consumer's span was overwritten while
+ *                     lent: the frames are lost, the overrun flag raised
+ */
+HAL_StatusTypeDef adcRing_consumeFor(uint8_t id, uint32_t count);
+
+/**
+ * @brief Check that the frames lent to a consumer are still intact
+ *
+ * @return uint8_t 1 until the producer laps an optional consumer's span
+ */
+uint8_t adcRing_intactFor(uint8_t id);
+
+/**
+ * @brief Frames a consumer is behind the producer
+ */
+uint32_t adcRing_countFor(uint8_t id);
+
+/**
+ * @brief Read and clear a consumer's overrun flag
+ *
+ * @return uint8_t 1 if frames were skipped since the last call
+ */
+uint8_t adcRing_takeOverrun(uint8_t id);
+
+/**
+ * @brief Get one consumer's cursor statistics
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer or id out of range
+ */
+HAL_StatusTypeDef adcRing_getConsumerStats(uint8_t id,
+                                           ADC_RingConsumerStats_t *stats);
+
+/**
+ * @brief Get occupancy statistics
+ *
+ * @param stats Destination
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer
+ */
+HAL_StatusTypeDef adcRing_getStats(ADC_RingStats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ADC_RING_H */
@@ -0,0 +1,340 @@
+/**
+ ******************************************************************************
+ * @file    adc_scan.hpp
+ * @brief   Header-only C++17 front-end: a regular scan described by its
+ *          type, with register images and buffer sizes worked out at
+ *          compile time
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * The C driver finds the SQR/SMPR bits of a channel in sConfig[] at run
+ * time (once, with ADC_CONVERSIONS_FAST_CONFIG). Here the scan is a type
+ * instead, and everything derived from it is a constant:
+ *
+ *   using Scan = adc::AdcScan<adc::Adc1, adc::Ch<0, adc::Smp15>,
+ *                             adc::Ch<1, adc::Smp15>, adc::Ch<4, adc::Smp84>>;
+ *
+ *   Scan::sqr3, Scan::smpr2 ...         register images, constexpr
+ *   Scan::Buffer<256>                   ping-pong DMA buffer, 32-byte aligned
+ *   Scan::dma_ndtr<256>, Scan::dma_cr   DMA stream set-up
+ *
+ * static_assert rejects at compile time what analogSensor_*() would catch
+ * at run time or not at all: more than 16 ranks, an input above 18, one
+ * input given two sampling times, a buffer half that does not span whole
+ * D-cache lines, or a transfer count beyond NDTR. Adc3 refuses IN4/IN5,
+ * which are not routed to it.
+ *
+ * The accessors are static inline functions of compile-time values, so
+ * Scan::apply() is a few read-modify-write stores and Scan::read<I>() the
+ * same two stores as analogSensor_loadChannel(), a start and the EOC poll.
+ * SettledCh<> picks the sampling time from the source impedance at a given
+ * ADCCLK, by the same settling condition as analogSensor_setChannelProfile().
+ *
+ * The C driver keeps ADC1 and the DMA stream it configures through HAL;
+ * use a Scan on an ADC the driver is not running (an instance-free ADC2 or
+ * ADC3, or ADC1 in firmware without adc_conversions.c). No RTTI, exceptions
+ * or heap: builds with the -fno-rtti -fno-exceptions of the toolchain file.
+ *
+ * Usage Example:
+ *   #include "adc_scan.hpp"
+ *   using Sensor = adc::SettledCh<3, 10000U, 12U, 27000000U>;  // IN3
+ *   using Scan = adc::AdcScan<adc::Adc2, adc::Ch<0, adc::Smp15>, Sensor>;
+ *
+ *   Scan::apply();                     // ranks and sampling times
+ *   uint16_t code;
+ *   if (Scan::read<1>(code, 2000U) == HAL_OK) {   // rank 2: IN3
+ *     ...
+ *   }
+ *
+ *   static Scan::Buffer<64> buffer;    // 2 x 64 frames
+ *   Scan::startDma(DMA2_Stream2, buffer);
+ ******************************************************************************
+ */
+
+#ifndef ADC_SCAN_HPP
+#define ADC_SCAN_HPP
+
+#include "adc_sections.h"
+#include "stm32f7xx_hal.h"
+#include <cstddef>
+#include <cstdint>
+
+namespace adc {
+
+/* Sampling times -------------------------------------------------------------*/
+
+/**
+ * @brief SMPx field value and length in ADCCLK cycles
+ */
+enum class SampleTime : uint32_t {
+  Cycles3 = ADC_SAMPLETIME_3CYCLES,
+  Cycles15 = ADC_SAMPLETIME_15CYCLES,
+  Cycles28 = ADC_SAMPLETIME_28CYCLES,
+  Cycles56 = ADC_SAMPLETIME_56CYCLES,
+  Cycles84 = ADC_SAMPLETIME_84CYCLES,
+  Cycles112 = ADC_SAMPLETIME_112CYCLES,
+  Cycles144 = ADC_SAMPLETIME_144CYCLES,
+  Cycles480 = ADC_SAMPLETIME_480CYCLES
+};
+
+constexpr SampleTime Smp3 = SampleTime::Cycles3;
+constexpr SampleTime Smp15 = SampleTime::Cycles15;
+constexpr SampleTime Smp28 = SampleTime::Cycles28;
+constexpr SampleTime Smp56 = SampleTime::Cycles56;
+constexpr SampleTime Smp84 = SampleTime::Cycles84;
+constexpr SampleTime Smp112 = SampleTime::Cycles112;
+constexpr SampleTime Smp144 = SampleTime::Cycles144;
+constexpr SampleTime Smp480 = SampleTime::Cycles480;
+
+constexpr uint32_t sampleCycles(SampleTime t) {
+  constexpr uint32_t cycles[] = {3U, 15U, 28U, 56U, 84U, 112U, 144U, 480U};
+  return cycles[static_cast<uint32_t>(t)];
+}
+
+/* ADCs -----------------------------------------------------------------------*/
+
+/**
+ * @brief ADC traits: registers, the inputs it is wired to, its DMA request
+ */
+struct Adc1 {
+  static ADC_TypeDef *regs() { return ADC1; }
+  static constexpr uint32_t inputs = 0x7FFFFU; ///< IN0..IN18
+  static constexpr uint32_t dma_channel = 0U;  ///< DMA2 Stream0/4
+};
+
+struct Adc2 {
+  static ADC_TypeDef *regs() { return ADC2; }
+  static constexpr uint32_t inputs = 0x0FFFFU; ///< IN0..IN15
+  static constexpr uint32_t dma_channel = 1U;  ///< DMA2 Stream2/3
+};
+
+struct Adc3 {
+  static ADC_TypeDef *regs() { return ADC3; }
+  static constexpr uint32_t inputs = 0x0FFCFU; ///< PA4/PA5 not routed
+  static constexpr uint32_t dma_channel = 2U;  ///< DMA2 Stream0/1
+};
+
+/* Channels -------------------------------------------------------------------*/
+
+/**
+ * @brief One rank: analog input IN<Input> with its sampling time
+ */
+template <uint32_t Input, SampleTime Smp> struct Ch {
+  static_assert(Input <= 18U, "ADC inputs are IN0..IN18");
+  static constexpr uint32_t input = Input;
+  static constexpr SampleTime smp = Smp;
+};
+
+/**
+ * @brief Shortest sampling time at AdcHz for a source of Ohms to settle to
+ *        Bits of accuracy
+ *
+ * k >= 0.5 + f_ADC * (R_AIN + R_ADC) * C_ADC * (N + 2) * ln 2, with
+ * R_ADC = 6 kOhm and C_ADC = 4 pF, as analogSensor_setChannelProfile().
+ */
+template <uint32_t Ohms, uint32_t Bits, uint32_t AdcHz>
+constexpr SampleTime settledSampleTime() {
+  static_assert(Bits >= 6U && Bits <= 12U, "accuracy is 6..12 bits");
+  constexpr double needed = 0.5 + static_cast<double>(AdcHz) *
+                                      (static_cast<double>(Ohms) + 6000.0) *
+                                      4.0e-12 * (Bits + 2U) * 0.69314718;
+  static_assert(needed <= 480.0, "source too slow for 480 cycles");
+  uint32_t t = 0;
+  while (sampleCycles(static_cast<SampleTime>(t)) < needed) {
+    t++;
+  }
+  return static_cast<SampleTime>(t);
+}
+
+template <uint32_t Input, uint32_t Ohms, uint32_t Bits, uint32_t AdcHz>
+using SettledCh = Ch<Input, settledSampleTime<Ohms, Bits, AdcHz>()>;
+
+/* Scan -----------------------------------------------------------------------*/
+
+/**
+ * @brief Regular scan of Adc over Chs..., rank 1 first
+ */
+template <class Adc, class... Chs> class AdcScan {
+public:
+  static constexpr size_t ranks = sizeof...(Chs);
+  static_assert(ranks >= 1U && ranks <= 16U, "1..16 regular ranks");
+
+  static constexpr uint32_t input[] = {Chs::input...};
+  static constexpr SampleTime smp[] = {Chs::smp...};
+
+private:
+  static constexpr bool wired() {
+    for (size_t r = 0; r < ranks; r++) {
+      if (!(Adc::inputs & (1UL << input[r]))) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  static constexpr bool consistent() {
+    for (size_t a = 0; a < ranks; a++) {
+      for (size_t b = a + 1U; b < ranks; b++) {
+        if (input[a] == input[b] && smp[a] != smp[b]) {
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+
+  static_assert(wired(), "input not routed to this ADC");
+  static_assert(consistent(), "one input, two sampling times");
+
+  // Sequence register n (1..3) from the ranks it holds
+  static constexpr uint32_t sqr(uint32_t first_rank, uint32_t last_rank) {
+    uint32_t image = 0;
+    for (size_t r = first_rank; r <= last_rank && r < ranks; r++) {
+      image |= input[r] << (5U * (r - first_rank));
+    }
+    return image;
+  }
+
+  // SMPR1 holds IN10..IN18, SMPR2 IN0..IN9
+  static constexpr uint32_t smprImage(bool high, bool mask) {
+    uint32_t image = 0;
+    for (size_t r = 0; r < ranks; r++) {
+      if ((input[r] >= 10U) != high) {
+        continue;
+      }
+      const uint32_t shift = 3U * (high ? input[r] - 10U : input[r]);
+      image |= (mask ? 0x7U : static_cast<uint32_t>(smp[r])) << shift;
+    }
+    return image;
+  }
+
+public:
+  /// Sequence registers: SQR3 ranks 1-6, SQR2 7-12, SQR1 13-16 and L
+  static constexpr uint32_t sqr3 = sqr(0U, 5U);
+  static constexpr uint32_t sqr2 = sqr(6U, 11U);
+  static constexpr uint32_t sqr1 =
+      sqr(12U, 15U) | ((ranks - 1U) << ADC_SQR1_L_Pos);
+
+  /// Sampling time fields of the scanned inputs, and the bits they replace
+  static constexpr uint32_t smpr1 = smprImage(true, false);
+  static constexpr uint32_t smpr1_mask = smprImage(true, true);
+  static constexpr uint32_t smpr2 = smprImage(false, false);
+  static constexpr uint32_t smpr2_mask = smprImage(false, true);
+
+  /// CR1.SCAN whenever more than one rank is converted
+  static constexpr uint32_t cr1_scan = (ranks > 1U) ? ADC_CR1_SCAN : 0U;
+
+  /**
+   * @brief Ping-pong DMA buffer of 2 x Frames scans, D-cache aligned
+   */
+  template <size_t Frames> struct Buffer {
+    static constexpr size_t frame_samples = Frames * ranks;
+    static_assert(Frames >= 1U, "at least one frame per half");
+    static_assert((frame_samples * sizeof(uint16_t)) % ADC_DCACHE_LINE_SIZE ==
+                      0U,
+                  "each half must span whole 32-byte D-cache lines");
+    static_assert(2U * frame_samples <= 0xFFFFU, "transfer count above NDTR");
+
+    alignas(ADC_DCACHE_LINE_SIZE) uint16_t data[2U * frame_samples];
+
+    uint16_t *half(size_t k) { return &data[k * frame_samples]; }
+  };
+
+  /// DMA transfers for a Buffer<Frames>: the whole ping-pong buffer
+  template <size_t Frames>
+  static constexpr uint32_t dma_ndtr =
+      static_cast<uint32_t>(2U * Buffer<Frames>::frame_samples);
+
+  /// Stream CR: peripheral to memory, half-words, circular, both halves
+  /// and errors interrupting, high priority
+  static constexpr uint32_t dma_cr =
+      (Adc::dma_channel << DMA_SxCR_CHSEL_Pos) | DMA_SxCR_PL_1 |
+      DMA_SxCR_MSIZE_0 | DMA_SxCR_PSIZE_0 | DMA_SxCR_MINC | DMA_SxCR_CIRC |
+      DMA_SxCR_HTIE | DMA_SxCR_TCIE | DMA_SxCR_TEIE;
+
+  /**
+   * @brief Load the sequence and sampling times (ADC may stay enabled,
+   *        no conversion running)
+   */
+  static inline void apply() {
+    ADC_TypeDef *adc = Adc::regs();
+    MODIFY_REG(adc->SMPR1, smpr1_mask, smpr1);
+    MODIFY_REG(adc->SMPR2, smpr2_mask, smpr2);
+    adc->SQR3 = sqr3;
+    adc->SQR2 = sqr2;
+    adc->SQR1 = sqr1;
+    MODIFY_REG(adc->CR1, ADC_CR1_SCAN, cr1_scan);
+  }
+
+  /**
+   * @brief Select rank I alone for a single conversion: two stores
+   *
+   * Needs apply() once for the sampling times.
+   */
+  template <size_t I> static inline void select() {
+    static_assert(I < ranks, "rank out of range");
+    ADC_TypeDef *adc = Adc::regs();
+    adc->SQR1 = 0U;
+    adc->SQR3 = input[I];
+  }
+
+  /**
+   * @brief Convert rank I once by software start (blocking)
+   *
+   * @param code           Receives the right-aligned result
+   * @param timeout_cycles EOC limit on DWT->CYCCNT, which must be running
+   *
+   * @return HAL_StatusTypeDef
+   *   @retval HAL_OK      code holds the result
+   *   @retval HAL_TIMEOUT No EOC within timeout_cycles
+   */
+  template <size_t I>
+  static inline HAL_StatusTypeDef read(uint16_t &code,
+                                       uint32_t timeout_cycles) {
+    ADC_TypeDef *adc = Adc::regs();
+    select<I>();
+    CLEAR_BIT(adc->CR2, ADC_CR2_CONT | ADC_CR2_EXTEN | ADC_CR2_DMA);
+    adc->SR = ~ADC_SR_EOC;
+    adc->CR2 |= ADC_CR2_ADON | ADC_CR2_SWSTART;
+    const uint32_t start = DWT->CYCCNT;
+    while (!(adc->SR & ADC_SR_EOC)) {
+      if (DWT->CYCCNT - start > timeout_cycles) {
+        return HAL_TIMEOUT;
+      }
+    }
+    code = static_cast<uint16_t>(adc->DR);
+    return HAL_OK;
+  }
+
+  /**
+   * @brief Stream the scan into a Buffer through a DMA2 stream of this
+   *        ADC's request, in circular mode (software or external trigger
+   *        as set in CR2)
+   *
+   * The stream's interrupts are left to the caller's handler.
+   */
+  template <size_t Frames>
+  static inline void startDma(DMA_Stream_TypeDef *stream,
+                              Buffer<Frames> &buffer) {
+    ADC_TypeDef *adc = Adc::regs();
+    CLEAR_BIT(stream->CR, DMA_SxCR_EN);
+    while (stream->CR & DMA_SxCR_EN) {
+    }
+    stream->PAR = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(&adc->DR));
+    stream->M0AR =
+        static_cast<uint32_t>(reinterpret_cast<uintptr_t>(buffer.data));
+    stream->NDTR = dma_ndtr<Frames>;
+    stream->FCR = 0U; // direct mode
+    stream->CR = dma_cr;
+    stream->CR |= DMA_SxCR_EN;
+
+    apply();
+    adc->CR2 |= ADC_CR2_DMA | ADC_CR2_DDS | ADC_CR2_ADON;
+  }
+};
+
+} // namespace adc
+
+#endif /* ADC_SCAN_HPP */
@@ -0,0 +1,126 @@
+/**
+ ******************************************************************************
+ * @file    adc_sections.h
+ * @brief   Memory placement macros for the acquisition and processing path
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * The STM32F746 has two tightly coupled memories next to the AXI/AHB SRAM:
+ *   - DTCM, 64 KB at 0x20000000: zero wait state data, not cached, still
+ *     reachable by the DMA controllers through the AHBS port.
+ *   - ITCM, 16 KB at 0x00000000: zero wait state code, independent of the
+ *     flash wait states and the ART accelerator.
+ * The SRAM itself is two slaves of the bus matrix, arbitrated separately:
+ *   - SRAM1, 240 KB at 0x20010000: .data, .bss, the heap and the
+ *     acquisition DMA buffers.
+ *   - SRAM2, 16 KB at 0x2004C000: the link DMA buffers alone.
+ *
+ * stm32f746zgtx_flash.ld provides matching output sections and
+ * startup_stm32f746xx.s initialises them before main():
+ *   - ADC_FAST_DATA: initialised data, copied from flash to DTCM
+ *   - ADC_FAST_BSS:  zero-initialised buffers in DTCM (no flash image)
+ *   - ADC_FAST_CODE: functions copied from flash to ITCM
+ *   - ADC_SRAM1_BSS: zero-initialised DMA buffers of the ADCs, the DAC and
+ *     the external ADC, grouped in SRAM1
+ *   - ADC_SRAM2_BSS: zero-initialised DMA buffers of the UART links, alone
+ *     in SRAM2
+ *   - ADC_NOINIT_BSS: SRAM1 the startup leaves alone, kept across a warm
+ *     reset (watchdog, fault, software reset)
+ *   - ADC_HOT_CODE:  functions kept in flash, grouped in .text.hot at the
+ *     start of .text next to the vendor ISR path (HAL_DMA_IRQHandler and
+ *     the ADC DMA callbacks, collected by name in the linker script)
+ *
+ * ITCM takes the per-sample inner loops, ISR bodies and kernels (16 KB).
+ * Code that runs often but not per sample (packet framing, CRC, COBS) goes
+ * to .text.hot instead: contiguous lines of the 16 KB I-cache, so it does
+ * not evict itself and pays the FLASH_LATENCY wait states once per line.
+ * Build with ADC_SECTIONS_ITCM=0 (CMake option ADC_ITCM=OFF) to put the
+ * ADC_FAST_CODE functions in .text.hot as well, e.g. to compare both or
+ * to debug with flash breakpoints. cmake/hot_sections.cmake lists from the
+ * map file where every tagged function ended up.
+ *
+ * The main stack is at the top of DTCM, so CPU state and interrupt frames
+ * never wait behind a DMA burst in the matrix. An ADC block DMA into SRAM1
+ * and a telemetry packet DMA out of SRAM2 run in parallel. The SD card
+ * ring (56 KB) is too large for SRAM2 and sits in .bss in SRAM1. The
+ * Ethernet descriptors and headers stay in DTCM, which needs no D-cache
+ * maintenance. The bench image measures the effect ("BENCH sram" lines,
+ * adc_bench.h).
+ *
+ * Usage Example:
+ *   static ADC_RingEntry_t ring_slots[1024] ADC_FAST_BSS;
+ *   static uint16_t dma_block[1536] ADC_SRAM1_BSS ADC_DMA_ALIGNED;
+ *   ADC_FAST_CODE void hot_function(void) { ... }
+ *
+ * @note DMA buffers written behind the D-cache should stay in SRAM and use
+ *       ADC_DMA_ALIGNED; DTCM is better kept for CPU working state.
+ ******************************************************************************
+ */
+
+#ifndef ADC_SECTIONS_H
+#define ADC_SECTIONS_H
+
+#include "cmsis_compiler.h"
+
+/**
+ * @brief Cortex-M7 D-cache line size in bytes
+ */
+#define ADC_DCACHE_LINE_SIZE 32U
+
+/**
+ * @brief Initialised variable placed in DTCM
+ */
+#define ADC_FAST_DATA __attribute__((section(".dtcm_data")))
+
+/**
+ * @brief Zero-initialised variable placed in DTCM
+ */
+#define ADC_FAST_BSS __attribute__((section(".dtcm_bss")))
+
+/**
+ * @brief Zero-initialised DMA buffer placed in SRAM1 (acquisition side)
+ */
+#define ADC_SRAM1_BSS __attribute__((section(".sram1_bss")))
+
+/**
+ * @brief Zero-initialised DMA buffer placed in SRAM2 (link side)
+ */
+#define ADC_SRAM2_BSS __attribute__((section(".sram2_bss")))
+
+/**
+ * @brief Variable placed in SRAM1 and never initialised: it keeps its value
+ *        across a warm reset (the D-cache must be cleaned behind writes)
+ */
+#define ADC_NOINIT_BSS __attribute__((section(".noinit")))
+
+/**
+ * @brief Set to 0 to keep ADC_FAST_CODE in flash (.text.hot)
+ */
+#ifndef ADC_SECTIONS_ITCM
+#define ADC_SECTIONS_ITCM 1
+#endif
+
+/**
+ * @brief Function executed from ITCM
+ * @note noinline keeps the body in ITCM instead of being copied into
+ *       flash-resident callers
+ */
+#if ADC_SECTIONS_ITCM
+#define ADC_FAST_CODE __attribute__((section(".itcm_text"), noinline))
+#else
+#define ADC_FAST_CODE __attribute__((section(".text.hot"), noinline))
+#endif
+
+/**
+ * @brief Frequently run function grouped with the hot code in flash
+ */
+#define ADC_HOT_CODE __attribute__((section(".text.hot")))
+
+/**
+ * @brief Alignment for buffers maintained with SCB_*DCache_by_Addr()
+ */
+#define ADC_DMA_ALIGNED __ALIGNED(ADC_DCACHE_LINE_SIZE)
+
+#endif /* ADC_SECTIONS_H */
@@ -0,0 +1,171 @@
+/**
+ ******************************************************************************
+ * @file    adc_supply.h
+ * @brief   VDDA and die temperature from the internal channels, with a
+ *          ratiometric gain correction of the sample blocks
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * The ADC converts against VREF+ = VDDA. When the sensors run from their
+ * own regulated rail, a drift of VDDA scales every code by 3300 / VDDA
+ * although the acceleration has not changed. VREFINT (1.21 V, factory
+ * converted at VDDA = 3.3 V) measures VDDA:
+ *
+ *   VDDA = 3300 mV * VREFINT_CAL / vrefint_code
+ *
+ * and each DMA block is multiplied by VDDA / nominal_mv in place
+ * (analogSensor_setBlockGain(), q14, two samples per word) before any
+ * consumer sees it. The die temperature comes from TS_CAL1 / TS_CAL2
+ * (30 / 110 degC at 3.3 V), after the same supply scaling.
+ *
+ * Every period_frames frames (1000 by default, 0.25 s at 4 kHz) one single
+ * injected conversion is started, alternately of the temperature sensor
+ * and of VREFINT: about 18 us in which the scan waits, 0.007 % of the
+ * conversion time. Both results are smoothed over 16 readings (8 s at the
+ * defaults), so the correction follows slow supply drift, not ripple.
+ * A VREFINT reading outside 1.7-3.6 V is discarded.
+ *
+ * With the sensors powered from VDDA itself the codes are already
+ * ratiometric: leave the correction off and use the module for monitoring.
+ * The correction scales the signal and its zero-g offset together, as a
+ * supply change does.
+ *
+ * Usage Example:
+ *   AdcSupply_Config_t cfg = {.period_frames = 0, .correct = 1};
+ *   adcSupply_init(&cfg);
+ *
+ *   // in the block callback (ISR)
+ *   adcSupply_processBlock(frame_count);
+ *
+ *   // anywhere
+ *   AdcSupply_Status_t st;
+ *   adcSupply_getStatus(&st);   // st.vdda_mv, st.temperature_c
+ *
+ * @note Build with ADC_SUPPLY_ENABLE=1 to run it from main.c and report it
+ *       in the status packets.
+ ******************************************************************************
+ */
+
+#ifndef ADC_SUPPLY_H
+#define ADC_SUPPLY_H
+
+#include "adc_conversions.h"
+#include "stm32f7xx_hal.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+
+/**
+ * @brief Set to 1 to sample VDDA and temperature from main.c
+ */
+#ifndef ADC_SUPPLY_ENABLE
+#define ADC_SUPPLY_ENABLE 0
+#endif
+
+/**
+ * @brief Default frames between two internal conversions
+ */
+#ifndef ADC_SUPPLY_PERIOD_FRAMES
+#define ADC_SUPPLY_PERIOD_FRAMES 1000U
+#endif
+
+/**
+ * @brief Smoothing: each reading moves the estimate by 1 / 2^shift
+ */
+#ifndef ADC_SUPPLY_SMOOTH_SHIFT
+#define ADC_SUPPLY_SMOOTH_SHIFT 4U
+#endif
+
+/**
+ * @brief VDDA of the factory calibration, and the default nominal supply
+ */
+#define ADC_SUPPLY_CAL_MV 3300U
+
+/**
+ * @brief Factory calibration words (system memory); overridable for hosts
+ *        without it
+ */
+#ifndef ADC_SUPPLY_VREFINT_CAL
+#define ADC_SUPPLY_VREFINT_CAL() (*VREFINT_CAL_ADDR_CMSIS)
+#endif
+#ifndef ADC_SUPPLY_TS_CAL1
+#define ADC_SUPPLY_TS_CAL1() (*TEMPSENSOR_CAL1_ADDR_CMSIS)
+#endif
+#ifndef ADC_SUPPLY_TS_CAL2
+#define ADC_SUPPLY_TS_CAL2() (*TEMPSENSOR_CAL2_ADDR_CMSIS)
+#endif
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief Module settings
+ */
+typedef struct {
+  uint32_t period_frames; ///< Frames between conversions, 0 = default
+  uint8_t correct;        ///< Apply the ratiometric gain to the blocks
+  uint16_t nominal_mv;    ///< VDDA the sensor scale refers to, 0 = 3300
+} AdcSupply_Config_t;
+
+/**
+ * @brief Latest estimates and counters
+ */
+typedef struct {
+  float vdda_mv;         ///< Smoothed VDDA, 0 before the first reading
+  float temperature_c;   ///< Smoothed die temperature, needs a VDDA first
+  uint16_t vrefint_code; ///< Newest raw VREFINT conversion
+  uint16_t ts_code;      ///< Newest raw temperature sensor conversion
+  uint16_t gain_q14;     ///< Gain applied to the blocks
+  uint32_t readings;     ///< Results accepted
+  uint32_t rejected;     ///< VREFINT results outside the VDDA range
+  uint32_t deferred;     ///< Starts put off: injected group busy
+} AdcSupply_Status_t;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief Configure the module and clear the estimates; the block gain is
+ *        reset to unity until the first VREFINT reading
+ *
+ * @param cfg Settings (NULL = defaults, correction off)
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR Blank VREFINT calibration word
+ */
+HAL_StatusTypeDef adcSupply_init(const AdcSupply_Config_t *cfg);
+
+/**
+ * @brief Count the frames of one block and start the next internal
+ *        conversion when due (block callback, ISR)
+ *
+ * @param frames Frames in the block
+ */
+void adcSupply_processBlock(uint32_t frames);
+
+/**
+ * @brief Switch the block correction on or off at runtime
+ *
+ * @param enable 0 = blocks left as converted
+ */
+void adcSupply_setCorrection(uint8_t enable);
+
+/**
+ * @brief Copy the latest estimates
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer
+ */
+HAL_StatusTypeDef adcSupply_getStatus(AdcSupply_Status_t *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ADC_SUPPLY_H */
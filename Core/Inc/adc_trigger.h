@@ -0,0 +1,483 @@
+/**
+ ******************************************************************************
+ * @file    adc_trigger.h
+ * @brief   Event trigger engine with pre-/post-trigger capture
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * Every DMA block is copied (in channel order) into a history ring of
+ * ADC_TRIGGER_HISTORY_FRAMES frames and checked against the armed channel
+ * conditions, in the block callback itself:
+ *   - LEVEL_ABOVE / LEVEL_BELOW: a sample crosses the threshold
+ *   - SLOPE: |x[n] - x[n - window]| reaches the threshold
+ *   - RMS: the AC RMS of a window of frames (non-overlapping) reaches the
+ *     threshold, compared in integers without a square root
+ *   - PEAK_TO_PEAK / RMS_SLIDING (DSP_WINDOW_ENABLE): max - min or the AC
+ *     RMS of the last window frames, judged at every frame, at a constant
+ *     cost per sample whatever the window (dsp_window.h). Up to
+ *     DSP_WINDOW_MAX_FRAMES, in DTCM; they wait for a full window.
+ *   - WATCHDOG: the ADC analog watchdog of a guarded channel raised an
+ *     alarm (adcTrigger_fire(), see analogSensor_configWatchdog()); the
+ *     block is then searched for the first sample outside the window
+ *   - MAGNITUDE_ABOVE / MAGNITUDE_BELOW, per sensor group (channels 0-2,
+ *     3-5): the vector length |code - zero g| of the three axes crosses
+ *     the threshold, compared squared in integers. Above catches a shock
+ *     in any direction, below a free fall. The event names the group's
+ *     first channel.
+ *   - EXPRESSION: a trigger expression (trigger_expr.h) over the block
+ *     statistics of any channels comes true, or has been true for its
+ *     hold; the event names the lowest channel it reads and its value is
+ *     the hold in ms. Judged per block, it fires at the block's first
+ *     frame, or at the frame the hold was reached.
+ * The first condition that fires fixes the trigger frame. Once post_frames
+ * more frames have arrived, [trigger - pre_frames, trigger + post_frames)
+ * is copied out of the history into the capture buffer and the engine
+ * stops until the capture is released, so the consumer can send it
+ * at link speed.
+ *
+ * State machine: IDLE -> ARMED -> TRIGGERED -> READY -> (arm) ARMED
+ *
+ * Snapshots: adcTrigger_pinSnapshot() pins the newest frames of the history
+ * where they are, for the consumer to send on demand, and the block
+ * callback writes around them: the rest of the ring keeps recording and
+ * the trigger keeps watching. The consumer releases the pinned frames as
+ * they go out, which gives their slots back. Should the writer still reach
+ * a pinned frame, the block is not recorded (pinned_frames) and the trigger
+ * does not see it; a capture it cuts is dropped (cut_captures).
+ *
+ * Packed history (ADC_TRIGGER_PACKED_ENABLE): the look-back also goes
+ * through the lossless sample codec (frame_pack.h) as each block is
+ * recorded, and the window is decoded only when adcTrigger_getCapture()
+ * first hands it out. The raw ring then only has to hold the block being
+ * judged, the slope and RMS windows and the snapshots, and the packed ring
+ * holds 2-3x the frames of a raw one its size. The builds' defaults:
+ *
+ *                      raw ring          packed ring   capture
+ *   raw history        2048 (28672 B)    -             1024 (14336 B)
+ *   packed history     512 (7168 B)      16384 B       2048 (28672 B)
+ *
+ * so a capture window twice as long for 23% more RAM. Noisy data packs
+ * worse (9 bytes a frame at the worst): when the ring runs short while the
+ * post-trigger frames come in, the capture gives up its oldest frames
+ * (trimmed_frames) rather than the event.
+ *
+ * Kept history (ADC_TRIGGER_RETAIN_ENABLE): the raw ring lives in the
+ * SRAM1 the startup never clears (ADC_NOINIT_BSS), and every block
+ * recorded is cleaned out of the D-cache and sealed: two copies of
+ * {magic, layout, newest frame, oldest frame, tick} under a CRC-32. After
+ * a watchdog, fault or software reset, adcTrigger_recoverHistory() finds a
+ * whole seal and pins the frames before the reset as a snapshot, less the
+ * oldest block's worth a torn write may have reached; the application
+ * sends them like any other before the ring moves on over them. A power-on
+ * or brown-out reset leaves no such thing to trust and clears the seals.
+ *
+ * Usage Example:
+ *   adcTrigger_init(256, 768);   // 64 ms before, 192 ms after at 4 kHz
+ *   ADC_TriggerConfig_t shock = {.condition = ADC_TRIGGER_SLOPE,
+ *                                .threshold = 400, .window = 4};
+ *   adcTrigger_configChannel(0, &shock);
+ *   ADC_TriggerConfig_t fall = {.condition = ADC_TRIGGER_MAGNITUDE_BELOW,
+ *                               .threshold = 245};  // 0.3 g at 819 codes/g
+ *   adcTrigger_configGroup(1, &fall);
+ *   adcTrigger_arm();
+ *
+ *   // in the block callback (ISR)
+ *   adcTrigger_process(block, frame_count, analogSensor_getBlockChannelMap());
+ *
+ *   // out-of-range alarms from the ADC watchdog, no per-sample test
+ *   analogSensor_configWatchdog(3, 205, 3890);
+ *   analogSensor_registerWatchdogCallback(adcTrigger_watchdogCallback, NULL);
+ *
+ *   // main loop
+ *   const ADC_TriggerEvent_t *event;
+ *   const ADC_Frame_t *frames;
+ *   if (adcTrigger_getCapture(&event, &frames) == HAL_OK) {
+ *     // send event->frame_count frames, then adcTrigger_arm()
+ *   }
+ *
+ *   // "what just happened": the last 100 ms, sent in place
+ *   ADC_TriggerSnapshot_t snap;
+ *   adcTrigger_pinSnapshot(400, &snap);
+ *   // ... send adcTrigger_getSnapshotFrame(snap.first_frame + i), then
+ *   adcTrigger_releaseSnapshot(snap.first_frame + sent);
+ *
+ ******************************************************************************
+ */
+
+#ifndef ADC_TRIGGER_H
+#define ADC_TRIGGER_H
+
+#include "adc_calibration.h"
+#include "adc_conversions.h"
+#include "trigger_expr.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+
+/**
+ * @brief Set to 1 to keep the look-back compressed (frame_pack.h)
+ */
+#ifndef ADC_TRIGGER_PACKED_ENABLE
+#define ADC_TRIGGER_PACKED_ENABLE 0
+#endif
+
+#if ADC_TRIGGER_PACKED_ENABLE
+
+/**
+ * @brief Largest pre + post window in frames
+ */
+#ifndef ADC_TRIGGER_CAPTURE_FRAMES
+#define ADC_TRIGGER_CAPTURE_FRAMES 2048U
+#endif
+
+/**
+ * @brief Raw ring in frames: power of two, at least two blocks (the one
+ *        being judged, and snapshots)
+ */
+#ifndef ADC_TRIGGER_HISTORY_FRAMES
+#define ADC_TRIGGER_HISTORY_FRAMES 512U
+#endif
+
+/**
+ * @brief Packed ring in bytes: a capture window at 5-6 bytes a frame
+ */
+#ifndef ADC_TRIGGER_PACKED_BYTES
+#define ADC_TRIGGER_PACKED_BYTES 16384U
+#endif
+
+/**
+ * @brief Longest snapshot in frames: the rest of the raw ring holds the
+ *        block being written
+ */
+#define ADC_TRIGGER_SNAPSHOT_MAX_FRAMES                                       \
+  (ADC_TRIGGER_HISTORY_FRAMES - ADC_CONVERSIONS_BLOCK_FRAMES)
+
+#else
+
+/**
+ * @brief Largest pre + post window in frames
+ */
+#ifndef ADC_TRIGGER_CAPTURE_FRAMES
+#define ADC_TRIGGER_CAPTURE_FRAMES 1024U
+#endif
+
+/**
+ * @brief History ring in frames: power of two, at least one capture plus
+ *        one block so the window is never overwritten before it is copied
+ */
+#ifndef ADC_TRIGGER_HISTORY_FRAMES
+#define ADC_TRIGGER_HISTORY_FRAMES 2048U
+#endif
+
+/**
+ * @brief Longest snapshot in frames: the rest of the history still holds a
+ *        capture window and the block being written
+ */
+#define ADC_TRIGGER_SNAPSHOT_MAX_FRAMES                                       \
+  (ADC_TRIGGER_HISTORY_FRAMES - ADC_TRIGGER_CAPTURE_FRAMES -                  \
+   ADC_CONVERSIONS_BLOCK_FRAMES)
+
+#endif /* ADC_TRIGGER_PACKED_ENABLE */
+
+/**
+ * @brief Set to 1 to keep the raw history across a warm reset
+ */
+#ifndef ADC_TRIGGER_RETAIN_ENABLE
+#define ADC_TRIGGER_RETAIN_ENABLE 0
+#endif
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief Per-channel trigger condition
+ */
+typedef enum {
+  ADC_TRIGGER_NONE = 0,    ///< Channel not watched
+  ADC_TRIGGER_LEVEL_ABOVE, ///< x >= threshold
+  ADC_TRIGGER_LEVEL_BELOW, ///< x <= threshold
+  ADC_TRIGGER_SLOPE,       ///< |x[n] - x[n - window]| >= threshold
+  ADC_TRIGGER_RMS,         ///< AC RMS over window frames >= threshold
+  ADC_TRIGGER_WATCHDOG,    ///< Analog watchdog alarm (adcTrigger_fire())
+  ADC_TRIGGER_MAGNITUDE_ABOVE, ///< Group |v| >= threshold
+  ADC_TRIGGER_MAGNITUDE_BELOW, ///< Group |v| <= threshold
+  ADC_TRIGGER_EXPRESSION,      ///< adcTrigger_setExpression()
+  ADC_TRIGGER_PEAK_TO_PEAK,    ///< max - min of the last window frames
+  ADC_TRIGGER_RMS_SLIDING      ///< AC RMS of the last window frames
+} ADC_TriggerCondition_t;
+
+/**
+ * @brief Condition settings of one channel
+ */
+typedef struct {
+  ADC_TriggerCondition_t condition;
+  uint16_t threshold; ///< Codes (level, slope, magnitude) or AC RMS codes
+  uint16_t window;    ///< Slope distance or RMS / sliding window, frames
+} ADC_TriggerConfig_t;
+
+/**
+ * @brief Engine state
+ */
+typedef enum {
+  ADC_TRIGGER_STATE_IDLE = 0, ///< Not armed
+  ADC_TRIGGER_STATE_ARMED,    ///< Watching the channels
+  ADC_TRIGGER_STATE_TRIGGERED,///< Collecting post-trigger frames
+  ADC_TRIGGER_STATE_READY     ///< Capture frozen, waiting for the consumer
+} ADC_TriggerState_t;
+
+/**
+ * @brief What fired and where the capture sits in the frame stream
+ */
+typedef struct {
+  uint8_t channel;                  ///< Channel, or group's first channel
+  ADC_TriggerCondition_t condition; ///< Its condition
+  uint16_t value; ///< Sample, slope, RMS or magnitude that fired
+  uint32_t trigger_frame;           ///< Frame number of the trigger
+  uint32_t first_frame;             ///< Frame number of capture frame 0
+  uint32_t timestamp;               ///< HAL tick of the trigger block or alarm
+  uint16_t pre_frames;              ///< Frames before the trigger
+  uint16_t frame_count;             ///< Frames in the capture
+} ADC_TriggerEvent_t;
+
+/**
+ * @brief Events the engine could not take
+ */
+typedef struct {
+  uint32_t missed_alarms; ///< Watchdog alarms while collecting or frozen
+  uint32_t blind_frames;  ///< Frames recorded, not watched: capture frozen
+  uint32_t pinned_frames; ///< Frames not recorded: a snapshot held the slots
+  uint32_t cut_captures;  ///< Captures dropped for those frames
+  uint32_t lookback_frames; ///< Frames the history reaches back now
+  uint32_t trimmed_frames;  ///< Pre-trigger frames a full packed ring took
+  uint32_t packed_bytes;    ///< Packed ring: bytes of the frames it holds
+} ADC_TriggerStats_t;
+
+/**
+ * @brief A pinned stretch of the history
+ */
+typedef struct {
+  uint32_t first_frame; ///< Frame number of the oldest frame
+  uint32_t frame_count; ///< Frames pinned
+  uint32_t timestamp;   ///< HAL tick when pinned (newest frame)
+} ADC_TriggerSnapshot_t;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief Reset the engine and set the capture window; all channels off
+ *
+ * @param pre_frames  Frames kept before the trigger
+ * @param post_frames Frames kept from the trigger on, >= 1
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success, state IDLE
+ *   @retval HAL_ERROR Window larger than ADC_TRIGGER_CAPTURE_FRAMES
+ */
+HAL_StatusTypeDef adcTrigger_init(uint16_t pre_frames, uint16_t post_frames);
+
+/**
+ * @brief Set the condition of one channel
+ *
+ * @param channel Channel index
+ * @param config  Condition, NULL = not watched
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_BUSY  Engine armed or triggered
+ *   @retval HAL_ERROR Invalid channel, window or condition (WATCHDOG is
+ *                     raised through adcTrigger_fire() only, EXPRESSION
+ *                     through adcTrigger_setExpression())
+ */
+HAL_StatusTypeDef adcTrigger_configChannel(uint8_t channel,
+                                           const ADC_TriggerConfig_t *config);
+
+/**
+ * @brief Set the vector condition of one sensor group
+ *
+ * The zero-g codes are taken from the active calibration table
+ * (adc_calibration.h) here: configure again after adcCal_setTable().
+ *
+ * @param group  Group index, 0..ADC_CAL_GROUP_COUNT - 1
+ * @param config MAGNITUDE_ABOVE or MAGNITUDE_BELOW (window unused), NULL =
+ *               not watched
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_BUSY  Engine armed or triggered
+ *   @retval HAL_ERROR Invalid group or condition
+ */
+HAL_StatusTypeDef adcTrigger_configGroup(uint8_t group,
+                                         const ADC_TriggerConfig_t *config);
+
+/**
+ * @brief Install a compiled trigger expression
+ *
+ * @param expr Expression, kept by reference and stepped in the block
+ *             callback; NULL = none
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_BUSY  Engine armed or triggered
+ *   @retval HAL_ERROR Empty expression
+ */
+HAL_StatusTypeDef adcTrigger_setExpression(TriggerExpr_t *expr);
+
+/**
+ * @brief Start watching, releasing any frozen capture
+ */
+void adcTrigger_arm(void);
+
+/**
+ * @brief Stop watching
+ */
+void adcTrigger_disarm(void);
+
+/**
+ * @brief Current engine state
+ */
+ADC_TriggerState_t adcTrigger_getState(void);
+
+/**
+ * @brief Record one block and evaluate the conditions on it
+ *
+ * @param block       Raw frames
+ * @param frames      Number of frames (<= ADC_TRIGGER_HISTORY_FRAMES -
+ *                    ADC_TRIGGER_CAPTURE_FRAMES; with the packed history,
+ *                    <= ADC_CONVERSIONS_BLOCK_FRAMES)
+ * @param channel_map Raw block slot -> channel (NULL = identity)
+ *
+ * @note Call from the block callback, for every block
+ */
+void adcTrigger_process(const uint16_t *block, uint32_t frames,
+                        const uint8_t *channel_map);
+
+/**
+ * @brief ADC_BlockCallback_t adapter, ctx is the channel map (may be NULL)
+ */
+void adcTrigger_blockCallback(const uint16_t *block, uint32_t frame_count,
+                              void *ctx);
+
+/**
+ * @brief Raise an external alarm on a channel
+ *
+ * Resolved by the next adcTrigger_process(): the trigger frame is the first
+ * frame of that block whose sample lies outside [low, high] (frame 0 if
+ * none does), reported as ADC_TRIGGER_WATCHDOG with the alarm's timestamp.
+ * Ignored unless the engine is armed.
+ *
+ * @param channel   Channel that raised the alarm
+ * @param low       Low threshold of its window (codes)
+ * @param high      High threshold of its window (codes)
+ * @param timestamp Time of the alarm (HAL tick)
+ *
+ * @note Call from an interrupt that cannot preempt the block callback or
+ *       be preempted by it (the ADC and DMA interrupts share priority 0)
+ */
+void adcTrigger_fire(uint8_t channel, uint16_t low, uint16_t high,
+                     uint32_t timestamp);
+
+/**
+ * @brief ADC_WatchdogCallback_t adapter, ctx unused
+ */
+void adcTrigger_watchdogCallback(uint8_t channel, uint16_t low, uint16_t high,
+                                 uint32_t timestamp, void *ctx);
+
+/**
+ * @brief Dead-time counters since adcTrigger_init()
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer
+ */
+HAL_StatusTypeDef adcTrigger_getStats(ADC_TriggerStats_t *stats);
+
+/**
+ * @brief Get the frozen capture
+ *
+ * @param event  Receives the event description
+ * @param frames Receives event->frame_count frames in channel order
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Capture ready, valid until the next adcTrigger_arm()
+ *   @retval HAL_BUSY  No capture yet
+ *   @retval HAL_ERROR NULL pointer, or a packed window that failed to
+ *                     decode (the engine is then re-armed)
+ *
+ * @note Main loop only: with the packed history, the first call after the
+ *       capture froze decodes it
+ */
+HAL_StatusTypeDef adcTrigger_getCapture(const ADC_TriggerEvent_t **event,
+                                        const ADC_Frame_t **frames);
+
+/**
+ * @brief Pin the newest frames of the history, without copying them
+ *
+ * @param frames Frames to pin, 1..ADC_TRIGGER_SNAPSHOT_MAX_FRAMES; fewer are
+ *               pinned when the history does not reach back that far
+ * @param snap   Receives the pinned stretch
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Pinned until released
+ *   @retval HAL_BUSY  A snapshot is already pinned
+ *   @retval HAL_ERROR NULL pointer, bad length or an empty history
+ *
+ * @note Main loop only
+ */
+HAL_StatusTypeDef adcTrigger_pinSnapshot(uint32_t frames,
+                                         ADC_TriggerSnapshot_t *snap);
+
+/**
+ * @brief One frame of the pinned snapshot, in place
+ *
+ * @return The frame, NULL outside the part still pinned
+ */
+const ADC_Frame_t *adcTrigger_getSnapshotFrame(uint32_t frame);
+
+/**
+ * @brief Give back the pinned frames before a frame number; the snapshot
+ *        ends when none are left
+ *
+ * @param next_frame First frame still wanted (snap.first_frame + sent)
+ */
+void adcTrigger_releaseSnapshot(uint32_t next_frame);
+
+/**
+ * @brief Drop the snapshot, whatever is left of it
+ */
+void adcTrigger_unpinSnapshot(void);
+
+/**
+ * @brief A snapshot is pinned
+ */
+uint8_t adcTrigger_isPinned(void);
+
+/**
+ * @brief Pin the history kept from before the reset as a snapshot
+ *
+ * @param warm Nonzero after a reset that kept SRAM (watchdog, fault,
+ *             software); zero clears what is left
+ * @param snap Receives the pinned stretch; its timestamp is the HAL tick
+ *             of the newest block before the reset
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Pinned until released. The snapshot has numbers of
+ *                     its own; this boot's frames still count from 0, in
+ *                     the slots after the kept ones
+ *   @retval HAL_ERROR Built without ADC_TRIGGER_RETAIN_ENABLE, NULL pointer,
+ *                     a cold reset or no whole seal
+ *
+ * @note At boot, after adcTrigger_init() and before the scan starts
+ */
+HAL_StatusTypeDef adcTrigger_recoverHistory(uint8_t warm,
+                                            ADC_TriggerSnapshot_t *snap);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ADC_TRIGGER_H */
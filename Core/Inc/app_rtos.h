@@ -0,0 +1,227 @@
+/**
+ ******************************************************************************
+ * @file    app_rtos.h
+ * @brief   CMSIS-RTOS2 build: acquisition, DSP and comms tasks
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * The superloop runs every stage in turn, so a slow one (a spectrum poll,
+ * a full TX queue) delays all the others. With APP_RTOS_ENABLE=1 the same
+ * stages run in three CMSIS-RTOS2 tasks instead, by priority:
+ *
+ *   acquisition (osPriorityRealtime)     every block, straight after its
+ *                                        DMA half: trigger, recorders
+ *   DSP         (osPriorityAboveNormal)  filters and spectra; blocks queue
+ *                                        up while the task is busy
+ *   comms       (osPriorityNormal)       telemetry, USB, commands, reports;
+ *                                        at least every APP_RTOS_COMMS_PERIOD_MS
+ *
+ * The ADC DMA interrupt runs at priority 0, above
+ * configMAX_SYSCALL_INTERRUPT_PRIORITY, and must not call the kernel. Its
+ * block callback only stores the block in a two-entry ring (one entry per
+ * DMA half) and pends APP_RTOS_NOTIFY_IRQn, a spare vector at a kernel-aware
+ * priority. That handler sets the acquisition task's thread flag.
+ *
+ * With the block pool enabled, the ring entry holds a reference to its
+ * block until the DSP task is done with it, so a slow DSP pass never reads
+ * samples the DMA has refilled. The DSP queue is then APP_RTOS_DSP_DEPTH
+ * pool blocks deep: a long DSP pass is caught up afterwards instead of
+ * dropping blocks, until the pool runs dry. A ping-pong half (pool off or
+ * starved) is only refilled one block later, so it is queued only behind
+ * nothing and dropped otherwise.
+ *
+ * Packets built in the DSP task are filled in place in a pool buffer and
+ * handed to the comms task by pointer; only the comms task calls
+ * telemetry_send(). The pool is a static array of APP_RTOS_PACKET_COUNT
+ * buffers whose free ones wait in a queue.
+ *
+ * Nothing comes from a heap: the task stacks and control blocks, the
+ * queues, the packet buffers and the kernel's idle and timer tasks are
+ * static arrays (configSUPPORT_DYNAMIC_ALLOCATION is 0, no heap_x.c), so
+ * they show in the map file and in the memory budget (mem_budget.h).
+ * uxTaskGetStackHighWaterMark() gives each task's stack margin.
+ *
+ * The idle task sleeps through cpuLoad_idle(), so the CPU load figures keep
+ * their meaning. SysTick drives the kernel tick (1 kHz); the HAL tick comes
+ * from TIM5 (timebase.h) unless TIMEBASE_HAL_TICK is 0.
+ *
+ * Usage Example:
+ *   // after the peripherals and analogSensor_startTimedDMA()
+ *   const AppRtos_Hooks_t hooks = {.acquire = App_AcquireBlock,
+ *                                  .process = App_ProcessBlock,
+ *                                  .service = App_Service};
+ *   appRtos_start(&hooks);            // does not return
+ *
+ *   // DSP task
+ *   uint8_t *buf = appRtos_reservePacket();
+ *   if (buf != NULL) {
+ *     appRtos_commitPacket(buf, encode(buf), TELEMETRY_CLASS_CONTROL);
+ *   }
+ *
+ * @note Needs a FreeRTOS kernel with its CMSIS_RTOS_V2 wrapper; the
+ *       APP_RTOS CMake option takes its path in FREERTOS_DIR.
+ ******************************************************************************
+ */
+
+#ifndef APP_RTOS_H
+#define APP_RTOS_H
+
+#include "irq_priority.h"
+#include "stm32f7xx_hal.h"
+#include "telemetry.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+
+/**
+ * @brief Set to 1 (CMake option APP_RTOS) to run main.c as RTOS tasks
+ *        instead of the superloop
+ */
+#ifndef APP_RTOS_ENABLE
+#define APP_RTOS_ENABLE 0
+#endif
+
+/**
+ * @brief Spare vector that moves the block notification down to a
+ *        kernel-aware priority (SPDIF-RX is not used on this board)
+ */
+#ifndef APP_RTOS_NOTIFY_IRQn
+#define APP_RTOS_NOTIFY_IRQn SPDIF_RX_IRQn
+#endif
+
+/**
+ * @brief Priority of the notification; numerically >= the FreeRTOSConfig.h
+ *        configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY
+ */
+#ifndef APP_RTOS_NOTIFY_PRIORITY
+#define APP_RTOS_NOTIFY_PRIORITY IRQ_PRIORITY_COMMS
+#endif
+
+/**
+ * @brief Longest comms task sleep when no packet arrives
+ */
+#ifndef APP_RTOS_COMMS_PERIOD_MS
+#define APP_RTOS_COMMS_PERIOD_MS 1U
+#endif
+
+/**
+ * @brief Packet buffers between the DSP and comms tasks
+ */
+#ifndef APP_RTOS_PACKET_COUNT
+#define APP_RTOS_PACKET_COUNT 8U
+#endif
+
+/**
+ * @brief Pool blocks the DSP task may owe; the DMA owns two more of the
+ *        BLOCK_POOL_COUNT
+ */
+#ifndef APP_RTOS_DSP_DEPTH
+#define APP_RTOS_DSP_DEPTH 4U
+#endif
+
+/**
+ * @brief Task stacks
+ */
+#ifndef APP_RTOS_ACQ_STACK_BYTES
+#define APP_RTOS_ACQ_STACK_BYTES 1024U
+#endif
+#ifndef APP_RTOS_DSP_STACK_BYTES
+#define APP_RTOS_DSP_STACK_BYTES 2048U
+#endif
+#ifndef APP_RTOS_COMMS_STACK_BYTES
+#define APP_RTOS_COMMS_STACK_BYTES 4096U
+#endif
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief Stage run on every block
+ *
+ * @param block       Interleaved frames (see ADC_BlockCallback_t)
+ * @param frame_count Frames in block
+ */
+typedef void (*AppRtos_BlockHook_t)(const uint16_t *block,
+                                    uint32_t frame_count);
+
+/**
+ * @brief Application stages, one per task
+ */
+typedef struct {
+  AppRtos_BlockHook_t acquire; ///< Acquisition task, may be NULL
+  AppRtos_BlockHook_t process; ///< DSP task, may be NULL
+  void (*service)(void);       ///< Comms task, after the packets; may be NULL
+} AppRtos_Hooks_t;
+
+/**
+ * @brief Task statistics
+ */
+typedef struct {
+  uint32_t blocks;         ///< Blocks taken by the acquisition task
+  uint32_t dropped;        ///< Blocks the DSP task (or acquisition) missed
+  uint32_t late;           ///< Blocks the DMA refilled before DSP finished
+                           ///< (ping-pong buffer only)
+  uint32_t packet_drops;   ///< Packets not sent: pool empty or queue full
+  uint32_t latency_max_us; ///< Longest DMA half -> DSP task start
+  uint32_t backlog_max;    ///< Most blocks queued for the DSP task
+  uint32_t acq_stack_free;   ///< Least stack left, bytes (high-water mark)
+  uint32_t dsp_stack_free;   ///< Least stack left, bytes
+  uint32_t comms_stack_free; ///< Least stack left, bytes
+} AppRtos_Stats_t;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief Create the tasks, queues and packet pool, take over the block
+ *        callback and start the kernel
+ *
+ * @param hooks Stages; copied
+ *
+ * @return HAL_StatusTypeDef, only on failure (the kernel does not return)
+ *   @retval HAL_ERROR hooks is NULL, or a kernel object could not be created
+ */
+HAL_StatusTypeDef appRtos_start(const AppRtos_Hooks_t *hooks);
+
+/**
+ * @brief Take a packet buffer of TELEMETRY_FRAME_ENCODED_MAX bytes
+ *
+ * @return uint8_t* Buffer, or NULL (counted) when all are in flight
+ *
+ * @note Any task; never blocks
+ */
+uint8_t *appRtos_reservePacket(void);
+
+/**
+ * @brief Queue a reserved buffer for the comms task, which sends and
+ *        frees it
+ *
+ * @param buf Buffer from appRtos_reservePacket()
+ * @param len Encoded length; 0 releases the buffer unsent
+ * @param cls Telemetry priority class it is sent in
+ */
+void appRtos_commitPacket(uint8_t *buf, uint16_t len, Telemetry_Class_t cls);
+
+/**
+ * @brief Copy the statistics
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    stats filled
+ *   @retval HAL_ERROR stats is NULL
+ */
+HAL_StatusTypeDef appRtos_getStats(AppRtos_Stats_t *stats);
+
+/**
+ * @brief Block notification; call from the APP_RTOS_NOTIFY_IRQn handler
+ */
+void appRtos_notifyIrqHandler(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* APP_RTOS_H */
@@ -0,0 +1,133 @@
+/**
+ ******************************************************************************
+ * @file    app_sched.h
+ * @brief   Run-to-completion scheduler of the bare-metal main loop: event
+ *          flags and software timers
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * The superloop used to run every stage after every wake-up, whatever woke
+ * it, and decided on the report period itself. Here each task of a table
+ * says what makes it ready: event flags the interrupts raise, a period, or
+ * both. appSched_run() takes the pending flags at once and runs every ready
+ * task to completion in table order; appSched_idle() sleeps until the next
+ * flag or the next timer (a TIM5 alarm, timebase_wakeAt()).
+ *
+ *   APP_SCHED_EVENT_BLOCK    ADC or SPI ADC block handed over (ISR)
+ *   APP_SCHED_EVENT_TX_DONE  telemetry UART transfer finished (ISR)
+ *   APP_SCHED_EVENT_COMMAND  bytes on the command UART or USB (ISR)
+ *   APP_SCHED_EVENT_WAKE     appSched_idle() returned, whatever ended it
+ *
+ * No stacks, no context switches, no kernel RAM: a task is a function that
+ * returns, and a busy one delays the others as in the superloop, so the
+ * table order is the priority. Interrupts that raise no flag still end the
+ * sleep and raise WAKE, so a task on WAKE sees every wake-up as before.
+ *
+ * Usage Example:
+ *   static const AppSched_Task_t tasks[] = {
+ *       {"pipeline", App_Pipeline, APP_SCHED_EVENT_BLOCK, 0U},
+ *       {"report", App_Report, 0U, 100U}};
+ *   appSched_init(tasks, 2U);
+ *
+ *   appSched_signal(APP_SCHED_EVENT_BLOCK);   // from the DMA interrupt
+ *
+ *   while (1) {
+ *     appSched_run();
+ *     appSched_idle();
+ *   }
+ *
+ * @note The RTOS build (app_rtos.h) keeps its tasks; the flags are then
+ *       raised and never taken.
+ ******************************************************************************
+ */
+
+#ifndef APP_SCHED_H
+#define APP_SCHED_H
+
+#include "stm32f7xx_hal.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+
+/**
+ * @brief Set to 0 for the plain superloop (every stage after every wake-up)
+ */
+#ifndef APP_SCHED_ENABLE
+#define APP_SCHED_ENABLE 1
+#endif
+
+/**
+ * @brief Tasks a table may hold
+ */
+#ifndef APP_SCHED_MAX_TASKS
+#define APP_SCHED_MAX_TASKS 8U
+#endif
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief Event flags, raised from any context
+ */
+typedef enum {
+  APP_SCHED_EVENT_BLOCK = 1U << 0,   ///< ADC or SPI ADC block handed over
+  APP_SCHED_EVENT_TX_DONE = 1U << 1, ///< Telemetry UART transfer finished
+  APP_SCHED_EVENT_COMMAND = 1U << 2, ///< Command bytes received
+  APP_SCHED_EVENT_WAKE = 1U << 3,    ///< The idle sleep ended
+  APP_SCHED_EVENT_ALL = 0xFU
+} AppSched_Event_t;
+
+/**
+ * @brief One task of the table
+ */
+typedef struct {
+  const char *name;   ///< For the debugger
+  void (*run)(void);  ///< Runs to completion
+  uint32_t events;    ///< AppSched_Event_t flags that make it ready
+  uint32_t period_ms; ///< Also ready this often (0 = events only)
+} AppSched_Task_t;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief Take a task table; the timers start now
+ *
+ * @param tasks Table, in priority order (kept, not copied)
+ * @param count Entries
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Ready
+ *   @retval HAL_ERROR NULL table or task, no trigger, or over
+ *                     APP_SCHED_MAX_TASKS
+ */
+HAL_StatusTypeDef appSched_init(const AppSched_Task_t *tasks, uint32_t count);
+
+/**
+ * @brief Raise event flags (interrupt-safe, any priority)
+ */
+void appSched_signal(uint32_t events);
+
+/**
+ * @brief Take the pending flags and run every ready task once, in table
+ *        order
+ *
+ * @return Tasks run
+ */
+uint32_t appSched_run(void);
+
+/**
+ * @brief Sleep in cpuLoad_idle() unless a flag is pending, with a TIM5
+ *        alarm at the next timer; raises APP_SCHED_EVENT_WAKE
+ */
+void appSched_idle(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* APP_SCHED_H */
@@ -0,0 +1,145 @@
+/**
+ ******************************************************************************
+ * @file    block_pool.h
+ * @brief   Fixed pool of reference-counted ADC block buffers
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * With the pool enabled (analogSensor_setBlockPool()), the ADC DMA runs in
+ * double-buffer mode and writes straight into pool blocks. At each
+ * completion the filled block is handed to the block callback and a free
+ * one is swapped into the DMA target, so no stage copies samples to keep
+ * them:
+ *
+ *   DMA fills block -> swapped out (DMA holds 1 reference)
+ *     -> block callback: a stage that needs the block later retains it
+ *     -> the DMA interrupt drops its reference
+ *     -> each stage releases when done, e.g. on TX-complete
+ *     -> last release returns the block to the pool
+ *
+ * A block that nobody retained is free again as soon as the callback
+ * returns. Freed blocks are reused oldest first, so a block that is not
+ * retained still stays intact for at least one block period, as before.
+ *
+ * There is no malloc: the arena is a static array in SRAM, aligned to
+ * D-cache lines for the DMA (adc_sections.h). All functions are safe from
+ * thread and interrupt context; the count updates mask interrupts for a
+ * few cycles.
+ *
+ * Usage Example:
+ *   // block callback (DMA ISR)
+ *   BlockPool_Block_t *blk = blockPool_fromData(block);
+ *   if (blk != NULL) {
+ *     blockPool_retain(blk);          // keep it past this callback
+ *     queue_for_tx(blk);
+ *   }
+ *
+ *   // TX-complete
+ *   blockPool_release(blk);
+ *
+ * @note Samples are read-only for every holder: several stages may share
+ *       one block.
+ ******************************************************************************
+ */
+
+#ifndef BLOCK_POOL_H
+#define BLOCK_POOL_H
+
+#include "adc_conversions.h"
+#include "stm32f7xx_hal.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+
+/**
+ * @brief Blocks in the arena: two owned by the DMA, the rest in flight
+ *        through the stages (3 kB each at the default block size)
+ */
+#ifndef BLOCK_POOL_COUNT
+#define BLOCK_POOL_COUNT 8U
+#endif
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief Handle of one pool block
+ */
+typedef struct {
+  const uint16_t *data; ///< ADC_CONVERSIONS_BLOCK_SAMPLES interleaved samples
+  ADC_BlockInfo_t info; ///< Position and time, set when the DMA filled it
+  volatile uint8_t refs; ///< Holders; use retain/release only
+  uint8_t index;         ///< Position in the arena
+} BlockPool_Block_t;
+
+/**
+ * @brief Pool statistics
+ */
+typedef struct {
+  uint32_t allocs;     ///< Blocks handed out
+  uint32_t failures;   ///< Allocations with no free block
+  uint32_t in_use;     ///< Blocks currently held
+  uint32_t high_water; ///< Most blocks held at once
+} BlockPool_Stats_t;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief Return every block to the pool and clear the statistics
+ *
+ * @note Once, before the first scan (analogSensor_setBlockPool()): a stage
+ *       may hold blocks past a stop, so a restart must not reset them
+ */
+void blockPool_init(void);
+
+/**
+ * @brief Take a free block, with one reference
+ *
+ * @return BlockPool_Block_t* Block, or NULL (counted) if all are held
+ */
+BlockPool_Block_t *blockPool_alloc(void);
+
+/**
+ * @brief Add a reference
+ */
+void blockPool_retain(BlockPool_Block_t *block);
+
+/**
+ * @brief Drop a reference; the last one returns the block to the pool
+ */
+void blockPool_release(BlockPool_Block_t *block);
+
+/**
+ * @brief Handle of the pool block holding these samples
+ *
+ * @param data Start of a block, e.g. as given to the block callback
+ *
+ * @return BlockPool_Block_t* Handle, or NULL if data is not a pool block
+ *         (pool disabled, or the DMA fell back to its own buffer)
+ */
+BlockPool_Block_t *blockPool_fromData(const uint16_t *data);
+
+/**
+ * @brief Writable samples of a block, for the DMA only
+ */
+uint16_t *blockPool_dmaTarget(BlockPool_Block_t *block);
+
+/**
+ * @brief Copy the statistics
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    stats filled
+ *   @retval HAL_ERROR stats is NULL
+ */
+HAL_StatusTypeDef blockPool_getStats(BlockPool_Stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BLOCK_POOL_H */
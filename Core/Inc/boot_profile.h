@@ -0,0 +1,153 @@
+/**
+ ******************************************************************************
+ * @file    boot_profile.h
+ * @brief   DWT timestamps of the init phases from reset to the first sample,
+ *          and the fast-start switch of main()
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * A duty-cycled node pays the whole boot on every wake, so the time to the
+ * first valid sample is part of its energy per measurement. With
+ * BOOT_PROFILE_ENABLE=1, bootProfile_start() enables the cycle counter at
+ * the top of main() and every bootProfile_mark() closes one phase:
+ *
+ *   MPU, caches + HAL_Init -> PLL + overdrive -> clock profile -> timebase
+ *   -> MX_*_Init -> ADC set-up -> scan start to first sample -> comms
+ *   -> storage -> DSP -> first block   (BOOT_FAST_START order)
+ *
+ * A phase is converted to microseconds at the core clock in force when it
+ * began, so the PLL lock is counted at 16 MHz HSI, at which it runs. Time
+ * before main() (vector table, .data/.bss, SystemInit) is not included.
+ * The report is one "BOOT" telemetry line per phase, queued once the first
+ * block has been marked and again on each bootProfile_dump().
+ *
+ * With BOOT_FAST_START=1, main() starts the timer-paced DMA scan right
+ * after the ADC set-up and only then brings up the UART telemetry, USB,
+ * Ethernet, SD card, QSPI recorder and DSP state, of which the SD card
+ * and the Ethernet PHY wait on external parts. Blocks completed before that are kept
+ * in the frame ring but skip the block stages. The default keeps the
+ * serial order, in which every consumer sees the first block.
+ *
+ * Usage Example:
+ *   bootProfile_start();                 // first line of main()
+ *   MPU_Config();
+ *   ...
+ *   HAL_Init();
+ *   bootProfile_mark(BOOT_PHASE_HAL);
+ *   ...
+ *   bootProfile_mark(BOOT_PHASE_FIRST_BLOCK);
+ *
+ *   // main loop, once telemetry is up
+ *   bootProfile_poll();
+ *
+ * @note Marks are taken from thread context only, before the scheduler
+ *       starts in the RTOS build; the first-block mark may come from the
+ *       block callback.
+ ******************************************************************************
+ */
+
+#ifndef BOOT_PROFILE_H
+#define BOOT_PROFILE_H
+
+#include "stm32f7xx_hal.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+
+/**
+ * @brief Set to 1 to timestamp the init phases and report them
+ */
+#ifndef BOOT_PROFILE_ENABLE
+#define BOOT_PROFILE_ENABLE 0
+#endif
+
+/**
+ * @brief Set to 1 to start acquisition before the comms and DSP init
+ */
+#ifndef BOOT_FAST_START
+#define BOOT_FAST_START 0
+#endif
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief Init phases, each closed by its mark
+ */
+typedef enum {
+  BOOT_PHASE_HAL = 0,       ///< MPU, caches, HAL_Init(): flash, SysTick
+  BOOT_PHASE_CLOCK,         ///< SystemClock_Config(): PLL lock, overdrive
+  BOOT_PHASE_CLOCK_PROFILE, ///< clockProfile_apply()
+  BOOT_PHASE_TIMEBASE,      ///< DWT probes, TIM5 timebase, CPU load
+  BOOT_PHASE_PERIPH,        ///< MX_*_Init(): GPIO, DMA, ADCs, USART, TIM2
+  BOOT_PHASE_ACQ,           ///< ADC set-up: multimode, watchdogs, pool
+  BOOT_PHASE_FIRST_SAMPLE,  ///< Scan start to the first DMA transfer
+  BOOT_PHASE_COMMS,         ///< UART telemetry, USB, Ethernet
+  BOOT_PHASE_STORAGE,       ///< SD card logger, QSPI recorder
+  BOOT_PHASE_DSP,           ///< Filters, spectra, triggers
+  BOOT_PHASE_FIRST_BLOCK,   ///< First block handed to the consumers
+  BOOT_PHASE_COUNT
+} BootProfile_Phase_t;
+
+/**
+ * @brief One closed phase
+ */
+typedef struct {
+  uint32_t duration_us; ///< Since the previous mark
+  uint32_t end_us;      ///< Since bootProfile_start()
+  uint8_t order;        ///< Position among the marks, 0 first
+  uint8_t marked;       ///< 0 = phase not reached (yet)
+} BootProfile_Entry_t;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief Enable the DWT cycle counter and clear the marks (first line of
+ *        main())
+ */
+void bootProfile_start(void);
+
+/**
+ * @brief Close a phase at the current cycle count; a phase marked twice
+ *        keeps its first mark
+ */
+void bootProfile_mark(BootProfile_Phase_t phase);
+
+/**
+ * @brief Copy one phase
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_BUSY  Phase not reached
+ *   @retval HAL_ERROR Invalid phase or NULL pointer
+ */
+HAL_StatusTypeDef bootProfile_get(BootProfile_Phase_t phase,
+                                  BootProfile_Entry_t *entry);
+
+/**
+ * @brief Time from bootProfile_start() to the first sample, 0 before it
+ */
+uint32_t bootProfile_getFirstSampleUs(void);
+
+/**
+ * @brief Request the report again (e.g. on the profiler dump command)
+ */
+void bootProfile_dump(void);
+
+/**
+ * @brief Queue pending report lines while telemetry slots are free
+ *
+ * @note Call from the main loop
+ */
+void bootProfile_poll(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BOOT_PROFILE_H */
@@ -0,0 +1,177 @@
+/**
+ ******************************************************************************
+ * @file    burst_capture.h
+ * @brief   Transient recorder: the shock capture at full rate into the
+ *          largest free RAM region, drained afterwards
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * The shock capture (analogSensor_startCapture()) interleaves ADC1, ADC2
+ * and ADC3 on one pin, at several Msps, into a 24 kB buffer: a few ms. A
+ * burst takes the same conversions into the largest RAM region nothing
+ * owns while it runs, one of:
+ *   - DTCM after .dtcm_bss, up to the main stack's reservation (_sstack)
+ *     (no D-cache to maintain)
+ *   - SRAM1 after the (empty) heap reservation, _eheap to the end of the
+ *     bank. No heap grows into it (mem_budget.h). SRAM2 holds the link
+ *     buffers.
+ *
+ * burstCapture_plan() picks the region and estimates the budget before
+ * anything is touched: size on each side of the SRAM1/SRAM2 boundary
+ * (the heap region no longer reaches SRAM2), samples, duration at the
+ * capture rate, the DMA write bandwidth and how long draining takes at the
+ * link rate. burstCapture_start() claims the
+ * region and starts the DMA; nothing else runs on the ADCs until it is
+ * full. The samples stay readable, the region held, until
+ * burstCapture_release(), so the scan can run again while they drain.
+ *
+ * Usage Example:
+ *   BurstCapture_Plan_t plan;
+ *   burstCapture_plan(921600U, &plan); // report it
+ *   analogSensor_stopDMA();            // the ADCs free
+ *   burstCapture_start(3, &plan);
+ *
+ *   // main loop
+ *   const uint16_t *samples;
+ *   uint32_t count;
+ *   if (burstCapture_getSamples(&samples, &count) == HAL_OK) {
+ *     analogSensor_stopDMA();          // restore the ADCs, restart the scan
+ *     // send count samples, then
+ *     burstCapture_release();
+ *   }
+ *
+ * @note Main loop only.
+ ******************************************************************************
+ */
+
+#ifndef BURST_CAPTURE_H
+#define BURST_CAPTURE_H
+
+#include "adc_conversions.h"
+#include "stm32f7xx_hal.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+
+/**
+ * @brief Smallest region worth a burst: more than the dedicated buffer
+ */
+#ifndef BURST_CAPTURE_MIN_BYTES
+#define BURST_CAPTURE_MIN_BYTES                                                \
+  (ADC_CONVERSIONS_CAPTURE_SAMPLES * 2U * sizeof(uint16_t))
+#endif
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief Region a burst records into
+ */
+typedef enum {
+  BURST_CAPTURE_REGION_NONE = 0,
+  BURST_CAPTURE_REGION_DTCM, ///< Free end of DTCM
+  BURST_CAPTURE_REGION_SRAM  ///< Heap to the end of SRAM1
+} BurstCapture_Region_t;
+
+/**
+ * @brief Recorder state
+ */
+typedef enum {
+  BURST_CAPTURE_IDLE = 0, ///< No region held
+  BURST_CAPTURE_RUNNING,  ///< DMA filling the region
+  BURST_CAPTURE_FULL      ///< Samples ready, region held
+} BurstCapture_State_t;
+
+/**
+ * @brief Region and budget of a burst, before it is armed
+ */
+typedef struct {
+  uint8_t region;           ///< BurstCapture_Region_t
+  uint32_t base;            ///< First byte, cache-line aligned
+  uint32_t bytes;           ///< Size, whole cache lines
+  uint32_t dtcm_free;       ///< Free DTCM found
+  uint32_t sram_free;       ///< Free SRAM1 above the heap reservation
+  uint32_t sram1_bytes;     ///< Of the region, in SRAM1
+  uint32_t sram2_bytes;     ///< Of the region, in SRAM2
+  uint32_t samples;         ///< Capacity
+  uint32_t sample_rate_hz;  ///< analogSensor_getCaptureRate()
+  uint32_t duration_us;     ///< Recording time
+  uint32_t dma_bytes_per_s; ///< DMA write bandwidth while it records
+  uint32_t drain_ms;        ///< Sending it as burst packets at the link rate
+} BurstCapture_Plan_t;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief Find the largest free region and estimate the burst it holds
+ *
+ * @param link_baud Link rate for the drain estimate (10 bits per byte)
+ * @param plan      Receives the region and the estimates
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    A region of at least BURST_CAPTURE_MIN_BYTES
+ *   @retval HAL_BUSY  A burst holds the region (plan describes it)
+ *   @retval HAL_ERROR NULL pointer or no region large enough
+ */
+HAL_StatusTypeDef burstCapture_plan(uint32_t link_baud,
+                                    BurstCapture_Plan_t *plan);
+
+/**
+ * @brief Claim the planned region and start recording
+ *
+ * @param channel Channel wired to all three ADCs
+ * @param plan    From burstCapture_plan(), just before
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Recording
+ *   @retval HAL_BUSY  A burst holds the region, or the ADCs are not free
+ *   @retval HAL_ERROR Bad plan (not from burstCapture_plan()), invalid
+ *                     channel or HAL failure; nothing held
+ */
+HAL_StatusTypeDef burstCapture_start(uint8_t channel,
+                                     const BurstCapture_Plan_t *plan);
+
+/**
+ * @brief Current state
+ */
+BurstCapture_State_t burstCapture_getState(void);
+
+/**
+ * @brief Get the finished recording
+ *
+ * @param samples Receives the region
+ * @param count   Receives the number of samples
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Full, valid until burstCapture_release()
+ *   @retval HAL_BUSY  Still recording
+ *   @retval HAL_ERROR No burst, or NULL pointer
+ */
+HAL_StatusTypeDef burstCapture_getSamples(const uint16_t **samples,
+                                          uint32_t *count);
+
+/**
+ * @brief Channel and start (HAL tick) of the burst held
+ */
+uint8_t burstCapture_getChannel(void);
+uint32_t burstCapture_getStartTick(void);
+
+/**
+ * @brief Give the region back
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Released
+ *   @retval HAL_BUSY  Still recording; analogSensor_stopDMA() aborts it
+ */
+HAL_StatusTypeDef burstCapture_release(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BURST_CAPTURE_H */
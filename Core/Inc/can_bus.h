@@ -0,0 +1,308 @@
+/**
+ ******************************************************************************
+ * @file    can_bus.h
+ * @brief   bxCAN broadcast of the vibration features and alarms, with an
+ *          identifier-ordered TX queue and hardware-filtered commands
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * Puts the node on an existing CAN network next to others of its kind, so
+ * no gateway has to poll each one. CAN1 runs on the Nucleo CN9 pins, wired
+ * to a transceiver:
+ *
+ *   PD0 RX  PD1 TX  (AF9)
+ *
+ * Identifiers are 11-bit, CAN_BUS_ID(type, node): the frame type in the
+ * upper six bits and the node in the lower five, so on the bus every alarm
+ * outranks every feature frame, of any node:
+ *
+ *   type                   data (little-endian)
+ *   CAN_BUS_TYPE_COMMAND   opcode, arguments (received, node 0 = all)
+ *   CAN_BUS_TYPE_ALARM     channel, event, alarm, worst band, score (f32)
+ *   CAN_BUS_TYPE_PEAK      channel, sequence, peak Hz (u16), amplitude (f32)
+ *   CAN_BUS_TYPE_RMS       channel, sequence, bands, 0, RMS (f32)
+ *   CAN_BUS_TYPE_STATUS    mode, TEC, REC, drops, frame sequence (u32)
+ *
+ * Transmit. Frames wait in a queue sorted by identifier, FIFO among equal
+ * ones, and the three TX mailboxes are kept full from its head; the
+ * mailboxes go out by identifier too (TXFP = 0). When a frame of higher
+ * priority than every pending mailbox finds them all taken, the lowest one
+ * is aborted and requeued, so an alarm never waits behind queued features.
+ * A full queue drops its lowest-priority frame first.
+ *
+ * Receive. One filter bank in 16-bit list mode accepts only the command
+ * identifiers of this node and of node 0 into FIFO 0, so the traffic of the
+ * other nodes never interrupts the CPU. canBus_poll() runs PING (answers
+ * with a status frame) and MASK (selects the types sent) and hands other
+ * opcodes to the command callback.
+ *
+ * Latency. A frame carries the timebase_now() of its event; the TX
+ * complete interrupt adds the time to the end of transmission, queueing,
+ * arbitration and retransmissions included, to the statistics of its class.
+ *
+ * Usage Example:
+ *   canBus_init();                           // once, after MX_GPIO_Init()
+ *
+ *   // Vibration result (DSP context)
+ *   const CanBus_Features_t f = {.channel = ch, .sequence = r.sequence,
+ *                                .rms = r.rms, .peak_hz = r.peak_hz,
+ *                                .peak_amplitude = r.peak_amplitude,
+ *                                .band_count = r.band_count,
+ *                                .event = timebase_now()};
+ *   canBus_sendFeatures(&f);
+ *
+ *   while (1) {
+ *     canBus_poll();                         // commands and the heartbeat
+ *   }
+ *
+ * Concurrency model:
+ *   - canBus_send*() and canBus_poll() run in the main loop; the queue is
+ *     shared with the CAN interrupts under short masked sections
+ *   - the TX, RX0 and SCE interrupts run at CAN_BUS_IRQ_PRIORITY
+ *
+ * @note CAN1, its filter banks 0..13 and PD0/PD1 are taken while
+ *       CAN_BUS_ENABLE is set.
+ ******************************************************************************
+ */
+
+#ifndef CAN_BUS_H
+#define CAN_BUS_H
+
+#include "irq_priority.h"
+#include "stm32f7xx_hal.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+
+/**
+ * @brief Set to 1 when the node is wired to a CAN transceiver
+ */
+#ifndef CAN_BUS_ENABLE
+#define CAN_BUS_ENABLE 0
+#endif
+
+/**
+ * @brief This node's number (1..31; 0 addresses every node)
+ */
+#ifndef CAN_BUS_NODE_ID
+#define CAN_BUS_NODE_ID 1U
+#endif
+
+/**
+ * @brief Bit rate; PCLK1 must be a multiple of 18 times it (18 quanta per
+ *        bit, sampled at 89 %)
+ */
+#ifndef CAN_BUS_BITRATE
+#define CAN_BUS_BITRATE 500000U
+#endif
+
+/**
+ * @brief Identifier of a frame type and node (11 bits)
+ */
+#ifndef CAN_BUS_ID
+#define CAN_BUS_ID(type, node) (((uint32_t)(type) << 5) | (uint32_t)(node))
+#endif
+
+/**
+ * @brief Frames waiting for a mailbox
+ */
+#ifndef CAN_BUS_QUEUE_LEN
+#define CAN_BUS_QUEUE_LEN 16U
+#endif
+
+/**
+ * @brief Status frame period (0 = only on PING)
+ */
+#ifndef CAN_BUS_HEARTBEAT_MS
+#define CAN_BUS_HEARTBEAT_MS 1000U
+#endif
+
+/**
+ * @brief TX, RX0 and SCE interrupt priority
+ */
+#ifndef CAN_BUS_IRQ_PRIORITY
+#define CAN_BUS_IRQ_PRIORITY IRQ_PRIORITY_COMMS
+#endif
+
+/**
+ * @brief Frame types, in bus priority order (lowest first)
+ */
+#define CAN_BUS_TYPE_COMMAND 0x01U ///< Host to node
+#define CAN_BUS_TYPE_ALARM 0x04U   ///< Baseline alarm raised or cleared
+#define CAN_BUS_TYPE_PEAK 0x10U    ///< Dominant spectral peak
+#define CAN_BUS_TYPE_RMS 0x11U     ///< Overall RMS
+#define CAN_BUS_TYPE_STATUS 0x20U  ///< Heartbeat and PING reply
+
+/**
+ * @brief Command opcodes (first data byte)
+ */
+#define CAN_BUS_CMD_PING 0x01U ///< Reply with a status frame
+#define CAN_BUS_CMD_MASK 0x02U ///< Byte 1: CAN_BUS_SEND_x bits to send
+
+/**
+ * @brief Types enabled by MASK
+ */
+#define CAN_BUS_SEND_ALARM 0x01U
+#define CAN_BUS_SEND_PEAK 0x02U
+#define CAN_BUS_SEND_RMS 0x04U
+#define CAN_BUS_SEND_STATUS 0x08U
+#define CAN_BUS_SEND_ALL 0x0FU
+
+#if CAN_BUS_NODE_ID < 1 || CAN_BUS_NODE_ID > 31
+#error "CAN_BUS_NODE_ID must be in 1..31"
+#endif
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief Latency classes
+ */
+typedef enum {
+  CAN_BUS_CLASS_ALARM = 0, ///< Alarm frames
+  CAN_BUS_CLASS_FEATURE,   ///< Peak and RMS frames
+  CAN_BUS_CLASS_STATUS,    ///< Status frames
+  CAN_BUS_CLASS_COUNT
+} CanBus_Class_t;
+
+/**
+ * @brief Event-to-bus latency of one class
+ */
+typedef struct {
+  uint32_t sent;   ///< Frames transmitted
+  uint32_t min_us; ///< Shortest event to end of transmission
+  uint32_t max_us; ///< Longest
+  uint64_t sum_us; ///< Total, for the mean
+} CanBus_Latency_t;
+
+/**
+ * @brief Counters since canBus_init()
+ */
+typedef struct {
+  CanBus_Latency_t latency[CAN_BUS_CLASS_COUNT]; ///< By class
+  uint32_t queued;      ///< Frames accepted by canBus_send()
+  uint32_t dropped;     ///< Frames lost to a full queue
+  uint32_t preempted;   ///< Mailboxes aborted for a higher-priority frame
+  uint32_t tx_errors;   ///< Transmissions ended without success
+  uint32_t commands;    ///< Commands received through the filter
+  uint32_t rx_overruns; ///< Commands lost to a full FIFO 0
+  uint32_t bus_off;     ///< Bus-off entries
+  uint8_t tec;          ///< Transmit error counter, now
+  uint8_t rec;          ///< Receive error counter, now
+  uint8_t mask;         ///< CAN_BUS_SEND_x types sent
+} CanBus_Stats_t;
+
+/**
+ * @brief Features of one vibration result
+ */
+typedef struct {
+  uint8_t channel;      ///< ADC channel
+  uint8_t band_count;   ///< Bands in the result
+  uint32_t sequence;    ///< Result sequence (low byte sent)
+  float rms;            ///< Overall RMS (codes)
+  float peak_hz;        ///< Dominant frequency
+  float peak_amplitude; ///< Its amplitude (codes, 0-pk)
+  uint64_t event;       ///< timebase_now() of the result
+} CanBus_Features_t;
+
+/**
+ * @brief One alarm change
+ */
+typedef struct {
+  uint8_t channel;    ///< ADC channel
+  uint8_t event;      ///< DSP_BaselineEvent_t
+  uint8_t alarm;      ///< Alarm state after it
+  uint8_t worst_band; ///< Band furthest from the baseline
+  float score;        ///< Its score
+  uint64_t event_ts;  ///< timebase_now() of the change
+} CanBus_Alarm_t;
+
+/**
+ * @brief Command not handled by the transport (main loop context)
+ *
+ * @param data Frame data, data[0] being the opcode
+ * @param len  1..8
+ * @param ctx  User context
+ */
+typedef void (*CanBus_CommandCallback_t)(const uint8_t *data, uint8_t len,
+                                         void *ctx);
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief Set up CAN1, its pins, the command filter and the interrupts, then
+ *        join the bus
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    On the bus (or CAN_BUS_ENABLE = 0)
+ *   @retval HAL_ERROR PCLK1 does not divide to CAN_BUS_BITRATE, or a HAL
+ *                     call failed
+ */
+HAL_StatusTypeDef canBus_init(void);
+
+/**
+ * @brief Queue one frame
+ *
+ * @param type  CAN_BUS_TYPE_x (this node's identifier is added)
+ * @param data  0..8 bytes
+ * @param len   Data length
+ * @param event timebase_now() of the event the frame reports
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Queued (a lower-priority frame may have been dropped)
+ *   @retval HAL_BUSY  Queue full of frames of higher priority; dropped
+ *   @retval HAL_ERROR Not initialised, or len > 8
+ */
+HAL_StatusTypeDef canBus_send(uint8_t type, const uint8_t *data, uint8_t len,
+                              uint64_t event);
+
+/**
+ * @brief Queue the peak and RMS frames of a result, as MASK allows
+ */
+HAL_StatusTypeDef canBus_sendFeatures(const CanBus_Features_t *features);
+
+/**
+ * @brief Queue an alarm frame, as MASK allows
+ */
+HAL_StatusTypeDef canBus_sendAlarm(const CanBus_Alarm_t *alarm);
+
+/**
+ * @brief Run received commands and send the heartbeat (main loop)
+ */
+void canBus_poll(void);
+
+/**
+ * @brief Register the callback of the other opcodes (NULL to remove)
+ */
+void canBus_registerCommandCallback(CanBus_CommandCallback_t callback,
+                                    void *ctx);
+
+/**
+ * @brief Get the counters
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer
+ */
+HAL_StatusTypeDef canBus_getStats(CanBus_Stats_t *stats);
+
+/**
+ * @brief Clear the latency statistics
+ */
+void canBus_resetLatency(void);
+
+/**
+ * @brief CAN1 TX, RX0 and SCE interrupts (CAN1_xxx_IRQHandler)
+ */
+void canBus_irqHandler(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CAN_BUS_H */
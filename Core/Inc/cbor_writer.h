@@ -0,0 +1,118 @@
+/**
+ ******************************************************************************
+ * @file    cbor_writer.h
+ * @brief   Streaming CBOR (RFC 8949) encoder into a caller's buffer
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * Writes definite-length maps and arrays, integers and floats straight
+ * into a caller-provided buffer: no allocation, no intermediate tree, no
+ * backtracking. Item counts are given up front, so the caller knows its
+ * message shape before it writes it.
+ *
+ * Integers take the shortest head (1, 2, 3 or 5 bytes). Floats are written
+ * as half precision (3 bytes) when the half value is within rel_tol of the
+ * float, else as single precision (5 bytes). With rel_tol = 0 only exact
+ * halves are shortened, which is CBOR's lossless preferred serialisation.
+ * Zero, infinities and NaN are always halves.
+ *
+ * A write past the end of the buffer sets the overflow flag and writes
+ * nothing more; cborWriter_finish() then fails, so a message is checked
+ * once instead of after every item.
+ *
+ * Usage Example:
+ *   uint8_t buf[64];
+ *   CborWriter_t w;
+ *   cborWriter_init(&w, buf, sizeof(buf));
+ *   cborWriter_map(&w, 2);
+ *   cborWriter_uint(&w, 1);                 // key 1
+ *   cborWriter_uint(&w, sequence);
+ *   cborWriter_uint(&w, 2);                 // key 2
+ *   cborWriter_float(&w, rms, 0.001f);      // 0.1 % is enough
+ *   uint16_t len;
+ *   if (cborWriter_finish(&w, &len) == HAL_OK) { ... }
+ ******************************************************************************
+ */
+
+#ifndef CBOR_WRITER_H
+#define CBOR_WRITER_H
+
+#include "stm32f7xx_hal.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief Writer state; cborWriter_init() sets it up
+ */
+typedef struct {
+  uint8_t *start;   ///< First byte of the buffer
+  uint8_t *p;       ///< Next byte to write
+  uint8_t *end;     ///< One past the last byte
+  uint8_t overflow; ///< An item did not fit
+} CborWriter_t;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief Start a message in buf
+ *
+ * @param w   Writer
+ * @param buf Output buffer
+ * @param cap Capacity of buf
+ */
+void cborWriter_init(CborWriter_t *w, uint8_t *buf, uint16_t cap);
+
+/**
+ * @brief Unsigned integer (major type 0); also used for map keys
+ */
+void cborWriter_uint(CborWriter_t *w, uint32_t value);
+
+/**
+ * @brief Signed integer (major type 0 or 1)
+ */
+void cborWriter_int(CborWriter_t *w, int32_t value);
+
+/**
+ * @brief Head of an array of items entries (major type 4)
+ */
+void cborWriter_array(CborWriter_t *w, uint32_t items);
+
+/**
+ * @brief Head of a map of pairs key/value pairs (major type 5)
+ */
+void cborWriter_map(CborWriter_t *w, uint32_t pairs);
+
+/**
+ * @brief Float in the shortest form within a relative tolerance (major
+ *        type 7)
+ *
+ * @param w       Writer
+ * @param value   Value to write
+ * @param rel_tol Largest |half - value| / |value| accepted, 0 = exact only
+ */
+void cborWriter_float(CborWriter_t *w, float value, float rel_tol);
+
+/**
+ * @brief End the message
+ *
+ * @param w   Writer
+ * @param len Bytes written
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer, or an item did not fit the buffer
+ */
+HAL_StatusTypeDef cborWriter_finish(const CborWriter_t *w, uint16_t *len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CBOR_WRITER_H */
@@ -0,0 +1,209 @@
+/**
+ ******************************************************************************
+ * @file    clock_gov.h
+ * @brief   Load-driven governor between two clock profiles
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * An idle unit streaming a slow scan has no use for 216 MHz and over-drive;
+ * a burst analysis does. The governor moves the running system between a
+ * fast and a slow profile of clock_profile.h with clockProfile_switch():
+ *
+ *   - up, at once, when the last CPU load slice (cpu_load.h) is above
+ *     CLOCK_GOV_UP_CENTI or the ring holds more than CLOCK_GOV_UP_FILL_PCT,
+ *     or while clockGov_boost() holds it up
+ *   - down when the load that slice projects onto the slow core clock is
+ *     below CLOCK_GOV_DOWN_CENTI and the ring is below
+ *     CLOCK_GOV_DOWN_FILL_PCT, both for CLOCK_GOV_HOLD_MS
+ *
+ * The two profiles must share PCLK1, PCLK2 and the ADC prescaler
+ * (PERFORMANCE and BALANCED do), so the UART, the ADCs and TIM2 keep their
+ * settings. Only the switch itself, some 100-500 us on HSI, runs the buses
+ * at 16 MHz. Through it the scan trigger stays phase-continuous: after
+ * every bus step, with interrupts masked, TIM2's ARR is rescaled to the new
+ * timer clock and its count to the same fraction of the period, so the
+ * next trigger lands within about one timer clock of where it would have.
+ * The last step puts back the exact ARR. SysTick's reload follows the core
+ * clock the same way, and the timebase's prescaler (timebase_setClock())
+ * the timer clock, so timebase_now() keeps its rate through the switch.
+ *
+ * A switch happens only at a safe point:
+ *
+ *   - the application's ready() hook agrees (e.g. telemetry queue empty:
+ *     a UART byte on the wire would be garbled by the baud change)
+ *   - the scan is stopped, or TIM2-paced at a rate the ADCs still convert
+ *     at 16 MHz (analogSensor_getMaxFrameRate() scaled by 16 MHz / PCLK2)
+ *   - the newest block is fresh (less than a quarter of a block period
+ *     old) and the longest switch seen so far fits in half a block
+ *     period, so the masked DMA interrupts are not late by a half buffer
+ *
+ * A due switch refused at a fresh block counts in ClockGov_Stats_t.refused.
+ *
+ * Usage Example:
+ *   cpuLoad_init();
+ *   const ClockGov_Config_t gov = {.fast = CLOCK_PROFILE_PERFORMANCE,
+ *                                  .slow = CLOCK_PROFILE_BALANCED,
+ *                                  .ready = app_ready};
+ *   clockGov_init(&gov);
+ *
+ *   clockGov_poll();                  // main loop
+ *   clockGov_boost(2000U);            // burst analysis ahead
+ *
+ * @note Main loop only. TIM1/TIM8 and the ADC clock run from PCLK2 and see
+ *       the window at 16 MHz, so PWM_SYNC, EXT_ADC and ADC_MUX exclude the
+ *       governor.
+ ******************************************************************************
+ */
+
+#ifndef CLOCK_GOV_H
+#define CLOCK_GOV_H
+
+#include "clock_profile.h"
+#include "stm32f7xx_hal.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+
+/**
+ * @brief Set to 1 to build the governor
+ */
+#ifndef CLOCK_GOV_ENABLE
+#define CLOCK_GOV_ENABLE 0
+#endif
+
+/**
+ * @brief Load of the last slice that moves to the fast profile, 0.01 %
+ */
+#ifndef CLOCK_GOV_UP_CENTI
+#define CLOCK_GOV_UP_CENTI 7500U
+#endif
+
+/**
+ * @brief Projected slow-profile load below which the slow one will do
+ */
+#ifndef CLOCK_GOV_DOWN_CENTI
+#define CLOCK_GOV_DOWN_CENTI 5000U
+#endif
+
+/**
+ * @brief Ring fill, in % of ADC_RING_CAPACITY, that moves up / allows down
+ */
+#ifndef CLOCK_GOV_UP_FILL_PCT
+#define CLOCK_GOV_UP_FILL_PCT 50U
+#endif
+#ifndef CLOCK_GOV_DOWN_FILL_PCT
+#define CLOCK_GOV_DOWN_FILL_PCT 12U
+#endif
+
+/**
+ * @brief Time the down conditions must hold
+ */
+#ifndef CLOCK_GOV_HOLD_MS
+#define CLOCK_GOV_HOLD_MS 3000U
+#endif
+
+/**
+ * @brief Switch time assumed before the first one is measured
+ */
+#ifndef CLOCK_GOV_WINDOW_US
+#define CLOCK_GOV_WINDOW_US 500U
+#endif
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief Policy
+ */
+typedef enum {
+  CLOCK_GOV_AUTO = 0, ///< By load and ring fill
+  CLOCK_GOV_FAST,     ///< Fast profile held
+  CLOCK_GOV_SLOW      ///< Slow profile held
+} ClockGov_Mode_t;
+
+/**
+ * @brief Profile pair and the application's safe-point hook
+ */
+typedef struct {
+  ClockProfile_Id_t fast; ///< Profile under load
+  ClockProfile_Id_t slow; ///< Profile when idle
+  /** Nonzero when nothing in flight minds the switch; NULL = always */
+  uint8_t (*ready)(void *ctx);
+  void *ctx;
+} ClockGov_Config_t;
+
+/**
+ * @brief Governor figures
+ */
+typedef struct {
+  uint8_t running;           ///< clockGov_init() succeeded
+  ClockGov_Mode_t mode;
+  ClockProfile_Id_t profile; ///< Active profile
+  ClockProfile_Id_t target;  ///< Profile the policy wants
+  uint16_t load_centi_pct;   ///< Last slice judged, 0.01 %
+  uint8_t fill_pct;          ///< Ring fill at the last poll
+  uint32_t boost_ms;         ///< Boost left
+  uint32_t switches;         ///< Switches done
+  uint32_t refused;          ///< Due switches refused at a fresh block
+  uint32_t failed;           ///< clockProfile_switch() errors
+  uint32_t last_window_us;   ///< Duration of the last switch
+  uint32_t max_window_us;    ///< Longest switch
+  uint32_t fast_ms;          ///< Time on the fast profile
+  uint32_t slow_ms;          ///< Time on the slow profile
+} ClockGov_Stats_t;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief Check the pair and start governing, in CLOCK_GOV_AUTO
+ *
+ * @param cfg Profiles and hook (copied)
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Governing
+ *   @retval HAL_ERROR Built without CLOCK_GOV_ENABLE, NULL pointer, invalid
+ *                     or equal profiles, profiles with different buses or
+ *                     ADC prescalers, or the active profile is not one of
+ *                     them
+ */
+HAL_StatusTypeDef clockGov_init(const ClockGov_Config_t *cfg);
+
+/**
+ * @brief Judge the load and switch at a safe point
+ */
+void clockGov_poll(void);
+
+/**
+ * @brief Set the policy; a held profile is reached at the next safe point
+ */
+void clockGov_setMode(ClockGov_Mode_t mode);
+
+/**
+ * @brief Hold the fast profile for a time (CLOCK_GOV_AUTO only); 0 ends it
+ */
+void clockGov_boost(uint32_t ms);
+
+/**
+ * @brief Copy the governor figures
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer
+ */
+HAL_StatusTypeDef clockGov_getStats(ClockGov_Stats_t *stats);
+
+/**
+ * @brief Policy as a short word for report lines
+ */
+const char *clockGov_modeName(ClockGov_Mode_t mode);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CLOCK_GOV_H */
@@ -0,0 +1,216 @@
+/**
+ ******************************************************************************
+ * @file    clock_profile.h
+ * @brief   Selectable system / ADC clock profiles
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * Each profile fixes SYSCLK, the bus dividers, the regulator scale and
+ * over-drive, the flash wait states and the ADC prescaler together, so
+ * they cannot disagree. The PLL runs its VCO at 432 MHz from a 1 or 2 MHz
+ * reference (HSI 16 MHz, or HSE in bypass mode, e.g. the 8 MHz MCO of the
+ * Nucleo's ST-LINK), and PLLQ gives 48 MHz in every profile.
+ *
+ *   Profile       SYSCLK  HCLK  APB1  APB2  ADCCLK  VOS  OD   Flash WS
+ *   PERFORMANCE   216     216   54    108   27      1    on   7
+ *   BALANCED      108     108   54    108   27      3    off  3
+ *   LOW_POWER      54      54   54     54   13.5    3    off  1
+ *
+ * PCLK1 is 54 MHz in all three, so USART3 and TIM2 settings carry over. The
+ * ADC common prescaler divides PCLK2 by 2/4/6/8 only. At 216 MHz (PCLK2
+ * 108 MHz) the fastest ADCCLK within the 36 MHz limit is 27 MHz.
+ *
+ * Usage Example:
+ *   SystemClock_Config();                      // CubeMX default
+ *   clockProfile_apply(CLOCK_PROFILE_PERFORMANCE, CLOCK_SOURCE_HSI);
+ *   MX_ADC1_Init(); ...                        // peripherals afterwards
+ *   analogSensor_setClockPrescaler(clockProfile_getActive()->adc_prescaler);
+ *
+ *   ClockProfile_Info_t info;
+ *   clockProfile_getInfo(CLOCK_PROFILE_LOW_POWER, &info);
+ *   // info.adc_conversion_rate: conversions/s of one ADC at 3 cycles
+ *
+ * clockProfile_switch() changes profile on a running system. It passes
+ * through HSI like clockProfile_apply(), with interrupts masked, and a
+ * hook after every change of the bus clocks. A timer that must keep time
+ * across the switch can be re-derived there, a few cycles after the edge.
+ *
+ ******************************************************************************
+ */
+
+#ifndef CLOCK_PROFILE_H
+#define CLOCK_PROFILE_H
+
+#include "stm32f7xx_hal.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+
+/**
+ * @brief Profile applied at boot (ClockProfile_Id_t value)
+ */
+#ifndef CLOCK_PROFILE_DEFAULT
+#define CLOCK_PROFILE_DEFAULT CLOCK_PROFILE_BALANCED
+#endif
+
+/**
+ * @brief Boot clock source: 1 = HSE bypass (HSE_VALUE must be the input
+ *        frequency, a whole number of MHz), 0 = HSI
+ */
+#ifndef CLOCK_PROFILE_HSE_BYPASS
+#define CLOCK_PROFILE_HSE_BYPASS 0
+#endif
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief Clock profiles
+ */
+typedef enum {
+  CLOCK_PROFILE_PERFORMANCE = 0, ///< 216 MHz, over-drive, ADCCLK 27 MHz
+  CLOCK_PROFILE_BALANCED,        ///< 108 MHz, scale 3, ADCCLK 27 MHz
+  CLOCK_PROFILE_LOW_POWER,       ///< 54 MHz, scale 3, ADCCLK 13.5 MHz
+  CLOCK_PROFILE_COUNT
+} ClockProfile_Id_t;
+
+/**
+ * @brief PLL reference
+ */
+typedef enum {
+  CLOCK_SOURCE_HSI = 0,   ///< Internal 16 MHz RC
+  CLOCK_SOURCE_HSE_BYPASS ///< External clock on OSC_IN (HSE_VALUE)
+} ClockProfile_Source_t;
+
+/**
+ * @brief Resulting clocks of a profile
+ */
+typedef struct {
+  ClockProfile_Id_t id;
+  uint32_t sysclk_hz;
+  uint32_t hclk_hz;
+  uint32_t pclk1_hz;
+  uint32_t pclk2_hz;
+  uint32_t adcclk_hz;
+  uint32_t adc_prescaler;       ///< ADC_CLOCK_SYNC_PCLK_DIVx
+  uint32_t flash_latency;       ///< FLASH_LATENCY_x
+  uint32_t voltage_scale;       ///< PWR_REGULATOR_VOLTAGE_SCALEx
+  uint8_t overdrive;            ///< 1 = over-drive enabled
+  uint32_t adc_conversion_rate; ///< Conversions/s of one ADC, 3 + 12 cycles
+} ClockProfile_Info_t;
+
+/**
+ * @brief Core and APB1 timer clocks at one step of a switch
+ */
+typedef struct {
+  uint32_t hclk_hz;       ///< HCLK (SysTick, DWT cycle counter)
+  uint32_t apb1_timer_hz; ///< TIM2..7, TIM12..14 (2x PCLK1 when divided)
+} ClockProfile_Bus_t;
+
+/**
+ * @brief Bus clocks just changed (interrupts masked, SystemCoreClock and the
+ *        HAL timebase not yet updated)
+ *
+ * @param before Clocks until the change
+ * @param after  Clocks from the change
+ * @param ctx    User context
+ */
+typedef void (*ClockProfile_BusHook_t)(const ClockProfile_Bus_t *before,
+                                       const ClockProfile_Bus_t *after,
+                                       void *ctx);
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief Switch the system clock to a profile
+ *
+ * Runs from HSI while the PLL, regulator scale and over-drive change, then
+ * switches to the PLL with the profile's wait states and dividers. SysTick
+ * is re-derived by the HAL.
+ *
+ * @param id     Profile
+ * @param source PLL reference
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Profile active
+ *   @retval HAL_ERROR Invalid profile, unusable HSE_VALUE or RCC/PWR failure
+ *                     (the system is then left on HSI)
+ *
+ * @note Call before the peripherals are initialised: baud rates and the ADC
+ *       prescaler are computed from the clocks at their init. The ADC
+ *       prescaler itself is applied by analogSensor_setClockPrescaler().
+ */
+HAL_StatusTypeDef clockProfile_apply(ClockProfile_Id_t id,
+                                     ClockProfile_Source_t source);
+
+/**
+ * @brief Restart the active profile's PLL after STOP mode
+ *
+ * STOP mode leaves the core on HSI with the PLL, HSE and over-drive off but
+ * keeps their configuration, so this only re-enables them and switches
+ * back: much faster than clockProfile_apply(), and the peripherals' baud
+ * rates and prescalers stay valid.
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK      Profile clocks running again (or never stopped)
+ *   @retval HAL_ERROR   No profile applied, or over-drive failed
+ *   @retval HAL_TIMEOUT HSE or PLL did not become ready
+ *
+ * @note SysTick must run (HAL_ResumeTick()) for the timeouts
+ */
+HAL_StatusTypeDef clockProfile_resume(void);
+
+/**
+ * @brief Move a running system to another profile
+ *
+ * SYSCLK goes to HSI, then the dividers to 1; the PLL is stopped, the
+ * regulator scale and over-drive changed and the PLL restarted with the
+ * profile's P divider from the same reference; then the dividers and
+ * SYSCLK go to the profile. Each of the four steps is a single register
+ * write followed by the hook, and the HAL timebase is re-derived after
+ * each. PLLQ (48 MHz) stops for the PLL lock time, about 100 us.
+ *
+ * @param id   Profile
+ * @param hook Called after each bus clock change (NULL = none)
+ * @param ctx  Passed to hook
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Profile active (also if it already was)
+ *   @retval HAL_ERROR No profile applied yet, invalid profile, or PLL or
+ *                     over-drive failure (the system is then left on HSI)
+ *
+ * @note Peripherals clocked from PCLK1/PCLK2 keep their settings, so only
+ *       profiles with the same buses suit a running system; during the
+ *       switch they all run from 16 MHz. Interrupts are masked throughout.
+ */
+HAL_StatusTypeDef clockProfile_switch(ClockProfile_Id_t id,
+                                      ClockProfile_BusHook_t hook, void *ctx);
+
+/**
+ * @brief Clocks a profile produces (whether or not it is active)
+ *
+ * @param id   Profile
+ * @param info Receives the clocks
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR Invalid profile or NULL pointer
+ */
+HAL_StatusTypeDef clockProfile_getInfo(ClockProfile_Id_t id,
+                                       ClockProfile_Info_t *info);
+
+/**
+ * @brief Profile applied last, NULL if none (CubeMX clock still running)
+ */
+const ClockProfile_Info_t *clockProfile_getActive(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CLOCK_PROFILE_H */
@@ -0,0 +1,209 @@
+/**
+ ******************************************************************************
+ * @file    config_store.h
+ * @brief   Persistent settings: a log of versioned, CRC-checked records in
+ *          flash sectors 1 and 2, loaded once at boot, written in the
+ *          background
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * The store keeps one value per key (scan rate, stream mask, block stages,
+ * ...) in RAM. configStore_init() scans the flash log once at boot and
+ * copies the latest valid record of every key there. After that,
+ * configStore_get() is a copy out of RAM, and configStore_set() only
+ * updates RAM and marks the key. configStore_poll() appends marked keys to
+ * the log a few words per call, so no caller ever waits for the flash.
+ *
+ * Layout: the two 32 KB sectors 1 and 2 (0x08008000, reserved by the
+ * linker script) alternate. The active one starts with a generation count
+ * and a magic word, followed by records:
+ *
+ *   word 0        key | version << 8 | length << 16
+ *   value words   length bytes, zero-padded to a word
+ *   CRC-32        over word 0 and the value words
+ *   commit word   programmed last
+ *
+ * A record is only taken at boot with its commit word and a matching CRC,
+ * so a reset in the middle of a write costs that one update. A record
+ * whose version differs from the one the reader asks for is ignored, and
+ * the reader keeps its default. When the active sector is full, the live
+ * values are copied into the other sector, and its header is written
+ * last. The sector with the newer valid header wins at boot. Each erase
+ * thus frees room for a few thousand updates.
+ *
+ * The F746 has a single flash bank. Every instruction fetch or vector read
+ * from flash stalls while a word programs (~16 us) or a sector erases
+ * (~0.5 s). Programming is spread over configStore_poll() calls, and
+ * erasing only happens with may_erase set. The application passes 1 only
+ * at boot, before the scan starts. After a compaction at runtime, the old
+ * sector is erased at the next boot. Until then updates go on into the
+ * new sector, and once that is full too they wait in RAM.
+ *
+ * Usage Example:
+ *   configStore_init();
+ *   configStore_poll(1);   // before acquisition: erase a spent sector
+ *   if (configStore_get(CONFIG_KEY_SCAN_RATE, 1, &rate, sizeof(rate)) !=
+ *       HAL_OK) {
+ *     rate = DEFAULT_RATE;
+ *   }
+ *
+ *   // on a change, then every main-loop pass
+ *   configStore_set(CONFIG_KEY_SCAN_RATE, 1, &rate, sizeof(rate));
+ *   configStore_poll(0);
+ *
+ ******************************************************************************
+ */
+
+#ifndef CONFIG_STORE_H
+#define CONFIG_STORE_H
+
+#include "stm32f7xx_hal.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+
+/**
+ * @brief Largest value in bytes (multiple of 4); RAM holds one per key. A
+ *        third-octave spectral baseline (dsp_baseline.h) takes 92.
+ */
+#ifndef CONFIG_STORE_VALUE_MAX
+#define CONFIG_STORE_VALUE_MAX 96U
+#endif
+
+/**
+ * @brief Flash words programmed per configStore_poll() call
+ */
+#ifndef CONFIG_STORE_WORDS_PER_POLL
+#define CONFIG_STORE_WORDS_PER_POLL 4U
+#endif
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief Stored settings; new keys go at the end
+ *
+ * Records whose key this build does not know are skipped at boot and
+ * dropped by the next compaction.
+ */
+typedef enum {
+  CONFIG_KEY_SCAN_RATE = 0, ///< uint32_t frame rate, Hz
+  CONFIG_KEY_STREAM_MASK,   ///< uint8_t channels of the filtered stream
+  CONFIG_KEY_BLOCK_STAGES,  ///< uint8_t block stages switched on
+  CONFIG_KEY_CODEC_STREAM,  ///< uint8_t lossless stream instead
+  CONFIG_KEY_CAPTURE,       ///< uint8_t event captures armed
+  CONFIG_KEY_PWM_PHASE,     ///< int32_t PWM_SYNC_ENABLE trigger phase, ns
+  CONFIG_KEY_REPORT_MODE,   ///< uint8_t stats sent by exception
+  CONFIG_KEY_FEATURE_FORMAT, ///< uint8_t features sent as CBOR
+  CONFIG_KEY_LOG_BANDS,     ///< uint8_t log band fraction, 0 = none
+  CONFIG_KEY_BASELINE_GATE, ///< uint8_t bands packets only on alarm
+  CONFIG_KEY_BASELINE_0,    ///< DSP_BaselineRecord_t of vibration channel 0
+  CONFIG_KEY_BASELINE_1,    ///< ... 1
+  CONFIG_KEY_BASELINE_2,    ///< ... 2
+  CONFIG_KEY_BASELINE_3,    ///< ... 3
+  CONFIG_KEY_RAINFLOW_MASK, ///< ADC_ChannelMask_t channels cycle-counted
+  CONFIG_KEY_SRS_MODE,      ///< uint8_t shock response spectra of captures
+  CONFIG_KEY_TRIGGER_EXPR,  ///< char[96] trigger expression, "" = none
+  CONFIG_KEY_PRESET,        ///< uint8_t operating preset, 0xFF = none
+  CONFIG_KEY_CODEC_ERROR,   ///< uint16_t wavelet codec bound, 0 = lossless
+  CONFIG_KEY_ENERGY_MODEL,  ///< EnergyMeter_Model_t currents, supply
+  CONFIG_KEY_CEPSTRUM,      ///< uint8_t[3] peaks, min and max quefrency ms
+  CONFIG_KEY_TSA,           ///< uint16_t revolutions per TSA, 0 = off
+  CONFIG_KEY_RESOLUTION,    ///< uint8_t bits of the scan ADCs (12/10/8/6)
+  CONFIG_KEY_ACQ_TUNE,      ///< AcqTune_Candidate_t of the last tuning run
+  CONFIG_KEY_COUNT
+} ConfigStore_Key_t;
+
+/**
+ * @brief Store statistics
+ */
+typedef struct {
+  uint32_t generation;  ///< Of the active sector, 0 = nothing stored yet
+  uint32_t used_bytes;  ///< Of the active sector, header included
+  uint32_t records;     ///< Records appended since boot
+  uint32_t compactions; ///< Copies into the other sector since boot
+  uint32_t erases;      ///< Sector erases since boot
+  uint32_t deferred;    ///< Polls with updates waiting for an erase
+  uint32_t errors;      ///< Program, verify or erase failures
+} ConfigStore_Stats_t;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief Find the active sector and load the latest record of every key
+ *
+ * Reads the flash only; erases nothing.
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Loaded, possibly nothing (fresh or corrupt store)
+ */
+HAL_StatusTypeDef configStore_init(void);
+
+/**
+ * @brief Value of a key, from RAM
+ *
+ * @param key     Setting
+ * @param version Layout the caller expects
+ * @param value   Receives len bytes
+ * @param len     Size the caller expects
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Copied
+ *   @retval HAL_ERROR Not stored, other version or size, or bad argument
+ */
+HAL_StatusTypeDef configStore_get(ConfigStore_Key_t key, uint8_t version,
+                                  void *value, uint16_t len);
+
+/**
+ * @brief Change a key in RAM and queue it for flash
+ *
+ * An unchanged value queues nothing. A key changed again before it is
+ * written is written once, with its latest value.
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Stored in RAM
+ *   @retval HAL_ERROR Invalid key, NULL pointer or len over
+ *                     CONFIG_STORE_VALUE_MAX
+ */
+HAL_StatusTypeDef configStore_set(ConfigStore_Key_t key, uint8_t version,
+                                  const void *value, uint16_t len);
+
+/**
+ * @brief Program the next few words of the queued keys
+ *
+ * @param may_erase Nonzero: erase spent sectors now (stalls the CPU for
+ *                  each 0.5 s erase; only outside acquisition)
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Progressing or nothing queued
+ *   @retval HAL_BUSY  Updates wait for an erase
+ *   @retval HAL_ERROR Flash operation failed (retried on later calls)
+ *
+ * @note Main loop only, as configStore_set()
+ */
+HAL_StatusTypeDef configStore_poll(uint8_t may_erase);
+
+/**
+ * @brief Whether updates are still waiting for, or in, flash
+ */
+uint8_t configStore_isPending(void);
+
+/**
+ * @brief Get store statistics
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer
+ */
+HAL_StatusTypeDef configStore_getStats(ConfigStore_Stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CONFIG_STORE_H */
@@ -0,0 +1,140 @@
+/**
+ ******************************************************************************
+ * @file    cpu_load.h
+ * @brief   WFI idle loop with DWT-based CPU load accounting
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * cpuLoad_idle() puts the core to sleep with __WFI() until the next
+ * interrupt (DMA half, timer, TIM5 alarm, USB, ...) and measures how long it
+ * slept on DWT->CYCCNT. Interrupts are masked around the WFI, so the core
+ * still wakes on a pending interrupt but the handler only runs once the
+ * sleep has been timed: ISR time counts as busy, as it should.
+ *
+ * Wall time comes from the TIM5 timebase, busy time from the cycle counter
+ * minus the cycles spent asleep. Either way the CYCCNT behaves in sleep
+ * (counting or stopped), the difference is the time the core was awake.
+ *
+ * The load is kept per CPU_LOAD_SLICE_MS slice; cpuLoad_getStats() reports
+ * the mean over the last CPU_LOAD_SLICES slices (rolling 1 s by default)
+ * and the busiest slice since the last reset, which is what decides whether
+ * one more DSP stage fits before frames start dropping.
+ *
+ * HAL_Delay() is overridden to sleep the same way, so delays show as idle.
+ * With the tickless HAL tick (TIMEBASE_HAL_TICK) it arms a TIM5 alarm at
+ * its deadline, and cpuLoad_idle() one CPU_LOAD_MAX_SLEEP_MS ahead.
+ *
+ * Usage Example:
+ *   timebase_init();
+ *   cpuLoad_init();
+ *
+ *   while (1) {
+ *     do_work();
+ *     cpuLoad_idle();       // sleep until the next interrupt
+ *   }
+ *
+ *   CpuLoad_Stats_t load;
+ *   cpuLoad_getStats(&load); // load.load_centi_pct = 2750 -> 27.50 %
+ *
+ * @note Work an interrupt leaves for the main loop while the loop is busy
+ *       waits at most CPU_LOAD_MAX_SLEEP_MS in the next cpuLoad_idle() (one
+ *       SysTick period, 1 ms, with TIMEBASE_HAL_TICK = 0).
+ ******************************************************************************
+ */
+
+#ifndef CPU_LOAD_H
+#define CPU_LOAD_H
+
+#include "stm32f7xx_hal.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+
+/**
+ * @brief Accounting slice
+ */
+#ifndef CPU_LOAD_SLICE_MS
+#define CPU_LOAD_SLICE_MS 100U
+#endif
+
+/**
+ * @brief Slices averaged into the rolling load
+ */
+#ifndef CPU_LOAD_SLICES
+#define CPU_LOAD_SLICES 10U
+#endif
+
+/**
+ * @brief Longest sleep of cpuLoad_idle() without SysTick (TIMEBASE_HAL_TICK)
+ */
+#ifndef CPU_LOAD_MAX_SLEEP_MS
+#define CPU_LOAD_MAX_SLEEP_MS 10U
+#endif
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief CPU load figures, in 0.01 % (10000 = always awake)
+ */
+typedef struct {
+  uint16_t load_centi_pct; ///< Mean of the last CPU_LOAD_SLICES slices
+  uint16_t last_centi_pct; ///< Newest complete slice
+  uint16_t peak_centi_pct; ///< Busiest slice since cpuLoad_resetPeak()
+  uint32_t slices;         ///< Slices completed since cpuLoad_init()
+  uint32_t wakeups;        ///< WFI exits since cpuLoad_init()
+} CpuLoad_Stats_t;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief Start the accounting
+ *
+ * @note Needs the DWT cycle counter (profiler_init()) and the timebase
+ *       (timebase_init()) running
+ */
+void cpuLoad_init(void);
+
+/**
+ * @brief Sleep until the next interrupt and account the time
+ *
+ * @note Main loop only; the pending interrupt runs on return
+ */
+void cpuLoad_idle(void);
+
+/**
+ * @brief Copy the current figures
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    stats filled
+ *   @retval HAL_ERROR stats is NULL
+ */
+HAL_StatusTypeDef cpuLoad_getStats(CpuLoad_Stats_t *stats);
+
+/**
+ * @brief Restart the peak, e.g. after enabling a feature
+ */
+void cpuLoad_resetPeak(void);
+
+/**
+ * @brief Drop the slice in progress and start a new one now, e.g. after a
+ *        core clock change (its cycles no longer match SystemCoreClock)
+ */
+void cpuLoad_restartSlice(void);
+
+/**
+ * @brief DWT cycles measured inside the WFI since reset (a few per sleep
+ *        if the counter stops there), for energy_meter.h
+ */
+uint64_t cpuLoad_getSleptCycles(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CPU_LOAD_H */
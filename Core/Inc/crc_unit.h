@@ -0,0 +1,197 @@
+/**
+ ******************************************************************************
+ * @file    crc_unit.h
+ * @brief   Shared access to the CRC calculation unit: CPU-fed for frames,
+ *          memory-to-memory DMA for large blocks
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * The F746 CRC unit takes 32 bits per write and has a programmable
+ * polynomial, initial value and bit reversal. It computes the two CRCs the
+ * firmware stores and sends, bit-exact with the software versions:
+ *
+ *   CRC-16  poly 0x1021, init 0xFFFF, MSB first, no final XOR
+ *           (telemetry frames, QSPI history pages)
+ *   CRC-32  IEEE 802.3, reflected, init and final XOR 0xFFFFFFFF
+ *           (QSPI captures, calibration record)
+ *
+ * The registers are driven directly; the HAL CRC module stays disabled.
+ * Fed by the CPU, a word costs one store and four AHB cycles of the unit
+ * instead of well over a hundred cycles of the bitwise loop. Blocks of at
+ * least CRC_UNIT_DMA_MIN_BYTES can be handed to DMA2 Stream7 in
+ * memory-to-memory mode, byte by byte into CRC_DR, while the CPU does
+ * other work; the result is polled later. The stream runs at low priority,
+ * behind the ADC stream on the same controller.
+ *
+ * There is one unit and every transport (UART, USB, Ethernet framing, the
+ * QSPI recorder) uses it, from thread and interrupt context. A caller
+ * owns it from the start of a computation to its result. A caller that
+ * finds it owned, e.g. an interrupt preempting the main loop or any caller
+ * during a DMA job, gets HAL_BUSY and computes in software instead, so no
+ * one ever waits for the unit. Before crcUnit_init(), every call returns
+ * HAL_BUSY.
+ *
+ * Usage Example:
+ *   uint16_t crc = 0xFFFFU;
+ *   if (crcUnit_crc16(raw, len, &crc) != HAL_OK) {
+ *     crc = softwareCrc16(raw, len);
+ *   }
+ *
+ *   // large block, main loop
+ *   crcUnit_startDma(CRC_UNIT_CRC32, 0, frames, bytes);
+ *   ...
+ *   if (crcUnit_getDmaResult(&crc32) == HAL_OK) { ... }
+ *
+ * @note The DMA reads memory behind the D-cache; crcUnit_startDma() cleans
+ *       the block, which must not change until the result is read.
+ ******************************************************************************
+ */
+
+#ifndef CRC_UNIT_H
+#define CRC_UNIT_H
+
+#include "irq_priority.h"
+#include "stm32f7xx_hal.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+
+/**
+ * @brief Set to 0 to compute every CRC in software (e.g. the host build)
+ */
+#ifndef CRC_UNIT_ENABLE
+#define CRC_UNIT_ENABLE 1
+#endif
+
+/**
+ * @brief Smallest block crcUnit_startDma() hands to the DMA; shorter ones
+ *        are fed by the CPU at once
+ */
+#ifndef CRC_UNIT_DMA_MIN_BYTES
+#define CRC_UNIT_DMA_MIN_BYTES 1024U
+#endif
+
+/**
+ * @brief NVIC priority of DMA2 Stream7
+ */
+#ifndef CRC_UNIT_IRQ_PRIORITY
+#define CRC_UNIT_IRQ_PRIORITY IRQ_PRIORITY_BULK
+#endif
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief CRC variants the unit is set up for
+ */
+typedef enum {
+  CRC_UNIT_CRC16 = 0, ///< poly 0x1021, init 0xFFFF, no reflection
+  CRC_UNIT_CRC32      ///< IEEE 802.3, reflected, final XOR
+} CrcUnit_Algo_t;
+
+/**
+ * @brief Usage counters
+ */
+typedef struct {
+  uint32_t computed;  ///< CRCs computed by the unit, CPU-fed
+  uint32_t busy;      ///< Requests refused because the unit was owned
+  uint32_t dma_jobs;  ///< DMA blocks completed
+  uint32_t dma_bytes; ///< Bytes fed by DMA
+  uint32_t dma_errors;
+} CrcUnit_Stats_t;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief Enable the CRC and DMA2 clocks and set up DMA2 Stream7
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR DMA set-up failed; the unit stays unused
+ */
+HAL_StatusTypeDef crcUnit_init(void);
+
+/**
+ * @brief CRC-16 of a buffer, fed by the CPU
+ *
+ * @param data Bytes, any alignment
+ * @param len  Byte count
+ * @param crc  Result, untouched unless HAL_OK
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_BUSY  Unit owned or not initialised: compute in software
+ *   @retval HAL_ERROR NULL pointer
+ */
+HAL_StatusTypeDef crcUnit_crc16(const uint8_t *data, uint32_t len,
+                                uint16_t *crc);
+
+/**
+ * @brief CRC-32 of a buffer, running, fed by the CPU
+ *
+ * @param prev Result over the preceding bytes, 0 to start
+ * @param data Bytes, any alignment
+ * @param len  Byte count
+ * @param crc  Result, untouched unless HAL_OK
+ *
+ * @return HAL_StatusTypeDef (as crcUnit_crc16())
+ */
+HAL_StatusTypeDef crcUnit_crc32(uint32_t prev, const uint8_t *data,
+                                uint32_t len, uint32_t *crc);
+
+/**
+ * @brief Start a CRC over a large block by memory-to-memory DMA
+ *
+ * The unit stays owned until the transfer completes. Blocks shorter than
+ * CRC_UNIT_DMA_MIN_BYTES are computed before returning.
+ *
+ * @param algo Variant
+ * @param prev CRC-32: result over the preceding bytes, 0 to start;
+ *             CRC-16: ignored
+ * @param data Block, unchanged until the result is read
+ * @param len  Byte count
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Started (or done)
+ *   @retval HAL_BUSY  Unit owned, a result not read yet or not initialised
+ *   @retval HAL_ERROR Invalid argument or DMA start failed
+ */
+HAL_StatusTypeDef crcUnit_startDma(CrcUnit_Algo_t algo, uint32_t prev,
+                                   const void *data, uint32_t len);
+
+/**
+ * @brief Result of the crcUnit_startDma() job
+ *
+ * @param crc Result (CRC-16 in the low half), untouched unless HAL_OK
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Result read; the next job may start
+ *   @retval HAL_BUSY  Transfer still running
+ *   @retval HAL_ERROR No job, DMA error (compute in software) or NULL
+ */
+HAL_StatusTypeDef crcUnit_getDmaResult(uint32_t *crc);
+
+/**
+ * @brief Get the usage counters
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer
+ */
+HAL_StatusTypeDef crcUnit_getStats(CrcUnit_Stats_t *stats);
+
+/**
+ * @brief DMA2 Stream7 interrupt; call from DMA2_Stream7_IRQHandler()
+ */
+void crcUnit_dmaIrqHandler(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CRC_UNIT_H */
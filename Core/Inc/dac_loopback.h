@@ -0,0 +1,314 @@
+/**
+ ******************************************************************************
+ * @file    dac_loopback.h
+ * @brief   DAC loopback self-test: latency, frame rate and ENOB in the field
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * DAC1 OUT1 is PA4, the pin of ADC1/2 IN4. With the DAC output enabled the
+ * test channel converts what the DAC drives, with no wiring: sensor 2 Y
+ * must be unplugged (or its RC filter opened) for the run, since the DAC
+ * buffer and the sensor would fight over the pin. Outside a run the DAC is
+ * disabled and the pin is a plain analog input again.
+ *
+ * A run has two parts, on the scan that is running (TIM2-paced):
+ *
+ *   1. Steps. DAC_LOOP_STEPS level steps between DAC_LOOP_LOW_CODE and
+ *      DAC_LOOP_HIGH_CODE, written from the main loop at a phase that
+ *      walks across the frame period. dacLoop_processBlock(), at the end of
+ *      the block path, finds the first frame past the mid-level and answers
+ *      with the reaction pin. Per step it measures
+ *        - step -> sample:   DAC write to the conversion time of that frame
+ *                            (up to a frame period, plus the DAC settling);
+ *        - sample -> react:  that frame to the pin write, i.e. the rest of
+ *                            the block, the DMA hand-off and the pipeline.
+ *   2. Tone. TIM6 paces the DAC through DMA1 Stream5 from a
+ *      DAC_LOOP_TONE_POINTS-point sine table, and DAC_LOOP_TONE_FRAMES
+ *      consecutive frames of the test channel are kept. TIM2 and TIM6 run
+ *      from the same timer clock, so the tone-to-frame-rate ratio is exact
+ *      from their dividers, and a three-parameter sine fit (IEEE 1241) at
+ *      that ratio leaves the noise and distortion as the residual:
+ *        SINAD = 20 log10((A / sqrt 2) / rms residual)
+ *        ENOB  = (SINAD - 1.76) / 6.02
+ *      The DAC is 12 bits too, so the figure bounds the ADC from below.
+ *      The same frames go through dspQuality_analyse() (dsp_quality.h):
+ *      its SNR leaves out the harmonics, where the DAC's staircase images
+ *      land, so it is the closer figure for the ADC alone.
+ *
+ * dacLoop_startSweep() runs a third kind of run on its own: a linearity
+ * sweep. The DAC steps through DAC_LOOP_SWEEP_FIRST_CODE..LAST_CODE, one
+ * code per block, written by the block path itself; the frames converted
+ * DAC_LOOP_SWEEP_SETTLE_US after the write (analogSensor_getFrameTime())
+ * are averaged into the mean code x 16 of that point, the rest of the
+ * block is let pass. dacLoop_getSweep() hands the means to adcLin_build()
+ * (adc_linearity.h). With the defaults, 3584 codes at one 256-frame block
+ * each, a sweep takes about four minutes at 4 kHz.
+ *
+ * The measured frame rate comes from analogSensor_getTiming() at the end of
+ * the run. Sampling time and ADCCLK are those in force, so a sweep over
+ * the channel profiles (analogSensor_setChannelProfile()) and the clock
+ * profiles (clock_profile.h) shows where settling or the clock costs bits.
+ * The bench image runs that sweep; the application runs one pass at its
+ * active settings on the "selftest" host command.
+ *
+ * Concurrency model: dacLoop_start() and dacLoop_poll() in the main loop,
+ * dacLoop_processBlock() in the block callback (DMA interrupt).
+ *
+ * Usage Example:
+ *   const DacLoop_Config_t cfg = {.channel = ADC_CH_SENSOR2_Y,
+ *                                 .port = GPIOG, .pin = GPIO_PIN_2};
+ *   dacLoop_init(&cfg);
+ *   analogSensor_startTimedDMA(4000);
+ *   dacLoop_start();
+ *
+ *   // block callback, after the stages
+ *   dacLoop_processBlock(block, frame_count);
+ *
+ *   // main loop
+ *   if (dacLoop_poll() == HAL_OK) {
+ *     DacLoop_Result_t r;
+ *     dacLoop_getResult(&r);   // r.enob_centi, r.snr_centi_db, ...
+ *   }
+ *
+ * @note The reaction port's clock must be running (MX_GPIO_Init()).
+ ******************************************************************************
+ */
+
+#ifndef DAC_LOOPBACK_H
+#define DAC_LOOPBACK_H
+
+#include "stm32f7xx_hal.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+
+/**
+ * @brief Set to 1 to build the self-test into the application; PA4 is then
+ *        driven during a run
+ */
+#ifndef DAC_LOOPBACK_ENABLE
+#define DAC_LOOPBACK_ENABLE 0
+#endif
+
+/**
+ * @brief Level steps per run
+ */
+#ifndef DAC_LOOP_STEPS
+#define DAC_LOOP_STEPS 32U
+#endif
+
+/**
+ * @brief Step levels (DAC codes); the ADC threshold is their mid-point
+ */
+#ifndef DAC_LOOP_LOW_CODE
+#define DAC_LOOP_LOW_CODE 1024U
+#endif
+#ifndef DAC_LOOP_HIGH_CODE
+#define DAC_LOOP_HIGH_CODE 3072U
+#endif
+
+/**
+ * @brief Time a level is held before the next step, and how long a step
+ *        may take to show up before it counts as missed
+ */
+#ifndef DAC_LOOP_HOLD_MS
+#define DAC_LOOP_HOLD_MS 20U
+#endif
+#ifndef DAC_LOOP_STEP_TIMEOUT_MS
+#define DAC_LOOP_STEP_TIMEOUT_MS 500U
+#endif
+
+/**
+ * @brief Sine table length, and the tone as a fraction of the frame rate:
+ *        about frame rate / DAC_LOOP_TONE_DIVISOR (a prime, so the frames
+ *        land on many phases)
+ */
+#ifndef DAC_LOOP_TONE_POINTS
+#define DAC_LOOP_TONE_POINTS 64U
+#endif
+#ifndef DAC_LOOP_TONE_DIVISOR
+#define DAC_LOOP_TONE_DIVISOR 67U
+#endif
+
+/**
+ * @brief Tone amplitude around mid-scale (DAC codes); keeps the buffered
+ *        output clear of its rails
+ */
+#ifndef DAC_LOOP_TONE_AMPLITUDE
+#define DAC_LOOP_TONE_AMPLITUDE 1640U
+#endif
+
+/**
+ * @brief Frames of the test channel in the fit, and blocks let pass first
+ *        while the DMA-paced output settles
+ */
+#ifndef DAC_LOOP_TONE_FRAMES
+#define DAC_LOOP_TONE_FRAMES 4096U
+#endif
+#ifndef DAC_LOOP_SETTLE_BLOCKS
+#define DAC_LOOP_SETTLE_BLOCKS 2U
+#endif
+
+/**
+ * @brief Linearity sweep: DAC codes covered (clear of the buffered output's
+ *        rails, 0.2 V from each), codes between points
+ */
+#ifndef DAC_LOOP_SWEEP_FIRST_CODE
+#define DAC_LOOP_SWEEP_FIRST_CODE 256U
+#endif
+#ifndef DAC_LOOP_SWEEP_LAST_CODE
+#define DAC_LOOP_SWEEP_LAST_CODE 3839U
+#endif
+#ifndef DAC_LOOP_SWEEP_STEP
+#define DAC_LOOP_SWEEP_STEP 1U
+#endif
+
+/**
+ * @brief Linearity sweep: frames converted sooner than this after a DAC
+ *        write are left out of the mean (the buffer settles in a few us)
+ */
+#ifndef DAC_LOOP_SWEEP_SETTLE_US
+#define DAC_LOOP_SWEEP_SETTLE_US 50U
+#endif
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief Test channel and reaction output
+ */
+typedef struct {
+  uint8_t channel;    ///< Channel index on PA4 (ADC_CHANNEL_4 of ADC1/2)
+  GPIO_TypeDef *port; ///< Reaction output port
+  uint16_t pin;       ///< GPIO_PIN_x, one pin; follows the step direction
+} DacLoop_Config_t;
+
+/**
+ * @brief Result of a run; times in microseconds
+ */
+typedef struct {
+  uint8_t ok;               ///< Every step seen and the tone fitted
+  uint32_t adcclk_hz;       ///< ADCCLK of the active clock profile
+  uint32_t sampling_cycles; ///< Test channel sampling time, ADCCLK cycles
+  uint32_t rate_mhz;        ///< Measured frame rate (mHz)
+  uint32_t steps;           ///< Steps seen
+  uint32_t missed;          ///< Steps not seen within the timeout
+  uint32_t sample_min_us;   ///< DAC write -> frame past the mid-level
+  uint32_t sample_mean_us;
+  uint32_t sample_max_us;
+  uint32_t react_min_us;    ///< That frame -> reaction pin
+  uint32_t react_mean_us;
+  uint32_t react_max_us;
+  uint32_t total_max_us;    ///< Worst DAC write -> reaction pin
+  uint32_t tone_mhz;        ///< Tone frequency (mHz)
+  uint32_t amplitude;       ///< Fitted amplitude, ADC codes
+  int32_t sinad_centi_db;   ///< SINAD in 0.01 dB
+  int32_t enob_centi;       ///< ENOB in 0.01 bit
+  int32_t snr_centi_db;     ///< FFT figures of the same frames, 0.01 dB
+  int32_t thd_centi_db;
+  int32_t sfdr_centi_db;
+  int32_t fft_enob_centi;   ///< ENOB from the FFT SINAD, 0.01 bit
+  uint8_t sweep;            ///< A linearity sweep (no steps, no tone); ok
+                            ///< when every point was taken
+  uint32_t points;          ///< Sweep points taken
+} DacLoop_Result_t;
+
+/**
+ * @brief Means of the last complete linearity sweep
+ */
+typedef struct {
+  const uint16_t *mean_x16; ///< Mean test channel code x 16 per point
+  uint16_t first;           ///< DAC code of point 0
+  uint16_t step;            ///< DAC codes between points
+  uint16_t points;          ///< Points
+  uint8_t slot;             ///< Block slot of the test channel
+} DacLoop_Sweep_t;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief Set up the DAC (disabled), TIM6, DMA1 Stream5 and the reaction pin
+ *
+ * @param cfg Test channel and output, copied
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer, a channel not on PA4, not exactly one
+ *                     pin, or a DAC/TIM/DMA init failure
+ */
+HAL_StatusTypeDef dacLoop_init(const DacLoop_Config_t *cfg);
+
+/**
+ * @brief Start a run on the running scan
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Running; dacLoop_poll() reports the end
+ *   @retval HAL_BUSY  A run is in progress
+ *   @retval HAL_ERROR Not initialised, or no TIM2-paced scan running
+ */
+HAL_StatusTypeDef dacLoop_start(void);
+
+/**
+ * @brief Start a linearity sweep on the running scan
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Running; dacLoop_poll() reports the end
+ *   @retval HAL_BUSY  A run is in progress
+ *   @retval HAL_ERROR Not initialised, or no TIM2-paced scan running
+ */
+HAL_StatusTypeDef dacLoop_startSweep(void);
+
+/**
+ * @brief Abort a run; the DAC is disabled and no result is kept
+ */
+void dacLoop_stop(void);
+
+/**
+ * @brief Whether a run is in progress
+ */
+uint8_t dacLoop_isRunning(void);
+
+/**
+ * @brief Step detection, tone capture and sweep points; call at the end of
+ *        the block callback. Returns at once when no run is in progress.
+ */
+void dacLoop_processBlock(const uint16_t *block, uint32_t frame_count);
+
+/**
+ * @brief Advance the run: next step, tone start, fit at the end
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    A run just ended; dacLoop_getResult() has it
+ *   @retval HAL_BUSY  Running, or nothing to do
+ */
+HAL_StatusTypeDef dacLoop_poll(void);
+
+/**
+ * @brief Result of the last run
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer, or no run has ended yet
+ */
+HAL_StatusTypeDef dacLoop_getResult(DacLoop_Result_t *result);
+
+/**
+ * @brief Means of the last complete sweep; they stay valid until the next
+ *        run starts
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer, or no sweep has completed
+ */
+HAL_StatusTypeDef dacLoop_getSweep(DacLoop_Sweep_t *sweep);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DAC_LOOPBACK_H */
@@ -0,0 +1,188 @@
+/**
+ ******************************************************************************
+ * @file    digital_in.h
+ * @brief   Digital inputs sampled with every scan frame, as edge records
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * Lining up the vibration with discrete machine signals (valve open, relay
+ * closed) needs those signals on the frame grid. The scan trigger does the
+ * sampling: TIM1 sits in reset slave mode on TIM2 TRGO (ITR1), so every
+ * TIM2 update also updates TIM1, and TIM1_UP has DMA2 Stream5 copy the
+ * input port's IDR into a circular buffer. Every frame gets the state of
+ * DIGITAL_IN_PINS at its own trigger instant, with no interrupt and no CPU
+ * in the path:
+ *
+ *   DIGITAL_IN_PORT pins DIGITAL_IN_PINS (PE10-PE15 by default), inputs
+ *
+ * The block callback (digitalIn_processBlock()) finds the buffer entry of
+ * each frame as adc_mux.h does: with the newest block stamped after the
+ * latest TIM2 update, the DMA's position is the block's next frame. It
+ * then compares the block's frames with the state before them and queues
+ * an edge record for every frame whose inputs differ: its frame number,
+ * its trigger time on the timebase, the input levels and the pins changed.
+ * The frame numbers are those of the samples packets, so the host lines
+ * the edges up with the analog data without a search. An edge is placed
+ * to one frame period: it came between the trigger of the previous frame
+ * and that of its own. After the start, a new phase or a gap in the frames
+ * a record with no pin changed gives the state to start from.
+ *
+ * Usage Example:
+ *   digitalIn_init();
+ *   analogSensor_startTimedDMA(4000U);
+ *   digitalIn_start();
+ *
+ *   digitalIn_processBlock(frame_count);     // block callback
+ *
+ *   DigitalIn_Edge_t edge;
+ *   while (digitalIn_popEdge(&edge) == HAL_OK) {
+ *     // edge.frame, edge.time, edge.levels, edge.changed
+ *   }
+ *
+ * @note TIM1 and DMA2 Stream5 are taken while DIGITAL_IN_ENABLE is set,
+ *       so it excludes ADC_MUX_ENABLE. Only a TIM2-paced scan is sampled,
+ *       which PWM_SYNC_ENABLE does not have.
+ ******************************************************************************
+ */
+
+#ifndef DIGITAL_IN_H
+#define DIGITAL_IN_H
+
+#include "stm32f7xx_hal.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+
+/**
+ * @brief Set to 1 to sample the digital inputs (takes TIM1 and DMA2
+ *        Stream5)
+ */
+#ifndef DIGITAL_IN_ENABLE
+#define DIGITAL_IN_ENABLE 0
+#endif
+
+/**
+ * @brief Input port and pins (bit n = pin n of the port)
+ */
+#ifndef DIGITAL_IN_PORT
+#define DIGITAL_IN_PORT GPIOE
+#define DIGITAL_IN_CLK_ENABLE() __HAL_RCC_GPIOE_CLK_ENABLE()
+#endif
+#ifndef DIGITAL_IN_PINS
+#define DIGITAL_IN_PINS 0xFC00U
+#endif
+
+/**
+ * @brief Pull on the inputs: GPIO_PULLDOWN for open-collector high-side
+ *        drivers, GPIO_PULLUP for contacts to ground
+ */
+#ifndef DIGITAL_IN_PULL
+#define DIGITAL_IN_PULL GPIO_PULLDOWN
+#endif
+
+/**
+ * @brief Port samples in the DMA buffer, a power of two of at least two
+ *        blocks: the block callback must run before it laps
+ */
+#ifndef DIGITAL_IN_SAMPLES
+#define DIGITAL_IN_SAMPLES 1024U
+#endif
+
+/**
+ * @brief Edge records queued for the main loop (power of two)
+ */
+#ifndef DIGITAL_IN_EDGE_QUEUE
+#define DIGITAL_IN_EDGE_QUEUE 64U
+#endif
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief Inputs that changed at a frame
+ */
+typedef struct {
+  uint32_t frame;   ///< Scan frame sequence number, first with the new state
+  uint64_t time;    ///< Trigger of that frame (timebase ticks, 0 = unknown)
+  uint16_t levels;  ///< DIGITAL_IN_PINS levels at the frame
+  uint16_t changed; ///< Pins that differ from the frame before, 0 = state
+} DigitalIn_Edge_t;
+
+/**
+ * @brief Sampler counters
+ */
+typedef struct {
+  uint8_t running;     ///< TIM1 and the DMA follow TIM2
+  uint8_t aligned;     ///< The buffer entry of each frame is known
+  uint16_t pins;       ///< DIGITAL_IN_PINS
+  uint16_t levels;     ///< Levels at the newest frame
+  uint32_t frames;     ///< Frames compared
+  uint32_t edges;      ///< Records queued, state records included
+  uint32_t dropped;    ///< Records lost to a full queue
+  uint32_t realigned;  ///< Times the frame-to-entry phase moved
+  uint32_t dma_errors; ///< DMA transfer errors
+} DigitalIn_Stats_t;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief Set up the pins, TIM1 and DMA2 Stream5; nothing runs yet
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Ready
+ *   @retval HAL_ERROR Built without DIGITAL_IN_ENABLE, or a HAL init failed
+ */
+HAL_StatusTypeDef digitalIn_init(void);
+
+/**
+ * @brief Sample the inputs at every TIM2 update from now on
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Running; the first edges come once a block aligned it
+ *   @retval HAL_ERROR Not initialised, or the DMA did not start
+ */
+HAL_StatusTypeDef digitalIn_start(void);
+
+/**
+ * @brief Stop sampling; queued edges stay
+ */
+void digitalIn_stop(void);
+
+/**
+ * @brief Turn a completed block's frames into edge records
+ *
+ * @param frame_count Frames in the block (analogSensor_getBlockInfo())
+ *
+ * @note Block callback (ISR) only, before the next block replaces the info
+ */
+void digitalIn_processBlock(uint32_t frame_count);
+
+/**
+ * @brief Take the oldest queued edge record
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Record taken
+ *   @retval HAL_BUSY  Queue empty
+ *   @retval HAL_ERROR NULL pointer
+ */
+HAL_StatusTypeDef digitalIn_popEdge(DigitalIn_Edge_t *edge);
+
+/**
+ * @brief Copy the sampler counters
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer
+ */
+HAL_StatusTypeDef digitalIn_getStats(DigitalIn_Stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DIGITAL_IN_H */
@@ -0,0 +1,176 @@
+/**
+ ******************************************************************************
+ * @file    dma_tuning.h
+ * @brief   FIFO mode, threshold and memory burst of the DMA streams
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * In direct mode every peripheral request is one memory beat, so each
+ * stream asks the bus matrix for the AXI/AHB bus once per sample. With
+ * several streams running (ADC scan, external ADC, SDMMC, USART3) those
+ * single beats contend with the CPU and each other. With the FIFO on, a
+ * stream collects requests and writes (or reads) memory in bursts of 4, 8
+ * or 16 beats once a threshold of its 16-byte FIFO is reached.
+ *
+ * Each stream below has a setting, built from the DMA_TUNING_<STREAM>_*
+ * defaults and changed with dmaTuning_set(). It is written into the
+ * stream's DMA_InitTypeDef by dmaTuning_apply() just before HAL_DMA_Init(),
+ * so it takes effect at the stream's next initialisation, or at once with
+ * dmaTuning_reinit() while the stream is idle. The threshold is raised to
+ * what the stream's memory data size allows (even quarters for half-words,
+ * full for words) and a burst the threshold does not take whole is lowered
+ * to the largest that fits, so HAL_DMA_Init() never rejects a setting.
+ *
+ *   Stream      Memory side                        Burst
+ *   ADC         scan blocks, capture (words)       yes; single beats in a
+ *                                                  realigning pass
+ *   EXT_RX      external ADC blocks                yes
+ *   SDMMC       sector buffers, FIFO required      yes
+ *   USART3_TX   packets of any length              single beats only
+ *
+ * A burst never crosses a 1 kB boundary on the bus: every buffer of a
+ * bursting stream is ADC_DMA_ALIGNED and a whole number of cache lines,
+ * which keeps bursts of up to 16 bytes inside one.
+ *
+ * The Ethernet MAC and the USB OTG FS core have their own bus masters (and
+ * the FS core no DMA); they are not streams of DMA1/DMA2.
+ *
+ * Usage Example:
+ *   const DmaTuning_Config_t cfg = {.fifo = 1, .threshold = 2, .burst = 4};
+ *   dmaTuning_set(DMA_TUNING_EXT_RX, &cfg); // half FIFO, 4-beat bursts
+ *
+ *   // stream init
+ *   dmaTuning_apply(DMA_TUNING_EXT_RX, &hdma_ext_rx.Init);
+ *   HAL_DMA_Init(&hdma_ext_rx);
+ *
+ * @note The ADC and EXT_RX scans expect their ping-pong halves complete at
+ *       the half-transfer interrupt; with the FIFO on, up to a threshold of
+ *       samples may still be on their way. The block pool's double-buffer
+ *       mode completes on transfer-complete only, where the FIFO is drained.
+ ******************************************************************************
+ */
+
+#ifndef DMA_TUNING_H
+#define DMA_TUNING_H
+
+#include "stm32f7xx_hal.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+
+/**
+ * @brief Defaults per stream: FIFO on (1) or direct (0), threshold in
+ *        quarters of the FIFO (1..4), memory burst in beats (1, 4, 8, 16)
+ */
+#ifndef DMA_TUNING_ADC_FIFO
+#define DMA_TUNING_ADC_FIFO 0U
+#endif
+#ifndef DMA_TUNING_ADC_THRESHOLD
+#define DMA_TUNING_ADC_THRESHOLD 2U
+#endif
+#ifndef DMA_TUNING_ADC_BURST
+#define DMA_TUNING_ADC_BURST 4U
+#endif
+#ifndef DMA_TUNING_EXT_RX_FIFO
+#define DMA_TUNING_EXT_RX_FIFO 0U
+#endif
+#ifndef DMA_TUNING_EXT_RX_THRESHOLD
+#define DMA_TUNING_EXT_RX_THRESHOLD 2U
+#endif
+#ifndef DMA_TUNING_EXT_RX_BURST
+#define DMA_TUNING_EXT_RX_BURST 4U
+#endif
+#ifndef DMA_TUNING_SDMMC_THRESHOLD
+#define DMA_TUNING_SDMMC_THRESHOLD 4U
+#endif
+#ifndef DMA_TUNING_SDMMC_BURST
+#define DMA_TUNING_SDMMC_BURST 4U
+#endif
+#ifndef DMA_TUNING_UART_TX_FIFO
+#define DMA_TUNING_UART_TX_FIFO 0U
+#endif
+#ifndef DMA_TUNING_UART_TX_THRESHOLD
+#define DMA_TUNING_UART_TX_THRESHOLD 1U
+#endif
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief Tuned streams
+ */
+typedef enum {
+  DMA_TUNING_ADC = 0, ///< DMA2 stream 0, ADC1 (scan and capture)
+  DMA_TUNING_EXT_RX,  ///< DMA2 stream 3, SPI4 RX (ext_adc.h)
+  DMA_TUNING_SDMMC,   ///< DMA2 stream 6, SDMMC1 TX (sd_logger.h)
+  DMA_TUNING_UART_TX, ///< DMA1 stream 3, USART3 TX (telemetry.h)
+  DMA_TUNING_STREAM_COUNT
+} DmaTuning_Stream_t;
+
+/**
+ * @brief FIFO and memory burst of one stream
+ */
+typedef struct {
+  uint8_t fifo;      ///< 1 = FIFO mode, 0 = direct
+  uint8_t threshold; ///< FIFO threshold in quarters, 1..4
+  uint8_t burst;     ///< Memory burst in beats: 1, 4, 8 or 16
+} DmaTuning_Config_t;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief Change a stream's setting; used from its next initialisation
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Stored
+ *   @retval HAL_ERROR NULL pointer, unknown stream, a value out of range or
+ *                     direct mode on the SDMMC stream
+ */
+HAL_StatusTypeDef dmaTuning_set(DmaTuning_Stream_t stream,
+                                const DmaTuning_Config_t *cfg);
+
+/**
+ * @brief Current setting of a stream
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    cfg filled
+ *   @retval HAL_ERROR NULL pointer or unknown stream
+ */
+HAL_StatusTypeDef dmaTuning_get(DmaTuning_Stream_t stream,
+                                DmaTuning_Config_t *cfg);
+
+/**
+ * @brief Write a stream's FIFO mode, threshold and memory burst into its
+ *        init structure, the burst fitted to init->MemDataAlignment
+ */
+void dmaTuning_apply(DmaTuning_Stream_t stream, DMA_InitTypeDef *init);
+
+/**
+ * @brief Apply the setting to an idle stream and initialise it again
+ *
+ * @param stream Stream
+ * @param hdma   Its handle
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Reinitialised
+ *   @retval HAL_BUSY  A transfer is running or not finished yet
+ *   @retval HAL_ERROR NULL handle, unknown stream or HAL failure
+ */
+HAL_StatusTypeDef dmaTuning_reinit(DmaTuning_Stream_t stream,
+                                   DMA_HandleTypeDef *hdma);
+
+/**
+ * @brief Short name of a stream ("adc", "ext_rx", "sdmmc", "uart_tx")
+ */
+const char *dmaTuning_getName(DmaTuning_Stream_t stream);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DMA_TUNING_H */
@@ -0,0 +1,132 @@
+/**
+ ******************************************************************************
+ * @file    dsp_arrival.h
+ * @brief   Impact time of arrival per channel of a trigger capture, and a
+ *          line localisation from the arrival difference of two sensors
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * An impact reaches each sensor after its distance over the wave speed, so
+ * the arrival differences locate it. Per channel of a frozen capture
+ * (adc_trigger.h):
+ *   - baseline: mean and standard deviation of the leading frames, which
+ *     lie well before the trigger
+ *   - threshold: threshold_sigma deviations, at least min_threshold_codes
+ *   - onset: the first frame after the baseline whose |x - mean| reaches
+ *     the threshold, moved back to the crossing by linear interpolation
+ *     with the frame before, so the arrival is a fraction of a frame
+ *
+ * The deltas are onsets less the earliest, in frames; times follow from
+ * the frame period measured on the timebase (analogSensor_getFrameTime()).
+ * Samples flagged in error_mask are skipped.
+ *
+ * A threshold crossing is late by the rise time of the wave front to the
+ * threshold, the same on every channel for fronts of the same shape and
+ * size, so it cancels in the deltas; sensors far from each other or of
+ * different gain see some of it. The deltas also hold the scan skew: none
+ * between the channels of a simultaneous multimode scan, about 1 us per
+ * rank otherwise (analogSensor_setMultimode()).
+ *
+ * dspArrival_locateLine() places the impact on the line between two
+ * sensors from their delta and the wave speed in the structure.
+ *
+ * Usage Example:
+ *   const DSP_ArrivalConfig_t cfg = {.threshold_sigma = 8.0f,
+ *                                    .min_threshold_codes = 40,
+ *                                    .mask = 0x3F};
+ *   static DSP_ArrivalResult_t res;
+ *
+ *   // main loop, once a capture is frozen
+ *   if (dspArrival_compute(&cfg, frames, event->frame_count,
+ *                          event->pre_frames / 2U, &res) == HAL_OK) {
+ *     // res.delta_frames[ch] x frame period, for the channels in
+ *     // res.detected
+ *   }
+ *
+ * @note One pass over the baseline per channel, then up to its onset:
+ *       tens of us of the main loop for six channels.
+ ******************************************************************************
+ */
+
+#ifndef DSP_ARRIVAL_H
+#define DSP_ARRIVAL_H
+
+#include "adc_conversions.h"
+#include "arm_math.h"
+#include "stm32f7xx_hal.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief Onset detection settings
+ */
+typedef struct {
+  float32_t threshold_sigma;    ///< Threshold in baseline deviations
+  uint16_t min_threshold_codes; ///< Smallest threshold, above the noise
+  ADC_ChannelMask_t mask;       ///< Channels searched
+} DSP_ArrivalConfig_t;
+
+/**
+ * @brief Arrivals of one capture
+ */
+typedef struct {
+  ADC_ChannelMask_t detected; ///< Channels with an onset
+  uint8_t first_channel;      ///< Earliest of them
+  float32_t first_frame;      ///< Its onset, capture frames
+  float32_t onset_frame[ADC_CONVERSIONS_CHANNEL_COUNT];  ///< Capture frames
+  float32_t delta_frames[ADC_CONVERSIONS_CHANNEL_COUNT]; ///< Onset - first
+  uint16_t threshold_codes[ADC_CONVERSIONS_CHANNEL_COUNT]; ///< Applied
+} DSP_ArrivalResult_t;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief Onset of every channel of a capture and their differences
+ *
+ * @param cfg             Settings
+ * @param frames          Capture frames, channel order
+ * @param frame_count     Frames
+ * @param baseline_frames Leading frames of the baseline, 2 or more and
+ *                        before any arrival
+ * @param res             Result; onsets and deltas of channels without
+ *                        an onset read 0
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    At least one onset
+ *   @retval HAL_BUSY  No channel reached its threshold
+ *   @retval HAL_ERROR NULL pointer, a threshold_sigma not above 0, or
+ *                     baseline_frames below 2 or not below frame_count
+ */
+HAL_StatusTypeDef dspArrival_compute(const DSP_ArrivalConfig_t *cfg,
+                                     const ADC_Frame_t *frames,
+                                     uint32_t frame_count,
+                                     uint32_t baseline_frames,
+                                     DSP_ArrivalResult_t *res);
+
+/**
+ * @brief Position of an impact on the line from sensor a to sensor b
+ *
+ * t_a - t_b = (2 x - spacing) / speed, so x = (spacing + speed (t_a - t_b))
+ * / 2, limited to the segment.
+ *
+ * @param delta_us   Arrival at a less arrival at b
+ * @param spacing_m  Distance between the sensors
+ * @param speed_m_s  Wave speed in the structure
+ *
+ * @return float32_t Distance from sensor a, 0..spacing_m
+ */
+float32_t dspArrival_locateLine(float32_t delta_us, float32_t spacing_m,
+                                float32_t speed_m_s);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DSP_ARRIVAL_H */
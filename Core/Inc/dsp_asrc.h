@@ -0,0 +1,214 @@
+/**
+ ******************************************************************************
+ * @file    dsp_asrc.h
+ * @brief   Asynchronous sample-rate converter: the stream filter's
+ *          decimation taken on the nominal frame grid of the sync pulses
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * time_sync.h can discipline TIM2 itself, so every board triggers on the
+ * same instants. With the discipline off (timeSync_setDiscipline(0)) the
+ * HSI-paced scan runs free, hundreds of ppm off nominal, and time_sync
+ * only measures: the clock error of each pulse interval and the position
+ * of each pulse among the frames. This stage puts the stream back on the
+ * nominal grid in software, so the host can stack boards' streams sample
+ * for sample without resampling them.
+ *
+ * It replaces the "keep every Dth frame" step of dsp_filter.h: instead of
+ * frame (k + 1) D - 1 of the full-rate filtered signal, output k is taken
+ * at a fractional position, interpolated by a cubic Lagrange Farrow
+ * structure from the four filtered frames around it:
+ *
+ *   c0 = x0
+ *   c1 = -x-1 / 3 - x0 / 2 + x1 - x2 / 6
+ *   c2 =  x-1 / 2 - x0 + x1 / 2
+ *   c3 = -x-1 / 6 + x0 / 2 - x1 / 2 + x2 / 6
+ *   y  = ((c3 mu + c2) mu + c1) mu + c0,   0 <= mu < 1
+ *
+ * Interpolating at the scan rate, after the anti-alias filter, keeps the
+ * content far below the Nyquist of the interpolator (200 Hz of 4 kHz at
+ * the defaults), where a cubic is accurate; on the decimated stream it
+ * would not be. The sim bench (BM_dspAsrc) puts the error of a 200 ppm
+ * board below -120 dB of a 50 Hz tone and -75 dB at 190 Hz. x2 of a
+ * block's last output is in the next block, so that output comes with
+ * it. With the nominal step (ppm 0, no pulse) mu stays 0 and the outputs
+ * are those of the plain decimation, bit for bit.
+ *
+ * Positions are in scan frames, 32.32 fixed point. Output frame s (nominal
+ * frame s, s on the lattice of the plain decimation) lies at local
+ * position pos(s); pos advances by step = D (1 + ppm 1e-6) per output.
+ * dspAsrc_steer() hands over each new pulse: its local position and the
+ * measured ppm. At the next block the nominal frame nearest to it is
+ * rounded to a multiple of period (frames per pulse): every board puts the
+ * pulse on the same nominal frame, so equal sequence numbers are equal
+ * instants. The first pulse, or one off by more than an output, renumbers
+ * the outputs and moves pos by the remaining fraction of one, so the
+ * stream is neither cut nor repeated (a jump). After that half of the
+ * error is closed over the next interval, as time_sync does with the
+ * timer.
+ *
+ * Usage Example:
+ *   static DSP_Asrc_t asrc;
+ *   dspAsrc_init(&asrc);
+ *   dspFilter_setResampler(&filt, &asrc); // filter calls plan/interpolate
+ *
+ *   // main loop, on a new pulse
+ *   dspAsrc_steer(&asrc, pulse_pos_q32, sync.clock_ppm, frames_per_pulse);
+ *
+ * @note steer() from any context; plan() and interpolate() from the one
+ *       that runs the filter.
+ ******************************************************************************
+ */
+
+#ifndef DSP_ASRC_H
+#define DSP_ASRC_H
+
+#include "adc_conversions.h"
+#include "arm_math.h"
+#include "stm32f7xx_hal.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+
+/**
+ * @brief Set to 1 to leave TIM2 free-running and resample the stream
+ *        instead (main.c)
+ */
+#ifndef DSP_ASRC_ENABLE
+#define DSP_ASRC_ENABLE 0
+#endif
+
+/**
+ * @brief Accepted clock error; a step further off is clamped
+ */
+#ifndef DSP_ASRC_MAX_PPM
+#define DSP_ASRC_MAX_PPM 20000.0f
+#endif
+
+/**
+ * @brief Frames of the previous block the interpolator keeps per channel
+ */
+#define DSP_ASRC_HISTORY 3U
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief Where one output is taken in a block
+ */
+typedef struct {
+  int16_t index; ///< Frame of x0 in the block (< 0: previous block)
+  float32_t mu;  ///< Fraction from x0 towards x1
+} DSP_AsrcTap_t;
+
+/**
+ * @brief Counters
+ */
+typedef struct {
+  float32_t ppm;       ///< Clock error in use (+ = local clock fast)
+  float32_t error;     ///< Newest pulse minus the grid, frames
+  uint32_t anchors;    ///< Pulses steered on
+  uint32_t jumps;      ///< Of them, renumbered onto the pulse
+  uint32_t resets;     ///< Restarts (decimation changed)
+  uint32_t skipped;    ///< Outputs with no history, or no room, dropped
+  uint32_t frames_in;  ///< Full-rate frames taken
+  uint32_t frames_out; ///< Frames interpolated
+} DSP_Asrc_Stats_t;
+
+/**
+ * @brief Converter state (one instance per filter)
+ */
+typedef struct {
+  uint8_t started;          ///< A block has been planned
+  uint8_t anchored;         ///< A pulse set the phase
+  uint8_t history_frames;   ///< Valid frames in history
+  uint16_t decimation;      ///< D of the outputs
+  float32_t history[ADC_CONVERSIONS_CHANNEL_COUNT][DSP_ASRC_HISTORY]; ///< Tail
+  uint32_t seq;             ///< Nominal frame of the next output
+  uint64_t pos;             ///< Its local position (32.32)
+  uint64_t step;            ///< pos per output (32.32)
+  volatile uint8_t pending; ///< A pulse waits for the next block
+  uint64_t pending_pos;     ///< Its local position (32.32)
+  float32_t pending_ppm;    ///< Clock error measured with it
+  uint32_t pending_period;  ///< Frames per pulse
+  DSP_Asrc_Stats_t stats;
+} DSP_Asrc_t;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief Reset a converter to nominal rate, unanchored
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL instance
+ */
+HAL_StatusTypeDef dspAsrc_init(DSP_Asrc_t *asrc);
+
+/**
+ * @brief Steer the output grid on one pulse, from the next block
+ *
+ * @param asrc      Instance
+ * @param pulse_q32 Local position of the pulse, scan frames in 32.32
+ * @param ppm       Measured clock error over the last interval
+ * @param period    Scan frames per pulse at nominal rate (0 = rate only)
+ */
+void dspAsrc_steer(DSP_Asrc_t *asrc, uint64_t pulse_q32, float32_t ppm,
+                   uint32_t period);
+
+/**
+ * @brief Place the outputs of one block of full-rate frames
+ *
+ * @param asrc       Instance
+ * @param first      Scan frame of the block's first frame
+ * @param frames     Frames in the block, at least DSP_ASRC_HISTORY
+ * @param decimation D; a new D restarts the converter
+ * @param taps       Receives one entry per output
+ * @param max        Capacity of taps
+ * @param seq        Receives the nominal frame of output 0; output k is
+ *                   seq + k D
+ *
+ * @return Outputs placed
+ */
+uint32_t dspAsrc_plan(DSP_Asrc_t *asrc, uint32_t first, uint32_t frames,
+                      uint16_t decimation, DSP_AsrcTap_t *taps, uint32_t max,
+                      uint32_t *seq);
+
+/**
+ * @brief Interpolate one channel at the planned taps, then keep the tail
+ *        of its block for the next one
+ *
+ * @param asrc     Instance
+ * @param channel  Channel (history slot)
+ * @param filtered The block's full-rate filtered frames of that channel
+ * @param frames   Frames in filtered, as planned
+ * @param taps     From dspAsrc_plan()
+ * @param n        Outputs planned
+ * @param out      First output
+ * @param stride   Distance between outputs in out
+ */
+void dspAsrc_interpolate(DSP_Asrc_t *asrc, uint8_t channel,
+                         const float32_t *filtered, uint32_t frames,
+                         const DSP_AsrcTap_t *taps, uint32_t n,
+                         float32_t *out, uint32_t stride);
+
+/**
+ * @brief Get the counters
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer
+ */
+HAL_StatusTypeDef dspAsrc_getStats(const DSP_Asrc_t *asrc,
+                                   DSP_Asrc_Stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DSP_ASRC_H */
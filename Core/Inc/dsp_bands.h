@@ -0,0 +1,151 @@
+/**
+ ******************************************************************************
+ * @file    dsp_bands.h
+ * @brief   Octave, third-octave and custom log-spaced bands over FFT bins
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * A 1024-point spectrum has 513 bins, linear in frequency: 4 bins per
+ * octave at 10 Hz, 128 at 1 kHz. Vibration and acoustic levels are read in
+ * constant-percentage bands instead (IEC 61260), a few dozen values for the
+ * whole spectrum with the same relative resolution everywhere.
+ *
+ * A band table holds the edges of up to DSP_BANDS_MAX contiguous bands and
+ * the first FFT bin of each, worked out once for one length and rate. A
+ * bin belongs to the band its centre frequency falls in, lower edge
+ * included; DC belongs to none. Summing a band is then a run of adds over
+ * the Welch power sums, no search and no division per bin.
+ *
+ *   - dspBands_initFractional(): 1/1 or 1/3 octave, base-10 midbands
+ *     fm = 1000 x 10^(3 x / (10 b)) Hz and edges fm x 10^(+-3 / (20 b)),
+ *     b = 1 or 3; the bands whose midband is in low_hz..high_hz and whose
+ *     upper edge is at or below Nyquist. Low bands too narrow for a bin are
+ *     dropped, so the table starts above the last empty one.
+ *   - dspBands_initEdges(): any increasing edges, every band one bin wide
+ *     at least
+ *
+ * dsp_spectrum.h fills DSP_SpectrumResult_t.log_band_rms[] from the table
+ * in DSP_SpectrumConfig_t.band_table. After a rate change the spectrum
+ * keeps the same edges in Hz: the bins are then worked out from the edges
+ * per result, as dspBands_binRange() does for a length or rate the table
+ * was not built for.
+ *
+ * Usage Example:
+ *   static DSP_BandTable_t third;
+ *   dspBands_initFractional(&third, 3, 10.0f, 1600.0f, 1024, 4000.0f);
+ *   cfg.band_table = &third; // before dspSpectrum_init()
+ *
+ *   // res.log_band_rms[b] is the RMS of the band around
+ *   dspBands_centreHz(&third, b);
+ *
+ * @note A table is about 200 bytes, shared by every instance using it.
+ ******************************************************************************
+ */
+
+#ifndef DSP_BANDS_H
+#define DSP_BANDS_H
+
+#include "arm_math.h"
+#include "stm32f7xx_hal.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+
+/**
+ * @brief Bands per table: third octaves from 10 Hz to 12.5 kHz
+ */
+#ifndef DSP_BANDS_MAX
+#define DSP_BANDS_MAX 32U
+#endif
+
+#define DSP_BANDS_CUSTOM 0U       ///< DSP_BandTable_t.fraction of edges given
+#define DSP_BANDS_OCTAVE 1U       ///< ... of 1/1-octave bands
+#define DSP_BANDS_THIRD_OCTAVE 3U ///< ... of 1/3-octave bands
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief Band edges and their bins at one FFT length and rate
+ */
+typedef struct {
+  uint8_t fraction;         ///< DSP_BANDS_OCTAVE, _THIRD_OCTAVE or _CUSTOM
+  uint8_t count;            ///< Bands
+  uint16_t length;          ///< FFT length first_bin[] is for
+  float32_t sample_rate_hz; ///< ... and rate
+  float32_t edge_hz[DSP_BANDS_MAX + 1U]; ///< Band b: edge b to edge b + 1
+  uint16_t first_bin[DSP_BANDS_MAX + 1U]; ///< Band b: first_bin[b] up to
+                                          ///< first_bin[b + 1] - 1
+} DSP_BandTable_t;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief Build a table of 1/1- or 1/3-octave bands
+ *
+ * @param tbl            Table
+ * @param fraction       DSP_BANDS_OCTAVE or DSP_BANDS_THIRD_OCTAVE
+ * @param low_hz         Lowest midband wanted
+ * @param high_hz        Highest midband wanted
+ * @param length         FFT length the bins are for
+ * @param sample_rate_hz Rate of the transformed samples
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR Invalid argument, no band with a bin, or more than
+ *                     DSP_BANDS_MAX bands
+ */
+HAL_StatusTypeDef dspBands_initFractional(DSP_BandTable_t *tbl,
+                                          uint8_t fraction, float32_t low_hz,
+                                          float32_t high_hz, uint16_t length,
+                                          float32_t sample_rate_hz);
+
+/**
+ * @brief Build a table from custom edges
+ *
+ * @param tbl            Table
+ * @param edge_hz        count + 1 increasing edges, the first above 0 and
+ *                       the last at or below Nyquist
+ * @param count          Bands, 1..DSP_BANDS_MAX
+ * @param length         FFT length the bins are for
+ * @param sample_rate_hz Rate of the transformed samples
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR Invalid argument, or a band without a bin
+ */
+HAL_StatusTypeDef dspBands_initEdges(DSP_BandTable_t *tbl,
+                                     const float32_t *edge_hz, uint8_t count,
+                                     uint16_t length,
+                                     float32_t sample_rate_hz);
+
+/**
+ * @brief Geometric centre of a band, the midband of a fractional one
+ */
+float32_t dspBands_centreHz(const DSP_BandTable_t *tbl, uint8_t band);
+
+/**
+ * @brief Inclusive bins of a band at a length and rate; the table's own
+ *        bins when they match, else worked out from the edges
+ *
+ * @param tbl            Table
+ * @param band           Band, below tbl->count
+ * @param length         FFT length
+ * @param sample_rate_hz Rate of the transformed samples
+ * @param lo             First bin
+ * @param hi             Last bin, below lo when no bin is in the band
+ */
+void dspBands_binRange(const DSP_BandTable_t *tbl, uint8_t band,
+                       uint16_t length, float32_t sample_rate_hz, int32_t *lo,
+                       int32_t *hi);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DSP_BANDS_H */
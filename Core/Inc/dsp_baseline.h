@@ -0,0 +1,215 @@
+/**
+ ******************************************************************************
+ * @file    dsp_baseline.h
+ * @brief   Learned spectral baseline per channel and a deviation alarm
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * A machine's spectrum is its own reference: a level that is normal on one
+ * pump is a fault on the next. The baseline learns, per channel, the mean
+ * and the spread of every log band level (dsp_bands.h) from the spectrum
+ * results, and scores each new result by how far it is from them:
+ *
+ *   L_b = 20 log10(rms_b)                         band level, dB
+ *   z_b = (L_b - m_b) / max(s_b, SPREAD_MIN_DB)   deviation per band
+ *   score = max over b of |z_b|
+ *
+ * The largest band, not an average over the bands: a fault mostly shows
+ * in the few bands of its frequencies, and an average over two dozen
+ * would dilute it.
+ *
+ * The mean m_b and variance s_b^2 are exponentially weighted, updated in
+ * place from each result, no history kept: 8 bytes per band.
+ *   - learning: the first DSP_BASELINE_LEARN_WINDOWS results weigh 1 / n,
+ *     the plain mean and variance of what has been seen; no score
+ *   - tracking: after that the weight is 1 / DSP_BASELINE_TRACK_WINDOWS,
+ *     following slow drift (temperature, wear) but not a fault: a result
+ *     scoring above DSP_BASELINE_CLEAR_SCORE does not update the baseline
+ *
+ * The alarm is raised after DSP_BASELINE_ALARM_WINDOWS results in a row
+ * above DSP_BASELINE_ALARM_SCORE, and cleared after as many below
+ * DSP_BASELINE_CLEAR_SCORE. dspBaseline_update() reports these changes
+ * and the end of learning only, so the host hears from the node when the
+ * spectrum changes, and asks for spectra then.
+ *
+ * dspBaseline_save() packs a learned baseline into a record of 4 bytes per
+ * band (mean and spread in 0.01 dB) for the config store;
+ * dspBaseline_load() resumes tracking from one after a reset.
+ *
+ * Usage Example:
+ *   static DSP_Baseline_t bl ADC_FAST_BSS;
+ *   dspBaseline_reset(&bl, DSP_BANDS_THIRD_OCTAVE, third.count);
+ *
+ *   // main loop, with each spectrum result
+ *   switch (dspBaseline_update(&bl, res.log_band_rms, res.log_band_count)) {
+ *   case DSP_BASELINE_LEARNED: // save it
+ *   case DSP_BASELINE_RAISED:  // bl.score, bl.worst_band, bl.worst_db
+ *   ...
+ *   }
+ *
+ * @note Main loop only; nothing here is touched by an interrupt.
+ ******************************************************************************
+ */
+
+#ifndef DSP_BASELINE_H
+#define DSP_BASELINE_H
+
+#include "dsp_bands.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+
+/**
+ * @brief Bands per baseline
+ */
+#define DSP_BASELINE_MAX_BANDS DSP_BANDS_MAX
+
+/**
+ * @brief Results averaged before scoring: 33 s at a result per 512 ms
+ */
+#ifndef DSP_BASELINE_LEARN_WINDOWS
+#define DSP_BASELINE_LEARN_WINDOWS 64U
+#endif
+
+/**
+ * @brief Time constant of the tracking, in results: about 9 minutes
+ */
+#ifndef DSP_BASELINE_TRACK_WINDOWS
+#define DSP_BASELINE_TRACK_WINDOWS 1024U
+#endif
+
+/**
+ * @brief Smallest spread a band is scored against: a steady tone has
+ *        almost none
+ */
+#ifndef DSP_BASELINE_SPREAD_MIN_DB
+#define DSP_BASELINE_SPREAD_MIN_DB 0.5f
+#endif
+
+/**
+ * @brief Deviation in spreads that raises the alarm, and the one that
+ *        clears it
+ */
+#ifndef DSP_BASELINE_ALARM_SCORE
+#define DSP_BASELINE_ALARM_SCORE 4.0f
+#endif
+#ifndef DSP_BASELINE_CLEAR_SCORE
+#define DSP_BASELINE_CLEAR_SCORE 3.0f
+#endif
+
+/**
+ * @brief Results in a row it takes to raise or clear the alarm
+ */
+#ifndef DSP_BASELINE_ALARM_WINDOWS
+#define DSP_BASELINE_ALARM_WINDOWS 3U
+#endif
+
+/**
+ * @brief Record size for a number of bands
+ */
+#define DSP_BASELINE_RECORD_SIZE(bands) (4U + 4U * (uint32_t)(bands))
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief What a result changed
+ */
+typedef enum {
+  DSP_BASELINE_NONE = 0, ///< Nothing to report
+  DSP_BASELINE_LEARNED,  ///< Learning just completed, scores follow
+  DSP_BASELINE_RAISED,   ///< Alarm raised
+  DSP_BASELINE_CLEARED   ///< Alarm cleared
+} DSP_BaselineEvent_t;
+
+/**
+ * @brief Baseline of one channel
+ */
+typedef struct {
+  uint8_t fraction;    ///< Band table kind it was learned on
+  uint8_t band_count;  ///< Bands it was learned on
+  uint16_t windows;    ///< Results learned, saturates at UINT16_MAX
+  float32_t mean_db[DSP_BASELINE_MAX_BANDS]; ///< m_b
+  float32_t var_db[DSP_BASELINE_MAX_BANDS];  ///< s_b^2
+  uint8_t alarm;       ///< 1 = raised
+  uint8_t run;         ///< Results in a row towards the other alarm state
+  uint8_t worst_band;  ///< Band of the largest |z| in the newest result
+  float32_t worst_db;  ///< Its level minus the mean (dB)
+  float32_t score;     ///< Newest score (|z| of worst_band), 0 learning
+} DSP_Baseline_t;
+
+/**
+ * @brief Persisted form; DSP_BASELINE_RECORD_SIZE(band_count) bytes of it
+ *        are stored
+ */
+typedef struct {
+  uint16_t windows;
+  uint8_t fraction;
+  uint8_t band_count;
+  struct {
+    int16_t mean_cdb;  ///< m_b, 0.01 dB
+    uint16_t sd_cdb;   ///< s_b, 0.01 dB
+  } band[DSP_BASELINE_MAX_BANDS];
+} DSP_BaselineRecord_t;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief Forget the baseline and learn again on a band table
+ *
+ * @param bl         Baseline
+ * @param fraction   DSP_BandTable_t.fraction of the table
+ * @param band_count Its bands, 0 = no baseline (updates are ignored)
+ */
+void dspBaseline_reset(DSP_Baseline_t *bl, uint8_t fraction,
+                       uint8_t band_count);
+
+/**
+ * @brief Score one result against the baseline, then learn from it
+ *
+ * @param bl       Baseline
+ * @param band_rms RMS per band (codes)
+ * @param count    Bands in band_rms[], must match the baseline
+ *
+ * @return DSP_BaselineEvent_t; DSP_BASELINE_NONE as well on a band count
+ *         that does not match
+ */
+DSP_BaselineEvent_t dspBaseline_update(DSP_Baseline_t *bl,
+                                       const float32_t *band_rms,
+                                       uint8_t count);
+
+/**
+ * @brief Pack a learned baseline for the config store
+ *
+ * @param bl  Baseline
+ * @param rec Destination
+ *
+ * @return Bytes of rec to store, DSP_BASELINE_RECORD_SIZE(band_count); 0
+ *         while still learning
+ */
+uint16_t dspBaseline_save(const DSP_Baseline_t *bl, DSP_BaselineRecord_t *rec);
+
+/**
+ * @brief Resume from a stored record; the alarm starts cleared
+ *
+ * @param bl  Baseline, reset on the table in use
+ * @param rec Record
+ * @param len Its stored size
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Loaded, tracking
+ *   @retval HAL_ERROR NULL pointer, or a record of another table or size
+ */
+HAL_StatusTypeDef dspBaseline_load(DSP_Baseline_t *bl,
+                                   const DSP_BaselineRecord_t *rec,
+                                   uint16_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DSP_BASELINE_H */
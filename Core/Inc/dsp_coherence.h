@@ -0,0 +1,177 @@
+/**
+ ******************************************************************************
+ * @file    dsp_coherence.h
+ * @brief   Welch cross-spectra between channel pairs: phase, coherence and
+ *          transfer gain at selected frequencies
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * Structural diagnostics (mode shapes, looseness, soft foot) compare the
+ * phase of two axes, or of the same axis on the two sensors. This stage
+ * rides on the FFT stage (dsp_spectrum.h): it attaches a segment hook to
+ * the spectrum instance of each channel it uses, so it runs no transform
+ * of its own and keeps no samples.
+ *
+ * For each segment, once every input has delivered its bins, the stage
+ * accumulates per pair (x, y) and per selected frequency:
+ *   Sxx += |X|^2, Syy += |Y|^2, Sxy += conj(X) Y
+ * After cfg.averages segments (Welch, with the spectra's window and 50 %
+ * overlap) it publishes, at the bin nearest each frequency:
+ *   - coherence |Sxy|^2 / (Sxx Syy), 0..1: how much of y is linearly
+ *     explained by x at that frequency
+ *   - phase arg(Sxy) in degrees, y relative to x, positive = y leads
+ *   - gain |Sxy| / Sxx (the H1 estimate of |y / x|)
+ * With n averages, uncorrelated noise still shows a coherence of about
+ * 1 / n, so use 16 or more. A single segment always gives 1.
+ *
+ * Segments are matched by their number (DSP_Spectrum_t.segment_index): a
+ * segment one input dropped (overrun) is skipped by all and counted in
+ * missed. All inputs must run the same length and sample rate. A new rate
+ * that moves a bin restarts the average.
+ *
+ * The phase is only that of the signals if both samples of a frame share
+ * the sample instant: run a simultaneous multimode scan
+ * (analogSensor_setMultimode()). In triple mode the two tri-axis groups are
+ * converted one rank (about 1 us) apart, which adds 0.36 degrees per kHz to
+ * cross-group pairs. In the independent scan each rank of separation adds
+ * about as much.
+ *
+ * Usage Example:
+ *   static DSP_Spectrum_t spec[2];   // channels 0 and 3, same settings
+ *   static DSP_Coherence_t coh;
+ *   DSP_Spectrum_t *inputs[] = {&spec[0], &spec[1]};
+ *   const DSP_CoherenceConfig_t cfg = {.averages = 16,
+ *                                      .pair_count = 1,
+ *                                      .pairs = {{0, 3}},
+ *                                      .freq_count = 2,
+ *                                      .freq_hz = {25.0f, 50.0f}};
+ *   dspCoherence_init(&coh, &cfg, inputs, 2);
+ *
+ *   // main loop, after dspSpectrum_poll() of the inputs
+ *   DSP_CoherenceResult_t res;
+ *   if (dspCoherence_getResult(&coh, &res) == HAL_OK) {
+ *     // res.coherence[0][f], res.phase_deg[0][f]
+ *   }
+ ******************************************************************************
+ */
+
+#ifndef DSP_COHERENCE_H
+#define DSP_COHERENCE_H
+
+#include "dsp_spectrum.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+
+#define DSP_COHERENCE_MAX_INPUTS 4U ///< Spectrum instances per stage
+#define DSP_COHERENCE_MAX_PAIRS 4U  ///< Channel pairs per result
+#define DSP_COHERENCE_MAX_FREQS 4U  ///< Frequencies per pair
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief Channel pair; y is measured against x
+ */
+typedef struct {
+  uint8_t x;
+  uint8_t y;
+} DSP_CoherencePair_t;
+
+/**
+ * @brief Stage settings
+ */
+typedef struct {
+  uint8_t averages;   ///< Segments per result, >= 2
+  uint8_t pair_count; ///< Entries used in pairs[]
+  DSP_CoherencePair_t pairs[DSP_COHERENCE_MAX_PAIRS];
+  uint8_t freq_count; ///< Entries used in freq_hz[]
+  float32_t freq_hz[DSP_COHERENCE_MAX_FREQS]; ///< Frequencies to report
+} DSP_CoherenceConfig_t;
+
+/**
+ * @brief One averaged result, [pair][frequency]
+ */
+typedef struct {
+  uint32_t sequence;      ///< Results published so far
+  uint32_t first_segment; ///< Number of the first segment averaged
+  uint8_t averages;       ///< Segments averaged
+  uint8_t pair_count;
+  DSP_CoherencePair_t pairs[DSP_COHERENCE_MAX_PAIRS];
+  uint8_t freq_count;
+  float32_t hz[DSP_COHERENCE_MAX_FREQS]; ///< Centre of the bin used
+  float32_t coherence[DSP_COHERENCE_MAX_PAIRS][DSP_COHERENCE_MAX_FREQS];
+  float32_t phase_deg[DSP_COHERENCE_MAX_PAIRS][DSP_COHERENCE_MAX_FREQS];
+  float32_t gain[DSP_COHERENCE_MAX_PAIRS][DSP_COHERENCE_MAX_FREQS];
+} DSP_CoherenceResult_t;
+
+/**
+ * @brief Stage state
+ */
+typedef struct {
+  DSP_CoherenceConfig_t cfg;
+  DSP_Spectrum_t *inputs[DSP_COHERENCE_MAX_INPUTS];
+  uint8_t input_count;
+  uint8_t need;                                  ///< Inputs the pairs use
+  uint8_t pair_input[DSP_COHERENCE_MAX_PAIRS][2]; ///< x, y -> inputs[]
+  uint16_t bin[DSP_COHERENCE_MAX_FREQS];         ///< FFT bin per frequency
+  float32_t bins[DSP_COHERENCE_MAX_INPUTS][DSP_COHERENCE_MAX_FREQS][2];
+  uint32_t index;                                ///< Segment being gathered
+  uint8_t have;                                  ///< Inputs delivered
+  float32_t sxx[DSP_COHERENCE_MAX_PAIRS][DSP_COHERENCE_MAX_FREQS];
+  float32_t syy[DSP_COHERENCE_MAX_PAIRS][DSP_COHERENCE_MAX_FREQS];
+  float32_t sxy[DSP_COHERENCE_MAX_PAIRS][DSP_COHERENCE_MAX_FREQS][2];
+  uint8_t averaged;      ///< Segments in the sums
+  uint32_t first;        ///< Number of the first one
+  uint32_t missed;       ///< Segments not delivered by every input
+  DSP_CoherenceResult_t result; ///< Newest result
+  uint32_t result_seq;   ///< Results published
+  uint32_t read_seq;     ///< Results consumed
+} DSP_Coherence_t;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief Configure the stage and attach it to its spectrum instances
+ *
+ * Takes the segment hook of every input a pair uses.
+ *
+ * @param coh    Instance
+ * @param cfg    Settings, copied
+ * @param inputs Initialised spectrum instances, one per channel
+ * @param count  Entries in inputs, 1..DSP_COHERENCE_MAX_INPUTS
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer, fewer than 2 averages, no pair or
+ *                     frequency, a pair channel without input, or inputs
+ *                     with different lengths or rates
+ */
+HAL_StatusTypeDef dspCoherence_init(DSP_Coherence_t *coh,
+                                    const DSP_CoherenceConfig_t *cfg,
+                                    DSP_Spectrum_t *const *inputs,
+                                    uint8_t count);
+
+/**
+ * @brief Take the newest result if one was published
+ *
+ * Call from the context of dspSpectrum_poll().
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    result filled
+ *   @retval HAL_BUSY  Nothing new since the previous call
+ *   @retval HAL_ERROR NULL pointer
+ */
+HAL_StatusTypeDef dspCoherence_getResult(DSP_Coherence_t *coh,
+                                         DSP_CoherenceResult_t *result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DSP_COHERENCE_H */
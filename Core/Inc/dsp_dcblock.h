@@ -0,0 +1,130 @@
+/**
+ ******************************************************************************
+ * @file    dsp_dcblock.h
+ * @brief   First-order q15 DC blocker for the dynamic acceleration channels
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * A static 1 g on the vertical axis sits 819 codes off mid-scale and uses
+ * up q15 headroom in every stage after it. The blocker removes it, and any
+ * drift slower than its corner, with one multiply-add per sample:
+ *
+ *   y[n] = x[n] - x[n-1] + a y[n-1],  a = 1 - 2 pi fc / fs  (q15)
+ *
+ * A zero at DC and a pole just inside it: -3 dB at fc, -0.5 dB at 3 fc,
+ * 0.05 dB at 10 fc. The q15 product is kept to 64 bits (SMLAL) and the
+ * bits the output drops are fed back into the next sample, so the rounding
+ * leaves no DC of its own and the output settles to exactly zero on a
+ * constant input.
+ *
+ * Samples are q15 as in dsp_multirate.h, (code - 2048) x 8; the result
+ * saturates at the q15 range. pipeline.h wraps it as the dcblock() stage on
+ * ADC codes, centred back on mid-scale for the stages that follow.
+ *
+ * Only the branches that run it lose the DC: tilt (dsp_vector.h), the DC
+ * tracker and the raw stream read the blocks themselves and keep gravity.
+ *
+ * Usage Example:
+ *   static DSP_DcBlock_t dcb;
+ *   dspDcBlock_init(&dcb, 1.0f, 4000.0f); // 1 Hz corner at 4 kHz
+ *
+ *   // per channel, in the block callback (ISR)
+ *   dspDcBlock_runQ15(&dcb, ch, q, q, n);
+ *
+ * @note The state is per channel; a new frame rate needs dspDcBlock_init()
+ *       again, which also clears it.
+ ******************************************************************************
+ */
+
+#ifndef DSP_DCBLOCK_H
+#define DSP_DCBLOCK_H
+
+#include "adc_conversions.h"
+#include "arm_math.h"
+#include "stm32f7xx_hal.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+
+/**
+ * @brief Default corner: below the 10 Hz band of ISO 10816, above drift
+ */
+#ifndef DSP_DCBLOCK_CUTOFF_DEFAULT
+#define DSP_DCBLOCK_CUTOFF_DEFAULT 1.0f
+#endif
+
+/**
+ * @brief Mid-scale code, the zero of the q15 samples
+ */
+#define DSP_DCBLOCK_MID_CODE 2048.0f
+
+/**
+ * @brief q15 LSBs per ADC code (3 fraction bits)
+ */
+#define DSP_DCBLOCK_Q15_PER_CODE 8.0f
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief Blocker of every channel, one corner
+ */
+typedef struct {
+  q15_t alpha;                                ///< Pole, a in q15
+  float32_t cutoff_hz;                        ///< Corner a gives
+  q15_t x1[ADC_CONVERSIONS_CHANNEL_COUNT];    ///< Previous input
+  q15_t y1[ADC_CONVERSIONS_CHANNEL_COUNT];    ///< Previous output
+  int32_t carry[ADC_CONVERSIONS_CHANNEL_COUNT]; ///< Bits dropped last time
+  uint8_t primed[ADC_CONVERSIONS_CHANNEL_COUNT]; ///< x1 holds a sample
+} DSP_DcBlock_t;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief Set the corner and clear every channel
+ *
+ * The first sample of a channel seeds x1, so a large DC does not start
+ * as a step.
+ *
+ * @param blk            Instance
+ * @param cutoff_hz      -3 dB corner; rounded to the q15 pole (cutoff_hz
+ *                       then holds the one obtained)
+ * @param sample_rate_hz Rate of the samples it will see
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer, or a corner not above 0 or above a
+ *                     tenth of the rate
+ */
+HAL_StatusTypeDef dspDcBlock_init(DSP_DcBlock_t *blk, float32_t cutoff_hz,
+                                  float32_t sample_rate_hz);
+
+/**
+ * @brief Clear every channel's state, keeping the corner
+ *
+ * @param blk Instance
+ */
+void dspDcBlock_reset(DSP_DcBlock_t *blk);
+
+/**
+ * @brief Block the DC of consecutive q15 samples of one channel
+ *
+ * @param blk     Instance
+ * @param channel Channel of the samples
+ * @param in      Input
+ * @param out     Output, may be in
+ * @param count   Samples
+ */
+void dspDcBlock_runQ15(DSP_DcBlock_t *blk, uint8_t channel, const q15_t *in,
+                       q15_t *out, uint32_t count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DSP_DCBLOCK_H */
@@ -0,0 +1,132 @@
+/**
+ ******************************************************************************
+ * @file    dsp_dctrack.h
+ * @brief   Per-channel DC offset and drift tracking, with optional auto-zero
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * The zero-g output of a MEMS accelerometer drifts with temperature. Each
+ * channel's DC is tracked in the background by a fixed-point leaky
+ * integrator, updated once per block from the block mean:
+ *
+ *   bias += (mean - bias) >> shift      (codes, q16)
+ *
+ * The time constant is 2^shift blocks, about 8 s at the default shift of 7
+ * (64 ms blocks at 4 kHz). It scales with the block period when the frame
+ * rate changes. The first block seeds the bias, so there is no start-up
+ * ramp from zero.
+ *
+ * Auto-zero is optional, per consumer: each one subtracts the tracked DC
+ * before its own stages.
+ *   - PIPELINE_STAGE_AUTOZERO() (pipeline.h) moves it to mid-scale (2048)
+ *     in a branch, ahead of its stats or spectrum stages
+ *   - dspMultirate_attachDcTrack() centres the q15 decimation input on it:
+ *     a static 1 g on an axis no longer takes 819 of the 2048 codes of
+ *     headroom
+ * The stats packet reports the tracked bias of every channel.
+ *
+ * Usage Example:
+ *   static DSP_DcTrack_t dc;
+ *   dspDcTrack_init(&dc, DSP_DCTRACK_SHIFT_DEFAULT,
+ *                   analogSensor_getBlockChannelMap());
+ *
+ *   // in the block callback (ISR), before the auto-zeroed consumers
+ *   dspDcTrack_process(&dc, block, frame_count);
+ *
+ *   // anywhere
+ *   float32_t bias = dspDcTrack_getBias(&dc, 2);   // codes
+ ******************************************************************************
+ */
+
+#ifndef DSP_DCTRACK_H
+#define DSP_DCTRACK_H
+
+#include "adc_conversions.h"
+#include "arm_math.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+
+/**
+ * @brief Integrator shift: time constant in blocks is 1 << shift
+ */
+#ifndef DSP_DCTRACK_SHIFT_DEFAULT
+#define DSP_DCTRACK_SHIFT_DEFAULT 7U
+#endif
+#define DSP_DCTRACK_SHIFT_MAX 15U
+
+/**
+ * @brief Fraction bits of the tracked bias
+ */
+#define DSP_DCTRACK_FRAC_BITS 16U
+
+/**
+ * @brief Code the auto-zero stage moves the DC to
+ */
+#define DSP_DCTRACK_MID_CODE 2048
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief Tracker state (one instance per block stream), channel order
+ */
+typedef struct {
+  uint8_t shift;
+  uint8_t slot_channel[ADC_CONVERSIONS_CHANNEL_COUNT]; ///< Raw slot -> ch
+  volatile int32_t bias_q16[ADC_CONVERSIONS_CHANNEL_COUNT]; ///< Codes, q16
+  volatile uint32_t blocks; ///< Blocks tracked, 0 = no bias yet
+} DSP_DcTrack_t;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief Reset the tracker; the next block seeds the bias
+ *
+ * @param dc          Instance
+ * @param shift       1..DSP_DCTRACK_SHIFT_MAX, time constant 2^shift blocks
+ * @param channel_map Raw block slot -> channel (NULL = identity)
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL instance or shift out of range
+ */
+HAL_StatusTypeDef dspDcTrack_init(DSP_DcTrack_t *dc, uint8_t shift,
+                                  const uint8_t *channel_map);
+
+/**
+ * @brief Update every channel from one block of interleaved raw frames
+ *
+ * @param dc     Instance
+ * @param block  Raw frames
+ * @param frames Frames in the block
+ */
+void dspDcTrack_process(DSP_DcTrack_t *dc, const uint16_t *block,
+                        uint32_t frames);
+
+/**
+ * @brief Tracked DC of a channel
+ *
+ * @return float32_t ADC codes; 0 before the first block or for an invalid
+ *         channel
+ */
+float32_t dspDcTrack_getBias(const DSP_DcTrack_t *dc, uint8_t channel);
+
+/**
+ * @brief Tracked DC of a channel in q16 codes, for integer consumers
+ */
+static inline int32_t dspDcTrack_getBiasQ16(const DSP_DcTrack_t *dc,
+                                            uint8_t channel) {
+  return dc->bias_q16[channel];
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DSP_DCTRACK_H */
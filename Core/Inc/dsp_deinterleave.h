@@ -0,0 +1,156 @@
+/**
+ ******************************************************************************
+ * @file    dsp_deinterleave.h
+ * @brief   Interleaved-to-planar block transpose, on the CPU or on DMA2D
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * The scan writes frames (ch0 ch1 ... ch5 ch0 ...), while most CMSIS-DSP
+ * routines want one contiguous array per channel. This stage transposes a
+ * block into ADC_CONVERSIONS_CHANNEL_COUNT planes of plane_stride samples,
+ * in channel order. The 12-bit codes are valid q15 values, so the planes
+ * feed the _q15 routines (or arm_q15_to_float) directly.
+ *
+ * dspDeinterleave_process() is the CPU path: two frames per iteration, one
+ * 32-bit load per slot pair and frame, then PKHBT/PKHTB pack the same slot
+ * of both frames into one word, stored straight into its plane. That is
+ * one load and one store per channel and frame pair instead of two of each.
+ *
+ * dspDeinterleave_startDma2d() is the experimental off-CPU path. DMA2D in
+ * memory-to-memory mode with 16-bit pixels copies one channel per transfer:
+ * a "line" is one sample and the foreground line offset of CH - 1 pixels
+ * skips the other slots of the frame. The transfer-complete interrupt
+ * chains the next channel; after the last one the planes are invalidated
+ * in the D-cache and the done callback runs. One sample per line means one
+ * bus access per sample, so the engine is not faster than the CPU loop; it
+ * is worth it when the cycles go to an FFT in the meantime.
+ *
+ * Usage Example:
+ *   static uint16_t planes[ADC_CONVERSIONS_CHANNEL_COUNT]
+ *                         [ADC_CONVERSIONS_BLOCK_FRAMES] ADC_DMA_ALIGNED;
+ *
+ *   // CPU, in the block callback
+ *   dspDeinterleave_process(block, frame_count,
+ *                           analogSensor_getBlockChannelMap(), &planes[0][0],
+ *                           ADC_CONVERSIONS_BLOCK_FRAMES);
+ *   arm_rfft_q15(&rfft, (q15_t *)planes[2], spectrum);
+ *
+ *   // DMA2D
+ *   dspDeinterleave_initDma2d();
+ *   dspDeinterleave_startDma2d(block, frame_count,
+ *                              analogSensor_getBlockChannelMap(),
+ *                              &planes[0][0], ADC_CONVERSIONS_BLOCK_FRAMES,
+ *                              App_PlanesReady, NULL);
+ *
+ * @note The DMA2D planes must be ADC_DMA_ALIGNED and a plane a whole number
+ *       of cache lines, so the invalidation cannot drop a neighbour's data.
+ ******************************************************************************
+ */
+
+#ifndef DSP_DEINTERLEAVE_H
+#define DSP_DEINTERLEAVE_H
+
+#include "adc_conversions.h"
+#include "irq_priority.h"
+#include "stm32f7xx_hal.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+
+/**
+ * @brief DMA2D interrupt priority (completion only chains transfers)
+ */
+#ifndef DSP_DEINTERLEAVE_IRQ_PRIORITY
+#define DSP_DEINTERLEAVE_IRQ_PRIORITY IRQ_PRIORITY_BULK
+#endif
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief End of a DMA2D transpose, called from the DMA2D interrupt
+ *
+ * @param status HAL_OK when every plane is written, HAL_ERROR on a
+ *               transfer or configuration error (planes incomplete)
+ * @param ctx    Pointer given to dspDeinterleave_startDma2d()
+ */
+typedef void (*DSP_DeinterleaveDone_t)(HAL_StatusTypeDef status, void *ctx);
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief Transpose a block into per-channel planes on the CPU
+ *
+ * @param block        Interleaved frames, 4-byte aligned (DMA blocks are)
+ * @param frames       Frames in block
+ * @param channel_map  Raw block slot -> channel (NULL = identity)
+ * @param planar       Plane of channel ch at planar + ch * plane_stride
+ * @param plane_stride Samples per plane, >= frames
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Planes written
+ *   @retval HAL_ERROR NULL pointer or plane_stride < frames
+ */
+HAL_StatusTypeDef dspDeinterleave_process(const uint16_t *block,
+                                          uint32_t frames,
+                                          const uint8_t *channel_map,
+                                          uint16_t *planar,
+                                          uint32_t plane_stride);
+
+/**
+ * @brief Initialise DMA2D for the transpose (clock, interrupt, layer)
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Ready
+ *   @retval HAL_ERROR HAL initialisation failed
+ */
+HAL_StatusTypeDef dspDeinterleave_initDma2d(void);
+
+/**
+ * @brief Start an asynchronous transpose on DMA2D
+ *
+ * @param block        Interleaved frames; must stay valid until done runs
+ *                     (hold a block pool reference)
+ * @param frames       Frames in block, at most 65535
+ * @param channel_map  Raw block slot -> channel (NULL = identity); copied
+ * @param planar       Planes as for dspDeinterleave_process(), ADC_DMA_ALIGNED
+ * @param plane_stride Samples per plane, >= frames, a multiple of
+ *                     ADC_DCACHE_LINE_SIZE / 2
+ * @param done         Completion callback, may be NULL
+ * @param ctx          Passed to done
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    First transfer started
+ *   @retval HAL_BUSY  A transpose is in progress
+ *   @retval HAL_ERROR Not initialised, invalid argument or alignment
+ */
+HAL_StatusTypeDef dspDeinterleave_startDma2d(const uint16_t *block,
+                                             uint32_t frames,
+                                             const uint8_t *channel_map,
+                                             uint16_t *planar,
+                                             uint32_t plane_stride,
+                                             DSP_DeinterleaveDone_t done,
+                                             void *ctx);
+
+/**
+ * @brief Whether a DMA2D transpose is in progress
+ *
+ * @return uint8_t 1 busy, 0 idle
+ */
+uint8_t dspDeinterleave_isBusy(void);
+
+/**
+ * @brief DMA2D interrupt; call from DMA2D_IRQHandler()
+ */
+void dspDeinterleave_dma2dIrqHandler(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DSP_DEINTERLEAVE_H */
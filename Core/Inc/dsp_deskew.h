@@ -0,0 +1,147 @@
+/**
+ ******************************************************************************
+ * @file    dsp_deskew.h
+ * @brief   Inter-channel scan skew compensation: a fractional-delay FIR per
+ *          channel, in place on the raw block
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * A scan converts its ranks one after the other, so each channel is
+ * sampled a fixed time after the frame trigger (analogSensor_getScanSkew():
+ * the end of its rank's sampling phase). Between two channels that is a
+ * phase error of 2 pi f dt, growing with frequency: about 1 us per rank
+ * at the default ADCCLK, 0.36 degrees per rank at 1 kHz, enough to spoil
+ * coherence phases and arrival deltas. Multimode removes it between the
+ * channels of a rank but not between ranks.
+ *
+ * Each channel here goes through a 7-tap Lagrange fractional-delay FIR
+ * (order 6, maximally flat) designed for its own delay: the output of
+ * frame n is the channel's value at the trigger of frame n - 3, the same
+ * instant on every channel. All channels are thus delayed by
+ * DSP_DESKEW_LATENCY frames, as the median of dsp_despike.h delays its
+ * own. A channel sampled on the trigger (delay 0) passes bit for bit.
+ *
+ * The coefficients are Q14, their sum forced to exactly 1.0 so DC stays
+ * exact; samples are taken around mid-scale as q15 pairs. One output is
+ * four SMLAD over pairs of frames (the 8th tap is zero), a rounding shift
+ * and a USAT to 12 bits.
+ *
+ * Attached as the driver's block filter (analogSensor_setBlockFilter()),
+ * after the spike filter when both are on, so every consumer sees aligned
+ * frames.
+ *
+ * Usage Example:
+ *   static DSP_Deskew_t deskew;
+ *   float skew_ns[ADC_CONVERSIONS_CHANNEL_COUNT];
+ *   analogSensor_getScanSkew(skew_ns);
+ *   dspDeskew_init(&deskew, skew_ns, analogSensor_getBlockChannelMap());
+ *   dspDeskew_setRate(&deskew, 4000U);
+ *   analogSensor_setBlockFilter(dspDeskew_blockFilter, &deskew);
+ *
+ * @note dspDeskew_setRate() may run at a block boundary (DMA ISR), between
+ *       two blocks of the filter.
+ ******************************************************************************
+ */
+
+#ifndef DSP_DESKEW_H
+#define DSP_DESKEW_H
+
+#include "adc_conversions.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+
+/**
+ * @brief Set to 1 to build the skew compensation into the application
+ */
+#ifndef DSP_DESKEW_ENABLE
+#define DSP_DESKEW_ENABLE 0
+#endif
+
+#define DSP_DESKEW_TAPS 7U    ///< Lagrange order 6
+#define DSP_DESKEW_LATENCY 3U ///< Frames every channel is delayed by
+
+/**
+ * @brief Taps in the SMLAD loop (the last one zero) and frames of history
+ */
+#define DSP_DESKEW_PAIRED_TAPS 8U
+#define DSP_DESKEW_HISTORY (DSP_DESKEW_PAIRED_TAPS - 1U)
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief Compensation state (one instance per block stream)
+ */
+typedef struct {
+  uint8_t slot_channel[ADC_CONVERSIONS_CHANNEL_COUNT]; ///< Raw slot -> ch
+  float skew_ns[ADC_CONVERSIONS_CHANNEL_COUNT];        ///< Channel order
+  uint32_t rate_hz;                                    ///< 0 = pass-through
+  uint8_t primed;                                      ///< history is valid
+  /// Q14 taps per slot, ordered for SMLAD: {h[1], h[0]}, {h[3], h[2]}, ...
+  uint32_t coeffs[ADC_CONVERSIONS_CHANNEL_COUNT][DSP_DESKEW_PAIRED_TAPS / 2U];
+  int16_t history[ADC_CONVERSIONS_CHANNEL_COUNT][DSP_DESKEW_HISTORY]; ///< In
+  volatile uint32_t samples; ///< Frames filtered
+} DSP_Deskew_t;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief Configure an instance, pass-through until dspDeskew_setRate()
+ *
+ * @param ds          Instance
+ * @param skew_ns     Sampling instant of each channel after the trigger,
+ *                    channel order (analogSensor_getScanSkew())
+ * @param channel_map Raw block slot -> channel (NULL = identity)
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer, or a negative skew
+ */
+HAL_StatusTypeDef dspDeskew_init(DSP_Deskew_t *ds, const float *skew_ns,
+                                 const uint8_t *channel_map);
+
+/**
+ * @brief Design the filters for a frame rate
+ *
+ * @param ds      Instance
+ * @param rate_hz Frames per second (0 = pass-through)
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL instance, or a skew of a whole frame or more
+ *                     (left pass-through)
+ */
+HAL_StatusTypeDef dspDeskew_setRate(DSP_Deskew_t *ds, uint32_t rate_hz);
+
+/**
+ * @brief Align one block of interleaved raw frames in place
+ *
+ * @param ds     Instance
+ * @param block  Raw frames, slot order, 12-bit codes
+ * @param frames Frames in the block
+ */
+void dspDeskew_process(DSP_Deskew_t *ds, uint16_t *block, uint32_t frames);
+
+/**
+ * @brief ADC_BlockFilter_t adapter, ctx = the DSP_Deskew_t
+ */
+void dspDeskew_blockFilter(uint16_t *block, uint32_t frames, void *ctx);
+
+/**
+ * @brief Delay a channel is compensated for
+ *
+ * @return float Frames at the current rate; 0 for an invalid channel
+ */
+float dspDeskew_getDelay(const DSP_Deskew_t *ds, uint8_t channel);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DSP_DESKEW_H */
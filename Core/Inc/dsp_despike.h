@@ -0,0 +1,154 @@
+/**
+ ******************************************************************************
+ * @file    dsp_despike.h
+ * @brief   Per-channel spike rejection: running median or Hampel-style
+ *          outlier replacement, in place on the raw block
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * EMI on the sensor lines shows up as single-sample spikes, which a linear
+ * filter only smears and which set the peak and crest factor of a whole
+ * stats window. A running median over 3, 5 or 7 frames removes them at the
+ * cost of a few compares per sample.
+ *
+ * The window is causal: frame n and the taps - 1 frames before it, carried
+ * over from the previous block. Two modes:
+ *   - DSP_DESPIKE_MEDIAN: the output is the window median. Spikes up to
+ *     (taps - 1) / 2 frames wide disappear, and the channel is delayed by
+ *     (taps - 1) / 2 frames against the unfiltered ones.
+ *   - DSP_DESPIKE_HAMPEL: the output is frame n itself, unless it lies more
+ *     than threshold codes from the window median; then it is the median.
+ *     No delay, and the signal is untouched below the threshold. This is
+ *     a Hampel identifier with a fixed scale instead of k x MAD: a MAD
+ *     would cost a second median per sample.
+ * A fast edge can be taken for a spike for up to (taps - 1) / 2 frames in
+ * either mode, so choose the threshold above the largest real frame to
+ * frame step.
+ *
+ * dspDespike_process() works on slot pairs packed in 32-bit words, like
+ * dsp_stats.h. Every compare-exchange of the median sorting networks is
+ * one USUB16 and two SEL (min and max of both lanes), the outlier test and
+ * the changed-sample count are USUB16 + SEL as well: no branch per sample.
+ * The per-lane counts widen into 32-bit totals once per block.
+ *
+ * Attached as the driver's block filter (analogSensor_setBlockFilter()), it
+ * runs before the frame views, the ring, the channel stats and the block
+ * callback, so every consumer sees the cleaned samples.
+ *
+ * Usage Example:
+ *   static DSP_Despike_t despike;
+ *   const DSP_DespikeConfig_t cfg = {.taps = 5,
+ *                                    .mode = DSP_DESPIKE_HAMPEL,
+ *                                    .threshold = 400,
+ *                                    .channels = 0x3FU};
+ *   dspDespike_init(&despike, &cfg, analogSensor_getBlockChannelMap());
+ *   analogSensor_setBlockFilter(dspDespike_blockFilter, &despike);
+ *
+ *   uint32_t n = dspDespike_getReplaced(&despike, 0);   // channel 0
+ ******************************************************************************
+ */
+
+#ifndef DSP_DESPIKE_H
+#define DSP_DESPIKE_H
+
+#include "adc_conversions.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+
+/**
+ * @brief Set to 1 to build the spike filter into the application
+ */
+#ifndef DSP_DESPIKE_ENABLE
+#define DSP_DESPIKE_ENABLE 0
+#endif
+
+#define DSP_DESPIKE_MAX_TAPS 7U ///< Longest median window
+
+/**
+ * @brief Slot pairs per frame; an odd last slot runs with an empty lane
+ */
+#define DSP_DESPIKE_PAIRS ((ADC_CONVERSIONS_CHANNEL_COUNT + 1U) / 2U)
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief Output rule
+ */
+typedef enum {
+  DSP_DESPIKE_MEDIAN = 0, ///< Window median (delays by (taps - 1) / 2)
+  DSP_DESPIKE_HAMPEL      ///< Median only for samples beyond threshold
+} DSP_DespikeMode_t;
+
+/**
+ * @brief Filter settings
+ */
+typedef struct {
+  uint8_t taps;               ///< Window length: 3, 5 or 7
+  DSP_DespikeMode_t mode;     ///< Output rule
+  uint16_t threshold;         ///< DSP_DESPIKE_HAMPEL: codes from the median
+  ADC_ChannelMask_t channels; ///< Channels filtered; the others pass
+} DSP_DespikeConfig_t;
+
+/**
+ * @brief Filter state (one instance per block stream)
+ */
+typedef struct {
+  DSP_DespikeConfig_t cfg;
+  uint32_t lane_mask[DSP_DESPIKE_PAIRS]; ///< 0xFFFF per filtered lane
+  uint8_t slot_channel[ADC_CONVERSIONS_CHANNEL_COUNT]; ///< Raw slot -> ch
+  uint8_t primed;                                      ///< history is valid
+  uint32_t history[DSP_DESPIKE_PAIRS][DSP_DESPIKE_MAX_TAPS - 1U]; ///< Input
+  volatile uint32_t replaced[ADC_CONVERSIONS_CHANNEL_COUNT]; ///< Channel order
+  volatile uint32_t samples; ///< Frames filtered
+} DSP_Despike_t;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief Configure an instance; the first block seeds the window
+ *
+ * @param ds          Instance
+ * @param cfg         Settings, copied
+ * @param channel_map Raw block slot -> channel (NULL = identity)
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer, taps other than 3/5/7, or no channel
+ */
+HAL_StatusTypeDef dspDespike_init(DSP_Despike_t *ds,
+                                  const DSP_DespikeConfig_t *cfg,
+                                  const uint8_t *channel_map);
+
+/**
+ * @brief Filter one block of interleaved raw frames in place
+ *
+ * @param ds     Instance
+ * @param block  Raw frames, slot order
+ * @param frames Frames in the block
+ */
+void dspDespike_process(DSP_Despike_t *ds, uint16_t *block, uint32_t frames);
+
+/**
+ * @brief ADC_BlockFilter_t adapter, ctx = the DSP_Despike_t
+ */
+void dspDespike_blockFilter(uint16_t *block, uint32_t frames, void *ctx);
+
+/**
+ * @brief Samples of a channel the filter changed
+ *
+ * @return uint32_t Count since dspDespike_init(); 0 for an invalid channel
+ */
+uint32_t dspDespike_getReplaced(const DSP_Despike_t *ds, uint8_t channel);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DSP_DESPIKE_H */
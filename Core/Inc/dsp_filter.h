@@ -0,0 +1,213 @@
+/**
+ ******************************************************************************
+ * @file    dsp_filter.h
+ * @brief   Per-channel CMSIS-DSP biquad low-pass and decimation stage
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * Runs block-wise on the DMA half-buffers: each channel is deinterleaved
+ * into a float work buffer, filtered by its own biquad cascade
+ * (arm_biquad_cascade_df2T_f32) and decimated, so the uplink can carry
+ * anti-aliased data at a fraction of the raw rate.
+ *
+ * Filters are described by DSP_FilterDesign_t entries (stage count plus
+ * CMSIS coefficients {b0, b1, b2, a1, a2} per stage, feedback terms already
+ * negated as CMSIS expects). dspFilter_lowpass200Hz is the default: a
+ * 4th-order Butterworth at 200 Hz for 4 kHz input, matched to decimation by
+ * 8 (500 Hz output, 250 Hz Nyquist).
+ *
+ * Output: two ping-pong blocks of decimated frames in channel order (float,
+ * ADC codes). The ISR fills one while the consumer reads the other.
+ *
+ * With a resampler attached (dspFilter_setResampler(), dsp_asrc.h) the
+ * decimated frames are interpolated on the nominal grid of the sync
+ * pulses instead of picked; a block then holds a frame more or less now
+ * and then, and first_input follows the nominal numbering.
+ *
+ * Usage Example:
+ *   static DSP_Filter_t filt;
+ *   dspFilter_init(&filt, 8, analogSensor_getBlockChannelMap());
+ *   dspFilter_configChannel(&filt, 0, &dspFilter_lowpass200Hz);
+ *
+ *   // in the block callback (ISR)
+ *   dspFilter_process(&filt, block, frame_count);
+ *
+ *   // main loop
+ *   const float32_t *out;
+ *   uint32_t frames;
+ *   if (dspFilter_getOutput(&filt, &out, &frames, NULL) == HAL_OK) {
+ *     // out[frame * ADC_CONVERSIONS_CHANNEL_COUNT + channel]
+ *   }
+ *
+ * @note Requires ARM_MATH_CM7 and libarm_cortexM7lfsp_math.a (linked by
+ *       CMakeLists.txt).
+ ******************************************************************************
+ */
+
+#ifndef DSP_FILTER_H
+#define DSP_FILTER_H
+
+#include "adc_conversions.h"
+#include "arm_math.h"
+#include "dsp_asrc.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+
+/**
+ * @brief Maximum biquad stages per channel (2 poles each)
+ */
+#ifndef DSP_FILTER_MAX_STAGES
+#define DSP_FILTER_MAX_STAGES 4U
+#endif
+
+/**
+ * @brief Coefficients per biquad stage in CMSIS order
+ */
+#define DSP_FILTER_COEFFS_PER_STAGE 5U
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief One entry of the coefficient table
+ */
+typedef struct {
+  uint8_t num_stages;       ///< 1..DSP_FILTER_MAX_STAGES
+  const float32_t *coeffs;  ///< num_stages x {b0, b1, b2, a1, a2}
+} DSP_FilterDesign_t;
+
+/**
+ * @brief Filter stage state (one instance per block stream)
+ */
+typedef struct {
+  uint8_t slot_channel[ADC_CONVERSIONS_CHANNEL_COUNT]; ///< Raw slot -> ch
+  uint16_t decimation;                                ///< Output every Nth
+  arm_biquad_cascade_df2T_instance_f32 biquad[ADC_CONVERSIONS_CHANNEL_COUNT];
+  float32_t state[ADC_CONVERSIONS_CHANNEL_COUNT][2U * DSP_FILTER_MAX_STAGES];
+  uint8_t enabled[ADC_CONVERSIONS_CHANNEL_COUNT];     ///< 0 = pass-through
+  float32_t output[2][ADC_CONVERSIONS_BLOCK_SAMPLES]; ///< Ping-pong output
+  uint32_t output_frames;                             ///< Frames per output
+  uint16_t output_decimation; ///< Decimation the newest output was taken at
+  uint32_t output_start[2]; ///< Input frame index of each output's first frame
+  uint32_t frames_in;       ///< Input frames processed since init
+  DSP_Asrc_t *asrc;         ///< Resampler of the decimation, NULL = none
+  volatile uint32_t blocks_done;                      ///< Written by process
+  uint32_t blocks_read;                               ///< Written by reader
+  uint32_t blocks_missed; ///< Outputs replaced before they were read
+} DSP_Filter_t;
+
+/* Exported variables --------------------------------------------------------*/
+
+/**
+ * @brief 4th-order Butterworth low-pass, fc = 200 Hz at fs = 4 kHz
+ */
+extern const DSP_FilterDesign_t dspFilter_lowpass200Hz;
+
+/**
+ * @brief 4th-order Butterworth band-pass, 500..1500 Hz (-3 dB) at
+ *        fs = 4 kHz: the resonance band ahead of an envelope (pipeline.h)
+ */
+extern const DSP_FilterDesign_t dspFilter_bandpass500to1500Hz;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief Reset a filter stage; all channels start as pass-through
+ *
+ * @param filt        Instance
+ * @param decimation  Keep every Nth frame, must divide
+ *                    ADC_CONVERSIONS_BLOCK_FRAMES (1 = no decimation)
+ * @param channel_map Raw block slot -> channel (NULL = identity)
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL instance or invalid decimation
+ */
+HAL_StatusTypeDef dspFilter_init(DSP_Filter_t *filt, uint16_t decimation,
+                                 const uint8_t *channel_map);
+
+/**
+ * @brief Attach a design from the coefficient table to one channel
+ *
+ * @param filt    Instance (not being fed while this runs)
+ * @param channel Channel index
+ * @param design  Coefficient table entry, NULL = pass-through
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success, filter state cleared
+ *   @retval HAL_ERROR Invalid argument
+ */
+HAL_StatusTypeDef dspFilter_configChannel(DSP_Filter_t *filt, uint8_t channel,
+                                          const DSP_FilterDesign_t *design);
+
+/**
+ * @brief Change the decimation, keeping the filter state and frame count
+ *
+ * @param filt       Instance
+ * @param decimation New factor, must divide ADC_CONVERSIONS_BLOCK_FRAMES
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Applies from the next block (output_decimation tells
+ *                     which factor the newest output used)
+ *   @retval HAL_ERROR NULL instance or invalid decimation
+ */
+HAL_StatusTypeDef dspFilter_setDecimation(DSP_Filter_t *filt,
+                                          uint16_t decimation);
+
+/**
+ * @brief Take the decimated frames on the nominal grid of a resampler
+ *
+ * @param filt Instance (not being fed while this runs)
+ * @param asrc Initialised resampler, NULL = plain decimation again
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL instance
+ */
+HAL_StatusTypeDef dspFilter_setResampler(DSP_Filter_t *filt,
+                                         DSP_Asrc_t *asrc);
+
+/**
+ * @brief Filter and decimate one block of interleaved raw frames
+ *
+ * @param filt   Instance
+ * @param block  Raw frames
+ * @param frames Frames in the block, at most ADC_CONVERSIONS_BLOCK_FRAMES;
+ *               the decimation runs across blocks, so a block shorter than
+ *               the factor may yield no output
+ */
+void dspFilter_process(DSP_Filter_t *filt, const uint16_t *block,
+                       uint32_t frames);
+
+/**
+ * @brief Take the newest output block, if any
+ *
+ * @param filt   Instance
+ * @param out    Receives decimated frames in channel order
+ * @param frames Receives the frame count
+ * @param first_input Receives the input frame index the block started at
+ *                    (output k = input first_input + (k + 1) *
+ *                    output_decimation - 1),
+ *                    NULL if not needed
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    New block, valid for one input block period (older
+ *                     ones not taken in time count in blocks_missed)
+ *   @retval HAL_BUSY  Nothing new since the previous call
+ *   @retval HAL_ERROR NULL pointer
+ */
+HAL_StatusTypeDef dspFilter_getOutput(DSP_Filter_t *filt,
+                                      const float32_t **out, uint32_t *frames,
+                                      uint32_t *first_input);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DSP_FILTER_H */
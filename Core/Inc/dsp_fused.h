@@ -0,0 +1,222 @@
+/**
+ ******************************************************************************
+ * @file    dsp_fused.h
+ * @brief   Single-pass unpack, calibrate, filter and stats kernel
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * adcCal_convertBlock_q15(), dspFilter_process() and dspStats_accumulate()
+ * each walk the interleaved DMA block on their own, and the filter works on
+ * raw codes. dspFused_process() does all of it in one pass, two frames per
+ * iteration. Each frame is one 32-bit load per slot pair (three with the
+ * default table; an odd last slot is loaded alone), then:
+ *   - stats of the raw codes: PKHBT/PKHTB repack the two frames so SMLAD
+ *     adds two squares of one channel (as dsp_stats.h), USUB16 + SEL keep
+ *     min/max of two channels
+ *   - calibration: SSUB16 removes the zero-g offsets of a slot pair, and
+ *     three SMLAD per output channel apply its 3x3 matrix row, two input
+ *     channels per instruction, on the (at most three) pairs holding its
+ *     sensor group, so the cost stays linear in the channel count
+ *   - filter: a df2T biquad cascade per channel on the mg values (single
+ *     precision FPU), decimated on the fly
+ *   - optionally, before the offsets, one lookup per sample in the ADC's
+ *     linearity table (adc_linearity.h), code -> corrected code x 4
+ *   - optionally a Goertzel bank (dsp_goertzel.h) and a sliding DFT
+ *     (dsp_sdft.h) on the mg values before the filter, at the full rate,
+ *     and an amplitude histogram (dsp_histogram.h) of the raw codes
+ * Only the decimated mg frames are written back. The slot -> channel map
+ * and the offsets are folded into the packed coefficients at init, so the
+ * loop only indexes the pairs of each row.
+ *
+ * Per-channel filter state and coefficients live in the instance; declare
+ * it ADC_FAST_BSS (DTCM) to keep them out of the D-cache.
+ *
+ * Usage Example:
+ *   static DSP_Fused_t fused ADC_FAST_BSS;
+ *   static float32_t mg[ADC_CONVERSIONS_BLOCK_SAMPLES / 8U];
+ *   adcCal_init();
+ *   dspFused_init(&fused, 8, analogSensor_getBlockChannelMap(),
+ *                 &dspFilter_lowpass200Hz);
+ *
+ *   // in the block callback (ISR)
+ *   uint32_t n = dspFused_process(&fused, block, frame_count, mg);
+ *   // mg[k * ADC_CONVERSIONS_CHANNEL_COUNT + channel], k < n
+ *
+ *   ADC_ChannelStats_t st[ADC_CONVERSIONS_CHANNEL_COUNT];
+ *   dspFused_getStats(&fused, st, 1);
+ *
+ * @note The M7 data path has no 8-bit lanes to use here (samples are
+ *       12-bit halfwords), so the SIMD steps are the 16-bit ones.
+ ******************************************************************************
+ */
+
+#ifndef DSP_FUSED_H
+#define DSP_FUSED_H
+
+#include "adc_calibration.h"
+#include "adc_conversions.h"
+#include "arm_math.h"
+#include "dsp_filter.h"
+#include "dsp_goertzel.h"
+#include "dsp_histogram.h"
+#include "dsp_sdft.h"
+#include "dsp_stats.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+
+/**
+ * @brief Slot pairs per frame (one 32-bit load each; an odd last slot
+ *        counts as a pair with an empty high lane)
+ */
+#define DSP_FUSED_PAIRS ((ADC_CONVERSIONS_CHANNEL_COUNT + 1U) / 2U)
+
+/**
+ * @brief Slot pairs a matrix row can touch: the three of a sensor group
+ */
+#define DSP_FUSED_ROW_PAIRS ADC_CAL_AXES
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief Fused kernel state
+ */
+typedef struct {
+  uint32_t offset[DSP_FUSED_PAIRS]; ///< Zero-g codes of each slot pair
+  /// Matrix row per output channel, packed per slot pair (q13)
+  uint32_t coef[ADC_CONVERSIONS_CHANNEL_COUNT][DSP_FUSED_ROW_PAIRS];
+  /// Slot pair of each coef[] entry
+  uint8_t coef_pair[ADC_CONVERSIONS_CHANNEL_COUNT][DSP_FUSED_ROW_PAIRS];
+  uint8_t slot_channel[ADC_CONVERSIONS_CHANNEL_COUNT]; ///< Slot -> channel
+  uint8_t num_stages;   ///< Biquad stages, 0 = no filter
+  uint16_t decimation;  ///< Output every Nth frame
+  uint16_t phase;       ///< Frames since the last output
+  float32_t biquad[DSP_FILTER_MAX_STAGES][DSP_FILTER_COEFFS_PER_STAGE];
+  float32_t state[ADC_CONVERSIONS_CHANNEL_COUNT][DSP_FILTER_MAX_STAGES][2];
+  DSP_StatsAccum_t stats[ADC_CONVERSIONS_CHANNEL_COUNT]; ///< Raw, ch order
+  DSP_Goertzel_t *goertzel; ///< Fed the mg values, NULL = none
+  DSP_Sdft_t *sdft;         ///< Fed the mg values, NULL = none
+  DSP_Histogram_t *histogram; ///< Fed the raw codes, NULL = none
+  uint8_t linear;             ///< Linearity tables applied
+  /// Table of each slot's ADC (the odd last slot's repeated for the empty
+  /// lane), valid while linear is set
+  const int16_t *lut[2U * DSP_FUSED_PAIRS];
+  float32_t mg_scale; ///< Matrix accumulator -> mg
+} DSP_Fused_t;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief Set up the kernel from the active calibration table
+ *
+ * @param fk          Instance
+ * @param decimation  Keep every Nth frame (1 = no decimation)
+ * @param channel_map Raw block slot -> channel (NULL = identity)
+ * @param design      Low-pass for every channel (dsp_filter.h), NULL = none
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success, filter and stats cleared
+ *   @retval HAL_ERROR NULL instance, decimation 0 or invalid design
+ */
+HAL_StatusTypeDef dspFused_init(DSP_Fused_t *fk, uint16_t decimation,
+                                const uint8_t *channel_map,
+                                const DSP_FilterDesign_t *design);
+
+/**
+ * @brief Reload offsets and matrix after adcCal_setTable(), and the
+ *        linearity tables of each slot after analogSensor_setMultimode()
+ *
+ * @param fk Instance (not being fed while this runs)
+ */
+void dspFused_loadCalibration(DSP_Fused_t *fk);
+
+/**
+ * @brief Feed a Goertzel bank with the calibrated mg values of every frame
+ *
+ * @param fk Instance (not being fed while this runs)
+ * @param gz Bank set up for the input frame rate, NULL to detach
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL instance
+ */
+HAL_StatusTypeDef dspFused_attachGoertzel(DSP_Fused_t *fk, DSP_Goertzel_t *gz);
+
+/**
+ * @brief Feed a sliding DFT with the calibrated mg values of every frame
+ *
+ * @param fk Instance (not being fed while this runs)
+ * @param sd Sliding DFT set up for the input frame rate, NULL to detach
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL instance
+ */
+HAL_StatusTypeDef dspFused_attachSdft(DSP_Fused_t *fk, DSP_Sdft_t *sd);
+
+/**
+ * @brief Count the raw codes of every frame into a histogram, from the slot
+ *        pairs already loaded for the stats
+ *
+ * @param fk Instance (not being fed while this runs)
+ * @param hg Histogram, NULL to detach
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL instance
+ */
+HAL_StatusTypeDef dspFused_attachHistogram(DSP_Fused_t *fk,
+                                           DSP_Histogram_t *hg);
+
+/**
+ * @brief Correct every code through its ADC's linearity table before the
+ *        calibration (the stats and the histogram keep the raw codes)
+ *
+ * @param fk Instance (not being fed while this runs)
+ * @param on Non-zero to apply the tables, 0 for the raw codes
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success, calibration reloaded at the new scale
+ *   @retval HAL_ERROR NULL instance, or tables not built in (ADC_LIN_ENABLE)
+ */
+HAL_StatusTypeDef dspFused_attachLinearity(DSP_Fused_t *fk, uint8_t on);
+
+/**
+ * @brief Stats, calibrate, filter and decimate one block in one pass
+ *
+ * @param fk     Instance
+ * @param block  Raw frames, 4-byte aligned (DMA blocks are)
+ * @param frames Number of frames
+ * @param out    Receives the decimated frames in mg, channel order; room
+ *               for frames / decimation + 1 frames
+ *
+ * @return uint32_t Frames written to out
+ */
+uint32_t dspFused_process(DSP_Fused_t *fk, const uint16_t *block,
+                          uint32_t frames, float32_t *out);
+
+/**
+ * @brief Statistics of the raw codes since the last reset
+ *
+ * @param fk    Instance
+ * @param stats ADC_CONVERSIONS_CHANNEL_COUNT entries, in channel order
+ * @param reset Non-zero to restart them in the same critical section
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer
+ */
+HAL_StatusTypeDef dspFused_getStats(DSP_Fused_t *fk, ADC_ChannelStats_t *stats,
+                                    uint8_t reset);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DSP_FUSED_H */
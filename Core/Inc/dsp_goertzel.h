@@ -0,0 +1,221 @@
+/**
+ ******************************************************************************
+ * @file    dsp_goertzel.h
+ * @brief   Goertzel filter bank: amplitudes at a few known frequencies per
+ *          channel, updated sample by sample
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * Tracking shaft harmonics needs a handful of bins, not a full spectrum.
+ * Each bin is a second-order resonator updated once per sample:
+ *
+ *   s[n] = x[n] + 2 cos(2 pi k / N) s[n-1] - s[n-2]
+ *
+ * one multiply and two adds per bin and sample, where a 1024-point FFT
+ * spends about 5 log2 N = 50 per sample on bins that are mostly not
+ * needed. After N samples the bin power is
+ * s1^2 + s2^2 - c s1 s2, and the bank publishes a 0-pk amplitude per bin
+ * (rectangular window), in the units of its input.
+ *
+ * Frequencies are snapped to the nearest k fs / N, so DC and tones on other
+ * bins do not leak into a bin. The previous window's mean is removed from
+ * the input anyway: gravity would otherwise dominate the single precision
+ * state at low k.
+ *
+ * Two ways to feed it:
+ *   - dspGoertzel_process(): raw codes of an interleaved block
+ *   - dspFused_attachGoertzel(): mg values inside the fused kernel
+ *     (dsp_fused.h), before its low-pass, in the same pass over the block
+ *
+ * Results are double-buffered, so the consumer has a whole window to copy
+ * the newest one.
+ *
+ * Usage Example:
+ *   static DSP_Goertzel_t gz;
+ *   static const float32_t shaft[] = {25.0f, 50.0f, 75.0f, 100.0f};
+ *   dspGoertzel_init(&gz, 4000.0f, 4000, analogSensor_getBlockChannelMap());
+ *   for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+ *     dspGoertzel_setBins(&gz, ch, shaft, 4);
+ *   }
+ *
+ *   // in the block callback (ISR)
+ *   dspGoertzel_process(&gz, block, frame_count);
+ *
+ *   // main loop
+ *   DSP_GoertzelResult_t res;
+ *   if (dspGoertzel_getResult(&gz, &res) == HAL_OK) {
+ *     // res.amplitude[ch][bin] at res.hz[ch][bin], once per N frames
+ *   }
+ ******************************************************************************
+ */
+
+#ifndef DSP_GOERTZEL_H
+#define DSP_GOERTZEL_H
+
+#include "adc_conversions.h"
+#include "arm_math.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+
+/**
+ * @brief Bins per channel
+ */
+#ifndef DSP_GOERTZEL_MAX_BINS
+#define DSP_GOERTZEL_MAX_BINS 16U
+#endif
+
+/**
+ * @brief Shortest window (samples per result)
+ */
+#define DSP_GOERTZEL_LENGTH_MIN 64U
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief Amplitudes of one window
+ */
+typedef struct {
+  uint32_t sequence;  ///< Windows completed since init
+  uint32_t first;     ///< Input sample index of the window's first sample
+  uint8_t bin_count[ADC_CONVERSIONS_CHANNEL_COUNT];
+  float32_t hz[ADC_CONVERSIONS_CHANNEL_COUNT]
+              [DSP_GOERTZEL_MAX_BINS]; ///< Bin frequency k fs / N
+  float32_t amplitude[ADC_CONVERSIONS_CHANNEL_COUNT]
+                     [DSP_GOERTZEL_MAX_BINS]; ///< 0-pk, units of the input
+} DSP_GoertzelResult_t;
+
+/**
+ * @brief Bank state (one instance per block stream), channel order
+ */
+typedef struct {
+  float32_t sample_rate_hz;
+  uint16_t length; ///< N, samples per result
+  uint8_t slot_channel[ADC_CONVERSIONS_CHANNEL_COUNT]; ///< Raw slot -> ch
+  uint8_t set_count[ADC_CONVERSIONS_CHANNEL_COUNT]; ///< Entries in hz
+  float32_t hz[ADC_CONVERSIONS_CHANNEL_COUNT][DSP_GOERTZEL_MAX_BINS]; ///< Set
+  uint8_t bin_count[ADC_CONVERSIONS_CHANNEL_COUNT]; ///< Below Nyquist
+  float32_t bin_hz[ADC_CONVERSIONS_CHANNEL_COUNT][DSP_GOERTZEL_MAX_BINS];
+  float32_t coef[ADC_CONVERSIONS_CHANNEL_COUNT][DSP_GOERTZEL_MAX_BINS];
+  float32_t s1[ADC_CONVERSIONS_CHANNEL_COUNT][DSP_GOERTZEL_MAX_BINS];
+  float32_t s2[ADC_CONVERSIONS_CHANNEL_COUNT][DSP_GOERTZEL_MAX_BINS];
+  float32_t dc[ADC_CONVERSIONS_CHANNEL_COUNT];  ///< Removed from the input
+  float32_t sum[ADC_CONVERSIONS_CHANNEL_COUNT]; ///< Input total this window
+  uint32_t count;    ///< Samples into the window
+  uint32_t samples;  ///< Samples since init
+  DSP_GoertzelResult_t result[2];
+  volatile uint32_t result_seq; ///< Written by the feeding context
+  uint32_t read_seq;            ///< Written by the reader
+} DSP_Goertzel_t;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief Reset the bank with no bins
+ *
+ * @param gz             Instance
+ * @param sample_rate_hz Input sample rate
+ * @param length         Samples per result, DSP_GOERTZEL_LENGTH_MIN or more;
+ *                       bin spacing is sample_rate_hz / length
+ * @param channel_map    Raw block slot -> channel (NULL = identity)
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL instance, rate not positive or length too short
+ */
+HAL_StatusTypeDef dspGoertzel_init(DSP_Goertzel_t *gz, float32_t sample_rate_hz,
+                                   uint16_t length, const uint8_t *channel_map);
+
+/**
+ * @brief Choose the frequencies tracked on a channel; restarts the window
+ *        of every channel
+ *
+ * @param gz      Instance
+ * @param channel Channel index
+ * @param hz      Frequencies, each snapped to the nearest bin
+ * @param count   Entries, 0..DSP_GOERTZEL_MAX_BINS
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR Invalid argument, or a frequency that snaps to DC or
+ *                     to Nyquist and above
+ */
+HAL_StatusTypeDef dspGoertzel_setBins(DSP_Goertzel_t *gz, uint8_t channel,
+                                      const float32_t *hz, uint8_t count);
+
+/**
+ * @brief Follow a new input rate (adaptive_rate.h): the set frequencies are
+ *        snapped again and the window restarts
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success; bins now at or above Nyquist are left out
+ *                     until a rate that has them
+ *   @retval HAL_ERROR NULL instance or rate not positive
+ */
+HAL_StatusTypeDef dspGoertzel_setSampleRate(DSP_Goertzel_t *gz,
+                                            float32_t sample_rate_hz);
+
+/**
+ * @brief Close the window; called by dspGoertzel_endFrame()
+ */
+void dspGoertzel_publish(DSP_Goertzel_t *gz);
+
+/**
+ * @brief Run one block of interleaved raw frames (codes) through the bank
+ *
+ * @param gz     Instance
+ * @param block  Raw frames
+ * @param frames Frames in the block
+ */
+void dspGoertzel_process(DSP_Goertzel_t *gz, const uint16_t *block,
+                         uint32_t frames);
+
+/**
+ * @brief Take the newest result if one was published
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    result filled
+ *   @retval HAL_BUSY  Nothing new since the previous call
+ *   @retval HAL_ERROR NULL pointer
+ */
+HAL_StatusTypeDef dspGoertzel_getResult(DSP_Goertzel_t *gz,
+                                        DSP_GoertzelResult_t *result);
+
+/**
+ * @brief Add one sample of a channel (channel order)
+ */
+static inline void dspGoertzel_push(DSP_Goertzel_t *gz, uint8_t channel,
+                                    float32_t x) {
+  const float32_t v = x - gz->dc[channel];
+  const float32_t *c = gz->coef[channel];
+  float32_t *s1 = gz->s1[channel];
+  float32_t *s2 = gz->s2[channel];
+
+  gz->sum[channel] += x;
+  for (uint8_t b = 0; b < gz->bin_count[channel]; b++) {
+    const float32_t s0 = v + c[b] * s1[b] - s2[b];
+    s2[b] = s1[b];
+    s1[b] = s0;
+  }
+}
+
+/**
+ * @brief End of a frame: every channel has been pushed once
+ */
+static inline void dspGoertzel_endFrame(DSP_Goertzel_t *gz) {
+  if (++gz->count >= gz->length) {
+    dspGoertzel_publish(gz);
+  }
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DSP_GOERTZEL_H */
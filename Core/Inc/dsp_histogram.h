@@ -0,0 +1,185 @@
+/**
+ ******************************************************************************
+ * @file    dsp_histogram.h
+ * @brief   Amplitude histogram of the raw codes per channel, and percentiles
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * Mean, RMS and min/max (dsp_stats.h) miss the shape of the distribution:
+ * an input stuck at a rail some of the time, a signal that jumps between
+ * two levels, a noise floor that is not Gaussian. The histogram counts
+ * every sample of every channel into 4096 >> shift bins of 1 << shift
+ * codes each, 64 to DSP_HISTOGRAM_MAX_BINS bins:
+ *
+ *   counts[slot][(code & 0xFFF) >> shift]++
+ *
+ * one masked index and one increment per sample, no compare and no branch
+ * (the slot loop is unrolled at compile time). Two ways to feed it:
+ *   - dspHistogram_process(): an interleaved raw block
+ *   - dspFused_attachHistogram(): inside the fused kernel (dsp_fused.h),
+ *     from the slot pairs it already loads for the stats
+ *
+ * dspHistogram_snapshot() copies one channel's counts, optionally with a
+ * reset, and dspHistogram_percentiles() reads any number of percentiles
+ * from a snapshot in one cumulative pass, interpolated within a bin:
+ * medians and tails on the MCU with no sorting and no stored window.
+ *
+ * Usage Example:
+ *   static DSP_Histogram_t hist;
+ *   static DSP_HistogramSnapshot_t snap;
+ *   dspHistogram_init(&hist, 4, analogSensor_getBlockChannelMap()); // 256
+ *
+ *   // in the block callback (ISR)
+ *   dspHistogram_process(&hist, block, frame_count);
+ *
+ *   // main loop
+ *   static const float32_t pct[] = {1.0f, 50.0f, 99.0f};
+ *   float32_t code[3];
+ *   dspHistogram_snapshot(&hist, 0, &snap, 1);
+ *   dspHistogram_percentiles(&snap, pct, 3, code);
+ *
+ * @note RAM is 4 bytes x DSP_HISTOGRAM_MAX_BINS per channel, 6 kB for six
+ *       channels at the default 256. A bin overflows after 2^32 samples,
+ *       12 days of one stuck code at 4 kHz; reset well before.
+ ******************************************************************************
+ */
+
+#ifndef DSP_HISTOGRAM_H
+#define DSP_HISTOGRAM_H
+
+#include "adc_conversions.h"
+#include "arm_math.h"
+#include "stm32f7xx_hal.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+
+/**
+ * @brief Most bins per channel, a power of two in 64..4096; the smallest
+ *        shift is log2(4096 / DSP_HISTOGRAM_MAX_BINS)
+ */
+#ifndef DSP_HISTOGRAM_MAX_BINS
+#define DSP_HISTOGRAM_MAX_BINS 256U
+#endif
+
+#define DSP_HISTOGRAM_CODES 4096U   ///< 12-bit codes
+#define DSP_HISTOGRAM_CODE_MASK 0xFFFU
+#define DSP_HISTOGRAM_MAX_SHIFT 6U  ///< 64 bins of 64 codes
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief Histogram state (one instance per block stream), raw slot order
+ */
+typedef struct {
+  uint8_t shift;      ///< Codes per bin = 1 << shift
+  uint16_t bin_count; ///< 4096 >> shift
+  uint8_t slot_channel[ADC_CONVERSIONS_CHANNEL_COUNT]; ///< Raw slot -> ch
+  uint32_t frames;    ///< Frames counted since the last reset
+  uint32_t counts[ADC_CONVERSIONS_CHANNEL_COUNT][DSP_HISTOGRAM_MAX_BINS];
+} DSP_Histogram_t;
+
+/**
+ * @brief Counts of one channel at one instant
+ */
+typedef struct {
+  uint8_t channel;
+  uint8_t shift;      ///< Codes per bin = 1 << shift
+  uint16_t bin_count;
+  uint32_t total;     ///< Samples counted
+  uint32_t counts[DSP_HISTOGRAM_MAX_BINS]; ///< Bin b: codes b << shift ...
+} DSP_HistogramSnapshot_t;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief Reset the instance with bins of 1 << shift codes
+ *
+ * @param hg          Instance
+ * @param shift       log2(4096 / DSP_HISTOGRAM_MAX_BINS)..6
+ * @param channel_map Raw block slot -> channel (NULL = identity)
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL instance or shift out of range
+ */
+HAL_StatusTypeDef dspHistogram_init(DSP_Histogram_t *hg, uint8_t shift,
+                                    const uint8_t *channel_map);
+
+/**
+ * @brief Count one block of interleaved raw frames
+ *
+ * @param hg     Instance
+ * @param block  Raw frames
+ * @param frames Frames in the block
+ */
+void dspHistogram_process(DSP_Histogram_t *hg, const uint16_t *block,
+                          uint32_t frames);
+
+/**
+ * @brief Clear every count
+ *
+ * @param hg Instance
+ */
+void dspHistogram_reset(DSP_Histogram_t *hg);
+
+/**
+ * @brief Copy the counts of one channel, consistent with the block in
+ *        progress (interrupts masked for the copy, a few us at 4096 bins)
+ *
+ * @param hg      Instance
+ * @param channel Channel index
+ * @param snap    Destination
+ * @param reset   Non-zero to clear every channel in the same section
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer or channel out of range
+ */
+HAL_StatusTypeDef dspHistogram_snapshot(DSP_Histogram_t *hg, uint8_t channel,
+                                        DSP_HistogramSnapshot_t *snap,
+                                        uint8_t reset);
+
+/**
+ * @brief Percentiles of a snapshot in codes, interpolated within a bin
+ *
+ * @param snap Snapshot
+ * @param pct  Percentiles, ascending, 0..100
+ * @param n    Entries
+ * @param code Receives n values in codes
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_BUSY  Nothing counted
+ *   @retval HAL_ERROR NULL pointer, or pct not ascending within 0..100
+ */
+HAL_StatusTypeDef dspHistogram_percentiles(const DSP_HistogramSnapshot_t *snap,
+                                           const float32_t *pct, uint8_t n,
+                                           float32_t *code);
+
+/**
+ * @brief Count one frame from its slot pairs as dsp_fused.c loads them:
+ *        slot 2k in the low halfword of w[k], slot 2k + 1 in the high one
+ */
+static inline void dspHistogram_pushPairs(DSP_Histogram_t *hg,
+                                          const uint32_t *w) {
+  const uint8_t shift = hg->shift;
+  for (uint8_t s = 0; s < ADC_CONVERSIONS_CHANNEL_COUNT; s++) {
+    const uint32_t code = (w[s / 2U] >> (16U * (s % 2U))) &
+                          DSP_HISTOGRAM_CODE_MASK;
+    hg->counts[s][code >> shift]++;
+  }
+  hg->frames++;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DSP_HISTOGRAM_H */
@@ -0,0 +1,274 @@
+/**
+ ******************************************************************************
+ * @file    dsp_multirate.h
+ * @brief   Multi-rate CIC + polyphase FIR decimation tree with per-channel
+ *          output rates
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * dspFilter decimates every channel by the same factor. Here each channel
+ * picks the rates it is streamed at from a chain of decimation levels, each
+ * one running on the output of the previous:
+ *
+ *   scan 4 kHz -> level 0: FIR /4 (48 taps)               -> 1 kHz
+ *              -> level 1: CIC3 /25 + compensation FIR /4 -> 10 Hz
+ *
+ * A channel runs the chain up to the highest level it is emitted at, and
+ * each level is computed once per channel however many streams use it: a
+ * 10 Hz tilt channel reuses its own 1 kHz stage, only without storing it.
+ * The raw rate needs no work here, it is the block itself.
+ *
+ * The FIR steps are arm_fir_decimate_q15 (polyphase: only the kept outputs
+ * are computed). A CIC step integrates and combs in 32-bit wrap-around
+ * arithmetic and rescales by 1 / R^N; its droop is undone by the FIR that
+ * follows it. Samples are q15 throughout: q = (code - 2048) * 8, so a
+ * level keeps the resolution its averaging gains (DSP_MULTIRATE_TO_CODE
+ * goes back to ADC codes). With a DC tracker attached (auto-zero,
+ * dsp_dctrack.h) the tracked DC of each channel takes the place of 2048,
+ * so gravity and zero-g drift leave the q15 headroom to the signal.
+ *
+ * Output: per level, two ping-pong blocks of decimated frames, channel
+ * order with the channels not emitted at that level left 0. The ISR fills
+ * one while the consumer reads the other, as dspFilter. A block that
+ * produced no frame at a level is not published there.
+ *
+ * Usage Example:
+ *   static DSP_Multirate_t mr;
+ *   dspMultirate_init(&mr, NULL, analogSensor_getBlockChannelMap());
+ *   dspMultirate_setChannelRates(&mr, 0, DSP_MULTIRATE_LEVEL_BIT(0));
+ *   dspMultirate_setChannelRates(&mr, 3, DSP_MULTIRATE_LEVEL_BIT(1));
+ *
+ *   // in the block callback (ISR)
+ *   dspMultirate_process(&mr, block, frame_count);
+ *
+ *   // main loop
+ *   const q15_t *out;
+ *   uint32_t frames;
+ *   if (dspMultirate_getOutput(&mr, 1, &out, &frames, NULL) == HAL_OK) {
+ *     // out[frame * ADC_CONVERSIONS_CHANNEL_COUNT + 3], 10 Hz
+ *   }
+ *
+ * @note Requires ARM_MATH_CM7 and libarm_cortexM7lfsp_math.a (linked by
+ *       CMakeLists.txt).
+ ******************************************************************************
+ */
+
+#ifndef DSP_MULTIRATE_H
+#define DSP_MULTIRATE_H
+
+#include "adc_conversions.h"
+#include "arm_math.h"
+#include "dsp_dctrack.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+
+/**
+ * @brief Decimation levels below the raw rate
+ */
+#ifndef DSP_MULTIRATE_LEVELS
+#define DSP_MULTIRATE_LEVELS 2U
+#endif
+
+/**
+ * @brief Longest FIR of a level
+ */
+#ifndef DSP_MULTIRATE_MAX_TAPS
+#define DSP_MULTIRATE_MAX_TAPS 64U
+#endif
+
+/**
+ * @brief Largest FIR decimation factor of a level
+ */
+#ifndef DSP_MULTIRATE_MAX_FIR_FACTOR
+#define DSP_MULTIRATE_MAX_FIR_FACTOR 16U
+#endif
+
+/**
+ * @brief Highest CIC order of a level
+ */
+#define DSP_MULTIRATE_CIC_MAX_ORDER 4U
+
+/**
+ * @brief Input samples one level takes per block
+ */
+#define DSP_MULTIRATE_MAX_BLOCK ADC_CONVERSIONS_BLOCK_FRAMES
+
+/**
+ * @brief Output frames per block and level; every level decimates by 2 or
+ *        more, so it never produces more
+ */
+#define DSP_MULTIRATE_MAX_OUT_FRAMES (DSP_MULTIRATE_MAX_BLOCK / 2U)
+
+/**
+ * @brief Rate mask bit of a level (dspMultirate_setChannelRates)
+ */
+#define DSP_MULTIRATE_LEVEL_BIT(level) (1U << (level))
+
+/**
+ * @brief q15 output sample -> 12-bit ADC code (float, keeps the extra
+ *        resolution)
+ */
+#define DSP_MULTIRATE_TO_CODE(q) ((float32_t)(q) * 0.125f + 2048.0f)
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief One decimation level: optional CIC, then a decimating FIR
+ */
+typedef struct {
+  uint16_t cic_factor; ///< CIC decimation R, 1 = no CIC
+  uint8_t cic_order;   ///< CIC order N (if R > 1), R^N <= 32768
+  uint8_t fir_factor;  ///< FIR decimation M, 1..DSP_MULTIRATE_MAX_FIR_FACTOR
+  uint16_t num_taps;   ///< 1..DSP_MULTIRATE_MAX_TAPS
+  const q15_t *taps;   ///< Unity DC gain; symmetric, so CMSIS order
+} DSP_MultirateStage_t;
+
+/**
+ * @brief Per-channel state of one level
+ */
+typedef struct {
+  arm_fir_decimate_instance_q15 fir;
+  q15_t fir_state[DSP_MULTIRATE_MAX_TAPS + DSP_MULTIRATE_MAX_BLOCK +
+                  DSP_MULTIRATE_MAX_FIR_FACTOR - 2U];
+  q15_t pending[DSP_MULTIRATE_MAX_FIR_FACTOR]; ///< < M samples for the FIR
+  uint32_t integ[DSP_MULTIRATE_CIC_MAX_ORDER];
+  uint32_t comb[DSP_MULTIRATE_CIC_MAX_ORDER];
+  uint16_t cic_phase;
+  uint8_t pending_count;
+} DSP_MultirateLane_t;
+
+/**
+ * @brief Decimation tree state (one instance per block stream)
+ */
+typedef struct {
+  const DSP_MultirateStage_t *stage[DSP_MULTIRATE_LEVELS];
+  int32_t cic_gain[DSP_MULTIRATE_LEVELS];  ///< 1 / R^N, q31
+  uint32_t factor[DSP_MULTIRATE_LEVELS];   ///< Input frames per output
+  uint8_t slot_channel[ADC_CONVERSIONS_CHANNEL_COUNT]; ///< Raw slot -> ch
+  uint8_t rates[ADC_CONVERSIONS_CHANNEL_COUNT];    ///< Level mask per ch
+  uint8_t depth[ADC_CONVERSIONS_CHANNEL_COUNT];    ///< Levels run per ch
+  ADC_ChannelMask_t channel_mask[DSP_MULTIRATE_LEVELS]; ///< Channels per level
+  DSP_MultirateLane_t lane[ADC_CONVERSIONS_CHANNEL_COUNT][DSP_MULTIRATE_LEVELS];
+  q15_t output[DSP_MULTIRATE_LEVELS][2]
+              [DSP_MULTIRATE_MAX_OUT_FRAMES * ADC_CONVERSIONS_CHANNEL_COUNT];
+  uint32_t output_frames[DSP_MULTIRATE_LEVELS][2];
+  uint32_t output_first[DSP_MULTIRATE_LEVELS][2]; ///< Level index of frame 0
+  uint32_t produced[DSP_MULTIRATE_LEVELS];        ///< Frames since init
+  volatile uint32_t blocks_done[DSP_MULTIRATE_LEVELS]; ///< Written by process
+  uint32_t blocks_read[DSP_MULTIRATE_LEVELS];          ///< Written by reader
+  const DSP_DcTrack_t *dc; ///< Auto-zero input centre, NULL = code 2048
+} DSP_Multirate_t;
+
+/* Exported variables --------------------------------------------------------*/
+
+/**
+ * @brief Default chain for 4 kHz input: 1 kHz, then 10 Hz
+ */
+extern const DSP_MultirateStage_t *const
+    dspMultirate_defaultStages[DSP_MULTIRATE_LEVELS];
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief Reset the tree; no channel is emitted at any level
+ *
+ * @param mr          Instance
+ * @param stages      DSP_MULTIRATE_LEVELS levels, NULL = the default chain;
+ *                    kept by pointer
+ * @param channel_map Raw block slot -> channel (NULL = identity)
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL instance or invalid stage
+ */
+HAL_StatusTypeDef dspMultirate_init(DSP_Multirate_t *mr,
+                                    const DSP_MultirateStage_t *const *stages,
+                                    const uint8_t *channel_map);
+
+/**
+ * @brief Choose the levels a channel is emitted at
+ *
+ * @param mr      Instance (not being fed while this runs)
+ * @param channel Channel index
+ * @param levels  DSP_MULTIRATE_LEVEL_BIT() mask, 0 = not decimated
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success; every chain restarts, so the levels stay
+ *                     aligned across channels
+ *   @retval HAL_ERROR Invalid argument
+ */
+HAL_StatusTypeDef dspMultirate_setChannelRates(DSP_Multirate_t *mr,
+                                               uint8_t channel,
+                                               uint8_t levels);
+
+/**
+ * @brief Centre the input of every channel on its tracked DC instead of
+ *        code 2048 (auto-zero)
+ *
+ * @param mr Instance
+ * @param dc Tracker, updated before dspMultirate_process() in the same
+ *           block; NULL = back to code 2048
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL instance
+ */
+HAL_StatusTypeDef dspMultirate_attachDcTrack(DSP_Multirate_t *mr,
+                                             const DSP_DcTrack_t *dc);
+
+/**
+ * @brief Run one block of interleaved raw frames through the tree
+ *
+ * @param mr     Instance
+ * @param block  Raw frames
+ * @param frames Frames in the block, at most ADC_CONVERSIONS_BLOCK_FRAMES
+ */
+void dspMultirate_process(DSP_Multirate_t *mr, const uint16_t *block,
+                          uint32_t frames);
+
+/**
+ * @brief Take the newest output block of a level, if any
+ *
+ * @param mr     Instance
+ * @param level  Level index
+ * @param out    Receives frames in channel order (q15)
+ * @param frames Receives the frame count
+ * @param first  Receives the level index of frame 0 (input frame of
+ *               output k = (first + k + 1) * factor - 1), NULL if not needed
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    New block, valid for one input block period
+ *   @retval HAL_BUSY  Nothing new since the previous call
+ *   @retval HAL_ERROR NULL pointer or invalid level
+ */
+HAL_StatusTypeDef dspMultirate_getOutput(DSP_Multirate_t *mr, uint8_t level,
+                                         const q15_t **out, uint32_t *frames,
+                                         uint32_t *first);
+
+/**
+ * @brief Input frames per output frame of a level
+ *
+ * @return uint32_t Total decimation, 0 for an invalid level
+ */
+uint32_t dspMultirate_getFactor(const DSP_Multirate_t *mr, uint8_t level);
+
+/**
+ * @brief Channels emitted at a level (telemetry channel mask)
+ *
+ * @return uint8_t Bit per channel
+ */
+ADC_ChannelMask_t dspMultirate_getChannelMask(const DSP_Multirate_t *mr,
+                                              uint8_t level);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DSP_MULTIRATE_H */
@@ -0,0 +1,257 @@
+/**
+ ******************************************************************************
+ * @file    dsp_order.h
+ * @brief   Order tracking: one channel resampled to a fixed number of
+ *          samples per shaft revolution, for order spectra
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * On a machine whose speed changes, a shaft-locked tone moves between FFT
+ * bins during a segment and its energy smears over many of them. Sampling
+ * at fixed shaft angles instead puts every shaft order at a fixed
+ * frequency: an FFT of the angle-domain samples is an order spectrum, with
+ * order k in "bin" k x length / samples_per_rev.
+ *
+ * Two stamped streams on the one timebase are combined:
+ *
+ *   - blocks: the block callback copies the channel into a history of
+ *     DSP_ORDER_HISTORY frames and refines a frame-time model from the
+ *     block stamp (ADC_BlockInfo_t): t(n) = anchor + (n - anchor_frame) x
+ *     frame period, the anchor following the stamps through a 1/16 gain so
+ *     the interrupt latency jitter averages out;
+ *   - tach edges (tach.h), pushed by the main loop.
+ *
+ * Between two edges the shaft is taken to turn at a constant rate, so the
+ * samples_per_rev / pulses_per_rev target angles of the interval sit at
+ * equal times between them. dspOrder_poll() places each target time among
+ * the frames and interpolates linearly between the two around it, then
+ * hands the samples to a dsp_spectrum.h instance whose sample_rate_hz is
+ * samples_per_rev: its "Hz" are then orders.
+ *
+ * A target is resampled once the edge after it and the frame after it have
+ * arrived, so the output lags by up to one edge interval plus one block.
+ * The history must hold that: an edge interval at min_rpm plus two blocks.
+ * Interval gaps longer than min_rpm allows restart the tracking at the
+ * next edge.
+ *
+ * The samples are taken as given: an angle rate above the frame rate
+ * (samples_per_rev x shaft Hz > sample_rate_hz) folds the frame-domain
+ * content above it back into the orders, so pick samples_per_rev for the
+ * highest speed. The block stamp lags the triggers by a constant scan and
+ * interrupt latency, which shifts the order phases, not their amplitudes.
+ *
+ * An attached time-synchronous averager (dsp_tsa.h) gets the same samples
+ * with their angle in the revolution, counted from the edge the tracking
+ * started on, and hears of every lost sample and restart.
+ *
+ * Usage Example:
+ *   static DSP_Order_t order;
+ *   static DSP_Spectrum_t order_fft; // .sample_rate_hz = samples_per_rev
+ *   const DSP_OrderConfig_t cfg = {.pulses_per_rev = 1,
+ *                                  .samples_per_rev = 64,
+ *                                  .sample_rate_hz = 4000.0f,
+ *                                  .min_rpm = 300.0f};
+ *   dspOrder_init(&order, 0, analogSensor_getBlockChannelMap(), &cfg);
+ *
+ *   // block callback (ISR)
+ *   dspOrder_process(&order, block, frame_count, &info);
+ *
+ *   // main loop
+ *   while (tach_popEdge(&edge) == HAL_OK) {
+ *     dspOrder_pushEdge(&order, edge);
+ *   }
+ *   dspOrder_poll(&order, &order_fft);
+ *   dspSpectrum_poll(&order_fft);   // result peak_hz = peak order
+ *
+ * @note RAM per instance is about 4 bytes x DSP_ORDER_HISTORY.
+ ******************************************************************************
+ */
+
+#ifndef DSP_ORDER_H
+#define DSP_ORDER_H
+
+#include "adc_conversions.h"
+#include "arm_math.h"
+#include "dsp_spectrum.h"
+#include "dsp_tsa.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+
+/**
+ * @brief Frames of history per instance (power of two)
+ */
+#ifndef DSP_ORDER_HISTORY
+#define DSP_ORDER_HISTORY 2048U
+#endif
+
+/**
+ * @brief Tach edges queued per instance (power of two)
+ */
+#ifndef DSP_ORDER_EDGES
+#define DSP_ORDER_EDGES 32U
+#endif
+
+#define DSP_ORDER_CHUNK 32U ///< Samples per hand-over to the spectrum
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief Resampler settings
+ */
+typedef struct {
+  uint16_t pulses_per_rev;  ///< Tach edges per revolution, >= 1
+  uint16_t samples_per_rev; ///< Output samples per revolution, a multiple
+                            ///< of pulses_per_rev
+  float32_t sample_rate_hz; ///< Frame rate of the block stream
+  float32_t min_rpm;        ///< Slower is a gap, not tracked
+} DSP_OrderConfig_t;
+
+/**
+ * @brief Tracking counters
+ */
+typedef struct {
+  float32_t rpm;        ///< Speed over the newest resampled edge interval
+  uint32_t revolutions; ///< Revolutions resampled
+  uint32_t samples;     ///< Angle-domain samples produced
+  uint32_t gaps;        ///< Edge intervals slower than min_rpm
+  uint32_t stale;       ///< Targets whose frames had left the history
+  uint32_t dropped_edges; ///< Edges lost to a full queue
+  uint32_t restarts;    ///< Scan restarts and rate changes
+} DSP_OrderStatus_t;
+
+/**
+ * @brief Resampler state (one instance per tracked channel)
+ */
+typedef struct {
+  DSP_OrderConfig_t cfg;
+  uint8_t channel;             ///< Tracked channel
+  uint8_t slot;                ///< Its position in a raw block frame
+  int64_t period_q16;          ///< Frame period, timebase ticks (Q16)
+  uint64_t max_interval;       ///< Longest edge interval tracked (ticks)
+  /* Written by the block callback */
+  float32_t history[DSP_ORDER_HISTORY]; ///< Indexed by frame number
+  uint32_t next_frame;         ///< Frame number expected next
+  uint32_t anchor_frame;       ///< Frame the time model is anchored to
+  int64_t anchor_q16;          ///< Its time after time_base, ticks (Q16)
+  uint64_t time_base;          ///< timebase_now() origin of the Q16 times
+  volatile uint32_t newest;    ///< Newest frame in history[]
+  volatile uint32_t epoch;     ///< Incremented at every restart
+  uint8_t resync;              ///< Restart at the next block (rate change)
+  uint32_t epoch_first;        ///< First frame since the restart
+  /* Main loop */
+  uint64_t edges[DSP_ORDER_EDGES];
+  uint32_t edge_head;
+  uint32_t edge_tail;
+  uint32_t seen_epoch;         ///< epoch the edges below belong to
+  uint8_t have_edge;           ///< edge_start is valid
+  uint64_t edge_start;         ///< Edge opening the interval in progress
+  uint16_t step;               ///< Next target within that interval
+  uint16_t pulse;              ///< Edges into the revolution since the
+                               ///< tracking started
+  DSP_Tsa_t *tsa;              ///< Fed with every sample, NULL = none
+  uint32_t intervals;          ///< Edge intervals resampled
+  float32_t out[DSP_ORDER_CHUNK];
+  DSP_OrderStatus_t status;
+} DSP_Order_t;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief Configure an instance for one channel
+ *
+ * @param ord         Instance
+ * @param channel     Channel to track
+ * @param channel_map Raw block slot -> channel (NULL = identity), see
+ *                    analogSensor_getBlockChannelMap()
+ * @param cfg         Settings, copied
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR Invalid argument, or an edge interval at min_rpm does
+ *                     not fit the history
+ */
+HAL_StatusTypeDef dspOrder_init(DSP_Order_t *ord, uint8_t channel,
+                                const uint8_t *channel_map,
+                                const DSP_OrderConfig_t *cfg);
+
+/**
+ * @brief Follow a frame rate change (block callback context, like
+ *        dspOrder_process()); tracking restarts at the next block
+ *
+ * @param ord            Instance
+ * @param sample_rate_hz New frame rate
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer, or an edge interval at min_rpm does not
+ *                     fit the history at this rate (tracking stops)
+ */
+HAL_StatusTypeDef dspOrder_setSampleRate(DSP_Order_t *ord,
+                                         float32_t sample_rate_hz);
+
+/**
+ * @brief Copy the channel of one block into the history (block callback)
+ *
+ * @param ord    Instance
+ * @param block  Raw frames
+ * @param frames Number of frames
+ * @param info   The block's position and stamp (analogSensor_getBlockInfo())
+ */
+void dspOrder_process(DSP_Order_t *ord, const uint16_t *block,
+                      uint32_t frames, const ADC_BlockInfo_t *info);
+
+/**
+ * @brief Queue one tach edge (main loop)
+ *
+ * @param ord  Instance
+ * @param time timebase_now() stamp of the edge (tach_popEdge())
+ */
+void dspOrder_pushEdge(DSP_Order_t *ord, uint64_t time);
+
+/**
+ * @brief Resample every target whose edges and frames have arrived, and
+ *        push the samples into the order spectrum
+ *
+ * @param ord Instance
+ * @param sp  Spectrum instance fed with the angle-domain samples
+ *
+ * @return Samples produced
+ *
+ * @note Main loop, before dspSpectrum_poll(sp)
+ */
+uint32_t dspOrder_poll(DSP_Order_t *ord, DSP_Spectrum_t *sp);
+
+/**
+ * @brief Get tracking counters
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer
+ */
+HAL_StatusTypeDef dspOrder_getStatus(const DSP_Order_t *ord,
+                                     DSP_OrderStatus_t *status);
+
+/**
+ * @brief Feed a time-synchronous averager from dspOrder_poll()
+ *
+ * @param ord Instance
+ * @param tsa Averager with the same samples_per_rev, NULL to detach
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL instance or another samples_per_rev
+ */
+HAL_StatusTypeDef dspOrder_attachTsa(DSP_Order_t *ord, DSP_Tsa_t *tsa);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DSP_ORDER_H */
@@ -0,0 +1,161 @@
+/**
+ ******************************************************************************
+ * @file    dsp_oversample.h
+ * @brief   Oversample-and-decimate stage for higher effective ADC resolution
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * The F7 ADC is 12-bit and MX_ADC1_Init() does no hardware oversampling.
+ * This stage sums N consecutive frames of each channel and scales the sum to
+ * a 13..16-bit result: every 4x of oversampling gains one bit of resolution
+ * given at least ~1 LSB of noise at the input (which the LISXXXALH outputs
+ * provide), e.g. 256x -> 16 bit for low-g tilt.
+ *
+ *   result = sum(N samples) >> (log2(N) - (bits - 12))
+ *
+ * Throughput: channel pairs are accumulated in the 16-bit lanes of one word
+ * with __UADD16, up to 16 frames at a time (16 x 4095 fits a lane), before
+ * being widened into 32-bit per-channel sums. That is one load and one
+ * UADD16 per two samples, a few cycles per frame, fast enough for MSPS
+ * aggregate input rates.
+ *
+ * Usage Example:
+ *   static DSP_Oversampler_t os;
+ *   dspOversample_init(&os, analogSensor_getBlockChannelMap());
+ *   dspOversample_configChannel(&os, 0, 256, 16);  // tilt: 16 bit, /256
+ *   analogSensor_registerBlockCallback(dspOversample_blockCallback, &os);
+ *
+ *   uint16_t value;
+ *   if (dspOversample_getOutput(&os, 0, &value) == HAL_OK) {
+ *     // new 16-bit result
+ *   }
+ *
+ ******************************************************************************
+ */
+
+#ifndef DSP_OVERSAMPLE_H
+#define DSP_OVERSAMPLE_H
+
+#include "adc_conversions.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+
+#define DSP_OVERSAMPLE_RATIO_MIN 4U   ///< Smallest ratio (one extra bit)
+#define DSP_OVERSAMPLE_RATIO_MAX 256U ///< Largest ratio (four extra bits)
+#define DSP_OVERSAMPLE_BITS_MIN 13U   ///< Narrowest result format
+#define DSP_OVERSAMPLE_BITS_MAX 16U   ///< Widest result format
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief Called for every decimated result
+ *
+ * @param channel Channel index
+ * @param value   Result in the channel's configured format
+ * @param ctx     User context
+ */
+typedef void (*DSP_OversampleCallback_t)(uint8_t channel, uint16_t value,
+                                         void *ctx);
+
+/**
+ * @brief Oversampler state (one instance per block stream)
+ */
+typedef struct {
+  uint8_t slot_channel[ADC_CONVERSIONS_CHANNEL_COUNT]; ///< Raw slot -> channel
+  uint16_t ratio[ADC_CONVERSIONS_CHANNEL_COUNT];       ///< N, power of two
+  uint8_t shift[ADC_CONVERSIONS_CHANNEL_COUNT];        ///< Sum -> result shift
+  uint16_t chunk;                           ///< Frames summed in 16-bit lanes
+  uint32_t sum[ADC_CONVERSIONS_CHANNEL_COUNT];     ///< Running sums
+  uint16_t count[ADC_CONVERSIONS_CHANNEL_COUNT];   ///< Frames in sum[]
+  uint16_t output[ADC_CONVERSIONS_CHANNEL_COUNT];  ///< Newest results
+  volatile uint32_t output_seq[ADC_CONVERSIONS_CHANNEL_COUNT]; ///< Results made
+  uint32_t read_seq[ADC_CONVERSIONS_CHANNEL_COUNT]; ///< Results consumed
+  DSP_OversampleCallback_t callback;        ///< Optional result callback
+  void *callback_ctx;                       ///< Passed to callback
+} DSP_Oversampler_t;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief Reset an oversampler; every channel starts at 16x / 14 bit
+ *
+ * @param os          Instance
+ * @param channel_map Raw block slot -> channel (NULL = identity), see
+ *                    analogSensor_getBlockChannelMap()
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL instance
+ */
+HAL_StatusTypeDef dspOversample_init(DSP_Oversampler_t *os,
+                                     const uint8_t *channel_map);
+
+/**
+ * @brief Set the ratio and result format of one channel
+ *
+ * @param os      Instance (not being fed while this runs)
+ * @param channel Channel index
+ * @param ratio   Oversampling ratio, power of two in 4..256
+ * @param bits    Result width 13..16, at most 12 + log2(ratio)
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success, the channel's running sum is restarted
+ *   @retval HAL_ERROR Invalid argument
+ */
+HAL_StatusTypeDef dspOversample_configChannel(DSP_Oversampler_t *os,
+                                              uint8_t channel, uint16_t ratio,
+                                              uint8_t bits);
+
+/**
+ * @brief Set the per-result callback (NULL = none)
+ *
+ * @param os       Instance
+ * @param callback Called from the context that feeds the blocks
+ * @param ctx      Passed back to the callback
+ */
+void dspOversample_setCallback(DSP_Oversampler_t *os,
+                               DSP_OversampleCallback_t callback, void *ctx);
+
+/**
+ * @brief Accumulate a block of interleaved raw frames
+ *
+ * @param os     Instance
+ * @param block  Raw frames, 4-byte aligned (DMA blocks are)
+ * @param frames Number of frames
+ */
+void dspOversample_process(DSP_Oversampler_t *os, const uint16_t *block,
+                           uint32_t frames);
+
+/**
+ * @brief ADC_BlockCallback_t adapter, ctx is the DSP_Oversampler_t
+ */
+void dspOversample_blockCallback(const uint16_t *block, uint32_t frame_count,
+                                 void *ctx);
+
+/**
+ * @brief Take the newest result of a channel if one was produced
+ *
+ * @param os      Instance
+ * @param channel Channel index
+ * @param value   Destination
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    New result copied
+ *   @retval HAL_BUSY  No result since the previous call
+ *   @retval HAL_ERROR Invalid argument
+ */
+HAL_StatusTypeDef dspOversample_getOutput(DSP_Oversampler_t *os,
+                                          uint8_t channel, uint16_t *value);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DSP_OVERSAMPLE_H */
@@ -0,0 +1,126 @@
+/**
+ ******************************************************************************
+ * @file    dsp_quality.h
+ * @brief   SNR, SINAD, THD, SFDR and ENOB of a reference tone from an FFT
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * Dynamic figures of merit of the ADC path (IEEE 1241) from a record of a
+ * single tone: the DAC loopback tone (dac_loopback.h), or an external
+ * generator on any input, e.g. through the interleaved shock capture. The
+ * record does not have to hold a whole number of periods: it is windowed
+ * with a 7-term Blackman-Harris (sidelobes below -180 dB, well under the
+ * noise floor of a 12-bit converter), mean-free, and transformed with
+ * arm_rfft_fast_f32(). In the power spectrum
+ *   - the tone is the largest lobe above the DC lobe; its frequency is the
+ *     power-weighted centroid of the lobe, which places the harmonics
+ *   - harmonics 2..DSP_QUALITY_HARMONICS + 1, folded into the first
+ *     Nyquist zone, are the distortion
+ *   - the other bins are the noise; their mean is extended over the lobes
+ *     that were taken out, so the noise figure covers the whole band
+ * with every lobe DSP_QUALITY_LOBE_BINS bins either side of its centre:
+ *   SNR   = P_tone / P_noise
+ *   SINAD = P_tone / (P_noise + P_harmonics)
+ *   THD   = P_harmonics / P_tone (negative, dBc)
+ *   SFDR  = largest tone bin / largest bin outside the tone and DC lobes
+ *   ENOB  = (SINAD - 1.76) / 6.02
+ * ENOB is not corrected to full scale: the tone amplitude is reported next
+ * to it.
+ *
+ * With the DAC loopback the tone and the frame rate are locked, so the
+ * DAC's own staircase images fold onto tone harmonics: THD then carries the
+ * DAC and SNR the ADC, which the sine fit's single residual cannot tell
+ * apart.
+ *
+ * Runs in the main loop: one real FFT and a few passes over the bins.
+ *
+ * Usage Example:
+ *   DSP_QualityResult_t q;
+ *   if (dspQuality_analyse(samples, 4096, &q) == HAL_OK) {
+ *     // q.enob, q.snr_db, q.tone * frame_rate_hz = tone in Hz
+ *   }
+ *
+ * @note RAM is 8 bytes x DSP_QUALITY_LENGTH_MAX, shared by every caller.
+ ******************************************************************************
+ */
+
+#ifndef DSP_QUALITY_H
+#define DSP_QUALITY_H
+
+#include "arm_math.h"
+#include "stm32f7xx_hal.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+
+#define DSP_QUALITY_LENGTH_MIN 256U ///< Shortest record analysed
+
+/**
+ * @brief Longest record analysed; longer ones use their first part
+ */
+#ifndef DSP_QUALITY_LENGTH_MAX
+#define DSP_QUALITY_LENGTH_MAX 4096U
+#endif
+
+/**
+ * @brief Harmonics counted as distortion, from the second on
+ */
+#ifndef DSP_QUALITY_HARMONICS
+#define DSP_QUALITY_HARMONICS 9U
+#endif
+
+/**
+ * @brief Half-width of a lobe in bins: the window's main lobe is 7
+ */
+#ifndef DSP_QUALITY_LOBE_BINS
+#define DSP_QUALITY_LOBE_BINS 8U
+#endif
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief Figures of one record
+ */
+typedef struct {
+  uint32_t length;     ///< Points analysed (power of two)
+  float32_t tone;      ///< Tone frequency in cycles per sample (0..0.5)
+  float32_t amplitude; ///< Tone amplitude (codes, 0-pk)
+  float32_t noise_rms; ///< Noise over the band, harmonics excluded (codes)
+  float32_t snr_db;
+  float32_t sinad_db;
+  float32_t thd_db;    ///< Negative: below the tone
+  float32_t sfdr_db;
+  float32_t enob;      ///< From SINAD, bits
+} DSP_QualityResult_t;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief Analyse a record of one tone
+ *
+ * Uses the largest power of two of samples, up to DSP_QUALITY_LENGTH_MAX.
+ * Not reentrant: the work buffers are shared.
+ *
+ * @param samples Codes in time order
+ * @param count   Samples in the record
+ * @param result  Receives the figures
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer, fewer than DSP_QUALITY_LENGTH_MIN
+ *                     samples, or no tone clear of the DC lobe
+ */
+HAL_StatusTypeDef dspQuality_analyse(const uint16_t *samples, uint32_t count,
+                                     DSP_QualityResult_t *result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DSP_QUALITY_H */
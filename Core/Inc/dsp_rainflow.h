@@ -0,0 +1,238 @@
+/**
+ ******************************************************************************
+ * @file    dsp_rainflow.h
+ * @brief   Streaming rainflow cycle counting and a Miner's-rule damage sum
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * Fatigue life depends on the load cycles a part has seen, counted by
+ * rainflow (ASTM E1049): every closed hysteresis loop of the signal is a
+ * cycle of its range and mean. Counted offline it needs the whole record;
+ * counted here it needs the residual turning points only.
+ *
+ * Per channel, on the raw codes of every block:
+ *   - turning points: a reversal is one once the signal has come back
+ *     more than hysteresis_codes from the extreme, so noise below that
+ *     never makes cycles
+ *   - four-point rule: with turning points A B C D on the stack, B-C is a
+ *     closed cycle when |C - B| <= |B - A| and |C - B| <= |D - C|; it is
+ *     counted and B and C leave the stack
+ *   - bounded residual: the stack holds DSP_RAINFLOW_STACK points; when
+ *     full its oldest range is counted as a half cycle and dropped
+ *
+ * Cycles go into a range x mean matrix of DSP_RAINFLOW_RANGE_BINS x
+ * DSP_RAINFLOW_MEAN_BINS cells, in half cycles (a full cycle adds 2). The
+ * last range bin and the end mean bins hold everything beyond them.
+ *
+ * With an S-N table, each cycle of range S (codes x units_per_code) also
+ * adds 1 / N(S) to the damage sum, N read log-log between the points of
+ * the table and extrapolated on its last segment; ranges below the first
+ * point are under the endurance limit and add nothing. A sum of 1 is the
+ * predicted failure. At most one logf and one expf per counted cycle.
+ *
+ * dspRainflow_snapshot() copies one channel; its damage_residual also
+ * counts the turning points still on the stack as half cycles, the damage
+ * if the record ended now (the residual itself stays for later cycles).
+ *
+ * Usage Example:
+ *   static DSP_Rainflow_t rf;
+ *   static const DSP_RainflowSn_t sn = {2, {100.0f, 1000.0f},
+ *                                       {1e7f, 1e4f}}; // m = 3
+ *   const DSP_RainflowConfig_t cfg = {.hysteresis_codes = 8,
+ *       .range_bin_codes = 32.0f, .mean_low_codes = 1792.0f,
+ *       .mean_bin_codes = 64.0f, .units_per_code = 1.22f, .sn = &sn};
+ *   dspRainflow_init(&rf, &cfg, analogSensor_getBlockChannelMap());
+ *   dspRainflow_setChannels(&rf, 0x0F);
+ *
+ *   // in the block callback (ISR)
+ *   dspRainflow_process(&rf, block, frame_count);
+ *
+ *   // main loop
+ *   static DSP_RainflowResult_t res;
+ *   dspRainflow_snapshot(&rf, 0, &res, 0);
+ *
+ * @note About 600 bytes per channel at the default sizes. The turning
+ *       points are integer codes, so the counting itself is exact.
+ ******************************************************************************
+ */
+
+#ifndef DSP_RAINFLOW_H
+#define DSP_RAINFLOW_H
+
+#include "adc_conversions.h"
+#include "arm_math.h"
+#include "stm32f7xx_hal.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+
+/**
+ * @brief Range and mean bins of the cycle matrix
+ */
+#ifndef DSP_RAINFLOW_RANGE_BINS
+#define DSP_RAINFLOW_RANGE_BINS 16U
+#endif
+#ifndef DSP_RAINFLOW_MEAN_BINS
+#define DSP_RAINFLOW_MEAN_BINS 8U
+#endif
+
+/**
+ * @brief Residual turning points kept per channel
+ */
+#ifndef DSP_RAINFLOW_STACK
+#define DSP_RAINFLOW_STACK 32U
+#endif
+
+/**
+ * @brief Points of an S-N table
+ */
+#define DSP_RAINFLOW_SN_POINTS 8U
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief S-N curve: cycles to failure at each stress range
+ */
+typedef struct {
+  uint8_t count;                            ///< Points, 2..8
+  float32_t range[DSP_RAINFLOW_SN_POINTS];  ///< Stress range, ascending
+  float32_t cycles[DSP_RAINFLOW_SN_POINTS]; ///< Cycles to failure at it
+} DSP_RainflowSn_t;
+
+/**
+ * @brief Counting settings, shared by every channel
+ */
+typedef struct {
+  uint16_t hysteresis_codes;  ///< Smallest reversal that is a turning point
+  float32_t range_bin_codes;  ///< Width of a range bin
+  float32_t mean_low_codes;   ///< Lower edge of the first mean bin
+  float32_t mean_bin_codes;   ///< Width of a mean bin
+  float32_t units_per_code;   ///< S-N range units per code
+  const DSP_RainflowSn_t *sn; ///< S-N table, NULL = no damage sum
+} DSP_RainflowConfig_t;
+
+/**
+ * @brief Counting state and results of one channel
+ */
+typedef struct {
+  int16_t stack[DSP_RAINFLOW_STACK]; ///< Residual turning points
+  uint8_t depth;                     ///< Points on the stack
+  int8_t direction;                  ///< +1 rising, -1 falling, 0 not yet
+  int16_t extreme;                   ///< Extreme since the last turn
+  uint16_t largest_range;            ///< Largest range counted (codes)
+  uint32_t half_cycles[DSP_RAINFLOW_RANGE_BINS][DSP_RAINFLOW_MEAN_BINS];
+  uint32_t half_total;               ///< Sum of half_cycles[][]
+  uint32_t overflows;                ///< Half cycles forced by a full stack
+  float32_t damage;                  ///< Miner sum of the counted cycles
+  float32_t damage_carry;            ///< Compensation of the damage sum
+} DSP_RainflowChannel_t;
+
+/**
+ * @brief Rainflow counter of one block stream, raw slot order
+ */
+typedef struct {
+  DSP_RainflowConfig_t cfg;
+  float32_t sn_log_range[DSP_RAINFLOW_SN_POINTS];  ///< ln S of each point
+  float32_t sn_log_cycles[DSP_RAINFLOW_SN_POINTS]; ///< ln N of each point
+  float32_t sn_slope[DSP_RAINFLOW_SN_POINTS];      ///< -d ln N / d ln S
+  uint8_t slot_channel[ADC_CONVERSIONS_CHANNEL_COUNT]; ///< Raw slot -> ch
+  volatile ADC_ChannelMask_t mask; ///< Channels counted
+  DSP_RainflowChannel_t slot[ADC_CONVERSIONS_CHANNEL_COUNT];
+} DSP_Rainflow_t;
+
+/**
+ * @brief Counts of one channel at one instant
+ */
+typedef struct {
+  uint8_t channel;
+  uint8_t residual;          ///< Ranges left on the stack
+  uint16_t largest_range;    ///< Largest range counted (codes)
+  uint32_t half_cycles[DSP_RAINFLOW_RANGE_BINS][DSP_RAINFLOW_MEAN_BINS];
+  uint32_t half_total;       ///< Sum of half_cycles[][]
+  uint32_t overflows;        ///< Half cycles forced by a full stack
+  float32_t damage;          ///< Miner sum of the counted cycles
+  float32_t damage_residual; ///< ... plus the residual as half cycles
+} DSP_RainflowResult_t;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief Set up the counter, every channel off and empty
+ *
+ * @param rf          Instance
+ * @param cfg         Settings, copied; cfg->sn must outlive the instance
+ * @param channel_map Raw block slot -> channel (NULL = identity)
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer, a bin width or scale not above 0, or
+ *                     an invalid S-N table
+ */
+HAL_StatusTypeDef dspRainflow_init(DSP_Rainflow_t *rf,
+                                   const DSP_RainflowConfig_t *cfg,
+                                   const uint8_t *channel_map);
+
+/**
+ * @brief Channels counted; a channel switched on starts a new record
+ *
+ * @param rf   Instance
+ * @param mask Channel bits
+ */
+void dspRainflow_setChannels(DSP_Rainflow_t *rf, ADC_ChannelMask_t mask);
+
+/**
+ * @brief Count the turning points and cycles of one block of raw frames
+ *
+ * @param rf     Instance
+ * @param block  Raw frames
+ * @param frames Frames in the block
+ */
+void dspRainflow_process(DSP_Rainflow_t *rf, const uint16_t *block,
+                         uint32_t frames);
+
+/**
+ * @brief Copy the counts of one channel, consistent with the block in
+ *        progress
+ *
+ * @param rf      Instance
+ * @param channel Channel index
+ * @param res     Destination
+ * @param reset   Non-zero to clear the channel's cycles and damage in the
+ *                same section (its residual stays)
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer or channel out of range
+ */
+HAL_StatusTypeDef dspRainflow_snapshot(DSP_Rainflow_t *rf, uint8_t channel,
+                                       DSP_RainflowResult_t *res,
+                                       uint8_t reset);
+
+/**
+ * @brief Clear the cycles and damage of every channel; residuals stay
+ *
+ * @param rf Instance
+ */
+void dspRainflow_reset(DSP_Rainflow_t *rf);
+
+/**
+ * @brief Damage of one cycle of a range, 1 / N(S); 0 without an S-N table
+ *        or below its first point
+ *
+ * @param rf          Instance
+ * @param range_codes Range in codes
+ */
+float32_t dspRainflow_cycleDamage(const DSP_Rainflow_t *rf,
+                                  float32_t range_codes);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DSP_RAINFLOW_H */
@@ -0,0 +1,268 @@
+/**
+ ******************************************************************************
+ * @file    dsp_sdft.h
+ * @brief   Damped sliding DFT: a few bins per channel, updated every sample
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * A block FFT or a Goertzel window gives a new spectrum once every N
+ * samples. A control loop that tracks a line (amplitude and phase of a
+ * vibration order, the mains hum on a channel) wants it at every sample.
+ * The sliding DFT moves the N-sample window by one sample per update:
+ *
+ *   X[n] = c (X[n-1] + v[n] - r^N v[n-N]),   c = r e^(j 2 pi k / N)
+ *
+ * one complex multiply and an add per bin and sample, plus one history
+ * read and write per channel, whatever the window length.
+ *
+ * With r = 1 the recursion is marginally stable: a rounding error stays in
+ * X for good, and the float state drifts. With r slightly below 1 every
+ * error decays with time constant 1 / (1 - r) samples, at the price of an
+ * exponential taper over the window (the oldest sample weighs r^N; about
+ * 0.975 at the defaults, corrected in the amplitude).
+ *
+ * Frequencies are snapped to the nearest k fs / N, so DC and tones on other
+ * bins do not leak into a bin. The previous window's mean is removed from
+ * the input, as in dsp_goertzel.h; the history holds the samples after the
+ * removal, so a new mean does not leave a residue in X.
+ *
+ * The state is published under a sequence counter, odd while a frame is
+ * being pushed, the same scheme as analogSensor_getLatestFrame():
+ * dspSdft_getLatest() copies the bins of the newest complete frame from
+ * any context and priority, without masking interrupts, and gives the
+ * 0-pk amplitude and the phase of each bin at the newest sample. The
+ * spectral latency is one sample instead of a block or a window.
+ *
+ * Two ways to feed it:
+ *   - dspSdft_process(): raw codes of an interleaved block
+ *   - dspFused_attachSdft(): mg values inside the fused kernel
+ *     (dsp_fused.h), before its low-pass, in the same pass over the block
+ *
+ * Usage Example:
+ *   static DSP_Sdft_t sdft;
+ *   static const float32_t lines[] = {50.0f, 100.0f};
+ *   dspSdft_init(&sdft, 4000.0f, 256, 0.0f,
+ *                analogSensor_getBlockChannelMap());
+ *   dspSdft_setBins(&sdft, 0, lines, 2);
+ *
+ *   // in the block callback (ISR)
+ *   dspSdft_process(&sdft, block, frame_count);
+ *
+ *   // any context, any time
+ *   DSP_SdftLatest_t now;
+ *   if (dspSdft_getLatest(&sdft, &now) == HAL_OK) {
+ *     // now.amplitude[0][b], now.phase[0][b] as of sample now.sample
+ *   }
+ *
+ * @note RAM is 4 bytes x DSP_SDFT_MAX_LENGTH per channel of history, about
+ *       6 kB at the default 256. Channels without bins skip the update.
+ ******************************************************************************
+ */
+
+#ifndef DSP_SDFT_H
+#define DSP_SDFT_H
+
+#include "adc_conversions.h"
+#include "arm_math.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+
+/**
+ * @brief Bins per channel
+ */
+#ifndef DSP_SDFT_MAX_BINS
+#define DSP_SDFT_MAX_BINS 4U
+#endif
+
+/**
+ * @brief Longest window (history samples per channel)
+ */
+#ifndef DSP_SDFT_MAX_LENGTH
+#define DSP_SDFT_MAX_LENGTH 256U
+#endif
+
+/**
+ * @brief Shortest window
+ */
+#define DSP_SDFT_LENGTH_MIN 16U
+
+/**
+ * @brief Damping r when dspSdft_init() is given 0: errors decay over about
+ *        10^4 samples (2.5 s at 4 kHz)
+ */
+#ifndef DSP_SDFT_DAMPING
+#define DSP_SDFT_DAMPING 0.9999f
+#endif
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief Bins of the newest complete frame
+ */
+typedef struct {
+  uint32_t sample; ///< Index of the newest sample since init
+  uint8_t bin_count[ADC_CONVERSIONS_CHANNEL_COUNT];
+  float32_t hz[ADC_CONVERSIONS_CHANNEL_COUNT]
+              [DSP_SDFT_MAX_BINS]; ///< Bin frequency k fs / N
+  float32_t amplitude[ADC_CONVERSIONS_CHANNEL_COUNT]
+                     [DSP_SDFT_MAX_BINS]; ///< 0-pk, units of the input
+  float32_t phase[ADC_CONVERSIONS_CHANNEL_COUNT]
+                 [DSP_SDFT_MAX_BINS]; ///< Of the bin's cosine at sample, rad
+} DSP_SdftLatest_t;
+
+/**
+ * @brief Sliding DFT state (one instance per block stream), channel order
+ */
+typedef struct {
+  float32_t sample_rate_hz;
+  uint16_t length;     ///< N, window samples
+  float32_t damping;   ///< r
+  float32_t damping_n; ///< r^N, applied to the sample leaving the window
+  float32_t scale;     ///< |X| -> 0-pk amplitude: 2 (1 - r) / (r (1 - r^N))
+  uint8_t slot_channel[ADC_CONVERSIONS_CHANNEL_COUNT]; ///< Raw slot -> ch
+  uint8_t bin_count[ADC_CONVERSIONS_CHANNEL_COUNT];
+  float32_t bin_hz[ADC_CONVERSIONS_CHANNEL_COUNT][DSP_SDFT_MAX_BINS];
+  float32_t c_re[ADC_CONVERSIONS_CHANNEL_COUNT][DSP_SDFT_MAX_BINS]; ///< c
+  float32_t c_im[ADC_CONVERSIONS_CHANNEL_COUNT][DSP_SDFT_MAX_BINS];
+  float32_t re[ADC_CONVERSIONS_CHANNEL_COUNT][DSP_SDFT_MAX_BINS];   ///< X
+  float32_t im[ADC_CONVERSIONS_CHANNEL_COUNT][DSP_SDFT_MAX_BINS];
+  float32_t history[ADC_CONVERSIONS_CHANNEL_COUNT]
+                   [DSP_SDFT_MAX_LENGTH]; ///< v of the last N samples
+  float32_t dc[ADC_CONVERSIONS_CHANNEL_COUNT];  ///< Removed from the input
+  float32_t sum[ADC_CONVERSIONS_CHANNEL_COUNT]; ///< Input total this window
+  uint16_t pos;        ///< History slot of the current sample
+  uint16_t count;      ///< Samples into the mean window
+  uint32_t filled;     ///< Samples since the last restart, up to N
+  uint32_t samples;    ///< Samples since init
+  volatile uint32_t seq; ///< Odd while a frame is pushed
+} DSP_Sdft_t;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief Reset the instance with no bins
+ *
+ * @param sd             Instance
+ * @param sample_rate_hz Input sample rate
+ * @param length         Window N, DSP_SDFT_LENGTH_MIN..DSP_SDFT_MAX_LENGTH;
+ *                       bin spacing is sample_rate_hz / length
+ * @param damping        r in (0.99, 1), or 0 for DSP_SDFT_DAMPING
+ * @param channel_map    Raw block slot -> channel (NULL = identity)
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL instance, rate not positive, length or damping
+ *                     out of range
+ */
+HAL_StatusTypeDef dspSdft_init(DSP_Sdft_t *sd, float32_t sample_rate_hz,
+                               uint16_t length, float32_t damping,
+                               const uint8_t *channel_map);
+
+/**
+ * @brief Choose the bins of a channel; restarts the window of every channel
+ *
+ * @param sd      Instance
+ * @param channel Channel index
+ * @param hz      Frequencies, each snapped to the nearest bin
+ * @param count   Entries, 0..DSP_SDFT_MAX_BINS
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success; no result until N samples have been pushed
+ *   @retval HAL_ERROR Invalid argument, or a frequency that snaps to DC or
+ *                     to Nyquist and above
+ */
+HAL_StatusTypeDef dspSdft_setBins(DSP_Sdft_t *sd, uint8_t channel,
+                                  const float32_t *hz, uint8_t count);
+
+/**
+ * @brief Run one block of interleaved raw frames (codes) through the bins
+ *
+ * @param sd     Instance
+ * @param block  Raw frames
+ * @param frames Frames in the block
+ */
+void dspSdft_process(DSP_Sdft_t *sd, const uint16_t *block, uint32_t frames);
+
+/**
+ * @brief Amplitude and phase of every bin as of the newest complete frame
+ *
+ * Retries while a frame is being pushed, so the bins of all channels come
+ * from the same sample.
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    latest filled
+ *   @retval HAL_BUSY  Window not full yet since init or the last setBins
+ *   @retval HAL_ERROR NULL pointer
+ */
+HAL_StatusTypeDef dspSdft_getLatest(DSP_Sdft_t *sd, DSP_SdftLatest_t *latest);
+
+/**
+ * @brief Close the mean window; called by dspSdft_endFrame()
+ */
+void dspSdft_endWindow(DSP_Sdft_t *sd);
+
+/**
+ * @brief Start of a frame: the snapshot is inconsistent until
+ *        dspSdft_endFrame()
+ */
+static inline void dspSdft_beginFrame(DSP_Sdft_t *sd) {
+  sd->seq++;
+  __DMB();
+}
+
+/**
+ * @brief Add one sample of a channel (channel order)
+ */
+static inline void dspSdft_push(DSP_Sdft_t *sd, uint8_t channel,
+                                float32_t x) {
+  const uint8_t n = sd->bin_count[channel];
+  if (n == 0U) {
+    return;
+  }
+  float32_t *slot = &sd->history[channel][sd->pos];
+  const float32_t v = x - sd->dc[channel];
+  const float32_t delta = v - sd->damping_n * *slot;
+  const float32_t *cr = sd->c_re[channel];
+  const float32_t *ci = sd->c_im[channel];
+  float32_t *re = sd->re[channel];
+  float32_t *im = sd->im[channel];
+
+  *slot = v;
+  sd->sum[channel] += x;
+  for (uint8_t b = 0; b < n; b++) {
+    const float32_t a = re[b] + delta;
+    re[b] = cr[b] * a - ci[b] * im[b];
+    im[b] = ci[b] * a + cr[b] * im[b];
+  }
+}
+
+/**
+ * @brief End of a frame: every channel has been pushed once
+ */
+static inline void dspSdft_endFrame(DSP_Sdft_t *sd) {
+  if (++sd->pos >= sd->length) {
+    sd->pos = 0;
+  }
+  if (sd->filled < sd->length) {
+    sd->filled++;
+  }
+  sd->samples++;
+  if (++sd->count >= sd->length) {
+    dspSdft_endWindow(sd);
+  }
+  __DMB();
+  sd->seq++;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DSP_SDFT_H */
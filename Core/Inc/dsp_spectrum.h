@@ -0,0 +1,437 @@
+/**
+ ******************************************************************************
+ * @file    dsp_spectrum.h
+ * @brief   Welch-averaged FFT spectrum and vibration features per channel
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * One instance analyses one channel of the block stream. The block callback
+ * only writes samples into a history ring; every hop samples a window ends
+ * and its position is handed to the main loop, which reads it from the
+ * ring with the mean removed and the window (Hann or flat-top) applied in
+ * the same pass, runs arm_rfft_fast_f32() and accumulates the power
+ * spectrum. Windows overlap by 50 % or 75 % (Welch); the overlap costs no
+ * copy, the next window simply starts hop samples further. After the
+ * configured number of averages a result is published:
+ *   - peak frequency (parabolic interpolation) and amplitude above
+ *     min_peak_hz; flat-top gives the most accurate amplitude
+ *   - total AC RMS and RMS in up to DSP_SPECTRUM_MAX_BANDS bands
+ *   - the spectral kurtosis of each band: per bin, over the averaged
+ *     segments, SK = M / (M - 1) x ((M + 1) sum|X|^4 / (sum|X|^2)^2 - 2),
+ *     then the mean over the band's bins. About 0 for stationary noise, -1
+ *     for a steady tone, and large where impacts excite the band (bearing
+ *     faults long before the RMS moves). Needs averages >= 2, else 0.
+ *   - the amplitude at up to DSP_SPECTRUM_MAX_TONES given frequencies
+ *     (bearing fault orders on an envelope spectrum): the largest bin
+ *     within tone_search_hz of each, interpolated as the peak
+ *   - optionally, the RMS in each band of a log-spaced table, 1/1 or 1/3
+ *     octave (dsp_bands.h): 20 to 30 values for the whole spectrum
+ *   - optionally, the largest peaks of the power cepstrum (below)
+ * All amplitudes are in ADC codes.
+ *
+ * Power cepstrum: a gearbox fault modulates the mesh tone at the shaft
+ * rate, so its spectrum grows a family of sidebands spaced by that rate,
+ * too many and too close to read one by one. The log of the averaged power
+ * spectrum turns the family into a ripple, and the inverse FFT of the log
+ * (the cepstrum) into a peak at the quefrency 1 / spacing:
+ *
+ *   c[q] = IFFT(ln P[k])[q],  peak at q / fs = 1 / spacing  (seconds)
+ *
+ * With cepstrum_count set, an extra step after the last segment takes the
+ * log of the Welch sum (a bit-trick log2, 0.005 octave at worst, floored
+ * 90 dB below the largest bin), runs the inverse arm_rfft_fast_f32() with
+ * the instance's own tables on the stage's shared FFT buffers, and keeps
+ * the cepstrum_count largest local maxima between cepstrum_min_ms and
+ * cepstrum_max_ms, interpolated as the spectrum peak. A quefrency in ms is
+ * a spacing of 1000 / ms Hz; the amplitude (nepers of power) grows with
+ * the depth of the modulation. Rahmonics at 2q, 3q of a strong family may
+ * take the lower places.
+ *
+ * A result is a few dozen bytes, instead of kilobytes of raw samples per
+ * second.
+ *
+ * A segment hook (dspSpectrum_setSegmentHook()) sees the complex bins of
+ * every transformed segment, e.g. for the cross-spectra of dsp_coherence.h.
+ * Segments are numbered from init, dropped ones included, so instances fed
+ * from the same blocks can match theirs up.
+ *
+ * The ring holds DSP_SPECTRUM_RING_LENGTH samples: the window in hand plus
+ * at least one hop, so the main loop has until the next window ends to
+ * read it, as it had with a segment copy. A window the ISR supersedes
+ * before it is taken, or overwrites while it is read, is dropped and
+ * counted in overruns.
+ *
+ * dspSpectrum_poll() does a whole segment at once. dspSpectrum_step()
+ * does it in resumable steps (transform, cepstrum, publish), so a scheduler
+ * (fft_sched.h) can spread the segments of several instances over
+ * successive passes instead of running them all in one.
+ *
+ * Usage Example:
+ *   static DSP_Spectrum_t spec;
+ *   DSP_SpectrumConfig_t cfg = {.length = 1024, .window = DSP_WINDOW_HANN,
+ *                               .averages = 4, .sample_rate_hz = 4000.0f,
+ *                               .min_peak_hz = 5.0f, .band_count = 1,
+ *                               .bands = {{10.0f, 1000.0f}}};
+ *   dspSpectrum_init(&spec, 0, analogSensor_getBlockChannelMap(), &cfg);
+ *
+ *   // in the block callback (ISR)
+ *   dspSpectrum_process(&spec, block, frame_count);
+ *
+ *   // main loop
+ *   dspSpectrum_poll(&spec);
+ *   DSP_SpectrumResult_t res;
+ *   if (dspSpectrum_getResult(&spec, &res) == HAL_OK) {
+ *     // res.peak_hz, res.peak_amplitude, res.band_rms[0]
+ *   }
+ *
+ * @note RAM per instance is about 14 bytes x DSP_SPECTRUM_BUFFER_LENGTH.
+ *       Raise the define to 4096 for the longest transforms.
+ ******************************************************************************
+ */
+
+#ifndef DSP_SPECTRUM_H
+#define DSP_SPECTRUM_H
+
+#include "adc_conversions.h"
+#include "arm_math.h"
+#include "dsp_bands.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+
+#define DSP_SPECTRUM_LENGTH_MIN 256U  ///< Shortest transform
+#define DSP_SPECTRUM_LENGTH_MAX 4096U ///< Longest arm_rfft_fast_f32 length
+#define DSP_SPECTRUM_MAX_BANDS 4U     ///< Band energies per result
+#define DSP_SPECTRUM_MAX_TONES 4U     ///< Tone amplitudes per result
+#define DSP_SPECTRUM_MAX_CEPSTRUM 4U  ///< Quefrency peaks per result
+
+/**
+ * @brief Longest transform the instance buffers can hold
+ */
+#ifndef DSP_SPECTRUM_BUFFER_LENGTH
+#define DSP_SPECTRUM_BUFFER_LENGTH 1024U
+#endif
+
+/**
+ * @brief History ring: the longest window plus half of one
+ */
+#define DSP_SPECTRUM_RING_LENGTH                                             \
+  (DSP_SPECTRUM_BUFFER_LENGTH + DSP_SPECTRUM_BUFFER_LENGTH / 2U)
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief Analysis window
+ */
+typedef enum {
+  DSP_WINDOW_HANN = 0, ///< Good frequency resolution, -1.4 dB scalloping
+  DSP_WINDOW_FLATTOP   ///< Accurate amplitude, wide main lobe
+} DSP_SpectrumWindow_t;
+
+/**
+ * @brief Window overlap (hop = length / 2 or length / 4)
+ */
+typedef enum {
+  DSP_SPECTRUM_OVERLAP_50 = 0, ///< Welch's usual choice
+  DSP_SPECTRUM_OVERLAP_75      ///< Lower variance per second, twice the FFTs
+} DSP_SpectrumOverlap_t;
+
+/**
+ * @brief Steps of one segment, in order
+ */
+typedef enum {
+  DSP_SPECTRUM_STEP_NONE = 0,  ///< No segment in hand
+  DSP_SPECTRUM_STEP_TRANSFORM, ///< Windowed read, FFT, hook, Welch sums
+  DSP_SPECTRUM_STEP_CEPSTRUM,  ///< Log, inverse FFT, quefrency peaks
+  DSP_SPECTRUM_STEP_PUBLISH    ///< Features of the finished average
+} DSP_SpectrumStep_t;
+
+/**
+ * @brief Frequency band, inclusive edges
+ */
+typedef struct {
+  float32_t low_hz;
+  float32_t high_hz;
+} DSP_SpectrumBand_t;
+
+/**
+ * @brief Called from dspSpectrum_poll() with each transformed segment
+ *
+ * @param channel Analysed channel
+ * @param index   Segment number since init (overruns leave gaps)
+ * @param bins    arm_rfft_fast_f32() output of the windowed, mean-free
+ *                segment: [0] = DC, [1] = Nyquist, then re/im of bins
+ *                1..length/2-1. Valid during the call only.
+ * @param ctx     User context given with the hook
+ */
+typedef void (*DSP_SpectrumSegmentHook_t)(uint8_t channel, uint32_t index,
+                                          const float32_t *bins, void *ctx);
+
+/**
+ * @brief Analysis settings
+ */
+typedef struct {
+  uint16_t length;             ///< Power of two, 256..BUFFER_LENGTH
+  DSP_SpectrumWindow_t window; ///< Analysis window
+  uint8_t averages;            ///< Welch segments per result, >= 1
+  DSP_SpectrumOverlap_t overlap; ///< Of consecutive segments
+  float32_t sample_rate_hz;    ///< Frame rate of the block stream
+  float32_t min_peak_hz;       ///< Ignore the peak search below this
+  uint8_t band_count;          ///< Entries used in bands[]
+  DSP_SpectrumBand_t bands[DSP_SPECTRUM_MAX_BANDS];
+  uint8_t tone_count;          ///< Entries used in tone_hz[]
+  float32_t tone_hz[DSP_SPECTRUM_MAX_TONES]; ///< Frequencies to measure
+  float32_t tone_search_hz;    ///< Half-width searched around each (slip)
+  const DSP_BandTable_t *band_table; ///< Log bands to sum, NULL = none;
+                                     ///< not copied, must outlive the stage
+  uint8_t cepstrum_count;      ///< Quefrency peaks to find, 0 = none
+  float32_t cepstrum_min_ms;   ///< Searched from (> 0 when used) ...
+  float32_t cepstrum_max_ms;   ///< ... to, 0 = half the window
+} DSP_SpectrumConfig_t;
+
+/**
+ * @brief Features of one averaged spectrum
+ */
+typedef struct {
+  uint32_t sequence;                        ///< Results published so far
+  float32_t peak_hz;                        ///< Dominant frequency
+  float32_t peak_amplitude;                 ///< Its amplitude (codes, 0-pk)
+  float32_t rms;                            ///< AC RMS over all bins (codes)
+  uint8_t band_count;                       ///< Entries used in band_rms[]
+  float32_t band_rms[DSP_SPECTRUM_MAX_BANDS]; ///< RMS per band (codes)
+  float32_t band_kurtosis[DSP_SPECTRUM_MAX_BANDS]; ///< Spectral kurtosis
+  uint8_t tone_count;                       ///< Entries used in tone_*[]
+  float32_t tone_hz[DSP_SPECTRUM_MAX_TONES];        ///< Frequency found
+  float32_t tone_amplitude[DSP_SPECTRUM_MAX_TONES]; ///< 0-pk (codes)
+  uint8_t log_band_count;                   ///< Bands of cfg band_table
+  float32_t log_band_rms[DSP_BANDS_MAX];    ///< RMS per log band (codes)
+  uint8_t cepstrum_count;                   ///< Peaks in cepstrum_*[]
+  float32_t cepstrum_ms[DSP_SPECTRUM_MAX_CEPSTRUM];        ///< Quefrency
+  float32_t cepstrum_amplitude[DSP_SPECTRUM_MAX_CEPSTRUM]; ///< Largest first
+} DSP_SpectrumResult_t;
+
+/**
+ * @brief Welch sums of one averaged spectrum, as dspSpectrum_features()
+ *        reads them; lets other transform paths (dsp_spectrum_q15.h) share
+ *        the feature extraction
+ */
+typedef struct {
+  const DSP_SpectrumConfig_t *cfg;
+  const float32_t *power;    ///< Sum of |X|^2 over cfg->averages segments,
+                             ///< bins 0..length/2, in codes x window
+  const float32_t *power_sq; ///< Sum of |X|^4, same bins
+  float32_t window_sum;      ///< Sum of w[n]
+  float32_t window_power;    ///< Sum of w[n]^2
+} DSP_SpectrumSums_t;
+
+/**
+ * @brief Spectrum stage state (one instance per analysed channel)
+ */
+typedef struct {
+  DSP_SpectrumConfig_t cfg;
+  uint8_t channel;                 ///< Analysed channel
+  uint8_t slot;                    ///< Its position in a raw block frame
+  arm_rfft_fast_instance_f32 rfft;
+  float32_t window_sum;            ///< Sum of w[n] (coherent gain x N)
+  float32_t window_power;          ///< Sum of w[n]^2
+  float32_t window[DSP_SPECTRUM_BUFFER_LENGTH];
+  float32_t ring[DSP_SPECTRUM_RING_LENGTH]; ///< History, filled by the ISR
+  uint16_t head;                   ///< Next write position in ring[]
+  uint16_t collected;              ///< Samples of the next window so far
+  uint16_t hop;                    ///< Window advance, from cfg.overlap
+  volatile uint32_t written;       ///< Samples written since init
+  uint16_t ready_pos;              ///< First sample of the ready window
+  uint32_t ready_end;              ///< written when it ended
+  volatile uint8_t segment_ready;  ///< 1 = a window waits in the ring
+  uint8_t stage;                   ///< Next DSP_SpectrumStep_t, NONE = idle
+  uint32_t segments;               ///< Segments completed, dropped included
+  uint32_t segment_index;          ///< Number of the ready window
+  DSP_SpectrumSegmentHook_t hook;  ///< Sees every transformed segment
+  void *hook_ctx;
+  float32_t power[DSP_SPECTRUM_BUFFER_LENGTH / 2U + 1U]; ///< Welch sum
+  float32_t power_sq[DSP_SPECTRUM_BUFFER_LENGTH / 2U + 1U]; ///< Sum |X|^4
+  uint8_t averaged;                ///< Segments in power[]
+  uint8_t cepstrum_found;          ///< Peaks of the average in hand
+  float32_t cepstrum_ms[DSP_SPECTRUM_MAX_CEPSTRUM]; ///< Until published
+  float32_t cepstrum_amplitude[DSP_SPECTRUM_MAX_CEPSTRUM];
+  uint32_t overruns;               ///< Segments dropped, main loop too slow
+  DSP_SpectrumResult_t result;     ///< Newest result
+  volatile uint32_t result_seq;    ///< Results published
+  uint32_t read_seq;               ///< Results consumed
+} DSP_Spectrum_t;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief Configure an instance for one channel
+ *
+ * @param sp          Instance
+ * @param channel     Channel to analyse
+ * @param channel_map Raw block slot -> channel (NULL = identity), see
+ *                    analogSensor_getBlockChannelMap()
+ * @param cfg         Settings, copied
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR Invalid argument (length, averages, overlap, rate,
+ *                     bands, tones or cepstrum)
+ */
+HAL_StatusTypeDef dspSpectrum_init(DSP_Spectrum_t *sp, uint8_t channel,
+                                   const uint8_t *channel_map,
+                                   const DSP_SpectrumConfig_t *cfg);
+
+/**
+ * @brief Collect the channel's samples from one block of raw frames
+ *
+ * Cheap enough for the block callback: a strided copy into the ring, and
+ * a few stores every hop frames.
+ *
+ * @param sp     Instance
+ * @param block  Raw frames
+ * @param frames Number of frames
+ */
+void dspSpectrum_process(DSP_Spectrum_t *sp, const uint16_t *block,
+                         uint32_t frames);
+
+/**
+ * @brief Collect already deinterleaved samples of the channel, e.g. the
+ *        output of a filter or decimation stage (pipeline.h)
+ *
+ * @param sp      Instance; cfg.sample_rate_hz must be the rate of samples
+ * @param samples Consecutive samples
+ * @param count   Number of samples
+ */
+void dspSpectrum_pushSamples(DSP_Spectrum_t *sp, const float32_t *samples,
+                             uint32_t count);
+
+/**
+ * @brief Transform a pending segment and publish a result when due
+ *
+ * Call from the main loop.
+ *
+ * @param sp Instance
+ */
+void dspSpectrum_poll(DSP_Spectrum_t *sp);
+
+/**
+ * @brief Run the next step of the pending segment, if any
+ *
+ * Same context as dspSpectrum_poll(), which it may be mixed with.
+ *
+ * @param sp Instance
+ *
+ * @return The step run, DSP_SPECTRUM_STEP_NONE if there was nothing to do
+ */
+DSP_SpectrumStep_t dspSpectrum_step(DSP_Spectrum_t *sp);
+
+/**
+ * @brief Steps left before the pending segment is done (0: idle)
+ */
+uint8_t dspSpectrum_pendingSteps(const DSP_Spectrum_t *sp);
+
+/**
+ * @brief Change the measured tones, e.g. fault orders at a new shaft speed
+ *
+ * Call from the context of dspSpectrum_poll(); applies from the next result.
+ *
+ * @param sp      Instance
+ * @param tone_hz Frequencies
+ * @param count   Entries, 0..DSP_SPECTRUM_MAX_TONES
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer, too many or negative tones
+ */
+HAL_StatusTypeDef dspSpectrum_setTones(DSP_Spectrum_t *sp,
+                                       const float32_t *tone_hz,
+                                       uint8_t count);
+
+/**
+ * @brief Change the cepstrum search
+ *
+ * Call from the context of dspSpectrum_poll(); applies from the next
+ * average.
+ *
+ * @param sp     Instance
+ * @param count  Peaks, 0 (off) .. DSP_SPECTRUM_MAX_CEPSTRUM
+ * @param min_ms Shortest quefrency searched, > 0
+ * @param max_ms Longest, 0 = half the window
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer, too many peaks or a bad range
+ */
+HAL_StatusTypeDef dspSpectrum_setCepstrum(DSP_Spectrum_t *sp, uint8_t count,
+                                          float32_t min_ms, float32_t max_ms);
+
+/**
+ * @brief Attach a hook called with the bins of every transformed segment
+ *
+ * Call before the first block; the hook runs in the dspSpectrum_poll()
+ * context.
+ *
+ * @param sp   Instance
+ * @param hook Hook, or NULL to detach
+ * @param ctx  Passed to the hook
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL instance
+ */
+HAL_StatusTypeDef dspSpectrum_setSegmentHook(DSP_Spectrum_t *sp,
+                                             DSP_SpectrumSegmentHook_t hook,
+                                             void *ctx);
+
+/**
+ * @brief Validate settings for a path whose buffers hold max_length
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer or invalid length, averages, overlap,
+ *                     rate, window, bands, tones or cepstrum range
+ */
+HAL_StatusTypeDef dspSpectrum_checkConfig(const DSP_SpectrumConfig_t *cfg,
+                                          uint16_t max_length);
+
+/**
+ * @brief Point n of the periodic analysis window of length points
+ */
+float32_t dspSpectrum_windowValue(DSP_SpectrumWindow_t window, uint16_t n,
+                                  uint16_t length);
+
+/**
+ * @brief Peak, RMS, band, tone and log band features of averaged Welch
+ *        sums; every field of result but sequence is written (no
+ *        cepstrum peaks: cepstrum_count = 0)
+ *
+ * @param sums   Sums of cfg->averages segments
+ * @param result Destination
+ */
+void dspSpectrum_features(const DSP_SpectrumSums_t *sums,
+                          DSP_SpectrumResult_t *result);
+
+/**
+ * @brief Take the newest result if one was published
+ *
+ * @param sp     Instance
+ * @param result Destination
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    New result copied
+ *   @retval HAL_BUSY  Nothing new since the previous call
+ *   @retval HAL_ERROR NULL pointer
+ */
+HAL_StatusTypeDef dspSpectrum_getResult(DSP_Spectrum_t *sp,
+                                        DSP_SpectrumResult_t *result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DSP_SPECTRUM_H */
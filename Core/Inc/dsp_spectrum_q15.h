@@ -0,0 +1,185 @@
+/**
+ ******************************************************************************
+ * @file    dsp_spectrum_q15.h
+ * @brief   Fixed-point (q15) Welch spectrum, the low-RAM twin of
+ *          dsp_spectrum.h
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * Same settings, features and results as DSP_Spectrum_t, with the sample
+ * buffers and the window in q15 and arm_rfft_q15() as the transform. RAM
+ * per instance is about 10 bytes x DSP_SPECTRUM_Q15_BUFFER_LENGTH instead
+ * of 16: six 4096-point instances take 240 kB instead of 384 kB, which is
+ * what lets them stay resident next to the block pool.
+ *
+ * Samples are kept as codes x 8 (3 fraction bits, -4096..4095.875 codes),
+ * so a filtered or mean-moved stream keeps some resolution below a code.
+ * Per segment the main loop
+ *   - removes the integer mean;
+ *   - block-scales: shifts left by the most bits that keep the largest
+ *     sample in q15, so a quiet segment uses the full word instead of its
+ *     bottom bits;
+ *   - windows (arm_mult_q15()) and transforms; the FFT halves at every
+ *     stage against overflow, which is the cost: its rounding floor is
+ *     about -80 dB per bin relative to the largest sample, at any length,
+ *     where the float path's is below -100 dB
+ *   - accumulates |X|^2 and |X|^4 in float, undoing the block shift and
+ *     the FFT scaling, so the sums and dspSpectrum_features() are shared
+ *     with the float path.
+ * sim/bench BM_spectrumF32_<n> and BM_spectrumQ15_<n> compare time, RAM,
+ * amplitude and floor of both paths at 256, 1024 and 4096 points.
+ *
+ * Keep the float path where the segment hook is needed (coherence) or for
+ * weak lines far below a strong one; take this one where the RAM matters
+ * more than the last 20 dB of floor (the sensors' own noise is usually
+ * above it).
+ *
+ * Usage Example:
+ *   static DSP_SpectrumQ15_t spec;
+ *   DSP_SpectrumConfig_t cfg = {.length = 1024, .window = DSP_WINDOW_HANN,
+ *                               .averages = 4, .sample_rate_hz = 4000.0f};
+ *   dspSpectrumQ15_init(&spec, 0, analogSensor_getBlockChannelMap(), &cfg);
+ *
+ *   // in the block callback (ISR)
+ *   dspSpectrumQ15_process(&spec, block, frame_count);
+ *
+ *   // main loop
+ *   dspSpectrumQ15_poll(&spec);
+ *   DSP_SpectrumResult_t res;
+ *   if (dspSpectrumQ15_getResult(&spec, &res) == HAL_OK) {
+ *     // res.peak_hz, res.peak_amplitude, res.band_rms[0]
+ *   }
+ *
+ * @note The rfft output buffer is shared by all instances (4 bytes x
+ *       DSP_SPECTRUM_Q15_BUFFER_LENGTH); poll them from one context.
+ ******************************************************************************
+ */
+
+#ifndef DSP_SPECTRUM_Q15_H
+#define DSP_SPECTRUM_Q15_H
+
+#include "dsp_spectrum.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+
+/**
+ * @brief Longest transform the instance buffers can hold
+ */
+#ifndef DSP_SPECTRUM_Q15_BUFFER_LENGTH
+#define DSP_SPECTRUM_Q15_BUFFER_LENGTH 1024U
+#endif
+
+/**
+ * @brief Fraction bits of the stored samples (codes x 2^bits)
+ */
+#define DSP_SPECTRUM_Q15_FRAC_BITS 3U
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief q15 spectrum stage state (one instance per analysed channel)
+ */
+typedef struct {
+  DSP_SpectrumConfig_t cfg;
+  uint8_t channel;                 ///< Analysed channel
+  uint8_t slot;                    ///< Its position in a raw block frame
+  arm_rfft_instance_q15 rfft;
+  float32_t window_sum;            ///< Sum of w[n] as stored in window[]
+  float32_t window_power;          ///< Sum of w[n]^2
+  q15_t window[DSP_SPECTRUM_Q15_BUFFER_LENGTH];
+  q15_t collect[DSP_SPECTRUM_Q15_BUFFER_LENGTH]; ///< Filled by the ISR
+  uint16_t collected;                            ///< Samples in collect[]
+  q15_t segment[DSP_SPECTRUM_Q15_BUFFER_LENGTH]; ///< Handed to the main loop
+  volatile uint8_t segment_ready;                ///< 1 = segment[] is full
+  uint8_t shift;                   ///< Block shift of the last segment
+  float32_t power[DSP_SPECTRUM_Q15_BUFFER_LENGTH / 2U + 1U]; ///< Welch sum
+  float32_t power_sq[DSP_SPECTRUM_Q15_BUFFER_LENGTH / 2U + 1U]; ///< |X|^4
+  uint8_t averaged;                ///< Segments in power[]
+  uint32_t overruns;               ///< Segments dropped, main loop too slow
+  DSP_SpectrumResult_t result;     ///< Newest result
+  volatile uint32_t result_seq;    ///< Results published
+  uint32_t read_seq;               ///< Results consumed
+} DSP_SpectrumQ15_t;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief Configure an instance for one channel
+ *
+ * @param sp          Instance
+ * @param channel     Channel to analyse
+ * @param channel_map Raw block slot -> channel (NULL = identity)
+ * @param cfg         Settings, copied; as dspSpectrum_init()
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR Invalid argument (length, averages, rate, bands,
+ *                     tones, an overlap other than 50 % or a cepstrum)
+ */
+HAL_StatusTypeDef dspSpectrumQ15_init(DSP_SpectrumQ15_t *sp, uint8_t channel,
+                                      const uint8_t *channel_map,
+                                      const DSP_SpectrumConfig_t *cfg);
+
+/**
+ * @brief Collect the channel's samples from one block of raw frames
+ *
+ * @param sp     Instance
+ * @param block  Raw frames
+ * @param frames Number of frames
+ */
+void dspSpectrumQ15_process(DSP_SpectrumQ15_t *sp, const uint16_t *block,
+                            uint32_t frames);
+
+/**
+ * @brief Collect already deinterleaved samples (codes), saturated to
+ *        -4096..4095.875
+ *
+ * @param sp      Instance; cfg.sample_rate_hz must be the rate of samples
+ * @param samples Consecutive samples
+ * @param count   Number of samples
+ */
+void dspSpectrumQ15_pushSamples(DSP_SpectrumQ15_t *sp,
+                                const float32_t *samples, uint32_t count);
+
+/**
+ * @brief Transform a pending segment and publish a result when due
+ *
+ * Call from the main loop.
+ *
+ * @param sp Instance
+ */
+void dspSpectrumQ15_poll(DSP_SpectrumQ15_t *sp);
+
+/**
+ * @brief Change the measured tones; as dspSpectrum_setTones()
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer, too many or negative tones
+ */
+HAL_StatusTypeDef dspSpectrumQ15_setTones(DSP_SpectrumQ15_t *sp,
+                                          const float32_t *tone_hz,
+                                          uint8_t count);
+
+/**
+ * @brief Take the newest result if one was published
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    New result copied
+ *   @retval HAL_BUSY  Nothing new since the previous call
+ *   @retval HAL_ERROR NULL pointer
+ */
+HAL_StatusTypeDef dspSpectrumQ15_getResult(DSP_SpectrumQ15_t *sp,
+                                           DSP_SpectrumResult_t *result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DSP_SPECTRUM_Q15_H */
@@ -0,0 +1,150 @@
+/**
+ ******************************************************************************
+ * @file    dsp_srs.h
+ * @brief   Shock response spectrum of a trigger capture (maximax absolute
+ *          acceleration of a bank of single-degree-of-freedom oscillators)
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * Shock qualification (MIL-STD-810, IEC 60068-2-27) compares shocks by
+ * their SRS: the largest absolute acceleration a mass on a spring of
+ * natural frequency fn and damping zeta would see when the base moves as
+ * measured. Each oscillator is the Smallwood ramp-invariant recursion
+ * (Smallwood 1981, ISO 18431-4):
+ *
+ *   y[n] = b0 x[n] + b1 x[n-1] + b2 x[n-2] + a1 y[n-1] + a2 y[n-2]
+ *
+ *   E = exp(-zeta w T), K = wd T, C = E cos K, S = E sin K, S' = S / K
+ *   b0 = 1 - S', b1 = 2 (S' - C), b2 = E^2 - S', a1 = 2 C, a2 = -E^2
+ *
+ * w = 2 pi fn, wd = w sqrt(1 - zeta^2), T the frame period. Exact for a
+ * piecewise-linear input, so it holds to a quarter of the rate, where the
+ * bank stops.
+ *
+ * The bank is laid out a coefficient per array, so the loop over the
+ * natural frequencies runs on one input sample at a time with the
+ * coefficients and states streamed from consecutive words; the peak is a
+ * max of |y| per oscillator (VMAXNM on the M7, no branch). After the
+ * capture the oscillators ring down with no input for one period of the
+ * lowest frequency, so a late residual peak is counted too.
+ *
+ * The input is one channel of a capture (adc_trigger.h) in codes; the
+ * mean of its pre-trigger frames is the zero (gravity and offset), and
+ * mg_per_code scales it.
+ *
+ * Usage Example:
+ *   static DSP_SrsBank_t bank;
+ *   static DSP_SrsResult_t res;
+ *   dspSrs_init(&bank, 4000.0f, 10.0f, 1000.0f, 6, 10.0f); // Q = 10
+ *
+ *   // main loop, once a capture is frozen
+ *   dspSrs_compute(&bank, frames, event->frame_count, ch,
+ *                  event->pre_frames, ADC_CAL_NOMINAL_MG_PER_CODE, &res);
+ *   // res.peak_mg[k] at bank.fn_hz[k]
+ *
+ * @note About 12 cycles per oscillator and frame: 40 oscillators over a
+ *       1024-frame capture are about 3 ms of the main loop per channel.
+ ******************************************************************************
+ */
+
+#ifndef DSP_SRS_H
+#define DSP_SRS_H
+
+#include "adc_conversions.h"
+#include "arm_math.h"
+#include "stm32f7xx_hal.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+
+/**
+ * @brief Natural frequencies per bank: 1/6 octaves over 8 octaves
+ */
+#ifndef DSP_SRS_MAX_FREQS
+#define DSP_SRS_MAX_FREQS 48U
+#endif
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief Oscillator bank at one rate, a coefficient per array
+ */
+typedef struct {
+  uint8_t count;            ///< Oscillators
+  uint8_t per_octave;       ///< Frequencies per octave
+  float32_t q;              ///< Quality factor, 1 / (2 zeta)
+  float32_t sample_rate_hz; ///< Rate the coefficients are for
+  float32_t fn_hz[DSP_SRS_MAX_FREQS]; ///< fn = first x 2^(k / per_octave)
+  float32_t b0[DSP_SRS_MAX_FREQS];
+  float32_t b1[DSP_SRS_MAX_FREQS];
+  float32_t b2[DSP_SRS_MAX_FREQS];
+  float32_t a1[DSP_SRS_MAX_FREQS];
+  float32_t a2[DSP_SRS_MAX_FREQS];
+} DSP_SrsBank_t;
+
+/**
+ * @brief SRS of one channel of one capture
+ */
+typedef struct {
+  uint8_t channel;
+  uint8_t count;                         ///< Entries in peak_mg[]
+  float32_t zero_code;                   ///< Pre-trigger mean, codes
+  float32_t input_peak_mg;               ///< Largest |input|
+  float32_t peak_mg[DSP_SRS_MAX_FREQS];  ///< Maximax |y| per oscillator
+} DSP_SrsResult_t;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief Build a bank of fractional-octave natural frequencies
+ *
+ * @param bank           Bank
+ * @param sample_rate_hz Frame rate of the captures
+ * @param first_hz       Lowest natural frequency
+ * @param last_hz        Highest wanted; the bank ends at or below it, and
+ *                       at or below a quarter of the rate
+ * @param per_octave     Frequencies per octave, 1..24
+ * @param q              Quality factor (10 = 5 % damping), above 0.5
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR Invalid argument, no frequency in range, or more
+ *                     than DSP_SRS_MAX_FREQS
+ */
+HAL_StatusTypeDef dspSrs_init(DSP_SrsBank_t *bank, float32_t sample_rate_hz,
+                              float32_t first_hz, float32_t last_hz,
+                              uint8_t per_octave, float32_t q);
+
+/**
+ * @brief SRS of one channel of a capture
+ *
+ * @param bank            Bank built for the capture's rate
+ * @param frames          Capture frames, channel order
+ * @param frame_count     Frames
+ * @param channel         Channel
+ * @param baseline_frames Leading frames averaged as the zero (0 = the
+ *                        first frame alone)
+ * @param mg_per_code     Scale of the input
+ * @param res             Result
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer, no frame or channel out of range
+ */
+HAL_StatusTypeDef dspSrs_compute(const DSP_SrsBank_t *bank,
+                                 const ADC_Frame_t *frames,
+                                 uint32_t frame_count, uint8_t channel,
+                                 uint32_t baseline_frames,
+                                 float32_t mg_per_code, DSP_SrsResult_t *res);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DSP_SRS_H */
@@ -0,0 +1,219 @@
+/**
+ ******************************************************************************
+ * @file    dsp_stats.h
+ * @brief   Single-pass per-channel statistics kernel for interleaved blocks
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * Accumulates count, sum, sum of squares, min and max of every channel in
+ * one pass over an interleaved DMA block, all in integers:
+ *   - two frames of a channel pair are repacked with PKHBT/PKHTB so that one
+ *     SMLAD adds two squares (and one more SMLAD against 0x00010001 two
+ *     samples) of the same channel
+ *   - USUB16 + SEL track min/max of two channels at once
+ *   - for the third and fourth moments, one SSUB16 centres both samples on
+ *     mid-scale (d = code - 2048), a 16 x 16 multiply squares each, and two
+ *     64-bit MACs per sample add d^3 and d^4
+ * Per-chunk partials are widened into the totals (64-bit integers, doubles
+ * for d^3 and d^4), so there is no division or float operation per sample.
+ * Mean, variance, RMS, peak-to-peak, crest factor, skewness and kurtosis
+ * are derived only when the totals are read. Centring on a fixed code keeps
+ * the totals additive (dspStats_merge()) and the double sums far from
+ * cancellation: deviations are at most 2048, not 4095.
+ *
+ * analogSensor_blockComplete() feeds the kernel; applications read the
+ * results with analogSensor_getChannelStats().
+ *
+ * Usage Example:
+ *   DSP_StatsAccum_t acc[ADC_CONVERSIONS_CHANNEL_COUNT];
+ *   dspStats_reset(acc);
+ *   dspStats_accumulate(acc, block, frame_count);   // slot order
+ *
+ *   ADC_ChannelStats_t out;
+ *   dspStats_compute(&acc[0], &out);
+ *
+ ******************************************************************************
+ */
+
+#ifndef DSP_STATS_H
+#define DSP_STATS_H
+
+#include "adc_conversions.h"
+#include <stdint.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+
+/**
+ * @brief Frames per 32-bit partial: 128 x 4095^2 < 2^31, so SMLAD never
+ *        saturates
+ */
+#define DSP_STATS_CHUNK_FRAMES 128U
+
+/**
+ * @brief SMLAD against this adds both halfwords
+ */
+#define DSP_STATS_ONES 0x00010001U
+
+/**
+ * @brief Centre of the higher moments (mid-scale), in both lanes
+ */
+#define DSP_STATS_MOMENT_REF 2048U
+#define DSP_STATS_MOMENT_REF2 (DSP_STATS_MOMENT_REF * DSP_STATS_ONES)
+
+/**
+ * @brief Channel pairs per frame; an odd last channel goes the scalar way
+ */
+#define DSP_STATS_PAIRS (ADC_CONVERSIONS_CHANNEL_COUNT / 2U)
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief Running integer totals of one channel
+ */
+typedef struct {
+  uint32_t count;  ///< Samples accumulated
+  uint64_t sum;    ///< Sum of codes
+  uint64_t sum_sq; ///< Sum of squared codes
+  uint16_t min;    ///< Smallest code (0xFFFF when empty)
+  uint16_t max;    ///< Largest code
+  double sum_cube; ///< Sum of (code - DSP_STATS_MOMENT_REF)^3
+  double sum_quad; ///< Sum of (code - DSP_STATS_MOMENT_REF)^4
+} DSP_StatsAccum_t;
+
+/**
+ * @brief Block-local 32-bit partials of one channel pair (SIMD kernels)
+ */
+typedef struct {
+  uint32_t sum[2];
+  uint32_t sum_sq[2];
+  uint32_t min; ///< Two 16-bit lanes
+  uint32_t max; ///< Two 16-bit lanes
+  int64_t sum_cube[2];  ///< 128 x 2048^3 < 2^63
+  uint64_t sum_quad[2]; ///< 128 x 2048^4 < 2^64
+} DSP_StatsPair_t;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief Two adjacent samples as one word (compiles to a single LDR)
+ */
+static inline uint32_t dspStats_load2(const uint16_t *p) {
+  uint32_t v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+/**
+ * @brief Add d^3 and d^4 of the two samples of one lane pair
+ *
+ * @param d Two signed deviations from DSP_STATS_MOMENT_REF
+ */
+static inline void dspStats_moments2(int64_t *cube, uint64_t *quad,
+                                     uint32_t d) {
+  // 16 x 16 products compile to SMULBB/SMULTT, the 64-bit sums to SMLAL
+  // and UMLAL
+  const int32_t d0 = (int16_t)d;
+  const int32_t d1 = (int16_t)(d >> 16);
+  const int32_t sq0 = d0 * d0;
+  const int32_t sq1 = d1 * d1;
+  *cube += (int64_t)sq0 * d0 + (int64_t)sq1 * d1;
+  *quad += (uint64_t)(uint32_t)sq0 * (uint32_t)sq0 +
+           (uint64_t)(uint32_t)sq1 * (uint32_t)sq1;
+}
+
+/**
+ * @brief Fold two frames of one channel pair into the partials
+ *
+ * a = (ch_lo, ch_hi) of frame f, b = the same pair of frame f + 1. Shared
+ * by dspStats_accumulate() and the fused kernel (dsp_fused.h).
+ */
+static inline void dspStats_pair2(DSP_StatsPair_t *p, uint32_t a,
+                                  uint32_t b) {
+  uint32_t lo = __PKHBT(a, b, 16); // ch_lo of f, f + 1
+  uint32_t hi = __PKHTB(b, a, 16); // ch_hi of f, f + 1
+
+  p->sum[0] = __SMLAD(lo, DSP_STATS_ONES, p->sum[0]);
+  p->sum[1] = __SMLAD(hi, DSP_STATS_ONES, p->sum[1]);
+  p->sum_sq[0] = __SMLAD(lo, lo, p->sum_sq[0]);
+  p->sum_sq[1] = __SMLAD(hi, hi, p->sum_sq[1]);
+  dspStats_moments2(&p->sum_cube[0], &p->sum_quad[0],
+                    __SSUB16(lo, DSP_STATS_MOMENT_REF2));
+  dspStats_moments2(&p->sum_cube[1], &p->sum_quad[1],
+                    __SSUB16(hi, DSP_STATS_MOMENT_REF2));
+
+  // GE flags select per lane: keep the larger / smaller halfword
+  __USUB16(a, p->max);
+  p->max = __SEL(a, p->max);
+  __USUB16(b, p->max);
+  p->max = __SEL(b, p->max);
+  __USUB16(p->min, a);
+  p->min = __SEL(a, p->min);
+  __USUB16(p->min, b);
+  p->min = __SEL(b, p->min);
+}
+
+/**
+ * @brief Add one sample the scalar way (odd frames and channels)
+ */
+static inline void dspStats_addSample(DSP_StatsAccum_t *acc, uint32_t v) {
+  const int32_t d = (int32_t)v - (int32_t)DSP_STATS_MOMENT_REF;
+  const int64_t sq = (int64_t)d * d;
+  acc->count++;
+  acc->sum += v;
+  acc->sum_sq += v * v;
+  acc->sum_cube += (double)(sq * d);
+  acc->sum_quad += (double)(sq * sq);
+  if (v < acc->min) {
+    acc->min = (uint16_t)v;
+  }
+  if (v > acc->max) {
+    acc->max = (uint16_t)v;
+  }
+}
+
+/**
+ * @brief Empty every accumulator of a block layout
+ *
+ * @param acc ADC_CONVERSIONS_CHANNEL_COUNT accumulators
+ */
+void dspStats_reset(DSP_StatsAccum_t *acc);
+
+/**
+ * @brief Add one block of interleaved frames
+ *
+ * @param acc    ADC_CONVERSIONS_CHANNEL_COUNT accumulators, indexed by the
+ *               sample's slot in a frame
+ * @param block  Raw frames, 4-byte aligned (DMA blocks are)
+ * @param frames Number of frames
+ */
+void dspStats_accumulate(DSP_StatsAccum_t *acc, const uint16_t *block,
+                         uint32_t frames);
+
+/**
+ * @brief Merge the totals of src into dst
+ *
+ * @param dst Accumulator being extended
+ * @param src Accumulator to add
+ */
+void dspStats_merge(DSP_StatsAccum_t *dst, const DSP_StatsAccum_t *src);
+
+/**
+ * @brief Derive the statistics of one accumulator
+ *
+ * @param acc Accumulator
+ * @param out Destination, all zero when acc is empty
+ */
+void dspStats_compute(const DSP_StatsAccum_t *acc, ADC_ChannelStats_t *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DSP_STATS_H */
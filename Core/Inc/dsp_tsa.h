@@ -0,0 +1,177 @@
+/**
+ ******************************************************************************
+ * @file    dsp_tsa.h
+ * @brief   Time-synchronous averaging of the order-tracked revolutions
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * The order resampler (dsp_order.h) takes samples_per_rev samples of every
+ * shaft revolution at the same angles. Averaging K such revolutions keeps
+ * what is locked to the shaft (a gear's meshing, a cracked tooth, an
+ * unbalance) and shrinks everything else by sqrt(K): other shafts, bearing
+ * tones, noise. The averaged revolution shows a local tooth fault as a
+ * bump at its angle long before it moves the spectrum, and it is one
+ * revolution of data for K.
+ *
+ * Each revolution fills a buffer as the resampler produces it; a complete
+ * one is added to the running sums (value and square), so there is never
+ * more than one revolution in hand. A revolution that loses a sample (a
+ * target already gone from the history) or is cut by a tracking restart
+ * is dropped and counted in rejected. After every K revolutions added a
+ * result is published and the sums start over:
+ *   - the averaged revolution, in ADC codes
+ *   - its mean, AC RMS and peak-to-peak
+ *   - the residual RMS: per angle, the spread of the K revolutions around
+ *     their average, over all angles. Non-synchronous vibration and noise;
+ *     the averaged revolution holds about residual / sqrt(K) of it.
+ *
+ * The angle reference is the tach edge that started the tracking. With one
+ * pulse per revolution it is the same after every restart, so the sums go
+ * on; with more, the resampler cannot tell which pulse it restarted on and
+ * the average starts over (dspTsa_restart()).
+ *
+ * Usage Example:
+ *   static DSP_Tsa_t tsa;
+ *   const DSP_TsaConfig_t cfg = {.samples_per_rev = 64, .revolutions = 32};
+ *   dspTsa_init(&tsa, &cfg);
+ *   dspOrder_attachTsa(&order, &tsa);   // fed from dspOrder_poll()
+ *
+ *   // main loop, after dspOrder_poll()
+ *   static DSP_TsaResult_t avg;
+ *   if (dspTsa_getResult(&tsa, &avg) == HAL_OK) {
+ *     // avg.samples[0 .. samples_per_rev - 1], avg.residual_rms
+ *   }
+ *
+ * @note Main loop only. RAM per instance is about 16 bytes x
+ *       DSP_TSA_MAX_SAMPLES.
+ ******************************************************************************
+ */
+
+#ifndef DSP_TSA_H
+#define DSP_TSA_H
+
+#include "arm_math.h"
+#include "stm32f7xx_hal.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+
+/**
+ * @brief Longest revolution an instance can average
+ */
+#ifndef DSP_TSA_MAX_SAMPLES
+#define DSP_TSA_MAX_SAMPLES 256U
+#endif
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief Averaging settings
+ */
+typedef struct {
+  uint16_t samples_per_rev; ///< The resampler's, 2..DSP_TSA_MAX_SAMPLES
+  uint16_t revolutions;     ///< Revolutions per result (K), >= 1
+} DSP_TsaConfig_t;
+
+/**
+ * @brief One averaged revolution
+ */
+typedef struct {
+  uint32_t sequence;        ///< Results published so far
+  uint16_t samples_per_rev; ///< Entries used in samples[]
+  uint16_t revolutions;     ///< Revolutions averaged (K)
+  uint16_t rejected;        ///< Revolutions dropped during this average
+  float32_t mean;           ///< Of samples[] (codes)
+  float32_t rms;            ///< AC RMS of samples[] (codes)
+  float32_t peak_to_peak;   ///< Of samples[] (codes)
+  float32_t residual_rms;   ///< Non-synchronous RMS of one revolution
+  float32_t samples[DSP_TSA_MAX_SAMPLES]; ///< Averaged revolution (codes)
+} DSP_TsaResult_t;
+
+/**
+ * @brief Averager state (one per tracked channel)
+ */
+typedef struct {
+  DSP_TsaConfig_t cfg;
+  uint16_t next;      ///< Position expected next in rev[]
+  uint8_t started;    ///< rev[] is being filled from position 0
+  uint8_t broken;     ///< rev[] lost a sample, dropped at its end
+  uint16_t averaged;  ///< Revolutions in the sums
+  uint16_t rejected;  ///< Revolutions dropped since the last result
+  uint32_t total;     ///< Revolutions added since init
+  uint32_t total_rejected; ///< Revolutions dropped since init
+  float32_t offset;   ///< Mean of the first revolution, out of the sums
+  float32_t rev[DSP_TSA_MAX_SAMPLES]; ///< Revolution in progress
+  float32_t sum[DSP_TSA_MAX_SAMPLES]; ///< Sum over averaged revolutions
+  float32_t sum_sq[DSP_TSA_MAX_SAMPLES]; ///< Sum of squares, same
+  DSP_TsaResult_t result; ///< Newest result
+  uint32_t result_seq;    ///< Results published
+  uint32_t read_seq;      ///< Results consumed
+} DSP_Tsa_t;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief Configure an instance
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer or invalid samples_per_rev, revolutions
+ */
+HAL_StatusTypeDef dspTsa_init(DSP_Tsa_t *tsa, const DSP_TsaConfig_t *cfg);
+
+/**
+ * @brief Add one angle-domain sample
+ *
+ * @param tsa      Instance
+ * @param position Its angle, 0..samples_per_rev - 1, from the reference
+ *                 edge; position 0 starts a revolution
+ * @param value    Sample (codes)
+ */
+void dspTsa_add(DSP_Tsa_t *tsa, uint16_t position, float32_t value);
+
+/**
+ * @brief The revolution in progress lost a sample
+ */
+void dspTsa_skip(DSP_Tsa_t *tsa);
+
+/**
+ * @brief Tracking restarted: drop the revolution in progress
+ *
+ * @param tsa  Instance
+ * @param keep 1 = the angle reference is unchanged, the sums go on;
+ *             0 = they start over too
+ */
+void dspTsa_restart(DSP_Tsa_t *tsa, uint8_t keep);
+
+/**
+ * @brief Change the revolutions per result; the average in hand starts
+ *        over
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer or 0 revolutions
+ */
+HAL_StatusTypeDef dspTsa_setRevolutions(DSP_Tsa_t *tsa, uint16_t revolutions);
+
+/**
+ * @brief Take the newest result if one was published
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    New result copied
+ *   @retval HAL_BUSY  Nothing new since the previous call
+ *   @retval HAL_ERROR NULL pointer
+ */
+HAL_StatusTypeDef dspTsa_getResult(DSP_Tsa_t *tsa, DSP_TsaResult_t *result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DSP_TSA_H */
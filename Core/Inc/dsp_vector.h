@@ -0,0 +1,147 @@
+/**
+ ******************************************************************************
+ * @file    dsp_vector.h
+ * @brief   Tri-axis vector magnitude and tilt of the LISXXXALH sensor groups
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * Every three channels are a tri-axis sensor: group 0 = channels 0-2 (X, Y,
+ * Z of sensor 1), group 1 = channels 3-5 and so on, as in
+ * adc_calibration.h. For each frame and group this computes, in mg and
+ * degrees:
+ *
+ *   magnitude = sqrt(x^2 + y^2 + z^2)
+ *   pitch     = atan2(-x, sqrt(y^2 + z^2))   -90..90
+ *   roll      = atan2(y, z)                  -180..180
+ *
+ * Frames are taken DSP_VECTOR_CHUNK at a time into per-axis planes, so
+ * the squares and sums run as CMSIS vector calls (arm_mult_f32,
+ * arm_add_f32) and the square roots as arm_sqrt_f32 (VSQRT). atan2 is an
+ * odd 11th-order polynomial on [0, 1] with octant folding, within 2e-6 rad
+ * (1e-4 deg): the CMSIS-DSP in this tree has no arm_atan2_f32.
+ *
+ * Input is either ADC codes (calibrated here with the active table, e.g.
+ * the dspFilter stream output) or mg already (dspFused_process() output).
+ * Group events (shock, free fall) are raised by the trigger engine itself,
+ * see adcTrigger_configGroup().
+ *
+ * Usage Example:
+ *   static DSP_Vector_t vec;
+ *   DSP_VectorSample_t v[DSP_VECTOR_GROUPS * 32];
+ *   dspVector_init(&vec, 1);   // input in codes
+ *
+ *   // main loop, on 32 filtered frames in channel order
+ *   dspVector_compute(&vec, filtered, 32, v);
+ *   // v[frame * DSP_VECTOR_GROUPS + group].magnitude / pitch / roll
+ *
+ * @note Build with DSP_VECTOR_STREAM_ENABLE=1 to stream the two magnitudes
+ *       (and the tilt once per packet) instead of the six axes.
+ ******************************************************************************
+ */
+
+#ifndef DSP_VECTOR_H
+#define DSP_VECTOR_H
+
+#include "adc_calibration.h"
+#include "adc_conversions.h"
+#include "arm_math.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+
+/**
+ * @brief Set to 1 to send type 12 vector packets in place of the
+ *        decimated sample stream in main.c
+ */
+#ifndef DSP_VECTOR_STREAM_ENABLE
+#define DSP_VECTOR_STREAM_ENABLE 0
+#endif
+
+/**
+ * @brief Tri-axis groups per frame
+ */
+#define DSP_VECTOR_GROUPS ADC_CAL_GROUP_COUNT
+
+/**
+ * @brief Frames per planar pass (stack: 5 planes of this many floats)
+ */
+#ifndef DSP_VECTOR_CHUNK
+#define DSP_VECTOR_CHUNK 32U
+#endif
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief Vector of one group in one frame
+ */
+typedef struct {
+  float32_t magnitude; ///< mg
+  float32_t pitch;     ///< Degrees, rotation about Y
+  float32_t roll;      ///< Degrees, rotation about X
+} DSP_VectorSample_t;
+
+/**
+ * @brief Conversion of the input to mg
+ */
+typedef struct {
+  uint8_t calibrate; ///< Input in codes: apply offset and matrix
+  float32_t offset[ADC_CONVERSIONS_CHANNEL_COUNT]; ///< Zero-g codes
+  float32_t matrix[DSP_VECTOR_GROUPS][ADC_CAL_AXES][ADC_CAL_AXES]; ///< mg/code
+} DSP_Vector_t;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief Set up the conversion
+ *
+ * @param vec         Instance
+ * @param input_codes Non-zero for ADC codes (calibrated with the active
+ *                    table), 0 for input already in mg
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL instance
+ */
+HAL_StatusTypeDef dspVector_init(DSP_Vector_t *vec, uint8_t input_codes);
+
+/**
+ * @brief Reload offsets and matrix after adcCal_setTable()
+ *
+ * @param vec Instance (not in use while this runs)
+ */
+void dspVector_loadCalibration(DSP_Vector_t *vec);
+
+/**
+ * @brief Magnitude and tilt of every group in a run of frames
+ *
+ * @param vec    Instance
+ * @param frames Frames in channel order (codes or mg, see init)
+ * @param count  Number of frames
+ * @param out    count * DSP_VECTOR_GROUPS entries, frame-major
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer
+ */
+HAL_StatusTypeDef dspVector_compute(const DSP_Vector_t *vec,
+                                    const float32_t *frames, uint32_t count,
+                                    DSP_VectorSample_t *out);
+
+/**
+ * @brief Four-quadrant arctangent, polynomial (|error| < 2e-6 rad)
+ *
+ * @return float32_t Radians, -pi..pi; 0 for (0, 0)
+ */
+float32_t dspVector_atan2(float32_t y, float32_t x);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DSP_VECTOR_H */
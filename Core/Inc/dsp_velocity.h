@@ -0,0 +1,199 @@
+/**
+ ******************************************************************************
+ * @file    dsp_velocity.h
+ * @brief   Band-limited velocity RMS per channel (ISO 10816 severity)
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * Machine-health limits are given as velocity RMS in mm/s over 10-1000 Hz,
+ * not as acceleration. Each selected channel runs, sample by sample:
+ *
+ *   code - offset -> HP 2nd order at low_hz -> LP 2nd order at high_hz
+ *                 -> leaky integrator (mm/s) -> sum of squares, |peak|
+ *
+ * The two Butterworth biquads (arm_biquad_cascade_df2T_f32) are designed at
+ * init for the sample rate, by the bilinear transform with pre-warping. The
+ * low-pass edge is held below 0.45 fs, so at reduced adaptive rates the band
+ * ends earlier.
+ *
+ * The integrator is Al-Alaoui's (7 x[n] + x[n-1]) T / 8 rule: within 2 % of
+ * 1 / (j w) up to fs / 4, where the trapezoidal rule is 21 % low and the
+ * rectangular one 11 % high (1 kHz at 4 kHz). Integrating is unstable at
+ * DC, so it leaks with a pole at low_hz / 10: with the two zeros of the
+ * high-pass in front, drift and the DC offset cannot build up, and the gain
+ * at low_hz is 0.5 % below ideal.
+ *
+ * One result per interval_ms: RMS and 0-pk velocity per channel in mm/s,
+ * plus an ISO 10816 zone (A..D) from three configurable limits. The first
+ * interval after init is dropped while the filters settle. The offset is
+ * seeded from the first frame so the high-pass does not start on a 2 g
+ * step.
+ *
+ * Usage Example:
+ *   static DSP_Velocity_t vel;
+ *   const DSP_VelocityConfig_t cfg = {
+ *       .sample_rate_hz = 4000.0f,
+ *       .low_hz = DSP_VELOCITY_LOW_HZ,
+ *       .high_hz = DSP_VELOCITY_HIGH_HZ,
+ *       .mg_per_code = ADC_CAL_NOMINAL_MG_PER_CODE,
+ *       .interval_ms = 1000,
+ *       .channels = 0x3FU,
+ *       .zone_mm_s = {1.4f, 2.8f, 4.5f}};  // ISO 10816-3 group 2, rigid
+ *   dspVelocity_init(&vel, &cfg, analogSensor_getBlockChannelMap());
+ *
+ *   // in the block callback (ISR)
+ *   dspVelocity_process(&vel, block, frame_count);
+ *
+ *   // main loop
+ *   DSP_VelocityResult_t res;
+ *   if (dspVelocity_getResult(&vel, &res) == HAL_OK) {
+ *     // res.rms_mm_s[ch], res.zone[ch]
+ *   }
+ *
+ * @note Requires ARM_MATH_CM7 and libarm_cortexM7lfsp_math.a (linked by
+ *       CMakeLists.txt).
+ ******************************************************************************
+ */
+
+#ifndef DSP_VELOCITY_H
+#define DSP_VELOCITY_H
+
+#include "adc_conversions.h"
+#include "arm_math.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+
+/**
+ * @brief ISO 10816 measurement band
+ */
+#define DSP_VELOCITY_LOW_HZ 10.0f
+#define DSP_VELOCITY_HIGH_HZ 1000.0f
+
+/**
+ * @brief Biquads per channel: the high-pass and the low-pass
+ */
+#define DSP_VELOCITY_STAGES 2U
+
+/**
+ * @brief ISO 10816 zone boundaries per result (A/B, B/C, C/D)
+ */
+#define DSP_VELOCITY_ZONE_LIMITS 3U
+#define DSP_VELOCITY_ZONE_NONE 0xFFU ///< Channel not measured or no limits
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief Stage settings
+ */
+typedef struct {
+  float32_t sample_rate_hz;   ///< Input frame rate
+  float32_t low_hz;           ///< High-pass edge, > 0
+  float32_t high_hz;          ///< Low-pass edge, above low_hz
+  float32_t mg_per_code;      ///< Sensor scale (ADC_CAL_NOMINAL_MG_PER_CODE)
+  uint16_t interval_ms;       ///< One result per interval
+  ADC_ChannelMask_t channels; ///< Channels measured
+  float32_t zone_mm_s[DSP_VELOCITY_ZONE_LIMITS]; ///< Ascending; 0 = no zones
+} DSP_VelocityConfig_t;
+
+/**
+ * @brief Velocity of one interval, channel order
+ */
+typedef struct {
+  uint32_t sequence;        ///< Intervals published since init
+  uint32_t first;           ///< Input frame index of the interval's start
+  uint32_t frames;          ///< Frames in the interval
+  ADC_ChannelMask_t channels; ///< Channels measured
+  float32_t rms_mm_s[ADC_CONVERSIONS_CHANNEL_COUNT];  ///< Velocity RMS
+  float32_t peak_mm_s[ADC_CONVERSIONS_CHANNEL_COUNT]; ///< Largest |velocity|
+  uint8_t zone[ADC_CONVERSIONS_CHANNEL_COUNT]; ///< 0..3 = A..D, or NONE
+} DSP_VelocityResult_t;
+
+/**
+ * @brief Stage state (one instance per block stream), channel order
+ */
+typedef struct {
+  DSP_VelocityConfig_t cfg;
+  uint8_t slot_channel[ADC_CONVERSIONS_CHANNEL_COUNT]; ///< Raw slot -> ch
+  float32_t coeffs[DSP_VELOCITY_STAGES * 5U]; ///< Shared by every channel
+  arm_biquad_cascade_df2T_instance_f32 biquad[ADC_CONVERSIONS_CHANNEL_COUNT];
+  float32_t biquad_state[ADC_CONVERSIONS_CHANNEL_COUNT]
+                        [2U * DSP_VELOCITY_STAGES];
+  float32_t offset[ADC_CONVERSIONS_CHANNEL_COUNT];  ///< Codes, first frame
+  float32_t accel[ADC_CONVERSIONS_CHANNEL_COUNT];   ///< Previous input
+  float32_t velocity[ADC_CONVERSIONS_CHANNEL_COUNT]; ///< Integrator, mm/s
+  float32_t sum_sq[ADC_CONVERSIONS_CHANNEL_COUNT];  ///< This interval
+  float32_t peak[ADC_CONVERSIONS_CHANNEL_COUNT];    ///< This interval
+  float32_t gain;  ///< Codes -> mm/s per integrator step, T / 8 included
+  float32_t leak;  ///< Integrator pole
+  uint32_t interval_frames;
+  uint32_t count;   ///< Frames into the interval
+  uint32_t samples; ///< Frames since init
+  uint8_t primed;   ///< offset is seeded
+  uint8_t settled;  ///< First interval is over
+  float32_t work[ADC_CONVERSIONS_BLOCK_FRAMES];
+  DSP_VelocityResult_t result[2];
+  volatile uint32_t result_seq; ///< Written by the feeding context
+  uint32_t read_seq;            ///< Written by the reader
+} DSP_Velocity_t;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief Design the filters and reset the stage
+ *
+ * @param vel         Instance
+ * @param cfg         Settings, copied
+ * @param channel_map Raw block slot -> channel (NULL = identity)
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer, bad band, zero interval or no channel
+ */
+HAL_StatusTypeDef dspVelocity_init(DSP_Velocity_t *vel,
+                                   const DSP_VelocityConfig_t *cfg,
+                                   const uint8_t *channel_map);
+
+/**
+ * @brief Follow a new input rate (adaptive_rate.h): filters and integrator
+ *        are redesigned, the interval in progress restarts
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL instance, or a rate the band does not fit
+ */
+HAL_StatusTypeDef dspVelocity_setSampleRate(DSP_Velocity_t *vel,
+                                            float32_t sample_rate_hz);
+
+/**
+ * @brief Run one block of interleaved raw frames (codes) through the stage
+ *
+ * @param vel    Instance
+ * @param block  Raw frames
+ * @param frames Frames in the block
+ */
+void dspVelocity_process(DSP_Velocity_t *vel, const uint16_t *block,
+                         uint32_t frames);
+
+/**
+ * @brief Take the newest result if one was published
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    result filled
+ *   @retval HAL_BUSY  Nothing new since the previous call
+ *   @retval HAL_ERROR NULL pointer
+ */
+HAL_StatusTypeDef dspVelocity_getResult(DSP_Velocity_t *vel,
+                                        DSP_VelocityResult_t *result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DSP_VELOCITY_H */
@@ -0,0 +1,196 @@
+/**
+ ******************************************************************************
+ * @file    dsp_window.h
+ * @brief   Sliding-window max, min, mean and AC RMS at constant cost per sample
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * "Peak over the last 100 ms, every frame" recomputed from the window costs
+ * its length per sample. Here each channel keeps the window's samples in a
+ * ring and updates the metrics as one frame comes in and the oldest goes:
+ *
+ *   - max / min: a monotonic deque of ring positions each. A new sample
+ *     drops every position from the back whose value it beats (they can
+ *     never be the extreme again while it is in the window), and the front
+ *     leaves when its frame falls out. The front is the window's max (min).
+ *     Every position goes in and out once: amortised O(1), at worst the
+ *     window length for a single sample.
+ *   - mean / RMS: running sum and sum of squares, less the leaving sample.
+ *     Integer codes, so nothing drifts however long it runs. The AC RMS
+ *     is the square root of n * sum_sq - sum^2 over n^2; the trigger
+ *     engine compares that n^2 variance against n^2 thr^2 without one.
+ *
+ * Until a window has filled, the metrics cover the frames it has. A channel
+ * costs 6 bytes a frame of window (the ring and two deques of uint16_t),
+ * sized DSP_WINDOW_MAX_FRAMES per channel: place the instances in DTCM
+ * (ADC_FAST_BSS), where the block callback reaches them without the cache.
+ * The trigger engine keeps its own per channel for the PEAK_TO_PEAK and
+ * RMS_SLIDING conditions (adc_trigger.h).
+ *
+ * Usage Example:
+ *   static DSP_Window_t win ADC_FAST_BSS;
+ *   dspWindow_init(&win, 200U, analogSensor_getBlockChannelMap()); // 50 ms
+ *
+ *   // in the block callback (ISR)
+ *   dspWindow_process(&win, block, frame_count);
+ *
+ *   // anywhere
+ *   DSP_WindowResult_t r;
+ *   dspWindow_get(&win, 2, &r);        // r.max - r.min, r.rms, ...
+ *
+ * @note DSP_WINDOW_ENABLE builds the trigger conditions and the application's
+ *       windowed metrics; the operators themselves are always there.
+ ******************************************************************************
+ */
+
+#ifndef DSP_WINDOW_H
+#define DSP_WINDOW_H
+
+#include "adc_conversions.h"
+#include "arm_math.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+
+/**
+ * @brief Set to 1 for the sliding trigger conditions and the "window"
+ *        metrics (DTCM per channel, see above)
+ */
+#ifndef DSP_WINDOW_ENABLE
+#define DSP_WINDOW_ENABLE 0
+#endif
+
+/**
+ * @brief Longest window in frames, per channel (256 = 64 ms at 4 kHz)
+ */
+#ifndef DSP_WINDOW_MAX_FRAMES
+#define DSP_WINDOW_MAX_FRAMES 256U
+#endif
+
+#if DSP_WINDOW_MAX_FRAMES < 1U || DSP_WINDOW_MAX_FRAMES > 65535U
+#error "DSP_WINDOW_MAX_FRAMES must be 1..65535"
+#endif
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief Window of one channel: the samples and the two deques of their
+ *        ring positions
+ */
+typedef struct {
+  uint16_t samples[DSP_WINDOW_MAX_FRAMES]; ///< Ring, codes
+  uint16_t max_q[DSP_WINDOW_MAX_FRAMES];   ///< Positions, values falling
+  uint16_t min_q[DSP_WINDOW_MAX_FRAMES];   ///< Positions, values rising
+  uint16_t max_head, max_count;
+  uint16_t min_head, min_count;
+  uint16_t pos;    ///< Next ring position, the oldest sample once full
+  uint16_t filled; ///< Samples in the window
+  uint32_t sum;    ///< 65535 x 4095 < 2^28
+  uint64_t sum_sq;
+} DSP_WindowChannel_t;
+
+/**
+ * @brief Windows of every channel of a block stream, channel order
+ */
+typedef struct {
+  uint16_t window; ///< Frames, 1..DSP_WINDOW_MAX_FRAMES
+  uint8_t slot_channel[ADC_CONVERSIONS_CHANNEL_COUNT]; ///< Raw slot -> ch
+  DSP_WindowChannel_t channels[ADC_CONVERSIONS_CHANNEL_COUNT];
+  volatile uint32_t frames; ///< Frames pushed since the init
+} DSP_Window_t;
+
+/**
+ * @brief Metrics of one channel over its window
+ */
+typedef struct {
+  uint16_t max;    ///< Codes
+  uint16_t min;    ///< Codes
+  uint16_t frames; ///< Frames covered, window once full (0 = no data)
+  float32_t mean;  ///< Codes
+  float32_t rms;   ///< AC RMS, codes
+} DSP_WindowResult_t;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief Empty one channel's window
+ */
+void dspWindow_resetChannel(DSP_WindowChannel_t *c);
+
+/**
+ * @brief Slide one channel's window by a sample
+ *
+ * @param c      Channel window
+ * @param window Window length in frames, 1..DSP_WINDOW_MAX_FRAMES; the
+ *               same from one reset to the next
+ * @param x      Sample, codes
+ */
+void dspWindow_push(DSP_WindowChannel_t *c, uint16_t window, uint16_t x);
+
+/**
+ * @brief Reset every channel to an empty window of a new length
+ *
+ * @param w           Instance
+ * @param window      Frames, 1..DSP_WINDOW_MAX_FRAMES
+ * @param channel_map Raw block slot -> channel (NULL = identity)
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL instance or window out of range
+ */
+HAL_StatusTypeDef dspWindow_init(DSP_Window_t *w, uint16_t window,
+                                 const uint8_t *channel_map);
+
+/**
+ * @brief Slide every channel over one block of interleaved raw frames
+ *
+ * @param w      Instance
+ * @param block  Raw frames
+ * @param frames Frames in the block
+ */
+void dspWindow_process(DSP_Window_t *w, const uint16_t *block,
+                       uint32_t frames);
+
+/**
+ * @brief Metrics of a channel, consistent with one frame
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success (frames = 0 before the first sample)
+ *   @retval HAL_ERROR NULL pointer or invalid channel
+ */
+HAL_StatusTypeDef dspWindow_get(const DSP_Window_t *w, uint8_t channel,
+                                DSP_WindowResult_t *result);
+
+/**
+ * @brief Largest sample in a non-empty window
+ */
+static inline uint16_t dspWindow_max(const DSP_WindowChannel_t *c) {
+  return c->samples[c->max_q[c->max_head]];
+}
+
+/**
+ * @brief Smallest sample in a non-empty window
+ */
+static inline uint16_t dspWindow_min(const DSP_WindowChannel_t *c) {
+  return c->samples[c->min_q[c->min_head]];
+}
+
+/**
+ * @brief n^2 times the variance of the window, n = filled, for integer
+ *        comparisons against n^2 thr^2
+ */
+static inline uint64_t dspWindow_varianceN2(const DSP_WindowChannel_t *c) {
+  return (uint64_t)c->filled * c->sum_sq - (uint64_t)c->sum * c->sum;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DSP_WINDOW_H */
@@ -0,0 +1,246 @@
+/**
+ ******************************************************************************
+ * @file    dsp_zoom.h
+ * @brief   Zoom FFT: fine resolution in a narrow band around a centre
+ *          frequency
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * Splitting the sidebands of a gear mesh at 4 kHz takes bins of 0.06 Hz,
+ * which is a 65536-point FFT over the whole band: 512 kB of buffers for a
+ * few dozen bins of interest. The zoom stage only transforms the band:
+ *
+ *   x -> mix by e^(-j 2 pi fc t) -> decimate by D (complex) -> FFT of L
+ *
+ *   - NCO: a unit complex rotator, one complex multiply per sample and one
+ *     renormalisation per call, moves centre_hz to DC
+ *   - decimation: a chain of polyphase FIR stages, /2 and /4, on the
+ *     complex samples; each stage only computes the outputs it keeps, and
+ *     its taps are designed at init (Blackman windowed sinc) with just the
+ *     transition the final band allows, so early stages stay short
+ *   - FFT: arm_cfft_f32() of L points at fs / D, windowed, Welch averaged
+ *     with 50 % overlap, in the main loop as dsp_spectrum.h
+ * The resolution is fs / (D L), as a D x L point FFT over the whole band:
+ * D = 256 and L = 256 match 65536 points in about 12 kB of state.
+ *
+ * D is the largest power of two up to DSP_ZOOM_MAX_DECIMATION whose clean
+ * band (DSP_ZOOM_CLEAN of fs / D, where the chain is flat and alias free)
+ * still holds span_hz. The result
+ * has the bins within span_hz / 2 of the centre, in ascending frequency,
+ * as 0-pk amplitudes in codes; the peak is interpolated as dsp_spectrum.h.
+ *
+ * Input is in codes around mid-scale (2048 removed): raw blocks through
+ * dspZoom_process(), or a branch's samples through PIPELINE_STAGE_ZOOM()
+ * (pipeline.h), e.g. after autozero().
+ *
+ * Usage Example:
+ *   static DSP_Zoom_t zoom;
+ *   const DSP_ZoomConfig_t cfg = {.centre_hz = 750.0f, .span_hz = 10.0f,
+ *                                 .length = 256, .window = DSP_WINDOW_HANN,
+ *                                 .averages = 2, .sample_rate_hz = 4000.0f};
+ *   dspZoom_init(&zoom, 0, analogSensor_getBlockChannelMap(), &cfg);
+ *
+ *   // in the block callback (ISR)
+ *   dspZoom_process(&zoom, block, frame_count);
+ *
+ *   // main loop
+ *   dspZoom_poll(&zoom);
+ *   DSP_ZoomResult_t res;
+ *   if (dspZoom_getResult(&zoom, &res) == HAL_OK) {
+ *     // res.amplitude[i] at res.first_hz + i * res.bin_hz
+ *   }
+ *
+ * @note A segment takes L D / 2 input samples once the first is full, so
+ *       a finer bin is also a slower update: 8 s per segment at 65536
+ *       equivalent points and 4 kHz.
+ ******************************************************************************
+ */
+
+#ifndef DSP_ZOOM_H
+#define DSP_ZOOM_H
+
+#include "dsp_spectrum.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+
+/**
+ * @brief Longest FFT the instance buffers can hold
+ */
+#ifndef DSP_ZOOM_BUFFER_LENGTH
+#define DSP_ZOOM_BUFFER_LENGTH 256U
+#endif
+
+/**
+ * @brief Shortest FFT
+ */
+#define DSP_ZOOM_LENGTH_MIN 64U
+
+/**
+ * @brief Largest decimation D, and the FIR stages it takes
+ */
+#ifndef DSP_ZOOM_MAX_DECIMATION
+#define DSP_ZOOM_MAX_DECIMATION 1024U
+#endif
+#ifndef DSP_ZOOM_MAX_STAGES
+#define DSP_ZOOM_MAX_STAGES 6U
+#endif
+
+/**
+ * @brief Longest FIR of a stage
+ */
+#ifndef DSP_ZOOM_MAX_TAPS
+#define DSP_ZOOM_MAX_TAPS 64U
+#endif
+
+/**
+ * @brief Share of fs / D the chain passes flat and alias free
+ */
+#define DSP_ZOOM_CLEAN 0.8f
+
+/**
+ * @brief Bins a result holds at most: DSP_ZOOM_CLEAN of the longest FFT,
+ *        and the centre bin
+ */
+#define DSP_ZOOM_MAX_BINS (DSP_ZOOM_BUFFER_LENGTH * 4U / 5U + 1U)
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief Zoom settings
+ */
+typedef struct {
+  float32_t centre_hz;         ///< Middle of the band
+  float32_t span_hz;           ///< Width of the band
+  uint16_t length;             ///< FFT L, power of two, 64..BUFFER_LENGTH
+  DSP_SpectrumWindow_t window; ///< Analysis window
+  uint8_t averages;            ///< Welch segments per result, >= 1
+  float32_t sample_rate_hz;    ///< Rate of the input samples
+} DSP_ZoomConfig_t;
+
+/**
+ * @brief One averaged zoom spectrum
+ */
+typedef struct {
+  uint32_t sequence;        ///< Results published so far
+  uint16_t decimation;      ///< D
+  uint16_t bin_count;       ///< Entries used in amplitude[]
+  float32_t bin_hz;         ///< Resolution fs / (D L)
+  float32_t first_hz;       ///< Frequency of amplitude[0]
+  float32_t peak_hz;        ///< Largest bin, interpolated
+  float32_t peak_amplitude; ///< Its amplitude (codes, 0-pk)
+  float32_t amplitude[DSP_ZOOM_MAX_BINS]; ///< 0-pk per bin (codes)
+} DSP_ZoomResult_t;
+
+/**
+ * @brief One decimating FIR stage, complex samples
+ */
+typedef struct {
+  uint8_t factor;                     ///< M, 2 or 4
+  uint8_t num_taps;
+  uint8_t pos;                        ///< Slot of the newest sample
+  uint8_t phase;                      ///< Inputs since the last output
+  float32_t taps[DSP_ZOOM_MAX_TAPS];  ///< Unity DC gain, symmetric
+  float32_t re[DSP_ZOOM_MAX_TAPS];    ///< Delay line
+  float32_t im[DSP_ZOOM_MAX_TAPS];
+} DSP_ZoomStage_t;
+
+/**
+ * @brief Zoom stage state (one instance per analysed channel)
+ */
+typedef struct {
+  DSP_ZoomConfig_t cfg;
+  uint8_t channel;                  ///< Analysed channel
+  uint8_t slot;                     ///< Its position in a raw block frame
+  uint8_t stage_count;
+  uint16_t decimation;              ///< D
+  uint16_t half_bins;               ///< Bins reported either side of DC
+  uint16_t settle;                  ///< Outputs still dropped after init
+  const arm_cfft_instance_f32 *cfft;
+  float32_t nco_re;                 ///< e^(-j 2 pi fc t)
+  float32_t nco_im;
+  float32_t step_re;                ///< Turn per sample
+  float32_t step_im;
+  DSP_ZoomStage_t stage[DSP_ZOOM_MAX_STAGES];
+  float32_t window_sum;             ///< Sum of w[n]
+  float32_t window[DSP_ZOOM_BUFFER_LENGTH];
+  float32_t collect[2U * DSP_ZOOM_BUFFER_LENGTH]; ///< re/im, filled by ISR
+  uint16_t collected;                             ///< Samples in collect[]
+  float32_t segment[2U * DSP_ZOOM_BUFFER_LENGTH]; ///< Handed to main loop
+  volatile uint8_t segment_ready;                 ///< 1 = segment[] is full
+  float32_t power[DSP_ZOOM_BUFFER_LENGTH];        ///< Welch sum, FFT order
+  uint8_t averaged;                 ///< Segments in power[]
+  uint32_t overruns;                ///< Segments dropped, main loop too slow
+  DSP_ZoomResult_t result;          ///< Newest result
+  volatile uint32_t result_seq;     ///< Results published
+  uint32_t read_seq;                ///< Results consumed
+} DSP_Zoom_t;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief Configure an instance for one channel and design its chain
+ *
+ * @param zm          Instance
+ * @param channel     Channel to analyse
+ * @param channel_map Raw block slot -> channel (NULL = identity)
+ * @param cfg         Settings, copied
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR Invalid argument: length, averages or rate, a band
+ *                     not inside 0..fs / 2, a span wider than the clean
+ *                     band at D = 2, or more stages than DSP_ZOOM_MAX_STAGES
+ */
+HAL_StatusTypeDef dspZoom_init(DSP_Zoom_t *zm, uint8_t channel,
+                               const uint8_t *channel_map,
+                               const DSP_ZoomConfig_t *cfg);
+
+/**
+ * @brief Mix and decimate the channel's samples of one block of raw frames
+ *
+ * @param zm     Instance
+ * @param block  Raw frames
+ * @param frames Number of frames
+ */
+void dspZoom_process(DSP_Zoom_t *zm, const uint16_t *block, uint32_t frames);
+
+/**
+ * @brief Mix and decimate already deinterleaved samples (codes)
+ *
+ * @param zm      Instance; cfg.sample_rate_hz must be the rate of samples
+ * @param samples Consecutive samples
+ * @param count   Number of samples
+ */
+void dspZoom_pushSamples(DSP_Zoom_t *zm, const float32_t *samples,
+                         uint32_t count);
+
+/**
+ * @brief Transform a pending segment and publish a result when due
+ *
+ * Call from the main loop.
+ *
+ * @param zm Instance
+ */
+void dspZoom_poll(DSP_Zoom_t *zm);
+
+/**
+ * @brief Take the newest result if one was published
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    New result copied
+ *   @retval HAL_BUSY  Nothing new since the previous call
+ *   @retval HAL_ERROR NULL pointer
+ */
+HAL_StatusTypeDef dspZoom_getResult(DSP_Zoom_t *zm, DSP_ZoomResult_t *result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DSP_ZOOM_H */
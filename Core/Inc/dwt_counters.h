@@ -0,0 +1,183 @@
+/**
+ ******************************************************************************
+ * @file    dwt_counters.h
+ * @brief   DWT event counters around one pipeline stage: CPI, LSU, folded,
+ *          sleep and exception cycles next to CYCCNT
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * CYCCNT says how long a stage takes, not why. The Cortex-M7 DWT also
+ * counts, per cycle:
+ *
+ *   CPICNT    extra cycles of multi-cycle instructions (not loads/stores)
+ *   LSUCNT    extra cycles of loads and stores: memory and bus stalls
+ *   EXCCNT    exception entry and exit
+ *   SLEEPCNT  cycles asleep
+ *   FOLDCNT   instructions that took no cycle of their own (dual issue)
+ *
+ * and instructions = cycles - CPI - LSU - EXC - SLEEP + FOLD. A stage with
+ * a large LSU share wants its data in TCM or better cache use; a large
+ * CPI share, fewer divisions and multi-cycle loads; neither, a cheaper
+ * algorithm.
+ *
+ * Those five counters are 8 bits wide and raise nothing when they wrap.
+ * While a window is open, TIM4 therefore reads them every
+ * DWT_COUNTERS_SAMPLE_CYCLES, less than 256 cycles, so no counter can wrap
+ * twice between two reads (each counts at most once a cycle). The handler
+ * reads all of them on entry and again on exit, and only the stretch in
+ * between is left out. Its own exception entry and exit still fall inside
+ * the window, and are subtracted: they are the smallest EXCCNT count seen
+ * between two samples. An interval that came out longer than 255 cycles,
+ * because a PRIMASK section or an interrupt at the sampler's level held
+ * it off, may have lost a wrap and is counted as inexact.
+ *
+ * A window is one run of the chosen stage. dwtCounters_begin() and
+ * dwtCounters_end() bracket each stage, and cost a compare unless that
+ * stage is armed. Stages are numbered by the caller, and any other
+ * interrupt that lands in a window is part of the result, as it is of the
+ * stage's real cost.
+ *
+ * Usage Example:
+ *   dwtCounters_start(DEADLINE_SPECTRUM, "spectrum", 16);
+ *
+ *   // around the stage
+ *   dwtCounters_begin(DEADLINE_SPECTRUM);
+ *   dspSpectrum_process(...);
+ *   dwtCounters_end(DEADLINE_SPECTRUM);
+ *
+ *   dwtCounters_poll();       // main loop: one PERF line when it is done
+ *
+ *   PERF spectrum win=16 cyc=913402 instr=702310 ipc=0.76 cpi=9.8%
+ *        lsu=15.3% exc=0.4% sleep=0.0% fold=41200 samples=4757 inexact=0
+ *
+ * @note The stages must run below the sampler. In the superloop build they
+ *       run in the ADC DMA interrupt, so for the run DMA2 Stream0 drops to
+ *       the tier below DWT_COUNTERS_IRQ_PRIORITY, as with the interlock.
+ * @note The sampler interrupts the stage about a million times a second
+ *       while a window is open. Pipeline refills after each return show up
+ *       as a few percent of extra CPI and LSU counts.
+ ******************************************************************************
+ */
+
+#ifndef DWT_COUNTERS_H
+#define DWT_COUNTERS_H
+
+#include "irq_priority.h"
+#include "stm32f7xx_hal.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+
+/**
+ * @brief Set to 0 to leave TIM4 and its vector alone
+ */
+#ifndef DWT_COUNTERS_ENABLE
+#define DWT_COUNTERS_ENABLE 1
+#endif
+
+/**
+ * @brief CPU cycles between two reads of the 8-bit counters (128..240)
+ */
+#ifndef DWT_COUNTERS_SAMPLE_CYCLES
+#define DWT_COUNTERS_SAMPLE_CYCLES 200U
+#endif
+
+/**
+ * @brief Windows measured by dwtCounters_start() without a count
+ */
+#ifndef DWT_COUNTERS_DEFAULT_WINDOWS
+#define DWT_COUNTERS_DEFAULT_WINDOWS 16U
+#endif
+
+/**
+ * @brief TIM4 priority: above every stage it measures
+ */
+#ifndef DWT_COUNTERS_IRQ_PRIORITY
+#define DWT_COUNTERS_IRQ_PRIORITY IRQ_PRIORITY_ACQUISITION
+#endif
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief Totals of a run over all its windows
+ */
+typedef struct {
+  uint8_t stage;         ///< As passed to dwtCounters_start()
+  uint32_t windows;      ///< Windows measured
+  uint32_t samples;      ///< Sampler interrupts inside them
+  uint32_t inexact;      ///< Intervals over 255 cycles (wraps may be lost)
+  uint64_t cycles;       ///< CYCCNT, sampler overhead removed
+  uint64_t instructions; ///< cycles - cpi - lsu - exc - sleep + fold
+  uint64_t cpi;          ///< CPICNT
+  uint64_t lsu;          ///< LSUCNT
+  uint64_t exc;          ///< EXCCNT, sampler overhead removed
+  uint64_t sleep;        ///< SLEEPCNT
+  uint64_t fold;         ///< FOLDCNT
+  uint64_t overhead;     ///< Sampler entry and exit cycles removed
+} DwtCounters_Result_t;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief Arm one stage for a number of windows
+ *
+ * @param stage   Caller's stage number, as given to dwtCounters_begin()
+ * @param name    Stage name for the PERF line (kept, not copied)
+ * @param windows Runs of the stage to add up (0 = the default)
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Armed (replacing a run in progress)
+ *   @retval HAL_ERROR NULL name, or DWT_COUNTERS_ENABLE = 0
+ */
+HAL_StatusTypeDef dwtCounters_start(uint8_t stage, const char *name,
+                                    uint32_t windows);
+
+/**
+ * @brief Abandon the run and put the DMA priority back
+ */
+void dwtCounters_stop(void);
+
+/**
+ * @brief Open a window if this stage is armed (stage context)
+ */
+void dwtCounters_begin(uint8_t stage);
+
+/**
+ * @brief Close the window of this stage (same context as the begin)
+ */
+void dwtCounters_end(uint8_t stage);
+
+/**
+ * @brief TIM4 update: read the counters (TIM4_IRQHandler())
+ */
+void dwtCounters_irqHandler(void);
+
+/**
+ * @brief Totals of the last run
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Run complete
+ *   @retval HAL_BUSY  Still measuring (totals so far)
+ *   @retval HAL_ERROR NULL pointer or no run yet
+ */
+HAL_StatusTypeDef dwtCounters_getResult(DwtCounters_Result_t *result);
+
+/**
+ * @brief Send the PERF line of a completed run once, when a telemetry slot
+ *        is free
+ *
+ * @note Call from the main loop
+ */
+void dwtCounters_poll(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DWT_COUNTERS_H */
@@ -0,0 +1,171 @@
+/**
+ ******************************************************************************
+ * @file    dwt_profiler.h
+ * @brief   DWT cycle-counter probes for the acquisition and processing stages
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * Replaces scope measurements on the GPIOG pin 0 toggle with named probes
+ * built on DWT->CYCCNT (one CPU cycle resolution, 32-bit wrap every ~40 s at
+ * 108 MHz). Each probe keeps count/min/max/total, so mean latency and jitter
+ * of every stage can be watched in the field.
+ *
+ * Cost: two CYCCNT reads plus a handful of compares per measurement, cheap
+ * enough to leave enabled in release builds. Define PROFILER_ENABLE to 0 to
+ * compile every probe out.
+ *
+ * Usage Example:
+ *   profiler_init();
+ *
+ *   uint32_t t0 = profiler_begin();
+ *   do_work();
+ *   profiler_end(PROFILER_PROBE_FILTER, t0);
+ *
+ *   profiler_dump();          // one telemetry line per probe
+ *   profiler_poll();          // from the main loop, queues pending lines
+ *
+ * @note A probe must be updated from a single context (thread or one ISR);
+ *       different probes may be used from different contexts.
+ ******************************************************************************
+ */
+
+#ifndef DWT_PROFILER_H
+#define DWT_PROFILER_H
+
+#include "stm32f7xx_hal.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+
+/**
+ * @brief Set to 0 to compile all probes out
+ */
+#ifndef PROFILER_ENABLE
+#define PROFILER_ENABLE 1
+#endif
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief Named measurement points
+ */
+typedef enum {
+  PROFILER_PROBE_CONFIG = 0,   ///< Channel selection in polling mode
+  PROFILER_PROBE_START,        ///< HAL_ADC_Start() in polling mode
+  PROFILER_PROBE_POLL,         ///< HAL_ADC_PollForConversion()
+  PROFILER_PROBE_DMA_CALLBACK, ///< DMA block hand-off (ISR)
+  PROFILER_PROBE_FILTER,       ///< Filter / DSP stages
+  PROFILER_PROBE_FORMAT,       ///< Telemetry formatting
+  PROFILER_PROBE_TRANSMIT,     ///< Telemetry transmission
+  PROFILER_PROBE_SPECTRUM,     ///< FFT and spectral features (main loop)
+  PROFILER_PROBE_INJECTED,     ///< Injected single-channel read
+  PROFILER_PROBE_READ_HAL,     ///< Whole polling read, HAL backend
+  PROFILER_PROBE_READ_LL,      ///< Whole polling read, LL backend
+  PROFILER_PROBE_CODEC,        ///< Lossless codec, cycles per sample
+  PROFILER_PROBE_OVERRUN,      ///< Overrun recovery of the DMA scan (ISR)
+  PROFILER_PROBE_ANOMALY,      ///< Anomaly inference of one channel group
+  PROFILER_PROBE_COUNT
+} Profiler_Probe_t;
+
+/**
+ * @brief Accumulated statistics of one probe (CPU cycles)
+ */
+typedef struct {
+  uint32_t count; ///< Number of measurements
+  uint32_t min;   ///< Shortest measurement (UINT32_MAX = none yet)
+  uint32_t max;   ///< Longest measurement
+  uint64_t total; ///< Sum of all measurements, mean = total / count
+} Profiler_Stats_t;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief Enable the DWT cycle counter and clear all probes
+ */
+void profiler_init(void);
+
+/**
+ * @brief Current cycle-counter value
+ */
+static inline uint32_t profiler_now(void) { return DWT->CYCCNT; }
+
+/**
+ * @brief Start a measurement
+ *
+ * @return uint32_t Start timestamp to pass to profiler_end()
+ */
+static inline uint32_t profiler_begin(void) {
+#if PROFILER_ENABLE
+  return DWT->CYCCNT;
+#else
+  return 0;
+#endif
+}
+
+/**
+ * @brief Record a measured duration for a probe
+ *
+ * @param probe  Probe to update
+ * @param cycles Duration in CPU cycles
+ */
+void profiler_record(Profiler_Probe_t probe, uint32_t cycles);
+
+/**
+ * @brief Finish a measurement started with profiler_begin()
+ *
+ * @param probe Probe to update
+ * @param start Value returned by profiler_begin()
+ */
+static inline void profiler_end(Profiler_Probe_t probe, uint32_t start) {
+#if PROFILER_ENABLE
+  profiler_record(probe, DWT->CYCCNT - start);
+#else
+  (void)probe;
+  (void)start;
+#endif
+}
+
+/**
+ * @brief Copy the statistics of one probe
+ *
+ * @param probe Probe to read
+ * @param stats Destination
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR Invalid probe or NULL pointer
+ */
+HAL_StatusTypeDef profiler_getStats(Profiler_Probe_t probe,
+                                    Profiler_Stats_t *stats);
+
+/**
+ * @brief Clear all probes
+ */
+void profiler_reset(void);
+
+/**
+ * @brief Request one report line per probe (count, min, max, mean in cycles)
+ *
+ * Lines are handed to the telemetry queue by profiler_poll() as slots free
+ * up, so a dump never blocks the caller.
+ */
+void profiler_dump(void);
+
+/**
+ * @brief Queue pending dump lines while telemetry slots are free
+ *
+ * @note Call from the main loop
+ */
+void profiler_poll(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DWT_PROFILER_H */
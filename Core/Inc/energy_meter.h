@@ -0,0 +1,266 @@
+/**
+ ******************************************************************************
+ * @file    energy_meter.h
+ * @brief   Energy accounting: time per power state and peripheral on-times,
+ *          priced by a current model, per frame and per feature message
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * On a battery node the figure that matters is the energy per useful
+ * sample, not the CPU load. This module splits the time since reset (or
+ * energyMeter_reset()) into the power states of the MCU:
+ *
+ *   run_<profile>    awake at a clock profile: DWT cycles not slept
+ *   sleep_<profile>  in the WFI of cpuLoad_idle(): the rest of the TIM5
+ *                    time between two polls
+ *   stop             STOP mode, timed on LPTIM1 by low_power.c (TIM5 and
+ *                    the DWT stand still there)
+ *
+ * and adds the on-time of each peripheral whose supply current matters
+ * (the ADCs scanning, the sensor supply, the Ethernet PHY, the USB
+ * transceiver, an SD card), switched by energyMeter_setPeripheral() at each
+ * edge. Each state and peripheral is priced with its current from
+ * EnergyMeter_Model_t at the supply voltage:
+ *
+ *   E [nJ] = t [us] * I [uA] / 1000 * V [mV] / 1000
+ *
+ * Dividing by the frames acquired and by the feature messages sent gives
+ * the energy per frame and per message, so an optimisation (a slower clock
+ * profile, a longer duty period, exception reports) shows up as uJ saved
+ * without a power analyser. The result is only as good as the model: the
+ * defaults are typical datasheet figures for the NUCLEO-F746ZG at 3.3 V,
+ * not measurements of this board. Measure once with a meter in each state
+ * and set the real currents (energyMeter_setModel(), kept by the "energy
+ * model" host command).
+ *
+ * energyMeter_poll() books the time since the previous poll: call it at
+ * least every 2^32 core cycles (19.8 s at 216 MHz), e.g. every service
+ * pass, so the DWT counter does not wrap in between. Peripheral edges and
+ * STOP poll first, so the split is exact at them.
+ *
+ * Usage Example:
+ *   energyMeter_init();                      // after cpuLoad_init()
+ *   energyMeter_setPeripheral(ENERGY_METER_PERIPH_SENSORS, 1);
+ *
+ *   // main loop / service pass
+ *   energyMeter_poll();
+ *   // block callback
+ *   energyMeter_addFrames(frame_count);
+ *   // each feature packet sent
+ *   energyMeter_addMessages(1);
+ *
+ *   EnergyMeter_Report_t r;
+ *   energyMeter_getReport(&r);    // r.nj_per_frame, r.nj_per_message
+ *
+ * @note Single-threaded but for the counters, which any context may add
+ *       to. Which frames and messages are useful is the caller's choice.
+ ******************************************************************************
+ */
+
+#ifndef ENERGY_METER_H
+#define ENERGY_METER_H
+
+#include "clock_profile.h"
+#include "stm32f7xx_hal.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+
+/**
+ * @brief Default currents, uA: core and regulator awake at each profile
+ *        (code in flash with the ART cache, peripherals clocked)
+ */
+#ifndef ENERGY_METER_RUN_PERFORMANCE_UA
+#define ENERGY_METER_RUN_PERFORMANCE_UA 110000U
+#endif
+#ifndef ENERGY_METER_RUN_BALANCED_UA
+#define ENERGY_METER_RUN_BALANCED_UA 50000U
+#endif
+#ifndef ENERGY_METER_RUN_LOW_POWER_UA
+#define ENERGY_METER_RUN_LOW_POWER_UA 26000U
+#endif
+
+/**
+ * @brief Default currents, uA: in WFI sleep at each profile
+ */
+#ifndef ENERGY_METER_SLEEP_PERFORMANCE_UA
+#define ENERGY_METER_SLEEP_PERFORMANCE_UA 60000U
+#endif
+#ifndef ENERGY_METER_SLEEP_BALANCED_UA
+#define ENERGY_METER_SLEEP_BALANCED_UA 26000U
+#endif
+#ifndef ENERGY_METER_SLEEP_LOW_POWER_UA
+#define ENERGY_METER_SLEEP_LOW_POWER_UA 14000U
+#endif
+
+/**
+ * @brief Default current, uA: STOP, regulator in low-power mode, flash off
+ */
+#ifndef ENERGY_METER_STOP_UA
+#define ENERGY_METER_STOP_UA 300U
+#endif
+
+/**
+ * @brief Default peripheral currents, uA, on top of the MCU state
+ */
+#ifndef ENERGY_METER_ADC_UA
+#define ENERGY_METER_ADC_UA 5000U // three ADCs converting, VDDA included
+#endif
+#ifndef ENERGY_METER_SENSORS_UA
+#define ENERGY_METER_SENSORS_UA 1400U // front end behind SENSOR_PD
+#endif
+#ifndef ENERGY_METER_ETH_UA
+#define ENERGY_METER_ETH_UA 40000U // LAN8742A PHY, 100BASE-TX
+#endif
+#ifndef ENERGY_METER_USB_UA
+#define ENERGY_METER_USB_UA 5000U // OTG FS core and transceiver
+#endif
+#ifndef ENERGY_METER_SD_UA
+#define ENERGY_METER_SD_UA 30000U // card, averaged over writes
+#endif
+
+/**
+ * @brief Default supply voltage, mV
+ */
+#ifndef ENERGY_METER_SUPPLY_MV
+#define ENERGY_METER_SUPPLY_MV 3300U
+#endif
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief Power states of the MCU, one at a time
+ */
+typedef enum {
+  ENERGY_METER_RUN = 0, ///< + ClockProfile_Id_t
+  ENERGY_METER_SLEEP = ENERGY_METER_RUN + CLOCK_PROFILE_COUNT, ///< + profile
+  ENERGY_METER_STOP = ENERGY_METER_SLEEP + CLOCK_PROFILE_COUNT,
+  ENERGY_METER_STATE_COUNT
+} EnergyMeter_State_t;
+
+/**
+ * @brief Peripherals priced on top of the state
+ */
+typedef enum {
+  ENERGY_METER_PERIPH_ADC = 0, ///< Scanning (any DMA mode)
+  ENERGY_METER_PERIPH_SENSORS, ///< Sensor supply up
+  ENERGY_METER_PERIPH_ETH,     ///< PHY linked up
+  ENERGY_METER_PERIPH_USB,     ///< USB device running
+  ENERGY_METER_PERIPH_SD,      ///< Card logging
+  ENERGY_METER_PERIPH_COUNT
+} EnergyMeter_Periph_t;
+
+/**
+ * @brief Current model (the CONFIG_KEY_ENERGY_MODEL record)
+ */
+typedef struct {
+  uint32_t state_ua[ENERGY_METER_STATE_COUNT];   ///< Per EnergyMeter_State_t
+  uint32_t periph_ua[ENERGY_METER_PERIPH_COUNT]; ///< Per EnergyMeter_Periph_t
+  uint32_t supply_mv;                            ///< Supply voltage
+} EnergyMeter_Model_t;
+
+/**
+ * @brief Totals since the last reset, at the current model
+ */
+typedef struct {
+  uint64_t elapsed_us;                           ///< All states
+  uint64_t state_us[ENERGY_METER_STATE_COUNT];   ///< Time per state
+  uint64_t periph_us[ENERGY_METER_PERIPH_COUNT]; ///< On-time per peripheral
+  uint64_t state_nj[ENERGY_METER_STATE_COUNT];   ///< Energy per state
+  uint64_t periph_nj[ENERGY_METER_PERIPH_COUNT]; ///< Energy per peripheral
+  uint64_t total_nj;                             ///< Sum of both
+  uint32_t average_uw;                           ///< total / elapsed
+  uint32_t frames;                               ///< Frames acquired
+  uint32_t messages;                             ///< Feature messages sent
+  uint32_t nj_per_frame;                         ///< 0 without frames
+  uint32_t nj_per_message;                       ///< 0 without messages
+} EnergyMeter_Report_t;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief Default model, all peripherals off, totals cleared
+ */
+void energyMeter_init(void);
+
+/**
+ * @brief Clear the totals (the model and the peripheral states stay)
+ */
+void energyMeter_reset(void);
+
+/**
+ * @brief Book the time since the previous poll to the active profile's run
+ *        and sleep states and to the peripherals on
+ */
+void energyMeter_poll(void);
+
+/**
+ * @brief Peripheral on or off from now
+ */
+void energyMeter_setPeripheral(EnergyMeter_Periph_t id, uint8_t on);
+
+/**
+ * @brief Book time spent in STOP mode (timed outside TIM5), with the
+ *        peripherals that were on throughout
+ *
+ * @param us Duration
+ */
+void energyMeter_addStop(uint32_t us);
+
+/**
+ * @brief Count frames acquired (useful samples)
+ */
+void energyMeter_addFrames(uint32_t frames);
+
+/**
+ * @brief Count feature messages sent
+ */
+void energyMeter_addMessages(uint32_t messages);
+
+/**
+ * @brief Replace the current model; applies to all the time booked
+ *
+ * @param model New currents, NULL for the defaults
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR A supply of 0 mV
+ */
+HAL_StatusTypeDef energyMeter_setModel(const EnergyMeter_Model_t *model);
+
+/**
+ * @brief Get the current model
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer
+ */
+HAL_StatusTypeDef energyMeter_getModel(EnergyMeter_Model_t *model);
+
+/**
+ * @brief Short name of a state or peripheral ("run_balanced", "stop",
+ *        "adc", ...), NULL past the last
+ */
+const char *energyMeter_stateName(EnergyMeter_State_t state);
+const char *energyMeter_periphName(EnergyMeter_Periph_t id);
+
+/**
+ * @brief Poll, then price the totals with the model
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer
+ */
+HAL_StatusTypeDef energyMeter_getReport(EnergyMeter_Report_t *report);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ENERGY_METER_H */
@@ -0,0 +1,199 @@
+/**
+ ******************************************************************************
+ * @file    eth_stream.h
+ * @brief   UDP streaming of raw DMA blocks through the on-chip Ethernet MAC
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * No IP stack: every DMA block becomes one UDP datagram built from a fixed
+ * Ethernet/IPv4/UDP header template, sent to a static collector address.
+ * The datagram is larger than one Ethernet frame (3 kB per 256-frame
+ * block), so it leaves as IPv4 fragments that the collector's stack
+ * reassembles. Each fragment is a chain of ETH DMA descriptors: its header
+ * from a small DTCM buffer, then its slice of the samples read by the MAC
+ * straight from the ADC ping-pong buffer. Nothing is copied.
+ *
+ * The MAC inserts the IPv4 header checksums. The UDP checksum is 0, which
+ * IPv4 allows, since the MAC cannot checksum a fragmented payload.
+ * Ethernet carries every raw frame with roughly 40x headroom at 100 Mbit/s.
+ *
+ * The device does not answer ARP, so the collector's MAC must be set, or
+ * left at broadcast. Set ETH_STREAM_IP_ADDR per board. Datagrams also
+ * carry a board id from the device UID.
+ *
+ * The one thing received is PTP (ptp_sync.h, PTP_SYNC_ENABLE): the MAC
+ * stamps Sync and Delay_Req in hardware, ethStream_poll() passes the
+ * messages on, and the block callback sends the Delay_Req. Once the sample
+ * clock follows the PTP seconds, every datagram carries the PTP time of its
+ * first frame, so the blocks of all nodes in a domain line up on one
+ * timeline without sync cabling or cross-correlation.
+ *
+ * Timing: ethStream_sendBlock() runs in the block callback (DMA interrupt).
+ * It reclaims finished descriptors, then queues the new block. A block
+ * stays valid for one block period (64 ms at 4 kHz), and a 100 Mbit/s link
+ * sends it in about 0.3 ms. If the previous datagram from the same half of
+ * the buffer is still queued, the new one is dropped and counted. With the
+ * block pool (analogSensor_setBlockPool()) each datagram holds a reference
+ * to its block until the last fragment is sent, so the DMA never refills
+ * samples the MAC has yet to read.
+ *
+ * Pins: on the Nucleo-F746ZG the LAN8742A RMII uses PA1 (REF_CLK), PA2
+ * (MDIO), PA7 (CRS_DV), PC1 (MDC), PC4 (RXD0) and PC5 (RXD1), which are
+ * also ADC1/2 IN1/IN2/IN7/IN11/IN14/IN15. The stream is therefore off by
+ * default. To build it with ETH_STREAM_ENABLE=1, move any channel on those
+ * inputs in adc_channels.h (a static assert checks this).
+ *
+ * Datagram payload (little-endian, docs/telemetry_protocol.md):
+ *
+ *   0  u8   version (2)          8  u64 block timestamp (timebase ticks)
+ *   1  u8   channel count       16  u32 board id
+ *   2  u16  frame count         20  u8[m] channel of each scan slot
+ *   4  u32  first frame         28  u64 PTP time of the first frame, ns
+ *                               36  u8  ETH_STREAM_TIME_x flags, 3 spare
+ *                               40  u16  samples, frame by frame
+ *
+ * m is the channel count rounded up to 8; the offsets from 28 on are those
+ * of m = 8 (up to 8 channels) and move by m - 8 for wider tables.
+ *
+ * Usage Example:
+ *   ethStream_init();                       // PHY reset, autonegotiation
+ *
+ *   // block callback
+ *   ethStream_sendBlock(block, frame_count);
+ *
+ *   // main loop
+ *   ethStream_poll();                       // PTP, link state, MAC speed
+ *
+ ******************************************************************************
+ */
+
+#ifndef ETH_STREAM_H
+#define ETH_STREAM_H
+
+#include "stm32f7xx_hal.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+
+/**
+ * @brief Build the Ethernet stream (RMII pins clash with ADC IN1/IN2/IN7)
+ */
+#ifndef ETH_STREAM_ENABLE
+#define ETH_STREAM_ENABLE 0
+#endif
+
+/**
+ * @brief Board and collector addresses
+ */
+#ifndef ETH_STREAM_IP_ADDR
+#define ETH_STREAM_IP_ADDR {192U, 168U, 0U, 10U}
+#endif
+#ifndef ETH_STREAM_DEST_IP
+#define ETH_STREAM_DEST_IP {255U, 255U, 255U, 255U}
+#endif
+#ifndef ETH_STREAM_DEST_MAC
+#define ETH_STREAM_DEST_MAC {0xFFU, 0xFFU, 0xFFU, 0xFFU, 0xFFU, 0xFFU}
+#endif
+
+/**
+ * @brief UDP port used as both source and destination
+ */
+#ifndef ETH_STREAM_PORT
+#define ETH_STREAM_PORT 5005U
+#endif
+
+/**
+ * @brief PHY address on the SMI bus (LAN8742A strap on the Nucleo)
+ */
+#ifndef ETH_STREAM_PHY_ADDR
+#define ETH_STREAM_PHY_ADDR 0U
+#endif
+
+/**
+ * @brief Interval between PHY link checks in ethStream_poll()
+ */
+#ifndef ETH_STREAM_LINK_POLL_MS
+#define ETH_STREAM_LINK_POLL_MS 250U
+#endif
+
+/**
+ * @brief Datagram time flags (byte 36, up to 8 channels)
+ */
+#define ETH_STREAM_TIME_PTP 0x01U           ///< PTP time valid
+#define ETH_STREAM_TIME_PTP_LOCKED 0x02U    ///< MAC clock locked to the master
+#define ETH_STREAM_TIME_FRAMES_LOCKED 0x04U ///< Scan locked to the PTP seconds
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief Link and transmit statistics
+ */
+typedef struct {
+  uint32_t datagrams_sent; ///< Datagrams whose last fragment completed
+  uint32_t dropped;        ///< Blocks skipped: descriptors still busy
+  uint32_t link_changes;   ///< Link up/down transitions
+  uint32_t ptp_received;   ///< PTP messages passed to ptp_sync
+  uint8_t link_up;         ///< Autonegotiation done and MAC started
+  uint8_t speed_100m;      ///< 1 = 100 Mbit/s, 0 = 10 Mbit/s
+  uint8_t full_duplex;     ///< 1 = full duplex
+} EthStream_Stats_t;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief Initialise the MAC (RMII), reset the PHY and start autonegotiation
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    MAC ready; transmission starts once the link is up
+ *   @retval HAL_ERROR HCLK below 25 MHz, MAC reset timed out (no RMII
+ *                     reference clock) or no PHY answering
+ */
+HAL_StatusTypeDef ethStream_init(void);
+
+/**
+ * @brief Receive PTP, follow the PHY link and (re)start the MAC at the
+ *        negotiated speed
+ * @note Call from the main loop; the PHY is read every
+ *       ETH_STREAM_LINK_POLL_MS
+ */
+void ethStream_poll(void);
+
+/**
+ * @brief Queue one DMA block as a UDP datagram
+ *
+ * @param block       Block as given to the block callback
+ * @param frame_count Frames in the block
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Queued on the descriptors
+ *   @retval HAL_BUSY  Previous datagram of this buffer half still queued
+ *                     (counted as dropped)
+ *   @retval HAL_ERROR Link down, or block too large for one datagram
+ *
+ * @note Call from the block callback only; it owns the TX descriptors
+ */
+HAL_StatusTypeDef ethStream_sendBlock(const uint16_t *block,
+                                      uint32_t frame_count);
+
+/**
+ * @brief Get link and transmit statistics
+ *
+ * @param stats Destination
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer
+ */
+HAL_StatusTypeDef ethStream_getStats(EthStream_Stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ETH_STREAM_H */
@@ -0,0 +1,206 @@
+/**
+ ******************************************************************************
+ * @file    event_log.h
+ * @brief   Binary event log: 12-byte entries in a RAM ring, mirrored to the
+ *          backup SRAM for the next boot
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * The status packet and the error matrix say how many things went wrong,
+ * not when, in which order or next to what. eventLog_write() records one
+ * event (code, an 8-bit argument and a 32-bit value, HAL tick and
+ * sequence number) from any context, interrupts included:
+ *   - a slot is claimed with LDREX/STREX on the write index, so writers
+ *     never mask interrupts or wait for each other
+ *   - the entry is written with its code cleared first and set last; the
+ *     reader copies it, then checks code and sequence are unchanged, so a
+ *     slot being written or overwritten meanwhile is never taken half-done
+ *   - a full ring overwrites its oldest entries; the reader skips them and
+ *     counts them as lost
+ *
+ * Every entry also goes to the backup SRAM (4 KB at 0x40024000, kept
+ * across resets and on VBAT with the backup regulator), below the
+ * retained counters (retained.h). It holds two banks of
+ * EVENT_LOG_BACKUP_ENTRIES; eventLog_init() switches banks at each boot,
+ * so the other bank keeps the previous boot's last entries for a
+ * post-mortem. They are drained first, marked as the previous boot.
+ *
+ * Entry (12 bytes, little endian, as in the log packet):
+ *   seq(2) code(1) arg(1) tick(4) value(4)
+ *
+ *   Code        arg                  value
+ *   BOOT        -                    RCC CSR reset flags
+ *   ADC_ERROR   ADC_ErrorKind_t      channel (0xFF scan) | HAL status << 8
+ *                                    | count << 16, at counts 1, 2, 4, ...
+ *   OVERRUN     -                    frames lost in the gap
+ *   DROPPED     -                    blocks dropped
+ *   TRIGGER     condition            trigger frame
+ *   MODE        new ADC_AcqMode_t    previous mode
+ *   CONFIG      ConfigStore_Key_t    version | length << 8
+ *   SHED        stage                1 = shed, 0 = restored
+ *
+ * Usage Example:
+ *   eventLog_init();             // after SystemClock_Config()
+ *
+ *   // anywhere
+ *   eventLog_write(EVENT_LOG_OVERRUN, 0, frames_lost);
+ *
+ *   // main loop, low priority
+ *   EventLog_Entry_t entries[16];
+ *   EventLog_Batch_t batch;
+ *   if (eventLog_peek(entries, 16, &batch) == HAL_OK) {
+ *     if (send(entries, batch.count) == HAL_OK) {
+ *       eventLog_consume(&batch);
+ *     }
+ *   }
+ *
+ ******************************************************************************
+ */
+
+#ifndef EVENT_LOG_H
+#define EVENT_LOG_H
+
+#include "stm32f7xx_hal.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+
+/**
+ * @brief Entries of the RAM ring (power of two)
+ */
+#ifndef EVENT_LOG_CAPACITY
+#define EVENT_LOG_CAPACITY 128U
+#endif
+
+/**
+ * @brief Entries of each backup SRAM bank (power of two, two banks below
+ *        the retained block)
+ */
+#ifndef EVENT_LOG_BACKUP_ENTRIES
+#define EVENT_LOG_BACKUP_ENTRIES 128U
+#endif
+
+/**
+ * @brief Bytes of one entry on the wire
+ */
+#define EVENT_LOG_ENTRY_SIZE 12U
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief Event codes (0 marks a slot being written)
+ */
+typedef enum {
+  EVENT_LOG_NONE = 0,
+  EVENT_LOG_BOOT,      ///< Log started, value = reset flags
+  EVENT_LOG_ADC_ERROR, ///< Error counted (ADC_ErrorInfo_t)
+  EVENT_LOG_OVERRUN,   ///< Overrun repaired
+  EVENT_LOG_DROPPED,   ///< Blocks dropped by a slow consumer
+  EVENT_LOG_TRIGGER,   ///< Trigger fired
+  EVENT_LOG_MODE,      ///< Acquisition mode changed
+  EVENT_LOG_CONFIG,    ///< Stored setting changed
+  EVENT_LOG_SHED,      ///< Stage shed or restored (stage_deadline.h)
+  EVENT_LOG_CODE_COUNT
+} EventLog_Code_t;
+
+/**
+ * @brief One entry
+ */
+typedef struct {
+  uint16_t seq;   ///< Sequence number, low 16 bits
+  uint8_t code;   ///< EventLog_Code_t
+  uint8_t arg;    ///< Code-specific
+  uint32_t tick;  ///< HAL tick (ms)
+  uint32_t value; ///< Code-specific
+} EventLog_Entry_t;
+
+/**
+ * @brief Entries taken by eventLog_peek(), for eventLog_consume()
+ */
+typedef struct {
+  uint8_t previous; ///< 1 = from the previous boot's backup bank
+  uint8_t count;    ///< Entries copied
+  uint32_t first;   ///< Sequence number of the first one
+  uint32_t lost;    ///< Overwritten before they were read, so far
+  uint32_t boot;    ///< Boot number they belong to
+} EventLog_Batch_t;
+
+/**
+ * @brief Counters
+ */
+typedef struct {
+  uint32_t written;  ///< Entries written this boot
+  uint32_t drained;  ///< Entries consumed
+  uint32_t lost;     ///< Overwritten before they were read
+  uint32_t boot;     ///< Boot number (backup SRAM), 0 without it
+  uint32_t previous; ///< Previous boot's entries still to drain
+} EventLog_Stats_t;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief Enable the backup SRAM, take over the previous boot's bank and
+ *        log EVENT_LOG_BOOT
+ *
+ * Entries written before it stay in the RAM ring only.
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK      Mirrored, kept on VBAT
+ *   @retval HAL_TIMEOUT Backup regulator not ready: mirrored, kept across
+ *                       resets but not a loss of VDD
+ */
+HAL_StatusTypeDef eventLog_init(void);
+
+/**
+ * @brief Record one event (any context)
+ */
+void eventLog_write(EventLog_Code_t code, uint8_t arg, uint32_t value);
+
+/**
+ * @brief Copy the oldest entries not drained yet, the previous boot's
+ *        first, without removing them
+ *
+ * @param entries Destination
+ * @param max     Capacity of entries (1..255)
+ * @param batch   Receives what was copied
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    At least one entry
+ *   @retval HAL_BUSY  Nothing to drain (or the next one is being written)
+ *   @retval HAL_ERROR NULL pointer or max 0
+ *
+ * @note Main loop only
+ */
+HAL_StatusTypeDef eventLog_peek(EventLog_Entry_t *entries, uint8_t max,
+                                EventLog_Batch_t *batch);
+
+/**
+ * @brief Remove the entries of a batch once sent
+ */
+void eventLog_consume(const EventLog_Batch_t *batch);
+
+/**
+ * @brief Short name of a code ("boot", "adc_error", ...)
+ */
+const char *eventLog_getName(EventLog_Code_t code);
+
+/**
+ * @brief Get the counters
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer
+ */
+HAL_StatusTypeDef eventLog_getStats(EventLog_Stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* EVENT_LOG_H */
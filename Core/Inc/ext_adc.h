@@ -0,0 +1,240 @@
+/**
+ ******************************************************************************
+ * @file    ext_adc.h
+ * @brief   External SPI ADC expansion: conversions chained by DMA off the
+ *          scan trigger, delivered in blocks aligned with the internal ones
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * For channels that need more than 12 bits, an SPI ADC of the kind that
+ * converts on the rising edge of its chip select and shifts a result out
+ * during the next frame (AD7689/AD7949, ADS8x68 with 16-bit frames) is
+ * wired to SPI4:
+ *
+ *   PE2 SCK  PE4 NSS (CNV)  PE5 MISO  PE6 MOSI  (AF5)
+ *
+ * No CPU time goes into the reads. The chain is:
+ *
+ *   TIM2 TRGO -> TIM8 (ITR1, trigger + one-pulse mode, RCR = W - 1)
+ *     CC1 once per word period, W times
+ *       -> DMA2 Stream2 ch7: next command word into SPI4_DR (circular)
+ *            -> SPI4 shifts 16 bits, NSS high after the frame (NSSP)
+ *            -> DMA2 Stream3 ch5: result word into the RX buffer (circular)
+ *
+ * Every scan trigger that starts the internal ADCs also sends the command
+ * table once: one command per channel, then EXT_ADC_LATENCY repeats of the
+ * last one so the pipelined results of this trigger are all read before
+ * the next. A trigger thus takes W = EXT_ADC_CHANNELS + EXT_ADC_LATENCY
+ * words, and channel ch of frame f is word f * W + EXT_ADC_LATENCY + ch.
+ * The word period EXT_ADC_WORD_NS covers the frame and the conversion
+ * that follows it, so channel ch is sampled about
+ * (ch + EXT_ADC_LATENCY) word periods after the internal channels.
+ *
+ * The RX buffer holds two blocks of ADC_CONVERSIONS_BLOCK_FRAMES frames.
+ * Its half and full interrupts (a cache invalidate and the callback) hand
+ * each block over a sequence after the internal block of the same
+ * triggers, with that block's ADC_BlockInfo_t: same first frame, frame
+ * count and timestamp, so external and internal channels are merged by
+ * frame number. A block whose internal counterpart does not match counts
+ * as misaligned (a trigger was lost, the rate is above
+ * extAdc_getMaxFrameRate()) and carries its own frame numbers and stamp.
+ *
+ * Usage Example:
+ *   extAdc_init();                              // once, after MX_DMA_Init()
+ *   extAdc_registerBlockCallback(onExtBlock, NULL);
+ *
+ *   analogSensor_startTimedDMA(rate_hz);
+ *   extAdc_start(rate_hz);                      // before the first trigger
+ *
+ *   void onExtBlock(const ExtAdc_Block_t *b, void *ctx) {
+ *     uint16_t code = extAdc_getSample(b, 0, 3); // first frame, channel 3
+ *   }
+ *
+ * @note TIM8 and DMA2 Streams 2/3 are taken while EXT_ADC_ENABLE is set.
+ *       The internal blocks must keep the build's length: a block shortened
+ *       by analogSensor_setBlockFrames() never matches an RX half.
+ ******************************************************************************
+ */
+
+#ifndef EXT_ADC_H
+#define EXT_ADC_H
+
+#include "adc_conversions.h"
+#include "irq_priority.h"
+#include "stm32f7xx_hal.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+
+/**
+ * @brief Set to 1 when the expansion board is fitted
+ */
+#ifndef EXT_ADC_ENABLE
+#define EXT_ADC_ENABLE 0
+#endif
+
+/**
+ * @brief Channels converted per trigger (1..16)
+ */
+#ifndef EXT_ADC_CHANNELS
+#define EXT_ADC_CHANNELS 8U
+#endif
+
+/**
+ * @brief Frames between sending a channel's command and reading its result
+ *        (2 for AD7689-type converters, 0..3)
+ */
+#ifndef EXT_ADC_LATENCY
+#define EXT_ADC_LATENCY 2U
+#endif
+
+/**
+ * @brief Command word that selects channel ch. The default is an AD7689 CFG
+ *        word: overwrite, unipolar to COM, full bandwidth, internal 4.096 V
+ *        reference, no sequencer, no read-back.
+ */
+#ifndef EXT_ADC_COMMAND
+#define EXT_ADC_COMMAND(ch) ((uint16_t)((0x3C49U | ((uint32_t)(ch) << 7)) << 2))
+#endif
+
+/**
+ * @brief Word period: one 16-bit frame plus the conversion after it
+ */
+#ifndef EXT_ADC_WORD_NS
+#define EXT_ADC_WORD_NS 4000U
+#endif
+
+/**
+ * @brief SPI4 clock divider from PCLK2 (SPI_BAUDRATEPRESCALER_x)
+ */
+#ifndef EXT_ADC_SPI_PRESCALER
+#define EXT_ADC_SPI_PRESCALER SPI_BAUDRATEPRESCALER_8
+#endif
+
+/**
+ * @brief 1 for SPI mode 3 (CPOL = CPHA = 1), 0 for mode 0
+ */
+#ifndef EXT_ADC_SPI_MODE3
+#define EXT_ADC_SPI_MODE3 0
+#endif
+
+/**
+ * @brief RX DMA interrupt priority; below the ADC stream, so a block is
+ *        handed over after its internal counterpart
+ */
+#ifndef EXT_ADC_IRQ_PRIORITY
+#define EXT_ADC_IRQ_PRIORITY IRQ_PRIORITY_TIMER
+#endif
+
+/**
+ * @brief Words per trigger and per block
+ */
+#define EXT_ADC_FRAME_WORDS (EXT_ADC_CHANNELS + EXT_ADC_LATENCY)
+#define EXT_ADC_BLOCK_WORDS (ADC_CONVERSIONS_BLOCK_FRAMES * EXT_ADC_FRAME_WORDS)
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief One block of external frames
+ */
+typedef struct {
+  ADC_BlockInfo_t info; ///< As the internal block of the same triggers
+  const uint16_t *words; ///< EXT_ADC_BLOCK_WORDS received words (DMA buffer)
+} ExtAdc_Block_t;
+
+/**
+ * @brief Block callback (RX DMA interrupt). The words stay valid for one
+ *        block period, until the DMA refills that half.
+ */
+typedef void (*ExtAdc_BlockCallback_t)(const ExtAdc_Block_t *block, void *ctx);
+
+/**
+ * @brief Transfer counters, reset by extAdc_start()
+ */
+typedef struct {
+  uint8_t running;     ///< Chain armed
+  uint32_t blocks;     ///< Blocks handed over
+  uint32_t misaligned; ///< Blocks without a matching internal block
+  uint32_t overruns;   ///< SPI receive overruns (a word was lost)
+  uint32_t dma_errors; ///< Transfer errors of either stream
+} ExtAdc_Stats_t;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief Set up SPI4, its pins, TIM8 and both DMA streams (not armed)
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Ready (or EXT_ADC_ENABLE = 0)
+ *   @retval HAL_ERROR A HAL init failed, or the word period does not fit
+ *                     the TIM8 counter
+ */
+HAL_StatusTypeDef extAdc_init(void);
+
+/**
+ * @brief Arm the chain for the scan started at frame 0
+ *
+ * Call right after analogSensor_startTimedDMA(), within one frame period:
+ * the first TIM2 update after the call is taken as frame 0.
+ *
+ * @param frame_rate_hz Scan rate, for the sequence length check
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Armed
+ *   @retval HAL_ERROR Not initialised, or the rate is above
+ *                     extAdc_getMaxFrameRate()
+ */
+HAL_StatusTypeDef extAdc_start(uint32_t frame_rate_hz);
+
+/**
+ * @brief Disarm the chain; call before analogSensor_stopDMA()
+ */
+void extAdc_stop(void);
+
+/**
+ * @brief Highest scan rate whose trigger period holds a whole sequence
+ */
+uint32_t extAdc_getMaxFrameRate(void);
+
+/**
+ * @brief Register the block callback (NULL to remove)
+ */
+void extAdc_registerBlockCallback(ExtAdc_BlockCallback_t callback, void *ctx);
+
+/**
+ * @brief Code of one channel in one frame of a block
+ *
+ * @param block Block passed to the callback
+ * @param frame 0..info.frame_count - 1
+ * @param ch    0..EXT_ADC_CHANNELS - 1
+ */
+static inline uint16_t extAdc_getSample(const ExtAdc_Block_t *block,
+                                        uint32_t frame, uint8_t ch) {
+  return block->words[frame * EXT_ADC_FRAME_WORDS + EXT_ADC_LATENCY + ch];
+}
+
+/**
+ * @brief Get transfer counters
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer
+ */
+HAL_StatusTypeDef extAdc_getStats(ExtAdc_Stats_t *stats);
+
+/**
+ * @brief RX DMA interrupt (DMA2_Stream3_IRQHandler)
+ */
+void extAdc_dmaIrqHandler(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* EXT_ADC_H */
@@ -0,0 +1,151 @@
+/**
+ ******************************************************************************
+ * @file    fat_view.h
+ * @brief   Read-only FAT32 volume synthesised over the raw SD recording
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * The recorder (sd_logger.h) writes records back to back from one card
+ * sector on, with no file system. Exposed as it is, the card would show
+ * the host an unformatted disk. The view shows a small FAT32 volume
+ * instead, whose files are the recording; nothing is written:
+ *
+ *   INDEX.BIN      the index sector (SdLogger_Index_t), 512 bytes
+ *   DATA_000.BIN   the records, FAT_VIEW_PART_MB per file, in order
+ *   DATA_001.BIN   ...
+ *
+ * Every sector of a data file is a card sector: the files are contiguous
+ * clusters, and the clusters are laid over the card so that sector i of
+ * the recording is volume sector file_lba + i. fatView_map() turns a run
+ * of volume sectors into one card run, which the reader fetches with a
+ * single multi-block read. The rest (boot sector, FSInfo, both FAT copies,
+ * the root directory, INDEX.BIN) is a few kB of arithmetic, worked out
+ * per sector by fatView_read(): a 32 GB card's FAT is never held in RAM.
+ *
+ * The volume is as large as the recorder's region, so it clears the FAT32
+ * minimum of 65525 clusters on any card over 32 MB, and the files end
+ * where the recording ends. Clusters are 32 kB, or smaller on small
+ * cards. There is no clock: the files are dated 1 January 1980.
+ *
+ * Usage Example:
+ *   static FatView_t view;
+ *   const FatView_Config_t cfg = {.data_lba = idx.data_lba,
+ *                                 .data_sectors = recorded,
+ *                                 .region_sectors = region,
+ *                                 .serial = idx.session,
+ *                                 .index = index_sector};
+ *   fatView_init(&view, &cfg);
+ *
+ *   uint32_t card;
+ *   uint32_t n = fatView_map(&view, lba, count, &card);
+ *   if (card == FAT_VIEW_SYNTH) {
+ *     for (uint32_t i = 0; i < n; i++) {
+ *       fatView_read(&view, lba + i, &buf[i * FAT_VIEW_SECTOR_SIZE]);
+ *     }
+ *   } else {
+ *     sdLogger_read(buf, card, n);   // n card sectors from card on
+ *   }
+ *
+ * @note No state changes after fatView_init(): any context may read.
+ ******************************************************************************
+ */
+
+#ifndef FAT_VIEW_H
+#define FAT_VIEW_H
+
+#include "stm32f7xx_hal.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+
+/**
+ * @brief Size of each data file but the last, MB (FAT32 files stop at
+ *        4 GB)
+ */
+#ifndef FAT_VIEW_PART_MB
+#define FAT_VIEW_PART_MB 1024U
+#endif
+
+#define FAT_VIEW_SECTOR_SIZE 512U
+
+/**
+ * @brief fatView_map(): the run is synthesised, not on the card
+ */
+#define FAT_VIEW_SYNTH 0xFFFFFFFFU
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief What the volume shows
+ */
+typedef struct {
+  uint32_t data_lba;       ///< Card sector of the recording's first sector
+  uint32_t data_sectors;   ///< Sectors recorded
+  uint32_t region_sectors; ///< Sectors the region can hold: the volume size
+  uint32_t serial;         ///< Volume serial number
+  const uint8_t *index;    ///< FAT_VIEW_SECTOR_SIZE bytes of INDEX.BIN
+} FatView_Config_t;
+
+/**
+ * @brief Volume geometry, from fatView_init()
+ */
+typedef struct {
+  FatView_Config_t cfg;
+  uint32_t cluster_sectors; ///< Sectors per cluster
+  uint32_t fat_sectors;     ///< Sectors per FAT copy
+  uint32_t clusters;        ///< Data clusters
+  uint32_t total_sectors;   ///< Volume size
+  uint32_t root_lba;        ///< Root directory (cluster 2)
+  uint32_t file_lba;        ///< First sector of DATA_000.BIN (cluster 4)
+  uint32_t part_sectors;    ///< Sectors per data file but the last
+  uint16_t parts;           ///< Data files
+} FatView_t;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief Lay out the volume
+ *
+ * @param view Instance
+ * @param cfg  What it shows (the index pointer is kept)
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Ready; a recording longer than the root directory
+ *                     can list files for is cut there
+ *   @retval HAL_ERROR NULL pointer, or a region under FAT32's minimum size
+ */
+HAL_StatusTypeDef fatView_init(FatView_t *view, const FatView_Config_t *cfg);
+
+/**
+ * @brief Where a run of volume sectors comes from
+ *
+ * @param view     Instance
+ * @param lba      First volume sector, below total_sectors
+ * @param count    Sectors wanted, >= 1
+ * @param card_lba Card sector of lba, or FAT_VIEW_SYNTH
+ *
+ * @return uint32_t Sectors from lba on of the same source (1..count)
+ */
+uint32_t fatView_map(const FatView_t *view, uint32_t lba, uint32_t count,
+                     uint32_t *card_lba);
+
+/**
+ * @brief Content of one synthesised sector (zeros past the files)
+ *
+ * @param view Instance
+ * @param lba  Volume sector that fatView_map() gave as FAT_VIEW_SYNTH
+ * @param dst  FAT_VIEW_SECTOR_SIZE bytes
+ */
+void fatView_read(const FatView_t *view, uint32_t lba, uint8_t *dst);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FAT_VIEW_H */
@@ -0,0 +1,181 @@
+/**
+ ******************************************************************************
+ * @file    fft_sched.h
+ * @brief   Paced FFT scheduler: the segments of several spectrum instances
+ *          spread over successive passes instead of one burst
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * Spectrum instances fed from the same blocks complete their segments on
+ * the same block, every length / 2 frames. Transforming all of them in the
+ * pass that follows is a CPU spike: the next block's consumer starts late,
+ * and the peak, not the mean, decides which clock profile the application
+ * needs. Each segment, though, may take until its instance's next one
+ * arrives before the collection buffer overruns.
+ *
+ * The scheduler runs the segments as resumable steps (dspSpectrum_step():
+ * transform, cepstrum, publish) and paces them against that deadline. Per
+ * pass it learns each instance's period (passes between two of its
+ * segments), then runs
+ *   ceil(steps pending / passes left before the earliest deadline)
+ * steps, the in-progress instance first, then by deadline. 1024-point
+ * instances at 256 frames per block (a segment every two blocks) run half
+ * their steps per pass instead of all of them; 4096 points spread over
+ * eight. An instance with no period yet runs at once, as before.
+ * Windows are not moved: segments of different instances stay on the same
+ * frames, as dsp_coherence.h needs.
+ *
+ * Reported: the most steps and the most cycles of one pass, the longest
+ * single step, and the worst latency of a segment, from the pass that
+ * first sees it to its transform. FFT_SCHED_BURST runs every step of the
+ * pass, as dspSpectrum_poll() did, for comparison.
+ *
+ * Usage Example:
+ *   static FftSched_t sched;
+ *   fftSched_init(&sched, FFT_SCHED_SPREAD);
+ *   fftSched_add(&sched, &spectrum[0]);
+ *   fftSched_add(&sched, &spectrum[1]);
+ *
+ *   // main loop, once per block (instead of dspSpectrum_poll())
+ *   fftSched_poll(&sched);
+ *   if (dspSpectrum_getResult(&spectrum[0], &res) == HAL_OK) { ... }
+ *
+ * @note One context: the one that would call dspSpectrum_poll(). Passes
+ *       more frequent than blocks only finish the work earlier.
+ ******************************************************************************
+ */
+
+#ifndef FFT_SCHED_H
+#define FFT_SCHED_H
+
+#include "dsp_spectrum.h"
+#include "stm32f7xx_hal.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+
+/**
+ * @brief Instances one scheduler can pace
+ */
+#ifndef FFT_SCHED_MAX_SPECTRA
+#define FFT_SCHED_MAX_SPECTRA 8U
+#endif
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief Pacing policy
+ */
+typedef enum {
+  FFT_SCHED_SPREAD = 0, ///< Steps paced to the earliest deadline
+  FFT_SCHED_BURST       ///< Every pending step in the pass that sees it
+} FftSched_Mode_t;
+
+/**
+ * @brief Load figures since init or the last reset
+ */
+typedef struct {
+  uint32_t passes;           ///< fftSched_poll() calls
+  uint32_t steps;            ///< Steps run
+  uint32_t segments;         ///< Segments transformed
+  uint32_t overruns;         ///< Segments the instances dropped (sum)
+  uint8_t peak_steps;        ///< Most steps in one pass
+  uint32_t peak_pass_cycles; ///< Most cycles in one pass
+  uint32_t peak_step_cycles; ///< Longest single step
+  uint32_t worst_wait_cycles; ///< Segment seen -> transformed, longest
+} FftSched_Stats_t;
+
+/**
+ * @brief One paced instance
+ */
+typedef struct {
+  DSP_Spectrum_t *spectrum;
+  uint32_t seen;     ///< Its segment count at the last pass
+  uint32_t arrival;  ///< Pass of its newest segment
+  uint32_t period;   ///< Passes between its last two segments, 0 = unknown
+  uint8_t waiting;   ///< A segment is in hand, not yet transformed
+  uint32_t ready_at; ///< DWT cycle it was seen
+} FftSched_Entry_t;
+
+/**
+ * @brief Scheduler state
+ */
+typedef struct {
+  FftSched_Entry_t entries[FFT_SCHED_MAX_SPECTRA];
+  uint8_t count;
+  FftSched_Mode_t mode;
+  uint32_t pass;         ///< Passes since init, the arrivals' clock
+  uint32_t overrun_base; ///< Instance overruns at the last reset
+  FftSched_Stats_t stats;
+} FftSched_t;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief Start an empty scheduler
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL instance or unknown mode
+ */
+HAL_StatusTypeDef fftSched_init(FftSched_t *sched, FftSched_Mode_t mode);
+
+/**
+ * @brief Pace one more spectrum instance, initialised or not yet
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer, or FFT_SCHED_MAX_SPECTRA reached
+ */
+HAL_StatusTypeDef fftSched_add(FftSched_t *sched, DSP_Spectrum_t *spectrum);
+
+/**
+ * @brief Change the policy from the next pass
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL instance or unknown mode
+ */
+HAL_StatusTypeDef fftSched_setMode(FftSched_t *sched, FftSched_Mode_t mode);
+
+/**
+ * @brief One pass: note new segments, run this pass's share of the steps
+ *
+ * @return Steps run
+ */
+uint32_t fftSched_poll(FftSched_t *sched);
+
+/**
+ * @brief Get the load figures, and the peaks in microseconds at the
+ *        current HCLK
+ *
+ * @param peak_pass_us Receives the longest pass (may be NULL)
+ * @param peak_step_us Receives the longest step (may be NULL)
+ * @param wait_us      Receives the worst segment wait (may be NULL)
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL instance or stats
+ */
+HAL_StatusTypeDef fftSched_getStats(const FftSched_t *sched,
+                                    FftSched_Stats_t *stats,
+                                    uint32_t *peak_pass_us,
+                                    uint32_t *peak_step_us,
+                                    uint32_t *wait_us);
+
+/**
+ * @brief Clear the load figures (periods are kept)
+ */
+void fftSched_resetStats(FftSched_t *sched);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FFT_SCHED_H */
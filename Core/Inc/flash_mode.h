@@ -0,0 +1,121 @@
+/**
+ ******************************************************************************
+ * @file    flash_mode.h
+ * @brief   Flash instruction-fetch modes: AXIM with the L1 I-cache, or the
+ *          ITCM flash interface with the ART accelerator and prefetch
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * The F746 flash answers on two buses. The image is linked at 0x08000000
+ * (AXIM), where instruction fetches go through the 16 KB L1 I-cache. The
+ * same bytes appear at 0x00200000 on the ITCM flash interface, which has
+ * no L1 cache of its own but has the ART accelerator (64 lines of 256
+ * bits) and the prefetch buffer in front of it. ART and prefetch
+ * (FLASH_ACR, PREFETCH_ENABLE / ART_ACCELERATOR_ENABLE in the HAL config)
+ * therefore only act on code fetched over ITCM. Any fetch that misses
+ * them waits the flash wait states: 3 at 108 MHz, 7 at 216 MHz.
+ *
+ * flashMode_apply() sets the I-cache, ART and prefetch of a mode at
+ * runtime. flashMode_entry() turns the address of a flash function into
+ * the one to call for the mode, so the benchmark image can run the same
+ * code over either bus. Relative branches stay on the bus they started
+ * on, while calls through pointers, veneers into ITCM RAM and literal data
+ * loads keep their linked addresses. ADC_FAST_CODE functions run from ITCM
+ * RAM in every mode.
+ *
+ * The application applies FLASH_MODE_DEFAULT after HAL_Init(). That is
+ * AXIM with the I-cache, where the image is linked, with ART and prefetch
+ * left off because nothing fetches over ITCM. The "BENCH flash" lines of
+ * the benchmark image measure every mode on the polling read, the filter
+ * chain, the FFT and the framing. Rebuild with -DFLASH_MODE_DEFAULT=<mode>
+ * if a release image should run in another mode.
+ *
+ * Usage Example:
+ *   flashMode_apply(FLASH_MODE_ITCM_ART_PREFETCH);
+ *   Scenario_t run = (Scenario_t)flashMode_entry(
+ *       FLASH_MODE_ITCM_ART_PREFETCH, (FlashMode_Fn_t)scenario);
+ *   run(&result);                          // fetched over the ITCM bus
+ *   flashMode_apply(FLASH_MODE_DEFAULT);
+ ******************************************************************************
+ */
+
+#ifndef FLASH_MODE_H
+#define FLASH_MODE_H
+
+#include "stm32f7xx_hal.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief Instruction-fetch path and accelerators
+ */
+typedef enum {
+  FLASH_MODE_AXIM_ICACHE = 0,    ///< AXIM, L1 I-cache on (linked address)
+  FLASH_MODE_AXIM_UNCACHED,      ///< AXIM, I-cache off: every miss waits
+  FLASH_MODE_ITCM_ART_PREFETCH,  ///< ITCM interface, ART and prefetch
+  FLASH_MODE_ITCM_ART,           ///< ITCM interface, ART only
+  FLASH_MODE_ITCM_PREFETCH,      ///< ITCM interface, prefetch only
+  FLASH_MODE_ITCM_BARE,          ///< ITCM interface, neither
+  FLASH_MODE_COUNT
+} FlashMode_t;
+
+/**
+ * @brief Any function, cast back to its own type before the call
+ */
+typedef void (*FlashMode_Fn_t)(void);
+
+/* Exported constants --------------------------------------------------------*/
+
+/**
+ * @brief Mode main() applies after HAL_Init() (FlashMode_t value)
+ */
+#ifndef FLASH_MODE_DEFAULT
+#define FLASH_MODE_DEFAULT FLASH_MODE_AXIM_ICACHE
+#endif
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief Switch the I-cache, ART accelerator and prefetch buffer
+ *
+ * The ART is flushed whenever it is switched on.
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR Invalid mode
+ */
+HAL_StatusTypeDef flashMode_apply(FlashMode_t mode);
+
+/**
+ * @brief Mode set by the last flashMode_apply()
+ */
+FlashMode_t flashMode_getActive(void);
+
+/**
+ * @brief Address to call a function at for a mode
+ *
+ * @param mode Mode the call is made in
+ * @param fn   Function at its linked address
+ *
+ * @return FlashMode_Fn_t The ITCM-interface alias for the ITCM modes when
+ *         fn lies in AXIM flash, fn otherwise (AXIM modes, ITCM RAM, SRAM)
+ */
+FlashMode_Fn_t flashMode_entry(FlashMode_t mode, FlashMode_Fn_t fn);
+
+/**
+ * @brief Short name of a mode for reports ("axim_icache", ...)
+ */
+const char *flashMode_getName(FlashMode_t mode);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FLASH_MODE_H */
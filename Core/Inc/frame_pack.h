@@ -0,0 +1,184 @@
+/**
+ ******************************************************************************
+ * @file    frame_pack.h
+ * @brief   Ring of losslessly compressed frame runs for deep look-back
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * A history kept as ADC_Frame_t costs 14 bytes a frame. This ring keeps the
+ * same frames through the sample codec (sample_codec.h) instead, one run of
+ * up to SAMPLE_CODEC_MAX_SAMPLES frames at a time, each channel coded on
+ * its own: accelerometer data at 4-6 bits a sample takes 4-5 bytes a frame,
+ * so a buffer holds 2-3x the frames it would hold raw. Nothing is decoded
+ * until framePack_decode() asks for a stretch.
+ *
+ * Runs sit whole and back to back in the buffer; a run that does not fit
+ * before its end starts again at offset 0. The oldest runs make room for
+ * the new one. A hold keeps the runs from a frame on: a run that would
+ * need them is refused rather than written (HAL_BUSY, dropped_runs), and
+ * the contiguous history starts again after it.
+ *
+ * Each run costs the encoder about the same per sample whatever the data,
+ * see BM_framePack; the worst case (verbatim runs) is 9 bytes a frame.
+ *
+ * Usage Example:
+ *   static uint8_t buf[16384];
+ *   static FramePack_t pack;
+ *   framePack_init(&pack, buf, sizeof(buf));
+ *
+ *   // writer, frames in channel order
+ *   framePack_push(&pack, frames, count, first_frame);
+ *
+ *   // keep a window, decode it, let it go
+ *   framePack_hold(&pack, first);
+ *   framePack_decode(&pack, first, count, out);
+ *   framePack_release(&pack);
+ *
+ * @note One writer (framePack_push) and one reader of a held stretch may
+ *       run in different contexts; everything else belongs to the writer.
+ ******************************************************************************
+ */
+
+#ifndef FRAME_PACK_H
+#define FRAME_PACK_H
+
+#include "adc_conversions.h"
+#include "sample_codec.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+
+/**
+ * @brief Runs the ring can index; the oldest goes when all are in use
+ */
+#ifndef FRAME_PACK_MAX_RUNS
+#define FRAME_PACK_MAX_RUNS 32U
+#endif
+
+/**
+ * @brief Longest run, in frames
+ */
+#define FRAME_PACK_RUN_FRAMES SAMPLE_CODEC_MAX_SAMPLES
+
+/**
+ * @brief Largest encoded run: every channel verbatim
+ */
+#define FRAME_PACK_RUN_BYTES                                                  \
+  (ADC_CONVERSIONS_CHANNEL_COUNT *                                            \
+   SAMPLE_CODEC_MAX_BYTES(FRAME_PACK_RUN_FRAMES))
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief One encoded run
+ */
+typedef struct {
+  uint32_t first_frame; ///< Frame number of its first frame
+  uint32_t offset;      ///< Position in the buffer
+  uint16_t frames;      ///< Frames in the run
+  uint16_t bytes[ADC_CONVERSIONS_CHANNEL_COUNT]; ///< Code length per channel
+} FramePack_Run_t;
+
+/**
+ * @brief Ring state; fields are the writer's
+ */
+typedef struct {
+  uint8_t *buf;
+  uint32_t size;
+  FramePack_Run_t runs[FRAME_PACK_MAX_RUNS];
+  uint32_t head;        ///< Runs pushed
+  uint32_t tail;        ///< Oldest run still held
+  uint32_t write;       ///< Buffer offset of the next run
+  uint32_t used;        ///< Bytes of the runs held
+  uint32_t start_frame; ///< Oldest frame of the contiguous history
+  uint32_t end_frame;   ///< One past the newest frame
+  volatile uint32_t hold_frame; ///< Runs from this frame on are kept ...
+  volatile uint8_t held;        ///< ... while set
+  uint32_t runs_packed;  ///< Totals since framePack_init()
+  uint32_t frames_packed;
+  uint32_t bytes_packed;
+  uint32_t dropped_runs; ///< Runs refused for a hold
+} FramePack_t;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief Start an empty ring over a buffer
+ *
+ * @param pack Instance
+ * @param buf  Storage, kept
+ * @param size Its size, at least FRAME_PACK_RUN_BYTES
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer or buffer too small
+ */
+HAL_StatusTypeDef framePack_init(FramePack_t *pack, uint8_t *buf,
+                                 uint32_t size);
+
+/**
+ * @brief Encode and append frames, as runs of FRAME_PACK_RUN_FRAMES
+ *
+ * @param pack        Instance
+ * @param frames      Frames in channel order (error fields not kept)
+ * @param count       Frames
+ * @param first_frame Frame number of frames[0]; a jump from the last push
+ *                    starts the contiguous history again
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Appended
+ *   @retval HAL_BUSY  A run would have overwritten held runs: it and the
+ *                     rest are dropped
+ *   @retval HAL_ERROR NULL pointer, or not initialised
+ */
+HAL_StatusTypeDef framePack_push(FramePack_t *pack, const ADC_Frame_t *frames,
+                                 uint32_t count, uint32_t first_frame);
+
+/**
+ * @brief Decode a stretch of the ring
+ *
+ * @param pack  Instance
+ * @param first Frame number of the first frame wanted
+ * @param count Frames
+ * @param out   Destination, count frames (error fields cleared)
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Decoded
+ *   @retval HAL_ERROR NULL pointer, or a frame not (or no longer) held
+ *
+ * @note Safe against the writer for a stretch under framePack_hold()
+ */
+HAL_StatusTypeDef framePack_decode(const FramePack_t *pack, uint32_t first,
+                                   uint32_t count, ADC_Frame_t *out);
+
+/**
+ * @brief Keep the runs from a frame on until framePack_release()
+ */
+void framePack_hold(FramePack_t *pack, uint32_t frame);
+
+/**
+ * @brief Let the held runs go
+ */
+void framePack_release(FramePack_t *pack);
+
+/**
+ * @brief Oldest frame of the contiguous history up to the newest one
+ */
+uint32_t framePack_startFrame(const FramePack_t *pack);
+
+/**
+ * @brief Frames of the contiguous history
+ */
+uint32_t framePack_frames(const FramePack_t *pack);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FRAME_PACK_H */
@@ -0,0 +1,192 @@
+/**
+ ******************************************************************************
+ * @file    host_cmd.h
+ * @brief   Host command channel: USART3 RX by circular DMA with idle-line
+ *          detection, parsed and dispatched from the main loop
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * HAL_UARTEx_ReceiveToIdle_DMA() keeps DMA1 Stream1 writing USART3 RX into
+ * a circular buffer. The RX event callback (half, full and idle line) only
+ * advances a byte count; hostCmd_poll() copies the new bytes out of the
+ * buffer, splits them into commands and runs the handlers, all in the main
+ * loop. Nothing on the receive path waits or parses in an interrupt, so a
+ * command never delays acquisition.
+ *
+ * A command ends with CR or LF, or with the idle line after the last byte,
+ * so a host may send "rate 2000" without a terminator as long as it sends
+ * it in one go. It is split at spaces into at most HOST_CMD_MAX_ARGS
+ * words; the first one selects the table entry. Every command longer than
+ * one character is answered with one text line through telemetry_send():
+ *
+ *   "CMD ok <name>"      handler returned HAL_OK
+ *   "CMD err <name>"     HAL_ERROR, e.g. a bad argument
+ *   "CMD busy <name>"    HAL_BUSY, refused in the current state
+ *   "CMD unknown <name>"
+ *
+ * One-character commands are the original single-byte controls and stay
+ * silent, so older host tools work unchanged and line noise at the wrong
+ * baud rate produces no output. "help" lists the table with its usage
+ * strings.
+ *
+ * The receiver restarts itself from hostCmd_poll() whenever the HAL has
+ * stopped it: after an overrun or framing error, or after
+ * telemetry_setLink() re-initialised the UART at another rate. If the main
+ * loop falls more than HOST_CMD_RX_SIZE bytes behind, the unread bytes are
+ * dropped and counted, and parsing resumes at the next terminator.
+ *
+ * Concurrency model:
+ *   - HAL_UARTEx_RxEventCallback() (USART3 / DMA1 Stream1 interrupts):
+ *     producer, updates the received byte count.
+ *   - hostCmd_poll(), hostCmd_feed() and the handlers: main loop (the comms
+ *     task in the RTOS build).
+ *
+ * Usage Example:
+ *   static HAL_StatusTypeDef App_CmdRate(uint32_t argc, char *argv[],
+ *                                        void *ctx);
+ *   static const HostCmd_Command_t commands[] = {
+ *       {"rate", App_CmdRate, NULL, "rate <hz>"},
+ *   };
+ *
+ *   hostCmd_init(&huart3, commands, sizeof(commands) / sizeof(commands[0]));
+ *
+ *   // main loop
+ *   hostCmd_poll();
+ *   len = usbStream_read(buf, sizeof(buf));
+ *   hostCmd_feed(buf, len);              // same commands over USB
+ *
+ ******************************************************************************
+ */
+
+#ifndef HOST_CMD_H
+#define HOST_CMD_H
+
+#include "irq_priority.h"
+#include "stm32f7xx_hal.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+
+/**
+ * @brief RX DMA buffer in bytes (power of two, multiple of 32): 22 ms of
+ *        continuous input at 115200 baud before the loop must have read it
+ */
+#ifndef HOST_CMD_RX_SIZE
+#define HOST_CMD_RX_SIZE 256U
+#endif
+
+/**
+ * @brief Longest command line; longer ones are dropped
+ */
+#ifndef HOST_CMD_LINE_MAX
+#define HOST_CMD_LINE_MAX 64U
+#endif
+
+/**
+ * @brief Most words per command, name included
+ */
+#ifndef HOST_CMD_MAX_ARGS
+#define HOST_CMD_MAX_ARGS 4U
+#endif
+
+/**
+ * @brief NVIC priority of DMA1 Stream1 (USART3 RX)
+ */
+#ifndef HOST_CMD_IRQ_PRIORITY
+#define HOST_CMD_IRQ_PRIORITY IRQ_PRIORITY_COMMS
+#endif
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief Command handler (main loop)
+ *
+ * @param argc Words, at least 1
+ * @param argv Zero-terminated words, argv[0] the command name
+ * @param ctx  Context of the table entry
+ *
+ * @return HAL_StatusTypeDef, reported to the host (see above)
+ */
+typedef HAL_StatusTypeDef (*HostCmd_Handler_t)(uint32_t argc, char *argv[],
+                                               void *ctx);
+
+/**
+ * @brief One command of the table
+ */
+typedef struct {
+  const char *name;          ///< First word
+  HostCmd_Handler_t handler;
+  void *ctx;                 ///< Passed to handler
+  const char *usage;         ///< Shown by "help" (NULL = name)
+} HostCmd_Command_t;
+
+/**
+ * @brief Receiver statistics
+ */
+typedef struct {
+  uint32_t bytes;      ///< Bytes received on USART3 and fed
+  uint32_t commands;   ///< Commands dispatched
+  uint32_t unknown;    ///< First word not in the table
+  uint32_t failed;     ///< Handler returned HAL_ERROR or HAL_BUSY
+  uint32_t too_long;   ///< Lines over HOST_CMD_LINE_MAX
+  uint32_t overflows;  ///< Times the loop fell a whole buffer behind
+  uint32_t restarts;   ///< Receiver restarts after an error or re-init
+} HostCmd_Stats_t;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief Set up DMA1 Stream1 and start receiving
+ *
+ * @param huart UART already initialised for RX (MX_USART3_UART_Init())
+ * @param table Commands, kept by reference
+ * @param count Entries in table
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Receiving
+ *   @retval HAL_ERROR NULL pointer, or DMA set-up or RX start failed
+ */
+HAL_StatusTypeDef hostCmd_init(UART_HandleTypeDef *huart,
+                               const HostCmd_Command_t *table,
+                               uint32_t count);
+
+/**
+ * @brief Restart the receiver if stopped, then parse and run what arrived
+ *
+ * @note Call from the main loop
+ */
+void hostCmd_poll(void);
+
+/**
+ * @brief Parse bytes from another link (e.g. USB); the end of the data
+ *        ends a command like an idle line
+ *
+ * @note Call from the main loop
+ */
+void hostCmd_feed(const uint8_t *data, uint32_t len);
+
+/**
+ * @brief Get receiver statistics
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer
+ */
+HAL_StatusTypeDef hostCmd_getStats(HostCmd_Stats_t *stats);
+
+/**
+ * @brief DMA1 Stream1 interrupt; call from DMA1_Stream1_IRQHandler()
+ */
+void hostCmd_dmaIrqHandler(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HOST_CMD_H */
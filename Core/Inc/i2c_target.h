@@ -0,0 +1,214 @@
+/**
+ ******************************************************************************
+ * @file    i2c_target.h
+ * @brief   I2C target (slave) register view of the newest frame, the
+ *          channel statistics and the acquisition status, read by DMA
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * For a host controller that polls the board like a sensor. I2C1 answers
+ * at I2C_TARGET_ADDRESS on the Nucleo D15/D14 pins:
+ *
+ *   PB8 SCL  PB9 SDA  (AF4, open drain; pull-ups on the host side)
+ *
+ * The registers (I2cTarget_Registers_t, little-endian) are addressed by an
+ * 8-bit pointer, as on most sensors:
+ *
+ *   write  [S] addr+W reg [P]                      set the pointer
+ *   read   [S] addr+W reg [Sr] addr+R data... [P]  burst from reg
+ *   read   [S] addr+R data... [P]                  burst from the pointer
+ *
+ * A burst runs up to the end of the map and wraps to register 0. The
+ * registers are read-only; bytes written after the pointer are ignored.
+ *
+ * No interrupt per byte. i2cTarget_update() (main loop) writes a complete
+ * copy of the registers into one of two snapshots, cleans it from the
+ * D-cache and publishes it. The address match of a read latches the
+ * published snapshot and DMA1 Stream7 serves the whole burst from it, so a
+ * read is always one coherent view. The update never writes the latched
+ * snapshot: while a read holds it past the next update, that update is
+ * deferred. A transaction costs the address interrupt, one DMA completion
+ * and the stop, all at IRQ_PRIORITY_COMMS, below the acquisition.
+ *
+ * Usage Example:
+ *   i2cTarget_init();              // once, after the ADC is initialised
+ *
+ *   while (1) {
+ *     i2cTarget_update();          // refreshes every I2C_TARGET_UPDATE_MS
+ *   }
+ *
+ *   // Host (any I2C controller), frame sequence and the samples:
+ *   //   HAL_I2C_Mem_Read(&hi2c, I2C_TARGET_ADDRESS << 1,
+ *   //                    I2C_TARGET_REG_SEQUENCE, I2C_MEMADD_SIZE_8BIT,
+ *   //                    buf, I2C_TARGET_REG_STATS - I2C_TARGET_REG_SEQUENCE,
+ *   //                    10);
+ *
+ * @note I2C1 and DMA1 Stream7 are taken while I2C_TARGET_ENABLE is set.
+ ******************************************************************************
+ */
+
+#ifndef I2C_TARGET_H
+#define I2C_TARGET_H
+
+#include "adc_conversions.h"
+#include "irq_priority.h"
+#include "stm32f7xx_hal.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+
+/**
+ * @brief Set to 1 when a host reads the board over I2C
+ */
+#ifndef I2C_TARGET_ENABLE
+#define I2C_TARGET_ENABLE 0
+#endif
+
+/**
+ * @brief 7-bit target address
+ */
+#ifndef I2C_TARGET_ADDRESS
+#define I2C_TARGET_ADDRESS 0x48U
+#endif
+
+/**
+ * @brief TIMINGR value; a target only uses its SDADEL/SCLDEL data hold and
+ *        setup times. The default is for 54 MHz PCLK1 and fast mode.
+ */
+#ifndef I2C_TARGET_TIMING
+#define I2C_TARGET_TIMING 0x00D00E28U
+#endif
+
+/**
+ * @brief Snapshot refresh period of i2cTarget_update()
+ */
+#ifndef I2C_TARGET_UPDATE_MS
+#define I2C_TARGET_UPDATE_MS 10U
+#endif
+
+/**
+ * @brief Event, error and TX DMA interrupt priority
+ */
+#ifndef I2C_TARGET_IRQ_PRIORITY
+#define I2C_TARGET_IRQ_PRIORITY IRQ_PRIORITY_COMMS
+#endif
+
+#define I2C_TARGET_MAGIC 0x4441U ///< "AD" in the first two registers
+#define I2C_TARGET_VERSION 1U    ///< Layout of I2cTarget_Registers_t
+
+/**
+ * @brief Flags register bits
+ */
+#define I2C_TARGET_FLAG_FRAME 0x01U   ///< A frame has been published
+#define I2C_TARGET_FLAG_RUNNING 0x02U ///< A scan is running
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief Statistics of one channel, since the last statistics reset
+ *
+ * mean and rms are in 1/16 code (a 12-bit code fits 16 bits at that
+ * scale); rms is taken around the mean, as in ADC_ChannelStats_t.
+ */
+typedef struct __attribute__((packed)) {
+  uint16_t mean_q4; ///< Mean code x 16
+  uint16_t rms_q4;  ///< AC RMS x 16 (saturates at 65535)
+  uint16_t min;     ///< Smallest code
+  uint16_t max;     ///< Largest code
+} I2cTarget_ChannelRegs_t;
+
+/**
+ * @brief Register map; the register address of a field is its offset
+ */
+typedef struct __attribute__((packed)) {
+  uint16_t magic;         ///< I2C_TARGET_MAGIC
+  uint8_t version;        ///< I2C_TARGET_VERSION
+  uint8_t channels;       ///< ADC_CONVERSIONS_CHANNEL_COUNT
+  uint8_t mode;           ///< ADC_AcqMode_t of the acquisition
+  uint8_t flags;          ///< I2C_TARGET_FLAG_x
+  uint16_t update;        ///< Snapshots published (wraps)
+  uint32_t frame_rate_hz; ///< Frame rate of the running scan
+  uint32_t sequence;      ///< Sequence number of the newest frame
+  uint64_t timestamp;     ///< Its timebase_now(), TIMEBASE_TICK_HZ ticks
+  uint32_t error_mask;    ///< Its failed channels (bit n = channel n)
+  uint32_t errors;        ///< analogSensor_getErrorCount()
+  uint32_t dropped;       ///< analogSensor_getDroppedBlocks()
+  uint32_t stats_count;   ///< Samples per channel in the statistics
+  uint16_t samples[ADC_CONVERSIONS_CHANNEL_COUNT]; ///< Newest frame, codes
+  I2cTarget_ChannelRegs_t stats[ADC_CONVERSIONS_CHANNEL_COUNT]; ///< By channel
+} I2cTarget_Registers_t;
+
+_Static_assert(sizeof(I2cTarget_Registers_t) <= 256U,
+               "the register map must fit the 8-bit register pointer");
+
+/**
+ * @brief Register addresses of the frame fields
+ */
+#define I2C_TARGET_REG_SEQUENCE offsetof(I2cTarget_Registers_t, sequence)
+#define I2C_TARGET_REG_SAMPLES offsetof(I2cTarget_Registers_t, samples)
+#define I2C_TARGET_REG_STATS offsetof(I2cTarget_Registers_t, stats)
+
+/**
+ * @brief Transaction counters since i2cTarget_init()
+ */
+typedef struct {
+  uint32_t reads;    ///< Read transfers started (address + R)
+  uint32_t writes;   ///< Pointer writes
+  uint32_t updates;  ///< Snapshots published
+  uint32_t deferred; ///< Updates put off by a read of the older snapshot
+  uint32_t errors;   ///< Bus errors, arbitration losses, overruns
+} I2cTarget_Stats_t;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief Set up I2C1, its pins and DMA stream, publish a first snapshot
+ *        and start listening
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Listening (or I2C_TARGET_ENABLE = 0)
+ *   @retval HAL_ERROR A HAL init failed
+ */
+HAL_StatusTypeDef i2cTarget_init(void);
+
+/**
+ * @brief Publish a new snapshot every I2C_TARGET_UPDATE_MS (main loop)
+ */
+void i2cTarget_update(void);
+
+/**
+ * @brief Get the transaction counters
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer
+ */
+HAL_StatusTypeDef i2cTarget_getStats(I2cTarget_Stats_t *stats);
+
+/**
+ * @brief Event interrupt (I2C1_EV_IRQHandler)
+ */
+void i2cTarget_evIrqHandler(void);
+
+/**
+ * @brief Error interrupt (I2C1_ER_IRQHandler)
+ */
+void i2cTarget_erIrqHandler(void);
+
+/**
+ * @brief TX DMA interrupt (DMA1_Stream7_IRQHandler)
+ */
+void i2cTarget_dmaIrqHandler(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* I2C_TARGET_H */
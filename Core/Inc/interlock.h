@@ -0,0 +1,180 @@
+/**
+ ******************************************************************************
+ * @file    interlock.h
+ * @brief   Hard real-time interlock: analog watchdog alarm -> GPIO in the
+ *          ADC interrupt
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * Drives an output pin when a guarded channel leaves its window, without
+ * the main loop. The comparison is the ADC analog watchdog: hardware checks
+ * every conversion of the guarded channel (analogSensor_configWatchdog())
+ * and raises the ADC interrupt on the first one outside the window.
+ * interlock_irqHandler() is the first thing ADC_IRQHandler() runs. It reads
+ * the three watchdog flags and writes the pin's BSRR. The HAL dispatch, the
+ * watchdog callback and the capture trigger (adc_trigger.h) come after it.
+ *
+ * The output latches. interlock_reset() releases it and re-arms the
+ * watchdogs, so an input still outside its window trips it again on the
+ * next frame.
+ *
+ * Latency from the sample instant of the offending conversion to the pin:
+ *
+ *   1. the rest of its conversion, 12 ADCCLK after the sampling time, plus
+ *      the later ranks of the ADC's scan, to the watchdog flag;
+ *   2. interrupt entry, 12 cycles, with the vector and the handler in
+ *      ITCM or hitting the ART cache;
+ *   3. this handler up to the BSRR write, a few dozen cycles;
+ *   4. whatever holds the ADC interrupt off: interrupts at ADC_IRQn's
+ *      priority or above, and PRIMASK sections.
+ *
+ * interlock_init() gives the ADC interrupt INTERLOCK_IRQ_PRIORITY and moves
+ * the ADC DMA interrupt one level below it, so the block processing in the
+ * DMA interrupt no longer holds the reaction off. Item 4 is then only the
+ * short PRIMASK snapshots of the stack. A level change between two samples
+ * adds up to one frame period on top, since the channel is sampled once
+ * per frame.
+ *
+ * Two measurements are kept per trip: the cycles from handler entry to the
+ * pin write (item 3), and the time from the frame's TIM2 scan trigger to
+ * the pin write, which spans items 1 to 4 for the whole scan up to the
+ * guarded rank. interlock_getStats() reports both, with the worst case
+ * seen; the second also goes to the trigger_output histogram
+ * (latency_hist.h) for its percentiles.
+ *
+ * Usage Example:
+ *   analogSensor_configWatchdog(0, 1024, 3072);   // +-1.25 g on X
+ *   const Interlock_Config_t cfg = {.port = GPIOG,
+ *                                   .pin = GPIO_PIN_1,
+ *                                   .active_low = 0,
+ *                                   .channels = 1U << 0};
+ *   interlock_init(&cfg);
+ *   analogSensor_startTimedDMA(4000);
+ *
+ *   // ADC_IRQHandler(), before HAL_ADC_IRQHandler()
+ *   interlock_irqHandler();
+ *
+ *   // after the cause is cleared
+ *   interlock_reset();
+ *
+ * @note The port's clock must be running (MX_GPIO_Init()).
+ ******************************************************************************
+ */
+
+#ifndef INTERLOCK_H
+#define INTERLOCK_H
+
+#include "adc_channels.h"
+#include "irq_priority.h"
+#include "stm32f7xx_hal.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+
+/**
+ * @brief Set to 1 to run the interlock from the ADC interrupt
+ */
+#ifndef INTERLOCK_ENABLE
+#define INTERLOCK_ENABLE 0
+#endif
+
+/**
+ * @brief ADC interrupt priority: the most urgent in the system
+ */
+#ifndef INTERLOCK_IRQ_PRIORITY
+#define INTERLOCK_IRQ_PRIORITY IRQ_PRIORITY_ACQUISITION
+#endif
+
+/**
+ * @brief ADC DMA interrupt priority under the interlock; must be a larger
+ *        number than INTERLOCK_IRQ_PRIORITY
+ */
+#ifndef INTERLOCK_DMA_PRIORITY
+#define INTERLOCK_DMA_PRIORITY (IRQ_PRIORITY_ACQUISITION + 1U)
+#endif
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief Output and the channels that trip it
+ */
+typedef struct {
+  GPIO_TypeDef *port;        ///< Output port
+  uint16_t pin;              ///< GPIO_PIN_x, one pin
+  uint8_t active_low;        ///< 1 = the pin goes low when tripped
+  ADC_ChannelMask_t channels; ///< Guarded channels that trip it
+} Interlock_Config_t;
+
+/**
+ * @brief Trip counters and latencies
+ */
+typedef struct {
+  uint8_t tripped;         ///< Output active
+  uint8_t channel;         ///< Channel of the first trip (0xFF = none)
+  uint32_t trips;          ///< Trips since interlock_init()
+  uint32_t alarms;         ///< Watchdog interrupts seen while tripped
+  uint32_t last_cycles;    ///< Handler entry -> pin write, newest trip
+  uint32_t max_cycles;     ///< ... worst trip
+  uint32_t last_trigger_ns; ///< Scan trigger -> pin write, newest trip
+  uint32_t max_trigger_ns;  ///< ... worst trip (0 = not TIM2-triggered)
+} Interlock_Stats_t;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief Set up the output (released) and the interrupt priorities
+ *
+ * @param cfg Output pin and channels, copied
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success (or INTERLOCK_ENABLE = 0)
+ *   @retval HAL_ERROR NULL pointer, not exactly one pin, or no channel
+ *
+ * @note The channels need a watchdog window (analogSensor_configWatchdog())
+ *       before the DMA start.
+ */
+HAL_StatusTypeDef interlock_init(const Interlock_Config_t *cfg);
+
+/**
+ * @brief Release the output and re-arm the watchdog alarms
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Released
+ *   @retval HAL_ERROR Not initialised
+ */
+HAL_StatusTypeDef interlock_reset(void);
+
+/**
+ * @brief Output state
+ *
+ * @return uint8_t 1 if tripped
+ */
+uint8_t interlock_isTripped(void);
+
+/**
+ * @brief Get trip counters and latencies
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer
+ */
+HAL_StatusTypeDef interlock_getStats(Interlock_Stats_t *stats);
+
+/**
+ * @brief Trip check; call first in ADC_IRQHandler()
+ *
+ * Leaves the flags to HAL_ADC_IRQHandler().
+ */
+void interlock_irqHandler(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* INTERLOCK_H */
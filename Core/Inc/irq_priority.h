@@ -0,0 +1,146 @@
+/**
+ ******************************************************************************
+ * @file    irq_priority.h
+ * @brief   NVIC priority plan of the acquisition stack
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * One table for every interrupt the firmware enables, so that a module
+ * added later takes a tier instead of a guessed number. Each module still
+ * has its own XXX_IRQ_PRIORITY switch; its default is the tier below.
+ * Lower numbers pre-empt higher ones (4 priority bits, no sub-priority):
+ *
+ *   0  IRQ_PRIORITY_ACQUISITION  ADC DMA (DMA2 Stream0), ADC watchdogs,
+ *                                TIM7 PC sampler (pc_profile.h), TIM4
+ *                                DWT counter reads (dwt_counters.h)
+ *   1  IRQ_PRIORITY_TIMER        TIM5 timebase, TIM2 sync, SPI ADC DMA
+ *   2  IRQ_PRIORITY_CAPTURE      TIM3 tach capture
+ *   5  IRQ_PRIORITY_COMMS        USART3, its RX/TX DMA, RTOS block notify,
+ *                                I2C1 target and its TX DMA (i2c_target.h),
+ *                                CAN1 (can_bus.h), USART2 Modbus server
+ *                                (modbus_server.h), UART8 and TIM9 TDMA
+ *                                bus (tdma_bus.h)
+ *   6  IRQ_PRIORITY_USB          OTG FS
+ *   7  IRQ_PRIORITY_BULK         SDMMC and its DMA, CRC feed, DMA2D
+ *   8  IRQ_PRIORITY_WAKE         LPTIM1 duty-cycle wake-up
+ *  15  IRQ_PRIORITY_TICK         SysTick (HAL tick, FreeRTOS tick)
+ *
+ * The rules behind it:
+ *   - nothing may hold off the ADC DMA for a whole half buffer, so it and
+ *     the watchdogs sit alone at the top (the interlock then puts the DMA
+ *     one level down, see interlock.h);
+ *   - the timebase and the sync discipline read capture registers against
+ *     TIM5 and only tolerate the acquisition above them;
+ *   - comms at 5 and below may call FreeRTOS from ISR functions
+ *     (configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY), and telemetry masks
+ *     them with BASEPRI to queue a packet;
+ *   - storage and memory-to-memory DMA only need to finish before the next
+ *     block, so they yield to everything else.
+ *
+ * irqPriority_apply() sets the vectors the CubeMX code initialises
+ * (MX_DMA_Init(), HAL_ADC_MspInit(), HAL_UART_MspInit()) to the plan, so a
+ * regenerated .ioc cannot drift from it. The module init functions set
+ * their own vectors. isr_budget.h measures how long each handler runs.
+ *
+ * FP context. The image is built for the hard-float ABI, so the thread
+ * code usually has FP state live (CONTROL.FPCA) when an interrupt comes.
+ * The FPU then stacks S0-S15 and FPSCR as well, 18 more words on the 8 of
+ * the basic frame. With automatic and lazy preservation (FPCCR ASPEN and
+ * LSPEN, the reset values, which irqPriority_apply() sets explicitly) the
+ * entry only reserves the space. The registers are written when the handler
+ * executes its first FP instruction, and never for a handler that has
+ * none. The reaction paths are therefore kept FPU-free, and
+ * cmake/fpu_free.cmake checks the linked image for it:
+ *   - interlock_irqHandler() and everything it calls (trigger reaction);
+ *   - the dispatch code of ADC_IRQHandler(), DMA2_Stream0_IRQHandler() and
+ *     analogSensor_dmaIrqFast(). The block stages they hand off to may use
+ *     the FPU, after the hand-off.
+ * The bench image measures the entry in each case (BENCH irq_entry).
+ *
+ * Usage Example:
+ *   MX_DMA_Init();
+ *   MX_ADC1_Init();
+ *   MX_USART3_UART_Init();
+ *   irqPriority_apply();
+ ******************************************************************************
+ */
+
+#ifndef IRQ_PRIORITY_H
+#define IRQ_PRIORITY_H
+
+#include "stm32f7xx_hal.h"
+
+/* Exported constants --------------------------------------------------------*/
+
+#define IRQ_PRIORITY_ACQUISITION 0U ///< ADC DMA and ADC watchdogs
+#define IRQ_PRIORITY_TIMER 1U       ///< Timebase, sync, SPI ADC DMA
+#define IRQ_PRIORITY_CAPTURE 2U     ///< Tach capture
+#define IRQ_PRIORITY_COMMS 5U       ///< Host link and RTOS notify
+#define IRQ_PRIORITY_USB 6U         ///< USB stream
+#define IRQ_PRIORITY_BULK 7U        ///< SD, CRC feed, DMA2D
+#define IRQ_PRIORITY_WAKE 8U        ///< Duty-cycle wake-up
+#define IRQ_PRIORITY_TICK 15U       ///< SysTick, lowest
+
+_Static_assert(IRQ_PRIORITY_ACQUISITION < IRQ_PRIORITY_TIMER &&
+                   IRQ_PRIORITY_TIMER < IRQ_PRIORITY_CAPTURE &&
+                   IRQ_PRIORITY_CAPTURE < IRQ_PRIORITY_COMMS &&
+                   IRQ_PRIORITY_COMMS < IRQ_PRIORITY_USB &&
+                   IRQ_PRIORITY_USB < IRQ_PRIORITY_BULK &&
+                   IRQ_PRIORITY_BULK < IRQ_PRIORITY_WAKE &&
+                   IRQ_PRIORITY_WAKE < IRQ_PRIORITY_TICK,
+               "the priority tiers must stay in order");
+_Static_assert(IRQ_PRIORITY_TICK < (1U << __NVIC_PRIO_BITS),
+               "the tiers must fit the NVIC priority bits");
+_Static_assert(TICK_INT_PRIORITY == IRQ_PRIORITY_TICK,
+               "SysTick must be the lowest priority");
+
+/**
+ * @brief Set to 0 to stack the FP registers at every exception entry taken
+ *        with FP context (FPCCR.LSPEN off), e.g. to measure the difference
+ */
+#ifndef IRQ_FPU_LAZY_STACKING
+#define IRQ_FPU_LAZY_STACKING 1
+#endif
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief Choose how exceptions preserve the FP context
+ *
+ * @param lazy 1 = reserve the extended frame and write it only at the
+ *             handler's first FP instruction, 0 = write it at entry
+ *
+ * @note Automatic preservation (ASPEN) always stays on: without it an FP
+ *       handler would corrupt the interrupted code's registers
+ */
+static inline void irqPriority_setFpuStacking(uint8_t lazy) {
+  uint32_t fpccr = FPU->FPCCR | FPU_FPCCR_ASPEN_Msk;
+  if (lazy) {
+    fpccr |= FPU_FPCCR_LSPEN_Msk;
+  } else {
+    fpccr &= ~FPU_FPCCR_LSPEN_Msk;
+  }
+  FPU->FPCCR = fpccr;
+  __DSB();
+  __ISB();
+}
+
+/**
+ * @brief Put the CubeMX-initialised vectors on the plan, and the FP context
+ *        policy
+ *
+ * @note Call after the MX_xxx_Init() functions, before the module inits
+ *       that may change them (interlock_init())
+ */
+static inline void irqPriority_apply(void) {
+  HAL_NVIC_SetPriority(DMA2_Stream0_IRQn, IRQ_PRIORITY_ACQUISITION, 0);
+  HAL_NVIC_SetPriority(ADC_IRQn, IRQ_PRIORITY_ACQUISITION, 0);
+  HAL_NVIC_SetPriority(USART3_IRQn, IRQ_PRIORITY_COMMS, 0);
+  HAL_NVIC_SetPriority(DMA1_Stream3_IRQn, IRQ_PRIORITY_COMMS, 0);
+  HAL_NVIC_SetPriority(SysTick_IRQn, IRQ_PRIORITY_TICK, 0);
+  irqPriority_setFpuStacking(IRQ_FPU_LAZY_STACKING);
+}
+
+#endif /* IRQ_PRIORITY_H */
@@ -0,0 +1,223 @@
+/**
+ ******************************************************************************
+ * @file    isr_budget.h
+ * @brief   Per-handler DWT cycle budgets with exceedance counters
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * Every handler in stm32f7xx_it.c is bracketed by isrBudget_begin() and
+ * isrBudget_end(). The measured time is the handler's own: the cycles of
+ * any higher-priority handler that pre-empted it are subtracted, so a slow
+ * USB interrupt shows up against the USB budget and not against the
+ * telemetry DMA it interrupted. Exception entry and exit (12 + ~10 cycles)
+ * are not included.
+ *
+ * Each handler has a budget in ns, turned into cycles at the current HCLK
+ * by isrBudget_init(). A run over it increments the handler's exceedance
+ * counter; nothing else happens, the counters are for tuning the priority
+ * plan (irq_priority.h) and spotting a handler that has grown. A budget of
+ * 0 only counts.
+ *
+ * Cost: two CYCCNT reads and two short PRIMASK sections per interrupt,
+ * about 25 cycles. Define ISR_BUDGET_ENABLE to 0 to compile it out.
+ *
+ * Usage Example:
+ *   isrBudget_init();                        // after profiler_init()
+ *   isrBudget_setBudgetNs(ISR_BUDGET_ADC_DMA, 500000U);
+ *
+ *   void TIM5_IRQHandler(void) {
+ *     const IsrBudget_Mark_t mark = isrBudget_begin();
+ *     timebase_irqHandler();
+ *     isrBudget_end(ISR_BUDGET_TIM5, mark);
+ *   }
+ *
+ *   isrBudget_dump();         // one telemetry line per handler that ran
+ *   isrBudget_poll();         // from the main loop
+ *
+ * @note Each handler updates only its own entry; the nesting total is the
+ *       one shared word.
+ ******************************************************************************
+ */
+
+#ifndef ISR_BUDGET_H
+#define ISR_BUDGET_H
+
+#include "stm32f7xx_hal.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+
+/**
+ * @brief Set to 0 to compile the handler brackets out
+ */
+#ifndef ISR_BUDGET_ENABLE
+#define ISR_BUDGET_ENABLE 1
+#endif
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief Measured handlers (one per vector)
+ */
+typedef enum {
+  ISR_BUDGET_ADC_DMA = 0, ///< DMA2 Stream0: ADC blocks, block callbacks
+  ISR_BUDGET_ADC,         ///< ADC watchdogs, interlock, capture trigger
+  ISR_BUDGET_TIM2,        ///< Sync discipline
+  ISR_BUDGET_TIM5,        ///< Timebase wraps
+  ISR_BUDGET_TIM3,        ///< Tach capture
+  ISR_BUDGET_EXT_DMA,     ///< DMA2 Stream3: SPI ADC results
+  ISR_BUDGET_USART3,      ///< Host link UART
+  ISR_BUDGET_UART_TX,     ///< DMA1 Stream3: telemetry TX
+  ISR_BUDGET_UART_RX,     ///< DMA1 Stream1: host command RX
+  ISR_BUDGET_I2C,         ///< I2C1 events and errors: I2C target
+  ISR_BUDGET_I2C_DMA,     ///< DMA1 Stream7: I2C target reads
+  ISR_BUDGET_CAN,         ///< CAN1 TX, RX0 and SCE: feature broadcast
+  ISR_BUDGET_MODBUS,      ///< USART2: Modbus requests and replies
+  ISR_BUDGET_TDMA,        ///< UART8: TDMA bus frames
+  ISR_BUDGET_TDMA_SLOT,   ///< TIM9: TDMA bus cycle and slot starts
+  ISR_BUDGET_USB,         ///< OTG FS
+  ISR_BUDGET_SDMMC,       ///< SD card
+  ISR_BUDGET_SD_DMA,      ///< DMA2 Stream6: SD card transfers
+  ISR_BUDGET_CRC_DMA,     ///< DMA2 Stream7: CRC unit feed
+  ISR_BUDGET_DMA2D,       ///< Block transpose
+  ISR_BUDGET_LPTIM,       ///< Duty-cycle wake-up
+  ISR_BUDGET_RTOS_NOTIFY, ///< Block notification of the RTOS build
+  ISR_BUDGET_SYSTICK,     ///< HAL and RTOS tick
+  ISR_BUDGET_COUNT
+} IsrBudget_Id_t;
+
+/**
+ * @brief Start of a measurement, from isrBudget_begin()
+ */
+typedef struct {
+  uint32_t start;  ///< CYCCNT at entry
+  uint32_t nested; ///< Nesting total at entry
+} IsrBudget_Mark_t;
+
+/**
+ * @brief Accumulated statistics of one handler (CPU cycles, own time)
+ */
+typedef struct {
+  uint32_t count;    ///< Runs
+  uint32_t max;      ///< Longest run
+  uint64_t total;    ///< Sum of all runs, mean = total / count
+  uint32_t budget;   ///< Budget in cycles (0 = none)
+  uint32_t exceeded; ///< Runs over the budget
+} IsrBudget_Stats_t;
+
+/* Exported variables --------------------------------------------------------*/
+
+/* Cycles of every completed measured handler, for the nesting correction */
+extern volatile uint32_t isrBudget_nested;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief Enable the DWT cycle counter, load the default budgets at the
+ *        current HCLK and clear the counters
+ *
+ * @note Call again after a clock change to rescale the budgets; that drops
+ *       any isrBudget_setBudgetNs() override
+ */
+void isrBudget_init(void);
+
+/**
+ * @brief Start measuring a handler
+ *
+ * @return IsrBudget_Mark_t Mark to pass to isrBudget_end()
+ */
+static inline IsrBudget_Mark_t isrBudget_begin(void) {
+  IsrBudget_Mark_t mark = {0, 0};
+#if ISR_BUDGET_ENABLE
+  // Both reads on the same side of any pre-emption
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  mark.start = DWT->CYCCNT;
+  mark.nested = isrBudget_nested;
+  __set_PRIMASK(primask);
+#endif
+  return mark;
+}
+
+/**
+ * @brief Record a handler's run (from its end)
+ *
+ * @param id   Handler
+ * @param mark Value returned by isrBudget_begin()
+ */
+void isrBudget_record(IsrBudget_Id_t id, IsrBudget_Mark_t mark);
+
+/**
+ * @brief Finish measuring a handler started with isrBudget_begin()
+ *
+ * @param id   Handler
+ * @param mark Value returned by isrBudget_begin()
+ */
+static inline void isrBudget_end(IsrBudget_Id_t id, IsrBudget_Mark_t mark) {
+#if ISR_BUDGET_ENABLE
+  isrBudget_record(id, mark);
+#else
+  (void)id;
+  (void)mark;
+#endif
+}
+
+/**
+ * @brief Set one handler's budget
+ *
+ * @param id Handler
+ * @param ns Budget in ns at the current HCLK (0 = count only)
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR Invalid handler
+ */
+HAL_StatusTypeDef isrBudget_setBudgetNs(IsrBudget_Id_t id, uint32_t ns);
+
+/**
+ * @brief Copy the statistics of one handler
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR Invalid handler or NULL pointer
+ */
+HAL_StatusTypeDef isrBudget_getStats(IsrBudget_Id_t id,
+                                     IsrBudget_Stats_t *stats);
+
+/**
+ * @brief Runs over budget, all handlers
+ */
+uint32_t isrBudget_getExceeded(void);
+
+/**
+ * @brief Clear the counters; the budgets stay
+ */
+void isrBudget_reset(void);
+
+/**
+ * @brief Request one report line per handler that has run (count, max,
+ *        mean, budget in cycles, exceedances)
+ *
+ * Lines are handed to the telemetry queue by isrBudget_poll() as slots
+ * free up, so a dump never blocks the caller.
+ */
+void isrBudget_dump(void);
+
+/**
+ * @brief Queue pending dump lines while telemetry slots are free
+ *
+ * @note Call from the main loop
+ */
+void isrBudget_poll(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ISR_BUDGET_H */
@@ -0,0 +1,152 @@
+/**
+ ******************************************************************************
+ * @file    latency_hist.h
+ * @brief   Log-bucketed latency histograms of the end-to-end paths, with
+ *          p50 / p99 / p99.9
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * The DWT probes (dwt_profiler.h) keep min / max / mean per stage, which
+ * says nothing about the tail, and they time stages, not what the system
+ * is asked to guarantee. Here each path from a cause to its effect has a
+ * histogram of its latency in ns:
+ *
+ *   dma_consumer    block stamp (DMA complete) -> App_ProcessBlock() entry,
+ *                   in the DMA interrupt or the DSP task (RTOS build)
+ *   trigger_output  TIM2 scan trigger -> interlock pin write, per trip
+ *                   (interlock.h, TIM2-paced scan only)
+ *   block_tx        conversion of a samples packet's newest frame (the
+ *                   block stamp, when it ends its block) -> TX complete
+ *
+ * Buckets are HDR style: values below 2^SUB_BITS have a bucket each, and
+ * every octave above is split into 2^SUB_BITS linear sub-buckets, so each
+ * bucket is at most 1 / 2^SUB_BITS of its value wide (12.5 % at 3 bits)
+ * from 1 ns to 4.29 s. The index is the octave from __CLZ() and the next
+ * SUB_BITS bits below the leading one: a count, a shift and a mask, no
+ * division and no loop. A percentile is read as the upper edge of the
+ * bucket it falls in, capped at the exact max, so it is never
+ * under-reported.
+ *
+ * Usage Example:
+ *   latencyHist_record(LATENCY_HIST_TRIGGER_OUTPUT, ns);
+ *   latencyHist_recordTicks(LATENCY_HIST_DMA_CONSUMER,
+ *                           timebase_now() - arrival);
+ *
+ *   latencyHist_dump();       // one telemetry line per path
+ *   latencyHist_poll();       // from the main loop
+ *
+ *   LAT dma_consumer   n=48211 p50=6143 p99=11263 p999=14820 max=14820 ns
+ *
+ * @note A path must be updated from a single context, like a DWT probe;
+ *       different paths may be updated from different contexts.
+ ******************************************************************************
+ */
+
+#ifndef LATENCY_HIST_H
+#define LATENCY_HIST_H
+
+#include "stm32f7xx_hal.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+
+/**
+ * @brief Set to 0 to compile the recording out
+ */
+#ifndef LATENCY_HIST_ENABLE
+#define LATENCY_HIST_ENABLE 1
+#endif
+
+/**
+ * @brief Sub-buckets per octave, as a power of two (1..6)
+ */
+#ifndef LATENCY_HIST_SUB_BITS
+#define LATENCY_HIST_SUB_BITS 3U
+#endif
+
+/**
+ * @brief Buckets per path: 2^SUB_BITS per octave from 2^SUB_BITS to 2^32,
+ *        plus the exact ones below
+ */
+#define LATENCY_HIST_BUCKETS                                                 \
+  ((33U - LATENCY_HIST_SUB_BITS) << LATENCY_HIST_SUB_BITS)
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief Measured paths
+ */
+typedef enum {
+  LATENCY_HIST_DMA_CONSUMER = 0, ///< DMA complete -> block consumer start
+  LATENCY_HIST_TRIGGER_OUTPUT,   ///< Scan trigger -> interlock pin
+  LATENCY_HIST_BLOCK_TX,         ///< Block ready -> samples packet sent
+  LATENCY_HIST_PATH_COUNT
+} LatencyHist_Path_t;
+
+/**
+ * @brief Percentiles of one path (ns, bucket upper edges)
+ */
+typedef struct {
+  uint32_t count; ///< Measurements
+  uint32_t p50;   ///< Median
+  uint32_t p99;   ///< 99th percentile
+  uint32_t p999;  ///< 99.9th percentile (the SLA figure)
+  uint32_t max;   ///< Longest measurement, exact
+} LatencyHist_Summary_t;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief Count one latency
+ *
+ * @param path Path to update
+ * @param ns   Latency in ns
+ */
+void latencyHist_record(LatencyHist_Path_t path, uint32_t ns);
+
+/**
+ * @brief Count one latency in timebase ticks (timebase.h), saturated at
+ *        UINT32_MAX ns
+ */
+void latencyHist_recordTicks(LatencyHist_Path_t path, uint64_t ticks);
+
+/**
+ * @brief Percentiles of one path
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success (all zero before the first measurement)
+ *   @retval HAL_ERROR Invalid path or NULL pointer
+ */
+HAL_StatusTypeDef latencyHist_getSummary(LatencyHist_Path_t path,
+                                         LatencyHist_Summary_t *summary);
+
+/**
+ * @brief Clear every path
+ *
+ * @note A measurement racing the reset may survive it
+ */
+void latencyHist_reset(void);
+
+/**
+ * @brief Request one report line per path (count, p50, p99, p99.9, max)
+ */
+void latencyHist_dump(void);
+
+/**
+ * @brief Queue pending dump lines while telemetry slots are free
+ *
+ * @note Call from the main loop
+ */
+void latencyHist_poll(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LATENCY_HIST_H */
@@ -0,0 +1,258 @@
+/**
+ ******************************************************************************
+ * @file    low_power.h
+ * @brief   Duty-cycled acquisition: STOP mode between LPTIM-paced bursts
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * For battery nodes that need a burst of frames every second or so rather
+ * than a continuous stream. LPTIM1 runs from LSE (or LSI) through STOP mode
+ * and wakes the core every period over EXTI line 23. Each cycle:
+ *
+ *   1. lowPower_sleep(): drain the telemetry queue, STOP mode with the
+ *      low-power regulator and flash power-down, wake on LPTIM1, then
+ *      clockProfile_resume() brings the PLL back (ADC registers, prescaler
+ *      and bus dividers survive STOP, so nothing else is re-initialised)
+ *   2. lowPower_burst(): TIM2-paced DMA scan for the configured frames,
+ *      blocks handed to the application callback as in streaming mode,
+ *      WFI between the DMA halves
+ *   3. process / send, then back to 1
+ *
+ * Sensor power gating: the LIS344ALH outputs draw their full supply current
+ * between bursts unless their PD input is high. With LOW_POWER_SENSOR_GATING
+ * the SENSOR_PD pin (PG3, gpio.c) powers both sensors down at the end of
+ * each burst and up again a lead time before the next wake-up, on an LPTIM1
+ * compare match that briefly wakes the core and puts it back in STOP. The
+ * outputs then settle while the core sleeps.
+ *
+ * Settle time is measured on every burst against the settle profile: the
+ * burst is cut into windows of window_frames, and the sensors count as
+ * settled from the first of two consecutive windows whose means agree to
+ * tolerance_codes on every channel (at least min_frames, at most
+ * max_frames in). Frames before that are discarded: not handed to block_cb
+ * and not in lowPower_getBurstStats(), and the burst runs on until
+ * burst_frames settled frames are in. When frames had to be discarded, the
+ * time from power-up to the first settled frame is exact, and the lead
+ * grows to it plus margin_us, so from the next burst the first sample is
+ * already valid and no block is added. The lead never shrinks (a cold
+ * sensor settles slower); lowPower_init() starts it again from the profile.
+ *
+ * Wake-to-first-sample latency is timed twice: on the LPTIM counter from
+ * the wake event to the first DMA transfer (includes the regulator and
+ * flash wake-up, one LPTIM tick resolution), and on DWT from the first
+ * instruction after STOP to the PLL running again (software part only).
+ * The first sample includes one TIM2 period: the timer paces from its
+ * first update, not from the start.
+ *
+ * Current budget at a 1 Hz, 256-frame/4 kHz burst: ~70 ms awake at
+ * tens of mA, the rest in STOP at a few hundred uA; the awake share is
+ * what lowPower_getStats() reports as the duty.
+ *
+ * Usage Example:
+ *   LowPower_Config_t cfg = {.period_ms = 1000, .burst_frames = 256,
+ *                            .frame_rate_hz = 4000,
+ *                            .settle = {.min_frames = 0,
+ *                                       .max_frames = 1024,
+ *                                       .window_frames = 16,
+ *                                       .tolerance_codes = 8,
+ *                                       .lead_us = 0,
+ *                                       .margin_us = 500},
+ *                            .block_cb = App_BlockReady, .ctx = NULL};
+ *   lowPower_init(&cfg);
+ *   while (1) {
+ *     lowPower_burst();   // blocking, WFI between blocks
+ *     send_results();
+ *     lowPower_sleep();   // STOP until the next period
+ *   }
+ *
+ * @note HAL_GetTick() is advanced by the time spent in STOP. The TIM5
+ *       timebase and the DWT counter stop with the clocks, so block
+ *       timestamps only order frames within a burst.
+ * @note USB, Ethernet and the SD card lose their sessions in STOP; leave
+ *       them unstarted on a duty-cycled node.
+ ******************************************************************************
+ */
+
+#ifndef LOW_POWER_H
+#define LOW_POWER_H
+
+#include "adc_conversions.h"
+#include "irq_priority.h"
+#include "stm32f7xx_hal.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+
+/**
+ * @brief Set to 1 to build main.c as a duty-cycled node (bursts + STOP)
+ *        instead of the continuous stream
+ */
+#ifndef LOW_POWER_DUTY_CYCLE
+#define LOW_POWER_DUTY_CYCLE 0
+#endif
+
+/**
+ * @brief LPTIM1 kernel clock: 1 = LSE 32.768 kHz crystal (X2 on the
+ *        Nucleo-144), 0 = LSI (~32 kHz, +-50 % over temperature)
+ */
+#ifndef LOW_POWER_USE_LSE
+#define LOW_POWER_USE_LSE 1
+#endif
+
+/**
+ * @brief LPTIM1 wake-up interrupt priority (lowest in the system)
+ */
+#ifndef LOW_POWER_IRQ_PRIORITY
+#define LOW_POWER_IRQ_PRIORITY IRQ_PRIORITY_WAKE
+#endif
+
+/**
+ * @brief Longest wait for the telemetry queue before STOP
+ */
+#ifndef LOW_POWER_DRAIN_TIMEOUT_MS
+#define LOW_POWER_DRAIN_TIMEOUT_MS 100U
+#endif
+
+/**
+ * @brief Set to 1 to power the sensors down between bursts on SENSOR_PD
+ */
+#ifndef LOW_POWER_SENSOR_GATING
+#define LOW_POWER_SENSOR_GATING 1
+#endif
+
+/**
+ * @brief SENSOR_PD level that powers the sensors down (LIS344ALH: high)
+ */
+#ifndef LOW_POWER_SENSOR_PD_ACTIVE
+#define LOW_POWER_SENSOR_PD_ACTIVE GPIO_PIN_SET
+#endif
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief How the sensor settling after power-up is judged and compensated
+ *
+ * A window_frames of 0 turns the measurement off: every frame is valid.
+ */
+typedef struct {
+  uint32_t min_frames;      ///< Frames always discarded
+  uint32_t max_frames;      ///< Settled by force past these
+  uint32_t window_frames;   ///< Frames per mean compared
+  uint16_t tolerance_codes; ///< Largest change between two window means
+  uint32_t lead_us;         ///< Initial power-up lead before the wake-up
+  uint32_t margin_us;       ///< Added to a measured settle time
+} LowPower_SettleProfile_t;
+
+/**
+ * @brief Duty cycle
+ */
+typedef struct {
+  uint32_t period_ms;              ///< Wake-up period, 1..256000 ms
+  uint32_t burst_frames;           ///< Settled frames, rounded up to blocks
+  uint32_t frame_rate_hz;          ///< Burst frame rate (TIM2)
+  LowPower_SettleProfile_t settle; ///< Sensor settling
+  ADC_BlockCallback_t block_cb;    ///< Block processing (ISR), may be NULL
+  void *ctx;                       ///< Passed to block_cb
+} LowPower_Config_t;
+
+/**
+ * @brief Duty-cycle statistics
+ */
+typedef struct {
+  uint32_t bursts;         ///< Completed bursts
+  uint32_t wake_us;        ///< Last wake event -> first sample (LPTIM)
+  uint32_t wake_max_us;    ///< Longest of these
+  uint32_t wake_mean_us;   ///< Mean of these
+  uint32_t resume_us;      ///< Last first instruction -> PLL running (DWT)
+  uint32_t duty_centi_pct; ///< Awake share of all periods, 0.01 %
+  uint32_t overruns;       ///< Periods whose work outlasted the period
+  uint32_t errors;         ///< Failed clock resumes or bursts
+  uint32_t discarded;      ///< Unsettled frames of the last burst
+  uint32_t settle_us;      ///< Last measured power-up -> settled frame
+  uint32_t lead_us;        ///< Power-up lead now applied
+  uint32_t settle_forced;  ///< Bursts that reached max_frames unsettled
+} LowPower_Stats_t;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief Start LPTIM1 from LSE/LSI at the period and enable its wake-up
+ *
+ * @param cfg Duty cycle; copied
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Running, first wake-up one period from now
+ *   @retval HAL_ERROR NULL/zero config, period out of range, a settle
+ *                     window above max_frames, or the LSE / LPTIM1 did
+ *                     not start
+ *
+ * @note Call after clockProfile_apply() and the ADC set-up
+ */
+HAL_StatusTypeDef lowPower_init(const LowPower_Config_t *cfg);
+
+/**
+ * @brief Acquire one burst by DMA, blocking
+ *
+ * Powers the sensors up first if the lead did not, and down at the end.
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK      burst_frames settled frames (rounded up to blocks)
+ *                       delivered
+ *   @retval HAL_ERROR   Not initialised or the DMA did not start
+ *   @retval HAL_TIMEOUT Fewer settled frames than expected within twice
+ *                       the burst time, max_frames included
+ */
+HAL_StatusTypeDef lowPower_burst(void);
+
+/**
+ * @brief Drain the telemetry queue, then STOP until the next LPTIM wake-up
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Woken by LPTIM1 with the profile clocks back
+ *   @retval HAL_BUSY  The period had already elapsed (overrun); not stopped
+ *   @retval HAL_ERROR Not initialised or the PLL did not come back (the
+ *                     core then runs on HSI)
+ */
+HAL_StatusTypeDef lowPower_sleep(void);
+
+/**
+ * @brief Copy the statistics
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    stats filled
+ *   @retval HAL_ERROR stats is NULL
+ */
+HAL_StatusTypeDef lowPower_getStats(LowPower_Stats_t *stats);
+
+/**
+ * @brief Statistics of the settled frames of the last burst
+ *
+ * @param stats ADC_CONVERSIONS_CHANNEL_COUNT entries, in channel order
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    stats filled
+ *   @retval HAL_ERROR stats is NULL
+ */
+HAL_StatusTypeDef lowPower_getBurstStats(ADC_ChannelStats_t *stats);
+
+/**
+ * @brief Queue an "LPWR ..." text line with the statistics on USART3
+ */
+void lowPower_report(void);
+
+/**
+ * @brief LPTIM1 interrupt; call from LPTIM1_IRQHandler()
+ */
+void lowPower_irqHandler(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LOW_POWER_H */
@@ -57,6 +57,8 @@ void Error_Handler(void);
 /* USER CODE END EFP */
 
 /* Private defines -----------------------------------------------------------*/
+#define SENSOR_PD_Pin GPIO_PIN_3
+#define SENSOR_PD_GPIO_Port GPIOG
 
 /* USER CODE BEGIN Private defines */
 
@@ -0,0 +1,172 @@
+/**
+ ******************************************************************************
+ * @file    mem_budget.h
+ * @brief   Static memory budget: RAM use per bank from the link, the painted
+ *          main stack's high-water mark and the heap seal
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * Every buffer of the firmware is a static array placed by the linker
+ * script: the pipeline, the block pool, the telemetry slots, the RTOS task
+ * stacks and queues (configSUPPORT_DYNAMIC_ALLOCATION is 0). There is no
+ * heap in use, so nothing fragments on a node that runs for months and the
+ * map file is the whole RAM budget. This module reads it back at run time
+ * from the linker symbols, one line per bank:
+ *
+ *   data      .data + .bss (DTCM: ADC_FAST_DATA/BSS, ITCM: the fast code)
+ *   dma       .sram1_bss / .sram2_bss (ADC_SRAM1_BSS, ADC_SRAM2_BSS)
+ *   reserved  the main stack (DTCM), the heap reservation (SRAM1)
+ *   free      what nothing owns: the burst recorder's regions
+ *
+ * The startup code fills the main stack, _sstack to _estack
+ * (_Min_Stack_Size, the interrupts' stack with the RTOS), with
+ * MEM_BUDGET_STACK_PAINT before anything runs on it.
+ * memBudget_getStack() scans up from _sstack for the first word changed:
+ * the deepest the stack has been. A changed bottom word means it has
+ * reached (or passed) the reservation.
+ *
+ * newlib's malloc() grows its heap through _sbrk() (sysmem.c), only within
+ * the link's _Min_Heap_Size (0). Once init is done, memBudget_seal() makes
+ * any further growth a bug: with MEM_BUDGET_HEAP_TRAP it halts in
+ * Error_Handler() (the retained breadcrumb points at _sbrk(), the debugger
+ * at the caller), otherwise it fails with ENOMEM and is counted. libc calls
+ * that allocate (strtof(), printf("%f"), stdio on a FILE) are kept out of
+ * the firmware for that reason.
+ *
+ * Usage Example:
+ *   // end of init, before the main loop or appRtos_start()
+ *   memBudget_seal();
+ *
+ *   MemBudget_Bank_t bank;
+ *   memBudget_getBank(MEM_BUDGET_BANK_SRAM1, &bank);
+ *   MemBudget_Stack_t stack;
+ *   memBudget_getStack(&stack);   // stack.used: high-water mark in bytes
+ *
+ * @note The paint pattern is repeated in startup_stm32f746xx.s.
+ ******************************************************************************
+ */
+
+#ifndef MEM_BUDGET_H
+#define MEM_BUDGET_H
+
+#include "stm32f7xx_hal.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+
+/**
+ * @brief Word the startup code paints the main stack with
+ */
+#define MEM_BUDGET_STACK_PAINT 0xA5A5A5A5U
+
+/**
+ * @brief Set to 0 to refuse heap growth after memBudget_seal() (ENOMEM,
+ *        counted) instead of halting
+ */
+#ifndef MEM_BUDGET_HEAP_TRAP
+#define MEM_BUDGET_HEAP_TRAP 1
+#endif
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief RAM banks of the linker script
+ */
+typedef enum {
+  MEM_BUDGET_BANK_DTCM = 0,
+  MEM_BUDGET_BANK_ITCM,
+  MEM_BUDGET_BANK_SRAM1,
+  MEM_BUDGET_BANK_SRAM2,
+  MEM_BUDGET_BANK_COUNT
+} MemBudget_BankId_t;
+
+/**
+ * @brief Use of one bank, bytes
+ */
+typedef struct {
+  const char *name;  ///< "dtcm", "itcm", "sram1", "sram2"
+  uint32_t base;     ///< First address
+  uint32_t size;     ///< Bank size
+  uint32_t data;     ///< Initialised, zeroed and kept data (ITCM: code)
+  uint32_t dma;      ///< DMA buffer section
+  uint32_t reserved; ///< Main stack or heap reservation
+  uint32_t free;     ///< Owned by nothing
+} MemBudget_Bank_t;
+
+/**
+ * @brief Main stack, bytes
+ */
+typedef struct {
+  uint32_t size;     ///< _Min_Stack_Size
+  uint32_t used;     ///< High-water mark since reset
+  uint8_t overflow;  ///< The bottom word has been written
+} MemBudget_Stack_t;
+
+/**
+ * @brief Heap, bytes
+ */
+typedef struct {
+  uint32_t reserved; ///< _Min_Heap_Size
+  uint32_t used;     ///< Break above _end
+  uint8_t sealed;    ///< memBudget_seal() called
+  uint32_t refused;  ///< Growth requests after the seal (without the trap)
+} MemBudget_Heap_t;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief Use of a bank, from the linker symbols
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer or bad bank
+ */
+HAL_StatusTypeDef memBudget_getBank(MemBudget_BankId_t id,
+                                    MemBudget_Bank_t *bank);
+
+/**
+ * @brief High-water mark of the main stack (a scan of up to
+ *        _Min_Stack_Size / 4 words)
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer
+ */
+HAL_StatusTypeDef memBudget_getStack(MemBudget_Stack_t *stack);
+
+/**
+ * @brief Heap break and seal
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer
+ */
+HAL_StatusTypeDef memBudget_getHeap(MemBudget_Heap_t *heap);
+
+/**
+ * @brief End of init: from now on the heap must not grow
+ */
+void memBudget_seal(void);
+
+/**
+ * @brief Heap growth check, from _sbrk()
+ *
+ * @param incr Bytes requested
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Allowed (before the seal)
+ *   @retval HAL_ERROR Refused; does not return with MEM_BUDGET_HEAP_TRAP
+ */
+HAL_StatusTypeDef memBudget_onHeapGrowth(int32_t incr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MEM_BUDGET_H */
@@ -0,0 +1,178 @@
+/**
+ ******************************************************************************
+ * @file    modbus_rtu.h
+ * @brief   Modbus RTU request processing over a register map that points
+ *          into the application's own variables
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * The protocol half of the Modbus server, without hardware: it takes one
+ * received ADU (address, PDU, CRC) and builds the reply, so the sim bench
+ * runs the same code as the target. modbus_server.h carries the ADUs over
+ * RS-485.
+ *
+ * No register copy. A map is a table of regions, each a run of fields of
+ * one type in the application's memory, at a stride, so one region can
+ * walk one field of an array of structures:
+ *
+ *   {.address = 100, .type = MODBUS_RTU_F32, .count = 4,
+ *    .stride = sizeof(vibration[0]), .data = &vibration[0].result.rms}
+ *
+ * puts the RMS of the four spectra on registers 100..107. A read converts
+ * the fields from where they live while the reply is built; a write stores
+ * into them. 32-bit fields (U32, I32, F32) take two registers, high word
+ * first, and may be read from either half but only written whole.
+ *
+ * Function codes:
+ *   0x03 Read Holding Registers     0x06 Write Single Register
+ *   0x04 Read Input Registers       0x10 Write Multiple Registers
+ *
+ * Exceptions: 01 illegal function, 02 illegal data address (a register no
+ * region covers, or half a 32-bit field written), 03 illegal data value (a
+ * bad quantity, or a value outside the region's min..max). A write is
+ * checked in full before any field is stored, so a rejected one changes
+ * nothing. Requests to address 0 (broadcast) are executed, writes only,
+ * and never answered.
+ *
+ * Usage Example:
+ *   static const ModbusRtu_Region_t inputs[] = {
+ *       {.address = 0, .type = MODBUS_RTU_U32, .count = 1,
+ *        .data = (void *)&frames}};
+ *   static const ModbusRtu_Region_t holding[] = {
+ *       {.address = 0, .type = MODBUS_RTU_U8, .count = 1, .data = &mode,
+ *        .min = 0, .max = 2, .notify = 0x01U}};
+ *   static const ModbusRtu_Map_t map = {
+ *       .address = 17, .input = inputs, .input_count = 1,
+ *       .holding = holding, .holding_count = 1};
+ *
+ *   uint16_t len;
+ *   uint32_t written = 0;
+ *   if (modbusRtu_process(&map, adu, adu_len, reply, &len, &written) ==
+ *       MODBUS_RTU_REPLY) {
+ *     send(reply, len);
+ *   }
+ *
+ * @note Fields are read and written from the caller's context (the server's
+ *       USART interrupt); a field the main loop writes is read whole, but
+ *       one reply may mix fields of two updates of a structure.
+ ******************************************************************************
+ */
+
+#ifndef MODBUS_RTU_H
+#define MODBUS_RTU_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+
+#define MODBUS_RTU_ADU_MAX 256U   ///< Longest ADU (address, PDU, CRC)
+#define MODBUS_RTU_ADU_MIN 4U     ///< Address, function, CRC
+#define MODBUS_RTU_BROADCAST 0U   ///< Address every server executes
+#define MODBUS_RTU_READ_MAX 125U  ///< Registers per FC03/FC04
+#define MODBUS_RTU_WRITE_MAX 123U ///< Registers per FC16
+
+/**
+ * @brief Function codes
+ */
+#define MODBUS_RTU_FC_READ_HOLDING 0x03U
+#define MODBUS_RTU_FC_READ_INPUT 0x04U
+#define MODBUS_RTU_FC_WRITE_SINGLE 0x06U
+#define MODBUS_RTU_FC_WRITE_MULTIPLE 0x10U
+
+/**
+ * @brief Exception codes
+ */
+#define MODBUS_RTU_EX_FUNCTION 0x01U ///< Illegal function
+#define MODBUS_RTU_EX_ADDRESS 0x02U  ///< Illegal data address
+#define MODBUS_RTU_EX_VALUE 0x03U    ///< Illegal data value
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief Field types; 32-bit ones take two registers
+ */
+typedef enum {
+  MODBUS_RTU_U8 = 0, ///< uint8_t, one register
+  MODBUS_RTU_U16,    ///< uint16_t, one register
+  MODBUS_RTU_I16,    ///< int16_t, one register
+  MODBUS_RTU_U32,    ///< uint32_t, two registers
+  MODBUS_RTU_I32,    ///< int32_t, two registers
+  MODBUS_RTU_F32     ///< float, IEEE 754 bits, two registers
+} ModbusRtu_Type_t;
+
+/**
+ * @brief A run of fields of one type mapped to consecutive registers
+ *
+ * min/max bound the values a write may store (ignored for reads and input
+ * regions); for F32 they are compared as floats and NaN is refused.
+ */
+typedef struct {
+  uint16_t address; ///< First register
+  uint8_t type;     ///< ModbusRtu_Type_t
+  uint8_t count;    ///< Fields
+  uint8_t notify;   ///< Bits or-ed into written on a write, 0 = none
+  uint32_t stride;  ///< Bytes from one field to the next, 0 = packed
+  void *data;       ///< First field
+  int32_t min;      ///< Smallest value a write may store
+  int32_t max;      ///< Largest
+} ModbusRtu_Region_t;
+
+/**
+ * @brief A server's register map
+ */
+typedef struct {
+  uint8_t address;                   ///< Server address, 1..247
+  const ModbusRtu_Region_t *input;   ///< FC04 regions
+  uint8_t input_count;
+  const ModbusRtu_Region_t *holding; ///< FC03/FC06/FC16 regions
+  uint8_t holding_count;
+} ModbusRtu_Map_t;
+
+/**
+ * @brief What modbusRtu_process() made of an ADU
+ */
+typedef enum {
+  MODBUS_RTU_REPLY = 0, ///< Executed; resp holds the reply
+  MODBUS_RTU_EXCEPTION, ///< Refused; resp holds the exception reply
+  MODBUS_RTU_SILENT,    ///< Broadcast (or a refused one); no reply
+  MODBUS_RTU_OTHER,     ///< For another server address
+  MODBUS_RTU_BAD_FRAME  ///< Too short, too long or a CRC mismatch
+} ModbusRtu_Result_t;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief CRC-16/MODBUS (reflected 0x8005, initial 0xFFFF) of a buffer
+ *
+ * @return The CRC, sent low byte first
+ */
+uint16_t modbusRtu_crc16(const uint8_t *data, uint16_t len);
+
+/**
+ * @brief Execute one request ADU and build its reply
+ *
+ * @param map      Register map
+ * @param req      ADU as received, CRC included
+ * @param len      Its length
+ * @param resp     Reply ADU, MODBUS_RTU_ADU_MAX bytes
+ * @param resp_len Reply length (0 when there is none)
+ * @param written  Or-ed with the notify bits of each region written
+ *
+ * @return ModbusRtu_Result_t
+ */
+ModbusRtu_Result_t modbusRtu_process(const ModbusRtu_Map_t *map,
+                                     const uint8_t *req, uint16_t len,
+                                     uint8_t *resp, uint16_t *resp_len,
+                                     uint32_t *written);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MODBUS_RTU_H */
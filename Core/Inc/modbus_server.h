@@ -0,0 +1,182 @@
+/**
+ ******************************************************************************
+ * @file    modbus_server.h
+ * @brief   Modbus RTU server on USART2 over RS-485, framed by the receiver
+ *          timeout and moved by DMA both ways
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * Answers a PLC or SCADA client from the register map of modbus_rtu.h.
+ * USART2 drives an RS-485 transceiver, its DE pin switched by the USART
+ * itself around every reply:
+ *
+ *   PD5 TX  PD6 RX  PD4 DE  (AF7; DE high = transmit)
+ *
+ * Framing in hardware. RTU frames end with 3.5 character times of silence.
+ * The receiver timeout counts them from the last stop bit (RTOR: 39 bit
+ * times up to 19200 baud, the fixed 1750 us above, as the specification
+ * asks), so the CPU is not woken per byte nor polls a timer: DMA1 Stream5
+ * stores the bytes and the one RTOF interrupt of a frame takes its length
+ * from the stream counter. In that interrupt the request is checked and
+ * executed and the reply built straight into the TX buffer, then DMA1
+ * Stream6 sends it; the TC interrupt of its last stop bit re-arms the
+ * receiver. Parity, framing, noise and overrun errors mark the frame,
+ * which is then dropped unanswered, as is a frame longer than an ADU.
+ *
+ * Turnaround. DWT->CYCCNT is taken at the RTOF entry and again once the
+ * reply DMA is started (the turnaround, the CPU's whole share of the
+ * reply), and TC closes the reply time, the reply's own bytes included.
+ *
+ * Writes. Holding registers are stored in place from the interrupt; the
+ * notify bits of what was written are collected and handed to the write
+ * callback from modbusServer_poll() (main loop), so saving or applying a
+ * setting never runs in the interrupt.
+ *
+ * Usage Example:
+ *   modbusServer_init(&map);             // once, map in const memory
+ *   modbusServer_registerWriteCallback(App_ModbusWritten, NULL);
+ *
+ *   while (1) {
+ *     modbusServer_poll();               // hands over the written bits
+ *   }
+ *
+ * Concurrency model:
+ *   - RX, processing and TX run in the USART2 interrupt at
+ *     MODBUS_SERVER_IRQ_PRIORITY; the map's fields are read and written
+ *     there, so the main loop must only write them whole
+ *   - modbusServer_poll() and the callback run in the main loop
+ *
+ * @note USART2, DMA1 Stream5/Stream6 and PD4..PD6 are taken while
+ *       MODBUS_SERVER_ENABLE is set; Stream5 is the DAC loopback's too.
+ ******************************************************************************
+ */
+
+#ifndef MODBUS_SERVER_H
+#define MODBUS_SERVER_H
+
+#include "irq_priority.h"
+#include "modbus_rtu.h"
+#include "stm32f7xx_hal.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+
+/**
+ * @brief Set to 1 when the node is wired to an RS-485 transceiver
+ */
+#ifndef MODBUS_SERVER_ENABLE
+#define MODBUS_SERVER_ENABLE 0
+#endif
+
+/**
+ * @brief Server address on the line (1..247)
+ */
+#ifndef MODBUS_SERVER_ADDRESS
+#define MODBUS_SERVER_ADDRESS 17U
+#endif
+
+/**
+ * @brief Baud rate
+ */
+#ifndef MODBUS_SERVER_BAUD
+#define MODBUS_SERVER_BAUD 19200U
+#endif
+
+/**
+ * @brief Parity: UART_PARITY_EVEN (the Modbus default), _ODD or _NONE (the
+ *        latter then sends two stop bits, keeping 11 bits per character)
+ */
+#ifndef MODBUS_SERVER_PARITY
+#define MODBUS_SERVER_PARITY UART_PARITY_EVEN
+#endif
+
+/**
+ * @brief USART2 interrupt priority
+ */
+#ifndef MODBUS_SERVER_IRQ_PRIORITY
+#define MODBUS_SERVER_IRQ_PRIORITY IRQ_PRIORITY_COMMS
+#endif
+
+#if MODBUS_SERVER_ADDRESS < 1 || MODBUS_SERVER_ADDRESS > 247
+#error "MODBUS_SERVER_ADDRESS must be in 1..247"
+#endif
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief Counters since modbusServer_init()
+ */
+typedef struct {
+  uint32_t requests;     ///< Frames for this server or broadcast, CRC good
+  uint32_t replies;      ///< Normal replies sent
+  uint32_t exceptions;   ///< Exception replies sent
+  uint32_t broadcasts;   ///< Broadcasts executed (never answered)
+  uint32_t other;        ///< Good frames for other servers
+  uint32_t bad_frames;   ///< CRC mismatches, runts, frames over an ADU
+  uint32_t uart_errors;  ///< Frames dropped on a parity, framing, noise or
+                         ///< overrun error
+  uint32_t measured;     ///< Replies in the timing figures below
+  uint32_t turn_min_cyc; ///< RTOF entry to reply DMA started, CPU cycles
+  uint32_t turn_max_cyc;
+  uint64_t turn_sum_cyc;
+  uint32_t reply_max_us; ///< RTOF entry to the reply's last stop bit
+} ModbusServer_Stats_t;
+
+/**
+ * @brief Holding registers were written (main loop context)
+ *
+ * @param written Notify bits of the regions written since the last call
+ * @param ctx     User context
+ */
+typedef void (*ModbusServer_WriteCallback_t)(uint32_t written, void *ctx);
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief Set up USART2 for RS-485, its pins, DMA streams and receiver
+ *        timeout, then wait for the first request
+ *
+ * @param map Register map, kept by reference (map->address is the server's)
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Listening (or MODBUS_SERVER_ENABLE = 0)
+ *   @retval HAL_ERROR NULL map, or a HAL init failed
+ */
+HAL_StatusTypeDef modbusServer_init(const ModbusRtu_Map_t *map);
+
+/**
+ * @brief Hand the written bits to the write callback (main loop)
+ */
+void modbusServer_poll(void);
+
+/**
+ * @brief Register the write callback (NULL to remove)
+ */
+void modbusServer_registerWriteCallback(ModbusServer_WriteCallback_t callback,
+                                        void *ctx);
+
+/**
+ * @brief Get the counters
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer
+ */
+HAL_StatusTypeDef modbusServer_getStats(ModbusServer_Stats_t *stats);
+
+/**
+ * @brief USART2 interrupt (USART2_IRQHandler)
+ */
+void modbusServer_irqHandler(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MODBUS_SERVER_H */
@@ -0,0 +1,285 @@
+/**
+ ******************************************************************************
+ * @file    nn_anomaly.h
+ * @brief   Anomaly score per channel group from the window features, with
+ *          int8 CMSIS-NN inference
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * Scores each stats window (STATS_PERIOD_MS in the application) on the
+ * node, so a healthy machine costs the link one score packet instead of
+ * the feature records of every channel.
+ *
+ * Per channel of a group the input vector holds, in channel order:
+ *   RMS, peak-to-peak, crest, kurtosis       (telemetryFrame_statsFeatures)
+ *   band RMS and band kurtosis of the first NN_ANOMALY_BANDS spectrum bands
+ *                                           (nnAnomaly_setBands(), 0 when
+ *                                            the channel has no spectrum)
+ * Each input is normalised, z = (x - mean) * inv_std, and quantised to q7
+ * with input_frac_bits fraction bits (saturating: +-8 sigma at 4 bits,
+ * +-16 at the baseline's 3).
+ * The model is a chain of dense int8 layers (arm_fully_connected_q7() and
+ * arm_relu_q7() of CMSIS-NN, legacy q7 API), in one of two shapes:
+ *   - autoencoder: the last layer has as many outputs as inputs; the score
+ *     is the mean squared reconstruction error in z^2 units
+ *   - classifier:  the last layer has one output; the score is that
+ *     output, e.g. an anomaly logit
+ * A model without layers is the baseline: the score is the mean z^2 of the
+ * inputs, about 1 on data like the learning windows. Models are trained
+ * and quantised off-line; bias_shift and out_shift are the usual CMSIS-NN
+ * Q-format shifts of each layer.
+ *
+ * Normalisation comes from the model (mean and inv_std arrays) or, when
+ * the model has none, is learned on the node: Welford mean and standard
+ * deviation over learn_windows windows after nnAnomaly_init() or
+ * nnAnomaly_learn(). A constant input (a band of a channel without a
+ * spectrum) gets inv_std 0 and does not count; a standard deviation below
+ * NN_ANOMALY_STD_FLOOR of the mean is raised to it, so a very steady
+ * feature does not turn every small change into an alarm. The learned
+ * values are kept in RAM only.
+ *
+ * A score is due every cadence windows: the mean and the peak of the
+ * window scores since the last one, an alarm bit per group whose peak is
+ * above its threshold, and the longest inference. While learning, a score
+ * is still due at the cadence, with the windows left to learn and zero
+ * scores, so the host can tell a learning node from a silent one. The
+ * inference of each group is timed by PROFILER_PROBE_ANOMALY.
+ *
+ * Concurrency model: main loop only. nnAnomaly_setBands() may run in
+ * another task than nnAnomaly_addWindow(); a window then uses the newest
+ * band values, possibly one spectrum older for some channels.
+ *
+ * Usage Example:
+ *   const NnAnomaly_Config_t cfg = {
+ *       .group = {{.channel_mask = 0x07, .threshold = 4.0f},
+ *                 {.channel_mask = 0x38, .threshold = 4.0f}},
+ *       .group_count = 2, .cadence = 10, .learn_windows = 600};
+ *   nnAnomaly_init(&cfg);
+ *
+ *   // each spectrum result
+ *   nnAnomaly_setBands(ch, r.band_rms, r.band_kurtosis, r.band_count);
+ *
+ *   // each stats window
+ *   if (nnAnomaly_addWindow(&features) == HAL_OK) {
+ *     NnAnomaly_Result_t res;
+ *     nnAnomaly_getResult(&res);   // res.score_mean[g], res.alarm_mask
+ *   }
+ *
+ * @note RAM is about 300 bytes per group plus the layer scratch; the
+ *       models live in flash.
+ ******************************************************************************
+ */
+
+#ifndef NN_ANOMALY_H
+#define NN_ANOMALY_H
+
+#include "arm_math.h"
+#include "telemetry_frame.h"
+#include "stm32f7xx_hal.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+
+#define NN_ANOMALY_MAGIC 0x4C444D4EU ///< "NMDL"
+
+/**
+ * @brief Channel groups scored
+ */
+#ifndef NN_ANOMALY_MAX_GROUPS
+#define NN_ANOMALY_MAX_GROUPS 4U
+#endif
+
+/**
+ * @brief Channels per group
+ */
+#ifndef NN_ANOMALY_GROUP_CHANNELS
+#define NN_ANOMALY_GROUP_CHANNELS 3U
+#endif
+
+/**
+ * @brief Spectrum bands per channel in the input vector
+ */
+#ifndef NN_ANOMALY_BANDS
+#define NN_ANOMALY_BANDS 2U
+#endif
+
+/**
+ * @brief Dense layers per model, and units per layer (input included)
+ */
+#ifndef NN_ANOMALY_MAX_LAYERS
+#define NN_ANOMALY_MAX_LAYERS 4U
+#endif
+#ifndef NN_ANOMALY_MAX_UNITS
+#define NN_ANOMALY_MAX_UNITS 32U
+#endif
+
+/**
+ * @brief Smallest learned standard deviation, relative to the mean
+ */
+#ifndef NN_ANOMALY_STD_FLOOR
+#define NN_ANOMALY_STD_FLOOR 0.01f
+#endif
+
+/**
+ * @brief Inputs per channel, and per group at most
+ */
+#define NN_ANOMALY_CHANNEL_INPUTS (4U + 2U * NN_ANOMALY_BANDS)
+#define NN_ANOMALY_MAX_INPUTS                                                 \
+  (NN_ANOMALY_CHANNEL_INPUTS * NN_ANOMALY_GROUP_CHANNELS)
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief One dense layer: out = sat((W x + (bias << bias_shift)) >>
+ *        out_shift), then ReLU when relu is set
+ */
+typedef struct {
+  const q7_t *weights; ///< outputs x inputs, row by row
+  const q7_t *bias;    ///< outputs
+  uint16_t inputs;
+  uint16_t outputs;
+  uint8_t bias_shift;
+  uint8_t out_shift;
+  uint8_t relu;
+} NnAnomaly_Layer_t;
+
+/**
+ * @brief Quantised model in flash
+ */
+typedef struct {
+  uint32_t magic;           ///< NN_ANOMALY_MAGIC
+  uint16_t inputs;          ///< Vector length: channels x CHANNEL_INPUTS
+  uint8_t input_frac_bits;  ///< Fraction bits of the q7 input
+  uint8_t output_frac_bits; ///< Fraction bits of the last layer's output
+  const float32_t *mean;    ///< Per input; NULL = learned on the node
+  const float32_t *inv_std; ///< Per input, with mean
+  uint8_t layer_count;      ///< 0 = baseline, mean z^2
+  NnAnomaly_Layer_t layer[NN_ANOMALY_MAX_LAYERS];
+} NnAnomaly_Model_t;
+
+/**
+ * @brief One channel group
+ */
+typedef struct {
+  ADC_ChannelMask_t channel_mask;  ///< At most NN_ANOMALY_GROUP_CHANNELS
+  const NnAnomaly_Model_t *model;  ///< NULL or not a model = baseline
+  float threshold;                 ///< Alarm above it, 0 = never
+} NnAnomaly_Group_t;
+
+/**
+ * @brief Groups and timing
+ */
+typedef struct {
+  NnAnomaly_Group_t group[NN_ANOMALY_MAX_GROUPS];
+  uint8_t group_count;    ///< 1..NN_ANOMALY_MAX_GROUPS
+  uint16_t cadence;       ///< Windows per score, >= 1
+  uint16_t learn_windows; ///< Windows of a learned normalisation, >= 2
+} NnAnomaly_Config_t;
+
+/**
+ * @brief Newest score
+ */
+typedef struct {
+  uint32_t sequence;   ///< Score number
+  uint16_t windows;    ///< Windows scored since the previous score
+  uint16_t learning;   ///< Windows still to learn, 0 = scoring
+  uint8_t group_count;
+  uint8_t alarm_mask;  ///< Bit g: peak of group g above its threshold
+  uint32_t cycles_max; ///< Longest inference of one group (CPU cycles)
+  ADC_ChannelMask_t channel_mask[NN_ANOMALY_MAX_GROUPS];
+  float score_mean[NN_ANOMALY_MAX_GROUPS]; ///< Mean over the windows
+  float score_peak[NN_ANOMALY_MAX_GROUPS]; ///< Largest window score
+} NnAnomaly_Result_t;
+
+/* Exported variables --------------------------------------------------------*/
+
+/**
+ * @brief Default model of every group: none (baseline). A generated file
+ *        defines it without the weak.
+ */
+extern const NnAnomaly_Model_t nn_anomaly_model;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief Set up the groups; groups without a model normalisation start
+ *        learning
+ *
+ * @param cfg Groups and timing, copied
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer, a bad count, cadence or mask, or a
+ *                     model whose layers do not chain from its inputs to
+ *                     its inputs or to one output
+ */
+HAL_StatusTypeDef nnAnomaly_init(const NnAnomaly_Config_t *cfg);
+
+/**
+ * @brief Newest spectrum bands of a channel
+ *
+ * @param channel  Channel index
+ * @param band_rms Band RMS values
+ * @param band_kurtosis Band kurtosis values
+ * @param count    Bands given; missing ones are 0
+ */
+void nnAnomaly_setBands(uint8_t channel, const float *band_rms,
+                        const float *band_kurtosis, uint8_t count);
+
+/**
+ * @brief Score one window
+ *
+ * @param features Features of every channel over the window
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    A score is due; nnAnomaly_getResult() has it
+ *   @retval HAL_BUSY  No score due yet
+ *   @retval HAL_ERROR NULL pointer or not initialised
+ */
+HAL_StatusTypeDef nnAnomaly_addWindow(
+    const TelemetryFrame_Features_t *features);
+
+/**
+ * @brief Learn the normalisation again over windows windows (0 = the
+ *        configured count); the period in progress is dropped
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Learning
+ *   @retval HAL_ERROR Not initialised, or windows is 1
+ */
+HAL_StatusTypeDef nnAnomaly_learn(uint16_t windows);
+
+/**
+ * @brief Windows per score from the next score on
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR Not initialised, or windows is 0
+ */
+HAL_StatusTypeDef nnAnomaly_setCadence(uint16_t windows);
+
+/**
+ * @brief Windows per score
+ */
+uint16_t nnAnomaly_getCadence(void);
+
+/**
+ * @brief Newest score
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer, or no score yet
+ */
+HAL_StatusTypeDef nnAnomaly_getResult(NnAnomaly_Result_t *result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* NN_ANOMALY_H */
@@ -0,0 +1,176 @@
+/**
+ ******************************************************************************
+ * @file    pc_profile.h
+ * @brief   Statistical profiler: TIM7 samples the interrupted PC (and LR)
+ *          into a histogram of code addresses
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * The DWT probes (dwt_profiler.h) only time the stages someone wrapped in
+ * one. This profiler needs no instrumentation: TIM7 interrupts a few
+ * thousand times a second and its handler reads the return address the
+ * core stacked on exception entry (from MSP or PSP, per EXC_RETURN), i.e.
+ * the instruction the firmware was about to run, along with the stacked
+ * LR of the interrupted function (its caller, for a leaf function).
+ *
+ * Addresses are counted in bins of PC_PROFILE_BIN_BYTES in an open
+ * addressed table; the board knows nothing about functions. "pcs dump"
+ * sends the table as text lines:
+ *
+ *   PCS begin hz=4000 bin=16 samples=81234 handler=5120 missed=0 lr=1
+ *   PCS 08004a10:3120 08004a20:518 L08012f30:77 ...
+ *   PCS end slots=412
+ *
+ * (L = stacked LR) and cmake/pc_profile.cmake maps the bins to functions
+ * with the linker's .map file:
+ *
+ *   cmake -DMAP_FILE=ADC_6_channels.map -DDUMP_FILE=pcs.txt \
+ *         -P cmake/pc_profile.cmake
+ *
+ * The period is jittered by up to PC_PROFILE_JITTER_PCT so that a loop
+ * locked to the sampling rate does not alias onto one bin.
+ *
+ * @note The sampler runs at PC_PROFILE_IRQ_PRIORITY, level with the ADC
+ *       DMA: it sees every other handler, but a sample due during one at
+ *       its own level, or inside a masked section, lands where that code
+ *       ends (the end of a __set_PRIMASK() section is over-counted).
+ * @note TIM7 is taken whole while PC_PROFILE_ENABLE is set; it only
+ *       counts between pcProfile_start() and pcProfile_stop().
+ ******************************************************************************
+ */
+
+#ifndef PC_PROFILE_H
+#define PC_PROFILE_H
+
+#include "irq_priority.h"
+#include "stm32f7xx_hal.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+
+/**
+ * @brief Set to 0 to leave TIM7 and its vector alone
+ */
+#ifndef PC_PROFILE_ENABLE
+#define PC_PROFILE_ENABLE 1
+#endif
+
+/**
+ * @brief Sampling rate of "pcs start" without an argument
+ */
+#ifndef PC_PROFILE_DEFAULT_HZ
+#define PC_PROFILE_DEFAULT_HZ 4000U
+#endif
+
+/**
+ * @brief Accepted sampling rates (TIM7 counts microseconds, 16 bits)
+ */
+#define PC_PROFILE_MIN_HZ 20U
+#define PC_PROFILE_MAX_HZ 20000U
+
+/**
+ * @brief Histogram slots (power of two)
+ */
+#ifndef PC_PROFILE_SLOTS
+#define PC_PROFILE_SLOTS 1024U
+#endif
+
+/**
+ * @brief Bytes of code per bin (power of two, at least 4)
+ */
+#ifndef PC_PROFILE_BIN_BYTES
+#define PC_PROFILE_BIN_BYTES 16U
+#endif
+
+/**
+ * @brief Period jitter, percent of the period (0 = fixed rate)
+ */
+#ifndef PC_PROFILE_JITTER_PCT
+#define PC_PROFILE_JITTER_PCT 10U
+#endif
+
+/**
+ * @brief TIM7 priority
+ */
+#ifndef PC_PROFILE_IRQ_PRIORITY
+#define PC_PROFILE_IRQ_PRIORITY IRQ_PRIORITY_ACQUISITION
+#endif
+
+/**
+ * @brief pcProfile_start() flags
+ */
+#define PC_PROFILE_LR 0x01U ///< Also count the stacked LR
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief Counters of the current (or last) run
+ */
+typedef struct {
+  uint8_t running;  ///< TIM7 sampling
+  uint8_t flags;    ///< PC_PROFILE_LR
+  uint32_t rate_hz; ///< Mean sampling rate
+  uint32_t samples; ///< Interrupts taken
+  uint32_t handler; ///< Of which interrupted another handler
+  uint32_t missed;  ///< Addresses not counted: their probe run was full
+  uint32_t slots;   ///< Slots in use
+} PcProfile_Stats_t;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief Clear the histogram and start sampling
+ *
+ * @param rate_hz PC_PROFILE_MIN_HZ..PC_PROFILE_MAX_HZ
+ * @param flags   PC_PROFILE_LR or 0
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Sampling (restarted if it was)
+ *   @retval HAL_ERROR Rate out of range, or PC_PROFILE_ENABLE = 0
+ */
+HAL_StatusTypeDef pcProfile_start(uint32_t rate_hz, uint8_t flags);
+
+/**
+ * @brief Stop sampling; the histogram is kept for the dump
+ */
+void pcProfile_stop(void);
+
+/**
+ * @brief TIM7 handler body, entered from TIM7_IRQHandler with the stacked
+ *        frame and EXC_RETURN
+ *
+ * @param frame      R0, R1, R2, R3, R12, LR, PC, xPSR of the interrupted code
+ * @param exc_return LR on exception entry
+ */
+void pcProfile_sample(const uint32_t *frame, uint32_t exc_return);
+
+/**
+ * @brief Get the counters
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer
+ */
+HAL_StatusTypeDef pcProfile_getStats(PcProfile_Stats_t *stats);
+
+/**
+ * @brief Queue the histogram as PCS text lines, sent by pcProfile_poll()
+ */
+void pcProfile_dump(void);
+
+/**
+ * @brief Send pending PCS lines while telemetry slots are free (main loop)
+ */
+void pcProfile_poll(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PC_PROFILE_H */
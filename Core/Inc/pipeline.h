@@ -0,0 +1,454 @@
+/**
+ ******************************************************************************
+ * @file    pipeline.h
+ * @brief   Static dataflow graph of block processing stages per channel
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * A pipeline is a table of branches, each a channel mask plus a chain of
+ * stages, declared as const tables at compile time or built at boot:
+ *
+ *   source(adc_scan) -> biquad(lp) -> decimate(4) -> stats -> frame -> sink
+ *
+ * pipeline_run() is the source: for every branch and every channel in its
+ * mask it deinterleaves the channel from the DMA block into one float work
+ * buffer and runs the whole chain on it in place before moving on to the
+ * next channel. Adjacent stages are fused this way: a block is read from
+ * memory once, and every later stage works on ADC_CONVERSIONS_BLOCK_FRAMES
+ * floats (1 kB) that are still in the L1 cache, instead of each module
+ * walking the full interleaved block again.
+ *
+ * Different channels take different branches, e.g. raw frames for channel 0
+ * and spectra for channels 1-5. Each stage state belongs to one branch.
+ *
+ * Stages have up to three hooks:
+ *   run   per channel segment, in the block callback (ISR or DSP task)
+ *   end   once per block after the branch's last channel, same context
+ *   poll  from pipeline_poll(), main loop or comms task: the heavy or
+ *         link-facing part (FFT, telemetry)
+ * PIPELINE_STAGE_*() build the built-in stages; any other stage only needs
+ * a run hook working on a Pipeline_Segment_t.
+ *
+ * Usage Example:
+ *   static Pipeline_Frame_t raw = {.sink = telemetry_send};
+ *   static Pipeline_Biquad_t lp;
+ *   static Pipeline_Decimate_t dec4 = {.factor = 4};
+ *   static Pipeline_Stats_t stats;
+ *   static Pipeline_Spectrum_t fft = {.channel = {NULL, &sp1, &sp2}};
+ *
+ *   static const Pipeline_Stage_t raw_path[] = {PIPELINE_STAGE_FRAME(&raw)};
+ *   static const Pipeline_Stage_t vib_path[] = {
+ *       PIPELINE_STAGE_BIQUAD(&lp), PIPELINE_STAGE_DECIMATE(&dec4),
+ *       PIPELINE_STAGE_STATS(&stats), PIPELINE_STAGE_SPECTRUM(&fft)};
+ *   static const Pipeline_Branch_t branches[] = {
+ *       PIPELINE_BRANCH(0x01U, raw_path), PIPELINE_BRANCH(0x3EU, vib_path)};
+ *   static Pipeline_t pl;
+ *
+ *   pipelineBiquad_init(&lp, &dspFilter_lowpass200Hz);
+ *   pipelineFrame_init(&raw, 0x01U);
+ *   pipelineStats_reset(&stats);
+ *   pipeline_init(&pl, branches, 2, analogSensor_getBlockChannelMap());
+ *   analogSensor_registerBlockCallback(pipeline_blockCallback, &pl);
+ *
+ *   // main loop
+ *   pipeline_poll(&pl);
+ *
+ * A display() branch is the cheap way to feed a live plot: it keeps the
+ * smallest and largest sample of every bucket of samples per channel and
+ * sends those pairs (telemetry display packets) instead of the samples. A
+ * bucket of 8 frames at 4 kHz is 1000 points per second per channel, yet a
+ * one-sample spike still shows as the min or max of its bucket, where a
+ * decimated stream would have dropped it 7 times out of 8. It runs no
+ * filter and does two compares per sample.
+ *
+ * spectrum() and spectrum_q15() are the same stage on the float and the
+ * fixed-point transform; a branch picks one, so the channels whose spectra
+ * need the float floor or the coherence hook keep it while the others take
+ * the smaller q15 buffers. zoom() (dsp_zoom.h) resolves a narrow band
+ * around one frequency finely, e.g. the sidebands of a gear mesh.
+ *
+ * autozero() and dcblock() both take gravity off a branch. autozero()
+ * subtracts the slowly tracked DC and keeps everything above it; dcblock()
+ * is a q15 high-pass with its own corner for the dynamic-only branches,
+ * which also takes out the drift between tracker updates.
+ *
+ * @note Put a low-pass before decimate() unless the input is already band
+ *       limited; decimate() only drops samples.
+ ******************************************************************************
+ */
+
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include "adc_conversions.h"
+#include "adc_ring.h"
+#include "arm_math.h"
+#include "dsp_dcblock.h"
+#include "dsp_dctrack.h"
+#include "dsp_filter.h"
+#include "dsp_spectrum.h"
+#include "dsp_spectrum_q15.h"
+#include "dsp_stats.h"
+#include "dsp_zoom.h"
+#include "telemetry_frame.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+
+/**
+ * @brief Most branches per pipeline
+ */
+#ifndef PIPELINE_MAX_BRANCHES
+#define PIPELINE_MAX_BRANCHES 4U
+#endif
+
+/**
+ * @brief Most stages per branch
+ */
+#ifndef PIPELINE_MAX_STAGES
+#define PIPELINE_MAX_STAGES 8U
+#endif
+
+/**
+ * @brief Buckets a display() stage holds between two polls
+ */
+#ifndef PIPELINE_DISPLAY_BUCKETS
+#define PIPELINE_DISPLAY_BUCKETS 64U
+#endif
+
+/**
+ * @brief Longest a part-filled display packet waits for more buckets (ms)
+ */
+#ifndef PIPELINE_DISPLAY_FLUSH_MS
+#define PIPELINE_DISPLAY_FLUSH_MS 100U
+#endif
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief One channel of one block on its way through a branch
+ *
+ * Stages change x and count in place. Sample k stands for input frame
+ * first + (k + 1) * stride - 1, as for dspFilter_getOutput().
+ */
+typedef struct {
+  float32_t *x;    ///< Samples (ADC codes), ADC_CONVERSIONS_BLOCK_FRAMES max
+  uint32_t count;  ///< Samples in x; 0 stops the branch for this channel
+  uint32_t first;  ///< Input frame index of the block
+  uint32_t stride; ///< Input frames per sample, the decimation so far
+  uint8_t channel; ///< Channel index
+} Pipeline_Segment_t;
+
+/**
+ * @brief Stage of a branch
+ */
+typedef struct {
+  void (*run)(void *state, Pipeline_Segment_t *seg); ///< Required
+  void (*end)(void *state);  ///< After the block's last channel, may be NULL
+  void (*poll)(void *state); ///< From pipeline_poll(), may be NULL
+  void *state;               ///< Passed to every hook
+} Pipeline_Stage_t;
+
+/**
+ * @brief Channels and the chain of stages they run through
+ */
+typedef struct {
+  ADC_ChannelMask_t channel_mask; ///< Bit n = channel n
+  uint8_t stage_count;            ///< Entries in stages
+  const Pipeline_Stage_t *stages; ///< Run in order
+} Pipeline_Branch_t;
+
+/**
+ * @brief Pipeline instance
+ */
+typedef struct {
+  const Pipeline_Branch_t *branches;
+  uint8_t branch_count;
+  uint8_t channel_slot[ADC_CONVERSIONS_CHANNEL_COUNT]; ///< Channel -> slot
+  uint32_t frames_in;                                  ///< Input frames run
+  float32_t work[ADC_CONVERSIONS_BLOCK_FRAMES];        ///< Fused segment
+} Pipeline_t;
+
+/**
+ * @brief decimate(): keep every factor-th sample. A group may span blocks,
+ *        so any block length works (analogSensor_setBlockFrames())
+ */
+typedef struct {
+  uint16_t factor; ///< Input samples per output sample
+  uint16_t phase[ADC_CONVERSIONS_CHANNEL_COUNT]; ///< Of the open group
+} Pipeline_Decimate_t;
+
+/**
+ * @brief biquad(): CMSIS df2T cascade per channel, see dsp_filter.h
+ */
+typedef struct {
+  arm_biquad_cascade_df2T_instance_f32 biquad[ADC_CONVERSIONS_CHANNEL_COUNT];
+  float32_t state[ADC_CONVERSIONS_CHANNEL_COUNT][2U * DSP_FILTER_MAX_STAGES];
+} Pipeline_Biquad_t;
+
+/**
+ * @brief stats(): integer totals of the rounded samples, see dsp_stats.h
+ */
+typedef struct {
+  DSP_StatsAccum_t acc[ADC_CONVERSIONS_CHANNEL_COUNT]; ///< Channel order
+} Pipeline_Stats_t;
+
+/**
+ * @brief frame() + sink: samples packets of the branch's channels
+ *
+ * run/end collect the block's segments into frames (ping-pong, like
+ * dsp_filter.h); poll encodes them into telemetry sample packets and hands
+ * each one to sink.
+ */
+typedef struct {
+  HAL_StatusTypeDef (*sink)(const uint8_t *data, uint16_t len); ///< Link
+  ADC_RingEntry_t frames[2][ADC_CONVERSIONS_BLOCK_FRAMES];
+  uint32_t frame_count[2];
+  ADC_ChannelMask_t channel_mask; ///< Channels in the packets
+  volatile uint32_t blocks_done; ///< Written by end
+  uint32_t blocks_read;          ///< Written by poll
+  uint32_t overruns;             ///< Blocks replaced before poll took them
+  uint32_t sink_errors;          ///< Packets the sink refused
+  TelemetryFrame_Batch_t batch;
+  uint8_t packet[TELEMETRY_FRAME_ENCODED_MAX];
+} Pipeline_Frame_t;
+
+/**
+ * @brief One closed bucket of a display() stage, channel order
+ */
+typedef struct {
+  uint32_t first_frame; ///< Input frame where the bucket starts
+  uint32_t timestamp;   ///< End of its block (HAL tick, ms)
+  uint16_t min[ADC_CONVERSIONS_CHANNEL_COUNT]; ///< Smallest code
+  uint16_t max[ADC_CONVERSIONS_CHANNEL_COUNT]; ///< Largest code
+} Pipeline_DisplayBucket_t;
+
+/**
+ * @brief display() + sink: min/max envelope per bucket of samples
+ *
+ * run folds the segment into each channel's open bucket and closes one
+ * every bucket samples, possibly across blocks; end publishes the block's
+ * buckets to a ring; poll packs them into display packets and hands each
+ * one to sink, full, or part-filled after PIPELINE_DISPLAY_FLUSH_MS.
+ */
+typedef struct {
+  HAL_StatusTypeDef (*sink)(const uint8_t *data, uint16_t len); ///< Link
+  uint16_t bucket;                ///< Segment samples per bucket
+  ADC_ChannelMask_t channel_mask; ///< Channels in the packets
+  uint32_t stride;                ///< Input frames per segment sample
+  float32_t lo[ADC_CONVERSIONS_CHANNEL_COUNT]; ///< Open bucket
+  float32_t hi[ADC_CONVERSIONS_CHANNEL_COUNT];
+  uint32_t start[ADC_CONVERSIONS_CHANNEL_COUNT]; ///< Its first frame
+  uint16_t filled[ADC_CONVERSIONS_CHANNEL_COUNT]; ///< Its samples so far
+  uint32_t closed;                ///< Buckets closed in this block
+  volatile uint32_t head;         ///< Buckets published, written by end
+  uint32_t tail;                  ///< Buckets taken, written by poll
+  uint32_t overruns;              ///< Buckets replaced before poll took them
+  uint32_t sink_errors;           ///< Packets the sink refused
+  Pipeline_DisplayBucket_t ring[PIPELINE_DISPLAY_BUCKETS];
+  TelemetryFrame_Display_t batch;
+  uint8_t packet[TELEMETRY_FRAME_ENCODED_MAX];
+} Pipeline_Display_t;
+
+/**
+ * @brief FFT: one spectrum instance per channel (NULL = not analysed)
+ */
+typedef struct {
+  DSP_Spectrum_t *channel[ADC_CONVERSIONS_CHANNEL_COUNT];
+} Pipeline_Spectrum_t;
+
+/**
+ * @brief FFT on the q15 path (dsp_spectrum_q15.h), same results as
+ *        Pipeline_Spectrum_t in about 10 / 16 of the RAM
+ */
+typedef struct {
+  DSP_SpectrumQ15_t *channel[ADC_CONVERSIONS_CHANNEL_COUNT];
+} Pipeline_SpectrumQ15_t;
+
+/**
+ * @brief Zoom FFT: one narrow-band instance per channel (NULL = none)
+ */
+typedef struct {
+  DSP_Zoom_t *channel[ADC_CONVERSIONS_CHANNEL_COUNT];
+} Pipeline_Zoom_t;
+
+/* Exported macros -----------------------------------------------------------*/
+
+#define PIPELINE_BRANCH(mask, stage_table)                                     \
+  {.channel_mask = (mask),                                                     \
+   .stage_count = (uint8_t)(sizeof(stage_table) / sizeof((stage_table)[0])),   \
+   .stages = (stage_table)}
+
+#define PIPELINE_STAGE_DECIMATE(st)                                            \
+  {.run = pipelineDecimate_run, .state = (st)}
+#define PIPELINE_STAGE_BIQUAD(st) {.run = pipelineBiquad_run, .state = (st)}
+// rectify(): |x| * pi / 2, stateless. Between a band-pass and a low-pass
+// this is the envelope, in carrier amplitude (the mean of a rectified sine
+// is 2 / pi of its peak)
+#define PIPELINE_STAGE_RECTIFY() {.run = pipelineRectify_run, .state = NULL}
+// autozero(): move the channel's tracked DC (dsp_dctrack.h) to mid-scale,
+// ahead of stats or spectrum stages. The tracker must be updated
+// before pipeline_run() in the same block
+#define PIPELINE_STAGE_AUTOZERO(dc)                                            \
+  {.run = pipelineAutozero_run, .state = (dc)}
+// dcblock(): q15 first-order high-pass (dsp_dcblock.h) on the branch's
+// channels, result centred on mid-scale; for the channels whose gravity
+// would take q15 headroom from the stages after it
+#define PIPELINE_STAGE_DCBLOCK(blk)                                            \
+  {.run = pipelineDcBlock_run, .state = (blk)}
+#define PIPELINE_STAGE_STATS(st) {.run = pipelineStats_run, .state = (st)}
+#define PIPELINE_STAGE_FRAME(st)                                               \
+  {.run = pipelineFrame_run,                                                   \
+   .end = pipelineFrame_end,                                                   \
+   .poll = pipelineFrame_poll,                                                 \
+   .state = (st)}
+#define PIPELINE_STAGE_DISPLAY(st)                                             \
+  {.run = pipelineDisplay_run,                                                 \
+   .end = pipelineDisplay_end,                                                 \
+   .poll = pipelineDisplay_poll,                                               \
+   .state = (st)}
+#define PIPELINE_STAGE_SPECTRUM(st)                                            \
+  {.run = pipelineSpectrum_run, .poll = pipelineSpectrum_poll, .state = (st)}
+#define PIPELINE_STAGE_SPECTRUM_Q15(st)                                        \
+  {.run = pipelineSpectrumQ15_run,                                             \
+   .poll = pipelineSpectrumQ15_poll,                                           \
+   .state = (st)}
+#define PIPELINE_STAGE_ZOOM(st)                                                \
+  {.run = pipelineZoom_run, .poll = pipelineZoom_poll, .state = (st)}
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief Attach a branch table
+ *
+ * @param pl           Instance
+ * @param branches     Branch table, kept by reference
+ * @param branch_count Entries, 1..PIPELINE_MAX_BRANCHES
+ * @param channel_map  Raw block slot -> channel (NULL = identity)
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer, too many branches or stages, a mask
+ *                     with no or unknown channels, a stage without run, or
+ *                     a decimate() without its state
+ */
+HAL_StatusTypeDef pipeline_init(Pipeline_t *pl,
+                                const Pipeline_Branch_t *branches,
+                                uint8_t branch_count,
+                                const uint8_t *channel_map);
+
+/**
+ * @brief Run every branch on one block of interleaved raw frames
+ *
+ * @param pl     Instance
+ * @param block  Raw frames
+ * @param frames Frames in the block, at most ADC_CONVERSIONS_BLOCK_FRAMES
+ */
+void pipeline_run(Pipeline_t *pl, const uint16_t *block, uint32_t frames);
+
+/**
+ * @brief ADC_BlockCallback_t adapter, ctx = the Pipeline_t
+ */
+void pipeline_blockCallback(const uint16_t *block, uint32_t frame_count,
+                            void *ctx);
+
+/**
+ * @brief Run the poll hooks of every stage
+ *
+ * @param pl Instance
+ */
+void pipeline_poll(Pipeline_t *pl);
+
+/**
+ * @brief Set up a biquad stage; every channel gets the same design
+ *
+ * @param st     Stage state
+ * @param design Coefficient table entry (dsp_filter.h)
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success, delay lines cleared
+ *   @retval HAL_ERROR NULL pointer or invalid stage count
+ */
+HAL_StatusTypeDef pipelineBiquad_init(Pipeline_Biquad_t *st,
+                                      const DSP_FilterDesign_t *design);
+
+/**
+ * @brief Clear a stats stage; required once before the first block
+ */
+void pipelineStats_reset(Pipeline_Stats_t *st);
+
+/**
+ * @brief Derive one channel's statistics
+ *
+ * @param st      Stage state
+ * @param channel Channel index
+ * @param out     Destination
+ * @param reset   Non-zero to restart the totals in the same critical section
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer or invalid channel
+ */
+HAL_StatusTypeDef pipelineStats_read(Pipeline_Stats_t *st, uint8_t channel,
+                                     ADC_ChannelStats_t *out, uint8_t reset);
+
+/**
+ * @brief Set up a frame stage; sink must already be set
+ *
+ * @param st           Stage state
+ * @param channel_mask Channels to put in the packets: the branch's mask
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer or sink, or invalid mask
+ */
+HAL_StatusTypeDef pipelineFrame_init(Pipeline_Frame_t *st,
+                                     ADC_ChannelMask_t channel_mask);
+
+/**
+ * @brief Set up a display stage; sink must already be set
+ *
+ * @param st           Stage state
+ * @param channel_mask Channels to put in the packets: the branch's mask
+ * @param bucket       Segment samples per min/max pair, >= 1
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer or sink, invalid mask, zero bucket, or
+ *                     more channels than a display packet holds
+ */
+HAL_StatusTypeDef pipelineDisplay_init(Pipeline_Display_t *st,
+                                       ADC_ChannelMask_t channel_mask,
+                                       uint16_t bucket);
+
+/* Built-in stage hooks, for the PIPELINE_STAGE_*() tables */
+void pipelineDecimate_run(void *state, Pipeline_Segment_t *seg);
+void pipelineBiquad_run(void *state, Pipeline_Segment_t *seg);
+void pipelineRectify_run(void *state, Pipeline_Segment_t *seg);
+void pipelineAutozero_run(void *state, Pipeline_Segment_t *seg);
+void pipelineDcBlock_run(void *state, Pipeline_Segment_t *seg);
+void pipelineStats_run(void *state, Pipeline_Segment_t *seg);
+void pipelineFrame_run(void *state, Pipeline_Segment_t *seg);
+void pipelineFrame_end(void *state);
+void pipelineFrame_poll(void *state);
+void pipelineDisplay_run(void *state, Pipeline_Segment_t *seg);
+void pipelineDisplay_end(void *state);
+void pipelineDisplay_poll(void *state);
+void pipelineSpectrum_run(void *state, Pipeline_Segment_t *seg);
+void pipelineSpectrum_poll(void *state);
+void pipelineSpectrumQ15_run(void *state, Pipeline_Segment_t *seg);
+void pipelineSpectrumQ15_poll(void *state);
+void pipelineZoom_run(void *state, Pipeline_Segment_t *seg);
+void pipelineZoom_poll(void *state);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PIPELINE_H */
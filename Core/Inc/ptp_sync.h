@@ -0,0 +1,256 @@
+/**
+ ******************************************************************************
+ * @file    ptp_sync.h
+ * @brief   IEEE 1588 (PTPv2) slave on the Ethernet MAC clock, and the PTP
+ *          time of every frame
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * The MAC keeps a system time (seconds + nanoseconds) and stamps PTP event
+ * frames in hardware on their way in and out, so the stamps do not carry
+ * any of the interrupt or main-loop latency. This module is an ordinary
+ * clock in slave-only mode over UDP/IPv4 (ports 319/320, multicast
+ * 224.0.1.129), end-to-end delay mechanism, one- and two-step masters:
+ *
+ *   Sync / Follow_Up   t1 (master, sent)       t2 (MAC stamp, received)
+ *   Delay_Req          t3 (MAC stamp, sent)
+ *   Delay_Resp         t4 (master, received)
+ *
+ *   path delay = ((t2 - t1) + (t4 - t3)) / 2
+ *   offset     =   t2 - t1 - path delay
+ *
+ * An offset above PTP_SYNC_STEP_NS steps the MAC clock. Smaller offsets go
+ * through a PI servo that trims the addend register, i.e. the rate of the
+ * MAC clock, in parts per billion. There is no best-master selection: the
+ * first master announced in PTP_SYNC_DOMAIN is followed until it has been
+ * silent for PTP_SYNC_MASTER_TIMEOUT_MS (one grandmaster, or a boundary
+ * clock switch, per machine hall).
+ *
+ * The sample clock follows through time_sync.h: at every whole PTP second
+ * the MAC's target-time trigger pulses TIM2 ITR1, which time_sync captures
+ * from TIME_SYNC_INPUT_PTP exactly like the PB11 pulse. With that loop
+ * locked, the scan triggers sit on the PTP second grid, and
+ * ptpSync_getFrameTime() gives the PTP time of any frame number. Nodes of
+ * one domain put the same timeline in their UDP block headers.
+ *
+ * eth_stream.c carries the messages: it hands received PTP datagrams and
+ * their stamps to ptpSync_receive(), sends the Delay_Req this module
+ * prepares from the block callback (which owns the TX descriptors), and
+ * returns its transmit stamp through ptpSync_txTimestamp().
+ *
+ * Usage Example:
+ *   ptpSync_start(mac_addr);      // after every HAL_ETH_Init()
+ *
+ *   // main loop
+ *   ptpSync_receive(msg, len, &rx_stamp);
+ *   ptpSync_poll();               // timeouts, Delay_Req, trigger
+ *
+ *   uint64_t ns;
+ *   if (ptpSync_getFrameTime(first_frame, rate_hz, &ns) == HAL_OK) {
+ *     // PTP time of the frame's scan trigger
+ *   }
+ *
+ * @note Needs HAL_ETH_USE_PTP (stm32f7xx_hal_conf.h) and HCLK above
+ *       PTP_SYNC_CLOCK_HZ.
+ ******************************************************************************
+ */
+
+#ifndef PTP_SYNC_H
+#define PTP_SYNC_H
+
+#include "stm32f7xx_hal.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+
+/**
+ * @brief Run PTP on the Ethernet link (with ETH_STREAM_ENABLE)
+ */
+#ifndef PTP_SYNC_ENABLE
+#define PTP_SYNC_ENABLE 1
+#endif
+
+/**
+ * @brief PTP domain to follow
+ */
+#ifndef PTP_SYNC_DOMAIN
+#define PTP_SYNC_DOMAIN 0U
+#endif
+
+/**
+ * @brief Rate the MAC system time is counted at (20 ns steps)
+ */
+#ifndef PTP_SYNC_CLOCK_HZ
+#define PTP_SYNC_CLOCK_HZ 50000000U
+#endif
+
+/**
+ * @brief Interval between Delay_Req messages
+ */
+#ifndef PTP_SYNC_DELAY_REQ_MS
+#define PTP_SYNC_DELAY_REQ_MS 1000U
+#endif
+
+/**
+ * @brief Master dropped after this long without a Sync
+ */
+#ifndef PTP_SYNC_MASTER_TIMEOUT_MS
+#define PTP_SYNC_MASTER_TIMEOUT_MS 3000U
+#endif
+
+/**
+ * @brief Offset above which the clock is stepped instead of slewed
+ */
+#ifndef PTP_SYNC_STEP_NS
+#define PTP_SYNC_STEP_NS 100000U
+#endif
+
+/**
+ * @brief Offset below which a Sync counts towards lock
+ */
+#ifndef PTP_SYNC_LOCK_NS
+#define PTP_SYNC_LOCK_NS 1000U
+#endif
+
+/**
+ * @brief Consecutive Syncs within PTP_SYNC_LOCK_NS to report lock
+ */
+#ifndef PTP_SYNC_LOCK_SYNCS
+#define PTP_SYNC_LOCK_SYNCS 4U
+#endif
+
+/**
+ * @brief Largest rate correction of the servo, parts per billion
+ */
+#ifndef PTP_SYNC_MAX_PPB
+#define PTP_SYNC_MAX_PPB 500000
+#endif
+
+#define PTP_SYNC_EVENT_PORT 319U   ///< Sync, Delay_Req
+#define PTP_SYNC_GENERAL_PORT 320U ///< Announce, Follow_Up, Delay_Resp
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief Port state
+ */
+typedef enum {
+  PTP_SYNC_DISABLED = 0, ///< Not started, or the link is down
+  PTP_SYNC_LISTENING,    ///< No master heard
+  PTP_SYNC_UNCALIBRATED, ///< Following a master, offset not settled
+  PTP_SYNC_SLAVE         ///< Offset within PTP_SYNC_LOCK_NS
+} PtpSync_State_t;
+
+/**
+ * @brief Servo and message counters
+ */
+typedef struct {
+  PtpSync_State_t state;
+  uint64_t master_id;     ///< Clock identity of the master followed
+  int32_t offset_ns;      ///< Newest offset from the master (saturated)
+  int32_t path_delay_ns;  ///< Mean path delay, filtered
+  int32_t freq_ppb;       ///< Rate correction applied to the MAC clock
+  uint32_t syncs;         ///< Sync/Follow_Up pairs used
+  uint32_t delay_resps;   ///< Delay measurements completed
+  uint32_t steps;         ///< Clock steps
+  uint32_t timeouts;      ///< Masters lost
+  uint32_t rejected;      ///< Malformed, foreign or unmatched messages
+} PtpSync_Status_t;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief Start the MAC system time and hardware stamping, restart the port
+ *
+ * @param mac MAC address of the port; the clock identity is derived from it
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Stamping; listening for a master
+ *   @retval HAL_ERROR HCLK not above PTP_SYNC_CLOCK_HZ, or NULL pointer
+ *
+ * @note Call after every HAL_ETH_Init(): the MAC reset clears the clock
+ */
+HAL_StatusTypeDef ptpSync_start(const uint8_t mac[6]);
+
+/**
+ * @brief Port down: stop the trigger, forget the master; the clock runs on
+ */
+void ptpSync_stop(void);
+
+/**
+ * @brief One received PTP message (UDP payload)
+ *
+ * @param msg   PTP header and body
+ * @param len   UDP payload length
+ * @param stamp MAC receive stamp of the frame, NULL on the general port
+ *
+ * @note Main loop, as ptpSync_poll()
+ */
+void ptpSync_receive(const uint8_t *msg, uint32_t len,
+                     const ETH_TimeStampTypeDef *stamp);
+
+/**
+ * @brief Master timeout, Delay_Req schedule and the second trigger
+ *
+ * @note Call from the main loop
+ */
+void ptpSync_poll(void);
+
+/**
+ * @brief Take the Delay_Req due for sending, if any
+ *
+ * @param msg Receives the message (valid until the next Delay_Req is due)
+ *
+ * @return Message length, 0 if none is due
+ *
+ * @note Block callback (TX owner). Send it with a transmit stamp.
+ */
+uint32_t ptpSync_takeDelayReq(const uint8_t **msg);
+
+/**
+ * @brief Transmit stamp of the Delay_Req (HAL_ETH_TxPtpCallback())
+ */
+void ptpSync_txTimestamp(const ETH_TimeStampTypeDef *stamp);
+
+/**
+ * @brief MAC system time, nanoseconds since the PTP epoch
+ */
+uint64_t ptpSync_now(void);
+
+/**
+ * @brief PTP time of a frame's scan trigger
+ *
+ * Takes the newest time_sync pulse, which sits on a whole PTP second, and
+ * counts frame periods from the frame it triggered.
+ *
+ * @param frame         Sequence number (ADC_BlockInfo_t.first_frame etc.)
+ * @param frame_rate_hz Scan rate the frames were taken at
+ * @param ptp_ns        Receives the time
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Computed; exact while both loops are locked
+ *   @retval HAL_ERROR No master yet, no PTP pulse captured, or bad argument
+ */
+HAL_StatusTypeDef ptpSync_getFrameTime(uint32_t frame, uint32_t frame_rate_hz,
+                                       uint64_t *ptp_ns);
+
+/**
+ * @brief Get port status and counters
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer
+ */
+HAL_StatusTypeDef ptpSync_getStatus(PtpSync_Status_t *status);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PTP_SYNC_H */
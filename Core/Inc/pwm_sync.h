@@ -0,0 +1,165 @@
+/**
+ ******************************************************************************
+ * @file    pwm_sync.h
+ * @brief   Scans triggered at a programmable phase of a TIM1/TIM8 PWM period
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * To correlate phase currents and frame vibration with the switching of a
+ * motor drive, every scan is started at the same point of the drive's PWM
+ * period instead of on the free TIM2 grid. The drive's advanced timer is
+ * centre-aligned: it counts up to ARR and back down, one PWM period per
+ * up/down pair. Channel 6, which has no pin, marks the trigger point:
+ *
+ *   CNT  ARR ........ /\ ........
+ *                   /    \
+ *                 /        \          phase > 0: OC6REF rises on the way
+ *   CCR6 ------ /- - - - - - \------         down, phase after the peak
+ *             /                \      phase < 0: PWM mode 2, rises on the
+ *        0  /                    \           way up, before the peak
+ *
+ * TRGO2 is OC6REF, and ADC1 starts a scan on its rising edge
+ * (ADC_SCAN_TRIGGER_TIM1_TRGO2 / _TIM8_TRGO2). One scan per PWM period:
+ * the frame rate is the PWM frequency. The peak of the counter is the
+ * centre of the off time of PWM mode 1 outputs; the trough, half a period
+ * away, the centre of their on time (where shunt currents are read).
+ *
+ * The timer either belongs to this module (pwm_hz != 0: started here,
+ * centre-aligned mode 1, no outputs), or to motor control code that
+ * already runs it centre-aligned (pwm_hz = 0): then only CCR6, the OC6
+ * mode bits and MMS2 are written, and the period is read back.
+ *
+ * TIM2 stays idle while the scan follows the PWM, so time_sync.h cannot
+ * pace it and the rate is not changed through analogSensor_setSampleRate().
+ *
+ * Usage Example:
+ *   const PwmSync_Config_t cfg = {.timer = PWM_SYNC_TIM1, .pwm_hz = 0,
+ *                                 .phase_ns = -2000};
+ *   pwmSync_start(&cfg);                  // scan stopped
+ *   analogSensor_startTimedDMA(pwmSync_getRate());
+ *
+ *   pwmSync_setPhase(500);                // at the next update event
+ *
+ * @note An own timer takes TIM1 or TIM8 whole; with EXT_ADC_ENABLE, TIM8
+ *       is the SPI ADC's.
+ ******************************************************************************
+ */
+
+#ifndef PWM_SYNC_H
+#define PWM_SYNC_H
+
+#include "stm32f7xx_hal.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+
+/**
+ * @brief Set to 1 to trigger the scan from the PWM timer instead of TIM2
+ */
+#ifndef PWM_SYNC_ENABLE
+#define PWM_SYNC_ENABLE 0
+#endif
+
+/**
+ * @brief Timer of the build's configuration (1 or 8)
+ */
+#ifndef PWM_SYNC_TIMER
+#define PWM_SYNC_TIMER 1
+#endif
+
+/**
+ * @brief PWM frequency of an own timer; 0 attaches to a running one
+ */
+#ifndef PWM_SYNC_HZ
+#define PWM_SYNC_HZ 0U
+#endif
+
+/**
+ * @brief Default trigger phase, ns from the counter peak (negative: before)
+ */
+#ifndef PWM_SYNC_PHASE_NS
+#define PWM_SYNC_PHASE_NS 0
+#endif
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief Timer the scan follows
+ */
+typedef enum {
+  PWM_SYNC_TIM1 = 0, ///< TIM1 TRGO2
+  PWM_SYNC_TIM8      ///< TIM8 TRGO2
+} PwmSync_Timer_t;
+
+/**
+ * @brief Trigger configuration
+ */
+typedef struct {
+  PwmSync_Timer_t timer;
+  uint32_t pwm_hz;  ///< Own timer at this frequency; 0 = attach to a running
+                    ///< centre-aligned timer
+  int32_t phase_ns; ///< Trigger point from the counter peak, within
+                    ///< +-(half a period - one tick)
+} PwmSync_Config_t;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief Set up the trigger and select it as the scan trigger
+ *
+ * @param cfg Configuration (copied)
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    The timer's TRGO2 triggers the next timed scan
+ *   @retval HAL_BUSY  An acquisition is running
+ *   @retval HAL_ERROR NULL pointer, a frequency the timer cannot produce,
+ *                     an attached timer that is stopped or edge-aligned,
+ *                     or a phase outside the period
+ */
+HAL_StatusTypeDef pwmSync_start(const PwmSync_Config_t *cfg);
+
+/**
+ * @brief Release the timer (an own one is stopped) and return the scan
+ *        trigger to TIM2
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK   Released (or never started)
+ *   @retval HAL_BUSY An acquisition is running
+ */
+HAL_StatusTypeDef pwmSync_stop(void);
+
+/**
+ * @brief Move the trigger point while running
+ *
+ * CCR6 is preloaded and changes at the next update event. A change of
+ * sign moves the point across the peak and can add or drop one scan.
+ *
+ * @param phase_ns Trigger point from the counter peak
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Applied
+ *   @retval HAL_ERROR Not started, or outside +-(half a period - one tick)
+ */
+HAL_StatusTypeDef pwmSync_setPhase(int32_t phase_ns);
+
+/**
+ * @brief Trigger point actually set, after rounding to timer ticks
+ */
+int32_t pwmSync_getPhase(void);
+
+/**
+ * @brief Scans per second, i.e. the PWM frequency (0 = not started)
+ */
+uint32_t pwmSync_getRate(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PWM_SYNC_H */
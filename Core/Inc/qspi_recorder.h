@@ -0,0 +1,455 @@
+/**
+ ******************************************************************************
+ * @file    qspi_recorder.h
+ * @brief   Black-box recorder on external QSPI NOR flash
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * Keeps the last minutes of raw frames, plus the latest trigger captures,
+ * in a serial NOR flash on QUADSPI bank 1. Nothing large stays in SRAM.
+ *
+ * Flash layout (4 KB sectors, 256-byte pages):
+ *
+ *   sector 0 .. H-1   history ring, one QspiRec_Page_t per page
+ *   sector H .. R-1   rollup segments (QSPI_REC_ROLLUP_ENABLE), 1 s, 1 min
+ *                     and 1 h, one QspiRec_Rollup_t per record slot
+ *   sector R .. end   QSPI_REC_CAPTURE_SLOTS capture slots
+ *
+ * History: the block callback packs frames, in channel order, into 256-byte
+ * pages of a RAM staging ring (QSPI_REC_STAGE_PAGES). The main loop
+ * programs them into the flash ring. Page n of the recording always sits at
+ * page n % H*16 of the ring. So the ring wraps sector by sector, and the
+ * oldest sector is the one that gets erased. The recorder keeps
+ * QSPI_REC_ERASE_AHEAD sectors ahead of the write position erased. Each
+ * erase is issued as soon as the writer enters a new sector, and runs while
+ * the block callback keeps filling the staging ring. Erase time is
+ * therefore never on the acquisition path: 64 pages hold 320 ms at 4 kHz,
+ * several typical 4 KB erase times. The flash cannot program while it
+ * erases, so the pages written meanwhile go out right after.
+ *
+ * Captures: qspiRec_commitCapture() copies a frozen trigger capture into
+ * the next slot, pre-erased after the last commit. The data pages go first,
+ * then the header page, then a separate commit word at the end of the
+ * header. A slot counts only if its commit word is set and both CRC-32s
+ * match, so a power cut always leaves either the old or the new capture.
+ * Slots are reused round-robin, oldest first.
+ *
+ * Rollups: qspiRec_addFeatures() takes each feature window
+ * (TelemetryFrame_Features_t) and keeps min, max and mean per channel and
+ * feature over 1 s, 1 min and 1 h intervals of the rollup clock. Each closed
+ * interval is one record in its tier's segment, a ring of whole sectors;
+ * the 1 min and 1 h records are built from the records below them, so a
+ * record dropped for a full queue still counts upwards. The sector a
+ * record enters is erased just before its first slot is programmed, which
+ * costs the segment its oldest sector only. A RAM index holds the time of
+ * the first record of every sector, so qspiRec_queryRollups() finds the
+ * start of a range from the index and at most one sector of headers.
+ * The rollup clock counts seconds; it resumes after the newest stored
+ * record at qspiRec_init() and only moves forward, so the times of a tier
+ * never decrease. qspiRec_setClock() sets it, e.g. to Unix time from the
+ * gateway.
+ *
+ * Restart: qspiRec_init() finds the newest history page and capture, and
+ * resumes recording at the next sector boundary. That skips any page cut
+ * short by the power loss.
+ *
+ * Flash: any 3-byte-address SPI NOR with 4 KB sector erase (0x20), page
+ * program (0x02), fast read (0x0B) and status bit WIP, e.g. MT25QL128 or
+ * W25Q128. It runs single-line at up to QSPI_REC_MAX_CLOCK_HZ, well above
+ * the 48 kB/s of the 4 kHz stream. Pins: PB2 CLK, PB6 NCS, PF8/PF9/PF7/PF6
+ * IO0-IO3. The Nucleo-F746ZG has no QSPI flash, so one must be wired to the
+ * morpho headers.
+ *
+ * Concurrency model:
+ *   - qspiRec_pushBlock(): block callback (DMA interrupt), the producer.
+ *   - everything else: main loop. Each flash command is a few us of
+ *     polling; erase and program completion is checked, never waited for.
+ *   - rollup intervals, their queues and the rollup clock are only touched
+ *     with interrupts masked, so callers in different tasks (the features
+ *     report, the poll, the host commands) never see half an interval.
+ *
+ * Usage Example:
+ *   qspiRec_init();
+ *
+ *   // block callback
+ *   qspiRec_pushBlock(block, frame_count);
+ *
+ *   // main loop
+ *   qspiRec_poll();
+ *   if (adcTrigger_getCapture(&event, &frames) == HAL_OK) {
+ *     qspiRec_commitCapture(event, frames);
+ *     // ... re-arm once !qspiRec_isCommitting()
+ *   }
+ *
+ *   // every stats window, then later a range of 1 min records
+ *   qspiRec_addFeatures(&features);
+ *   qspiRec_queryRollups(QSPI_REC_TIER_1MIN, from_s, to_s, &query);
+ *   while (qspiRec_nextRollup(&query, &record) != HAL_ERROR) {
+ *     // ... HAL_OK: send record; HAL_BUSY: retry on the next pass
+ *   }
+ *
+ ******************************************************************************
+ */
+
+#ifndef QSPI_RECORDER_H
+#define QSPI_RECORDER_H
+
+#include "adc_conversions.h"
+#include "adc_trigger.h"
+#include "telemetry_frame.h"
+#include "stm32f7xx_hal.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+
+/**
+ * @brief Flash size in bytes (power of two), 16 MB = 128 Mbit
+ */
+#ifndef QSPI_REC_FLASH_SIZE
+#define QSPI_REC_FLASH_SIZE (16UL * 1024UL * 1024UL)
+#endif
+
+/**
+ * @brief Highest QSPI clock; the prescaler is picked from HCLK at init
+ */
+#ifndef QSPI_REC_MAX_CLOCK_HZ
+#define QSPI_REC_MAX_CLOCK_HZ 50000000UL
+#endif
+
+/**
+ * @brief Capture slots at the top of the flash
+ */
+#ifndef QSPI_REC_CAPTURE_SLOTS
+#define QSPI_REC_CAPTURE_SLOTS 8U
+#endif
+
+/**
+ * @brief History pages buffered in SRAM (256 bytes each)
+ */
+#ifndef QSPI_REC_STAGE_PAGES
+#define QSPI_REC_STAGE_PAGES 64U
+#endif
+
+/**
+ * @brief History sectors kept erased ahead of the write position
+ */
+#ifndef QSPI_REC_ERASE_AHEAD
+#define QSPI_REC_ERASE_AHEAD 2U
+#endif
+
+/**
+ * @brief Set to 1 to give the feature rollups their segments; this moves
+ *        the capture slots, so the first boot with it starts afresh
+ */
+#ifndef QSPI_REC_ROLLUP_ENABLE
+#define QSPI_REC_ROLLUP_ENABLE 0
+#endif
+
+/**
+ * @brief Segment sizes in sectors, 8 records each: 68 min of 1 s, 17 h of
+ *        1 min and 21 days of 1 h records (2.75 MB)
+ */
+#ifndef QSPI_REC_ROLLUP_SECTORS_1S
+#define QSPI_REC_ROLLUP_SECTORS_1S 512U
+#endif
+#ifndef QSPI_REC_ROLLUP_SECTORS_1MIN
+#define QSPI_REC_ROLLUP_SECTORS_1MIN 128U
+#endif
+#ifndef QSPI_REC_ROLLUP_SECTORS_1H
+#define QSPI_REC_ROLLUP_SECTORS_1H 64U
+#endif
+
+/**
+ * @brief Closed records waiting for the flash, per tier
+ */
+#ifndef QSPI_REC_ROLLUP_QUEUE
+#define QSPI_REC_ROLLUP_QUEUE 4U
+#endif
+
+#define QSPI_REC_PAGE_SIZE 256U
+#define QSPI_REC_SECTOR_SIZE 4096U
+#define QSPI_REC_PAGE_HEADER 16U
+#define QSPI_REC_PAGE_FRAMES                                                   \
+  ((QSPI_REC_PAGE_SIZE - QSPI_REC_PAGE_HEADER) /                               \
+   (ADC_CONVERSIONS_CHANNEL_COUNT * 2U))
+#define QSPI_REC_CAPTURE_MAGIC 0x58424B42U ///< "BKBX"
+#define QSPI_REC_COMMIT 0x54494D43U        ///< "CMIT"
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief One history page as stored in the flash, little-endian
+ *
+ * An erased page reads sequence 0xFFFFFFFF.
+ */
+typedef struct {
+  uint16_t crc;         ///< CRC-16/CCITT of bytes 2..255
+  uint16_t frame_count; ///< Frames used, up to QSPI_REC_PAGE_FRAMES
+  uint32_t sequence;    ///< Page number since the flash was first used
+  uint32_t first_frame; ///< Sequence number of the first frame
+  uint32_t time_ms;     ///< HAL tick of the first frame's block
+  /// frame_count frames in channel order, the rest unused
+  uint16_t samples[(QSPI_REC_PAGE_SIZE - QSPI_REC_PAGE_HEADER) / 2U];
+} QspiRec_Page_t;
+
+/**
+ * @brief Capture slot header, first page of the slot, little-endian
+ *
+ * Followed from the next page on by frame_count ADC_Frame_t.
+ */
+typedef struct {
+  uint32_t magic;         ///< QSPI_REC_CAPTURE_MAGIC
+  uint32_t sequence;      ///< Capture number, +1 per commit
+  uint32_t trigger_frame; ///< Frame number of the trigger
+  uint32_t first_frame;   ///< Frame number of capture frame 0
+  uint32_t timestamp;     ///< HAL tick of the trigger
+  uint32_t history_page;  ///< History page being filled at the commit
+  uint16_t pre_frames;    ///< Frames before the trigger
+  uint16_t frame_count;   ///< Frames in the capture
+  uint16_t value;         ///< Sample, slope or RMS that fired
+  uint8_t channel;        ///< Channel that fired
+  uint8_t condition;      ///< ADC_TriggerCondition_t
+  uint16_t frame_size;    ///< sizeof(ADC_Frame_t)
+  uint8_t channels;       ///< Samples per frame
+  uint8_t reserved;
+  uint32_t data_crc;      ///< CRC-32 of the frames
+  uint32_t header_crc;    ///< CRC-32 of the fields above
+  uint32_t commit;        ///< QSPI_REC_COMMIT, programmed last
+} QspiRec_CaptureHeader_t;
+
+/**
+ * @brief Rollup resolutions
+ */
+typedef enum {
+  QSPI_REC_TIER_1S = 0,
+  QSPI_REC_TIER_1MIN,
+  QSPI_REC_TIER_1H,
+  QSPI_REC_TIER_COUNT
+} QspiRec_Tier_t;
+
+/**
+ * @brief One rollup record as stored in the flash, little-endian
+ *
+ * A channel outside channel_mask had no window in the interval; its values
+ * are 0. An erased slot reads time_s 0xFFFFFFFF.
+ */
+typedef struct {
+  uint16_t crc;          ///< CRC-16/CCITT of the bytes after it
+  uint8_t tier;          ///< QspiRec_Tier_t
+  uint8_t channels;      ///< ADC_CONVERSIONS_CHANNEL_COUNT
+  uint32_t time_s;       ///< Start of the interval, rollup clock
+  uint32_t windows;      ///< Feature windows in the interval
+  uint32_t channel_mask; ///< Channels with values
+  float min[ADC_CONVERSIONS_CHANNEL_COUNT][TELEMETRY_FRAME_FEATURES];
+  float max[ADC_CONVERSIONS_CHANNEL_COUNT][TELEMETRY_FRAME_FEATURES];
+  float mean[ADC_CONVERSIONS_CHANNEL_COUNT][TELEMETRY_FRAME_FEATURES];
+} QspiRec_Rollup_t;
+
+/**
+ * @brief Range read in progress; fields are the recorder's
+ */
+typedef struct {
+  uint8_t tier;
+  uint32_t slot;    ///< Next slot to read
+  uint32_t left;    ///< Slots before the writer's
+  uint32_t from_s;  ///< Range, [from_s, to_s)
+  uint32_t to_s;
+} QspiRec_RollupQuery_t;
+
+/**
+ * @brief Rollup statistics
+ */
+typedef struct {
+  uint32_t clock_s;                      ///< Rollup clock now
+  uint32_t records[QSPI_REC_TIER_COUNT]; ///< Records written since init
+  uint32_t capacity[QSPI_REC_TIER_COUNT]; ///< Record slots per segment
+  uint32_t oldest_s[QSPI_REC_TIER_COUNT]; ///< 0xFFFFFFFF = none held
+  uint32_t newest_s[QSPI_REC_TIER_COUNT];
+  uint32_t dropped;                      ///< Records lost to a full queue
+} QspiRec_RollupStats_t;
+
+/**
+ * @brief Recorder statistics
+ */
+typedef struct {
+  uint8_t ready;            ///< Flash found and recording
+  uint32_t history_pages;   ///< Ring size in pages
+  uint32_t pages_written;   ///< History pages programmed since init
+  uint32_t frames_dropped;  ///< Frames lost to a full staging ring
+  uint32_t erases;          ///< Sector erases issued
+  uint32_t captures;        ///< Captures committed since init
+  uint32_t flash_errors;    ///< Failed QSPI commands
+  uint32_t stage_high_water;///< Most staging pages in use
+} QspiRec_Stats_t;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief Bring up QUADSPI, check the flash and resume the ring
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Recording (pages are accepted from now on)
+ *   @retval HAL_ERROR QSPI error, or no flash answering its JEDEC ID
+ */
+HAL_StatusTypeDef qspiRec_init(void);
+
+/**
+ * @brief Stage one DMA block into history pages
+ *
+ * @param block       Block as given to the block callback
+ * @param frame_count Frames in the block
+ *
+ * @note Call from the block callback; does nothing before qspiRec_init()
+ */
+void qspiRec_pushBlock(const uint16_t *block, uint32_t frame_count);
+
+/**
+ * @brief Issue the next erase or program once the flash is idle
+ * @note Call from the main loop
+ */
+void qspiRec_poll(void);
+
+/**
+ * @brief Start committing a frozen trigger capture to the next slot
+ *
+ * @param event  Capture event
+ * @param frames event->frame_count frames; must stay valid (capture
+ *               frozen) until qspiRec_isCommitting() returns 0
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Commit started
+ *   @retval HAL_BUSY  Previous commit still running
+ *   @retval HAL_ERROR Recorder not ready, NULL pointer or capture too large
+ */
+HAL_StatusTypeDef qspiRec_commitCapture(const ADC_TriggerEvent_t *event,
+                                        const ADC_Frame_t *frames);
+
+/**
+ * @brief Whether a capture commit is still running
+ */
+uint8_t qspiRec_isCommitting(void);
+
+/**
+ * @brief Read a history page back
+ *
+ * @param age  0 = newest page in the flash, 1 = the one before, ...
+ * @param page Destination
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Page valid
+ *   @retval HAL_BUSY  Flash busy with an erase or program, retry
+ *   @retval HAL_ERROR Not recorded, erased or CRC mismatch
+ */
+HAL_StatusTypeDef qspiRec_readHistory(uint32_t age, QspiRec_Page_t *page);
+
+/**
+ * @brief Read a committed capture back
+ *
+ * @param age        0 = newest capture, 1 = the one before, ...
+ * @param header     Destination for the header
+ * @param frames     Destination for the frames, NULL = header only
+ * @param max_frames Room in frames
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Capture valid; min(frame_count, max_frames) read
+ *   @retval HAL_BUSY  Flash busy with an erase or program, retry
+ *   @retval HAL_ERROR No such capture, not committed, or data CRC
+ *                     mismatch
+ */
+HAL_StatusTypeDef qspiRec_readCapture(uint32_t age,
+                                      QspiRec_CaptureHeader_t *header,
+                                      ADC_Frame_t *frames,
+                                      uint16_t max_frames);
+
+/**
+ * @brief Add one feature window to the open 1 s, 1 min and 1 h intervals
+ *
+ * @param features Window values, timestamp = HAL tick of the window
+ *
+ * @note Main loop; does nothing without QSPI_REC_ROLLUP_ENABLE or before
+ *       qspiRec_init()
+ */
+void qspiRec_addFeatures(const TelemetryFrame_Features_t *features);
+
+/**
+ * @brief Set the rollup clock
+ *
+ * @param time_s Seconds now, e.g. Unix time
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Set
+ *   @retval HAL_ERROR Behind the clock (the times of a tier never go back),
+ *                     or built without QSPI_REC_ROLLUP_ENABLE
+ */
+HAL_StatusTypeDef qspiRec_setClock(uint32_t time_s);
+
+/**
+ * @brief Rollup clock now, in seconds
+ */
+uint32_t qspiRec_getClock(void);
+
+/**
+ * @brief Start reading the records of a tier whose interval starts in a
+ *        range, oldest first
+ *
+ * @param tier   Resolution
+ * @param from_s First second of the range
+ * @param to_s   One past its last second
+ * @param query  Cursor for qspiRec_nextRollup()
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Cursor set (it may find nothing)
+ *   @retval HAL_BUSY  Flash busy with an erase or program, retry
+ *   @retval HAL_ERROR Not ready, no rollups, NULL pointer or bad tier
+ */
+HAL_StatusTypeDef qspiRec_queryRollups(QspiRec_Tier_t tier, uint32_t from_s,
+                                       uint32_t to_s,
+                                       QspiRec_RollupQuery_t *query);
+
+/**
+ * @brief Read the next record of a range
+ *
+ * @param query  Cursor from qspiRec_queryRollups()
+ * @param record Destination
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Record read
+ *   @retval HAL_BUSY  Flash busy with an erase or program, retry
+ *   @retval HAL_ERROR No more records in the range
+ */
+HAL_StatusTypeDef qspiRec_nextRollup(QspiRec_RollupQuery_t *query,
+                                     QspiRec_Rollup_t *record);
+
+/**
+ * @brief Get the rollup statistics
+ *
+ * @param stats Destination
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer
+ */
+HAL_StatusTypeDef qspiRec_getRollupStats(QspiRec_RollupStats_t *stats);
+
+/**
+ * @brief Get recorder statistics
+ *
+ * @param stats Destination
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer
+ */
+HAL_StatusTypeDef qspiRec_getStats(QspiRec_Stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* QSPI_RECORDER_H */
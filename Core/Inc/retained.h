@@ -0,0 +1,277 @@
+/**
+ ******************************************************************************
+ * @file    retained.h
+ * @brief   Lifetime counters and crash breadcrumbs in the backup SRAM,
+ *          kept across resets and updated at RAM speed
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * ADC_ErrorInfo_t and the loss counters start from zero at every boot;
+ * the flash store (config_store.h) is far too slow and wears too fast to
+ * keep them. This block sits at the top of the backup SRAM, above the
+ * event log's banks (event_log.h), and survives resets, watchdogs and,
+ * with VBAT, a loss of VDD:
+ *   - counters (boots, reset causes, faults, losses) and the ADC error
+ *     matrix of the default instance, each word stored next to its
+ *     complement: an update is two stores in a masked section, from any
+ *     context; a pair a reset tore apart is repaired to its last
+ *     complete value at the next boot
+ *   - breadcrumbs: the main loop marks where it is (id, value, tick) in a
+ *     ring of RETAINED_MARKS, each with an 8-bit check; after a hang and
+ *     a watchdog reset the previous boot's last marks say where it stopped
+ *   - fault records: the HardFault, MemManage, BusFault and UsageFault
+ *     handlers (naked, in stm32f7xx_it.c) hand over the stacked frame;
+ *     PC, LR, xPSR, the fault status and address registers go into a ring
+ *     of RETAINED_FAULT_RECORDS, each sealed by a CRC-32
+ *
+ * The header (magic, layout, CRC-32) is checked at retained_init(): a
+ * mismatch (first power-up, VBAT lost, a build with another layout)
+ * clears the block. Nothing is ever written to flash.
+ *
+ * Usage Example:
+ *   retained_init();             // before eventLog_init(): reset flags
+ *
+ *   // any context
+ *   retained_add(RETAINED_OVERRUN_FRAMES, frames_lost);
+ *
+ *   // main loop
+ *   retained_mark(RETAINED_MARK_PIPELINE, block_sequence);
+ *
+ *   Retained_Fault_t fault;
+ *   for (uint8_t i = 0; retained_getFault(i, &fault) == HAL_OK; i++) {
+ *     report(&fault);            // newest first
+ *   }
+ *
+ * @note Takes the top RETAINED_BACKUP_BYTES of the 4 KB backup SRAM; the
+ *       event log keeps the rest. The backup domain is enabled here and in
+ *       eventLog_init(), whichever runs first.
+ ******************************************************************************
+ */
+
+#ifndef RETAINED_H
+#define RETAINED_H
+
+#include "adc_conversions.h"
+#include "stm32f7xx_hal.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+
+/**
+ * @brief Bytes taken at the top of the backup SRAM
+ */
+#define RETAINED_BACKUP_BYTES 768U
+
+/**
+ * @brief Breadcrumbs kept (power of two)
+ */
+#ifndef RETAINED_MARKS
+#define RETAINED_MARKS 8U
+#endif
+
+/**
+ * @brief Fault records kept, the oldest overwritten
+ */
+#ifndef RETAINED_FAULT_RECORDS
+#define RETAINED_FAULT_RECORDS 4U
+#endif
+
+/**
+ * @brief Set to 0 to halt in a fault handler once recorded, as before;
+ *        1 resets unless a debugger is attached
+ */
+#ifndef RETAINED_FAULT_RESET
+#define RETAINED_FAULT_RESET 1
+#endif
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief Counters
+ */
+typedef enum {
+  RETAINED_BOOTS = 0,       ///< retained_init() calls
+  RETAINED_RESET_POWER,     ///< Power-on or brown-out reset
+  RETAINED_RESET_PIN,       ///< NRST pin only
+  RETAINED_RESET_SOFTWARE,  ///< NVIC_SystemReset(), fault resets included
+  RETAINED_RESET_IWDG,      ///< Independent watchdog
+  RETAINED_RESET_WWDG,      ///< Window watchdog
+  RETAINED_RESET_LOWPOWER,  ///< Illegal STOP/STANDBY entry
+  RETAINED_FAULTS,          ///< Fault records written
+  RETAINED_ERRORS,          ///< Errors of the ADC matrix, all rows
+  RETAINED_OVERRUN_FRAMES,  ///< Frames lost in repaired overruns
+  RETAINED_DROPPED_BLOCKS,  ///< Blocks dropped by a slow consumer
+  RETAINED_COUNTER_COUNT
+} Retained_Counter_t;
+
+/**
+ * @brief Breadcrumb ids
+ */
+typedef enum {
+  RETAINED_MARK_NONE = 0,
+  RETAINED_MARK_PIPELINE,    ///< Block processing, value = ring sequence
+  RETAINED_MARK_HOUSEKEEPING, ///< Commands, reports, TX queue
+  RETAINED_MARK_ERROR,       ///< Error_Handler(), value = caller
+  RETAINED_MARK_COUNT
+} Retained_MarkId_t;
+
+/**
+ * @brief Fault kinds (the active exception number)
+ */
+typedef enum {
+  RETAINED_FAULT_HARD = 3,
+  RETAINED_FAULT_MEMMANAGE = 4,
+  RETAINED_FAULT_BUS = 5,
+  RETAINED_FAULT_USAGE = 6
+} Retained_FaultKind_t;
+
+/**
+ * @brief One breadcrumb
+ */
+typedef struct {
+  uint16_t seq;   ///< Sequence number in its boot, low 16 bits
+  uint8_t id;     ///< Retained_MarkId_t
+  uint8_t check;  ///< XOR of the other bytes, 0xA5 seeded
+  uint32_t tick;  ///< HAL tick (ms)
+  uint32_t value; ///< Id-specific
+} Retained_Mark_t;
+
+/**
+ * @brief One fault record
+ */
+typedef struct {
+  uint32_t kind;       ///< Retained_FaultKind_t
+  uint32_t boot;       ///< RETAINED_BOOTS when it happened
+  uint32_t tick;       ///< HAL tick (ms)
+  uint32_t exc_return; ///< EXC_RETURN: stack, mode, FPU frame
+  uint32_t pc;         ///< Stacked PC, 0 if the stack was unusable
+  uint32_t lr;         ///< Stacked LR
+  uint32_t xpsr;       ///< Stacked xPSR
+  uint32_t sp;         ///< Stack pointer the frame was read from
+  uint32_t cfsr;       ///< Configurable fault status
+  uint32_t hfsr;       ///< HardFault status
+  uint32_t mmfar;      ///< MemManage address (valid per CFSR.MMARVALID)
+  uint32_t bfar;       ///< BusFault address (valid per CFSR.BFARVALID)
+  uint32_t crc;        ///< CRC-32 of the words above
+} Retained_Fault_t;
+
+/**
+ * @brief State of the block
+ */
+typedef struct {
+  uint8_t restored;     ///< 1 = found valid at boot, 0 = cleared
+  uint8_t vbat;         ///< 1 = backup regulator on, kept without VDD
+  uint8_t marks;        ///< Previous boot's breadcrumbs kept
+  uint8_t faults;       ///< Valid fault records
+  uint32_t repaired;    ///< Torn counters repaired at boot
+  uint32_t reset_flags; ///< RCC CSR at boot
+} Retained_Stats_t;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief Enable the backup SRAM, check or clear the block, count the boot
+ *        and its reset cause, keep the previous boot's breadcrumbs
+ *
+ * Before eventLog_init(), which clears the reset flags. Counters updated
+ * before it are not kept.
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK      Kept on VBAT
+ *   @retval HAL_TIMEOUT Backup regulator not ready: kept across resets
+ *                       but not a loss of VDD
+ */
+HAL_StatusTypeDef retained_init(void);
+
+/**
+ * @brief Add to a counter, saturating (any context)
+ */
+void retained_add(Retained_Counter_t counter, uint32_t n);
+
+/**
+ * @brief Count one error of the ADC matrix (any context)
+ *
+ * @param row  Channel, or ADC_ERROR_ROW_SCAN
+ * @param kind ADC_ErrorKind_t
+ */
+void retained_countAdcError(uint8_t row, ADC_ErrorKind_t kind);
+
+/**
+ * @brief Get a counter, 0 before retained_init()
+ */
+uint32_t retained_get(Retained_Counter_t counter);
+
+/**
+ * @brief Lifetime ADC error matrix (last_error_status HAL_OK,
+ *        last_failed_channel 0xFF: not kept)
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer
+ */
+HAL_StatusTypeDef retained_getAdcErrors(ADC_ErrorInfo_t *error_info);
+
+/**
+ * @brief Leave a breadcrumb (main loop, or one context only)
+ */
+void retained_mark(Retained_MarkId_t id, uint32_t value);
+
+/**
+ * @brief The previous boot's breadcrumbs, oldest first
+ *
+ * @param marks Destination, RETAINED_MARKS entries
+ *
+ * @return Number copied
+ */
+uint8_t retained_getPreviousMarks(Retained_Mark_t *marks);
+
+/**
+ * @brief Get a fault record
+ *
+ * @param index 0 = newest
+ * @param fault Destination
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Copied, CRC valid
+ *   @retval HAL_BUSY  No such record, or its CRC failed
+ *   @retval HAL_ERROR NULL pointer
+ */
+HAL_StatusTypeDef retained_getFault(uint8_t index, Retained_Fault_t *fault);
+
+/**
+ * @brief Short name of a breadcrumb id ("pipeline", ...)
+ */
+const char *retained_getMarkName(Retained_MarkId_t id);
+
+/**
+ * @brief Clear counters, matrix and fault records (not the boot count)
+ */
+void retained_clear(void);
+
+/**
+ * @brief Get the state of the block
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer
+ */
+HAL_StatusTypeDef retained_getStats(Retained_Stats_t *stats);
+
+/**
+ * @brief Fault handler body, entered from the naked fault handlers with
+ *        the stacked frame and EXC_RETURN; records the fault, then resets
+ *        (RETAINED_FAULT_RESET) or halts. Does not return.
+ */
+void retained_fault(const uint32_t *frame, uint32_t exc_return);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RETAINED_H */
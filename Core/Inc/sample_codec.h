@@ -0,0 +1,163 @@
+/**
+ ******************************************************************************
+ * @file    sample_codec.h
+ * @brief   Lossless codec for 12-bit sample streams (fixed predictor + Rice)
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * Compresses one channel of up to SAMPLE_CODEC_MAX_SAMPLES samples at a
+ * time, in the FLAC style:
+ *   1. Fixed predictor of order 0, 1 or 2, whichever gives the smallest
+ *      sum of |residual| for this run:
+ *        order 0  e[n] = x[n] - 2048
+ *        order 1  e[n] = x[n] - x[n-1]
+ *        order 2  e[n] = x[n] - 2 x[n-1] + x[n-2]
+ *   2. Zigzag mapping, u = 2e for e >= 0 and -2e - 1 for e < 0.
+ *   3. Rice code with a parameter k from the mean of u: q = u >> k ones,
+ *      a zero, then the k low bits. A q of SAMPLE_CODEC_ESCAPE or more is
+ *      sent as SAMPLE_CODEC_ESCAPE ones and u in 16 bits.
+ * If the Rice bits would exceed 12 bits per sample, the run is stored
+ * verbatim instead. So the output never grows by more than one byte.
+ *
+ * Stream (bits MSB first, zero padded to a byte):
+ *
+ *   u8   order << 4 | k         k = 15: verbatim
+ *   12   x[0] .. x[order-1]     warm-up samples (verbatim: all samples)
+ *   ...  Rice codes of u[order] .. u[count-1]
+ *
+ * Input samples may be interleaved (stride), so one channel is read straight
+ * out of a DMA block or a frame array. The run length is not stored; the
+ * container carries it. Accelerometer data at 4 kHz typically needs 4-6
+ * bits per sample, about 2-3x smaller than 12-bit packing.
+ *
+ * Usage Example:
+ *   uint8_t out[SAMPLE_CODEC_MAX_BYTES(256)];
+ *   uint32_t len;
+ *   // channel ch of a DMA block
+ *   sampleCodec_encode(&block[slot], 256, ADC_CONVERSIONS_CHANNEL_COUNT,
+ *                      out, sizeof(out), &len);
+ *   sampleCodec_decode(out, len, 256, decoded, 1);
+ *
+ ******************************************************************************
+ */
+
+#ifndef SAMPLE_CODEC_H
+#define SAMPLE_CODEC_H
+
+#include "stm32f7xx_hal.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+
+/**
+ * @brief Longest run per call
+ */
+#define SAMPLE_CODEC_MAX_SAMPLES 256U
+
+/**
+ * @brief Unary length that switches a residual to the 16-bit escape
+ */
+#define SAMPLE_CODEC_ESCAPE 24U
+
+/**
+ * @brief k value marking a verbatim run
+ */
+#define SAMPLE_CODEC_VERBATIM 15U
+
+/**
+ * @brief Worst-case encoded size of a run of n samples
+ */
+#define SAMPLE_CODEC_MAX_BYTES(n) (1U + ((n) * 12U + 7U) / 8U)
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief Running totals since the last reset
+ */
+typedef struct {
+  uint32_t runs;          ///< Runs encoded
+  uint32_t samples;       ///< Samples encoded
+  uint32_t bytes;         ///< Encoded bytes, parameter bytes included
+  uint32_t verbatim_runs; ///< Runs stored verbatim
+  uint32_t order_runs[3]; ///< Runs per predictor order
+} SampleCodec_Stats_t;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief Compress one run of 12-bit samples
+ *
+ * @param samples First sample
+ * @param count   Samples in the run, 1..SAMPLE_CODEC_MAX_SAMPLES
+ * @param stride  Distance between samples in uint16_t (1 = contiguous)
+ * @param out     Destination
+ * @param cap     Size of out, SAMPLE_CODEC_MAX_BYTES(count) always fits
+ * @param out_len Encoded length in bytes
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer, bad count or stride, buffer too small
+ *
+ * @note Samples above 4095 are clipped.
+ */
+HAL_StatusTypeDef sampleCodec_encode(const uint16_t *samples, uint32_t count,
+                                     uint32_t stride, uint8_t *out,
+                                     uint32_t cap, uint32_t *out_len);
+
+/**
+ * @brief sampleCodec_encode() counted into other totals
+ *
+ * For a second user of the codec, such as an interrupt, whose runs must
+ * not mix with the running totals: same parameters and results, plus
+ *
+ * @param stats Totals to add the run to, NULL = none
+ */
+HAL_StatusTypeDef
+sampleCodec_encodeCounted(const uint16_t *samples, uint32_t count,
+                          uint32_t stride, uint8_t *out, uint32_t cap,
+                          uint32_t *out_len, SampleCodec_Stats_t *stats);
+
+/**
+ * @brief Expand one run produced by sampleCodec_encode()
+ *
+ * @param in      Encoded run
+ * @param len     Bytes in the run
+ * @param count   Samples in the run
+ * @param samples Destination
+ * @param stride  Distance between samples in uint16_t
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer, bad parameters or truncated run
+ */
+HAL_StatusTypeDef sampleCodec_decode(const uint8_t *in, uint32_t len,
+                                     uint32_t count, uint16_t *samples,
+                                     uint32_t stride);
+
+/**
+ * @brief Get the running totals (compression ratio = samples * 1.5 / bytes)
+ *
+ * @param stats Destination
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer
+ */
+HAL_StatusTypeDef sampleCodec_getStats(SampleCodec_Stats_t *stats);
+
+/**
+ * @brief Clear the running totals
+ */
+void sampleCodec_resetStats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SAMPLE_CODEC_H */
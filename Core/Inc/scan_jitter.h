@@ -0,0 +1,144 @@
+/**
+ ******************************************************************************
+ * @file    scan_jitter.h
+ * @brief   Scan trigger period jitter, captured in hardware on TIM3
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * The timing packet bounds the jitter of the block stamps, which is mostly
+ * DMA interrupt latency; it says nothing about when each conversion
+ * started. Here TIM3 input-captures the scan trigger itself: channel 1
+ * takes TRC, TIM2 TRGO on ITR1, so every TIM2 update (one per scan) latches
+ * the free-running TIM3 count, and DMA1 Stream4 (TIM3_CH1, channel 5)
+ * copies it into a circular buffer. No interrupt runs and no code sits in
+ * the path, so the stamps are exact to one tick of the APB1 timer clock
+ * (9.3 ns at 108 MHz) whatever the load. TIM2 and TIM3 share that clock,
+ * so an interval is the trigger period as the ADCs saw it. Below about
+ * 3.3 kHz TIM3 is prescaled so that a period fits 15 bits of its count; a
+ * rate change starts the window again at the new prescaler.
+ *
+ * scanJitter_poll() turns the stamps into intervals and keeps, per
+ * measurement window: the count, min, max, mean and rms deviation from the
+ * mean. The ADC samples conversion k at a fixed number of ADC clocks after
+ * trigger k, so these are the sampling jitter up to one ADC clock of
+ * synchronisation (74 ns at 13.5 MHz). time_sync.h dithers ARR by one tick
+ * to spread a fractional period, which shows as about 0.5 tick rms. A
+ * tone at f seen through a jitter of s rms is noisy at -20 log10(2 pi f s)
+ * dBc, so ScanJitter_Stats_t.snr_db (at half the scan rate, the worst
+ * tone) set against the 74 dB of a 12-bit ADC says whether the timing or
+ * the converter sets the spectrum's noise floor.
+ *
+ * The triggers counted are also set against the frames the DMA delivered
+ * (lag): a trigger the ADC missed because it was still converting keeps
+ * the lag growing, where a healthy scan keeps it below a block.
+ *
+ * Usage Example:
+ *   analogSensor_startTimedDMA(4000U);
+ *   scanJitter_start();
+ *
+ *   scanJitter_poll();                 // main loop, at least every 50 ms
+ *
+ *   ScanJitter_Stats_t js;
+ *   scanJitter_getStats(&js);          // js.rms_ns, js.snr_db, ...
+ *   scanJitter_resetWindow();          // next window
+ *
+ * @note TIM3 and DMA1 Stream4 are taken while SCAN_JITTER_ENABLE is set,
+ *       so it excludes TACH_ENABLE. Only a TIM2-paced scan is measured.
+ ******************************************************************************
+ */
+
+#ifndef SCAN_JITTER_H
+#define SCAN_JITTER_H
+
+#include "stm32f7xx_hal.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+
+/**
+ * @brief Set to 1 to build the trigger capture (takes TIM3 and DMA1
+ *        Stream4)
+ */
+#ifndef SCAN_JITTER_ENABLE
+#define SCAN_JITTER_ENABLE 0
+#endif
+
+/**
+ * @brief Stamps in the DMA buffer, a power of two: 64 ms at 4 kHz between
+ *        two scanJitter_poll() calls
+ */
+#ifndef SCAN_JITTER_STAMPS
+#define SCAN_JITTER_STAMPS 256U
+#endif
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief Trigger intervals of the current window
+ */
+typedef struct {
+  uint8_t running;        ///< Capture started
+  uint32_t tick_hz;       ///< TIM3 count rate
+  uint32_t nominal_ticks; ///< Programmed TIM2 period, in TIM3 ticks
+  uint32_t intervals;     ///< Intervals in the window
+  uint32_t min_ticks;     ///< Shortest interval
+  uint32_t max_ticks;     ///< Longest interval
+  float mean_ns;          ///< Mean interval
+  float rms_ns;           ///< Rms deviation from the mean
+  float pp_ns;            ///< Longest minus shortest interval
+  float snr_db;           ///< Jitter-limited SNR of a tone at half the rate
+  uint32_t triggers;      ///< Stamps since scanJitter_start()
+  int32_t lag;            ///< Triggers minus frames delivered since then
+  uint32_t overruns;      ///< Polls too late: the buffer had wrapped
+} ScanJitter_Stats_t;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief Start capturing the TIM2 trigger, with an empty window
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Capturing
+ *   @retval HAL_BUSY  TIM2 is not running: no timed scan
+ *   @retval HAL_ERROR Built without SCAN_JITTER_ENABLE, or the DMA failed
+ */
+HAL_StatusTypeDef scanJitter_start(void);
+
+/**
+ * @brief Stop the capture; the last window's statistics stay readable
+ */
+void scanJitter_stop(void);
+
+/**
+ * @brief Fold the new stamps into the window
+ *
+ * @note Call from the main loop, within SCAN_JITTER_STAMPS trigger periods;
+ *       a later call drops the stamps in the buffer (overruns)
+ */
+void scanJitter_poll(void);
+
+/**
+ * @brief Start a new window, keeping the capture and the trigger count
+ */
+void scanJitter_resetWindow(void);
+
+/**
+ * @brief Statistics of the current window
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success (intervals 0 before two stamps)
+ *   @retval HAL_ERROR NULL pointer
+ */
+HAL_StatusTypeDef scanJitter_getStats(ScanJitter_Stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SCAN_JITTER_H */
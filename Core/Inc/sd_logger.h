@@ -0,0 +1,307 @@
+/**
+ ******************************************************************************
+ * @file    sd_logger.h
+ * @brief   Gap-free raw block recorder on an SD card (SDMMC1, DMA)
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * The card is used as one raw, pre-allocated region instead of a file
+ * system, so the write path never looks up clusters or updates a FAT:
+ *
+ *   LBA SD_LOGGER_START_LBA       index sector (SdLogger_Index_t)
+ *   LBA SD_LOGGER_START_LBA + 1   record 0, record 1, ... to the card end
+ *
+ * A record is one DMA block: a 512-byte header sector (SdLogger_Record_t)
+ * followed by the raw samples, one sector per channel for 256 frames (6
+ * with the default table). The records are self-describing (session,
+ * index, first frame, timestamp), so a recording can be recovered even if
+ * the index was not updated last.
+ *
+ * Latency spikes: the block callback copies each block into a RAM ring of
+ * SD_LOGGER_SLOTS records, laid out exactly as on the card. The main loop
+ * sends every run of queued records as one multi-block DMA write straight
+ * from the ring. An SD card can stall for hundreds of ms while it
+ * reorganises its flash, and the ring covers that: 16 slots are 1 s at
+ * 4 kHz. Only a longer stall drops a block, which is counted and shows as
+ * a jump in first_frame.
+ *
+ * The index sector is rewritten every SD_LOGGER_INDEX_PERIOD_MS with the
+ * number of records written. Each start opens a new session number.
+ *
+ * Reading back: between sessions, sdLogger_openReader() lends the card to
+ * a reader (usb_msc.h) for multi-block DMA reads, sdLogger_read() /
+ * sdLogger_pollRead(). The one DMA stream serves both directions: the HAL
+ * sets it per transfer. Recording cannot start until sdLogger_closeReader().
+ *
+ * Hardware: SDMMC1 in 4-bit mode at 24 MHz on PC8-PC12 / PD2 (AF12). The
+ * clock is the 48 MHz CLK48 from PLLQ. A card socket has to be wired up:
+ * the Nucleo-F746ZG has none. The card is dedicated to the logger. Writing
+ * the raw region destroys any file system in it.
+ *
+ * Concurrency model:
+ *   - sdLogger_pushBlock(): block callback (DMA interrupt), the producer.
+ *   - sdLogger_poll(): main loop, starts writes.
+ *   - SDMMC / DMA2 Stream6 interrupts (SD_LOGGER_IRQ_PRIORITY): complete
+ *     them and release the slots, or end a read.
+ *   - The reader calls: main loop.
+ *
+ * Usage Example:
+ *   if (sdLogger_init() == HAL_OK) {
+ *     sdLogger_start(analogSensor_getSampleRate());
+ *   }
+ *
+ *   // block callback
+ *   sdLogger_pushBlock(block, frame_count);
+ *
+ *   // main loop
+ *   sdLogger_poll();
+ *
+ ******************************************************************************
+ */
+
+#ifndef SD_LOGGER_H
+#define SD_LOGGER_H
+
+#include "adc_conversions.h"
+#include "irq_priority.h"
+#include "stm32f7xx_hal.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+
+/**
+ * @brief First sector of the raw region (the first 4 MB stay untouched)
+ */
+#ifndef SD_LOGGER_START_LBA
+#define SD_LOGGER_START_LBA 8192U
+#endif
+
+/**
+ * @brief Records buffered in RAM (3.5 kB each)
+ */
+#ifndef SD_LOGGER_SLOTS
+#define SD_LOGGER_SLOTS 16U
+#endif
+
+/**
+ * @brief Most records per multi-block write
+ */
+#ifndef SD_LOGGER_MAX_BURST
+#define SD_LOGGER_MAX_BURST 8U
+#endif
+
+/**
+ * @brief Interval between index sector updates
+ */
+#ifndef SD_LOGGER_INDEX_PERIOD_MS
+#define SD_LOGGER_INDEX_PERIOD_MS 1000U
+#endif
+
+/**
+ * @brief SDMMC1 and its DMA stream (below the USB and telemetry links)
+ */
+#ifndef SD_LOGGER_IRQ_PRIORITY
+#define SD_LOGGER_IRQ_PRIORITY IRQ_PRIORITY_BULK
+#endif
+
+#define SD_LOGGER_SECTOR_SIZE 512U
+#define SD_LOGGER_MAGIC 0x474F4C41U  ///< "ALOG"
+#define SD_LOGGER_VERSION 1U
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief Index sector, little-endian, zero padded to 512 bytes
+ */
+typedef struct {
+  uint32_t magic;          ///< SD_LOGGER_MAGIC
+  uint16_t version;        ///< SD_LOGGER_VERSION
+  uint16_t record_sectors; ///< Sectors per record, header included
+  uint32_t session;        ///< Incremented at every start
+  uint32_t sample_rate_hz; ///< Frame rate of the recording
+  uint16_t block_frames;   ///< Frames per record
+  uint8_t channels;        ///< Samples per frame
+  uint8_t slot_map[ADC_CONVERSIONS_CHANNEL_COUNT]; ///< Channel per slot
+  uint32_t data_lba;       ///< First sector of record 0
+  uint32_t capacity;       ///< Records that fit on the card
+  uint32_t records;        ///< Records written when the index was updated
+  uint32_t dropped;        ///< Blocks lost to a full ring so far
+  uint64_t start_time;     ///< timebase_now() at the start
+} SdLogger_Index_t;
+
+/**
+ * @brief Header sector in front of every record
+ */
+typedef struct {
+  uint32_t magic;       ///< SD_LOGGER_MAGIC
+  uint32_t session;     ///< Session of the index sector
+  uint32_t record;      ///< Record number within the session
+  uint32_t first_frame; ///< Sequence number of the first frame
+  uint64_t timestamp;   ///< Block completion time (timebase ticks)
+  uint16_t frame_count; ///< Frames in the record
+  uint16_t reserved;
+  uint32_t dropped;     ///< Blocks dropped before this one, cumulative
+} SdLogger_Record_t;
+
+/**
+ * @brief Recorder state
+ */
+typedef enum {
+  SD_LOGGER_NO_CARD = 0, ///< Not initialised, or no card
+  SD_LOGGER_IDLE,        ///< Card ready, not recording
+  SD_LOGGER_RECORDING,   ///< Accepting blocks
+  SD_LOGGER_FULL,        ///< Region full, recording stopped
+  SD_LOGGER_ERROR        ///< Write failed repeatedly, recording stopped
+} SdLogger_State_t;
+
+/**
+ * @brief Recorder statistics
+ */
+typedef struct {
+  SdLogger_State_t state;
+  uint32_t session;      ///< Current or last session
+  uint32_t records;      ///< Records on the card this session
+  uint32_t capacity;     ///< Records that fit on the card
+  uint32_t dropped;      ///< Blocks lost to a full ring
+  uint32_t write_errors; ///< Failed writes (retried)
+  uint32_t high_water;   ///< Most ring slots in use
+  uint32_t max_write_ms; ///< Longest write, including card busy time
+  uint32_t sectors_read; ///< Sectors read back by a reader
+  uint32_t read_errors;  ///< Failed reads
+} SdLogger_Stats_t;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief Bring up SDMMC1 and the card in 4-bit mode and read the index
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Card ready (SD_LOGGER_IDLE)
+ *   @retval HAL_ERROR No card, card error, or card smaller than the region
+ */
+HAL_StatusTypeDef sdLogger_init(void);
+
+/**
+ * @brief Open a new session at record 0 and accept blocks
+ *
+ * @param sample_rate_hz Frame rate, stored in the index
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Recording
+ *   @retval HAL_BUSY  Already recording
+ *   @retval HAL_ERROR No card, or the index could not be written
+ */
+HAL_StatusTypeDef sdLogger_start(uint32_t sample_rate_hz);
+
+/**
+ * @brief Stop accepting blocks, write the queued ones and the final index
+ *
+ * @param timeout_ms Longest wait for the queue to drain
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK      Index up to date
+ *   @retval HAL_TIMEOUT Writes still pending after timeout_ms
+ */
+HAL_StatusTypeDef sdLogger_stop(uint32_t timeout_ms);
+
+/**
+ * @brief Queue one DMA block
+ *
+ * @param block       Block as given to the block callback
+ * @param frame_count Frames in the block
+ *
+ * @note Call from the block callback; does nothing unless recording
+ */
+void sdLogger_pushBlock(const uint16_t *block, uint32_t frame_count);
+
+/**
+ * @brief Start the next write (records or index) once the card is ready
+ * @note Call from the main loop
+ */
+void sdLogger_poll(void);
+
+/**
+ * @brief Get recorder statistics
+ *
+ * @param stats Destination
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer
+ */
+HAL_StatusTypeDef sdLogger_getStats(SdLogger_Stats_t *stats);
+
+/**
+ * @brief Index of the card: the session recording or last recorded
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Copied; records is up to date once stopped
+ *   @retval HAL_ERROR NULL pointer, no card, or no index on it
+ */
+HAL_StatusTypeDef sdLogger_getIndex(SdLogger_Index_t *index);
+
+/**
+ * @brief Lend the card to a reader
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    sdLogger_read() may be used
+ *   @retval HAL_BUSY  Recording, or writes still pending (sdLogger_stop())
+ *   @retval HAL_ERROR No card, or the recorder failed
+ */
+HAL_StatusTypeDef sdLogger_openReader(void);
+
+/**
+ * @brief Start a multi-block DMA read
+ *
+ * @param dst     Destination, 32-byte aligned, sectors x 512 bytes; its
+ *                cache lines are discarded
+ * @param lba     First card sector
+ * @param sectors Sectors, >= 1
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Started; sdLogger_pollRead() tells the end
+ *   @retval HAL_BUSY  A read in flight, or the card not ready yet
+ *   @retval HAL_ERROR No reader open, bad arguments, or the read refused
+ */
+HAL_StatusTypeDef sdLogger_read(uint8_t *dst, uint32_t lba, uint32_t sectors);
+
+/**
+ * @brief Outcome of the read started last
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Done, dst holds the sectors
+ *   @retval HAL_BUSY  Still in flight
+ *   @retval HAL_ERROR Failed, or no read started since the last outcome
+ */
+HAL_StatusTypeDef sdLogger_pollRead(void);
+
+/**
+ * @brief Take the card back from the reader
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Recording may start again
+ *   @retval HAL_BUSY  A read is still in flight
+ */
+HAL_StatusTypeDef sdLogger_closeReader(void);
+
+/**
+ * @brief SDMMC1 interrupt; call from SDMMC1_IRQHandler()
+ */
+void sdLogger_irqHandler(void);
+
+/**
+ * @brief SDMMC1 DMA interrupt; call from DMA2_Stream6_IRQHandler()
+ */
+void sdLogger_dmaIrqHandler(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SD_LOGGER_H */
@@ -0,0 +1,237 @@
+/**
+ ******************************************************************************
+ * @file    stage_deadline.h
+ * @brief   Per-block deadlines of the processing stages, with load shedding
+ *          of the optional ones under sustained overload
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * Past 100 % load the block stages do not fail, they finish later every
+ * block until the DMA overwrites a half still being read and the frame
+ * ring overflows. Each stage therefore declares how long after its block's
+ * arrival (the DMA interrupt, ADC_BlockInfo_t.timestamp) it must be done,
+ * as a share of the block period, so the deadlines follow the rate.
+ *
+ * Per block, in the context that runs the stages:
+ *   stageDeadline_begin()   arrival of the block
+ *   stageDeadline_isShed()  skip a shed stage
+ *   stageDeadline_done()    after each stage: late against its deadline?
+ *   stageDeadline_end()     block verdict, shedding and restoring
+ *
+ * The verdict feeds an overload level: +1 per block with a miss, -1 per
+ * block without (never below 0). A ring overflow reported with
+ * stageDeadline_miss() counts as a missed block. At
+ * STAGE_DEADLINE_SHED_LEVEL the optional stage with the highest shed_rank
+ * still running is shed and the level starts again, so the next one only
+ * goes if shedding the first did not help. After
+ * STAGE_DEADLINE_RESTORE_BLOCKS blocks in a row without a miss, the stage
+ * shed last comes back. A shed_rank of 0 is never shed.
+ *
+ * Usage Example:
+ *   static const StageDeadline_Stage_t table[] = {
+ *       {"spectrum", 30U, 1U}, {"display", 50U, 2U}, {"record", 90U, 0U}};
+ *   static StageDeadline_t mon;
+ *   stageDeadline_init(&mon, table, 3, 64000U); // 256 frames at 4 kHz
+ *
+ *   // block callback
+ *   stageDeadline_begin(&mon, info.timestamp);
+ *   if (!stageDeadline_isShed(&mon, 1)) {
+ *     display_process(block);
+ *     stageDeadline_done(&mon, 1);
+ *   }
+ *   stageDeadline_end(&mon);
+ *
+ * @note One instance per block context; stageDeadline_miss() and the
+ *       getters may be called from anywhere.
+ ******************************************************************************
+ */
+
+#ifndef STAGE_DEADLINE_H
+#define STAGE_DEADLINE_H
+
+#include "stm32f7xx_hal.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+
+/**
+ * @brief Most stages per instance
+ */
+#ifndef STAGE_DEADLINE_MAX_STAGES
+#define STAGE_DEADLINE_MAX_STAGES 16U
+#endif
+
+/**
+ * @brief Overload level that sheds the next optional stage (blocks)
+ */
+#ifndef STAGE_DEADLINE_SHED_LEVEL
+#define STAGE_DEADLINE_SHED_LEVEL 8U
+#endif
+
+/**
+ * @brief Blocks in a row without a miss before a shed stage is restored
+ *        (256 = 16 s at 4 kHz)
+ */
+#ifndef STAGE_DEADLINE_RESTORE_BLOCKS
+#define STAGE_DEADLINE_RESTORE_BLOCKS 256U
+#endif
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief Declaration of one stage
+ */
+typedef struct {
+  const char *name;     ///< For the reports
+  uint8_t deadline_pct; ///< Done by this share of the block period, 1..100
+  uint8_t shed_rank;    ///< Shed from the highest; 0 = never
+} StageDeadline_Stage_t;
+
+/**
+ * @brief Statistics of one stage
+ */
+typedef struct {
+  uint32_t deadline_us; ///< After the block's arrival
+  uint32_t worst_us;    ///< Latest finish after arrival
+  uint32_t misses;      ///< Blocks it finished after its deadline
+  uint32_t sheds;       ///< Times shed
+  uint8_t shed;         ///< Shed now
+} StageDeadline_Stats_t;
+
+/**
+ * @brief Monitor instance
+ */
+typedef struct {
+  const StageDeadline_Stage_t *stages;
+  uint8_t count;
+  uint32_t deadline_us[STAGE_DEADLINE_MAX_STAGES];
+  uint32_t worst_us[STAGE_DEADLINE_MAX_STAGES];
+  uint32_t misses[STAGE_DEADLINE_MAX_STAGES];
+  uint32_t sheds[STAGE_DEADLINE_MAX_STAGES];
+  uint8_t shed_order[STAGE_DEADLINE_MAX_STAGES]; ///< Stack, last on top
+  uint8_t shed_depth;
+  uint64_t arrival;               ///< Block being run (timebase ticks)
+  uint8_t block_missed;           ///< A stage of it was late
+  volatile uint8_t overflowed;    ///< From stageDeadline_miss()
+  uint32_t level;                 ///< Overload level
+  uint32_t clean;                 ///< Blocks in a row without a miss
+  volatile uint32_t shed_mask;    ///< Bit n = stage n shed
+  volatile uint32_t changes;      ///< Shed set changes
+  uint32_t blocks;                ///< Blocks seen
+  uint32_t missed_blocks;         ///< With a miss or an overflow
+} StageDeadline_t;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief Attach a stage table and set the deadlines; nothing shed
+ *
+ * @param mon             Instance
+ * @param stages          Table, kept by reference; index = stage number
+ * @param count           Entries, 1..STAGE_DEADLINE_MAX_STAGES
+ * @param block_period_us Block period the shares apply to
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer, bad count, a share outside 1..100 or a
+ *                     zero period
+ */
+HAL_StatusTypeDef stageDeadline_init(StageDeadline_t *mon,
+                                     const StageDeadline_Stage_t *stages,
+                                     uint8_t count, uint32_t block_period_us);
+
+/**
+ * @brief Rescale the deadlines to a new block period (rate change), from
+ *        the block context
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer or zero period
+ */
+HAL_StatusTypeDef stageDeadline_setPeriod(StageDeadline_t *mon,
+                                          uint32_t block_period_us);
+
+/**
+ * @brief Start a block
+ *
+ * @param mon     Instance
+ * @param arrival timebase_now() at its DMA interrupt
+ */
+void stageDeadline_begin(StageDeadline_t *mon, uint64_t arrival);
+
+/**
+ * @brief Check a stage that has finished the block against its deadline
+ *
+ * @param mon   Instance
+ * @param stage Index in the table
+ */
+void stageDeadline_done(StageDeadline_t *mon, uint8_t stage);
+
+/**
+ * @brief Close the block: overload level, then shed or restore one stage
+ *
+ * @param mon Instance
+ */
+void stageDeadline_end(StageDeadline_t *mon);
+
+/**
+ * @brief Count an overload sign seen elsewhere (ring overflow) as a missed
+ *        block, at the next stageDeadline_end()
+ *
+ * @param mon Instance
+ */
+void stageDeadline_miss(StageDeadline_t *mon);
+
+/**
+ * @brief Whether a stage is shed now
+ *
+ * @return uint8_t 1 = skip it this block
+ */
+static inline uint8_t stageDeadline_isShed(const StageDeadline_t *mon,
+                                           uint8_t stage) {
+  return (uint8_t)((mon->shed_mask >> stage) & 1U);
+}
+
+/**
+ * @brief Stages shed now, bit n = stage n
+ */
+uint32_t stageDeadline_getShed(const StageDeadline_t *mon);
+
+/**
+ * @brief Shed set changes so far; compare with a saved value to announce
+ *        them
+ */
+uint32_t stageDeadline_getChanges(const StageDeadline_t *mon);
+
+/**
+ * @brief Copy the statistics of one stage
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer or invalid stage
+ */
+HAL_StatusTypeDef stageDeadline_getStats(const StageDeadline_t *mon,
+                                         uint8_t stage,
+                                         StageDeadline_Stats_t *stats);
+
+/**
+ * @brief Write the names of the shed stages, comma separated ("-" if none)
+ *
+ * @param mon  Instance
+ * @param out  Destination, always terminated
+ * @param size Its size
+ */
+void stageDeadline_formatShed(const StageDeadline_t *mon, char *out,
+                              uint32_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* STAGE_DEADLINE_H */
@@ -55,7 +55,35 @@ void SVC_Handler(void);
 void DebugMon_Handler(void);
 void PendSV_Handler(void);
 void SysTick_Handler(void);
+void DMA1_Stream3_IRQHandler(void);
+void ADC_IRQHandler(void);
+void USART3_IRQHandler(void);
+void DMA2_Stream0_IRQHandler(void);
 /* USER CODE BEGIN EFP */
+void TIM2_IRQHandler(void);
+void TIM3_IRQHandler(void);
+void TIM5_IRQHandler(void);
+void TIM4_IRQHandler(void);
+void TIM7_IRQHandler(void);
+void OTG_FS_IRQHandler(void);
+void SDMMC1_IRQHandler(void);
+void DMA2_Stream6_IRQHandler(void);
+void DMA2_Stream7_IRQHandler(void);
+void DMA2_Stream3_IRQHandler(void);
+void DMA1_Stream1_IRQHandler(void);
+void LPTIM1_IRQHandler(void);
+void DMA2D_IRQHandler(void);
+void SPDIF_RX_IRQHandler(void);
+void CEC_IRQHandler(void);
+void I2C1_EV_IRQHandler(void);
+void I2C1_ER_IRQHandler(void);
+void DMA1_Stream7_IRQHandler(void);
+void CAN1_TX_IRQHandler(void);
+void CAN1_RX0_IRQHandler(void);
+void CAN1_SCE_IRQHandler(void);
+void USART2_IRQHandler(void);
+void UART8_IRQHandler(void);
+void TIM1_BRK_TIM9_IRQHandler(void);
 
 /* USER CODE END EFP */
 
@@ -0,0 +1,188 @@
+/**
+ ******************************************************************************
+ * @file    swo_trace.h
+ * @brief   ITM/SWO development trace: probe events, markers, raw sample
+ *          blocks and printf on separate stimulus ports
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * The ITM writes 32-bit words into a small FIFO that the TPIU shifts out of
+ * PB3 (SWO) in UART framing at SWO_TRACE_BAUD. The ST-LINK captures it
+ * without touching the UART link, and SWV viewers or OpenOCD/pyOCD
+ * split it by stimulus port:
+ *
+ *   port 0  printf() text via __io_putchar()
+ *   port 1  probe events: probe << 24 | duration in cycles (24 bits,
+ *           saturated), one word per profiler_end()
+ *   port 2  markers: id << 24 | value (24 bits), e.g. a trigger with the
+ *           sequence number of its frame
+ *   port 3  raw sample blocks: 0xB10C << 16 | frame count, first frame,
+ *           timestamp low/high, then the interleaved samples two per word
+ *
+ * Event and marker writes never wait: if the FIFO is full, the word is
+ * dropped and counted. They are one store each, with interrupts masked
+ * for the few cycles between the ready check and the store, so the probes
+ * cost the same whether or not a probe is attached. printf() waits for the
+ * FIFO, one character at a time.
+ *
+ * Blocks are too long for an interrupt. swoTrace_pushBlock() (block
+ * callback) retains the pool block, and swoTrace_poll() (main loop) sends
+ * it for at most SWO_TRACE_POLL_US per call. While one block is in flight,
+ * the next ones are dropped. At 2 MHz a word takes ~25 us, so 4 kHz
+ * streaming needs about a third of the line. ST-LINK/V3 runs SWO up to
+ * 24 MHz.
+ *
+ * The stimulus port enables (ITM_TER) select what is sent; the debugger
+ * may change them too. SWO_TRACE_PORTS leaves the block port off.
+ *
+ * Usage Example:
+ *   swoTrace_init();                     // after the final clock set-up
+ *   printf("boot %lu\n", HAL_GetTick()); // port 0
+ *   swoTrace_marker(SWO_TRACE_MARK_TRIGGER + channel, frame);
+ *
+ *   // block callback / main loop
+ *   swoTrace_pushBlock(block, frame_count);
+ *   swoTrace_poll();
+ *
+ * @note The prescaler follows HCLK at swoTrace_init(); call it again after
+ *       a clock change, and set the viewer to swoTrace_getBaud().
+ ******************************************************************************
+ */
+
+#ifndef SWO_TRACE_H
+#define SWO_TRACE_H
+
+#include "stm32f7xx_hal.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+
+/**
+ * @brief Set to 0 to leave the ITM alone (and printf() unconnected)
+ */
+#ifndef SWO_TRACE_ENABLE
+#define SWO_TRACE_ENABLE 1
+#endif
+
+/**
+ * @brief SWO bit rate; HCLK / SWO_TRACE_BAUD should be a whole number
+ */
+#ifndef SWO_TRACE_BAUD
+#define SWO_TRACE_BAUD 2000000U
+#endif
+
+/**
+ * @brief Stimulus ports enabled at swoTrace_init(): printf, probes, markers
+ */
+#ifndef SWO_TRACE_PORTS
+#define SWO_TRACE_PORTS 0x07U
+#endif
+
+/**
+ * @brief Longest swoTrace_poll() sends block words (waiting on the FIFO)
+ */
+#ifndef SWO_TRACE_POLL_US
+#define SWO_TRACE_POLL_US 200U
+#endif
+
+#define SWO_TRACE_PORT_PRINTF 0U
+#define SWO_TRACE_PORT_PROBE 1U
+#define SWO_TRACE_PORT_MARKER 2U
+#define SWO_TRACE_PORT_BLOCK 3U
+
+#define SWO_TRACE_BLOCK_TAG 0xB10C0000U ///< First word of a block
+
+/**
+ * @brief Marker ids (bits 31:24 of a port 2 word)
+ */
+#define SWO_TRACE_MARK_TRIGGER 0x10U ///< + channel; value: trigger frame
+#define SWO_TRACE_MARK_CAPTURE 0x20U ///< Capture sent; value: first frame
+#define SWO_TRACE_MARK_RATE 0x21U    ///< Scan rate changed; value: Hz
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief Trace statistics
+ */
+typedef struct {
+  uint32_t events;         ///< Probe events sent
+  uint32_t markers;        ///< Markers sent
+  uint32_t blocks;         ///< Sample blocks sent completely
+  uint32_t dropped_events; ///< Probe events and markers lost to a full FIFO
+  uint32_t dropped_blocks; ///< Blocks skipped: one in flight, or no pool
+} SwoTrace_Stats_t;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief Enable trace, the TPIU in UART mode on PB3 and the ITM ports
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Tracing (or SWO_TRACE_ENABLE = 0)
+ *   @retval HAL_ERROR SWO_TRACE_BAUD out of the prescaler range at HCLK
+ */
+HAL_StatusTypeDef swoTrace_init(void);
+
+/**
+ * @brief Actual SWO bit rate, 0 before swoTrace_init()
+ */
+uint32_t swoTrace_getBaud(void);
+
+/**
+ * @brief Select the stimulus ports (bit n = port n)
+ */
+void swoTrace_setPorts(uint32_t mask);
+
+/**
+ * @brief Stimulus ports enabled now
+ */
+uint32_t swoTrace_getPorts(void);
+
+/**
+ * @brief One probe measurement (any context; dwt_profiler.c calls it)
+ */
+void swoTrace_probe(uint8_t probe, uint32_t cycles);
+
+/**
+ * @brief One marker (any context)
+ *
+ * @param id    SWO_TRACE_MARK_x
+ * @param value Low 24 bits are sent
+ */
+void swoTrace_marker(uint8_t id, uint32_t value);
+
+/**
+ * @brief Queue a DMA block for the block port (block callback)
+ *
+ * The pool block is retained until it has been sent. Dropped while the
+ * previous block is in flight or the block is not from the pool.
+ */
+void swoTrace_pushBlock(const uint16_t *block, uint32_t frame_count);
+
+/**
+ * @brief Send words of the queued block for up to SWO_TRACE_POLL_US
+ *
+ * @note Call from the main loop
+ */
+void swoTrace_poll(void);
+
+/**
+ * @brief Get trace statistics
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer
+ */
+HAL_StatusTypeDef swoTrace_getStats(SwoTrace_Stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SWO_TRACE_H */
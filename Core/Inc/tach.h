@@ -0,0 +1,153 @@
+/**
+ ******************************************************************************
+ * @file    tach.h
+ * @brief   Shaft tachometer on TIM3 input capture, stamped on the timebase
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * A once-per-rev (or N-per-rev) pulse from an optical or magnetic pick-up
+ * goes to TIM3_CH1 (PC6, AF2). TIM3 counts at TIMEBASE_TICK_HZ from the
+ * same APB1 clock as TIM5, and its capture latches the count at the edge.
+ * The capture interrupt reads the timebase together with TIM3 and
+ * subtracts the ticks that passed since the edge, so each edge gets a
+ * 64-bit timebase stamp that carries none of the interrupt latency, to
+ * within one tick. The block stamps of adc_conversions.h are on the same
+ * timebase, which is what lets dsp_order.h place the edges among the frames.
+ *
+ * Edges closer than TACH_MIN_INTERVAL_US (contact bounce, a second mark on
+ * the shaft) are dropped as glitches. The stamps queue for the main loop.
+ *
+ * Usage Example:
+ *   tach_init();
+ *
+ *   uint64_t edge;
+ *   while (tach_popEdge(&edge) == HAL_OK) {
+ *     dspOrder_pushEdge(&order, edge);
+ *   }
+ *   float rpm = tach_getRpm();
+ *
+ * @note TIM3 is taken whole while TACH_ENABLE is set.
+ ******************************************************************************
+ */
+
+#ifndef TACH_H
+#define TACH_H
+
+#include "irq_priority.h"
+#include "stm32f7xx_hal.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+
+/**
+ * @brief Set to 1 when a tach pick-up is wired to PC6
+ */
+#ifndef TACH_ENABLE
+#define TACH_ENABLE 0
+#endif
+
+/**
+ * @brief Pulses per shaft revolution
+ */
+#ifndef TACH_PULSES_PER_REV
+#define TACH_PULSES_PER_REV 1U
+#endif
+
+/**
+ * @brief Edges closer than this to the previous one are glitches
+ *        (100 us: 600 000 rpm at one pulse per rev)
+ */
+#ifndef TACH_MIN_INTERVAL_US
+#define TACH_MIN_INTERVAL_US 100U
+#endif
+
+/**
+ * @brief No edge for this long means the shaft stands still (getRpm() = 0)
+ */
+#ifndef TACH_TIMEOUT_MS
+#define TACH_TIMEOUT_MS 2000U
+#endif
+
+/**
+ * @brief Stamps queued for the main loop (power of two)
+ */
+#ifndef TACH_EDGE_QUEUE
+#define TACH_EDGE_QUEUE 64U
+#endif
+
+/**
+ * @brief Capture interrupt priority; any, as long as it runs within one
+ *        TIM3 wrap (65 ms at 1 MHz) of the edge
+ */
+#ifndef TACH_IRQ_PRIORITY
+#define TACH_IRQ_PRIORITY IRQ_PRIORITY_CAPTURE
+#endif
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief Capture counters
+ */
+typedef struct {
+  uint32_t edges;    ///< Edges stamped
+  uint32_t glitches; ///< Edges within TACH_MIN_INTERVAL_US, dropped
+  uint32_t dropped;  ///< Stamps lost to a full queue
+  uint32_t period_ticks; ///< Newest edge interval (timebase ticks)
+} Tach_Stats_t;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief Set up PC6 and the TIM3 capture, and start it
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Capturing (or TACH_ENABLE = 0)
+ *   @retval HAL_ERROR TIM3 clock is not a multiple of TIMEBASE_TICK_HZ, or
+ *                     a HAL init failed
+ *
+ * @note Call after timebase_init()
+ */
+HAL_StatusTypeDef tach_init(void);
+
+/**
+ * @brief Take the oldest queued edge stamp
+ *
+ * @param time Receives the timebase_now() value of the edge
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Stamp taken
+ *   @retval HAL_BUSY  Queue empty
+ *   @retval HAL_ERROR NULL pointer
+ */
+HAL_StatusTypeDef tach_popEdge(uint64_t *time);
+
+/**
+ * @brief Shaft speed from the newest edge interval, 0 once it timed out
+ */
+float tach_getRpm(void);
+
+/**
+ * @brief Get capture counters
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer
+ */
+HAL_StatusTypeDef tach_getStats(Tach_Stats_t *stats);
+
+/**
+ * @brief TIM3 capture handling; call from TIM3_IRQHandler()
+ */
+void tach_irqHandler(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TACH_H */
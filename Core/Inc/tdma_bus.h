@@ -0,0 +1,324 @@
+/**
+ ******************************************************************************
+ * @file    tdma_bus.h
+ * @brief   Time-slotted RS-485 bus on UART8: one master schedules the
+ *          slots, each node sends its packets in its own slot by DMA
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * Several boards share one twisted pair instead of a cable each. UART8
+ * drives the RS-485 transceiver and switches its DE pin around every
+ * frame itself:
+ *
+ *   PE1 TX  PE0 RX  PD15 DE  (AF8; DE high = transmit)
+ *
+ * Schedule. A bus cycle is TDMA_BUS_NODES + 1 slots of TDMA_BUS_SLOT_FRAMES
+ * scan frames each. Slot 0 is the master's (address 0): it opens every
+ * cycle with a beacon carrying the cycle number, the slot length, the node
+ * count and the scan rate. Slot n belongs to node n, which sends one frame
+ * in it, with its queued packets or empty as a heartbeat:
+ *
+ *   slot   0        1        2            N
+ *        |beacon  |node 1  |node 2  |...|node N  |beacon  |...
+ *
+ * Slot clock. Slots are counted in scan frames, not in time: TIM9, clocked
+ * by TIM2's update (ITR0, the scan trigger), counts frames in hardware and
+ * wraps once per cycle. Its update starts the master's beacon; its CC1
+ * match, at the node's slot start, starts the node's frame. The slot edges
+ * therefore move with the sample clock, and boards disciplined to one sync
+ * pulse (time_sync.h) count the same frames. On each beacon a node sets its
+ * TIM9 to the frames the beacon has taken since the cycle began (about 80
+ * us at 2 Mbaud), so the cycles of all boards start together. After that
+ * first lock, an error of one frame is left alone and a larger one is
+ * corrected and counted (resyncs). Without a sync pulse, the cycles of the
+ * boards drift apart by the ppm between their crystals. Each beacon pulls
+ * them back together, so the guard below must also cover one cycle of that
+ * drift.
+ *
+ * Frames. Every frame is delimited by the receiver timeout and ends with
+ * a CRC-16/CCITT-FALSE (telemetryFrame_crc16()), little-endian:
+ *
+ *   beacon  0x00 0xB0 cycle(4) slot_frames(2) nodes(1) rate_hz(4) crc(2)
+ *   data    node 0xD0 seq(2) payload(0..capacity) crc(2)
+ *
+ * A node's payload is the byte stream its application queued with
+ * tdmaBus_reserve()/tdmaBus_commit(): in main.c, its delimited telemetry
+ * packets. The payload capacity is what a slot carries at the baud rate,
+ * less TDMA_BUS_GUARD_US and the receiver timeout, so a frame always ends
+ * inside its slot.
+ *
+ * No copy, no CRC in an interrupt for data. The node seals a frame (header
+ * and CRC) in tdmaBus_poll() in one of two buffers while the application
+ * fills the other one. The slot match only starts the DMA of the sealed
+ * buffer, or of a 6-byte heartbeat. The master stores every frame by DMA in
+ * a ring of TDMA_BUS_RX_BUFFERS. Its receiver timeout interrupt only
+ * checks the header and the slot, and tdmaBus_poll() checks the CRC and
+ * hands the payload to the frame callback.
+ *
+ * Utilisation. The master adds up the bits on the wire in each cycle
+ * (beacon and node frames, 10 per byte) and reports them as a share of the
+ * cycle: last, highest and mean, in 1/1000.
+ *
+ * Usage Example:
+ *   // master (TDMA_BUS_ADDRESS 0)     // node (TDMA_BUS_ADDRESS 1..N)
+ *   tdmaBus_init();                    tdmaBus_init();
+ *   tdmaBus_registerFrameCallback(     tdmaBus_start(scan_rate_hz);
+ *       App_NodeFrame, NULL);          ...
+ *   tdmaBus_start(scan_rate_hz);       uint8_t *p = tdmaBus_reserve(len);
+ *                                      if (p != NULL) {
+ *   while (1) {                          encode(p, &len);
+ *     tdmaBus_poll();                    tdmaBus_commit(len);
+ *   }                                  }
+ *                                      tdmaBus_poll();
+ *
+ * Concurrency model:
+ *   - UART8 (frames) and TIM9 (slots) interrupt at TDMA_BUS_IRQ_PRIORITY,
+ *     one level, so they never preempt each other
+ *   - reserve, commit, poll and the frame callback run in the main loop
+ *
+ * @note UART8, TIM9, DMA1 Stream0/Stream6 and PE0, PE1, PD15 are taken
+ *       while TDMA_BUS_ENABLE is set. Stream6 is also the Modbus server's,
+ *       and TIM9 counts TIM2 updates, so the scan must be paced by TIM2
+ *       (not by the PWM timers, pwm_sync.h).
+ ******************************************************************************
+ */
+
+#ifndef TDMA_BUS_H
+#define TDMA_BUS_H
+
+#include "irq_priority.h"
+#include "stm32f7xx_hal.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+
+/**
+ * @brief Set to 1 when the board sits on a TDMA bus
+ */
+#ifndef TDMA_BUS_ENABLE
+#define TDMA_BUS_ENABLE 0
+#endif
+
+/**
+ * @brief 0 = master, 1..TDMA_BUS_MAX_NODES = node (its slot number)
+ */
+#ifndef TDMA_BUS_ADDRESS
+#define TDMA_BUS_ADDRESS 0U
+#endif
+
+/**
+ * @brief Node slots the master schedules per cycle (nodes take theirs
+ *        from the beacon)
+ */
+#ifndef TDMA_BUS_NODES
+#define TDMA_BUS_NODES 3U
+#endif
+
+/**
+ * @brief Scan frames per slot (master). The default at 4000 frames/s: 4 ms
+ *        slots of 782 payload bytes, a 16 ms cycle in which each node
+ *        queues four full sample packets (672 bytes) of its 64 frames
+ */
+#ifndef TDMA_BUS_SLOT_FRAMES
+#define TDMA_BUS_SLOT_FRAMES 16U
+#endif
+
+/**
+ * @brief Baud rate, 8N1; 54 MHz PCLK1 divides 2 Mbaud exactly
+ */
+#ifndef TDMA_BUS_BAUD
+#define TDMA_BUS_BAUD 2000000U
+#endif
+
+/**
+ * @brief Silence kept at the end of each slot for the slot interrupt's
+ *        latency and the clock drift of a cycle
+ */
+#ifndef TDMA_BUS_GUARD_US
+#define TDMA_BUS_GUARD_US 50U
+#endif
+
+/**
+ * @brief Receiver timeout that ends a frame, bit times
+ */
+#ifndef TDMA_BUS_RTO_BITS
+#define TDMA_BUS_RTO_BITS 20U
+#endif
+
+/**
+ * @brief Longest frame, header and CRC included (buffer size)
+ */
+#ifndef TDMA_BUS_FRAME_MAX
+#define TDMA_BUS_FRAME_MAX 1024U
+#endif
+
+/**
+ * @brief Master receive ring, frames (at least 2)
+ */
+#ifndef TDMA_BUS_RX_BUFFERS
+#define TDMA_BUS_RX_BUFFERS 4U
+#endif
+
+/**
+ * @brief Cycles a node keeps sending without a beacon
+ */
+#ifndef TDMA_BUS_HOLDOVER_CYCLES
+#define TDMA_BUS_HOLDOVER_CYCLES 4U
+#endif
+
+/**
+ * @brief UART8 and TIM9 interrupt priority
+ */
+#ifndef TDMA_BUS_IRQ_PRIORITY
+#define TDMA_BUS_IRQ_PRIORITY IRQ_PRIORITY_COMMS
+#endif
+
+#define TDMA_BUS_MAX_NODES 8U   ///< Nodes per bus (bits of present_mask)
+#define TDMA_BUS_HEADER_SIZE 4U ///< Data frame: node, type, seq
+#define TDMA_BUS_CRC_SIZE 2U
+
+#if TDMA_BUS_ADDRESS > TDMA_BUS_MAX_NODES
+#error "TDMA_BUS_ADDRESS must be 0 (master) or 1..TDMA_BUS_MAX_NODES"
+#endif
+
+#if TDMA_BUS_NODES < 1 || TDMA_BUS_NODES > TDMA_BUS_MAX_NODES
+#error "TDMA_BUS_NODES must be in 1..TDMA_BUS_MAX_NODES"
+#endif
+
+#if TDMA_BUS_RX_BUFFERS < 2
+#error "TDMA_BUS_RX_BUFFERS must be at least 2"
+#endif
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief Counters since tdmaBus_start(); M = master only, N = node only
+ */
+typedef struct {
+  uint8_t running;        ///< Slots are being counted
+  uint8_t locked;         ///< N: beacon seen within the holdover
+  uint8_t nodes;          ///< Node slots of the schedule in use
+  uint8_t present_mask;   ///< M: nodes heard in the last cycle (bit n-1)
+  uint16_t slot_frames;   ///< Scan frames per slot
+  uint16_t capacity;      ///< Payload bytes per slot
+  uint32_t cycle_us;      ///< Cycle length at the scan rate
+  uint32_t cycles;        ///< M: beacons sent, N: beacons received
+  uint32_t frames;        ///< M: received, N: sent, data frames
+  uint32_t heartbeats;    ///< M: received, N: sent, empty node frames
+  uint32_t missed;        ///< M: node slots without a frame
+  uint32_t late;          ///< M: frames that ended outside their slot,
+                          ///< N: slots found the last frame still going out
+  uint32_t bad_frames;    ///< CRC mismatch, bad header or length
+  uint32_t overruns;      ///< M: frames dropped on a full receive ring
+  uint32_t uart_errors;   ///< Frames dropped on a framing, noise or
+                          ///< overrun error
+  uint32_t resyncs;       ///< N: cycle phase corrected by over a frame
+  uint32_t mismatches;    ///< N: beacons at another scan rate or without
+                          ///< a slot for this node
+  uint32_t holdovers;     ///< N: slots skipped without a valid beacon
+  uint32_t dropped;       ///< N: reserves refused on a full slot frame
+  uint64_t payload_bytes; ///< M: received, N: sent, in data frames
+  uint16_t util_last;     ///< M: bus busy share of the last cycle, 1/1000
+  uint16_t util_max;      ///< M: ... of the busiest cycle
+  uint16_t util_mean;     ///< M: ... over all cycles
+} TdmaBus_Stats_t;
+
+/**
+ * @brief A node frame passed its CRC (master, main loop context)
+ *
+ * @param node    Node address, 1..TDMA_BUS_MAX_NODES
+ * @param cycle   Bus cycle it was sent in
+ * @param payload Its payload, valid until the callback returns
+ * @param len     Payload bytes (0 = heartbeat, not passed on)
+ * @param ctx     User context
+ */
+typedef void (*TdmaBus_FrameCallback_t)(uint8_t node, uint32_t cycle,
+                                        const uint8_t *payload, uint16_t len,
+                                        void *ctx);
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief Set up UART8 for RS-485, its pins and DMA streams, and TIM9 as
+ *        the frame counter; nothing runs until tdmaBus_start()
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Ready (or TDMA_BUS_ENABLE = 0)
+ *   @retval HAL_ERROR A HAL init failed
+ */
+HAL_StatusTypeDef tdmaBus_init(void);
+
+/**
+ * @brief (Re)start the slot clock at a scan rate; call again after each
+ *        rate change. The master schedules TDMA_BUS_NODES slots and sends
+ *        a beacon from the next cycle, a node waits for a beacon.
+ *
+ * @param frame_rate_hz Scan frames per second (TIM2 updates)
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Running
+ *   @retval HAL_ERROR Not initialised, or a slot too short for a header and
+ *                     its guard at this rate
+ */
+HAL_StatusTypeDef tdmaBus_start(uint32_t frame_rate_hz);
+
+/**
+ * @brief Stop sending; queued payload is discarded
+ */
+void tdmaBus_stop(void);
+
+/**
+ * @brief Node: room for len more bytes in the next slot frame (main loop)
+ *
+ * @return Where to write them, or NULL (master, not running, or the frame
+ *         full: counted in dropped)
+ */
+uint8_t *tdmaBus_reserve(uint16_t len);
+
+/**
+ * @brief Node: add the first len bytes of the last reservation
+ */
+void tdmaBus_commit(uint16_t len);
+
+/**
+ * @brief Seal the queued payload (node) or check and pass on the received
+ *        frames (master); main loop
+ */
+void tdmaBus_poll(void);
+
+/**
+ * @brief Register the master's frame callback (NULL to remove)
+ */
+void tdmaBus_registerFrameCallback(TdmaBus_FrameCallback_t callback,
+                                   void *ctx);
+
+/**
+ * @brief Get the counters
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer
+ */
+HAL_StatusTypeDef tdmaBus_getStats(TdmaBus_Stats_t *stats);
+
+/**
+ * @brief UART8 interrupt (UART8_IRQHandler)
+ */
+void tdmaBus_uartIrqHandler(void);
+
+/**
+ * @brief TIM9 interrupt (TIM1_BRK_TIM9_IRQHandler)
+ */
+void tdmaBus_timIrqHandler(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TDMA_BUS_H */
@@ -0,0 +1,397 @@
+/**
+ ******************************************************************************
+ * @file    telemetry.h
+ * @brief   Non-blocking USART3 telemetry queues served by TX DMA, by
+ *          priority class and bandwidth budget
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * A blocking HAL_UART_Transmit() of a ~120-byte line at 115200 baud holds the
+ * main loop for ~10 ms. Here the caller only copies its message into a free
+ * slot; DMA1 Stream3 drains the slots in order and the TX-complete callback
+ * chains the next one, so acquisition and processing never wait on the link.
+ *
+ * Concurrency model:
+ *   - One producer context (main loop) calls telemetry_send().
+ *   - The UART TX-complete / error callbacks (ISR) release slots and start
+ *     the next transfer.
+ *   - When every slot of its class is in flight or queued, the message is
+ *     dropped and counted rather than blocking.
+ *
+ * Priority: every message belongs to a class (Telemetry_Class_t) with its
+ * own slots. When the link is free, the next transfer is taken from the
+ * highest class that has one queued, so an alarm waits for at most the one
+ * transfer in flight, never behind a queue of raw samples. A class can
+ * also have a budget: a token bucket refilled at share_pct of the link's
+ * byte rate, holding up to burst_bytes. A message the bucket cannot pay
+ * for is dropped and counted as throttled. That keeps a bulk stream from
+ * filling the link, and it tells the producer to send less
+ * (telemetry_getClassStats()). telemetry_send() uses the control class.
+ *
+ * Batching: a message that fits behind the newest queued slot (one not yet
+ * in flight) is appended to it, so under load one DMA transfer, one cache
+ * clean and one TX-complete interrupt carry several packets instead of one.
+ * The wire bytes are the same: every packet keeps its own header and CRC,
+ * and the link is a byte stream. An idle link still starts the first
+ * message at once, unless a batch hold (TELEMETRY_BATCH_HOLD_MS,
+ * telemetry_setBatchHold()) lets it wait for more.
+ *
+ * Zero copy: telemetry_reserve() hands out the free end of a slot, so a
+ * packet can be encoded straight into DMA memory and then committed, with
+ * no staging buffer and no copy. An open reservation on a queued slot keeps
+ * that slot from starting until the commit.
+ *
+ * Link speed: telemetry_setLink() changes baud rate and RTS/CTS at run time.
+ * It waits for the queue to drain, then picks 16x oversampling, or 8x when
+ * the rate needs it (above PCLK1 / 16 = 3.375 Mbaud at 54 MHz, or when 8x
+ * gives the smaller error). Any rate other than the boot default must be
+ * confirmed with telemetry_confirmLink() within TELEMETRY_LINK_CONFIRM_MS,
+ * or telemetry_poll() falls back to the default, so a host that cannot
+ * follow never loses the board.
+ *
+ * Usage Example:
+ *   telemetry_init(&huart3);
+ *
+ *   if (telemetry_send(buf, len) != HAL_OK) {
+ *     // queue full: message dropped, see telemetry_getStats()
+ *   }
+ *
+ *   const Telemetry_Budget_t raw = {.share_pct = 75, .burst_bytes = 1024};
+ *   telemetry_setBudget(TELEMETRY_CLASS_BULK, &raw);
+ *   telemetry_sendClass(samples, len, TELEMETRY_CLASS_BULK);
+ *
+ *   uint8_t *p = telemetry_reserve(TELEMETRY_CLASS_BULK, max_len);
+ *   if (p != NULL) {
+ *     telemetry_commit(encode(p, max_len));   // 0 releases it
+ *   }
+ *
+ *   const Telemetry_LinkConfig_t fast = {.baud_rate = 2000000U};
+ *   telemetry_setLink(&fast);  // host switches too, then sends a byte
+ *   ...
+ *   telemetry_confirmLink();   // on that byte, at the new rate
+ *   telemetry_poll();          // main loop: fallback timer
+ *
+ ******************************************************************************
+ */
+
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include "adc_channels.h"
+#include "stm32f7xx_hal.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+
+/**
+ * @brief Number of TX slots per class (must be a power of two)
+ */
+#ifndef TELEMETRY_SLOT_COUNT
+#define TELEMETRY_SLOT_COUNT 4U
+#endif
+
+/**
+ * @brief Bytes per slot, i.e. the largest DMA transfer (multiple of 32 so
+ *        each slot covers whole D-cache lines); three samples packets fit,
+ *        and so does the stats packet of a table with more than 11 channels
+ */
+#ifndef TELEMETRY_SLOT_SIZE
+#define TELEMETRY_SLOT_SIZE 512U
+#endif
+
+/**
+ * @brief Longest time a message waits on an idle link for others to share
+ *        its transfer (0 = start at once; a full slot always starts)
+ */
+#ifndef TELEMETRY_BATCH_HOLD_MS
+#define TELEMETRY_BATCH_HOLD_MS 0U
+#endif
+
+/**
+ * @brief Link settings at boot and after a fallback (usart.c, 8N1)
+ */
+#ifndef TELEMETRY_DEFAULT_BAUD
+#define TELEMETRY_DEFAULT_BAUD 115200U
+#endif
+
+/**
+ * @brief Time a new link setting has to be confirmed by the host
+ */
+#ifndef TELEMETRY_LINK_CONFIRM_MS
+#define TELEMETRY_LINK_CONFIRM_MS 2000U
+#endif
+
+/**
+ * @brief Longest wait in telemetry_setLink() for the queue to drain
+ */
+#ifndef TELEMETRY_DRAIN_TIMEOUT_MS
+#define TELEMETRY_DRAIN_TIMEOUT_MS 200U
+#endif
+
+/**
+ * @brief Largest accepted baud rate error (the receiver tolerates ~3 % at 8x
+ *        oversampling, shared with the host's own error)
+ */
+#ifndef TELEMETRY_BAUD_TOLERANCE_PPM
+#define TELEMETRY_BAUD_TOLERANCE_PPM 20000U
+#endif
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief Priority classes, highest first
+ */
+typedef enum {
+  TELEMETRY_CLASS_ALARM = 0, ///< Events and trips; never held for batching
+  TELEMETRY_CLASS_CONTROL,   ///< Replies, status, features (telemetry_send())
+  TELEMETRY_CLASS_BULK,      ///< Sample streams
+  TELEMETRY_CLASS_COUNT
+} Telemetry_Class_t;
+
+/**
+ * @brief Bandwidth budget of a class
+ */
+typedef struct {
+  uint8_t share_pct;    ///< Refill rate, % of the link byte rate; 0 = none
+  uint16_t burst_bytes; ///< Bucket size, >= TELEMETRY_SLOT_SIZE
+} Telemetry_Budget_t;
+
+/**
+ * @brief Requested link settings
+ */
+typedef struct {
+  uint32_t baud_rate;   ///< Bits per second
+  uint8_t flow_control; ///< 1 = RTS/CTS (PD12/PD11, not on the ST-LINK VCP)
+} Telemetry_LinkConfig_t;
+
+/**
+ * @brief Link settings in effect
+ */
+typedef struct {
+  uint32_t baud_rate;     ///< Requested rate
+  uint32_t actual_baud;   ///< Rate produced by the divider
+  uint8_t oversampling_8; ///< 1 = 8x oversampling, 0 = 16x
+  uint8_t flow_control;   ///< 1 = RTS/CTS
+  uint8_t confirmed;      ///< 0 while the fallback timer runs
+} Telemetry_LinkInfo_t;
+
+/**
+ * @brief TX queue statistics
+ */
+typedef struct {
+  uint32_t queued;     ///< Slots currently waiting or in flight
+  uint32_t sent;       ///< Messages fully transmitted
+  uint32_t transfers;  ///< DMA transfers completed
+  uint32_t batched;    ///< Messages appended to an already queued slot
+  uint32_t dropped;    ///< Messages rejected: queue full or throttled
+  uint32_t throttled;  ///< Part of dropped: over the class budget
+  uint32_t tx_errors;  ///< Transfers aborted by a UART/DMA error
+  uint32_t high_water; ///< Maximum queued slots of one class since init
+} Telemetry_Stats_t;
+
+/**
+ * @brief Statistics of one class
+ */
+typedef struct {
+  uint32_t queued;     ///< Slots waiting or in flight
+  uint32_t sent;       ///< Messages fully transmitted
+  uint32_t dropped;    ///< Messages rejected because its slots were full
+  uint32_t throttled;  ///< Messages rejected by the budget
+  uint32_t high_water; ///< Maximum queued slots since init
+} Telemetry_ClassStats_t;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief Bind the queue to a UART whose TX DMA is already linked
+ *
+ * @param huart Initialised UART handle (hdmatx must be set)
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL handle or no TX DMA linked
+ */
+HAL_StatusTypeDef telemetry_init(UART_HandleTypeDef *huart);
+
+/**
+ * @brief Queue a message of the control class without blocking
+ *
+ * The data is copied, so the caller's buffer can be reused immediately. It
+ * shares the newest queued slot when it fits there.
+ *
+ * @param data Message bytes
+ * @param len  Length in bytes (1..TELEMETRY_SLOT_SIZE)
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Message queued
+ *   @retval HAL_BUSY  Queue full, message dropped and counted
+ *   @retval HAL_ERROR Not initialised, NULL data or invalid length
+ */
+HAL_StatusTypeDef telemetry_send(const uint8_t *data, uint16_t len);
+
+/**
+ * @brief Queue a message in a priority class (see telemetry_send())
+ *
+ * @param data Message bytes
+ * @param len  Length in bytes (1..TELEMETRY_SLOT_SIZE)
+ * @param cls  Priority class
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Message queued
+ *   @retval HAL_BUSY  Class slots full or budget spent, dropped and counted
+ *   @retval HAL_ERROR Not initialised, NULL data, invalid length or class
+ */
+HAL_StatusTypeDef telemetry_sendClass(const uint8_t *data, uint16_t len,
+                                      Telemetry_Class_t cls);
+
+/**
+ * @brief Reserve space for one message at the end of a class's queue, to
+ *        encode it in place
+ *
+ * @param cls     Priority class
+ * @param max_len Bytes the message may take (1..TELEMETRY_SLOT_SIZE)
+ *
+ * @return uint8_t* Write position, or NULL: no room (counted as dropped),
+ *                  not initialised, invalid arguments or a reservation
+ *                  already open
+ *
+ * @note Must be followed by telemetry_commit() before any other send
+ */
+uint8_t *telemetry_reserve(Telemetry_Class_t cls, uint16_t max_len);
+
+/**
+ * @brief Queue the bytes written after telemetry_reserve()
+ *
+ * @param len Bytes written, at most the reserved max_len; 0 releases the
+ *            space
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Message queued (or the space released)
+ *   @retval HAL_BUSY  Budget spent, dropped and counted as throttled
+ *   @retval HAL_ERROR No reservation open, or len above max_len (dropped)
+ */
+HAL_StatusTypeDef telemetry_commit(uint16_t len);
+
+/**
+ * @brief telemetry_commit() for a message that carries acquired data: the
+ *        TX-complete of its transfer records origin -> wire as the
+ *        LATENCY_HIST_BLOCK_TX path (latency_hist.h)
+ *
+ * @param len    As for telemetry_commit()
+ * @param origin Timebase stamp of the data's newest frame (0 = none); a
+ *               batched transfer is timed from its oldest stamp
+ */
+HAL_StatusTypeDef telemetry_commitStamped(uint16_t len, uint64_t origin);
+
+/**
+ * @brief Number of free slots of the control class
+ *
+ * @return uint32_t 0..TELEMETRY_SLOT_COUNT
+ */
+uint32_t telemetry_getFreeSlots(void);
+
+/**
+ * @brief Number of free slots of a class
+ *
+ * @return uint32_t 0..TELEMETRY_SLOT_COUNT, 0 for an invalid class
+ */
+uint32_t telemetry_getClassFreeSlots(Telemetry_Class_t cls);
+
+/**
+ * @brief Set or clear the budget of a class; the bucket starts full
+ *
+ * @param cls    Priority class
+ * @param budget Settings, copied; share_pct 0 removes the limit
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Applied
+ *   @retval HAL_ERROR Invalid class, NULL budget, share above 100 % or a
+ *                     burst smaller than one slot
+ *
+ * @note Call from the producer context
+ */
+HAL_StatusTypeDef telemetry_setBudget(Telemetry_Class_t cls,
+                                      const Telemetry_Budget_t *budget);
+
+/**
+ * @brief Get the statistics of one class
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR Invalid class or NULL pointer
+ */
+HAL_StatusTypeDef telemetry_getClassStats(Telemetry_Class_t cls,
+                                          Telemetry_ClassStats_t *stats);
+
+/**
+ * @brief Get queue statistics
+ *
+ * @param stats Destination
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer
+ */
+HAL_StatusTypeDef telemetry_getStats(Telemetry_Stats_t *stats);
+
+/**
+ * @brief Change baud rate and flow control once the queue has drained
+ *
+ * @param cfg New settings; non-default ones start the confirmation timer
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Applied
+ *   @retval HAL_BUSY  Queue did not drain within TELEMETRY_DRAIN_TIMEOUT_MS
+ *   @retval HAL_ERROR Not initialised, NULL config, or no divider within
+ *                     TELEMETRY_BAUD_TOLERANCE_PPM of the rate
+ *
+ * @note Call from the producer context (main loop); blocks while draining
+ */
+HAL_StatusTypeDef telemetry_setLink(const Telemetry_LinkConfig_t *cfg);
+
+/**
+ * @brief Keep the current link settings (the host is receiving them)
+ */
+void telemetry_confirmLink(void);
+
+/**
+ * @brief Let a message on an idle link wait up to hold_ms for others to
+ *        share its transfer (0 = start at once); TELEMETRY_BATCH_HOLD_MS
+ *        at boot
+ */
+void telemetry_setBatchHold(uint32_t hold_ms);
+
+/**
+ * @brief Batch hold in effect, ms
+ */
+uint32_t telemetry_getBatchHold(void);
+
+/**
+ * @brief Fall back to TELEMETRY_DEFAULT_BAUD when a new setting was not
+ *        confirmed in time, and start a slot whose batch hold has run out;
+ *        call from the main loop
+ */
+void telemetry_poll(void);
+
+/**
+ * @brief Get the link settings in effect
+ *
+ * @param info Destination
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer or not initialised
+ */
+HAL_StatusTypeDef telemetry_getLink(Telemetry_LinkInfo_t *info);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TELEMETRY_H */
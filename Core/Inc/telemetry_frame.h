@@ -0,0 +1,1563 @@
+/**
+ ******************************************************************************
+ * @file    telemetry_frame.h
+ * @brief   Compact binary telemetry packets (packed 12-bit samples, CRC, COBS)
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * Replaces the ~110-byte snprintf() report line with binary packets. A
+ * sample packet carries up to TELEMETRY_FRAME_MAX_FRAMES frames of the
+ * selected channels packed at 12 bits, an error bitmap and a CRC-16; a
+ * status packet carries the error and queue counters; a spectrum packet
+ * carries the vibration features of one channel; a stats packet carries
+ * the per-channel block statistics; an event packet describes a trigger
+ * capture, whose frames follow as sample packets; a timing packet ties a
+ * frame sequence number to the 64-bit timebase; a sync packet reports the
+ * discipline to the external sync pulse; a vector packet carries the
+ * magnitude of each tri-axis group per frame; an exception packet carries
+ * only the channel features that moved since the host last saw them; a
+ * display packet carries the min/max envelope of each channel per bucket.
+ * The stats, spectrum and velocity content can also go out as a CBOR
+ * packet: a self-describing map with small integer keys (cbor_writer.h)
+ * that a gateway forwards to cloud ingestion without re-encoding it.
+ * Every packet is COBS
+ * encoded and wrapped in 0x00 delimiters so the host can resynchronise after
+ * any lost byte. The wire format is specified in docs/telemetry_protocol.md.
+ *
+ * Usage Example:
+ *   TelemetryFrame_Batch_t batch;
+ *   telemetryFrame_initBatch(&batch, TELEMETRY_FRAME_ALL_CHANNELS);
+ *
+ *   while (adcRing_pop(&entry) == HAL_OK) {
+ *     telemetryFrame_addFrame(&batch, &entry);
+ *     if (telemetryFrame_isFull(&batch)) {
+ *       uint16_t len;
+ *       telemetryFrame_encodeSamples(&batch, out, sizeof(out), &len);
+ *       telemetry_send(out, len);
+ *       telemetryFrame_initBatch(&batch, TELEMETRY_FRAME_ALL_CHANNELS);
+ *     }
+ *   }
+ *
+ ******************************************************************************
+ */
+
+#ifndef TELEMETRY_FRAME_H
+#define TELEMETRY_FRAME_H
+
+#include "adc_ring.h"
+#include "event_log.h"
+#include "sample_codec.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+
+/**
+ * @brief Packet layout constants (see docs/telemetry_protocol.md)
+ */
+#define TELEMETRY_FRAME_SYNC 0xA55AU ///< First field of every packet
+#define TELEMETRY_FRAME_ALL_CHANNELS ADC_CHANNELS_MASK_ALL
+
+/**
+ * @brief Wire format version. Up to 6 channels the sample packet keeps the
+ *        channel and error masks in one byte each (version 1); wider tables
+ *        send a flags byte and 32-bit masks (version 2). All other packets
+ *        are the same in both.
+ */
+#if ADC_CHANNELS_COUNT > 6
+#define TELEMETRY_FRAME_VERSION 2U
+#define TELEMETRY_FRAME_SAMPLES_HDR 26U // + flags, count, masks, bitmap
+#else
+#define TELEMETRY_FRAME_VERSION 1U
+#define TELEMETRY_FRAME_SAMPLES_HDR 19U // + mask, count, errors, bitmap
+#endif
+
+/**
+ * @brief Sample packet flags, carried in the unused top bits of channel_mask
+ *        (version 1) or in their own byte (version 2)
+ */
+#define TELEMETRY_FRAME_FLAG_RATE_CHANGE 0x80U ///< First packet at a new rate
+#define TELEMETRY_FRAME_FLAG_CLIPPED 0x40U ///< A frame has a clipped sample
+#define TELEMETRY_FRAME_FLAGS_MASK 0xC0U
+
+/**
+ * @brief Frames per sample packet (1..32, one bit each in the error bitmap);
+ *        wide tables send fewer frames so a packet stays about as long
+ */
+#ifndef TELEMETRY_FRAME_MAX_FRAMES
+#if ADC_CHANNELS_COUNT > 6
+#define TELEMETRY_FRAME_MAX_FRAMES (96U / ADC_CHANNELS_COUNT)
+#else
+#define TELEMETRY_FRAME_MAX_FRAMES 16U
+#endif
+#endif
+
+/**
+ * @brief Raw (unencoded) length with CRC of a full sample packet and of a
+ *        stats packet, the two that grow with the channel count
+ */
+#define TELEMETRY_FRAME_SAMPLES_RAW                                            \
+  (TELEMETRY_FRAME_SAMPLES_HDR +                                               \
+   ((TELEMETRY_FRAME_MAX_FRAMES * ADC_CONVERSIONS_CHANNEL_COUNT * 12U + 7U) /  \
+    8U) +                                                                      \
+   2U)
+#define TELEMETRY_FRAME_STATS_RAW                                              \
+  (17U + 28U * ADC_CONVERSIONS_CHANNEL_COUNT + 2U)
+
+/**
+ * @brief Raw length with CRC of a CBOR stats packet when every float needs
+ *        single precision: header, 13 map entries, 8 of them channel arrays
+ */
+#define TELEMETRY_FRAME_CBOR_STATS_RAW                                         \
+  (12U + 51U + 36U * ADC_CONVERSIONS_CHANNEL_COUNT + 2U)
+
+/**
+ * @brief Worst-case encoded size of one packet: header, payload and CRC,
+ *        plus COBS overhead and both delimiters
+ */
+#define TELEMETRY_FRAME_RAW_BINARY_MAX                                         \
+  ((TELEMETRY_FRAME_SAMPLES_RAW > TELEMETRY_FRAME_STATS_RAW)                   \
+       ? TELEMETRY_FRAME_SAMPLES_RAW                                           \
+       : TELEMETRY_FRAME_STATS_RAW)
+#define TELEMETRY_FRAME_RAW_MAX                                                \
+  ((TELEMETRY_FRAME_RAW_BINARY_MAX > TELEMETRY_FRAME_CBOR_STATS_RAW)           \
+       ? TELEMETRY_FRAME_RAW_BINARY_MAX                                        \
+       : TELEMETRY_FRAME_CBOR_STATS_RAW)
+#define TELEMETRY_FRAME_ENCODED_MAX                                            \
+  (TELEMETRY_FRAME_RAW_MAX + (TELEMETRY_FRAME_RAW_MAX / 254U) + 1U + 2U)
+#define TELEMETRY_FRAME_SAMPLES_ENCODED_MAX                                    \
+  (TELEMETRY_FRAME_SAMPLES_RAW + (TELEMETRY_FRAME_SAMPLES_RAW / 254U) + 1U +   \
+   2U)
+
+/**
+ * @brief Frames of one channel per compressed packet (1..255)
+ */
+#ifndef TELEMETRY_FRAME_CODEC_FRAMES
+#define TELEMETRY_FRAME_CODEC_FRAMES 128U
+#endif
+
+/**
+ * @brief Worst-case encoded size of one compressed packet (a verbatim run,
+ *        of either codec, and the wavelet packet's bound field)
+ */
+#define TELEMETRY_FRAME_CODEC_RAW_MAX                                          \
+  (17U + SAMPLE_CODEC_MAX_BYTES(TELEMETRY_FRAME_CODEC_FRAMES) + 2U)
+#define TELEMETRY_FRAME_CODEC_ENCODED_MAX                                      \
+  (TELEMETRY_FRAME_CODEC_RAW_MAX + (TELEMETRY_FRAME_CODEC_RAW_MAX / 254U) +    \
+   1U + 2U)
+
+/**
+ * @brief Band RMS values per spectrum packet
+ */
+#define TELEMETRY_FRAME_MAX_BANDS 4U
+
+/**
+ * @brief Fault tones per envelope packet
+ */
+#define TELEMETRY_FRAME_MAX_TONES 4U
+
+/**
+ * @brief Frequencies per coherence packet
+ */
+#define TELEMETRY_FRAME_MAX_COHERENCE 4U
+
+/**
+ * @brief Features per channel in an exception packet
+ *        (TelemetryFrame_Feature_t), one bit each in its feature mask
+ */
+#define TELEMETRY_FRAME_FEATURES 6U
+
+/**
+ * @brief Min/max pairs per display packet (buckets x channels): the 12-bit
+ *        payload of a full sample packet
+ */
+#define TELEMETRY_FRAME_DISPLAY_PAIRS                                          \
+  ((TELEMETRY_FRAME_MAX_FRAMES * ADC_CONVERSIONS_CHANNEL_COUNT) / 2U)
+
+/**
+ * @brief Relative error accepted when a CBOR feature float is shortened to
+ *        half precision (0 = only exact halves). Levels (mean, DC bias)
+ *        are always exact.
+ */
+#ifndef TELEMETRY_FRAME_CBOR_TOLERANCE
+#define TELEMETRY_FRAME_CBOR_TOLERANCE 0.001f
+#endif
+
+/**
+ * @brief Goertzel bins per harmonics packet
+ */
+#define TELEMETRY_FRAME_MAX_HARMONICS 16U
+
+/**
+ * @brief Tri-axis groups per vector packet (channels 0-2, 3-5, ...)
+ */
+#define TELEMETRY_FRAME_VECTOR_GROUPS (ADC_CONVERSIONS_CHANNEL_COUNT / 3U)
+
+/**
+ * @brief Error matrix of a diagnostics packet: a row per channel plus the
+ *        scan row, by error kind (ADC_ErrorInfo_t)
+ */
+#define TELEMETRY_FRAME_DIAG_ROWS (ADC_CONVERSIONS_CHANNEL_COUNT + 1U)
+#define TELEMETRY_FRAME_DIAG_KINDS 5U
+
+/**
+ * @brief External SPI ADC packets: up to 16 channels, frames x channels
+ *        samples per packet (ext_adc.h)
+ */
+#define TELEMETRY_FRAME_EXT_CHANNELS 16U
+#define TELEMETRY_FRAME_EXT_SAMPLES 64U
+
+/**
+ * @brief Channel groups per anomaly packet (nn_anomaly.h)
+ */
+#define TELEMETRY_FRAME_ANOMALY_GROUPS 8U
+
+/**
+ * @brief Log bands per bands packet (dsp_bands.h)
+ */
+#define TELEMETRY_FRAME_LOG_BANDS 32U
+
+/**
+ * @brief Rainflow matrix cells per packet: 8 range bins of 8 mean bins
+ */
+#define TELEMETRY_FRAME_RAINFLOW_CELLS 64U
+
+/**
+ * @brief Natural frequencies per SRS packet
+ */
+#define TELEMETRY_FRAME_SRS_FREQS 48U
+
+/**
+ * @brief Samples per burst packet (even): 12-bit packed, about the payload
+ *        of a full sample packet
+ */
+#define TELEMETRY_FRAME_BURST_SAMPLES 128U
+
+/**
+ * @brief Event log entries per log packet
+ */
+#define TELEMETRY_FRAME_LOG_ENTRIES 16U
+
+/**
+ * @brief Node bytes per relay packet: what the largest packet leaves after
+ *        its header and 4 bytes, at most 255
+ */
+#define TELEMETRY_FRAME_RELAY_BYTES                                            \
+  ((TELEMETRY_FRAME_RAW_MAX - 18U > 255U) ? 255U                              \
+                                          : (TELEMETRY_FRAME_RAW_MAX - 18U))
+
+/**
+ * @brief Quefrency peaks per cepstrum packet (dsp_spectrum.h)
+ */
+#define TELEMETRY_FRAME_CEPSTRUM_PEAKS 4U
+
+/**
+ * @brief Angles of an averaged revolution per TSA packet (dsp_tsa.h)
+ */
+#define TELEMETRY_FRAME_TSA_SAMPLES 64U
+
+/**
+ * @brief Edge records per digital packet (digital_in.h)
+ */
+#define TELEMETRY_FRAME_DIGITAL_EDGES 8U
+
+/**
+ * @brief Level of a log band without energy, 0.01 dB units
+ */
+#define TELEMETRY_FRAME_LEVEL_NONE INT16_MIN
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief Packet type field
+ */
+typedef enum {
+  TELEMETRY_FRAME_TYPE_SAMPLES = 1, ///< Batch of packed sample frames
+  TELEMETRY_FRAME_TYPE_STATUS = 2,  ///< Error and queue counters
+  TELEMETRY_FRAME_TYPE_SPECTRUM = 3, ///< Spectral features of one channel
+  TELEMETRY_FRAME_TYPE_STATS = 4,    ///< Per-channel signal statistics
+  TELEMETRY_FRAME_TYPE_EVENT = 5,    ///< Trigger event of a capture
+  TELEMETRY_FRAME_TYPE_TIMING = 6,   ///< Block timestamp and rate estimate
+  TELEMETRY_FRAME_TYPE_SYNC = 7,     ///< Sync pulse phase and clock error
+  TELEMETRY_FRAME_TYPE_COMPRESSED = 8, ///< Lossless run of one channel
+  TELEMETRY_FRAME_TYPE_RATE = 9,       ///< Sample-rate change
+  TELEMETRY_FRAME_TYPE_ENVELOPE = 10,  ///< Envelope spectrum fault tones
+  TELEMETRY_FRAME_TYPE_HARMONICS = 11, ///< Goertzel bin amplitudes
+  TELEMETRY_FRAME_TYPE_VECTOR = 12,    ///< Group magnitudes and tilt
+  TELEMETRY_FRAME_TYPE_DIAGNOSTICS = 13, ///< Per-channel error counters
+  TELEMETRY_FRAME_TYPE_EXTERNAL = 14,    ///< External SPI ADC frames
+  TELEMETRY_FRAME_TYPE_ORDER = 15,       ///< Order spectrum of one channel
+  TELEMETRY_FRAME_TYPE_VELOCITY = 16,    ///< Velocity RMS and ISO zones
+  TELEMETRY_FRAME_TYPE_COHERENCE = 17,   ///< Phase and coherence of a pair
+  TELEMETRY_FRAME_TYPE_EXCEPTION = 18,   ///< Changed channel features
+  TELEMETRY_FRAME_TYPE_DISPLAY = 19,     ///< Min/max envelope per bucket
+  TELEMETRY_FRAME_TYPE_CBOR = 20,        ///< Features as a CBOR map
+  TELEMETRY_FRAME_TYPE_ANOMALY = 21,     ///< Anomaly score per group
+  TELEMETRY_FRAME_TYPE_BANDS = 22,       ///< Octave band levels
+  TELEMETRY_FRAME_TYPE_BASELINE = 23,    ///< Spectral baseline alarm
+  TELEMETRY_FRAME_TYPE_RAINFLOW = 24,    ///< Rainflow cycle matrix slice
+  TELEMETRY_FRAME_TYPE_SRS = 25,         ///< Shock response spectrum
+  TELEMETRY_FRAME_TYPE_ARRIVAL = 26,     ///< Impact arrival times
+  TELEMETRY_FRAME_TYPE_MODE = 27,        ///< Capture taken out of the scan
+  TELEMETRY_FRAME_TYPE_BURST = 28,       ///< Slice of a burst recording
+  TELEMETRY_FRAME_TYPE_LOG = 29,         ///< Event log entries
+  TELEMETRY_FRAME_TYPE_RELAY = 30,       ///< Bytes from a TDMA bus node
+  TELEMETRY_FRAME_TYPE_WAVELET = 31,     ///< Error-bounded run of one channel
+  TELEMETRY_FRAME_TYPE_CEPSTRUM = 32,    ///< Quefrency peaks of one channel
+  TELEMETRY_FRAME_TYPE_TSA = 33,         ///< Slice of an averaged revolution
+  TELEMETRY_FRAME_TYPE_ROLLUP = 34,      ///< Stored feature rollup, a channel
+  TELEMETRY_FRAME_TYPE_DIGITAL = 35      ///< Digital input edges, by frame
+} TelemetryFrame_Type_t;
+
+/**
+ * @brief Map keys of a CBOR packet's payload; all below 24, so each takes
+ *        one byte. Per-channel values are arrays in channel order over the
+ *        channels the message carries.
+ */
+typedef enum {
+  TELEMETRY_FRAME_CBOR_MSG = 0,     ///< Binary packet type it replaces
+  TELEMETRY_FRAME_CBOR_SEQ = 1,     ///< Sequence number of that packet
+  TELEMETRY_FRAME_CBOR_TIME = 2,    ///< HAL tick, ms
+  TELEMETRY_FRAME_CBOR_CHANNELS = 3, ///< Channel mask, or the one channel
+  TELEMETRY_FRAME_CBOR_FRAMES = 4,  ///< Frames in the statistics window
+  TELEMETRY_FRAME_CBOR_MIN = 5,     ///< Codes
+  TELEMETRY_FRAME_CBOR_MAX = 6,     ///< Codes
+  TELEMETRY_FRAME_CBOR_MEAN = 7,    ///< Codes
+  TELEMETRY_FRAME_CBOR_RMS = 8,     ///< AC RMS: codes, mm/s for velocity
+  TELEMETRY_FRAME_CBOR_CREST = 9,
+  TELEMETRY_FRAME_CBOR_DC_BIAS = 10, ///< Tracked DC, codes
+  TELEMETRY_FRAME_CBOR_SKEWNESS = 11,
+  TELEMETRY_FRAME_CBOR_KURTOSIS = 12,
+  TELEMETRY_FRAME_CBOR_PEAK_HZ = 13,
+  TELEMETRY_FRAME_CBOR_PEAK_AMPLITUDE = 14, ///< Codes, 0-pk
+  TELEMETRY_FRAME_CBOR_BAND_RMS = 15,      ///< Codes, per band
+  TELEMETRY_FRAME_CBOR_BAND_KURTOSIS = 16, ///< Per band
+  TELEMETRY_FRAME_CBOR_WINDOW = 17,        ///< 0 = Hann, 1 = flat-top
+  TELEMETRY_FRAME_CBOR_LENGTH = 18,        ///< FFT length
+  TELEMETRY_FRAME_CBOR_AVERAGES = 19,
+  TELEMETRY_FRAME_CBOR_PEAK = 20,          ///< Velocity 0-pk, mm/s
+  TELEMETRY_FRAME_CBOR_ZONE = 21,          ///< 0..3 = A..D, 255 = none
+  TELEMETRY_FRAME_CBOR_BAND = 22,          ///< [low_hz, high_hz]
+  TELEMETRY_FRAME_CBOR_INTERVAL = 23       ///< ms
+} TelemetryFrame_CborKey_t;
+
+/**
+ * @brief Channel features reported by exception, in wire order
+ */
+typedef enum {
+  TELEMETRY_FRAME_FEATURE_MEAN = 0,     ///< Mean code
+  TELEMETRY_FRAME_FEATURE_RMS,          ///< AC RMS (codes)
+  TELEMETRY_FRAME_FEATURE_PEAK_TO_PEAK, ///< max - min (codes)
+  TELEMETRY_FRAME_FEATURE_CREST,        ///< Crest factor
+  TELEMETRY_FRAME_FEATURE_KURTOSIS,     ///< Kurtosis, not excess
+  TELEMETRY_FRAME_FEATURE_DC_BIAS       ///< Tracked DC (codes)
+} TelemetryFrame_Feature_t;
+
+/**
+ * @brief Frames collected for one sample packet
+ */
+typedef struct {
+  ADC_ChannelMask_t channel_mask; ///< Channels included (bit n = channel n)
+  uint8_t frame_count;            ///< Frames collected so far
+  ADC_ChannelMask_t error_mask;   ///< OR of the frames' error masks
+  uint32_t error_bitmap;    ///< Bit i = frame i had at least one error
+  uint32_t first_sequence;  ///< Sequence number of frame 0
+  uint32_t first_timestamp; ///< Timestamp of frame 0 (HAL tick, ms)
+  uint16_t samples[TELEMETRY_FRAME_MAX_FRAMES * ADC_CONVERSIONS_CHANNEL_COUNT];
+  uint16_t sample_count; ///< Entries used in samples[]
+  uint8_t flags;         ///< TELEMETRY_FRAME_FLAG_*, cleared by initBatch
+} TelemetryFrame_Batch_t;
+
+/**
+ * @brief Counters carried by a status packet
+ */
+typedef struct {
+  uint32_t sequence;          ///< Newest frame sequence number
+  uint32_t timestamp;         ///< Time of the report (HAL tick, ms)
+  uint32_t total_errors;      ///< analogSensor error count
+  uint8_t last_failed_channel;///< Channel of the last error (0xFF = none/DMA)
+  uint32_t ring_high_water;   ///< Frame ring high-water mark
+  uint32_t ring_overflows;    ///< Frames dropped by the ring
+  uint32_t telemetry_dropped; ///< Packets dropped by the TX queue
+  uint16_t cpu_load;          ///< Rolling CPU load, 0.01 %
+  uint16_t cpu_peak;          ///< Busiest CPU load slice, 0.01 %
+  uint16_t vdda_mv;           ///< Measured VDDA (mV), 0 = not measured
+  int16_t temperature;        ///< Die temperature, 0.01 degC
+} TelemetryFrame_Status_t;
+
+/**
+ * @brief Features carried by a spectrum packet (see dsp_spectrum.h)
+ */
+typedef struct {
+  uint32_t sequence;      ///< Result number for this channel
+  uint32_t timestamp;     ///< Time of the result (HAL tick, ms)
+  uint8_t channel;        ///< Analysed channel
+  uint8_t window;         ///< 0 = Hann, 1 = flat-top
+  uint16_t length;        ///< FFT length
+  uint8_t averages;       ///< Welch segments averaged
+  float peak_hz;          ///< Dominant frequency
+  float peak_amplitude;   ///< Its amplitude (ADC codes, 0-pk)
+  float rms;              ///< AC RMS (ADC codes)
+  uint8_t band_count;     ///< Entries used in band_rms[]
+  float band_rms[TELEMETRY_FRAME_MAX_BANDS]; ///< RMS per band (ADC codes)
+  float band_kurtosis[TELEMETRY_FRAME_MAX_BANDS]; ///< Spectral kurtosis
+} TelemetryFrame_Spectrum_t;
+
+/**
+ * @brief Statistics carried by a stats packet
+ */
+typedef struct {
+  uint32_t sequence;  ///< Newest frame sequence number
+  uint32_t timestamp; ///< End of the statistics window (HAL tick, ms)
+  ADC_ChannelStats_t channels[ADC_CONVERSIONS_CHANNEL_COUNT]; ///< By channel
+  float dc_bias[ADC_CONVERSIONS_CHANNEL_COUNT]; ///< Tracked DC, 0 = untracked
+} TelemetryFrame_Stats_t;
+
+/**
+ * @brief Trigger description carried by an event packet (see adc_trigger.h)
+ */
+typedef struct {
+  uint32_t trigger_frame; ///< Frame number of the trigger (header sequence)
+  uint32_t timestamp;     ///< Time of the trigger (HAL tick, ms)
+  uint8_t channel;        ///< Channel that fired
+  uint8_t condition;      ///< ADC_TriggerCondition_t
+  uint16_t value;         ///< Sample, slope or RMS that fired (ADC codes)
+  uint16_t pre_frames;    ///< Capture frames before the trigger
+  uint16_t frame_count;   ///< Frames in the capture
+  uint32_t first_frame;   ///< Frame number of capture frame 0
+} TelemetryFrame_Event_t;
+
+/**
+ * @brief Block timestamp and frame-rate estimate carried by a timing packet
+ */
+typedef struct {
+  uint32_t first_frame;   ///< First frame of the stamped block (header seq)
+  uint32_t timestamp;     ///< Time of the report (HAL tick, ms)
+  uint64_t block_time;    ///< Timebase ticks at the end of that block
+  uint16_t frame_count;   ///< Frames in the block
+  uint32_t tick_hz;       ///< Timebase rate (TIMEBASE_TICK_HZ)
+  uint32_t nominal_mhz;   ///< Configured frame rate (mHz, 0 = free-running)
+  uint32_t measured_mhz;  ///< Measured frame rate (mHz)
+  float drift_ppm;        ///< measured vs nominal
+  uint32_t jitter_ticks;  ///< Spread of the block intervals
+} TelemetryFrame_Timing_t;
+
+/**
+ * @brief Discipline status carried by a sync packet (see time_sync.h)
+ */
+typedef struct {
+  uint32_t pulse_frame;    ///< Frame nearest to the newest pulse (header seq)
+  uint32_t timestamp;      ///< Time of the report (HAL tick, ms)
+  uint8_t state;           ///< TimeSync_State_t
+  uint32_t pulses;         ///< Pulses accepted
+  uint32_t rejected;       ///< Pulses rejected as off-rate
+  uint32_t missed_updates; ///< Late frame interrupts
+  int32_t phase_ns;        ///< Pulse minus nearest trigger
+  float clock_ppm;         ///< Local timer clock error
+  uint64_t pulse_time;     ///< Timebase ticks at the newest pulse
+} TelemetryFrame_Sync_t;
+
+/**
+ * @brief One channel's run of full-rate frames, compressed: lossless
+ *        (sample_codec.h) or within max_error codes (wavelet_codec.h)
+ */
+typedef struct {
+  uint32_t first_frame; ///< Sequence number of frame 0 (header seq)
+  uint32_t timestamp;   ///< Capture time of frame 0 (HAL tick, ms)
+  uint8_t channel;      ///< Channel of the run
+  uint8_t frame_count;  ///< Frames, 1..TELEMETRY_FRAME_CODEC_FRAMES
+  uint8_t error_count;  ///< Frames in which this channel failed
+  uint16_t max_error;   ///< 0: sampleCodec_encode() output (compressed
+                        ///< packet), else waveletCodec_encode()'s (wavelet)
+  const uint8_t *data;  ///< Codec output
+  uint16_t length;      ///< Bytes in data
+} TelemetryFrame_Compressed_t;
+
+/**
+ * @brief Sample-rate change carried by a rate packet (see adaptive_rate.h)
+ */
+typedef struct {
+  uint32_t first_frame;   ///< First frame at the new rate (header seq)
+  uint32_t timestamp;     ///< Time of the change (HAL tick, ms)
+  uint32_t frame_rate_hz; ///< New scan frame rate
+  uint16_t decimation;    ///< New stream decimation
+  uint8_t level;          ///< Rate level, 0 = fastest
+  float activity;         ///< Activity that caused the change (ADC codes)
+} TelemetryFrame_Rate_t;
+
+/**
+ * @brief Envelope spectrum features of one channel (bearing faults)
+ */
+typedef struct {
+  uint32_t sequence;       ///< Result number for this channel
+  uint32_t timestamp;      ///< Time of the result (HAL tick, ms)
+  uint8_t channel;         ///< Analysed channel
+  uint16_t length;         ///< FFT length
+  uint8_t averages;        ///< Welch segments averaged
+  float sample_rate_hz;    ///< Envelope sample rate (bin = rate / length)
+  float rms;               ///< Envelope AC RMS (ADC codes)
+  uint8_t tone_count;      ///< Entries used in the tone arrays
+  float tone_hz[TELEMETRY_FRAME_MAX_TONES];        ///< Frequency found
+  float tone_amplitude[TELEMETRY_FRAME_MAX_TONES]; ///< 0-pk (ADC codes)
+} TelemetryFrame_Envelope_t;
+
+/**
+ * @brief Goertzel bank amplitudes of one channel (dsp_goertzel.h)
+ */
+typedef struct {
+  uint32_t sequence;   ///< Window number
+  uint32_t timestamp;  ///< Time of the result (HAL tick, ms)
+  uint8_t channel;     ///< Channel
+  uint16_t length;     ///< Samples per window
+  uint8_t bin_count;   ///< Entries used in the bin arrays
+  float hz[TELEMETRY_FRAME_MAX_HARMONICS];        ///< Bin frequency
+  float amplitude[TELEMETRY_FRAME_MAX_HARMONICS]; ///< 0-pk
+} TelemetryFrame_Harmonics_t;
+
+/**
+ * @brief Magnitude of each tri-axis group over a run of frames, tilt of
+ *        the last one (dsp_vector.h)
+ */
+typedef struct {
+  uint32_t first_frame; ///< Sequence number of the first frame
+  uint32_t timestamp;   ///< Time of the first frame (HAL tick, ms)
+  uint16_t stride;      ///< Input frames between two entries (decimation)
+  uint8_t frame_count;  ///< Entries used, 1..TELEMETRY_FRAME_MAX_FRAMES
+  int16_t pitch_cdeg[TELEMETRY_FRAME_VECTOR_GROUPS]; ///< 0.01 degree
+  int16_t roll_cdeg[TELEMETRY_FRAME_VECTOR_GROUPS];  ///< 0.01 degree
+  uint16_t magnitude_mg[TELEMETRY_FRAME_MAX_FRAMES]
+                       [TELEMETRY_FRAME_VECTOR_GROUPS]; ///< mg
+} TelemetryFrame_Vector_t;
+
+/**
+ * @brief Error counters per channel and kind, and the loss counters of the
+ *        data path
+ */
+typedef struct {
+  uint32_t sequence;  ///< Diagnostics report number
+  uint32_t timestamp; ///< Time of the report (HAL tick, ms)
+  uint32_t counts[TELEMETRY_FRAME_DIAG_ROWS]
+                 [TELEMETRY_FRAME_DIAG_KINDS]; ///< Sent as the low 16 bits
+  uint32_t total_errors;         ///< analogSensor error count
+  uint32_t ring_overflows;       ///< Frames dropped by the ring
+  uint32_t telemetry_dropped;    ///< Packets dropped by the TX queue
+  uint32_t blocks_dropped;       ///< Blocks the polling consumer missed
+  uint32_t trigger_missed;       ///< Trigger alarms while busy
+  uint32_t trigger_blind_frames; ///< Frames not watched: capture frozen
+} TelemetryFrame_Diagnostics_t;
+
+/**
+ * @brief Frames of the external SPI ADC, numbered like the internal ones
+ */
+typedef struct {
+  uint32_t first_frame;  ///< Sequence number of the first frame
+  uint32_t timestamp;    ///< Time of the first frame (HAL tick, ms)
+  uint16_t stride;       ///< Scan frames between two entries (decimation)
+  uint8_t channel_count; ///< 1..TELEMETRY_FRAME_EXT_CHANNELS
+  uint8_t frame_count;   ///< Entries used; frames x channels fit samples[]
+  uint16_t samples[TELEMETRY_FRAME_EXT_SAMPLES]; ///< Codes, frame by frame
+} TelemetryFrame_External_t;
+
+/**
+ * @brief Order spectrum features of one channel (dsp_order.h): "Hz" of the
+ *        angle-domain spectrum are shaft orders
+ */
+typedef struct {
+  uint32_t sequence;        ///< Result number for this channel
+  uint32_t timestamp;       ///< Time of the result (HAL tick, ms)
+  uint8_t channel;          ///< Tracked channel
+  uint16_t length;          ///< FFT length
+  uint8_t averages;         ///< Welch segments averaged
+  uint16_t samples_per_rev; ///< Angle samples per revolution
+  float rpm;                ///< Shaft speed at the newest edge interval
+  float peak_order;         ///< Dominant order
+  float peak_amplitude;     ///< Its amplitude (ADC codes, 0-pk)
+  float rms;                ///< AC RMS (ADC codes)
+  uint8_t tone_count;       ///< Entries used in the tone arrays
+  float tone_order[TELEMETRY_FRAME_MAX_TONES];     ///< Order found
+  float tone_amplitude[TELEMETRY_FRAME_MAX_TONES]; ///< 0-pk (ADC codes)
+} TelemetryFrame_Order_t;
+
+/**
+ * @brief Velocity severity of one interval (dsp_velocity.h)
+ */
+typedef struct {
+  uint32_t sequence;    ///< Interval number
+  uint32_t timestamp;   ///< End of the interval (HAL tick, ms)
+  uint16_t interval_ms; ///< Interval length
+  uint16_t low_hz;      ///< Band, high-pass edge
+  uint16_t high_hz;     ///< Band, low-pass edge
+  ADC_ChannelMask_t channel_mask; ///< Channels carried (bit n = channel n)
+  float rms_mm_s[ADC_CONVERSIONS_CHANNEL_COUNT];  ///< Velocity RMS, by channel
+  float peak_mm_s[ADC_CONVERSIONS_CHANNEL_COUNT]; ///< Velocity 0-pk
+  uint8_t zone[ADC_CONVERSIONS_CHANNEL_COUNT];    ///< 0..3 = A..D, 0xFF none
+} TelemetryFrame_Velocity_t;
+
+/**
+ * @brief Cross-spectrum of one channel pair (dsp_coherence.h)
+ */
+typedef struct {
+  uint32_t sequence;   ///< Result number
+  uint32_t timestamp;  ///< Time of the result (HAL tick, ms)
+  uint8_t channel_x;   ///< Reference channel
+  uint8_t channel_y;   ///< Channel measured against it
+  uint16_t length;     ///< FFT length
+  uint8_t averages;    ///< Segments averaged
+  uint8_t freq_count;  ///< Entries used in the arrays
+  float hz[TELEMETRY_FRAME_MAX_COHERENCE];        ///< Bin frequency
+  float coherence[TELEMETRY_FRAME_MAX_COHERENCE]; ///< 0..1
+  float phase_deg[TELEMETRY_FRAME_MAX_COHERENCE]; ///< y - x, degrees
+  float gain[TELEMETRY_FRAME_MAX_COHERENCE];      ///< |y / x| (H1)
+} TelemetryFrame_Coherence_t;
+
+/**
+ * @brief Min/max envelope of a run of buckets (pipeline display() stage)
+ */
+typedef struct {
+  uint32_t first_frame;   ///< Input frame where bucket 0 starts
+  uint32_t timestamp;     ///< Time of bucket 0 (HAL tick, ms)
+  uint16_t bucket_frames; ///< Input frames per bucket
+  ADC_ChannelMask_t channel_mask; ///< Channels carried (bit n = channel n)
+  uint8_t bucket_count;   ///< Buckets; buckets x channels fit the arrays
+  uint16_t min[TELEMETRY_FRAME_DISPLAY_PAIRS]; ///< Codes, bucket by bucket
+  uint16_t max[TELEMETRY_FRAME_DISPLAY_PAIRS]; ///< ... in channel order
+} TelemetryFrame_Display_t;
+
+/**
+ * @brief Anomaly scores of the channel groups (nn_anomaly.h)
+ */
+typedef struct {
+  uint32_t sequence;    ///< Score number
+  uint32_t timestamp;   ///< End of the last window (HAL tick, ms)
+  uint16_t windows;     ///< Windows scored, 0 while learning
+  uint16_t learning;    ///< Windows still to learn, 0 = scoring
+  uint8_t group_count;  ///< Entries used in the arrays
+  uint8_t alarm_mask;   ///< Bit g: group g above its threshold
+  uint32_t cycles_max;  ///< Longest inference of one group (CPU cycles)
+  ADC_ChannelMask_t channel_mask[TELEMETRY_FRAME_ANOMALY_GROUPS];
+  float score_mean[TELEMETRY_FRAME_ANOMALY_GROUPS]; ///< Over the windows
+  float score_peak[TELEMETRY_FRAME_ANOMALY_GROUPS]; ///< Largest window
+} TelemetryFrame_Anomaly_t;
+
+/**
+ * @brief Octave or custom log band levels of one channel's spectrum
+ *        (dsp_bands.h)
+ */
+typedef struct {
+  uint32_t sequence;         ///< Spectrum result sequence number
+  uint32_t timestamp;        ///< Time of the result (HAL tick, ms)
+  uint8_t channel;           ///< Analysed channel
+  uint8_t fraction;          ///< 1 = octave, 3 = third octave, 0 = custom
+  uint8_t band_count;        ///< Entries used in level_rms[]
+  float first_centre_hz;     ///< Centre of band 0
+  float level_rms[TELEMETRY_FRAME_LOG_BANDS]; ///< RMS per band (codes)
+} TelemetryFrame_Bands_t;
+
+/**
+ * @brief Spectral baseline change of one channel (dsp_baseline.h)
+ */
+typedef struct {
+  uint32_t sequence;      ///< Spectrum result sequence number
+  uint32_t timestamp;     ///< Time of the result (HAL tick, ms)
+  uint8_t channel;        ///< Analysed channel
+  uint8_t event;          ///< DSP_BaselineEvent_t, 0 = status on request
+  uint8_t alarm;          ///< 1 = alarm raised
+  uint8_t worst_band;     ///< Band furthest from the baseline
+  uint16_t windows;       ///< Results learned
+  float score;            ///< Largest deviation in spreads, 0 learning
+  float worst_centre_hz;  ///< Centre of worst_band
+  float worst_db;         ///< Its level minus the baseline
+} TelemetryFrame_Baseline_t;
+
+/**
+ * @brief Rows of one channel's rainflow cycle matrix (dsp_rainflow.h)
+ */
+typedef struct {
+  uint32_t sequence;       ///< Request number, shared by a matrix's slices
+  uint32_t timestamp;      ///< Time of the snapshot (HAL tick, ms)
+  uint8_t channel;         ///< Counted channel
+  uint8_t range_bins;      ///< Rows of the whole matrix
+  uint8_t mean_bins;       ///< Columns
+  uint8_t first_row;       ///< Range bin of the first row carried
+  uint8_t row_count;       ///< Rows carried
+  uint8_t residual;        ///< Ranges left on the residual stack
+  float range_bin_codes;   ///< Width of a range bin
+  float mean_low_codes;    ///< Lower edge of mean bin 0
+  float mean_bin_codes;    ///< Width of a mean bin
+  float cycles;            ///< Full cycles in the whole matrix
+  float damage;            ///< Miner damage sum of the counted cycles
+  float damage_residual;   ///< ... with the residual as half cycles
+  uint32_t half_cycles[TELEMETRY_FRAME_RAINFLOW_CELLS]; ///< Row by row
+} TelemetryFrame_Rainflow_t;
+
+/**
+ * @brief Shock response spectrum of one channel of a capture (dsp_srs.h)
+ */
+typedef struct {
+  uint32_t trigger_frame;  ///< Frame number of the trigger, as its event
+  uint32_t timestamp;      ///< Time of the trigger (HAL tick, ms)
+  uint8_t channel;         ///< Analysed channel
+  uint8_t per_octave;      ///< Natural frequencies per octave
+  uint8_t freq_count;      ///< Entries used in peak_mg[]
+  float first_hz;          ///< Lowest natural frequency
+  float q;                 ///< Quality factor of the oscillators
+  float input_peak_mg;     ///< Largest |input| about the pre-trigger mean
+  float peak_mg[TELEMETRY_FRAME_SRS_FREQS]; ///< Maximax |acceleration|
+} TelemetryFrame_Srs_t;
+
+/**
+ * @brief Impact arrival times of a capture (dsp_arrival.h)
+ */
+typedef struct {
+  uint32_t trigger_frame;   ///< Frame number of the trigger, as its event
+  uint32_t timestamp;       ///< Time of the trigger (HAL tick, ms)
+  uint8_t first_channel;    ///< Earliest arrival
+  uint64_t first_us;        ///< Its arrival on the timebase, us
+  float frame_period_us;    ///< Measured frame period
+  float position_m;         ///< Along the located pair, NaN if not located
+  ADC_ChannelMask_t channel_mask; ///< Channels with an arrival
+  float delta_us[ADC_CONVERSIONS_CHANNEL_COUNT]; ///< After first_channel
+  uint16_t threshold_codes[ADC_CONVERSIONS_CHANNEL_COUNT]; ///< Applied
+} TelemetryFrame_Arrival_t;
+
+/**
+ * @brief Shock capture switched into the scan and back, the marker of the
+ *        scan frames it took (analogSensor_switchToCapture())
+ */
+typedef struct {
+  uint32_t gap_sequence;     ///< First scan frame it took (header seq)
+  uint32_t timestamp;        ///< Time the scan came back (HAL tick, ms)
+  uint8_t channel;           ///< Captured channel
+  uint32_t gap_frames;       ///< Scan frames it took; the scan resumes at
+                             ///< gap_sequence + gap_frames
+  uint64_t capture_start_us; ///< Its first conversion on the timebase
+  uint32_t capture_samples;  ///< Samples of the capture
+  uint32_t capture_rate_hz;  ///< Their rate
+  uint32_t enter_us;         ///< Scan to capture transition
+  uint32_t leave_us;         ///< Capture to scan transition
+  float frame_period_us;     ///< Scan frame period, the transitions' target
+} TelemetryFrame_Mode_t;
+
+/**
+ * @brief Consecutive samples of a burst recording (burst_capture.h)
+ */
+typedef struct {
+  uint32_t offset;          ///< Index of samples[0] in the burst (header seq)
+  uint32_t timestamp;       ///< Start of the burst (HAL tick, ms)
+  uint8_t channel;          ///< Recorded channel
+  uint8_t count;            ///< Samples, 1..TELEMETRY_FRAME_BURST_SAMPLES
+  uint32_t total;           ///< Samples of the whole burst
+  uint32_t sample_rate_hz;  ///< Their rate
+  const uint16_t *samples;  ///< count codes
+} TelemetryFrame_Burst_t;
+
+/**
+ * @brief Consecutive event log entries (event_log.h)
+ */
+typedef struct {
+  uint32_t first;                   ///< Sequence number of entries[0] (seq)
+  uint32_t timestamp;               ///< Sent at (HAL tick, ms)
+  uint32_t boot;                    ///< Boot they were written in
+  uint8_t previous;                 ///< 1 = kept from the previous boot
+  uint8_t count;                    ///< 1..TELEMETRY_FRAME_LOG_ENTRIES
+  uint32_t lost;                    ///< Overwritten before sent, so far
+  const EventLog_Entry_t *entries;  ///< count entries
+} TelemetryFrame_Log_t;
+
+/**
+ * @brief A piece of the payload a node sent in its TDMA bus slot
+ *        (tdma_bus.h)
+ */
+typedef struct {
+  uint32_t cycle;      ///< Bus cycle of the slot (seq)
+  uint32_t timestamp;  ///< Received at (HAL tick, ms)
+  uint8_t node;        ///< Node address
+  uint8_t count;       ///< Bytes, 1..TELEMETRY_FRAME_RELAY_BYTES
+  uint16_t offset;     ///< Offset of the first in the slot payload
+  const uint8_t *data; ///< count bytes
+} TelemetryFrame_Relay_t;
+
+/**
+ * @brief Largest power cepstrum peaks of one channel's spectrum
+ *        (dsp_spectrum.h): sideband families and their spacing
+ */
+typedef struct {
+  uint32_t sequence;   ///< Spectrum result sequence number
+  uint32_t timestamp;  ///< Time of the result (HAL tick, ms)
+  uint8_t channel;     ///< Analysed channel
+  uint8_t peak_count;  ///< Entries used in the arrays, largest first
+  float quefrency_ms[TELEMETRY_FRAME_CEPSTRUM_PEAKS]; ///< 1000 / spacing Hz
+  float amplitude[TELEMETRY_FRAME_CEPSTRUM_PEAKS];    ///< Nepers of power
+} TelemetryFrame_Cepstrum_t;
+
+/**
+ * @brief Consecutive angles of one time-synchronous averaged revolution
+ *        (dsp_tsa.h), with the features of the whole average
+ */
+typedef struct {
+  uint32_t sequence;        ///< Average sequence number
+  uint32_t timestamp;       ///< Time of the average (HAL tick, ms)
+  uint8_t channel;          ///< Tracked channel
+  uint16_t first;           ///< Angle of samples[0]
+  uint8_t count;            ///< Angles, 1..TELEMETRY_FRAME_TSA_SAMPLES
+  uint16_t samples_per_rev; ///< Angles of the whole revolution
+  uint16_t revolutions;     ///< Revolutions averaged
+  uint16_t rejected;        ///< Revolutions dropped meanwhile
+  float rpm;                ///< Shaft speed at the end
+  float mean;               ///< Mean of the revolution (codes)
+  float rms;                ///< Its AC RMS (codes)
+  float peak_to_peak;       ///< Its peak-to-peak (codes)
+  float residual_rms;       ///< Non-synchronous RMS (codes)
+  float scale;              ///< Codes per count, the same for every slice
+  const float *samples;     ///< count averaged values (codes)
+} TelemetryFrame_Tsa_t;
+
+/**
+ * @brief One channel of a stored feature rollup record (qspi_recorder.h)
+ */
+typedef struct {
+  uint32_t time_s;    ///< Start of the interval, rollup clock (header seq)
+  uint32_t timestamp; ///< Sent at (HAL tick, ms)
+  uint8_t tier;       ///< 0 = 1 s, 1 = 1 min, 2 = 1 h
+  uint8_t channel;
+  uint32_t windows;   ///< Feature windows in the interval
+  const float *min;   ///< TELEMETRY_FRAME_FEATURES values each
+  const float *max;
+  const float *mean;
+} TelemetryFrame_Rollup_t;
+
+/**
+ * @brief One digital input record: the inputs at the first frame of a new
+ *        state (digital_in.h)
+ */
+typedef struct {
+  uint32_t frame;   ///< Scan frame sequence number
+  uint64_t time_us; ///< Its trigger on the timebase
+  uint16_t levels;  ///< Input levels, bit n = port pin n
+  uint16_t changed; ///< Pins changed since the frame before, 0 = state only
+} TelemetryFrame_DigitalEdge_t;
+
+/**
+ * @brief Digital input records, oldest first
+ */
+typedef struct {
+  uint32_t timestamp; ///< Sent at (HAL tick, ms)
+  uint16_t pins;      ///< Pins sampled
+  uint32_t dropped;   ///< Records lost so far to a full queue
+  uint8_t count;      ///< Records, 1..TELEMETRY_FRAME_DIGITAL_EDGES
+  const TelemetryFrame_DigitalEdge_t *edges;
+} TelemetryFrame_Digital_t;
+
+/**
+ * @brief Feature values of every channel at one instant
+ */
+typedef struct {
+  uint32_t sequence;  ///< Newest frame sequence number
+  uint32_t timestamp; ///< Time of the values (HAL tick, ms), drives heartbeats
+  ADC_ChannelMask_t channel_mask; ///< Channels with values
+  float value[ADC_CONVERSIONS_CHANNEL_COUNT]
+             [TELEMETRY_FRAME_FEATURES]; ///< By channel, then feature
+} TelemetryFrame_Features_t;
+
+/**
+ * @brief Report-by-exception settings
+ */
+typedef struct {
+  float deadband[TELEMETRY_FRAME_FEATURES]; ///< Change that is sent, >= 0
+  uint32_t heartbeat_ms; ///< Full record per channel this often, 0 = never
+} TelemetryFrame_ExceptionConfig_t;
+
+/**
+ * @brief Report-by-exception state: what the host was last sent, per
+ *        channel and feature
+ *
+ * A feature goes out when it is more than its dead-band away from the value
+ * last sent (not the previous value, so a slow drift is still reported once
+ * it adds up). A channel's whole record goes out the first time, after
+ * telemetryFrame_resetException(), and when heartbeat_ms passed since its
+ * last whole record, so the host re-syncs after a lost packet and can tell a
+ * quiet channel from a dead node.
+ */
+typedef struct {
+  TelemetryFrame_ExceptionConfig_t cfg;
+  float sent[ADC_CONVERSIONS_CHANNEL_COUNT][TELEMETRY_FRAME_FEATURES];
+  uint32_t record_ms[ADC_CONVERSIONS_CHANNEL_COUNT]; ///< Last whole record
+  ADC_ChannelMask_t known; ///< Channels the host has a whole record of
+  uint32_t evaluated;      ///< Features offered since init
+  uint32_t reported;       ///< ... of which were sent
+  uint32_t packets;        ///< Exception packets encoded
+} TelemetryFrame_Exception_t;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief Start an empty batch
+ *
+ * @param batch        Batch to reset
+ * @param channel_mask Channels to include, non-zero
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer or empty/invalid mask
+ */
+HAL_StatusTypeDef telemetryFrame_initBatch(TelemetryFrame_Batch_t *batch,
+                                           ADC_ChannelMask_t channel_mask);
+
+/**
+ * @brief Append one frame to a batch
+ *
+ * @param batch Batch being filled
+ * @param entry Frame from the ADC ring
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Frame added
+ *   @retval HAL_BUSY  Batch already full
+ *   @retval HAL_ERROR NULL pointer
+ */
+HAL_StatusTypeDef telemetryFrame_addFrame(TelemetryFrame_Batch_t *batch,
+                                          const ADC_RingEntry_t *entry);
+
+/**
+ * @brief Check whether a batch holds TELEMETRY_FRAME_MAX_FRAMES frames
+ *
+ * @param batch Batch to test
+ *
+ * @return uint8_t 1 if full, 0 otherwise
+ */
+uint8_t telemetryFrame_isFull(const TelemetryFrame_Batch_t *batch);
+
+/**
+ * @brief Encode a batch as a delimited COBS sample packet
+ *
+ * @param batch   Non-empty batch
+ * @param out     Output buffer
+ * @param cap     Capacity of out (TELEMETRY_FRAME_ENCODED_MAX is enough)
+ * @param out_len Bytes written
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer, empty batch or buffer too small
+ */
+HAL_StatusTypeDef telemetryFrame_encodeSamples(
+    const TelemetryFrame_Batch_t *batch, uint8_t *out, uint16_t cap,
+    uint16_t *out_len);
+
+/**
+ * @brief Encode a delimited COBS status packet
+ *
+ * @param status  Counters to send
+ * @param out     Output buffer
+ * @param cap     Capacity of out
+ * @param out_len Bytes written
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer or buffer too small
+ */
+HAL_StatusTypeDef telemetryFrame_encodeStatus(
+    const TelemetryFrame_Status_t *status, uint8_t *out, uint16_t cap,
+    uint16_t *out_len);
+
+/**
+ * @brief Encode a delimited COBS spectrum packet
+ *
+ * @param spectrum Features to send
+ * @param out      Output buffer
+ * @param cap      Capacity of out
+ * @param out_len  Bytes written
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer, too many bands or buffer too small
+ */
+HAL_StatusTypeDef telemetryFrame_encodeSpectrum(
+    const TelemetryFrame_Spectrum_t *spectrum, uint8_t *out, uint16_t cap,
+    uint16_t *out_len);
+
+/**
+ * @brief Encode a delimited COBS stats packet
+ *
+ * @param stats   Statistics of every channel over one window
+ * @param out     Output buffer
+ * @param cap     Capacity of out
+ * @param out_len Bytes written
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer or buffer too small
+ */
+HAL_StatusTypeDef telemetryFrame_encodeStats(const TelemetryFrame_Stats_t *stats,
+                                             uint8_t *out, uint16_t cap,
+                                             uint16_t *out_len);
+
+/**
+ * @brief Encode a delimited COBS event packet
+ *
+ * @param event   Trigger that started a capture
+ * @param out     Output buffer
+ * @param cap     Capacity of out
+ * @param out_len Bytes written
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer or buffer too small
+ */
+HAL_StatusTypeDef telemetryFrame_encodeEvent(const TelemetryFrame_Event_t *event,
+                                             uint8_t *out, uint16_t cap,
+                                             uint16_t *out_len);
+
+/**
+ * @brief Encode a delimited COBS timing packet
+ *
+ * @param timing  Block timestamp and rate estimate
+ * @param out     Output buffer
+ * @param cap     Capacity of out
+ * @param out_len Bytes written
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer or buffer too small
+ */
+HAL_StatusTypeDef telemetryFrame_encodeTiming(
+    const TelemetryFrame_Timing_t *timing, uint8_t *out, uint16_t cap,
+    uint16_t *out_len);
+
+/**
+ * @brief Encode a delimited COBS sync packet
+ *
+ * @param sync    Discipline status
+ * @param out     Output buffer
+ * @param cap     Capacity of out
+ * @param out_len Bytes written
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer or buffer too small
+ */
+HAL_StatusTypeDef telemetryFrame_encodeSync(const TelemetryFrame_Sync_t *sync,
+                                            uint8_t *out, uint16_t cap,
+                                            uint16_t *out_len);
+
+/**
+ * @brief Encode a delimited COBS compressed-run packet, or a wavelet packet
+ *        when run->max_error is set
+ *
+ * @param run     Channel run and its codec output
+ * @param out     Output buffer
+ * @param cap     Capacity of out (TELEMETRY_FRAME_CODEC_ENCODED_MAX fits)
+ * @param out_len Bytes written
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer, bad frame count, run larger than a
+ *                     verbatim run, or buffer too small
+ */
+HAL_StatusTypeDef telemetryFrame_encodeCompressed(
+    const TelemetryFrame_Compressed_t *run, uint8_t *out, uint16_t cap,
+    uint16_t *out_len);
+
+/**
+ * @brief Encode a delimited COBS rate packet
+ *
+ * @param rate    Rate change
+ * @param out     Output buffer
+ * @param cap     Capacity of out
+ * @param out_len Bytes written
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer or buffer too small
+ */
+HAL_StatusTypeDef telemetryFrame_encodeRate(const TelemetryFrame_Rate_t *rate,
+                                            uint8_t *out, uint16_t cap,
+                                            uint16_t *out_len);
+
+/**
+ * @brief Encode a delimited COBS envelope packet
+ *
+ * @param envelope Envelope features
+ * @param out      Output buffer
+ * @param cap      Capacity of out
+ * @param out_len  Bytes written
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer, too many tones or buffer too small
+ */
+HAL_StatusTypeDef telemetryFrame_encodeEnvelope(
+    const TelemetryFrame_Envelope_t *envelope, uint8_t *out, uint16_t cap,
+    uint16_t *out_len);
+
+/**
+ * @brief Encode a delimited COBS harmonics packet
+ *
+ * @param harmonics Bin amplitudes of one channel
+ * @param out       Output buffer
+ * @param cap       Capacity of out
+ * @param out_len   Bytes written
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer, too many bins or buffer too small
+ */
+HAL_StatusTypeDef telemetryFrame_encodeHarmonics(
+    const TelemetryFrame_Harmonics_t *harmonics, uint8_t *out, uint16_t cap,
+    uint16_t *out_len);
+
+/**
+ * @brief Encode a delimited COBS vector packet
+ *
+ * @param vector  Group magnitudes and tilt
+ * @param out     Output buffer
+ * @param cap     Capacity of out
+ * @param out_len Bytes written
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer, no or too many frames, or buffer too
+ *                     small
+ */
+HAL_StatusTypeDef telemetryFrame_encodeVector(
+    const TelemetryFrame_Vector_t *vector, uint8_t *out, uint16_t cap,
+    uint16_t *out_len);
+
+/**
+ * @brief Encode a delimited COBS diagnostics packet
+ *
+ * @param diag    Counters
+ * @param out     Output buffer
+ * @param cap     Capacity of out
+ * @param out_len Bytes written
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer or buffer too small
+ */
+HAL_StatusTypeDef telemetryFrame_encodeDiagnostics(
+    const TelemetryFrame_Diagnostics_t *diag, uint8_t *out, uint16_t cap,
+    uint16_t *out_len);
+
+/**
+ * @brief Encode a delimited COBS external-ADC packet
+ *
+ * @param ext     Frames of the external channels
+ * @param out     Output buffer
+ * @param cap     Capacity of out
+ * @param out_len Bytes written
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer, bad shape or buffer too small
+ */
+HAL_StatusTypeDef telemetryFrame_encodeExternal(
+    const TelemetryFrame_External_t *ext, uint8_t *out, uint16_t cap,
+    uint16_t *out_len);
+
+/**
+ * @brief Encode a delimited COBS order packet
+ *
+ * @param order   Order spectrum features
+ * @param out     Output buffer
+ * @param cap     Capacity of out
+ * @param out_len Bytes written
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer, too many tones or buffer too small
+ */
+HAL_StatusTypeDef telemetryFrame_encodeOrder(
+    const TelemetryFrame_Order_t *order, uint8_t *out, uint16_t cap,
+    uint16_t *out_len);
+
+/**
+ * @brief Encode a delimited COBS velocity packet
+ *
+ * @param vel     Velocity severity; only the channels in channel_mask go out
+ * @param out     Output buffer
+ * @param cap     Capacity of out
+ * @param out_len Bytes written
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer or buffer too small
+ */
+HAL_StatusTypeDef telemetryFrame_encodeVelocity(
+    const TelemetryFrame_Velocity_t *vel, uint8_t *out, uint16_t cap,
+    uint16_t *out_len);
+
+/**
+ * @brief Encode a delimited COBS coherence packet
+ *
+ * @param coh     Cross-spectrum of one pair
+ * @param out     Output buffer
+ * @param cap     Capacity of out
+ * @param out_len Bytes written
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer, too many frequencies or buffer too small
+ */
+HAL_StatusTypeDef telemetryFrame_encodeCoherence(
+    const TelemetryFrame_Coherence_t *coh, uint8_t *out, uint16_t cap,
+    uint16_t *out_len);
+
+/**
+ * @brief Encode a delimited COBS display packet
+ *
+ * @param disp    Min/max envelope of the carried channels
+ * @param out     Output buffer
+ * @param cap     Capacity of out (TELEMETRY_FRAME_ENCODED_MAX is enough)
+ * @param out_len Bytes written
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer, no bucket, bad mask, too many pairs or
+ *                     buffer too small
+ */
+HAL_StatusTypeDef telemetryFrame_encodeDisplay(
+    const TelemetryFrame_Display_t *disp, uint8_t *out, uint16_t cap,
+    uint16_t *out_len);
+
+/**
+ * @brief Encode a delimited COBS anomaly packet
+ *
+ * @param anomaly Scores of the channel groups
+ * @param out     Output buffer
+ * @param cap     Capacity of out (TELEMETRY_FRAME_ENCODED_MAX is enough)
+ * @param out_len Bytes written
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer, too many groups or buffer too small
+ */
+HAL_StatusTypeDef telemetryFrame_encodeAnomaly(
+    const TelemetryFrame_Anomaly_t *anomaly, uint8_t *out, uint16_t cap,
+    uint16_t *out_len);
+
+/**
+ * @brief Encode a delimited COBS bands packet; each RMS goes out as an
+ *        int16 level in 0.01 dB re 1 code
+ *
+ * @param bands   Log band levels of one spectrum
+ * @param out     Output buffer
+ * @param cap     Capacity of out (TELEMETRY_FRAME_ENCODED_MAX is enough)
+ * @param out_len Bytes written
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer, too many bands or buffer too small
+ */
+HAL_StatusTypeDef telemetryFrame_encodeBands(
+    const TelemetryFrame_Bands_t *bands, uint8_t *out, uint16_t cap,
+    uint16_t *out_len);
+
+/**
+ * @brief Encode a delimited COBS baseline packet
+ *
+ * @param baseline Baseline change of one channel
+ * @param out      Output buffer
+ * @param cap      Capacity of out (TELEMETRY_FRAME_ENCODED_MAX is enough)
+ * @param out_len  Bytes written
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer or buffer too small
+ */
+HAL_StatusTypeDef telemetryFrame_encodeBaseline(
+    const TelemetryFrame_Baseline_t *baseline, uint8_t *out, uint16_t cap,
+    uint16_t *out_len);
+
+/**
+ * @brief Encode a delimited COBS rainflow packet
+ *
+ * @param rainflow Rows of one channel's cycle matrix
+ * @param out      Output buffer
+ * @param cap      Capacity of out (TELEMETRY_FRAME_ENCODED_MAX is enough)
+ * @param out_len  Bytes written
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer, more cells than
+ *                     TELEMETRY_FRAME_RAINFLOW_CELLS or buffer too small
+ */
+HAL_StatusTypeDef telemetryFrame_encodeRainflow(
+    const TelemetryFrame_Rainflow_t *rainflow, uint8_t *out, uint16_t cap,
+    uint16_t *out_len);
+
+/**
+ * @brief Encode a delimited COBS SRS packet
+ *
+ * @param srs     Shock response spectrum of one channel
+ * @param out     Output buffer
+ * @param cap     Capacity of out (TELEMETRY_FRAME_ENCODED_MAX is enough)
+ * @param out_len Bytes written
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer, too many frequencies or buffer too
+ *                     small
+ */
+HAL_StatusTypeDef telemetryFrame_encodeSrs(const TelemetryFrame_Srs_t *srs,
+                                           uint8_t *out, uint16_t cap,
+                                           uint16_t *out_len);
+
+/**
+ * @brief Encode a delimited COBS impact arrival packet
+ *
+ * @param arrival Arrivals; only the channels in channel_mask go out
+ * @param out     Output buffer
+ * @param cap     Capacity of out (TELEMETRY_FRAME_ENCODED_MAX is enough)
+ * @param out_len Bytes written
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer or buffer too small
+ */
+HAL_StatusTypeDef telemetryFrame_encodeArrival(
+    const TelemetryFrame_Arrival_t *arrival, uint8_t *out, uint16_t cap,
+    uint16_t *out_len);
+
+/**
+ * @brief Encode a delimited COBS mode packet
+ *
+ * @param mode    Capture taken out of the scan
+ * @param out     Output buffer
+ * @param cap     Capacity of out
+ * @param out_len Bytes written
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer or buffer too small
+ */
+HAL_StatusTypeDef telemetryFrame_encodeMode(const TelemetryFrame_Mode_t *mode,
+                                            uint8_t *out, uint16_t cap,
+                                            uint16_t *out_len);
+
+/**
+ * @brief Encode a delimited COBS burst packet
+ *
+ * @param burst   Slice of the recording
+ * @param out     Output buffer
+ * @param cap     Capacity of out (TELEMETRY_FRAME_ENCODED_MAX is enough)
+ * @param out_len Bytes written
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer, bad count or buffer too small
+ */
+HAL_StatusTypeDef telemetryFrame_encodeBurst(
+    const TelemetryFrame_Burst_t *burst, uint8_t *out, uint16_t cap,
+    uint16_t *out_len);
+
+/**
+ * @brief Encode a delimited COBS event log packet
+ *
+ * @param log     Entries and where they come from
+ * @param out     Output buffer
+ * @param cap     Capacity of out (TELEMETRY_FRAME_ENCODED_MAX is enough)
+ * @param out_len Bytes written
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer, bad count or buffer too small
+ */
+HAL_StatusTypeDef telemetryFrame_encodeLog(const TelemetryFrame_Log_t *log,
+                                           uint8_t *out, uint16_t cap,
+                                           uint16_t *out_len);
+
+/**
+ * @brief Encode a piece of a TDMA node's payload as a relay packet
+ *
+ * @param relay   Node, cycle and bytes
+ * @param out     Output buffer
+ * @param cap     Capacity of out (TELEMETRY_FRAME_ENCODED_MAX is enough)
+ * @param out_len Bytes written
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer, bad count or buffer too small
+ */
+HAL_StatusTypeDef telemetryFrame_encodeRelay(
+    const TelemetryFrame_Relay_t *relay, uint8_t *out, uint16_t cap,
+    uint16_t *out_len);
+
+/**
+ * @brief Encode a delimited COBS cepstrum packet
+ *
+ * @param cepstrum Quefrency peaks of one spectrum
+ * @param out      Output buffer
+ * @param cap      Capacity of out (TELEMETRY_FRAME_ENCODED_MAX is enough)
+ * @param out_len  Bytes written
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer, too many peaks or buffer too small
+ */
+HAL_StatusTypeDef telemetryFrame_encodeCepstrum(
+    const TelemetryFrame_Cepstrum_t *cepstrum, uint8_t *out, uint16_t cap,
+    uint16_t *out_len);
+
+/**
+ * @brief Encode a slice of an averaged revolution as a TSA packet; each
+ *        value goes out as (value - mean) / scale in 16 bits
+ *
+ * @param tsa     Slice and features
+ * @param out     Output buffer
+ * @param cap     Capacity of out (TELEMETRY_FRAME_ENCODED_MAX is enough)
+ * @param out_len Bytes written
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer, bad count, scale not above 0 or buffer
+ *                     too small
+ */
+HAL_StatusTypeDef telemetryFrame_encodeTsa(const TelemetryFrame_Tsa_t *tsa,
+                                           uint8_t *out, uint16_t cap,
+                                           uint16_t *out_len);
+
+/**
+ * @brief Encode one channel of a rollup record as a rollup packet
+ *
+ * @param rollup  Record channel
+ * @param out     Output buffer
+ * @param cap     Capacity of out (TELEMETRY_FRAME_ENCODED_MAX is enough)
+ * @param out_len Bytes written
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer or buffer too small
+ */
+HAL_StatusTypeDef telemetryFrame_encodeRollup(
+    const TelemetryFrame_Rollup_t *rollup, uint8_t *out, uint16_t cap,
+    uint16_t *out_len);
+
+/**
+ * @brief Encode digital input records as a digital packet; the first
+ *        record's frame is the header sequence
+ *
+ * @param digital Records
+ * @param out     Output buffer
+ * @param cap     Capacity of out (TELEMETRY_FRAME_ENCODED_MAX is enough)
+ * @param out_len Bytes written
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer, no or too many records, or buffer too
+ *                     small
+ */
+HAL_StatusTypeDef telemetryFrame_encodeDigital(
+    const TelemetryFrame_Digital_t *digital, uint8_t *out, uint16_t cap,
+    uint16_t *out_len);
+
+/**
+ * @brief Encode a stats packet's content as a delimited COBS CBOR packet
+ *
+ * @param stats   Statistics of every channel over one window
+ * @param out     Output buffer
+ * @param cap     Capacity of out (TELEMETRY_FRAME_ENCODED_MAX is enough)
+ * @param out_len Bytes written
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer or buffer too small
+ */
+HAL_StatusTypeDef telemetryFrame_encodeStatsCbor(
+    const TelemetryFrame_Stats_t *stats, uint8_t *out, uint16_t cap,
+    uint16_t *out_len);
+
+/**
+ * @brief Encode a spectrum packet's content as a delimited COBS CBOR packet
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer, too many bands or buffer too small
+ */
+HAL_StatusTypeDef telemetryFrame_encodeSpectrumCbor(
+    const TelemetryFrame_Spectrum_t *spectrum, uint8_t *out, uint16_t cap,
+    uint16_t *out_len);
+
+/**
+ * @brief Encode a velocity packet's content as a delimited COBS CBOR
+ *        packet; only the channels in channel_mask go out
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer or buffer too small
+ */
+HAL_StatusTypeDef telemetryFrame_encodeVelocityCbor(
+    const TelemetryFrame_Velocity_t *vel, uint8_t *out, uint16_t cap,
+    uint16_t *out_len);
+
+/**
+ * @brief Set up report-by-exception; every channel's first record is whole
+ *
+ * @param exc Instance
+ * @param cfg Settings, copied
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer or a negative dead-band
+ */
+HAL_StatusTypeDef telemetryFrame_initException(
+    TelemetryFrame_Exception_t *exc, const TelemetryFrame_ExceptionConfig_t *cfg);
+
+/**
+ * @brief Send every channel's whole record next time (host reconnected,
+ *        mode switched)
+ */
+void telemetryFrame_resetException(TelemetryFrame_Exception_t *exc);
+
+/**
+ * @brief Feature values of a stats packet
+ *
+ * @param stats    Statistics and tracked DC of every channel
+ * @param features Filled, all channels
+ */
+void telemetryFrame_statsFeatures(const TelemetryFrame_Stats_t *stats,
+                                  TelemetryFrame_Features_t *features);
+
+/**
+ * @brief Encode the features that are due as a delimited COBS exception
+ *        packet
+ *
+ * The state only moves on when a packet is written: after HAL_ERROR the
+ * same features are due again.
+ *
+ * @param exc      Report-by-exception state, updated
+ * @param features Newest values
+ * @param out      Output buffer
+ * @param cap      Capacity of out (TELEMETRY_FRAME_ENCODED_MAX is enough)
+ * @param out_len  Bytes written
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Packet written
+ *   @retval HAL_BUSY  Nothing due, no packet
+ *   @retval HAL_ERROR NULL pointer or buffer too small
+ */
+HAL_StatusTypeDef telemetryFrame_encodeException(
+    TelemetryFrame_Exception_t *exc, const TelemetryFrame_Features_t *features,
+    uint8_t *out, uint16_t cap, uint16_t *out_len);
+
+/**
+ * @brief CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF, no reflection)
+ *
+ * Computed by the CRC unit, or in software while it is owned elsewhere
+ * (see crc_unit.h).
+ *
+ * @param data Bytes to checksum
+ * @param len  Number of bytes
+ *
+ * @return uint16_t CRC value
+ */
+uint16_t telemetryFrame_crc16(const uint8_t *data, uint16_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TELEMETRY_FRAME_H */
@@ -0,0 +1,87 @@
+/**
+ ******************************************************************************
+ * @file    text_format.h
+ * @brief   Fixed-width decimal and hex formatting without printf
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * The ASCII bring-up stream prints every frame as text. newlib-nano's
+ * snprintf parses the format string, walks its varargs and divides by 10
+ * once per digit for every field, and takes a few hundred bytes of stack.
+ * The per-frame lines here need none of that: unsigned fields, a known
+ * width, decimal or hex.
+ *
+ * Decimal digits are produced two at a time from a 200-byte table of the
+ * pairs "00".."99": one division by 100 (a multiply by constant) per pair.
+ * Hex is a nibble lookup. Nothing is NUL-terminated and nothing is checked
+ * against a buffer size: the caller reserves the worst case, which the
+ * TEXT_FORMAT_*_MAX constants give.
+ *
+ * Usage Example:
+ *   char line[32];
+ *   char *p = line;
+ *   p += textFormat_u32(p, sequence);        // "%lu"
+ *   *p++ = ' ';
+ *   p += textFormat_u32Width(p, code, 4);    // "%4lu"
+ *   *p++ = ' ';
+ *   p += textFormat_hex(p, flags, 2);        // "%02lx"
+ *   telemetry_send((const uint8_t *)line, (uint16_t)(p - line));
+ ******************************************************************************
+ */
+
+#ifndef TEXT_FORMAT_H
+#define TEXT_FORMAT_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+
+#define TEXT_FORMAT_U32_MAX 10U ///< Digits of 4294967295
+#define TEXT_FORMAT_HEX_MAX 8U  ///< Nibbles of a uint32_t
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief Decimal digits of value, no padding ("%lu")
+ *
+ * @param out   At least TEXT_FORMAT_U32_MAX bytes
+ * @param value Value to print
+ *
+ * @return Characters written, 1..TEXT_FORMAT_U32_MAX
+ */
+uint8_t textFormat_u32(char *out, uint32_t value);
+
+/**
+ * @brief Decimal, right-aligned with spaces in width characters ("%*lu");
+ *        a longer number is written whole
+ *
+ * @param out   At least max(width, TEXT_FORMAT_U32_MAX) bytes
+ * @param value Value to print
+ * @param width Field width
+ *
+ * @return Characters written
+ */
+uint8_t textFormat_u32Width(char *out, uint32_t value, uint8_t width);
+
+/**
+ * @brief Lower-case hex of the low digits nibbles, zero-padded ("%0*lx")
+ *
+ * @param out    At least digits bytes
+ * @param value  Value to print; higher nibbles are dropped
+ * @param digits 1..TEXT_FORMAT_HEX_MAX
+ *
+ * @return Characters written (digits, clamped to the valid range)
+ */
+uint8_t textFormat_hex(char *out, uint32_t value, uint8_t digits);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TEXT_FORMAT_H */
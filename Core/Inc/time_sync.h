@@ -0,0 +1,227 @@
+/**
+ ******************************************************************************
+ * @file    time_sync.h
+ * @brief   Sampling timer disciplined to an external 1PPS / sync pulse
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * A shared pulse on TIM2_CH4 (PB11, AF1) is captured against TIM2 itself,
+ * the timer that triggers every scan. Each capture yields, to one timer
+ * tick (9.3 ns at 108 MHz):
+ *
+ *   - the local ticks between two pulses, i.e. the oscillator's true rate,
+ *     counted from the periods this module programmed;
+ *   - the phase error: distance from the pulse to the nearest scan
+ *     trigger, positive when the trigger came first.
+ *
+ * The next pulse interval is then paced at exactly that rate plus half of
+ * the phase error. The fractional period is spread over the frames by a
+ * 32-bit phase accumulator in the TIM2 update interrupt, which writes ARR
+ * (preloaded) with the integer period or one more. Boards fed with the same
+ * pulse converge to the same trigger instants and the same frame numbering
+ * per pulse (TimeSync_Status_t.pulse_frame), so their streams line up
+ * without resampling.
+ *
+ * The pulse can also come from the Ethernet MAC: with TIME_SYNC_INPUT_PTP
+ * the capture takes the PTP target-time trigger on TIM2 ITR1 instead of
+ * the pin. ptp_sync.h fires it on every whole PTP second, so the frames
+ * follow the PTP grandmaster without a sync cable.
+ *
+ * With timeSync_setDiscipline(0) the pulses are only measured: TIM2 keeps
+ * its nominal period, and phase_ns, clock_ppm and pulse_frame say where
+ * each pulse fell among the free-running frames (dsp_asrc.h resamples the
+ * stream from them).
+ *
+ * Without pulses the last rate is kept (holdover). The rate must be a
+ * multiple of TIME_SYNC_PULSE_HZ. TIM2 runs one short interrupt per frame
+ * while synchronising; a frame interrupt delayed by a whole period (e.g.
+ * behind a long block callback) is detected on the timebase and accounted
+ * for.
+ *
+ * Usage Example:
+ *   timeSync_start(4000U);            // before the TIM2 scan starts
+ *   analogSensor_startTimedDMA(4000U);
+ *
+ *   TimeSync_Status_t sync;
+ *   timeSync_getStatus(&sync);
+ *   if (sync.state == TIME_SYNC_LOCKED) {
+ *     // within TIME_SYNC_LOCK_NS of the pulse; sync.phase_ns is the error
+ *   }
+ *
+ ******************************************************************************
+ */
+
+#ifndef TIME_SYNC_H
+#define TIME_SYNC_H
+
+#include "irq_priority.h"
+#include "stm32f7xx_hal.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+
+/**
+ * @brief Sync pulse rate; the frame rate must be a multiple of it
+ */
+#ifndef TIME_SYNC_PULSE_HZ
+#define TIME_SYNC_PULSE_HZ 1U
+#endif
+
+/**
+ * @brief Capture input (TIM2_CH1..3 pins are ADC inputs on this board)
+ */
+#ifndef TIME_SYNC_GPIO_PORT
+#define TIME_SYNC_GPIO_PORT GPIOB
+#define TIME_SYNC_GPIO_PIN GPIO_PIN_11
+#define TIME_SYNC_GPIO_CLK_ENABLE() __HAL_RCC_GPIOB_CLK_ENABLE()
+#endif
+
+/**
+ * @brief Reject pulse intervals further than this from nominal (HSI is
+ *        +-1 % over temperature)
+ */
+#ifndef TIME_SYNC_MAX_PPM
+#define TIME_SYNC_MAX_PPM 20000U
+#endif
+
+/**
+ * @brief Phase error below which a pulse counts towards lock
+ */
+#ifndef TIME_SYNC_LOCK_NS
+#define TIME_SYNC_LOCK_NS 500U
+#endif
+
+/**
+ * @brief Consecutive pulses within TIME_SYNC_LOCK_NS to report lock
+ */
+#ifndef TIME_SYNC_LOCK_PULSES
+#define TIME_SYNC_LOCK_PULSES 3U
+#endif
+
+/**
+ * @brief TIM2 interrupt priority; must pre-empt everything but the ADC DMA
+ */
+#ifndef TIME_SYNC_IRQ_PRIORITY
+#define TIME_SYNC_IRQ_PRIORITY IRQ_PRIORITY_TIMER
+#endif
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief Discipline state
+ */
+typedef enum {
+  TIME_SYNC_OFF = 0,   ///< Not started
+  TIME_SYNC_NO_SIGNAL, ///< Started, no usable pulse yet (nominal rate)
+  TIME_SYNC_ACQUIRING, ///< Following the pulses, phase not settled
+  TIME_SYNC_LOCKED,    ///< Phase within TIME_SYNC_LOCK_NS
+  TIME_SYNC_HOLDOVER,  ///< Pulses lost, running at the last rate
+  TIME_SYNC_MEASURING  ///< Following the pulses, TIM2 left at nominal
+} TimeSync_State_t;
+
+/**
+ * @brief Source of the sync pulse
+ */
+typedef enum {
+  TIME_SYNC_INPUT_PIN = 0, ///< TIME_SYNC_GPIO_PIN (TIM2_CH4)
+  TIME_SYNC_INPUT_PTP      ///< Ethernet PTP trigger on ITR1 (ptp_sync.h)
+} TimeSync_Input_t;
+
+/**
+ * @brief Discipline status after the newest pulse
+ */
+typedef struct {
+  TimeSync_State_t state;
+  uint32_t pulses;         ///< Pulses accepted since the start
+  uint32_t rejected;       ///< Pulses off by more than TIME_SYNC_MAX_PPM
+  uint32_t missed_updates; ///< Frame interrupts that came a period late
+  int32_t phase_ns;        ///< Pulse minus nearest trigger (+ = frames early)
+  float clock_ppm;         ///< Local timer clock vs its nominal frequency
+  uint32_t pulse_frame;    ///< Frame triggered nearest to the newest pulse
+  uint64_t pulse_time;     ///< timebase_now() at the newest pulse
+} TimeSync_Status_t;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief Select the pulse source of the next timeSync_start()
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Selected
+ *   @retval HAL_BUSY  Running; stop first
+ *   @retval HAL_ERROR Unknown input
+ */
+HAL_StatusTypeDef timeSync_setInput(TimeSync_Input_t input);
+
+/**
+ * @brief Pace TIM2 from the pulses (1, the default) or only measure them
+ *        (0) from the next timeSync_start()
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK   Selected
+ *   @retval HAL_BUSY Running; stop first
+ */
+HAL_StatusTypeDef timeSync_setDiscipline(uint8_t enable);
+
+/**
+ * @brief Capture the sync input and pace TIM2 from it
+ *
+ * @param frame_rate_hz Frames per second, a multiple of TIME_SYNC_PULSE_HZ;
+ *                      pass the rate given to analogSensor_startTimedDMA()
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Capture armed, nominal period loaded
+ *   @retval HAL_BUSY  TIM2 is already running (call before the scan starts)
+ *   @retval HAL_ERROR Rate not a multiple of the pulse rate, or too fast
+ *
+ * @note While running this module owns ARR: analogSensor_setSampleRate()
+ *       is overridden at the next frame.
+ */
+HAL_StatusTypeDef timeSync_start(uint32_t frame_rate_hz);
+
+/**
+ * @brief Change the paced frame rate while running
+ *
+ * @param frame_rate_hz New frames per second, a multiple of TIME_SYNC_PULSE_HZ
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Rate changed from the next frame on; the measured clock
+ *                     error is kept, the phase lock is acquired again
+ *   @retval HAL_ERROR Not running, or invalid rate
+ *
+ * @note Use this instead of analogSensor_setSampleRate() while running.
+ */
+HAL_StatusTypeDef timeSync_setFrameRate(uint32_t frame_rate_hz);
+
+/**
+ * @brief Stop the capture and the frame interrupt; TIM2 keeps its period
+ */
+void timeSync_stop(void);
+
+/**
+ * @brief Discipline status
+ *
+ * @param status Receives the status
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer
+ */
+HAL_StatusTypeDef timeSync_getStatus(TimeSync_Status_t *status);
+
+/**
+ * @brief TIM2 update / capture handling; call from TIM2_IRQHandler()
+ */
+void timeSync_irqHandler(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TIME_SYNC_H */
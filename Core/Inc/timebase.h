@@ -0,0 +1,141 @@
+/**
+ ******************************************************************************
+ * @file    timebase.h
+ * @brief   Monotonic 64-bit high-resolution timebase on TIM5
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * TIM5 (32-bit, APB1) free-runs at TIMEBASE_TICK_HZ and its update
+ * interrupt counts the wraps, so timebase_now() returns a 64-bit tick count
+ * that never goes backwards and does not wrap in practice. At 1 MHz the
+ * 32-bit counter wraps every 71.6 min, so the interrupt costs nothing
+ * measurable.
+ *
+ * timebase_now() is safe from any context, including interrupts that mask
+ * or out-rank the TIM5 interrupt. A wrap the interrupt has not counted yet
+ * is detected from the pending update flag.
+ *
+ * With TIMEBASE_HAL_TICK the HAL tick comes from here too
+ * (stm32f7xx_hal_timebase_tim.c): HAL_InitTick() starts TIM5 from HAL_Init()
+ * and re-derives its prescaler at every clock change, keeping the count, and
+ * HAL_GetTick() is computed from timebase_now(). SysTick stays off in the
+ * superloop build, so nothing interrupts once a millisecond: a sleeper with
+ * a deadline arms the TIM5 compare with timebase_wakeAt() instead.
+ *
+ * The ticks come from the same oscillator as the ADC pacing timer, so they
+ * show the frame timing exactly but not the oscillator's own error (HSI
+ * +-1 %). Cross-board alignment needs an external reference on top.
+ *
+ * Usage Example:
+ *   timebase_init();
+ *   uint64_t t0 = timebase_now();
+ *   do_work();
+ *   uint32_t us = (uint32_t)timebase_toMicros(timebase_now() - t0);
+ *
+ *   timebase_wakeAt(timebase_now() + 5000U); // WFI ends within 5 ms
+ *   __WFI();
+ *
+ ******************************************************************************
+ */
+
+#ifndef TIMEBASE_H
+#define TIMEBASE_H
+
+#include "irq_priority.h"
+#include "stm32f7xx_hal.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+
+/**
+ * @brief Tick rate; the TIM5 input clock must be a multiple of it
+ */
+#ifndef TIMEBASE_TICK_HZ
+#define TIMEBASE_TICK_HZ 1000000U
+#endif
+
+/**
+ * @brief Set to 0 to keep the 1 kHz SysTick HAL tick
+ */
+#ifndef TIMEBASE_HAL_TICK
+#define TIMEBASE_HAL_TICK 1
+#endif
+
+/**
+ * @brief TIM5 update (wrap) and compare interrupt priority
+ */
+#ifndef TIMEBASE_IRQ_PRIORITY
+#define TIMEBASE_IRQ_PRIORITY IRQ_PRIORITY_TIMER
+#endif
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief Start TIM5 free-running at TIMEBASE_TICK_HZ from zero, or, when it
+ *        already runs, re-derive the prescaler from the current clocks and
+ *        keep counting
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Running
+ *   @retval HAL_ERROR TIM5 clock is not a multiple of TIMEBASE_TICK_HZ, or
+ *                     the prescaler would exceed 16 bits
+ *
+ * @note Call after every clock change (HAL_InitTick() does with
+ *       TIMEBASE_HAL_TICK); until then the tick rate follows the old clock
+ */
+HAL_StatusTypeDef timebase_init(void);
+
+/**
+ * @brief Re-derive the prescaler of the running TIM5 for a new input clock,
+ *        keeping the count
+ *
+ * For code that changes the APB1 clock with interrupts masked and cannot
+ * wait for HAL_InitTick() (clock_gov.c's bus hook); safe to call masked.
+ *
+ * @param clk_hz TIM5 input clock, Hz (2x PCLK1 when APB1 is divided)
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Prescaler set (or already right)
+ *   @retval HAL_ERROR Clock is not a multiple of TIMEBASE_TICK_HZ, or the
+ *                     prescaler would exceed 16 bits; left as it was
+ */
+HAL_StatusTypeDef timebase_setClock(uint32_t clk_hz);
+
+/**
+ * @brief Current time in ticks since timebase_init()
+ */
+uint64_t timebase_now(void);
+
+/**
+ * @brief Convert ticks to microseconds
+ */
+uint64_t timebase_toMicros(uint64_t ticks);
+
+/**
+ * @brief Raise the TIM5 interrupt at a tick, to end a WFI
+ *
+ * Keeps the earlier of this and an alarm already armed, and fires once. A
+ * deadline more than 2^31 ticks away is brought in to 2^31, one already
+ * past is ignored.
+ *
+ * @param tick Absolute time, as timebase_now()
+ */
+void timebase_wakeAt(uint64_t tick);
+
+/**
+ * @brief Count a TIM5 wrap and clear a fired alarm; call from
+ *        TIM5_IRQHandler()
+ */
+void timebase_irqHandler(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TIMEBASE_H */
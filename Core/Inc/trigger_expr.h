@@ -0,0 +1,216 @@
+/**
+ ******************************************************************************
+ * @file    trigger_expr.h
+ * @brief   Trigger expressions over the block statistics, compiled on the
+ *          device into a postfix program
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * One threshold per channel cannot say "channel 0 is loud and channel 3
+ * rings". An expression combines comparisons of block statistics
+ * (ADC_ChannelStats_t of one DMA block) over any channels:
+ *
+ *   rms0>120 & (peak3>800 | kurt3>6) for 50
+ *
+ *   expr    := or [for <ms>]
+ *   or      := and {'|' and}            also "or"
+ *   and     := unary {'&' unary}        also "and"
+ *   unary   := '!' unary | '(' or ')' | compare     '!' also "not"
+ *   compare := <feature><channel> ('>' | '>=' | '<' | '<=') <number>
+ *
+ * Features, in ADC codes: mean, rms (AC), peak (largest deviation from the
+ * mean), pp (peak-to-peak), crest, skew, kurt (3 for Gaussian noise).
+ * Spaces are optional and keywords are case-insensitive. "for" holds the
+ * expression: it fires once it has been true for that long without a
+ * break, counted in whole blocks, and again only after it went false.
+ *
+ * triggerExpr_compile() checks the text and emits at most
+ * TRIGGER_EXPR_MAX_OPS operations. The truth values run on a 32-bit stack,
+ * one bit each, so an evaluation is at most TRIGGER_EXPR_MAX_OPS steps of
+ * a few instructions, whatever the expression: no recursion and no
+ * allocation at run time. adc_trigger.h evaluates it once per block, as
+ * the condition ADC_TRIGGER_EXPRESSION.
+ *
+ * Usage Example:
+ *   static TriggerExpr_t expr;
+ *   TriggerExpr_Error_t err;
+ *   if (triggerExpr_compile("rms0>120&(peak3>800|kurt3>6)for50", &expr,
+ *                           &err) == HAL_OK) {
+ *     triggerExpr_setRate(&expr, 4000U);
+ *     adcTrigger_setExpression(&expr);
+ *   } else {
+ *     // err.position, err.reason
+ *   }
+ *
+ * @note Compile and install with the engine disarmed; setRate from the
+ *       block context.
+ ******************************************************************************
+ */
+
+#ifndef TRIGGER_EXPR_H
+#define TRIGGER_EXPR_H
+
+#include "adc_conversions.h"
+#include "stm32f7xx_hal.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+
+/**
+ * @brief Longest program; also the most truth values on the stack
+ */
+#ifndef TRIGGER_EXPR_MAX_OPS
+#define TRIGGER_EXPR_MAX_OPS 32U
+#endif
+
+/**
+ * @brief Longest source text, terminator included (a config store value)
+ */
+#ifndef TRIGGER_EXPR_TEXT_MAX
+#define TRIGGER_EXPR_TEXT_MAX 96U
+#endif
+
+/**
+ * @brief Deepest nesting of parentheses and negations
+ */
+#ifndef TRIGGER_EXPR_MAX_NESTING
+#define TRIGGER_EXPR_MAX_NESTING 8U
+#endif
+
+_Static_assert(TRIGGER_EXPR_MAX_OPS <= 32U,
+               "the truth stack is one 32-bit word");
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief Block statistic a comparison reads
+ */
+typedef enum {
+  TRIGGER_EXPR_FEATURE_MEAN = 0, ///< Mean code
+  TRIGGER_EXPR_FEATURE_RMS,      ///< AC RMS
+  TRIGGER_EXPR_FEATURE_PEAK,     ///< Largest deviation from the mean
+  TRIGGER_EXPR_FEATURE_PP,       ///< Peak-to-peak
+  TRIGGER_EXPR_FEATURE_CREST,    ///< Crest factor
+  TRIGGER_EXPR_FEATURE_SKEW,     ///< Skewness
+  TRIGGER_EXPR_FEATURE_KURT,     ///< Kurtosis
+  TRIGGER_EXPR_FEATURE_COUNT
+} TriggerExpr_Feature_t;
+
+/**
+ * @brief Operation codes: comparisons push one truth value, the logic
+ *        operations combine the top ones
+ */
+typedef enum {
+  TRIGGER_EXPR_OP_GT = 0, ///< feature > threshold
+  TRIGGER_EXPR_OP_GE,     ///< feature >= threshold
+  TRIGGER_EXPR_OP_LT,     ///< feature < threshold
+  TRIGGER_EXPR_OP_LE,     ///< feature <= threshold
+  TRIGGER_EXPR_OP_AND,
+  TRIGGER_EXPR_OP_OR,
+  TRIGGER_EXPR_OP_NOT
+} TriggerExpr_OpCode_t;
+
+/**
+ * @brief One operation
+ */
+typedef struct {
+  uint8_t code;      ///< TriggerExpr_OpCode_t
+  uint8_t feature;   ///< TriggerExpr_Feature_t, comparisons
+  uint8_t channel;   ///< Comparisons
+  float threshold;   ///< Comparisons
+} TriggerExpr_Op_t;
+
+/**
+ * @brief Compiled expression and its hold state
+ */
+typedef struct {
+  TriggerExpr_Op_t ops[TRIGGER_EXPR_MAX_OPS];
+  uint8_t op_count;
+  ADC_ChannelMask_t channel_mask; ///< Channels the comparisons read
+  uint32_t hold_ms;               ///< "for", 0 = the first true block
+  uint32_t hold_frames;           ///< hold_ms at the frame rate
+  uint32_t true_frames;           ///< Frames true in a row
+  uint8_t latched;                ///< Fired; waits for a false block
+  uint32_t evaluations;           ///< Blocks evaluated
+  uint32_t fired;                 ///< Times it fired
+} TriggerExpr_t;
+
+/**
+ * @brief Where and why a text did not compile
+ */
+typedef struct {
+  uint16_t position;  ///< Offset of the offending character
+  const char *reason; ///< Short description, static
+} TriggerExpr_Error_t;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief Compile a text into a program; the hold state is cleared
+ *
+ * @param text Expression, zero-terminated
+ * @param expr Receives the program
+ * @param err  Receives the error position and reason (NULL ok)
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Compiled; set the rate before the first step
+ *   @retval HAL_ERROR NULL pointer, a syntax error, an unknown feature,
+ *                     a channel out of range, more than
+ *                     TRIGGER_EXPR_MAX_OPS operations or deeper nesting
+ *                     than TRIGGER_EXPR_MAX_NESTING
+ */
+HAL_StatusTypeDef triggerExpr_compile(const char *text, TriggerExpr_t *expr,
+                                      TriggerExpr_Error_t *err);
+
+/**
+ * @brief Convert the hold to frames at a frame rate
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer or zero rate
+ */
+HAL_StatusTypeDef triggerExpr_setRate(TriggerExpr_t *expr,
+                                      uint32_t frame_rate_hz);
+
+/**
+ * @brief Clear the hold state (re-arm)
+ */
+void triggerExpr_reset(TriggerExpr_t *expr);
+
+/**
+ * @brief Truth of the expression on one block's statistics
+ *
+ * @param expr  Program
+ * @param stats Statistics in channel order; only the channels in
+ *              channel_mask are read
+ *
+ * @return uint8_t 1 = true
+ */
+uint8_t triggerExpr_evaluate(const TriggerExpr_t *expr,
+                             const ADC_ChannelStats_t *stats);
+
+/**
+ * @brief Evaluate one block and advance the hold
+ *
+ * @param expr   Program
+ * @param stats  As triggerExpr_evaluate()
+ * @param frames Frames of the block
+ * @param offset Receives the frame of the block at which the hold was
+ *               reached, when it fires
+ *
+ * @return uint8_t 1 = fires on this block
+ */
+uint8_t triggerExpr_step(TriggerExpr_t *expr, const ADC_ChannelStats_t *stats,
+                         uint32_t frames, uint32_t *offset);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TRIGGER_EXPR_H */
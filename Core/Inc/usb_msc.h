@@ -0,0 +1,140 @@
+/**
+ ******************************************************************************
+ * @file    usb_msc.h
+ * @brief   USB mass storage mode: the SD recording as a read-only drive
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * Hours of recording do not come off a node over a UART. In this mode the
+ * USB user connector stops being the CDC port (usb_stream.h) and becomes
+ * a USB drive, Bulk-Only Transport with the SCSI commands Linux, macOS and
+ * Windows use. The drive is the FAT32 view of the raw region (fat_view.h):
+ * INDEX.BIN and the records as DATA_nnn.BIN, read-only, so the host copies
+ * files and no tool is needed. The drive reports itself write-protected
+ * and refuses writes.
+ *
+ * Reads run as a pipeline over two buffers of USB_MSC_BUFFER_SECTORS: the
+ * SDMMC DMA fills one with a multi-block read while the bulk IN endpoint
+ * sends the other, so the card (about 10 MB/s at 24 MHz, 4-bit) keeps the
+ * full-speed bus (1.2 MB/s at most, about 1 MB/s of sectors) busy. Every
+ * SCSI command runs in the main loop (usbMsc_poll()); the interrupt only
+ * hands over CBWs and transfer completions.
+ *
+ * The recorder must be stopped first (sdLogger_stop()): the drive shows
+ * the records written up to then, and recording cannot start again while
+ * the mode lasts. A host that ejects the drive ends the mode from its
+ * side (usbMsc_isEjected()); usbMsc_stop() brings the CDC port back.
+ *
+ * Usage Example:
+ *   sdLogger_stop(1000);
+ *   if (usbMsc_start() == HAL_OK) {   // re-enumerates as a drive
+ *     // main loop
+ *     usbMsc_poll();
+ *     if (usbMsc_isEjected()) {
+ *       usbMsc_stop();                // the CDC port again
+ *       sdLogger_start(rate);
+ *     }
+ *   }
+ *
+ * @note RAM: 2 x USB_MSC_BUFFER_SECTORS x 512 bytes, reserved only with
+ *       USB_MSC_ENABLE.
+ ******************************************************************************
+ */
+
+#ifndef USB_MSC_H
+#define USB_MSC_H
+
+#include "stm32f7xx_hal.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+
+/**
+ * @brief Set to 1 to build the mode in (needs the SD card socket)
+ */
+#ifndef USB_MSC_ENABLE
+#define USB_MSC_ENABLE 0
+#endif
+
+/**
+ * @brief Sectors per pipeline buffer (two of them): one multi-block read
+ */
+#ifndef USB_MSC_BUFFER_SECTORS
+#define USB_MSC_BUFFER_SECTORS 16U
+#endif
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief Drive statistics, since usbMsc_start()
+ */
+typedef struct {
+  uint8_t active;        ///< Mode on
+  uint8_t ejected;       ///< The host ejected the drive
+  uint32_t commands;     ///< SCSI commands run
+  uint32_t failed;       ///< ... that ended with a check condition
+  uint32_t sectors_sent; ///< Sectors sent to the host
+  uint32_t card_reads;   ///< Multi-block reads from the card
+  uint32_t read_errors;  ///< Card reads that failed
+  uint32_t resets;       ///< Bulk-Only resets and invalid CBWs
+  uint32_t volume_sectors; ///< Size of the drive
+  uint32_t file_sectors;   ///< Sectors of the data files
+} UsbMsc_Stats_t;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief Expose the recording as a drive
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Re-enumerated as a drive
+ *   @retval HAL_BUSY  Already on, or the recorder still running
+ *   @retval HAL_ERROR Built without USB_MSC_ENABLE, no card or no index, a
+ *                     region too small for FAT32, or USB not started
+ */
+HAL_StatusTypeDef usbMsc_start(void);
+
+/**
+ * @brief End the mode: the CDC port again and the card back to the
+ *        recorder
+ *
+ * @note Waits for a card read in flight; blocks for the re-attach
+ */
+void usbMsc_stop(void);
+
+/**
+ * @brief Run the command received, move the read pipeline on
+ * @note Main loop only, as often as it runs
+ */
+void usbMsc_poll(void);
+
+/**
+ * @brief Check whether the mode is on
+ */
+uint8_t usbMsc_isActive(void);
+
+/**
+ * @brief Check whether the host ejected the drive
+ */
+uint8_t usbMsc_isEjected(void);
+
+/**
+ * @brief Get the drive statistics
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer
+ */
+HAL_StatusTypeDef usbMsc_getStats(UsbMsc_Stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* USB_MSC_H */
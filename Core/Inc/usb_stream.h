@@ -0,0 +1,258 @@
+/**
+ ******************************************************************************
+ * @file    usb_stream.h
+ * @brief   USB OTG FS CDC-ACM streaming endpoint for the binary telemetry
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * A minimal CDC-ACM device (virtual COM port, no driver needed on Linux,
+ * macOS or Windows 10+) built directly on the HAL PCD driver: one bulk IN
+ * endpoint carries the packets, one bulk OUT endpoint takes host commands,
+ * and the notification endpoint stays silent. Bulk full-speed gives about
+ * 1 MB/s, against ~11 kB/s on USART3 at 115200 baud.
+ *
+ * Zero-copy transmit: the producer reserves space inside one of two
+ * endpoint buffers, encodes a packet straight into it and commits it. The
+ * buffer is then handed to the PCD as is, which feeds the TX FIFO from it
+ * (OTG FS has no DMA, so the D-cache is not involved). While one buffer is
+ * on the bus the other fills; when both are busy a reservation fails and
+ * the packet is counted as dropped.
+ *
+ * Packets go out only while a host holds the port open (DTR set), so
+ * nothing is queued before a terminal or decoder attaches.
+ *
+ * Other functions: usbStream_setFunction() detaches, swaps the CDC-ACM
+ * descriptors and class requests for another function's and attaches
+ * again, so the host enumerates a different device on the same two bulk
+ * endpoints (usb_msc.h: the SD card as a drive). The enumeration, EP0 and
+ * the PCD stay here; the function gets the class requests and the bulk
+ * completions from the interrupt and moves its data with
+ * usbStream_bulkTransmit() / usbStream_bulkReceive(). The CDC port is
+ * closed meanwhile.
+ *
+ * Clock: OTG FS needs 48 MHz +-0.25 % from PLLQ, which every clock profile
+ * provides (clock_profile.h). HSI is only +-1 %, so reliable enumeration
+ * needs CLOCK_PROFILE_HSE_BYPASS (8 MHz MCO from the ST-LINK on the
+ * Nucleo). Connect to the USB user connector (PA11/PA12).
+ *
+ * Concurrency model:
+ *   - One producer context (main loop): reserve / commit / poll / read.
+ *   - The OTG FS interrupt only answers control requests and marks the
+ *     in-flight buffer done; the main loop submits the next one, so a
+ *     buffer is never sent half-written.
+ *
+ * Usage Example:
+ *   usbStream_init();
+ *
+ *   uint16_t len;
+ *   uint8_t *p = usbStream_reserve(TELEMETRY_FRAME_ENCODED_MAX);
+ *   if (p != NULL &&
+ *       telemetryFrame_encodeSamples(&batch, p, TELEMETRY_FRAME_ENCODED_MAX,
+ *                                    &len) == HAL_OK) {
+ *     usbStream_commit(len);
+ *   }
+ *   usbStream_poll();
+ *
+ ******************************************************************************
+ */
+
+#ifndef USB_STREAM_H
+#define USB_STREAM_H
+
+#include "irq_priority.h"
+#include "stm32f7xx_hal.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+
+/**
+ * @brief Bytes per endpoint buffer (two of them)
+ */
+#ifndef USB_STREAM_BUFFER_SIZE
+#define USB_STREAM_BUFFER_SIZE 4096U
+#endif
+
+/**
+ * @brief OTG FS interrupt priority (below the ADC DMA and the UART queue)
+ */
+#ifndef USB_STREAM_IRQ_PRIORITY
+#define USB_STREAM_IRQ_PRIORITY IRQ_PRIORITY_USB
+#endif
+
+/**
+ * @brief Time detached when the function changes, so the host sees the
+ *        device leave
+ */
+#ifndef USB_STREAM_REATTACH_MS
+#define USB_STREAM_REATTACH_MS 50U
+#endif
+
+#define USB_STREAM_EP_IN 0x81U  ///< Bulk IN endpoint of every function
+#define USB_STREAM_EP_OUT 0x01U ///< Bulk OUT endpoint of every function
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief Streaming statistics
+ */
+typedef struct {
+  uint32_t bytes_sent;  ///< Payload bytes completed on the bulk IN endpoint
+  uint32_t transfers;   ///< Buffers completed
+  uint32_t dropped;     ///< Reservations refused (both buffers busy)
+  uint8_t configured;   ///< Enumerated and configured by a host
+  uint8_t open;         ///< Host holds the port open (DTR)
+} UsbStream_Stats_t;
+
+/**
+ * @brief A USB function in place of the CDC-ACM port
+ *
+ * The callbacks run in the OTG FS interrupt. The configuration descriptor
+ * has one interface with the bulk endpoints USB_STREAM_EP_IN and
+ * USB_STREAM_EP_OUT, 64 bytes each.
+ */
+typedef struct {
+  const uint8_t *device_desc; ///< 18 bytes; strings 1, 2 and 3 as CDC's
+  const uint8_t *config_desc; ///< wTotalLength bytes
+  const char *product;        ///< String 2
+  void (*configured)(uint8_t on); ///< Endpoints opened (1) or gone (0)
+  /**
+   * Class request to the interface. HAL_OK answers with *len bytes of
+   * *reply (0: status stage only); anything else stalls it
+   */
+  HAL_StatusTypeDef (*request)(const uint8_t *setup, const uint8_t **reply,
+                               uint16_t *len);
+  void (*data_in)(void);            ///< Bulk IN transfer completed
+  void (*data_out)(uint16_t len);   ///< Bulk OUT transfer completed
+  void (*halt_cleared)(uint8_t ep); ///< Host cleared an endpoint's stall
+} UsbStream_Function_t;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief Select the 48 MHz clock, start the OTG FS core and connect
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Device connected, enumeration runs from the interrupt
+ *   @retval HAL_ERROR No clock profile active (PLLQ not at 48 MHz) or PCD
+ *                     initialisation failed
+ */
+HAL_StatusTypeDef usbStream_init(void);
+
+/**
+ * @brief Check whether a host has the port open
+ *
+ * @return uint8_t 1 if packets are being sent
+ */
+uint8_t usbStream_isOpen(void);
+
+/**
+ * @brief Reserve space for one packet in the filling buffer
+ *
+ * @param max_len Largest size the packet can reach
+ *
+ * @return uint8_t* Write pointer, or NULL if the port is closed or both
+ *         buffers are busy (counted as dropped)
+ *
+ * @note Must be followed by usbStream_commit() before the next reserve
+ */
+uint8_t *usbStream_reserve(uint16_t max_len);
+
+/**
+ * @brief Commit the bytes written after usbStream_reserve()
+ *
+ * @param len Bytes written, at most the reserved max_len
+ */
+void usbStream_commit(uint16_t len);
+
+/**
+ * @brief Hand the filled buffer to the endpoint once the other is done
+ * @note Call from the main loop; usbStream_commit() also calls it
+ */
+void usbStream_poll(void);
+
+/**
+ * @brief Take bytes received from the host (bulk OUT)
+ *
+ * @param buf Destination
+ * @param cap Capacity of buf
+ *
+ * @return uint16_t Bytes copied, 0 if nothing arrived
+ */
+uint16_t usbStream_read(uint8_t *buf, uint16_t cap);
+
+/**
+ * @brief Get streaming statistics
+ *
+ * @param stats Destination
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer
+ */
+HAL_StatusTypeDef usbStream_getStats(UsbStream_Stats_t *stats);
+
+/**
+ * @brief Re-enumerate as another function, or as the CDC-ACM port again
+ *
+ * @param fn Function, kept (not copied); NULL = CDC-ACM
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Attached again, the host enumerates the new device
+ *   @retval HAL_ERROR usbStream_init() was not run
+ *
+ * @note Main loop only; blocks for USB_STREAM_REATTACH_MS
+ */
+HAL_StatusTypeDef usbStream_setFunction(const UsbStream_Function_t *fn);
+
+/**
+ * @brief Start a bulk IN transfer of a function
+ *
+ * @param buf Data, untouched until data_in(); at most 64 kB
+ * @param len Bytes (0: a zero-length packet)
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Started
+ *   @retval HAL_ERROR No function, or not configured
+ */
+HAL_StatusTypeDef usbStream_bulkTransmit(const uint8_t *buf, uint16_t len);
+
+/**
+ * @brief Start a bulk OUT transfer of a function
+ *
+ * @param buf Destination until data_out()
+ * @param len Largest transfer, a multiple of 64 bytes
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Armed
+ *   @retval HAL_ERROR No function, or not configured
+ */
+HAL_StatusTypeDef usbStream_bulkReceive(uint8_t *buf, uint16_t len);
+
+/**
+ * @brief Stall a bulk endpoint of a function until the host clears it
+ *
+ * @param ep USB_STREAM_EP_IN or USB_STREAM_EP_OUT
+ */
+void usbStream_bulkStall(uint8_t ep);
+
+/**
+ * @brief Abandon the bulk IN transfer of a function in flight
+ */
+void usbStream_bulkAbort(void);
+
+/**
+ * @brief OTG FS interrupt; call from OTG_FS_IRQHandler()
+ */
+void usbStream_irqHandler(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* USB_STREAM_H */
@@ -0,0 +1,196 @@
+/**
+ ******************************************************************************
+ * @file    wavelet_codec.h
+ * @brief   Error-bounded lossy codec for 12-bit sample runs (integer 5/3
+ *          lifting wavelet, dead-zone quantiser, run-length Rice codes)
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * sample_codec.h keeps every bit and so stops at 2-3x: the noise floor of
+ * the signal is coded too. For archives a bounded error is acceptable, and
+ * this codec trades it for far fewer bits. One channel, one run at a time:
+ *
+ *   1. Integer LeGall 5/3 lifting (the reversible JPEG 2000 wavelet), up
+ *      to WAVELET_CODEC_LEVELS levels, symmetric extension at both ends:
+ *        d[i] = x[2i+1] - ((x[2i] + x[2i+2]) >> 1)
+ *        s[i] = x[2i]   + ((d[i-1] + d[i] + 2) >> 2)
+ *      The coefficients end up as [a_L | d_L | d_L-1 | ... | d_1].
+ *   2. Quantisation with step 2^shift: the approximation a_L rounded, the
+ *      details through a dead zone, so every detail below the step is
+ *      thresholded to zero and the rest keep sign (|c| >> shift).
+ *   3. The residual layer: the run decoded from those codes is subtracted,
+ *      and what is left is rounded in steps of 2 max_error + 1. That makes
+ *      the bound exact, |decoded - sample| <= max_error for every sample,
+ *      whatever the wavelet layer lost. At max_error 0 it is lossless.
+ *   4. Every band, and the residual, coded on its own: densely (each value
+ *      zigzag Rice coded) or sparsely (the zero run before each nonzero
+ *      value, then the value), whichever is shorter.
+ *
+ * The shift trades the two layers: a coarse one leaves most details at
+ * zero and more in the residual. The encoder starts at the residual step
+ * and moves coarser (or else finer) while the run gets shorter, two to
+ * four trials. A run coded no shorter than 12-bit packing is stored
+ * verbatim, so the output never grows by more than one byte.
+ *
+ * Stream (bits MSB first, zero padded to a byte):
+ *
+ *   u8   levels << 4 | shift    0xFF: verbatim, count 12-bit samples
+ *   per band, a_L, d_L, ..., d_1, then the residual:
+ *     4    k                    15: all zero, nothing follows
+ *     1    sparse
+ *     ...  dense:  zigzag(v) Rice coded, per value
+ *          sparse: run, value, run, value, ... up to the band length
+ *
+ * A Rice code of u is u >> k ones, a zero, the k low bits;
+ * WAVELET_CODEC_ESCAPE ones instead escape to u in 18 bits. A run is
+ * Exp-Golomb order 0 (n zeros, then run + 1 in n + 1 bits), a sparse value
+ * v is coded as u = 2 (|v| - 1) + (v < 0). After the band's last nonzero
+ * value one more run reaches the end of the band, unless it already has.
+ * The approximation is coded as differences, from midscale on. The run
+ * length and max_error are not stored; the container carries them.
+ *
+ * Usage Example:
+ *   uint8_t out[WAVELET_CODEC_MAX_BYTES(128)];
+ *   uint32_t len;
+ *   // channel ch of a frame array, within 4 codes
+ *   waveletCodec_encode(&frames[0].samples[ch], 128, stride, 4, out,
+ *                       sizeof(out), &len);
+ *   waveletCodec_decode(out, len, 128, 4, decoded, 1);
+ *
+ * @note The encoder works in a static area (about 4 kB): one caller at a
+ *       time. The decoder takes 2 kB of stack.
+ ******************************************************************************
+ */
+
+#ifndef WAVELET_CODEC_H
+#define WAVELET_CODEC_H
+
+#include "stm32f7xx_hal.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+
+/**
+ * @brief Longest run per call
+ */
+#define WAVELET_CODEC_MAX_SAMPLES 256U
+
+/**
+ * @brief Decomposition levels, fewer when the run length is not a multiple
+ *        of 2^levels or the approximation would drop under two values
+ */
+#ifndef WAVELET_CODEC_LEVELS
+#define WAVELET_CODEC_LEVELS 5U
+#endif
+
+/**
+ * @brief Coarsest quantiser step, 2^shift
+ */
+#define WAVELET_CODEC_MAX_SHIFT 11U
+
+/**
+ * @brief Largest error bound accepted
+ */
+#define WAVELET_CODEC_MAX_ERROR 2047U
+
+/**
+ * @brief Unary length that switches a value to the 18-bit escape
+ */
+#define WAVELET_CODEC_ESCAPE 24U
+
+/**
+ * @brief Header byte marking a verbatim run
+ */
+#define WAVELET_CODEC_VERBATIM 0xFFU
+
+/**
+ * @brief Worst-case encoded size of a run of n samples
+ */
+#define WAVELET_CODEC_MAX_BYTES(n) (1U + ((n) * 12U + 7U) / 8U)
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief Running totals since the last reset
+ */
+typedef struct {
+  uint32_t runs;          ///< Runs encoded
+  uint32_t samples;       ///< Samples encoded
+  uint32_t bytes;         ///< Encoded bytes, header bytes included
+  uint32_t verbatim_runs; ///< Runs stored verbatim
+  uint32_t trials;        ///< Shifts coded, to pick the shortest
+  uint32_t zeroed;        ///< Detail coefficients thresholded to zero
+  uint32_t shift_runs[WAVELET_CODEC_MAX_SHIFT + 1U]; ///< Runs per shift
+} WaveletCodec_Stats_t;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief Compress one run of 12-bit samples within an error bound
+ *
+ * @param samples   First sample
+ * @param count     Samples in the run, 1..WAVELET_CODEC_MAX_SAMPLES
+ * @param stride    Distance between samples in uint16_t (1 = contiguous)
+ * @param max_error Largest |decoded - sample| allowed, in codes
+ *                  (0 = lossless, up to WAVELET_CODEC_MAX_ERROR)
+ * @param out       Destination
+ * @param cap       Size of out, WAVELET_CODEC_MAX_BYTES(count) always fits
+ * @param out_len   Encoded length in bytes
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer, bad count, stride or bound, buffer too
+ *                     small
+ *
+ * @note Samples above 4095 are clipped.
+ */
+HAL_StatusTypeDef waveletCodec_encode(const uint16_t *samples, uint32_t count,
+                                      uint32_t stride, uint16_t max_error,
+                                      uint8_t *out, uint32_t cap,
+                                      uint32_t *out_len);
+
+/**
+ * @brief Expand one run produced by waveletCodec_encode()
+ *
+ * @param in        Encoded run
+ * @param len       Bytes in the run
+ * @param count     Samples in the run
+ * @param max_error Bound it was encoded with
+ * @param samples   Destination
+ * @param stride    Distance between samples in uint16_t
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer, bad parameters or truncated run
+ */
+HAL_StatusTypeDef waveletCodec_decode(const uint8_t *in, uint32_t len,
+                                      uint32_t count, uint16_t max_error,
+                                      uint16_t *samples, uint32_t stride);
+
+/**
+ * @brief Get the running totals (compression ratio = samples * 1.5 / bytes)
+ *
+ * @param stats Destination
+ *
+ * @return HAL_StatusTypeDef
+ *   @retval HAL_OK    Success
+ *   @retval HAL_ERROR NULL pointer
+ */
+HAL_StatusTypeDef waveletCodec_getStats(WaveletCodec_Stats_t *stats);
+
+/**
+ * @brief Clear the running totals
+ */
+void waveletCodec_resetStats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* WAVELET_CODEC_H */
@@ -0,0 +1,373 @@
+/**
+ ******************************************************************************
+ * @file    acq_tune.c
+ * @brief   Implementation of the acquisition autotuner
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "acq_tune.h"
+#include "adc_conversions.h"
+#include "adc_ring.h"
+#include "clock_profile.h"
+#include "cpu_load.h"
+#include "dac_loopback.h"
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define ACQ_TUNE_FULL_CENTI_PCT 10000U
+
+#if ACQ_TUNE_ENABLE && !DAC_LOOPBACK_ENABLE
+#error "ACQ_TUNE_ENABLE needs DAC_LOOPBACK_ENABLE for the ENOB"
+#endif
+
+/* Private types -------------------------------------------------------------*/
+typedef enum {
+  TUNE_IDLE = 0,
+  TUNE_NEXT,   // pick the next candidate
+  TUNE_SETTLE, // started, pipeline filling
+  TUNE_LOAD,   // measuring the CPU load
+  TUNE_LOOP    // loopback running
+} AcqTune_Phase_t;
+
+/* Private variables ---------------------------------------------------------*/
+static const uint8_t tune_bits[ACQ_TUNE_BITS_COUNT] = {12U, 10U, 8U, 6U};
+static const uint8_t tune_accuracy[ACQ_TUNE_ACCURACY_COUNT] = {12U, 9U, 6U};
+static const DmaTuning_Config_t tune_dma[ACQ_TUNE_DMA_PRESETS] = {
+    {.fifo = 0U, .threshold = 2U, .burst = 4U},
+    {.fifo = 1U, .threshold = 2U, .burst = 4U},
+    {.fifo = 1U, .threshold = 4U, .burst = 8U}};
+
+static AcqTune_Config_t config;
+static AcqTune_Result_t results[ACQ_TUNE_CANDIDATES];
+static uint8_t judged_flag[ACQ_TUNE_CANDIDATES];
+static uint8_t order[ACQ_TUNE_CANDIDATES]; // fastest bound first
+static AcqTune_Phase_t phase = TUNE_IDLE;
+static uint32_t cursor = 0; // position in order[]
+static uint32_t judged = 0;
+static int32_t best = -1;
+static int32_t last = -1;
+static uint32_t phase_ms = 0;
+static uint32_t rescales = 0;
+static uint32_t errors_base = 0;
+
+/* The settings to go back to */
+static ADC_ChannelProfile_t saved_profile[ADC_CONVERSIONS_CHANNEL_COUNT];
+static DmaTuning_Config_t saved_dma;
+static uint32_t saved_rate = 0;
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+ * @brief Conversion errors and frames the ring dropped, since start
+ */
+static uint32_t acqTune_errors(void) {
+  ADC_RingStats_t ring;
+  uint32_t n = analogSensor_getErrorCount();
+  if (adcRing_getStats(&ring) == HAL_OK) {
+    n += ring.overflows;
+  }
+  return n;
+}
+
+/**
+ * @brief Largest multiple of the rate step not above hz (hz itself below
+ *        one step)
+ */
+static uint32_t acqTune_roundRate(uint32_t hz) {
+  return (hz >= ACQ_TUNE_RATE_STEP_HZ)
+             ? hz / ACQ_TUNE_RATE_STEP_HZ * ACQ_TUNE_RATE_STEP_HZ
+             : hz;
+}
+
+static uint16_t acqTune_budget(void) {
+  return (uint16_t)(ACQ_TUNE_FULL_CENTI_PCT - config.headroom_centi_pct);
+}
+
+static void acqTune_restore(void) {
+  if (config.configure(NULL, config.ctx) == HAL_OK) {
+    for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+      (void)analogSensor_setChannelProfile(ch, &saved_profile[ch]);
+    }
+    (void)dmaTuning_set(DMA_TUNING_ADC, &saved_dma);
+  }
+  (void)config.start(saved_rate, config.ctx);
+}
+
+/**
+ * @brief Run a candidate at a rate: restart and wait for it to settle
+ */
+static HAL_StatusTypeDef acqTune_run(uint32_t rate_hz) {
+  results[order[cursor]].rate_hz = rate_hz;
+  phase_ms = HAL_GetTick();
+  phase = TUNE_SETTLE;
+  return config.start(rate_hz, config.ctx);
+}
+
+/**
+ * @brief Close the current candidate with a verdict
+ */
+static AcqTune_Event_t acqTune_judge(AcqTune_Verdict_t verdict) {
+  const uint8_t i = order[cursor];
+  AcqTune_Result_t *r = &results[i];
+  r->verdict = verdict;
+  judged_flag[i] = 1;
+  judged++;
+  last = i;
+  if (verdict == ACQ_TUNE_PASS) {
+    const AcqTune_Result_t *b = (best >= 0) ? &results[best] : NULL;
+    if (b == NULL || r->rate_hz > b->rate_hz ||
+        (r->rate_hz == b->rate_hz && r->enob_centi > b->enob_centi)) {
+      best = i;
+    }
+  }
+  cursor++;
+  phase = TUNE_NEXT;
+  return ACQ_TUNE_EVENT_RESULT;
+}
+
+/**
+ * @brief Bound of every grid point, then order[] by bound, fastest first
+ *        (insertion sort, stable: the grid order breaks ties)
+ */
+static void acqTune_plan(void) {
+  const uint32_t prescaler = clockProfile_getActive()->adc_prescaler;
+  uint32_t n = 0;
+  for (uint8_t b = 0; b < ACQ_TUNE_BITS_COUNT; b++) {
+    for (uint8_t a = 0; a < ACQ_TUNE_ACCURACY_COUNT; a++) {
+      const AcqTune_Candidate_t cand = {.bits = tune_bits[b],
+                                        .accuracy_bits = tune_accuracy[a],
+                                        .dma = 0U};
+      uint32_t max_hz = 0;
+      if (config.configure(&cand, config.ctx) == HAL_OK) {
+        max_hz = analogSensor_getMaxFrameRate(prescaler);
+      }
+      for (uint8_t d = 0; d < ACQ_TUNE_DMA_PRESETS; d++, n++) {
+        results[n].cand = cand;
+        results[n].cand.dma = d;
+        results[n].max_hz = max_hz;
+      }
+    }
+  }
+  for (uint32_t i = 0; i < n; i++) {
+    uint32_t j = i;
+    for (; j > 0U && results[order[j - 1U]].max_hz < results[i].max_hz; j--) {
+      order[j] = order[j - 1U];
+    }
+    order[j] = (uint8_t)i;
+  }
+}
+
+static AcqTune_Event_t acqTune_next(void) {
+  if (cursor >= ACQ_TUNE_CANDIDATES) {
+    phase = TUNE_IDLE;
+    if (best < 0) {
+      acqTune_restore();
+    } else if (config.configure(&results[best].cand, config.ctx) != HAL_OK ||
+               config.start(results[best].rate_hz, config.ctx) != HAL_OK) {
+      best = -1; // it ran a moment ago; put the old settings back
+      acqTune_restore();
+    }
+    return ACQ_TUNE_EVENT_DONE;
+  }
+
+  AcqTune_Result_t *r = &results[order[cursor]];
+  uint32_t max_hz = r->max_hz;
+  if (config.limit_hz != 0U && max_hz > config.limit_hz) {
+    max_hz = config.limit_hz;
+  }
+  if (best >= 0 && acqTune_roundRate(max_hz) < results[best].rate_hz) {
+    return acqTune_judge(ACQ_TUNE_SKIPPED);
+  }
+  rescales = 0;
+  if (max_hz == 0U || config.configure(&r->cand, config.ctx) != HAL_OK ||
+      acqTune_run(acqTune_roundRate(max_hz)) != HAL_OK) {
+    return acqTune_judge(ACQ_TUNE_FAIL_START);
+  }
+  return ACQ_TUNE_EVENT_NONE;
+}
+
+static AcqTune_Event_t acqTune_checkLoad(void) {
+  AcqTune_Result_t *r = &results[order[cursor]];
+  CpuLoad_Stats_t load;
+  (void)cpuLoad_getStats(&load);
+  r->load_centi_pct = load.load_centi_pct;
+  r->peak_centi_pct = load.peak_centi_pct;
+  r->errors = acqTune_errors() - errors_base;
+  if (r->errors != 0U) {
+    return acqTune_judge(ACQ_TUNE_FAIL_ERRORS);
+  }
+
+  const uint16_t budget = acqTune_budget();
+  if (load.peak_centi_pct > budget) {
+    // Load grows about in proportion to the rate
+    const uint32_t hz = acqTune_roundRate(
+        (uint32_t)((uint64_t)r->rate_hz * budget / load.peak_centi_pct));
+    if (rescales >= ACQ_TUNE_RESCALES || hz == 0U || hz >= r->rate_hz ||
+        (best >= 0 && hz < results[best].rate_hz)) {
+      return acqTune_judge(ACQ_TUNE_FAIL_LOAD);
+    }
+    rescales++;
+    if (acqTune_run(hz) != HAL_OK) {
+      return acqTune_judge(ACQ_TUNE_FAIL_START);
+    }
+    return ACQ_TUNE_EVENT_NONE;
+  }
+
+  if (dacLoop_start() != HAL_OK) {
+    return acqTune_judge(ACQ_TUNE_FAIL_LOOPBACK);
+  }
+  phase_ms = HAL_GetTick();
+  phase = TUNE_LOOP;
+  return ACQ_TUNE_EVENT_NONE;
+}
+
+static AcqTune_Event_t acqTune_checkLoop(void) {
+  AcqTune_Result_t *r = &results[order[cursor]];
+  if (dacLoop_isRunning()) {
+    if (HAL_GetTick() - phase_ms < ACQ_TUNE_LOOP_TIMEOUT_MS) {
+      return ACQ_TUNE_EVENT_NONE;
+    }
+    dacLoop_stop();
+    return acqTune_judge(ACQ_TUNE_FAIL_LOOPBACK);
+  }
+
+  DacLoop_Result_t loop;
+  if (dacLoop_getResult(&loop) != HAL_OK || !loop.ok) {
+    return acqTune_judge(ACQ_TUNE_FAIL_LOOPBACK);
+  }
+  r->enob_centi = loop.enob_centi;
+  r->errors = acqTune_errors() - errors_base;
+  if (r->errors != 0U) {
+    return acqTune_judge(ACQ_TUNE_FAIL_ERRORS);
+  }
+  return acqTune_judge((loop.enob_centi >= config.target_enob_centi)
+                           ? ACQ_TUNE_PASS
+                           : ACQ_TUNE_FAIL_ENOB);
+}
+
+/* Public functions ----------------------------------------------------------*/
+
+HAL_StatusTypeDef acqTune_start(const AcqTune_Config_t *cfg) {
+#if !ACQ_TUNE_ENABLE
+  return HAL_ERROR; // no loopback to judge the ENOB by
+#endif
+  if (cfg == NULL || cfg->configure == NULL || cfg->start == NULL ||
+      cfg->headroom_centi_pct >= ACQ_TUNE_FULL_CENTI_PCT) {
+    return HAL_ERROR;
+  }
+  if (phase != TUNE_IDLE || dacLoop_isRunning()) {
+    return HAL_BUSY;
+  }
+  config = *cfg;
+
+  for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+    (void)analogSensor_getChannelProfile(ch, &saved_profile[ch]);
+  }
+  (void)dmaTuning_get(DMA_TUNING_ADC, &saved_dma);
+  saved_rate = analogSensor_getSampleRate();
+
+  memset(results, 0, sizeof(results));
+  memset(judged_flag, 0, sizeof(judged_flag));
+  acqTune_plan();
+  cursor = 0;
+  judged = 0;
+  best = -1;
+  last = -1;
+  phase = TUNE_NEXT;
+  return HAL_OK;
+}
+
+void acqTune_stop(void) {
+  if (phase == TUNE_IDLE) {
+    return;
+  }
+  if (phase == TUNE_LOOP) {
+    dacLoop_stop();
+  }
+  phase = TUNE_IDLE;
+  best = -1;
+  acqTune_restore();
+}
+
+AcqTune_Event_t acqTune_poll(void) {
+  const uint32_t now = HAL_GetTick();
+  switch (phase) {
+  case TUNE_NEXT:
+    return acqTune_next();
+  case TUNE_SETTLE:
+    if (now - phase_ms >= ACQ_TUNE_SETTLE_MS) {
+      cpuLoad_resetPeak();
+      errors_base = acqTune_errors();
+      phase_ms = now;
+      phase = TUNE_LOAD;
+    }
+    return ACQ_TUNE_EVENT_NONE;
+  case TUNE_LOAD:
+    return (now - phase_ms >= ACQ_TUNE_LOAD_MS) ? acqTune_checkLoad()
+                                                : ACQ_TUNE_EVENT_NONE;
+  case TUNE_LOOP:
+    return acqTune_checkLoop();
+  default:
+    return ACQ_TUNE_EVENT_NONE;
+  }
+}
+
+uint8_t acqTune_isRunning(void) { return (phase != TUNE_IDLE) ? 1U : 0U; }
+
+HAL_StatusTypeDef acqTune_getStatus(AcqTune_Status_t *status) {
+  if (status == NULL) {
+    return HAL_ERROR;
+  }
+  status->running = acqTune_isRunning();
+  status->candidates = ACQ_TUNE_CANDIDATES;
+  status->judged = judged;
+  status->best = best;
+  status->last = last;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef acqTune_getResult(uint32_t index, AcqTune_Result_t *result) {
+  if (index >= ACQ_TUNE_CANDIDATES || result == NULL) {
+    return HAL_ERROR;
+  }
+  if (!judged_flag[index]) {
+    return HAL_BUSY;
+  }
+  *result = results[index];
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef acqTune_applyAnalog(const AcqTune_Candidate_t *cand) {
+  if (cand == NULL || cand->accuracy_bits < 6U || cand->accuracy_bits > 12U ||
+      cand->dma >= ACQ_TUNE_DMA_PRESETS) {
+    return HAL_ERROR;
+  }
+  for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+    ADC_ChannelProfile_t profile;
+    if (analogSensor_getChannelProfile(ch, &profile) != HAL_OK) {
+      return HAL_ERROR;
+    }
+    profile.accuracy_bits = cand->accuracy_bits;
+    const HAL_StatusTypeDef status =
+        analogSensor_setChannelProfile(ch, &profile);
+    if (status != HAL_OK) {
+      return status;
+    }
+  }
+  return dmaTuning_set(DMA_TUNING_ADC, &tune_dma[cand->dma]);
+}
+
+const DmaTuning_Config_t *acqTune_getDmaPreset(uint8_t preset) {
+  return (preset < ACQ_TUNE_DMA_PRESETS) ? &tune_dma[preset] : NULL;
+}
+
+const char *acqTune_verdictName(AcqTune_Verdict_t verdict) {
+  static const char *const names[] = {"pass",    "skipped", "start",
+                                      "errors",  "load",    "loopback",
+                                      "enob"};
+  return ((uint32_t)verdict < sizeof(names) / sizeof(names[0]))
+             ? names[verdict]
+             : "?";
+}
@@ -0,0 +1,247 @@
+/**
+ ******************************************************************************
+ * @file    adaptive_rate.c
+ * @brief   Implementation of the activity-driven frame rate controller
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "adaptive_rate.h"
+#include "adc_sections.h"
+#include "dsp_stats.h"
+#include "time_sync.h"
+#include <math.h>
+
+/* Exported variables --------------------------------------------------------*/
+
+const AdaptiveRate_Level_t adaptiveRate_defaultLevels[3] = {
+    {4000U, 8U}, {1000U, 4U}, {250U, 2U}};
+
+/* Private variables ---------------------------------------------------------*/
+static AdaptiveRate_Config_t config;
+static uint8_t slot_channel[ADC_CONVERSIONS_CHANNEL_COUNT];
+static uint8_t ready = 0;
+static AdaptiveRate_Status_t status;
+static uint32_t quiet_since_ms = 0;
+static uint8_t quiet = 0;
+static volatile uint8_t staged_level = 0; // level waiting for its block
+
+/* Poll window, written by the ISR and the stages feeding it */
+static volatile float peak_variance = 0.0f; // codes^2, raw statistics
+static volatile float peak_external = 0.0f; // codes, noteActivity()
+static volatile uint32_t window_blocks = 0;
+static volatile uint8_t wake_pending = 0;
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+ * @brief Sync discipline and the stages of a level
+ */
+ADC_FAST_CODE static void adaptiveRate_retune(const AdaptiveRate_Level_t *lv) {
+  // HAL_ERROR when the discipline is off: the driver's ARR then stands
+  (void)timeSync_setFrameRate(lv->frame_rate_hz);
+  if (config.apply != NULL) {
+    config.apply(lv, config.ctx);
+  }
+}
+
+/**
+ * @brief The staged rate reached its block (DMA ISR)
+ */
+ADC_FAST_CODE static void adaptiveRate_onApplied(uint32_t first_frame,
+                                                 void *ctx) {
+  (void)first_frame;
+  (void)ctx;
+  adaptiveRate_retune(&config.levels[staged_level]);
+}
+
+/**
+ * @brief Move to a level: TIM2 period, sync discipline and the callback
+ *        with no block in between
+ *
+ * With the timer-paced scan running the rate is staged and swapped in at
+ * the next block boundary, the stages retuned right after the last block
+ * at the old rate. Otherwise everything changes at once.
+ */
+static HAL_StatusTypeDef adaptiveRate_apply(uint8_t level) {
+  const AdaptiveRate_Level_t *lv = &config.levels[level];
+  HAL_StatusTypeDef rc;
+
+  if (analogSensor_getMode() == ADC_ACQ_MODE_DMA_TIMER) {
+    const ADC_ScanConfig_t cfg = {.fields = ADC_SCAN_CONFIG_RATE,
+                                  .frame_rate_hz = lv->frame_rate_hz,
+                                  .applied = adaptiveRate_onApplied};
+    staged_level = level;
+    rc = analogSensor_stageConfig(&cfg, &status.first_frame);
+  } else {
+    ADC_BlockInfo_t block;
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    rc = analogSensor_setSampleRate(lv->frame_rate_hz);
+    if (rc == HAL_OK) {
+      adaptiveRate_retune(lv);
+      status.first_frame = (analogSensor_getBlockInfo(&block) == HAL_OK)
+                               ? block.first_frame + block.frame_count
+                               : 0U;
+    }
+    __set_PRIMASK(primask);
+  }
+  if (rc != HAL_OK) {
+    return HAL_ERROR;
+  }
+
+  status.level = level;
+  status.frame_rate_hz = lv->frame_rate_hz;
+  status.decimation = lv->decimation;
+  status.changed_ms = HAL_GetTick();
+  return HAL_OK;
+}
+
+/* Public functions ----------------------------------------------------------*/
+
+HAL_StatusTypeDef adaptiveRate_init(const AdaptiveRate_Config_t *cfg,
+                                    const uint8_t *channel_map) {
+  if (cfg == NULL || cfg->channel_mask == 0U ||
+      cfg->step_down_codes > cfg->step_up_codes) {
+    return HAL_ERROR;
+  }
+  AdaptiveRate_Config_t c = *cfg;
+  if (c.levels == NULL) {
+    c.levels = adaptiveRate_defaultLevels;
+    c.level_count = (uint8_t)(sizeof(adaptiveRate_defaultLevels) /
+                              sizeof(adaptiveRate_defaultLevels[0]));
+  }
+  if (c.level_count == 0U || c.level_count > ADAPTIVE_RATE_MAX_LEVELS) {
+    return HAL_ERROR;
+  }
+  for (uint8_t l = 0; l < c.level_count; l++) {
+    if (c.levels[l].frame_rate_hz == 0U || c.levels[l].decimation == 0U) {
+      return HAL_ERROR;
+    }
+  }
+
+  ready = 0;
+  config = c;
+  for (uint8_t s = 0; s < ADC_CONVERSIONS_CHANNEL_COUNT; s++) {
+    slot_channel[s] = (channel_map != NULL) ? channel_map[s] : s;
+  }
+  status = (AdaptiveRate_Status_t){
+      .frame_rate_hz = c.levels[0].frame_rate_hz,
+      .decimation = c.levels[0].decimation,
+      .changed_ms = HAL_GetTick()};
+  quiet = 0;
+  peak_variance = 0.0f;
+  peak_external = 0.0f;
+  window_blocks = 0;
+  wake_pending = 0;
+  ready = 1;
+  return HAL_OK;
+}
+
+ADC_FAST_CODE void adaptiveRate_processBlock(const uint16_t *block,
+                                             uint32_t frames) {
+  if (!ready || block == NULL || frames == 0U) {
+    return;
+  }
+  DSP_StatsAccum_t acc[ADC_CONVERSIONS_CHANNEL_COUNT];
+  dspStats_reset(acc);
+  dspStats_accumulate(acc, block, frames);
+
+  // n^2 variance in integers (n * sum_sq < 2^41 for a block), one divide
+  float peak = peak_variance;
+  for (uint8_t s = 0; s < ADC_CONVERSIONS_CHANNEL_COUNT; s++) {
+    if ((config.channel_mask & (1UL << slot_channel[s])) == 0U) {
+      continue;
+    }
+    uint64_t n = acc[s].count;
+    uint64_t spread = n * acc[s].sum_sq - acc[s].sum * acc[s].sum;
+    float variance = (float)spread / (float)(n * n);
+    if (variance > peak) {
+      peak = variance;
+    }
+  }
+  peak_variance = peak;
+  window_blocks++;
+}
+
+void adaptiveRate_noteActivity(float rms_codes) {
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  if (rms_codes > peak_external) {
+    peak_external = rms_codes;
+  }
+  __set_PRIMASK(primask);
+}
+
+void adaptiveRate_wake(void) { wake_pending = 1; }
+
+HAL_StatusTypeDef adaptiveRate_poll(AdaptiveRate_Status_t *out) {
+  if (!ready) {
+    return HAL_ERROR;
+  }
+
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  const uint8_t wake = wake_pending;
+  if (window_blocks == 0U && !wake) {
+    // No block since the last poll: no measurement, not quiet either
+    __set_PRIMASK(primask);
+    return HAL_BUSY;
+  }
+  float variance = peak_variance;
+  float external = peak_external;
+  window_blocks = 0;
+  peak_variance = 0.0f;
+  peak_external = 0.0f;
+  wake_pending = 0;
+  __set_PRIMASK(primask);
+
+  float activity = sqrtf(variance);
+  if (external > activity) {
+    activity = external;
+  }
+  status.activity = activity;
+
+  const uint32_t now = HAL_GetTick();
+  uint8_t target = status.level;
+  if (wake || activity >= config.step_up_codes) {
+    target = 0;
+    quiet = 0;
+  } else if (activity < config.step_down_codes) {
+    if (!quiet) {
+      quiet = 1;
+      quiet_since_ms = now;
+    } else if (now - quiet_since_ms >= config.quiet_ms &&
+               status.level + 1U < config.level_count) {
+      target = status.level + 1U;
+      quiet_since_ms = now; // dwell again before the next step
+    }
+  } else {
+    quiet = 0;
+  }
+
+  if (target == status.level) {
+    return HAL_BUSY;
+  }
+  if (adaptiveRate_apply(target) != HAL_OK) {
+    return HAL_ERROR;
+  }
+  if (target == 0U) {
+    status.steps_up++;
+  } else {
+    status.steps_down++;
+  }
+  if (out != NULL) {
+    *out = status;
+  }
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef adaptiveRate_getStatus(AdaptiveRate_Status_t *out) {
+  if (out == NULL) {
+    return HAL_ERROR;
+  }
+  *out = status;
+  return HAL_OK;
+}
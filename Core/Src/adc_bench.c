@@ -0,0 +1,1442 @@
+/**
+ ******************************************************************************
+ * @file    adc_bench.c
+ * @brief   On-target benchmark scenarios of the acquisition and DSP chain
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "adc_bench.h"
+#include "adc.h"
+#include "adc_calibration.h"
+#include "adc_conversions.h"
+#include "adc_linearity.h"
+#include "adc_ring.h"
+#include "adc_sections.h"
+#include "clock_profile.h"
+#include "dac_loopback.h"
+#include "dma_tuning.h"
+#include "dsp_deinterleave.h"
+#include "dsp_filter.h"
+#include "dsp_fused.h"
+#include "dsp_multirate.h"
+#include "dsp_oversample.h"
+#include "dsp_quality.h"
+#include "dsp_spectrum.h"
+#include "dsp_stats.h"
+#include "dwt_profiler.h"
+#include "flash_mode.h"
+#include "irq_priority.h"
+#include "sample_codec.h"
+#include "telemetry.h"
+#include "telemetry_frame.h"
+#include "timebase.h"
+#include "usart.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define ADC_BENCH_BLOCKS 8U       // converted blocks the DSP scenarios replay
+#define ADC_BENCH_DSP_PASSES 4U   // passes over them per DSP scenario
+#define ADC_BENCH_DECIMATION 8U   // as the application's stream filter
+#define ADC_BENCH_TILT_RATIO 256U // ... and its tilt oversampling
+#define ADC_BENCH_TILT_BITS 16U
+#define ADC_BENCH_FFT_LENGTH 1024U
+#define ADC_BENCH_FFT_AVERAGES 4U
+#define ADC_BENCH_CODEC_FRAMES TELEMETRY_FRAME_CODEC_FRAMES
+#define ADC_BENCH_COLLECT_TIMEOUT_MS 1000U
+#define ADC_BENCH_TX_TIMEOUT_MS 200U
+#define ADC_BENCH_DMA2D_TIMEOUT_MS 10U
+#define ADC_BENCH_LOOP_CHANNEL ADC_CH_SENSOR2_Y // on PA4, DAC_OUT1
+#define ADC_BENCH_LOOP_BITS {6U, 9U, 12U}    // settling accuracies swept
+#define ADC_BENCH_BUS_WORDS 2048U // memory-to-memory load per transfer
+#define ADC_BENCH_BUS_STEPS 8U    // scan rates tried, in 1/8 of the ADC bound
+#define ADC_BENCH_FILL_BYTES 64U  // UART load line
+#define ADC_BENCH_PROBE_WORDS 1024U // CPU read per pass, the D-cache size
+#define ADC_BENCH_PROBE_PASSES 1024U
+#define ADC_BENCH_IRQ_PASSES 256U
+
+/* Private types -------------------------------------------------------------*/
+typedef HAL_StatusTypeDef (*ADC_BenchScenario_t)(ADC_BenchResult_t *result);
+
+typedef struct {
+  const char *name;
+  ADC_BenchScenario_t run;
+} ADC_BenchEntry_t;
+
+typedef struct {
+  const char *name;
+  DmaTuning_Config_t cfg;
+} ADC_BenchDmaPreset_t;
+
+typedef struct {
+  const char *name;
+  const uint32_t *src;
+  uint32_t *dst;
+  uint8_t dma; ///< 1 = DMA2 reaches the source (not the ITCM flash alias)
+} ADC_BenchRegion_t;
+
+/* Private variables ---------------------------------------------------------*/
+static uint16_t bench_blocks[ADC_BENCH_BLOCKS][ADC_CONVERSIONS_BLOCK_SAMPLES]
+    ADC_DMA_ALIGNED;
+static volatile uint32_t bench_collected = 0;
+static ADC_Frame_t bench_frames[ADC_BENCH_CODEC_FRAMES];
+
+// Stage state lives here, not on the stack, so ram= is the real footprint
+static DSP_Filter_t bench_filter;
+static DSP_Oversampler_t bench_oversampler;
+static DSP_Spectrum_t bench_spectrum;
+static TelemetryFrame_Batch_t bench_batch;
+static DSP_StatsAccum_t bench_stats[ADC_CONVERSIONS_CHANNEL_COUNT];
+static int16_t bench_mg[ADC_CONVERSIONS_BLOCK_SAMPLES];
+static DSP_Fused_t bench_fused ADC_FAST_BSS;
+static float32_t bench_fused_out[ADC_CONVERSIONS_BLOCK_SAMPLES /
+                                 ADC_BENCH_DECIMATION];
+static uint16_t bench_planes[ADC_CONVERSIONS_CHANNEL_COUNT]
+                            [ADC_CONVERSIONS_BLOCK_FRAMES] ADC_DMA_ALIGNED;
+static volatile uint8_t bench_planes_done = 0;
+static DSP_Multirate_t bench_multirate;
+
+// Bus load standing in for the SDMMC and Ethernet traffic: DMA2 stream 1
+static uint32_t bench_bus_src[ADC_BENCH_BUS_WORDS] ADC_DMA_ALIGNED;
+static uint32_t bench_bus_dst[ADC_BENCH_BUS_WORDS] ADC_DMA_ALIGNED;
+static DMA_HandleTypeDef bench_bus_dma;
+static char bench_fill[ADC_BENCH_FILL_BYTES];
+
+// CPU working data in each bank, read while the DMA streams run
+static uint32_t bench_probe_dtcm[ADC_BENCH_PROBE_WORDS] ADC_FAST_BSS;
+static uint32_t bench_probe_sram1[ADC_BENCH_PROBE_WORDS] ADC_DMA_ALIGNED;
+static uint32_t bench_probe_sram2[ADC_BENCH_PROBE_WORDS] ADC_SRAM2_BSS
+    ADC_DMA_ALIGNED;
+static volatile uint32_t bench_probe_sink = 0;
+
+// Copy targets of the bandwidth scenarios, beside the probe buffers
+static uint32_t bench_copy_dtcm[ADC_BENCH_PROBE_WORDS] ADC_FAST_BSS;
+static uint32_t bench_copy_sram1[ADC_BENCH_PROBE_WORDS] ADC_DMA_ALIGNED;
+static uint32_t bench_copy_sram2[ADC_BENCH_PROBE_WORDS] ADC_SRAM2_BSS
+    ADC_DMA_ALIGNED;
+
+/* Interrupt entry scenario: the handler's stamps */
+static volatile uint32_t bench_irq_stamp = 0;
+static volatile uint32_t bench_irq_fp_cycles = 0;
+static volatile uint8_t bench_irq_use_fp = 0;
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+ * @brief Fill max_rate_hz and load_centi_pct from cycles_per_frame
+ *
+ * @param result   Result with cycles_per_frame set
+ * @param adc_max  ADC bound of the scenario, 0 = CPU bound only
+ */
+static void adcBench_finish(ADC_BenchResult_t *result, uint32_t adc_max) {
+  uint32_t hclk = HAL_RCC_GetHCLKFreq();
+  uint32_t cycles = (result->cycles_per_frame != 0U) ? result->cycles_per_frame
+                                                     : 1U;
+  uint32_t cpu_max = hclk / cycles;
+
+  result->max_rate_hz = (adc_max != 0U && adc_max < cpu_max) ? adc_max
+                                                             : cpu_max;
+  result->load_centi_pct =
+      (uint32_t)(((uint64_t)cycles * ADC_BENCH_FRAME_RATE_HZ * 10000U) / hclk);
+}
+
+/**
+ * @brief Mean of a probe, 0 when it never ran
+ */
+static uint32_t adcBench_probeMean(Profiler_Probe_t probe) {
+  Profiler_Stats_t stats;
+  if (profiler_getStats(probe, &stats) != HAL_OK || stats.count == 0U) {
+    return 0;
+  }
+  return (uint32_t)(stats.total / stats.count);
+}
+
+/**
+ * @brief Queue one report line, waiting for a free TX slot
+ */
+static void adcBench_send(const char *line) {
+  uint32_t start = HAL_GetTick();
+  while (telemetry_getFreeSlots() == 0U &&
+         HAL_GetTick() - start < ADC_BENCH_TX_TIMEOUT_MS) {
+  }
+  telemetry_send((const uint8_t *)line, (uint16_t)strlen(line));
+}
+
+static void adcBench_collectCallback(const uint16_t *block,
+                                     uint32_t frame_count, void *ctx) {
+  UNUSED(ctx);
+  UNUSED(frame_count);
+  if (bench_collected < ADC_BENCH_BLOCKS) {
+    memcpy(bench_blocks[bench_collected], block,
+           sizeof(bench_blocks[bench_collected]));
+    bench_collected++;
+  }
+}
+
+/**
+ * @brief Convert the input blocks of the DSP scenarios (independent scan)
+ */
+static HAL_StatusTypeDef adcBench_collect(void) {
+  bench_collected = 0;
+  analogSensor_registerBlockCallback(adcBench_collectCallback, NULL);
+  if (analogSensor_startTimedDMA(ADC_BENCH_FRAME_RATE_HZ) != HAL_OK) {
+    analogSensor_registerBlockCallback(NULL, NULL);
+    return HAL_ERROR;
+  }
+  uint32_t start = HAL_GetTick();
+  while (bench_collected < ADC_BENCH_BLOCKS &&
+         HAL_GetTick() - start < ADC_BENCH_COLLECT_TIMEOUT_MS) {
+  }
+  analogSensor_stopDMA();
+  analogSensor_registerBlockCallback(NULL, NULL);
+  return (bench_collected == ADC_BENCH_BLOCKS) ? HAL_OK : HAL_ERROR;
+}
+
+/**
+ * @brief Timed DMA scan: cost of the block hand-off ISR per frame
+ */
+static HAL_StatusTypeDef adcBench_dma(ADC_Multimode_t mode,
+                                      ADC_BenchResult_t *result) {
+  if (analogSensor_setMultimode(mode) != HAL_OK) {
+    return HAL_ERROR;
+  }
+  uint32_t adc_max =
+      analogSensor_getMaxFrameRate(clockProfile_getActive()->adc_prescaler);
+
+  profiler_reset();
+  if (analogSensor_startTimedDMA(ADC_BENCH_FRAME_RATE_HZ) != HAL_OK) {
+    analogSensor_setMultimode(ADC_MULTI_INDEPENDENT);
+    return HAL_ERROR;
+  }
+  HAL_Delay(ADC_BENCH_DMA_RUN_MS);
+  analogSensor_stopDMA();
+  analogSensor_setMultimode(ADC_MULTI_INDEPENDENT);
+
+  uint32_t per_block = adcBench_probeMean(PROFILER_PROBE_DMA_CALLBACK);
+  if (per_block == 0U) {
+    return HAL_ERROR;
+  }
+  result->cycles_per_frame = per_block / ADC_CONVERSIONS_BLOCK_FRAMES;
+  result->ram_bytes = 2U * ADC_CONVERSIONS_BLOCK_SAMPLES * sizeof(uint16_t) +
+                      ADC_RING_CAPACITY * sizeof(ADC_RingEntry_t);
+  adcBench_finish(result, adc_max);
+  return HAL_OK;
+}
+
+/* Scenarios -----------------------------------------------------------------*/
+
+/**
+ * @brief Blocking full frame through one polling backend
+ */
+static HAL_StatusTypeDef adcBench_poll(Profiler_Probe_t probe,
+                                       ADC_BenchResult_t *result) {
+  profiler_reset();
+  if (analogSensor_benchmarkBackends(ADC_BENCH_POLL_ROUNDS) != HAL_OK) {
+    return HAL_ERROR;
+  }
+  result->cycles_per_frame =
+      adcBench_probeMean(probe) * ADC_CONVERSIONS_CHANNEL_COUNT;
+  result->ram_bytes = sizeof(ADC_Frame_t);
+  // The conversion time is inside the measurement: CPU bound is the bound
+  adcBench_finish(result, 0);
+  return HAL_OK;
+}
+
+static HAL_StatusTypeDef adcBench_pollHAL(ADC_BenchResult_t *result) {
+  return adcBench_poll(PROFILER_PROBE_READ_HAL, result);
+}
+
+static HAL_StatusTypeDef adcBench_pollLL(ADC_BenchResult_t *result) {
+  return adcBench_poll(PROFILER_PROBE_READ_LL, result);
+}
+
+static HAL_StatusTypeDef adcBench_dmaScan(ADC_BenchResult_t *result) {
+  return adcBench_dma(ADC_MULTI_INDEPENDENT, result);
+}
+
+static HAL_StatusTypeDef adcBench_multiADC(ADC_BenchResult_t *result) {
+  return adcBench_dma(ADC_MULTI_TRIPLE_SIMULT, result);
+}
+
+/**
+ * @brief Block stages of the application: anti-alias filter + decimation
+ *        on every channel, 256x oversampling on X/Y/Z
+ */
+static HAL_StatusTypeDef adcBench_filterChain(ADC_BenchResult_t *result) {
+  const float32_t *out;
+  uint32_t frames;
+  uint64_t cycles = 0;
+
+  if (dspFilter_init(&bench_filter, ADC_BENCH_DECIMATION, NULL) != HAL_OK ||
+      dspOversample_init(&bench_oversampler, NULL) != HAL_OK) {
+    return HAL_ERROR;
+  }
+  for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+    dspFilter_configChannel(&bench_filter, ch, &dspFilter_lowpass200Hz);
+  }
+  for (uint8_t ch = 0; ch < 3U; ch++) {
+    dspOversample_configChannel(&bench_oversampler, ch, ADC_BENCH_TILT_RATIO,
+                                ADC_BENCH_TILT_BITS);
+  }
+
+  for (uint32_t pass = 0; pass < ADC_BENCH_DSP_PASSES; pass++) {
+    for (uint32_t b = 0; b < ADC_BENCH_BLOCKS; b++) {
+      uint32_t t0 = profiler_now();
+      dspOversample_process(&bench_oversampler, bench_blocks[b],
+                            ADC_CONVERSIONS_BLOCK_FRAMES);
+      dspFilter_process(&bench_filter, bench_blocks[b],
+                        ADC_CONVERSIONS_BLOCK_FRAMES);
+      cycles += profiler_now() - t0;
+      dspFilter_getOutput(&bench_filter, &out, &frames, NULL);
+    }
+  }
+  result->cycles_per_frame =
+      (uint32_t)(cycles / (ADC_BENCH_DSP_PASSES * ADC_BENCH_BLOCKS *
+                           ADC_CONVERSIONS_BLOCK_FRAMES));
+  result->ram_bytes = sizeof(bench_filter) + sizeof(bench_oversampler);
+  adcBench_finish(result, 0);
+  return HAL_OK;
+}
+
+/**
+ * @brief One channel's Welch spectrum (1024 points, 4 averages, Hann):
+ *        strided collection in the ISR plus the FFTs of the main loop
+ */
+static HAL_StatusTypeDef adcBench_fft(ADC_BenchResult_t *result) {
+  const DSP_SpectrumConfig_t cfg = {
+      .length = ADC_BENCH_FFT_LENGTH,
+      .window = DSP_WINDOW_HANN,
+      .averages = ADC_BENCH_FFT_AVERAGES,
+      .sample_rate_hz = (float32_t)ADC_BENCH_FRAME_RATE_HZ,
+      .min_peak_hz = 5.0f,
+      .band_count = 1,
+      .bands = {{10.0f, 1000.0f}}};
+  DSP_SpectrumResult_t res;
+  uint64_t cycles = 0;
+
+  if (dspSpectrum_init(&bench_spectrum, 0, NULL, &cfg) != HAL_OK) {
+    return HAL_ERROR;
+  }
+  for (uint32_t pass = 0; pass < ADC_BENCH_DSP_PASSES; pass++) {
+    for (uint32_t b = 0; b < ADC_BENCH_BLOCKS; b++) {
+      uint32_t t0 = profiler_now();
+      dspSpectrum_process(&bench_spectrum, bench_blocks[b],
+                          ADC_CONVERSIONS_BLOCK_FRAMES);
+      dspSpectrum_poll(&bench_spectrum);
+      cycles += profiler_now() - t0;
+    }
+  }
+  if (dspSpectrum_getResult(&bench_spectrum, &res) != HAL_OK) {
+    return HAL_ERROR; // fewer frames than one averaged result needs
+  }
+  result->cycles_per_frame =
+      (uint32_t)(cycles / (ADC_BENCH_DSP_PASSES * ADC_BENCH_BLOCKS *
+                           ADC_CONVERSIONS_BLOCK_FRAMES));
+  result->ram_bytes = sizeof(bench_spectrum);
+  adcBench_finish(result, 0);
+  return HAL_OK;
+}
+
+/**
+ * @brief Raw frames into COBS sample packets (batching + encoding)
+ */
+static HAL_StatusTypeDef adcBench_framing(ADC_BenchResult_t *result) {
+  const uint8_t *map = analogSensor_getBlockChannelMap();
+  uint8_t packet[TELEMETRY_FRAME_ENCODED_MAX];
+  uint16_t packet_len = 0;
+  uint64_t cycles = 0;
+  ADC_RingEntry_t entry = {0};
+
+  telemetryFrame_initBatch(&bench_batch, TELEMETRY_FRAME_ALL_CHANNELS);
+  for (uint32_t b = 0; b < ADC_BENCH_BLOCKS; b++) {
+    for (uint32_t f = 0; f < ADC_CONVERSIONS_BLOCK_FRAMES; f++) {
+      const uint16_t *src = &bench_blocks[b][f * ADC_CONVERSIONS_CHANNEL_COUNT];
+      for (uint8_t i = 0; i < ADC_CONVERSIONS_CHANNEL_COUNT; i++) {
+        entry.frame.samples[map[i]] = src[i];
+      }
+      uint32_t t0 = profiler_now();
+      telemetryFrame_addFrame(&bench_batch, &entry);
+      if (telemetryFrame_isFull(&bench_batch)) {
+        telemetryFrame_encodeSamples(&bench_batch, packet, sizeof(packet),
+                                     &packet_len);
+        telemetryFrame_initBatch(&bench_batch, TELEMETRY_FRAME_ALL_CHANNELS);
+      }
+      cycles += profiler_now() - t0;
+      entry.sequence++;
+    }
+  }
+  result->cycles_per_frame = (uint32_t)(
+      cycles / (ADC_BENCH_BLOCKS * ADC_CONVERSIONS_BLOCK_FRAMES));
+  result->ram_bytes = sizeof(bench_batch) + TELEMETRY_FRAME_ENCODED_MAX;
+  adcBench_finish(result, 0);
+  return HAL_OK;
+}
+
+/**
+ * @brief Lossless codec on full-rate runs, every channel (as the 'z' stream)
+ */
+static HAL_StatusTypeDef adcBench_codec(ADC_BenchResult_t *result) {
+  const uint8_t *map = analogSensor_getBlockChannelMap();
+  uint8_t data[SAMPLE_CODEC_MAX_BYTES(ADC_BENCH_CODEC_FRAMES)];
+  uint64_t cycles = 0;
+  uint32_t runs = 0;
+
+  for (uint32_t b = 0; b < ADC_BENCH_BLOCKS; b++) {
+    for (uint32_t first = 0; first + ADC_BENCH_CODEC_FRAMES <=
+                             ADC_CONVERSIONS_BLOCK_FRAMES;
+         first += ADC_BENCH_CODEC_FRAMES) {
+      for (uint32_t f = 0; f < ADC_BENCH_CODEC_FRAMES; f++) {
+        const uint16_t *src =
+            &bench_blocks[b][(first + f) * ADC_CONVERSIONS_CHANNEL_COUNT];
+        for (uint8_t i = 0; i < ADC_CONVERSIONS_CHANNEL_COUNT; i++) {
+          bench_frames[f].samples[map[i]] = src[i];
+        }
+      }
+      uint32_t t0 = profiler_now();
+      for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+        uint32_t len;
+        if (sampleCodec_encode(&bench_frames[0].samples[ch],
+                               ADC_BENCH_CODEC_FRAMES,
+                               sizeof(ADC_Frame_t) / sizeof(uint16_t), data,
+                               sizeof(data), &len) != HAL_OK) {
+          return HAL_ERROR;
+        }
+      }
+      cycles += profiler_now() - t0;
+      runs++;
+    }
+  }
+  if (runs == 0U) {
+    return HAL_ERROR;
+  }
+  result->cycles_per_frame =
+      (uint32_t)(cycles / ((uint64_t)runs * ADC_BENCH_CODEC_FRAMES));
+  result->ram_bytes = sizeof(bench_frames) + sizeof(data);
+  adcBench_finish(result, 0);
+  return HAL_OK;
+}
+
+/**
+ * @brief Stats, mg conversion and anti-alias filter as separate passes
+ *        over the block (reference for fused)
+ */
+static HAL_StatusTypeDef adcBench_calSeparate(ADC_BenchResult_t *result) {
+  const uint8_t *map = analogSensor_getBlockChannelMap();
+  const float32_t *out;
+  uint32_t frames;
+  uint64_t cycles = 0;
+
+  if (dspFilter_init(&bench_filter, ADC_BENCH_DECIMATION, map) != HAL_OK) {
+    return HAL_ERROR;
+  }
+  for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+    dspFilter_configChannel(&bench_filter, ch, &dspFilter_lowpass200Hz);
+  }
+  dspStats_reset(bench_stats);
+
+  for (uint32_t pass = 0; pass < ADC_BENCH_DSP_PASSES; pass++) {
+    for (uint32_t b = 0; b < ADC_BENCH_BLOCKS; b++) {
+      uint32_t t0 = profiler_now();
+      dspStats_accumulate(bench_stats, bench_blocks[b],
+                          ADC_CONVERSIONS_BLOCK_FRAMES);
+      adcCal_convertBlock_q15(bench_blocks[b], ADC_CONVERSIONS_BLOCK_FRAMES,
+                              map, bench_mg);
+      dspFilter_process(&bench_filter, bench_blocks[b],
+                        ADC_CONVERSIONS_BLOCK_FRAMES);
+      cycles += profiler_now() - t0;
+      dspFilter_getOutput(&bench_filter, &out, &frames, NULL);
+    }
+  }
+  result->cycles_per_frame =
+      (uint32_t)(cycles / (ADC_BENCH_DSP_PASSES * ADC_BENCH_BLOCKS *
+                           ADC_CONVERSIONS_BLOCK_FRAMES));
+  result->ram_bytes =
+      sizeof(bench_filter) + sizeof(bench_stats) + sizeof(bench_mg);
+  adcBench_finish(result, 0);
+  return HAL_OK;
+}
+
+/**
+ * @brief The same work in one pass: dspFused_process(), optionally through
+ *        the linearity tables
+ */
+static HAL_StatusTypeDef adcBench_fusedRun(ADC_BenchResult_t *result,
+                                           uint8_t linear) {
+  uint64_t cycles = 0;
+
+  if (dspFused_init(&bench_fused, ADC_BENCH_DECIMATION,
+                    analogSensor_getBlockChannelMap(),
+                    &dspFilter_lowpass200Hz) != HAL_OK ||
+      (linear && dspFused_attachLinearity(&bench_fused, 1) != HAL_OK)) {
+    return HAL_ERROR;
+  }
+  for (uint32_t pass = 0; pass < ADC_BENCH_DSP_PASSES; pass++) {
+    for (uint32_t b = 0; b < ADC_BENCH_BLOCKS; b++) {
+      uint32_t t0 = profiler_now();
+      dspFused_process(&bench_fused, bench_blocks[b],
+                       ADC_CONVERSIONS_BLOCK_FRAMES, bench_fused_out);
+      cycles += profiler_now() - t0;
+    }
+  }
+  result->cycles_per_frame =
+      (uint32_t)(cycles / (ADC_BENCH_DSP_PASSES * ADC_BENCH_BLOCKS *
+                           ADC_CONVERSIONS_BLOCK_FRAMES));
+  result->ram_bytes = sizeof(bench_fused) + sizeof(bench_fused_out) +
+                      (linear ? ADC_LIN_ADCS * ADC_LIN_CODES * 2U : 0U);
+  adcBench_finish(result, 0);
+  return HAL_OK;
+}
+
+static HAL_StatusTypeDef adcBench_fused(ADC_BenchResult_t *result) {
+  return adcBench_fusedRun(result, 0);
+}
+
+#if ADC_LIN_ENABLE
+static HAL_StatusTypeDef adcBench_fusedLinear(ADC_BenchResult_t *result) {
+  return adcBench_fusedRun(result, 1);
+}
+#endif
+
+/**
+ * @brief Interleaved -> planar transpose on the CPU
+ */
+static HAL_StatusTypeDef adcBench_deinterleave(ADC_BenchResult_t *result) {
+  const uint8_t *map = analogSensor_getBlockChannelMap();
+  uint64_t cycles = 0;
+
+  for (uint32_t pass = 0; pass < ADC_BENCH_DSP_PASSES; pass++) {
+    for (uint32_t b = 0; b < ADC_BENCH_BLOCKS; b++) {
+      uint32_t t0 = profiler_now();
+      dspDeinterleave_process(bench_blocks[b], ADC_CONVERSIONS_BLOCK_FRAMES,
+                              map, &bench_planes[0][0],
+                              ADC_CONVERSIONS_BLOCK_FRAMES);
+      cycles += profiler_now() - t0;
+    }
+  }
+  result->cycles_per_frame =
+      (uint32_t)(cycles / (ADC_BENCH_DSP_PASSES * ADC_BENCH_BLOCKS *
+                           ADC_CONVERSIONS_BLOCK_FRAMES));
+  result->ram_bytes = sizeof(bench_planes);
+  adcBench_finish(result, 0);
+  return HAL_OK;
+}
+
+static void adcBench_planesDone(HAL_StatusTypeDef status, void *ctx) {
+  (void)ctx;
+  bench_planes_done = (status == HAL_OK) ? 1U : 2U;
+}
+
+/**
+ * @brief The same transpose on DMA2D; start to done, so cycles= is the
+ *        engine's latency, not CPU time (the CPU only takes six interrupts)
+ */
+static HAL_StatusTypeDef adcBench_deinterleaveDma2d(
+    ADC_BenchResult_t *result) {
+  const uint8_t *map = analogSensor_getBlockChannelMap();
+  uint64_t cycles = 0;
+
+  if (dspDeinterleave_initDma2d() != HAL_OK) {
+    return HAL_ERROR;
+  }
+  for (uint32_t pass = 0; pass < ADC_BENCH_DSP_PASSES; pass++) {
+    for (uint32_t b = 0; b < ADC_BENCH_BLOCKS; b++) {
+      bench_planes_done = 0;
+      uint32_t start = HAL_GetTick();
+      uint32_t t0 = profiler_now();
+      if (dspDeinterleave_startDma2d(bench_blocks[b],
+                                     ADC_CONVERSIONS_BLOCK_FRAMES, map,
+                                     &bench_planes[0][0],
+                                     ADC_CONVERSIONS_BLOCK_FRAMES,
+                                     adcBench_planesDone, NULL) != HAL_OK) {
+        return HAL_ERROR;
+      }
+      while (bench_planes_done == 0U) {
+        if (HAL_GetTick() - start > ADC_BENCH_DMA2D_TIMEOUT_MS) {
+          return HAL_TIMEOUT;
+        }
+      }
+      cycles += profiler_now() - t0;
+      if (bench_planes_done != 1U) {
+        return HAL_ERROR;
+      }
+    }
+  }
+  result->cycles_per_frame =
+      (uint32_t)(cycles / (ADC_BENCH_DSP_PASSES * ADC_BENCH_BLOCKS *
+                           ADC_CONVERSIONS_BLOCK_FRAMES));
+  result->ram_bytes = sizeof(bench_planes);
+  adcBench_finish(result, 0);
+  return HAL_OK;
+}
+
+/**
+ * @brief Multi-rate tree: X/Y/Z at 1 kHz, the other three at 10 Hz, so
+ *        the tilt channels also run the 1 kHz level
+ */
+static HAL_StatusTypeDef adcBench_multirate(ADC_BenchResult_t *result) {
+  const q15_t *out;
+  uint32_t frames;
+  uint64_t cycles = 0;
+
+  if (dspMultirate_init(&bench_multirate, NULL,
+                        analogSensor_getBlockChannelMap()) != HAL_OK) {
+    return HAL_ERROR;
+  }
+  for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+    dspMultirate_setChannelRates(&bench_multirate, ch,
+                                 DSP_MULTIRATE_LEVEL_BIT(ch < 3U ? 0U : 1U));
+  }
+  for (uint32_t pass = 0; pass < ADC_BENCH_DSP_PASSES; pass++) {
+    for (uint32_t b = 0; b < ADC_BENCH_BLOCKS; b++) {
+      uint32_t t0 = profiler_now();
+      dspMultirate_process(&bench_multirate, bench_blocks[b],
+                           ADC_CONVERSIONS_BLOCK_FRAMES);
+      cycles += profiler_now() - t0;
+      for (uint8_t l = 0; l < DSP_MULTIRATE_LEVELS; l++) {
+        dspMultirate_getOutput(&bench_multirate, l, &out, &frames, NULL);
+      }
+    }
+  }
+  result->cycles_per_frame =
+      (uint32_t)(cycles / (ADC_BENCH_DSP_PASSES * ADC_BENCH_BLOCKS *
+                           ADC_CONVERSIONS_BLOCK_FRAMES));
+  result->ram_bytes = sizeof(bench_multirate);
+  adcBench_finish(result, 0);
+  return HAL_OK;
+}
+
+static const ADC_BenchEntry_t scenarios[] = {
+    {"poll_hal", adcBench_pollHAL},   {"poll_ll", adcBench_pollLL},
+    {"dma_scan", adcBench_dmaScan},   {"multi_adc", adcBench_multiADC},
+    {"filter", adcBench_filterChain}, {"fft", adcBench_fft},
+    {"framing", adcBench_framing},    {"codec", adcBench_codec},
+    {"cal_separate", adcBench_calSeparate}, {"fused", adcBench_fused},
+    {"deinterleave", adcBench_deinterleave},
+    {"deinterleave_dma2d", adcBench_deinterleaveDma2d},
+    {"multirate", adcBench_multirate},
+#if ADC_LIN_ENABLE
+    {"fused_linear", adcBench_fusedLinear},
+#endif
+};
+
+/* Scenarios repeated in every flash mode: the polling loop, the DSP chain
+ * and the framing */
+static const ADC_BenchEntry_t flash_scenarios[] = {
+    {"poll_hal", adcBench_pollHAL},
+    {"filter", adcBench_filterChain},
+    {"fft", adcBench_fft},
+    {"framing", adcBench_framing},
+};
+
+/**
+ * @brief Run the flash_scenarios once per flash mode, each fetched over the
+ *        mode's bus, one line per mode, then the fastest mode by total
+ */
+static HAL_StatusTypeDef adcBench_flashModes(uint8_t have_blocks) {
+  HAL_StatusTypeDef status = HAL_OK;
+  uint64_t best_total = UINT64_MAX;
+  FlashMode_t best = FLASH_MODE_DEFAULT;
+  char line[160];
+
+  for (uint32_t m = 0; m < FLASH_MODE_COUNT; m++) {
+    const FlashMode_t mode = (FlashMode_t)m;
+    int len = snprintf(line, sizeof(line), "BENCH flash mode=%s",
+                       flashMode_getName(mode));
+    uint64_t total = 0;
+    uint8_t ok = 1;
+
+    flashMode_apply(mode);
+    for (uint32_t i = 0;
+         i < sizeof(flash_scenarios) / sizeof(flash_scenarios[0]); i++) {
+      ADC_BenchResult_t result = {0};
+      const ADC_BenchScenario_t run = (ADC_BenchScenario_t)flashMode_entry(
+          mode, (FlashMode_Fn_t)flash_scenarios[i].run);
+      if ((i > 0U && !have_blocks) || run(&result) != HAL_OK) {
+        ok = 0;
+        len += snprintf(&line[len], sizeof(line) - (size_t)len, " %s=error",
+                        flash_scenarios[i].name);
+        continue;
+      }
+      total += result.cycles_per_frame;
+      len += snprintf(&line[len], sizeof(line) - (size_t)len, " %s=%lu",
+                      flash_scenarios[i].name,
+                      (unsigned long)result.cycles_per_frame);
+    }
+    flashMode_apply(FLASH_MODE_DEFAULT);
+
+    snprintf(&line[len], sizeof(line) - (size_t)len, " total=%lu\r\n",
+             (unsigned long)total);
+    adcBench_send(line);
+    if (!ok) {
+      status = HAL_ERROR;
+    } else if (total < best_total) {
+      best_total = total;
+      best = mode;
+    }
+  }
+
+  snprintf(line, sizeof(line), "BENCH flash best=%s default=%s\r\n",
+           flashMode_getName(best), flashMode_getName(FLASH_MODE_DEFAULT));
+  adcBench_send(line);
+  return status;
+}
+
+/* DMA bus contention --------------------------------------------------------*/
+
+// Every stream in direct mode, then FIFO bursts of 4 and of 8 beats
+static const ADC_BenchDmaPreset_t dma_presets[] = {
+    {"direct", {0U, 2U, 1U}},
+    {"fifo_inc4", {1U, 2U, 4U}},
+    {"fifo_inc8", {1U, 4U, 8U}}};
+
+/**
+ * @brief Memory-to-memory load on DMA2 stream 1, word bursts through the
+ *        same bus matrix ports as the ADC stream, and the UART load line
+ */
+static HAL_StatusTypeDef adcBench_busInit(void) {
+  // Filler the host drops: "BENCH dma fill ----...\r\n"
+  memset(bench_fill, '-', sizeof(bench_fill));
+  memcpy(bench_fill, "BENCH dma fill ", 15U);
+  bench_fill[sizeof(bench_fill) - 2U] = '\r';
+  bench_fill[sizeof(bench_fill) - 1U] = '\n';
+
+  __HAL_RCC_DMA2_CLK_ENABLE();
+  bench_bus_dma.Instance = DMA2_Stream1;
+  bench_bus_dma.Init.Channel = DMA_CHANNEL_0;
+  bench_bus_dma.Init.Direction = DMA_MEMORY_TO_MEMORY;
+  bench_bus_dma.Init.PeriphInc = DMA_PINC_ENABLE;
+  bench_bus_dma.Init.MemInc = DMA_MINC_ENABLE;
+  bench_bus_dma.Init.PeriphDataAlignment = DMA_PDATAALIGN_WORD;
+  bench_bus_dma.Init.MemDataAlignment = DMA_MDATAALIGN_WORD;
+  bench_bus_dma.Init.Mode = DMA_NORMAL;
+  bench_bus_dma.Init.Priority = DMA_PRIORITY_LOW;
+  bench_bus_dma.Init.FIFOMode = DMA_FIFOMODE_ENABLE; // required for M2M
+  bench_bus_dma.Init.FIFOThreshold = DMA_FIFO_THRESHOLD_FULL;
+  bench_bus_dma.Init.MemBurst = DMA_MBURST_INC4;
+  bench_bus_dma.Init.PeriphBurst = DMA_PBURST_INC4;
+  return HAL_DMA_Init(&bench_bus_dma);
+}
+
+static HAL_StatusTypeDef adcBench_busStart(void) {
+  return HAL_DMA_Start(&bench_bus_dma, (uint32_t)bench_bus_src,
+                       (uint32_t)bench_bus_dst, ADC_BENCH_BUS_WORDS);
+}
+
+/**
+ * @brief Initialise the ADC and USART3 TX streams again with the current
+ *        dma_tuning.h settings
+ */
+static HAL_StatusTypeDef adcBench_dmaReinit(void) {
+  // The TX stream is idle only between two packets
+  const uint32_t start = HAL_GetTick();
+  HAL_StatusTypeDef status;
+  do {
+    telemetry_poll();
+    status = dmaTuning_reinit(DMA_TUNING_UART_TX, huart3.hdmatx);
+  } while (status == HAL_BUSY &&
+           HAL_GetTick() - start < ADC_BENCH_TX_TIMEOUT_MS);
+  if (status != HAL_OK) {
+    return status;
+  }
+  return dmaTuning_reinit(DMA_TUNING_ADC, hadc1.DMA_Handle);
+}
+
+/**
+ * @brief One pool scan at rate_hz with the UART kept full and the bus load
+ *        running
+ *
+ * @param rate_hz    Frame rate
+ * @param uart_bytes Receives the bytes sent over USART3
+ * @param bus_bytes  Receives the bytes the bus load copied
+ *
+ * @return 1 when the scan ran without an overrun, a dropped block or an
+ *         ADC/DMA error
+ */
+static uint8_t adcBench_busRun(uint32_t rate_hz, uint32_t *uart_bytes,
+                               uint32_t *bus_bytes) {
+  ADC_OverrunInfo_t overrun_before = {0};
+  ADC_OverrunInfo_t overrun_after = {0};
+  Telemetry_Stats_t tx_before = {0};
+  Telemetry_Stats_t tx_after = {0};
+
+  analogSensor_resetErrors();
+  const uint32_t dropped = analogSensor_getDroppedBlocks();
+  (void)analogSensor_getOverrunInfo(&overrun_before);
+  (void)telemetry_getStats(&tx_before);
+
+  *bus_bytes = 0;
+  uint8_t ok = adcBench_busStart() == HAL_OK &&
+               analogSensor_startTimedDMA(rate_hz) == HAL_OK;
+  const uint32_t start = HAL_GetTick();
+  while (ok && HAL_GetTick() - start < ADC_BENCH_DMA_RUN_MS) {
+    if (telemetry_getFreeSlots() != 0U) {
+      (void)telemetry_send((const uint8_t *)bench_fill, sizeof(bench_fill));
+    }
+    if (__HAL_DMA_GET_FLAG(&bench_bus_dma,
+                           __HAL_DMA_GET_TC_FLAG_INDEX(&bench_bus_dma))) {
+      // Clears the flags and the handle state; the copy is already done
+      (void)HAL_DMA_PollForTransfer(&bench_bus_dma, HAL_DMA_FULL_TRANSFER,
+                                    0U);
+      *bus_bytes += sizeof(bench_bus_src);
+      ok = (adcBench_busStart() == HAL_OK);
+    }
+  }
+  analogSensor_stopDMA();
+  (void)HAL_DMA_Abort(&bench_bus_dma);
+
+  (void)telemetry_getStats(&tx_after);
+  (void)analogSensor_getOverrunInfo(&overrun_after);
+  *uart_bytes = (tx_after.sent - tx_before.sent) * ADC_BENCH_FILL_BYTES;
+  return (uint8_t)(ok &&
+                   overrun_after.recoveries == overrun_before.recoveries &&
+                   analogSensor_getDroppedBlocks() == dropped &&
+                   analogSensor_getErrorCount() == 0U);
+}
+
+/**
+ * @brief Highest clean scan rate with every stream busy, per FIFO preset,
+ *        one line per preset
+ */
+static HAL_StatusTypeDef adcBench_dmaContention(void) {
+  DmaTuning_Config_t saved[DMA_TUNING_STREAM_COUNT];
+  const uint32_t adc_max =
+      analogSensor_getMaxFrameRate(clockProfile_getActive()->adc_prescaler);
+  HAL_StatusTypeDef status = HAL_OK;
+  char line[160];
+
+  for (uint32_t s = 0; s < DMA_TUNING_STREAM_COUNT; s++) {
+    (void)dmaTuning_get((DmaTuning_Stream_t)s, &saved[s]);
+  }
+  // Pool blocks complete on transfer-complete, where the FIFO is drained
+  if (adcBench_busInit() != HAL_OK ||
+      analogSensor_setBlockPool(1U) != HAL_OK) {
+    adcBench_send("BENCH dma error\r\n");
+    return HAL_ERROR;
+  }
+
+  for (uint32_t p = 0; p < sizeof(dma_presets) / sizeof(dma_presets[0]);
+       p++) {
+    uint32_t rate = 0;
+    uint32_t uart_bytes = 0;
+    uint32_t bus_bytes = 0;
+
+    for (uint32_t s = 0; s < DMA_TUNING_STREAM_COUNT; s++) {
+      // The SDMMC stream refuses direct mode and keeps its FIFO
+      (void)dmaTuning_set((DmaTuning_Stream_t)s, &dma_presets[p].cfg);
+    }
+    const uint8_t ok = (adcBench_dmaReinit() == HAL_OK);
+
+    // From the ADC bound down in eighths, the first rate that runs clean
+    for (uint32_t step = ADC_BENCH_BUS_STEPS; ok && step > 0U; step--) {
+      const uint32_t hz =
+          (uint32_t)((uint64_t)adc_max * step / ADC_BENCH_BUS_STEPS);
+      if (adcBench_busRun(hz, &uart_bytes, &bus_bytes)) {
+        rate = hz;
+        break;
+      }
+    }
+    if (!ok || rate == 0U) {
+      status = HAL_ERROR;
+    }
+
+    const uint32_t adc_bps =
+        rate * ADC_CONVERSIONS_CHANNEL_COUNT * (uint32_t)sizeof(uint16_t);
+    const uint32_t uart_bps = uart_bytes * 1000U / ADC_BENCH_DMA_RUN_MS;
+    const uint32_t bus_bps =
+        (uint32_t)((uint64_t)bus_bytes * 1000U / ADC_BENCH_DMA_RUN_MS);
+    snprintf(line, sizeof(line),
+             "BENCH dma preset=%s adc_hz=%lu adc_Bps=%lu uart_Bps=%lu "
+             "bus_Bps=%lu total_Bps=%lu%s\r\n",
+             dma_presets[p].name, (unsigned long)rate,
+             (unsigned long)adc_bps, (unsigned long)uart_bps,
+             (unsigned long)bus_bps,
+             (unsigned long)(adc_bps + uart_bps + bus_bps),
+             (ok && rate != 0U) ? "" : " error");
+    adcBench_send(line);
+  }
+
+  for (uint32_t s = 0; s < DMA_TUNING_STREAM_COUNT; s++) {
+    (void)dmaTuning_set((DmaTuning_Stream_t)s, &saved[s]);
+  }
+  if (adcBench_dmaReinit() != HAL_OK) {
+    status = HAL_ERROR;
+  }
+  (void)analogSensor_setBlockPool(0U);
+  (void)HAL_DMA_DeInit(&bench_bus_dma);
+  return status;
+}
+
+/**
+ * @brief CPU cycles of ADC_BENCH_PROBE_PASSES reads of a probe buffer, its
+ *        lines invalidated before each so every one comes from the bank
+ *
+ * @param probe  Buffer of ADC_BENCH_PROBE_WORDS
+ * @param loaded 1 = with the scan, USART3 and the bus load running
+ * @param bus_bytes Receives the bytes the bus load copied meanwhile
+ */
+static uint32_t adcBench_probeBank(uint32_t *probe, uint8_t loaded,
+                                   uint32_t *bus_bytes) {
+  uint32_t cycles = 0;
+  uint32_t sum = 0;
+
+  *bus_bytes = 0;
+  if (loaded && (adcBench_busStart() != HAL_OK ||
+                 analogSensor_startTimedDMA(analogSensor_getMaxFrameRate(
+                     clockProfile_getActive()->adc_prescaler)) != HAL_OK)) {
+    (void)HAL_DMA_Abort(&bench_bus_dma);
+    return 0;
+  }
+  for (uint32_t pass = 0; pass < ADC_BENCH_PROBE_PASSES; pass++) {
+    if (loaded && telemetry_getFreeSlots() != 0U) {
+      (void)telemetry_send((const uint8_t *)bench_fill, sizeof(bench_fill));
+    }
+    if (loaded && __HAL_DMA_GET_FLAG(
+                      &bench_bus_dma,
+                      __HAL_DMA_GET_TC_FLAG_INDEX(&bench_bus_dma))) {
+      (void)HAL_DMA_PollForTransfer(&bench_bus_dma, HAL_DMA_FULL_TRANSFER,
+                                    0U);
+      *bus_bytes += sizeof(bench_bus_src);
+      (void)adcBench_busStart();
+    }
+    SCB_InvalidateDCache_by_Addr(probe, (int32_t)(ADC_BENCH_PROBE_WORDS *
+                                                  sizeof(uint32_t)));
+    const uint32_t start = profiler_now();
+    for (uint32_t i = 0; i < ADC_BENCH_PROBE_WORDS; i++) {
+      sum += probe[i];
+    }
+    cycles += profiler_now() - start;
+  }
+  bench_probe_sink = sum;
+  if (loaded) {
+    analogSensor_stopDMA();
+    (void)HAL_DMA_Abort(&bench_bus_dma);
+  }
+  return cycles;
+}
+
+/**
+ * @brief CPU reads from DTCM, SRAM1 and SRAM2, idle and under the DMA
+ *        load of the pool scan (SRAM1), the bus load (SRAM1) and USART3
+ *        (SRAM2), one line per bank
+ */
+static HAL_StatusTypeDef adcBench_sramBanks(void) {
+  static const struct {
+    const char *name;
+    uint32_t *probe;
+  } banks[] = {{"dtcm", bench_probe_dtcm},
+               {"sram1", bench_probe_sram1},
+               {"sram2", bench_probe_sram2}};
+  const uint32_t kb = ADC_BENCH_PROBE_PASSES * ADC_BENCH_PROBE_WORDS *
+                      (uint32_t)sizeof(uint32_t) / 1024U;
+  HAL_StatusTypeDef status = HAL_OK;
+  char line[128];
+
+  if (adcBench_busInit() != HAL_OK ||
+      analogSensor_setBlockPool(1U) != HAL_OK) {
+    adcBench_send("BENCH sram error\r\n");
+    return HAL_ERROR;
+  }
+  for (uint32_t b = 0; b < sizeof(banks) / sizeof(banks[0]); b++) {
+    uint32_t bus_bytes = 0;
+    const uint32_t idle = adcBench_probeBank(banks[b].probe, 0U, &bus_bytes);
+    const uint32_t start = HAL_GetTick();
+    const uint32_t load = adcBench_probeBank(banks[b].probe, 1U, &bus_bytes);
+    const uint32_t ms = HAL_GetTick() - start;
+    const uint8_t ok = (load != 0U);
+    if (!ok) {
+      status = HAL_ERROR;
+    }
+    snprintf(line, sizeof(line),
+             "BENCH sram bank=%s idle_cyc_kb=%lu load_cyc_kb=%lu "
+             "bus_Bps=%lu%s\r\n",
+             banks[b].name, (unsigned long)(idle / kb),
+             (unsigned long)(load / kb),
+             (unsigned long)((ms != 0U) ? (uint64_t)bus_bytes * 1000U / ms
+                                        : 0U),
+             ok ? "" : " error");
+    adcBench_send(line);
+  }
+  (void)analogSensor_setBlockPool(0U);
+  (void)HAL_DMA_DeInit(&bench_bus_dma);
+  return status;
+}
+
+/* Memory bandwidth ----------------------------------------------------------*/
+
+// Each RAM bank copies within itself; flash is copied into DTCM, once over
+// AXIM and once over the ITCM interface (ART), which the DMA cannot reach
+static const ADC_BenchRegion_t regions[] = {
+    {"dtcm", bench_probe_dtcm, bench_copy_dtcm, 1U},
+    {"sram1", bench_probe_sram1, bench_copy_sram1, 1U},
+    {"sram2", bench_probe_sram2, bench_copy_sram2, 1U},
+    {"flash_axim", (const uint32_t *)FLASHAXI_BASE, bench_copy_dtcm, 1U},
+    {"flash_itcm", (const uint32_t *)FLASHITCM_BASE, bench_copy_dtcm, 0U}};
+
+/**
+ * @brief Start the ADC and transport load: the pool scan at its ADC bound
+ *        and USART3 kept full
+ */
+static HAL_StatusTypeDef adcBench_loadStart(void) {
+  return analogSensor_startTimedDMA(
+      analogSensor_getMaxFrameRate(clockProfile_getActive()->adc_prescaler));
+}
+
+static void adcBench_loadPoll(void) {
+  if (telemetry_getFreeSlots() != 0U) {
+    (void)telemetry_send((const uint8_t *)bench_fill, sizeof(bench_fill));
+  }
+}
+
+/**
+ * @brief Bytes per second of ADC_BENCH_PROBE_PASSES copies of one probe
+ *        buffer, by memcpy() or on DMA2 stream 1, 0 on failure
+ *
+ * Both buffers are cleaned and invalidated before each pass, and the CPU
+ * copy includes cleaning the destination, so every byte crosses the bus.
+ *
+ * @param region Source and destination
+ * @param dma    1 = memory-to-memory DMA, 0 = memcpy()
+ * @param loaded 1 = beside the pool scan and a full USART3
+ */
+static uint32_t adcBench_copyRegion(const ADC_BenchRegion_t *region,
+                                    uint8_t dma, uint8_t loaded) {
+  const int32_t size = (int32_t)(ADC_BENCH_PROBE_WORDS * sizeof(uint32_t));
+  uint64_t cycles = 0;
+  uint8_t ok = 1U;
+
+  if (loaded && adcBench_loadStart() != HAL_OK) {
+    return 0;
+  }
+  for (uint32_t pass = 0; ok && pass < ADC_BENCH_PROBE_PASSES; pass++) {
+    if (loaded) {
+      adcBench_loadPoll();
+    }
+    SCB_CleanInvalidateDCache_by_Addr((uint32_t *)region->src, size);
+    SCB_CleanInvalidateDCache_by_Addr(region->dst, size);
+    const uint32_t start = profiler_now();
+    if (dma) {
+      ok = HAL_DMA_Start(&bench_bus_dma, (uint32_t)region->src,
+                         (uint32_t)region->dst,
+                         ADC_BENCH_PROBE_WORDS) == HAL_OK &&
+           HAL_DMA_PollForTransfer(&bench_bus_dma, HAL_DMA_FULL_TRANSFER,
+                                   ADC_BENCH_TX_TIMEOUT_MS) == HAL_OK;
+    } else {
+      memcpy(region->dst, region->src, (size_t)size);
+      SCB_CleanDCache_by_Addr(region->dst, size);
+    }
+    cycles += profiler_now() - start;
+  }
+  if (loaded) {
+    analogSensor_stopDMA();
+  }
+  if (!ok) {
+    (void)HAL_DMA_Abort(&bench_bus_dma);
+    return 0;
+  }
+  const uint64_t bytes = (uint64_t)ADC_BENCH_PROBE_PASSES * (uint64_t)size;
+  return (cycles != 0U)
+             ? (uint32_t)(bytes * HAL_RCC_GetHCLKFreq() / cycles)
+             : 0U;
+}
+
+/**
+ * @brief CPU and DMA copy bandwidth of every region, idle and beside the
+ *        ADC and USART3 streams, one line per region and engine
+ */
+static HAL_StatusTypeDef adcBench_bandwidth(void) {
+  static const char *const engines[] = {"memcpy", "m2m"};
+  HAL_StatusTypeDef status = HAL_OK;
+  char line[112];
+
+  // Stream 1 as set up for the bus load is the copy engine here
+  if (adcBench_busInit() != HAL_OK ||
+      analogSensor_setBlockPool(1U) != HAL_OK) {
+    adcBench_send("BENCH memcpy error\r\n");
+    return HAL_ERROR;
+  }
+  for (uint8_t dma = 0; dma < 2U; dma++) {
+    for (uint32_t r = 0; r < sizeof(regions) / sizeof(regions[0]); r++) {
+      if (dma && !regions[r].dma) {
+        continue;
+      }
+      const uint32_t idle = adcBench_copyRegion(&regions[r], dma, 0U);
+      const uint32_t load = adcBench_copyRegion(&regions[r], dma, 1U);
+      const uint8_t ok = (idle != 0U && load != 0U);
+      if (!ok) {
+        status = HAL_ERROR;
+      }
+      snprintf(line, sizeof(line),
+               "BENCH %s region=%s idle_Bps=%lu load_Bps=%lu%s\r\n",
+               engines[dma], regions[r].name, (unsigned long)idle,
+               (unsigned long)load, ok ? "" : " error");
+      adcBench_send(line);
+    }
+  }
+  (void)analogSensor_setBlockPool(0U);
+  (void)HAL_DMA_DeInit(&bench_bus_dma);
+  return status;
+}
+
+/**
+ * @brief Pend the bench vector once and return the cycles to its handler
+ *
+ * @param fp_context 1 = execute an FP instruction first (CONTROL.FPCA set),
+ *                   0 = clear FPCA so the entry stacks the basic frame
+ */
+static uint32_t adcBench_irqEntryOnce(uint8_t fp_context) {
+  if (fp_context) {
+    __asm volatile("vmov.f32 s1, s1");
+  } else {
+    __set_CONTROL(__get_CONTROL() & ~CONTROL_FPCA_Msk);
+    __ISB();
+  }
+  bench_irq_stamp = 0;
+  const uint32_t start = DWT->CYCCNT;
+  NVIC->STIR = (uint32_t)ADC_BENCH_IRQn;
+  __DSB();
+  __ISB();
+  while (bench_irq_stamp == 0U) {
+  }
+  return bench_irq_stamp - start;
+}
+
+/**
+ * @brief Interrupt entry with and without FP context, lazy and full
+ *        stacking, FPU-free and FP-using handlers
+ */
+static HAL_StatusTypeDef adcBench_interruptEntry(void) {
+  static const struct {
+    const char *name;
+    uint8_t fp_context;
+    uint8_t lazy;
+  } contexts[] = {{"int", 0U, 1U}, {"fp_lazy", 1U, 1U}, {"fp_full", 1U, 0U}};
+  char line[112];
+
+  HAL_NVIC_SetPriority(ADC_BENCH_IRQn, IRQ_PRIORITY_ACQUISITION, 0);
+  HAL_NVIC_EnableIRQ(ADC_BENCH_IRQn);
+  for (uint32_t c = 0; c < sizeof(contexts) / sizeof(contexts[0]); c++) {
+    uint32_t min[2] = {UINT32_MAX, UINT32_MAX};
+    uint32_t sum[2] = {0, 0};
+    uint32_t fp_sum = 0;
+
+    irqPriority_setFpuStacking(contexts[c].lazy);
+    for (uint8_t use_fp = 0; use_fp < 2U; use_fp++) {
+      bench_irq_use_fp = use_fp;
+      for (uint32_t i = 0; i < ADC_BENCH_IRQ_PASSES; i++) {
+        const uint32_t cycles = adcBench_irqEntryOnce(contexts[c].fp_context);
+        sum[use_fp] += cycles;
+        if (cycles < min[use_fp]) {
+          min[use_fp] = cycles;
+        }
+        if (use_fp) {
+          fp_sum += bench_irq_fp_cycles;
+        }
+      }
+    }
+    snprintf(line, sizeof(line),
+             "BENCH irq_entry ctx=%s min=%lu mean=%lu fp_min=%lu "
+             "fp_mean=%lu fp_first=%lu\r\n",
+             contexts[c].name, (unsigned long)min[0],
+             (unsigned long)(sum[0] / ADC_BENCH_IRQ_PASSES),
+             (unsigned long)min[1],
+             (unsigned long)(sum[1] / ADC_BENCH_IRQ_PASSES),
+             (unsigned long)(fp_sum / ADC_BENCH_IRQ_PASSES));
+    adcBench_send(line);
+  }
+  HAL_NVIC_DisableIRQ(ADC_BENCH_IRQn);
+  bench_irq_use_fp = 0;
+  irqPriority_setFpuStacking(IRQ_FPU_LAZY_STACKING);
+  return HAL_OK;
+}
+
+#if DAC_LOOPBACK_ENABLE || ADC_BENCH_QUALITY_ENABLE
+/**
+ * @brief Append " name=x.yy", value in hundredths; returns the new length
+ */
+static int adcBench_appendCenti(char *line, size_t size, int len,
+                                const char *name, int32_t centi) {
+  const uint32_t mag = (centi < 0) ? (uint32_t)-centi : (uint32_t)centi;
+  if (len < 0 || (size_t)len >= size) {
+    return len;
+  }
+  return len + snprintf(&line[len], size - (size_t)len, " %s=%s%lu.%02lu",
+                        name, (centi < 0) ? "-" : "",
+                        (unsigned long)(mag / 100U),
+                        (unsigned long)(mag % 100U));
+}
+
+/**
+ * @brief Close a report line and queue it
+ */
+static void adcBench_sendLine(char *line, size_t size, int len, uint8_t ok) {
+  if (len < 0 || (size_t)len >= size) {
+    return;
+  }
+  snprintf(&line[len], size - (size_t)len, "%s\r\n", ok ? "" : " error");
+  adcBench_send(line);
+}
+
+/**
+ * @brief Move to a clock profile with the timebase and ADCCLK following it
+ */
+static HAL_StatusTypeDef adcBench_applyProfile(ClockProfile_Id_t id) {
+  // Let the UART drain: the switch runs from HSI for a moment
+  uint32_t start = HAL_GetTick();
+  while (telemetry_getFreeSlots() < TELEMETRY_SLOT_COUNT &&
+         HAL_GetTick() - start < ADC_BENCH_TX_TIMEOUT_MS) {
+    telemetry_poll();
+  }
+  if (clockProfile_apply(id, CLOCK_PROFILE_HSE_BYPASS
+                                 ? CLOCK_SOURCE_HSE_BYPASS
+                                 : CLOCK_SOURCE_HSI) != HAL_OK ||
+      timebase_init() != HAL_OK) {
+    return HAL_ERROR;
+  }
+  return analogSensor_setClockPrescaler(
+      clockProfile_getActive()->adc_prescaler);
+}
+#endif
+
+#if DAC_LOOPBACK_ENABLE
+static void adcBench_loopbackCallback(const uint16_t *block,
+                                      uint32_t frame_count, void *ctx) {
+  UNUSED(ctx);
+  dacLoop_processBlock(block, frame_count);
+}
+
+/**
+ * @brief DAC loopback in every clock profile at each settling accuracy of
+ *        the test channel, one line per run
+ */
+static HAL_StatusTypeDef adcBench_loopback(void) {
+  static const uint8_t accuracy_bits[] = ADC_BENCH_LOOP_BITS;
+  const DacLoop_Config_t cfg = {.channel = ADC_BENCH_LOOP_CHANNEL,
+                                .port = GPIOG,
+                                .pin = GPIO_PIN_2};
+  const ClockProfile_Id_t home = clockProfile_getActive()->id;
+  ADC_ChannelProfile_t saved;
+  HAL_StatusTypeDef status = HAL_OK;
+  char line[256];
+
+  if (dacLoop_init(&cfg) != HAL_OK ||
+      analogSensor_getChannelProfile(cfg.channel, &saved) != HAL_OK) {
+    adcBench_send("BENCH loopback error\r\n");
+    return HAL_ERROR;
+  }
+  analogSensor_registerBlockCallback(adcBench_loopbackCallback, NULL);
+  for (uint32_t p = 0; p < CLOCK_PROFILE_COUNT; p++) {
+    if (adcBench_applyProfile((ClockProfile_Id_t)p) != HAL_OK) {
+      status = HAL_ERROR;
+      continue;
+    }
+    for (uint32_t i = 0; i < sizeof(accuracy_bits); i++) {
+      ADC_ChannelProfile_t profile = saved;
+      DacLoop_Result_t r = {0};
+      profile.accuracy_bits = accuracy_bits[i];
+      uint8_t ok =
+          analogSensor_setChannelProfile(cfg.channel, &profile) == HAL_OK &&
+          analogSensor_startTimedDMA(ADC_BENCH_FRAME_RATE_HZ) == HAL_OK &&
+          dacLoop_start() == HAL_OK;
+      while (ok && dacLoop_poll() != HAL_OK) {
+        telemetry_poll();
+      }
+      analogSensor_stopDMA();
+      ok = ok && dacLoop_getResult(&r) == HAL_OK && r.ok;
+      if (!ok) {
+        status = HAL_ERROR;
+      }
+      // The scan this configuration could run at: the throughput side
+      const uint32_t max_hz = analogSensor_getMaxFrameRate(
+          clockProfile_getActive()->adc_prescaler);
+      int len = snprintf(
+          line, sizeof(line),
+          "BENCH loopback profile=%lu bits=%u adcclk=%lu smp=%lu "
+          "rate_mhz=%lu max_hz=%lu sample_us=%lu react_us=%lu "
+          "total_max_us=%lu",
+          (unsigned long)p, accuracy_bits[i], (unsigned long)r.adcclk_hz,
+          (unsigned long)r.sampling_cycles, (unsigned long)r.rate_mhz,
+          (unsigned long)max_hz, (unsigned long)r.sample_mean_us,
+          (unsigned long)r.react_mean_us, (unsigned long)r.total_max_us);
+      len = adcBench_appendCenti(line, sizeof(line), len, "enob",
+                                 r.enob_centi);
+      len = adcBench_appendCenti(line, sizeof(line), len, "snr",
+                                 r.snr_centi_db);
+      len = adcBench_appendCenti(line, sizeof(line), len, "thd",
+                                 r.thd_centi_db);
+      len = adcBench_appendCenti(line, sizeof(line), len, "sfdr",
+                                 r.sfdr_centi_db);
+      len = adcBench_appendCenti(line, sizeof(line), len, "fft_enob",
+                                 r.fft_enob_centi);
+      adcBench_sendLine(line, sizeof(line), len, ok);
+    }
+  }
+  analogSensor_registerBlockCallback(NULL, NULL);
+  (void)analogSensor_setChannelProfile(cfg.channel, &saved);
+  if (adcBench_applyProfile(home) != HAL_OK) {
+    status = HAL_ERROR;
+  }
+  return status;
+}
+#endif
+
+#if ADC_BENCH_QUALITY_ENABLE
+/**
+ * @brief External tone through the interleaved capture in every clock
+ *        profile, one line per profile
+ */
+static HAL_StatusTypeDef adcBench_quality(void) {
+  const ClockProfile_Id_t home = clockProfile_getActive()->id;
+  HAL_StatusTypeDef status = HAL_OK;
+  char line[192];
+
+  for (uint32_t p = 0; p < CLOCK_PROFILE_COUNT; p++) {
+    DSP_QualityResult_t q = {0};
+    const uint16_t *samples = NULL;
+    uint32_t count = 0;
+    HAL_StatusTypeDef capture = HAL_ERROR;
+    uint8_t ok = adcBench_applyProfile((ClockProfile_Id_t)p) == HAL_OK &&
+                 analogSensor_startCapture(ADC_BENCH_QUALITY_CHANNEL, NULL,
+                                           NULL) == HAL_OK;
+    const uint32_t start = HAL_GetTick();
+    if (ok) {
+      do {
+        capture = analogSensor_getCapture(&samples, &count);
+      } while (capture == HAL_BUSY &&
+               HAL_GetTick() - start < ADC_BENCH_COLLECT_TIMEOUT_MS);
+    }
+    ok = ok && capture == HAL_OK &&
+         dspQuality_analyse(samples, count, &q) == HAL_OK;
+    const uint32_t rate = analogSensor_getCaptureRate();
+    analogSensor_stopDMA();
+    if (!ok) {
+      status = HAL_ERROR;
+    }
+    int len = snprintf(line, sizeof(line),
+                       "BENCH quality profile=%lu ch=%u max_hz=%lu "
+                       "tone_hz=%lu amp=%lu",
+                       (unsigned long)p, ADC_BENCH_QUALITY_CHANNEL,
+                       (unsigned long)rate,
+                       (unsigned long)lroundf(q.tone * (float32_t)rate),
+                       (unsigned long)lroundf(q.amplitude));
+    len = adcBench_appendCenti(line, sizeof(line), len, "snr",
+                               (int32_t)lroundf(q.snr_db * 100.0f));
+    len = adcBench_appendCenti(line, sizeof(line), len, "sinad",
+                               (int32_t)lroundf(q.sinad_db * 100.0f));
+    len = adcBench_appendCenti(line, sizeof(line), len, "thd",
+                               (int32_t)lroundf(q.thd_db * 100.0f));
+    len = adcBench_appendCenti(line, sizeof(line), len, "sfdr",
+                               (int32_t)lroundf(q.sfdr_db * 100.0f));
+    len = adcBench_appendCenti(line, sizeof(line), len, "enob",
+                               (int32_t)lroundf(q.enob * 100.0f));
+    adcBench_sendLine(line, sizeof(line), len, ok);
+  }
+  if (adcBench_applyProfile(home) != HAL_OK) {
+    status = HAL_ERROR;
+  }
+  return status;
+}
+#endif
+
+/* Public functions ----------------------------------------------------------*/
+
+HAL_StatusTypeDef adcBench_run(void) {
+  const ClockProfile_Info_t *profile = clockProfile_getActive();
+  HAL_StatusTypeDef status = HAL_OK;
+  char line[96];
+
+  analogSensor_stopDMA();
+  snprintf(line, sizeof(line),
+           "BENCH begin profile=%u hclk=%lu adcclk=%lu rate=%u\r\n",
+           (unsigned)profile->id, (unsigned long)HAL_RCC_GetHCLKFreq(),
+           (unsigned long)profile->adcclk_hz, ADC_BENCH_FRAME_RATE_HZ);
+  adcBench_send(line);
+
+  // The DSP stages run on real conversions, taken once per report
+  uint8_t have_blocks = (adcBench_collect() == HAL_OK);
+
+  for (uint32_t i = 0; i < sizeof(scenarios) / sizeof(scenarios[0]); i++) {
+    ADC_BenchResult_t result = {0};
+    uint8_t needs_blocks = (i >= 4U);
+    if ((needs_blocks && !have_blocks) || scenarios[i].run(&result) != HAL_OK) {
+      snprintf(line, sizeof(line), "BENCH %s error\r\n", scenarios[i].name);
+      status = HAL_ERROR;
+    } else {
+      snprintf(line, sizeof(line),
+               "BENCH %s cyc_frame=%lu max_hz=%lu load_pct=%lu.%02lu "
+               "ram=%lu\r\n",
+               scenarios[i].name, (unsigned long)result.cycles_per_frame,
+               (unsigned long)result.max_rate_hz,
+               (unsigned long)(result.load_centi_pct / 100U),
+               (unsigned long)(result.load_centi_pct % 100U),
+               (unsigned long)result.ram_bytes);
+    }
+    adcBench_send(line);
+  }
+
+  // The same code over AXIM and the ITCM flash interface, ART / prefetch
+  if (adcBench_flashModes(have_blocks) != HAL_OK) {
+    status = HAL_ERROR;
+  }
+
+  // The scan, USART3 and a memory copy on the bus at once, per FIFO preset
+  if (adcBench_dmaContention() != HAL_OK) {
+    status = HAL_ERROR;
+  }
+  // CPU reads from each RAM bank beside the same DMA load
+  if (adcBench_sramBanks() != HAL_OK) {
+    status = HAL_ERROR;
+  }
+  // Copy bandwidth per region, by the CPU and by DMA, idle and loaded
+  if (adcBench_bandwidth() != HAL_OK) {
+    status = HAL_ERROR;
+  }
+
+  // Entry latency with and without FP context (irq_priority.h)
+  if (adcBench_interruptEntry() != HAL_OK) {
+    status = HAL_ERROR;
+  }
+
+#if DAC_LOOPBACK_ENABLE
+  // DAC1 into the test channel at every clock profile and sampling time
+  if (adcBench_loopback() != HAL_OK) {
+    status = HAL_ERROR;
+  }
+#endif
+#if ADC_BENCH_QUALITY_ENABLE
+  // An external tone through the interleaved capture at every clock profile
+  if (adcBench_quality() != HAL_OK) {
+    status = HAL_ERROR;
+  }
+#endif
+
+  snprintf(line, sizeof(line), "BENCH end status=%s\r\n",
+           (status == HAL_OK) ? "ok" : "error");
+  adcBench_send(line);
+  return status;
+}
+
+void adcBench_irqEntry(uint32_t stamp) {
+  if (bench_irq_use_fp) {
+    const uint32_t start = DWT->CYCCNT;
+    __asm volatile("vmov.f32 s0, s0");
+    bench_irq_fp_cycles = DWT->CYCCNT - start;
+  }
+  bench_irq_stamp = stamp;
+}
+
+void adcBench_main(void) {
+  for (;;) {
+    adcBench_run();
+    // Any byte on USART3 repeats the run (e.g. after a profile change)
+    while (!__HAL_UART_GET_FLAG(&huart3, UART_FLAG_RXNE)) {
+      if (__HAL_UART_GET_FLAG(&huart3, UART_FLAG_ORE)) {
+        __HAL_UART_CLEAR_OREFLAG(&huart3);
+      }
+      telemetry_poll();
+    }
+    (void)huart3.Instance->RDR;
+  }
+}
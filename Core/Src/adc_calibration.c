@@ -0,0 +1,250 @@
+/**
+ ******************************************************************************
+ * @file    adc_calibration.c
+ * @brief   Implementation of the calibration table and mg conversion
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "adc_calibration.h"
+#include "adc_sections.h"
+#include "crc_unit.h"
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define ADC_CAL_MAGIC 0x4C414341U // "ACAL"
+#define ADC_CAL_VERSION 1U
+#define ADC_CAL_FLASH_SECTOR FLASH_SECTOR_7
+
+/* Accumulator rounding for the q15 (1 mg) output */
+#define ADC_CAL_ROUND (1 << (ADC_CAL_MATRIX_FRAC_BITS - 1U))
+
+/* Private types -------------------------------------------------------------*/
+
+/* Flash record; programmed word by word */
+typedef struct {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t size; // sizeof(ADC_CalTable_t)
+  ADC_CalTable_t table;
+  uint32_t crc; // CRC-32 of the table
+} ADC_CalRecord_t;
+
+_Static_assert(ADC_CONVERSIONS_CHANNEL_COUNT % ADC_CAL_AXES == 0U,
+               "channels must form whole 3-axis groups");
+
+_Static_assert(sizeof(ADC_CalRecord_t) % sizeof(uint32_t) == 0U,
+               "calibration record must be whole flash words");
+
+/* External variables --------------------------------------------------------*/
+extern const uint32_t _scalib[]; // start of the CALIB region (linker script)
+
+/* Private variables ---------------------------------------------------------*/
+static ADC_CalTable_t cal_table;
+static ADC_CalSource_t cal_source = ADC_CAL_SOURCE_DEFAULT;
+
+/* Matrix rows packed for SMLAD: (M[i][0], M[i][1]) and (M[i][2], 0) */
+static uint32_t cal_coef01[ADC_CAL_GROUP_COUNT][ADC_CAL_AXES];
+static uint32_t cal_coef2[ADC_CAL_GROUP_COUNT][ADC_CAL_AXES];
+
+/* Private functions ---------------------------------------------------------*/
+
+static uint32_t adcCal_crc32(const uint8_t *data, uint32_t len) {
+  uint32_t crc = 0xFFFFFFFFU;
+#if CRC_UNIT_ENABLE
+  if (crcUnit_crc32(0, data, len, &crc) == HAL_OK) {
+    return crc;
+  }
+#endif
+  for (uint32_t i = 0; i < len; i++) {
+    crc ^= data[i];
+    for (uint8_t bit = 0; bit < 8U; bit++) {
+      crc = (crc & 1U) ? (crc >> 1) ^ 0xEDB88320U : crc >> 1;
+    }
+  }
+  return ~crc;
+}
+
+static void adcCal_setDefaults(ADC_CalTable_t *table) {
+  memset(table, 0, sizeof(*table));
+  int16_t gain = adcCal_gainToQ15(ADC_CAL_NOMINAL_MG_PER_CODE);
+  for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+    table->offset[ch] = ADC_CAL_NOMINAL_OFFSET;
+  }
+  for (uint8_t g = 0; g < ADC_CAL_GROUP_COUNT; g++) {
+    for (uint8_t i = 0; i < ADC_CAL_AXES; i++) {
+      table->matrix[g][i][i] = gain;
+    }
+  }
+}
+
+/**
+ * @brief Rebuild the packed SMLAD operands from cal_table
+ */
+static void adcCal_pack(void) {
+  for (uint8_t g = 0; g < ADC_CAL_GROUP_COUNT; g++) {
+    for (uint8_t i = 0; i < ADC_CAL_AXES; i++) {
+      const int16_t *row = cal_table.matrix[g][i];
+      cal_coef01[g][i] = (uint16_t)row[0] | ((uint32_t)(uint16_t)row[1] << 16);
+      cal_coef2[g][i] = (uint16_t)row[2];
+    }
+  }
+}
+
+/**
+ * @brief Offset-corrected codes of one frame, in channel order
+ */
+static inline void adcCal_centre(const uint16_t *frame, const uint8_t *slot_of,
+                                 int32_t *x) {
+  for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+    x[ch] = (int32_t)frame[slot_of[ch]] - cal_table.offset[ch];
+  }
+}
+
+static void adcCal_slotMap(const uint8_t *channel_map, uint8_t *slot_of) {
+  for (uint8_t s = 0; s < ADC_CONVERSIONS_CHANNEL_COUNT; s++) {
+    slot_of[(channel_map != NULL) ? channel_map[s] : s] = s;
+  }
+}
+
+/* Public functions ----------------------------------------------------------*/
+
+ADC_CalSource_t adcCal_init(void) {
+  const ADC_CalRecord_t *rec = (const ADC_CalRecord_t *)_scalib;
+
+  if (rec->magic == ADC_CAL_MAGIC && rec->version == ADC_CAL_VERSION &&
+      rec->size == sizeof(ADC_CalTable_t) &&
+      rec->crc == adcCal_crc32((const uint8_t *)&rec->table,
+                               sizeof(rec->table))) {
+    cal_table = rec->table;
+    cal_source = ADC_CAL_SOURCE_FLASH;
+  } else {
+    adcCal_setDefaults(&cal_table);
+    cal_source = ADC_CAL_SOURCE_DEFAULT;
+  }
+  adcCal_pack();
+  return cal_source;
+}
+
+const ADC_CalTable_t *adcCal_getTable(void) { return &cal_table; }
+
+ADC_CalSource_t adcCal_getSource(void) { return cal_source; }
+
+HAL_StatusTypeDef adcCal_setTable(const ADC_CalTable_t *table) {
+  if (table == NULL) {
+    return HAL_ERROR;
+  }
+  cal_table = *table;
+  cal_source = ADC_CAL_SOURCE_RUNTIME;
+  adcCal_pack();
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef adcCal_save(void) {
+  ADC_CalRecord_t rec = {.magic = ADC_CAL_MAGIC,
+                         .version = ADC_CAL_VERSION,
+                         .size = sizeof(ADC_CalTable_t),
+                         .table = cal_table};
+  rec.crc = adcCal_crc32((const uint8_t *)&rec.table, sizeof(rec.table));
+
+  FLASH_EraseInitTypeDef erase = {.TypeErase = FLASH_TYPEERASE_SECTORS,
+                                  .Sector = ADC_CAL_FLASH_SECTOR,
+                                  .NbSectors = 1,
+                                  .VoltageRange = FLASH_VOLTAGE_RANGE_3};
+  uint32_t sector_error = 0;
+  HAL_StatusTypeDef status = HAL_FLASH_Unlock();
+  if (status == HAL_OK) {
+    status = HAL_FLASHEx_Erase(&erase, &sector_error);
+  }
+
+  uint32_t words[sizeof(rec) / sizeof(uint32_t)];
+  memcpy(words, &rec, sizeof(rec));
+  for (uint32_t i = 0; status == HAL_OK && i < sizeof(rec) / sizeof(uint32_t);
+       i++) {
+    status = HAL_FLASH_Program(FLASH_TYPEPROGRAM_WORD,
+                               (uint32_t)&_scalib[i], words[i]);
+  }
+  HAL_FLASH_Lock();
+
+  // The D-cache may still hold the erased sector's old contents
+  SCB_InvalidateDCache_by_Addr((uint32_t *)_scalib,
+                               (sizeof(rec) + ADC_DCACHE_LINE_SIZE - 1U) &
+                                   ~(ADC_DCACHE_LINE_SIZE - 1U));
+
+  if (status != HAL_OK || memcmp(_scalib, &rec, sizeof(rec)) != 0) {
+    return HAL_ERROR;
+  }
+  cal_source = ADC_CAL_SOURCE_FLASH;
+  return HAL_OK;
+}
+
+int16_t adcCal_gainToQ15(float mg_per_code) {
+  float q = mg_per_code * (float)(1U << ADC_CAL_MATRIX_FRAC_BITS);
+  q += (q >= 0.0f) ? 0.5f : -0.5f;
+  if (q > 32767.0f) {
+    return INT16_MAX;
+  }
+  if (q < -32768.0f) {
+    return INT16_MIN;
+  }
+  return (int16_t)q;
+}
+
+ADC_FAST_CODE void adcCal_convertBlock_q15(const uint16_t *block,
+                                           uint32_t frames,
+                                           const uint8_t *channel_map,
+                                           int16_t *out) {
+  if (block == NULL || out == NULL) {
+    return;
+  }
+
+  uint8_t slot_of[ADC_CONVERSIONS_CHANNEL_COUNT];
+  adcCal_slotMap(channel_map, slot_of);
+
+  for (uint32_t f = 0; f < frames; f++) {
+    int32_t x[ADC_CONVERSIONS_CHANNEL_COUNT];
+    adcCal_centre(&block[f * ADC_CONVERSIONS_CHANNEL_COUNT], slot_of, x);
+
+    for (uint8_t g = 0; g < ADC_CAL_GROUP_COUNT; g++) {
+      const int32_t *xg = &x[g * ADC_CAL_AXES];
+      uint32_t x01 = __PKHBT(xg[0], xg[1], 16);
+      uint32_t x2 = (uint16_t)xg[2];
+      for (uint8_t i = 0; i < ADC_CAL_AXES; i++) {
+        int32_t acc = (int32_t)__SMLAD(
+            x01, cal_coef01[g][i],
+            __SMLAD(x2, cal_coef2[g][i], (uint32_t)ADC_CAL_ROUND));
+        *out++ = (int16_t)__SSAT(acc >> ADC_CAL_MATRIX_FRAC_BITS, 16);
+      }
+    }
+  }
+}
+
+ADC_FAST_CODE void adcCal_convertBlock_q31(const uint16_t *block,
+                                           uint32_t frames,
+                                           const uint8_t *channel_map,
+                                           int32_t *out) {
+  if (block == NULL || out == NULL) {
+    return;
+  }
+
+  uint8_t slot_of[ADC_CONVERSIONS_CHANNEL_COUNT];
+  adcCal_slotMap(channel_map, slot_of);
+
+  for (uint32_t f = 0; f < frames; f++) {
+    int32_t x[ADC_CONVERSIONS_CHANNEL_COUNT];
+    adcCal_centre(&block[f * ADC_CONVERSIONS_CHANNEL_COUNT], slot_of, x);
+
+    for (uint8_t g = 0; g < ADC_CAL_GROUP_COUNT; g++) {
+      const int32_t *xg = &x[g * ADC_CAL_AXES];
+      uint32_t x01 = __PKHBT(xg[0], xg[1], 16);
+      uint32_t x2 = (uint16_t)xg[2];
+      for (uint8_t i = 0; i < ADC_CAL_AXES; i++) {
+        int32_t acc = (int32_t)__SMLAD(x01, cal_coef01[g][i],
+                                       __SMLAD(x2, cal_coef2[g][i], 0U));
+        // mg x 2^13 -> mg x 2^16, saturated at +-32768 mg
+        *out++ = __SSAT(acc, 29) * 8;
+      }
+    }
+  }
+}
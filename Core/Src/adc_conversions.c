@@ -9,19 +9,158 @@
 
 #include "adc_conversions.h"
 #include "adc.h"
+#include "adc_ring.h"
+#include "adc_sections.h"
+#include "block_pool.h"
+#include "dma_tuning.h"
+#include "dsp_stats.h"
+#include "dwt_profiler.h"
+#include "event_log.h"
 #include "main.h"
+#include "retained.h"
+#include "stm32f7xx_ll_adc.h"
+#include "tim.h"
+#include "timebase.h"
+#include <string.h>
 
 /* Private defines -----------------------------------------------------------*/
+/* Injected reads only: their JEOC ISR can wait behind DMA block callbacks,
+ * so the bound stays in HAL_GetTick() ms */
 #define ADC_POLL_TIMEOUT_MS 10
 
+/* Bits of a code in the common sample format */
+#define ADC_SAMPLE_BITS 12U
+
+/* Shock capture: 3 + 12 cycles per conversion, staggered by 5 cycles, so
+ * each ADC restarts exactly when its turn comes round again */
+#define ADC_CAPTURE_PRESCALER ADC_CLOCK_SYNC_PCLK_DIV4
+#define ADC_CAPTURE_SAMPLETIME ADC_SAMPLETIME_3CYCLES
+#define ADC_CAPTURE_DELAY ADC_TWOSAMPLINGDELAY_5CYCLES
+#define ADC_CAPTURE_DELAY_CYCLES 5U
+#define ADC_MAX_CODE 4095U
+#define ADC_CLIP_PAIRS ((ADC_CONVERSIONS_CHANNEL_COUNT + 1U) / 2U)
+#define ADC_CLIP_ONES 0x00010001U // one count in each lane of a slot pair
+#define ADC_CLIP_MIDSCALE 0x0800U // empty lane of an odd last pair
+#define ADC_WATCHDOG_NONE 0xFFU    // no channel guarded by an ADC
+#define ADC_SAMPLING_STALE 0xFFU   // sConfig[] sampling times to be derived
+
+/* Temperature sensor and VREFINT need 10 us of sampling: 16.6 us at the
+ * 6.75 MHz scan ADCCLK */
+#define ADC_INTERNAL_SAMPLETIME ADC_SAMPLETIME_112CYCLES
+
+/* Overrun recovery: EN reads while the stream finishes its current beat */
+#define ADC_DMA_STOP_SPINS 64U
+#define ADC_FRAME_ALL_CHANNELS ADC_CHANNELS_MASK_ALL
+
+/* Default sequence weight of each channel */
+#define ADC_SEQUENCE_X_ONE(name, channel, ohms, bits, adcs, slot) 1U,
+
+/* Sampling-time model of the F7 datasheet (ADC characteristics):
+ *   R_AIN <= (k - 0.5) / (f_ADC * C_ADC * ln(2^(N + 2))) - R_ADC */
+#define ADC_R_ADC_OHMS 6000.0f      // sampling switch, max
+#define ADC_C_ADC_FARADS 4.0e-12f   // sample-and-hold capacitor
+#define ADC_R_AIN_MAX_OHMS 50000U   // datasheet limit of the formula
+#define ADC_ACCURACY_MIN_BITS 6U
+#define ADC_ACCURACY_MAX_BITS 12U
+#define ADC_LN2 0.693147f
+#define ADC_CLOCK_MAX_HZ 36000000U  // f_ADC limit at VDDA 2.4-3.6 V
+
+/* Channel table expanders: DMA slot order of the triple scan, pin wiring */
+#define ADC_CHANNELS_X_SLOT(name, channel, ohms, bits, adcs, slot)             \
+  [(slot)] = ADC_CH_##name,
+#define ADC_CHANNELS_X_ADCS(name, channel, ohms, bits, adcs, slot) (adcs),
+
+/* Compile-time checks of ADC_CHANNELS_TABLE() */
+#define ADC_CHANNELS_X_PROFILE_OK(name, channel, ohms, bits, adcs, slot)     \
+  &&((ohms) <= ADC_R_AIN_MAX_OHMS && (bits) >= ADC_ACCURACY_MIN_BITS &&      \
+     (bits) <= ADC_ACCURACY_MAX_BITS)
+#define ADC_CHANNELS_X_SLOT_BIT(name, channel, ohms, bits, adcs, slot)         \
+  | (1UL << (slot))
+#define ADC_CHANNELS_X_SLOT_WIRED(name, channel, ohms, bits, adcs, slot)       \
+  &&(((adcs) >> ((slot) % 3U)) & 1U)
+#define ADC_CHANNELS_X_PIN_OK(name, channel, ohms, bits, adcs, slot)         \
+  &&((adcs) == ADC_CHANNELS_ADC123                                           \
+         ? ((channel) <= 3U || ((channel) >= 10U && (channel) <= 13U))       \
+     : (adcs) == ADC_CHANNELS_ADC12 ? ((channel) <= 15U)                     \
+     : (adcs) == ADC_CHANNELS_ADC3                                           \
+         ? (((channel) >= 4U && (channel) <= 9U) || (channel) == 14U ||      \
+            (channel) == 15U)                                                \
+         : 0)
+
+/* Layouts the table can run: independent and dual take it in table order
+ * on ADC1 (and ADC2), triple follows triple_slot; 16 ranks per ADC */
+#define ADC_MAX_RANKS 16U
+#define ADC_SQR3_RANKS 6U // ranks 1-6; the register images cover only these
+#define ADC_LAYOUT_INDEPENDENT_OK                                            \
+  (ADC_CHANNELS_ALL_ADC12 && ADC_CONVERSIONS_CHANNEL_COUNT <= ADC_MAX_RANKS)
+#define ADC_LAYOUT_DUAL_OK                                                   \
+  (ADC_CHANNELS_ALL_ADC12 && ADC_CONVERSIONS_CHANNEL_COUNT % 2U == 0U &&     \
+   ADC_CONVERSIONS_CHANNEL_COUNT / 2U <= ADC_MAX_RANKS)
+#define ADC_LAYOUT_TRIPLE_OK                                                 \
+  (ADC_CONVERSIONS_CHANNEL_COUNT % 3U == 0U &&                               \
+   ADC_CONVERSIONS_CHANNEL_COUNT / 3U <= ADC_MAX_RANKS)
+#define ADC_LAYOUT_DEFAULT                                                   \
+  (ADC_LAYOUT_INDEPENDENT_OK ? ADC_MULTI_INDEPENDENT                         \
+   : ADC_LAYOUT_DUAL_OK      ? ADC_MULTI_DUAL_SIMULT                         \
+                             : ADC_MULTI_TRIPLE_SIMULT)
+
+/* Ranks MX_ADC1_Init() programs: the table order, up to 16 */
+#define ADC_POLL_RANKS                                                       \
+  ((ADC_CONVERSIONS_CHANNEL_COUNT < ADC_MAX_RANKS)                           \
+       ? ADC_CONVERSIONS_CHANNEL_COUNT                                       \
+       : ADC_MAX_RANKS)
+
+_Static_assert(ADC_CONVERSIONS_CHANNEL_COUNT >= 1 &&
+                   ADC_CONVERSIONS_CHANNEL_COUNT <= ADC_CHANNELS_MAX,
+               "the F746 has ADC_CHANNELS_MAX external inputs");
+_Static_assert(1 ADC_CHANNELS_TABLE(ADC_CHANNELS_X_PIN_OK),
+               "adcs does not match the pin of adc_channel");
+_Static_assert((0UL ADC_CHANNELS_TABLE(ADC_CHANNELS_X_SLOT_BIT)) ==
+                   (1UL << ADC_CONVERSIONS_CHANNEL_COUNT) - 1UL,
+               "triple_slot must number the channels 0..count-1 once each");
+_Static_assert(!ADC_LAYOUT_TRIPLE_OK ||
+                   (1 ADC_CHANNELS_TABLE(ADC_CHANNELS_X_SLOT_WIRED)),
+               "a triple_slot falls on an ADC not wired to the channel");
+_Static_assert(1 ADC_CHANNELS_TABLE(ADC_CHANNELS_X_PROFILE_OK),
+               "source_ohms above 50 kOhm or accuracy_bits outside 6..12");
+_Static_assert(ADC_LAYOUT_INDEPENDENT_OK || ADC_LAYOUT_DUAL_OK ||
+                   ADC_LAYOUT_TRIPLE_OK,
+               "no scan layout fits: ADC3-only pins or more than 16 "
+               "channels need a multiple of 3 channels");
+
+_Static_assert((ADC_CONVERSIONS_CAPTURE_SAMPLES * sizeof(uint16_t)) %
+                       ADC_DCACHE_LINE_SIZE ==
+                   0U,
+               "capture buffer must be a multiple of the D-cache line size");
+
+_Static_assert(ADC_CONVERSIONS_SEQUENCE_SCANS % 16U == 0U,
+               "sequence halves must span whole D-cache lines");
+
+_Static_assert((2U * ADC_GROUP_MAX_SIZE * sizeof(uint16_t)) %
+                       ADC_DCACHE_LINE_SIZE ==
+                   0U,
+               "the group buffer must span whole D-cache lines");
+
+/* DMA buffers are aligned and sized to the D-cache line so a per-block
+ * invalidate never touches unrelated data */
+_Static_assert((ADC_CONVERSIONS_BLOCK_SAMPLES * sizeof(uint16_t)) %
+                       ADC_DCACHE_LINE_SIZE ==
+                   0U,
+               "ADC block size must be a multiple of the D-cache line size");
+
 /* External variables --------------------------------------------------------*/
 extern ADC_HandleTypeDef hadc1;
+extern ADC_HandleTypeDef hadc2;
+extern ADC_HandleTypeDef hadc3;
 
+#if ADC_CONVERSIONS_LEGACY_VIEW
 /* ADC sample storage (definition shared via adc_conversions.h) */
 volatile uint32_t raw_LISXXXALH[ADC_CONVERSIONS_CHANNEL_COUNT] = {0};
+#endif
 
 /* Private types -------------------------------------------------------------*/
 
+#if ADC_CONVERSIONS_LEGACY_VIEW
 /* Error markers for raw_LISXXXALH[] array (values > 4095) */
 typedef enum {
   ADC_ERROR_INVALID_CHANNEL = 0xFFFF,
@@ -30,160 +169,4144 @@ typedef enum {
   ADC_ERROR_TIMEOUT = 0xFFFC
 } ADC_ErrorTypeDef;
 
+/* ADC_SampleError_t -> legacy sentinel */
+static const uint16_t legacy_sentinel[] = {
+    [ADC_SAMPLE_OK] = 0,
+    [ADC_SAMPLE_ERROR_CONFIG] = ADC_ERROR_CONFIG,
+    [ADC_SAMPLE_ERROR_START] = ADC_ERROR_START,
+    [ADC_SAMPLE_ERROR_TIMEOUT] = ADC_ERROR_TIMEOUT};
+#endif
+
+/* ADC_SampleError_t -> error matrix column */
+static const ADC_ErrorKind_t sample_error_kind[] = {
+    [ADC_SAMPLE_ERROR_CONFIG] = ADC_ERROR_KIND_CONFIG,
+    [ADC_SAMPLE_ERROR_START] = ADC_ERROR_KIND_START,
+    [ADC_SAMPLE_ERROR_TIMEOUT] = ADC_ERROR_KIND_TIMEOUT,
+    [ADC_SAMPLE_ERROR_OVERRUN] = ADC_ERROR_KIND_OVERRUN};
+
 /* Private variables ---------------------------------------------------------*/
 
-/* Error tracking */
-static ADC_ErrorInfo_t adc_errors = {.total_errors = 0,
-                                     .last_error_status = HAL_OK,
-                                     .last_failed_channel = 0xFF};
+/* Active acquisition mode (written from thread context only) */
+static volatile ADC_AcqMode_t acq_mode = ADC_ACQ_MODE_POLLING;
 
-// if using STM32F7 series, uncomment the following line
-#define STM32F7xx_HAL_ADC_H // <<-- uncomment this line
-#ifdef STM32F7xx_HAL_ADC_H
-/* ADC channel configurations for STM32F756 (the MCU was tested with) */
-static ADC_ChannelConfTypeDef sConfig[ADC_CONVERSIONS_CHANNEL_COUNT] = {
-    {.Channel = ADC_CHANNEL_0,
-     .Rank = ADC_REGULAR_RANK_1,
-     .SamplingTime = ADC_SAMPLETIME_15CYCLES,
-     .Offset = 0},
-    {.Channel = ADC_CHANNEL_1,
-     .Rank = ADC_REGULAR_RANK_1,
-     .SamplingTime = ADC_SAMPLETIME_15CYCLES,
-     .Offset = 0},
-    {.Channel = ADC_CHANNEL_2,
-     .Rank = ADC_REGULAR_RANK_1,
-     .SamplingTime = ADC_SAMPLETIME_15CYCLES,
-     .Offset = 0},
-    {.Channel = ADC_CHANNEL_3,
-     .Rank = ADC_REGULAR_RANK_1,
-     .SamplingTime = ADC_SAMPLETIME_15CYCLES,
-     .Offset = 0},
-    {.Channel = ADC_CHANNEL_4,
-     .Rank = ADC_REGULAR_RANK_1,
-     .SamplingTime = ADC_SAMPLETIME_15CYCLES,
-     .Offset = 0},
-    {.Channel = ADC_CHANNEL_5,
-     .Rank = ADC_REGULAR_RANK_1,
-     .SamplingTime = ADC_SAMPLETIME_15CYCLES,
-     .Offset = 0}};
-#endif // STM32F7xx_HAL_ADC_H
-
-/* for STM32H7 series (per the original code) uncomment the following line */
-// #define STM32H7xx_HAL_ADC_H // <<-- uncomment this line
-#ifdef STM32H7xx_HAL_ADC_H
-/* ADC channel configurations for STM32H743 (for reference) */  
+/* Frame rate produced by TIM2 after period rounding, or given with an
+ * external scan trigger */
+static uint32_t sample_rate_hz = 0;
+
+/* Scan trigger of the timer-paced mode (changed while stopped only) */
+static ADC_ScanTrigger_t scan_trigger = ADC_SCAN_TRIGGER_TIM2;
+static const uint32_t scan_trigger_conv[] = {
+    [ADC_SCAN_TRIGGER_TIM2] = ADC_EXTERNALTRIGCONV_T2_TRGO,
+    [ADC_SCAN_TRIGGER_TIM1_TRGO2] = ADC_EXTERNALTRIGCONV_T1_TRGO2,
+    [ADC_SCAN_TRIGGER_TIM8_TRGO2] = ADC_EXTERNALTRIGCONV_T8_TRGO2};
+
+/* Frames and samples per block of the ping-pong, pool and replay blocks,
+ * changed while stopped only; shorter blocks sit at the start of the
+ * buffer */
+static uint32_t block_frames = ADC_CONVERSIONS_BLOCK_FRAMES;
+static uint32_t block_samples = ADC_CONVERSIONS_BLOCK_SAMPLES;
+
+/* Ping-pong DMA buffer: block 0 = first half, block 1 = second half.
+ * Written by DMA behind the D-cache, so each block is invalidated before the
+ * CPU reads it. */
+static uint16_t adc_dma_buffer[2 * ADC_CONVERSIONS_BLOCK_SAMPLES]
+    ADC_SRAM1_BSS ADC_DMA_ALIGNED;
+
+/* Block pool mode: the DMA fills pool blocks in double-buffer mode (M0/M1).
+ * A NULL target means that half of adc_dma_buffer, used while the pool is
+ * exhausted. */
+static uint8_t pool_enabled = 0;
+static uint8_t pool_active = 0; // the running scan uses the pool
+static uint8_t pool_ready = 0;  // blockPool_init() done, at the first enable
+static BlockPool_Block_t *pool_target[2] = {NULL, NULL};
+static uint32_t pool_starved = 0;
+
+/* Replay mode: blocks filled by the main loop from a recording and handed
+ * off from the DMA vector. replay_data is set while a hand-off is pending;
+ * until it is cleared the pending block belongs to the interrupt. */
+static ADC_ReplaySource_t replay_source = NULL;
+static void *replay_ctx = NULL;
+static uint64_t replay_period = 0; // timebase ticks per block, 0 = back to back
+static uint64_t replay_due = 0;
+static uint64_t replay_first = 0;
+static uint8_t replay_half = 0;
+static uint16_t *replay_fill = NULL;            // filled, not yet pended
+static BlockPool_Block_t *replay_block = NULL;  // its pool block, if any
+static const uint16_t *volatile replay_data = NULL;
+static ADC_ReplayStats_t replay_stats;
+
+/* Block hand-off state */
+static ADC_BlockCallback_t block_callback = NULL;
+static void *block_callback_ctx = NULL;
+static ADC_BlockFilter_t block_filter = NULL;
+static void *block_filter_ctx = NULL;
+static ADC_RangeHook_t range_hook = NULL;
+static void *range_hook_ctx = NULL;
+static volatile uint32_t blocks_completed = 0; // written by the DMA ISR
+static const uint16_t *volatile newest_block = NULL;
+static uint32_t blocks_consumed = 0;           // written by the consumer
+static uint32_t blocks_dropped = 0;
+
+/* Block subscribers: a slot is filled before active is set and emptied by
+ * clearing active first, so the dispatching context never sees it torn */
+typedef struct {
+  ADC_SubscriberCallback_t callback;
+  void *ctx;
+  uint32_t every_n_blocks;
+  uint32_t countdown; // blocks to the next call, dispatching context
+  ADC_ChannelMask_t channel_mask;
+  volatile uint8_t active;
+} ADC_Subscriber_t;
+static ADC_Subscriber_t subscribers[ADC_CONVERSIONS_MAX_SUBSCRIBERS];
+
+/* Sequence number of the next frame queued to the ring */
+static uint32_t frame_sequence = 0;
+
+/* Configuration staged for the running scan, swapped in by the DMA ISR:
+ * the new sampling times and the SMPR bits they replace on each scan ADC
+ * are worked out when staging, so the swap is register stores only */
+typedef struct {
+  ADC_ScanConfig_t cfg;
+  uint32_t sampling_time[ADC_CONVERSIONS_CHANNEL_COUNT];
+  uint32_t smpr1_mask[3];
+  uint32_t smpr1[3];
+  uint32_t smpr2_mask[3];
+  uint32_t smpr2[3];
+} ADC_StagedConfig_t;
+static ADC_StagedConfig_t staged;
+static volatile uint8_t staged_pending = 0;
+static uint8_t staged_mark = 0;      // flag the next block's first frame
+static uint8_t staged_mark_rate = 0; // ... and restart the timing estimate
+
+/* Block timestamps, written by the DMA ISR: the newest block, the first one
+ * since the start and the extremes of the block-to-block interval */
+static ADC_BlockInfo_t last_block = {0};
+static uint32_t timing_blocks = 0;
+static uint32_t timing_first_frame = 0;
+static uint64_t timing_first_timestamp = 0;
+static uint32_t interval_min = 0;
+static uint32_t interval_max = 0;
+
+/* Overrun recovery, DMA ISR / ADC ISR context: the block (half or target)
+ * the DMA completes next, the single pass realigning a block after a
+ * restart inside it, and the flagged frames of that block */
+static uint8_t dma_next_block = 0;
+static uint8_t resync_active = 0;
+static uint8_t resync_block = 0;
+static const uint16_t *gap_block = NULL;
+static uint32_t gap_first = 0;
+static uint32_t gap_end = 0;
+static ADC_OverrunInfo_t overrun_info = {0};
+
+/* Multimode layout selected for the next DMA start */
+static ADC_Multimode_t multimode = ADC_LAYOUT_DEFAULT;
+
+/* Layouts the channel table can run */
+static const uint8_t layout_ok[] = {
+    [ADC_MULTI_INDEPENDENT] = ADC_LAYOUT_INDEPENDENT_OK,
+    [ADC_MULTI_DUAL_SIMULT] = ADC_LAYOUT_DUAL_OK,
+    [ADC_MULTI_TRIPLE_SIMULT] = ADC_LAYOUT_TRIPLE_OK};
+
+/* ADCs per layout; ADC k converts scan_order[r * count + k] at rank r+1, so
+ * scan_order[] is also the channel order DMA mode 1 writes to memory */
+static ADC_HandleTypeDef *const scan_adcs[] = {&hadc1, &hadc2, &hadc3};
+static const uint8_t scan_adc_count[] = {
+    [ADC_MULTI_INDEPENDENT] = 1,
+    [ADC_MULTI_DUAL_SIMULT] = 2,
+    [ADC_MULTI_TRIPLE_SIMULT] = 3};
+static const uint8_t scan_order[][ADC_CONVERSIONS_CHANNEL_COUNT] = {
+    [ADC_MULTI_INDEPENDENT] = {ADC_CHANNELS_TABLE(ADC_CHANNELS_X_ID)},
+    [ADC_MULTI_DUAL_SIMULT] = {ADC_CHANNELS_TABLE(ADC_CHANNELS_X_ID)},
+    [ADC_MULTI_TRIPLE_SIMULT] = {ADC_CHANNELS_TABLE(ADC_CHANNELS_X_SLOT)}};
+
+/* ADCs wired to each channel's pin */
+static const uint8_t channel_adcs[ADC_CONVERSIONS_CHANNEL_COUNT] = {
+    ADC_CHANNELS_TABLE(ADC_CHANNELS_X_ADCS)};
+
+/* Shock capture target, filled once per capture by 32-bit DMA (mode 2) */
+static uint16_t capture_buffer[ADC_CONVERSIONS_CAPTURE_SAMPLES]
+    ADC_SRAM1_BSS ADC_DMA_ALIGNED;
+/* Buffer the capture running fills: capture_buffer, or a burst's region */
+static uint16_t *capture_target = capture_buffer;
+static uint32_t capture_samples = ADC_CONVERSIONS_CAPTURE_SAMPLES;
+static ADC_CaptureCallback_t capture_callback = NULL;
+static void *capture_callback_ctx = NULL;
+static volatile uint8_t capture_done = 0;
+static uint32_t scan_prescaler = 0; // ADCCLK prescaler to restore
+
+/* Capture switched in at a block boundary of the timed scan: the channel
+ * asked for (+ 1, 0 = none), the capture running in place of the scan, its
+ * buffer readable with the scan back, and the first block back to flag */
+static volatile uint8_t switch_request = 0;
+static volatile uint8_t switch_active = 0;
+static uint8_t capture_switched = 0;
+static uint8_t switch_mark = 0;
+static ADC_SwitchInfo_t switch_info = {0};
+
+/* Weighted sequence (ADC1 alone), default every channel once; its scans
+ * land in their own circular buffer sized for 16 ranks. Tables the
+ * independent layout cannot run start without one. */
+#if ADC_LAYOUT_INDEPENDENT_OK
+static ADC_ScanSequence_t sequence = {
+    .ranks = ADC_CONVERSIONS_CHANNEL_COUNT,
+    .mask = ADC_FRAME_ALL_CHANNELS,
+    .weight = {ADC_CHANNELS_TABLE(ADC_SEQUENCE_X_ONE)},
+    .channel = {ADC_CHANNELS_TABLE(ADC_CHANNELS_X_ID)}};
+#else
+static ADC_ScanSequence_t sequence = {0};
+#endif
+static uint16_t sequence_buffer[2U * ADC_CONVERSIONS_SEQUENCE_SCANS *
+                                ADC_SEQUENCE_MAX_RANKS]
+    ADC_SRAM1_BSS ADC_DMA_ALIGNED;
+static ADC_SequenceCallback_t sequence_callback = NULL;
+static void *sequence_callback_ctx = NULL;
+static uint32_t sequence_scans = 0; // scans handed off since the start
+
+/* Grouped scan (ADC1 alone): two groups of DMA buffer, so the half and full
+ * transfer interrupts each end one group */
+static uint16_t group_buffer[2U * ADC_GROUP_MAX_SIZE]
+    ADC_SRAM1_BSS ADC_DMA_ALIGNED;
+static ADC_GroupCallback_t group_callback = NULL;
+static void *group_callback_ctx = NULL;
+static uint8_t group_len = 0;     // channels per group
+static uint8_t group_count = 0;
+static uint8_t group_next = 0;    // group the next hand-off ends
+static uint32_t group_frames = 0; // frames completed since the start
+
+/* DMA slot -> channel map of the running scan (read by the DMA ISR) */
+static const uint8_t *active_order = scan_order[ADC_LAYOUT_DEFAULT];
+
+/* Streaming statistics in channel order, extended by the DMA ISR */
+static DSP_StatsAccum_t channel_stats[ADC_CONVERSIONS_CHANNEL_COUNT];
+
+/* Saturation counters in channel order, and the clipped lanes of the newest
+ * frame per slot pair (episode edges), written by the DMA ISR */
+static uint32_t clip_samples[ADC_CONVERSIONS_CHANNEL_COUNT];
+static uint32_t clip_episodes[ADC_CONVERSIONS_CHANNEL_COUNT];
+static uint32_t clip_lanes[ADC_CLIP_PAIRS];
+
+_Static_assert(ADC_CONVERSIONS_BLOCK_FRAMES <= 0xFFFFU,
+               "the per-lane clip counts of a block must fit 16 bits");
+_Static_assert(ADC_CLIP_LOW_CODE < ADC_CLIP_HIGH_CODE &&
+                   ADC_CLIP_HIGH_CODE <= ADC_MAX_CODE,
+               "the clip codes must be inside the 12-bit range");
+
+/* Analog watchdog windows per channel, and the channel each ADC guards */
+static uint8_t watchdog_enabled[ADC_CONVERSIONS_CHANNEL_COUNT];
+static uint16_t watchdog_low[ADC_CONVERSIONS_CHANNEL_COUNT];
+static uint16_t watchdog_high[ADC_CONVERSIONS_CHANNEL_COUNT];
+static uint8_t watchdog_channel[3] = {ADC_WATCHDOG_NONE, ADC_WATCHDOG_NONE,
+                                      ADC_WATCHDOG_NONE};
+static ADC_WatchdogCallback_t watchdog_callback = NULL;
+static void *watchdog_callback_ctx = NULL;
+static volatile uint32_t watchdog_alarms = 0;
+
+/* Injected conversion in flight: requested channel and the ADC reporting it */
+static volatile uint8_t injected_busy = 0;
+static uint8_t injected_channel = 0;
+static ADC_HandleTypeDef *injected_adc = NULL;
+static volatile uint16_t injected_value = 0;
+static ADC_InjectedCallback_t injected_callback = NULL;
+static void *injected_callback_ctx = NULL;
+
+/* Scan DMA interrupt: the path taken and its cycles from the vector to the
+ * hand-off; dma_irq_stamped is set until the first half of a run is filed */
+static volatile uint8_t dma_fast_isr = ADC_CONVERSIONS_FAST_DMA_ISR;
+static uint8_t dma_irq_stamped = 0;
+static uint32_t dma_irq_entry = 0;
+static ADC_DmaDispatchStats_t dma_dispatch[ADC_DMA_DISPATCH_COUNT];
+
+/* Asynchronous requests: queued by analogSensor_operation_async(), taken at
+ * async_tail one at a time; the head is written with interrupts masked */
+typedef struct {
+  uint8_t channel;
+  ADC_AsyncCallback_t callback;
+  void *ctx;
+} ADC_AsyncRequest_t;
+
+static ADC_AsyncRequest_t async_queue[ADC_CONVERSIONS_ASYNC_DEPTH];
+static volatile uint32_t async_head = 0;
+static volatile uint32_t async_tail = 0;
+static volatile uint8_t async_active = 0;  // the tail request is in flight
+static volatile uint8_t async_regular = 0; // ... on ADC1's regular group
+static volatile uint8_t async_hold = 0;    // a blocking read owns the ADC
+static uint32_t async_started_ms = 0;
+
+/* q14 gain applied to each DMA block before hand-off */
+static volatile uint16_t block_gain = ADC_BLOCK_GAIN_UNITY;
+
+/* Resolution of each ADC (ADC_RESOLUTION_xB), restored after a capture */
+static uint32_t adc_resolution[] = {ADC_RESOLUTION_12B, ADC_RESOLUTION_12B,
+                                    ADC_RESOLUTION_12B};
+/* Bits of the scan blocks being handed off: replays are 12-bit already */
+static volatile uint8_t block_bits = ADC_SAMPLE_BITS;
+
+/* Per-channel HAL configuration, expanded from ADC_CHANNELS_TABLE(); the
+ * sampling times are set from channel_profile[] for the running ADCCLK */
+#define ADC_CHANNELS_X_CONF(name, channel, ohms, bits, adcs, slot)           \
+  {.Channel = (channel),                                                     \
+   .Rank = ADC_REGULAR_RANK_1,                                               \
+   .SamplingTime = ADC_SAMPLETIME_480CYCLES,                                 \
+   .Offset = 0},
 static ADC_ChannelConfTypeDef sConfig[ADC_CONVERSIONS_CHANNEL_COUNT] = {
-    {.channel = ADC_CHANNEL_0,
-      .Rank = ADC_REGULAR_RANK_1,
-      .SamplingTime = ADC_SAMPLETIME_5CYCLE,
-      .SingleDiff = ADC_SINGLE_ENDED,
-      .OffsetNumber = ADC_OFFSET_NONE,
-      .Offset = 0},
-      {.channel = ADC_CHANNEL_1,
-      .Rank = ADC_REGULAR_RANK_1,
-      .SamplingTime = ADC_SAMPLETIME_5CYCLE,
-      .SingleDiff = ADC_SINGLE_ENDED,
-      .OffsetNumber = ADC_OFFSET_NONE,
-      .Offset = 0},
-      {.channel = ADC_CHANNEL_2,
-      .Rank = ADC_REGULAR_RANK_1,
-      .SamplingTime = ADC_SAMPLETIME_5CYCLE,
-      .SingleDiff = ADC_SINGLE_ENDED,
-      .OffsetNumber = ADC_OFFSET_NONE,
-      .Offset = 0},
-      {.channel = ADC_CHANNEL_3,
-      .Rank = ADC_REGULAR_RANK_1,
-      .SamplingTime = ADC_SAMPLETIME_5CYCLE,
-      .SingleDiff = ADC_SINGLE_ENDED,
-      .OffsetNumber = ADC_OFFSET_NONE,
-      .Offset = 0},
-      {.channel = ADC_CHANNEL_4,
-      .Rank = ADC_REGULAR_RANK_1,
-      .SamplingTime = ADC_SAMPLETIME_5CYCLE,
-      .SingleDiff = ADC_SINGLE_ENDED,
-      .OffsetNumber = ADC_OFFSET_NONE,
-      .Offset = 0},
-      {.channel = ADC_CHANNEL_5,
-      .Rank = ADC_REGULAR_RANK_1,
-      .SamplingTime = ADC_SAMPLETIME_5CYCLE,
-      .SingleDiff = ADC_SINGLE_ENDED,
-      .OffsetNumber = ADC_OFFSET_NONE,
-      .Offset = 0},
-      {.channel = ADC_CHANNEL_6,
-      .Rank = ADC_REGULAR_RANK_1,
-      .SamplingTime = ADC_SAMPLETIME_5_CYCLES,
-      .SingleDiff = ADC_SINGLE_ENDED,
-      .OffsetNumber = ADC_OFFSET_NONE,
-      .Offset = 0}
-    };
-#endif // STM32H7xx_HAL_ADC_H
-/* Public functions ----------------------------------------------------------*/
+    ADC_CHANNELS_TABLE(ADC_CHANNELS_X_CONF)};
 
-void analogSensor_operation(uint8_t snsrID) {
-  HAL_StatusTypeDef status;
+/* Default instance: ADC1 and sConfig[]. Its error matrix is written under
+ * error_seq (odd while an update is under way); frame is the newest packed
+ * frame; the newest complete frame is published under published_seq, by
+ * one writer at a time (the DMA ISR in the scans, the main loop when
+ * polling), so the writer needs no masking either. */
+static ADC_SensorCtx_t default_ctx = {
+    .hadc = &hadc1,
+    .channels = sConfig,
+    .channel_count = ADC_CONVERSIONS_CHANNEL_COUNT,
+    .errors = {.total_errors = 0,
+               .last_error_status = HAL_OK,
+               .last_failed_channel = 0xFF}};
 
-  if (snsrID >= ADC_CONVERSIONS_CHANNEL_COUNT) {
-    adc_errors.total_errors++;
-    adc_errors.last_error_status = HAL_ERROR;
-    adc_errors.last_failed_channel = snsrID;
-    return;
+#if !ADC_CHANNELS_ALL_ADC12
+/* ADC3-only pins are polled on ADC3, through the instance read on the
+ * same sConfig[]; results go to the default instance */
+static ADC_SensorCtx_t adc3_ctx = {
+    .hadc = &hadc3,
+    .channels = sConfig,
+    .channel_count = ADC_CONVERSIONS_CHANNEL_COUNT};
+#endif
+
+/* Source impedance and accuracy per channel */
+#define ADC_CHANNELS_X_PROFILE(name, channel, ohms, bits, adcs, slot)        \
+  {.source_ohms = (ohms), .accuracy_bits = (bits)},
+static ADC_ChannelProfile_t channel_profile[ADC_CONVERSIONS_CHANNEL_COUNT] = {
+    ADC_CHANNELS_TABLE(ADC_CHANNELS_X_PROFILE)};
+
+/* Selectable sampling times, shortest first */
+static const uint32_t sampling_times[] = {
+    ADC_SAMPLETIME_3CYCLES,   ADC_SAMPLETIME_15CYCLES,
+    ADC_SAMPLETIME_28CYCLES,  ADC_SAMPLETIME_56CYCLES,
+    ADC_SAMPLETIME_84CYCLES,  ADC_SAMPLETIME_112CYCLES,
+    ADC_SAMPLETIME_144CYCLES, ADC_SAMPLETIME_480CYCLES};
+#define ADC_SAMPLING_TIME_COUNT                                              \
+  (sizeof(sampling_times) / sizeof(sampling_times[0]))
+
+/* Layout sConfig[] sampling times were last derived for */
+static uint8_t sampling_layout = ADC_SAMPLING_STALE;
+
+/* Register images per polling channel: SQR3 with the channel at rank 1, and
+ * SMPR1/SMPR2 with every channel's sampling time (built on the first read) */
+static uint32_t sqr3_image[ADC_CONVERSIONS_CHANNEL_COUNT];
+static uint32_t smpr1_image = 0;
+static uint32_t smpr2_image = 0;
+static uint8_t register_images_ready = 0;
+
+/* Polling conversion times per channel and what was observed; the table
+ * is rebuilt when the profiles or SystemCoreClock change (0 = stale) */
+static ADC_ConvTiming_t conv_timing = {0};
+static uint32_t conv_timing_hclk = 0;
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+ * @brief Build the SQR3/SMPR images HAL_ADC_ConfigChannel() would produce
+ *
+ * Ranks 2..6 keep the scan order of MX_ADC1_Init(), as after the HAL path.
+ * SMPR bits of channels not in sConfig[] are taken over unchanged; the
+ * ADC3-only channels are read on ADC3 and left out.
+ */
+static void analogSensor_buildRegisterImages(void) {
+  uint32_t smpr1 = LL_ADC_ReadReg(ADC1, SMPR1);
+  uint32_t smpr2 = LL_ADC_ReadReg(ADC1, SMPR2);
+  uint32_t ranks = 0;
+
+  for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+    const uint32_t channel = sConfig[ch].Channel;
+    if ((channel_adcs[ch] & ADC_CHANNELS_ADC1) == 0U) {
+      continue;
+    }
+    if (channel > ADC_CHANNEL_9) {
+      smpr1 &= ~ADC_SMPR1(ADC_SMPR1_SMP10, channel);
+      smpr1 |= ADC_SMPR1(sConfig[ch].SamplingTime, channel);
+    } else {
+      smpr2 &= ~ADC_SMPR2(ADC_SMPR2_SMP0, channel);
+      smpr2 |= ADC_SMPR2(sConfig[ch].SamplingTime, channel);
+    }
+    if (ch != 0U && ch < ADC_SQR3_RANKS) {
+      ranks |= ADC_SQR3_RK(channel, ch + 1U);
+    }
   }
+  for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+    sqr3_image[ch] = ranks | ADC_SQR3_RK(sConfig[ch].Channel, 1U);
+  }
+  smpr1_image = smpr1;
+  smpr2_image = smpr2;
+  register_images_ready = 1;
+}
 
-  // using with static array to avoid runtime mutation issues and
-  // misconfigurations
-  status = HAL_ADC_ConfigChannel(&hadc1, &sConfig[snsrID]);
-  if (status != HAL_OK) {
-    adc_errors.total_errors++;
-    adc_errors.last_error_status = status;
-    adc_errors.last_failed_channel = snsrID;
-    raw_LISXXXALH[snsrID] = ADC_ERROR_CONFIG;
-    return;
+/**
+ * @brief Select a channel for the next polling conversion (two stores, a
+ *        third for tables using IN10-IN15)
+ */
+static inline void analogSensor_loadChannel(uint8_t ch) {
+  if (!register_images_ready) {
+    analogSensor_buildRegisterImages();
   }
+  if (ADC_CHANNELS_PINS_C != 0U) {
+    LL_ADC_WriteReg(ADC1, SMPR1, smpr1_image);
+  }
+  LL_ADC_WriteReg(ADC1, SMPR2, smpr2_image);
+  LL_ADC_WriteReg(ADC1, SQR3, sqr3_image[ch]);
+}
 
-  status = HAL_ADC_Start(&hadc1);
-  if (status != HAL_OK) {
-    raw_LISXXXALH[snsrID] = ADC_ERROR_START;
-    adc_errors.total_errors++;
-    adc_errors.last_error_status = status;
-    adc_errors.last_failed_channel = snsrID;
-    return;
+/**
+ * @brief Store a valid sample in the packed frame (and the legacy view)
+ */
+static void analogSensor_storeSample(uint8_t ch, uint16_t value) {
+  default_ctx.frame.samples[ch] = value;
+  default_ctx.frame.error_mask &= (ADC_ChannelMask_t)~(1UL << ch);
+#if ADC_CONVERSIONS_LEGACY_VIEW
+  raw_LISXXXALH[ch] = value;
+#endif
+}
+
+/**
+ * @brief Count one error against a channel of an instance (0xFF or out of
+ *        range: the scan)
+ *
+ * Writers in the main loop and in the ADC/DMA interrupts are serialised by a
+ * short masked section; readers only retry on error_seq.
+ */
+static void analogSensor_ctxCountError(ADC_SensorCtx_t *ctx, uint8_t ch,
+                                       ADC_ErrorKind_t kind,
+                                       HAL_StatusTypeDef status) {
+  const uint8_t row =
+      (ch < ADC_CONVERSIONS_CHANNEL_COUNT) ? ch : (uint8_t)ADC_ERROR_ROW_SCAN;
+
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  ctx->error_seq++;
+  __DMB();
+  ctx->errors.total_errors++;
+  const uint32_t count = ++ctx->errors.counts[row][kind];
+  ctx->errors.last_error_status = status;
+  ctx->errors.last_failed_channel = ch;
+  __DMB();
+  ctx->error_seq++;
+  __set_PRIMASK(primask);
+
+  // Logged at counts 1, 2, 4, 8, ...: a channel failing every frame does
+  // not flush the log
+  if ((count & (count - 1U)) == 0U) {
+    eventLog_write(EVENT_LOG_ADC_ERROR, (uint8_t)kind,
+                   row | ((uint32_t)status << 8) |
+                       ((count < 0xFFFFU) ? count : 0xFFFFU) << 16);
   }
+}
 
-  status = HAL_ADC_PollForConversion(&hadc1, ADC_POLL_TIMEOUT_MS);
-  if (status != HAL_OK) {
-    raw_LISXXXALH[snsrID] = ADC_ERROR_TIMEOUT;
-    adc_errors.total_errors++;
-    adc_errors.last_error_status = status;
-    adc_errors.last_failed_channel = snsrID;
-    HAL_ADC_Stop(&hadc1);
-    return;
+/**
+ * @brief Count one error of the default instance
+ */
+static inline void analogSensor_countError(uint8_t ch, ADC_ErrorKind_t kind,
+                                           HAL_StatusTypeDef status) {
+  analogSensor_ctxCountError(&default_ctx, ch, kind, status);
+  // Lifetime matrix in the backup SRAM, kept across resets
+  retained_countAdcError(
+      (ch < ADC_CONVERSIONS_CHANNEL_COUNT) ? ch : (uint8_t)ADC_ERROR_ROW_SCAN,
+      kind);
+}
+
+/**
+ * @brief Switch the acquisition mode, logging the change
+ */
+static void analogSensor_enterMode(ADC_AcqMode_t mode) {
+  const ADC_AcqMode_t old = acq_mode;
+  acq_mode = mode;
+  if (old != mode) {
+    eventLog_write(EVENT_LOG_MODE, (uint8_t)mode, (uint32_t)old);
   }
+}
 
-  raw_LISXXXALH[snsrID] = HAL_ADC_GetValue(&hadc1);
-  HAL_ADC_Stop(&hadc1);
+/**
+ * @brief Flag a failed channel in the packed frame and update error tracking
+ */
+static void analogSensor_storeError(uint8_t ch, ADC_SampleError_t code,
+                                    HAL_StatusTypeDef status) {
+  default_ctx.frame.error_mask |= (ADC_ChannelMask_t)(1UL << ch);
+  default_ctx.frame.error_code = (uint8_t)code;
+#if ADC_CONVERSIONS_LEGACY_VIEW
+  raw_LISXXXALH[ch] = legacy_sentinel[code];
+#endif
+  analogSensor_countError(ch, sample_error_kind[code], status);
 }
 
-void analogSensor_operation_all_channels(uint8_t total_channels) {
-  if (total_channels > ADC_CONVERSIONS_CHANNEL_COUNT) {
-    total_channels = ADC_CONVERSIONS_CHANNEL_COUNT;
+/**
+ * @brief Publish a complete frame of an instance for
+ *        analogSensor_getLatestFrame()
+ */
+ADC_FAST_CODE static void
+analogSensor_ctxPublishFrame(ADC_SensorCtx_t *ctx, const ADC_Frame_t *frame,
+                             uint32_t sequence, uint64_t timestamp) {
+  ctx->published_seq++;
+  __DMB();
+  ctx->published.frame = *frame;
+  ctx->published.sequence = sequence;
+  ctx->published.timestamp = timestamp;
+  __DMB();
+  ctx->published_seq++;
+}
+
+/**
+ * @brief Publish a complete frame of the default instance
+ */
+static inline void analogSensor_publishFrame(const ADC_Frame_t *frame,
+                                             uint32_t sequence,
+                                             uint64_t timestamp) {
+  analogSensor_ctxPublishFrame(&default_ctx, frame, sequence, timestamp);
+}
+
+/**
+ * @brief Publish an instance's frame after a polling frame read
+ */
+static void analogSensor_ctxPublishPolled(ADC_SensorCtx_t *ctx) {
+  const ADC_Frame_t frame = ctx->frame;
+  analogSensor_ctxPublishFrame(ctx, &frame, ctx->frames++, timebase_now());
+}
+
+/**
+ * @brief Sampling phase length in ADCCLK cycles for an ADC_SAMPLETIME_x value
+ */
+static uint32_t analogSensor_samplingCycles(uint32_t sampling_time) {
+  switch (sampling_time) {
+  case ADC_SAMPLETIME_3CYCLES:
+    return 3U;
+  case ADC_SAMPLETIME_15CYCLES:
+    return 15U;
+  case ADC_SAMPLETIME_28CYCLES:
+    return 28U;
+  case ADC_SAMPLETIME_56CYCLES:
+    return 56U;
+  case ADC_SAMPLETIME_84CYCLES:
+    return 84U;
+  case ADC_SAMPLETIME_112CYCLES:
+    return 112U;
+  case ADC_SAMPLETIME_144CYCLES:
+    return 144U;
+  default:
+    return 480U;
   }
-  for (uint8_t i = 0; i < total_channels; i++) {
-    analogSensor_operation(i);
+}
+
+/**
+ * @brief ADCCLK cycles of the successive approximation at a resolution,
+ *        which are also its bits
+ */
+static uint32_t analogSensor_resolutionCycles(uint32_t resolution) {
+  switch (resolution) {
+  case ADC_RESOLUTION_12B:
+    return 12U;
+  case ADC_RESOLUTION_10B:
+    return 10U;
+  case ADC_RESOLUTION_8B:
+    return 8U;
+  default:
+    return 6U;
   }
 }
 
-uint32_t analogSensor_getErrorCount(void) { return adc_errors.total_errors; }
+/**
+ * @brief A conversion at a lower resolution as a 12-bit code: its top bits
+ *        repeated below it, so the rails stay 0 and ADC_MAX_CODE
+ */
+static inline uint16_t analogSensor_rescaleCode(uint32_t code,
+                                                uint32_t resolution) {
+  const uint32_t bits = analogSensor_resolutionCycles(resolution);
+  const uint32_t shift = ADC_SAMPLE_BITS - bits;
+  return (uint16_t)((code << shift) | (code >> (bits - shift)));
+}
 
-HAL_StatusTypeDef analogSensor_getErrors(ADC_ErrorInfo_t *error_info) {
-  if (error_info == NULL) {
+/**
+ * @brief Rescale samples of a lower resolution in place, two per 32-bit
+ *        word, and clean the lines as analogSensor_applyGain() does
+ */
+ADC_FAST_CODE static void analogSensor_rescaleSamples(uint16_t *samples,
+                                                      uint32_t count,
+                                                      uint32_t bits) {
+  const uint32_t shift = ADC_SAMPLE_BITS - bits;
+  const uint32_t low = ((1UL << shift) - 1U) * ADC_CLIP_ONES;
+  uint32_t *word = (uint32_t *)samples;
+  for (uint32_t i = 0; i < count / 2U; i++) {
+    const uint32_t w = word[i];
+    word[i] = (w << shift) | ((w >> (bits - shift)) & low);
+  }
+  if (count % 2U != 0U) {
+    samples[count - 1U] = (uint16_t)((samples[count - 1U] << shift) |
+                                     (samples[count - 1U] >> (bits - shift)));
+  }
+  SCB_CleanDCache_by_Addr((uint32_t *)samples, count * sizeof(uint16_t));
+}
+
+/**
+ * @brief Bits of the slowest ADC of a layout: the ranks run in lock-step
+ */
+static uint32_t analogSensor_layoutBits(ADC_Multimode_t mode) {
+  uint32_t bits = 0;
+  for (uint8_t k = 0; k < scan_adc_count[mode]; k++) {
+    const uint32_t b = analogSensor_resolutionCycles(adc_resolution[k]);
+    bits = (b > bits) ? b : bits;
+  }
+  return bits;
+}
+
+/**
+ * @brief ADCCLK frequency for a common prescaler (ADC_CLOCK_SYNC_PCLK_DIVx)
+ */
+static uint32_t analogSensor_prescalerClockHz(uint32_t clock_prescaler) {
+  uint32_t div = ((clock_prescaler >> ADC_CCR_ADCPRE_Pos) + 1U) * 2U;
+  return HAL_RCC_GetPCLK2Freq() / div;
+}
+
+/**
+ * @brief ADCCLK frequency derived from PCLK2 and the common prescaler
+ */
+static uint32_t analogSensor_adcClockHz(void) {
+  return analogSensor_prescalerClockHz(hadc1.Init.ClockPrescaler);
+}
+
+/**
+ * @brief Index in sampling_times[] of the shortest sampling time that lets
+ *        the hold capacitor settle to the channel's accuracy at adc_hz
+ */
+static uint8_t analogSensor_pickSamplingTime(const ADC_ChannelProfile_t *p,
+                                             uint32_t adc_hz) {
+  // k >= 0.5 + f_ADC * (R_AIN + R_ADC) * C_ADC * (N + 2) * ln 2
+  float needed = 0.5f + (float)adc_hz *
+                            ((float)p->source_ohms + ADC_R_ADC_OHMS) *
+                            ADC_C_ADC_FARADS *
+                            (float)(p->accuracy_bits + 2U) * ADC_LN2;
+  uint8_t i = 0;
+  while (i + 1U < ADC_SAMPLING_TIME_COUNT &&
+         (float)analogSensor_samplingCycles(sampling_times[i]) < needed) {
+    i++;
+  }
+  return i;
+}
+
+/**
+ * @brief Sampling time of one rank: the slowest channel of the ADCs that
+ *        convert it together, so multimode stays in lock-step
+ */
+static uint8_t analogSensor_rankSamplingTime(
+    ADC_Multimode_t mode, uint8_t first_slot, uint32_t adc_hz,
+    const ADC_ChannelProfile_t *profiles) {
+  uint8_t longest = 0;
+  for (uint8_t k = 0; k < scan_adc_count[mode]; k++) {
+    uint8_t ch = scan_order[mode][first_slot + k];
+    uint8_t i = analogSensor_pickSamplingTime(&profiles[ch], adc_hz);
+    if (i > longest) {
+      longest = i;
+    }
+  }
+  return longest;
+}
+
+/**
+ * @brief ADCCLK cycles needed for one complete scan sequence of a layout
+ *
+ * In multimode the ADCs run in lock-step, rank by rank.
+ */
+static uint32_t analogSensor_scanCycles(ADC_Multimode_t mode, uint32_t adc_hz,
+                                        const ADC_ChannelProfile_t *profiles) {
+  const uint32_t bits = analogSensor_layoutBits(mode);
+  uint32_t cycles = 0;
+  for (uint8_t i = 0; i < ADC_CONVERSIONS_CHANNEL_COUNT;
+       i += scan_adc_count[mode]) {
+    uint8_t t = analogSensor_rankSamplingTime(mode, i, adc_hz, profiles);
+    cycles += analogSensor_samplingCycles(sampling_times[t]) + bits;
+  }
+  return cycles;
+}
+
+/**
+ * @brief Derive the sConfig[] sampling times of a layout from the profiles
+ *        at the current ADCCLK
+ */
+static void analogSensor_applyProfiles(ADC_Multimode_t mode) {
+  uint32_t adc_hz = analogSensor_adcClockHz();
+  for (uint8_t i = 0; i < ADC_CONVERSIONS_CHANNEL_COUNT;
+       i += scan_adc_count[mode]) {
+    uint32_t time = sampling_times[analogSensor_rankSamplingTime(
+        mode, i, adc_hz, channel_profile)];
+    for (uint8_t k = 0; k < scan_adc_count[mode]; k++) {
+      sConfig[scan_order[mode][i + k]].SamplingTime = time;
+    }
+  }
+  sampling_layout = (uint8_t)mode;
+  register_images_ready = 0;
+  conv_timing_hclk = 0;
+#if !ADC_CHANNELS_ALL_ADC12
+  adc3_ctx.timeout_hclk = 0;
+#endif
+}
+
+/**
+ * @brief Polling reads use each channel's own sampling time
+ */
+static inline void analogSensor_usePollingProfiles(void) {
+  if (sampling_layout != (uint8_t)ADC_MULTI_INDEPENDENT) {
+    analogSensor_applyProfiles(ADC_MULTI_INDEPENDENT);
+  }
+}
+
+/**
+ * @brief Program the rank sequence of every ADC taking part in the scan
+ *
+ * Polling mode rewrites rank 1 for every read, so the sequence set up by
+ * MX_ADC1_Init() has to be restored before a scan is started. In multimode
+ * each ADC gets count / n ranks and follows ADC1's trigger; the slaves keep a
+ * software trigger since the master starts them. The sampling times of
+ * sConfig[] are re-derived for the layout and ADCCLK first; the entries are
+ * otherwise copied, never modified.
+ */
+static HAL_StatusTypeDef analogSensor_configScanSequence(void) {
+  uint8_t adc_count = scan_adc_count[multimode];
+
+  // Ranks converted together must end together: one resolution per layout
+  for (uint8_t k = 1; k < adc_count; k++) {
+    if (adc_resolution[k] != adc_resolution[0]) {
+      analogSensor_countError(0xFF, ADC_ERROR_KIND_CONFIG, HAL_ERROR);
+      return HAL_ERROR;
+    }
+  }
+  analogSensor_applyProfiles(multimode);
+  uint8_t ranks = ADC_CONVERSIONS_CHANNEL_COUNT / adc_count;
+
+  for (uint8_t k = 0; k < adc_count; k++) {
+    ADC_HandleTypeDef *hadc = scan_adcs[k];
+    hadc->Init.NbrOfConversion = ranks;
+    hadc->Init.Resolution = adc_resolution[k];
+    if (k != 0U) {
+      hadc->Init.ContinuousConvMode = hadc1.Init.ContinuousConvMode;
+      hadc->Init.ExternalTrigConvEdge = ADC_EXTERNALTRIGCONVEDGE_NONE;
+      hadc->Init.ExternalTrigConv = ADC_SOFTWARE_START;
+    }
+
+    HAL_StatusTypeDef status = HAL_ADC_Init(hadc);
+    uint8_t failed = 0xFF; // HAL_ADC_Init() itself: the scan
+    for (uint8_t r = 0; r < ranks && status == HAL_OK; r++) {
+      uint8_t ch = scan_order[multimode][r * adc_count + k];
+      ADC_ChannelConfTypeDef rank_config = sConfig[ch];
+      rank_config.Rank = ADC_REGULAR_RANK_1 + r;
+      status = HAL_ADC_ConfigChannel(hadc, &rank_config);
+      if (status != HAL_OK) {
+        failed = ch;
+      }
+    }
+    if (status != HAL_OK) {
+      analogSensor_countError(failed, ADC_ERROR_KIND_CONFIG, status);
+      return status;
+    }
+  }
+  return HAL_OK;
+}
+
+/**
+ * @brief Write the multimode selection to the common ADC registers
+ *
+ * @note All ADCs must be disabled (ADON = 0)
+ */
+static HAL_StatusTypeDef analogSensor_configMultimode(ADC_Multimode_t mode) {
+  ADC_MultiModeTypeDef config = {0};
+
+  switch (mode) {
+  // Injected simultaneous as well: one injected read keeps all in lock-step
+  case ADC_MULTI_DUAL_SIMULT:
+    config.Mode = ADC_DUALMODE_REGSIMULT_INJECSIMULT;
+    config.DMAAccessMode = ADC_DMAACCESSMODE_1;
+    break;
+  case ADC_MULTI_TRIPLE_SIMULT:
+    config.Mode = ADC_TRIPLEMODE_REGSIMULT_INJECSIMULT;
+    config.DMAAccessMode = ADC_DMAACCESSMODE_1;
+    break;
+  default:
+    config.Mode = ADC_MODE_INDEPENDENT;
+    config.DMAAccessMode = ADC_DMAACCESSMODE_DISABLED;
+    break;
+  }
+  config.TwoSamplingDelay = ADC_TWOSAMPLINGDELAY_5CYCLES;
+  return HAL_ADCEx_MultiModeConfigChannel(&hadc1, &config);
+}
+
+/**
+ * @brief Index in scan_adcs[] of the ADC converting a channel in a layout
+ */
+static uint8_t analogSensor_adcOfChannel(ADC_Multimode_t mode, uint8_t ch) {
+  uint8_t i = 0;
+  while (scan_order[mode][i] != ch) {
+    i++;
+  }
+  return i % scan_adc_count[mode];
+}
+
+/**
+ * @brief Index in scan_adcs[] of the ADC polling a channel: ADC1, or ADC3
+ *        for its own pins
+ */
+static inline uint8_t analogSensor_pollAdc(uint8_t ch) {
+  return ((channel_adcs[ch] & ADC_CHANNELS_ADC1) != 0U) ? 0U : 2U;
+}
+
+/**
+ * @brief Put a HAL channel on rank 1 of an ADC's software-started injected
+ *        group
+ */
+static HAL_StatusTypeDef analogSensor_configInjectedRaw(ADC_HandleTypeDef *hadc,
+                                                        uint32_t channel,
+                                                        uint32_t sampling) {
+  ADC_InjectionConfTypeDef config = {
+      .InjectedChannel = channel,
+      .InjectedRank = ADC_INJECTED_RANK_1,
+      .InjectedSamplingTime = sampling,
+      .InjectedOffset = 0,
+      .InjectedNbrOfConversion = 1,
+      .InjectedDiscontinuousConvMode = DISABLE,
+      .AutoInjectedConv = DISABLE,
+      .ExternalTrigInjecConv = ADC_INJECTED_SOFTWARE_START,
+      .ExternalTrigInjecConvEdge = ADC_EXTERNALTRIGINJECCONVEDGE_NONE};
+  return HAL_ADCEx_InjectedConfigChannel(hadc, &config);
+}
+
+/**
+ * @brief Put a sensor channel on the injected group with its scan sampling
+ *        time
+ */
+static HAL_StatusTypeDef analogSensor_configInjected(ADC_HandleTypeDef *hadc,
+                                                     uint8_t ch) {
+  return analogSensor_configInjectedRaw(hadc, sConfig[ch].Channel,
+                                        sConfig[ch].SamplingTime);
+}
+
+/**
+ * @brief Start the configured injected conversion of one scan ADC
+ *
+ * @param k       Index in scan_adcs[] of the ADC reporting the result
+ * @param channel Channel passed to the callback
+ */
+static HAL_StatusTypeDef analogSensor_triggerInjected(
+    uint8_t k, uint8_t channel, ADC_InjectedCallback_t callback, void *ctx) {
+  ADC_HandleTypeDef *hadc = scan_adcs[k];
+
+  injected_channel = channel;
+  injected_adc = hadc;
+  injected_callback = callback;
+  injected_callback_ctx = ctx;
+  injected_busy = 1;
+
+  // In multimode a slave only arms its JEOC interrupt; ADC1's JSWSTART
+  // starts the injected group of every ADC
+  HAL_StatusTypeDef status = HAL_ADCEx_InjectedStart_IT(hadc);
+  if (status == HAL_OK && k != 0U) {
+    status = HAL_ADCEx_InjectedStart(&hadc1);
+  }
+  if (status != HAL_OK) {
+    injected_busy = 0;
     return HAL_ERROR;
   }
-  *error_info = adc_errors;
   return HAL_OK;
 }
 
-void analogSensor_resetErrors(void) {
-  adc_errors.total_errors = 0;
-  adc_errors.last_error_status = HAL_OK;
-  adc_errors.last_failed_channel = 0xFF;
+/**
+ * @brief Program (or switch off) the analog watchdog of every scan ADC
+ *
+ * @param enable 0 = all watchdogs off, e.g. for polling mode
+ */
+static HAL_StatusTypeDef analogSensor_configWatchdogs(uint8_t enable) {
+  HAL_StatusTypeDef status = HAL_OK;
+
+  for (uint8_t k = 0; k < 3U; k++) {
+    ADC_HandleTypeDef *hadc = scan_adcs[k];
+    watchdog_channel[k] = ADC_WATCHDOG_NONE;
+    CLEAR_BIT(hadc->Instance->CR1,
+              ADC_CR1_AWDEN | ADC_CR1_AWDIE | ADC_CR1_AWDSGL);
+    __HAL_ADC_CLEAR_FLAG(hadc, ADC_FLAG_AWD);
+    if (!enable || k >= scan_adc_count[multimode]) {
+      continue;
+    }
+
+    for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+      if (!watchdog_enabled[ch] ||
+          analogSensor_adcOfChannel(multimode, ch) != k) {
+        continue;
+      }
+      ADC_AnalogWDGConfTypeDef config = {
+          .WatchdogMode = ADC_ANALOGWATCHDOG_SINGLE_REG,
+          .HighThreshold = watchdog_high[ch],
+          .LowThreshold = watchdog_low[ch],
+          .Channel = sConfig[ch].Channel,
+          .ITMode = ENABLE};
+      if (HAL_ADC_AnalogWDGConfig(hadc, &config) != HAL_OK) {
+        analogSensor_countError(ch, ADC_ERROR_KIND_CONFIG, HAL_ERROR);
+        status = HAL_ERROR;
+        break;
+      }
+      watchdog_channel[k] = ch;
+      break;
+    }
+  }
+  return status;
+}
+
+/**
+ * @brief Input clock of TIM2 (APB1 timers run at 2x PCLK1 when APB1 is divided)
+ */
+static uint32_t analogSensor_timerClockHz(void) {
+  uint32_t clk = HAL_RCC_GetPCLK1Freq();
+  if ((RCC->CFGR & RCC_CFGR_PPRE1) != RCC_HCLK_DIV1) {
+    clk *= 2U;
+  }
+  return clk;
+}
+
+/**
+ * @brief Whether a scan completes within one trigger period: a trigger
+ *        arriving while a scan is still converting is ignored by the ADC,
+ *        which would silently halve the rate
+ */
+static uint8_t analogSensor_rateFits(uint32_t frame_rate_hz) {
+  const uint32_t adc_hz = analogSensor_adcClockHz();
+  return (frame_rate_hz != 0U &&
+          frame_rate_hz <= adc_hz / analogSensor_scanCycles(multimode, adc_hz,
+                                                            channel_profile))
+             ? 1U
+             : 0U;
+}
+
+/**
+ * @brief Program the TIM2 period for a trigger rate (already checked
+ *        against the scan length)
+ */
+static HAL_StatusTypeDef analogSensor_loadTimerPeriod(uint32_t rate_hz) {
+  uint32_t timer_clk = analogSensor_timerClockHz();
+  uint32_t period = (timer_clk + rate_hz / 2U) / rate_hz;
+  if (period < 2U) {
+    return HAL_ERROR;
+  }
+
+  // TIM2 is 32-bit with ARR preload: PSC stays 0 for the finest resolution
+  // and the new period takes effect at the next update event.
+  __HAL_TIM_SET_PRESCALER(&htim2, 0U);
+  __HAL_TIM_SET_AUTORELOAD(&htim2, period - 1U);
+  sample_rate_hz = timer_clk / period;
+  return HAL_OK;
+}
+
+/**
+ * @brief Select software (free-running) or timer start for the scan (TIM2
+ *        TRGO unless analogSensor_setScanTrigger() chose another)
+ */
+static HAL_StatusTypeDef analogSensor_configTrigger(uint8_t use_timer) {
+  if (use_timer) {
+    hadc1.Init.ContinuousConvMode = DISABLE;
+    hadc1.Init.ExternalTrigConvEdge = ADC_EXTERNALTRIGCONVEDGE_RISING;
+    hadc1.Init.ExternalTrigConv = scan_trigger_conv[scan_trigger];
+  } else {
+    hadc1.Init.ContinuousConvMode = ENABLE;
+    hadc1.Init.ExternalTrigConvEdge = ADC_EXTERNALTRIGCONVEDGE_NONE;
+    hadc1.Init.ExternalTrigConv = ADC_SOFTWARE_START;
+  }
+  return HAL_ADC_Init(&hadc1);
+}
+
+/**
+ * @brief Switch the DMA stream between scan and capture transfers
+ *
+ * Scan: half-words into the circular ping-pong buffer. Capture: one pass of
+ * 32-bit words, each holding two interleaved conversions. The FIFO and the
+ * burst (dma_tuning.h) are fitted to the data size of each.
+ */
+static HAL_StatusTypeDef analogSensor_configDMA(uint8_t capture) {
+  DMA_HandleTypeDef *hdma = hadc1.DMA_Handle;
+
+  if (capture) {
+    hdma->Init.PeriphDataAlignment = DMA_PDATAALIGN_WORD;
+    hdma->Init.MemDataAlignment = DMA_MDATAALIGN_WORD;
+    hdma->Init.Mode = DMA_NORMAL;
+  } else {
+    hdma->Init.PeriphDataAlignment = DMA_PDATAALIGN_HALFWORD;
+    hdma->Init.MemDataAlignment = DMA_MDATAALIGN_HALFWORD;
+    hdma->Init.Mode = DMA_CIRCULAR;
+  }
+  dmaTuning_apply(DMA_TUNING_ADC, &hdma->Init);
+  return HAL_DMA_Init(hdma);
+}
+
+/**
+ * @brief Program ADC1/2/3 for single-channel interleaved capture or back
+ *        for the scan
+ *
+ * Only the fields the capture changes are touched; the scan sequence itself
+ * is rebuilt by analogSensor_configScanSequence() at the next start.
+ */
+static HAL_StatusTypeDef analogSensor_configCapture(uint8_t capture,
+                                                    uint8_t channel) {
+  HAL_StatusTypeDef status = HAL_OK;
+
+  for (uint8_t k = 0; k < 3U && status == HAL_OK; k++) {
+    ADC_HandleTypeDef *hadc = scan_adcs[k];
+    // The capture cycle (3 + 12 cycles, staggered by 5) needs 12 bits
+    hadc->Init.Resolution = capture ? ADC_RESOLUTION_12B : adc_resolution[k];
+    if (capture) {
+      hadc->Init.ClockPrescaler = ADC_CAPTURE_PRESCALER;
+      hadc->Init.ScanConvMode = ADC_SCAN_DISABLE;
+      hadc->Init.ContinuousConvMode = ENABLE;
+      hadc->Init.NbrOfConversion = 1;
+      hadc->Init.DMAContinuousRequests = DISABLE;
+    } else {
+      hadc->Init.ClockPrescaler = scan_prescaler;
+      hadc->Init.ScanConvMode = ADC_SCAN_ENABLE;
+      hadc->Init.NbrOfConversion = (k == 0U) ? ADC_POLL_RANKS : 1U;
+      hadc->Init.DMAContinuousRequests = (k == 0U) ? ENABLE : DISABLE;
+    }
+    hadc->Init.ExternalTrigConvEdge = ADC_EXTERNALTRIGCONVEDGE_NONE;
+    hadc->Init.ExternalTrigConv = ADC_SOFTWARE_START;
+    status = HAL_ADC_Init(hadc);
+
+    if (capture && status == HAL_OK) {
+      ADC_ChannelConfTypeDef config = sConfig[channel];
+      config.Rank = ADC_REGULAR_RANK_1;
+      config.SamplingTime = ADC_CAPTURE_SAMPLETIME;
+      status = HAL_ADC_ConfigChannel(hadc, &config);
+    }
+  }
+
+  if (status == HAL_OK) {
+    ADC_MultiModeTypeDef multi = {
+        .Mode = capture ? ADC_TRIPLEMODE_INTERL : ADC_MODE_INDEPENDENT,
+        .DMAAccessMode =
+            capture ? ADC_DMAACCESSMODE_2 : ADC_DMAACCESSMODE_DISABLED,
+        .TwoSamplingDelay = ADC_CAPTURE_DELAY};
+    status = HAL_ADCEx_MultiModeConfigChannel(&hadc1, &multi);
+  }
+  if (status == HAL_OK) {
+    status = analogSensor_configDMA(capture);
+  }
+  return status;
+}
+
+/**
+ * @brief Stop the interleaved ADCs (DMA ISR or thread context)
+ */
+static void analogSensor_haltCapture(void) {
+  HAL_ADCEx_MultiModeStop_DMA(&hadc1);
+  HAL_ADC_Stop(&hadc2);
+  HAL_ADC_Stop(&hadc3);
+}
+
+/**
+ * @brief Stop every ADC of the scan and return to independent ADC1
+ */
+static HAL_StatusTypeDef analogSensor_stopScan(void) {
+  HAL_StatusTypeDef status;
+
+  if (multimode == ADC_MULTI_INDEPENDENT) {
+    return HAL_ADC_Stop_DMA(&hadc1);
+  }
+
+  status = HAL_ADCEx_MultiModeStop_DMA(&hadc1);
+  for (uint8_t k = 1; k < scan_adc_count[multimode]; k++) {
+    if (HAL_ADC_Stop(scan_adcs[k]) != HAL_OK) {
+      status = HAL_ERROR;
+    }
+  }
+  if (analogSensor_configMultimode(ADC_MULTI_INDEPENDENT) != HAL_OK) {
+    status = HAL_ERROR;
+  }
+  return status;
+}
+
+/**
+ * @brief Restore the scan sequence and start circular DMA into the block buffer
+ *
+ * @param resume 1 = back from a switched capture: the frame numbering, the
+ *               counters, the ring and the timing estimate carry on
+ */
+static HAL_StatusTypeDef analogSensor_startScanDMA(uint8_t resume) {
+  if (analogSensor_configScanSequence() != HAL_OK) {
+    return HAL_ERROR;
+  }
+  if (analogSensor_configWatchdogs(1) != HAL_OK) {
+    return HAL_ERROR; // counted against the guarded channel
+  }
+  // Slaves convert their first scan channel alongside an injected read
+  for (uint8_t k = 1; k < scan_adc_count[multimode]; k++) {
+    if (analogSensor_configInjected(scan_adcs[k], scan_order[multimode][k]) !=
+        HAL_OK) {
+      analogSensor_countError(scan_order[multimode][k], ADC_ERROR_KIND_CONFIG,
+                              HAL_ERROR);
+      return HAL_ERROR;
+    }
+  }
+
+  if (!resume) {
+    blocks_completed = 0;
+    blocks_consumed = 0;
+    blocks_dropped = 0;
+    frame_sequence = 0;
+    timing_blocks = 0;
+    watchdog_alarms = 0;
+    memset(&overrun_info, 0, sizeof(overrun_info));
+    adcRing_reset();
+  }
+  dma_next_block = 0;
+  resync_active = 0;
+  block_bits = (uint8_t)analogSensor_layoutBits(multimode);
+  gap_block = NULL;
+  staged_pending = 0;
+  staged_mark = 0;
+  staged_mark_rate = 0;
+  active_order = scan_order[multimode];
+  // A stop during a realigning pass left the stream out of circular mode
+  DMA_HandleTypeDef *hdma = hadc1.DMA_Handle;
+  MODIFY_REG(hdma->Instance->CR, DMA_SxCR_CIRC, hdma->Init.Mode & DMA_SxCR_CIRC);
+
+  HAL_StatusTypeDef status;
+  if (multimode == ADC_MULTI_INDEPENDENT) {
+    status = HAL_ADC_Start_DMA(&hadc1, (uint32_t *)adc_dma_buffer,
+                               2 * block_samples);
+  } else {
+    // Slaves are only enabled here; ADC1 starts all of them and the common
+    // data register feeds DMA with ADC1, ADC2(, ADC3) half-words in turn.
+    status = analogSensor_configMultimode(multimode);
+    for (uint8_t k = 1; k < scan_adc_count[multimode] && status == HAL_OK;
+         k++) {
+      status = HAL_ADC_Start(scan_adcs[k]);
+    }
+    if (status == HAL_OK) {
+      status = HAL_ADCEx_MultiModeStart_DMA(&hadc1, (uint32_t *)adc_dma_buffer,
+                                            2 * block_samples);
+    }
+    if (status != HAL_OK) {
+      analogSensor_stopScan();
+    }
+  }
+  if (status != HAL_OK) {
+    analogSensor_countError(0xFF, ADC_ERROR_KIND_START, status);
+    return HAL_ERROR;
+  }
+  return HAL_OK;
+}
+
+/**
+ * @brief Time one transition of a switched capture against the target
+ *
+ * @return uint32_t Microseconds from `from` to `to`
+ */
+static uint32_t analogSensor_timeSwitch(uint64_t from, uint64_t to,
+                                        uint32_t *max_us) {
+  const uint64_t us = timebase_toMicros(to - from);
+  const uint32_t t = (us > UINT32_MAX) ? UINT32_MAX : (uint32_t)us;
+  if (t > *max_us) {
+    *max_us = t;
+  }
+  if (t > switch_info.frame_period_us) {
+    switch_info.over_target++;
+  }
+  return t;
+}
+
+/**
+ * @brief Re-arm the timed scan after a switched capture, its frames
+ *        numbered from where TIM2 has got to
+ * @note DMA interrupt context, from the capture's completion
+ */
+static void analogSensor_leaveCapture(uint64_t end) {
+  switch_active = 0;
+  analogSensor_enterMode(ADC_ACQ_MODE_DMA_TIMER);
+  HAL_StatusTypeDef status = analogSensor_configCapture(0, 0);
+  if (status == HAL_OK) {
+    status = analogSensor_configTrigger(1);
+  }
+  if (status == HAL_OK) {
+    status = analogSensor_startScanDMA(1);
+  }
+  const uint64_t armed = timebase_now();
+  if (status != HAL_OK) {
+    // Nothing to go back to: polling mode, as analogSensor_stopDMA()
+    HAL_TIM_Base_Stop(&htim2);
+    analogSensor_configWatchdogs(0);
+    hadc1.Init.NbrOfConversion = ADC_POLL_RANKS;
+    analogSensor_configTrigger(0);
+    analogSensor_enterMode(ADC_ACQ_MODE_POLLING);
+    switch_info.failures++;
+    return;
+  }
+
+  // The first frame back is the first TIM2 edge after arming: skip the
+  // edges since the last scan frame, as an overrun's recovery does
+  const uint32_t skipped =
+      (uint32_t)((armed - last_block.timestamp) * sample_rate_hz /
+                 TIMEBASE_TICK_HZ);
+  switch_info.gap_sequence = frame_sequence;
+  switch_info.gap_frames = skipped;
+  frame_sequence += skipped;
+  switch_mark = 1;
+  switch_info.capture_end = end;
+  switch_info.leave_us =
+      analogSensor_timeSwitch(end, armed, &switch_info.leave_max_us);
+  switch_info.switches++;
+}
+
+/**
+ * @brief Stop the timed scan at a block boundary and start the switched
+ *        capture; TIM2 keeps the scan's frame grid running meanwhile
+ * @note DMA interrupt context, from the completion of the scan's last block
+ */
+static void analogSensor_enterCapture(uint8_t channel, uint64_t now) {
+  analogSensor_stopScan();
+  analogSensor_configWatchdogs(0);
+  scan_prescaler = hadc1.Init.ClockPrescaler;
+  analogSensor_enterMode(ADC_ACQ_MODE_CAPTURE);
+  switch_active = 1;
+
+  HAL_StatusTypeDef status = analogSensor_configCapture(1, channel);
+  for (uint8_t k = 1; k < 3U && status == HAL_OK; k++) {
+    status = HAL_ADC_Start(scan_adcs[k]);
+  }
+  if (status == HAL_OK) {
+    status = HAL_ADCEx_MultiModeStart_DMA(&hadc1, (uint32_t *)capture_buffer,
+                                          ADC_CONVERSIONS_CAPTURE_SAMPLES / 2U);
+  }
+  const uint64_t started = timebase_now();
+  switch_info.channel = channel;
+  switch_info.capture_start = started;
+  switch_info.enter_us =
+      analogSensor_timeSwitch(now, started, &switch_info.enter_max_us);
+  if (status != HAL_OK) {
+    // Straight back: the scan only loses the frames of the attempt
+    analogSensor_countError(channel, ADC_ERROR_KIND_START, status);
+    analogSensor_haltCapture();
+    capture_switched = 0;
+    analogSensor_leaveCapture(started);
+  }
+}
+
+/**
+ * @brief Swap the staged configuration in: profiles, sConfig[] sampling
+ *        times, the scan ADCs' SMPR bits and the TIM2 period
+ * @note DMA interrupt context, between the last scan of a block and the
+ *       first trigger of the next
+ */
+ADC_FAST_CODE static void analogSensor_swapStaged(void) {
+  if (staged.cfg.fields & ADC_SCAN_CONFIG_PROFILES) {
+    for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+      channel_profile[ch] = staged.cfg.profile[ch];
+      sConfig[ch].SamplingTime = staged.sampling_time[ch];
+    }
+    for (uint8_t k = 0; k < scan_adc_count[multimode]; k++) {
+      ADC_TypeDef *adc = scan_adcs[k]->Instance;
+      MODIFY_REG(adc->SMPR1, staged.smpr1_mask[k], staged.smpr1[k]);
+      MODIFY_REG(adc->SMPR2, staged.smpr2_mask[k], staged.smpr2[k]);
+    }
+    register_images_ready = 0;
+    conv_timing_hclk = 0;
+  }
+  if (staged.cfg.fields & ADC_SCAN_CONFIG_RATE) {
+    (void)analogSensor_loadTimerPeriod(staged.cfg.frame_rate_hz);
+    staged_mark_rate = 1;
+  }
+  staged_pending = 0;
+  staged_mark = 1;
+}
+
+/**
+ * @brief Scale a block in place by a q14 gain, saturated to 12 bits
+ *
+ * Two samples per 32-bit word. The lines are cleaned afterwards: dirty, they
+ * could be evicted over the next DMA pass into the same memory.
+ */
+ADC_FAST_CODE static void analogSensor_applyGain(uint16_t *block,
+                                                 uint16_t gain) {
+  uint32_t *word = (uint32_t *)block;
+  const uint32_t round = 1UL << (ADC_BLOCK_GAIN_FRAC_BITS - 1U);
+  for (uint32_t i = 0; i < block_samples / 2U; i++) {
+    const uint32_t w = word[i];
+    const uint32_t lo = __USAT(
+        ((w & 0xFFFFU) * gain + round) >> ADC_BLOCK_GAIN_FRAC_BITS, 12);
+    const uint32_t hi =
+        __USAT(((w >> 16) * gain + round) >> ADC_BLOCK_GAIN_FRAC_BITS, 12);
+    word[i] = lo | (hi << 16);
+  }
+  SCB_CleanDCache_by_Addr((uint32_t *)block, block_samples * sizeof(uint16_t));
+}
+
+/**
+ * @brief Slot pair k of a frame, two samples in one word; the last pair of
+ *        an odd channel count gets a mid-scale upper lane
+ */
+__attribute__((always_inline)) static inline uint32_t
+analogSensor_loadPair(const uint16_t *frame, uint32_t k) {
+  if (ADC_CONVERSIONS_CHANNEL_COUNT % 2U != 0U && k + 1U == ADC_CLIP_PAIRS) {
+    return frame[2U * k] | ((uint32_t)ADC_CLIP_MIDSCALE << 16);
+  }
+  uint32_t v;
+  memcpy(&v, &frame[2U * k], sizeof(v));
+  return v;
+}
+
+/**
+ * @brief 0xFFFF in each lane of a slot pair that is at or beyond a rail
+ *
+ * Two USUB16 compares, each read back by one SEL: no branch per sample.
+ */
+__attribute__((always_inline)) static inline uint32_t
+analogSensor_clipLanes(uint32_t x) {
+  __USUB16(x, ADC_CLIP_HIGH_CODE * ADC_CLIP_ONES); // GE: x >= high
+  const uint32_t high = __SEL(0xFFFFFFFFU, 0U);
+  __USUB16(x, (ADC_CLIP_LOW_CODE + 1U) * ADC_CLIP_ONES); // GE: x > low
+  const uint32_t low = __SEL(0U, 0xFFFFFFFFU);
+  return high | low;
+}
+
+/**
+ * @brief Hand off a completed DMA half-buffer
+ * @note Called from DMA interrupt context
+ */
+ADC_FAST_CODE static void analogSensor_blockComplete(const uint16_t *block) {
+  // Latch first: everything after this adds to the stamp's latency
+  uint64_t now = timebase_now();
+  uint32_t t0 = profiler_begin();
+
+  // The first block under a swapped configuration restarts the estimate
+  const uint8_t first_staged = staged_mark;
+  staged_mark = 0;
+  if (staged_mark_rate) {
+    staged_mark_rate = 0;
+    timing_blocks = 0;
+  }
+  // Before the next trigger: the ADCs are idle between two scans
+  const uint8_t swapped = staged_pending;
+  if (swapped) {
+    analogSensor_swapStaged();
+  }
+  // ... and the last block of the scan before a switched capture
+  const uint8_t switch_channel = switch_request;
+  if (switch_channel != 0U) {
+    switch_request = 0;
+    analogSensor_enterCapture(switch_channel - 1U, now);
+  }
+  const uint8_t first_switched = switch_mark;
+  switch_mark = 0;
+
+  // Drop stale cache lines: DMA has just rewritten this half behind the cache
+  // and is now filling the other one, so the lines stay valid for a block.
+  SCB_InvalidateDCache_by_Addr((uint32_t *)block,
+                               block_samples * sizeof(uint16_t));
+  // Into the common 12-bit format before anything reads the codes
+  const uint8_t bits = block_bits;
+  if (bits != ADC_SAMPLE_BITS) {
+    analogSensor_rescaleSamples((uint16_t *)block, block_samples, bits);
+  }
+  const uint16_t gain = block_gain;
+  if (gain != ADC_BLOCK_GAIN_UNITY) {
+    analogSensor_applyGain((uint16_t *)block, gain);
+  }
+  const ADC_BlockFilter_t filter = block_filter;
+  if (filter != NULL) {
+    filter((uint16_t *)block, block_frames, block_filter_ctx);
+    SCB_CleanDCache_by_Addr((uint32_t *)block,
+                            block_samples * sizeof(uint16_t));
+  }
+
+  const uint8_t *order = active_order;
+  const uint16_t *newest =
+      &block[block_samples - ADC_CONVERSIONS_CHANNEL_COUNT];
+  for (uint8_t i = 0; i < ADC_CONVERSIONS_CHANNEL_COUNT; i++) {
+    default_ctx.frame.samples[order[i]] = newest[i];
+#if ADC_CONVERSIONS_LEGACY_VIEW
+    raw_LISXXXALH[order[i]] = newest[i];
+#endif
+  }
+  // Frames an overrun lost in this block (none: an empty range)
+  const uint32_t lost_first = (block == gap_block) ? gap_first : block_frames;
+  const uint32_t lost_end = (block == gap_block) ? gap_end : 0U;
+  gap_block = NULL;
+  const uint8_t newest_lost = (lost_end == block_frames);
+  default_ctx.frame.error_mask = newest_lost ? ADC_FRAME_ALL_CHANNELS : 0U;
+  default_ctx.frame.error_code =
+      newest_lost ? ADC_SAMPLE_ERROR_OVERRUN : ADC_SAMPLE_OK;
+  const ADC_Frame_t newest_frame = default_ctx.frame;
+  analogSensor_publishFrame(&newest_frame, frame_sequence + block_frames - 1U,
+                            now);
+
+  // One stamp per block; frame times follow from the index and the rate
+  if (timing_blocks == 0U) {
+    timing_first_frame = frame_sequence;
+    timing_first_timestamp = now;
+  } else if (!first_switched) { // not across a capture
+    uint32_t interval = (uint32_t)(now - last_block.timestamp);
+    if (timing_blocks == 1U || interval < interval_min) {
+      interval_min = interval;
+    }
+    if (timing_blocks == 1U || interval > interval_max) {
+      interval_max = interval;
+    }
+  }
+  last_block.first_frame = frame_sequence;
+  last_block.frame_count = block_frames;
+  last_block.timestamp = now;
+  timing_blocks++;
+  BlockPool_Block_t *pooled = pool_active ? blockPool_fromData(block) : NULL;
+  if (pooled != NULL) {
+    pooled->info = last_block;
+  }
+
+  // Sensor range of the block, and the samples a range switch left void
+  ADC_BlockRange_t range = {0};
+  uint32_t settle_end = 0;
+  const ADC_RangeHook_t hook = range_hook;
+  if (hook != NULL) {
+    hook(block, block_frames, order, &range, range_hook_ctx);
+    for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+      settle_end = (range.settle[ch] > settle_end) ? range.settle[ch]
+                                                   : settle_end;
+    }
+  }
+
+  // Queue every frame of the block for the streaming consumers, checking
+  // each slot pair against the rails on the way (per-lane block counts)
+  ADC_RingEntry_t entry = {.timestamp = HAL_GetTick(), .range = range.range};
+  uint32_t clip_hits[ADC_CLIP_PAIRS] = {0};
+  uint32_t clip_starts[ADC_CLIP_PAIRS] = {0};
+  uint32_t clip_seen[ADC_CLIP_PAIRS] = {0};
+  for (uint32_t f = 0; f < block_frames; f++) {
+    const uint16_t *src = &block[f * ADC_CONVERSIONS_CHANNEL_COUNT];
+    for (uint8_t i = 0; i < ADC_CONVERSIONS_CHANNEL_COUNT; i++) {
+      entry.frame.samples[order[i]] = src[i];
+    }
+    const uint8_t lost = (f >= lost_first && f < lost_end);
+    uint32_t clipped = 0;
+#if ADC_CONVERSIONS_CLIP_DETECT
+    // A frame an overrun lost holds no conversion: never clipped
+    const uint32_t valid = lost ? 0U : 0xFFFFFFFFU;
+    for (uint32_t k = 0; k < ADC_CLIP_PAIRS; k++) {
+      const uint32_t lanes =
+          analogSensor_clipLanes(analogSensor_loadPair(src, k)) & valid;
+      clip_hits[k] += lanes & ADC_CLIP_ONES;
+      clip_starts[k] += lanes & ~clip_lanes[k] & ADC_CLIP_ONES;
+      clip_seen[k] |= lanes;
+      clip_lanes[k] = lanes;
+      clipped |= lanes;
+    }
+#endif
+    entry.frame.error_mask = lost ? ADC_FRAME_ALL_CHANNELS : 0U;
+    entry.frame.error_code = lost ? ADC_SAMPLE_ERROR_OVERRUN : ADC_SAMPLE_OK;
+    entry.flags = ((first_staged && f == 0U) ? ADC_RING_FLAG_CONFIG : 0U) |
+                  ((clipped != 0U) ? ADC_RING_FLAG_CLIPPED : 0U) |
+                  ((first_switched && f == 0U) ? ADC_RING_FLAG_MODE : 0U);
+    if (f < settle_end && !lost) {
+      ADC_ChannelMask_t settling = 0;
+      for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+        settling |= (ADC_ChannelMask_t)((f < range.settle[ch]) << ch);
+      }
+      entry.frame.error_mask = settling;
+      entry.frame.error_code = ADC_SAMPLE_ERROR_SETTLING;
+      entry.flags |= ADC_RING_FLAG_SETTLING;
+    }
+    entry.sequence = frame_sequence++;
+    adcRing_push(&entry);
+  }
+
+  // Widen the lane counts into the channel totals once per block
+  ADC_ChannelMask_t clipped_channels = 0;
+  for (uint8_t i = 0; i < ADC_CONVERSIONS_CHANNEL_COUNT; i++) {
+    const uint32_t shift = 16U * (i & 1U);
+    const uint8_t ch = order[i];
+    clip_samples[ch] += (clip_hits[i / 2U] >> shift) & 0xFFFFU;
+    clip_episodes[ch] += (clip_starts[i / 2U] >> shift) & 0xFFFFU;
+    const uint32_t seen = (clip_seen[i / 2U] >> shift) & 1U;
+    clipped_channels |= (ADC_ChannelMask_t)(seen << ch);
+  }
+  last_block.clipped = clipped_channels;
+  if (pooled != NULL) {
+    pooled->info.clipped = clipped_channels;
+  }
+
+  // One integer pass per block (slot order), merged in channel order
+  DSP_StatsAccum_t block_stats[ADC_CONVERSIONS_CHANNEL_COUNT];
+  dspStats_reset(block_stats);
+  dspStats_accumulate(block_stats, block, block_frames);
+  for (uint8_t i = 0; i < ADC_CONVERSIONS_CHANNEL_COUNT; i++) {
+    dspStats_merge(&channel_stats[order[i]], &block_stats[i]);
+  }
+
+  newest_block = block;
+  blocks_completed++;
+  if (block_callback != NULL) {
+    block_callback(block, block_frames, block_callback_ctx);
+  }
+  // Consumers retune after the last block at the old settings
+  if (swapped && staged.cfg.applied != NULL) {
+    staged.cfg.applied(frame_sequence, staged.cfg.ctx);
+  }
+
+  profiler_end(PROFILER_PROBE_DMA_CALLBACK, t0);
+}
+
+/**
+ * @brief Memory the DMA fills for a block: a ping-pong half or the pool
+ *        target (its own half while the pool is exhausted)
+ */
+static inline uint16_t *analogSensor_dmaBlock(uint8_t k) {
+  return (pool_active && pool_target[k] != NULL)
+             ? blockPool_dmaTarget(pool_target[k])
+             : &adc_dma_buffer[k * block_samples];
+}
+
+/**
+ * @brief Swap a free pool block into a filled double-buffer target
+ *
+ * @param done Receives the filled pool block (NULL: the DMA's own half)
+ *
+ * @return const uint16_t* The filled samples
+ */
+ADC_FAST_CODE static const uint16_t *
+analogSensor_poolSwap(DMA_HandleTypeDef *hdma, uint8_t target,
+                      BlockPool_Block_t **done) {
+  *done = pool_target[target];
+  const uint16_t *data = (*done != NULL)
+                             ? (*done)->data
+                             : &adc_dma_buffer[target * block_samples];
+
+  // The DMA is on the other target for a block period; retarget this one.
+  // A held block is never reused, so with none free the DMA falls back to
+  // its own half, whose data then lasts one block period only.
+  BlockPool_Block_t *next = blockPool_alloc();
+  uint16_t *dst = (next != NULL)
+                      ? blockPool_dmaTarget(next)
+                      : &adc_dma_buffer[target * block_samples];
+  if (next == NULL) {
+    pool_starved++;
+  }
+  // No dirty line of a reused block may be evicted over the new samples
+  SCB_InvalidateDCache_by_Addr((uint32_t *)dst,
+                               block_samples * sizeof(uint16_t));
+  HAL_DMAEx_ChangeMemory(hdma, (uint32_t)dst, target ? MEMORY1 : MEMORY0);
+  pool_target[target] = next;
+  return data;
+}
+
+/**
+ * @brief Detach a filled block from the DMA for its hand-off
+ *
+ * @param done Receives the pool block to release afterwards (or NULL)
+ */
+ADC_FAST_CODE static const uint16_t *
+analogSensor_takeBlock(DMA_HandleTypeDef *hdma, uint8_t k,
+                       BlockPool_Block_t **done) {
+  if (!pool_active) {
+    *done = NULL;
+    return &adc_dma_buffer[k * block_samples];
+  }
+  return analogSensor_poolSwap(hdma, k, done);
+}
+
+/**
+ * @brief Hand off a detached block and drop the DMA's pool reference
+ */
+ADC_FAST_CODE static void analogSensor_handOff(const uint16_t *data,
+                                               BlockPool_Block_t *done) {
+  analogSensor_blockComplete(data);
+  // The stages have retained what they keep
+  blockPool_release(done);
+}
+
+/**
+ * @brief Program the stopped scan stream to continue at a frame of a block
+ *
+ * From frame 0 the normal transfer restarts: circular over the ping-pong
+ * buffer (from block 0 only) or double-buffer on the pool targets. NDTR
+ * reloads its programmed count in both, so anywhere else a single pass
+ * runs to the end of the block and its completion re-arms from the next.
+ * That pass starts mid-block, off the burst alignment, so it moves single
+ * beats. Every flag is cleared first, as the stream requires before EN.
+ */
+ADC_FAST_CODE static void analogSensor_armStream(DMA_HandleTypeDef *hdma,
+                                                 uint8_t block,
+                                                 uint32_t frame) {
+  DMA_Stream_TypeDef *stream = hdma->Instance;
+  __HAL_DMA_CLEAR_FLAG(hdma, __HAL_DMA_GET_TC_FLAG_INDEX(hdma) |
+                                 __HAL_DMA_GET_HT_FLAG_INDEX(hdma) |
+                                 __HAL_DMA_GET_TE_FLAG_INDEX(hdma) |
+                                 __HAL_DMA_GET_DME_FLAG_INDEX(hdma) |
+                                 __HAL_DMA_GET_FE_FLAG_INDEX(hdma));
+  uint32_t cr = (stream->CR & ~(DMA_SxCR_CIRC | DMA_SxCR_DBM | DMA_SxCR_CT |
+                                DMA_SxCR_MBURST | DMA_IT_HT)) |
+                DMA_IT_TC;
+  const uint32_t burst = (hdma->Init.FIFOMode == DMA_FIFOMODE_ENABLE)
+                             ? hdma->Init.MemBurst
+                             : DMA_MBURST_SINGLE;
+
+  if (frame == 0U && pool_active) {
+    stream->M0AR = (uint32_t)analogSensor_dmaBlock(0);
+    stream->M1AR = (uint32_t)analogSensor_dmaBlock(1);
+    stream->NDTR = block_samples;
+    cr |= DMA_SxCR_DBM | DMA_SxCR_CIRC | burst | (block ? DMA_SxCR_CT : 0U);
+    resync_active = 0;
+  } else if (frame == 0U && block == 0U) {
+    stream->M0AR = (uint32_t)adc_dma_buffer;
+    stream->NDTR = 2U * block_samples;
+    cr |= DMA_SxCR_CIRC | DMA_IT_HT | burst;
+    resync_active = 0;
+  } else {
+    stream->M0AR = (uint32_t)&analogSensor_dmaBlock(
+        block)[frame * ADC_CONVERSIONS_CHANNEL_COUNT];
+    stream->NDTR = (block_frames - frame) * ADC_CONVERSIONS_CHANNEL_COUNT;
+    resync_block = block;
+    resync_active = 1;
+  }
+  dma_next_block = block;
+  stream->CR = cr;
+  // The HAL handler left a finished single pass READY; stop needs BUSY
+  hdma->State = HAL_DMA_STATE_BUSY;
+  SET_BIT(stream->CR, DMA_SxCR_EN);
+}
+
+/**
+ * @brief The single realigning pass reached the end of its block: re-arm
+ *        from the next block, then hand the completed one off
+ * @note Called from DMA interrupt context
+ */
+ADC_FAST_CODE static void analogSensor_resyncComplete(DMA_HandleTypeDef *hdma) {
+  const uint8_t block = resync_block;
+  BlockPool_Block_t *done;
+  const uint16_t *data = analogSensor_takeBlock(hdma, block, &done);
+  // Until the next TIM2 trigger the ADC has nothing for the stream
+  analogSensor_armStream(hdma, block ^ 1U, 0);
+  analogSensor_handOff(data, done);
+}
+
+/**
+ * @brief Double-buffer target done: swap a free pool block into it and hand
+ *        the filled one on
+ * @note Called from DMA interrupt context
+ */
+ADC_FAST_CODE static void analogSensor_poolComplete(DMA_HandleTypeDef *hdma,
+                                                    uint8_t target) {
+  if (resync_active) {
+    analogSensor_resyncComplete(hdma);
+    return;
+  }
+  BlockPool_Block_t *done;
+  const uint16_t *data = analogSensor_poolSwap(hdma, target, &done);
+  dma_next_block = target ^ 1U;
+  analogSensor_handOff(data, done);
+}
+
+ADC_FAST_CODE static void analogSensor_poolM0Complete(DMA_HandleTypeDef *hdma) {
+  analogSensor_poolComplete(hdma, 0);
+}
+
+ADC_FAST_CODE static void analogSensor_poolM1Complete(DMA_HandleTypeDef *hdma) {
+  analogSensor_poolComplete(hdma, 1);
+}
+
+/**
+ * @brief Repair an overrun of the running scan in place
+ *
+ * At OVR the ADC stops requesting DMA after its last valid transfer, so the
+ * block in memory is good up to the stream's position. The stream is
+ * stopped and restarted at the frame the next TIM2 trigger produces, taken
+ * from the timebase since the newest block; the frames in between repeat
+ * the last valid one and are queued as ADC_SAMPLE_ERROR_OVERRUN. A stall
+ * past the end of the block finishes it that way and resumes at the next
+ * block, the sequence skipping the frames never converted. A completion
+ * whose interrupt had not run yet is handed off here, as disabling the
+ * stream clears its flag. The ADCs keep their configuration: only OVR and
+ * the DMA request enable are touched.
+ *
+ * @note Called from ADC interrupt context, same priority as the DMA
+ */
+ADC_FAST_CODE static void analogSensor_recoverOverrun(void) {
+  DMA_HandleTypeDef *hdma = hadc1.DMA_Handle;
+  DMA_Stream_TypeDef *stream = hdma->Instance;
+  const uint64_t now = timebase_now();
+  const uint32_t t0 = profiler_now();
+
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  CLEAR_BIT(stream->CR, DMA_SxCR_EN);
+  for (uint32_t spin = 0;
+       (stream->CR & DMA_SxCR_EN) != 0U && spin < ADC_DMA_STOP_SPINS; spin++) {
+  }
+
+  // Block being filled and the samples already in it
+  const uint32_t remaining = stream->NDTR;
+  uint8_t block;
+  uint32_t written;
+  if (resync_active) {
+    block = resync_block;
+    written = block_samples - remaining;
+  } else if (pool_active) {
+    block = (stream->CR & DMA_SxCR_CT) ? 1U : 0U;
+    written = block_samples - remaining;
+  } else {
+    const uint32_t pass = 2U * block_samples;
+    const uint32_t done = (pass - remaining) % pass;
+    block = (uint8_t)(done / block_samples);
+    written = done % block_samples;
+  }
+  if (written >= block_samples) {
+    block ^= 1U; // a finished single pass
+    written = 0;
+  }
+  const uint8_t pending = (block != dma_next_block);
+
+  // Resume at the frame due next; the one cut short is lost either way
+  const uint32_t good = written / ADC_CONVERSIONS_CHANNEL_COUNT;
+  uint32_t resume = (written + ADC_CONVERSIONS_CHANNEL_COUNT - 1U) /
+                    ADC_CONVERSIONS_CHANNEL_COUNT;
+  if (acq_mode == ADC_ACQ_MODE_DMA_TIMER && timing_blocks != 0U) {
+    const int64_t due =
+        (int64_t)((now - last_block.timestamp) * sample_rate_hz /
+                  TIMEBASE_TICK_HZ) -
+        (pending ? (int64_t)block_frames : 0);
+    if (due > (int64_t)resume) {
+      resume = (uint32_t)due;
+    }
+  }
+  const uint8_t finish = (resume >= block_frames);
+  const uint32_t gap_stop = finish ? block_frames : resume;
+  const uint32_t skipped = finish ? resume - block_frames : 0U;
+
+  // Hold the last valid frame over the gap, written back before the DMA
+  // can reach a shared cache line again
+  uint16_t *data = analogSensor_dmaBlock(block);
+  SCB_InvalidateDCache_by_Addr((uint32_t *)data,
+                               block_samples * sizeof(uint16_t));
+  uint16_t held[ADC_CONVERSIONS_CHANNEL_COUNT];
+  for (uint8_t i = 0; i < ADC_CONVERSIONS_CHANNEL_COUNT; i++) {
+    held[i] = (good != 0U)
+                  ? data[(good - 1U) * ADC_CONVERSIONS_CHANNEL_COUNT + i]
+                  : default_ctx.frame.samples[active_order[i]];
+  }
+  for (uint32_t f = good; f < gap_stop; f++) {
+    memcpy(&data[f * ADC_CONVERSIONS_CHANNEL_COUNT], held, sizeof(held));
+  }
+  SCB_CleanDCache_by_Addr((uint32_t *)data,
+                          block_samples * sizeof(uint16_t));
+
+  // Detach what is handed off below before the stream may reuse a target
+  BlockPool_Block_t *pending_done = NULL;
+  BlockPool_Block_t *finish_done = NULL;
+  const uint16_t *pending_data =
+      pending ? analogSensor_takeBlock(hdma, block ^ 1U, &pending_done) : NULL;
+  const uint16_t *finish_data =
+      finish ? analogSensor_takeBlock(hdma, block, &finish_done) : NULL;
+  analogSensor_armStream(hdma, finish ? block ^ 1U : block,
+                         finish ? 0U : resume);
+
+  // RM0385: with the DMA re-initialised, clear OVR and re-enable requests;
+  // the next trigger starts the sequence at rank 1
+  for (uint8_t k = 0; k < scan_adc_count[multimode]; k++) {
+    __HAL_ADC_CLEAR_FLAG(scan_adcs[k], ADC_FLAG_OVR);
+  }
+  if (multimode == ADC_MULTI_INDEPENDENT) {
+    CLEAR_BIT(hadc1.Instance->CR2, ADC_CR2_DMA);
+    SET_BIT(hadc1.Instance->CR2, ADC_CR2_DMA);
+  } else {
+    const uint32_t dma_mode = ADC->CCR & ADC_CCR_DMA;
+    CLEAR_BIT(ADC->CCR, ADC_CCR_DMA);
+    SET_BIT(ADC->CCR, dma_mode);
+  }
+  if ((hadc1.Instance->CR2 & ADC_CR2_EXTEN) == 0U) {
+    SET_BIT(hadc1.Instance->CR2, ADC_CR2_SWSTART);
+  }
+  __set_PRIMASK(primask);
+
+  const uint32_t cycles = profiler_now() - t0;
+  profiler_record(PROFILER_PROBE_OVERRUN, cycles);
+  overrun_info.recoveries++;
+  overrun_info.last_gap_sequence =
+      frame_sequence + (pending ? block_frames : 0U) + good;
+  overrun_info.last_gap_frames = gap_stop - good + skipped;
+  overrun_info.frames_lost += overrun_info.last_gap_frames;
+  overrun_info.last_cycles = cycles;
+  eventLog_write(EVENT_LOG_OVERRUN, 0, overrun_info.last_gap_frames);
+  retained_add(RETAINED_OVERRUN_FRAMES, overrun_info.last_gap_frames);
+  if (cycles > overrun_info.max_cycles) {
+    overrun_info.max_cycles = cycles;
+  }
+
+  // The DMA interrupt cannot pre-empt: blocks leave in order
+  if (pending) {
+    analogSensor_handOff(pending_data, pending_done);
+  }
+  // A second overrun in the same block widens its gap
+  if (gap_block != data) {
+    gap_block = data;
+    gap_first = good;
+  }
+  gap_end = gap_stop;
+  if (finish) {
+    analogSensor_handOff(finish_data, finish_done);
+    frame_sequence += skipped;
+  }
+}
+
+/**
+ * @brief Return the DMA's own blocks, after the scan stopped or before it
+ *        takes new ones; blocks consumers still hold keep their references
+ */
+static void analogSensor_stopPool(void) {
+  pool_active = 0;
+  for (uint8_t k = 0; k < 2U; k++) {
+    blockPool_release(pool_target[k]);
+    pool_target[k] = NULL;
+  }
+}
+
+/**
+ * @brief Re-arm the scan DMA, started by the HAL in circular mode, in
+ *        double-buffer mode on two pool blocks
+ *
+ * Only while the conversions wait for their first TIM2 trigger: the stream
+ * is briefly disabled. The pool itself is not reset: a consumer may still
+ * hold blocks of the last scan, so only the DMA's two are swapped for new
+ * ones, or for its own halves while none is free.
+ */
+static HAL_StatusTypeDef analogSensor_startPool(void) {
+  DMA_HandleTypeDef *hdma = hadc1.DMA_Handle;
+
+  analogSensor_stopPool();
+  pool_starved = 0;
+  uint16_t *target[2];
+  for (uint8_t k = 0; k < 2U; k++) {
+    pool_target[k] = blockPool_alloc();
+    if (pool_target[k] == NULL) {
+      pool_starved++;
+    }
+    target[k] = (pool_target[k] != NULL) ? blockPool_dmaTarget(pool_target[k])
+                                         : &adc_dma_buffer[k * block_samples];
+  }
+  uint32_t peripheral = hdma->Instance->PAR;
+  if (HAL_DMA_Abort(hdma) != HAL_OK) {
+    return HAL_ERROR;
+  }
+  for (uint8_t k = 0; k < 2U; k++) {
+    SCB_InvalidateDCache_by_Addr((uint32_t *)target[k],
+                                 block_samples * sizeof(uint16_t));
+  }
+  // The HAL handler calls these per target; no half-transfer interrupts
+  hdma->XferCpltCallback = analogSensor_poolM0Complete;
+  hdma->XferM1CpltCallback = analogSensor_poolM1Complete;
+  hdma->XferHalfCpltCallback = NULL;
+  hdma->XferM1HalfCpltCallback = NULL;
+  if (HAL_DMAEx_MultiBufferStart_IT(hdma, peripheral, (uint32_t)target[0],
+                                    (uint32_t)target[1],
+                                    block_samples) != HAL_OK) {
+    return HAL_ERROR;
+  }
+  pool_active = 1;
+  return HAL_OK;
+}
+
+/**
+ * @brief End replay mode: drop a block not yet handed off
+ */
+static void analogSensor_stopReplay(void) {
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  analogSensor_enterMode(ADC_ACQ_MODE_POLLING);
+  replay_data = NULL;
+  __set_PRIMASK(primask);
+  NVIC_ClearPendingIRQ(DMA2_Stream0_IRQn);
+  blockPool_release(replay_block);
+  replay_block = NULL;
+  replay_fill = NULL;
+  replay_stats.running = 0;
+  pool_active = 0;
+}
+
+/**
+ * @brief Start CYCCNT if nothing has yet: the EOC limits are counted on it
+ */
+static void analogSensor_enableCycleCounter(void) {
+  if (!(DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk)) {
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+  }
+}
+
+/**
+ * @brief Expected conversion time and EOC limit of every channel in CPU
+ *        cycles, for the current sampling times, resolution and clocks
+ *
+ * Also makes sure CYCCNT runs, since the limit is counted on it.
+ */
+static void analogSensor_buildConvTiming(void) {
+  analogSensor_enableCycleCounter();
+  const uint32_t adc_hz = analogSensor_adcClockHz();
+  const uint32_t bits = analogSensor_resolutionCycles(hadc1.Init.Resolution);
+  for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+    const uint64_t adc_cycles =
+        analogSensor_samplingCycles(sConfig[ch].SamplingTime) + bits;
+    const uint32_t expected =
+        (uint32_t)((adc_cycles * SystemCoreClock + adc_hz - 1U) / adc_hz);
+    conv_timing.expected_cycles[ch] = expected;
+    conv_timing.timeout_cycles[ch] = expected * ADC_CONVERSIONS_TIMEOUT_FACTOR +
+                                     ADC_CONVERSIONS_TIMEOUT_MARGIN_CYCLES;
+  }
+  conv_timing_hclk = SystemCoreClock;
+}
+
+/**
+ * @brief Rebuild the timing table if the profiles or the core clock moved
+ */
+static inline void analogSensor_prepareConvTiming(void) {
+  if (conv_timing_hclk != SystemCoreClock) {
+    analogSensor_buildConvTiming();
+  }
+}
+
+/**
+ * @brief Wait for the EOC of a started ADC1 conversion, bounded by the
+ *        channel's cycle limit, and file the time taken in the histogram
+ *
+ * The timing status is main-loop only, like the polling reads themselves.
+ */
+static HAL_StatusTypeDef analogSensor_waitEOC(uint8_t ch, uint32_t start) {
+  const uint32_t limit = conv_timing.timeout_cycles[ch];
+  uint32_t elapsed = 0;
+  while (!LL_ADC_IsActiveFlag_EOCS(ADC1)) {
+    elapsed = DWT->CYCCNT - start;
+    if (elapsed > limit) {
+      conv_timing.timeouts++;
+      return HAL_TIMEOUT;
+    }
+  }
+  elapsed = DWT->CYCCNT - start;
+
+  uint32_t bin = elapsed * 4U / conv_timing.expected_cycles[ch];
+  if (bin >= ADC_CONV_TIMING_BINS) {
+    bin = ADC_CONV_TIMING_BINS - 1U;
+  }
+  conv_timing.histogram[bin]++;
+  if (conv_timing.count == 0U || elapsed < conv_timing.min_cycles) {
+    conv_timing.min_cycles = elapsed;
+  }
+  if (elapsed > conv_timing.max_cycles) {
+    conv_timing.max_cycles = elapsed;
+  }
+  conv_timing.count++;
+  return HAL_OK;
+}
+
+/**
+ * @brief Polling read through HAL: channel selection, start, EOC wait, stop
+ *
+ * The EOC wait is the shared cycle-bounded one rather than
+ * HAL_ADC_PollForConversion(), whose limit is whole HAL_GetTick() ms.
+ */
+static HAL_StatusTypeDef analogSensor_pollHAL(uint8_t ch, uint16_t *value,
+                                              ADC_SampleError_t *error) {
+  HAL_StatusTypeDef status;
+
+  analogSensor_usePollingProfiles();
+  // using with static array to avoid runtime mutation issues and
+  // misconfigurations
+  uint32_t t0 = profiler_begin();
+#if ADC_CONVERSIONS_FAST_CONFIG
+  analogSensor_loadChannel(ch);
+  status = HAL_OK;
+#else
+  status = HAL_ADC_ConfigChannel(&hadc1, &sConfig[ch]);
+#endif
+  profiler_end(PROFILER_PROBE_CONFIG, t0);
+  if (status != HAL_OK) {
+    *error = ADC_SAMPLE_ERROR_CONFIG;
+    return status;
+  }
+
+  analogSensor_prepareConvTiming();
+  t0 = profiler_begin();
+  status = HAL_ADC_Start(&hadc1);
+  profiler_end(PROFILER_PROBE_START, t0);
+  if (status != HAL_OK) {
+    *error = ADC_SAMPLE_ERROR_START;
+    return status;
+  }
+
+  t0 = profiler_begin();
+  status = analogSensor_waitEOC(ch, DWT->CYCCNT);
+  profiler_end(PROFILER_PROBE_POLL, t0);
+  if (status != HAL_OK) {
+    *error = ADC_SAMPLE_ERROR_TIMEOUT;
+    HAL_ADC_Stop(&hadc1);
+    return status;
+  }
+
+  *value = analogSensor_rescaleCode(HAL_ADC_GetValue(&hadc1),
+                                    hadc1.Init.Resolution);
+  HAL_ADC_Stop(&hadc1);
+  *error = ADC_SAMPLE_OK;
+  return HAL_OK;
+}
+
+/**
+ * @brief EOC limits of an instance's channels in CPU cycles, as
+ *        analogSensor_buildConvTiming() works them out for ADC1
+ */
+static void analogSensor_ctxBuildTimeouts(ADC_SensorCtx_t *ctx) {
+  analogSensor_enableCycleCounter();
+  const uint32_t adc_hz = analogSensor_adcClockHz(); // common prescaler
+  const uint32_t bits =
+      analogSensor_resolutionCycles(ctx->hadc->Init.Resolution);
+  for (uint8_t ch = 0; ch < ctx->channel_count; ch++) {
+    const uint64_t adc_cycles =
+        analogSensor_samplingCycles(ctx->channels[ch].SamplingTime) + bits;
+    const uint32_t expected =
+        (uint32_t)((adc_cycles * SystemCoreClock + adc_hz - 1U) / adc_hz);
+    ctx->timeout_cycles[ch] = expected * ADC_CONVERSIONS_TIMEOUT_FACTOR +
+                              ADC_CONVERSIONS_TIMEOUT_MARGIN_CYCLES;
+  }
+  ctx->timeout_hclk = SystemCoreClock;
+}
+
+/**
+ * @brief Whether the default instance is converting on an ADC: the slaves
+ *        of a multimode scan, or all three during a capture
+ */
+static uint8_t analogSensor_adcBusy(const ADC_HandleTypeDef *hadc) {
+  const ADC_AcqMode_t mode = acq_mode;
+  if (mode == ADC_ACQ_MODE_CAPTURE) {
+    return 1;
+  }
+  if (mode == ADC_ACQ_MODE_POLLING || mode == ADC_ACQ_MODE_SEQUENCE ||
+      mode == ADC_ACQ_MODE_REPLAY || mode == ADC_ACQ_MODE_GROUPED) {
+    return 0;
+  }
+  for (uint8_t k = 0; k < scan_adc_count[multimode]; k++) {
+    if (scan_adcs[k]->Instance == hadc->Instance) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/**
+ * @brief Polling read of an instance on its own ADC: rank 1 in single
+ *        conversion, start, cycle-bounded EOC wait, stop
+ *
+ * SCAN, CONT and the sequence length are cleared in the registers only, so
+ * the handle's Init still describes the scan the driver restores with
+ * HAL_ADC_Init() before a multimode start.
+ */
+static HAL_StatusTypeDef analogSensor_ctxPoll(ADC_SensorCtx_t *ctx, uint8_t ch,
+                                             uint16_t *value,
+                                             ADC_SampleError_t *error) {
+  ADC_HandleTypeDef *hadc = ctx->hadc;
+  ADC_TypeDef *adc = hadc->Instance;
+  ADC_ChannelConfTypeDef config = ctx->channels[ch];
+  config.Rank = ADC_REGULAR_RANK_1;
+  HAL_StatusTypeDef status = HAL_ADC_ConfigChannel(hadc, &config);
+  if (status != HAL_OK) {
+    *error = ADC_SAMPLE_ERROR_CONFIG;
+    return status;
+  }
+  CLEAR_BIT(adc->CR1, ADC_CR1_SCAN);
+  CLEAR_BIT(adc->CR2, ADC_CR2_CONT | ADC_CR2_EXTEN);
+  MODIFY_REG(adc->SQR1, ADC_SQR1_L, 0U);
+
+  if (ctx->timeout_hclk != SystemCoreClock) {
+    analogSensor_ctxBuildTimeouts(ctx);
+  }
+  status = HAL_ADC_Start(hadc);
+  if (status != HAL_OK) {
+    *error = ADC_SAMPLE_ERROR_START;
+    return status;
+  }
+  const uint32_t start = DWT->CYCCNT;
+  const uint32_t limit = ctx->timeout_cycles[ch];
+  while (!(adc->SR & ADC_SR_EOC)) {
+    if (DWT->CYCCNT - start > limit) {
+      HAL_ADC_Stop(hadc);
+      *error = ADC_SAMPLE_ERROR_TIMEOUT;
+      return HAL_TIMEOUT;
+    }
+  }
+  *value = analogSensor_rescaleCode(HAL_ADC_GetValue(hadc),
+                                    hadc->Init.Resolution);
+  HAL_ADC_Stop(hadc);
+  *error = ADC_SAMPLE_OK;
+  return HAL_OK;
+}
+
+/**
+ * @brief Put ADC1 into single-conversion, one-rank mode and keep it enabled
+ *
+ * Only touches the registers when the state differs, so back-to-back reads
+ * pay one CR2/SQR1 check.
+ */
+static void analogSensor_prepareLL(void) {
+  if ((ADC1->CR2 & (ADC_CR2_ADON | ADC_CR2_CONT)) == ADC_CR2_ADON &&
+      LL_ADC_REG_GetSequencerLength(ADC1) == LL_ADC_REG_SEQ_SCAN_DISABLE) {
+    return;
+  }
+
+  LL_ADC_REG_SetContinuousMode(ADC1, LL_ADC_REG_CONV_SINGLE);
+  LL_ADC_REG_SetSequencerLength(ADC1, LL_ADC_REG_SEQ_SCAN_DISABLE);
+  if (!LL_ADC_IsEnabled(ADC1)) {
+    LL_ADC_Enable(ADC1);
+    // tSTAB before the first conversion
+    uint32_t start = DWT->CYCCNT;
+    uint32_t stab = ADC_STAB_DELAY_US * (SystemCoreClock / 1000000U);
+    while (DWT->CYCCNT - start < stab) {
+    }
+  }
+}
+
+/**
+ * @brief Hand ADC1 back to the HAL: sequence and continuous mode of
+ *        hadc1.Init, converter off (as after HAL_ADC_Stop())
+ */
+static void analogSensor_releaseLL(void) {
+  LL_ADC_Disable(ADC1);
+  LL_ADC_REG_SetContinuousMode(ADC1, hadc1.Init.ContinuousConvMode
+                                         ? LL_ADC_REG_CONV_CONTINUOUS
+                                         : LL_ADC_REG_CONV_SINGLE);
+  MODIFY_REG(ADC1->SQR1, ADC_SQR1_L, ADC_SQR1(hadc1.Init.NbrOfConversion));
+}
+
+/**
+ * @brief Polling read on the registers: select, SWSTART, EOC wait, read
+ *
+ * No HAL state machine and no lock; the EOC wait is the same cycle-bounded
+ * one as the HAL backend's.
+ */
+static HAL_StatusTypeDef analogSensor_pollLL(uint8_t ch, uint16_t *value,
+                                             ADC_SampleError_t *error) {
+  analogSensor_usePollingProfiles();
+  analogSensor_prepareLL();
+  analogSensor_prepareConvTiming();
+  analogSensor_loadChannel(ch);
+  LL_ADC_ClearFlag_EOCS(ADC1);
+  LL_ADC_ClearFlag_OVR(ADC1);
+  LL_ADC_REG_StartConversionSWStart(ADC1);
+
+  if (analogSensor_waitEOC(ch, DWT->CYCCNT) != HAL_OK) {
+    *error = ADC_SAMPLE_ERROR_TIMEOUT;
+    return HAL_TIMEOUT;
+  }
+
+  *value = analogSensor_rescaleCode(LL_ADC_REG_ReadConversionData12(ADC1),
+                                    hadc1.Init.Resolution);
+  *error = ADC_SAMPLE_OK;
+  return HAL_OK;
+}
+
+/**
+ * @brief ADCCLK cycles of one weighted-sequence scan, each rank at its
+ *        channel's own profile sampling time
+ */
+static uint32_t analogSensor_sequenceCycles(uint32_t adc_hz) {
+  const uint32_t bits = analogSensor_resolutionCycles(adc_resolution[0]);
+  uint32_t cycles = 0;
+  for (uint8_t r = 0; r < sequence.ranks; r++) {
+    uint8_t i = analogSensor_pickSamplingTime(
+        &channel_profile[sequence.channel[r]], adc_hz);
+    cycles += analogSensor_samplingCycles(sampling_times[i]) + bits;
+  }
+  return cycles;
+}
+
+/**
+ * @brief Program ADC1 with the weighted sequence on the TIM2 trigger
+ *
+ * Sampling times come from the independent layout's profiles; a channel
+ * repeated at several ranks has one SMPR entry, so one sampling time.
+ */
+static HAL_StatusTypeDef analogSensor_configSequence(void) {
+  analogSensor_applyProfiles(ADC_MULTI_INDEPENDENT);
+  hadc1.Init.NbrOfConversion = sequence.ranks;
+  HAL_StatusTypeDef status = analogSensor_configTrigger(1);
+  for (uint8_t r = 0; r < sequence.ranks && status == HAL_OK; r++) {
+    ADC_ChannelConfTypeDef rank_config = sConfig[sequence.channel[r]];
+    rank_config.Rank = ADC_REGULAR_RANK_1 + r;
+    status = HAL_ADC_ConfigChannel(&hadc1, &rank_config);
+  }
+  return status;
+}
+
+/**
+ * @brief Hand off one completed half of the weighted-sequence buffer
+ * @note Called from DMA interrupt context
+ */
+ADC_FAST_CODE static void analogSensor_sequenceComplete(uint8_t half) {
+  uint32_t t0 = profiler_begin();
+  const uint32_t samples = ADC_CONVERSIONS_SEQUENCE_SCANS * sequence.ranks;
+  uint16_t *scans = &sequence_buffer[half * samples];
+  SCB_InvalidateDCache_by_Addr((uint32_t *)scans, samples * sizeof(uint16_t));
+  const uint32_t bits = analogSensor_resolutionCycles(hadc1.Init.Resolution);
+  if (bits != ADC_SAMPLE_BITS) {
+    analogSensor_rescaleSamples(scans, samples, bits);
+  }
+
+  // Later ranks of a repeated channel are newer
+  const uint16_t *newest = &scans[samples - sequence.ranks];
+  for (uint8_t r = 0; r < sequence.ranks; r++) {
+    analogSensor_storeSample(sequence.channel[r], newest[r]);
+  }
+  const ADC_Frame_t frame = default_ctx.frame;
+  sequence_scans += ADC_CONVERSIONS_SEQUENCE_SCANS;
+  analogSensor_publishFrame(&frame, sequence_scans - 1U, timebase_now());
+  if (sequence_callback != NULL) {
+    sequence_callback(scans, ADC_CONVERSIONS_SEQUENCE_SCANS, &sequence,
+                      sequence_callback_ctx);
+  }
+  profiler_end(PROFILER_PROBE_DMA_CALLBACK, t0);
+}
+
+/**
+ * @brief Longest group of the grouped scan in ADCCLK cycles, 0 if the size
+ *        does not split the table
+ */
+static uint32_t analogSensor_groupCycles(uint8_t size, uint32_t adc_hz) {
+  if (size == 0U || size > ADC_GROUP_MAX_SIZE ||
+      ADC_CONVERSIONS_CHANNEL_COUNT % size != 0U) {
+    return 0U;
+  }
+  const uint32_t bits = analogSensor_resolutionCycles(adc_resolution[0]);
+  uint32_t longest = 0;
+  for (uint8_t first = 0; first < ADC_CONVERSIONS_CHANNEL_COUNT;
+       first += size) {
+    uint32_t cycles = 0;
+    for (uint8_t ch = first; ch < first + size; ch++) {
+      uint8_t i = analogSensor_pickSamplingTime(&channel_profile[ch], adc_hz);
+      cycles += analogSensor_samplingCycles(sampling_times[i]) + bits;
+    }
+    if (cycles > longest) {
+      longest = cycles;
+    }
+  }
+  return longest;
+}
+
+/**
+ * @brief Program ADC1 with the table order in discontinuous groups on the
+ *        TIM2 trigger
+ */
+static HAL_StatusTypeDef analogSensor_configGrouped(uint8_t size) {
+  analogSensor_applyProfiles(ADC_MULTI_INDEPENDENT);
+  hadc1.Init.NbrOfConversion = ADC_CONVERSIONS_CHANNEL_COUNT;
+  hadc1.Init.DiscontinuousConvMode = ENABLE;
+  hadc1.Init.NbrOfDiscConversion = size;
+  HAL_StatusTypeDef status = analogSensor_configTrigger(1);
+  for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT && status == HAL_OK;
+       ch++) {
+    ADC_ChannelConfTypeDef rank_config = sConfig[ch];
+    rank_config.Rank = ADC_REGULAR_RANK_1 + ch;
+    status = HAL_ADC_ConfigChannel(&hadc1, &rank_config);
+  }
+  return status;
+}
+
+/**
+ * @brief Hand off the group that ended in one half of the group buffer
+ * @note Called from DMA interrupt context
+ */
+ADC_FAST_CODE static void analogSensor_groupComplete(uint8_t half) {
+  uint32_t t0 = profiler_begin();
+  // Both halves share one cache line; the CPU never writes it
+  SCB_InvalidateDCache_by_Addr((uint32_t *)group_buffer, sizeof(group_buffer));
+  uint16_t *samples = &group_buffer[half * group_len];
+  const uint32_t bits = analogSensor_resolutionCycles(hadc1.Init.Resolution);
+  if (bits != ADC_SAMPLE_BITS) {
+    analogSensor_rescaleSamples(samples, group_len, bits);
+  }
+
+  const uint8_t group = group_next;
+  const uint8_t first = (uint8_t)(group * group_len);
+  for (uint8_t i = 0; i < group_len; i++) {
+    analogSensor_storeSample(first + i, samples[i]);
+  }
+  group_next = (group + 1U < group_count) ? (uint8_t)(group + 1U) : 0U;
+  if (group_callback != NULL) {
+    group_callback(group, samples, group_len, group_frames,
+                   group_callback_ctx);
+  }
+  if (group_next == 0U) {
+    const ADC_Frame_t frame = default_ctx.frame;
+    analogSensor_publishFrame(&frame, group_frames, timebase_now());
+    group_frames++;
+  }
+  profiler_end(PROFILER_PROBE_DMA_CALLBACK, t0);
+}
+
+/**
+ * @brief Report the request in flight and drop it from the queue
+ * @note Interrupts masked, or the ADC interrupt
+ */
+static void analogSensor_asyncFinish(uint16_t value, ADC_SampleError_t error,
+                                     HAL_StatusTypeDef status) {
+  const ADC_AsyncRequest_t req =
+      async_queue[async_tail % ADC_CONVERSIONS_ASYNC_DEPTH];
+  async_tail++;
+  async_active = 0;
+  async_regular = 0;
+
+  if (error == ADC_SAMPLE_OK) {
+    analogSensor_storeSample(req.channel, value);
+  } else {
+    analogSensor_storeError(req.channel, error, status);
+  }
+  if (req.callback != NULL) {
+    req.callback(req.channel, value, error, req.ctx);
+  }
+}
+
+static void analogSensor_asyncKick(void);
+
+/**
+ * @brief Injected result of an asynchronous request
+ */
+static void analogSensor_asyncInjectedDone(uint8_t channel, uint16_t value,
+                                           void *ctx) {
+  (void)channel;
+  (void)ctx;
+  analogSensor_asyncFinish(value, ADC_SAMPLE_OK, HAL_OK);
+  analogSensor_asyncKick();
+}
+
+/**
+ * @brief Select an ADC1 channel as the polling read does and start it with
+ *        the EOC interrupt
+ */
+static HAL_StatusTypeDef analogSensor_asyncStartRegular(
+    uint8_t ch, ADC_SampleError_t *error) {
+  analogSensor_usePollingProfiles();
+#if ADC_CONVERSIONS_FAST_CONFIG
+  analogSensor_loadChannel(ch);
+#else
+  if (HAL_ADC_ConfigChannel(&hadc1, &sConfig[ch]) != HAL_OK) {
+    *error = ADC_SAMPLE_ERROR_CONFIG;
+    return HAL_ERROR;
+  }
+#endif
+  if (HAL_ADC_Start_IT(&hadc1) != HAL_OK) {
+    *error = ADC_SAMPLE_ERROR_START;
+    return HAL_ERROR;
+  }
+  return HAL_OK;
+}
+
+/**
+ * @brief Start queued requests until one is in flight or the queue is empty
+ *
+ * A request that cannot start is reported failed at once and the next one
+ * tried, so a HAL error never stalls the queue.
+ *
+ * @note Interrupts masked, or the ADC interrupt
+ */
+static void analogSensor_asyncKick(void) {
+  while (!async_active && !async_hold && async_tail != async_head) {
+    const uint8_t ch =
+        async_queue[async_tail % ADC_CONVERSIONS_ASYNC_DEPTH].channel;
+    ADC_SampleError_t error = ADC_SAMPLE_ERROR_START;
+    HAL_StatusTypeDef status;
+
+    async_active = 1;
+    async_started_ms = HAL_GetTick();
+    if (acq_mode == ADC_ACQ_MODE_POLLING && analogSensor_pollAdc(ch) == 0U) {
+      status = analogSensor_asyncStartRegular(ch, &error);
+      async_regular = (status == HAL_OK);
+    } else {
+      // The scan keeps the regular group; ADC3's pins use its injected one
+      status = analogSensor_startInjected(ch, analogSensor_asyncInjectedDone,
+                                          NULL);
+    }
+    if (status != HAL_OK) {
+      analogSensor_asyncFinish(0, error, status);
+    }
+  }
+}
+
+/**
+ * @brief Fail the request in flight if its result is overdue
+ * @note Interrupts masked
+ */
+static void analogSensor_asyncExpire(void) {
+  if (!async_active ||
+      HAL_GetTick() - async_started_ms <= ADC_POLL_TIMEOUT_MS) {
+    return;
+  }
+  if (async_regular) {
+    __HAL_ADC_DISABLE_IT(&hadc1, ADC_IT_EOC | ADC_IT_OVR);
+  } else {
+    __HAL_ADC_DISABLE_IT(injected_adc, ADC_IT_JEOC);
+    injected_busy = 0;
+  }
+  analogSensor_asyncFinish(0, ADC_SAMPLE_ERROR_TIMEOUT, HAL_TIMEOUT);
+}
+
+/**
+ * @brief Keep the queue off the ADC for a blocking read: wait for the
+ *        request in flight, bounded by the polling timeout
+ */
+static void analogSensor_asyncHold(void) {
+  async_hold = 1;
+  const uint32_t start = HAL_GetTick();
+  while (async_active && HAL_GetTick() - start <= ADC_POLL_TIMEOUT_MS) {
+  }
+  const uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  analogSensor_asyncExpire();
+  __set_PRIMASK(primask);
+}
+
+/**
+ * @brief Let the queue run again after a blocking read
+ */
+static void analogSensor_asyncRelease(void) {
+  const uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  async_hold = 0;
+  analogSensor_asyncKick();
+  __set_PRIMASK(primask);
+}
+
+/**
+ * @brief One blocking conversion, the queue held off
+ */
+static void analogSensor_operationBlocking(uint8_t snsrID) {
+  HAL_StatusTypeDef status;
+
+  if (acq_mode == ADC_ACQ_MODE_CAPTURE) {
+    return;
+  }
+
+  if (snsrID >= ADC_CONVERSIONS_CHANNEL_COUNT) {
+    analogSensor_countError(snsrID, ADC_ERROR_KIND_CONFIG, HAL_ERROR);
+    return;
+  }
+
+  // The scan owns the regular group: go through the injected group instead
+  if (acq_mode != ADC_ACQ_MODE_POLLING) {
+    uint16_t value = 0;
+    status = analogSensor_readInjected(snsrID, &value);
+    if (status == HAL_OK) {
+      analogSensor_storeSample(snsrID, value);
+    } else {
+      analogSensor_storeError(snsrID,
+                              (status == HAL_TIMEOUT) ? ADC_SAMPLE_ERROR_TIMEOUT
+                                                      : ADC_SAMPLE_ERROR_START,
+                              status);
+    }
+    return;
+  }
+
+  uint16_t value = 0;
+  ADC_SampleError_t error;
+  uint32_t t0 = profiler_begin();
+#if !ADC_CHANNELS_ALL_ADC12
+  if (analogSensor_pollAdc(snsrID) != 0U) {
+    analogSensor_usePollingProfiles();
+    status = analogSensor_ctxPoll(&adc3_ctx, snsrID, &value, &error);
+    profiler_end(PROFILER_PROBE_READ_HAL, t0);
+  } else
+#endif
+  {
+#if ADC_CONVERSIONS_LL_POLLING
+    status = analogSensor_pollLL(snsrID, &value, &error);
+    profiler_end(PROFILER_PROBE_READ_LL, t0);
+#else
+    status = analogSensor_pollHAL(snsrID, &value, &error);
+    profiler_end(PROFILER_PROBE_READ_HAL, t0);
+#endif
+  }
+  if (status != HAL_OK) {
+    analogSensor_storeError(snsrID, error, status);
+    return;
+  }
+  analogSensor_storeSample(snsrID, value);
+}
+
+/**
+ * @brief File the cycles since the DMA vector was entered against a path
+ */
+ADC_FAST_CODE static void analogSensor_fileDispatch(ADC_DmaDispatch_t path) {
+  if (!dma_irq_stamped) {
+    return;
+  }
+  dma_irq_stamped = 0;
+  const uint32_t cycles = DWT->CYCCNT - dma_irq_entry;
+  ADC_DmaDispatchStats_t *stats = &dma_dispatch[path];
+  stats->count++;
+  stats->total += cycles;
+  if (cycles > stats->max) {
+    stats->max = cycles;
+  }
+}
+
+/**
+ * @brief Hand off one half of the circular scan buffer (weighted sequence,
+ *        group or ping-pong blocks)
+ * @note Called from DMA interrupt context
+ */
+ADC_FAST_CODE static void analogSensor_scanHalf(uint8_t half) {
+  if (acq_mode == ADC_ACQ_MODE_SEQUENCE) {
+    analogSensor_sequenceComplete(half);
+    return;
+  }
+  if (acq_mode == ADC_ACQ_MODE_GROUPED) {
+    analogSensor_groupComplete(half);
+    return;
+  }
+  dma_next_block = half ^ 1U;
+  analogSensor_blockComplete(&adc_dma_buffer[half * block_samples]);
+}
+
+/* Public functions ----------------------------------------------------------*/
+
+void analogSensor_operation(uint8_t snsrID) {
+  analogSensor_asyncHold();
+  analogSensor_operationBlocking(snsrID);
+  analogSensor_asyncRelease();
+}
+
+HAL_StatusTypeDef analogSensor_operation_async(uint8_t channel,
+                                               ADC_AsyncCallback_t callback,
+                                               void *ctx) {
+  if (channel >= ADC_CONVERSIONS_CHANNEL_COUNT) {
+    return HAL_ERROR;
+  }
+  if (acq_mode == ADC_ACQ_MODE_CAPTURE) {
+    return HAL_BUSY;
+  }
+
+  HAL_StatusTypeDef status = HAL_BUSY;
+  const uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  analogSensor_asyncExpire();
+  if (async_head - async_tail < ADC_CONVERSIONS_ASYNC_DEPTH) {
+    async_queue[async_head % ADC_CONVERSIONS_ASYNC_DEPTH] =
+        (ADC_AsyncRequest_t){channel, callback, ctx};
+    async_head++;
+    analogSensor_asyncKick();
+    status = HAL_OK;
+  }
+  __set_PRIMASK(primask);
+  return status;
+}
+
+uint32_t analogSensor_asyncPending(void) {
+  return async_head - async_tail;
+}
+
+void analogSensor_operation_all_channels(uint8_t total_channels) {
+  if (acq_mode != ADC_ACQ_MODE_POLLING) {
+    return;
+  }
+  if (total_channels > ADC_CONVERSIONS_CHANNEL_COUNT) {
+    total_channels = ADC_CONVERSIONS_CHANNEL_COUNT;
+  }
+  for (uint8_t i = 0; i < total_channels; i++) {
+    analogSensor_operation(i);
+  }
+  analogSensor_ctxPublishPolled(&default_ctx);
+}
+
+void analogSensor_operation_channels(ADC_ChannelMask_t channel_mask) {
+  if (acq_mode != ADC_ACQ_MODE_POLLING) {
+    return;
+  }
+  for (uint8_t i = 0; i < ADC_CONVERSIONS_CHANNEL_COUNT; i++) {
+    if (channel_mask & (1UL << i)) {
+      analogSensor_operation(i);
+    }
+  }
+  analogSensor_ctxPublishPolled(&default_ctx);
+}
+
+HAL_StatusTypeDef analogSensor_benchmarkBackends(uint16_t rounds) {
+  HAL_StatusTypeDef status = HAL_OK;
+
+  if (acq_mode != ADC_ACQ_MODE_POLLING) {
+    return HAL_BUSY;
+  }
+
+  // Same channels, same order, results discarded: only the probes change.
+  // Both backends are ADC1's, so ADC3-only channels are left out.
+  for (uint16_t r = 0; r < rounds; r++) {
+    for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+      if (analogSensor_pollAdc(ch) != 0U) {
+        continue;
+      }
+      uint16_t value;
+      ADC_SampleError_t error;
+      uint32_t t0 = profiler_begin();
+      if (analogSensor_pollHAL(ch, &value, &error) != HAL_OK) {
+        status = HAL_ERROR;
+      }
+      profiler_end(PROFILER_PROBE_READ_HAL, t0);
+    }
+  }
+  for (uint16_t r = 0; r < rounds; r++) {
+    for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+      if (analogSensor_pollAdc(ch) != 0U) {
+        continue;
+      }
+      uint16_t value;
+      ADC_SampleError_t error;
+      uint32_t t0 = profiler_begin();
+      if (analogSensor_pollLL(ch, &value, &error) != HAL_OK) {
+        status = HAL_ERROR;
+      }
+      profiler_end(PROFILER_PROBE_READ_LL, t0);
+    }
+  }
+
+#if !ADC_CONVERSIONS_LL_POLLING
+  analogSensor_releaseLL();
+#endif
+  return status;
+}
+
+HAL_StatusTypeDef analogSensor_startDMA(void) {
+  if (acq_mode != ADC_ACQ_MODE_POLLING) {
+    return HAL_BUSY;
+  }
+
+  if (analogSensor_startScanDMA(0) != HAL_OK) {
+    return HAL_ERROR;
+  }
+
+  analogSensor_enterMode(ADC_ACQ_MODE_DMA_CIRCULAR);
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef analogSensor_startTimedDMA(uint32_t frame_rate_hz) {
+  HAL_StatusTypeDef status;
+
+  if (acq_mode != ADC_ACQ_MODE_POLLING) {
+    return HAL_BUSY;
+  }
+
+  // Load the period while the ADC is not armed: the update event generated
+  // here also pulses TRGO. An external trigger runs at its own rate.
+  const uint8_t use_tim2 = (scan_trigger == ADC_SCAN_TRIGGER_TIM2);
+  if (use_tim2) {
+    if (analogSensor_setSampleRate(frame_rate_hz) != HAL_OK) {
+      return HAL_ERROR;
+    }
+    HAL_TIM_GenerateEvent(&htim2, TIM_EVENTSOURCE_UPDATE);
+  } else if (!analogSensor_rateFits(frame_rate_hz)) {
+    return HAL_ERROR;
+  } else {
+    sample_rate_hz = frame_rate_hz;
+  }
+
+  if (analogSensor_configTrigger(1) != HAL_OK ||
+      analogSensor_startScanDMA(0) != HAL_OK) {
+    hadc1.Init.NbrOfConversion = ADC_POLL_RANKS;
+    analogSensor_configTrigger(0);
+    return HAL_ERROR;
+  }
+  if (pool_enabled && analogSensor_startPool() != HAL_OK) {
+    analogSensor_countError(0xFF, ADC_ERROR_KIND_START, HAL_ERROR);
+    analogSensor_stopScan();
+    analogSensor_stopPool();
+    hadc1.Init.NbrOfConversion = ADC_POLL_RANKS;
+    analogSensor_configTrigger(0);
+    return HAL_ERROR;
+  }
+
+  status = use_tim2 ? HAL_TIM_Base_Start(&htim2) : HAL_OK;
+  if (status != HAL_OK) {
+    analogSensor_stopScan();
+    analogSensor_stopPool();
+    analogSensor_configTrigger(0);
+    return HAL_ERROR;
+  }
+
+  analogSensor_enterMode(ADC_ACQ_MODE_DMA_TIMER);
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef analogSensor_setSampleRate(uint32_t frame_rate_hz) {
+  if (scan_trigger != ADC_SCAN_TRIGGER_TIM2 ||
+      !analogSensor_rateFits(frame_rate_hz)) {
+    return HAL_ERROR;
+  }
+  return analogSensor_loadTimerPeriod(frame_rate_hz);
+}
+
+HAL_StatusTypeDef analogSensor_setScanTrigger(ADC_ScanTrigger_t source) {
+  if ((uint32_t)source >=
+      sizeof(scan_trigger_conv) / sizeof(scan_trigger_conv[0])) {
+    return HAL_ERROR;
+  }
+  if (acq_mode != ADC_ACQ_MODE_POLLING) {
+    return HAL_BUSY;
+  }
+  scan_trigger = source;
+  return HAL_OK;
+}
+
+ADC_ScanTrigger_t analogSensor_getScanTrigger(void) { return scan_trigger; }
+
+uint32_t analogSensor_getSampleRate(void) { return sample_rate_hz; }
+
+HAL_StatusTypeDef analogSensor_setClockPrescaler(uint32_t clock_prescaler) {
+  if (acq_mode != ADC_ACQ_MODE_POLLING) {
+    return HAL_BUSY;
+  }
+  if (!IS_ADC_CLOCKPRESCALER(clock_prescaler) ||
+      analogSensor_prescalerClockHz(clock_prescaler) > ADC_CLOCK_MAX_HZ) {
+    return HAL_ERROR;
+  }
+  for (uint8_t k = 0; k < 3U; k++) {
+    scan_adcs[k]->Init.ClockPrescaler = clock_prescaler;
+  }
+  sampling_layout = ADC_SAMPLING_STALE;
+  // ADC1's init writes the common ADCPRE field shared by all three ADCs
+  return HAL_ADC_Init(&hadc1);
+}
+
+HAL_StatusTypeDef analogSensor_setChannelProfile(
+    uint8_t channel, const ADC_ChannelProfile_t *profile) {
+  if (acq_mode != ADC_ACQ_MODE_POLLING) {
+    return HAL_BUSY;
+  }
+  if (channel >= ADC_CONVERSIONS_CHANNEL_COUNT || profile == NULL ||
+      profile->source_ohms > ADC_R_AIN_MAX_OHMS ||
+      profile->accuracy_bits < ADC_ACCURACY_MIN_BITS ||
+      profile->accuracy_bits > ADC_ACCURACY_MAX_BITS) {
+    return HAL_ERROR;
+  }
+  channel_profile[channel] = *profile;
+  sampling_layout = ADC_SAMPLING_STALE;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef analogSensor_getChannelProfile(uint8_t channel,
+                                                 ADC_ChannelProfile_t *profile) {
+  if (channel >= ADC_CONVERSIONS_CHANNEL_COUNT || profile == NULL) {
+    return HAL_ERROR;
+  }
+  *profile = channel_profile[channel];
+  return HAL_OK;
+}
+
+uint32_t analogSensor_getSamplingCycles(uint8_t channel,
+                                        uint32_t clock_prescaler) {
+  if (channel >= ADC_CONVERSIONS_CHANNEL_COUNT ||
+      !IS_ADC_CLOCKPRESCALER(clock_prescaler)) {
+    return 0;
+  }
+  uint8_t i = analogSensor_pickSamplingTime(
+      &channel_profile[channel], analogSensor_prescalerClockHz(clock_prescaler));
+  return analogSensor_samplingCycles(sampling_times[i]);
+}
+
+uint32_t analogSensor_getMaxFrameRate(uint32_t clock_prescaler) {
+  if (!IS_ADC_CLOCKPRESCALER(clock_prescaler)) {
+    return 0;
+  }
+  uint32_t adc_hz = analogSensor_prescalerClockHz(clock_prescaler);
+  return adc_hz / analogSensor_scanCycles(multimode, adc_hz, channel_profile);
+}
+
+HAL_StatusTypeDef analogSensor_getScanSkew(float *skew_ns) {
+  if (skew_ns == NULL) {
+    return HAL_ERROR;
+  }
+  // A rank samples until the end of its sampling phase; the ranks before
+  // it took their sampling and conversion each
+  const uint32_t adc_hz = analogSensor_adcClockHz();
+  const uint32_t bits = analogSensor_layoutBits(multimode);
+  uint32_t cycles = 0;
+  for (uint8_t i = 0; i < ADC_CONVERSIONS_CHANNEL_COUNT;
+       i += scan_adc_count[multimode]) {
+    const uint32_t sampling = analogSensor_samplingCycles(
+        sampling_times[analogSensor_rankSamplingTime(multimode, i, adc_hz,
+                                                     channel_profile)]);
+    const float at_ns = (float)(cycles + sampling) * 1.0e9f / (float)adc_hz;
+    for (uint8_t k = 0; k < scan_adc_count[multimode]; k++) {
+      skew_ns[scan_order[multimode][i + k]] = at_ns;
+    }
+    cycles += sampling + bits;
+  }
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef analogSensor_stageConfig(const ADC_ScanConfig_t *cfg,
+                                           uint32_t *first_frame) {
+  if (cfg == NULL) {
+    return HAL_ERROR;
+  }
+  if (acq_mode != ADC_ACQ_MODE_DMA_TIMER) {
+    return HAL_BUSY;
+  }
+  // An external scan trigger sets the rate itself
+  if ((cfg->fields & ADC_SCAN_CONFIG_RATE) &&
+      scan_trigger != ADC_SCAN_TRIGGER_TIM2) {
+    return HAL_ERROR;
+  }
+
+  ADC_StagedConfig_t next = {.cfg = *cfg};
+  const ADC_ChannelProfile_t *profiles = channel_profile;
+  if (cfg->fields & ADC_SCAN_CONFIG_PROFILES) {
+    for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+      const ADC_ChannelProfile_t *p = &cfg->profile[ch];
+      if (p->source_ohms > ADC_R_AIN_MAX_OHMS ||
+          p->accuracy_bits < ADC_ACCURACY_MIN_BITS ||
+          p->accuracy_bits > ADC_ACCURACY_MAX_BITS) {
+        return HAL_ERROR;
+      }
+    }
+    profiles = cfg->profile;
+  }
+  const uint32_t rate = (cfg->fields & ADC_SCAN_CONFIG_RATE)
+                            ? cfg->frame_rate_hz
+                            : sample_rate_hz;
+  const uint32_t adc_hz = analogSensor_adcClockHz();
+  if (rate == 0U ||
+      rate > adc_hz / analogSensor_scanCycles(multimode, adc_hz, profiles) ||
+      analogSensor_timerClockHz() / rate < 2U) {
+    return HAL_ERROR;
+  }
+
+  // Same rank grouping as applyProfiles(), into register images
+  if (cfg->fields & ADC_SCAN_CONFIG_PROFILES) {
+    const uint8_t count = scan_adc_count[multimode];
+    for (uint8_t i = 0; i < ADC_CONVERSIONS_CHANNEL_COUNT; i += count) {
+      uint32_t time = sampling_times[analogSensor_rankSamplingTime(
+          multimode, i, adc_hz, profiles)];
+      for (uint8_t k = 0; k < count; k++) {
+        const uint8_t ch = scan_order[multimode][i + k];
+        const uint32_t channel = sConfig[ch].Channel;
+        next.sampling_time[ch] = time;
+        if (channel > ADC_CHANNEL_9) {
+          next.smpr1_mask[k] |= ADC_SMPR1(ADC_SMPR1_SMP10, channel);
+          next.smpr1[k] |= ADC_SMPR1(time, channel);
+        } else {
+          next.smpr2_mask[k] |= ADC_SMPR2(ADC_SMPR2_SMP0, channel);
+          next.smpr2[k] |= ADC_SMPR2(time, channel);
+        }
+      }
+    }
+  }
+
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  staged = next;
+  staged_pending = 1;
+  // The block in progress finishes under the old configuration
+  const uint32_t first = frame_sequence + block_frames;
+  __set_PRIMASK(primask);
+  if (first_frame != NULL) {
+    *first_frame = first;
+  }
+  return HAL_OK;
+}
+
+uint8_t analogSensor_isConfigPending(void) { return staged_pending; }
+
+HAL_StatusTypeDef analogSensor_stopDMA(void) {
+  staged_pending = 0;
+  switch_request = 0;
+  // A switched capture goes back to the scan from its DMA interrupt
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  if (acq_mode == ADC_ACQ_MODE_CAPTURE && !capture_done) {
+    analogSensor_haltCapture();
+  }
+  __set_PRIMASK(primask);
+  if (acq_mode == ADC_ACQ_MODE_POLLING) {
+    return HAL_OK;
+  }
+
+  if (acq_mode == ADC_ACQ_MODE_CAPTURE) {
+    analogSensor_enterMode(ADC_ACQ_MODE_POLLING);
+    HAL_StatusTypeDef status = analogSensor_configCapture(0, 0);
+    if (switch_active) {
+      // TIM2 ran on through the capture for the scan's frame grid
+      switch_active = 0;
+      HAL_TIM_Base_Stop(&htim2);
+      hadc1.Init.NbrOfConversion = ADC_POLL_RANKS;
+      if (analogSensor_configTrigger(0) != HAL_OK) {
+        status = HAL_ERROR;
+      }
+    }
+    return status;
+  }
+  if (acq_mode == ADC_ACQ_MODE_REPLAY) {
+    analogSensor_stopReplay();
+    return HAL_OK;
+  }
+
+  const uint8_t timed = (acq_mode == ADC_ACQ_MODE_DMA_TIMER ||
+                         acq_mode == ADC_ACQ_MODE_SEQUENCE ||
+                         acq_mode == ADC_ACQ_MODE_GROUPED);
+  if (timed) {
+    HAL_TIM_Base_Stop(&htim2);
+  }
+
+  HAL_StatusTypeDef status = analogSensor_stopScan();
+  analogSensor_stopPool();
+  analogSensor_configWatchdogs(0);
+  if (timed || multimode != ADC_MULTI_INDEPENDENT) {
+    // Back to the software-start sequence of MX_ADC1_Init() (polling mode)
+    hadc1.Init.NbrOfConversion = ADC_POLL_RANKS;
+    hadc1.Init.DiscontinuousConvMode = DISABLE;
+    if (analogSensor_configTrigger(0) != HAL_OK) {
+      status = HAL_ERROR;
+    }
+  }
+  analogSensor_enterMode(ADC_ACQ_MODE_POLLING);
+  return status;
+}
+
+void analogSensor_registerBlockCallback(ADC_BlockCallback_t callback,
+                                        void *ctx) {
+  // Clear first so the ISR never sees a new ctx with the old callback
+  block_callback = NULL;
+  block_callback_ctx = ctx;
+  block_callback = callback;
+}
+
+void analogSensor_setBlockFilter(ADC_BlockFilter_t filter, void *ctx) {
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  block_filter = filter;
+  block_filter_ctx = ctx;
+  __set_PRIMASK(primask);
+}
+
+void analogSensor_setRangeHook(ADC_RangeHook_t hook, void *ctx) {
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  range_hook = hook;
+  range_hook_ctx = ctx;
+  __set_PRIMASK(primask);
+}
+
+HAL_StatusTypeDef analogSensor_subscribe(ADC_SubscriberCallback_t callback,
+                                         void *ctx,
+                                         ADC_ChannelMask_t channel_mask,
+                                         uint32_t every_n_blocks) {
+  if (callback == NULL || (channel_mask & ADC_FRAME_ALL_CHANNELS) == 0U ||
+      every_n_blocks == 0U) {
+    return HAL_ERROR;
+  }
+  ADC_Subscriber_t *slot = NULL;
+  for (uint8_t i = 0; i < ADC_CONVERSIONS_MAX_SUBSCRIBERS; i++) {
+    ADC_Subscriber_t *sub = &subscribers[i];
+    if (sub->active && sub->callback == callback && sub->ctx == ctx) {
+      slot = sub;
+      break;
+    }
+    if (!sub->active && slot == NULL) {
+      slot = sub;
+    }
+  }
+  if (slot == NULL) {
+    return HAL_BUSY;
+  }
+
+  slot->active = 0;
+  __DMB();
+  slot->callback = callback;
+  slot->ctx = ctx;
+  slot->every_n_blocks = every_n_blocks;
+  slot->countdown = every_n_blocks;
+  slot->channel_mask = channel_mask & ADC_FRAME_ALL_CHANNELS;
+  __DMB();
+  slot->active = 1;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef analogSensor_unsubscribe(ADC_SubscriberCallback_t callback,
+                                           void *ctx) {
+  for (uint8_t i = 0; i < ADC_CONVERSIONS_MAX_SUBSCRIBERS; i++) {
+    ADC_Subscriber_t *sub = &subscribers[i];
+    if (sub->active && sub->callback == callback && sub->ctx == ctx) {
+      sub->active = 0;
+      return HAL_OK;
+    }
+  }
+  return HAL_ERROR;
+}
+
+void analogSensor_dispatchBlock(const uint16_t *block, uint32_t frame_count) {
+  if (block == NULL || frame_count == 0U) {
+    return;
+  }
+  uint8_t slot[ADC_CONVERSIONS_CHANNEL_COUNT];
+  const uint8_t *order = active_order;
+  for (uint8_t i = 0; i < ADC_CONVERSIONS_CHANNEL_COUNT; i++) {
+    slot[order[i]] = i;
+  }
+
+  ADC_BlockView_t view = {
+      .block = block, .frame_count = frame_count, .slot = slot};
+  for (uint8_t i = 0; i < ADC_CONVERSIONS_MAX_SUBSCRIBERS; i++) {
+    ADC_Subscriber_t *sub = &subscribers[i];
+    if (!sub->active || --sub->countdown != 0U) {
+      continue;
+    }
+    __DMB();
+    sub->countdown = sub->every_n_blocks;
+    view.blocks = sub->every_n_blocks;
+    view.channel_mask = sub->channel_mask;
+    sub->callback(&view, sub->ctx);
+  }
+}
+
+void analogSensor_setBlockGain(uint16_t gain_q14) { block_gain = gain_q14; }
+
+uint16_t analogSensor_getBlockGain(void) { return block_gain; }
+
+const uint16_t *analogSensor_getReadyBlock(void) {
+  uint32_t completed = blocks_completed;
+
+  if (block_callback != NULL || completed == blocks_consumed) {
+    return NULL;
+  }
+  if (completed - blocks_consumed > 1U) {
+    blocks_dropped += completed - blocks_consumed - 1U;
+    eventLog_write(EVENT_LOG_DROPPED, 0, completed - blocks_consumed - 1U);
+    retained_add(RETAINED_DROPPED_BLOCKS, completed - blocks_consumed - 1U);
+  }
+  blocks_consumed = completed;
+  return newest_block;
+}
+
+uint32_t analogSensor_getDroppedBlocks(void) { return blocks_dropped; }
+
+HAL_StatusTypeDef analogSensor_setBlockPool(uint8_t enable) {
+  if (acq_mode != ADC_ACQ_MODE_POLLING) {
+    return HAL_BUSY;
+  }
+  // Once: a later start must not wipe references consumers still hold
+  if (enable && !pool_ready) {
+    blockPool_init();
+    pool_ready = 1;
+  }
+  pool_enabled = enable ? 1U : 0U;
+  return HAL_OK;
+}
+
+uint32_t analogSensor_getPoolStarved(void) { return pool_starved; }
+
+HAL_StatusTypeDef analogSensor_setBlockFrames(uint32_t frames) {
+  if (acq_mode != ADC_ACQ_MODE_POLLING) {
+    return HAL_BUSY;
+  }
+  if (frames < ADC_CONVERSIONS_MIN_BLOCK_FRAMES ||
+      frames > ADC_CONVERSIONS_BLOCK_FRAMES ||
+      (frames * ADC_CONVERSIONS_CHANNEL_COUNT * sizeof(uint16_t)) %
+              ADC_DCACHE_LINE_SIZE !=
+          0U) {
+    return HAL_ERROR;
+  }
+  block_frames = frames;
+  block_samples = frames * ADC_CONVERSIONS_CHANNEL_COUNT;
+  return HAL_OK;
+}
+
+uint32_t analogSensor_getBlockFrames(void) { return block_frames; }
+
+HAL_StatusTypeDef analogSensor_startReplay(uint32_t frame_rate_hz,
+                                           uint8_t paced,
+                                           ADC_ReplaySource_t source,
+                                           void *ctx) {
+  if (acq_mode != ADC_ACQ_MODE_POLLING) {
+    return HAL_BUSY;
+  }
+  if (source == NULL || frame_rate_hz == 0U) {
+    return HAL_ERROR;
+  }
+  memset(&replay_stats, 0, sizeof(replay_stats));
+  block_bits = ADC_SAMPLE_BITS;
+  replay_stats.running = 1;
+  replay_stats.paced = paced ? 1U : 0U;
+  replay_source = source;
+  replay_ctx = ctx;
+  replay_period =
+      paced ? (uint64_t)block_frames * TIMEBASE_TICK_HZ / frame_rate_hz : 0U;
+  replay_due = timebase_now();
+  replay_half = 0;
+  replay_fill = NULL;
+  replay_block = NULL;
+  replay_data = NULL;
+  sample_rate_hz = frame_rate_hz;
+  // Same defaults as a DMA start: a new timing estimate, the DMA's own
+  // blocks back; blocks consumers still hold keep their references
+  timing_blocks = 0;
+  analogSensor_stopPool();
+  pool_starved = 0;
+  pool_active = pool_enabled;
+  analogSensor_enterMode(ADC_ACQ_MODE_REPLAY);
+  return HAL_OK;
+}
+
+void analogSensor_pollReplay(void) {
+  if (acq_mode != ADC_ACQ_MODE_REPLAY || replay_data != NULL ||
+      replay_stats.finished) {
+    return;
+  }
+  if (replay_fill == NULL) {
+    // The half handed off last stays intact, as with the DMA
+    BlockPool_Block_t *blk = pool_active ? blockPool_alloc() : NULL;
+    uint16_t *dst = (blk != NULL)
+                        ? blockPool_dmaTarget(blk)
+                        : &adc_dma_buffer[replay_half * block_samples];
+    if (pool_active && blk == NULL) {
+      pool_starved++;
+    }
+    const HAL_StatusTypeDef status =
+        replay_source(dst, block_frames, replay_ctx);
+    if (status != HAL_OK) {
+      blockPool_release(blk);
+      if (status == HAL_BUSY) {
+        replay_stats.waits++;
+      } else {
+        replay_stats.finished = 1;
+      }
+      return;
+    }
+    // The hand-off invalidates the block: the samples must be in SRAM
+    SCB_CleanDCache_by_Addr((uint32_t *)dst,
+                            block_samples * sizeof(uint16_t));
+    if (blk == NULL) {
+      replay_half ^= 1U;
+    }
+    replay_fill = dst;
+    replay_block = blk;
+  }
+
+  if (replay_period != 0U) {
+    const uint64_t now = timebase_now();
+    if (now < replay_due) {
+      return;
+    }
+    if (now - replay_due >= replay_period) {
+      replay_stats.late++;
+      replay_due = now; // no burst to catch up: keep the block spacing
+    }
+    replay_due += replay_period;
+  }
+  replay_data = replay_fill;
+  NVIC_SetPendingIRQ(DMA2_Stream0_IRQn);
+}
+
+ADC_FAST_CODE void analogSensor_replayIrqHandler(void) {
+  const uint16_t *data = replay_data;
+  if (data == NULL || acq_mode != ADC_ACQ_MODE_REPLAY) {
+    return;
+  }
+  BlockPool_Block_t *done = replay_block;
+  replay_block = NULL;
+  replay_fill = NULL;
+  const uint64_t now = timebase_now();
+  if (replay_stats.blocks == 0U) {
+    replay_first = now;
+  }
+  analogSensor_handOff(data, done);
+  replay_stats.blocks++;
+  replay_stats.elapsed_ticks = now - replay_first;
+  replay_data = NULL;
+}
+
+HAL_StatusTypeDef analogSensor_getReplayStats(ADC_ReplayStats_t *stats) {
+  if (stats == NULL) {
+    return HAL_ERROR;
+  }
+  *stats = replay_stats;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef analogSensor_getBlockInfo(ADC_BlockInfo_t *info) {
+  if (info == NULL) {
+    return HAL_ERROR;
+  }
+
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  uint32_t blocks = timing_blocks;
+  *info = last_block;
+  __set_PRIMASK(primask);
+
+  return (blocks == 0U) ? HAL_ERROR : HAL_OK;
+}
+
+HAL_StatusTypeDef analogSensor_getTiming(ADC_TimingInfo_t *info) {
+  if (info == NULL) {
+    return HAL_ERROR;
+  }
+
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  uint32_t blocks = timing_blocks;
+  uint32_t first_frame = timing_first_frame;
+  uint64_t first_timestamp = timing_first_timestamp;
+  ADC_BlockInfo_t last = last_block;
+  uint32_t jitter = interval_max - interval_min;
+  __set_PRIMASK(primask);
+
+  if (blocks < 2U) {
+    return HAL_BUSY;
+  }
+
+  uint64_t elapsed = last.timestamp - first_timestamp;
+  uint64_t frames = last.first_frame - first_frame;
+  info->blocks = blocks;
+  info->nominal_mhz =
+      (acq_mode == ADC_ACQ_MODE_DMA_TIMER) ? sample_rate_hz * 1000U : 0U;
+  info->measured_mhz =
+      (uint32_t)(frames * TIMEBASE_TICK_HZ * 1000U / elapsed);
+  info->drift_ppm =
+      (info->nominal_mhz == 0U)
+          ? 0.0f
+          : (float)((int32_t)(info->measured_mhz - info->nominal_mhz)) *
+                1.0e6f / (float)info->nominal_mhz;
+  info->jitter_ticks = jitter;
+  info->first_timestamp = first_timestamp;
+  info->last_timestamp = last.timestamp;
+  return HAL_OK;
+}
+
+uint64_t analogSensor_getFrameTime(uint32_t sequence) {
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  uint32_t blocks = timing_blocks;
+  uint32_t first_frame = timing_first_frame;
+  uint64_t first_timestamp = timing_first_timestamp;
+  ADC_BlockInfo_t last = last_block;
+  __set_PRIMASK(primask);
+
+  if (blocks < 2U) {
+    return 0U;
+  }
+
+  // The stamp belongs to the block's last frame; step from there at the
+  // measured period (signed: the frame may lie after the newest block)
+  uint64_t elapsed = last.timestamp - first_timestamp;
+  uint32_t frames = last.first_frame - first_frame;
+  int32_t offset =
+      (int32_t)(last.first_frame + last.frame_count - 1U - sequence);
+  int64_t delta = (int64_t)offset * (int64_t)elapsed / (int64_t)frames;
+  return last.timestamp - (uint64_t)delta;
+}
+
+ADC_AcqMode_t analogSensor_getMode(void) { return acq_mode; }
+
+HAL_StatusTypeDef analogSensor_setMultimode(ADC_Multimode_t mode) {
+  if (acq_mode != ADC_ACQ_MODE_POLLING) {
+    return HAL_BUSY;
+  }
+  if ((uint32_t)mode > (uint32_t)ADC_MULTI_TRIPLE_SIMULT || !layout_ok[mode]) {
+    return HAL_ERROR;
+  }
+  multimode = mode;
+  memset(watchdog_enabled, 0, sizeof(watchdog_enabled));
+  return HAL_OK;
+}
+
+ADC_Multimode_t analogSensor_getMultimode(void) { return multimode; }
+
+HAL_StatusTypeDef analogSensor_setResolution(uint8_t adc, uint32_t resolution) {
+  if (adc >= sizeof(adc_resolution) / sizeof(adc_resolution[0]) ||
+      !IS_ADC_RESOLUTION(resolution)) {
+    return HAL_ERROR;
+  }
+  if (acq_mode != ADC_ACQ_MODE_POLLING || async_active) {
+    return HAL_BUSY;
+  }
+  ADC_HandleTypeDef *hadc = scan_adcs[adc];
+  adc_resolution[adc] = resolution;
+  hadc->Init.Resolution = resolution;
+  // Polling reads and instances use the ADC as it is set up now
+  MODIFY_REG(hadc->Instance->CR1, ADC_CR1_RES, resolution);
+  conv_timing_hclk = 0;
+#if !ADC_CHANNELS_ALL_ADC12
+  adc3_ctx.timeout_hclk = 0;
+#endif
+  return HAL_OK;
+}
+
+uint32_t analogSensor_getResolution(uint8_t adc) {
+  return (adc < sizeof(adc_resolution) / sizeof(adc_resolution[0]))
+             ? adc_resolution[adc]
+             : 0U;
+}
+
+const uint8_t *analogSensor_getBlockChannelMap(void) {
+  return scan_order[multimode];
+}
+
+HAL_StatusTypeDef analogSensor_startCapture(uint8_t channel,
+                                            ADC_CaptureCallback_t callback,
+                                            void *ctx) {
+  return analogSensor_startBurst(channel, capture_buffer,
+                                 ADC_CONVERSIONS_CAPTURE_SAMPLES, callback,
+                                 ctx);
+}
+
+HAL_StatusTypeDef analogSensor_startBurst(uint8_t channel, uint16_t *buffer,
+                                          uint32_t samples,
+                                          ADC_CaptureCallback_t callback,
+                                          void *ctx) {
+  HAL_StatusTypeDef status;
+
+  if (acq_mode != ADC_ACQ_MODE_POLLING) {
+    return HAL_BUSY;
+  }
+  // All three ADCs interleave on the one pin
+  if (channel >= ADC_CONVERSIONS_CHANNEL_COUNT ||
+      channel_adcs[channel] != ADC_CHANNELS_ADC123) {
+    return HAL_ERROR;
+  }
+  // Whole cache lines, and a count the DMA's 16-bit NDTR takes in words
+  if (buffer == NULL || ((uintptr_t)buffer % ADC_DCACHE_LINE_SIZE) != 0U ||
+      samples == 0U ||
+      (samples * sizeof(uint16_t)) % ADC_DCACHE_LINE_SIZE != 0U ||
+      samples > ADC_CONVERSIONS_BURST_MAX_SAMPLES) {
+    return HAL_ERROR;
+  }
+
+  capture_callback = callback;
+  capture_callback_ctx = ctx;
+  capture_done = 0;
+  capture_switched = 0;
+  capture_target = buffer;
+  capture_samples = samples;
+  scan_prescaler = hadc1.Init.ClockPrescaler;
+  analogSensor_enterMode(ADC_ACQ_MODE_CAPTURE);
+
+  // A dirty line evicted during the transfer would overwrite DMA data
+  SCB_CleanInvalidateDCache_by_Addr((uint32_t *)buffer,
+                                    (int32_t)(samples * sizeof(uint16_t)));
+  status = analogSensor_configCapture(1, channel);
+  for (uint8_t k = 1; k < 3U && status == HAL_OK; k++) {
+    status = HAL_ADC_Start(scan_adcs[k]);
+  }
+  if (status == HAL_OK) {
+    // DMA mode 2: one 32-bit word per pair of conversions
+    status = HAL_ADCEx_MultiModeStart_DMA(&hadc1, (uint32_t *)buffer,
+                                          samples / 2U);
+  }
+  if (status != HAL_OK) {
+    analogSensor_countError(channel, ADC_ERROR_KIND_START, status);
+    analogSensor_haltCapture();
+    analogSensor_stopDMA();
+    return HAL_ERROR;
+  }
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef analogSensor_switchToCapture(uint8_t channel,
+                                               ADC_CaptureCallback_t callback,
+                                               void *ctx) {
+  // The block pool re-arms only before the first trigger; the resume
+  // numbers its frames on the last block's stamp
+  if (acq_mode != ADC_ACQ_MODE_DMA_TIMER || pool_active ||
+      timing_blocks == 0U || switch_request != 0U) {
+    return HAL_BUSY;
+  }
+  if (channel >= ADC_CONVERSIONS_CHANNEL_COUNT ||
+      channel_adcs[channel] != ADC_CHANNELS_ADC123) {
+    return HAL_ERROR;
+  }
+
+  capture_callback = callback;
+  capture_callback_ctx = ctx;
+  capture_done = 0;
+  capture_switched = 1;
+  capture_target = capture_buffer;
+  capture_samples = ADC_CONVERSIONS_CAPTURE_SAMPLES;
+  switch_info.frame_period_us = 1000000U / sample_rate_hz;
+  switch_request = (uint8_t)(channel + 1U);
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef analogSensor_setSequence(ADC_ChannelMask_t channel_mask,
+                                           const uint8_t *weights) {
+  if (acq_mode != ADC_ACQ_MODE_POLLING) {
+    return HAL_BUSY;
+  }
+  channel_mask &= ADC_FRAME_ALL_CHANNELS;
+  if (channel_mask == 0U) {
+    return HAL_ERROR;
+  }
+
+  ADC_ScanSequence_t seq = {.mask = channel_mask};
+  uint32_t total = 0;
+  for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+    if (channel_mask & (1UL << ch)) {
+      seq.weight[ch] = (weights != NULL) ? weights[ch] : 1U;
+      if (seq.weight[ch] == 0U) {
+        return HAL_ERROR;
+      }
+      total += seq.weight[ch];
+    }
+  }
+  if (total > ADC_SEQUENCE_MAX_RANKS) {
+    return HAL_ERROR;
+  }
+
+  // Heaviest channel first, each spread evenly over the ranks still free:
+  // CH0 x4 of 8 ranks takes 0/2/4/6, the others fill the gaps
+  ADC_ChannelMask_t taken = 0;
+  uint8_t used[ADC_SEQUENCE_MAX_RANKS] = {0};
+  while (taken != channel_mask) {
+    uint8_t ch = 0xFF;
+    for (uint8_t c = 0; c < ADC_CONVERSIONS_CHANNEL_COUNT; c++) {
+      if ((channel_mask & ~taken & (1UL << c)) &&
+          (ch == 0xFF || seq.weight[c] > seq.weight[ch])) {
+        ch = c;
+      }
+    }
+    uint8_t free_ranks[ADC_SEQUENCE_MAX_RANKS];
+    uint8_t free_count = 0;
+    for (uint8_t r = 0; r < total; r++) {
+      if (!used[r]) {
+        free_ranks[free_count++] = r;
+      }
+    }
+    for (uint8_t k = 0; k < seq.weight[ch]; k++) {
+      uint8_t r = free_ranks[k * free_count / seq.weight[ch]];
+      used[r] = 1;
+      seq.channel[r] = ch;
+    }
+    taken |= (ADC_ChannelMask_t)(1UL << ch);
+  }
+  seq.ranks = (uint8_t)total;
+  sequence = seq;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef analogSensor_getSequence(ADC_ScanSequence_t *seq) {
+  if (seq == NULL) {
+    return HAL_ERROR;
+  }
+  *seq = sequence;
+  return HAL_OK;
+}
+
+uint32_t analogSensor_getSequenceMaxRate(void) {
+  uint32_t adc_hz = analogSensor_adcClockHz();
+  return adc_hz / analogSensor_sequenceCycles(adc_hz);
+}
+
+HAL_StatusTypeDef analogSensor_startSequence(uint32_t scan_rate_hz,
+                                             ADC_SequenceCallback_t callback,
+                                             void *ctx) {
+  if (acq_mode != ADC_ACQ_MODE_POLLING) {
+    return HAL_BUSY;
+  }
+  // The ranks are ADC1's alone; the slaves would need a layout of their own.
+  // The sequence is paced by TIM2 whatever the scan trigger.
+  if (multimode != ADC_MULTI_INDEPENDENT || scan_rate_hz == 0U ||
+      scan_trigger != ADC_SCAN_TRIGGER_TIM2 ||
+      scan_rate_hz > analogSensor_getSequenceMaxRate() ||
+      analogSensor_loadTimerPeriod(scan_rate_hz) != HAL_OK) {
+    return HAL_ERROR;
+  }
+  HAL_TIM_GenerateEvent(&htim2, TIM_EVENTSOURCE_UPDATE);
+
+  sequence_callback = callback;
+  sequence_callback_ctx = ctx;
+  sequence_scans = 0;
+  analogSensor_enterMode(ADC_ACQ_MODE_SEQUENCE);
+
+  HAL_StatusTypeDef status = analogSensor_configSequence();
+  if (status == HAL_OK) {
+    DMA_HandleTypeDef *hdma = hadc1.DMA_Handle;
+    MODIFY_REG(hdma->Instance->CR, DMA_SxCR_CIRC,
+               hdma->Init.Mode & DMA_SxCR_CIRC);
+    status = HAL_ADC_Start_DMA(
+        &hadc1, (uint32_t *)sequence_buffer,
+        2U * ADC_CONVERSIONS_SEQUENCE_SCANS * sequence.ranks);
+  }
+  if (status == HAL_OK) {
+    status = HAL_TIM_Base_Start(&htim2);
+  }
+  if (status != HAL_OK) {
+    analogSensor_countError(0xFF, ADC_ERROR_KIND_START, status);
+    analogSensor_stopDMA();
+    return HAL_ERROR;
+  }
+  return HAL_OK;
+}
+
+uint32_t analogSensor_getGroupedMaxRate(uint8_t group_size) {
+  const uint32_t adc_hz = analogSensor_adcClockHz();
+  const uint32_t cycles = analogSensor_groupCycles(group_size, adc_hz);
+  if (cycles == 0U) {
+    return 0U;
+  }
+  return adc_hz / (cycles * (ADC_CONVERSIONS_CHANNEL_COUNT / group_size));
+}
+
+HAL_StatusTypeDef analogSensor_startGrouped(uint32_t frame_rate_hz,
+                                            uint8_t group_size,
+                                            ADC_GroupCallback_t callback,
+                                            void *ctx) {
+  if (acq_mode != ADC_ACQ_MODE_POLLING) {
+    return HAL_BUSY;
+  }
+  // ADC1's ranks take every channel, paced by TIM2 group by group
+  const uint8_t groups = (group_size != 0U)
+                             ? (uint8_t)(ADC_CONVERSIONS_CHANNEL_COUNT /
+                                         group_size)
+                             : 0U;
+  if (multimode != ADC_MULTI_INDEPENDENT || frame_rate_hz == 0U ||
+      scan_trigger != ADC_SCAN_TRIGGER_TIM2 ||
+      frame_rate_hz > analogSensor_getGroupedMaxRate(group_size) ||
+      analogSensor_loadTimerPeriod(frame_rate_hz * groups) != HAL_OK) {
+    return HAL_ERROR;
+  }
+  sample_rate_hz /= groups; // the frame rate, as in the other timed modes
+  HAL_TIM_GenerateEvent(&htim2, TIM_EVENTSOURCE_UPDATE);
+
+  group_callback = callback;
+  group_callback_ctx = ctx;
+  group_len = group_size;
+  group_count = groups;
+  group_next = 0;
+  group_frames = 0;
+  analogSensor_enterMode(ADC_ACQ_MODE_GROUPED);
+
+  HAL_StatusTypeDef status = analogSensor_configGrouped(group_size);
+  if (status == HAL_OK) {
+    DMA_HandleTypeDef *hdma = hadc1.DMA_Handle;
+    MODIFY_REG(hdma->Instance->CR, DMA_SxCR_CIRC,
+               hdma->Init.Mode & DMA_SxCR_CIRC);
+    status = HAL_ADC_Start_DMA(&hadc1, (uint32_t *)group_buffer,
+                               2U * group_size);
+  }
+  if (status == HAL_OK) {
+    status = HAL_TIM_Base_Start(&htim2);
+  }
+  if (status != HAL_OK) {
+    analogSensor_countError(0xFF, ADC_ERROR_KIND_START, status);
+    analogSensor_stopDMA();
+    return HAL_ERROR;
+  }
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef analogSensor_startInjected(uint8_t channel,
+                                             ADC_InjectedCallback_t callback,
+                                             void *ctx) {
+  if (channel >= ADC_CONVERSIONS_CHANNEL_COUNT) {
+    return HAL_ERROR;
+  }
+  if (injected_busy || acq_mode == ADC_ACQ_MODE_CAPTURE) {
+    return HAL_BUSY;
+  }
+
+  // Polling mode and independent scans use ADC1 alone (ADC3 for its own
+  // pins)
+  uint8_t k = (acq_mode == ADC_ACQ_MODE_POLLING ||
+               acq_mode == ADC_ACQ_MODE_REPLAY)
+                  ? analogSensor_pollAdc(channel)
+                  : analogSensor_adcOfChannel(multimode, channel);
+  if (analogSensor_configInjected(scan_adcs[k], channel) != HAL_OK) {
+    return HAL_ERROR;
+  }
+  return analogSensor_triggerInjected(k, channel, callback, ctx);
+}
+
+HAL_StatusTypeDef analogSensor_startInternal(uint8_t which,
+                                             ADC_InjectedCallback_t callback,
+                                             void *ctx) {
+  if (which != ADC_INTERNAL_TEMPSENSOR && which != ADC_INTERNAL_VREFINT) {
+    return HAL_ERROR;
+  }
+  if (injected_busy || acq_mode == ADC_ACQ_MODE_CAPTURE) {
+    return HAL_BUSY;
+  }
+
+  // Raw IN18/IN17: the HAL's TEMPSENSOR value carries a flag it would write
+  // into JSQR. Its IN18 handling turns VBAT on, which must stay off.
+  const uint32_t channel = (which == ADC_INTERNAL_TEMPSENSOR)
+                               ? ADC_CHANNEL_18
+                               : ADC_CHANNEL_VREFINT;
+  if (analogSensor_configInjectedRaw(&hadc1, channel,
+                                     ADC_INTERNAL_SAMPLETIME) != HAL_OK) {
+    return HAL_ERROR;
+  }
+  CLEAR_BIT(ADC->CCR, ADC_CCR_VBATE);
+  SET_BIT(ADC->CCR, ADC_CCR_TSVREFE);
+
+  // Slaves convert alongside ADC1; equal sampling keeps them in lock-step
+  if (acq_mode != ADC_ACQ_MODE_POLLING) {
+    for (uint8_t k = 1; k < scan_adc_count[multimode]; k++) {
+      if (analogSensor_configInjectedRaw(
+              scan_adcs[k], sConfig[scan_order[multimode][k]].Channel,
+              ADC_INTERNAL_SAMPLETIME) != HAL_OK) {
+        return HAL_ERROR;
+      }
+    }
+  }
+  return analogSensor_triggerInjected(0, which, callback, ctx);
+}
+
+HAL_StatusTypeDef analogSensor_readInjected(uint8_t channel, uint16_t *value) {
+  if (value == NULL) {
+    return HAL_ERROR;
+  }
+
+  uint32_t t0 = profiler_begin();
+  HAL_StatusTypeDef status = analogSensor_startInjected(channel, NULL, NULL);
+  if (status != HAL_OK) {
+    return status;
+  }
+
+  uint32_t start = HAL_GetTick();
+  while (injected_busy) {
+    if (HAL_GetTick() - start > ADC_POLL_TIMEOUT_MS) {
+      __HAL_ADC_DISABLE_IT(injected_adc, ADC_IT_JEOC);
+      injected_busy = 0;
+      return HAL_TIMEOUT;
+    }
+  }
+  *value = injected_value;
+  profiler_end(PROFILER_PROBE_INJECTED, t0);
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef analogSensor_getCapture(const uint16_t **samples,
+                                          uint32_t *count) {
+  if (samples == NULL || count == NULL ||
+      (acq_mode != ADC_ACQ_MODE_CAPTURE && !capture_switched)) {
+    return HAL_ERROR;
+  }
+  if (!capture_done) {
+    return HAL_BUSY;
+  }
+  *samples = capture_target;
+  *count = capture_samples;
+  return HAL_OK;
+}
+
+uint32_t analogSensor_getCaptureRate(void) {
+  uint32_t div = ((ADC_CAPTURE_PRESCALER >> ADC_CCR_ADCPRE_Pos) + 1U) * 2U;
+  return HAL_RCC_GetPCLK2Freq() / div / ADC_CAPTURE_DELAY_CYCLES;
+}
+
+HAL_StatusTypeDef analogSensor_getFrame(ADC_Frame_t *frame) {
+  if (frame == NULL) {
+    return HAL_ERROR;
+  }
+  for (uint8_t i = 0; i < ADC_CONVERSIONS_CHANNEL_COUNT; i++) {
+    frame->samples[i] = default_ctx.frame.samples[i];
+  }
+  frame->error_mask = default_ctx.frame.error_mask;
+  frame->error_code = default_ctx.frame.error_code;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef analogSensor_getLatestFrame(ADC_LatestFrame_t *latest) {
+  return analogSensor_ctxGetLatestFrame(&default_ctx, latest);
+}
+
+HAL_StatusTypeDef analogSensor_ctxGetLatestFrame(ADC_SensorCtx_t *ctx,
+                                                 ADC_LatestFrame_t *latest) {
+  if (ctx == NULL || latest == NULL) {
+    return HAL_ERROR;
+  }
+  uint32_t seq;
+  do {
+    seq = ctx->published_seq;
+    __DMB();
+    *latest = ctx->published;
+    __DMB();
+  } while ((seq & 1U) != 0U || seq != ctx->published_seq);
+  return (seq != 0U) ? HAL_OK : HAL_BUSY;
+}
+
+uint32_t analogSensor_readFrames(ADC_Frame_t *dst, uint32_t max_frames,
+                                 uint32_t *first_sequence) {
+  if (dst == NULL) {
+    return 0;
+  }
+  uint32_t copied = 0;
+  uint32_t first = 0;
+  uint8_t gap = 0;
+  const ADC_RingEntry_t *span;
+  uint32_t n;
+  // Two spans at most: up to the end of the slots, then past the wrap
+  while (!gap && copied < max_frames &&
+         (n = adcRing_peek(&span, max_frames - copied)) != 0U) {
+    if (copied == 0U) {
+      first = span[0].sequence;
+    }
+    uint32_t i = 0;
+    for (; i < n; i++) {
+      if (span[i].sequence != first + copied) {
+        gap = 1;
+        break;
+      }
+      dst[copied++] = span[i].frame;
+    }
+    adcRing_consume(i);
+  }
+  if (first_sequence != NULL && copied != 0U) {
+    *first_sequence = first;
+  }
+  return copied;
+}
+
+uint32_t analogSensor_getErrorCount(void) {
+  return default_ctx.errors.total_errors;
+}
+
+HAL_StatusTypeDef analogSensor_getErrors(ADC_ErrorInfo_t *error_info) {
+  return analogSensor_ctxGetErrors(&default_ctx, error_info);
+}
+
+HAL_StatusTypeDef analogSensor_ctxGetErrors(ADC_SensorCtx_t *ctx,
+                                            ADC_ErrorInfo_t *error_info) {
+  if (ctx == NULL || error_info == NULL) {
+    return HAL_ERROR;
+  }
+  uint32_t seq;
+  do {
+    seq = ctx->error_seq;
+    __DMB();
+    *error_info = ctx->errors;
+    __DMB();
+  } while ((seq & 1U) != 0U || seq != ctx->error_seq);
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef analogSensor_getOverrunInfo(ADC_OverrunInfo_t *info) {
+  if (info == NULL) {
+    return HAL_ERROR;
+  }
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  *info = overrun_info;
+  __set_PRIMASK(primask);
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef analogSensor_getSwitchInfo(ADC_SwitchInfo_t *info) {
+  if (info == NULL) {
+    return HAL_ERROR;
+  }
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  *info = switch_info;
+  __set_PRIMASK(primask);
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef analogSensor_getConvTiming(ADC_ConvTiming_t *timing) {
+  if (timing == NULL) {
+    return HAL_ERROR;
+  }
+  analogSensor_prepareConvTiming();
+  *timing = conv_timing;
+  return HAL_OK;
+}
+
+void analogSensor_resetConvTiming(void) {
+  memset(conv_timing.histogram, 0, sizeof(conv_timing.histogram));
+  conv_timing.min_cycles = 0;
+  conv_timing.max_cycles = 0;
+  conv_timing.count = 0;
+  conv_timing.timeouts = 0;
+}
+
+void analogSensor_resetErrors(void) {
+  analogSensor_ctxResetErrors(&default_ctx);
+}
+
+void analogSensor_ctxResetErrors(ADC_SensorCtx_t *ctx) {
+  if (ctx == NULL) {
+    return;
+  }
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  ctx->error_seq++;
+  __DMB();
+  memset(&ctx->errors, 0, sizeof(ctx->errors));
+  ctx->errors.last_error_status = HAL_OK;
+  ctx->errors.last_failed_channel = 0xFF;
+  __DMB();
+  ctx->error_seq++;
+  __set_PRIMASK(primask);
+}
+
+ADC_SensorCtx_t *analogSensor_defaultCtx(void) { return &default_ctx; }
+
+HAL_StatusTypeDef analogSensor_ctxInit(ADC_SensorCtx_t *ctx,
+                                       ADC_HandleTypeDef *hadc,
+                                       const ADC_ChannelConfTypeDef *channels,
+                                       uint8_t channel_count) {
+  if (ctx == NULL || hadc == NULL || channels == NULL || channel_count == 0U ||
+      channel_count > ADC_CONVERSIONS_CHANNEL_COUNT || ctx == &default_ctx ||
+      hadc->Instance == hadc1.Instance) {
+    return HAL_ERROR;
+  }
+  memset(ctx, 0, sizeof(*ctx));
+  ctx->hadc = hadc;
+  ctx->channels = channels;
+  ctx->channel_count = channel_count;
+  ctx->errors.last_error_status = HAL_OK;
+  ctx->errors.last_failed_channel = 0xFF;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef analogSensor_ctxOperation(ADC_SensorCtx_t *ctx,
+                                            uint8_t channel) {
+  if (ctx == NULL || ctx->hadc == NULL || channel >= ctx->channel_count) {
+    return HAL_ERROR;
+  }
+  if (ctx == &default_ctx) {
+    analogSensor_operation(channel);
+    return (default_ctx.frame.error_mask & (1UL << channel)) ? HAL_ERROR
+                                                            : HAL_OK;
+  }
+  if (analogSensor_adcBusy(ctx->hadc)) {
+    return HAL_BUSY;
+  }
+
+  uint16_t value = 0;
+  ADC_SampleError_t error;
+  const HAL_StatusTypeDef status =
+      analogSensor_ctxPoll(ctx, channel, &value, &error);
+  if (status != HAL_OK) {
+    ctx->frame.error_mask |= (ADC_ChannelMask_t)(1UL << channel);
+    ctx->frame.error_code = (uint8_t)error;
+    analogSensor_ctxCountError(ctx, channel, sample_error_kind[error], status);
+    return status;
+  }
+  ctx->frame.samples[channel] = value;
+  ctx->frame.error_mask &= (ADC_ChannelMask_t)~(1UL << channel);
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef analogSensor_ctxOperationChannels(
+    ADC_SensorCtx_t *ctx, ADC_ChannelMask_t channel_mask) {
+  if (ctx == NULL || ctx->hadc == NULL) {
+    return HAL_ERROR;
+  }
+  if (ctx == &default_ctx) {
+    analogSensor_operation_channels(channel_mask);
+    return (default_ctx.frame.error_mask & channel_mask) ? HAL_ERROR : HAL_OK;
+  }
+  HAL_StatusTypeDef result = HAL_OK;
+  for (uint8_t i = 0; i < ctx->channel_count; i++) {
+    if (channel_mask & (1UL << i)) {
+      const HAL_StatusTypeDef status = analogSensor_ctxOperation(ctx, i);
+      if (status == HAL_BUSY) {
+        return status;
+      }
+      if (status != HAL_OK) {
+        result = status;
+      }
+    }
+  }
+  analogSensor_ctxPublishPolled(ctx);
+  return result;
+}
+
+HAL_StatusTypeDef analogSensor_getChannelStats(ADC_ChannelStats_t *stats,
+                                               uint8_t reset) {
+  if (stats == NULL) {
+    return HAL_ERROR;
+  }
+
+  // The DMA interrupt runs at priority 0, out of BASEPRI's reach
+  DSP_StatsAccum_t snapshot[ADC_CONVERSIONS_CHANNEL_COUNT];
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  memcpy(snapshot, channel_stats, sizeof(snapshot));
+  if (reset) {
+    dspStats_reset(channel_stats);
+  }
+  __set_PRIMASK(primask);
+
+  for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+    dspStats_compute(&snapshot[ch], &stats[ch]);
+  }
+  return HAL_OK;
+}
+
+void analogSensor_resetChannelStats(void) {
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  dspStats_reset(channel_stats);
+  __set_PRIMASK(primask);
+}
+
+HAL_StatusTypeDef analogSensor_getClipStats(ADC_ClipStats_t *stats,
+                                            uint8_t reset) {
+  if (stats == NULL) {
+    return HAL_ERROR;
+  }
+
+  uint32_t lanes[ADC_CLIP_PAIRS];
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  const uint8_t *order = active_order;
+  memcpy(lanes, clip_lanes, sizeof(lanes));
+  for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+    stats[ch].samples = clip_samples[ch];
+    stats[ch].episodes = clip_episodes[ch];
+  }
+  if (reset) {
+    memset(clip_samples, 0, sizeof(clip_samples));
+    memset(clip_episodes, 0, sizeof(clip_episodes));
+  }
+  __set_PRIMASK(primask);
+
+  for (uint8_t i = 0; i < ADC_CONVERSIONS_CHANNEL_COUNT; i++) {
+    const uint32_t shift = 16U * (i & 1U);
+    stats[order[i]].active = (uint8_t)((lanes[i / 2U] >> shift) & 1U);
+  }
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef analogSensor_configWatchdog(uint8_t channel, uint16_t low,
+                                              uint16_t high) {
+  if (channel >= ADC_CONVERSIONS_CHANNEL_COUNT || low > high ||
+      high > ADC_MAX_CODE) {
+    return HAL_ERROR;
+  }
+  if (acq_mode != ADC_ACQ_MODE_POLLING) {
+    return HAL_BUSY;
+  }
+
+  uint8_t adc = analogSensor_adcOfChannel(multimode, channel);
+  for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+    if (ch != channel && watchdog_enabled[ch] &&
+        analogSensor_adcOfChannel(multimode, ch) == adc) {
+      return HAL_ERROR;
+    }
+  }
+  watchdog_low[channel] = low;
+  watchdog_high[channel] = high;
+  watchdog_enabled[channel] = 1;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef analogSensor_clearWatchdog(uint8_t channel) {
+  if (channel >= ADC_CONVERSIONS_CHANNEL_COUNT) {
+    return HAL_ERROR;
+  }
+  if (acq_mode != ADC_ACQ_MODE_POLLING) {
+    return HAL_BUSY;
+  }
+  watchdog_enabled[channel] = 0;
+  return HAL_OK;
+}
+
+void analogSensor_registerWatchdogCallback(ADC_WatchdogCallback_t callback,
+                                           void *ctx) {
+  // Clear first so the ISR never sees a new ctx with the old callback
+  watchdog_callback = NULL;
+  watchdog_callback_ctx = ctx;
+  watchdog_callback = callback;
+}
+
+void analogSensor_armWatchdog(void) {
+  for (uint8_t k = 0; k < 3U; k++) {
+    if (watchdog_channel[k] != ADC_WATCHDOG_NONE) {
+      __HAL_ADC_CLEAR_FLAG(scan_adcs[k], ADC_FLAG_AWD);
+      __HAL_ADC_ENABLE_IT(scan_adcs[k], ADC_IT_AWD);
+    }
+  }
+}
+
+uint32_t analogSensor_getWatchdogAlarms(void) { return watchdog_alarms; }
+
+ADC_FAST_CODE uint8_t analogSensor_getWatchdogChannel(uint8_t adc) {
+  return (adc < 3U) ? watchdog_channel[adc] : ADC_WATCHDOG_NONE;
+}
+
+ADC_FAST_CODE uint8_t analogSensor_dmaIrqFast(void) {
+  dma_irq_entry = DWT->CYCCNT;
+  dma_irq_stamped = 1;
+#if ADC_CONVERSIONS_FAST_DMA_ISR
+  const ADC_AcqMode_t mode = acq_mode;
+  if (!dma_fast_isr || pool_active || resync_active ||
+      (mode != ADC_ACQ_MODE_DMA_CIRCULAR && mode != ADC_ACQ_MODE_DMA_TIMER &&
+       mode != ADC_ACQ_MODE_SEQUENCE && mode != ADC_ACQ_MODE_GROUPED)) {
+    return 0U;
+  }
+  const uint32_t flags = DMA2->LISR;
+  // Errors keep the HAL's stream abort and error callback
+  if ((flags & (DMA_LISR_TEIF0 | DMA_LISR_DMEIF0)) != 0U ||
+      ((flags & DMA_LISR_FEIF0) != 0U &&
+       (DMA2_Stream0->FCR & DMA_SxFCR_FEIE) != 0U)) {
+    return 0U;
+  }
+  // Both set: the hand-off ran late; the first half is the older one
+  if ((flags & DMA_LISR_HTIF0) != 0U) {
+    DMA2->LIFCR = DMA_LIFCR_CHTIF0;
+    analogSensor_fileDispatch(ADC_DMA_DISPATCH_FAST);
+    analogSensor_scanHalf(0);
+  }
+  if ((flags & DMA_LISR_TCIF0) != 0U) {
+    DMA2->LIFCR = DMA_LIFCR_CTCIF0;
+    analogSensor_fileDispatch(ADC_DMA_DISPATCH_FAST);
+    analogSensor_scanHalf(1);
+  }
+  dma_irq_stamped = 0;
+  return 1U;
+#else
+  return 0U;
+#endif
+}
+
+void analogSensor_setFastDmaIsr(uint8_t enable) {
+  dma_fast_isr = (enable != 0U);
+}
+
+HAL_StatusTypeDef analogSensor_getDmaDispatch(ADC_DmaDispatch_t path,
+                                              ADC_DmaDispatchStats_t *stats) {
+  if (path >= ADC_DMA_DISPATCH_COUNT || stats == NULL) {
+    return HAL_ERROR;
+  }
+  const uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  *stats = dma_dispatch[path];
+  __set_PRIMASK(primask);
+  return HAL_OK;
+}
+
+void analogSensor_resetDmaDispatch(void) {
+  const uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  memset(dma_dispatch, 0, sizeof(dma_dispatch));
+  __set_PRIMASK(primask);
+}
+
+/* HAL callbacks -------------------------------------------------------------*/
+
+/**
+ * @brief DMA half-transfer: the first block of the ping-pong buffer is ready
+ */
+ADC_FAST_CODE void HAL_ADC_ConvHalfCpltCallback(ADC_HandleTypeDef *hadc) {
+  if (hadc->Instance != ADC1 || acq_mode == ADC_ACQ_MODE_CAPTURE) {
+    return;
+  }
+  analogSensor_fileDispatch(ADC_DMA_DISPATCH_HAL);
+  analogSensor_scanHalf(0);
+}
+
+/**
+ * @brief DMA transfer complete: the second block of the ping-pong buffer is ready
+ */
+ADC_FAST_CODE void HAL_ADC_ConvCpltCallback(ADC_HandleTypeDef *hadc) {
+  if (hadc->Instance != ADC1) {
+    return;
+  }
+  // EOC of an asynchronous polling-mode request
+  if (async_regular) {
+    const uint16_t value = analogSensor_rescaleCode(HAL_ADC_GetValue(&hadc1),
+                                                    hadc1.Init.Resolution);
+    __HAL_ADC_DISABLE_IT(&hadc1, ADC_IT_OVR);
+    analogSensor_asyncFinish(value, ADC_SAMPLE_OK, HAL_OK);
+    analogSensor_asyncKick();
+    return;
+  }
+  if (acq_mode != ADC_ACQ_MODE_CAPTURE) {
+    // The end of a realigning pass, which may be either block
+    if (resync_active && acq_mode != ADC_ACQ_MODE_SEQUENCE) {
+      analogSensor_resyncComplete(hadc->DMA_Handle);
+      return;
+    }
+    analogSensor_fileDispatch(ADC_DMA_DISPATCH_HAL);
+    analogSensor_scanHalf(1);
+    return;
+  }
+
+  // One-shot capture finished: halt the ADCs before they overrun
+  const uint64_t end = timebase_now();
+  analogSensor_haltCapture();
+  SCB_InvalidateDCache_by_Addr((uint32_t *)capture_target,
+                               (int32_t)(capture_samples * sizeof(uint16_t)));
+  if (switch_active) {
+    analogSensor_leaveCapture(end);
+  }
+  capture_done = 1;
+  if (capture_callback != NULL) {
+    capture_callback(capture_target, capture_samples,
+                     capture_callback_ctx);
+  }
+}
+
+/**
+ * @brief Injected group finished: report the requested channel
+ * @note Called from ADC interrupt context
+ */
+ADC_HOT_CODE void HAL_ADCEx_InjectedConvCpltCallback(ADC_HandleTypeDef *hadc) {
+  if (!injected_busy || hadc->Instance != injected_adc->Instance) {
+    return;
+  }
+  injected_value = analogSensor_rescaleCode(
+      HAL_ADCEx_InjectedGetValue(hadc, ADC_INJECTED_RANK_1),
+      hadc->Init.Resolution);
+  injected_busy = 0;
+  if (injected_callback != NULL) {
+    injected_callback(injected_channel, injected_value,
+                      injected_callback_ctx);
+  }
+}
+
+/**
+ * @brief Analog watchdog: a guarded channel left its window
+ * @note Called from ADC interrupt context
+ */
+ADC_HOT_CODE void HAL_ADC_LevelOutOfWindowCallback(ADC_HandleTypeDef *hadc) {
+  uint32_t timestamp = HAL_GetTick();
+
+  for (uint8_t k = 0; k < 3U; k++) {
+    if (scan_adcs[k]->Instance != hadc->Instance) {
+      continue;
+    }
+    // One shot until analogSensor_armWatchdog()
+    __HAL_ADC_DISABLE_IT(hadc, ADC_IT_AWD);
+    uint8_t ch = watchdog_channel[k];
+    if (ch == ADC_WATCHDOG_NONE) {
+      return;
+    }
+    watchdog_alarms++;
+    if (watchdog_callback != NULL) {
+      watchdog_callback(ch, watchdog_low[ch], watchdog_high[ch], timestamp,
+                        watchdog_callback_ctx);
+    }
+    return;
+  }
+}
+
+/**
+ * @brief ADC error callback (overrun or DMA transfer error)
+ * @note Called from ADC/DMA interrupt context
+ */
+void HAL_ADC_ErrorCallback(ADC_HandleTypeDef *hadc) {
+  if (hadc->Instance != ADC1) {
+    return;
+  }
+  // Conversions the halted capture produced after its last DMA word
+  if (acq_mode == ADC_ACQ_MODE_CAPTURE && capture_done) {
+    return;
+  }
+  // The HAL only ORs into ErrorCode: take this report's bits
+  const uint32_t code = hadc->ErrorCode;
+  hadc->ErrorCode = HAL_ADC_ERROR_NONE;
+  if ((code & HAL_ADC_ERROR_OVR) != 0U &&
+      (acq_mode == ADC_ACQ_MODE_DMA_CIRCULAR ||
+       acq_mode == ADC_ACQ_MODE_DMA_TIMER)) {
+    analogSensor_recoverOverrun();
+  }
+  analogSensor_countError(0xFF,
+                          (code & HAL_ADC_ERROR_OVR) ? ADC_ERROR_KIND_OVERRUN
+                                                     : ADC_ERROR_KIND_DMA,
+                          HAL_ERROR);
 }
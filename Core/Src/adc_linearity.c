@@ -0,0 +1,208 @@
+/**
+ ******************************************************************************
+ * @file    adc_linearity.c
+ * @brief   Implementation of the per-code ADC linearity tables
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "adc_linearity.h"
+#include "adc_conversions.h"
+#include "adc_sections.h"
+#include <math.h>
+#include <stddef.h>
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define ADC_LIN_ONE (1 << ADC_LIN_FRAC_BITS)
+#define ADC_LIN_MAX_ENTRY ((int32_t)(ADC_LIN_CODES - 1U) * ADC_LIN_ONE)
+#define ADC_LIN_MIN_POINTS 16U
+#define ADC_LIN_MEAN_ONE 16.0f // mean_x16 units per code
+
+/* Private variables ---------------------------------------------------------*/
+#if ADC_LIN_ENABLE
+/* Read once per sample by the fused kernel, in DTCM */
+static int16_t tables[ADC_LIN_ADCS][ADC_LIN_CODES] ADC_FAST_BSS;
+#endif
+static AdcLin_Info_t infos[ADC_LIN_ADCS];
+
+/* Private functions ---------------------------------------------------------*/
+
+#if ADC_LIN_ENABLE
+/**
+ * @brief Entry of a corrected code, rounded and kept in the 12-bit range
+ */
+static int16_t adcLin_entry(float code) {
+  int32_t e = (int32_t)lroundf(code * (float)ADC_LIN_ONE);
+  if (e < 0) {
+    e = 0;
+  } else if (e > ADC_LIN_MAX_ENTRY) {
+    e = ADC_LIN_MAX_ENTRY;
+  }
+  return (int16_t)e;
+}
+#endif
+
+/* Public functions ----------------------------------------------------------*/
+
+void adcLin_init(void) {
+  for (uint8_t adc = 0; adc < ADC_LIN_ADCS; adc++) {
+    (void)adcLin_reset(adc);
+  }
+}
+
+const int16_t *adcLin_getTable(uint8_t adc) {
+#if ADC_LIN_ENABLE
+  return (adc < ADC_LIN_ADCS) ? tables[adc] : NULL;
+#else
+  (void)adc;
+  return NULL;
+#endif
+}
+
+uint8_t adcLin_slotAdc(uint8_t slot) {
+  switch (analogSensor_getMultimode()) {
+  case ADC_MULTI_DUAL_SIMULT:
+    return slot % 2U;
+  case ADC_MULTI_TRIPLE_SIMULT:
+    return slot % 3U;
+  default:
+    return 0U;
+  }
+}
+
+HAL_StatusTypeDef adcLin_build(uint8_t adc, const uint16_t *mean_x16,
+                               uint16_t first, uint16_t step,
+                               uint16_t points) {
+#if ADC_LIN_ENABLE
+  if (adc >= ADC_LIN_ADCS || mean_x16 == NULL || step == 0U ||
+      points < ADC_LIN_MIN_POINTS ||
+      (uint32_t)first + (uint32_t)(points - 1U) * step >= ADC_LIN_CODES) {
+    return HAL_ERROR;
+  }
+
+  // Least-squares line, DAC code -> mean x16; exact in 64 bits for 4096
+  // points (sum d*y < 2^41)
+  int64_t sd = 0, sy = 0, sdd = 0, sdy = 0;
+  for (uint16_t i = 0; i < points; i++) {
+    const int64_t d = (int64_t)first + (int64_t)i * step;
+    sd += d;
+    sy += mean_x16[i];
+    sdd += d * d;
+    sdy += d * mean_x16[i];
+  }
+  const int64_t den = (int64_t)points * sdd - sd * sd;
+  const int64_t num = (int64_t)points * sdy - sd * sy;
+  if (den <= 0 || num <= 0) {
+    return HAL_ERROR;
+  }
+  const float b = (float)num / (float)den;
+  const float a = ((float)sy - b * (float)sd) / (float)points;
+
+  // Validate before the table is touched: the curve must rise end to end
+  uint32_t peak = mean_x16[0];
+  uint32_t folds = 0;
+  for (uint16_t i = 1; i < points; i++) {
+    if (mean_x16[i] < peak) {
+      folds++;
+    } else {
+      peak = mean_x16[i];
+    }
+  }
+  if (peak <= mean_x16[0]) {
+    return HAL_ERROR;
+  }
+
+  AdcLin_Info_t info = {.calibrated = 1,
+                        .first = first,
+                        .last = (uint16_t)(first + (points - 1U) * step),
+                        .folds = folds};
+  info.code_lo = (uint16_t)((mean_x16[0] + 15U) / 16U);
+  info.code_hi = (uint16_t)(peak / 16U);
+  info.gain_ppm = (int32_t)lroundf((b / ADC_LIN_MEAN_ONE - 1.0f) * 1e6f);
+  info.offset_centi = (int32_t)lroundf(a / ADC_LIN_MEAN_ONE * 100.0f);
+
+  // Invert the running maximum at each covered code: the DAC position
+  // where the mean reaches it, then the line's value there
+  int16_t *const t = tables[adc];
+  uint16_t j = 0;
+  uint32_t lo = mean_x16[0]; // running maximum at points j and j + 1
+  uint32_t hi = (mean_x16[1] > lo) ? mean_x16[1] : lo;
+  float prev = 0.0f;
+  float dnl_max = 0.0f;
+  float inl_max = 0.0f;
+  for (uint32_t c = info.code_lo; c <= info.code_hi; c++) {
+    const uint32_t target = c * 16U;
+    while (hi < target || hi == lo) {
+      if (j + 2U >= points) {
+        break; // target == peak, reached at the last point
+      }
+      j++;
+      lo = hi;
+      hi = (mean_x16[j + 1U] > lo) ? mean_x16[j + 1U] : lo;
+    }
+    const float frac = (hi > lo) ? (float)(target - lo) / (float)(hi - lo)
+                                 : 1.0f;
+    const float d = (float)first + ((float)j + frac) * (float)step;
+    const float corrected = (a + b * d) / ADC_LIN_MEAN_ONE;
+    t[c] = adcLin_entry(corrected);
+
+    const float inl = (float)c - corrected;
+    if (fabsf(inl) > fabsf(inl_max)) {
+      inl_max = inl;
+      info.inl_code = (uint16_t)c;
+    }
+    // The code's step in ideal LSB, next corrected minus this one
+    if (c > info.code_lo && fabsf(corrected - prev - 1.0f) > dnl_max) {
+      dnl_max = fabsf(corrected - prev - 1.0f);
+    }
+    prev = corrected;
+  }
+  info.inl_max_centi = (int32_t)lroundf(inl_max * 100.0f);
+  info.dnl_max_centi = (int32_t)lroundf(dnl_max * 100.0f);
+
+  // Beyond the sweep: the correction of the nearest covered code
+  const int32_t below = t[info.code_lo] - (int32_t)info.code_lo * ADC_LIN_ONE;
+  const int32_t above = t[info.code_hi] - (int32_t)info.code_hi * ADC_LIN_ONE;
+  for (uint32_t c = 0; c < info.code_lo; c++) {
+    t[c] = adcLin_entry((float)c + (float)below / (float)ADC_LIN_ONE);
+  }
+  for (uint32_t c = info.code_hi + 1U; c < ADC_LIN_CODES; c++) {
+    t[c] = adcLin_entry((float)c + (float)above / (float)ADC_LIN_ONE);
+  }
+  infos[adc] = info;
+  return HAL_OK;
+#else
+  (void)adc;
+  (void)mean_x16;
+  (void)first;
+  (void)step;
+  (void)points;
+  return HAL_ERROR;
+#endif
+}
+
+HAL_StatusTypeDef adcLin_reset(uint8_t adc) {
+#if ADC_LIN_ENABLE
+  if (adc >= ADC_LIN_ADCS) {
+    return HAL_ERROR;
+  }
+  for (uint32_t c = 0; c < ADC_LIN_CODES; c++) {
+    tables[adc][c] = (int16_t)(c * ADC_LIN_ONE);
+  }
+  memset(&infos[adc], 0, sizeof(infos[adc]));
+  return HAL_OK;
+#else
+  (void)adc;
+  return HAL_ERROR;
+#endif
+}
+
+HAL_StatusTypeDef adcLin_getInfo(uint8_t adc, AdcLin_Info_t *info) {
+  if (adc >= ADC_LIN_ADCS || info == NULL) {
+    return HAL_ERROR;
+  }
+  *info = infos[adc];
+  return HAL_OK;
+}
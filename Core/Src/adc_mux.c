@@ -0,0 +1,368 @@
+/**
+ ******************************************************************************
+ * @file    adc_mux.c
+ * @brief   Implementation of the external analog multiplexer scan
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "adc_mux.h"
+#include "adc_sections.h"
+#include "tim.h"
+#include "timebase.h"
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define ADC_MUX_MASK (ADC_MUX_POSITIONS - 1U)
+#define ADC_MUX_BITS                                                           \
+  ((ADC_MUX_POSITIONS == 8U) ? 3U : (ADC_MUX_POSITIONS == 4U) ? 2U : 1U)
+#define ADC_MUX_BLOCK_SAMPLES (ADC_MUX_BLOCK_FRAMES * ADC_MUX_CHANNELS)
+
+#if ADC_MUX_POSITIONS != 2 && ADC_MUX_POSITIONS != 4 && ADC_MUX_POSITIONS != 8
+#error "ADC_MUX_POSITIONS must be 2, 4 or 8"
+#endif
+
+_Static_assert(ADC_MUX_SELECT_SHIFT + ADC_MUX_BITS <= 16U,
+               "the select lines must be pins of one port");
+_Static_assert(ADC_MUX_BLOCK_FRAMES > 0U, "a mux block needs a frame");
+_Static_assert(ADC_MUX_CHANNELS <= 256U, "sensors are numbered in a byte");
+
+/* Private variables ---------------------------------------------------------*/
+static TIM_HandleTypeDef htim_mux;
+static DMA_HandleTypeDef hdma_mux;
+static uint8_t ready = 0;
+static uint32_t settle_ns = ADC_MUX_SETTLE_NS;
+
+/* BSRR words, entry k selects position k + 1: sent after scan k */
+static uint32_t select_table[ADC_MUX_POSITIONS] ADC_SRAM1_BSS ADC_DMA_ALIGNED;
+
+/* Mux frames: one block fills while the other is with the callback */
+static uint16_t out_frames[2][ADC_MUX_BLOCK_SAMPLES];
+static uint8_t out_half = 0;
+static uint32_t out_count = 0;     // complete frames in the filling block
+static uint32_t out_first_scan = 0; // scan of position 0 of its frame 0
+static uint32_t fill = 0;          // positions of the frame being filled
+static uint32_t next_scan = 0;     // scan frame the next block starts at
+static const uint16_t *latest = NULL;
+static uint32_t latest_frame = 0;
+
+static AdcMux_BlockCallback_t block_callback = NULL;
+static void *block_ctx = NULL;
+static AdcMux_Stats_t stats_ = {0};
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+ * @brief Input clock of TIM1 (APB2 timers run at 2x PCLK2 when APB2 is divided)
+ */
+static uint32_t adcMux_timerClockHz(void) {
+  uint32_t clk = HAL_RCC_GetPCLK2Freq();
+  if ((RCC->CFGR & RCC_CFGR_PPRE2) != RCC_CFGR_PPRE2_DIV1) {
+    clk *= 2U;
+  }
+  return clk;
+}
+
+/**
+ * @brief Input clock of TIM2, the scan trigger (APB1)
+ */
+static uint32_t adcMux_scanClockHz(void) {
+  uint32_t clk = HAL_RCC_GetPCLK1Freq();
+  if ((RCC->CFGR & RCC_CFGR_PPRE1) != RCC_CFGR_PPRE1_DIV1) {
+    clk *= 2U;
+  }
+  return clk;
+}
+
+/**
+ * @brief BSRR word that drives the select lines to a position
+ */
+static uint32_t adcMux_selectWord(uint32_t position) {
+  const uint32_t set = position & ADC_MUX_MASK;
+  const uint32_t reset = ~position & ADC_MUX_MASK;
+  return (set << ADC_MUX_SELECT_SHIFT) |
+         (reset << (ADC_MUX_SELECT_SHIFT + 16U));
+}
+
+/**
+ * @brief Trigger -> switch: the end of the last sampling phase plus the
+ *        margin, at the current ADCCLK and profiles
+ */
+static uint32_t adcMux_switchNs(void) {
+  float skew_ns[ADC_CONVERSIONS_CHANNEL_COUNT];
+  float last = 0.0f;
+
+  if (analogSensor_getScanSkew(skew_ns) == HAL_OK) {
+    for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+      last = (skew_ns[ch] > last) ? skew_ns[ch] : last;
+    }
+  }
+  return (uint32_t)(last + 0.5f) + ADC_MUX_SWITCH_MARGIN_NS;
+}
+
+static void adcMux_initPins(void) {
+  GPIO_InitTypeDef gpio = {.Pin = ADC_MUX_MASK << ADC_MUX_SELECT_SHIFT,
+                           .Mode = GPIO_MODE_OUTPUT_PP,
+                           .Pull = GPIO_NOPULL,
+                           .Speed = GPIO_SPEED_FREQ_HIGH};
+  ADC_MUX_SELECT_CLK_ENABLE();
+  ADC_MUX_SELECT_PORT->BSRR = adcMux_selectWord(0U);
+  HAL_GPIO_Init(ADC_MUX_SELECT_PORT, &gpio);
+}
+
+/**
+ * @brief TIM1: one count to the switch instant per TIM2 update
+ */
+static HAL_StatusTypeDef adcMux_initTimer(void) {
+  __HAL_RCC_TIM1_CLK_ENABLE();
+  htim_mux.Instance = TIM1;
+  htim_mux.Init.Prescaler = 0;
+  htim_mux.Init.CounterMode = TIM_COUNTERMODE_UP;
+  htim_mux.Init.Period = 0xFFFFU; // set by adcMux_start()
+  htim_mux.Init.ClockDivision = TIM_CLOCKDIVISION_DIV1;
+  htim_mux.Init.RepetitionCounter = 0;
+  htim_mux.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_DISABLE;
+  // Frozen output compare: CC4 only raises the DMA request
+  return HAL_TIM_OnePulse_Init(&htim_mux, TIM_OPMODE_SINGLE);
+}
+
+static HAL_StatusTypeDef adcMux_initDma(void) {
+  __HAL_RCC_DMA2_CLK_ENABLE();
+
+  // BSRR words into the select port on TIM1_CH4, round the table forever
+  hdma_mux.Instance = DMA2_Stream4;
+  hdma_mux.Init.Channel = DMA_CHANNEL_6;
+  hdma_mux.Init.Direction = DMA_MEMORY_TO_PERIPH;
+  hdma_mux.Init.PeriphInc = DMA_PINC_DISABLE;
+  hdma_mux.Init.MemInc = DMA_MINC_ENABLE;
+  hdma_mux.Init.PeriphDataAlignment = DMA_PDATAALIGN_WORD;
+  hdma_mux.Init.MemDataAlignment = DMA_MDATAALIGN_WORD;
+  hdma_mux.Init.Mode = DMA_CIRCULAR;
+  hdma_mux.Init.Priority = DMA_PRIORITY_VERY_HIGH;
+  hdma_mux.Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+  return HAL_DMA_Init(&hdma_mux);
+}
+
+/**
+ * @brief Follow the DMA's position: exact while no trigger came after the
+ *        block, which the TIM2 count since the last update shows
+ */
+static void adcMux_checkPhase(const ADC_BlockInfo_t *info) {
+  const uint32_t scan_clk = adcMux_scanClockHz();
+
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  const uint64_t now = timebase_now();
+  const uint32_t since_update = __HAL_TIM_GET_COUNTER(&htim2);
+  const uint32_t ndtr = hdma_mux.Instance->NDTR;
+  __set_PRIMASK(primask);
+
+  // Block stamped after the latest update: that update was the block's
+  // last scan, and its switch is done (it precedes the block's DMA)
+  const uint64_t elapsed =
+      (now - info->timestamp) * scan_clk / TIMEBASE_TICK_HZ;
+  if (elapsed > (uint64_t)since_update + scan_clk / TIMEBASE_TICK_HZ) {
+    return;
+  }
+  stats_.checked++;
+  const uint32_t next = info->first_frame + info->frame_count;
+  const uint32_t position = (ADC_MUX_POSITIONS - ndtr) & ADC_MUX_MASK;
+  const uint8_t phase = (uint8_t)((next - position) & ADC_MUX_MASK);
+  if (phase != stats_.phase) {
+    stats_.phase = phase;
+    stats_.realigned++;
+    fill = 0; // the frame in progress mixes both
+  }
+}
+
+/**
+ * @brief A block of mux frames is complete: to the callback, then fill the
+ *        other one
+ */
+static void adcMux_blockDone(void) {
+  const AdcMux_Block_t blk = {
+      .first_frame = (out_first_scan - stats_.phase) / ADC_MUX_POSITIONS,
+      .first_scan = out_first_scan,
+      .frame_count = ADC_MUX_BLOCK_FRAMES,
+      .frames = out_frames[out_half]};
+  out_half ^= 1U;
+  out_count = 0;
+  stats_.blocks++;
+  if (block_callback != NULL) {
+    block_callback(&blk, block_ctx);
+  }
+}
+
+/* Public functions ----------------------------------------------------------*/
+
+HAL_StatusTypeDef adcMux_init(void) {
+#if !ADC_MUX_ENABLE
+  return HAL_OK; // not fitted: TIM1, the stream and the pins stay free
+#endif
+  adcMux_initPins();
+  if (adcMux_initTimer() != HAL_OK || adcMux_initDma() != HAL_OK) {
+    return HAL_ERROR;
+  }
+  for (uint32_t k = 0; k < ADC_MUX_POSITIONS; k++) {
+    select_table[k] = adcMux_selectWord(k + 1U);
+  }
+  SCB_CleanDCache_by_Addr(select_table, (int32_t)sizeof(select_table));
+  ready = 1;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef adcMux_start(uint32_t frame_rate_hz) {
+  if (!ready || frame_rate_hz == 0U ||
+      frame_rate_hz > adcMux_getMaxFrameRate()) {
+    return HAL_ERROR;
+  }
+  const uint32_t switch_ns = adcMux_switchNs();
+  const uint64_t ticks =
+      ((uint64_t)adcMux_timerClockHz() * switch_ns + 500000000ULL) /
+      1000000000ULL;
+  if (ticks == 0U || ticks >= 0xFFFFU) {
+    return HAL_ERROR;
+  }
+  adcMux_stop();
+
+  stats_ = (AdcMux_Stats_t){.switch_ns = switch_ns, .settle_ns = settle_ns};
+  out_half = 0;
+  out_count = 0;
+  fill = 0;
+  next_scan = 0;
+  latest = NULL;
+
+  htim_mux.Instance->CCR4 = (uint32_t)ticks;
+  __HAL_TIM_SET_AUTORELOAD(&htim_mux, (uint32_t)ticks + 1U);
+  if (HAL_DMA_Start(&hdma_mux, (uint32_t)(uintptr_t)select_table,
+                    (uint32_t)(uintptr_t)&ADC_MUX_SELECT_PORT->BSRR,
+                    ADC_MUX_POSITIONS) != HAL_OK) {
+    return HAL_ERROR;
+  }
+
+  // Armed last: the next TIM2 update is frame 0
+  TIM_SlaveConfigTypeDef slave = {.SlaveMode = TIM_SLAVEMODE_TRIGGER,
+                                  .InputTrigger = TIM_TS_ITR1};
+  __HAL_TIM_SET_COUNTER(&htim_mux, 0U);
+  if (HAL_TIM_SlaveConfigSynchro(&htim_mux, &slave) != HAL_OK) {
+    adcMux_stop();
+    return HAL_ERROR;
+  }
+  __HAL_TIM_ENABLE_DMA(&htim_mux, TIM_DMA_CC4);
+  stats_.running = 1;
+  return HAL_OK;
+}
+
+void adcMux_stop(void) {
+  if (!ready) {
+    return;
+  }
+  CLEAR_BIT(htim_mux.Instance->SMCR, TIM_SMCR_SMS);
+  __HAL_TIM_DISABLE_DMA(&htim_mux, TIM_DMA_CC4);
+  htim_mux.Instance->CR1 &= ~TIM_CR1_CEN;
+  (void)HAL_DMA_Abort(&hdma_mux);
+  ADC_MUX_SELECT_PORT->BSRR = adcMux_selectWord(0U);
+  stats_.running = 0;
+}
+
+void adcMux_setSettle(uint32_t ns) { settle_ns = ns; }
+
+uint32_t adcMux_getMaxFrameRate(void) {
+  return 1000000000U / (adcMux_switchNs() + settle_ns);
+}
+
+ADC_FAST_CODE void adcMux_processBlock(const uint16_t *block,
+                                       uint32_t frame_count,
+                                       const uint8_t *channel_map) {
+  ADC_BlockInfo_t info;
+
+  if (!stats_.running || block == NULL ||
+      analogSensor_getMode() != ADC_ACQ_MODE_DMA_TIMER ||
+      analogSensor_getBlockInfo(&info) != HAL_OK ||
+      info.frame_count != frame_count) {
+    return;
+  }
+  if (__HAL_DMA_GET_FLAG(&hdma_mux, __HAL_DMA_GET_TE_FLAG_INDEX(&hdma_mux))) {
+    __HAL_DMA_CLEAR_FLAG(&hdma_mux, __HAL_DMA_GET_TE_FLAG_INDEX(&hdma_mux));
+    stats_.dma_errors++;
+  }
+  if (info.first_frame != next_scan) {
+    stats_.dropped += (fill != 0U); // an overrun took scans
+    fill = 0;
+  }
+  adcMux_checkPhase(&info);
+
+  const uint32_t phase = stats_.phase;
+  for (uint32_t f = 0; f < frame_count; f++) {
+    const uint32_t scan = info.first_frame + f;
+    const uint32_t position = (scan - phase) & ADC_MUX_MASK;
+    if (position != fill) {
+      stats_.dropped += (fill != 0U);
+      fill = 0;
+      if (position != 0U) {
+        continue; // wait for the next position 0
+      }
+    }
+    if (position == 0U && out_count == 0U) {
+      out_first_scan = scan;
+    }
+    uint16_t *dst = &out_frames[out_half][out_count * ADC_MUX_CHANNELS];
+    const uint16_t *src = &block[f * ADC_CONVERSIONS_CHANNEL_COUNT];
+    for (uint8_t s = 0; s < ADC_CONVERSIONS_CHANNEL_COUNT; s++) {
+      const uint8_t input = (channel_map != NULL) ? channel_map[s] : s;
+      dst[input * ADC_MUX_POSITIONS + position] = src[s];
+    }
+    if (++fill < ADC_MUX_POSITIONS) {
+      continue;
+    }
+    fill = 0;
+    latest = dst;
+    latest_frame = (scan - phase) / ADC_MUX_POSITIONS;
+    stats_.frames++;
+    if (++out_count == ADC_MUX_BLOCK_FRAMES) {
+      adcMux_blockDone();
+    }
+  }
+  next_scan = info.first_frame + frame_count;
+}
+
+void adcMux_registerBlockCallback(AdcMux_BlockCallback_t callback, void *ctx) {
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  block_callback = callback;
+  block_ctx = ctx;
+  __set_PRIMASK(primask);
+}
+
+HAL_StatusTypeDef adcMux_getLatest(uint16_t *samples, uint32_t *frame) {
+  HAL_StatusTypeDef status = HAL_OK;
+
+  if (samples == NULL) {
+    return HAL_ERROR;
+  }
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  if (latest == NULL) {
+    status = HAL_BUSY;
+  } else {
+    memcpy(samples, latest, ADC_MUX_CHANNELS * sizeof(uint16_t));
+    if (frame != NULL) {
+      *frame = latest_frame;
+    }
+  }
+  __set_PRIMASK(primask);
+  return status;
+}
+
+HAL_StatusTypeDef adcMux_getStats(AdcMux_Stats_t *stats) {
+  if (stats == NULL) {
+    return HAL_ERROR;
+  }
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  *stats = stats_;
+  __set_PRIMASK(primask);
+  stats->settle_ns = settle_ns; // set for the next start already
+  return HAL_OK;
+}
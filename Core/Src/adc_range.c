@@ -0,0 +1,231 @@
+/**
+ ******************************************************************************
+ * @file    adc_range.c
+ * @brief   Implementation of the automatic gain ranging
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "adc_range.h"
+#include "adc_sections.h"
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define ADC_RANGE_NARROW_CODES(mg)                                            \
+  ((int32_t)((float)(mg) / ADC_CAL_NOMINAL_MG_PER_CODE + 0.5f))
+#define ADC_RANGE_WIDE_CODES(mg)                                              \
+  ((int32_t)((float)(mg) * 256.0f /                                           \
+                 (ADC_CAL_NOMINAL_MG_PER_CODE * ADC_RANGE_WIDE_SCALE_Q8) +    \
+             0.5f))
+
+_Static_assert(ADC_RANGE_DOWN_MG < ADC_RANGE_UP_MG,
+               "the hysteresis needs the down threshold below the up one");
+_Static_assert(ADC_CAL_GROUP_COUNT <= 8U, "one range bit per group");
+
+/* Private variables ---------------------------------------------------------*/
+static AdcRange_Config_t config;
+static int16_t zero[ADC_CONVERSIONS_CHANNEL_COUNT]; // zero-g codes
+static volatile AdcRange_Mode_t mode = ADC_RANGE_AUTO;
+static volatile uint8_t wide = 0;                   // bit g: FS high
+static uint32_t settle_left[ADC_CAL_GROUP_COUNT];   // frames still void
+static uint32_t quiet[ADC_CAL_GROUP_COUNT];         // frames below down
+static AdcRange_Stats_t stats_;
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+ * @brief Frames in a time at the scan rate, at least one
+ */
+ADC_FAST_CODE static uint32_t adcRange_frames(uint32_t us) {
+  const uint64_t n =
+      ((uint64_t)analogSensor_getSampleRate() * us + 999999U) / 1000000U;
+  return (n != 0U) ? (uint32_t)n : 1U;
+}
+
+/**
+ * @brief Drive a group's FS pin; the frames from the next block settle
+ */
+ADC_FAST_CODE static void adcRange_switch(uint8_t g, uint8_t to_wide) {
+  const uint32_t pin = config.pins[g];
+  config.port->BSRR = to_wide ? pin : pin << 16;
+  wide = (uint8_t)(to_wide ? (wide | (1U << g)) : (wide & ~(1U << g)));
+  settle_left[g] = stats_.settle_frames;
+  quiet[g] = 0;
+  if (to_wide) {
+    stats_.switches_up++;
+  } else {
+    stats_.switches_down++;
+  }
+}
+
+ADC_FAST_CODE static void adcRange_hook(const uint16_t *block,
+                                        uint32_t frame_count,
+                                        const uint8_t *order,
+                                        ADC_BlockRange_t *out, void *ctx) {
+  UNUSED(ctx);
+  int32_t peak[ADC_CAL_GROUP_COUNT] = {0};
+  uint8_t clipped = 0;
+  uint32_t first[ADC_CAL_GROUP_COUNT];
+
+  stats_.settle_frames = adcRange_frames(ADC_RANGE_SETTLE_US);
+  const uint8_t range = wide;
+  out->range = range;
+  for (uint8_t g = 0; g < ADC_CAL_GROUP_COUNT; g++) {
+    first[g] = (settle_left[g] < frame_count) ? settle_left[g] : frame_count;
+    settle_left[g] -= first[g];
+    stats_.voided += first[g];
+  }
+
+  // Peak deviation from zero g over the frames taken on a settled range
+  for (uint8_t i = 0; i < ADC_CONVERSIONS_CHANNEL_COUNT; i++) {
+    const uint8_t ch = order[i];
+    const uint8_t g = ch / ADC_CAL_AXES;
+    if (g >= ADC_CAL_GROUP_COUNT) {
+      continue;
+    }
+    out->settle[ch] = (uint16_t)first[g];
+    const int32_t z = zero[ch];
+    int32_t lo = z;
+    int32_t hi = z;
+    for (uint32_t f = first[g]; f < frame_count; f++) {
+      const int32_t x = block[f * ADC_CONVERSIONS_CHANNEL_COUNT + i];
+      lo = (x < lo) ? x : lo;
+      hi = (x > hi) ? x : hi;
+    }
+    if (lo <= (int32_t)ADC_CLIP_LOW_CODE ||
+        hi >= (int32_t)ADC_CLIP_HIGH_CODE) {
+      clipped |= (uint8_t)(1U << g);
+    }
+    const int32_t dev = (hi - z > z - lo) ? hi - z : z - lo;
+    peak[g] = (dev > peak[g]) ? dev : peak[g];
+  }
+
+  const AdcRange_Mode_t m = mode;
+  const uint32_t hold = adcRange_frames(ADC_RANGE_HOLD_MS * 1000U);
+  for (uint8_t g = 0; g < ADC_CAL_GROUP_COUNT; g++) {
+    const uint8_t is_wide = (range >> g) & 1U;
+    const float mg_per_code =
+        is_wide ? ADC_CAL_NOMINAL_MG_PER_CODE * ADC_RANGE_WIDE_SCALE_Q8 / 256U
+                : ADC_CAL_NOMINAL_MG_PER_CODE;
+    const float mg = (float)peak[g] * mg_per_code;
+    stats_.peak_mg[g] = (mg < 65535.0f) ? (uint16_t)mg : 65535U;
+
+    if (m != ADC_RANGE_AUTO) {
+      if (is_wide != (m == ADC_RANGE_WIDE)) {
+        adcRange_switch(g, m == ADC_RANGE_WIDE);
+      }
+      continue;
+    }
+    if (first[g] == frame_count) {
+      continue; // all settling: nothing to judge
+    }
+    if (!is_wide) {
+      if (((clipped >> g) & 1U) ||
+          peak[g] >= ADC_RANGE_NARROW_CODES(ADC_RANGE_UP_MG)) {
+        adcRange_switch(g, 1);
+      }
+    } else if (peak[g] < ADC_RANGE_WIDE_CODES(ADC_RANGE_DOWN_MG)) {
+      quiet[g] += frame_count - first[g];
+      if (quiet[g] >= hold) {
+        adcRange_switch(g, 0);
+      }
+    } else {
+      quiet[g] = 0;
+    }
+  }
+  stats_.range = wide;
+}
+
+/**
+ * @brief Scale the wide-range groups of converted frames to the +-2 g scale
+ */
+static void adcRange_scale(int16_t *mg, uint32_t frames, uint8_t range) {
+  for (uint8_t g = 0; g < ADC_CAL_GROUP_COUNT; g++) {
+    if (!((range >> g) & 1U)) {
+      continue;
+    }
+    for (uint32_t f = 0; f < frames; f++) {
+      int16_t *v = &mg[f * ADC_CONVERSIONS_CHANNEL_COUNT + g * ADC_CAL_AXES];
+      for (uint8_t a = 0; a < ADC_CAL_AXES; a++) {
+        const int32_t x = v[a] * (int32_t)ADC_RANGE_WIDE_SCALE_Q8;
+        v[a] = (int16_t)__SSAT(x >> 8, 16);
+      }
+    }
+  }
+}
+
+/* Public functions ----------------------------------------------------------*/
+
+HAL_StatusTypeDef adcRange_init(const AdcRange_Config_t *cfg) {
+#if !ADC_RANGE_ENABLE
+  return HAL_ERROR; // the FS pins are not wired
+#endif
+  if (cfg == NULL || cfg->port == NULL) {
+    return HAL_ERROR;
+  }
+  analogSensor_setRangeHook(NULL, NULL);
+  config = *cfg;
+  const ADC_CalTable_t *cal = adcCal_getTable();
+  for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+    zero[ch] = cal->offset[ch];
+  }
+
+  uint32_t pins = 0;
+  for (uint8_t g = 0; g < ADC_CAL_GROUP_COUNT; g++) {
+    pins |= config.pins[g];
+  }
+  GPIO_InitTypeDef gpio = {.Pin = pins,
+                           .Mode = GPIO_MODE_OUTPUT_PP,
+                           .Pull = GPIO_NOPULL,
+                           .Speed = GPIO_SPEED_FREQ_LOW};
+  config.port->BSRR = pins << 16; // +-2 g before the pins drive
+  HAL_GPIO_Init(config.port, &gpio);
+
+  memset(&stats_, 0, sizeof(stats_));
+  memset(settle_left, 0, sizeof(settle_left));
+  memset(quiet, 0, sizeof(quiet));
+  wide = 0;
+  mode = ADC_RANGE_AUTO;
+  analogSensor_setRangeHook(adcRange_hook, NULL);
+  return HAL_OK;
+}
+
+void adcRange_deinit(void) {
+  analogSensor_setRangeHook(NULL, NULL);
+  if (config.port == NULL) {
+    return;
+  }
+  for (uint8_t g = 0; g < ADC_CAL_GROUP_COUNT; g++) {
+    config.port->BSRR = (uint32_t)config.pins[g] << 16;
+  }
+  wide = 0;
+}
+
+void adcRange_setMode(AdcRange_Mode_t m) { mode = m; }
+
+AdcRange_Mode_t adcRange_getMode(void) { return mode; }
+
+uint8_t adcRange_getRange(void) { return wide; }
+
+void adcRange_convertEntry_q15(const ADC_RingEntry_t *entry, int16_t *out) {
+  adcCal_convertBlock_q15(entry->frame.samples, 1U, NULL, out);
+  adcRange_scale(out, 1U, entry->range);
+}
+
+void adcRange_convertBlock_q15(const uint16_t *block, uint32_t frames,
+                               const uint8_t *channel_map, uint8_t range,
+                               int16_t *out) {
+  adcCal_convertBlock_q15(block, frames, channel_map, out);
+  adcRange_scale(out, frames, range);
+}
+
+HAL_StatusTypeDef adcRange_getStats(AdcRange_Stats_t *stats) {
+  if (stats == NULL) {
+    return HAL_ERROR;
+  }
+  *stats = stats_;
+  stats->mode = mode;
+  stats->range = wide;
+  return HAL_OK;
+}
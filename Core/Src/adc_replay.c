@@ -0,0 +1,193 @@
+/**
+ ******************************************************************************
+ * @file    adc_replay.c
+ * @brief   Implementation of the replay inputs
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "adc_replay.h"
+#include "qspi_recorder.h"
+#include <string.h>
+
+/* Private types -------------------------------------------------------------*/
+
+typedef struct {
+  const ADC_ReplayImage_t *image;
+  uint32_t next;   ///< Next frame of the vector
+  uint32_t passes; ///< Passes still to start after the current one
+} ADC_ReplayVector_t;
+
+typedef struct {
+  uint32_t remaining; ///< History pages still to play
+  uint32_t age;       ///< Age of the next page to play
+  uint32_t last_seq;  ///< Sequence of the page played last
+  uint8_t played;     ///< A page has been played
+  QspiRec_Page_t page;
+  uint16_t used;     ///< Frames of page already taken
+  uint16_t have;     ///< Frames of page (0 = read the next one)
+  uint32_t filled;   ///< Frames staged in block[]
+  uint16_t block[ADC_CONVERSIONS_BLOCK_SAMPLES]; ///< Channel order
+} ADC_ReplayQspi_t;
+
+/* Private variables ---------------------------------------------------------*/
+
+/* Default vector: none. A generated file defines it without the weak. */
+__attribute__((weak)) const ADC_ReplayImage_t adc_replay_image = {0};
+
+static ADC_ReplayVector_t vector;
+static ADC_ReplayQspi_t qspi;
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+ * @brief One frame in channel order into a block slot frame
+ */
+static inline void adcReplay_placeFrame(uint16_t *dst, const uint16_t *frame,
+                                        const uint8_t *map) {
+  for (uint8_t i = 0; i < ADC_CONVERSIONS_CHANNEL_COUNT; i++) {
+    dst[i] = frame[map[i]];
+  }
+}
+
+/**
+ * @brief Vector source: frames of the image, wrapping between passes
+ */
+static HAL_StatusTypeDef adcReplay_vectorBlock(uint16_t *block,
+                                               uint32_t frame_count,
+                                               void *ctx) {
+  ADC_ReplayVector_t *v = ctx;
+  const uint32_t total = v->image->frame_count;
+  if (v->next + frame_count > total && v->passes == 0U) {
+    return HAL_ERROR; // the rest is shorter than a block
+  }
+  const uint8_t *map = analogSensor_getBlockChannelMap();
+  for (uint32_t f = 0; f < frame_count; f++) {
+    if (v->next == total) {
+      v->next = 0;
+      v->passes--;
+    }
+    adcReplay_placeFrame(&block[f * ADC_CONVERSIONS_CHANNEL_COUNT],
+                         &v->image->samples[v->next *
+                                            ADC_CONVERSIONS_CHANNEL_COUNT],
+                         map);
+    v->next++;
+  }
+  return HAL_OK;
+}
+
+/**
+ * @brief QSPI source: history pages oldest first, staged into a block
+ *
+ * The recorder numbers pages by age from its newest. Recording is held
+ * off during a replay, but a page it still had pending shifts the ages by
+ * one: a read that lands on the page played last steps one page further
+ * back. Ages the ring has not been filled to yet are skipped until the
+ * first page reads back.
+ */
+static HAL_StatusTypeDef adcReplay_qspiBlock(uint16_t *block,
+                                             uint32_t frame_count,
+                                             void *ctx) {
+  ADC_ReplayQspi_t *q = ctx;
+  while (q->filled < frame_count) {
+    if (q->used == q->have) {
+      if (q->remaining == 0U) {
+        return HAL_ERROR;
+      }
+      const HAL_StatusTypeDef status =
+          qspiRec_readHistory(q->age, &q->page);
+      if (status == HAL_BUSY) {
+        return HAL_BUSY;
+      }
+      if (status != HAL_OK && q->played) {
+        return HAL_ERROR; // a lost page ends it
+      }
+      if (status == HAL_OK && q->played && q->page.sequence == q->last_seq) {
+        q->age++;
+        continue;
+      }
+      q->remaining--;
+      if (q->age != 0U) {
+        q->age--;
+      }
+      if (status != HAL_OK) {
+        continue; // not recorded yet
+      }
+      q->played = 1;
+      q->last_seq = q->page.sequence;
+      q->used = 0;
+      q->have = q->page.frame_count;
+    }
+    const uint32_t n = (uint32_t)(q->have - q->used) < frame_count - q->filled
+                           ? (uint32_t)(q->have - q->used)
+                           : frame_count - q->filled;
+    memcpy(&q->block[q->filled * ADC_CONVERSIONS_CHANNEL_COUNT],
+           &q->page.samples[q->used * ADC_CONVERSIONS_CHANNEL_COUNT],
+           n * ADC_CONVERSIONS_CHANNEL_COUNT * sizeof(uint16_t));
+    q->used = (uint16_t)(q->used + n);
+    q->filled += n;
+  }
+  const uint8_t *map = analogSensor_getBlockChannelMap();
+  for (uint32_t f = 0; f < frame_count; f++) {
+    adcReplay_placeFrame(&block[f * ADC_CONVERSIONS_CHANNEL_COUNT],
+                         &q->block[f * ADC_CONVERSIONS_CHANNEL_COUNT], map);
+  }
+  q->filled = 0;
+  return HAL_OK;
+}
+
+/**
+ * @brief Set up the QSPI source on the newest count pages
+ */
+static HAL_StatusTypeDef adcReplay_startQspi(uint32_t count) {
+  QspiRec_Stats_t stats;
+  if (qspiRec_getStats(&stats) != HAL_OK || !stats.ready) {
+    return HAL_ERROR;
+  }
+  if (count == 0U || count > stats.history_pages) {
+    count = stats.history_pages;
+  }
+  qspi.remaining = count;
+  qspi.age = count - 1U;
+  qspi.played = 0;
+  qspi.used = 0;
+  qspi.have = 0;
+  qspi.filled = 0;
+  return HAL_OK;
+}
+
+/* Public functions ----------------------------------------------------------*/
+
+HAL_StatusTypeDef adcReplay_start(ADC_ReplayInput_t input, uint32_t count,
+                                  uint32_t frame_rate_hz, uint8_t paced) {
+  if (analogSensor_getMode() != ADC_ACQ_MODE_POLLING) {
+    return HAL_BUSY;
+  }
+  if (input == ADC_REPLAY_VECTOR) {
+    const ADC_ReplayImage_t *image = &adc_replay_image;
+    if (image->magic != ADC_REPLAY_MAGIC ||
+        image->channels != ADC_CONVERSIONS_CHANNEL_COUNT ||
+        image->frame_count == 0U) {
+      return HAL_ERROR;
+    }
+    vector.image = image;
+    vector.next = 0;
+    vector.passes = (count != 0U) ? count - 1U : 0U;
+    return analogSensor_startReplay(frame_rate_hz, paced,
+                                    adcReplay_vectorBlock, &vector);
+  }
+  if (input == ADC_REPLAY_QSPI) {
+    const HAL_StatusTypeDef status = adcReplay_startQspi(count);
+    if (status != HAL_OK) {
+      return status;
+    }
+    return analogSensor_startReplay(frame_rate_hz, paced, adcReplay_qspiBlock,
+                                    &qspi);
+  }
+  return HAL_ERROR;
+}
+
+uint8_t adcReplay_isActive(void) {
+  return (analogSensor_getMode() == ADC_ACQ_MODE_REPLAY) ? 1U : 0U;
+}
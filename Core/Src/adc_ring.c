@@ -0,0 +1,330 @@
+/**
+ ******************************************************************************
+ * @file    adc_ring.c
+ * @brief   Implementation of the lock-free SPMC ADC frame ring
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "adc_ring.h"
+#include "adc_sections.h"
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define ADC_RING_MASK (ADC_RING_CAPACITY - 1U)
+#define ADC_RING_RESYNC (ADC_RING_CAPACITY / 2U) // kept by a lapped reader
+
+#if (ADC_RING_CAPACITY & ADC_RING_MASK) != 0
+#error "ADC_RING_CAPACITY must be a power of two"
+#endif
+
+#if ADC_RING_MAX_CONSUMERS < 1 || ADC_RING_MAX_CONSUMERS > 255
+#error "ADC_RING_MAX_CONSUMERS must be 1..255"
+#endif
+
+/* Private types -------------------------------------------------------------*/
+
+/**
+ * @brief One consumer: the tail is its reader's, read by the producer
+ */
+typedef struct {
+  volatile uint32_t tail;
+  volatile uint8_t active;
+  uint8_t required;
+  uint8_t overrun;
+  uint32_t max_lag;
+  uint32_t overruns;
+  uint32_t lost;
+} AdcRing_Cursor_t;
+
+/* Private variables ---------------------------------------------------------*/
+/* CPU-only working set: kept in DTCM, off the bus matrix the DMA uses */
+static ADC_RingEntry_t ring_slots[ADC_RING_CAPACITY] ADC_FAST_BSS;
+
+static volatile uint32_t ring_head = 0; // written by the producer only
+static AdcRing_Cursor_t ring_cursors[ADC_RING_MAX_CONSUMERS] = {
+    [ADC_RING_DEFAULT_CONSUMER] = {.active = 1, .required = 1}};
+
+static volatile uint32_t ring_high_water = 0; // producer
+static volatile uint32_t ring_overflows = 0;  // producer
+
+/* Private functions ---------------------------------------------------------*/
+
+static AdcRing_Cursor_t *adcRing_cursor(uint8_t id) {
+  if (id >= ADC_RING_MAX_CONSUMERS || !ring_cursors[id].active) {
+    return NULL;
+  }
+  return &ring_cursors[id];
+}
+
+/**
+ * @brief Frames held for the slowest required consumer
+ */
+ADC_FAST_CODE static uint32_t adcRing_used(uint32_t head) {
+  uint32_t used = 0;
+  for (uint32_t i = 0; i < ADC_RING_MAX_CONSUMERS; i++) {
+    const AdcRing_Cursor_t *c = &ring_cursors[i];
+    const uint32_t behind = head - c->tail;
+    if (c->active && c->required && behind > used) {
+      used = behind;
+    }
+  }
+  return used;
+}
+
+/**
+ * @brief The oldest lent slot is still the one the producer published
+ */
+static uint8_t adcRing_intact(const AdcRing_Cursor_t *c) {
+  // The caller's reads of the slots come before this look at the head
+  __DMB();
+  return c->required || ring_head - c->tail < ADC_RING_CAPACITY;
+}
+
+static uint32_t adcRing_peekCursor(AdcRing_Cursor_t *c,
+                                   const ADC_RingEntry_t **span,
+                                   uint32_t max_entries) {
+  const uint32_t head = ring_head;
+  uint32_t tail = c->tail;
+  uint32_t count = head - tail;
+  if (count > c->max_lag) {
+    c->max_lag = count;
+  }
+  if (!c->required && count >= ADC_RING_CAPACITY) {
+    // Lapped, or the producer is on its oldest slot: keep the newest half
+    tail = head - ADC_RING_RESYNC;
+    c->lost += tail - c->tail;
+    c->overruns++;
+    c->overrun = 1;
+    c->tail = tail;
+    count = ADC_RING_RESYNC;
+  }
+  const uint32_t first = tail & ADC_RING_MASK;
+  if (count > ADC_RING_CAPACITY - first) {
+    count = ADC_RING_CAPACITY - first;
+  }
+  if (count > max_entries) {
+    count = max_entries;
+  }
+  if (count == 0U) {
+    return 0;
+  }
+
+  // The caller reads the slots only after observing the head
+  __DMB();
+  *span = &ring_slots[first];
+  return count;
+}
+
+static HAL_StatusTypeDef adcRing_consumeCursor(AdcRing_Cursor_t *c,
+                                               uint32_t count) {
+  const uint32_t tail = c->tail;
+  const uint32_t used = ring_head - tail;
+  if (count > used) {
+    count = used;
+  }
+  HAL_StatusTypeDef status = HAL_OK;
+  if (count != 0U && !adcRing_intact(c)) {
+    c->lost += count;
+    c->overruns++;
+    c->overrun = 1;
+    status = HAL_ERROR;
+  }
+
+  // Finish the caller's reads before handing the slots back
+  __DMB();
+  c->tail = tail + count;
+  return status;
+}
+
+/* Public functions ----------------------------------------------------------*/
+
+void adcRing_reset(void) {
+  ring_head = 0;
+  for (uint32_t i = 0; i < ADC_RING_MAX_CONSUMERS; i++) {
+    AdcRing_Cursor_t *c = &ring_cursors[i];
+    c->tail = 0;
+    c->overrun = 0;
+    c->max_lag = 0;
+    c->overruns = 0;
+    c->lost = 0;
+  }
+  ring_high_water = 0;
+  ring_overflows = 0;
+}
+
+ADC_FAST_CODE HAL_StatusTypeDef adcRing_push(const ADC_RingEntry_t *entry) {
+  uint32_t head = ring_head;
+  uint32_t used = adcRing_used(head);
+
+  if (used >= ADC_RING_CAPACITY) {
+    ring_overflows++;
+    return HAL_ERROR;
+  }
+
+  ring_slots[head & ADC_RING_MASK] = *entry;
+
+  // Slot contents must be visible before the consumer can see the new head
+  __DMB();
+  ring_head = head + 1U;
+
+  if (used + 1U > ring_high_water) {
+    ring_high_water = used + 1U;
+  }
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef adcRing_pop(ADC_RingEntry_t *entry) {
+  if (entry == NULL) {
+    return HAL_ERROR;
+  }
+
+  AdcRing_Cursor_t *c = &ring_cursors[ADC_RING_DEFAULT_CONSUMER];
+  uint32_t tail = c->tail;
+  if (tail == ring_head) {
+    return HAL_ERROR;
+  }
+
+  // Read the slot only after observing the head that published it
+  __DMB();
+  *entry = ring_slots[tail & ADC_RING_MASK];
+
+  // Finish reading before handing the slot back to the producer
+  __DMB();
+  c->tail = tail + 1U;
+  return HAL_OK;
+}
+
+uint32_t adcRing_popBulk(ADC_RingEntry_t *entries, uint32_t max_entries) {
+  if (entries == NULL) {
+    return 0;
+  }
+
+  AdcRing_Cursor_t *c = &ring_cursors[ADC_RING_DEFAULT_CONSUMER];
+  const uint32_t tail = c->tail;
+  uint32_t count = ring_head - tail;
+  if (count > max_entries) {
+    count = max_entries;
+  }
+  if (count == 0U) {
+    return 0;
+  }
+
+  // Read the slots only after observing the head that published them
+  __DMB();
+  const uint32_t first = tail & ADC_RING_MASK;
+  const uint32_t run =
+      (count < ADC_RING_CAPACITY - first) ? count : ADC_RING_CAPACITY - first;
+  memcpy(entries, &ring_slots[first], run * sizeof(ADC_RingEntry_t));
+  memcpy(&entries[run], ring_slots, (count - run) * sizeof(ADC_RingEntry_t));
+
+  // Finish reading before handing the slots back to the producer
+  __DMB();
+  c->tail = tail + count;
+  return count;
+}
+
+uint32_t adcRing_peek(const ADC_RingEntry_t **span, uint32_t max_entries) {
+  return adcRing_peekFor(ADC_RING_DEFAULT_CONSUMER, span, max_entries);
+}
+
+void adcRing_consume(uint32_t count) {
+  (void)adcRing_consumeFor(ADC_RING_DEFAULT_CONSUMER, count);
+}
+
+uint32_t adcRing_count(void) {
+  return adcRing_countFor(ADC_RING_DEFAULT_CONSUMER);
+}
+
+HAL_StatusTypeDef adcRing_getStats(ADC_RingStats_t *stats) {
+  if (stats == NULL) {
+    return HAL_ERROR;
+  }
+  stats->count = adcRing_count();
+  stats->high_water = ring_high_water;
+  stats->overflows = ring_overflows;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef adcRing_attach(uint8_t required, uint8_t *id) {
+  if (id == NULL) {
+    return HAL_ERROR;
+  }
+  for (uint32_t i = 0; i < ADC_RING_MAX_CONSUMERS; i++) {
+    AdcRing_Cursor_t *c = &ring_cursors[i];
+    if (c->active) {
+      continue;
+    }
+    c->tail = ring_head;
+    c->required = required ? 1U : 0U;
+    c->overrun = 0;
+    c->max_lag = 0;
+    c->overruns = 0;
+    c->lost = 0;
+    // The producer sees the cursor only once its tail is set
+    __DMB();
+    c->active = 1;
+    *id = (uint8_t)i;
+    return HAL_OK;
+  }
+  return HAL_BUSY;
+}
+
+void adcRing_detach(uint8_t id) {
+  if (id != ADC_RING_DEFAULT_CONSUMER && id < ADC_RING_MAX_CONSUMERS) {
+    ring_cursors[id].active = 0;
+  }
+}
+
+uint32_t adcRing_peekFor(uint8_t id, const ADC_RingEntry_t **span,
+                         uint32_t max_entries) {
+  AdcRing_Cursor_t *c = adcRing_cursor(id);
+  if (c == NULL || span == NULL) {
+    return 0;
+  }
+  return adcRing_peekCursor(c, span, max_entries);
+}
+
+HAL_StatusTypeDef adcRing_consumeFor(uint8_t id, uint32_t count) {
+  AdcRing_Cursor_t *c = adcRing_cursor(id);
+  if (c == NULL) {
+    return HAL_ERROR;
+  }
+  return adcRing_consumeCursor(c, count);
+}
+
+uint8_t adcRing_intactFor(uint8_t id) {
+  const AdcRing_Cursor_t *c = adcRing_cursor(id);
+  return (c != NULL) ? adcRing_intact(c) : 0U;
+}
+
+uint32_t adcRing_countFor(uint8_t id) {
+  const AdcRing_Cursor_t *c = adcRing_cursor(id);
+  return (c != NULL) ? ring_head - c->tail : 0U;
+}
+
+uint8_t adcRing_takeOverrun(uint8_t id) {
+  AdcRing_Cursor_t *c = adcRing_cursor(id);
+  if (c == NULL || !c->overrun) {
+    return 0;
+  }
+  c->overrun = 0;
+  return 1;
+}
+
+HAL_StatusTypeDef adcRing_getConsumerStats(uint8_t id,
+                                           ADC_RingConsumerStats_t *stats) {
+  if (stats == NULL || id >= ADC_RING_MAX_CONSUMERS) {
+    return HAL_ERROR;
+  }
+  const AdcRing_Cursor_t *c = &ring_cursors[id];
+  stats->active = c->active;
+  stats->required = c->required;
+  stats->overrun = c->overrun;
+  stats->lag = c->active ? ring_head - c->tail : 0U;
+  stats->max_lag = c->max_lag;
+  stats->overruns = c->overruns;
+  stats->lost = c->lost;
+  return HAL_OK;
+}
@@ -0,0 +1,170 @@
+/**
+ ******************************************************************************
+ * @file    adc_supply.c
+ * @brief   Implementation of the VDDA / temperature sampling and the
+ *          ratiometric block correction
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "adc_supply.h"
+#include "adc_sections.h"
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define ADC_SUPPLY_VDDA_MIN_MV 1700.0f // F7 VDDA operating range
+#define ADC_SUPPLY_VDDA_MAX_MV 3600.0f
+#define ADC_SUPPLY_TS_CAL1_C 30.0f
+#define ADC_SUPPLY_TS_CAL2_C 110.0f
+#define ADC_SUPPLY_ALPHA (1.0f / (float)(1UL << ADC_SUPPLY_SMOOTH_SHIFT))
+
+/* Private variables ---------------------------------------------------------*/
+static AdcSupply_Config_t config;
+static uint8_t ready = 0;
+static AdcSupply_Status_t status;
+
+/* Conversion schedule, block callback context */
+static uint32_t frames_since = 0;
+static uint8_t next_source = ADC_INTERNAL_VREFINT;
+static uint8_t ts_seeded = 0;
+
+/* Calibration words, read once */
+static float vrefint_cal = 0.0f;
+static float ts_cal1 = 0.0f;
+static float ts_slope = 0.0f; // degC per code at 3.3 V
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+ * @brief Push the gain for the current VDDA estimate (or unity) to the
+ *        driver
+ */
+static void adcSupply_updateGain(void) {
+  uint16_t gain = ADC_BLOCK_GAIN_UNITY;
+  if (config.correct && status.vdda_mv > 0.0f) {
+    gain = (uint16_t)(status.vdda_mv / (float)config.nominal_mv *
+                          (float)ADC_BLOCK_GAIN_UNITY +
+                      0.5f);
+  }
+  status.gain_q14 = gain;
+  analogSensor_setBlockGain(gain);
+}
+
+/**
+ * @brief Injected result of one internal source (ADC ISR)
+ */
+static void adcSupply_onResult(uint8_t channel, uint16_t value, void *ctx) {
+  (void)ctx;
+  if (value == 0U) {
+    status.rejected++;
+    return;
+  }
+
+  if (channel == ADC_INTERNAL_VREFINT) {
+    status.vrefint_code = value;
+    const float vdda = (float)ADC_SUPPLY_CAL_MV * vrefint_cal / (float)value;
+    if (vdda < ADC_SUPPLY_VDDA_MIN_MV || vdda > ADC_SUPPLY_VDDA_MAX_MV) {
+      status.rejected++;
+      return;
+    }
+    status.vdda_mv = (status.vdda_mv == 0.0f)
+                         ? vdda
+                         : status.vdda_mv +
+                               (vdda - status.vdda_mv) * ADC_SUPPLY_ALPHA;
+    adcSupply_updateGain();
+  } else {
+    status.ts_code = value;
+    // The calibration codes were taken at 3.3 V: rescale to them first
+    if (status.vdda_mv == 0.0f) {
+      return;
+    }
+    const float code = (float)value * status.vdda_mv / (float)ADC_SUPPLY_CAL_MV;
+    const float celsius = (code - ts_cal1) * ts_slope + ADC_SUPPLY_TS_CAL1_C;
+    status.temperature_c =
+        !ts_seeded ? celsius
+                   : status.temperature_c +
+                         (celsius - status.temperature_c) * ADC_SUPPLY_ALPHA;
+    ts_seeded = 1;
+  }
+  status.readings++;
+}
+
+/* Public functions ----------------------------------------------------------*/
+
+HAL_StatusTypeDef adcSupply_init(const AdcSupply_Config_t *cfg) {
+  const uint16_t vcal = ADC_SUPPLY_VREFINT_CAL();
+  const uint16_t tcal1 = ADC_SUPPLY_TS_CAL1();
+  const uint16_t tcal2 = ADC_SUPPLY_TS_CAL2();
+  if (vcal == 0U || vcal == 0xFFFFU) {
+    return HAL_ERROR;
+  }
+
+  ready = 0;
+  memset(&config, 0, sizeof(config));
+  if (cfg != NULL) {
+    config = *cfg;
+  }
+  if (config.period_frames == 0U) {
+    config.period_frames = ADC_SUPPLY_PERIOD_FRAMES;
+  }
+  if (config.nominal_mv == 0U) {
+    config.nominal_mv = ADC_SUPPLY_CAL_MV;
+  }
+
+  vrefint_cal = (float)vcal;
+  ts_cal1 = (float)tcal1;
+  // A blank pair leaves the temperature at 0 rather than dividing by it
+  ts_slope = (tcal2 > tcal1) ? (ADC_SUPPLY_TS_CAL2_C - ADC_SUPPLY_TS_CAL1_C) /
+                                   (float)(tcal2 - tcal1)
+                             : 0.0f;
+
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  memset(&status, 0, sizeof(status));
+  frames_since = 0;
+  next_source = ADC_INTERNAL_VREFINT;
+  ts_seeded = 0;
+  adcSupply_updateGain();
+  ready = 1;
+  __set_PRIMASK(primask);
+  return HAL_OK;
+}
+
+ADC_FAST_CODE void adcSupply_processBlock(uint32_t frames) {
+  if (!ready) {
+    return;
+  }
+  frames_since += frames;
+  if (frames_since < config.period_frames) {
+    return;
+  }
+  // A busy injected group (a control-loop read) retries on the next block
+  if (analogSensor_startInternal(next_source, adcSupply_onResult, NULL) !=
+      HAL_OK) {
+    status.deferred++;
+    return;
+  }
+  frames_since = 0;
+  next_source = (next_source == ADC_INTERNAL_VREFINT) ? ADC_INTERNAL_TEMPSENSOR
+                                                      : ADC_INTERNAL_VREFINT;
+}
+
+void adcSupply_setCorrection(uint8_t enable) {
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  config.correct = (enable != 0U);
+  adcSupply_updateGain();
+  __set_PRIMASK(primask);
+}
+
+HAL_StatusTypeDef adcSupply_getStatus(AdcSupply_Status_t *out) {
+  if (out == NULL) {
+    return HAL_ERROR;
+  }
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  *out = status;
+  __set_PRIMASK(primask);
+  return HAL_OK;
+}
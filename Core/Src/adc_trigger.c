@@ -0,0 +1,909 @@
+/**
+ ******************************************************************************
+ * @file    adc_trigger.c
+ * @brief   Implementation of the event trigger engine
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "adc_trigger.h"
+#include "adc_sections.h"
+#include "dsp_stats.h"
+#include "dsp_window.h"
+#include "event_log.h"
+#include "frame_pack.h"
+#include "swo_trace.h"
+#include <math.h>
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define ADC_TRIGGER_HISTORY_MASK (ADC_TRIGGER_HISTORY_FRAMES - 1U)
+#define ADC_TRIGGER_NO_HIT 0xFFFFFFFFU
+
+_Static_assert((ADC_TRIGGER_HISTORY_FRAMES & ADC_TRIGGER_HISTORY_MASK) == 0U,
+               "ADC_TRIGGER_HISTORY_FRAMES must be a power of two");
+#if ADC_TRIGGER_PACKED_ENABLE
+_Static_assert(ADC_TRIGGER_HISTORY_FRAMES >= 2U * ADC_CONVERSIONS_BLOCK_FRAMES,
+               "raw ring must hold the block being judged and another");
+_Static_assert(ADC_TRIGGER_PACKED_BYTES >= FRAME_PACK_RUN_BYTES,
+               "packed ring must hold one run at the worst");
+#else
+_Static_assert(ADC_TRIGGER_HISTORY_FRAMES >=
+                   ADC_TRIGGER_CAPTURE_FRAMES + ADC_CONVERSIONS_BLOCK_FRAMES,
+               "history must hold a capture window plus one block");
+#endif
+
+#if ADC_TRIGGER_RETAIN_ENABLE
+#define ADC_TRIGGER_SEAL_MAGIC 0x48495354U // "HIST"
+#define ADC_TRIGGER_SEAL_LAYOUT                                               \
+  ((ADC_TRIGGER_HISTORY_FRAMES << 16) | (sizeof(ADC_Frame_t) << 8) |          \
+   ADC_CONVERSIONS_CHANNEL_COUNT)
+#define ADC_TRIGGER_SEAL_WORDS 6U // words under the CRC
+#define ADC_TRIGGER_HISTORY_SECTION ADC_NOINIT_BSS ADC_DMA_ALIGNED
+#else
+#define ADC_TRIGGER_HISTORY_SECTION
+#endif
+
+/* Private types -------------------------------------------------------------*/
+
+/**
+ * @brief Where the kept history stood after the last block recorded
+ */
+typedef struct {
+  uint32_t magic;
+  uint32_t layout;        // ADC_TRIGGER_SEAL_LAYOUT of the build
+  uint32_t frames_seen;   // in slot numbers: frames + slot_base
+  uint32_t history_start;
+  uint32_t block_frames;  // largest block recorded: a torn one may overlap
+  uint32_t tick;          // HAL tick of the newest block
+  uint32_t crc;           // CRC-32 of the words above
+} ADC_TriggerSeal_t;
+
+/* Private variables ---------------------------------------------------------*/
+
+/* Frames in channel order; history is written by the ISR only */
+static ADC_Frame_t history[ADC_TRIGGER_HISTORY_FRAMES]
+    ADC_TRIGGER_HISTORY_SECTION;
+static ADC_Frame_t capture[ADC_TRIGGER_CAPTURE_FRAMES];
+static uint32_t frames_seen = 0; // frames written to history
+static uint32_t history_start = 0; // oldest frame since the last gap
+static uint32_t slot_base = 0; // history slot of frame 0: after the kept ones
+
+static ADC_TriggerConfig_t channel_cfg[ADC_CONVERSIONS_CHANNEL_COUNT];
+static ADC_TriggerConfig_t group_cfg[ADC_CAL_GROUP_COUNT];
+static int32_t group_zero[ADC_CAL_GROUP_COUNT][ADC_CAL_AXES]; // zero-g codes
+static uint16_t pre_frames = 0;
+static uint16_t post_frames = 1;
+
+/* RMS window accumulators */
+static uint32_t rms_sum[ADC_CONVERSIONS_CHANNEL_COUNT];
+static uint64_t rms_sum_sq[ADC_CONVERSIONS_CHANNEL_COUNT];
+static uint16_t rms_count[ADC_CONVERSIONS_CHANNEL_COUNT];
+
+#if DSP_WINDOW_ENABLE
+/* Sliding windows of PEAK_TO_PEAK and RMS_SLIDING, slid by the ISR */
+static DSP_WindowChannel_t windows[ADC_CONVERSIONS_CHANNEL_COUNT]
+    ADC_FAST_BSS;
+#endif
+
+/* Trigger expression, evaluated on the statistics of every block */
+static TriggerExpr_t *expression = NULL;
+static DSP_StatsAccum_t expr_acc[ADC_CONVERSIONS_CHANNEL_COUNT];
+static ADC_ChannelStats_t expr_stats[ADC_CONVERSIONS_CHANNEL_COUNT];
+
+static volatile ADC_TriggerState_t state = ADC_TRIGGER_STATE_IDLE;
+static ADC_TriggerEvent_t event;
+
+/* External alarm waiting for the next block */
+static volatile uint8_t fire_pending = 0;
+static uint8_t fire_channel = 0;
+static uint16_t fire_low = 0;
+static uint16_t fire_high = 0;
+static uint32_t fire_timestamp = 0;
+
+/* Dead time: each counter has one writer, the ADC or the DMA interrupt */
+static volatile uint32_t missed_alarms = 0;
+static volatile uint32_t blind_frames = 0;
+static volatile uint32_t pinned_frames = 0;
+static volatile uint32_t cut_captures = 0;
+
+/* Snapshot: pinned and pin_next are written by the main loop only, and
+ * pin_next only moves forward, so the ISR never frees a slot too early */
+static volatile uint8_t pinned = 0;
+static volatile uint32_t pin_next = 0; // oldest frame still pinned
+static uint32_t pin_end = 0;           // one past the newest
+static uint32_t pin_offset = 0; // snapshot numbers - frames (recovered only)
+
+#if ADC_TRIGGER_PACKED_ENABLE
+/* Packed look-back, written by the ISR. From the trigger on its runs are
+ * held: from the trigger frame while collecting (older ones may still go),
+ * from the window's first frame once frozen, until decoded */
+static uint8_t packed_buf[ADC_TRIGGER_PACKED_BYTES];
+static FramePack_t packed;
+static uint8_t unpacked = 0; // the frozen window is in capture[]
+static volatile uint32_t trimmed_frames = 0;
+#endif
+
+#if ADC_TRIGGER_RETAIN_ENABLE
+/* Two copies written one after the other: a reset tears one at most */
+static ADC_TriggerSeal_t seals[2] ADC_NOINIT_BSS ADC_DMA_ALIGNED;
+static uint32_t block_frames = 0;
+#endif
+
+/* Private functions ---------------------------------------------------------*/
+
+static inline uint32_t adcTrigger_slot(uint32_t frame) {
+  return (frame + slot_base) & ADC_TRIGGER_HISTORY_MASK;
+}
+
+static inline uint16_t adcTrigger_sample(uint32_t frame, uint8_t channel) {
+  return history[adcTrigger_slot(frame)].samples[channel];
+}
+
+/**
+ * @brief Find the first frame of [base, base + frames) where a channel's
+ *        condition holds, searching no further than limit
+ *
+ * @return Offset into the block, or ADC_TRIGGER_NO_HIT
+ */
+static uint32_t adcTrigger_scan(uint8_t ch, uint32_t base, uint32_t limit,
+                                uint16_t *value) {
+  const ADC_TriggerConfig_t *cfg = &channel_cfg[ch];
+  const uint16_t thr = cfg->threshold;
+
+  for (uint32_t f = 0; f < limit; f++) {
+    const uint32_t n = base + f;
+    const uint16_t x = adcTrigger_sample(n, ch);
+
+    switch (cfg->condition) {
+    case ADC_TRIGGER_LEVEL_ABOVE:
+      if (x >= thr) {
+        *value = x;
+        return f;
+      }
+      break;
+
+    case ADC_TRIGGER_LEVEL_BELOW:
+      if (x <= thr) {
+        *value = x;
+        return f;
+      }
+      break;
+
+    case ADC_TRIGGER_SLOPE: {
+      if (n - history_start < cfg->window) {
+        break;
+      }
+      uint16_t prev = adcTrigger_sample(n - cfg->window, ch);
+      uint16_t slope = (x > prev) ? (uint16_t)(x - prev) : (uint16_t)(prev - x);
+      if (slope >= thr) {
+        *value = slope;
+        return f;
+      }
+      break;
+    }
+
+    case ADC_TRIGGER_RMS: {
+      rms_sum[ch] += x;
+      rms_sum_sq[ch] += (uint32_t)x * x;
+      if (++rms_count[ch] < cfg->window) {
+        break;
+      }
+      // n^2 * variance = n * sum_sq - sum^2, compared against n^2 * thr^2
+      uint64_t w = cfg->window;
+      uint64_t var_n2 = w * rms_sum_sq[ch] - (uint64_t)rms_sum[ch] * rms_sum[ch];
+      uint64_t thr_n2 = (uint64_t)thr * thr * w * w;
+      rms_sum[ch] = 0;
+      rms_sum_sq[ch] = 0;
+      rms_count[ch] = 0;
+      if (var_n2 >= thr_n2) {
+        *value = (uint16_t)sqrtf((float)var_n2 / (float)(w * w));
+        return f;
+      }
+      break;
+    }
+
+#if DSP_WINDOW_ENABLE
+    case ADC_TRIGGER_PEAK_TO_PEAK: {
+      DSP_WindowChannel_t *c = &windows[ch];
+      dspWindow_push(c, cfg->window, x);
+      if (c->filled < cfg->window) {
+        break;
+      }
+      const uint16_t pp = (uint16_t)(dspWindow_max(c) - dspWindow_min(c));
+      if (pp >= thr) {
+        *value = pp;
+        return f;
+      }
+      break;
+    }
+
+    case ADC_TRIGGER_RMS_SLIDING: {
+      DSP_WindowChannel_t *c = &windows[ch];
+      dspWindow_push(c, cfg->window, x);
+      if (c->filled < cfg->window) {
+        break;
+      }
+      const uint64_t w = cfg->window;
+      const uint64_t var_n2 = dspWindow_varianceN2(c);
+      if (var_n2 >= (uint64_t)thr * thr * w * w) {
+        *value = (uint16_t)sqrtf((float)var_n2 / (float)(w * w));
+        return f;
+      }
+      break;
+    }
+#endif
+
+    default:
+      return ADC_TRIGGER_NO_HIT;
+    }
+  }
+  return ADC_TRIGGER_NO_HIT;
+}
+
+/**
+ * @brief Conditions whose state moves with every frame: they see the
+ *        whole block even past an earlier hit
+ */
+static inline uint8_t adcTrigger_isWindowed(ADC_TriggerCondition_t cond) {
+  return cond == ADC_TRIGGER_RMS || cond == ADC_TRIGGER_PEAK_TO_PEAK ||
+         cond == ADC_TRIGGER_RMS_SLIDING;
+}
+
+/**
+ * @brief Empty the RMS and sliding windows, after a gap or at an arm
+ */
+static void adcTrigger_resetWindows(void) {
+  memset(rms_sum, 0, sizeof(rms_sum));
+  memset(rms_sum_sq, 0, sizeof(rms_sum_sq));
+  memset(rms_count, 0, sizeof(rms_count));
+#if DSP_WINDOW_ENABLE
+  for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+    dspWindow_resetChannel(&windows[ch]);
+  }
+#endif
+}
+
+/**
+ * @brief Find the first frame of [base, base + limit) where a group's
+ *        vector length crosses its threshold
+ *
+ * @return Offset into the block, or ADC_TRIGGER_NO_HIT
+ */
+static uint32_t adcTrigger_scanGroup(uint8_t g, uint32_t base, uint32_t limit,
+                                     uint16_t *value) {
+  const uint8_t above = (group_cfg[g].condition == ADC_TRIGGER_MAGNITUDE_ABOVE);
+  const uint32_t thr2 = (uint32_t)group_cfg[g].threshold *
+                        group_cfg[g].threshold;
+  const uint8_t ch0 = (uint8_t)(g * ADC_CAL_AXES);
+
+  for (uint32_t f = 0; f < limit; f++) {
+    const ADC_Frame_t *fr = &history[adcTrigger_slot(base + f)];
+    // 3 x 4095^2 < 2^26: the squared length fits easily
+    uint32_t m2 = 0;
+    for (uint8_t a = 0; a < ADC_CAL_AXES; a++) {
+      const int32_t d = (int32_t)fr->samples[ch0 + a] - group_zero[g][a];
+      m2 += (uint32_t)(d * d);
+    }
+    if (above ? (m2 >= thr2) : (m2 <= thr2)) {
+      *value = (uint16_t)sqrtf((float)m2);
+      return f;
+    }
+  }
+  return ADC_TRIGGER_NO_HIT;
+}
+
+/**
+ * @brief Locate a pending alarm: first frame outside the alarm window
+ */
+static uint32_t adcTrigger_scanAlarm(uint32_t base, uint32_t frames,
+                                     uint16_t *value) {
+  for (uint32_t f = 0; f < frames; f++) {
+    uint16_t x = adcTrigger_sample(base + f, fire_channel);
+    if (x < fire_low || x > fire_high) {
+      *value = x;
+      return f;
+    }
+  }
+  // Converted just outside this block: keep the alarm, pin it to frame 0
+  *value = adcTrigger_sample(base, fire_channel);
+  return 0;
+}
+
+/**
+ * @brief Step the expression on the statistics of a raw block
+ *
+ * @return uint32_t Frame of the block where its hold was reached, or
+ *         ADC_TRIGGER_NO_HIT
+ */
+static uint32_t adcTrigger_scanExpression(const uint16_t *block,
+                                          uint32_t frames,
+                                          const uint8_t *channel_map) {
+  dspStats_reset(expr_acc);
+  dspStats_accumulate(expr_acc, block, frames);
+  for (uint8_t s = 0; s < ADC_CONVERSIONS_CHANNEL_COUNT; s++) {
+    const uint8_t ch = (channel_map != NULL) ? channel_map[s] : s;
+    if ((expression->channel_mask >> ch) & 1U) {
+      dspStats_compute(&expr_acc[s], &expr_stats[ch]);
+    }
+  }
+  uint32_t offset = 0;
+  if (!triggerExpr_step(expression, expr_stats, frames, &offset)) {
+    return ADC_TRIGGER_NO_HIT;
+  }
+  return (offset < frames) ? offset : frames - 1U;
+}
+
+/**
+ * @brief Evaluate every watched channel on the block just recorded
+ *
+ * @param expr_hit Frame the expression fired at, or ADC_TRIGGER_NO_HIT
+ */
+static void adcTrigger_evaluate(uint32_t base, uint32_t frames,
+                                uint32_t expr_hit) {
+  uint32_t best = ADC_TRIGGER_NO_HIT;
+  uint8_t best_ch = 0;
+  uint16_t best_value = 0;
+  ADC_TriggerCondition_t best_condition = ADC_TRIGGER_NONE;
+  uint32_t timestamp = HAL_GetTick();
+
+  for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+    if (channel_cfg[ch].condition == ADC_TRIGGER_NONE) {
+      continue;
+    }
+    // RMS windows keep their phase, so they always see the whole block
+    uint32_t limit = (adcTrigger_isWindowed(channel_cfg[ch].condition) ||
+                      best == ADC_TRIGGER_NO_HIT)
+                         ? frames
+                         : best;
+    uint16_t value = 0;
+    uint32_t hit = adcTrigger_scan(ch, base, limit, &value);
+    if (hit < best) {
+      best = hit;
+      best_ch = ch;
+      best_value = value;
+      best_condition = channel_cfg[ch].condition;
+    }
+  }
+
+  for (uint8_t g = 0; g < ADC_CAL_GROUP_COUNT; g++) {
+    if (group_cfg[g].condition == ADC_TRIGGER_NONE) {
+      continue;
+    }
+    uint16_t value = 0;
+    uint32_t hit = adcTrigger_scanGroup(
+        g, base, (best == ADC_TRIGGER_NO_HIT) ? frames : best, &value);
+    if (hit < best) {
+      best = hit;
+      best_ch = (uint8_t)(g * ADC_CAL_AXES);
+      best_value = value;
+      best_condition = group_cfg[g].condition;
+    }
+  }
+
+  if (fire_pending) {
+    uint16_t value = 0;
+    uint32_t hit = adcTrigger_scanAlarm(base, frames, &value);
+    if (hit < best) {
+      best = hit;
+      best_ch = fire_channel;
+      best_value = value;
+      best_condition = ADC_TRIGGER_WATCHDOG;
+      timestamp = fire_timestamp;
+    }
+    fire_pending = 0;
+  }
+
+  if (expr_hit < best) {
+    best = expr_hit;
+    best_ch = 0;
+    while (best_ch + 1U < ADC_CONVERSIONS_CHANNEL_COUNT &&
+           !((expression->channel_mask >> best_ch) & 1U)) {
+      best_ch++;
+    }
+    best_value = (expression->hold_ms > UINT16_MAX)
+                     ? UINT16_MAX
+                     : (uint16_t)expression->hold_ms;
+    best_condition = ADC_TRIGGER_EXPRESSION;
+  }
+
+  if (best == ADC_TRIGGER_NO_HIT) {
+    return;
+  }
+
+  uint32_t trigger = base + best;
+#if ADC_TRIGGER_PACKED_ENABLE
+  const uint32_t held = trigger - framePack_startFrame(&packed);
+  framePack_hold(&packed, trigger);
+#else
+  const uint32_t held = trigger - history_start;
+#endif
+  uint32_t pre = (held < pre_frames) ? held : pre_frames;
+  event.channel = best_ch;
+  event.condition = best_condition;
+  event.value = best_value;
+  event.trigger_frame = trigger;
+  event.first_frame = trigger - pre;
+  event.timestamp = timestamp;
+  event.pre_frames = (uint16_t)pre;
+  event.frame_count = (uint16_t)(pre + post_frames);
+  state = ADC_TRIGGER_STATE_TRIGGERED;
+  eventLog_write(EVENT_LOG_TRIGGER, (uint8_t)best_condition, trigger);
+#if SWO_TRACE_ENABLE
+  swoTrace_marker((uint8_t)(SWO_TRACE_MARK_TRIGGER + best_ch), trigger);
+#endif
+}
+
+/**
+ * @brief Freeze the window once the post-trigger frames are in the history
+ */
+static void adcTrigger_freeze(void) {
+  if (frames_seen < event.first_frame + event.frame_count) {
+    return;
+  }
+#if ADC_TRIGGER_PACKED_ENABLE
+  // The ring may have given up the oldest frames for the newest; the
+  // window is decoded by adcTrigger_getCapture()
+  const uint32_t trim = framePack_startFrame(&packed) - event.first_frame;
+  if (trim <= event.pre_frames) {
+    event.first_frame += trim;
+    event.pre_frames = (uint16_t)(event.pre_frames - trim);
+    event.frame_count = (uint16_t)(event.frame_count - trim);
+    trimmed_frames += trim;
+  }
+  framePack_hold(&packed, event.first_frame);
+  unpacked = 0;
+#else
+  for (uint16_t i = 0; i < event.frame_count; i++) {
+    capture[i] = history[adcTrigger_slot(event.first_frame + i)];
+  }
+#endif
+  __DMB();
+  state = ADC_TRIGGER_STATE_READY;
+}
+
+#if ADC_TRIGGER_PACKED_ENABLE
+/**
+ * @brief Pack the block just recorded, straight from the raw ring
+ */
+static void adcTrigger_pack(uint32_t base, uint32_t frames) {
+  const uint32_t at = adcTrigger_slot(base);
+  const uint32_t first = (frames < ADC_TRIGGER_HISTORY_FRAMES - at)
+                             ? frames
+                             : ADC_TRIGGER_HISTORY_FRAMES - at;
+  HAL_StatusTypeDef status = framePack_push(&packed, &history[at], first, base);
+  if (status == HAL_OK && first < frames) {
+    status = framePack_push(&packed, history, frames - first, base + first);
+  }
+  if (status != HAL_OK && state == ADC_TRIGGER_STATE_TRIGGERED) {
+    // No room left for the post-trigger frames
+    framePack_release(&packed);
+    state = ADC_TRIGGER_STATE_ARMED;
+    cut_captures++;
+  }
+}
+#endif
+
+#if ADC_TRIGGER_RETAIN_ENABLE
+/**
+ * @brief CRC-32 (reflected, 0xEDB88320) in software, as retained.c: the CRC
+ *        unit may be busy in the main loop when the block callback runs
+ */
+static uint32_t adcTrigger_crc32(const uint32_t *words, uint32_t count) {
+  uint32_t crc = 0xFFFFFFFFU;
+  for (uint32_t i = 0; i < count; i++) {
+    crc ^= words[i];
+    for (uint8_t b = 0; b < 32U; b++) {
+      crc = (crc & 1U) ? (crc >> 1) ^ 0xEDB88320U : crc >> 1;
+    }
+  }
+  return ~crc;
+}
+
+/**
+ * @brief Write a span back from the D-cache to SRAM, where a reset finds it
+ */
+static void adcTrigger_cleanSpan(const void *p, uint32_t bytes) {
+  const uint32_t start = (uint32_t)p & ~(ADC_DCACHE_LINE_SIZE - 1U);
+  SCB_CleanDCache_by_Addr((uint32_t *)start,
+                          (int32_t)((uint32_t)p + bytes - start));
+}
+
+/**
+ * @brief Flush the frames of a block and seal the history state after it
+ */
+static void adcTrigger_seal(uint32_t base, uint32_t frames) {
+  const uint32_t first = adcTrigger_slot(base);
+  const uint32_t run = (frames < ADC_TRIGGER_HISTORY_FRAMES - first)
+                           ? frames
+                           : ADC_TRIGGER_HISTORY_FRAMES - first;
+  adcTrigger_cleanSpan(&history[first], run * sizeof(ADC_Frame_t));
+  if (run < frames) {
+    adcTrigger_cleanSpan(history, (frames - run) * sizeof(ADC_Frame_t));
+  }
+
+  block_frames = (frames > block_frames) ? frames : block_frames;
+  ADC_TriggerSeal_t seal = {.magic = ADC_TRIGGER_SEAL_MAGIC,
+                            .layout = ADC_TRIGGER_SEAL_LAYOUT,
+                            .frames_seen = frames_seen + slot_base,
+                            .history_start = history_start + slot_base,
+                            .block_frames = block_frames,
+                            .tick = HAL_GetTick()};
+  seal.crc = adcTrigger_crc32(&seal.magic, ADC_TRIGGER_SEAL_WORDS);
+  for (uint8_t i = 0; i < 2U; i++) {
+    seals[i] = seal;
+    adcTrigger_cleanSpan(&seals[i], sizeof(seals[i]));
+  }
+}
+
+static uint8_t adcTrigger_sealValid(const ADC_TriggerSeal_t *seal) {
+  return seal->magic == ADC_TRIGGER_SEAL_MAGIC &&
+         seal->layout == ADC_TRIGGER_SEAL_LAYOUT &&
+         seal->crc == adcTrigger_crc32(&seal->magic, ADC_TRIGGER_SEAL_WORDS) &&
+         seal->frames_seen - seal->history_start <=
+             ADC_TRIGGER_HISTORY_FRAMES &&
+         seal->block_frames < ADC_TRIGGER_HISTORY_FRAMES;
+}
+#endif
+
+/* Public functions ----------------------------------------------------------*/
+
+HAL_StatusTypeDef adcTrigger_init(uint16_t pre, uint16_t post) {
+  if (post == 0U || (uint32_t)pre + post > ADC_TRIGGER_CAPTURE_FRAMES) {
+    return HAL_ERROR;
+  }
+  state = ADC_TRIGGER_STATE_IDLE;
+  __DMB();
+  memset(channel_cfg, 0, sizeof(channel_cfg));
+  memset(group_cfg, 0, sizeof(group_cfg));
+  pre_frames = pre;
+  post_frames = post;
+  missed_alarms = 0;
+  blind_frames = 0;
+  pinned_frames = 0;
+  cut_captures = 0;
+#if ADC_TRIGGER_PACKED_ENABLE
+  trimmed_frames = 0;
+  (void)framePack_init(&packed, packed_buf, sizeof(packed_buf));
+#endif
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef adcTrigger_configChannel(uint8_t channel,
+                                           const ADC_TriggerConfig_t *config) {
+  if (channel >= ADC_CONVERSIONS_CHANNEL_COUNT) {
+    return HAL_ERROR;
+  }
+  if (state == ADC_TRIGGER_STATE_ARMED ||
+      state == ADC_TRIGGER_STATE_TRIGGERED) {
+    return HAL_BUSY;
+  }
+  if (config == NULL) {
+    channel_cfg[channel].condition = ADC_TRIGGER_NONE;
+    return HAL_OK;
+  }
+  if (config->condition == ADC_TRIGGER_WATCHDOG ||
+      config->condition == ADC_TRIGGER_MAGNITUDE_ABOVE ||
+      config->condition == ADC_TRIGGER_MAGNITUDE_BELOW ||
+      config->condition == ADC_TRIGGER_EXPRESSION) {
+    return HAL_ERROR;
+  }
+  if ((config->condition == ADC_TRIGGER_SLOPE ||
+       config->condition == ADC_TRIGGER_RMS) &&
+      (config->window == 0U ||
+       config->window > ADC_TRIGGER_HISTORY_FRAMES -
+                            ADC_CONVERSIONS_BLOCK_FRAMES)) {
+    return HAL_ERROR;
+  }
+  if (config->condition == ADC_TRIGGER_PEAK_TO_PEAK ||
+      config->condition == ADC_TRIGGER_RMS_SLIDING) {
+#if DSP_WINDOW_ENABLE
+    if (config->window == 0U || config->window > DSP_WINDOW_MAX_FRAMES) {
+      return HAL_ERROR;
+    }
+    dspWindow_resetChannel(&windows[channel]);
+#else
+    return HAL_ERROR;
+#endif
+  }
+  channel_cfg[channel] = *config;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef adcTrigger_configGroup(uint8_t group,
+                                         const ADC_TriggerConfig_t *config) {
+  if (group >= ADC_CAL_GROUP_COUNT) {
+    return HAL_ERROR;
+  }
+  if (state == ADC_TRIGGER_STATE_ARMED ||
+      state == ADC_TRIGGER_STATE_TRIGGERED) {
+    return HAL_BUSY;
+  }
+  if (config == NULL) {
+    group_cfg[group].condition = ADC_TRIGGER_NONE;
+    return HAL_OK;
+  }
+  if (config->condition != ADC_TRIGGER_MAGNITUDE_ABOVE &&
+      config->condition != ADC_TRIGGER_MAGNITUDE_BELOW) {
+    return HAL_ERROR;
+  }
+  const ADC_CalTable_t *cal = adcCal_getTable();
+  for (uint8_t a = 0; a < ADC_CAL_AXES; a++) {
+    group_zero[group][a] = cal->offset[group * ADC_CAL_AXES + a];
+  }
+  group_cfg[group] = *config;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef adcTrigger_setExpression(TriggerExpr_t *expr) {
+  if (state == ADC_TRIGGER_STATE_ARMED ||
+      state == ADC_TRIGGER_STATE_TRIGGERED) {
+    return HAL_BUSY;
+  }
+  if (expr != NULL && (expr->op_count == 0U || expr->channel_mask == 0U)) {
+    return HAL_ERROR;
+  }
+  expression = expr;
+  return HAL_OK;
+}
+
+void adcTrigger_arm(void) {
+  state = ADC_TRIGGER_STATE_IDLE;
+  __DMB();
+  adcTrigger_resetWindows();
+  triggerExpr_reset(expression);
+  fire_pending = 0;
+#if ADC_TRIGGER_PACKED_ENABLE
+  framePack_release(&packed);
+#endif
+  __DMB();
+  state = ADC_TRIGGER_STATE_ARMED;
+}
+
+void adcTrigger_disarm(void) { state = ADC_TRIGGER_STATE_IDLE; }
+
+ADC_TriggerState_t adcTrigger_getState(void) { return state; }
+
+ADC_FAST_CODE void adcTrigger_process(const uint16_t *block, uint32_t frames,
+                                      const uint8_t *channel_map) {
+  if (block == NULL) {
+    return;
+  }
+
+  // A pinned snapshot keeps its slots: the block is left out instead, and
+  // the history starts again after it
+  const uint32_t base = frames_seen;
+  if (pinned && base + frames - pin_next > ADC_TRIGGER_HISTORY_FRAMES) {
+    frames_seen = base + frames;
+    history_start = frames_seen;
+    pinned_frames += frames; // the last seal still holds: nothing written
+    adcTrigger_resetWindows();
+    if (state == ADC_TRIGGER_STATE_TRIGGERED) {
+      state = ADC_TRIGGER_STATE_ARMED; // its window has a hole
+      cut_captures++;
+#if ADC_TRIGGER_PACKED_ENABLE
+      framePack_release(&packed);
+#endif
+    }
+    return;
+  }
+
+  // Record in channel order; error flags are not tracked in DMA mode
+  for (uint32_t f = 0; f < frames; f++) {
+    ADC_Frame_t *dst = &history[adcTrigger_slot(base + f)];
+    const uint16_t *src = &block[f * ADC_CONVERSIONS_CHANNEL_COUNT];
+    for (uint8_t s = 0; s < ADC_CONVERSIONS_CHANNEL_COUNT; s++) {
+      dst->samples[(channel_map != NULL) ? channel_map[s] : s] = src[s];
+    }
+    dst->error_mask = 0;
+    dst->error_code = ADC_SAMPLE_OK;
+  }
+  frames_seen = base + frames;
+#if ADC_TRIGGER_RETAIN_ENABLE
+  adcTrigger_seal(base, frames);
+#endif
+#if ADC_TRIGGER_PACKED_ENABLE
+  adcTrigger_pack(base, frames);
+#endif
+
+  // A frozen capture waits for its consumer; nothing is evaluated meanwhile
+  if (state == ADC_TRIGGER_STATE_READY) {
+    blind_frames += frames;
+  }
+  if (state == ADC_TRIGGER_STATE_ARMED) {
+    // The hold counts armed blocks only
+    const uint32_t expr_hit =
+        (expression != NULL && frames != 0U)
+            ? adcTrigger_scanExpression(block, frames, channel_map)
+            : ADC_TRIGGER_NO_HIT;
+    adcTrigger_evaluate(base, frames, expr_hit);
+  }
+  if (state == ADC_TRIGGER_STATE_TRIGGERED) {
+    adcTrigger_freeze();
+  }
+}
+
+void adcTrigger_blockCallback(const uint16_t *block, uint32_t frame_count,
+                              void *ctx) {
+  adcTrigger_process(block, frame_count, (const uint8_t *)ctx);
+}
+
+void adcTrigger_fire(uint8_t channel, uint16_t low, uint16_t high,
+                     uint32_t timestamp) {
+  if (channel >= ADC_CONVERSIONS_CHANNEL_COUNT) {
+    return;
+  }
+  if (state != ADC_TRIGGER_STATE_ARMED || fire_pending) {
+    // Disarmed on purpose is not a miss
+    if (state != ADC_TRIGGER_STATE_IDLE) {
+      missed_alarms++;
+    }
+    return;
+  }
+  fire_channel = channel;
+  fire_low = low;
+  fire_high = high;
+  fire_timestamp = timestamp;
+  fire_pending = 1;
+}
+
+void adcTrigger_watchdogCallback(uint8_t channel, uint16_t low, uint16_t high,
+                                 uint32_t timestamp, void *ctx) {
+  UNUSED(ctx);
+  adcTrigger_fire(channel, low, high, timestamp);
+}
+
+HAL_StatusTypeDef adcTrigger_getStats(ADC_TriggerStats_t *stats) {
+  if (stats == NULL) {
+    return HAL_ERROR;
+  }
+  stats->missed_alarms = missed_alarms;
+  stats->blind_frames = blind_frames;
+  stats->pinned_frames = pinned_frames;
+  stats->cut_captures = cut_captures;
+#if ADC_TRIGGER_PACKED_ENABLE
+  stats->lookback_frames = framePack_frames(&packed);
+  stats->trimmed_frames = trimmed_frames;
+  stats->packed_bytes = packed.used;
+#else
+  const uint32_t held = frames_seen - history_start;
+  stats->lookback_frames =
+      (held < ADC_TRIGGER_HISTORY_FRAMES) ? held : ADC_TRIGGER_HISTORY_FRAMES;
+  stats->trimmed_frames = 0;
+  stats->packed_bytes = 0;
+#endif
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef adcTrigger_getCapture(const ADC_TriggerEvent_t **ev,
+                                        const ADC_Frame_t **frames) {
+  if (ev == NULL || frames == NULL) {
+    return HAL_ERROR;
+  }
+  if (state != ADC_TRIGGER_STATE_READY) {
+    return HAL_BUSY;
+  }
+  __DMB();
+#if ADC_TRIGGER_PACKED_ENABLE
+  if (!unpacked) {
+    const HAL_StatusTypeDef status = framePack_decode(
+        &packed, event.first_frame, event.frame_count, capture);
+    if (status != HAL_OK) {
+      adcTrigger_arm();
+      return HAL_ERROR;
+    }
+    unpacked = 1;
+    framePack_release(&packed);
+  }
+#endif
+  *ev = &event;
+  *frames = capture;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef adcTrigger_pinSnapshot(uint32_t frames,
+                                         ADC_TriggerSnapshot_t *snap) {
+  if (snap == NULL || frames == 0U ||
+      frames > ADC_TRIGGER_SNAPSHOT_MAX_FRAMES) {
+    return HAL_ERROR;
+  }
+  if (pinned) {
+    return HAL_BUSY;
+  }
+  // One read of the newest frame: a block written meanwhile lands a capture
+  // window away from the oldest one pinned
+  const uint32_t newest = frames_seen;
+  const uint32_t held = newest - history_start;
+  if (held == 0U) {
+    return HAL_ERROR;
+  }
+  if (frames > held) {
+    frames = held;
+  }
+  pin_next = newest - frames;
+  pin_end = newest;
+  pin_offset = 0;
+  __DMB();
+  pinned = 1;
+  snap->first_frame = newest - frames;
+  snap->frame_count = frames;
+  snap->timestamp = HAL_GetTick();
+  return HAL_OK;
+}
+
+const ADC_Frame_t *adcTrigger_getSnapshotFrame(uint32_t frame) {
+  frame -= pin_offset;
+  if (!pinned || frame - pin_next >= pin_end - pin_next) {
+    return NULL;
+  }
+  return &history[adcTrigger_slot(frame)];
+}
+
+void adcTrigger_releaseSnapshot(uint32_t next_frame) {
+  next_frame -= pin_offset;
+  if (!pinned || next_frame - pin_next > pin_end - pin_next) {
+    return;
+  }
+  // The frames before it have been read out
+  __DMB();
+  if (next_frame == pin_end) {
+    pinned = 0;
+  } else {
+    pin_next = next_frame;
+  }
+}
+
+void adcTrigger_unpinSnapshot(void) {
+  __DMB();
+  pinned = 0;
+}
+
+uint8_t adcTrigger_isPinned(void) { return pinned; }
+
+HAL_StatusTypeDef adcTrigger_recoverHistory(uint8_t warm,
+                                            ADC_TriggerSnapshot_t *snap) {
+#if !ADC_TRIGGER_RETAIN_ENABLE
+  (void)warm;
+  (void)snap;
+  return HAL_ERROR; // the history is cleared at every boot
+#else
+  if (snap == NULL) {
+    return HAL_ERROR;
+  }
+  // The first copy is written first: the newer one whenever it is whole
+  const ADC_TriggerSeal_t *seal = NULL;
+  for (uint8_t i = 0; warm && i < 2U && seal == NULL; i++) {
+    if (adcTrigger_sealValid(&seals[i])) {
+      seal = &seals[i];
+    }
+  }
+  if (seal == NULL) {
+    memset(seals, 0, sizeof(seals));
+    adcTrigger_cleanSpan(seals, sizeof(seals));
+    return HAL_ERROR;
+  }
+
+  // The oldest slots may hold part of a block the reset cut short
+  uint32_t held = seal->frames_seen - seal->history_start;
+  const uint32_t limit = ADC_TRIGGER_HISTORY_FRAMES - seal->block_frames;
+  held = (held < limit) ? held : limit;
+  block_frames = seal->block_frames;
+  if (held == 0U) {
+    return HAL_ERROR;
+  }
+  // This boot's frames go on in the slots after the kept ones and keep
+  // their own numbers from 0; the snapshot keeps the seal's
+  slot_base = seal->frames_seen - frames_seen;
+  history_start = frames_seen;
+  pin_next = frames_seen - held;
+  pin_end = frames_seen;
+  pin_offset = slot_base;
+  __DMB();
+  pinned = 1;
+  snap->first_frame = seal->frames_seen - held;
+  snap->frame_count = held;
+  snap->timestamp = seal->tick;
+  return HAL_OK;
+#endif
+}
@@ -0,0 +1,337 @@
+/**
+ ******************************************************************************
+ * @file    app_rtos.c
+ * @brief   Implementation of the CMSIS-RTOS2 acquisition, DSP and comms tasks
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "app_rtos.h"
+
+#if APP_RTOS_ENABLE
+
+#include "FreeRTOS.h"
+#include "adc_conversions.h"
+#include "block_pool.h"
+#include "cmsis_os2.h"
+#include "cpu_load.h"
+#include "main.h"
+#include "task.h"
+#include "telemetry.h"
+#include "telemetry_frame.h"
+#include "timebase.h"
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define APP_RTOS_FLAG_BLOCK 0x0001U
+#define APP_RTOS_RING_SIZE 2U // one entry per DMA half
+#define APP_RTOS_STACK_WORDS(bytes) ((bytes) / sizeof(StackType_t))
+
+_Static_assert(APP_RTOS_DSP_DEPTH >= 1U &&
+                   APP_RTOS_DSP_DEPTH + 2U <= BLOCK_POOL_COUNT,
+               "the DMA keeps two pool blocks besides the DSP backlog");
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct {
+  const uint16_t *block;
+  uint32_t frame_count;
+  uint32_t seq;  // block interrupt count when it arrived
+  uint64_t time; // timebase at the DMA half
+  BlockPool_Block_t *handle; // held pool block, NULL = ping-pong half
+} AppRtos_Block_t;
+
+typedef struct {
+  uint8_t *buf;
+  uint16_t len;
+  Telemetry_Class_t cls;
+} AppRtos_Packet_t;
+
+/* Private variables ---------------------------------------------------------*/
+static AppRtos_Hooks_t hooks;
+static AppRtos_Stats_t stats;
+static AppRtos_Block_t ring[APP_RTOS_RING_SIZE];
+static volatile uint32_t block_irqs = 0;
+static osThreadId_t acq_task;
+static osThreadId_t dsp_task;
+static osThreadId_t comms_task;
+static osMessageQueueId_t dsp_queue;    // blocks, acquisition -> DSP
+static osMessageQueueId_t packet_queue; // packets, any task -> comms
+static osMessageQueueId_t free_queue;   // packet buffers not in flight
+
+/* Kernel objects, all static (configSUPPORT_DYNAMIC_ALLOCATION is 0) */
+static StaticTask_t acq_tcb, dsp_tcb, comms_tcb;
+static StackType_t acq_stack[APP_RTOS_STACK_WORDS(APP_RTOS_ACQ_STACK_BYTES)];
+static StackType_t dsp_stack[APP_RTOS_STACK_WORDS(APP_RTOS_DSP_STACK_BYTES)];
+static StackType_t
+    comms_stack[APP_RTOS_STACK_WORDS(APP_RTOS_COMMS_STACK_BYTES)];
+static StaticQueue_t dsp_queue_cb, packet_queue_cb, free_queue_cb;
+static uint8_t dsp_queue_mem[APP_RTOS_DSP_DEPTH * sizeof(AppRtos_Block_t)];
+static uint8_t
+    packet_queue_mem[APP_RTOS_PACKET_COUNT * sizeof(AppRtos_Packet_t)];
+static uint8_t free_queue_mem[APP_RTOS_PACKET_COUNT * sizeof(uint8_t *)];
+static uint8_t packets[APP_RTOS_PACKET_COUNT][TELEMETRY_FRAME_ENCODED_MAX];
+static StaticTask_t idle_tcb, timer_tcb;
+static StackType_t idle_stack[configMINIMAL_STACK_SIZE];
+static StackType_t timer_stack[configTIMER_TASK_STACK_DEPTH];
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+ * @brief DMA block hand-off (ISR, priority 0): no kernel calls here
+ */
+static void appRtos_blockCallback(const uint16_t *block, uint32_t frame_count,
+                                  void *ctx) {
+  UNUSED(ctx);
+  AppRtos_Block_t *slot = &ring[block_irqs % APP_RTOS_RING_SIZE];
+  // An entry the acquisition task never took is overwritten: drop its hold
+  blockPool_release(slot->handle);
+  slot->handle = blockPool_fromData(block);
+  blockPool_retain(slot->handle);
+  slot->block = block;
+  slot->frame_count = frame_count;
+  slot->seq = block_irqs;
+  slot->time = timebase_now();
+  block_irqs++;
+  NVIC_SetPendingIRQ(APP_RTOS_NOTIFY_IRQn);
+}
+
+static void appRtos_acqTask(void *argument) {
+  UNUSED(argument);
+  uint32_t next = 0;
+
+  for (;;) {
+    osThreadFlagsWait(APP_RTOS_FLAG_BLOCK, osFlagsWaitAny, osWaitForever);
+    for (;;) {
+      // Priority 0 is above the kernel's BASEPRI: mask it with PRIMASK
+      uint32_t primask = __get_PRIMASK();
+      __disable_irq();
+      uint32_t pending = block_irqs - next;
+      if (pending > APP_RTOS_RING_SIZE) {
+        stats.dropped += pending - APP_RTOS_RING_SIZE;
+        next = block_irqs - APP_RTOS_RING_SIZE;
+      }
+      AppRtos_Block_t blk = ring[next % APP_RTOS_RING_SIZE];
+      if (pending != 0U) {
+        ring[next % APP_RTOS_RING_SIZE].handle = NULL; // the hold is ours
+      }
+      __set_PRIMASK(primask);
+      if (pending == 0U) {
+        break;
+      }
+      next++;
+
+      stats.blocks++;
+      if (hooks.acquire != NULL) {
+        hooks.acquire(blk.block, blk.frame_count);
+      }
+      // A ping-pong half is refilled before a backlog ahead of it clears
+      if ((blk.handle == NULL && osMessageQueueGetCount(dsp_queue) != 0U) ||
+          osMessageQueuePut(dsp_queue, &blk, 0U, 0U) != osOK) {
+        stats.dropped++; // DSP too far behind
+        blockPool_release(blk.handle);
+        continue;
+      }
+      const uint32_t backlog = osMessageQueueGetCount(dsp_queue);
+      if (backlog > stats.backlog_max) {
+        stats.backlog_max = backlog;
+      }
+    }
+  }
+}
+
+static void appRtos_dspTask(void *argument) {
+  UNUSED(argument);
+  AppRtos_Block_t blk;
+
+  for (;;) {
+    if (osMessageQueueGet(dsp_queue, &blk, NULL, osWaitForever) != osOK) {
+      continue;
+    }
+    uint32_t latency_us =
+        (uint32_t)timebase_toMicros(timebase_now() - blk.time);
+    if (latency_us > stats.latency_max_us) {
+      stats.latency_max_us = latency_us;
+    }
+    if (hooks.process != NULL) {
+      hooks.process(blk.block, blk.frame_count);
+    }
+    // A pool block was held throughout; a ping-pong half is refilled as
+    // soon as the next one completes
+    if (blk.handle != NULL) {
+      blockPool_release(blk.handle);
+    } else if (block_irqs - blk.seq > 1U) {
+      stats.late++;
+    }
+  }
+}
+
+static void appRtos_commsTask(void *argument) {
+  UNUSED(argument);
+  AppRtos_Packet_t pkt;
+
+  for (;;) {
+    uint32_t timeout = APP_RTOS_COMMS_PERIOD_MS;
+    while (osMessageQueueGet(packet_queue, &pkt, NULL, timeout) == osOK) {
+      if (telemetry_sendClass(pkt.buf, pkt.len, pkt.cls) != HAL_OK) {
+        stats.packet_drops++;
+      }
+      (void)osMessageQueuePut(free_queue, &pkt.buf, 0U, 0U);
+      timeout = 0U;
+    }
+    if (hooks.service != NULL) {
+      hooks.service();
+    }
+  }
+}
+
+/* Public functions ----------------------------------------------------------*/
+
+HAL_StatusTypeDef appRtos_start(const AppRtos_Hooks_t *app_hooks) {
+  if (app_hooks == NULL) {
+    return HAL_ERROR;
+  }
+  hooks = *app_hooks;
+  memset(&stats, 0, sizeof(stats));
+
+  const osThreadAttr_t acq_attr = {.name = "acq",
+                                   .cb_mem = &acq_tcb,
+                                   .cb_size = sizeof(acq_tcb),
+                                   .stack_mem = acq_stack,
+                                   .stack_size = sizeof(acq_stack),
+                                   .priority = osPriorityRealtime};
+  const osThreadAttr_t dsp_attr = {.name = "dsp",
+                                   .cb_mem = &dsp_tcb,
+                                   .cb_size = sizeof(dsp_tcb),
+                                   .stack_mem = dsp_stack,
+                                   .stack_size = sizeof(dsp_stack),
+                                   .priority = osPriorityAboveNormal};
+  const osThreadAttr_t comms_attr = {.name = "comms",
+                                     .cb_mem = &comms_tcb,
+                                     .cb_size = sizeof(comms_tcb),
+                                     .stack_mem = comms_stack,
+                                     .stack_size = sizeof(comms_stack),
+                                     .priority = osPriorityNormal};
+  const osMessageQueueAttr_t dsp_queue_attr = {
+      .cb_mem = &dsp_queue_cb,
+      .cb_size = sizeof(dsp_queue_cb),
+      .mq_mem = dsp_queue_mem,
+      .mq_size = sizeof(dsp_queue_mem)};
+  const osMessageQueueAttr_t packet_queue_attr = {
+      .cb_mem = &packet_queue_cb,
+      .cb_size = sizeof(packet_queue_cb),
+      .mq_mem = packet_queue_mem,
+      .mq_size = sizeof(packet_queue_mem)};
+  const osMessageQueueAttr_t free_queue_attr = {
+      .cb_mem = &free_queue_cb,
+      .cb_size = sizeof(free_queue_cb),
+      .mq_mem = free_queue_mem,
+      .mq_size = sizeof(free_queue_mem)};
+
+  if (osKernelInitialize() != osOK) {
+    return HAL_ERROR;
+  }
+  // Held pool blocks wait their turn behind a slow DSP pass
+  dsp_queue = osMessageQueueNew(APP_RTOS_DSP_DEPTH, sizeof(AppRtos_Block_t),
+                                &dsp_queue_attr);
+  packet_queue = osMessageQueueNew(
+      APP_RTOS_PACKET_COUNT, sizeof(AppRtos_Packet_t), &packet_queue_attr);
+  // The packet pool: its free buffers queued by pointer
+  free_queue = osMessageQueueNew(APP_RTOS_PACKET_COUNT, sizeof(uint8_t *),
+                                 &free_queue_attr);
+  if (free_queue != NULL) {
+    for (uint32_t i = 0; i < APP_RTOS_PACKET_COUNT; i++) {
+      uint8_t *buf = packets[i];
+      (void)osMessageQueuePut(free_queue, &buf, 0U, 0U);
+    }
+  }
+  acq_task = osThreadNew(appRtos_acqTask, NULL, &acq_attr);
+  dsp_task = osThreadNew(appRtos_dspTask, NULL, &dsp_attr);
+  comms_task = osThreadNew(appRtos_commsTask, NULL, &comms_attr);
+  if (dsp_queue == NULL || packet_queue == NULL || free_queue == NULL ||
+      acq_task == NULL || dsp_task == NULL || comms_task == NULL) {
+    return HAL_ERROR;
+  }
+
+  // Blocks before the kernel runs are counted and skipped as dropped
+  analogSensor_registerBlockCallback(appRtos_blockCallback, NULL);
+  HAL_NVIC_SetPriority(APP_RTOS_NOTIFY_IRQn, APP_RTOS_NOTIFY_PRIORITY, 0);
+  HAL_NVIC_EnableIRQ(APP_RTOS_NOTIFY_IRQn);
+
+  osKernelStart();
+  return HAL_ERROR;
+}
+
+uint8_t *appRtos_reservePacket(void) {
+  uint8_t *buf = NULL;
+  if (osMessageQueueGet(free_queue, &buf, NULL, 0U) != osOK) {
+    stats.packet_drops++;
+    return NULL;
+  }
+  return buf;
+}
+
+void appRtos_commitPacket(uint8_t *buf, uint16_t len, Telemetry_Class_t cls) {
+  if (buf == NULL) {
+    return;
+  }
+  const AppRtos_Packet_t pkt = {.buf = buf, .len = len, .cls = cls};
+  if (len == 0U || osMessageQueuePut(packet_queue, &pkt, 0U, 0U) != osOK) {
+    if (len != 0U) {
+      stats.packet_drops++;
+    }
+    (void)osMessageQueuePut(free_queue, &buf, 0U, 0U);
+  }
+}
+
+HAL_StatusTypeDef appRtos_getStats(AppRtos_Stats_t *out) {
+  if (out == NULL) {
+    return HAL_ERROR;
+  }
+  *out = stats;
+  // Words never written since the task started, as bytes
+  if (osKernelGetState() == osKernelRunning) {
+    out->acq_stack_free = (uint32_t)uxTaskGetStackHighWaterMark(
+                              (TaskHandle_t)acq_task) *
+                          sizeof(StackType_t);
+    out->dsp_stack_free = (uint32_t)uxTaskGetStackHighWaterMark(
+                              (TaskHandle_t)dsp_task) *
+                          sizeof(StackType_t);
+    out->comms_stack_free = (uint32_t)uxTaskGetStackHighWaterMark(
+                                (TaskHandle_t)comms_task) *
+                            sizeof(StackType_t);
+  }
+  return HAL_OK;
+}
+
+void appRtos_notifyIrqHandler(void) {
+  if (osKernelGetState() == osKernelRunning) {
+    osThreadFlagsSet(acq_task, APP_RTOS_FLAG_BLOCK);
+  }
+}
+
+/* FreeRTOS hooks ------------------------------------------------------------*/
+
+void vApplicationIdleHook(void) { cpuLoad_idle(); }
+
+void vApplicationStackOverflowHook(TaskHandle_t xTask, char *pcTaskName) {
+  UNUSED(xTask);
+  UNUSED(pcTaskName);
+  Error_Handler();
+}
+
+void vApplicationGetIdleTaskMemory(StaticTask_t **tcb, StackType_t **stack,
+                                   uint32_t *words) {
+  *tcb = &idle_tcb;
+  *stack = idle_stack;
+  *words = configMINIMAL_STACK_SIZE;
+}
+
+void vApplicationGetTimerTaskMemory(StaticTask_t **tcb, StackType_t **stack,
+                                    uint32_t *words) {
+  *tcb = &timer_tcb;
+  *stack = timer_stack;
+  *words = configTIMER_TASK_STACK_DEPTH;
+}
+
+#endif /* APP_RTOS_ENABLE */
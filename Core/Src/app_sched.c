@@ -0,0 +1,109 @@
+/**
+ ******************************************************************************
+ * @file    app_sched.c
+ * @brief   Implementation of the main-loop scheduler
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "app_sched.h"
+#include "cpu_load.h"
+#include "timebase.h"
+#include <stddef.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define APP_SCHED_MS_TICKS (TIMEBASE_TICK_HZ / 1000U)
+
+/* Private variables ---------------------------------------------------------*/
+static const AppSched_Task_t *table = NULL;
+static uint32_t task_count = 0;
+static uint32_t due_ms[APP_SCHED_MAX_TASKS]; // HAL tick of the next period
+
+/* Raised by appSched_signal(), taken whole by appSched_run() */
+static volatile uint32_t pending = 0;
+
+/* Public functions ----------------------------------------------------------*/
+
+HAL_StatusTypeDef appSched_init(const AppSched_Task_t *tasks, uint32_t count) {
+  if (tasks == NULL || count == 0U || count > APP_SCHED_MAX_TASKS) {
+    return HAL_ERROR;
+  }
+  for (uint32_t i = 0; i < count; i++) {
+    if (tasks[i].run == NULL ||
+        (tasks[i].events == 0U && tasks[i].period_ms == 0U)) {
+      return HAL_ERROR;
+    }
+  }
+
+  const uint32_t now = HAL_GetTick();
+  for (uint32_t i = 0; i < count; i++) {
+    due_ms[i] = now + tasks[i].period_ms;
+  }
+  table = tasks;
+  task_count = count;
+  return HAL_OK;
+}
+
+void appSched_signal(uint32_t events) {
+  // An interrupt in between makes the store fail
+  uint32_t old;
+  do {
+    old = __LDREXW(&pending);
+  } while (__STREXW(old | events, &pending) != 0U);
+}
+
+uint32_t appSched_run(void) {
+  uint32_t events;
+  do {
+    events = __LDREXW(&pending);
+  } while (__STREXW(0U, &pending) != 0U);
+
+  const uint32_t now = HAL_GetTick();
+  uint32_t ran = 0;
+  for (uint32_t i = 0; i < task_count; i++) {
+    const AppSched_Task_t *task = &table[i];
+    uint8_t ready = (task->events & events) != 0U;
+    if (task->period_ms != 0U && (int32_t)(now - due_ms[i]) >= 0) {
+      ready = 1U;
+      due_ms[i] += task->period_ms;
+      if ((int32_t)(now - due_ms[i]) >= 0) {
+        due_ms[i] = now + task->period_ms; // fell behind: no catch-up burst
+      }
+    }
+    if (ready) {
+      task->run();
+      ran++;
+    }
+  }
+  return ran;
+}
+
+void appSched_idle(void) {
+  // The nearest timer, as an alarm: nothing else may end the sleep for it
+  const uint32_t now = HAL_GetTick();
+  uint32_t wait_ms = UINT32_MAX;
+  for (uint32_t i = 0; i < task_count; i++) {
+    if (table[i].period_ms != 0U) {
+      const int32_t left = (int32_t)(due_ms[i] - now);
+      const uint32_t ms = (left > 0) ? (uint32_t)left : 0U;
+      if (ms < wait_ms) {
+        wait_ms = ms;
+      }
+    }
+  }
+
+  if (wait_ms != 0U) {
+    if (wait_ms != UINT32_MAX) {
+      timebase_wakeAt(timebase_now() + (uint64_t)wait_ms * APP_SCHED_MS_TICKS);
+    }
+    // A flag raised after the last run must not wait for the next wake-up
+    const uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    if (pending == 0U) {
+      cpuLoad_idle();
+    }
+    __set_PRIMASK(primask);
+  }
+  appSched_signal(APP_SCHED_EVENT_WAKE);
+}
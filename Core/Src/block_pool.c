@@ -0,0 +1,119 @@
+/**
+ ******************************************************************************
+ * @file    block_pool.c
+ * @brief   Implementation of the reference-counted ADC block pool
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "block_pool.h"
+#include "adc_sections.h"
+
+_Static_assert(BLOCK_POOL_COUNT >= 2U && BLOCK_POOL_COUNT <= 255U,
+               "the DMA needs two blocks; indices are 8-bit");
+_Static_assert((ADC_CONVERSIONS_BLOCK_SAMPLES * sizeof(uint16_t)) %
+                       ADC_DCACHE_LINE_SIZE ==
+                   0U,
+               "pool blocks must not share cache lines");
+
+/* Private variables ---------------------------------------------------------*/
+
+/* DMA target in SRAM1: invalidated per block like the ping-pong buffer */
+static uint16_t arena[BLOCK_POOL_COUNT][ADC_CONVERSIONS_BLOCK_SAMPLES]
+    ADC_SRAM1_BSS ADC_DMA_ALIGNED;
+static BlockPool_Block_t blocks[BLOCK_POOL_COUNT];
+
+/* Free indices, oldest release first */
+static uint8_t free_ring[BLOCK_POOL_COUNT];
+static uint32_t free_head = 0; // next to allocate
+static uint32_t free_count = 0;
+static BlockPool_Stats_t stats;
+
+/* Public functions ----------------------------------------------------------*/
+
+void blockPool_init(void) {
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  for (uint32_t i = 0; i < BLOCK_POOL_COUNT; i++) {
+    blocks[i].data = arena[i];
+    blocks[i].refs = 0;
+    blocks[i].index = (uint8_t)i;
+    free_ring[i] = (uint8_t)i;
+  }
+  free_head = 0;
+  free_count = BLOCK_POOL_COUNT;
+  stats = (BlockPool_Stats_t){0};
+  __set_PRIMASK(primask);
+}
+
+BlockPool_Block_t *blockPool_alloc(void) {
+  BlockPool_Block_t *block = NULL;
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  if (free_count != 0U) {
+    block = &blocks[free_ring[free_head]];
+    free_head = (free_head + 1U) % BLOCK_POOL_COUNT;
+    free_count--;
+    block->refs = 1;
+    stats.allocs++;
+    stats.in_use++;
+    if (stats.in_use > stats.high_water) {
+      stats.high_water = stats.in_use;
+    }
+  } else {
+    stats.failures++;
+  }
+  __set_PRIMASK(primask);
+  return block;
+}
+
+void blockPool_retain(BlockPool_Block_t *block) {
+  if (block == NULL) {
+    return;
+  }
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  if (block->refs != 0U) {
+    block->refs++;
+  }
+  __set_PRIMASK(primask);
+}
+
+void blockPool_release(BlockPool_Block_t *block) {
+  if (block == NULL) {
+    return;
+  }
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  if (block->refs != 0U && --block->refs == 0U) {
+    free_ring[(free_head + free_count) % BLOCK_POOL_COUNT] = block->index;
+    free_count++;
+    stats.in_use--;
+  }
+  __set_PRIMASK(primask);
+}
+
+BlockPool_Block_t *blockPool_fromData(const uint16_t *data) {
+  const uint16_t *base = arena[0];
+  if (data < base || data > arena[BLOCK_POOL_COUNT - 1U]) {
+    return NULL;
+  }
+  uint32_t offset = (uint32_t)(data - base);
+  if (offset % ADC_CONVERSIONS_BLOCK_SAMPLES != 0U) {
+    return NULL;
+  }
+  return &blocks[offset / ADC_CONVERSIONS_BLOCK_SAMPLES];
+}
+
+uint16_t *blockPool_dmaTarget(BlockPool_Block_t *block) {
+  return arena[block->index];
+}
+
+HAL_StatusTypeDef blockPool_getStats(BlockPool_Stats_t *out) {
+  if (out == NULL) {
+    return HAL_ERROR;
+  }
+  *out = stats;
+  return HAL_OK;
+}
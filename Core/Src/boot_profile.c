@@ -0,0 +1,135 @@
+/**
+ ******************************************************************************
+ * @file    boot_profile.c
+ * @brief   Implementation of the boot phase timestamps
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "boot_profile.h"
+#include "telemetry.h"
+#include <stdio.h>
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+
+/* Key that unlocks the DWT registers for software access on the Cortex-M7 */
+#define BOOT_DWT_LAR_UNLOCK_KEY 0xC5ACCE55U
+
+/* Private variables ---------------------------------------------------------*/
+static BootProfile_Entry_t phases[BOOT_PHASE_COUNT];
+static uint32_t last_cycles = 0; // CYCCNT at the previous mark
+static uint32_t last_hz = 0;     // core clock when the open phase began
+static uint32_t elapsed_us = 0;
+static uint8_t marks = 0;
+
+/* Next report position; BOOT_PHASE_COUNT = no report pending */
+static uint8_t report_next = BOOT_PHASE_COUNT;
+
+static const char *const phase_names[BOOT_PHASE_COUNT] = {
+    [BOOT_PHASE_HAL] = "hal",
+    [BOOT_PHASE_CLOCK] = "clock",
+    [BOOT_PHASE_CLOCK_PROFILE] = "clock_prof",
+    [BOOT_PHASE_TIMEBASE] = "timebase",
+    [BOOT_PHASE_PERIPH] = "periph",
+    [BOOT_PHASE_ACQ] = "acq_start",
+    [BOOT_PHASE_FIRST_SAMPLE] = "1st_sample",
+    [BOOT_PHASE_COMMS] = "comms",
+    [BOOT_PHASE_STORAGE] = "storage",
+    [BOOT_PHASE_DSP] = "dsp",
+    [BOOT_PHASE_FIRST_BLOCK] = "1st_block"};
+
+/* Public functions ----------------------------------------------------------*/
+
+void bootProfile_start(void) {
+#if BOOT_PROFILE_ENABLE
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->LAR = BOOT_DWT_LAR_UNLOCK_KEY;
+  DWT->CYCCNT = 0;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+  memset(phases, 0, sizeof(phases));
+  last_cycles = 0;
+  last_hz = SystemCoreClock;
+  elapsed_us = 0;
+  marks = 0;
+  report_next = BOOT_PHASE_COUNT;
+#endif
+}
+
+void bootProfile_mark(BootProfile_Phase_t phase) {
+#if BOOT_PROFILE_ENABLE
+  if ((uint32_t)phase >= BOOT_PHASE_COUNT) {
+    return;
+  }
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  if (!phases[phase].marked && last_hz != 0U) {
+    const uint32_t now = DWT->CYCCNT;
+    const uint32_t us =
+        (uint32_t)((uint64_t)(now - last_cycles) * 1000000U / last_hz);
+    elapsed_us += us;
+    phases[phase].duration_us = us;
+    phases[phase].end_us = elapsed_us;
+    phases[phase].order = marks++;
+    phases[phase].marked = 1;
+    last_cycles = now;
+    last_hz = SystemCoreClock;
+    if (phase == BOOT_PHASE_FIRST_BLOCK) {
+      report_next = 0;
+    }
+  }
+  __set_PRIMASK(primask);
+#else
+  (void)phase;
+#endif
+}
+
+HAL_StatusTypeDef bootProfile_get(BootProfile_Phase_t phase,
+                                  BootProfile_Entry_t *entry) {
+  if ((uint32_t)phase >= BOOT_PHASE_COUNT || entry == NULL) {
+    return HAL_ERROR;
+  }
+  if (!phases[phase].marked) {
+    return HAL_BUSY;
+  }
+  *entry = phases[phase];
+  return HAL_OK;
+}
+
+uint32_t bootProfile_getFirstSampleUs(void) {
+  return phases[BOOT_PHASE_FIRST_SAMPLE].marked
+             ? phases[BOOT_PHASE_FIRST_SAMPLE].end_us
+             : 0U;
+}
+
+void bootProfile_dump(void) {
+#if BOOT_PROFILE_ENABLE
+  report_next = 0;
+#endif
+}
+
+void bootProfile_poll(void) {
+  char line[64];
+
+  while (report_next < marks && telemetry_getFreeSlots() > 0U) {
+    uint8_t phase = 0;
+    while (phase < BOOT_PHASE_COUNT &&
+           !(phases[phase].marked && phases[phase].order == report_next)) {
+      phase++;
+    }
+    if (phase < BOOT_PHASE_COUNT) {
+      int len = snprintf(line, sizeof(line), "BOOT %-10s %7lu us t=%lu us\r\n",
+                         phase_names[phase],
+                         (unsigned long)phases[phase].duration_us,
+                         (unsigned long)phases[phase].end_us);
+      if (len > 0) {
+        telemetry_send((const uint8_t *)line, (uint16_t)strlen(line));
+      }
+    }
+    report_next++;
+  }
+  if (report_next >= marks) {
+    report_next = BOOT_PHASE_COUNT;
+  }
+}
@@ -0,0 +1,183 @@
+/**
+ ******************************************************************************
+ * @file    burst_capture.c
+ * @brief   Implementation of the transient recorder in free RAM
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "burst_capture.h"
+#include "adc_sections.h"
+#include "telemetry_frame.h"
+#include <stddef.h>
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define BURST_LINE_MASK (ADC_DCACHE_LINE_SIZE - 1U)
+/* Full burst packet on the wire: 22 + samples + CRC, COBS and delimiters */
+#define BURST_PACKET_BYTES                                                     \
+  (22U + (TELEMETRY_FRAME_BURST_SAMPLES * 3U) / 2U + 2U + 3U)
+
+/* Private variables ---------------------------------------------------------*/
+
+/* Linker script symbols */
+extern uint8_t _edtcm_bss;
+extern uint8_t _sstack; // bottom of the main stack reservation
+extern uint8_t _eheap;  // end of the heap reservation
+extern uint8_t _esram1; // end of SRAM1
+
+static volatile BurstCapture_State_t state = BURST_CAPTURE_IDLE;
+static BurstCapture_Plan_t held; // region of the burst held
+static uint8_t held_channel = 0;
+static uint32_t start_tick = 0;
+static volatile uint32_t recorded = 0; // samples, set at the end
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+ * @brief Capture completion (DMA ISR)
+ */
+static void burstCapture_complete(const uint16_t *samples, uint32_t count,
+                                  void *ctx) {
+  UNUSED(samples);
+  UNUSED(ctx);
+  recorded = count;
+  __DMB();
+  state = BURST_CAPTURE_FULL;
+}
+
+/**
+ * @brief Region [start, end) rounded inwards to whole cache lines, capped
+ *        at what one DMA transfer fills
+ */
+static uint32_t burstCapture_fit(uint32_t start, uint32_t end,
+                                 uint32_t *base) {
+  *base = (start + BURST_LINE_MASK) & ~BURST_LINE_MASK;
+  end &= ~BURST_LINE_MASK;
+  if (end <= *base) {
+    return 0;
+  }
+  const uint32_t max = ADC_CONVERSIONS_BURST_MAX_SAMPLES * sizeof(uint16_t);
+  return (end - *base > max) ? max : end - *base;
+}
+
+/* Public functions ----------------------------------------------------------*/
+
+HAL_StatusTypeDef burstCapture_plan(uint32_t link_baud,
+                                    BurstCapture_Plan_t *plan) {
+  if (plan == NULL) {
+    return HAL_ERROR;
+  }
+  if (state != BURST_CAPTURE_IDLE) {
+    *plan = held;
+    return HAL_BUSY;
+  }
+  memset(plan, 0, sizeof(*plan));
+
+  uint32_t dtcm_base = 0;
+  uint32_t sram_base = 0;
+  plan->dtcm_free = burstCapture_fit((uint32_t)&_edtcm_bss,
+                                     (uint32_t)&_sstack, &dtcm_base);
+  plan->sram_free =
+      burstCapture_fit((uint32_t)&_eheap, (uint32_t)&_esram1, &sram_base);
+
+  if (plan->sram_free >= plan->dtcm_free) {
+    plan->region = BURST_CAPTURE_REGION_SRAM;
+    plan->base = sram_base;
+    plan->bytes = plan->sram_free;
+    const uint32_t end = sram_base + plan->bytes;
+    plan->sram2_bytes = (end > SRAM2_BASE)
+                            ? end - ((sram_base > SRAM2_BASE) ? sram_base
+                                                               : SRAM2_BASE)
+                            : 0U;
+    plan->sram1_bytes = plan->bytes - plan->sram2_bytes;
+  } else {
+    plan->region = BURST_CAPTURE_REGION_DTCM;
+    plan->base = dtcm_base;
+    plan->bytes = plan->dtcm_free;
+  }
+  if (plan->bytes < BURST_CAPTURE_MIN_BYTES) {
+    plan->region = BURST_CAPTURE_REGION_NONE;
+    return HAL_ERROR;
+  }
+
+  plan->samples = plan->bytes / sizeof(uint16_t);
+  plan->sample_rate_hz = analogSensor_getCaptureRate();
+  if (plan->sample_rate_hz != 0U) {
+    plan->duration_us = (uint32_t)((uint64_t)plan->samples * 1000000U /
+                                   plan->sample_rate_hz);
+  }
+  plan->dma_bytes_per_s = plan->sample_rate_hz * (uint32_t)sizeof(uint16_t);
+  if (link_baud != 0U) {
+    // 10 bits per byte on the wire
+    const uint64_t packets =
+        (plan->samples + TELEMETRY_FRAME_BURST_SAMPLES - 1U) /
+        TELEMETRY_FRAME_BURST_SAMPLES;
+    plan->drain_ms =
+        (uint32_t)(packets * BURST_PACKET_BYTES * 10U * 1000U / link_baud);
+  }
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef burstCapture_start(uint8_t channel,
+                                     const BurstCapture_Plan_t *plan) {
+  BurstCapture_Plan_t now;
+
+  if (plan == NULL) {
+    return HAL_ERROR;
+  }
+  if (state != BURST_CAPTURE_IDLE ||
+      analogSensor_getMode() != ADC_ACQ_MODE_POLLING) {
+    return HAL_BUSY;
+  }
+  if (burstCapture_plan(0U, &now) != HAL_OK || now.region != plan->region ||
+      now.base != plan->base || now.bytes != plan->bytes) {
+    return HAL_ERROR;
+  }
+
+  held = *plan;
+  held_channel = channel;
+  start_tick = HAL_GetTick();
+  recorded = 0;
+  state = BURST_CAPTURE_RUNNING;
+  const HAL_StatusTypeDef status = analogSensor_startBurst(
+      channel, (uint16_t *)plan->base, plan->samples, burstCapture_complete,
+      NULL);
+  if (status != HAL_OK) {
+    (void)burstCapture_release(); // the ADCs are back in polling mode
+  }
+  return status;
+}
+
+BurstCapture_State_t burstCapture_getState(void) { return state; }
+
+HAL_StatusTypeDef burstCapture_getSamples(const uint16_t **samples,
+                                          uint32_t *count) {
+  if (samples == NULL || count == NULL || state == BURST_CAPTURE_IDLE) {
+    return HAL_ERROR;
+  }
+  if (state != BURST_CAPTURE_FULL) {
+    return HAL_BUSY;
+  }
+  *samples = (const uint16_t *)held.base;
+  *count = recorded;
+  return HAL_OK;
+}
+
+uint8_t burstCapture_getChannel(void) { return held_channel; }
+
+uint32_t burstCapture_getStartTick(void) { return start_tick; }
+
+HAL_StatusTypeDef burstCapture_release(void) {
+  if (state == BURST_CAPTURE_RUNNING &&
+      analogSensor_getMode() == ADC_ACQ_MODE_CAPTURE) {
+    return HAL_BUSY;
+  }
+  if (state == BURST_CAPTURE_IDLE) {
+    return HAL_OK;
+  }
+  memset(&held, 0, sizeof(held));
+  state = BURST_CAPTURE_IDLE;
+  return HAL_OK;
+}
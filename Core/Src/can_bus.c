@@ -0,0 +1,515 @@
+/**
+ ******************************************************************************
+ * @file    can_bus.c
+ * @brief   Implementation of the bxCAN feature broadcast
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "can_bus.h"
+#include "adc_conversions.h"
+#include "timebase.h"
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define CAN_BUS_MAILBOXES 3U
+#define CAN_BUS_QUANTA 18U // 1 sync + 15 BS1 + 2 BS2
+#define CAN_BUS_PRESCALER_MAX 1024U
+#define CAN_BUS_RX_LEN 4U // commands waiting for canBus_poll()
+#define CAN_BUS_TYPE_OF(id) ((uint8_t)((id) >> 5))
+
+/* Standard identifier in the 16-bit filter layout (STID in bits 15:5) */
+#define CAN_BUS_FILTER_STD(id) ((uint32_t)(id) << 5)
+
+/* Private types -------------------------------------------------------------*/
+typedef struct {
+  uint16_t id;
+  uint8_t len;
+  uint8_t data[8];
+  uint64_t event;
+} CanBus_Frame_t;
+
+typedef struct {
+  uint8_t len;
+  uint8_t data[8];
+} CanBus_Command_t;
+
+/* Private variables ---------------------------------------------------------*/
+static CAN_HandleTypeDef hcan_bus;
+static uint8_t ready = 0;
+
+/* Sorted by identifier, FIFO among equal ones */
+static CanBus_Frame_t queue[CAN_BUS_QUEUE_LEN];
+static uint8_t queue_len = 0;
+
+/* Frame in each TX mailbox; bit n of the masks = mailbox n */
+static CanBus_Frame_t in_mailbox[CAN_BUS_MAILBOXES];
+static uint8_t mailbox_busy = 0;
+static uint8_t mailbox_aborting = 0;
+
+static CanBus_Command_t rx_ring[CAN_BUS_RX_LEN];
+static volatile uint8_t rx_head = 0; // written by the RX0 interrupt
+static uint8_t rx_tail = 0;
+
+static CanBus_CommandCallback_t command_callback = NULL;
+static void *command_ctx = NULL;
+static uint8_t send_mask = CAN_BUS_SEND_ALL;
+static uint32_t last_heartbeat_ms = 0;
+static CanBus_Stats_t stats_ = {0};
+
+/* Private functions ---------------------------------------------------------*/
+
+static void canBus_initPins(void) {
+  GPIO_InitTypeDef gpio = {.Pin = GPIO_PIN_0 | GPIO_PIN_1,
+                           .Mode = GPIO_MODE_AF_PP,
+                           .Pull = GPIO_NOPULL,
+                           .Speed = GPIO_SPEED_FREQ_VERY_HIGH,
+                           .Alternate = GPIO_AF9_CAN1};
+  __HAL_RCC_GPIOD_CLK_ENABLE();
+  HAL_GPIO_Init(GPIOD, &gpio);
+}
+
+static HAL_StatusTypeDef canBus_initCan(void) {
+  const uint32_t pclk1 = HAL_RCC_GetPCLK1Freq();
+  const uint32_t per_bit = CAN_BUS_BITRATE * CAN_BUS_QUANTA;
+  if (pclk1 % per_bit != 0U || pclk1 / per_bit == 0U ||
+      pclk1 / per_bit > CAN_BUS_PRESCALER_MAX) {
+    return HAL_ERROR;
+  }
+
+  __HAL_RCC_CAN1_CLK_ENABLE();
+  hcan_bus.Instance = CAN1;
+  hcan_bus.Init.Prescaler = pclk1 / per_bit;
+  hcan_bus.Init.Mode = CAN_MODE_NORMAL;
+  hcan_bus.Init.SyncJumpWidth = CAN_SJW_1TQ;
+  hcan_bus.Init.TimeSeg1 = CAN_BS1_15TQ;
+  hcan_bus.Init.TimeSeg2 = CAN_BS2_2TQ;
+  hcan_bus.Init.TimeTriggeredMode = DISABLE;
+  hcan_bus.Init.AutoBusOff = ENABLE; // back after 128 x 11 recessive bits
+  hcan_bus.Init.AutoWakeUp = DISABLE;
+  hcan_bus.Init.AutoRetransmission = ENABLE;
+  hcan_bus.Init.ReceiveFifoLocked = DISABLE;
+  // Mailboxes leave by identifier, as the queue is ordered
+  hcan_bus.Init.TransmitFifoPriority = DISABLE;
+  return HAL_CAN_Init(&hcan_bus);
+}
+
+/**
+ * @brief Bank 0, 16-bit list: this node's commands and the broadcast ones
+ */
+static HAL_StatusTypeDef canBus_initFilter(void) {
+  const uint32_t own =
+      CAN_BUS_FILTER_STD(CAN_BUS_ID(CAN_BUS_TYPE_COMMAND, CAN_BUS_NODE_ID));
+  const uint32_t all = CAN_BUS_FILTER_STD(CAN_BUS_ID(CAN_BUS_TYPE_COMMAND, 0U));
+  const CAN_FilterTypeDef filter = {.FilterIdHigh = own,
+                                    .FilterIdLow = all,
+                                    .FilterMaskIdHigh = own,
+                                    .FilterMaskIdLow = all,
+                                    .FilterFIFOAssignment = CAN_FILTER_FIFO0,
+                                    .FilterBank = 0U,
+                                    .FilterMode = CAN_FILTERMODE_IDLIST,
+                                    .FilterScale = CAN_FILTERSCALE_16BIT,
+                                    .FilterActivation = CAN_FILTER_ENABLE,
+                                    .SlaveStartFilterBank = 14U};
+  return HAL_CAN_ConfigFilter(&hcan_bus, &filter);
+}
+
+static uint8_t canBus_mailboxIndex(uint32_t mailbox) {
+  return (mailbox == CAN_TX_MAILBOX0) ? 0U
+         : (mailbox == CAN_TX_MAILBOX1) ? 1U
+                                        : 2U;
+}
+
+/**
+ * @brief Insert a frame in identifier order (interrupts masked)
+ *
+ * @param frame        Frame
+ * @param before_equal 1 for a preempted frame, older than the queued ones
+ *                     of its identifier
+ *
+ * @return 0 if the queue only holds frames of higher priority (dropped)
+ */
+static uint8_t canBus_insert(const CanBus_Frame_t *frame,
+                             uint8_t before_equal) {
+  if (queue_len == CAN_BUS_QUEUE_LEN) {
+    if (queue[queue_len - 1U].id <= frame->id) {
+      stats_.dropped++;
+      return 0;
+    }
+    queue_len--; // the lowest-priority frame makes room
+    stats_.dropped++;
+  }
+  uint8_t pos = queue_len;
+  while (pos > 0U && (queue[pos - 1U].id > frame->id ||
+                      (before_equal && queue[pos - 1U].id == frame->id))) {
+    pos--;
+  }
+  memmove(&queue[pos + 1U], &queue[pos],
+          (size_t)(queue_len - pos) * sizeof(queue[0]));
+  queue[pos] = *frame;
+  queue_len++;
+  return 1;
+}
+
+/**
+ * @brief All mailboxes taken: abort the lowest pending one if the queue
+ *        head outranks it
+ */
+static void canBus_preempt(void) {
+  uint8_t lowest = CAN_BUS_MAILBOXES;
+  for (uint8_t n = 0; n < CAN_BUS_MAILBOXES; n++) {
+    const uint8_t bit = (uint8_t)(1U << n);
+    if ((mailbox_busy & bit) != 0U && (mailbox_aborting & bit) == 0U &&
+        (lowest == CAN_BUS_MAILBOXES ||
+         in_mailbox[n].id > in_mailbox[lowest].id)) {
+      lowest = n;
+    }
+  }
+  if (lowest == CAN_BUS_MAILBOXES || queue[0].id >= in_mailbox[lowest].id) {
+    return;
+  }
+  // A frame already on the wire finishes; the abort then has no effect
+  mailbox_aborting |= (uint8_t)(1U << lowest);
+  (void)HAL_CAN_AbortTxRequest(&hcan_bus, CAN_TX_MAILBOX0 << lowest);
+}
+
+/**
+ * @brief Move queued frames into free mailboxes (interrupts masked)
+ */
+static void canBus_fill(void) {
+  while (queue_len > 0U) {
+    if (HAL_CAN_GetTxMailboxesFreeLevel(&hcan_bus) == 0U) {
+      canBus_preempt();
+      return;
+    }
+    const CanBus_Frame_t *head = &queue[0];
+    const CAN_TxHeaderTypeDef header = {.StdId = head->id,
+                                        .IDE = CAN_ID_STD,
+                                        .RTR = CAN_RTR_DATA,
+                                        .DLC = head->len,
+                                        .TransmitGlobalTime = DISABLE};
+    uint32_t mailbox = 0;
+    if (HAL_CAN_AddTxMessage(&hcan_bus, &header, head->data, &mailbox) !=
+        HAL_OK) {
+      return;
+    }
+    const uint8_t n = canBus_mailboxIndex(mailbox);
+    in_mailbox[n] = *head;
+    mailbox_busy |= (uint8_t)(1U << n);
+    queue_len--;
+    memmove(&queue[0], &queue[1], (size_t)queue_len * sizeof(queue[0]));
+  }
+}
+
+static void canBus_noteLatency(const CanBus_Frame_t *frame) {
+  const uint8_t type = CAN_BUS_TYPE_OF(frame->id);
+  CanBus_Class_t cls;
+  if (type == CAN_BUS_TYPE_ALARM) {
+    cls = CAN_BUS_CLASS_ALARM;
+  } else if (type == CAN_BUS_TYPE_PEAK || type == CAN_BUS_TYPE_RMS) {
+    cls = CAN_BUS_CLASS_FEATURE;
+  } else {
+    cls = CAN_BUS_CLASS_STATUS;
+  }
+  const uint64_t ticks = timebase_now() - frame->event;
+  const uint64_t us64 = ticks * 1000000ULL / TIMEBASE_TICK_HZ;
+  const uint32_t us = (us64 > UINT32_MAX) ? UINT32_MAX : (uint32_t)us64;
+
+  CanBus_Latency_t *lat = &stats_.latency[cls];
+  if (lat->sent == 0U || us < lat->min_us) {
+    lat->min_us = us;
+  }
+  if (us > lat->max_us) {
+    lat->max_us = us;
+  }
+  lat->sum_us += us;
+  lat->sent++;
+}
+
+/**
+ * @brief Mailbox n is free again (TX interrupt)
+ *
+ * @param ok 1 = transmitted, 0 = aborted or failed
+ */
+static void canBus_mailboxDone(uint8_t n, uint8_t ok) {
+  const uint8_t bit = (uint8_t)(1U << n);
+  if ((mailbox_busy & bit) == 0U) {
+    return;
+  }
+  if (ok) {
+    canBus_noteLatency(&in_mailbox[n]);
+  } else if ((mailbox_aborting & bit) != 0U) {
+    stats_.preempted++;
+    (void)canBus_insert(&in_mailbox[n], 1U);
+  } else {
+    stats_.tx_errors++;
+  }
+  mailbox_busy &= (uint8_t)~bit;
+  mailbox_aborting &= (uint8_t)~bit;
+  canBus_fill();
+}
+
+static void canBus_put16(uint8_t *dst, uint16_t value) {
+  dst[0] = (uint8_t)value;
+  dst[1] = (uint8_t)(value >> 8);
+}
+
+static void canBus_put32(uint8_t *dst, uint32_t value) {
+  canBus_put16(dst, (uint16_t)value);
+  canBus_put16(dst + 2, (uint16_t)(value >> 16));
+}
+
+static void canBus_putFloat(uint8_t *dst, float value) {
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  canBus_put32(dst, bits);
+}
+
+static HAL_StatusTypeDef canBus_sendStatus(void) {
+  ADC_LatestFrame_t latest;
+  const uint32_t sequence =
+      (analogSensor_getLatestFrame(&latest) == HAL_OK) ? latest.sequence : 0U;
+  const uint32_t esr = CAN1->ESR;
+  uint8_t data[8];
+  data[0] = (uint8_t)analogSensor_getMode();
+  data[1] = (uint8_t)((esr & CAN_ESR_TEC) >> CAN_ESR_TEC_Pos);
+  data[2] = (uint8_t)((esr & CAN_ESR_REC) >> CAN_ESR_REC_Pos);
+  data[3] = (stats_.dropped > 0xFFU) ? 0xFFU : (uint8_t)stats_.dropped;
+  canBus_put32(&data[4], sequence);
+  return canBus_send(CAN_BUS_TYPE_STATUS, data, 8U, timebase_now());
+}
+
+static void canBus_runCommand(const CanBus_Command_t *cmd) {
+  if (cmd->len == 0U) {
+    return;
+  }
+  if (cmd->data[0] == CAN_BUS_CMD_PING) {
+    (void)canBus_sendStatus();
+  } else if (cmd->data[0] == CAN_BUS_CMD_MASK && cmd->len >= 2U) {
+    send_mask = cmd->data[1] & CAN_BUS_SEND_ALL;
+  } else if (command_callback != NULL) {
+    command_callback(cmd->data, cmd->len, command_ctx);
+  }
+}
+
+/* HAL callbacks -------------------------------------------------------------*/
+
+void HAL_CAN_TxMailbox0CompleteCallback(CAN_HandleTypeDef *hcan) {
+  (void)hcan;
+  canBus_mailboxDone(0U, 1U);
+}
+
+void HAL_CAN_TxMailbox1CompleteCallback(CAN_HandleTypeDef *hcan) {
+  (void)hcan;
+  canBus_mailboxDone(1U, 1U);
+}
+
+void HAL_CAN_TxMailbox2CompleteCallback(CAN_HandleTypeDef *hcan) {
+  (void)hcan;
+  canBus_mailboxDone(2U, 1U);
+}
+
+void HAL_CAN_TxMailbox0AbortCallback(CAN_HandleTypeDef *hcan) {
+  (void)hcan;
+  canBus_mailboxDone(0U, 0U);
+}
+
+void HAL_CAN_TxMailbox1AbortCallback(CAN_HandleTypeDef *hcan) {
+  (void)hcan;
+  canBus_mailboxDone(1U, 0U);
+}
+
+void HAL_CAN_TxMailbox2AbortCallback(CAN_HandleTypeDef *hcan) {
+  (void)hcan;
+  canBus_mailboxDone(2U, 0U);
+}
+
+void HAL_CAN_RxFifo0MsgPendingCallback(CAN_HandleTypeDef *hcan) {
+  while (HAL_CAN_GetRxFifoFillLevel(hcan, CAN_RX_FIFO0) > 0U) {
+    CAN_RxHeaderTypeDef header;
+    uint8_t data[8];
+    if (HAL_CAN_GetRxMessage(hcan, CAN_RX_FIFO0, &header, data) != HAL_OK) {
+      return;
+    }
+    const uint8_t next = (uint8_t)((rx_head + 1U) % CAN_BUS_RX_LEN);
+    if (header.RTR != CAN_RTR_DATA) {
+      continue;
+    }
+    if (next == rx_tail) {
+      stats_.rx_overruns++;
+      continue;
+    }
+    rx_ring[rx_head].len = (uint8_t)((header.DLC > 8U) ? 8U : header.DLC);
+    memcpy(rx_ring[rx_head].data, data, sizeof(data));
+    rx_head = next;
+    stats_.commands++;
+  }
+}
+
+void HAL_CAN_ErrorCallback(CAN_HandleTypeDef *hcan) {
+  const uint32_t error = HAL_CAN_GetError(hcan);
+  // A mailbox that ended in arbitration loss or an error (after an abort,
+  // as retransmission is on) reports here instead of the abort callback
+  static const uint32_t tx_failed[CAN_BUS_MAILBOXES] = {
+      HAL_CAN_ERROR_TX_ALST0 | HAL_CAN_ERROR_TX_TERR0,
+      HAL_CAN_ERROR_TX_ALST1 | HAL_CAN_ERROR_TX_TERR1,
+      HAL_CAN_ERROR_TX_ALST2 | HAL_CAN_ERROR_TX_TERR2};
+  for (uint8_t n = 0; n < CAN_BUS_MAILBOXES; n++) {
+    if ((error & tx_failed[n]) != 0U) {
+      canBus_mailboxDone(n, 0U);
+    }
+  }
+  if ((error & HAL_CAN_ERROR_RX_FOV0) != 0U) {
+    stats_.rx_overruns++;
+  }
+  if ((error & HAL_CAN_ERROR_BOF) != 0U) {
+    stats_.bus_off++;
+  }
+  (void)HAL_CAN_ResetError(hcan);
+}
+
+/* Public functions ----------------------------------------------------------*/
+
+HAL_StatusTypeDef canBus_init(void) {
+#if !CAN_BUS_ENABLE
+  return HAL_OK; // no transceiver: CAN1 and PD0/PD1 stay free
+#endif
+  canBus_initPins();
+  if (canBus_initCan() != HAL_OK || canBus_initFilter() != HAL_OK) {
+    return HAL_ERROR;
+  }
+  if (HAL_CAN_ActivateNotification(
+          &hcan_bus, CAN_IT_TX_MAILBOX_EMPTY | CAN_IT_RX_FIFO0_MSG_PENDING |
+                         CAN_IT_RX_FIFO0_OVERRUN | CAN_IT_BUSOFF |
+                         CAN_IT_ERROR) != HAL_OK) {
+    return HAL_ERROR;
+  }
+  HAL_NVIC_SetPriority(CAN1_TX_IRQn, CAN_BUS_IRQ_PRIORITY, 0);
+  HAL_NVIC_EnableIRQ(CAN1_TX_IRQn);
+  HAL_NVIC_SetPriority(CAN1_RX0_IRQn, CAN_BUS_IRQ_PRIORITY, 0);
+  HAL_NVIC_EnableIRQ(CAN1_RX0_IRQn);
+  HAL_NVIC_SetPriority(CAN1_SCE_IRQn, CAN_BUS_IRQ_PRIORITY, 0);
+  HAL_NVIC_EnableIRQ(CAN1_SCE_IRQn);
+
+  stats_ = (CanBus_Stats_t){0};
+  last_heartbeat_ms = HAL_GetTick();
+  if (HAL_CAN_Start(&hcan_bus) != HAL_OK) {
+    return HAL_ERROR;
+  }
+  ready = 1;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef canBus_send(uint8_t type, const uint8_t *data, uint8_t len,
+                              uint64_t event) {
+  if (!ready || len > 8U || (len != 0U && data == NULL)) {
+    return HAL_ERROR;
+  }
+  CanBus_Frame_t frame = {
+      .id = (uint16_t)CAN_BUS_ID(type, CAN_BUS_NODE_ID),
+      .len = len,
+      .event = event};
+  if (len != 0U) {
+    memcpy(frame.data, data, len);
+  }
+
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  const uint8_t queued = canBus_insert(&frame, 0U);
+  if (queued) {
+    stats_.queued++;
+  }
+  canBus_fill();
+  __set_PRIMASK(primask);
+  return queued ? HAL_OK : HAL_BUSY;
+}
+
+HAL_StatusTypeDef canBus_sendFeatures(const CanBus_Features_t *features) {
+  if (!ready || features == NULL) {
+    return HAL_ERROR;
+  }
+  HAL_StatusTypeDef status = HAL_OK;
+  uint8_t data[8] = {features->channel, (uint8_t)features->sequence};
+  if ((send_mask & CAN_BUS_SEND_PEAK) != 0U) {
+    const float hz = features->peak_hz + 0.5f;
+    canBus_put16(&data[2], (hz <= 0.0f)       ? 0U
+                           : (hz >= 65535.0f) ? 65535U
+                                              : (uint16_t)hz);
+    canBus_putFloat(&data[4], features->peak_amplitude);
+    if (canBus_send(CAN_BUS_TYPE_PEAK, data, 8U, features->event) != HAL_OK) {
+      status = HAL_BUSY;
+    }
+  }
+  if ((send_mask & CAN_BUS_SEND_RMS) != 0U) {
+    data[2] = features->band_count;
+    data[3] = 0U;
+    canBus_putFloat(&data[4], features->rms);
+    if (canBus_send(CAN_BUS_TYPE_RMS, data, 8U, features->event) != HAL_OK) {
+      status = HAL_BUSY;
+    }
+  }
+  return status;
+}
+
+HAL_StatusTypeDef canBus_sendAlarm(const CanBus_Alarm_t *alarm) {
+  if (!ready || alarm == NULL) {
+    return HAL_ERROR;
+  }
+  if ((send_mask & CAN_BUS_SEND_ALARM) == 0U) {
+    return HAL_OK;
+  }
+  uint8_t data[8] = {alarm->channel, alarm->event, alarm->alarm,
+                     alarm->worst_band};
+  canBus_putFloat(&data[4], alarm->score);
+  return canBus_send(CAN_BUS_TYPE_ALARM, data, 8U, alarm->event_ts);
+}
+
+void canBus_poll(void) {
+  if (!ready) {
+    return;
+  }
+  while (rx_tail != rx_head) {
+    const CanBus_Command_t cmd = rx_ring[rx_tail];
+    rx_tail = (uint8_t)((rx_tail + 1U) % CAN_BUS_RX_LEN);
+    canBus_runCommand(&cmd);
+  }
+#if CAN_BUS_HEARTBEAT_MS > 0
+  if (HAL_GetTick() - last_heartbeat_ms >= CAN_BUS_HEARTBEAT_MS) {
+    last_heartbeat_ms = HAL_GetTick();
+    if ((send_mask & CAN_BUS_SEND_STATUS) != 0U) {
+      (void)canBus_sendStatus();
+    }
+  }
+#endif
+}
+
+void canBus_registerCommandCallback(CanBus_CommandCallback_t callback,
+                                    void *ctx) {
+  command_callback = callback; // main loop only, as canBus_poll()
+  command_ctx = ctx;
+}
+
+HAL_StatusTypeDef canBus_getStats(CanBus_Stats_t *stats) {
+  if (stats == NULL) {
+    return HAL_ERROR;
+  }
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  *stats = stats_;
+  __set_PRIMASK(primask);
+  const uint32_t esr = ready ? CAN1->ESR : 0U;
+  stats->tec = (uint8_t)((esr & CAN_ESR_TEC) >> CAN_ESR_TEC_Pos);
+  stats->rec = (uint8_t)((esr & CAN_ESR_REC) >> CAN_ESR_REC_Pos);
+  stats->mask = send_mask;
+  return HAL_OK;
+}
+
+void canBus_resetLatency(void) {
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  memset(stats_.latency, 0, sizeof(stats_.latency));
+  __set_PRIMASK(primask);
+}
+
+void canBus_irqHandler(void) { HAL_CAN_IRQHandler(&hcan_bus); }
@@ -0,0 +1,176 @@
+/**
+ ******************************************************************************
+ * @file    cbor_writer.c
+ * @brief   Implementation of the streaming CBOR encoder
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "cbor_writer.h"
+#include <math.h>
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define CBOR_MAJOR_UINT 0U
+#define CBOR_MAJOR_NINT 1U
+#define CBOR_MAJOR_ARRAY 4U
+#define CBOR_MAJOR_MAP 5U
+#define CBOR_MAJOR_SIMPLE 7U
+#define CBOR_INFO_1BYTE 24U
+#define CBOR_INFO_2BYTE 25U
+#define CBOR_INFO_4BYTE 26U
+#define CBOR_HALF_NAN 0x7E00U
+#define CBOR_HALF_INF 0x7C00U
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+ * @brief Room for n more bytes; flags the overflow if not
+ */
+static uint8_t cborWriter_room(CborWriter_t *w, uint32_t n) {
+  if (w->overflow || (uint32_t)(w->end - w->p) < n) {
+    w->overflow = 1;
+    return 0;
+  }
+  return 1;
+}
+
+/**
+ * @brief Initial byte and big-endian argument in the shortest form
+ */
+static void cborWriter_head(CborWriter_t *w, uint8_t major, uint32_t arg) {
+  const uint8_t mt = (uint8_t)(major << 5);
+  if (arg < CBOR_INFO_1BYTE) {
+    if (cborWriter_room(w, 1U)) {
+      *w->p++ = (uint8_t)(mt | arg);
+    }
+  } else if (arg <= 0xFFU) {
+    if (cborWriter_room(w, 2U)) {
+      *w->p++ = (uint8_t)(mt | CBOR_INFO_1BYTE);
+      *w->p++ = (uint8_t)arg;
+    }
+  } else if (arg <= 0xFFFFU) {
+    if (cborWriter_room(w, 3U)) {
+      *w->p++ = (uint8_t)(mt | CBOR_INFO_2BYTE);
+      *w->p++ = (uint8_t)(arg >> 8);
+      *w->p++ = (uint8_t)arg;
+    }
+  } else if (cborWriter_room(w, 5U)) {
+    *w->p++ = (uint8_t)(mt | CBOR_INFO_4BYTE);
+    *w->p++ = (uint8_t)(arg >> 24);
+    *w->p++ = (uint8_t)(arg >> 16);
+    *w->p++ = (uint8_t)(arg >> 8);
+    *w->p++ = (uint8_t)arg;
+  }
+}
+
+/**
+ * @brief Nearest normal half of a float; 0 if the float is out of the
+ *        half's normal range (subnormal halves are not used)
+ */
+static uint16_t cborWriter_toHalf(uint32_t bits) {
+  const uint16_t sign = (uint16_t)((bits >> 16) & 0x8000U);
+  const int32_t exp = (int32_t)((bits >> 23) & 0xFFU) - 127 + 15;
+  const uint32_t mant = bits & 0x7FFFFFU;
+  if (exp <= 0 || exp >= 31) {
+    return 0;
+  }
+  uint16_t half = (uint16_t)(sign | ((uint32_t)exp << 10) | (mant >> 13));
+  const uint32_t rest = mant & 0x1FFFU;
+  if (rest > 0x1000U || (rest == 0x1000U && (half & 1U) != 0U)) {
+    half++; // a carry into the exponent is still the right value
+  }
+  return ((half & CBOR_HALF_INF) == CBOR_HALF_INF) ? 0U : half;
+}
+
+/**
+ * @brief Float value of a normal half
+ */
+static float cborWriter_fromHalf(uint16_t half) {
+  const uint32_t bits = ((uint32_t)(half & 0x8000U) << 16) |
+                        ((((uint32_t)(half >> 10) & 0x1FU) + 127U - 15U)
+                         << 23) |
+                        ((uint32_t)(half & 0x3FFU) << 13);
+  float value;
+  memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+/* Public functions ----------------------------------------------------------*/
+
+void cborWriter_init(CborWriter_t *w, uint8_t *buf, uint16_t cap) {
+  if (w == NULL) {
+    return;
+  }
+  w->start = buf;
+  w->p = buf;
+  w->end = (buf != NULL) ? buf + cap : NULL;
+  w->overflow = (buf == NULL) ? 1U : 0U;
+}
+
+void cborWriter_uint(CborWriter_t *w, uint32_t value) {
+  cborWriter_head(w, CBOR_MAJOR_UINT, value);
+}
+
+void cborWriter_int(CborWriter_t *w, int32_t value) {
+  if (value < 0) {
+    // -1 - n, computed without overflow at INT32_MIN
+    cborWriter_head(w, CBOR_MAJOR_NINT, (uint32_t)(-(value + 1)));
+  } else {
+    cborWriter_head(w, CBOR_MAJOR_UINT, (uint32_t)value);
+  }
+}
+
+void cborWriter_array(CborWriter_t *w, uint32_t items) {
+  cborWriter_head(w, CBOR_MAJOR_ARRAY, items);
+}
+
+void cborWriter_map(CborWriter_t *w, uint32_t pairs) {
+  cborWriter_head(w, CBOR_MAJOR_MAP, pairs);
+}
+
+void cborWriter_float(CborWriter_t *w, float value, float rel_tol) {
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+
+  uint16_t half = 0;
+  uint8_t use_half = 0;
+  if (isnan(value)) {
+    half = CBOR_HALF_NAN;
+    use_half = 1;
+  } else if (isinf(value) || value == 0.0f) {
+    half = (uint16_t)(((bits >> 16) & 0x8000U) |
+                      (isinf(value) ? CBOR_HALF_INF : 0U));
+    use_half = 1;
+  } else {
+    half = cborWriter_toHalf(bits);
+    if (half != 0U) {
+      const float err = fabsf(cborWriter_fromHalf(half) - value);
+      use_half = (err <= rel_tol * fabsf(value)) ? 1U : 0U;
+    }
+  }
+
+  const uint8_t mt = (uint8_t)(CBOR_MAJOR_SIMPLE << 5);
+  if (use_half) {
+    if (cborWriter_room(w, 3U)) {
+      *w->p++ = (uint8_t)(mt | CBOR_INFO_2BYTE);
+      *w->p++ = (uint8_t)(half >> 8);
+      *w->p++ = (uint8_t)half;
+    }
+  } else if (cborWriter_room(w, 5U)) {
+    *w->p++ = (uint8_t)(mt | CBOR_INFO_4BYTE);
+    *w->p++ = (uint8_t)(bits >> 24);
+    *w->p++ = (uint8_t)(bits >> 16);
+    *w->p++ = (uint8_t)(bits >> 8);
+    *w->p++ = (uint8_t)bits;
+  }
+}
+
+HAL_StatusTypeDef cborWriter_finish(const CborWriter_t *w, uint16_t *len) {
+  if (w == NULL || len == NULL || w->overflow) {
+    return HAL_ERROR;
+  }
+  *len = (uint16_t)(w->p - w->start);
+  return HAL_OK;
+}
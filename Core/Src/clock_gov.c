@@ -0,0 +1,341 @@
+/**
+ ******************************************************************************
+ * @file    clock_gov.c
+ * @brief   Implementation of the load-driven clock governor
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "clock_gov.h"
+#include "adc_conversions.h"
+#include "adc_ring.h"
+#include "cpu_load.h"
+#include "timebase.h"
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+
+_Static_assert(CLOCK_GOV_DOWN_CENTI < CLOCK_GOV_UP_CENTI,
+               "the hysteresis needs the down load below the up one");
+_Static_assert(CLOCK_GOV_DOWN_FILL_PCT < CLOCK_GOV_UP_FILL_PCT,
+               "the hysteresis needs the down fill below the up one");
+
+/* Private types -------------------------------------------------------------*/
+
+/**
+ * @brief What the bus hook re-derives from, taken before the switch
+ */
+typedef struct {
+  uint8_t tim2;         // TIM2 counting
+  uint32_t tim2_arr;    // its ARR (the preload) at the timer clock below
+  uint32_t tim2_hz;     // APB1 timer clock it was set for
+  uint8_t systick;      // SysTick counting
+  uint32_t systick_reload;
+  uint32_t hclk_hz;     // core clock the reload was set for
+} ClockGov_Saved_t;
+
+/* Private variables ---------------------------------------------------------*/
+static ClockGov_Config_t config;
+static ClockProfile_Info_t fast_info;
+static ClockProfile_Info_t slow_info;
+static ClockGov_Saved_t saved;
+static uint8_t running = 0;
+static ClockGov_Mode_t mode = CLOCK_GOV_AUTO;
+static ClockProfile_Id_t profile;
+static ClockProfile_Id_t target;
+static uint32_t boost_until = 0;     // HAL_GetTick()
+static uint8_t boosting = 0;
+static uint32_t seen_slices = 0;     // cpuLoad slices already judged
+static uint16_t last_load = 0;
+static uint8_t quiet = 0;            // down conditions holding ...
+static uint32_t quiet_since = 0;     // ... since this HAL_GetTick()
+static uint32_t last_ms = 0;         // time accounting
+static uint32_t seen_frame = 0;      // first frame of the block judged
+static uint8_t seen_valid = 0;
+static ClockGov_Stats_t stats_;
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+ * @brief x * to / from, in 64 bits
+ */
+static uint32_t clockGov_scale(uint32_t x, uint32_t to, uint32_t from) {
+  return (uint32_t)((uint64_t)x * to / from);
+}
+
+/**
+ * @brief APB1 timer clock of a profile (2x PCLK1 when APB1 is divided)
+ */
+static uint32_t clockGov_timerHz(const ClockProfile_Info_t *info) {
+  return (info->pclk1_hz < info->hclk_hz) ? 2U * info->pclk1_hz
+                                          : info->pclk1_hz;
+}
+
+/**
+ * @brief After each bus step of clockProfile_switch(), interrupts masked:
+ *        TIM2's period and phase, the timebase's prescaler and SysTick's
+ *        reload, at the new clocks
+ */
+static void clockGov_busHook(const ClockProfile_Bus_t *before,
+                             const ClockProfile_Bus_t *after, void *ctx) {
+  UNUSED(ctx);
+  if (saved.tim2 && after->apb1_timer_hz != before->apb1_timer_hz) {
+    // Periods from the saved ARR, so the last step puts it back exactly
+    uint32_t arr = clockGov_scale(saved.tim2_arr + 1U, after->apb1_timer_hz,
+                                  saved.tim2_hz);
+    arr = (arr > 1U) ? arr - 1U : 1U;
+    uint32_t cnt = clockGov_scale(TIM2->CNT, after->apb1_timer_hz,
+                                  before->apb1_timer_hz);
+    cnt = (cnt < arr) ? cnt : arr;
+    TIM2->CR1 &= ~TIM_CR1_ARPE; // ARR now, not at the next update
+    TIM2->ARR = arr;
+    TIM2->CNT = cnt;
+    TIM2->CR1 |= TIM_CR1_ARPE;
+  }
+  if (after->apb1_timer_hz != before->apb1_timer_hz) {
+    // Microseconds keep their length through the switch, not only after
+    // the HAL_InitTick() that ends it
+    (void)timebase_setClock(after->apb1_timer_hz);
+  }
+  if (saved.systick && after->hclk_hz != before->hclk_hz) {
+    SysTick->LOAD = clockGov_scale(saved.systick_reload + 1U, after->hclk_hz,
+                                   saved.hclk_hz) - 1U; // from the next wrap
+  }
+}
+
+static const ClockProfile_Info_t *clockGov_info(ClockProfile_Id_t id) {
+  return (id == config.fast) ? &fast_info : &slow_info;
+}
+
+/**
+ * @brief Profile the policy wants now
+ */
+static ClockProfile_Id_t clockGov_target(uint32_t now) {
+  if (mode == CLOCK_GOV_FAST) {
+    return config.fast;
+  }
+  if (mode == CLOCK_GOV_SLOW) {
+    return config.slow;
+  }
+
+  CpuLoad_Stats_t load;
+  (void)cpuLoad_getStats(&load);
+  if (load.slices != seen_slices) {
+    seen_slices = load.slices;
+    last_load = load.last_centi_pct;
+  }
+  const uint32_t fill = adcRing_count() * 100U / ADC_RING_CAPACITY;
+  stats_.load_centi_pct = last_load;
+  stats_.fill_pct = (uint8_t)fill;
+
+  if (boosting && (int32_t)(boost_until - now) <= 0) {
+    boosting = 0;
+  }
+  if (boosting) {
+    quiet = 0;
+    return config.fast;
+  }
+  if (profile == config.slow) {
+    const uint8_t up =
+        last_load > CLOCK_GOV_UP_CENTI || fill > CLOCK_GOV_UP_FILL_PCT;
+    return up ? config.fast : config.slow;
+  }
+
+  // On the fast clock: the same work on the slow one takes longer
+  const uint32_t projected =
+      clockGov_scale(last_load, fast_info.hclk_hz, slow_info.hclk_hz);
+  if (projected >= CLOCK_GOV_DOWN_CENTI || fill >= CLOCK_GOV_DOWN_FILL_PCT) {
+    quiet = 0;
+    return config.fast;
+  }
+  if (!quiet) {
+    quiet = 1;
+    quiet_since = now;
+  }
+  return (now - quiet_since >= CLOCK_GOV_HOLD_MS) ? config.slow : config.fast;
+}
+
+/**
+ * @brief Safe point for a switch; counts a refusal once per fresh block
+ */
+static uint8_t clockGov_safe(void) {
+  const ADC_AcqMode_t acq = analogSensor_getMode();
+  const uint8_t scanning = (TIM2->CR1 & TIM_CR1_CEN) != 0U;
+  if (acq != ADC_ACQ_MODE_POLLING &&
+      !(acq == ADC_ACQ_MODE_DMA_TIMER && scanning)) {
+    return 0; // a free-running or interleaved scan follows ADCCLK
+  }
+  if (acq == ADC_ACQ_MODE_POLLING) {
+    return (config.ready == NULL || config.ready(config.ctx)) ? 1U : 0U;
+  }
+
+  // Judge each block once, as it arrives
+  ADC_BlockInfo_t info;
+  const uint32_t rate = analogSensor_getSampleRate();
+  if (rate == 0U || analogSensor_getBlockInfo(&info) != HAL_OK ||
+      info.frame_count == 0U ||
+      (seen_valid && info.first_frame == seen_frame)) {
+    return 0;
+  }
+  const uint64_t period = (uint64_t)info.frame_count * TIMEBASE_TICK_HZ / rate;
+  if (timebase_now() - info.timestamp >= period / 4U) {
+    return 0; // missed this one: wait for the next
+  }
+  seen_frame = info.first_frame;
+  seen_valid = 1;
+
+  const uint32_t window = (stats_.max_window_us != 0U)
+                              ? stats_.max_window_us
+                              : CLOCK_GOV_WINDOW_US;
+  const uint32_t hsi_max = clockGov_scale(
+      analogSensor_getMaxFrameRate(fast_info.adc_prescaler), HSI_VALUE,
+      fast_info.pclk2_hz);
+  const uint8_t ok =
+      rate <= hsi_max &&
+      (uint64_t)window * TIMEBASE_TICK_HZ / 1000000U < period / 2U &&
+      (config.ready == NULL || config.ready(config.ctx));
+  if (!ok) {
+    stats_.refused++;
+  }
+  return ok;
+}
+
+/**
+ * @brief Switch now, timers re-derived on the way
+ */
+static void clockGov_switch(ClockProfile_Id_t id) {
+  const ClockProfile_Info_t *from = clockGov_info(profile);
+  saved.tim2 = (TIM2->CR1 & TIM_CR1_CEN) != 0U;
+  saved.tim2_arr = TIM2->ARR;
+  saved.tim2_hz = clockGov_timerHz(from);
+  saved.systick = (SysTick->CTRL & SysTick_CTRL_ENABLE_Msk) != 0U;
+  saved.systick_reload = SysTick->LOAD;
+  saved.hclk_hz = from->hclk_hz;
+
+  const uint64_t t0 = timebase_now();
+  const HAL_StatusTypeDef status =
+      clockProfile_switch(id, clockGov_busHook, NULL);
+  const uint64_t t1 = timebase_now();
+  if (status != HAL_OK) {
+    // Stranded on HSI: back to where it was, from scratch, and stop
+    const ClockProfile_Source_t source =
+        (__HAL_RCC_GET_PLL_OSCSOURCE() == RCC_PLLSOURCE_HSE)
+            ? CLOCK_SOURCE_HSE_BYPASS
+            : CLOCK_SOURCE_HSI;
+    (void)clockProfile_apply(profile, source);
+    if (saved.tim2) {
+      TIM2->ARR = saved.tim2_arr;
+    }
+    if (saved.systick) {
+      SysTick->LOAD = saved.systick_reload;
+    }
+    stats_.failed++;
+    running = 0;
+    return;
+  }
+
+  const uint32_t us = (uint32_t)((t1 - t0) * 1000000U / TIMEBASE_TICK_HZ);
+  stats_.last_window_us = us;
+  if (us > stats_.max_window_us) {
+    stats_.max_window_us = us;
+  }
+  stats_.switches++;
+  profile = id;
+  quiet = 0;
+  cpuLoad_restartSlice(); // the slice's cycles span two core clocks
+  CpuLoad_Stats_t load;
+  (void)cpuLoad_getStats(&load);
+  seen_slices = load.slices; // judge the first slice on the new clock
+}
+
+/* Public functions ----------------------------------------------------------*/
+
+HAL_StatusTypeDef clockGov_init(const ClockGov_Config_t *cfg) {
+#if !CLOCK_GOV_ENABLE
+  return HAL_ERROR;
+#endif
+  const ClockProfile_Info_t *active = clockProfile_getActive();
+  if (cfg == NULL || active == NULL || cfg->fast == cfg->slow ||
+      clockProfile_getInfo(cfg->fast, &fast_info) != HAL_OK ||
+      clockProfile_getInfo(cfg->slow, &slow_info) != HAL_OK) {
+    return HAL_ERROR;
+  }
+  if (fast_info.pclk1_hz != slow_info.pclk1_hz ||
+      fast_info.pclk2_hz != slow_info.pclk2_hz ||
+      fast_info.adc_prescaler != slow_info.adc_prescaler ||
+      clockGov_timerHz(&fast_info) != clockGov_timerHz(&slow_info) ||
+      (active->id != cfg->fast && active->id != cfg->slow)) {
+    return HAL_ERROR;
+  }
+
+  config = *cfg;
+  memset(&stats_, 0, sizeof(stats_));
+  mode = CLOCK_GOV_AUTO;
+  profile = active->id;
+  target = profile;
+  boosting = 0;
+  quiet = 0;
+  seen_valid = 0;
+  CpuLoad_Stats_t load;
+  (void)cpuLoad_getStats(&load);
+  seen_slices = load.slices;
+  last_load = load.last_centi_pct;
+  last_ms = HAL_GetTick();
+  running = 1;
+  return HAL_OK;
+}
+
+void clockGov_poll(void) {
+  if (!running) {
+    return;
+  }
+  const uint32_t now = HAL_GetTick();
+  if (profile == config.fast) {
+    stats_.fast_ms += now - last_ms;
+  } else {
+    stats_.slow_ms += now - last_ms;
+  }
+  last_ms = now;
+
+  target = clockGov_target(now);
+  if (target == profile || !clockGov_safe()) {
+    return;
+  }
+  clockGov_switch(target);
+}
+
+void clockGov_setMode(ClockGov_Mode_t m) {
+  mode = m;
+  quiet = 0;
+}
+
+void clockGov_boost(uint32_t ms) {
+  boost_until = HAL_GetTick() + ms;
+  boosting = (ms != 0U) ? 1U : 0U;
+}
+
+HAL_StatusTypeDef clockGov_getStats(ClockGov_Stats_t *stats) {
+  if (stats == NULL) {
+    return HAL_ERROR;
+  }
+  *stats = stats_;
+  stats->running = running;
+  stats->mode = mode;
+  stats->profile = profile;
+  stats->target = target;
+  const int32_t left = (int32_t)(boost_until - HAL_GetTick());
+  stats->boost_ms = (boosting && left > 0) ? (uint32_t)left : 0U;
+  return HAL_OK;
+}
+
+const char *clockGov_modeName(ClockGov_Mode_t m) {
+  switch (m) {
+  case CLOCK_GOV_FAST:
+    return "fast";
+  case CLOCK_GOV_SLOW:
+    return "slow";
+  default:
+    return "auto";
+  }
+}
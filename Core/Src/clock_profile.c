@@ -0,0 +1,438 @@
+/**
+ ******************************************************************************
+ * @file    clock_profile.c
+ * @brief   Implementation of the system / ADC clock profiles
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "clock_profile.h"
+
+/* Private defines -----------------------------------------------------------*/
+#define CLOCK_VCO_HZ 432000000U // PLL VCO output in every profile
+#define CLOCK_PLLQ 9U           // 432 / 9 = 48 MHz
+#define CLOCK_HSI_HZ 16000000U
+#define CLOCK_ADC_MIN_CYCLES 15U // 3-cycle sampling + 12-bit conversion
+#define CLOCK_RESUME_TIMEOUT_MS 5U // HSE + PLL lock after STOP mode
+#define CLOCK_SWITCH_SPINS 10000U  // SYSCLK source switch, a few cycles
+#define CLOCK_LOCK_SPINS 20000U    // PLL lock / over-drive, masked: >= 5 ms
+                                   // on HSI at 4+ cycles a spin
+#define CLOCK_DIVIDERS (RCC_CFGR_HPRE | RCC_CFGR_PPRE1 | RCC_CFGR_PPRE2)
+
+_Static_assert(HSE_VALUE % 1000000U == 0U,
+               "HSE_VALUE must be a whole number of MHz for the PLL");
+
+/* Private types -------------------------------------------------------------*/
+
+typedef struct {
+  uint32_t pllp;          // RCC_PLLP_DIVx
+  uint32_t ahb_div;       // RCC_SYSCLK_DIVx
+  uint32_t apb1_div;      // RCC_HCLK_DIVx
+  uint32_t apb2_div;
+  uint32_t adc_prescaler; // ADC_CLOCK_SYNC_PCLK_DIVx
+  uint32_t flash_latency; // 2.7-3.6 V wait states for HCLK
+  uint32_t voltage_scale;
+  uint8_t overdrive;
+} ClockProfile_Def_t;
+
+/* Private variables ---------------------------------------------------------*/
+static const ClockProfile_Def_t profiles[CLOCK_PROFILE_COUNT] = {
+    [CLOCK_PROFILE_PERFORMANCE] = {.pllp = RCC_PLLP_DIV2,
+                                   .ahb_div = RCC_SYSCLK_DIV1,
+                                   .apb1_div = RCC_HCLK_DIV4,
+                                   .apb2_div = RCC_HCLK_DIV2,
+                                   .adc_prescaler = ADC_CLOCK_SYNC_PCLK_DIV4,
+                                   .flash_latency = FLASH_LATENCY_7,
+                                   .voltage_scale =
+                                       PWR_REGULATOR_VOLTAGE_SCALE1,
+                                   .overdrive = 1},
+    [CLOCK_PROFILE_BALANCED] = {.pllp = RCC_PLLP_DIV4,
+                                .ahb_div = RCC_SYSCLK_DIV1,
+                                .apb1_div = RCC_HCLK_DIV2,
+                                .apb2_div = RCC_HCLK_DIV1,
+                                .adc_prescaler = ADC_CLOCK_SYNC_PCLK_DIV4,
+                                .flash_latency = FLASH_LATENCY_3,
+                                .voltage_scale = PWR_REGULATOR_VOLTAGE_SCALE3,
+                                .overdrive = 0},
+    [CLOCK_PROFILE_LOW_POWER] = {.pllp = RCC_PLLP_DIV8,
+                                 .ahb_div = RCC_SYSCLK_DIV1,
+                                 .apb1_div = RCC_HCLK_DIV1,
+                                 .apb2_div = RCC_HCLK_DIV1,
+                                 .adc_prescaler = ADC_CLOCK_SYNC_PCLK_DIV4,
+                                 .flash_latency = FLASH_LATENCY_1,
+                                 .voltage_scale = PWR_REGULATOR_VOLTAGE_SCALE3,
+                                 .overdrive = 0}};
+
+static ClockProfile_Info_t active_info;
+static uint8_t active_valid = 0;
+
+/* Private functions ---------------------------------------------------------*/
+
+static uint32_t clockProfile_ahbDivisor(uint32_t div) {
+  switch (div) {
+  case RCC_SYSCLK_DIV2:
+    return 2U;
+  case RCC_SYSCLK_DIV4:
+    return 4U;
+  default:
+    return 1U;
+  }
+}
+
+static uint32_t clockProfile_apbDivisor(uint32_t div) {
+  switch (div) {
+  case RCC_HCLK_DIV2:
+    return 2U;
+  case RCC_HCLK_DIV4:
+    return 4U;
+  case RCC_HCLK_DIV8:
+    return 8U;
+  case RCC_HCLK_DIV16:
+    return 16U;
+  default:
+    return 1U;
+  }
+}
+
+/**
+ * @brief PLLM for a 2 MHz VCO input if the source divides evenly, else 1 MHz
+ *
+ * @return uint32_t PLLM, 0 = source unusable
+ */
+static uint32_t clockProfile_pllm(uint32_t source_hz) {
+  uint32_t m = (source_hz % 2000000U == 0U) ? source_hz / 2000000U
+                                            : source_hz / 1000000U;
+  return IS_RCC_PLLM_VALUE(m) ? m : 0U;
+}
+
+/**
+ * @brief Run SYSCLK from HSI with the PLL and over-drive off (VOS can only
+ *        be changed while the PLL is off)
+ */
+static HAL_StatusTypeDef clockProfile_toHSI(void) {
+  RCC_OscInitTypeDef osc = {0};
+  osc.OscillatorType = RCC_OSCILLATORTYPE_HSI;
+  osc.HSIState = RCC_HSI_ON;
+  osc.HSICalibrationValue = RCC_HSICALIBRATION_DEFAULT;
+  osc.PLL.PLLState = RCC_PLL_NONE;
+  if (HAL_RCC_OscConfig(&osc) != HAL_OK) {
+    return HAL_ERROR;
+  }
+
+  RCC_ClkInitTypeDef clk = {0};
+  clk.ClockType = RCC_CLOCKTYPE_HCLK | RCC_CLOCKTYPE_SYSCLK |
+                  RCC_CLOCKTYPE_PCLK1 | RCC_CLOCKTYPE_PCLK2;
+  clk.SYSCLKSource = RCC_SYSCLKSOURCE_HSI;
+  clk.AHBCLKDivider = RCC_SYSCLK_DIV1;
+  clk.APB1CLKDivider = RCC_HCLK_DIV1;
+  clk.APB2CLKDivider = RCC_HCLK_DIV1;
+  // Keep the current wait states; the HAL lowers them after the switch
+  if (HAL_RCC_ClockConfig(&clk, __HAL_FLASH_GET_LATENCY()) != HAL_OK) {
+    return HAL_ERROR;
+  }
+  if (__HAL_PWR_GET_FLAG(PWR_FLAG_ODRDY) &&
+      HAL_PWREx_DisableOverDrive() != HAL_OK) {
+    return HAL_ERROR;
+  }
+
+  osc.OscillatorType = RCC_OSCILLATORTYPE_NONE;
+  osc.PLL.PLLState = RCC_PLL_OFF;
+  return HAL_RCC_OscConfig(&osc);
+}
+
+/**
+ * @brief Core and APB1 timer clocks of a SYSCLK under a CFGR value
+ */
+static void clockProfile_busOf(uint32_t sysclk_hz, uint32_t cfgr,
+                               ClockProfile_Bus_t *bus) {
+  const uint32_t apb1 = clockProfile_apbDivisor(cfgr & RCC_CFGR_PPRE1);
+  bus->hclk_hz = sysclk_hz / clockProfile_ahbDivisor(cfgr & RCC_CFGR_HPRE);
+  bus->apb1_timer_hz = bus->hclk_hz / apb1 * ((apb1 > 1U) ? 2U : 1U);
+}
+
+/**
+ * @brief Wait, in spins rather than ticks (interrupts may be masked), for
+ *        the bits of a register under a mask to read want
+ */
+static HAL_StatusTypeDef clockProfile_spinFor(volatile uint32_t *reg,
+                                              uint32_t mask, uint32_t want) {
+  for (uint32_t n = 0; (*reg & mask) != want; n++) {
+    if (n >= CLOCK_LOCK_SPINS) {
+      return HAL_TIMEOUT;
+    }
+  }
+  return HAL_OK;
+}
+
+/**
+ * @brief HAL_PWREx_Enable/DisableOverDrive() with spin-bounded waits, for
+ *        clockProfile_switch()
+ */
+static HAL_StatusTypeDef clockProfile_overdrive(uint8_t on) {
+  __HAL_RCC_PWR_CLK_ENABLE();
+  if (on) {
+    __HAL_PWR_OVERDRIVE_ENABLE();
+    if (clockProfile_spinFor(&PWR->CSR1, PWR_CSR1_ODRDY, PWR_CSR1_ODRDY) !=
+        HAL_OK) {
+      return HAL_TIMEOUT;
+    }
+    __HAL_PWR_OVERDRIVESWITCHING_ENABLE();
+    return clockProfile_spinFor(&PWR->CSR1, PWR_CSR1_ODSWRDY,
+                                PWR_CSR1_ODSWRDY);
+  }
+  __HAL_PWR_OVERDRIVESWITCHING_DISABLE();
+  if (clockProfile_spinFor(&PWR->CSR1, PWR_CSR1_ODSWRDY, 0U) != HAL_OK) {
+    return HAL_TIMEOUT;
+  }
+  __HAL_PWR_OVERDRIVE_DISABLE();
+  return clockProfile_spinFor(&PWR->CSR1, PWR_CSR1_ODRDY, 0U);
+}
+
+/**
+ * @brief One step of clockProfile_switch(): a CFGR write, the SYSCLK source
+ *        it selects, the hook, then SystemCoreClock and the HAL timebase
+ *        (HAL_InitTick() only reprograms a timer, it does not wait)
+ */
+static HAL_StatusTypeDef clockProfile_step(uint32_t cfgr, uint32_t sysclk_hz,
+                                           ClockProfile_Bus_t *bus,
+                                           ClockProfile_BusHook_t hook,
+                                           void *ctx) {
+  ClockProfile_Bus_t after;
+  clockProfile_busOf(sysclk_hz, cfgr, &after);
+  const uint32_t sws = (cfgr & RCC_CFGR_SW) << RCC_CFGR_SWS_Pos;
+
+  RCC->CFGR = cfgr;
+  for (uint32_t n = 0; (RCC->CFGR & RCC_CFGR_SWS) != sws; n++) {
+    if (n >= CLOCK_SWITCH_SPINS) {
+      return HAL_ERROR;
+    }
+  }
+  if (hook != NULL) {
+    hook(bus, &after, ctx);
+  }
+  *bus = after;
+  SystemCoreClock = after.hclk_hz;
+  return HAL_InitTick(uwTickPrio);
+}
+
+/* Public functions ----------------------------------------------------------*/
+
+HAL_StatusTypeDef clockProfile_getInfo(ClockProfile_Id_t id,
+                                       ClockProfile_Info_t *info) {
+  if ((uint32_t)id >= (uint32_t)CLOCK_PROFILE_COUNT || info == NULL) {
+    return HAL_ERROR;
+  }
+  const ClockProfile_Def_t *def = &profiles[id];
+
+  info->id = id;
+  info->sysclk_hz = CLOCK_VCO_HZ / def->pllp;
+  info->hclk_hz = info->sysclk_hz / clockProfile_ahbDivisor(def->ahb_div);
+  info->pclk1_hz = info->hclk_hz / clockProfile_apbDivisor(def->apb1_div);
+  info->pclk2_hz = info->hclk_hz / clockProfile_apbDivisor(def->apb2_div);
+  info->adcclk_hz =
+      info->pclk2_hz /
+      (((def->adc_prescaler >> ADC_CCR_ADCPRE_Pos) + 1U) * 2U);
+  info->adc_prescaler = def->adc_prescaler;
+  info->flash_latency = def->flash_latency;
+  info->voltage_scale = def->voltage_scale;
+  info->overdrive = def->overdrive;
+  info->adc_conversion_rate = info->adcclk_hz / CLOCK_ADC_MIN_CYCLES;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef clockProfile_apply(ClockProfile_Id_t id,
+                                     ClockProfile_Source_t source) {
+  ClockProfile_Info_t info;
+  if (clockProfile_getInfo(id, &info) != HAL_OK) {
+    return HAL_ERROR;
+  }
+  const ClockProfile_Def_t *def = &profiles[id];
+
+  uint32_t m = clockProfile_pllm(
+      (source == CLOCK_SOURCE_HSE_BYPASS) ? HSE_VALUE : CLOCK_HSI_HZ);
+  if (m == 0U) {
+    return HAL_ERROR;
+  }
+  uint32_t vco_in_hz =
+      ((source == CLOCK_SOURCE_HSE_BYPASS) ? HSE_VALUE : CLOCK_HSI_HZ) / m;
+
+  // The PLL cannot be reprogrammed while it clocks the core
+  if (clockProfile_toHSI() != HAL_OK) {
+    return HAL_ERROR;
+  }
+  active_valid = 0;
+
+  __HAL_RCC_PWR_CLK_ENABLE();
+  __HAL_PWR_VOLTAGESCALING_CONFIG(def->voltage_scale);
+
+  RCC_OscInitTypeDef osc = {0};
+  if (source == CLOCK_SOURCE_HSE_BYPASS) {
+    osc.OscillatorType = RCC_OSCILLATORTYPE_HSE;
+    osc.HSEState = RCC_HSE_BYPASS;
+    osc.PLL.PLLSource = RCC_PLLSOURCE_HSE;
+  } else {
+    osc.OscillatorType = RCC_OSCILLATORTYPE_HSI;
+    osc.HSIState = RCC_HSI_ON;
+    osc.HSICalibrationValue = RCC_HSICALIBRATION_DEFAULT;
+    osc.PLL.PLLSource = RCC_PLLSOURCE_HSI;
+  }
+  osc.PLL.PLLState = RCC_PLL_ON;
+  osc.PLL.PLLM = m;
+  osc.PLL.PLLN = CLOCK_VCO_HZ / vco_in_hz;
+  osc.PLL.PLLP = def->pllp;
+  osc.PLL.PLLQ = CLOCK_PLLQ;
+  if (HAL_RCC_OscConfig(&osc) != HAL_OK) {
+    return HAL_ERROR;
+  }
+
+  // Over-drive is switched on with the PLL running but not yet selected
+  if (def->overdrive && HAL_PWREx_EnableOverDrive() != HAL_OK) {
+    return HAL_ERROR;
+  }
+
+  RCC_ClkInitTypeDef clk = {0};
+  clk.ClockType = RCC_CLOCKTYPE_HCLK | RCC_CLOCKTYPE_SYSCLK |
+                  RCC_CLOCKTYPE_PCLK1 | RCC_CLOCKTYPE_PCLK2;
+  clk.SYSCLKSource = RCC_SYSCLKSOURCE_PLLCLK;
+  clk.AHBCLKDivider = def->ahb_div;
+  clk.APB1CLKDivider = def->apb1_div;
+  clk.APB2CLKDivider = def->apb2_div;
+  if (HAL_RCC_ClockConfig(&clk, def->flash_latency) != HAL_OK) {
+    return HAL_ERROR;
+  }
+
+  active_info = info;
+  active_valid = 1;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef clockProfile_switch(ClockProfile_Id_t id,
+                                      ClockProfile_BusHook_t hook, void *ctx) {
+  ClockProfile_Info_t info;
+  if (!active_valid || clockProfile_getInfo(id, &info) != HAL_OK) {
+    return HAL_ERROR;
+  }
+  if (id == active_info.id) {
+    return HAL_OK;
+  }
+  const ClockProfile_Def_t *def = &profiles[id];
+
+  // HSI carries the core through the switch (it is off under an HSE PLL)
+  const uint32_t start = HAL_GetTick();
+  __HAL_RCC_HSI_ENABLE();
+  while (__HAL_RCC_GET_FLAG(RCC_FLAG_HSIRDY) == RESET) {
+    if (HAL_GetTick() - start > CLOCK_RESUME_TIMEOUT_MS) {
+      return HAL_ERROR;
+    }
+  }
+
+  const uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  ClockProfile_Bus_t bus;
+  clockProfile_busOf(active_info.sysclk_hz, RCC->CFGR, &bus);
+  active_valid = 0;
+
+  // SYSCLK onto HSI, then the dividers to 1
+  HAL_StatusTypeDef status = clockProfile_step(
+      (RCC->CFGR & ~RCC_CFGR_SW) | RCC_CFGR_SW_HSI, CLOCK_HSI_HZ, &bus, hook,
+      ctx);
+  if (status == HAL_OK) {
+    status = clockProfile_step(RCC->CFGR & ~CLOCK_DIVIDERS, CLOCK_HSI_HZ,
+                               &bus, hook, ctx);
+  }
+
+  // Regulator scale only with the PLL off; over-drive only from HSI. No
+  // tick-based HAL helper from here: with interrupts masked the SysTick
+  // HAL tick (TIMEBASE_HAL_TICK 0) stands still and their timeouts with it
+  if (status == HAL_OK && __HAL_PWR_GET_FLAG(PWR_FLAG_ODRDY)) {
+    status = clockProfile_overdrive(0);
+  }
+  if (status == HAL_OK) {
+    __HAL_RCC_PLL_DISABLE();
+    status = clockProfile_spinFor(&RCC->CR, RCC_CR_PLLRDY, 0U);
+  }
+  if (status == HAL_OK) {
+    __HAL_PWR_VOLTAGESCALING_CONFIG(def->voltage_scale);
+    // Same source, M and N: only the dividers of the new profile
+    RCC->PLLCFGR =
+        (RCC->PLLCFGR & ~(RCC_PLLCFGR_PLLP | RCC_PLLCFGR_PLLQ)) |
+        (((def->pllp >> 1U) - 1U) << RCC_PLLCFGR_PLLP_Pos) |
+        (CLOCK_PLLQ << RCC_PLLCFGR_PLLQ_Pos);
+    __HAL_RCC_PLL_ENABLE();
+    status = clockProfile_spinFor(&RCC->CR, RCC_CR_PLLRDY, RCC_CR_PLLRDY);
+  }
+  if (status == HAL_OK && def->overdrive) {
+    status = clockProfile_overdrive(1);
+  }
+
+  // Wait states for the new HCLK before it, the dividers before SYSCLK
+  if (status == HAL_OK && def->flash_latency > __HAL_FLASH_GET_LATENCY()) {
+    __HAL_FLASH_SET_LATENCY(def->flash_latency);
+    if (__HAL_FLASH_GET_LATENCY() != def->flash_latency) {
+      status = HAL_ERROR;
+    }
+  }
+  if (status == HAL_OK) {
+    status = clockProfile_step((RCC->CFGR & ~CLOCK_DIVIDERS) | def->ahb_div |
+                                   def->apb1_div | (def->apb2_div << 3U),
+                               CLOCK_HSI_HZ, &bus, hook, ctx);
+  }
+  if (status == HAL_OK) {
+    status = clockProfile_step((RCC->CFGR & ~RCC_CFGR_SW) | RCC_CFGR_SW_PLL,
+                               info.sysclk_hz, &bus, hook, ctx);
+  }
+  if (status == HAL_OK && def->flash_latency < __HAL_FLASH_GET_LATENCY()) {
+    __HAL_FLASH_SET_LATENCY(def->flash_latency);
+  }
+
+  if (status == HAL_OK) {
+    active_info = info;
+    active_valid = 1;
+  }
+  __set_PRIMASK(primask);
+  return status;
+}
+
+HAL_StatusTypeDef clockProfile_resume(void) {
+  if (!active_valid) {
+    return HAL_ERROR;
+  }
+  if (__HAL_RCC_GET_SYSCLK_SOURCE() == RCC_SYSCLKSOURCE_STATUS_PLLCLK) {
+    return HAL_OK; // woken by something that did not stop the clocks
+  }
+
+  // STOP mode cleared HSEON, PLLON and over-drive only: PLL factors, bus
+  // dividers, VOS and wait states are still those of the profile
+  uint32_t start = HAL_GetTick();
+  if (__HAL_RCC_GET_PLL_OSCSOURCE() == RCC_PLLSOURCE_HSE) {
+    __HAL_RCC_HSE_CONFIG(RCC_HSE_BYPASS);
+    while (__HAL_RCC_GET_FLAG(RCC_FLAG_HSERDY) == RESET) {
+      if (HAL_GetTick() - start > CLOCK_RESUME_TIMEOUT_MS) {
+        return HAL_TIMEOUT;
+      }
+    }
+  }
+  __HAL_RCC_PLL_ENABLE();
+  while (__HAL_RCC_GET_FLAG(RCC_FLAG_PLLRDY) == RESET) {
+    if (HAL_GetTick() - start > CLOCK_RESUME_TIMEOUT_MS) {
+      return HAL_TIMEOUT;
+    }
+  }
+  if (active_info.overdrive && HAL_PWREx_EnableOverDrive() != HAL_OK) {
+    return HAL_ERROR;
+  }
+
+  __HAL_RCC_SYSCLK_CONFIG(RCC_SYSCLKSOURCE_PLLCLK);
+  while (__HAL_RCC_GET_SYSCLK_SOURCE() != RCC_SYSCLKSOURCE_STATUS_PLLCLK) {
+    if (HAL_GetTick() - start > CLOCK_RESUME_TIMEOUT_MS) {
+      return HAL_TIMEOUT;
+    }
+  }
+  SystemCoreClock = active_info.hclk_hz;
+  return HAL_OK;
+}
+
+const ClockProfile_Info_t *clockProfile_getActive(void) {
+  return active_valid ? &active_info : NULL;
+}
@@ -0,0 +1,447 @@
+/**
+ ******************************************************************************
+ * @file    config_store.c
+ * @brief   Implementation of the persistent settings log
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "config_store.h"
+#include "adc_sections.h"
+#include "crc_unit.h"
+#include "event_log.h"
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define CONFIG_STORE_MAGIC 0x31474643U  // "CFG1"
+#define CONFIG_STORE_COMMIT 0x54494D43U // "CMIT"
+#define CONFIG_STORE_ERASED 0xFFFFFFFFU
+#define CONFIG_STORE_SECTORS 2U
+#define CONFIG_STORE_SECTOR_WORDS (32U * 1024U / sizeof(uint32_t))
+#define CONFIG_STORE_HEADER_WORDS 2U // generation, then magic
+#define CONFIG_STORE_VALUE_WORDS (CONFIG_STORE_VALUE_MAX / sizeof(uint32_t))
+#define CONFIG_STORE_RECORD_WORDS(len)                                         \
+  (1U + ((uint32_t)(len) + 3U) / 4U + 2U) // head, value, CRC, commit
+
+_Static_assert(CONFIG_STORE_VALUE_MAX % sizeof(uint32_t) == 0U &&
+                   CONFIG_STORE_VALUE_MAX <= 0xFFFFU,
+               "CONFIG_STORE_VALUE_MAX: whole words, 16-bit length");
+_Static_assert(CONFIG_KEY_COUNT <= 32U, "one dirty bit per key");
+
+/* Private types -------------------------------------------------------------*/
+typedef struct {
+  uint8_t valid;
+  uint8_t version;
+  uint16_t len;
+  uint32_t value[CONFIG_STORE_VALUE_WORDS];
+} ConfigStore_Entry_t;
+
+typedef enum {
+  CONFIG_OP_IDLE = 0,
+  CONFIG_OP_RECORD,  // appending one record to the active sector
+  CONFIG_OP_COMPACT, // copying every value into the other sector
+} ConfigStore_Op_t;
+
+/* External variables --------------------------------------------------------*/
+extern const uint32_t _sconfig[]; // start of the CONFIG region (linker script)
+
+/* Private variables ---------------------------------------------------------*/
+static const uint32_t sector_id[CONFIG_STORE_SECTORS] = {FLASH_SECTOR_1,
+                                                         FLASH_SECTOR_2};
+static uint8_t mounted = 0;
+static int8_t active = -1;         // sector with the newest header, -1 none
+static uint32_t generation = 0;    // of the active sector
+static uint32_t write_pos = 0;     // next free word of the active sector
+static uint8_t blank[CONFIG_STORE_SECTORS]; // erased, usable for a copy
+
+static ConfigStore_Entry_t entries[CONFIG_KEY_COUNT];
+static uint32_t dirty = 0; // keys changed in RAM since their last record
+
+/* Write in progress */
+static ConfigStore_Op_t op = CONFIG_OP_IDLE;
+static uint8_t op_sector = 0;
+static uint32_t op_pos = 0;  // compaction: next free word of op_sector
+static uint32_t op_key = 0;  // compaction: next key to copy
+static uint32_t staged[CONFIG_STORE_RECORD_WORDS(CONFIG_STORE_VALUE_MAX)];
+static uint32_t staged_at = 0;    // word offset in op_sector
+static uint32_t staged_words = 0;
+static uint32_t staged_done = 0;  // words programmed
+static int32_t staged_key = -1;   // key of the record, -1 = header
+
+static ConfigStore_Stats_t stats_ = {0};
+
+/* Private functions ---------------------------------------------------------*/
+
+static const uint32_t *configStore_sector(uint8_t sector) {
+  return &_sconfig[sector * CONFIG_STORE_SECTOR_WORDS];
+}
+
+static uint32_t configStore_crc32(const uint32_t *words, uint32_t count) {
+  const uint8_t *data = (const uint8_t *)words;
+  const uint32_t len = count * sizeof(uint32_t);
+  uint32_t crc = 0xFFFFFFFFU;
+#if CRC_UNIT_ENABLE
+  if (crcUnit_crc32(0, data, len, &crc) == HAL_OK) {
+    return crc;
+  }
+#endif
+  for (uint32_t i = 0; i < len; i++) {
+    crc ^= data[i];
+    for (uint8_t bit = 0; bit < 8U; bit++) {
+      crc = (crc & 1U) ? (crc >> 1) ^ 0xEDB88320U : crc >> 1;
+    }
+  }
+  return ~crc;
+}
+
+/**
+ * @brief Drop cached lines of flash words that were just programmed or
+ *        erased
+ */
+static void configStore_invalidate(const uint32_t *words, uint32_t count) {
+  const uintptr_t addr = (uintptr_t)words;
+  const uintptr_t offset = addr & (ADC_DCACHE_LINE_SIZE - 1U);
+  SCB_InvalidateDCache_by_Addr((uint32_t *)(addr - offset),
+                               (int32_t)(count * sizeof(uint32_t) + offset));
+}
+
+static uint8_t configStore_isBlank(uint8_t sector) {
+  const uint32_t *base = configStore_sector(sector);
+  for (uint32_t i = 0; i < CONFIG_STORE_SECTOR_WORDS; i++) {
+    if (base[i] != CONFIG_STORE_ERASED) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+/**
+ * @brief Load every committed record of a sector into entries[]
+ *
+ * @return uint32_t First free word; the sector end if a damaged record
+ *         makes the rest unusable
+ */
+static uint32_t configStore_scan(uint8_t sector) {
+  const uint32_t *base = configStore_sector(sector);
+  uint32_t pos = CONFIG_STORE_HEADER_WORDS;
+
+  while (pos < CONFIG_STORE_SECTOR_WORDS) {
+    const uint32_t head = base[pos];
+    if (head == CONFIG_STORE_ERASED) {
+      break;
+    }
+    const uint32_t key = head & 0xFFU;
+    const uint32_t len = head >> 16;
+    const uint32_t words = CONFIG_STORE_RECORD_WORDS(len);
+    if (len > CONFIG_STORE_VALUE_MAX ||
+        words > CONFIG_STORE_SECTOR_WORDS - pos) {
+      return CONFIG_STORE_SECTOR_WORDS;
+    }
+    // Later records of a key replace earlier ones
+    if (key < CONFIG_KEY_COUNT &&
+        base[pos + words - 1U] == CONFIG_STORE_COMMIT &&
+        base[pos + words - 2U] == configStore_crc32(&base[pos], words - 2U)) {
+      ConfigStore_Entry_t *entry = &entries[key];
+      entry->valid = 1;
+      entry->version = (uint8_t)(head >> 8);
+      entry->len = (uint16_t)len;
+      memset(entry->value, 0, sizeof(entry->value));
+      memcpy(entry->value, &base[pos + 1U], len);
+    }
+    pos += words; // an interrupted record is skipped, never reused
+  }
+  return pos;
+}
+
+/**
+ * @brief Queue the record of a key for programming at a word offset
+ */
+static void configStore_stageRecord(uint32_t key, uint32_t at) {
+  const ConfigStore_Entry_t *entry = &entries[key];
+  const uint32_t value_words = CONFIG_STORE_RECORD_WORDS(entry->len) - 3U;
+
+  staged[0] = key | ((uint32_t)entry->version << 8) |
+              ((uint32_t)entry->len << 16);
+  memcpy(&staged[1], entry->value, value_words * sizeof(uint32_t));
+  staged[1U + value_words] = configStore_crc32(staged, 1U + value_words);
+  staged[2U + value_words] = CONFIG_STORE_COMMIT;
+  staged_words = 3U + value_words;
+  staged_at = at;
+  staged_done = 0;
+  staged_key = (int32_t)key;
+  dirty &= ~(1UL << key); // changed again from here on: written again
+}
+
+/**
+ * @brief Queue the compaction target's header, which makes it active
+ */
+static void configStore_stageHeader(void) {
+  staged[0] = generation + 1U;
+  staged[1] = CONFIG_STORE_MAGIC; // programmed last
+  staged_words = CONFIG_STORE_HEADER_WORDS;
+  staged_at = 0;
+  staged_done = 0;
+  staged_key = -1;
+}
+
+/**
+ * @brief Stage the next value of the compaction, or its header
+ */
+static void configStore_stageCompaction(void) {
+  while (op_key < CONFIG_KEY_COUNT && !entries[op_key].valid) {
+    op_key++;
+  }
+  if (op_key < CONFIG_KEY_COUNT) {
+    configStore_stageRecord(op_key++, op_pos);
+  } else {
+    configStore_stageHeader();
+  }
+}
+
+static void configStore_fail(void) {
+  stats_.errors++;
+  if (op == CONFIG_OP_RECORD) {
+    write_pos = CONFIG_STORE_SECTOR_WORDS; // next update compacts
+  } else {
+    blank[op_sector] = 0; // erased before the next attempt
+    for (uint32_t key = 0; key < CONFIG_KEY_COUNT; key++) {
+      if (entries[key].valid) {
+        dirty |= 1UL << key;
+      }
+    }
+  }
+  if (staged_key >= 0) {
+    dirty |= 1UL << (uint32_t)staged_key;
+  }
+  op = CONFIG_OP_IDLE;
+}
+
+/**
+ * @brief The staged words are in flash and verified
+ */
+static void configStore_staged(void) {
+  if (op == CONFIG_OP_RECORD) {
+    write_pos += staged_words;
+    stats_.records++;
+    op = CONFIG_OP_IDLE;
+  } else if (staged_key >= 0) {
+    op_pos += staged_words;
+    configStore_stageCompaction();
+  } else {
+    // The copy holds every value: it replaces the old sector
+    if (active >= 0) {
+      blank[active] = 0;
+    }
+    active = (int8_t)op_sector;
+    generation++;
+    write_pos = op_pos;
+    stats_.compactions++;
+    op = CONFIG_OP_IDLE;
+  }
+}
+
+/**
+ * @brief Program up to CONFIG_STORE_WORDS_PER_POLL staged words
+ */
+static HAL_StatusTypeDef configStore_program(void) {
+  const uint32_t *base = configStore_sector(op_sector);
+  HAL_StatusTypeDef status = HAL_FLASH_Unlock();
+
+  for (uint32_t n = 0; status == HAL_OK && n < CONFIG_STORE_WORDS_PER_POLL &&
+                       staged_done < staged_words;
+       n++) {
+    status = HAL_FLASH_Program(FLASH_TYPEPROGRAM_WORD,
+                               (uint32_t)&base[staged_at + staged_done],
+                               staged[staged_done]);
+    if (status == HAL_OK) {
+      staged_done++;
+    }
+  }
+  HAL_FLASH_Lock();
+
+  if (status == HAL_OK && staged_done == staged_words) {
+    configStore_invalidate(&base[staged_at], staged_words);
+    if (memcmp(&base[staged_at], staged, staged_words * sizeof(uint32_t)) !=
+        0) {
+      status = HAL_ERROR;
+    } else {
+      configStore_staged();
+    }
+  }
+  if (status != HAL_OK) {
+    configStore_fail();
+    return HAL_ERROR;
+  }
+  return HAL_OK;
+}
+
+/**
+ * @brief Erase every sector that is neither active nor blank
+ */
+static HAL_StatusTypeDef configStore_eraseSpent(void) {
+  HAL_StatusTypeDef result = HAL_OK;
+
+  for (uint8_t sector = 0; sector < CONFIG_STORE_SECTORS; sector++) {
+    if ((int8_t)sector == active || blank[sector]) {
+      continue;
+    }
+    FLASH_EraseInitTypeDef erase = {.TypeErase = FLASH_TYPEERASE_SECTORS,
+                                    .Sector = sector_id[sector],
+                                    .NbSectors = 1,
+                                    .VoltageRange = FLASH_VOLTAGE_RANGE_3};
+    uint32_t sector_error = 0;
+    HAL_StatusTypeDef status = HAL_FLASH_Unlock();
+    if (status == HAL_OK) {
+      status = HAL_FLASHEx_Erase(&erase, &sector_error);
+    }
+    HAL_FLASH_Lock();
+    configStore_invalidate(configStore_sector(sector),
+                           CONFIG_STORE_SECTOR_WORDS);
+    stats_.erases++;
+
+    blank[sector] = (status == HAL_OK) ? configStore_isBlank(sector) : 0U;
+    if (!blank[sector]) {
+      stats_.errors++;
+      result = HAL_ERROR;
+    }
+  }
+  return result;
+}
+
+/**
+ * @brief Start writing the lowest queued key, or a compaction when it does
+ *        not fit
+ *
+ * @return HAL_StatusTypeDef HAL_BUSY when no blank sector takes the copy
+ */
+static HAL_StatusTypeDef configStore_start(void) {
+  uint32_t key = 0;
+  while ((dirty & (1UL << key)) == 0U) {
+    key++;
+  }
+
+  if (active >= 0 && CONFIG_STORE_RECORD_WORDS(entries[key].len) <=
+                         CONFIG_STORE_SECTOR_WORDS - write_pos) {
+    op = CONFIG_OP_RECORD;
+    op_sector = (uint8_t)active;
+    configStore_stageRecord(key, write_pos);
+    return HAL_OK;
+  }
+
+  // Full, or nothing formatted yet: copy everything into a blank sector
+  for (uint8_t sector = 0; sector < CONFIG_STORE_SECTORS; sector++) {
+    if ((int8_t)sector != active && blank[sector]) {
+      op = CONFIG_OP_COMPACT;
+      op_sector = sector;
+      op_pos = CONFIG_STORE_HEADER_WORDS;
+      op_key = 0;
+      blank[sector] = 0;
+      configStore_stageCompaction();
+      return HAL_OK;
+    }
+  }
+  stats_.deferred++;
+  return HAL_BUSY;
+}
+
+/* Public functions ----------------------------------------------------------*/
+
+HAL_StatusTypeDef configStore_init(void) {
+  memset(entries, 0, sizeof(entries));
+  dirty = 0;
+  op = CONFIG_OP_IDLE;
+  active = -1;
+  generation = 0;
+  write_pos = CONFIG_STORE_SECTOR_WORDS;
+
+  // The newest complete header wins; the other sector is spent or blank
+  for (uint8_t sector = 0; sector < CONFIG_STORE_SECTORS; sector++) {
+    const uint32_t *base = configStore_sector(sector);
+    if (base[1] == CONFIG_STORE_MAGIC &&
+        (active < 0 || (int32_t)(base[0] - generation) > 0)) {
+      active = (int8_t)sector;
+      generation = base[0];
+    }
+  }
+  for (uint8_t sector = 0; sector < CONFIG_STORE_SECTORS; sector++) {
+    blank[sector] = ((int8_t)sector != active) ? configStore_isBlank(sector)
+                                              : 0U;
+  }
+  if (active >= 0) {
+    write_pos = configStore_scan((uint8_t)active);
+  }
+  mounted = 1;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef configStore_get(ConfigStore_Key_t key, uint8_t version,
+                                  void *value, uint16_t len) {
+  if ((uint32_t)key >= CONFIG_KEY_COUNT || value == NULL) {
+    return HAL_ERROR;
+  }
+  const ConfigStore_Entry_t *entry = &entries[key];
+  if (!entry->valid || entry->version != version || entry->len != len) {
+    return HAL_ERROR;
+  }
+  memcpy(value, entry->value, len);
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef configStore_set(ConfigStore_Key_t key, uint8_t version,
+                                  const void *value, uint16_t len) {
+  if ((uint32_t)key >= CONFIG_KEY_COUNT || (value == NULL && len != 0U) ||
+      len > CONFIG_STORE_VALUE_MAX) {
+    return HAL_ERROR;
+  }
+  ConfigStore_Entry_t *entry = &entries[key];
+  if (entry->valid && entry->version == version && entry->len == len &&
+      memcmp(entry->value, value, len) == 0) {
+    return HAL_OK; // no flash wear for a value already stored
+  }
+  entry->valid = 1;
+  entry->version = version;
+  entry->len = len;
+  memset(entry->value, 0, sizeof(entry->value));
+  if (len != 0U) {
+    memcpy(entry->value, value, len);
+  }
+  dirty |= 1UL << (uint32_t)key;
+  eventLog_write(EVENT_LOG_CONFIG, (uint8_t)key,
+                 version | ((uint32_t)len << 8));
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef configStore_poll(uint8_t may_erase) {
+  if (!mounted) {
+    return HAL_ERROR;
+  }
+  if (op == CONFIG_OP_IDLE) {
+    if (may_erase && configStore_eraseSpent() != HAL_OK) {
+      return HAL_ERROR;
+    }
+    if (dirty == 0U) {
+      return HAL_OK;
+    }
+    HAL_StatusTypeDef status = configStore_start();
+    if (status != HAL_OK) {
+      return status;
+    }
+  }
+  return configStore_program();
+}
+
+uint8_t configStore_isPending(void) {
+  return (dirty != 0U || op != CONFIG_OP_IDLE) ? 1U : 0U;
+}
+
+HAL_StatusTypeDef configStore_getStats(ConfigStore_Stats_t *stats) {
+  if (stats == NULL) {
+    return HAL_ERROR;
+  }
+  *stats = stats_;
+  stats->generation = (active >= 0) ? generation : 0U;
+  stats->used_bytes =
+      (active >= 0) ? write_pos * (uint32_t)sizeof(uint32_t) : 0U;
+  return HAL_OK;
+}
@@ -0,0 +1,162 @@
+/**
+ ******************************************************************************
+ * @file    cpu_load.c
+ * @brief   Implementation of the WFI idle loop and CPU load accounting
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "cpu_load.h"
+#include "timebase.h"
+
+/* Private defines -----------------------------------------------------------*/
+#define CPU_LOAD_FULL 10000U // 100.00 %
+#define CPU_LOAD_SLICE_TICKS                                                   \
+  ((uint64_t)CPU_LOAD_SLICE_MS * TIMEBASE_TICK_HZ / 1000U)
+#define CPU_LOAD_MS_TICKS (TIMEBASE_TICK_HZ / 1000U)
+
+/* Private variables ---------------------------------------------------------*/
+static uint8_t running = 0;
+static uint64_t slice_start_tick;    // timebase at the start of the slice
+static uint32_t slice_start_cycles;  // CYCCNT at the start of the slice
+static uint32_t slice_slept;         // cycles measured asleep in the slice
+static uint16_t history[CPU_LOAD_SLICES];
+static uint32_t slice_count = 0;
+static uint16_t peak = 0;
+static uint32_t wakeups = 0;
+static uint64_t slept_total = 0;    // cycles measured asleep since reset
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+ * @brief Close the slice once CPU_LOAD_SLICE_MS of wall time has passed
+ */
+static void cpuLoad_account(void) {
+  uint64_t now = timebase_now();
+  uint64_t ticks = now - slice_start_tick;
+  if (ticks < CPU_LOAD_SLICE_TICKS) {
+    return;
+  }
+
+  uint32_t cycles = DWT->CYCCNT;
+  uint64_t wall = ticks * SystemCoreClock / TIMEBASE_TICK_HZ;
+  // Elapsed counter cycles less those asleep: right whether or not the
+  // counter runs during WFI (if it stops, slice_slept is only a few cycles)
+  uint32_t counted = cycles - slice_start_cycles;
+  uint64_t awake = (counted > slice_slept) ? counted - slice_slept : 0U;
+  uint32_t load = (wall != 0U) ? (uint32_t)(awake * CPU_LOAD_FULL / wall) : 0U;
+  if (load > CPU_LOAD_FULL) {
+    load = CPU_LOAD_FULL; // timebase and core clock from different sources
+  }
+
+  history[slice_count % CPU_LOAD_SLICES] = (uint16_t)load;
+  slice_count++;
+  if (load > peak) {
+    peak = (uint16_t)load;
+  }
+
+  slice_start_tick = now;
+  slice_start_cycles = cycles;
+  slice_slept = 0;
+}
+
+/* Public functions ----------------------------------------------------------*/
+
+void cpuLoad_init(void) {
+  for (uint32_t i = 0; i < CPU_LOAD_SLICES; i++) {
+    history[i] = 0;
+  }
+  slice_count = 0;
+  peak = 0;
+  wakeups = 0;
+  slice_slept = 0;
+  slice_start_tick = timebase_now();
+  slice_start_cycles = DWT->CYCCNT;
+  running = 1;
+}
+
+void cpuLoad_idle(void) {
+  // PRIMASK only holds the handler back: a pending interrupt still ends the
+  // WFI, and runs once the sleep has been timed
+#if TIMEBASE_HAL_TICK
+  // No SysTick to end the sleep: work an interrupt left for the loop while
+  // it was busy waits at most CPU_LOAD_MAX_SLEEP_MS
+  timebase_wakeAt(timebase_now() +
+                  (uint64_t)CPU_LOAD_MAX_SLEEP_MS * CPU_LOAD_MS_TICKS);
+#endif
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  uint32_t t0 = DWT->CYCCNT;
+  __DSB();
+  __WFI();
+  uint32_t t1 = DWT->CYCCNT;
+  slept_total += t1 - t0; // still masked: a reader never sees half of it
+  __set_PRIMASK(primask);
+  __ISB();
+
+  if (!running) {
+    return;
+  }
+  slice_slept += t1 - t0;
+  wakeups++;
+  cpuLoad_account();
+}
+
+HAL_StatusTypeDef cpuLoad_getStats(CpuLoad_Stats_t *stats) {
+  if (stats == NULL) {
+    return HAL_ERROR;
+  }
+  uint32_t n = (slice_count < CPU_LOAD_SLICES) ? slice_count : CPU_LOAD_SLICES;
+  uint32_t sum = 0;
+  for (uint32_t i = 0; i < n; i++) {
+    sum += history[i];
+  }
+  stats->load_centi_pct = (n != 0U) ? (uint16_t)(sum / n) : 0U;
+  stats->last_centi_pct =
+      (slice_count != 0U) ? history[(slice_count - 1U) % CPU_LOAD_SLICES] : 0U;
+  stats->peak_centi_pct = peak;
+  stats->slices = slice_count;
+  stats->wakeups = wakeups;
+  return HAL_OK;
+}
+
+void cpuLoad_resetPeak(void) { peak = 0; }
+
+void cpuLoad_restartSlice(void) {
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  slice_start_tick = timebase_now();
+  slice_start_cycles = DWT->CYCCNT;
+  slice_slept = 0;
+  __set_PRIMASK(primask);
+}
+
+uint64_t cpuLoad_getSleptCycles(void) {
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  uint64_t cycles = slept_total;
+  __set_PRIMASK(primask);
+  return cycles;
+}
+
+/**
+ * @brief HAL_Delay() that sleeps until its deadline, or between SysTick
+ *        interrupts (overrides the weak busy-wait of stm32f7xx_hal.c)
+ */
+void HAL_Delay(uint32_t Delay) {
+  uint32_t start = HAL_GetTick();
+  uint32_t wait = Delay;
+
+  // Same minimum wait as the HAL version
+  if (wait < HAL_MAX_DELAY) {
+    wait += (uint32_t)uwTickFreq;
+  }
+  // The ms tick may be about to step: the deadline is at most 1 ms early
+  const uint64_t deadline =
+      timebase_now() + (uint64_t)wait * CPU_LOAD_MS_TICKS;
+  while ((HAL_GetTick() - start) < wait) {
+    timebase_wakeAt(deadline);
+    cpuLoad_idle();
+  }
+}
@@ -0,0 +1,279 @@
+/**
+ ******************************************************************************
+ * @file    crc_unit.c
+ * @brief   Implementation of the shared CRC unit access
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "crc_unit.h"
+#include "adc_sections.h"
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define CRC_UNIT_POLY16 0x1021U
+#define CRC_UNIT_POLY32 0x04C11DB7U
+#define CRC_UNIT_DMA_MAX_CHUNK 65535U // NDTR limit, in bytes here
+#define CRC_UNIT_CACHE_LINE 32U
+
+/* Private types -------------------------------------------------------------*/
+typedef enum {
+  CRC_JOB_NONE = 0,
+  CRC_JOB_RUNNING,
+  CRC_JOB_DONE,  // result not read yet
+  CRC_JOB_ERROR
+} CrcUnit_Job_t;
+
+/* Private variables ---------------------------------------------------------*/
+static DMA_HandleTypeDef hdma_crc;
+static uint8_t ready = 0;
+static volatile uint8_t owned = 0;
+
+/* DMA job */
+static volatile uint8_t job = CRC_JOB_NONE;
+static CrcUnit_Algo_t job_algo = CRC_UNIT_CRC16;
+static const uint8_t *job_next = NULL; // start of the next chunk
+static uint32_t job_left = 0;          // bytes after this chunk
+static uint32_t job_bytes = 0;
+static uint32_t job_result = 0;
+
+static CrcUnit_Stats_t stats_ = {0};
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+ * @brief Take the unit if nobody owns it
+ */
+ADC_HOT_CODE static uint8_t crcUnit_acquire(void) {
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  uint8_t got = (ready && !owned) ? 1U : 0U;
+  if (got) {
+    owned = 1;
+  } else {
+    stats_.busy++;
+  }
+  __set_PRIMASK(primask);
+  return got;
+}
+
+/**
+ * @brief Polynomial, reversal and initial value of a variant, then reset
+ *
+ * The CRC-32 state is kept reflected in CRC_DR (REV_OUT) but loaded
+ * unreflected into CRC_INIT, hence the RBIT when resuming from prev.
+ */
+ADC_HOT_CODE static void crcUnit_setup(CrcUnit_Algo_t algo, uint32_t prev) {
+  if (algo == CRC_UNIT_CRC16) {
+    CRC->POL = CRC_UNIT_POLY16;
+    CRC->INIT = 0xFFFFU;
+    CRC->CR = CRC_CR_POLYSIZE_0 | CRC_CR_RESET;
+  } else {
+    CRC->POL = CRC_UNIT_POLY32;
+    CRC->INIT = __RBIT(~prev);
+    CRC->CR = CRC_CR_REV_IN_0 | CRC_CR_REV_OUT | CRC_CR_RESET;
+  }
+}
+
+/**
+ * @brief Feed bytes in memory order: whole words byte-swapped so the first
+ *        byte goes in first, then the tail as byte writes
+ */
+ADC_HOT_CODE static void crcUnit_feed(const uint8_t *data, uint32_t len) {
+  __IO uint8_t *dr8 = (__IO uint8_t *)&CRC->DR;
+
+  while (len >= 4U) {
+    uint32_t word;
+    memcpy(&word, data, sizeof(word));
+    CRC->DR = __REV(word);
+    data += 4;
+    len -= 4U;
+  }
+  while (len-- > 0U) {
+    *dr8 = *data++;
+  }
+}
+
+ADC_HOT_CODE static uint32_t crcUnit_result(CrcUnit_Algo_t algo) {
+  return (algo == CRC_UNIT_CRC16) ? (CRC->DR & 0xFFFFU) : ~CRC->DR;
+}
+
+/**
+ * @brief Start the DMA on the next chunk of the job
+ */
+static HAL_StatusTypeDef crcUnit_startChunk(void) {
+  const uint8_t *src = job_next;
+  uint32_t n = (job_left > CRC_UNIT_DMA_MAX_CHUNK) ? CRC_UNIT_DMA_MAX_CHUNK
+                                                   : job_left;
+  job_next += n;
+  job_left -= n;
+  return HAL_DMA_Start_IT(&hdma_crc, (uint32_t)(uintptr_t)src,
+                          (uint32_t)(uintptr_t)&CRC->DR, n);
+}
+
+static void crcUnit_dmaDone(DMA_HandleTypeDef *hdma) {
+  (void)hdma;
+  if (job_left != 0U) {
+    if (crcUnit_startChunk() == HAL_OK) {
+      return;
+    }
+    stats_.dma_errors++;
+    job = CRC_JOB_ERROR;
+  } else {
+    job_result = crcUnit_result(job_algo);
+    stats_.dma_jobs++;
+    stats_.dma_bytes += job_bytes;
+    job = CRC_JOB_DONE;
+  }
+  owned = 0;
+}
+
+static void crcUnit_dmaError(DMA_HandleTypeDef *hdma) {
+  // A FIFO error alone leaves the stream running
+  if ((hdma->ErrorCode & ~HAL_DMA_ERROR_FE) == 0U) {
+    return;
+  }
+  stats_.dma_errors++;
+  job = CRC_JOB_ERROR;
+  owned = 0;
+}
+
+/* Public functions ----------------------------------------------------------*/
+
+HAL_StatusTypeDef crcUnit_init(void) {
+#if CRC_UNIT_ENABLE
+  __HAL_RCC_CRC_CLK_ENABLE();
+  __HAL_RCC_DMA2_CLK_ENABLE();
+
+  // Memory to memory: the "peripheral" port reads the block, the memory
+  // port writes CRC_DR. Byte writes keep any length and alignment exact.
+  hdma_crc.Instance = DMA2_Stream7;
+  hdma_crc.Init.Channel = DMA_CHANNEL_0;
+  hdma_crc.Init.Direction = DMA_MEMORY_TO_MEMORY;
+  hdma_crc.Init.PeriphInc = DMA_PINC_ENABLE;
+  hdma_crc.Init.MemInc = DMA_MINC_DISABLE;
+  hdma_crc.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+  hdma_crc.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+  hdma_crc.Init.Mode = DMA_NORMAL;
+  hdma_crc.Init.Priority = DMA_PRIORITY_LOW;
+  hdma_crc.Init.FIFOMode = DMA_FIFOMODE_ENABLE; // required for M2M
+  hdma_crc.Init.FIFOThreshold = DMA_FIFO_THRESHOLD_FULL;
+  hdma_crc.Init.MemBurst = DMA_MBURST_SINGLE;
+  hdma_crc.Init.PeriphBurst = DMA_PBURST_SINGLE;
+  if (HAL_DMA_Init(&hdma_crc) != HAL_OK) {
+    return HAL_ERROR;
+  }
+  hdma_crc.XferCpltCallback = crcUnit_dmaDone;
+  hdma_crc.XferErrorCallback = crcUnit_dmaError;
+
+  HAL_NVIC_SetPriority(DMA2_Stream7_IRQn, CRC_UNIT_IRQ_PRIORITY, 0);
+  HAL_NVIC_EnableIRQ(DMA2_Stream7_IRQn);
+  ready = 1;
+#endif
+  return HAL_OK;
+}
+
+ADC_HOT_CODE HAL_StatusTypeDef crcUnit_crc16(const uint8_t *data, uint32_t len,
+                                             uint16_t *crc) {
+  if ((data == NULL && len != 0U) || crc == NULL) {
+    return HAL_ERROR;
+  }
+  if (!crcUnit_acquire()) {
+    return HAL_BUSY;
+  }
+  crcUnit_setup(CRC_UNIT_CRC16, 0);
+  crcUnit_feed(data, len);
+  *crc = (uint16_t)crcUnit_result(CRC_UNIT_CRC16);
+  stats_.computed++;
+  owned = 0;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef crcUnit_crc32(uint32_t prev, const uint8_t *data,
+                                uint32_t len, uint32_t *crc) {
+  if ((data == NULL && len != 0U) || crc == NULL) {
+    return HAL_ERROR;
+  }
+  if (!crcUnit_acquire()) {
+    return HAL_BUSY;
+  }
+  crcUnit_setup(CRC_UNIT_CRC32, prev);
+  crcUnit_feed(data, len);
+  *crc = crcUnit_result(CRC_UNIT_CRC32);
+  stats_.computed++;
+  owned = 0;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef crcUnit_startDma(CrcUnit_Algo_t algo, uint32_t prev,
+                                   const void *data, uint32_t len) {
+  if (data == NULL || len == 0U || (uint32_t)algo > CRC_UNIT_CRC32) {
+    return HAL_ERROR;
+  }
+  if (!crcUnit_acquire()) {
+    return HAL_BUSY;
+  }
+  if (job != CRC_JOB_NONE) {
+    owned = 0;
+    return HAL_BUSY;
+  }
+  crcUnit_setup(algo, prev);
+
+  if (len < CRC_UNIT_DMA_MIN_BYTES) {
+    crcUnit_feed((const uint8_t *)data, len);
+    job_result = crcUnit_result(algo);
+    stats_.computed++;
+    job = CRC_JOB_DONE;
+    owned = 0;
+    return HAL_OK;
+  }
+
+  // Whole cache lines, the block need not be aligned
+  const uintptr_t addr = (uintptr_t)data;
+  const uintptr_t offset = addr & (CRC_UNIT_CACHE_LINE - 1U);
+  SCB_CleanDCache_by_Addr((uint32_t *)(addr - offset),
+                          (int32_t)(len + offset));
+
+  job_algo = algo;
+  job_next = (const uint8_t *)data;
+  job_left = len;
+  job_bytes = len;
+  job = CRC_JOB_RUNNING;
+  if (crcUnit_startChunk() != HAL_OK) {
+    stats_.dma_errors++;
+    job = CRC_JOB_NONE;
+    owned = 0;
+    return HAL_ERROR;
+  }
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef crcUnit_getDmaResult(uint32_t *crc) {
+  if (crc == NULL) {
+    return HAL_ERROR;
+  }
+  switch (job) {
+  case CRC_JOB_RUNNING:
+    return HAL_BUSY;
+  case CRC_JOB_DONE:
+    *crc = job_result;
+    job = CRC_JOB_NONE;
+    return HAL_OK;
+  case CRC_JOB_ERROR:
+    job = CRC_JOB_NONE;
+    return HAL_ERROR;
+  default:
+    return HAL_ERROR;
+  }
+}
+
+HAL_StatusTypeDef crcUnit_getStats(CrcUnit_Stats_t *stats) {
+  if (stats == NULL) {
+    return HAL_ERROR;
+  }
+  *stats = stats_;
+  return HAL_OK;
+}
+
+void crcUnit_dmaIrqHandler(void) { HAL_DMA_IRQHandler(&hdma_crc); }
@@ -0,0 +1,682 @@
+/**
+ ******************************************************************************
+ * @file    dac_loopback.c
+ * @brief   Implementation of the DAC loopback self-test
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "dac_loopback.h"
+#include "adc_channels.h"
+#include "adc_conversions.h"
+#include "adc_sections.h"
+#include "clock_profile.h"
+#include "dsp_quality.h"
+#include "timebase.h"
+#include <math.h>
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define DAC_LOOP_MID_CODE ((DAC_LOOP_LOW_CODE + DAC_LOOP_HIGH_CODE) / 2U)
+#define DAC_LOOP_TICKS_PER_MS (TIMEBASE_TICK_HZ / 1000U)
+#define DAC_LOOP_PHASE_STEP 7919U // ticks the step phase walks per step
+#define DAC_LOOP_TONE_TIMEOUT_MS 1000U // on top of the frames it needs
+#define DAC_LOOP_SWEEP_POINTS                                                \
+  ((DAC_LOOP_SWEEP_LAST_CODE - DAC_LOOP_SWEEP_FIRST_CODE) /                  \
+       DAC_LOOP_SWEEP_STEP +                                                 \
+   1U)
+
+_Static_assert(DAC_LOOP_LOW_CODE < DAC_LOOP_HIGH_CODE &&
+                   DAC_LOOP_HIGH_CODE <= 4095U,
+               "step levels must be increasing 12-bit codes");
+_Static_assert(DAC_LOOP_TONE_AMPLITUDE < 2048U, "tone exceeds the DAC range");
+_Static_assert(DAC_LOOP_SWEEP_STEP >= 1U &&
+                   DAC_LOOP_SWEEP_FIRST_CODE < DAC_LOOP_SWEEP_LAST_CODE &&
+                   DAC_LOOP_SWEEP_LAST_CODE <= 4095U,
+               "sweep codes must be increasing 12-bit codes");
+_Static_assert(DAC_LOOP_SWEEP_POINTS <= DAC_LOOP_TONE_FRAMES,
+               "the sweep means share the tone frames");
+
+/* Private types -------------------------------------------------------------*/
+typedef enum {
+  DAC_LOOP_IDLE = 0,
+  DAC_LOOP_HOLD, // level held until the next step is due
+  DAC_LOOP_STEP, // step written, waiting for the block path to see it
+  DAC_LOOP_TONE, // tone running, frames collected by the block path
+  DAC_LOOP_SWEEP // sweep running, points taken by the block path
+} DacLoop_State_t;
+
+/* Private variables ---------------------------------------------------------*/
+static DAC_HandleTypeDef hdac;
+static DMA_HandleTypeDef hdma_dac;
+static TIM_HandleTypeDef htim_dac;
+
+// ADC input of every channel: the test channel must be IN4 of ADC1/2
+#define DAC_LOOP_CHANNEL_PIN(name, channel, ohms, bits, adcs, slot)          \
+  (((channel) == ADC_CHANNEL_4 && ((adcs) & ADC_CHANNELS_ADC12) != 0U) ? 1U  \
+                                                                       : 0U),
+static const uint8_t on_pa4[ADC_CONVERSIONS_CHANNEL_COUNT] = {
+    ADC_CHANNELS_TABLE(DAC_LOOP_CHANNEL_PIN)};
+
+static uint16_t tone_table[DAC_LOOP_TONE_POINTS]
+    ADC_SRAM1_BSS ADC_DMA_ALIGNED;
+static uint16_t tone_frames[DAC_LOOP_TONE_FRAMES]; // or the sweep means
+
+static uint8_t initialised = 0;
+static DacLoop_Config_t config;
+static DacLoop_State_t state = DAC_LOOP_IDLE;
+static uint8_t slot = 0;            // frame position of the test channel
+static uint32_t step_index = 0;
+static uint64_t next_step = 0;      // timebase tick of the next step
+static uint64_t tone_start = 0;
+static uint64_t step_timeout = 0;   // ticks
+static uint64_t tone_timeout = 0;
+static uint64_t sweep_start = 0;
+static uint64_t sweep_timeout = 0;
+static uint64_t tick_sum[2];        // sample, react
+static double tone_ratio = 0.0;     // tone cycles per frame
+
+// Shared with the block path
+static volatile uint8_t step_pending = 0;
+static volatile uint8_t step_done = 0;
+static volatile uint8_t step_rising = 0;
+static volatile uint64_t step_time = 0;
+static volatile uint32_t step_sample = 0; // ticks, step -> frame
+static volatile uint32_t step_react = 0;  // ticks, frame -> pin
+static volatile uint8_t tone_active = 0;
+static volatile uint8_t tone_done = 0;
+static uint32_t tone_skip = 0;
+static uint32_t tone_count = 0;
+static uint32_t tone_next_frame = 0;
+static volatile uint8_t sweep_active = 0;
+static volatile uint8_t sweep_done = 0;
+static volatile uint32_t sweep_count = 0;
+static uint64_t sweep_write = 0; // tick of the last DAC write
+static uint64_t sweep_settle = 0; // ticks
+
+static DacLoop_Result_t result;
+static uint8_t have_result = 0;
+static uint8_t have_sweep = 0;
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+ * @brief Input clock of TIM6 (APB1 timers run at 2x PCLK1 when APB1 is divided)
+ */
+static uint32_t dacLoop_timerClockHz(void) {
+  uint32_t clk = HAL_RCC_GetPCLK1Freq();
+  if ((RCC->CFGR & RCC_CFGR_PPRE1) != RCC_HCLK_DIV1) {
+    clk *= 2U;
+  }
+  return clk;
+}
+
+/**
+ * @brief DAC channel 1, software-written levels or TIM6-paced DMA
+ */
+static HAL_StatusTypeDef dacLoop_configChannel(uint8_t paced) {
+  DAC_ChannelConfTypeDef ch = {0};
+  ch.DAC_Trigger = paced ? DAC_TRIGGER_T6_TRGO : DAC_TRIGGER_NONE;
+  ch.DAC_OutputBuffer = DAC_OUTPUTBUFFER_ENABLE;
+  return HAL_DAC_ConfigChannel(&hdac, &ch, DAC_CHANNEL_1);
+}
+
+/**
+ * @brief DAC off: PA4 is an ADC input again
+ */
+static void dacLoop_release(void) {
+  tone_active = 0;
+  step_pending = 0;
+  sweep_active = 0;
+  HAL_TIM_Base_Stop(&htim_dac);
+  (void)HAL_DAC_Stop_DMA(&hdac, DAC_CHANNEL_1);
+  (void)HAL_DAC_Stop(&hdac, DAC_CHANNEL_1);
+  state = DAC_LOOP_IDLE;
+}
+
+/**
+ * @brief Hold a level, then step to the other one at a phase that walks
+ *        across the frame period from step to step
+ */
+static void dacLoop_scheduleStep(uint64_t now, uint32_t frame_ticks) {
+  next_step = now + (uint64_t)DAC_LOOP_HOLD_MS * DAC_LOOP_TICKS_PER_MS +
+              (step_index * DAC_LOOP_PHASE_STEP) % frame_ticks;
+  state = DAC_LOOP_HOLD;
+}
+
+/**
+ * @brief Frame period in timebase ticks, at least 1
+ */
+static uint32_t dacLoop_frameTicks(void) {
+  const uint32_t rate = analogSensor_getSampleRate();
+  const uint32_t ticks = (rate != 0U) ? TIMEBASE_TICK_HZ / rate : 1U;
+  return (ticks != 0U) ? ticks : 1U;
+}
+
+/**
+ * @brief Record one seen (or missed) step
+ */
+static void dacLoop_accountStep(uint8_t seen) {
+  if (!seen) {
+    result.missed++;
+    return;
+  }
+  const uint32_t s = (uint32_t)timebase_toMicros(step_sample);
+  const uint32_t r = (uint32_t)timebase_toMicros(step_react);
+  if (result.steps == 0U || s < result.sample_min_us) {
+    result.sample_min_us = s;
+  }
+  if (s > result.sample_max_us) {
+    result.sample_max_us = s;
+  }
+  if (result.steps == 0U || r < result.react_min_us) {
+    result.react_min_us = r;
+  }
+  if (r > result.react_max_us) {
+    result.react_max_us = r;
+  }
+  if (s + r > result.total_max_us) {
+    result.total_max_us = s + r;
+  }
+  tick_sum[0] += step_sample;
+  tick_sum[1] += step_react;
+  result.steps++;
+}
+
+/**
+ * @brief Start the TIM6-paced sine, about frame rate / DAC_LOOP_TONE_DIVISOR
+ */
+static HAL_StatusTypeDef dacLoop_startTone(void) {
+  // TIM2 and TIM6 share the APB1 timer clock: the ratio is their dividers
+  const uint64_t frame_ticks = (uint64_t)(TIM2->PSC + 1U) * (TIM2->ARR + 1U);
+  uint64_t update_ticks =
+      frame_ticks * DAC_LOOP_TONE_DIVISOR / DAC_LOOP_TONE_POINTS;
+  if (update_ticks < 2U) {
+    return HAL_ERROR;
+  }
+  const uint32_t psc = (uint32_t)((update_ticks - 1U) / 65536U);
+  const uint32_t arr = (uint32_t)(update_ticks / (psc + 1U)) - 1U;
+  update_ticks = (uint64_t)(psc + 1U) * (arr + 1U);
+  tone_ratio = (double)frame_ticks /
+               ((double)update_ticks * (double)DAC_LOOP_TONE_POINTS);
+
+  htim_dac.Init.Prescaler = psc;
+  htim_dac.Init.Period = arr;
+  if (HAL_TIM_Base_Init(&htim_dac) != HAL_OK ||
+      HAL_DAC_Stop(&hdac, DAC_CHANNEL_1) != HAL_OK ||
+      dacLoop_configChannel(1) != HAL_OK ||
+      HAL_DAC_Start_DMA(&hdac, DAC_CHANNEL_1, (uint32_t *)tone_table,
+                        DAC_LOOP_TONE_POINTS, DAC_ALIGN_12B_R) != HAL_OK) {
+    return HAL_ERROR;
+  }
+  result.tone_mhz = (uint32_t)((double)dacLoop_timerClockHz() * 1000.0 /
+                               ((double)update_ticks * DAC_LOOP_TONE_POINTS));
+  tone_skip = DAC_LOOP_SETTLE_BLOCKS;
+  tone_count = 0;
+  tone_done = 0;
+  tone_active = 1;
+  tone_start = timebase_now();
+  state = DAC_LOOP_TONE;
+  return HAL_TIM_Base_Start(&htim_dac);
+}
+
+/**
+ * @brief Three-parameter sine fit at the known ratio; residual -> SINAD
+ */
+static void dacLoop_fitTone(void) {
+  const double w = 2.0 * 3.14159265358979323846 * tone_ratio;
+  const double cw = cos(w);
+  const double sw = sin(w);
+  double scc = 0.0, sss = 0.0, scs = 0.0, sc = 0.0, ss = 0.0;
+  double sxc = 0.0, sxs = 0.0, sx = 0.0;
+  double c = 1.0, s = 0.0;
+  const double n = (double)DAC_LOOP_TONE_FRAMES;
+
+  // cos/sin by rotation: double keeps the phase error far below a code
+  for (uint32_t i = 0; i < DAC_LOOP_TONE_FRAMES; i++) {
+    const double x = (double)tone_frames[i];
+    scc += c * c;
+    sss += s * s;
+    scs += c * s;
+    sc += c;
+    ss += s;
+    sxc += x * c;
+    sxs += x * s;
+    sx += x;
+    const double t = c * cw - s * sw;
+    s = s * cw + c * sw;
+    c = t;
+  }
+
+  // [scc scs sc; scs sss ss; sc ss n] [a b k]' = [sxc sxs sx]'
+  const double m00 = sss * n - ss * ss;
+  const double m01 = scs * n - ss * sc;
+  const double m02 = scs * ss - sss * sc;
+  const double det = scc * m00 - scs * m01 + sc * m02;
+  if (fabs(det) < 1e-9) {
+    return;
+  }
+  const double a = (sxc * m00 - scs * (sxs * n - ss * sx) +
+                    sc * (sxs * ss - sss * sx)) / det;
+  const double b = (scc * (sxs * n - ss * sx) - sxc * m01 +
+                    sc * (scs * sx - sxs * sc)) / det;
+  const double k = (scc * (sss * sx - ss * sxs) -
+                    scs * (scs * sx - sc * sxs) + sxc * m02) / det;
+
+  double residual = 0.0;
+  c = 1.0;
+  s = 0.0;
+  for (uint32_t i = 0; i < DAC_LOOP_TONE_FRAMES; i++) {
+    const double e = (double)tone_frames[i] - (a * c + b * s + k);
+    residual += e * e;
+    const double t = c * cw - s * sw;
+    s = s * cw + c * sw;
+    c = t;
+  }
+  const double amplitude = sqrt(a * a + b * b);
+  const double rms = sqrt(residual / n);
+  if (rms <= 0.0 || amplitude <= 0.0) {
+    return;
+  }
+  const double sinad = 20.0 * log10(amplitude / (sqrt(2.0) * rms));
+  result.amplitude = (uint32_t)(amplitude + 0.5);
+  result.sinad_centi_db = (int32_t)lround(sinad * 100.0);
+  result.enob_centi = (int32_t)lround((sinad - 1.76) / 6.02 * 100.0);
+  result.ok = (result.missed == 0U) ? 1U : 0U;
+}
+
+/**
+ * @brief FFT figures of the tone frames; a failure clears ok
+ */
+static void dacLoop_analyseTone(void) {
+  DSP_QualityResult_t q;
+  if (dspQuality_analyse(tone_frames, DAC_LOOP_TONE_FRAMES, &q) != HAL_OK) {
+    result.ok = 0;
+    return;
+  }
+  result.snr_centi_db = (int32_t)lroundf(q.snr_db * 100.0f);
+  result.thd_centi_db = (int32_t)lroundf(q.thd_db * 100.0f);
+  result.sfdr_centi_db = (int32_t)lroundf(q.sfdr_db * 100.0f);
+  result.fft_enob_centi = (int32_t)lroundf(q.enob * 100.0f);
+}
+
+/**
+ * @brief Close the run: timing, averages, fit
+ */
+static void dacLoop_finish(uint8_t tone_ok) {
+  dacLoop_release();
+  ADC_TimingInfo_t timing;
+  if (analogSensor_getTiming(&timing) == HAL_OK) {
+    result.rate_mhz = timing.measured_mhz;
+  }
+  if (result.steps != 0U) {
+    result.sample_mean_us =
+        (uint32_t)timebase_toMicros(tick_sum[0] / result.steps);
+    result.react_mean_us =
+        (uint32_t)timebase_toMicros(tick_sum[1] / result.steps);
+  }
+  if (tone_ok) {
+    dacLoop_fitTone();
+    dacLoop_analyseTone();
+  }
+  if (result.sweep) {
+    result.points = sweep_count;
+    result.ok = (sweep_count == DAC_LOOP_SWEEP_POINTS) ? 1U : 0U;
+    have_sweep = result.ok;
+  }
+  have_result = 1;
+}
+
+/**
+ * @brief Checks shared by every run, the test channel's slot, and the
+ *        result cleared for it
+ */
+static HAL_StatusTypeDef dacLoop_begin(void) {
+  if (!initialised || analogSensor_getMode() != ADC_ACQ_MODE_DMA_TIMER ||
+      analogSensor_getScanTrigger() != ADC_SCAN_TRIGGER_TIM2) {
+    return HAL_ERROR;
+  }
+  if (state != DAC_LOOP_IDLE) {
+    return HAL_BUSY;
+  }
+  const uint8_t *map = analogSensor_getBlockChannelMap();
+  slot = 0;
+  while (slot < ADC_CONVERSIONS_CHANNEL_COUNT && map[slot] != config.channel) {
+    slot++;
+  }
+  if (slot == ADC_CONVERSIONS_CHANNEL_COUNT) {
+    return HAL_ERROR;
+  }
+
+  memset(&result, 0, sizeof(result));
+  tick_sum[0] = 0;
+  tick_sum[1] = 0;
+  have_result = 0;
+  have_sweep = 0;
+  const ClockProfile_Info_t *profile = clockProfile_getActive();
+  result.adcclk_hz = profile->adcclk_hz;
+  result.sampling_cycles =
+      analogSensor_getSamplingCycles(config.channel, profile->adc_prescaler);
+  return HAL_OK;
+}
+
+/**
+ * @brief One sweep point from a block: the mean of the frames converted
+ *        after the DAC settled, then the next code
+ */
+static void dacLoop_sweepBlock(const uint16_t *block, uint32_t frame_count,
+                               const ADC_BlockInfo_t *info) {
+  // Frame times rise through the block: skip up to the first settled one
+  const uint64_t ready = sweep_write + sweep_settle;
+  uint32_t f = 0;
+  while (f < frame_count &&
+         analogSensor_getFrameTime(info->first_frame + f) < ready) {
+    f++;
+  }
+  if (2U * (frame_count - f) < frame_count) {
+    return; // written late in the block: keep the code for the next one
+  }
+  uint32_t sum = 0;
+  for (uint32_t i = f; i < frame_count; i++) {
+    sum += block[i * ADC_CONVERSIONS_CHANNEL_COUNT + slot];
+  }
+  const uint32_t n = frame_count - f;
+  tone_frames[sweep_count] = (uint16_t)((sum * 16U + n / 2U) / n);
+  if (++sweep_count == DAC_LOOP_SWEEP_POINTS) {
+    sweep_active = 0;
+    sweep_done = 1;
+    return;
+  }
+  HAL_DAC_SetValue(&hdac, DAC_CHANNEL_1, DAC_ALIGN_12B_R,
+                   DAC_LOOP_SWEEP_FIRST_CODE +
+                       sweep_count * DAC_LOOP_SWEEP_STEP);
+  sweep_write = timebase_now();
+}
+
+/* Public functions ----------------------------------------------------------*/
+
+HAL_StatusTypeDef dacLoop_init(const DacLoop_Config_t *cfg) {
+  if (cfg == NULL || cfg->channel >= ADC_CONVERSIONS_CHANNEL_COUNT ||
+      !on_pa4[cfg->channel] || cfg->port == NULL || cfg->pin == 0U ||
+      (cfg->pin & (cfg->pin - 1U)) != 0U) {
+    return HAL_ERROR;
+  }
+  config = *cfg;
+  initialised = 0;
+
+  GPIO_InitTypeDef gpio = {.Pin = cfg->pin,
+                           .Mode = GPIO_MODE_OUTPUT_PP,
+                           .Pull = GPIO_NOPULL,
+                           .Speed = GPIO_SPEED_FREQ_VERY_HIGH};
+  HAL_GPIO_WritePin(cfg->port, cfg->pin, GPIO_PIN_RESET);
+  HAL_GPIO_Init(cfg->port, &gpio);
+
+  // Sine around mid-scale; the DMA reads it through the bus matrix
+  for (uint32_t i = 0; i < DAC_LOOP_TONE_POINTS; i++) {
+    const float phase = 6.28318531f * (float)i / (float)DAC_LOOP_TONE_POINTS;
+    tone_table[i] = (uint16_t)lroundf(2048.0f + (float)DAC_LOOP_TONE_AMPLITUDE *
+                                                    sinf(phase));
+  }
+  SCB_CleanDCache_by_Addr((uint32_t *)tone_table, sizeof(tone_table));
+
+  __HAL_RCC_TIM6_CLK_ENABLE();
+  htim_dac.Instance = TIM6;
+  htim_dac.Init.CounterMode = TIM_COUNTERMODE_UP;
+  htim_dac.Init.Prescaler = 0;
+  htim_dac.Init.Period = 0xFFFFU;
+  htim_dac.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_DISABLE;
+  TIM_MasterConfigTypeDef master = {.MasterOutputTrigger = TIM_TRGO_UPDATE,
+                                    .MasterSlaveMode =
+                                        TIM_MASTERSLAVEMODE_DISABLE};
+  hdac.Instance = DAC;
+  if (HAL_TIM_Base_Init(&htim_dac) != HAL_OK ||
+      HAL_TIMEx_MasterConfigSynchronization(&htim_dac, &master) != HAL_OK ||
+      HAL_DAC_Init(&hdac) != HAL_OK || dacLoop_configChannel(0) != HAL_OK) {
+    return HAL_ERROR;
+  }
+  initialised = 1;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef dacLoop_start(void) {
+  const HAL_StatusTypeDef status = dacLoop_begin();
+  if (status != HAL_OK) {
+    return status;
+  }
+
+  // A step shows up within two blocks; the tone needs its frames
+  const uint64_t frame_ticks = dacLoop_frameTicks();
+  step_timeout = (uint64_t)DAC_LOOP_STEP_TIMEOUT_MS * DAC_LOOP_TICKS_PER_MS;
+  if (step_timeout < 3U * ADC_CONVERSIONS_BLOCK_FRAMES * frame_ticks) {
+    step_timeout = 3U * ADC_CONVERSIONS_BLOCK_FRAMES * frame_ticks;
+  }
+  tone_timeout =
+      (uint64_t)DAC_LOOP_TONE_TIMEOUT_MS * DAC_LOOP_TICKS_PER_MS +
+      (DAC_LOOP_TONE_FRAMES +
+       (DAC_LOOP_SETTLE_BLOCKS + 1U) * ADC_CONVERSIONS_BLOCK_FRAMES) *
+          frame_ticks;
+
+  // Low level first, held once before the first step
+  step_index = 0;
+  step_rising = 0;
+  HAL_GPIO_WritePin(config.port, config.pin, GPIO_PIN_RESET);
+  if (dacLoop_configChannel(0) != HAL_OK ||
+      HAL_DAC_SetValue(&hdac, DAC_CHANNEL_1, DAC_ALIGN_12B_R,
+                       DAC_LOOP_LOW_CODE) != HAL_OK ||
+      HAL_DAC_Start(&hdac, DAC_CHANNEL_1) != HAL_OK) {
+    dacLoop_release();
+    return HAL_ERROR;
+  }
+  dacLoop_scheduleStep(timebase_now(), (uint32_t)frame_ticks);
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef dacLoop_startSweep(void) {
+  const HAL_StatusTypeDef status = dacLoop_begin();
+  if (status != HAL_OK) {
+    return status;
+  }
+  result.sweep = 1;
+
+  // A point a block, four blocks of slack each for late or held points
+  const uint64_t block_ticks =
+      (uint64_t)ADC_CONVERSIONS_BLOCK_FRAMES * dacLoop_frameTicks();
+  sweep_timeout = (uint64_t)DAC_LOOP_TONE_TIMEOUT_MS * DAC_LOOP_TICKS_PER_MS +
+                  4U * DAC_LOOP_SWEEP_POINTS * block_ticks;
+  sweep_settle = (uint64_t)DAC_LOOP_SWEEP_SETTLE_US * TIMEBASE_TICK_HZ /
+                 1000000U;
+  sweep_count = 0;
+  sweep_done = 0;
+  if (dacLoop_configChannel(0) != HAL_OK ||
+      HAL_DAC_SetValue(&hdac, DAC_CHANNEL_1, DAC_ALIGN_12B_R,
+                       DAC_LOOP_SWEEP_FIRST_CODE) != HAL_OK ||
+      HAL_DAC_Start(&hdac, DAC_CHANNEL_1) != HAL_OK) {
+    dacLoop_release();
+    return HAL_ERROR;
+  }
+  sweep_start = timebase_now();
+  sweep_write = sweep_start;
+  state = DAC_LOOP_SWEEP;
+  sweep_active = 1;
+  return HAL_OK;
+}
+
+void dacLoop_stop(void) {
+  if (state != DAC_LOOP_IDLE) {
+    dacLoop_release();
+  }
+}
+
+uint8_t dacLoop_isRunning(void) { return (state != DAC_LOOP_IDLE) ? 1U : 0U; }
+
+ADC_FAST_CODE void dacLoop_processBlock(const uint16_t *block,
+                                        uint32_t frame_count) {
+  if (!step_pending && !tone_active && !sweep_active) {
+    return;
+  }
+  ADC_BlockInfo_t info;
+  if (analogSensor_getBlockInfo(&info) != HAL_OK) {
+    return;
+  }
+  if (sweep_active) {
+    dacLoop_sweepBlock(block, frame_count, &info);
+    return;
+  }
+
+  if (step_pending) {
+    for (uint32_t f = 0; f < frame_count; f++) {
+      const uint16_t v = block[f * ADC_CONVERSIONS_CHANNEL_COUNT + slot];
+      if (step_rising ? (v < DAC_LOOP_MID_CODE) : (v >= DAC_LOOP_MID_CODE)) {
+        continue;
+      }
+      // Reaction first, then the bookkeeping
+      config.port->BSRR = step_rising ? config.pin
+                                      : (uint32_t)config.pin << 16;
+      const uint64_t react = timebase_now();
+      const uint64_t sampled = analogSensor_getFrameTime(info.first_frame + f);
+      const uint64_t t0 = step_time;
+      step_sample = (sampled > t0) ? (uint32_t)(sampled - t0) : 0U;
+      step_react = (react > sampled) ? (uint32_t)(react - sampled) : 0U;
+      step_pending = 0;
+      step_done = 1;
+      break;
+    }
+    return;
+  }
+
+  if (tone_skip != 0U) {
+    tone_skip--;
+    tone_next_frame = info.first_frame + frame_count;
+    return;
+  }
+  if (info.first_frame != tone_next_frame) {
+    tone_count = 0; // dropped block: the fit needs consecutive frames
+  }
+  tone_next_frame = info.first_frame + frame_count;
+  for (uint32_t f = 0; f < frame_count && tone_count < DAC_LOOP_TONE_FRAMES;
+       f++) {
+    tone_frames[tone_count++] = block[f * ADC_CONVERSIONS_CHANNEL_COUNT + slot];
+  }
+  if (tone_count == DAC_LOOP_TONE_FRAMES) {
+    tone_active = 0;
+    tone_done = 1;
+  }
+}
+
+HAL_StatusTypeDef dacLoop_poll(void) {
+  const uint64_t now = timebase_now();
+
+  switch (state) {
+  case DAC_LOOP_HOLD:
+    if (now < next_step) {
+      break;
+    }
+    if (step_index == DAC_LOOP_STEPS) {
+      if (dacLoop_startTone() != HAL_OK) {
+        dacLoop_finish(0);
+        return HAL_OK;
+      }
+      break;
+    }
+    {
+      const uint32_t primask = __get_PRIMASK();
+      __disable_irq();
+      step_rising = !step_rising;
+      step_done = 0;
+      step_time = timebase_now();
+      HAL_DAC_SetValue(&hdac, DAC_CHANNEL_1, DAC_ALIGN_12B_R,
+                       step_rising ? DAC_LOOP_HIGH_CODE : DAC_LOOP_LOW_CODE);
+      step_pending = 1;
+      __set_PRIMASK(primask);
+    }
+    state = DAC_LOOP_STEP;
+    break;
+
+  case DAC_LOOP_STEP:
+    if (step_done) {
+      dacLoop_accountStep(1);
+    } else if (now - step_time >= step_timeout) {
+      step_pending = 0;
+      dacLoop_accountStep(0);
+    } else {
+      break;
+    }
+    step_index++;
+    dacLoop_scheduleStep(now, dacLoop_frameTicks());
+    break;
+
+  case DAC_LOOP_TONE:
+    if (tone_done) {
+      dacLoop_finish(1);
+      return HAL_OK;
+    }
+    if (now - tone_start >= tone_timeout) {
+      dacLoop_finish(0);
+      return HAL_OK;
+    }
+    break;
+
+  case DAC_LOOP_SWEEP:
+    if (sweep_done || now - sweep_start >= sweep_timeout) {
+      dacLoop_finish(0);
+      return HAL_OK;
+    }
+    break;
+
+  default:
+    break;
+  }
+  return HAL_BUSY;
+}
+
+HAL_StatusTypeDef dacLoop_getResult(DacLoop_Result_t *out) {
+  if (out == NULL || !have_result) {
+    return HAL_ERROR;
+  }
+  *out = result;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef dacLoop_getSweep(DacLoop_Sweep_t *out) {
+  if (out == NULL || !have_sweep) {
+    return HAL_ERROR;
+  }
+  *out = (DacLoop_Sweep_t){.mean_x16 = tone_frames,
+                           .first = DAC_LOOP_SWEEP_FIRST_CODE,
+                           .step = DAC_LOOP_SWEEP_STEP,
+                           .points = DAC_LOOP_SWEEP_POINTS,
+                           .slot = slot};
+  return HAL_OK;
+}
+
+/* MSP -----------------------------------------------------------------------*/
+
+void HAL_DAC_MspInit(DAC_HandleTypeDef *dac) {
+  if (dac->Instance != DAC) {
+    return;
+  }
+  __HAL_RCC_DAC_CLK_ENABLE();
+  __HAL_RCC_DMA1_CLK_ENABLE();
+  __HAL_RCC_GPIOA_CLK_ENABLE();
+
+  // PA4 stays analog: the ADC input and DAC_OUT1 share it
+  GPIO_InitTypeDef gpio = {.Pin = GPIO_PIN_4, .Mode = GPIO_MODE_ANALOG,
+                           .Pull = GPIO_NOPULL};
+  HAL_GPIO_Init(GPIOA, &gpio);
+
+  // Circular table read; no interrupt, the stop aborts it
+  hdma_dac.Instance = DMA1_Stream5;
+  hdma_dac.Init.Channel = DMA_CHANNEL_7;
+  hdma_dac.Init.Direction = DMA_MEMORY_TO_PERIPH;
+  hdma_dac.Init.PeriphInc = DMA_PINC_DISABLE;
+  hdma_dac.Init.MemInc = DMA_MINC_ENABLE;
+  hdma_dac.Init.PeriphDataAlignment = DMA_PDATAALIGN_HALFWORD;
+  hdma_dac.Init.MemDataAlignment = DMA_MDATAALIGN_HALFWORD;
+  hdma_dac.Init.Mode = DMA_CIRCULAR;
+  hdma_dac.Init.Priority = DMA_PRIORITY_LOW;
+  hdma_dac.Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+  if (HAL_DMA_Init(&hdma_dac) == HAL_OK) {
+    __HAL_LINKDMA(dac, DMA_Handle1, hdma_dac);
+  }
+}
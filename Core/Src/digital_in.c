@@ -0,0 +1,276 @@
+/**
+ ******************************************************************************
+ * @file    digital_in.c
+ * @brief   Implementation of the digital inputs sampled on the scan trigger
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "digital_in.h"
+#include "adc_conversions.h"
+#include "adc_sections.h"
+#include "timebase.h"
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define DIGITAL_IN_MASK (DIGITAL_IN_SAMPLES - 1U)
+#define DIGITAL_IN_QUEUE_MASK (DIGITAL_IN_EDGE_QUEUE - 1U)
+
+#if (DIGITAL_IN_SAMPLES & DIGITAL_IN_MASK) != 0U
+#error "DIGITAL_IN_SAMPLES must be a power of two"
+#endif
+
+#if (DIGITAL_IN_EDGE_QUEUE & DIGITAL_IN_QUEUE_MASK) != 0U
+#error "DIGITAL_IN_EDGE_QUEUE must be a power of two"
+#endif
+
+_Static_assert(DIGITAL_IN_SAMPLES >= 2U * ADC_CONVERSIONS_BLOCK_FRAMES,
+               "the port samples must span the block being read and another");
+_Static_assert((DIGITAL_IN_PINS & ~0xFFFFU) == 0U && DIGITAL_IN_PINS != 0U,
+               "DIGITAL_IN_PINS must be pins of the port");
+
+/* Private variables ---------------------------------------------------------*/
+
+/* In DTCM: written by DMA2 through the AHB slave port, never cached */
+static uint16_t samples[DIGITAL_IN_SAMPLES] ADC_FAST_BSS;
+
+static DMA_HandleTypeDef hdma_din;
+static uint8_t ready = 0;
+static uint32_t phase = 0;      // frame - buffer entry, modulo the buffer
+static uint32_t next_frame = 0; // frame the next block should start at
+static uint16_t last_levels = 0;
+static uint8_t have_last = 0;   // last_levels is the frame before next_frame
+
+static DigitalIn_Edge_t queue[DIGITAL_IN_EDGE_QUEUE];
+static volatile uint32_t queue_head = 0;
+static volatile uint32_t queue_tail = 0;
+
+static DigitalIn_Stats_t stats_ = {0};
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+ * @brief Input clock of TIM2, the scan trigger (APB1)
+ */
+static uint32_t digitalIn_scanClockHz(void) {
+  uint32_t clk = HAL_RCC_GetPCLK1Freq();
+  if ((RCC->CFGR & RCC_CFGR_PPRE1) != RCC_CFGR_PPRE1_DIV1) {
+    clk *= 2U;
+  }
+  return clk;
+}
+
+static void digitalIn_initPins(void) {
+  GPIO_InitTypeDef gpio = {.Pin = DIGITAL_IN_PINS,
+                           .Mode = GPIO_MODE_INPUT,
+                           .Pull = DIGITAL_IN_PULL,
+                           .Speed = GPIO_SPEED_FREQ_LOW};
+  DIGITAL_IN_CLK_ENABLE();
+  HAL_GPIO_Init(DIGITAL_IN_PORT, &gpio);
+}
+
+/**
+ * @brief TIM1 as a slave of TIM2: slowest count, so only a reset by TRGO
+ *        updates it (it would wrap on its own after some 20 s at 216 MHz)
+ */
+static void digitalIn_initTimer(void) {
+  __HAL_RCC_TIM1_CLK_ENABLE();
+  TIM1->CR1 = 0;
+  TIM1->SMCR = 0;
+  TIM1->DIER = 0;
+  TIM1->PSC = 0xFFFFU;
+  TIM1->ARR = 0xFFFFU;
+  TIM1->EGR = TIM_EGR_UG; // load PSC now, before the DMA request is on
+  TIM1->SR = 0;
+}
+
+static HAL_StatusTypeDef digitalIn_initDma(void) {
+  __HAL_RCC_DMA2_CLK_ENABLE();
+
+  // One IDR half-word per TIM1 update, round the buffer forever
+  hdma_din.Instance = DMA2_Stream5;
+  hdma_din.Init.Channel = DMA_CHANNEL_6;
+  hdma_din.Init.Direction = DMA_PERIPH_TO_MEMORY;
+  hdma_din.Init.PeriphInc = DMA_PINC_DISABLE;
+  hdma_din.Init.MemInc = DMA_MINC_ENABLE;
+  hdma_din.Init.PeriphDataAlignment = DMA_PDATAALIGN_HALFWORD;
+  hdma_din.Init.MemDataAlignment = DMA_MDATAALIGN_HALFWORD;
+  hdma_din.Init.Mode = DMA_CIRCULAR;
+  hdma_din.Init.Priority = DMA_PRIORITY_HIGH;
+  hdma_din.Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+  return HAL_DMA_Init(&hdma_din);
+}
+
+/**
+ * @brief Follow the DMA's position: exact while no trigger came after the
+ *        block, which the TIM2 count since the last update shows
+ *
+ * @return 1 when the phase was found or moved
+ */
+static uint8_t digitalIn_checkPhase(const ADC_BlockInfo_t *info) {
+  const uint32_t scan_clk = digitalIn_scanClockHz();
+
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  const uint64_t now = timebase_now();
+  const uint32_t since_update = TIM2->CNT * (TIM2->PSC + 1U);
+  const uint32_t ndtr = hdma_din.Instance->NDTR;
+  __set_PRIMASK(primask);
+
+  // Block stamped after the latest update: that update was the block's
+  // last scan, and the DMA's next entry belongs to the frame after it
+  const uint64_t elapsed =
+      (now - info->timestamp) * scan_clk / TIMEBASE_TICK_HZ;
+  if (elapsed > (uint64_t)since_update + scan_clk / TIMEBASE_TICK_HZ) {
+    return 0;
+  }
+  const uint32_t next = info->first_frame + info->frame_count;
+  const uint32_t position = (DIGITAL_IN_SAMPLES - ndtr) & DIGITAL_IN_MASK;
+  const uint32_t now_phase = (next - position) & DIGITAL_IN_MASK;
+  if (stats_.aligned && now_phase == phase) {
+    return 0;
+  }
+  stats_.realigned += stats_.aligned;
+  stats_.aligned = 1;
+  phase = now_phase;
+  return 1;
+}
+
+static void digitalIn_push(const DigitalIn_Edge_t *edge) {
+  const uint32_t head = queue_head;
+  if (head - queue_tail >= DIGITAL_IN_EDGE_QUEUE) {
+    stats_.dropped++;
+    return;
+  }
+  queue[head & DIGITAL_IN_QUEUE_MASK] = *edge;
+  __DMB();
+  queue_head = head + 1U;
+  stats_.edges++;
+}
+
+/* Public functions ----------------------------------------------------------*/
+
+HAL_StatusTypeDef digitalIn_init(void) {
+#if !DIGITAL_IN_ENABLE
+  return HAL_ERROR; // TIM1 and the stream may belong to the mux or the PWM
+#endif
+  digitalIn_initPins();
+  digitalIn_initTimer();
+  if (digitalIn_initDma() != HAL_OK) {
+    return HAL_ERROR;
+  }
+  ready = 1;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef digitalIn_start(void) {
+  if (!ready) {
+    return HAL_ERROR;
+  }
+  digitalIn_stop();
+
+  if (HAL_DMA_Start(&hdma_din, (uint32_t)(uintptr_t)&DIGITAL_IN_PORT->IDR,
+                    (uint32_t)(uintptr_t)samples,
+                    DIGITAL_IN_SAMPLES) != HAL_OK) {
+    return HAL_ERROR;
+  }
+  stats_.aligned = 0;
+  have_last = 0;
+
+  // Reset slave mode: every TIM2 TRGO becomes a TIM1 update, and a request
+  TIM1->CNT = 0;
+  TIM1->SR = 0;
+  TIM1->SMCR = TIM_TS_ITR1 | TIM_SLAVEMODE_RESET;
+  TIM1->DIER = TIM_DIER_UDE;
+  TIM1->CR1 |= TIM_CR1_CEN;
+  stats_.running = 1;
+  return HAL_OK;
+}
+
+void digitalIn_stop(void) {
+  if (!ready) {
+    return;
+  }
+  TIM1->SMCR = 0;
+  TIM1->DIER = 0;
+  TIM1->CR1 &= ~TIM_CR1_CEN;
+  (void)HAL_DMA_Abort(&hdma_din);
+  stats_.running = 0;
+  stats_.aligned = 0;
+}
+
+ADC_FAST_CODE void digitalIn_processBlock(uint32_t frame_count) {
+  ADC_BlockInfo_t info;
+
+  if (!stats_.running ||
+      analogSensor_getMode() != ADC_ACQ_MODE_DMA_TIMER ||
+      analogSensor_getBlockInfo(&info) != HAL_OK ||
+      info.frame_count != frame_count) {
+    have_last = 0;
+    return;
+  }
+  if (__HAL_DMA_GET_FLAG(&hdma_din,
+                         __HAL_DMA_GET_TE_FLAG_INDEX(&hdma_din))) {
+    __HAL_DMA_CLEAR_FLAG(&hdma_din, __HAL_DMA_GET_TE_FLAG_INDEX(&hdma_din));
+    stats_.dma_errors++;
+  }
+
+  // A new phase: this block's entries may predate the start or belong to
+  // the old one, so the next block starts from a fresh state record
+  const uint32_t next = info.first_frame + frame_count;
+  if (digitalIn_checkPhase(&info) || !stats_.aligned) {
+    have_last = 0;
+    next_frame = next;
+    return;
+  }
+  if (info.first_frame != next_frame) {
+    have_last = 0; // frames went missing between the blocks
+  }
+
+  // One load and compare per frame; only a change costs a record
+  for (uint32_t f = 0; f < frame_count; f++) {
+    const uint32_t frame = info.first_frame + f;
+    const uint16_t levels =
+        samples[(frame - phase) & DIGITAL_IN_MASK] & DIGITAL_IN_PINS;
+    if (!have_last || levels != last_levels) {
+      const DigitalIn_Edge_t edge = {
+          .frame = frame,
+          .time = analogSensor_getFrameTime(frame),
+          .levels = levels,
+          .changed = have_last ? (uint16_t)(levels ^ last_levels) : 0U};
+      digitalIn_push(&edge);
+    }
+    last_levels = levels;
+    have_last = 1;
+  }
+  stats_.frames += frame_count;
+  stats_.levels = last_levels;
+  next_frame = next;
+}
+
+HAL_StatusTypeDef digitalIn_popEdge(DigitalIn_Edge_t *edge) {
+  if (edge == NULL) {
+    return HAL_ERROR;
+  }
+  const uint32_t tail = queue_tail;
+  if (tail == queue_head) {
+    return HAL_BUSY;
+  }
+  __DMB();
+  *edge = queue[tail & DIGITAL_IN_QUEUE_MASK];
+  queue_tail = tail + 1U;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef digitalIn_getStats(DigitalIn_Stats_t *stats) {
+  if (stats == NULL) {
+    return HAL_ERROR;
+  }
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  *stats = stats_;
+  __set_PRIMASK(primask);
+  stats->pins = DIGITAL_IN_PINS;
+  return HAL_OK;
+}
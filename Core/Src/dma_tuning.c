@@ -0,0 +1,147 @@
+/**
+ ******************************************************************************
+ * @file    dma_tuning.c
+ * @brief   Implementation of the DMA stream FIFO and burst settings
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "dma_tuning.h"
+#include <stddef.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define DMA_TUNING_FIFO_BYTES 16U
+
+/* Private types -------------------------------------------------------------*/
+typedef struct {
+  const char *name;
+  uint8_t fifo_required; // peripheral flow control (SDMMC)
+  uint8_t burst_max;     // beats; 1 where transfer lengths are arbitrary
+} DmaTuning_StreamInfo_t;
+
+/* Private variables ---------------------------------------------------------*/
+static const DmaTuning_StreamInfo_t stream_info[DMA_TUNING_STREAM_COUNT] = {
+    [DMA_TUNING_ADC] = {"adc", 0U, 16U},
+    [DMA_TUNING_EXT_RX] = {"ext_rx", 0U, 16U},
+    [DMA_TUNING_SDMMC] = {"sdmmc", 1U, 16U},
+    [DMA_TUNING_UART_TX] = {"uart_tx", 0U, 1U}};
+
+static DmaTuning_Config_t settings[DMA_TUNING_STREAM_COUNT] = {
+    [DMA_TUNING_ADC] = {DMA_TUNING_ADC_FIFO, DMA_TUNING_ADC_THRESHOLD,
+                        DMA_TUNING_ADC_BURST},
+    [DMA_TUNING_EXT_RX] = {DMA_TUNING_EXT_RX_FIFO, DMA_TUNING_EXT_RX_THRESHOLD,
+                           DMA_TUNING_EXT_RX_BURST},
+    [DMA_TUNING_SDMMC] = {1U, DMA_TUNING_SDMMC_THRESHOLD,
+                          DMA_TUNING_SDMMC_BURST},
+    [DMA_TUNING_UART_TX] = {DMA_TUNING_UART_TX_FIFO,
+                            DMA_TUNING_UART_TX_THRESHOLD, 1U}};
+
+static const uint32_t thresholds[4] = {
+    DMA_FIFO_THRESHOLD_1QUARTERFULL, DMA_FIFO_THRESHOLD_HALFFULL,
+    DMA_FIFO_THRESHOLD_3QUARTERSFULL, DMA_FIFO_THRESHOLD_FULL};
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+ * @brief Bytes of one memory beat
+ */
+static uint32_t dmaTuning_beatBytes(uint32_t mem_align) {
+  if (mem_align == DMA_MDATAALIGN_WORD) {
+    return 4U;
+  }
+  return (mem_align == DMA_MDATAALIGN_HALFWORD) ? 2U : 1U;
+}
+
+/**
+ * @brief A burst fits when the threshold holds a whole number of them
+ */
+static uint8_t dmaTuning_fits(uint32_t beats, uint32_t beat_bytes,
+                              uint8_t threshold) {
+  const uint32_t level = threshold * (DMA_TUNING_FIFO_BYTES / 4U);
+  const uint32_t bytes = beats * beat_bytes;
+  return (uint8_t)(bytes <= level && (level % bytes) == 0U);
+}
+
+/* Public functions ----------------------------------------------------------*/
+
+HAL_StatusTypeDef dmaTuning_set(DmaTuning_Stream_t stream,
+                                const DmaTuning_Config_t *cfg) {
+  if (cfg == NULL || stream >= DMA_TUNING_STREAM_COUNT ||
+      cfg->fifo > 1U || cfg->threshold < 1U || cfg->threshold > 4U ||
+      (cfg->burst != 1U && cfg->burst != 4U && cfg->burst != 8U &&
+       cfg->burst != 16U)) {
+    return HAL_ERROR;
+  }
+  if (!cfg->fifo && stream_info[stream].fifo_required) {
+    return HAL_ERROR;
+  }
+  settings[stream] = *cfg;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef dmaTuning_get(DmaTuning_Stream_t stream,
+                                DmaTuning_Config_t *cfg) {
+  if (cfg == NULL || stream >= DMA_TUNING_STREAM_COUNT) {
+    return HAL_ERROR;
+  }
+  *cfg = settings[stream];
+  return HAL_OK;
+}
+
+void dmaTuning_apply(DmaTuning_Stream_t stream, DMA_InitTypeDef *init) {
+  if (init == NULL || stream >= DMA_TUNING_STREAM_COUNT) {
+    return;
+  }
+  const DmaTuning_Config_t *cfg = &settings[stream];
+  if (!cfg->fifo) {
+    init->FIFOMode = DMA_FIFOMODE_DISABLE;
+    return;
+  }
+  // Half-words need an even threshold, words a full FIFO
+  const uint32_t beat_bytes = dmaTuning_beatBytes(init->MemDataAlignment);
+  uint8_t threshold = cfg->threshold;
+  if (beat_bytes == 4U) {
+    threshold = 4U;
+  } else if (beat_bytes == 2U && (threshold & 1U) != 0U) {
+    threshold++;
+  }
+  init->FIFOMode = DMA_FIFOMODE_ENABLE;
+  init->FIFOThreshold = thresholds[threshold - 1U];
+
+  // Largest burst up to the setting that the threshold takes whole
+  uint32_t beats = (cfg->burst < stream_info[stream].burst_max)
+                       ? cfg->burst
+                       : stream_info[stream].burst_max;
+  while (beats > 1U && !dmaTuning_fits(beats, beat_bytes, threshold)) {
+    beats = (beats == 4U) ? 1U : beats / 2U;
+  }
+  init->MemBurst = (beats == 16U)  ? DMA_MBURST_INC16
+                   : (beats == 8U) ? DMA_MBURST_INC8
+                   : (beats == 4U) ? DMA_MBURST_INC4
+                                   : DMA_MBURST_SINGLE;
+}
+
+HAL_StatusTypeDef dmaTuning_reinit(DmaTuning_Stream_t stream,
+                                   DMA_HandleTypeDef *hdma) {
+  if (hdma == NULL || hdma->Instance == NULL ||
+      stream >= DMA_TUNING_STREAM_COUNT) {
+    return HAL_ERROR;
+  }
+  // A completion interrupt may start the next transfer: none in between
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  if (hdma->State != HAL_DMA_STATE_READY ||
+      (hdma->Instance->CR & DMA_SxCR_EN) != 0U) {
+    __set_PRIMASK(primask);
+    return HAL_BUSY;
+  }
+  dmaTuning_apply(stream, &hdma->Init);
+  const HAL_StatusTypeDef status = HAL_DMA_Init(hdma);
+  __set_PRIMASK(primask);
+  return status;
+}
+
+const char *dmaTuning_getName(DmaTuning_Stream_t stream) {
+  return (stream < DMA_TUNING_STREAM_COUNT) ? stream_info[stream].name : "?";
+}
@@ -0,0 +1,124 @@
+/**
+ ******************************************************************************
+ * @file    dsp_arrival.c
+ * @brief   Implementation of the impact time of arrival
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "dsp_arrival.h"
+#include <math.h>
+#include <string.h>
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+ * @brief Onset of one channel: the fractional frame where |x - mean|
+ *        crosses the threshold, or a negative value if it never does
+ */
+static float32_t dspArrival_onset(const ADC_Frame_t *frames,
+                                  uint32_t frame_count, uint32_t start,
+                                  uint8_t channel, float32_t mean,
+                                  float32_t threshold) {
+  const ADC_ChannelMask_t bit = (ADC_ChannelMask_t)(1U << channel);
+  float32_t prev = -1.0f; // no valid sample before yet
+  uint32_t prev_n = 0;
+  for (uint32_t n = start; n < frame_count; n++) {
+    if (frames[n].error_mask & bit) {
+      continue;
+    }
+    const float32_t d = fabsf((float32_t)frames[n].samples[channel] - mean);
+    if (d >= threshold) {
+      if (prev < 0.0f) {
+        return (float32_t)n;
+      }
+      // Linear between the last sample below and this one
+      return (float32_t)prev_n + (float32_t)(n - prev_n) *
+                                     (threshold - prev) / (d - prev);
+    }
+    prev = d;
+    prev_n = n;
+  }
+  return -1.0f;
+}
+
+/* Public functions ----------------------------------------------------------*/
+
+HAL_StatusTypeDef dspArrival_compute(const DSP_ArrivalConfig_t *cfg,
+                                     const ADC_Frame_t *frames,
+                                     uint32_t frame_count,
+                                     uint32_t baseline_frames,
+                                     DSP_ArrivalResult_t *res) {
+  if (cfg == NULL || frames == NULL || res == NULL ||
+      !(cfg->threshold_sigma > 0.0f) || baseline_frames < 2U ||
+      baseline_frames >= frame_count) {
+    return HAL_ERROR;
+  }
+  memset(res, 0, sizeof(*res));
+
+  for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+    const ADC_ChannelMask_t bit = (ADC_ChannelMask_t)(1U << ch);
+    if (!(cfg->mask & bit)) {
+      continue;
+    }
+    // Integer sums over at most a few thousand 12-bit codes are exact
+    uint32_t count = 0;
+    uint64_t sum = 0;
+    uint64_t sum_sq = 0;
+    for (uint32_t n = 0; n < baseline_frames; n++) {
+      if (frames[n].error_mask & bit) {
+        continue;
+      }
+      const uint32_t x = frames[n].samples[ch];
+      sum += x;
+      sum_sq += (uint64_t)x * x;
+      count++;
+    }
+    if (count < 2U) {
+      continue;
+    }
+    const float32_t mean = (float32_t)sum / (float32_t)count;
+    const float32_t var =
+        (float32_t)(sum_sq * count - sum * sum) /
+        ((float32_t)count * (float32_t)(count - 1U));
+    float32_t threshold = cfg->threshold_sigma * sqrtf(var);
+    if (threshold < (float32_t)cfg->min_threshold_codes) {
+      threshold = (float32_t)cfg->min_threshold_codes;
+    }
+    res->threshold_codes[ch] =
+        (threshold < 65535.0f) ? (uint16_t)lrintf(threshold) : UINT16_MAX;
+
+    const float32_t onset = dspArrival_onset(frames, frame_count,
+                                             baseline_frames, ch, mean,
+                                             threshold);
+    if (onset < 0.0f) {
+      continue;
+    }
+    res->onset_frame[ch] = onset;
+    if (res->detected == 0U || onset < res->first_frame) {
+      res->first_channel = ch;
+      res->first_frame = onset;
+    }
+    res->detected |= bit;
+  }
+  if (res->detected == 0U) {
+    return HAL_BUSY;
+  }
+
+  for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+    if (res->detected & (ADC_ChannelMask_t)(1U << ch)) {
+      res->delta_frames[ch] = res->onset_frame[ch] - res->first_frame;
+    }
+  }
+  return HAL_OK;
+}
+
+float32_t dspArrival_locateLine(float32_t delta_us, float32_t spacing_m,
+                                float32_t speed_m_s) {
+  const float32_t x = 0.5f * (spacing_m + speed_m_s * delta_us * 1.0e-6f);
+  if (!(x > 0.0f)) {
+    return 0.0f;
+  }
+  return (x > spacing_m) ? spacing_m : x;
+}
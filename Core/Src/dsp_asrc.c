@@ -0,0 +1,197 @@
+/**
+ ******************************************************************************
+ * @file    dsp_asrc.c
+ * @brief   Implementation of the Farrow sample-rate converter
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "dsp_asrc.h"
+#include "adc_sections.h"
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define DSP_ASRC_Q32 4294967296.0f     // 1.0 in 32.32
+#define DSP_ASRC_PPM_Q32 4294.967296f  // 1 ppm in 32.32
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+ * @brief pos per output at a clock error: D (1 + ppm 1e-6) in 32.32
+ */
+static uint64_t dspAsrc_baseStep(uint16_t decimation, float32_t ppm) {
+  const int64_t trim =
+      (int64_t)((float32_t)decimation * ppm * DSP_ASRC_PPM_Q32);
+  return ((uint64_t)decimation << 32) + (uint64_t)trim;
+}
+
+/**
+ * @brief Apply a pulse at a block boundary: pos and seq are the next output
+ */
+static void dspAsrc_anchor(DSP_Asrc_t *asrc, uint64_t pulse_q32,
+                           float32_t ppm, uint32_t period) {
+  if (ppm > DSP_ASRC_MAX_PPM) {
+    ppm = DSP_ASRC_MAX_PPM;
+  } else if (ppm < -DSP_ASRC_MAX_PPM) {
+    ppm = -DSP_ASRC_MAX_PPM;
+  }
+  const uint16_t d = asrc->decimation;
+  const uint64_t base = dspAsrc_baseStep(d, ppm);
+  asrc->stats.ppm = ppm;
+  asrc->step = base;
+  if (period == 0U) {
+    return; // rate only
+  }
+
+  // Nominal frame at the pulse, rounded to a multiple of period; e = pulse
+  // minus where the outputs up to it, taken at base, put that frame
+  const int64_t dp = (int64_t)(pulse_q32 - asrc->pos);
+  const int64_t ahead = dp / (int64_t)(base / d);
+  const uint32_t at = asrc->seq + (uint32_t)(int32_t)ahead;
+  const uint32_t nominal = (at + period / 2U) / period * period;
+  const int64_t frames = (int64_t)(int32_t)(nominal - asrc->seq);
+  const int64_t e = dp - frames * (int64_t)base / (int64_t)d;
+  asrc->stats.error = (float32_t)e / DSP_ASRC_Q32;
+  asrc->stats.anchors++;
+
+  if (!asrc->anchored || e > (int64_t)base || e < -(int64_t)base) {
+    // Renumber by whole outputs, move by the rest: no output cut or doubled
+    const int64_t half = (int64_t)(base / 2U);
+    const int64_t k = ((e >= 0) ? e + half : e - half) / (int64_t)base;
+    asrc->seq -= (uint32_t)(k * d);
+    asrc->pos += (uint64_t)(e - k * (int64_t)base);
+    asrc->anchored = 1;
+    asrc->stats.jumps++;
+  } else {
+    // Half of the error over the next pulse interval: e_next = e / 2
+    asrc->step = base + (uint64_t)(e * d / (2 * (int64_t)period));
+  }
+}
+
+/* Public functions ----------------------------------------------------------*/
+
+HAL_StatusTypeDef dspAsrc_init(DSP_Asrc_t *asrc) {
+  if (asrc == NULL) {
+    return HAL_ERROR;
+  }
+  memset(asrc, 0, sizeof(*asrc));
+  return HAL_OK;
+}
+
+void dspAsrc_steer(DSP_Asrc_t *asrc, uint64_t pulse_q32, float32_t ppm,
+                   uint32_t period) {
+  if (asrc == NULL) {
+    return;
+  }
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  asrc->pending_pos = pulse_q32;
+  asrc->pending_ppm = ppm;
+  asrc->pending_period = period;
+  asrc->pending = 1;
+  __set_PRIMASK(primask);
+}
+
+ADC_FAST_CODE uint32_t dspAsrc_plan(DSP_Asrc_t *asrc, uint32_t first,
+                                    uint32_t frames, uint16_t decimation,
+                                    DSP_AsrcTap_t *taps, uint32_t max,
+                                    uint32_t *seq) {
+  uint32_t n = 0;
+
+  if (asrc == NULL || taps == NULL || seq == NULL || decimation == 0U ||
+      frames < DSP_ASRC_HISTORY) {
+    return 0;
+  }
+  if (!asrc->started || decimation != asrc->decimation) {
+    // Plain decimation's lattice at nominal rate until a pulse steers it
+    asrc->stats.resets += asrc->started;
+    asrc->started = 1;
+    asrc->anchored = 0;
+    asrc->decimation = decimation;
+    asrc->seq = first + decimation - 1U;
+    asrc->pos = (uint64_t)asrc->seq << 32;
+    asrc->step = dspAsrc_baseStep(decimation, asrc->stats.ppm);
+  }
+  if (asrc->pending) {
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    const uint64_t pulse_q32 = asrc->pending_pos;
+    const float32_t ppm = asrc->pending_ppm;
+    const uint32_t period = asrc->pending_period;
+    asrc->pending = 0;
+    __set_PRIMASK(primask);
+    dspAsrc_anchor(asrc, pulse_q32, ppm, period);
+  }
+
+  // x0 from 1 - history (x-1 kept) up to frames - 3 (x2 in this block);
+  // the rest waits for the next block
+  const int32_t lowest = 1 - (int32_t)asrc->history_frames;
+  const int32_t highest = (int32_t)frames - 3;
+  while (1) {
+    const int32_t index = (int32_t)((uint32_t)(asrc->pos >> 32) - first);
+    if (index > highest) {
+      break;
+    }
+    if (index < lowest || n >= max) {
+      asrc->stats.skipped++; // behind the history (a jump back), or full
+    } else {
+      if (n == 0U) {
+        *seq = asrc->seq;
+      }
+      taps[n].index = (int16_t)index;
+      taps[n].mu = (float32_t)(uint32_t)asrc->pos * (1.0f / DSP_ASRC_Q32);
+      n++;
+    }
+    asrc->pos += asrc->step;
+    asrc->seq += decimation;
+  }
+  asrc->history_frames = DSP_ASRC_HISTORY;
+  asrc->stats.frames_in += frames;
+  asrc->stats.frames_out += n;
+  return n;
+}
+
+ADC_FAST_CODE void dspAsrc_interpolate(DSP_Asrc_t *asrc, uint8_t channel,
+                                       const float32_t *filtered,
+                                       uint32_t frames,
+                                       const DSP_AsrcTap_t *taps, uint32_t n,
+                                       float32_t *out, uint32_t stride) {
+  if (asrc == NULL || filtered == NULL || taps == NULL || out == NULL ||
+      channel >= ADC_CONVERSIONS_CHANNEL_COUNT ||
+      frames < DSP_ASRC_HISTORY) {
+    return;
+  }
+  float32_t *history = asrc->history[channel];
+
+  for (uint32_t k = 0; k < n; k++) {
+    // Oldest first: x-1, x0, x1, x2; negative frames from the history
+    float32_t x[4];
+    const int32_t base = taps[k].index - 1;
+    for (int32_t i = 0; i < 4; i++) {
+      const int32_t f = base + i;
+      x[i] = (f >= 0) ? filtered[f]
+                      : history[(int32_t)DSP_ASRC_HISTORY + f];
+    }
+    // Cubic Lagrange in Farrow form
+    const float32_t mu = taps[k].mu;
+    const float32_t c1 = x[2] - x[0] * (1.0f / 3.0f) - 0.5f * x[1] -
+                         x[3] * (1.0f / 6.0f);
+    const float32_t c2 = 0.5f * (x[0] + x[2]) - x[1];
+    const float32_t c3 = 0.5f * (x[1] - x[2]) + (x[3] - x[0]) * (1.0f / 6.0f);
+    *out = ((c3 * mu + c2) * mu + c1) * mu + x[1];
+    out += stride;
+  }
+
+  memcpy(history, &filtered[frames - DSP_ASRC_HISTORY],
+         DSP_ASRC_HISTORY * sizeof(float32_t));
+}
+
+HAL_StatusTypeDef dspAsrc_getStats(const DSP_Asrc_t *asrc,
+                                   DSP_Asrc_Stats_t *stats) {
+  if (asrc == NULL || stats == NULL) {
+    return HAL_ERROR;
+  }
+  *stats = asrc->stats;
+  return HAL_OK;
+}
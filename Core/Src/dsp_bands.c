@@ -0,0 +1,164 @@
+/**
+ ******************************************************************************
+ * @file    dsp_bands.c
+ * @brief   Implementation of the log-spaced band tables
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "dsp_bands.h"
+#include <math.h>
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define DSP_BANDS_LENGTH_MIN 16U
+#define DSP_BANDS_SLACK 1e-4 // Relative: a midband or edge on a limit is in
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+ * @brief First bin whose centre is at or above an edge, 1..nyquist + 1
+ */
+static int32_t dspBands_firstBin(float32_t edge_hz, float32_t bin_hz,
+                                 int32_t nyquist) {
+  const float32_t k = ceilf(edge_hz / bin_hz);
+  if (!(k >= 1.0f)) {
+    return 1;
+  }
+  if (k > (float32_t)(nyquist + 1)) {
+    return nyquist + 1;
+  }
+  return (int32_t)k;
+}
+
+/**
+ * @brief Edge x of a fractional table: 1000 x 10^(3 (2 x - 1) / (20 b)) Hz,
+ *        the lower edge of midband x
+ */
+static double dspBands_edge(int32_t x, uint8_t fraction) {
+  return 1000.0 * pow(10.0, 3.0 * (2.0 * (double)x - 1.0) /
+                                (20.0 * (double)fraction));
+}
+
+/**
+ * @brief Bins of every edge at the table's length and rate
+ */
+static void dspBands_bind(DSP_BandTable_t *tbl, uint16_t length,
+                          float32_t sample_rate_hz) {
+  const float32_t bin_hz = sample_rate_hz / (float32_t)length;
+  const int32_t nyquist = (int32_t)(length / 2U);
+  tbl->length = length;
+  tbl->sample_rate_hz = sample_rate_hz;
+  for (uint8_t e = 0; e <= tbl->count; e++) {
+    tbl->first_bin[e] =
+        (uint16_t)dspBands_firstBin(tbl->edge_hz[e], bin_hz, nyquist);
+  }
+}
+
+/* Public functions ----------------------------------------------------------*/
+
+HAL_StatusTypeDef dspBands_initFractional(DSP_BandTable_t *tbl,
+                                          uint8_t fraction, float32_t low_hz,
+                                          float32_t high_hz, uint16_t length,
+                                          float32_t sample_rate_hz) {
+  if (tbl == NULL ||
+      (fraction != DSP_BANDS_OCTAVE && fraction != DSP_BANDS_THIRD_OCTAVE) ||
+      !(low_hz > 0.0f) || !(high_hz >= low_hz) ||
+      length < DSP_BANDS_LENGTH_MIN || !(sample_rate_hz > 0.0f)) {
+    return HAL_ERROR;
+  }
+
+  // Midband index x: fm = 1000 x 10^(3 x / (10 b))
+  const double per_decade = 10.0 * (double)fraction / 3.0;
+  const int32_t x_lo = (int32_t)ceil(
+      per_decade * log10((double)low_hz / 1000.0) - DSP_BANDS_SLACK);
+  const int32_t x_hi = (int32_t)floor(
+      per_decade * log10((double)high_hz / 1000.0) + DSP_BANDS_SLACK);
+  const double nyquist_hz = (double)sample_rate_hz / 2.0;
+  const float32_t bin_hz = sample_rate_hz / (float32_t)length;
+  const int32_t nyquist = (int32_t)(length / 2U);
+
+  // Start above the last band without a bin, stop below Nyquist
+  int32_t first = x_lo;
+  int32_t last = x_lo - 1;
+  for (int32_t x = x_lo; x <= x_hi; x++) {
+    if (dspBands_edge(x + 1, fraction) > nyquist_hz * (1.0 + DSP_BANDS_SLACK)) {
+      break;
+    }
+    last = x;
+    const int32_t lo = dspBands_firstBin(
+        (float32_t)dspBands_edge(x, fraction), bin_hz, nyquist);
+    const int32_t hi = dspBands_firstBin(
+        (float32_t)dspBands_edge(x + 1, fraction), bin_hz, nyquist);
+    if (hi <= lo) {
+      first = x + 1;
+    }
+  }
+  if (last < first || last - first + 1 > (int32_t)DSP_BANDS_MAX) {
+    return HAL_ERROR;
+  }
+
+  memset(tbl, 0, sizeof(*tbl));
+  tbl->fraction = fraction;
+  tbl->count = (uint8_t)(last - first + 1);
+  for (uint8_t e = 0; e <= tbl->count; e++) {
+    tbl->edge_hz[e] = (float32_t)dspBands_edge(first + (int32_t)e, fraction);
+  }
+  dspBands_bind(tbl, length, sample_rate_hz);
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef dspBands_initEdges(DSP_BandTable_t *tbl,
+                                     const float32_t *edge_hz, uint8_t count,
+                                     uint16_t length,
+                                     float32_t sample_rate_hz) {
+  if (tbl == NULL || edge_hz == NULL || count == 0U ||
+      count > DSP_BANDS_MAX || length < DSP_BANDS_LENGTH_MIN ||
+      !(sample_rate_hz > 0.0f) || !(edge_hz[0] > 0.0f) ||
+      edge_hz[count] > sample_rate_hz / 2.0f) {
+    return HAL_ERROR;
+  }
+  for (uint8_t b = 0; b < count; b++) {
+    if (!(edge_hz[b + 1U] > edge_hz[b])) {
+      return HAL_ERROR;
+    }
+  }
+
+  memset(tbl, 0, sizeof(*tbl));
+  tbl->fraction = DSP_BANDS_CUSTOM;
+  tbl->count = count;
+  memcpy(tbl->edge_hz, edge_hz, (count + 1U) * sizeof(float32_t));
+  dspBands_bind(tbl, length, sample_rate_hz);
+  for (uint8_t b = 0; b < count; b++) {
+    if (tbl->first_bin[b + 1U] <= tbl->first_bin[b]) {
+      tbl->count = 0;
+      return HAL_ERROR;
+    }
+  }
+  return HAL_OK;
+}
+
+float32_t dspBands_centreHz(const DSP_BandTable_t *tbl, uint8_t band) {
+  if (tbl == NULL || band >= tbl->count) {
+    return 0.0f;
+  }
+  float32_t centre;
+  arm_sqrt_f32(tbl->edge_hz[band] * tbl->edge_hz[band + 1U], &centre);
+  return centre;
+}
+
+void dspBands_binRange(const DSP_BandTable_t *tbl, uint8_t band,
+                       uint16_t length, float32_t sample_rate_hz, int32_t *lo,
+                       int32_t *hi) {
+  if (length == tbl->length && sample_rate_hz == tbl->sample_rate_hz) {
+    *lo = tbl->first_bin[band];
+    *hi = (int32_t)tbl->first_bin[band + 1U] - 1;
+    return;
+  }
+  // Edges in Hz stay, the bins move with the rate
+  const float32_t bin_hz = sample_rate_hz / (float32_t)length;
+  const int32_t nyquist = (int32_t)(length / 2U);
+  *lo = dspBands_firstBin(tbl->edge_hz[band], bin_hz, nyquist);
+  *hi = dspBands_firstBin(tbl->edge_hz[band + 1U], bin_hz, nyquist) - 1;
+}
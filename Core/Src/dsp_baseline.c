@@ -0,0 +1,147 @@
+/**
+ ******************************************************************************
+ * @file    dsp_baseline.c
+ * @brief   Implementation of the learned spectral baseline
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "dsp_baseline.h"
+#include <math.h>
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define DSP_BASELINE_RMS_MIN 1e-3f // -60 dB re 1 code: a band with no energy
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+ * @brief Round and clamp a dB value to 0.01 dB in an int16
+ */
+static int16_t dspBaseline_centi(float32_t db) {
+  float32_t c = db * 100.0f;
+  if (c > 32767.0f) {
+    c = 32767.0f;
+  } else if (c < -32767.0f) {
+    c = -32767.0f;
+  }
+  return (int16_t)lrintf(c);
+}
+
+/* Public functions ----------------------------------------------------------*/
+
+void dspBaseline_reset(DSP_Baseline_t *bl, uint8_t fraction,
+                       uint8_t band_count) {
+  if (bl == NULL) {
+    return;
+  }
+  memset(bl, 0, sizeof(*bl));
+  bl->fraction = fraction;
+  bl->band_count = (band_count <= DSP_BASELINE_MAX_BANDS) ? band_count : 0U;
+}
+
+DSP_BaselineEvent_t dspBaseline_update(DSP_Baseline_t *bl,
+                                       const float32_t *band_rms,
+                                       uint8_t count) {
+  if (bl == NULL || band_rms == NULL || count == 0U ||
+      count != bl->band_count) {
+    return DSP_BASELINE_NONE;
+  }
+
+  float32_t level[DSP_BASELINE_MAX_BANDS];
+  for (uint8_t b = 0; b < count; b++) {
+    const float32_t rms = (band_rms[b] > DSP_BASELINE_RMS_MIN)
+                              ? band_rms[b]
+                              : DSP_BASELINE_RMS_MIN;
+    level[b] = 20.0f * log10f(rms);
+  }
+
+  const uint8_t learning = bl->windows < DSP_BASELINE_LEARN_WINDOWS;
+  DSP_BaselineEvent_t event = DSP_BASELINE_NONE;
+  if (!learning) {
+    bl->score = -1.0f;
+    for (uint8_t b = 0; b < count; b++) {
+      float32_t sd;
+      arm_sqrt_f32(bl->var_db[b], &sd);
+      if (sd < DSP_BASELINE_SPREAD_MIN_DB) {
+        sd = DSP_BASELINE_SPREAD_MIN_DB;
+      }
+      const float32_t dev = level[b] - bl->mean_db[b];
+      const float32_t z = fabsf(dev) / sd;
+      if (z > bl->score) {
+        bl->score = z;
+        bl->worst_band = b;
+        bl->worst_db = dev;
+      }
+    }
+
+    // The alarm changes state after a run of results on the other side
+    const uint8_t towards = bl->alarm ? (bl->score < DSP_BASELINE_CLEAR_SCORE)
+                                      : (bl->score >= DSP_BASELINE_ALARM_SCORE);
+    bl->run = towards ? (uint8_t)(bl->run + 1U) : 0U;
+    if (bl->run >= DSP_BASELINE_ALARM_WINDOWS) {
+      bl->alarm ^= 1U;
+      bl->run = 0;
+      event = bl->alarm ? DSP_BASELINE_RAISED : DSP_BASELINE_CLEARED;
+    }
+    // A changed spectrum is not learned: the alarm would fade on its own
+    if (bl->alarm || bl->score >= DSP_BASELINE_CLEAR_SCORE) {
+      return event;
+    }
+  }
+
+  // Mean and variance in place: weight 1 / n while learning, fixed after
+  const float32_t alpha =
+      learning ? 1.0f / (float32_t)(bl->windows + 1U)
+               : 1.0f / (float32_t)DSP_BASELINE_TRACK_WINDOWS;
+  for (uint8_t b = 0; b < count; b++) {
+    const float32_t d = level[b] - bl->mean_db[b];
+    bl->mean_db[b] += alpha * d;
+    bl->var_db[b] = (1.0f - alpha) * (bl->var_db[b] + alpha * d * d);
+  }
+  if (bl->windows < UINT16_MAX) {
+    bl->windows++;
+  }
+  if (bl->windows == DSP_BASELINE_LEARN_WINDOWS) {
+    event = DSP_BASELINE_LEARNED;
+  }
+  return event;
+}
+
+uint16_t dspBaseline_save(const DSP_Baseline_t *bl, DSP_BaselineRecord_t *rec) {
+  if (bl == NULL || rec == NULL || bl->band_count == 0U ||
+      bl->windows < DSP_BASELINE_LEARN_WINDOWS) {
+    return 0;
+  }
+  memset(rec, 0, sizeof(*rec));
+  rec->windows = bl->windows;
+  rec->fraction = bl->fraction;
+  rec->band_count = bl->band_count;
+  for (uint8_t b = 0; b < bl->band_count; b++) {
+    float32_t sd;
+    arm_sqrt_f32(bl->var_db[b], &sd);
+    rec->band[b].mean_cdb = dspBaseline_centi(bl->mean_db[b]);
+    rec->band[b].sd_cdb = (uint16_t)dspBaseline_centi(sd);
+  }
+  return (uint16_t)DSP_BASELINE_RECORD_SIZE(bl->band_count);
+}
+
+HAL_StatusTypeDef dspBaseline_load(DSP_Baseline_t *bl,
+                                   const DSP_BaselineRecord_t *rec,
+                                   uint16_t len) {
+  if (bl == NULL || rec == NULL || bl->band_count == 0U ||
+      rec->fraction != bl->fraction || rec->band_count != bl->band_count ||
+      len != DSP_BASELINE_RECORD_SIZE(bl->band_count) ||
+      rec->windows < DSP_BASELINE_LEARN_WINDOWS) {
+    return HAL_ERROR;
+  }
+  dspBaseline_reset(bl, rec->fraction, rec->band_count);
+  bl->windows = rec->windows;
+  for (uint8_t b = 0; b < bl->band_count; b++) {
+    const float32_t sd = (float32_t)rec->band[b].sd_cdb / 100.0f;
+    bl->mean_db[b] = (float32_t)rec->band[b].mean_cdb / 100.0f;
+    bl->var_db[b] = sd * sd;
+  }
+  return HAL_OK;
+}
@@ -0,0 +1,213 @@
+/**
+ ******************************************************************************
+ * @file    dsp_coherence.c
+ * @brief   Implementation of the cross-spectrum and coherence stage
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "dsp_coherence.h"
+#include <math.h>
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define DSP_COHERENCE_DEG_PER_RAD (180.0f / PI)
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+ * @brief Empty the Welch sums
+ */
+static void dspCoherence_restart(DSP_Coherence_t *coh) {
+  memset(coh->sxx, 0, sizeof(coh->sxx));
+  memset(coh->syy, 0, sizeof(coh->syy));
+  memset(coh->sxy, 0, sizeof(coh->sxy));
+  coh->averaged = 0;
+}
+
+/**
+ * @brief Bin of each frequency at the inputs' current rate; a moved bin
+ *        restarts the average
+ */
+static void dspCoherence_updateBins(DSP_Coherence_t *coh) {
+  const DSP_SpectrumConfig_t *sc = &coh->inputs[0]->cfg;
+  const float32_t bin_hz = sc->sample_rate_hz / (float32_t)sc->length;
+  const uint16_t top = (uint16_t)(sc->length / 2U - 1U);
+  uint8_t moved = 0;
+
+  for (uint8_t f = 0; f < coh->cfg.freq_count; f++) {
+    uint32_t k = (uint32_t)(coh->cfg.freq_hz[f] / bin_hz + 0.5f);
+    k = (k < 1U) ? 1U : (k > top) ? top : k;
+    if (coh->bin[f] != (uint16_t)k) {
+      coh->bin[f] = (uint16_t)k;
+      moved = 1;
+    }
+  }
+  if (moved) {
+    dspCoherence_restart(coh);
+  }
+}
+
+/**
+ * @brief Features of the averaged cross-spectra; restart the sums
+ */
+static void dspCoherence_publish(DSP_Coherence_t *coh) {
+  const DSP_SpectrumConfig_t *sc = &coh->inputs[0]->cfg;
+  const float32_t bin_hz = sc->sample_rate_hz / (float32_t)sc->length;
+  DSP_CoherenceResult_t *res = &coh->result;
+
+  res->first_segment = coh->first;
+  res->averages = coh->averaged;
+  res->pair_count = coh->cfg.pair_count;
+  res->freq_count = coh->cfg.freq_count;
+  for (uint8_t f = 0; f < coh->cfg.freq_count; f++) {
+    res->hz[f] = (float32_t)coh->bin[f] * bin_hz;
+  }
+  for (uint8_t p = 0; p < coh->cfg.pair_count; p++) {
+    res->pairs[p] = coh->cfg.pairs[p];
+    for (uint8_t f = 0; f < coh->cfg.freq_count; f++) {
+      const float32_t re = coh->sxy[p][f][0];
+      const float32_t im = coh->sxy[p][f][1];
+      const float32_t cross = re * re + im * im;
+      const float32_t auto_xy = coh->sxx[p][f] * coh->syy[p][f];
+      float32_t mag;
+      arm_sqrt_f32(cross, &mag);
+      res->coherence[p][f] = (auto_xy > 0.0f) ? cross / auto_xy : 0.0f;
+      res->phase_deg[p][f] = atan2f(im, re) * DSP_COHERENCE_DEG_PER_RAD;
+      res->gain[p][f] = (coh->sxx[p][f] > 0.0f) ? mag / coh->sxx[p][f] : 0.0f;
+    }
+  }
+  res->sequence = ++coh->result_seq;
+  dspCoherence_restart(coh);
+}
+
+/**
+ * @brief Add the gathered segment to every pair's sums
+ */
+static void dspCoherence_accumulate(DSP_Coherence_t *coh) {
+  if (coh->averaged == 0U) {
+    coh->first = coh->index;
+  }
+  for (uint8_t p = 0; p < coh->cfg.pair_count; p++) {
+    const float32_t(*x)[2] = coh->bins[coh->pair_input[p][0]];
+    const float32_t(*y)[2] = coh->bins[coh->pair_input[p][1]];
+    for (uint8_t f = 0; f < coh->cfg.freq_count; f++) {
+      // conj(X) Y: its angle is the phase of y minus that of x
+      coh->sxx[p][f] += x[f][0] * x[f][0] + x[f][1] * x[f][1];
+      coh->syy[p][f] += y[f][0] * y[f][0] + y[f][1] * y[f][1];
+      coh->sxy[p][f][0] += x[f][0] * y[f][0] + x[f][1] * y[f][1];
+      coh->sxy[p][f][1] += x[f][0] * y[f][1] - x[f][1] * y[f][0];
+    }
+  }
+  if (++coh->averaged >= coh->cfg.averages) {
+    dspCoherence_publish(coh);
+  }
+}
+
+/**
+ * @brief DSP_SpectrumSegmentHook_t: keep the input's selected bins until
+ *        every input has the same segment
+ */
+static void dspCoherence_segment(uint8_t channel, uint32_t index,
+                                 const float32_t *bins, void *ctx) {
+  DSP_Coherence_t *coh = (DSP_Coherence_t *)ctx;
+  uint8_t in = 0;
+  while (in < coh->input_count && coh->inputs[in]->channel != channel) {
+    in++;
+  }
+  if (in == coh->input_count || !((coh->need >> in) & 1U)) {
+    return;
+  }
+
+  if (coh->have != 0U && index != coh->index) {
+    if ((int32_t)(index - coh->index) < 0) {
+      return; // its partner of this segment was dropped
+    }
+    coh->missed++; // an input dropped the one being gathered
+    coh->have = 0;
+  }
+  if (coh->have == 0U) {
+    coh->index = index;
+    dspCoherence_updateBins(coh);
+  }
+
+  for (uint8_t f = 0; f < coh->cfg.freq_count; f++) {
+    const uint32_t k = coh->bin[f];
+    coh->bins[in][f][0] = bins[2U * k];
+    coh->bins[in][f][1] = bins[2U * k + 1U];
+  }
+  coh->have |= (uint8_t)(1U << in);
+  if (coh->have == coh->need) {
+    coh->have = 0;
+    dspCoherence_accumulate(coh);
+  }
+}
+
+/* Public functions ----------------------------------------------------------*/
+
+HAL_StatusTypeDef dspCoherence_init(DSP_Coherence_t *coh,
+                                    const DSP_CoherenceConfig_t *cfg,
+                                    DSP_Spectrum_t *const *inputs,
+                                    uint8_t count) {
+  if (coh == NULL || cfg == NULL || inputs == NULL || count == 0U ||
+      count > DSP_COHERENCE_MAX_INPUTS || cfg->averages < 2U ||
+      cfg->pair_count == 0U || cfg->pair_count > DSP_COHERENCE_MAX_PAIRS ||
+      cfg->freq_count == 0U || cfg->freq_count > DSP_COHERENCE_MAX_FREQS) {
+    return HAL_ERROR;
+  }
+  for (uint8_t i = 0; i < count; i++) {
+    if (inputs[i] == NULL || inputs[i]->cfg.length == 0U ||
+        inputs[i]->cfg.length != inputs[0]->cfg.length ||
+        inputs[i]->cfg.sample_rate_hz != inputs[0]->cfg.sample_rate_hz) {
+      return HAL_ERROR;
+    }
+  }
+  for (uint8_t f = 0; f < cfg->freq_count; f++) {
+    if (!(cfg->freq_hz[f] > 0.0f)) {
+      return HAL_ERROR;
+    }
+  }
+
+  memset(coh, 0, sizeof(*coh));
+  coh->cfg = *cfg;
+  coh->input_count = count;
+  for (uint8_t i = 0; i < count; i++) {
+    coh->inputs[i] = inputs[i];
+  }
+  for (uint8_t p = 0; p < cfg->pair_count; p++) {
+    const uint8_t ch[2] = {cfg->pairs[p].x, cfg->pairs[p].y};
+    for (uint8_t side = 0; side < 2U; side++) {
+      uint8_t in = 0;
+      while (in < count && inputs[in]->channel != ch[side]) {
+        in++;
+      }
+      if (in == count) {
+        return HAL_ERROR;
+      }
+      coh->pair_input[p][side] = in;
+      coh->need |= (uint8_t)(1U << in);
+    }
+  }
+  dspCoherence_updateBins(coh);
+
+  for (uint8_t i = 0; i < count; i++) {
+    if ((coh->need >> i) & 1U) {
+      (void)dspSpectrum_setSegmentHook(inputs[i], dspCoherence_segment, coh);
+    }
+  }
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef dspCoherence_getResult(DSP_Coherence_t *coh,
+                                         DSP_CoherenceResult_t *result) {
+  if (coh == NULL || result == NULL) {
+    return HAL_ERROR;
+  }
+  if (coh->result_seq == coh->read_seq) {
+    return HAL_BUSY;
+  }
+  *result = coh->result;
+  coh->read_seq = coh->result_seq;
+  return HAL_OK;
+}
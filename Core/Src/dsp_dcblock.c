@@ -0,0 +1,80 @@
+/**
+ ******************************************************************************
+ * @file    dsp_dcblock.c
+ * @brief   Implementation of the q15 DC blocker
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "dsp_dcblock.h"
+#include "adc_sections.h"
+#include <math.h>
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define DSP_DCBLOCK_ONE 32768.0f // 1.0 in q15
+
+/* Public functions ----------------------------------------------------------*/
+
+HAL_StatusTypeDef dspDcBlock_init(DSP_DcBlock_t *blk, float32_t cutoff_hz,
+                                  float32_t sample_rate_hz) {
+  if (blk == NULL || !(cutoff_hz > 0.0f) || !(sample_rate_hz > 0.0f) ||
+      cutoff_hz > 0.1f * sample_rate_hz) {
+    return HAL_ERROR;
+  }
+  const float32_t k = 2.0f * PI / sample_rate_hz;
+  // At least one LSB below 1, or it is an integrator
+  long a = lrintf(DSP_DCBLOCK_ONE * (1.0f - k * cutoff_hz));
+  if (a > 32767L) {
+    a = 32767L;
+  }
+  memset(blk, 0, sizeof(*blk));
+  blk->alpha = (q15_t)a;
+  blk->cutoff_hz = (1.0f - (float32_t)a / DSP_DCBLOCK_ONE) / k;
+  return HAL_OK;
+}
+
+void dspDcBlock_reset(DSP_DcBlock_t *blk) {
+  if (blk == NULL) {
+    return;
+  }
+  memset(blk->x1, 0, sizeof(blk->x1));
+  memset(blk->y1, 0, sizeof(blk->y1));
+  memset(blk->carry, 0, sizeof(blk->carry));
+  memset(blk->primed, 0, sizeof(blk->primed));
+}
+
+ADC_FAST_CODE void dspDcBlock_runQ15(DSP_DcBlock_t *blk, uint8_t channel,
+                                     const q15_t *in, q15_t *out,
+                                     uint32_t count) {
+  if (blk == NULL || in == NULL || out == NULL || count == 0U ||
+      channel >= ADC_CONVERSIONS_CHANNEL_COUNT) {
+    return;
+  }
+  const int32_t a = blk->alpha;
+  int32_t x1 = blk->primed[channel] ? blk->x1[channel] : in[0];
+  int32_t y1 = blk->y1[channel];
+  int32_t carry = blk->carry[channel];
+  for (uint32_t n = 0; n < count; n++) {
+    const int32_t x = in[n];
+    // q30; the fraction the q15 output drops goes into the next sample
+    const int64_t acc = ((int64_t)(x - x1) << 15) + (int64_t)a * y1 + carry;
+    int64_t y = acc >> 15;
+    carry = (int32_t)(acc - (y << 15));
+    if (y > INT16_MAX) {
+      y = INT16_MAX;
+      carry = 0;
+    } else if (y < INT16_MIN) {
+      y = INT16_MIN;
+      carry = 0;
+    }
+    out[n] = (q15_t)y;
+    x1 = x;
+    y1 = (int32_t)y;
+  }
+  blk->x1[channel] = (q15_t)x1;
+  blk->y1[channel] = (q15_t)y1;
+  blk->carry[channel] = carry;
+  blk->primed[channel] = 1;
+}
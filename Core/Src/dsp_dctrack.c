@@ -0,0 +1,64 @@
+/**
+ ******************************************************************************
+ * @file    dsp_dctrack.c
+ * @brief   Implementation of the per-channel DC tracker
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "dsp_dctrack.h"
+#include "adc_sections.h"
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define DSP_DCTRACK_ONE ((float32_t)(1UL << DSP_DCTRACK_FRAC_BITS))
+
+/* Public functions ----------------------------------------------------------*/
+
+HAL_StatusTypeDef dspDcTrack_init(DSP_DcTrack_t *dc, uint8_t shift,
+                                  const uint8_t *channel_map) {
+  if (dc == NULL || shift == 0U || shift > DSP_DCTRACK_SHIFT_MAX) {
+    return HAL_ERROR;
+  }
+  memset(dc, 0, sizeof(*dc));
+  dc->shift = shift;
+  for (uint8_t s = 0; s < ADC_CONVERSIONS_CHANNEL_COUNT; s++) {
+    dc->slot_channel[s] = (channel_map != NULL) ? channel_map[s] : s;
+  }
+  return HAL_OK;
+}
+
+ADC_FAST_CODE void dspDcTrack_process(DSP_DcTrack_t *dc, const uint16_t *block,
+                                      uint32_t frames) {
+  if (dc == NULL || block == NULL || frames == 0U) {
+    return;
+  }
+  // One block of 12-bit codes per slot fits 32 bits
+  uint32_t sum[ADC_CONVERSIONS_CHANNEL_COUNT] = {0};
+  const uint16_t *p = block;
+  for (uint32_t f = 0; f < frames; f++) {
+    for (uint8_t s = 0; s < ADC_CONVERSIONS_CHANNEL_COUNT; s++) {
+      sum[s] += p[s];
+    }
+    p += ADC_CONVERSIONS_CHANNEL_COUNT;
+  }
+
+  const uint8_t seed = (dc->blocks == 0U);
+  for (uint8_t s = 0; s < ADC_CONVERSIONS_CHANNEL_COUNT; s++) {
+    const uint8_t ch = dc->slot_channel[s];
+    const int32_t mean =
+        (int32_t)(((uint64_t)sum[s] << DSP_DCTRACK_FRAC_BITS) / frames);
+    // Arithmetic shift: rounds toward -inf by under 1 LSB of q16
+    dc->bias_q16[ch] =
+        seed ? mean : dc->bias_q16[ch] + ((mean - dc->bias_q16[ch]) >> dc->shift);
+  }
+  dc->blocks++;
+}
+
+float32_t dspDcTrack_getBias(const DSP_DcTrack_t *dc, uint8_t channel) {
+  if (dc == NULL || channel >= ADC_CONVERSIONS_CHANNEL_COUNT) {
+    return 0.0f;
+  }
+  return (float32_t)dc->bias_q16[channel] / DSP_DCTRACK_ONE;
+}
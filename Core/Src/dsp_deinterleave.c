@@ -0,0 +1,212 @@
+/**
+ ******************************************************************************
+ * @file    dsp_deinterleave.c
+ * @brief   Implementation of the interleaved-to-planar block transpose
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "dsp_deinterleave.h"
+#include "adc_sections.h"
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define DSP_DEINTERLEAVE_PAIRS (ADC_CONVERSIONS_CHANNEL_COUNT / 2U)
+#define DSP_DEINTERLEAVE_TAIL_SLOT (ADC_CONVERSIONS_CHANNEL_COUNT - 1U)
+
+/* Samples per D-cache line; DMA2D planes are whole lines */
+#define DSP_DEINTERLEAVE_LINE_SAMPLES (ADC_DCACHE_LINE_SIZE / sizeof(uint16_t))
+
+/* DMA2D NLR.NL is 16 bits wide */
+#define DSP_DEINTERLEAVE_DMA2D_MAX_FRAMES 0xFFFFU
+
+/* Private types -------------------------------------------------------------*/
+
+/**
+ * @brief Transpose in progress on DMA2D
+ */
+typedef struct {
+  const uint16_t *block;
+  uint16_t *planar;
+  uint32_t frames;
+  uint32_t plane_stride;
+  uint8_t slot_channel[ADC_CONVERSIONS_CHANNEL_COUNT];
+  uint8_t slot; ///< Slot of the transfer running
+  DSP_DeinterleaveDone_t done;
+  void *ctx;
+} DSP_DeinterleaveJob_t;
+
+/* Private variables ---------------------------------------------------------*/
+static DMA2D_HandleTypeDef hdma2d;
+static DSP_DeinterleaveJob_t job;
+static volatile uint8_t dma2d_busy = 0;
+static uint8_t dma2d_ready = 0;
+
+/* Private functions ---------------------------------------------------------*/
+
+static inline void dspDeinterleave_store2(uint16_t *p, uint32_t v) {
+  memcpy(p, &v, sizeof(v));
+}
+
+static HAL_StatusTypeDef dspDeinterleave_startSlot(void) {
+  const uint8_t s = job.slot;
+  uint16_t *dst = job.planar + job.slot_channel[s] * job.plane_stride;
+  // One pixel per line; the foreground offset skips the rest of the frame
+  return HAL_DMA2D_Start_IT(&hdma2d, (uint32_t)(uintptr_t)&job.block[s],
+                            (uint32_t)(uintptr_t)dst, 1U, job.frames);
+}
+
+static void dspDeinterleave_finish(HAL_StatusTypeDef status) {
+  SCB_InvalidateDCache_by_Addr(
+      (uint32_t *)job.planar,
+      (int32_t)(ADC_CONVERSIONS_CHANNEL_COUNT * job.plane_stride *
+                sizeof(uint16_t)));
+  dma2d_busy = 0;
+  if (job.done != NULL) {
+    job.done(status, job.ctx);
+  }
+}
+
+static void dspDeinterleave_xferCplt(DMA2D_HandleTypeDef *h) {
+  (void)h;
+  if (++job.slot < ADC_CONVERSIONS_CHANNEL_COUNT) {
+    if (dspDeinterleave_startSlot() == HAL_OK) {
+      return;
+    }
+    dspDeinterleave_finish(HAL_ERROR);
+    return;
+  }
+  dspDeinterleave_finish(HAL_OK);
+}
+
+static void dspDeinterleave_xferError(DMA2D_HandleTypeDef *h) {
+  (void)h;
+  dspDeinterleave_finish(HAL_ERROR);
+}
+
+/* Public functions ----------------------------------------------------------*/
+
+ADC_FAST_CODE HAL_StatusTypeDef dspDeinterleave_process(
+    const uint16_t *block, uint32_t frames, const uint8_t *channel_map,
+    uint16_t *planar, uint32_t plane_stride) {
+  if (block == NULL || planar == NULL || plane_stride < frames) {
+    return HAL_ERROR;
+  }
+
+  uint16_t *dst[ADC_CONVERSIONS_CHANNEL_COUNT];
+  for (uint8_t s = 0; s < ADC_CONVERSIONS_CHANNEL_COUNT; s++) {
+    const uint8_t ch = (channel_map != NULL) ? channel_map[s] : s;
+    dst[s] = planar + ch * plane_stride;
+  }
+
+  const uint16_t *p = block;
+  uint32_t f = 0;
+  for (; f + 2U <= frames; f += 2U) {
+    for (uint8_t k = 0; k < DSP_DEINTERLEAVE_PAIRS; k++) {
+      uint32_t a;
+      uint32_t b;
+      memcpy(&a, &p[2U * k], sizeof(a));
+      memcpy(&b, &p[ADC_CONVERSIONS_CHANNEL_COUNT + 2U * k], sizeof(b));
+      // (slot 2k of f, of f + 1) and (slot 2k + 1 of f, of f + 1)
+      dspDeinterleave_store2(&dst[2U * k][f], __PKHBT(a, b, 16));
+      dspDeinterleave_store2(&dst[2U * k + 1U][f], __PKHTB(b, a, 16));
+    }
+    if (ADC_CONVERSIONS_CHANNEL_COUNT % 2U != 0U) {
+      // Odd count: the last slot has no partner
+      dst[DSP_DEINTERLEAVE_TAIL_SLOT][f] = p[DSP_DEINTERLEAVE_TAIL_SLOT];
+      dst[DSP_DEINTERLEAVE_TAIL_SLOT][f + 1U] =
+          p[ADC_CONVERSIONS_CHANNEL_COUNT + DSP_DEINTERLEAVE_TAIL_SLOT];
+    }
+    p += 2U * ADC_CONVERSIONS_CHANNEL_COUNT;
+  }
+  if (f < frames) {
+    for (uint8_t s = 0; s < ADC_CONVERSIONS_CHANNEL_COUNT; s++) {
+      dst[s][f] = p[s];
+    }
+  }
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef dspDeinterleave_initDma2d(void) {
+  hdma2d.Instance = DMA2D;
+  hdma2d.Init.Mode = DMA2D_M2M;
+  hdma2d.Init.ColorMode = DMA2D_OUTPUT_RGB565; // any 16-bit format: no PFC
+  hdma2d.Init.OutputOffset = 0;                // planes are contiguous
+  hdma2d.XferCpltCallback = dspDeinterleave_xferCplt;
+  hdma2d.XferErrorCallback = dspDeinterleave_xferError;
+  if (HAL_DMA2D_Init(&hdma2d) != HAL_OK) {
+    return HAL_ERROR;
+  }
+
+  hdma2d.LayerCfg[DMA2D_FOREGROUND_LAYER].InputOffset =
+      ADC_CONVERSIONS_CHANNEL_COUNT - 1U;
+  hdma2d.LayerCfg[DMA2D_FOREGROUND_LAYER].InputColorMode = DMA2D_INPUT_RGB565;
+  hdma2d.LayerCfg[DMA2D_FOREGROUND_LAYER].AlphaMode = DMA2D_NO_MODIF_ALPHA;
+  hdma2d.LayerCfg[DMA2D_FOREGROUND_LAYER].InputAlpha = 0xFFU;
+  if (HAL_DMA2D_ConfigLayer(&hdma2d, DMA2D_FOREGROUND_LAYER) != HAL_OK) {
+    return HAL_ERROR;
+  }
+  dma2d_ready = 1;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef dspDeinterleave_startDma2d(const uint16_t *block,
+                                             uint32_t frames,
+                                             const uint8_t *channel_map,
+                                             uint16_t *planar,
+                                             uint32_t plane_stride,
+                                             DSP_DeinterleaveDone_t done,
+                                             void *ctx) {
+  if (!dma2d_ready || block == NULL || planar == NULL || frames == 0U ||
+      frames > DSP_DEINTERLEAVE_DMA2D_MAX_FRAMES || plane_stride < frames ||
+      (plane_stride % DSP_DEINTERLEAVE_LINE_SAMPLES) != 0U ||
+      ((uintptr_t)planar % ADC_DCACHE_LINE_SIZE) != 0U) {
+    return HAL_ERROR;
+  }
+  if (dma2d_busy) {
+    return HAL_BUSY;
+  }
+
+  job.block = block;
+  job.planar = planar;
+  job.frames = frames;
+  job.plane_stride = plane_stride;
+  for (uint8_t s = 0; s < ADC_CONVERSIONS_CHANNEL_COUNT; s++) {
+    job.slot_channel[s] = (channel_map != NULL) ? channel_map[s] : s;
+  }
+  job.slot = 0;
+  job.done = done;
+  job.ctx = ctx;
+
+  // DMA2D reads memory, not the cache: write back a block the CPU built,
+  // and drop plane lines so no eviction lands on top of the engine's data
+  SCB_CleanDCache_by_Addr((void *)(uintptr_t)block,
+                          (int32_t)(frames * ADC_CONVERSIONS_CHANNEL_COUNT *
+                                    sizeof(uint16_t)));
+  SCB_InvalidateDCache_by_Addr(
+      (uint32_t *)planar, (int32_t)(ADC_CONVERSIONS_CHANNEL_COUNT *
+                                    plane_stride * sizeof(uint16_t)));
+
+  dma2d_busy = 1;
+  if (dspDeinterleave_startSlot() != HAL_OK) {
+    dma2d_busy = 0;
+    return HAL_ERROR;
+  }
+  return HAL_OK;
+}
+
+uint8_t dspDeinterleave_isBusy(void) { return dma2d_busy; }
+
+void dspDeinterleave_dma2dIrqHandler(void) { HAL_DMA2D_IRQHandler(&hdma2d); }
+
+/* HAL callbacks -------------------------------------------------------------*/
+
+void HAL_DMA2D_MspInit(DMA2D_HandleTypeDef *h) {
+  if (h->Instance != DMA2D) {
+    return;
+  }
+  __HAL_RCC_DMA2D_CLK_ENABLE();
+  HAL_NVIC_SetPriority(DMA2D_IRQn, DSP_DEINTERLEAVE_IRQ_PRIORITY, 0);
+  HAL_NVIC_EnableIRQ(DMA2D_IRQn);
+}
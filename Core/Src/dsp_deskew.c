@@ -0,0 +1,158 @@
+/**
+ ******************************************************************************
+ * @file    dsp_deskew.c
+ * @brief   Implementation of the scan skew compensation
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "dsp_deskew.h"
+#include "adc_sections.h"
+#include <math.h>
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define DSP_DESKEW_Q 14U            // coefficient fraction bits
+#define DSP_DESKEW_ONE (1 << DSP_DESKEW_Q)
+#define DSP_DESKEW_MID 2048         // 12-bit mid-scale, the q15 zero
+
+/* Private variables ---------------------------------------------------------*/
+
+/* One slot's history and block, mid-scale removed; CPU only, in DTCM */
+static int16_t work[DSP_DESKEW_HISTORY + ADC_CONVERSIONS_BLOCK_FRAMES]
+    ADC_FAST_BSS;
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+ * @brief Q14 Lagrange taps for the value delay frames back, sum exactly 1.0
+ */
+static void dspDeskew_design(float delay, int16_t *h) {
+  int32_t sum = 0;
+  for (int32_t k = 0; k < (int32_t)DSP_DESKEW_TAPS; k++) {
+    float c = 1.0f;
+    for (int32_t j = 0; j < (int32_t)DSP_DESKEW_TAPS; j++) {
+      if (j != k) {
+        c *= (delay - (float)j) / (float)(k - j);
+      }
+    }
+    h[k] = (int16_t)lroundf(c * (float)DSP_DESKEW_ONE);
+    sum += h[k];
+  }
+  h[DSP_DESKEW_LATENCY] =
+      (int16_t)(h[DSP_DESKEW_LATENCY] + (DSP_DESKEW_ONE - sum));
+  h[DSP_DESKEW_TAPS] = 0; // the 8th tap of the pairs
+}
+
+/**
+ * @brief Unaligned pair of q15 samples (LDR allows it on normal memory)
+ */
+static inline uint32_t dspDeskew_pair(const int16_t *p) {
+  uint32_t v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+/* Public functions ----------------------------------------------------------*/
+
+HAL_StatusTypeDef dspDeskew_init(DSP_Deskew_t *ds, const float *skew_ns,
+                                 const uint8_t *channel_map) {
+  if (ds == NULL || skew_ns == NULL) {
+    return HAL_ERROR;
+  }
+  for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+    if (!(skew_ns[ch] >= 0.0f)) {
+      return HAL_ERROR;
+    }
+  }
+  memset(ds, 0, sizeof(*ds));
+  for (uint8_t s = 0; s < ADC_CONVERSIONS_CHANNEL_COUNT; s++) {
+    ds->slot_channel[s] = (channel_map != NULL) ? channel_map[s] : s;
+  }
+  memcpy(ds->skew_ns, skew_ns, sizeof(ds->skew_ns));
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef dspDeskew_setRate(DSP_Deskew_t *ds, uint32_t rate_hz) {
+  if (ds == NULL) {
+    return HAL_ERROR;
+  }
+  int16_t h[ADC_CONVERSIONS_CHANNEL_COUNT][DSP_DESKEW_PAIRED_TAPS];
+  for (uint8_t s = 0; s < ADC_CONVERSIONS_CHANNEL_COUNT; s++) {
+    const float frames =
+        ds->skew_ns[ds->slot_channel[s]] * (float)rate_hz * 1.0e-9f;
+    if (frames >= 1.0f) {
+      ds->rate_hz = 0; // no stale taps at a rate they were not made for
+      return HAL_ERROR;
+    }
+    dspDeskew_design((float)DSP_DESKEW_LATENCY + frames, h[s]);
+  }
+  if (ds->rate_hz == 0U) {
+    ds->primed = 0; // the history stopped with the pass-through
+  }
+  for (uint8_t s = 0; s < ADC_CONVERSIONS_CHANNEL_COUNT; s++) {
+    for (uint32_t j = 0; j < DSP_DESKEW_PAIRED_TAPS / 2U; j++) {
+      ds->coeffs[s][j] = (uint32_t)(uint16_t)h[s][2U * j + 1U] |
+                         ((uint32_t)(uint16_t)h[s][2U * j] << 16);
+    }
+  }
+  ds->rate_hz = rate_hz;
+  return HAL_OK;
+}
+
+ADC_FAST_CODE void dspDeskew_process(DSP_Deskew_t *ds, uint16_t *block,
+                                     uint32_t frames) {
+  if (ds == NULL || block == NULL || frames == 0U ||
+      frames > ADC_CONVERSIONS_BLOCK_FRAMES || ds->rate_hz == 0U) {
+    return;
+  }
+  const uint8_t primed = ds->primed;
+
+  for (uint8_t s = 0; s < ADC_CONVERSIONS_CHANNEL_COUNT; s++) {
+    // History ahead of the slot's samples; the first frame fills it
+    uint16_t *src = &block[s];
+    if (!primed) {
+      for (uint32_t k = 0; k < DSP_DESKEW_HISTORY; k++) {
+        ds->history[s][k] = (int16_t)((int32_t)*src - DSP_DESKEW_MID);
+      }
+    }
+    memcpy(work, ds->history[s], sizeof(ds->history[s]));
+    for (uint32_t f = 0; f < frames; f++) {
+      work[DSP_DESKEW_HISTORY + f] = (int16_t)((int32_t)*src - DSP_DESKEW_MID);
+      src += ADC_CONVERSIONS_CHANNEL_COUNT;
+    }
+
+    // y[n] = sum h[k] x[n - k]: four pairs {x[n-2j-1], x[n-2j]}
+    const uint32_t c0 = ds->coeffs[s][0];
+    const uint32_t c1 = ds->coeffs[s][1];
+    const uint32_t c2 = ds->coeffs[s][2];
+    const uint32_t c3 = ds->coeffs[s][3];
+    uint16_t *dst = &block[s];
+    for (uint32_t f = 0; f < frames; f++) {
+      const int16_t *x = &work[DSP_DESKEW_HISTORY + f];
+      uint32_t acc = (uint32_t)(DSP_DESKEW_ONE / 2);
+      acc = __SMLAD(dspDeskew_pair(x - 1), c0, acc);
+      acc = __SMLAD(dspDeskew_pair(x - 3), c1, acc);
+      acc = __SMLAD(dspDeskew_pair(x - 5), c2, acc);
+      acc = __SMLAD(dspDeskew_pair(x - 7), c3, acc);
+      const int32_t y = ((int32_t)acc >> DSP_DESKEW_Q) + DSP_DESKEW_MID;
+      *dst = (uint16_t)__USAT(y, 12);
+      dst += ADC_CONVERSIONS_CHANNEL_COUNT;
+    }
+    memcpy(ds->history[s], &work[frames], sizeof(ds->history[s]));
+  }
+  ds->primed = 1;
+  ds->samples += frames;
+}
+
+void dspDeskew_blockFilter(uint16_t *block, uint32_t frames, void *ctx) {
+  dspDeskew_process((DSP_Deskew_t *)ctx, block, frames);
+}
+
+float dspDeskew_getDelay(const DSP_Deskew_t *ds, uint8_t channel) {
+  if (ds == NULL || channel >= ADC_CONVERSIONS_CHANNEL_COUNT) {
+    return 0.0f;
+  }
+  return ds->skew_ns[channel] * (float)ds->rate_hz * 1.0e-9f;
+}
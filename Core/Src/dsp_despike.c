@@ -0,0 +1,204 @@
+/**
+ ******************************************************************************
+ * @file    dsp_despike.c
+ * @brief   Implementation of the running-median spike filter
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "dsp_despike.h"
+#include "adc_sections.h"
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define DSP_DESPIKE_ONES 0x00010001U // one count in each lane
+
+_Static_assert(ADC_CONVERSIONS_BLOCK_FRAMES <= 0xFFFFU,
+               "the per-lane counts of a block must fit 16 bits");
+
+/* Compare-exchange of both lanes: a = min, b = max. The GE flags of the
+ * USUB16 serve both SELs. */
+#define DSP_DESPIKE_SORT(a, b)                                                 \
+  do {                                                                         \
+    __USUB16((a), (b));                                                        \
+    const uint32_t lo_ = __SEL((b), (a));                                      \
+    (b) = __SEL((a), (b));                                                     \
+    (a) = lo_;                                                                 \
+  } while (0)
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+ * @brief Median of both lanes of p[0..taps-1] (sorting networks, p is
+ *        destroyed)
+ */
+__attribute__((always_inline)) static inline uint32_t
+dspDespike_median(uint32_t *p, uint8_t taps) {
+  if (taps == 3U) {
+    DSP_DESPIKE_SORT(p[0], p[1]);
+    DSP_DESPIKE_SORT(p[1], p[2]);
+    DSP_DESPIKE_SORT(p[0], p[1]);
+    return p[1];
+  }
+  if (taps == 5U) {
+    DSP_DESPIKE_SORT(p[0], p[1]);
+    DSP_DESPIKE_SORT(p[3], p[4]);
+    DSP_DESPIKE_SORT(p[0], p[3]);
+    DSP_DESPIKE_SORT(p[1], p[4]);
+    DSP_DESPIKE_SORT(p[1], p[2]);
+    DSP_DESPIKE_SORT(p[2], p[3]);
+    DSP_DESPIKE_SORT(p[1], p[2]);
+    return p[2];
+  }
+  DSP_DESPIKE_SORT(p[0], p[5]);
+  DSP_DESPIKE_SORT(p[0], p[3]);
+  DSP_DESPIKE_SORT(p[1], p[6]);
+  DSP_DESPIKE_SORT(p[2], p[4]);
+  DSP_DESPIKE_SORT(p[0], p[1]);
+  DSP_DESPIKE_SORT(p[3], p[5]);
+  DSP_DESPIKE_SORT(p[2], p[6]);
+  DSP_DESPIKE_SORT(p[2], p[3]);
+  DSP_DESPIKE_SORT(p[3], p[6]);
+  DSP_DESPIKE_SORT(p[4], p[5]);
+  DSP_DESPIKE_SORT(p[1], p[4]);
+  DSP_DESPIKE_SORT(p[1], p[3]);
+  DSP_DESPIKE_SORT(p[3], p[4]);
+  return p[3];
+}
+
+/**
+ * @brief One slot pair through a block; taps is a constant at each call
+ *
+ * @return uint32_t Changed samples, one count per lane
+ */
+__attribute__((always_inline)) static inline uint32_t
+dspDespike_pair(DSP_Despike_t *ds, uint32_t pair, uint16_t *block,
+                uint32_t frames, uint8_t taps) {
+  const uint32_t slot = 2U * pair;
+  const uint8_t has_hi = (slot + 1U < ADC_CONVERSIONS_CHANNEL_COUNT);
+  const uint32_t lanes = ds->lane_mask[pair];
+  const uint8_t hampel = (ds->cfg.mode == DSP_DESPIKE_HAMPEL);
+  const uint32_t thr = (uint32_t)ds->cfg.threshold * DSP_DESPIKE_ONES;
+  uint32_t *hist = ds->history[pair];
+  uint32_t win[DSP_DESPIKE_MAX_TAPS - 1U];
+  uint32_t changed = 0;
+
+  for (uint8_t k = 0; k + 1U < taps; k++) {
+    win[k] = hist[k];
+  }
+  uint16_t *src = &block[slot];
+  for (uint32_t f = 0; f < frames; f++) {
+    const uint32_t x = src[0] | ((has_hi ? (uint32_t)src[1] : 0U) << 16);
+    uint32_t p[DSP_DESPIKE_MAX_TAPS];
+    for (uint8_t k = 0; k + 1U < taps; k++) {
+      p[k] = win[k];
+    }
+    p[taps - 1U] = x;
+    const uint32_t m = dspDespike_median(p, taps);
+
+    // |x - m| per lane, then median only where it exceeds the threshold
+    const uint32_t up = __USUB16(x, m);
+    const uint32_t down = __USUB16(m, x);
+    const uint32_t dev = __SEL(down, up);
+    __USUB16(thr, dev);
+    const uint32_t kept = __SEL(x, m);
+    uint32_t out = hampel ? kept : m;
+    out = (out & lanes) | (x & ~lanes);
+
+    // A lane differs from its input: count it
+    __USUB16(0U, out ^ x);
+    changed += __SEL(0U, DSP_DESPIKE_ONES);
+
+    src[0] = (uint16_t)out;
+    if (has_hi) {
+      src[1] = (uint16_t)(out >> 16);
+    }
+    for (uint8_t k = 0; k + 2U < taps; k++) {
+      win[k] = win[k + 1U];
+    }
+    win[taps - 2U] = x;
+    src += ADC_CONVERSIONS_CHANNEL_COUNT;
+  }
+  for (uint8_t k = 0; k + 1U < taps; k++) {
+    hist[k] = win[k];
+  }
+  return changed;
+}
+
+/* Public functions ----------------------------------------------------------*/
+
+HAL_StatusTypeDef dspDespike_init(DSP_Despike_t *ds,
+                                  const DSP_DespikeConfig_t *cfg,
+                                  const uint8_t *channel_map) {
+  if (ds == NULL || cfg == NULL ||
+      (cfg->taps != 3U && cfg->taps != 5U && cfg->taps != 7U) ||
+      (cfg->channels & ADC_CHANNELS_MASK_ALL) == 0U) {
+    return HAL_ERROR;
+  }
+  memset(ds, 0, sizeof(*ds));
+  ds->cfg = *cfg;
+  for (uint8_t s = 0; s < ADC_CONVERSIONS_CHANNEL_COUNT; s++) {
+    const uint8_t ch = (channel_map != NULL) ? channel_map[s] : s;
+    ds->slot_channel[s] = ch;
+    if ((cfg->channels >> ch) & 1U) {
+      ds->lane_mask[s / 2U] |= (s & 1U) ? 0xFFFF0000U : 0x0000FFFFU;
+    }
+  }
+  return HAL_OK;
+}
+
+ADC_FAST_CODE void dspDespike_process(DSP_Despike_t *ds, uint16_t *block,
+                                      uint32_t frames) {
+  if (ds == NULL || block == NULL || frames == 0U) {
+    return;
+  }
+  if (!ds->primed) {
+    // The first frame fills the window: no start-up transient
+    for (uint32_t pr = 0; pr < DSP_DESPIKE_PAIRS; pr++) {
+      const uint32_t slot = 2U * pr;
+      const uint32_t hi = (slot + 1U < ADC_CONVERSIONS_CHANNEL_COUNT)
+                              ? (uint32_t)block[slot + 1U]
+                              : 0U;
+      for (uint32_t k = 0; k + 1U < DSP_DESPIKE_MAX_TAPS; k++) {
+        ds->history[pr][k] = block[slot] | (hi << 16);
+      }
+    }
+    ds->primed = 1;
+  }
+
+  for (uint32_t pr = 0; pr < DSP_DESPIKE_PAIRS; pr++) {
+    if (ds->lane_mask[pr] == 0U) {
+      continue;
+    }
+    uint32_t changed;
+    switch (ds->cfg.taps) {
+    case 3U:
+      changed = dspDespike_pair(ds, pr, block, frames, 3U);
+      break;
+    case 5U:
+      changed = dspDespike_pair(ds, pr, block, frames, 5U);
+      break;
+    default:
+      changed = dspDespike_pair(ds, pr, block, frames, 7U);
+      break;
+    }
+    const uint32_t slot = 2U * pr;
+    ds->replaced[ds->slot_channel[slot]] += changed & 0xFFFFU;
+    if (slot + 1U < ADC_CONVERSIONS_CHANNEL_COUNT) {
+      ds->replaced[ds->slot_channel[slot + 1U]] += changed >> 16;
+    }
+  }
+  ds->samples += frames;
+}
+
+void dspDespike_blockFilter(uint16_t *block, uint32_t frames, void *ctx) {
+  dspDespike_process((DSP_Despike_t *)ctx, block, frames);
+}
+
+uint32_t dspDespike_getReplaced(const DSP_Despike_t *ds, uint8_t channel) {
+  if (ds == NULL || channel >= ADC_CONVERSIONS_CHANNEL_COUNT) {
+    return 0;
+  }
+  return ds->replaced[channel];
+}
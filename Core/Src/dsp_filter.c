@@ -0,0 +1,182 @@
+/**
+ ******************************************************************************
+ * @file    dsp_filter.c
+ * @brief   Implementation of the CMSIS-DSP biquad filter and decimation stage
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "dsp_filter.h"
+#include "adc_sections.h"
+#include <string.h>
+
+/* Private variables ---------------------------------------------------------*/
+
+/* Per-channel scratch, CPU only: kept in DTCM next to the ring */
+static float32_t work_in[ADC_CONVERSIONS_BLOCK_FRAMES] ADC_FAST_BSS;
+static float32_t work_out[ADC_CONVERSIONS_BLOCK_FRAMES] ADC_FAST_BSS;
+static DSP_AsrcTap_t work_taps[ADC_CONVERSIONS_BLOCK_FRAMES] ADC_FAST_BSS;
+
+/* Coefficient table ---------------------------------------------------------*/
+
+/* RBJ low-pass sections, Q = 0.5412 and 1.3066 (Butterworth, 4th order) */
+static const float32_t lowpass200Hz_coeffs[2U * DSP_FILTER_COEFFS_PER_STAGE] = {
+    0.019036832f, 0.038073663f, 0.019036832f, 1.479674217f, -0.555821543f,
+    0.021883852f, 0.043767704f, 0.021883852f, 1.700964337f, -0.788499745f};
+
+const DSP_FilterDesign_t dspFilter_lowpass200Hz = {
+    .num_stages = 2, .coeffs = lowpass200Hz_coeffs};
+
+/* Bilinear Butterworth band-pass; edges at fs / 8 and 3 fs / 8, so the two
+   sections mirror around fs / 4 */
+static const float32_t
+    bandpass500to1500Hz_coeffs[2U * DSP_FILTER_COEFFS_PER_STAGE] = {
+        0.541196100f, 0.0f, -0.541196100f, 0.910179721f,  -0.414213562f,
+        0.541196100f, 0.0f, -0.541196100f, -0.910179721f, -0.414213562f};
+
+const DSP_FilterDesign_t dspFilter_bandpass500to1500Hz = {
+    .num_stages = 2, .coeffs = bandpass500to1500Hz_coeffs};
+
+/* Public functions ----------------------------------------------------------*/
+
+HAL_StatusTypeDef dspFilter_init(DSP_Filter_t *filt, uint16_t decimation,
+                                 const uint8_t *channel_map) {
+  if (filt == NULL || decimation == 0U ||
+      (ADC_CONVERSIONS_BLOCK_FRAMES % decimation) != 0U) {
+    return HAL_ERROR;
+  }
+  memset(filt, 0, sizeof(*filt));
+  for (uint8_t s = 0; s < ADC_CONVERSIONS_CHANNEL_COUNT; s++) {
+    filt->slot_channel[s] = (channel_map != NULL) ? channel_map[s] : s;
+  }
+  filt->decimation = decimation;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef dspFilter_configChannel(DSP_Filter_t *filt, uint8_t channel,
+                                          const DSP_FilterDesign_t *design) {
+  if (filt == NULL || channel >= ADC_CONVERSIONS_CHANNEL_COUNT) {
+    return HAL_ERROR;
+  }
+  if (design == NULL) {
+    filt->enabled[channel] = 0;
+    return HAL_OK;
+  }
+  if (design->coeffs == NULL || design->num_stages == 0U ||
+      design->num_stages > DSP_FILTER_MAX_STAGES) {
+    return HAL_ERROR;
+  }
+
+  // Init also clears the delay line
+  arm_biquad_cascade_df2T_init_f32(&filt->biquad[channel], design->num_stages,
+                                   (float32_t *)design->coeffs,
+                                   filt->state[channel]);
+  filt->enabled[channel] = 1;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef dspFilter_setDecimation(DSP_Filter_t *filt,
+                                          uint16_t decimation) {
+  if (filt == NULL || decimation == 0U ||
+      (ADC_CONVERSIONS_BLOCK_FRAMES % decimation) != 0U) {
+    return HAL_ERROR;
+  }
+  filt->decimation = decimation;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef dspFilter_setResampler(DSP_Filter_t *filt,
+                                         DSP_Asrc_t *asrc) {
+  if (filt == NULL) {
+    return HAL_ERROR;
+  }
+  filt->asrc = asrc;
+  return HAL_OK;
+}
+
+ADC_FAST_CODE void dspFilter_process(DSP_Filter_t *filt, const uint16_t *block,
+                                     uint32_t frames) {
+  if (filt == NULL || block == NULL || frames > ADC_CONVERSIONS_BLOCK_FRAMES) {
+    return;
+  }
+
+  // Input frames (n + 1) D - 1 are kept, counted across blocks: a block
+  // shorter than D, or not a multiple of it, carries on the lattice
+  const uint32_t decimation = filt->decimation;
+  const uint32_t first = decimation - 1U - filt->frames_in % decimation;
+  uint32_t out_frames =
+      (frames > first) ? (frames - 1U - first) / decimation + 1U : 0U;
+  uint32_t out_start = filt->frames_in + first + 1U - decimation;
+  const uint32_t half = filt->blocks_done & 1U;
+  float32_t *out = filt->output[half];
+
+  // Resampled: where each output falls, shared by the channels
+  if (filt->asrc != NULL) {
+    uint32_t seq = 0;
+    out_frames = dspAsrc_plan(filt->asrc, filt->frames_in, frames,
+                              (uint16_t)decimation, work_taps,
+                              ADC_CONVERSIONS_BLOCK_FRAMES, &seq);
+    out_start = seq + 1U - decimation;
+  }
+
+  for (uint8_t s = 0; s < ADC_CONVERSIONS_CHANNEL_COUNT; s++) {
+    uint8_t ch = filt->slot_channel[s];
+
+    // Deinterleave one slot: stride of one frame
+    const uint16_t *src = &block[s];
+    for (uint32_t f = 0; f < frames; f++) {
+      work_in[f] = (float32_t)*src;
+      src += ADC_CONVERSIONS_CHANNEL_COUNT;
+    }
+
+    const float32_t *filtered = work_in;
+    if (filt->enabled[ch]) {
+      arm_biquad_cascade_df2T_f32(&filt->biquad[ch], work_in, work_out,
+                                  frames);
+      filtered = work_out;
+    }
+
+    if (filt->asrc != NULL) {
+      dspAsrc_interpolate(filt->asrc, ch, filtered, frames, work_taps,
+                          out_frames, &out[ch], ADC_CONVERSIONS_CHANNEL_COUNT);
+      continue;
+    }
+
+    // Keep the last sample of each decimation group
+    float32_t *dst = &out[ch];
+    for (uint32_t k = 0; k < out_frames; k++) {
+      *dst = filtered[first + k * decimation];
+      dst += ADC_CONVERSIONS_CHANNEL_COUNT;
+    }
+  }
+
+  filt->output_frames = out_frames;
+  filt->output_decimation = (uint16_t)decimation;
+  filt->output_start[half] = out_start;
+  filt->frames_in += frames;
+  __DMB();
+  filt->blocks_done++;
+}
+
+HAL_StatusTypeDef dspFilter_getOutput(DSP_Filter_t *filt,
+                                      const float32_t **out, uint32_t *frames,
+                                      uint32_t *first_input) {
+  if (filt == NULL || out == NULL || frames == NULL) {
+    return HAL_ERROR;
+  }
+
+  uint32_t done = filt->blocks_done;
+  if (done == filt->blocks_read) {
+    return HAL_BUSY;
+  }
+  __DMB();
+  filt->blocks_missed += done - filt->blocks_read - 1U;
+  filt->blocks_read = done;
+  *out = filt->output[(done - 1U) & 1U];
+  *frames = filt->output_frames;
+  if (first_input != NULL) {
+    *first_input = filt->output_start[(done - 1U) & 1U];
+  }
+  return HAL_OK;
+}
@@ -0,0 +1,332 @@
+/**
+ ******************************************************************************
+ * @file    dsp_fused.c
+ * @brief   Implementation of the single-pass unpack, calibrate, filter and
+ *          stats kernel
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "dsp_fused.h"
+#include "adc_linearity.h"
+#include "adc_sections.h"
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+
+/* q13 matrix accumulator -> mg, raw codes or table entries (x 4) */
+#define DSP_FUSED_MG_SCALE (1.0f / (float32_t)(1U << ADC_CAL_MATRIX_FRAC_BITS))
+#define DSP_FUSED_LIN_MG_SCALE                                               \
+  (1.0f /                                                                    \
+   (float32_t)(1U << (ADC_CAL_MATRIX_FRAC_BITS + ADC_LIN_FRAC_BITS)))
+#define DSP_FUSED_CODE_MASK 0x0FFFU
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+ * @brief Slot pair k of a frame; the odd last slot alone in the low lane
+ */
+static inline uint32_t dspFused_load(const uint16_t *frame, uint8_t k) {
+  if (2U * k + 1U < ADC_CONVERSIONS_CHANNEL_COUNT) {
+    return dspStats_load2(&frame[2U * k]);
+  }
+  return frame[2U * k];
+}
+
+static inline uint32_t dspFused_pack(int16_t lo, int16_t hi) {
+  return (uint16_t)lo | ((uint32_t)(uint16_t)hi << 16);
+}
+
+/**
+ * @brief Calibrate and filter one frame; store it when the decimation is due
+ *
+ * @param w Slot pairs of the frame as loaded from the block
+ */
+static inline void dspFused_frame(DSP_Fused_t *fk, const uint32_t *w,
+                                  float32_t **out) {
+  // Code - offset of two slots per SSUB16; |result| < 4096 fits a halfword,
+  // and < 16384 with the linearity tables (codes x 4)
+  uint32_t x[DSP_FUSED_PAIRS];
+  if (fk->linear) {
+    const int16_t *const *lut = fk->lut;
+    for (uint8_t k = 0; k < DSP_FUSED_PAIRS; k++) {
+      const uint32_t v = dspFused_pack(
+          lut[2U * k][w[k] & DSP_FUSED_CODE_MASK],
+          lut[2U * k + 1U][(w[k] >> 16) & DSP_FUSED_CODE_MASK]);
+      x[k] = __SSUB16(v, fk->offset[k]);
+    }
+  } else {
+    for (uint8_t k = 0; k < DSP_FUSED_PAIRS; k++) {
+      x[k] = __SSUB16(w[k], fk->offset[k]);
+    }
+  }
+  DSP_Goertzel_t *const gz = fk->goertzel;
+  DSP_Sdft_t *const sd = fk->sdft;
+  if (fk->histogram != NULL) {
+    dspHistogram_pushPairs(fk->histogram, w);
+  }
+  const uint8_t emit = (++fk->phase >= fk->decimation);
+  if (emit) {
+    fk->phase = 0;
+  }
+  if (sd != NULL) {
+    dspSdft_beginFrame(sd);
+  }
+
+  for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+    // 3 x 16380 x 32767 < 2^31: the row sum cannot overflow, tables or not
+    const uint32_t *c = fk->coef[ch];
+    const uint8_t *k = fk->coef_pair[ch];
+    int32_t acc = (int32_t)__SMLAD(
+        x[k[0]], c[0], __SMLAD(x[k[1]], c[1], __SMLAD(x[k[2]], c[2], 0U)));
+    float32_t y = (float32_t)acc * fk->mg_scale;
+    if (gz != NULL) {
+      dspGoertzel_push(gz, ch, y);
+    }
+    if (sd != NULL) {
+      dspSdft_push(sd, ch, y);
+    }
+
+    // df2T per stage; CMSIS coefficients, feedback already negated
+    for (uint8_t st = 0; st < fk->num_stages; st++) {
+      const float32_t *b = fk->biquad[st];
+      float32_t *d = fk->state[ch][st];
+      float32_t v = b[0] * y + d[0];
+      d[0] = b[1] * y + b[3] * v + d[1];
+      d[1] = b[2] * y + b[4] * v;
+      y = v;
+    }
+    if (emit) {
+      (*out)[ch] = y;
+    }
+  }
+  if (emit) {
+    *out += ADC_CONVERSIONS_CHANNEL_COUNT;
+  }
+  if (gz != NULL) {
+    dspGoertzel_endFrame(gz);
+  }
+  if (sd != NULL) {
+    dspSdft_endFrame(sd);
+  }
+}
+
+/**
+ * @brief Widen the partials of the slot pairs into the channel totals
+ */
+static void dspFused_flushStats(DSP_Fused_t *fk, const DSP_StatsPair_t *pair,
+                                uint32_t frames) {
+  for (uint8_t s = 0; s < ADC_CONVERSIONS_CHANNEL_COUNT; s++) {
+    const DSP_StatsPair_t *p = &pair[s / 2U];
+    const uint8_t lane = s % 2U;
+    DSP_StatsAccum_t *acc = &fk->stats[fk->slot_channel[s]];
+    uint16_t mn = (uint16_t)(p->min >> (16U * lane));
+    uint16_t mx = (uint16_t)(p->max >> (16U * lane));
+    acc->count += frames;
+    acc->sum += p->sum[lane];
+    acc->sum_sq += p->sum_sq[lane];
+    acc->sum_cube += (double)p->sum_cube[lane];
+    acc->sum_quad += (double)p->sum_quad[lane];
+    if (mn < acc->min) {
+      acc->min = mn;
+    }
+    if (mx > acc->max) {
+      acc->max = mx;
+    }
+  }
+}
+
+/**
+ * @brief Scalar stats of a trailing odd frame
+ */
+static void dspFused_addFrameStats(DSP_Fused_t *fk, const uint16_t *frame) {
+  for (uint8_t s = 0; s < ADC_CONVERSIONS_CHANNEL_COUNT; s++) {
+    dspStats_addSample(&fk->stats[fk->slot_channel[s]], frame[s]);
+  }
+}
+
+/* Public functions ----------------------------------------------------------*/
+
+HAL_StatusTypeDef dspFused_init(DSP_Fused_t *fk, uint16_t decimation,
+                                const uint8_t *channel_map,
+                                const DSP_FilterDesign_t *design) {
+  if (fk == NULL || decimation == 0U ||
+      (design != NULL &&
+       (design->coeffs == NULL || design->num_stages == 0U ||
+        design->num_stages > DSP_FILTER_MAX_STAGES))) {
+    return HAL_ERROR;
+  }
+
+  memset(fk, 0, sizeof(*fk));
+  fk->decimation = decimation;
+  for (uint8_t s = 0; s < ADC_CONVERSIONS_CHANNEL_COUNT; s++) {
+    fk->slot_channel[s] = (channel_map != NULL) ? channel_map[s] : s;
+  }
+  if (design != NULL) {
+    fk->num_stages = design->num_stages;
+    memcpy(fk->biquad, design->coeffs,
+           design->num_stages * DSP_FILTER_COEFFS_PER_STAGE *
+               sizeof(float32_t));
+  }
+  dspStats_reset(fk->stats);
+  dspFused_loadCalibration(fk);
+  return HAL_OK;
+}
+
+void dspFused_loadCalibration(DSP_Fused_t *fk) {
+  if (fk == NULL) {
+    return;
+  }
+  const ADC_CalTable_t *cal = adcCal_getTable();
+
+  // The tables give codes x 4: the offsets follow, the scale undoes it
+  const uint8_t shift = fk->linear ? ADC_LIN_FRAC_BITS : 0U;
+  fk->mg_scale = fk->linear ? DSP_FUSED_LIN_MG_SCALE : DSP_FUSED_MG_SCALE;
+  for (uint8_t s = 0; s < 2U * DSP_FUSED_PAIRS; s++) {
+    const uint8_t real = (s < ADC_CONVERSIONS_CHANNEL_COUNT) ? s : s - 1U;
+    fk->lut[s] = fk->linear ? adcLin_getTable(adcLin_slotAdc(real)) : NULL;
+  }
+  for (uint8_t k = 0; k < DSP_FUSED_PAIRS; k++) {
+    const uint8_t s = 2U * k;
+    fk->offset[k] = dspFused_pack(
+        (int16_t)(cal->offset[fk->slot_channel[s]] * (1 << shift)),
+        (s + 1U < ADC_CONVERSIONS_CHANNEL_COUNT)
+            ? (int16_t)(cal->offset[fk->slot_channel[s + 1U]] * (1 << shift))
+            : 0);
+  }
+
+  // Row of output channel ch against the pairs holding its group; unused
+  // terms multiply pair 0 by zero
+  for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+    const uint8_t g = ch / ADC_CAL_AXES;
+    const uint8_t row = ch % ADC_CAL_AXES;
+    uint8_t terms = 0;
+    memset(fk->coef[ch], 0, sizeof(fk->coef[ch]));
+    memset(fk->coef_pair[ch], 0, sizeof(fk->coef_pair[ch]));
+    for (uint8_t k = 0; k < DSP_FUSED_PAIRS && terms < DSP_FUSED_ROW_PAIRS;
+         k++) {
+      int16_t c[2] = {0, 0};
+      uint8_t used = 0;
+      for (uint8_t lane = 0; lane < 2U; lane++) {
+        const uint8_t s = 2U * k + lane;
+        if (s >= ADC_CONVERSIONS_CHANNEL_COUNT) {
+          break;
+        }
+        const uint8_t in = fk->slot_channel[s];
+        if (in / ADC_CAL_AXES == g) {
+          c[lane] = cal->matrix[g][row][in % ADC_CAL_AXES];
+          used = 1;
+        }
+      }
+      if (used) {
+        fk->coef[ch][terms] = dspFused_pack(c[0], c[1]);
+        fk->coef_pair[ch][terms] = k;
+        terms++;
+      }
+    }
+  }
+}
+
+HAL_StatusTypeDef dspFused_attachGoertzel(DSP_Fused_t *fk, DSP_Goertzel_t *gz) {
+  if (fk == NULL) {
+    return HAL_ERROR;
+  }
+  fk->goertzel = gz;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef dspFused_attachSdft(DSP_Fused_t *fk, DSP_Sdft_t *sd) {
+  if (fk == NULL) {
+    return HAL_ERROR;
+  }
+  fk->sdft = sd;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef dspFused_attachHistogram(DSP_Fused_t *fk,
+                                           DSP_Histogram_t *hg) {
+  if (fk == NULL) {
+    return HAL_ERROR;
+  }
+  fk->histogram = hg;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef dspFused_attachLinearity(DSP_Fused_t *fk, uint8_t on) {
+  if (fk == NULL || (on && adcLin_getTable(0) == NULL)) {
+    return HAL_ERROR;
+  }
+  fk->linear = !!on;
+  dspFused_loadCalibration(fk);
+  return HAL_OK;
+}
+
+ADC_FAST_CODE uint32_t dspFused_process(DSP_Fused_t *fk,
+                                        const uint16_t *block,
+                                        uint32_t frames, float32_t *out) {
+  if (fk == NULL || block == NULL || out == NULL) {
+    return 0;
+  }
+
+  const uint16_t *p = block;
+  float32_t *o = out;
+  uint32_t f = 0;
+  while (f + 2U <= frames) {
+    uint32_t n = frames - f;
+    if (n > DSP_STATS_CHUNK_FRAMES) {
+      n = DSP_STATS_CHUNK_FRAMES;
+    }
+    n &= ~1U;
+
+    DSP_StatsPair_t pair[DSP_FUSED_PAIRS];
+    for (uint8_t k = 0; k < DSP_FUSED_PAIRS; k++) {
+      pair[k] = (DSP_StatsPair_t){.min = 0xFFFFFFFFU};
+    }
+    for (uint32_t j = 0; j < n; j += 2U) {
+      uint32_t a[DSP_FUSED_PAIRS];
+      uint32_t b[DSP_FUSED_PAIRS];
+      for (uint8_t k = 0; k < DSP_FUSED_PAIRS; k++) {
+        a[k] = dspFused_load(p, k);
+        b[k] = dspFused_load(p + ADC_CONVERSIONS_CHANNEL_COUNT, k);
+        dspStats_pair2(&pair[k], a[k], b[k]);
+      }
+      dspFused_frame(fk, a, &o);
+      dspFused_frame(fk, b, &o);
+      p += 2U * ADC_CONVERSIONS_CHANNEL_COUNT;
+    }
+    dspFused_flushStats(fk, pair, n);
+    f += n;
+  }
+
+  if (f < frames) {
+    uint32_t a[DSP_FUSED_PAIRS];
+    for (uint8_t k = 0; k < DSP_FUSED_PAIRS; k++) {
+      a[k] = dspFused_load(p, k);
+    }
+    dspFused_addFrameStats(fk, p);
+    dspFused_frame(fk, a, &o);
+  }
+  return (uint32_t)(o - out) / ADC_CONVERSIONS_CHANNEL_COUNT;
+}
+
+HAL_StatusTypeDef dspFused_getStats(DSP_Fused_t *fk, ADC_ChannelStats_t *stats,
+                                    uint8_t reset) {
+  if (fk == NULL || stats == NULL) {
+    return HAL_ERROR;
+  }
+  DSP_StatsAccum_t acc[ADC_CONVERSIONS_CHANNEL_COUNT];
+
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  memcpy(acc, fk->stats, sizeof(acc));
+  if (reset) {
+    dspStats_reset(fk->stats);
+  }
+  __set_PRIMASK(primask);
+
+  for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+    dspStats_compute(&acc[ch], &stats[ch]);
+  }
+  return HAL_OK;
+}
@@ -0,0 +1,172 @@
+/**
+ ******************************************************************************
+ * @file    dsp_goertzel.c
+ * @brief   Implementation of the Goertzel filter bank
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "dsp_goertzel.h"
+#include "adc_sections.h"
+#include <math.h>
+#include <string.h>
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+ * @brief Nearest bin of a frequency, 0 if it is not strictly between DC and
+ *        Nyquist
+ */
+static uint32_t dspGoertzel_bin(const DSP_Goertzel_t *gz, float32_t hz) {
+  const float32_t k = hz * (float32_t)gz->length / gz->sample_rate_hz + 0.5f;
+  if (!(k >= 1.0f) || k >= (float32_t)(gz->length / 2U)) {
+    return 0;
+  }
+  return (uint32_t)k;
+}
+
+/**
+ * @brief Coefficients of one channel from its set frequencies
+ */
+static void dspGoertzel_tune(DSP_Goertzel_t *gz, uint8_t ch) {
+  const float32_t bin_hz = gz->sample_rate_hz / (float32_t)gz->length;
+  uint8_t n = 0;
+  for (uint8_t b = 0; b < gz->set_count[ch]; b++) {
+    const uint32_t k = dspGoertzel_bin(gz, gz->hz[ch][b]);
+    if (k == 0U) {
+      continue; // above Nyquist at this rate; back when the rate returns
+    }
+    gz->bin_hz[ch][n] = (float32_t)k * bin_hz;
+    // cosf, not the table: a coefficient error detunes low bins the most
+    gz->coef[ch][n] =
+        2.0f * cosf(2.0f * PI * (float32_t)k / (float32_t)gz->length);
+    n++;
+  }
+  gz->bin_count[ch] = n;
+}
+
+/**
+ * @brief Start an empty window
+ */
+static void dspGoertzel_restart(DSP_Goertzel_t *gz) {
+  memset(gz->s1, 0, sizeof(gz->s1));
+  memset(gz->s2, 0, sizeof(gz->s2));
+  memset(gz->sum, 0, sizeof(gz->sum));
+  gz->samples += gz->count;
+  gz->count = 0;
+}
+
+/* Public functions ----------------------------------------------------------*/
+
+HAL_StatusTypeDef dspGoertzel_init(DSP_Goertzel_t *gz, float32_t sample_rate_hz,
+                                   uint16_t length, const uint8_t *channel_map) {
+  if (gz == NULL || !(sample_rate_hz > 0.0f) ||
+      length < DSP_GOERTZEL_LENGTH_MIN) {
+    return HAL_ERROR;
+  }
+  memset(gz, 0, sizeof(*gz));
+  gz->sample_rate_hz = sample_rate_hz;
+  gz->length = length;
+  for (uint8_t s = 0; s < ADC_CONVERSIONS_CHANNEL_COUNT; s++) {
+    gz->slot_channel[s] = (channel_map != NULL) ? channel_map[s] : s;
+  }
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef dspGoertzel_setBins(DSP_Goertzel_t *gz, uint8_t channel,
+                                      const float32_t *hz, uint8_t count) {
+  if (gz == NULL || channel >= ADC_CONVERSIONS_CHANNEL_COUNT ||
+      count > DSP_GOERTZEL_MAX_BINS || (hz == NULL && count != 0U)) {
+    return HAL_ERROR;
+  }
+  for (uint8_t b = 0; b < count; b++) {
+    if (dspGoertzel_bin(gz, hz[b]) == 0U) {
+      return HAL_ERROR;
+    }
+  }
+
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  memcpy(gz->hz[channel], hz, count * sizeof(float32_t));
+  gz->set_count[channel] = count;
+  dspGoertzel_tune(gz, channel);
+  dspGoertzel_restart(gz);
+  __set_PRIMASK(primask);
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef dspGoertzel_setSampleRate(DSP_Goertzel_t *gz,
+                                            float32_t sample_rate_hz) {
+  if (gz == NULL || !(sample_rate_hz > 0.0f)) {
+    return HAL_ERROR;
+  }
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  gz->sample_rate_hz = sample_rate_hz;
+  for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+    dspGoertzel_tune(gz, ch);
+  }
+  dspGoertzel_restart(gz);
+  __set_PRIMASK(primask);
+  return HAL_OK;
+}
+
+ADC_FAST_CODE void dspGoertzel_publish(DSP_Goertzel_t *gz) {
+  const uint32_t seq = gz->result_seq + 1U;
+  DSP_GoertzelResult_t *res = &gz->result[seq & 1U];
+  const float32_t scale = 2.0f / (float32_t)gz->count;
+
+  res->sequence = seq;
+  res->first = gz->samples;
+  for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+    const uint8_t n = gz->bin_count[ch];
+    res->bin_count[ch] = n;
+    for (uint8_t b = 0; b < n; b++) {
+      const float32_t s1 = gz->s1[ch][b];
+      const float32_t s2 = gz->s2[ch][b];
+      float32_t power = s1 * s1 + s2 * s2 - gz->coef[ch][b] * s1 * s2;
+      float32_t mag;
+      arm_sqrt_f32((power > 0.0f) ? power : 0.0f, &mag);
+      res->hz[ch][b] = gz->bin_hz[ch][b];
+      res->amplitude[ch][b] = mag * scale;
+    }
+    // This window's mean is the next one's DC estimate
+    gz->dc[ch] = gz->sum[ch] / (float32_t)gz->count;
+  }
+  __DMB();
+  gz->result_seq = seq;
+  dspGoertzel_restart(gz);
+}
+
+ADC_FAST_CODE void dspGoertzel_process(DSP_Goertzel_t *gz,
+                                       const uint16_t *block,
+                                       uint32_t frames) {
+  if (gz == NULL || block == NULL) {
+    return;
+  }
+  const uint16_t *p = block;
+  for (uint32_t f = 0; f < frames; f++) {
+    for (uint8_t s = 0; s < ADC_CONVERSIONS_CHANNEL_COUNT; s++) {
+      dspGoertzel_push(gz, gz->slot_channel[s], (float32_t)p[s]);
+    }
+    dspGoertzel_endFrame(gz);
+    p += ADC_CONVERSIONS_CHANNEL_COUNT;
+  }
+}
+
+HAL_StatusTypeDef dspGoertzel_getResult(DSP_Goertzel_t *gz,
+                                        DSP_GoertzelResult_t *result) {
+  if (gz == NULL || result == NULL) {
+    return HAL_ERROR;
+  }
+  const uint32_t seq = gz->result_seq;
+  if (seq == gz->read_seq) {
+    return HAL_BUSY;
+  }
+  __DMB();
+  // Rewritten by the window after next
+  *result = gz->result[seq & 1U];
+  gz->read_seq = seq;
+  return HAL_OK;
+}
@@ -0,0 +1,138 @@
+/**
+ ******************************************************************************
+ * @file    dsp_histogram.c
+ * @brief   Implementation of the per-channel amplitude histogram
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "dsp_histogram.h"
+#include "adc_sections.h"
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+#if DSP_HISTOGRAM_MAX_BINS < 64U || DSP_HISTOGRAM_MAX_BINS > 4096U ||         \
+    (DSP_HISTOGRAM_MAX_BINS & (DSP_HISTOGRAM_MAX_BINS - 1U)) != 0U
+#error "DSP_HISTOGRAM_MAX_BINS must be a power of two in 64..4096"
+#endif
+
+/* Public functions ----------------------------------------------------------*/
+
+HAL_StatusTypeDef dspHistogram_init(DSP_Histogram_t *hg, uint8_t shift,
+                                    const uint8_t *channel_map) {
+  if (hg == NULL || shift > DSP_HISTOGRAM_MAX_SHIFT ||
+      (DSP_HISTOGRAM_CODES >> shift) > DSP_HISTOGRAM_MAX_BINS) {
+    return HAL_ERROR;
+  }
+  memset(hg, 0, sizeof(*hg));
+  hg->shift = shift;
+  hg->bin_count = (uint16_t)(DSP_HISTOGRAM_CODES >> shift);
+  for (uint8_t s = 0; s < ADC_CONVERSIONS_CHANNEL_COUNT; s++) {
+    hg->slot_channel[s] = (channel_map != NULL) ? channel_map[s] : s;
+  }
+  return HAL_OK;
+}
+
+ADC_FAST_CODE void dspHistogram_process(DSP_Histogram_t *hg,
+                                        const uint16_t *block,
+                                        uint32_t frames) {
+  if (hg == NULL || block == NULL || hg->bin_count == 0U) {
+    return;
+  }
+  const uint8_t shift = hg->shift;
+  const uint16_t *p = block;
+  for (uint32_t f = 0; f < frames; f++) {
+    for (uint8_t s = 0; s < ADC_CONVERSIONS_CHANNEL_COUNT; s++) {
+      hg->counts[s][(p[s] & DSP_HISTOGRAM_CODE_MASK) >> shift]++;
+    }
+    p += ADC_CONVERSIONS_CHANNEL_COUNT;
+  }
+  hg->frames += frames;
+}
+
+void dspHistogram_reset(DSP_Histogram_t *hg) {
+  if (hg == NULL) {
+    return;
+  }
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  memset(hg->counts, 0, sizeof(hg->counts));
+  hg->frames = 0;
+  __set_PRIMASK(primask);
+}
+
+HAL_StatusTypeDef dspHistogram_snapshot(DSP_Histogram_t *hg, uint8_t channel,
+                                        DSP_HistogramSnapshot_t *snap,
+                                        uint8_t reset) {
+  if (hg == NULL || snap == NULL ||
+      channel >= ADC_CONVERSIONS_CHANNEL_COUNT) {
+    return HAL_ERROR;
+  }
+  uint8_t slot = 0;
+  while (slot < ADC_CONVERSIONS_CHANNEL_COUNT - 1U &&
+         hg->slot_channel[slot] != channel) {
+    slot++;
+  }
+  snap->channel = channel;
+  snap->shift = hg->shift;
+  snap->bin_count = hg->bin_count;
+
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  memcpy(snap->counts, hg->counts[slot],
+         hg->bin_count * sizeof(snap->counts[0]));
+  snap->total = hg->frames;
+  if (reset) {
+    memset(hg->counts, 0, sizeof(hg->counts));
+    hg->frames = 0;
+  }
+  __set_PRIMASK(primask);
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef dspHistogram_percentiles(const DSP_HistogramSnapshot_t *snap,
+                                           const float32_t *pct, uint8_t n,
+                                           float32_t *code) {
+  if (snap == NULL || pct == NULL || code == NULL) {
+    return HAL_ERROR;
+  }
+  for (uint8_t i = 0; i < n; i++) {
+    if (!(pct[i] >= 0.0f) || pct[i] > 100.0f ||
+        (i > 0U && pct[i] < pct[i - 1U])) {
+      return HAL_ERROR;
+    }
+  }
+  if (snap->total == 0U) {
+    return HAL_BUSY;
+  }
+
+  // Bin b spreads its count evenly over codes (b << shift) - 0.5 up to
+  // ((b + 1) << shift) - 0.5, so a single code reads as itself
+  const float32_t width = (float32_t)(1U << snap->shift);
+  uint32_t cum = 0;
+  uint16_t b = 0;
+  for (uint8_t i = 0; i < n; i++) {
+    const float32_t target = pct[i] / 100.0f * (float32_t)snap->total;
+    while (b + 1U < snap->bin_count &&
+           (float32_t)(cum + snap->counts[b]) < target) {
+      cum += snap->counts[b];
+      b++;
+    }
+    // Skip empty bins below the first sample (the 0th percentile)
+    while (b + 1U < snap->bin_count && snap->counts[b] == 0U) {
+      b++;
+    }
+    float32_t frac = (snap->counts[b] != 0U)
+                         ? (target - (float32_t)cum) /
+                               (float32_t)snap->counts[b]
+                         : 1.0f;
+    if (frac < 0.0f) {
+      frac = 0.0f;
+    } else if (frac > 1.0f) {
+      frac = 1.0f;
+    }
+    code[i] = ((float32_t)b + frac) * width - 0.5f;
+  }
+  return HAL_OK;
+}
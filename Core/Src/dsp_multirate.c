@@ -0,0 +1,338 @@
+/**
+ ******************************************************************************
+ * @file    dsp_multirate.c
+ * @brief   Implementation of the multi-rate decimation tree
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "dsp_multirate.h"
+#include "adc_sections.h"
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define DSP_MULTIRATE_CIC_MAX_GAIN 32768U // q15 input + R^N stays in 31 bits
+#define DSP_MULTIRATE_CODE_MID 2048
+#define DSP_MULTIRATE_CODE_SHIFT 3U // 12-bit code -> q15 full scale
+#define DSP_MULTIRATE_BIAS_SHIFT                                               \
+  (DSP_DCTRACK_FRAC_BITS - DSP_MULTIRATE_CODE_SHIFT) // q16 codes -> q15
+
+/* Private variables ---------------------------------------------------------*/
+
+/* Per-channel scratch, CPU only: kept in DTCM */
+static q15_t work[2][DSP_MULTIRATE_MAX_BLOCK] ADC_FAST_BSS;
+static q15_t fir_in[DSP_MULTIRATE_MAX_BLOCK + DSP_MULTIRATE_MAX_FIR_FACTOR -
+                    1U] ADC_FAST_BSS;
+
+/* Coefficient table ---------------------------------------------------------*/
+
+/* Hamming-windowed sinc, fc = 400 Hz at fs = 4 kHz: -6 dB at 400 Hz,
+ * -27 dB at the 500 Hz output Nyquist, < -50 dB from 600 Hz */
+static const q15_t fir1kHz_taps[48] = {
+    29,    39,    38,    18,    -24,   -81,   -131,  -136,  -66,   83,
+    270,   411,   407,   189,   -229,  -727,  -1093, -1084, -515,  657,
+    2287,  4057,  5561,  6424,  6424,  5561,  4057,  2287,  657,   -515,
+    -1084, -1093, -727,  -229,  189,   407,   411,   270,   83,    -66,
+    -136,  -131,  -81,   -24,   18,    38,    39,    29};
+
+/* Frequency-sampled at fs = 40 Hz with the inverse of the 3rd-order /25
+ * CIC response up to 3.5 Hz, Hamming window. CIC + FIR: flat to 3 Hz,
+ * -8 dB at the 5 Hz output Nyquist, < -55 dB from 8 Hz */
+static const q15_t fir10HzComp_taps[32] = {
+    -17,  -28,   -29,  5,     93,    205,   234,   44,    -409, -940, -1126,
+    -485, 1211,  3690, 6184,  7752,  7752,  6184,  3690,  1211, -485, -1126,
+    -940, -409,  44,   234,   205,   93,    5,     -29,   -28,  -17};
+
+static const DSP_MultirateStage_t stage1kHz = {
+    .cic_factor = 1, .fir_factor = 4, .num_taps = 48, .taps = fir1kHz_taps};
+
+static const DSP_MultirateStage_t stage10Hz = {.cic_factor = 25,
+                                               .cic_order = 3,
+                                               .fir_factor = 4,
+                                               .num_taps = 32,
+                                               .taps = fir10HzComp_taps};
+
+const DSP_MultirateStage_t *const
+    dspMultirate_defaultStages[DSP_MULTIRATE_LEVELS] = {&stage1kHz,
+                                                        &stage10Hz};
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+ * @brief Clear the chain state of every channel and the output counters
+ */
+static void dspMultirate_restart(DSP_Multirate_t *mr) {
+  for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+    for (uint8_t l = 0; l < DSP_MULTIRATE_LEVELS; l++) {
+      const DSP_MultirateStage_t *st = mr->stage[l];
+      DSP_MultirateLane_t *ln = &mr->lane[ch][l];
+      const uint32_t m = st->fir_factor;
+      memset(ln, 0, sizeof(*ln));
+      // Largest chunk: pending (< M) + one full input, rounded down to M
+      arm_fir_decimate_init_q15(&ln->fir, st->num_taps, (uint8_t)m,
+                                (q15_t *)st->taps, ln->fir_state,
+                                ((DSP_MULTIRATE_MAX_BLOCK + m - 1U) / m) * m);
+    }
+  }
+  for (uint8_t l = 0; l < DSP_MULTIRATE_LEVELS; l++) {
+    mr->produced[l] = 0;
+    mr->blocks_done[l] = 0;
+    mr->blocks_read[l] = 0;
+  }
+}
+
+/**
+ * @brief CIC decimator, 32-bit wrap-around integrators and combs
+ *
+ * @return uint32_t Samples written to y
+ */
+static uint32_t dspMultirate_cic(DSP_MultirateLane_t *ln,
+                                 const DSP_MultirateStage_t *st, int32_t gain,
+                                 const q15_t *x, uint32_t n, q15_t *y) {
+  const uint8_t order = st->cic_order;
+  uint32_t count = 0;
+
+  for (uint32_t i = 0; i < n; i++) {
+    uint32_t v = (uint32_t)(int32_t)x[i];
+    for (uint8_t k = 0; k < order; k++) {
+      ln->integ[k] += v;
+      v = ln->integ[k];
+    }
+    if (++ln->cic_phase < st->cic_factor) {
+      continue;
+    }
+    ln->cic_phase = 0;
+    for (uint8_t k = 0; k < order; k++) {
+      const uint32_t in = v;
+      v -= ln->comb[k];
+      ln->comb[k] = in;
+    }
+    // |v| <= 32768 * R^N: the wrapped difference is the true sum
+    y[count++] =
+        (q15_t)__SSAT((int32_t)(((int64_t)(int32_t)v * gain) >> 31), 16);
+  }
+  return count;
+}
+
+/**
+ * @brief Decimating FIR over the leftover of the previous block plus x
+ *
+ * @return uint32_t Samples written to y
+ */
+static uint32_t dspMultirate_fir(DSP_MultirateLane_t *ln, uint8_t m,
+                                 const q15_t *x, uint32_t n, q15_t *y) {
+  const q15_t *src = x;
+  uint32_t total = n;
+
+  if (ln->pending_count != 0U) {
+    memcpy(fir_in, ln->pending, ln->pending_count * sizeof(q15_t));
+    memcpy(&fir_in[ln->pending_count], x, n * sizeof(q15_t));
+    src = fir_in;
+    total += ln->pending_count;
+  }
+  const uint32_t use = total - total % m;
+  if (use != 0U) {
+    arm_fir_decimate_q15(&ln->fir, (q15_t *)src, y, use);
+  }
+  ln->pending_count = (uint8_t)(total - use);
+  memcpy(ln->pending, &src[use], ln->pending_count * sizeof(q15_t));
+  return use / m;
+}
+
+/* Public functions ----------------------------------------------------------*/
+
+HAL_StatusTypeDef dspMultirate_init(DSP_Multirate_t *mr,
+                                    const DSP_MultirateStage_t *const *stages,
+                                    const uint8_t *channel_map) {
+  if (mr == NULL) {
+    return HAL_ERROR;
+  }
+  if (stages == NULL) {
+    stages = dspMultirate_defaultStages;
+  }
+
+  uint32_t factor = 1;
+  int32_t gain[DSP_MULTIRATE_LEVELS];
+  for (uint8_t l = 0; l < DSP_MULTIRATE_LEVELS; l++) {
+    const DSP_MultirateStage_t *st = stages[l];
+    if (st == NULL || st->taps == NULL || st->num_taps == 0U ||
+        st->num_taps > DSP_MULTIRATE_MAX_TAPS || st->fir_factor == 0U ||
+        st->fir_factor > DSP_MULTIRATE_MAX_FIR_FACTOR ||
+        st->cic_factor == 0U ||
+        (st->cic_factor > 1U &&
+         (st->cic_order == 0U || st->cic_order > DSP_MULTIRATE_CIC_MAX_ORDER)) ||
+        (uint32_t)st->cic_factor * st->fir_factor < 2U) {
+      return HAL_ERROR;
+    }
+    uint32_t r_n = 1;
+    for (uint8_t k = 0; st->cic_factor > 1U && k < st->cic_order; k++) {
+      r_n *= st->cic_factor;
+      if (r_n > DSP_MULTIRATE_CIC_MAX_GAIN) {
+        return HAL_ERROR;
+      }
+    }
+    gain[l] = (r_n > 1U) ? (int32_t)(((1ULL << 31) + r_n / 2U) / r_n)
+                         : INT32_MAX;
+    factor *= (uint32_t)st->cic_factor * st->fir_factor;
+    mr->factor[l] = factor;
+  }
+
+  for (uint8_t l = 0; l < DSP_MULTIRATE_LEVELS; l++) {
+    mr->stage[l] = stages[l];
+    mr->cic_gain[l] = gain[l];
+    mr->channel_mask[l] = 0;
+  }
+  for (uint8_t s = 0; s < ADC_CONVERSIONS_CHANNEL_COUNT; s++) {
+    mr->slot_channel[s] = (channel_map != NULL) ? channel_map[s] : s;
+    mr->rates[s] = 0;
+    mr->depth[s] = 0;
+  }
+  mr->dc = NULL;
+  dspMultirate_restart(mr);
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef dspMultirate_attachDcTrack(DSP_Multirate_t *mr,
+                                             const DSP_DcTrack_t *dc) {
+  if (mr == NULL) {
+    return HAL_ERROR;
+  }
+  mr->dc = dc;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef dspMultirate_setChannelRates(DSP_Multirate_t *mr,
+                                               uint8_t channel,
+                                               uint8_t levels) {
+  if (mr == NULL || channel >= ADC_CONVERSIONS_CHANNEL_COUNT ||
+      (levels >> DSP_MULTIRATE_LEVELS) != 0U) {
+    return HAL_ERROR;
+  }
+  mr->rates[channel] = levels;
+  // Run up to the highest level asked for; the ones below feed it
+  mr->depth[channel] = 0;
+  for (uint8_t l = 0; l < DSP_MULTIRATE_LEVELS; l++) {
+    if ((levels & DSP_MULTIRATE_LEVEL_BIT(l)) != 0U) {
+      mr->depth[channel] = l + 1U;
+      mr->channel_mask[l] |= (ADC_ChannelMask_t)(1UL << channel);
+    } else {
+      mr->channel_mask[l] &= (ADC_ChannelMask_t)~(1UL << channel);
+    }
+  }
+  dspMultirate_restart(mr);
+  return HAL_OK;
+}
+
+ADC_FAST_CODE void dspMultirate_process(DSP_Multirate_t *mr,
+                                        const uint16_t *block,
+                                        uint32_t frames) {
+  if (mr == NULL || block == NULL || frames == 0U ||
+      frames > ADC_CONVERSIONS_BLOCK_FRAMES) {
+    return;
+  }
+
+  uint32_t out_frames[DSP_MULTIRATE_LEVELS] = {0};
+  uint32_t idx[DSP_MULTIRATE_LEVELS];
+  for (uint8_t l = 0; l < DSP_MULTIRATE_LEVELS; l++) {
+    idx[l] = mr->blocks_done[l] & 1U;
+  }
+
+  for (uint8_t s = 0; s < ADC_CONVERSIONS_CHANNEL_COUNT; s++) {
+    const uint8_t ch = mr->slot_channel[s];
+    if (ch >= ADC_CONVERSIONS_CHANNEL_COUNT || mr->depth[ch] == 0U) {
+      continue;
+    }
+
+    // Deinterleave and centre once; each level then feeds the next
+    const uint16_t *src = &block[s];
+    if (mr->dc != NULL && mr->dc->blocks != 0U) {
+      // (code - bias) * 8 from q16: |result| <= 4095 * 8, within q15
+      const int32_t bias = dspDcTrack_getBiasQ16(mr->dc, ch);
+      for (uint32_t f = 0; f < frames; f++) {
+        work[0][f] = (q15_t)(((int32_t)((uint32_t)*src << DSP_DCTRACK_FRAC_BITS) -
+                              bias) >> DSP_MULTIRATE_BIAS_SHIFT);
+        src += ADC_CONVERSIONS_CHANNEL_COUNT;
+      }
+    } else {
+      for (uint32_t f = 0; f < frames; f++) {
+        work[0][f] = (q15_t)(((int32_t)*src - DSP_MULTIRATE_CODE_MID)
+                             << DSP_MULTIRATE_CODE_SHIFT);
+        src += ADC_CONVERSIONS_CHANNEL_COUNT;
+      }
+    }
+    q15_t *x = work[0];
+    uint32_t n = frames;
+
+    for (uint8_t l = 0; l < mr->depth[ch] && n != 0U; l++) {
+      const DSP_MultirateStage_t *st = mr->stage[l];
+      DSP_MultirateLane_t *ln = &mr->lane[ch][l];
+      q15_t *y = (x == work[0]) ? work[1] : work[0];
+
+      if (st->cic_factor > 1U) {
+        // In place: the CIC writes at most one sample per one it read
+        n = dspMultirate_cic(ln, st, mr->cic_gain[l], x, n, x);
+      }
+      n = dspMultirate_fir(ln, st->fir_factor, x, n, y);
+      x = y;
+
+      if ((mr->rates[ch] & DSP_MULTIRATE_LEVEL_BIT(l)) != 0U) {
+        q15_t *out = &mr->output[l][idx[l]][ch];
+        for (uint32_t k = 0; k < n; k++) {
+          out[k * ADC_CONVERSIONS_CHANNEL_COUNT] = x[k];
+        }
+        out_frames[l] = n;
+      }
+    }
+  }
+
+  // Every lane of a level is in step, so one count holds for all of them
+  for (uint8_t l = 0; l < DSP_MULTIRATE_LEVELS; l++) {
+    if (mr->channel_mask[l] == 0U || out_frames[l] == 0U) {
+      continue;
+    }
+    mr->output_frames[l][idx[l]] = out_frames[l];
+    mr->output_first[l][idx[l]] = mr->produced[l];
+    mr->produced[l] += out_frames[l];
+    __DMB();
+    mr->blocks_done[l]++;
+  }
+}
+
+HAL_StatusTypeDef dspMultirate_getOutput(DSP_Multirate_t *mr, uint8_t level,
+                                         const q15_t **out, uint32_t *frames,
+                                         uint32_t *first) {
+  if (mr == NULL || out == NULL || frames == NULL ||
+      level >= DSP_MULTIRATE_LEVELS) {
+    return HAL_ERROR;
+  }
+  const uint32_t done = mr->blocks_done[level];
+  if (done == mr->blocks_read[level]) {
+    return HAL_BUSY;
+  }
+  __DMB();
+  mr->blocks_read[level] = done;
+
+  const uint32_t i = (done - 1U) & 1U;
+  *out = mr->output[level][i];
+  *frames = mr->output_frames[level][i];
+  if (first != NULL) {
+    *first = mr->output_first[level][i];
+  }
+  return HAL_OK;
+}
+
+uint32_t dspMultirate_getFactor(const DSP_Multirate_t *mr, uint8_t level) {
+  if (mr == NULL || level >= DSP_MULTIRATE_LEVELS) {
+    return 0;
+  }
+  return mr->factor[level];
+}
+
+ADC_ChannelMask_t dspMultirate_getChannelMask(const DSP_Multirate_t *mr,
+                                              uint8_t level) {
+  if (mr == NULL || level >= DSP_MULTIRATE_LEVELS) {
+    return 0;
+  }
+  return mr->channel_mask[level];
+}
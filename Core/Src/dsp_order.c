@@ -0,0 +1,313 @@
+/**
+ ******************************************************************************
+ * @file    dsp_order.c
+ * @brief   Implementation of the order-tracking resampler
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "dsp_order.h"
+#include "adc_sections.h"
+#include "timebase.h"
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define DSP_ORDER_MASK (DSP_ORDER_HISTORY - 1U)
+#define DSP_ORDER_ANCHOR_GAIN 16 // anchor follows 1/16 of each stamp error
+#define DSP_ORDER_ONE 65536LL    // Q16 times: 1 timebase tick
+#define DSP_ORDER_REBASE_Q16 (DSP_ORDER_ONE << 24) // every ~17 s at 1 MHz
+
+#if (DSP_ORDER_HISTORY & DSP_ORDER_MASK) != 0U ||                              \
+    DSP_ORDER_HISTORY < 4U * ADC_CONVERSIONS_BLOCK_FRAMES
+#error "DSP_ORDER_HISTORY must be a power of two of at least four blocks"
+#endif
+
+#if (DSP_ORDER_EDGES & (DSP_ORDER_EDGES - 1U)) != 0U
+#error "DSP_ORDER_EDGES must be a power of two"
+#endif
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+ * @brief Floor division of a signed time by the (positive) frame period
+ */
+static int64_t dspOrder_floorDiv(int64_t t, int64_t period, int64_t *rem) {
+  int64_t k = t / period;
+  int64_t r = t - k * period;
+  if (r < 0) {
+    k--;
+    r += period;
+  }
+  *rem = r;
+  return k;
+}
+
+/**
+ * @brief An edge interval at min_rpm, plus a block in flight and one being
+ *        written, fits the history
+ */
+static uint8_t dspOrder_fits(const DSP_OrderConfig_t *cfg,
+                             float32_t sample_rate_hz) {
+  const float32_t interval_s =
+      60.0f / (cfg->min_rpm * (float32_t)cfg->pulses_per_rev);
+  return (interval_s * sample_rate_hz +
+              2.0f * (float32_t)ADC_CONVERSIONS_BLOCK_FRAMES <
+          (float32_t)DSP_ORDER_HISTORY)
+             ? 1U
+             : 0U;
+}
+
+/**
+ * @brief Frame period in timebase ticks (Q16)
+ */
+static int64_t dspOrder_periodQ16(float32_t sample_rate_hz) {
+  return (int64_t)((float32_t)TIMEBASE_TICK_HZ * (float32_t)DSP_ORDER_ONE /
+                       sample_rate_hz +
+                   0.5f);
+}
+
+/* Public functions ----------------------------------------------------------*/
+
+HAL_StatusTypeDef dspOrder_init(DSP_Order_t *ord, uint8_t channel,
+                                const uint8_t *channel_map,
+                                const DSP_OrderConfig_t *cfg) {
+  if (ord == NULL || cfg == NULL || channel >= ADC_CONVERSIONS_CHANNEL_COUNT ||
+      cfg->pulses_per_rev == 0U || cfg->samples_per_rev == 0U ||
+      cfg->samples_per_rev % cfg->pulses_per_rev != 0U ||
+      cfg->sample_rate_hz <= 0.0f || cfg->min_rpm <= 0.0f) {
+    return HAL_ERROR;
+  }
+  if (!dspOrder_fits(cfg, cfg->sample_rate_hz)) {
+    return HAL_ERROR;
+  }
+
+  memset(ord, 0, sizeof(*ord));
+  ord->cfg = *cfg;
+  ord->channel = channel;
+  ord->slot = channel;
+  if (channel_map != NULL) {
+    for (uint8_t s = 0; s < ADC_CONVERSIONS_CHANNEL_COUNT; s++) {
+      if (channel_map[s] == channel) {
+        ord->slot = s;
+      }
+    }
+  }
+  ord->period_q16 = dspOrder_periodQ16(cfg->sample_rate_hz);
+  ord->max_interval =
+      (uint64_t)(60.0f * (float32_t)TIMEBASE_TICK_HZ /
+                 (cfg->min_rpm * (float32_t)cfg->pulses_per_rev));
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef dspOrder_setSampleRate(DSP_Order_t *ord,
+                                         float32_t sample_rate_hz) {
+  if (ord == NULL || sample_rate_hz <= 0.0f) {
+    return HAL_ERROR;
+  }
+  ord->cfg.sample_rate_hz = sample_rate_hz;
+  ord->resync = 1;
+  if (!dspOrder_fits(&ord->cfg, sample_rate_hz)) {
+    ord->period_q16 = 0; // process() and poll() idle
+    return HAL_ERROR;
+  }
+  ord->period_q16 = dspOrder_periodQ16(sample_rate_hz);
+  return HAL_OK;
+}
+
+ADC_HOT_CODE void dspOrder_process(DSP_Order_t *ord, const uint16_t *block,
+                                   uint32_t frames,
+                                   const ADC_BlockInfo_t *info) {
+  if (ord == NULL || block == NULL || info == NULL || frames == 0U ||
+      ord->period_q16 == 0) {
+    return;
+  }
+
+  // A jump in the numbering (scan restarted) or a new frame period: model
+  // and history start over
+  const uint8_t restart = (ord->epoch == 0U || ord->resync ||
+                           info->first_frame != ord->next_frame);
+  if (restart) {
+    ord->resync = 0;
+    if (ord->epoch != 0U) {
+      ord->status.restarts++;
+    }
+    ord->epoch++;
+    ord->epoch_first = info->first_frame;
+    ord->time_base = info->timestamp;
+  }
+
+  const uint16_t *src = &block[ord->slot];
+  for (uint32_t f = 0; f < frames; f++) {
+    ord->history[(info->first_frame + f) & DSP_ORDER_MASK] = (float32_t)*src;
+    src += ADC_CONVERSIONS_CHANNEL_COUNT;
+  }
+
+  // The stamp belongs to the block's last frame. Times are kept relative
+  // to time_base, so Q16 never runs out of 64 bits.
+  const uint32_t last = info->first_frame + frames - 1U;
+  const int64_t stamp =
+      (int64_t)(info->timestamp - ord->time_base) * DSP_ORDER_ONE;
+  if (restart) {
+    ord->anchor_q16 = stamp;
+  } else {
+    const int64_t predicted =
+        ord->anchor_q16 +
+        (int64_t)(int32_t)(last - ord->anchor_frame) * ord->period_q16;
+    ord->anchor_q16 =
+        predicted + (stamp - predicted) / DSP_ORDER_ANCHOR_GAIN;
+  }
+  if (ord->anchor_q16 >= DSP_ORDER_REBASE_Q16) {
+    const int64_t whole = ord->anchor_q16 / DSP_ORDER_ONE;
+    ord->time_base += (uint64_t)whole;
+    ord->anchor_q16 -= whole * DSP_ORDER_ONE;
+  }
+  ord->anchor_frame = last;
+  ord->next_frame = last + 1U;
+  __DMB();
+  ord->newest = last;
+}
+
+void dspOrder_pushEdge(DSP_Order_t *ord, uint64_t time) {
+  if (ord == NULL) {
+    return;
+  }
+  if (ord->edge_head - ord->edge_tail >= DSP_ORDER_EDGES) {
+    ord->status.dropped_edges++;
+    return;
+  }
+  ord->edges[ord->edge_head & (DSP_ORDER_EDGES - 1U)] = time;
+  ord->edge_head++;
+}
+
+uint32_t dspOrder_poll(DSP_Order_t *ord, DSP_Spectrum_t *sp) {
+  if (ord == NULL || sp == NULL || ord->period_q16 == 0) {
+    return 0;
+  }
+
+  // One consistent view of the model; the block callback moves it
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  const uint32_t epoch = ord->epoch;
+  const uint32_t first = ord->epoch_first;
+  const uint32_t newest = ord->newest;
+  const uint32_t anchor_frame = ord->anchor_frame;
+  const int64_t anchor_q16 = ord->anchor_q16;
+  const uint64_t time_base = ord->time_base;
+  __set_PRIMASK(primask);
+  if (epoch == 0U) {
+    return 0; // no frames yet
+  }
+  if (epoch != ord->seen_epoch) {
+    // The interval in progress straddles the restart
+    ord->seen_epoch = epoch;
+    ord->have_edge = 0;
+  }
+
+  const uint32_t per_edge =
+      (uint32_t)(ord->cfg.samples_per_rev / ord->cfg.pulses_per_rev);
+  const int64_t period = ord->period_q16;
+  uint32_t produced = 0;
+  uint32_t n_out = 0;
+  uint8_t waiting = 0;
+
+  while (!waiting && ord->edge_tail != ord->edge_head) {
+    const uint64_t edge_end =
+        ord->edges[ord->edge_tail & (DSP_ORDER_EDGES - 1U)];
+    const uint64_t span = edge_end - ord->edge_start;
+    if (!ord->have_edge || span > ord->max_interval) {
+      if (ord->have_edge) {
+        ord->status.gaps++; // stopped or lost pulses: restart here
+      }
+      ord->have_edge = 1;
+      ord->edge_start = edge_end;
+      ord->step = 0;
+      ord->pulse = 0;
+      ord->edge_tail++;
+      if (ord->tsa != NULL) {
+        // A single pulse is the same angle again; of several, any one
+        dspTsa_restart(ord->tsa, (ord->cfg.pulses_per_rev == 1U) ? 1U : 0U);
+      }
+      continue;
+    }
+
+    for (; ord->step < per_edge; ord->step++) {
+      const int64_t t =
+          (int64_t)(ord->edge_start - time_base) * DSP_ORDER_ONE +
+          (int64_t)(span * (uint64_t)DSP_ORDER_ONE * ord->step / per_edge);
+      int64_t rem;
+      const int64_t k = dspOrder_floorDiv(t - anchor_q16, period, &rem);
+      const uint32_t n = anchor_frame + (uint32_t)(int32_t)k;
+      const int32_t ahead = (int32_t)(newest - n);
+      if (ahead < 1) {
+        waiting = 1; // frame n + 1 is not in yet
+        break;
+      }
+      if ((uint32_t)ahead >=
+              DSP_ORDER_HISTORY - ADC_CONVERSIONS_BLOCK_FRAMES ||
+          (int32_t)(n - first) < 0) {
+        ord->status.stale++;
+        if (ord->tsa != NULL) {
+          dspTsa_skip(ord->tsa);
+        }
+        continue;
+      }
+      const float32_t x0 = ord->history[n & DSP_ORDER_MASK];
+      const float32_t x1 = ord->history[(n + 1U) & DSP_ORDER_MASK];
+      const float32_t x =
+          x0 + (x1 - x0) * ((float32_t)rem / (float32_t)period);
+      ord->out[n_out++] = x;
+      if (ord->tsa != NULL) {
+        dspTsa_add(ord->tsa,
+                   (uint16_t)(ord->pulse * per_edge + ord->step), x);
+      }
+      produced++;
+      if (n_out == DSP_ORDER_CHUNK) {
+        dspSpectrum_pushSamples(sp, ord->out, n_out);
+        n_out = 0;
+      }
+    }
+    if (waiting) {
+      break;
+    }
+
+    ord->intervals++;
+    ord->status.rpm =
+        60.0f * (float32_t)TIMEBASE_TICK_HZ /
+        ((float32_t)span * (float32_t)ord->cfg.pulses_per_rev);
+    ord->edge_start = edge_end;
+    ord->step = 0;
+    if (++ord->pulse == ord->cfg.pulses_per_rev) {
+      ord->pulse = 0;
+    }
+    ord->edge_tail++;
+  }
+
+  if (n_out != 0U) {
+    dspSpectrum_pushSamples(sp, ord->out, n_out);
+  }
+  ord->status.samples += produced;
+  ord->status.revolutions = ord->intervals / ord->cfg.pulses_per_rev;
+  return produced;
+}
+
+HAL_StatusTypeDef dspOrder_getStatus(const DSP_Order_t *ord,
+                                     DSP_OrderStatus_t *status) {
+  if (ord == NULL || status == NULL) {
+    return HAL_ERROR;
+  }
+  *status = ord->status;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef dspOrder_attachTsa(DSP_Order_t *ord, DSP_Tsa_t *tsa) {
+  if (ord == NULL ||
+      (tsa != NULL && tsa->cfg.samples_per_rev != ord->cfg.samples_per_rev)) {
+    return HAL_ERROR;
+  }
+  if (tsa != NULL) {
+    dspTsa_restart(tsa, 0); // fills from the next revolution's start
+  }
+  ord->tsa = tsa;
+  return HAL_OK;
+}
@@ -0,0 +1,222 @@
+/**
+ ******************************************************************************
+ * @file    dsp_oversample.c
+ * @brief   Implementation of the SIMD oversample-and-decimate stage
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "dsp_oversample.h"
+#include "adc_sections.h"
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define DSP_OVERSAMPLE_ADC_BITS 12U
+#define DSP_OVERSAMPLE_DEFAULT_RATIO 16U
+#define DSP_OVERSAMPLE_DEFAULT_BITS 14U
+
+/* Frames that can be summed in a 16-bit lane: 16 x 4095 = 65520 */
+#define DSP_OVERSAMPLE_LANE_FRAMES 16U
+
+/* Words per frame: channel pairs (0,1) (2,3) ...; an odd last slot is
+ * summed on its own */
+#define DSP_OVERSAMPLE_FRAME_WORDS (ADC_CONVERSIONS_CHANNEL_COUNT / 2U)
+#define DSP_OVERSAMPLE_TAIL_SLOT (ADC_CONVERSIONS_CHANNEL_COUNT - 1U)
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+ * @brief Two adjacent samples as one word (compiles to a single LDR)
+ */
+static inline uint32_t dspOversample_load2(const uint16_t *p) {
+  uint32_t v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+static uint8_t dspOversample_log2(uint16_t v) {
+  uint8_t n = 0;
+  while (v > 1U) {
+    v >>= 1;
+    n++;
+  }
+  return n;
+}
+
+/**
+ * @brief Smallest ratio decides how many frames go through the 16-bit lanes
+ *        before widening; it divides every ratio since all are powers of two
+ */
+static void dspOversample_updateChunk(DSP_Oversampler_t *os) {
+  uint16_t chunk = DSP_OVERSAMPLE_LANE_FRAMES;
+  for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+    if (os->ratio[ch] < chunk) {
+      chunk = os->ratio[ch];
+    }
+  }
+  os->chunk = chunk;
+}
+
+/**
+ * @brief Restart every running sum so all channels share the chunk phase
+ */
+static void dspOversample_restart(DSP_Oversampler_t *os) {
+  for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+    os->sum[ch] = 0;
+    os->count[ch] = 0;
+  }
+}
+
+/**
+ * @brief Add n frames worth of one channel and emit a result at the ratio
+ */
+ADC_FAST_CODE static void dspOversample_add(DSP_Oversampler_t *os, uint8_t ch,
+                                            uint32_t value, uint16_t n) {
+  os->sum[ch] += value;
+  os->count[ch] += n;
+  if (os->count[ch] < os->ratio[ch]) {
+    return;
+  }
+
+  uint16_t result = (uint16_t)(os->sum[ch] >> os->shift[ch]);
+  os->sum[ch] = 0;
+  os->count[ch] = 0;
+  os->output[ch] = result;
+  __DMB();
+  os->output_seq[ch]++;
+
+  if (os->callback != NULL) {
+    os->callback(ch, result, os->callback_ctx);
+  }
+}
+
+/**
+ * @brief Scalar path for frames outside a whole chunk
+ */
+static void dspOversample_addFrame(DSP_Oversampler_t *os,
+                                   const uint16_t *frame) {
+  for (uint8_t s = 0; s < ADC_CONVERSIONS_CHANNEL_COUNT; s++) {
+    dspOversample_add(os, os->slot_channel[s], frame[s], 1U);
+  }
+}
+
+/* Public functions ----------------------------------------------------------*/
+
+HAL_StatusTypeDef dspOversample_init(DSP_Oversampler_t *os,
+                                     const uint8_t *channel_map) {
+  if (os == NULL) {
+    return HAL_ERROR;
+  }
+  memset(os, 0, sizeof(*os));
+  for (uint8_t s = 0; s < ADC_CONVERSIONS_CHANNEL_COUNT; s++) {
+    os->slot_channel[s] = (channel_map != NULL) ? channel_map[s] : s;
+    os->ratio[s] = DSP_OVERSAMPLE_DEFAULT_RATIO;
+    os->shift[s] = dspOversample_log2(DSP_OVERSAMPLE_DEFAULT_RATIO) -
+                   (DSP_OVERSAMPLE_DEFAULT_BITS - DSP_OVERSAMPLE_ADC_BITS);
+  }
+  dspOversample_updateChunk(os);
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef dspOversample_configChannel(DSP_Oversampler_t *os,
+                                              uint8_t channel, uint16_t ratio,
+                                              uint8_t bits) {
+  if (os == NULL || channel >= ADC_CONVERSIONS_CHANNEL_COUNT ||
+      ratio < DSP_OVERSAMPLE_RATIO_MIN || ratio > DSP_OVERSAMPLE_RATIO_MAX ||
+      (ratio & (ratio - 1U)) != 0U || bits < DSP_OVERSAMPLE_BITS_MIN ||
+      bits > DSP_OVERSAMPLE_BITS_MAX) {
+    return HAL_ERROR;
+  }
+
+  uint8_t log2_ratio = dspOversample_log2(ratio);
+  uint8_t extra_bits = bits - DSP_OVERSAMPLE_ADC_BITS;
+  if (extra_bits > log2_ratio) {
+    return HAL_ERROR;
+  }
+
+  os->ratio[channel] = ratio;
+  os->shift[channel] = log2_ratio - extra_bits;
+  dspOversample_updateChunk(os);
+  dspOversample_restart(os);
+  return HAL_OK;
+}
+
+void dspOversample_setCallback(DSP_Oversampler_t *os,
+                               DSP_OversampleCallback_t callback, void *ctx) {
+  if (os == NULL) {
+    return;
+  }
+  os->callback = NULL;
+  os->callback_ctx = ctx;
+  os->callback = callback;
+}
+
+ADC_FAST_CODE void dspOversample_process(DSP_Oversampler_t *os,
+                                         const uint16_t *block,
+                                         uint32_t frames) {
+  if (os == NULL || block == NULL) {
+    return;
+  }
+
+  const uint16_t chunk = os->chunk;
+  const uint8_t *map = os->slot_channel;
+  uint32_t f = 0;
+
+  // Realign to a chunk boundary after a partial block (counts share a phase)
+  while (f < frames && (os->count[map[0]] % chunk) != 0U) {
+    dspOversample_addFrame(os, &block[f * ADC_CONVERSIONS_CHANNEL_COUNT]);
+    f++;
+  }
+
+  for (; f + chunk <= frames; f += chunk) {
+    const uint16_t *p = &block[f * ADC_CONVERSIONS_CHANNEL_COUNT];
+    uint32_t acc[DSP_OVERSAMPLE_FRAME_WORDS] = {0};
+    uint32_t tail = 0;
+
+    // Two channels per instruction; lanes cannot carry within a chunk
+    for (uint16_t j = 0; j < chunk; j++) {
+      for (uint8_t w = 0; w < DSP_OVERSAMPLE_FRAME_WORDS; w++) {
+        acc[w] = __UADD16(acc[w], dspOversample_load2(&p[2U * w]));
+      }
+      if (ADC_CONVERSIONS_CHANNEL_COUNT % 2U != 0U) {
+        tail += p[DSP_OVERSAMPLE_TAIL_SLOT];
+      }
+      p += ADC_CONVERSIONS_CHANNEL_COUNT;
+    }
+
+    for (uint8_t w = 0; w < DSP_OVERSAMPLE_FRAME_WORDS; w++) {
+      dspOversample_add(os, map[2U * w], acc[w] & 0xFFFFU, chunk);
+      dspOversample_add(os, map[2U * w + 1U], acc[w] >> 16, chunk);
+    }
+    if (ADC_CONVERSIONS_CHANNEL_COUNT % 2U != 0U) {
+      dspOversample_add(os, map[DSP_OVERSAMPLE_TAIL_SLOT], tail, chunk);
+    }
+  }
+
+  for (; f < frames; f++) {
+    dspOversample_addFrame(os, &block[f * ADC_CONVERSIONS_CHANNEL_COUNT]);
+  }
+}
+
+void dspOversample_blockCallback(const uint16_t *block, uint32_t frame_count,
+                                 void *ctx) {
+  dspOversample_process((DSP_Oversampler_t *)ctx, block, frame_count);
+}
+
+HAL_StatusTypeDef dspOversample_getOutput(DSP_Oversampler_t *os,
+                                          uint8_t channel, uint16_t *value) {
+  if (os == NULL || value == NULL ||
+      channel >= ADC_CONVERSIONS_CHANNEL_COUNT) {
+    return HAL_ERROR;
+  }
+
+  uint32_t seq = os->output_seq[channel];
+  if (seq == os->read_seq[channel]) {
+    return HAL_BUSY;
+  }
+  __DMB();
+  *value = os->output[channel];
+  os->read_seq[channel] = seq;
+  return HAL_OK;
+}
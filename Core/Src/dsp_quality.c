@@ -0,0 +1,201 @@
+/**
+ ******************************************************************************
+ * @file    dsp_quality.c
+ * @brief   Implementation of the FFT-based ADC quality figures
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "dsp_quality.h"
+#include <math.h>
+
+/* Private defines -----------------------------------------------------------*/
+#if DSP_QUALITY_LENGTH_MAX < DSP_QUALITY_LENGTH_MIN ||                        \
+    DSP_QUALITY_LENGTH_MAX > 4096U
+#error "DSP_QUALITY_LENGTH_MAX must be in 256..4096"
+#endif
+
+#define DSP_QUALITY_TAKEN (-1.0f)  // bin already counted in a lobe
+#define DSP_QUALITY_FLOOR 1e-20f   // keeps an empty power out of log10(0)
+
+/* Private variables ---------------------------------------------------------*/
+
+/* Windowed record, then its power spectrum; and the rfft output */
+static float32_t work_in[DSP_QUALITY_LENGTH_MAX];
+static float32_t work_out[DSP_QUALITY_LENGTH_MAX];
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+ * @brief 7-term Blackman-Harris, periodic, at point n of len
+ */
+static float32_t dspQuality_window(uint32_t n, uint32_t len) {
+  static const float32_t a[7] = {0.27105140069342f, 0.43329793923448f,
+                                 0.21812299954311f, 0.06592544638803f,
+                                 0.01081174209837f, 0.00077658482522f,
+                                 0.00001388721735f};
+  // cosf, not arm_cos_f32: the table's interpolation error would show as
+  // sidelobes above a 12-bit noise floor
+  const float32_t c1 = cosf(2.0f * PI * (float32_t)n / (float32_t)len);
+  float32_t prev = 1.0f;
+  float32_t cur = c1;
+  float32_t w = a[0] - a[1] * c1;
+
+  // cos(kx) from cos(x) by the Chebyshev recurrence
+  for (uint32_t k = 2; k < 7U; k++) {
+    const float32_t next = 2.0f * c1 * cur - prev;
+    prev = cur;
+    cur = next;
+    w += ((k & 1U) != 0U) ? -a[k] * cur : a[k] * cur;
+  }
+  return w;
+}
+
+/**
+ * @brief Sum the bins of the lobe at centre not counted yet, and mark them
+ *
+ * @param power   One-sided power spectrum, bins 0..half
+ * @param half    Nyquist bin
+ * @param centre  Lobe centre bin
+ * @param moment  Adds sum p x k when not NULL (centroid)
+ * @param largest Raised to the largest bin taken when not NULL
+ */
+static float32_t dspQuality_takeLobe(float32_t *power, uint32_t half,
+                                     uint32_t centre, float32_t *moment,
+                                     float32_t *largest) {
+  const uint32_t lo =
+      (centre > DSP_QUALITY_LOBE_BINS) ? centre - DSP_QUALITY_LOBE_BINS : 0U;
+  const uint32_t hi = (centre + DSP_QUALITY_LOBE_BINS < half)
+                          ? centre + DSP_QUALITY_LOBE_BINS
+                          : half;
+  float32_t sum = 0.0f;
+
+  for (uint32_t k = lo; k <= hi; k++) {
+    const float32_t p = power[k];
+    if (p < 0.0f) {
+      continue;
+    }
+    sum += p;
+    if (moment != NULL) {
+      *moment += p * (float32_t)k;
+    }
+    if (largest != NULL && p > *largest) {
+      *largest = p;
+    }
+    power[k] = DSP_QUALITY_TAKEN;
+  }
+  return sum;
+}
+
+/**
+ * @brief Power ratio in dB
+ */
+static float32_t dspQuality_db(float32_t num, float32_t den) {
+  return 10.0f * log10f((num + DSP_QUALITY_FLOOR) /
+                        (den + DSP_QUALITY_FLOOR));
+}
+
+/* Public functions ----------------------------------------------------------*/
+
+HAL_StatusTypeDef dspQuality_analyse(const uint16_t *samples, uint32_t count,
+                                     DSP_QualityResult_t *result) {
+  if (samples == NULL || result == NULL || count < DSP_QUALITY_LENGTH_MIN) {
+    return HAL_ERROR;
+  }
+  uint32_t n = DSP_QUALITY_LENGTH_MAX;
+  while (n > count) {
+    n >>= 1;
+  }
+  arm_rfft_fast_instance_f32 rfft;
+  if (arm_rfft_fast_init_f32(&rfft, (uint16_t)n) != ARM_MATH_SUCCESS) {
+    return HAL_ERROR;
+  }
+
+  // Mean-free first, so the DC lobe holds only what the window leaves
+  uint64_t total = 0;
+  for (uint32_t i = 0; i < n; i++) {
+    total += samples[i];
+  }
+  const float32_t mean = (float32_t)total / (float32_t)n;
+  float32_t window_power = 0.0f;
+  for (uint32_t i = 0; i < n; i++) {
+    const float32_t w = dspQuality_window(i, n);
+    work_in[i] = ((float32_t)samples[i] - mean) * w;
+    window_power += w * w;
+  }
+  arm_rfft_fast_f32(&rfft, work_in, work_out, 0);
+
+  // One-sided power over work_in: the Nyquist bin has no mirror, so half
+  const uint32_t half = n / 2U;
+  float32_t *power = work_in;
+  power[0] = work_out[0] * work_out[0];
+  power[half] = 0.5f * work_out[1] * work_out[1];
+  for (uint32_t k = 1; k < half; k++) {
+    const float32_t re = work_out[2U * k];
+    const float32_t im = work_out[2U * k + 1U];
+    power[k] = re * re + im * im;
+  }
+
+  // DC lobe out; the tone is the largest bin above it, and clear of it
+  for (uint32_t k = 0; k <= DSP_QUALITY_LOBE_BINS; k++) {
+    power[k] = DSP_QUALITY_TAKEN;
+  }
+  uint32_t peak = DSP_QUALITY_LOBE_BINS + 1U;
+  for (uint32_t k = peak + 1U; k <= half; k++) {
+    if (power[k] > power[peak]) {
+      peak = k;
+    }
+  }
+  const float32_t peak_power = power[peak];
+  if (peak <= 2U * DSP_QUALITY_LOBE_BINS || peak_power <= 0.0f) {
+    return HAL_ERROR;
+  }
+  float32_t moment = 0.0f;
+  const float32_t tone_power =
+      dspQuality_takeLobe(power, half, peak, &moment, NULL);
+  const float32_t centre = moment / tone_power;
+
+  // Harmonics where they fold to; the largest of their bins is a spur
+  float32_t spur = 0.0f;
+  float32_t harmonic_power = 0.0f;
+  for (uint32_t h = 2; h <= DSP_QUALITY_HARMONICS + 1U; h++) {
+    float32_t f = fmodf(centre * (float32_t)h, (float32_t)n);
+    if (f > (float32_t)half) {
+      f = (float32_t)n - f;
+    }
+    harmonic_power += dspQuality_takeLobe(
+        power, half, (uint32_t)lroundf(f), NULL, &spur);
+  }
+
+  // What is left is noise, extended over the bins the lobes took
+  float32_t noise_sum = 0.0f;
+  uint32_t noise_bins = 0;
+  for (uint32_t k = 0; k <= half; k++) {
+    if (power[k] >= 0.0f) {
+      noise_sum += power[k];
+      noise_bins++;
+      if (power[k] > spur) {
+        spur = power[k];
+      }
+    }
+  }
+  if (noise_bins == 0U) {
+    return HAL_ERROR; // short record: the lobes covered every bin
+  }
+  const float32_t noise_power = noise_sum / (float32_t)noise_bins *
+                                (float32_t)(half - DSP_QUALITY_LOBE_BINS);
+
+  // Parseval over the window: a tone of amplitude A has N sum(w^2) A^2 / 4
+  const float32_t scale = (float32_t)n * window_power;
+  result->length = n;
+  result->tone = centre / (float32_t)n;
+  result->amplitude = 2.0f * sqrtf(tone_power / scale);
+  result->noise_rms = sqrtf(2.0f * noise_power / scale);
+  result->snr_db = dspQuality_db(tone_power, noise_power);
+  result->sinad_db = dspQuality_db(tone_power, noise_power + harmonic_power);
+  result->thd_db = dspQuality_db(harmonic_power, tone_power);
+  result->sfdr_db = dspQuality_db(peak_power, spur);
+  result->enob = (result->sinad_db - 1.76f) / 6.02f;
+  return HAL_OK;
+}
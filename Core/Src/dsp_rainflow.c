@@ -0,0 +1,312 @@
+/**
+ ******************************************************************************
+ * @file    dsp_rainflow.c
+ * @brief   Implementation of the streaming rainflow counter
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "dsp_rainflow.h"
+#include "adc_sections.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define DSP_RAINFLOW_CODE_MASK 0xFFFU
+
+#if DSP_RAINFLOW_STACK < 4U || DSP_RAINFLOW_STACK > 255U
+#error "DSP_RAINFLOW_STACK must be 4..255"
+#endif
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+ * @brief Matrix bin of a value: floor((v - low) / width) within 0..n - 1
+ */
+static uint32_t dspRainflow_bin(float32_t v, float32_t low, float32_t width,
+                                uint32_t n) {
+  const float32_t b = (v - low) / width;
+  if (!(b >= 0.0f)) {
+    return 0;
+  }
+  return (b >= (float32_t)n) ? n - 1U : (uint32_t)b;
+}
+
+/**
+ * @brief Add half_cycles (1 or 2) of the range between two turning points
+ */
+static void dspRainflow_count(const DSP_Rainflow_t *rf,
+                              DSP_RainflowChannel_t *c, int32_t a, int32_t b,
+                              uint32_t half_cycles) {
+  const uint32_t range = (uint32_t)abs(a - b);
+  const uint32_t rb = dspRainflow_bin((float32_t)range, 0.0f,
+                                      rf->cfg.range_bin_codes,
+                                      DSP_RAINFLOW_RANGE_BINS);
+  const uint32_t mb = dspRainflow_bin(0.5f * (float32_t)(a + b),
+                                      rf->cfg.mean_low_codes,
+                                      rf->cfg.mean_bin_codes,
+                                      DSP_RAINFLOW_MEAN_BINS);
+  c->half_cycles[rb][mb] += half_cycles;
+  c->half_total += half_cycles;
+  if (range > c->largest_range) {
+    c->largest_range = (uint16_t)range;
+  }
+
+  // Compensated sum: a long record adds many cycles far below the total
+  const float32_t d = 0.5f * (float32_t)half_cycles *
+                      dspRainflow_cycleDamage(rf, (float32_t)range);
+  if (d > 0.0f) {
+    const float32_t y = d - c->damage_carry;
+    const float32_t t = c->damage + y;
+    c->damage_carry = (t - c->damage) - y;
+    c->damage = t;
+  }
+}
+
+/**
+ * @brief Push a turning point and close every cycle it completes
+ */
+static void dspRainflow_push(const DSP_Rainflow_t *rf,
+                             DSP_RainflowChannel_t *c, int16_t point) {
+  if (c->depth == DSP_RAINFLOW_STACK) {
+    // Full: the oldest range can no longer close, count its half cycle
+    dspRainflow_count(rf, c, c->stack[0], c->stack[1], 1U);
+    memmove(&c->stack[0], &c->stack[1],
+            (DSP_RAINFLOW_STACK - 1U) * sizeof(c->stack[0]));
+    c->depth--;
+    c->overflows++;
+  }
+  c->stack[c->depth++] = point;
+
+  // Four-point rule on the newest four: B-C closes inside A-D
+  while (c->depth >= 4U) {
+    const int16_t *s = &c->stack[c->depth - 4U];
+    const int32_t inner = abs(s[2] - s[1]);
+    if (inner > abs(s[1] - s[0]) || inner > abs(s[3] - s[2])) {
+      break;
+    }
+    dspRainflow_count(rf, c, s[1], s[2], 2U);
+    c->stack[c->depth - 3U] = c->stack[c->depth - 1U];
+    c->depth -= 2U;
+  }
+}
+
+/**
+ * @brief One sample: follow the extreme, push it once the signal turns
+ */
+static inline void dspRainflow_sample(const DSP_Rainflow_t *rf,
+                                      DSP_RainflowChannel_t *c, int16_t x) {
+  const int32_t h = rf->cfg.hysteresis_codes;
+  if (c->depth == 0U) {
+    c->stack[0] = x; // start of the record
+    c->depth = 1;
+    c->direction = 0;
+    c->extreme = x;
+    return;
+  }
+  if (c->direction > 0) {
+    if (x > c->extreme) {
+      c->extreme = x;
+    } else if (x < c->extreme - h) {
+      dspRainflow_push(rf, c, c->extreme);
+      c->direction = -1;
+      c->extreme = x;
+    }
+  } else if (c->direction < 0) {
+    if (x < c->extreme) {
+      c->extreme = x;
+    } else if (x > c->extreme + h) {
+      dspRainflow_push(rf, c, c->extreme);
+      c->direction = 1;
+      c->extreme = x;
+    }
+  } else {
+    // From the start point, the first move beyond the hysteresis
+    const int32_t top = c->stack[c->depth - 1U];
+    if (x > top + h) {
+      c->direction = 1;
+      c->extreme = x;
+    } else if (x < top - h) {
+      c->direction = -1;
+      c->extreme = x;
+    }
+  }
+}
+
+/**
+ * @brief Raw slot of a channel
+ */
+static uint8_t dspRainflow_slot(const DSP_Rainflow_t *rf, uint8_t channel) {
+  uint8_t s = 0;
+  while (s < ADC_CONVERSIONS_CHANNEL_COUNT - 1U &&
+         rf->slot_channel[s] != channel) {
+    s++;
+  }
+  return s;
+}
+
+/**
+ * @brief Clear the counted cycles and damage of a channel, not its stack
+ */
+static void dspRainflow_clearCounts(DSP_RainflowChannel_t *c) {
+  memset(c->half_cycles, 0, sizeof(c->half_cycles));
+  c->half_total = 0;
+  c->overflows = 0;
+  c->largest_range = 0;
+  c->damage = 0.0f;
+  c->damage_carry = 0.0f;
+}
+
+/* Public functions ----------------------------------------------------------*/
+
+HAL_StatusTypeDef dspRainflow_init(DSP_Rainflow_t *rf,
+                                   const DSP_RainflowConfig_t *cfg,
+                                   const uint8_t *channel_map) {
+  if (rf == NULL || cfg == NULL || !(cfg->range_bin_codes > 0.0f) ||
+      !(cfg->mean_bin_codes > 0.0f) || !(cfg->units_per_code > 0.0f)) {
+    return HAL_ERROR;
+  }
+  const DSP_RainflowSn_t *sn = cfg->sn;
+  if (sn != NULL) {
+    if (sn->count < 2U || sn->count > DSP_RAINFLOW_SN_POINTS) {
+      return HAL_ERROR;
+    }
+    for (uint8_t k = 0; k < sn->count; k++) {
+      if (!(sn->range[k] > 0.0f) || !(sn->cycles[k] > 0.0f) ||
+          (k > 0U && (sn->range[k] <= sn->range[k - 1U] ||
+                      sn->cycles[k] > sn->cycles[k - 1U]))) {
+        return HAL_ERROR;
+      }
+    }
+  }
+
+  memset(rf, 0, sizeof(*rf));
+  rf->cfg = *cfg;
+  for (uint8_t s = 0; s < ADC_CONVERSIONS_CHANNEL_COUNT; s++) {
+    rf->slot_channel[s] = (channel_map != NULL) ? channel_map[s] : s;
+  }
+  if (sn != NULL) {
+    for (uint8_t k = 0; k < sn->count; k++) {
+      rf->sn_log_range[k] = logf(sn->range[k]);
+      rf->sn_log_cycles[k] = logf(sn->cycles[k]);
+    }
+    // Segment k runs from point k to k + 1; the last extends the one before
+    for (uint8_t k = 0; k + 1U < sn->count; k++) {
+      rf->sn_slope[k] = (rf->sn_log_cycles[k] - rf->sn_log_cycles[k + 1U]) /
+                        (rf->sn_log_range[k + 1U] - rf->sn_log_range[k]);
+    }
+    rf->sn_slope[sn->count - 1U] = rf->sn_slope[sn->count - 2U];
+  }
+  return HAL_OK;
+}
+
+void dspRainflow_setChannels(DSP_Rainflow_t *rf, ADC_ChannelMask_t mask) {
+  if (rf == NULL) {
+    return;
+  }
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  for (uint8_t s = 0; s < ADC_CONVERSIONS_CHANNEL_COUNT; s++) {
+    const ADC_ChannelMask_t bit =
+        (ADC_ChannelMask_t)(1U << rf->slot_channel[s]);
+    if ((mask & bit) && !(rf->mask & bit)) {
+      rf->slot[s].depth = 0; // a gap in the signal is no turning point
+    }
+  }
+  rf->mask = mask;
+  __set_PRIMASK(primask);
+}
+
+ADC_FAST_CODE void dspRainflow_process(DSP_Rainflow_t *rf,
+                                       const uint16_t *block,
+                                       uint32_t frames) {
+  if (rf == NULL || block == NULL) {
+    return;
+  }
+  const ADC_ChannelMask_t mask = rf->mask;
+  for (uint8_t s = 0; s < ADC_CONVERSIONS_CHANNEL_COUNT; s++) {
+    if (!(mask & (ADC_ChannelMask_t)(1U << rf->slot_channel[s]))) {
+      continue;
+    }
+    DSP_RainflowChannel_t *c = &rf->slot[s];
+    const uint16_t *p = &block[s];
+    for (uint32_t f = 0; f < frames; f++) {
+      dspRainflow_sample(rf, c, (int16_t)(*p & DSP_RAINFLOW_CODE_MASK));
+      p += ADC_CONVERSIONS_CHANNEL_COUNT;
+    }
+  }
+}
+
+HAL_StatusTypeDef dspRainflow_snapshot(DSP_Rainflow_t *rf, uint8_t channel,
+                                       DSP_RainflowResult_t *res,
+                                       uint8_t reset) {
+  if (rf == NULL || res == NULL || channel >= ADC_CONVERSIONS_CHANNEL_COUNT) {
+    return HAL_ERROR;
+  }
+  DSP_RainflowChannel_t *c = &rf->slot[dspRainflow_slot(rf, channel)];
+  int16_t residual[DSP_RAINFLOW_STACK + 1U];
+
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  memcpy(res->half_cycles, c->half_cycles, sizeof(res->half_cycles));
+  res->half_total = c->half_total;
+  res->overflows = c->overflows;
+  res->largest_range = c->largest_range;
+  res->damage = c->damage;
+  uint8_t n = c->depth;
+  memcpy(residual, c->stack, n * sizeof(residual[0]));
+  if (c->direction != 0) {
+    residual[n++] = c->extreme; // the newest extreme ends the record
+  }
+  if (reset) {
+    dspRainflow_clearCounts(c);
+  }
+  __set_PRIMASK(primask);
+
+  res->channel = channel;
+  res->residual = (n > 0U) ? (uint8_t)(n - 1U) : 0U;
+  res->damage_residual = res->damage;
+  for (uint8_t i = 1; i < n; i++) {
+    res->damage_residual +=
+        0.5f * dspRainflow_cycleDamage(
+                   rf, (float32_t)abs(residual[i] - residual[i - 1U]));
+  }
+  return HAL_OK;
+}
+
+void dspRainflow_reset(DSP_Rainflow_t *rf) {
+  if (rf == NULL) {
+    return;
+  }
+  for (uint8_t s = 0; s < ADC_CONVERSIONS_CHANNEL_COUNT; s++) {
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    dspRainflow_clearCounts(&rf->slot[s]);
+    __set_PRIMASK(primask);
+  }
+}
+
+float32_t dspRainflow_cycleDamage(const DSP_Rainflow_t *rf,
+                                  float32_t range_codes) {
+  const DSP_RainflowSn_t *sn = rf->cfg.sn;
+  if (sn == NULL) {
+    return 0.0f;
+  }
+  const float32_t s = range_codes * rf->cfg.units_per_code;
+  if (!(s >= sn->range[0])) {
+    return 0.0f; // endurance limit
+  }
+  const float32_t ls = logf(s);
+  uint8_t k = 0;
+  while (k + 2U < sn->count && ls >= rf->sn_log_range[k + 1U]) {
+    k++;
+  }
+  if (ls >= rf->sn_log_range[sn->count - 1U]) {
+    k = sn->count - 1U; // beyond the table: the last segment extended
+  }
+  // ln N = ln N_k - m_k (ln S - ln S_k); the damage of a cycle is 1 / N
+  return expf(rf->sn_slope[k] * (ls - rf->sn_log_range[k]) -
+              rf->sn_log_cycles[k]);
+}
@@ -0,0 +1,174 @@
+/**
+ ******************************************************************************
+ * @file    dsp_sdft.c
+ * @brief   Implementation of the damped sliding DFT
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "dsp_sdft.h"
+#include "adc_sections.h"
+#include <math.h>
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define DSP_SDFT_DAMPING_MIN 0.99f
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+ * @brief Nearest bin of a frequency, 0 if it is not strictly between DC and
+ *        Nyquist
+ */
+static uint32_t dspSdft_bin(const DSP_Sdft_t *sd, float32_t hz) {
+  const float32_t k = hz * (float32_t)sd->length / sd->sample_rate_hz + 0.5f;
+  if (!(k >= 1.0f) || k >= (float32_t)(sd->length / 2U)) {
+    return 0;
+  }
+  return (uint32_t)k;
+}
+
+/**
+ * @brief Start an empty window: the bins restart from zero
+ */
+static void dspSdft_restart(DSP_Sdft_t *sd) {
+  memset(sd->re, 0, sizeof(sd->re));
+  memset(sd->im, 0, sizeof(sd->im));
+  memset(sd->history, 0, sizeof(sd->history));
+  memset(sd->sum, 0, sizeof(sd->sum));
+  sd->pos = 0;
+  sd->count = 0;
+  sd->filled = 0;
+  // Even to even: a reader in the middle of a copy retries
+  sd->seq += 2U;
+}
+
+/* Public functions ----------------------------------------------------------*/
+
+HAL_StatusTypeDef dspSdft_init(DSP_Sdft_t *sd, float32_t sample_rate_hz,
+                               uint16_t length, float32_t damping,
+                               const uint8_t *channel_map) {
+  if (damping == 0.0f) {
+    damping = DSP_SDFT_DAMPING;
+  }
+  if (sd == NULL || !(sample_rate_hz > 0.0f) ||
+      length < DSP_SDFT_LENGTH_MIN || length > DSP_SDFT_MAX_LENGTH ||
+      !(damping > DSP_SDFT_DAMPING_MIN) || !(damping < 1.0f)) {
+    return HAL_ERROR;
+  }
+  memset(sd, 0, sizeof(*sd));
+  sd->sample_rate_hz = sample_rate_hz;
+  sd->length = length;
+  sd->damping = damping;
+
+  // In double: 1 - r is a few float ulps of r
+  const double r_n = pow((double)damping, (double)length);
+  sd->damping_n = (float32_t)r_n;
+  sd->scale = (float32_t)(2.0 * (1.0 - (double)damping) /
+                          ((double)damping * (1.0 - r_n)));
+  for (uint8_t s = 0; s < ADC_CONVERSIONS_CHANNEL_COUNT; s++) {
+    sd->slot_channel[s] = (channel_map != NULL) ? channel_map[s] : s;
+  }
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef dspSdft_setBins(DSP_Sdft_t *sd, uint8_t channel,
+                                  const float32_t *hz, uint8_t count) {
+  if (sd == NULL || sd->length == 0U ||
+      channel >= ADC_CONVERSIONS_CHANNEL_COUNT || count > DSP_SDFT_MAX_BINS ||
+      (hz == NULL && count != 0U)) {
+    return HAL_ERROR;
+  }
+  for (uint8_t b = 0; b < count; b++) {
+    if (dspSdft_bin(sd, hz[b]) == 0U) {
+      return HAL_ERROR;
+    }
+  }
+
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  const float32_t spacing = sd->sample_rate_hz / (float32_t)sd->length;
+  for (uint8_t b = 0; b < count; b++) {
+    const uint32_t k = dspSdft_bin(sd, hz[b]);
+    const double theta = 2.0 * (double)PI * (double)k / (double)sd->length;
+    sd->bin_hz[channel][b] = (float32_t)k * spacing;
+    // cos/sin, not the table: a twiddle error detunes and undamps the bin
+    sd->c_re[channel][b] = (float32_t)((double)sd->damping * cos(theta));
+    sd->c_im[channel][b] = (float32_t)((double)sd->damping * sin(theta));
+  }
+  sd->bin_count[channel] = count;
+  dspSdft_restart(sd);
+  __set_PRIMASK(primask);
+  return HAL_OK;
+}
+
+ADC_FAST_CODE void dspSdft_endWindow(DSP_Sdft_t *sd) {
+  for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+    // This window's mean is the next one's DC estimate
+    sd->dc[ch] = sd->sum[ch] / (float32_t)sd->count;
+    sd->sum[ch] = 0.0f;
+  }
+  sd->count = 0;
+}
+
+ADC_FAST_CODE void dspSdft_process(DSP_Sdft_t *sd, const uint16_t *block,
+                                   uint32_t frames) {
+  if (sd == NULL || block == NULL || sd->length == 0U) {
+    return;
+  }
+  const uint16_t *p = block;
+  for (uint32_t f = 0; f < frames; f++) {
+    dspSdft_beginFrame(sd);
+    for (uint8_t s = 0; s < ADC_CONVERSIONS_CHANNEL_COUNT; s++) {
+      dspSdft_push(sd, sd->slot_channel[s], (float32_t)p[s]);
+    }
+    dspSdft_endFrame(sd);
+    p += ADC_CONVERSIONS_CHANNEL_COUNT;
+  }
+}
+
+HAL_StatusTypeDef dspSdft_getLatest(DSP_Sdft_t *sd, DSP_SdftLatest_t *latest) {
+  if (sd == NULL || latest == NULL) {
+    return HAL_ERROR;
+  }
+
+  float32_t re[ADC_CONVERSIONS_CHANNEL_COUNT][DSP_SDFT_MAX_BINS];
+  float32_t im[ADC_CONVERSIONS_CHANNEL_COUNT][DSP_SDFT_MAX_BINS];
+  uint32_t seq;
+  uint32_t samples;
+  uint32_t filled;
+  do {
+    seq = sd->seq;
+    __DMB();
+    memcpy(re, sd->re, sizeof(re));
+    memcpy(im, sd->im, sizeof(im));
+    memcpy(latest->bin_count, sd->bin_count, sizeof(latest->bin_count));
+    memcpy(latest->hz, sd->bin_hz, sizeof(latest->hz));
+    samples = sd->samples;
+    filled = sd->filled;
+    __DMB();
+  } while ((seq & 1U) != 0U || seq != sd->seq);
+
+  if (filled < sd->length) {
+    return HAL_BUSY;
+  }
+
+  const float32_t rad_per_hz = 2.0f * PI / sd->sample_rate_hz;
+  latest->sample = samples - 1U;
+  for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+    for (uint8_t b = 0; b < latest->bin_count[ch]; b++) {
+      float32_t mag;
+      arm_sqrt_f32(re[ch][b] * re[ch][b] + im[ch][b] * im[ch][b], &mag);
+      latest->amplitude[ch][b] = mag * sd->scale;
+      // X turns by theta per sample and leads the newest sample by one
+      float32_t phase = atan2f(im[ch][b], re[ch][b]) -
+                      latest->hz[ch][b] * rad_per_hz;
+      if (phase <= -PI) {
+        phase += 2.0f * PI;
+      }
+      latest->phase[ch][b] = phase;
+    }
+  }
+  return HAL_OK;
+}
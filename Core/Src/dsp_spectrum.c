@@ -0,0 +1,651 @@
+/**
+ ******************************************************************************
+ * @file    dsp_spectrum.c
+ * @brief   Implementation of the Welch-averaged FFT spectrum stage
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "dsp_spectrum.h"
+#include <float.h>
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+#if DSP_SPECTRUM_BUFFER_LENGTH < DSP_SPECTRUM_LENGTH_MIN ||                    \
+    DSP_SPECTRUM_BUFFER_LENGTH > DSP_SPECTRUM_LENGTH_MAX
+#error "DSP_SPECTRUM_BUFFER_LENGTH must be in 256..4096"
+#endif
+
+#define DSP_SPECTRUM_LN2 0.693147181f
+#define DSP_SPECTRUM_CEPSTRUM_FLOOR 1e-9f // of the largest bin: -90 dB
+#define DSP_SPECTRUM_CEPSTRUM_MIN_Q 2     // clear of the spectral envelope
+
+/* Private variables ---------------------------------------------------------*/
+
+/* rfft input and output, shared: every instance is polled from the main
+ * loop, and a step leaves both free */
+static float32_t fft_in[DSP_SPECTRUM_BUFFER_LENGTH];
+static float32_t fft_out[DSP_SPECTRUM_BUFFER_LENGTH];
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+ * @brief Build the periodic window and its normalisation sums
+ */
+static void dspSpectrum_buildWindow(DSP_Spectrum_t *sp) {
+  const uint16_t n_len = sp->cfg.length;
+
+  sp->window_sum = 0.0f;
+  sp->window_power = 0.0f;
+  for (uint16_t n = 0; n < n_len; n++) {
+    const float32_t w = dspSpectrum_windowValue(sp->cfg.window, n, n_len);
+    sp->window[n] = w;
+    sp->window_sum += w;
+    sp->window_power += w * w;
+  }
+}
+
+/**
+ * @brief Mean square in bins lo..hi of the averaged one-sided spectrum
+ */
+static float32_t dspSpectrum_binPower(const DSP_SpectrumSums_t *sp,
+                                      int32_t lo, int32_t hi) {
+  const int32_t nyquist = (int32_t)(sp->cfg->length / 2U);
+  if (lo < 0) {
+    lo = 0;
+  }
+  if (hi > nyquist) {
+    hi = nyquist;
+  }
+
+  float32_t sum = 0.0f;
+  for (int32_t k = lo; k <= hi; k++) {
+    // DC and Nyquist appear once, every other bin twice (negative half)
+    float32_t p = sp->power[k];
+    sum += (k == 0 || k == nyquist) ? p : 2.0f * p;
+  }
+
+  // Parseval, corrected for the window's power and the Welch average
+  return sum / ((float32_t)sp->cfg->length * sp->window_power *
+                (float32_t)sp->cfg->averages);
+}
+
+/**
+ * @brief Mean spectral kurtosis of bins lo..hi, clamped to 1..nyquist - 1
+ */
+static float32_t dspSpectrum_bandKurtosis(const DSP_SpectrumSums_t *sp,
+                                          int32_t lo, int32_t hi) {
+  const int32_t nyquist = (int32_t)(sp->cfg->length / 2U);
+  const float32_t m = (float32_t)sp->cfg->averages;
+  if (sp->cfg->averages < 2U) {
+    return 0.0f;
+  }
+  if (lo < 1) {
+    lo = 1;
+  }
+  if (hi > nyquist - 1) {
+    hi = nyquist - 1;
+  }
+
+  // Unbiased for M segments: 0 for Gaussian noise, -1 for a pure tone
+  float32_t sum = 0.0f;
+  uint32_t bins = 0;
+  for (int32_t k = lo; k <= hi; k++) {
+    const float32_t p = sp->power[k];
+    if (p > 0.0f) {
+      sum += (m + 1.0f) * sp->power_sq[k] / (p * p) - 2.0f;
+      bins++;
+    }
+  }
+  return (bins != 0U) ? sum / (float32_t)bins * m / (m - 1.0f) : 0.0f;
+}
+
+/**
+ * @brief Interpolated frequency and 0-pk amplitude of the peak at bin k
+ */
+static void dspSpectrum_measure(const DSP_SpectrumSums_t *sp, int32_t k,
+                                float32_t *hz, float32_t *amplitude) {
+  const int32_t nyquist = (int32_t)(sp->cfg->length / 2U);
+  const float32_t bin_hz =
+      sp->cfg->sample_rate_hz / (float32_t)sp->cfg->length;
+
+  // Parabolic interpolation on the magnitudes around the peak bin
+  float32_t offset = 0.0f;
+  float32_t a, b, c;
+  arm_sqrt_f32(sp->power[k], &b);
+  if (k > 1 && k < nyquist - 1) {
+    arm_sqrt_f32(sp->power[k - 1], &a);
+    arm_sqrt_f32(sp->power[k + 1], &c);
+    float32_t denom = a - 2.0f * b + c;
+    if (denom < 0.0f) {
+      offset = 0.5f * (a - c) / denom;
+    }
+  }
+  *hz = ((float32_t)k + offset) * bin_hz;
+
+  // One-sided amplitude: 2 |X| / sum(w), |X| averaged over the segments
+  float32_t avg_mag;
+  arm_sqrt_f32(sp->power[k] / (float32_t)sp->cfg->averages, &avg_mag);
+  *amplitude = 2.0f * avg_mag / sp->window_sum;
+}
+
+/**
+ * @brief Largest bin in lo..hi, clamped to 1..nyquist - 1
+ */
+static int32_t dspSpectrum_maxBin(const DSP_SpectrumSums_t *sp, int32_t lo,
+                                  int32_t hi) {
+  const int32_t nyquist = (int32_t)(sp->cfg->length / 2U);
+  if (lo < 1) {
+    lo = 1;
+  }
+  if (hi > nyquist - 1) {
+    hi = nyquist - 1;
+  }
+  if (lo > hi) {
+    lo = hi; // tone above the spectrum: report its top bin
+  }
+  int32_t k_max = lo;
+  for (int32_t k = lo + 1; k <= hi; k++) {
+    if (sp->power[k] > sp->power[k_max]) {
+      k_max = k;
+    }
+  }
+  return k_max;
+}
+
+/**
+ * @brief log2 of a positive float: the exponent field, plus a parabola
+ *        through the mantissa, within 0.005
+ */
+static inline float32_t dspSpectrum_fastLog2(float32_t x) {
+  uint32_t bits;
+  memcpy(&bits, &x, sizeof(bits));
+  const float32_t e = (float32_t)((int32_t)((bits >> 23) & 0xFFU) - 128);
+  bits = (bits & 0x7FFFFFU) | 0x3F800000U; // mantissa, 1..2
+  float32_t m;
+  memcpy(&m, &bits, sizeof(m));
+  return e + (-0.34484843f * m + 2.02466578f) * m - 0.67487759f;
+}
+
+/**
+ * @brief Power cepstrum of the finished average; its largest peaks are
+ *        kept for the publish step
+ */
+static void dspSpectrum_cepstrum(DSP_Spectrum_t *sp) {
+  const DSP_SpectrumConfig_t *cfg = &sp->cfg;
+  const int32_t half = (int32_t)(cfg->length / 2U);
+  const uint8_t count = cfg->cepstrum_count;
+
+  sp->cepstrum_found = 0;
+  if (count == 0U) {
+    return;
+  }
+
+  // Floor the log: the mean-free DC bin and empty bins would be -inf
+  float32_t peak = 0.0f;
+  for (int32_t k = 0; k <= half; k++) {
+    peak = (sp->power[k] > peak) ? sp->power[k] : peak;
+  }
+  float32_t floor = peak * DSP_SPECTRUM_CEPSTRUM_FLOOR;
+  floor = (floor < FLT_MIN) ? FLT_MIN : floor;
+
+  // log2 P in the packed layout of a real spectrum (zero imaginary parts)
+  // and back: [0] = DC, [1] = Nyquist, then re/im of bins 1..N/2-1
+  fft_in[0] = dspSpectrum_fastLog2((sp->power[0] > floor) ? sp->power[0]
+                                                          : floor);
+  fft_in[1] = dspSpectrum_fastLog2((sp->power[half] > floor) ? sp->power[half]
+                                                             : floor);
+  for (int32_t k = 1; k < half; k++) {
+    const float32_t p = sp->power[k];
+    fft_in[2 * k] = dspSpectrum_fastLog2((p > floor) ? p : floor);
+    fft_in[2 * k + 1] = 0.0f;
+  }
+  arm_rfft_fast_f32(&sp->rfft, fft_in, fft_out, 1);
+
+  // Largest local maxima of c[q] in the range, largest first
+  const float32_t *c = fft_out;
+  const float32_t q_per_ms = cfg->sample_rate_hz / 1000.0f;
+  int32_t lo = (int32_t)(cfg->cepstrum_min_ms * q_per_ms + 0.999f);
+  int32_t hi = (cfg->cepstrum_max_ms > 0.0f)
+                   ? (int32_t)(cfg->cepstrum_max_ms * q_per_ms)
+                   : half - 1;
+  lo = (lo < DSP_SPECTRUM_CEPSTRUM_MIN_Q) ? DSP_SPECTRUM_CEPSTRUM_MIN_Q : lo;
+  hi = (hi > half - 1) ? half - 1 : hi;
+
+  int32_t best[DSP_SPECTRUM_MAX_CEPSTRUM];
+  uint8_t found = 0;
+  for (int32_t q = lo; q <= hi; q++) {
+    const float32_t v = c[q];
+    if (v <= 0.0f || v <= c[q - 1] || v < c[q + 1] ||
+        (found == count && v <= c[best[count - 1U]])) {
+      continue;
+    }
+    uint8_t i = (found < count) ? found++ : (uint8_t)(count - 1U);
+    for (; i > 0U && c[best[i - 1U]] < v; i--) {
+      best[i] = best[i - 1U];
+    }
+    best[i] = q;
+  }
+
+  // Parabolic interpolation, as the spectrum peak; log2 -> nepers
+  for (uint8_t i = 0; i < found; i++) {
+    const int32_t q = best[i];
+    const float32_t a = c[q - 1];
+    const float32_t b = c[q];
+    const float32_t d = c[q + 1];
+    const float32_t denom = a - 2.0f * b + d;
+    const float32_t offset = (denom < 0.0f) ? 0.5f * (a - d) / denom : 0.0f;
+    sp->cepstrum_ms[i] = ((float32_t)q + offset) / q_per_ms;
+    sp->cepstrum_amplitude[i] =
+        (b - 0.25f * (a - d) * offset) * DSP_SPECTRUM_LN2;
+  }
+  sp->cepstrum_found = found;
+}
+
+/**
+ * @brief Extract the features of the averaged spectrum and restart it
+ */
+static void dspSpectrum_publish(DSP_Spectrum_t *sp) {
+  const DSP_SpectrumSums_t sums = {.cfg = &sp->cfg,
+                                   .power = sp->power,
+                                   .power_sq = sp->power_sq,
+                                   .window_sum = sp->window_sum,
+                                   .window_power = sp->window_power};
+  dspSpectrum_features(&sums, &sp->result);
+  sp->result.cepstrum_count = sp->cepstrum_found;
+  for (uint8_t i = 0; i < sp->cepstrum_found; i++) {
+    sp->result.cepstrum_ms[i] = sp->cepstrum_ms[i];
+    sp->result.cepstrum_amplitude[i] = sp->cepstrum_amplitude[i];
+  }
+  sp->cepstrum_found = 0;
+  sp->result.sequence = ++sp->result_seq;
+  memset(sp->power, 0, sizeof(sp->power));
+  memset(sp->power_sq, 0, sizeof(sp->power_sq));
+  sp->averaged = 0;
+}
+
+/**
+ * @brief Append one sample to the ring; hand a finished window to the main
+ *        loop, superseding one it has not taken
+ */
+static inline void dspSpectrum_collect(DSP_Spectrum_t *sp, float32_t sample) {
+  const uint16_t n_len = sp->cfg.length;
+
+  sp->ring[sp->head] = sample;
+  if (++sp->head == DSP_SPECTRUM_RING_LENGTH) {
+    sp->head = 0;
+  }
+  sp->written++;
+  if (++sp->collected < n_len) {
+    return;
+  }
+
+  if (sp->segment_ready) {
+    sp->overruns++; // the older window goes, the ring moves on
+  }
+  const uint32_t pos = (uint32_t)sp->head + DSP_SPECTRUM_RING_LENGTH - n_len;
+  sp->ready_pos = (uint16_t)((pos >= DSP_SPECTRUM_RING_LENGTH)
+                                 ? pos - DSP_SPECTRUM_RING_LENGTH
+                                 : pos);
+  sp->ready_end = sp->written;
+  sp->segment_index = sp->segments++;
+  __DMB();
+  sp->segment_ready = 1;
+
+  // The next window shares all but hop of these samples, in place
+  sp->collected = (uint16_t)(n_len - sp->hop);
+}
+
+/**
+ * @brief Take the ready window out of the ring into fft_in, mean removed
+ *        and windowed in the same pass
+ *
+ * @return 0 if the ISR overwrote part of it while it was read
+ */
+static uint8_t dspSpectrum_readWindow(DSP_Spectrum_t *sp, uint32_t *index) {
+  const uint16_t n_len = sp->cfg.length;
+
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  const uint16_t pos = sp->ready_pos;
+  const uint32_t end = sp->ready_end;
+  *index = sp->segment_index;
+  sp->segment_ready = 0;
+  __set_PRIMASK(primask);
+
+  // The window in at most two runs of the ring
+  const uint16_t first = (uint16_t)((DSP_SPECTRUM_RING_LENGTH - pos < n_len)
+                                        ? DSP_SPECTRUM_RING_LENGTH - pos
+                                        : n_len);
+  float32_t *a = &sp->ring[pos];
+  float32_t mean_a;
+  float32_t mean_b = 0.0f;
+  arm_mean_f32(a, first, &mean_a);
+  if (first < n_len) {
+    arm_mean_f32(sp->ring, (uint32_t)(n_len - first), &mean_b);
+  }
+  // Drop the DC level (gravity, mid-rail bias) as the window is applied
+  const float32_t mean = (mean_a * (float32_t)first +
+                          mean_b * (float32_t)(n_len - first)) /
+                         (float32_t)n_len;
+  const float32_t *w = sp->window;
+  for (uint16_t n = 0; n < first; n++) {
+    fft_in[n] = (a[n] - mean) * w[n];
+  }
+  for (uint16_t n = first; n < n_len; n++) {
+    fft_in[n] = (sp->ring[n - first] - mean) * w[n];
+  }
+
+  // Intact as long as the oldest sample has not come round again
+  __DMB();
+  return (sp->written - end <= DSP_SPECTRUM_RING_LENGTH - n_len) ? 1U : 0U;
+}
+
+/**
+ * @brief Validate a tone list
+ */
+static HAL_StatusTypeDef dspSpectrum_checkTones(const float32_t *tone_hz,
+                                                uint8_t count) {
+  if (count > DSP_SPECTRUM_MAX_TONES) {
+    return HAL_ERROR;
+  }
+  for (uint8_t i = 0; i < count; i++) {
+    if (tone_hz[i] < 0.0f) {
+      return HAL_ERROR;
+    }
+  }
+  return HAL_OK;
+}
+
+/**
+ * @brief Validate a cepstrum search
+ */
+static HAL_StatusTypeDef dspSpectrum_checkCepstrum(uint8_t count,
+                                                   float32_t min_ms,
+                                                   float32_t max_ms) {
+  if (count > DSP_SPECTRUM_MAX_CEPSTRUM ||
+      (count != 0U && (min_ms <= 0.0f || max_ms < 0.0f ||
+                       (max_ms != 0.0f && max_ms <= min_ms)))) {
+    return HAL_ERROR;
+  }
+  return HAL_OK;
+}
+
+/* Public functions ----------------------------------------------------------*/
+
+HAL_StatusTypeDef dspSpectrum_checkConfig(const DSP_SpectrumConfig_t *cfg,
+                                          uint16_t max_length) {
+  if (cfg == NULL || cfg->length < DSP_SPECTRUM_LENGTH_MIN ||
+      cfg->length > max_length ||
+      (cfg->length & (cfg->length - 1U)) != 0U || cfg->averages == 0U ||
+      (cfg->overlap != DSP_SPECTRUM_OVERLAP_50 &&
+       cfg->overlap != DSP_SPECTRUM_OVERLAP_75) ||
+      cfg->sample_rate_hz <= 0.0f || cfg->band_count > DSP_SPECTRUM_MAX_BANDS ||
+      (cfg->window != DSP_WINDOW_HANN && cfg->window != DSP_WINDOW_FLATTOP)) {
+    return HAL_ERROR;
+  }
+  for (uint8_t i = 0; i < cfg->band_count; i++) {
+    if (cfg->bands[i].low_hz < 0.0f ||
+        cfg->bands[i].high_hz < cfg->bands[i].low_hz) {
+      return HAL_ERROR;
+    }
+  }
+  if (cfg->tone_search_hz < 0.0f ||
+      dspSpectrum_checkTones(cfg->tone_hz, cfg->tone_count) != HAL_OK ||
+      dspSpectrum_checkCepstrum(cfg->cepstrum_count, cfg->cepstrum_min_ms,
+                                cfg->cepstrum_max_ms) != HAL_OK) {
+    return HAL_ERROR;
+  }
+  return HAL_OK;
+}
+
+float32_t dspSpectrum_windowValue(DSP_SpectrumWindow_t window, uint16_t n,
+                                  uint16_t length) {
+  // 5-term flat-top: scalloping loss below 0.01 dB
+  static const float32_t flattop[5] = {0.21557895f, 0.41663158f, 0.277263158f,
+                                       0.083578947f, 0.006947368f};
+  const float32_t x = 2.0f * PI / (float32_t)length * (float32_t)n;
+
+  if (window == DSP_WINDOW_FLATTOP) {
+    return flattop[0] - flattop[1] * arm_cos_f32(x) +
+           flattop[2] * arm_cos_f32(2.0f * x) -
+           flattop[3] * arm_cos_f32(3.0f * x) +
+           flattop[4] * arm_cos_f32(4.0f * x);
+  }
+  return 0.5f - 0.5f * arm_cos_f32(x);
+}
+
+void dspSpectrum_features(const DSP_SpectrumSums_t *sp,
+                          DSP_SpectrumResult_t *res) {
+  const DSP_SpectrumConfig_t *cfg = sp->cfg;
+  const int32_t nyquist = (int32_t)(cfg->length / 2U);
+  const float32_t bin_hz = cfg->sample_rate_hz / (float32_t)cfg->length;
+
+  // Peak search above min_peak_hz, never on DC
+  int32_t k_min = (int32_t)(cfg->min_peak_hz / bin_hz + 0.999f);
+  int32_t k_peak = dspSpectrum_maxBin(sp, k_min, nyquist - 1);
+  dspSpectrum_measure(sp, k_peak, &res->peak_hz, &res->peak_amplitude);
+
+  arm_sqrt_f32(dspSpectrum_binPower(sp, 0, nyquist), &res->rms);
+
+  res->band_count = cfg->band_count;
+  for (uint8_t i = 0; i < cfg->band_count; i++) {
+    const DSP_SpectrumBand_t *band = &cfg->bands[i];
+    int32_t lo = (int32_t)(band->low_hz / bin_hz + 0.999f);
+    int32_t hi = (int32_t)(band->high_hz / bin_hz);
+    arm_sqrt_f32(dspSpectrum_binPower(sp, lo, hi), &res->band_rms[i]);
+    res->band_kurtosis[i] = dspSpectrum_bandKurtosis(sp, lo, hi);
+  }
+
+  res->tone_count = cfg->tone_count;
+  for (uint8_t i = 0; i < cfg->tone_count; i++) {
+    const float32_t f = cfg->tone_hz[i];
+    int32_t lo = (int32_t)((f - cfg->tone_search_hz) / bin_hz + 0.5f);
+    int32_t hi = (int32_t)((f + cfg->tone_search_hz) / bin_hz + 0.5f);
+    dspSpectrum_measure(sp, dspSpectrum_maxBin(sp, lo, hi), &res->tone_hz[i],
+                        &res->tone_amplitude[i]);
+  }
+
+  const DSP_BandTable_t *tbl = cfg->band_table;
+  res->log_band_count = (tbl != NULL) ? tbl->count : 0U;
+  for (uint8_t b = 0; b < res->log_band_count; b++) {
+    int32_t lo;
+    int32_t hi;
+    dspBands_binRange(tbl, b, cfg->length, cfg->sample_rate_hz, &lo, &hi);
+    arm_sqrt_f32(dspSpectrum_binPower(sp, lo, hi), &res->log_band_rms[b]);
+  }
+  res->cepstrum_count = 0; // a step of the float stage, not of the sums
+}
+
+HAL_StatusTypeDef dspSpectrum_init(DSP_Spectrum_t *sp, uint8_t channel,
+                                   const uint8_t *channel_map,
+                                   const DSP_SpectrumConfig_t *cfg) {
+  if (sp == NULL || channel >= ADC_CONVERSIONS_CHANNEL_COUNT ||
+      dspSpectrum_checkConfig(cfg, DSP_SPECTRUM_BUFFER_LENGTH) != HAL_OK) {
+    return HAL_ERROR;
+  }
+
+  memset(sp, 0, sizeof(*sp));
+  sp->cfg = *cfg;
+  sp->channel = channel;
+  sp->slot = channel;
+  sp->hop = (cfg->overlap == DSP_SPECTRUM_OVERLAP_75) ? cfg->length / 4U
+                                                      : cfg->length / 2U;
+  if (channel_map != NULL) {
+    for (uint8_t s = 0; s < ADC_CONVERSIONS_CHANNEL_COUNT; s++) {
+      if (channel_map[s] == channel) {
+        sp->slot = s;
+      }
+    }
+  }
+
+  if (arm_rfft_fast_init_f32(&sp->rfft, cfg->length) != ARM_MATH_SUCCESS) {
+    return HAL_ERROR;
+  }
+  dspSpectrum_buildWindow(sp);
+  return HAL_OK;
+}
+
+void dspSpectrum_process(DSP_Spectrum_t *sp, const uint16_t *block,
+                         uint32_t frames) {
+  if (sp == NULL || block == NULL || sp->cfg.length == 0U) {
+    return;
+  }
+
+  const uint16_t *src = &block[sp->slot];
+  for (uint32_t f = 0; f < frames; f++) {
+    dspSpectrum_collect(sp, (float32_t)*src);
+    src += ADC_CONVERSIONS_CHANNEL_COUNT;
+  }
+}
+
+void dspSpectrum_pushSamples(DSP_Spectrum_t *sp, const float32_t *samples,
+                             uint32_t count) {
+  if (sp == NULL || samples == NULL || sp->cfg.length == 0U) {
+    return;
+  }
+
+  for (uint32_t i = 0; i < count; i++) {
+    dspSpectrum_collect(sp, samples[i]);
+  }
+}
+
+void dspSpectrum_poll(DSP_Spectrum_t *sp) {
+  // The segment in hand to its end, then stop: one segment per call
+  while (dspSpectrum_step(sp) != DSP_SPECTRUM_STEP_NONE &&
+         sp->stage != DSP_SPECTRUM_STEP_NONE) {
+  }
+}
+
+DSP_SpectrumStep_t dspSpectrum_step(DSP_Spectrum_t *sp) {
+  if (sp == NULL) {
+    return DSP_SPECTRUM_STEP_NONE;
+  }
+  if (sp->stage == DSP_SPECTRUM_STEP_NONE) {
+    if (!sp->segment_ready) {
+      return DSP_SPECTRUM_STEP_NONE;
+    }
+    sp->stage = DSP_SPECTRUM_STEP_TRANSFORM;
+  }
+  __DMB();
+
+  const uint16_t half = sp->cfg.length / 2U;
+  const DSP_SpectrumStep_t step = (DSP_SpectrumStep_t)sp->stage;
+
+  switch (step) {
+  case DSP_SPECTRUM_STEP_TRANSFORM: {
+    uint32_t index;
+    if (!dspSpectrum_readWindow(sp, &index)) {
+      uint32_t primask = __get_PRIMASK();
+      __disable_irq();
+      sp->overruns++; // torn: the main loop took it too late
+      __set_PRIMASK(primask);
+      sp->stage = DSP_SPECTRUM_STEP_NONE;
+      break;
+    }
+    // Packed output: [0] = DC, [1] = Nyquist, then re/im of bins 1..N/2-1;
+    // fft_in and fft_out are shared, so the step ends with both free again
+    arm_rfft_fast_f32(&sp->rfft, fft_in, fft_out, 0);
+    if (sp->hook != NULL) {
+      sp->hook(sp->channel, index, fft_out, sp->hook_ctx);
+    }
+    sp->power[0] += fft_out[0] * fft_out[0];
+    sp->power[half] += fft_out[1] * fft_out[1];
+    arm_cmplx_mag_squared_f32(&fft_out[2], fft_in, half - 1U);
+    arm_add_f32(&sp->power[1], fft_in, &sp->power[1], half - 1U);
+    // |X|^4 for the spectral kurtosis
+    arm_mult_f32(fft_in, fft_in, fft_out, half - 1U);
+    arm_add_f32(&sp->power_sq[1], fft_out, &sp->power_sq[1], half - 1U);
+    if (++sp->averaged < sp->cfg.averages) {
+      sp->stage = DSP_SPECTRUM_STEP_NONE;
+    } else {
+      sp->stage = (sp->cfg.cepstrum_count != 0U) ? DSP_SPECTRUM_STEP_CEPSTRUM
+                                                 : DSP_SPECTRUM_STEP_PUBLISH;
+    }
+    break;
+  }
+  case DSP_SPECTRUM_STEP_CEPSTRUM:
+    dspSpectrum_cepstrum(sp);
+    sp->stage = DSP_SPECTRUM_STEP_PUBLISH;
+    break;
+  case DSP_SPECTRUM_STEP_PUBLISH:
+    dspSpectrum_publish(sp);
+    sp->stage = DSP_SPECTRUM_STEP_NONE;
+    break;
+  default:
+    sp->stage = DSP_SPECTRUM_STEP_NONE;
+    return DSP_SPECTRUM_STEP_NONE;
+  }
+  return step;
+}
+
+uint8_t dspSpectrum_pendingSteps(const DSP_Spectrum_t *sp) {
+  if (sp == NULL) {
+    return 0;
+  }
+  // Steps after the last segment of an average: cepstrum, publish
+  const uint8_t tail = (sp->cfg.cepstrum_count != 0U) ? 2U : 1U;
+  const uint8_t publish =
+      (sp->averaged + 1U >= sp->cfg.averages) ? tail : 0U;
+  switch (sp->stage) {
+  case DSP_SPECTRUM_STEP_NONE:
+    return sp->segment_ready ? (uint8_t)(1U + publish) : 0U;
+  case DSP_SPECTRUM_STEP_TRANSFORM:
+    return (uint8_t)(1U + publish);
+  case DSP_SPECTRUM_STEP_CEPSTRUM:
+    return 2U;
+  default:
+    return 1U;
+  }
+}
+
+HAL_StatusTypeDef dspSpectrum_setTones(DSP_Spectrum_t *sp,
+                                       const float32_t *tone_hz,
+                                       uint8_t count) {
+  if (sp == NULL || (tone_hz == NULL && count != 0U) ||
+      dspSpectrum_checkTones(tone_hz, count) != HAL_OK) {
+    return HAL_ERROR;
+  }
+  for (uint8_t i = 0; i < count; i++) {
+    sp->cfg.tone_hz[i] = tone_hz[i];
+  }
+  sp->cfg.tone_count = count;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef dspSpectrum_setCepstrum(DSP_Spectrum_t *sp, uint8_t count,
+                                          float32_t min_ms, float32_t max_ms) {
+  if (sp == NULL ||
+      dspSpectrum_checkCepstrum(count, min_ms, max_ms) != HAL_OK) {
+    return HAL_ERROR;
+  }
+  sp->cfg.cepstrum_count = count;
+  sp->cfg.cepstrum_min_ms = min_ms;
+  sp->cfg.cepstrum_max_ms = max_ms;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef dspSpectrum_setSegmentHook(DSP_Spectrum_t *sp,
+                                             DSP_SpectrumSegmentHook_t hook,
+                                             void *ctx) {
+  if (sp == NULL) {
+    return HAL_ERROR;
+  }
+  sp->hook = hook;
+  sp->hook_ctx = ctx;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef dspSpectrum_getResult(DSP_Spectrum_t *sp,
+                                        DSP_SpectrumResult_t *result) {
+  if (sp == NULL || result == NULL) {
+    return HAL_ERROR;
+  }
+  if (sp->result_seq == sp->read_seq) {
+    return HAL_BUSY;
+  }
+  *result = sp->result;
+  sp->read_seq = sp->result_seq;
+  return HAL_OK;
+}
@@ -0,0 +1,266 @@
+/**
+ ******************************************************************************
+ * @file    dsp_spectrum_q15.c
+ * @brief   Implementation of the fixed-point Welch spectrum stage
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "dsp_spectrum_q15.h"
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+#if DSP_SPECTRUM_Q15_BUFFER_LENGTH < DSP_SPECTRUM_LENGTH_MIN ||                \
+    DSP_SPECTRUM_Q15_BUFFER_LENGTH > DSP_SPECTRUM_LENGTH_MAX
+#error "DSP_SPECTRUM_Q15_BUFFER_LENGTH must be in 256..4096"
+#endif
+
+#define DSP_SPECTRUM_Q15_ONE 32768.0f
+#define DSP_SPECTRUM_Q15_SAMPLE_MAX 32767.0f
+#define DSP_SPECTRUM_Q15_SAMPLE_MIN (-32768.0f)
+
+/* Private variables ---------------------------------------------------------*/
+
+/* rfft output, shared: re/im of bins 0..length-1 (the upper half mirrors
+   the lower) */
+static q15_t fft_out[2U * DSP_SPECTRUM_Q15_BUFFER_LENGTH];
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+ * @brief Build the q15 window and its normalisation sums; the sums are of
+ *        the rounded values the segments are multiplied by
+ */
+static void dspSpectrumQ15_buildWindow(DSP_SpectrumQ15_t *sp) {
+  const uint16_t n_len = sp->cfg.length;
+
+  sp->window_sum = 0.0f;
+  sp->window_power = 0.0f;
+  for (uint16_t n = 0; n < n_len; n++) {
+    float32_t w = dspSpectrum_windowValue(sp->cfg.window, n, n_len);
+    // Rounded; the Hann peak of 1.0 saturates to 32767
+    w = w * DSP_SPECTRUM_Q15_ONE + ((w >= 0.0f) ? 0.5f : -0.5f);
+    w = (w > DSP_SPECTRUM_Q15_SAMPLE_MAX) ? DSP_SPECTRUM_Q15_SAMPLE_MAX : w;
+    sp->window[n] = (q15_t)w;
+    w = (float32_t)sp->window[n] / DSP_SPECTRUM_Q15_ONE;
+    sp->window_sum += w;
+    sp->window_power += w * w;
+  }
+}
+
+/**
+ * @brief Append one sample; hand a full segment to the main loop
+ */
+static inline void dspSpectrumQ15_collect(DSP_SpectrumQ15_t *sp,
+                                          q15_t sample) {
+  const uint16_t n_len = sp->cfg.length;
+  const uint16_t half = n_len / 2U;
+
+  sp->collect[sp->collected++] = sample;
+  if (sp->collected < n_len) {
+    return;
+  }
+
+  if (sp->segment_ready) {
+    sp->overruns++;
+  } else {
+    memcpy(sp->segment, sp->collect, n_len * sizeof(q15_t));
+    __DMB();
+    sp->segment_ready = 1;
+  }
+
+  // 50 % overlap: the second half starts the next segment
+  memmove(sp->collect, &sp->collect[half], half * sizeof(q15_t));
+  sp->collected = half;
+}
+
+/**
+ * @brief Remove the mean and shift left by the most bits that keep the
+ *        segment in q15
+ *
+ * @return The shift
+ */
+static uint8_t dspSpectrumQ15_normalise(q15_t *x, uint16_t n_len) {
+  int32_t sum = 0;
+  for (uint16_t n = 0; n < n_len; n++) {
+    sum += x[n];
+  }
+  // Rounded to nearest, also for a negative sum
+  const int32_t mean =
+      (sum >= 0) ? (sum + n_len / 2) / n_len : -((-sum + n_len / 2) / n_len);
+
+  int32_t peak = 0;
+  for (uint16_t n = 0; n < n_len; n++) {
+    int32_t v = x[n] - mean;
+    v = (v > 32767) ? 32767 : (v < -32768) ? -32768 : v;
+    x[n] = (q15_t)v;
+    if (v < 0) {
+      v = -v;
+    }
+    if (v > peak) {
+      peak = v;
+    }
+  }
+  if (peak == 0) {
+    return 0;
+  }
+
+  uint8_t shift = 0;
+  while (shift < 15U && (peak << (shift + 1U)) <= 32767) {
+    shift++;
+  }
+  if (shift != 0U) {
+    arm_shift_q15(x, (int8_t)shift, x, n_len);
+  }
+  return shift;
+}
+
+/**
+ * @brief Extract the features of the averaged spectrum and restart it
+ */
+static void dspSpectrumQ15_publish(DSP_SpectrumQ15_t *sp) {
+  const DSP_SpectrumSums_t sums = {.cfg = &sp->cfg,
+                                   .power = sp->power,
+                                   .power_sq = sp->power_sq,
+                                   .window_sum = sp->window_sum,
+                                   .window_power = sp->window_power};
+  dspSpectrum_features(&sums, &sp->result);
+  sp->result.sequence = ++sp->result_seq;
+  memset(sp->power, 0, sizeof(sp->power));
+  memset(sp->power_sq, 0, sizeof(sp->power_sq));
+  sp->averaged = 0;
+}
+
+/* Public functions ----------------------------------------------------------*/
+
+HAL_StatusTypeDef dspSpectrumQ15_init(DSP_SpectrumQ15_t *sp, uint8_t channel,
+                                      const uint8_t *channel_map,
+                                      const DSP_SpectrumConfig_t *cfg) {
+  if (sp == NULL || channel >= ADC_CONVERSIONS_CHANNEL_COUNT ||
+      dspSpectrum_checkConfig(cfg, DSP_SPECTRUM_Q15_BUFFER_LENGTH) != HAL_OK ||
+      cfg->overlap != DSP_SPECTRUM_OVERLAP_50 || cfg->cepstrum_count != 0U) {
+    return HAL_ERROR; // segment copies at 50 % only, no cepstrum step
+  }
+
+  memset(sp, 0, sizeof(*sp));
+  sp->cfg = *cfg;
+  sp->channel = channel;
+  sp->slot = channel;
+  if (channel_map != NULL) {
+    for (uint8_t s = 0; s < ADC_CONVERSIONS_CHANNEL_COUNT; s++) {
+      if (channel_map[s] == channel) {
+        sp->slot = s;
+      }
+    }
+  }
+
+  if (arm_rfft_init_q15(&sp->rfft, cfg->length, 0, 1) != ARM_MATH_SUCCESS) {
+    return HAL_ERROR;
+  }
+  dspSpectrumQ15_buildWindow(sp);
+  return HAL_OK;
+}
+
+void dspSpectrumQ15_process(DSP_SpectrumQ15_t *sp, const uint16_t *block,
+                            uint32_t frames) {
+  if (sp == NULL || block == NULL || sp->cfg.length == 0U) {
+    return;
+  }
+
+  const uint16_t *src = &block[sp->slot];
+  for (uint32_t f = 0; f < frames; f++) {
+    // 12-bit codes: x 8 stays below 32768
+    dspSpectrumQ15_collect(
+        sp, (q15_t)((*src & 0x0FFFU) << DSP_SPECTRUM_Q15_FRAC_BITS));
+    src += ADC_CONVERSIONS_CHANNEL_COUNT;
+  }
+}
+
+void dspSpectrumQ15_pushSamples(DSP_SpectrumQ15_t *sp,
+                                const float32_t *samples, uint32_t count) {
+  if (sp == NULL || samples == NULL || sp->cfg.length == 0U) {
+    return;
+  }
+
+  for (uint32_t i = 0; i < count; i++) {
+    float32_t v = samples[i] * (float32_t)(1U << DSP_SPECTRUM_Q15_FRAC_BITS);
+    v += (v >= 0.0f) ? 0.5f : -0.5f;
+    v = (v > DSP_SPECTRUM_Q15_SAMPLE_MAX)   ? DSP_SPECTRUM_Q15_SAMPLE_MAX
+        : (v < DSP_SPECTRUM_Q15_SAMPLE_MIN) ? DSP_SPECTRUM_Q15_SAMPLE_MIN
+                                            : v;
+    dspSpectrumQ15_collect(sp, (q15_t)v);
+  }
+}
+
+void dspSpectrumQ15_poll(DSP_SpectrumQ15_t *sp) {
+  if (sp == NULL || !sp->segment_ready) {
+    return;
+  }
+  __DMB();
+
+  const uint16_t n_len = sp->cfg.length;
+  const uint16_t half = n_len / 2U;
+
+  sp->shift = dspSpectrumQ15_normalise(sp->segment, n_len);
+  arm_mult_q15(sp->segment, sp->window, sp->segment, n_len);
+
+  // Works in place on segment[]; the output is scaled by 1 / length
+  arm_rfft_q15(&sp->rfft, sp->segment, fft_out);
+
+  // segment[] is free again for the ISR
+  __DMB();
+  sp->segment_ready = 0;
+
+  // Codes per output unit: the FFT scaling, the block shift, the fraction
+  const float32_t unit =
+      (float32_t)n_len /
+      (float32_t)(1UL << (sp->shift + DSP_SPECTRUM_Q15_FRAC_BITS));
+  const float32_t scale = unit * unit;
+  for (uint16_t k = 0; k <= half; k++) {
+    const int32_t re = fft_out[2U * k];
+    const int32_t im = fft_out[2U * k + 1U];
+    const float32_t p = (float32_t)(re * re + im * im) * scale;
+    sp->power[k] += p;
+    if (k != 0U && k != half) {
+      sp->power_sq[k] += p * p;
+    }
+  }
+
+  if (++sp->averaged >= sp->cfg.averages) {
+    dspSpectrumQ15_publish(sp);
+  }
+}
+
+HAL_StatusTypeDef dspSpectrumQ15_setTones(DSP_SpectrumQ15_t *sp,
+                                          const float32_t *tone_hz,
+                                          uint8_t count) {
+  if (sp == NULL || (tone_hz == NULL && count != 0U) ||
+      count > DSP_SPECTRUM_MAX_TONES) {
+    return HAL_ERROR;
+  }
+  DSP_SpectrumConfig_t cfg = sp->cfg;
+  for (uint8_t i = 0; i < count; i++) {
+    cfg.tone_hz[i] = tone_hz[i];
+  }
+  cfg.tone_count = count;
+  if (dspSpectrum_checkConfig(&cfg, DSP_SPECTRUM_Q15_BUFFER_LENGTH) !=
+      HAL_OK) {
+    return HAL_ERROR;
+  }
+  sp->cfg = cfg;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef dspSpectrumQ15_getResult(DSP_SpectrumQ15_t *sp,
+                                           DSP_SpectrumResult_t *result) {
+  if (sp == NULL || result == NULL) {
+    return HAL_ERROR;
+  }
+  if (sp->result_seq == sp->read_seq) {
+    return HAL_BUSY;
+  }
+  *result = sp->result;
+  sp->read_seq = sp->result_seq;
+  return HAL_OK;
+}
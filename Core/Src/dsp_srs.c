@@ -0,0 +1,128 @@
+/**
+ ******************************************************************************
+ * @file    dsp_srs.c
+ * @brief   Implementation of the shock response spectrum
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "dsp_srs.h"
+#include <math.h>
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define DSP_SRS_MAX_PER_OCTAVE 24U
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+ * @brief Run every oscillator on one input sample and keep its peak
+ */
+static inline void dspSrs_step(const DSP_SrsBank_t *bank, float32_t x0,
+                               float32_t x1, float32_t x2, float32_t *y1,
+                               float32_t *y2, float32_t *peak) {
+  for (uint8_t k = 0; k < bank->count; k++) {
+    const float32_t y = bank->b0[k] * x0 + bank->b1[k] * x1 +
+                        bank->b2[k] * x2 + bank->a1[k] * y1[k] +
+                        bank->a2[k] * y2[k];
+    y2[k] = y1[k];
+    y1[k] = y;
+    peak[k] = fmaxf(peak[k], fabsf(y));
+  }
+}
+
+/* Public functions ----------------------------------------------------------*/
+
+HAL_StatusTypeDef dspSrs_init(DSP_SrsBank_t *bank, float32_t sample_rate_hz,
+                              float32_t first_hz, float32_t last_hz,
+                              uint8_t per_octave, float32_t q) {
+  if (bank == NULL || !(sample_rate_hz > 0.0f) || !(first_hz > 0.0f) ||
+      per_octave == 0U || per_octave > DSP_SRS_MAX_PER_OCTAVE ||
+      !(q > 0.5f)) {
+    return HAL_ERROR;
+  }
+  const float32_t top_hz =
+      (last_hz < 0.25f * sample_rate_hz) ? last_hz : 0.25f * sample_rate_hz;
+  const float32_t zeta = 0.5f / q;
+  const float32_t t = 1.0f / sample_rate_hz;
+
+  memset(bank, 0, sizeof(*bank));
+  bank->per_octave = per_octave;
+  bank->q = q;
+  bank->sample_rate_hz = sample_rate_hz;
+  for (uint32_t k = 0;; k++) {
+    // 1.0001: a last frequency equal to top_hz survives the rounding
+    const float32_t fn =
+        first_hz * exp2f((float32_t)k / (float32_t)per_octave);
+    if (fn > top_hz * 1.0001f) {
+      break;
+    }
+    if (k >= DSP_SRS_MAX_FREQS) {
+      return HAL_ERROR;
+    }
+    const float32_t w = 2.0f * PI * fn;
+    const float32_t e = expf(-zeta * w * t);
+    const float32_t kd = w * sqrtf(1.0f - zeta * zeta) * t;
+    const float32_t c = e * cosf(kd);
+    const float32_t sp = e * sinf(kd) / kd;
+    bank->fn_hz[k] = fn;
+    bank->b0[k] = 1.0f - sp;
+    bank->b1[k] = 2.0f * (sp - c);
+    bank->b2[k] = e * e - sp;
+    bank->a1[k] = 2.0f * c;
+    bank->a2[k] = -e * e;
+    bank->count = (uint8_t)(k + 1U);
+  }
+  return (bank->count != 0U) ? HAL_OK : HAL_ERROR;
+}
+
+HAL_StatusTypeDef dspSrs_compute(const DSP_SrsBank_t *bank,
+                                 const ADC_Frame_t *frames,
+                                 uint32_t frame_count, uint8_t channel,
+                                 uint32_t baseline_frames,
+                                 float32_t mg_per_code, DSP_SrsResult_t *res) {
+  if (bank == NULL || frames == NULL || res == NULL || frame_count == 0U ||
+      channel >= ADC_CONVERSIONS_CHANNEL_COUNT) {
+    return HAL_ERROR;
+  }
+  // The zero: the mean before the trigger, wherever gravity has it
+  const uint32_t nb = (baseline_frames == 0U) ? 1U
+                      : (baseline_frames < frame_count) ? baseline_frames
+                                                        : frame_count;
+  uint32_t sum = 0;
+  for (uint32_t n = 0; n < nb; n++) {
+    sum += frames[n].samples[channel];
+  }
+  const float32_t zero = (float32_t)sum / (float32_t)nb;
+
+  float32_t y1[DSP_SRS_MAX_FREQS] = {0};
+  float32_t y2[DSP_SRS_MAX_FREQS] = {0};
+  memset(res, 0, sizeof(*res));
+  res->channel = channel;
+  res->count = bank->count;
+  res->zero_code = zero;
+
+  float32_t x1 = 0.0f;
+  float32_t x2 = 0.0f;
+  for (uint32_t n = 0; n < frame_count; n++) {
+    const float32_t x0 =
+        ((float32_t)frames[n].samples[channel] - zero) * mg_per_code;
+    res->input_peak_mg = fmaxf(res->input_peak_mg, fabsf(x0));
+    dspSrs_step(bank, x0, x1, x2, y1, y2, res->peak_mg);
+    x2 = x1;
+    x1 = x0;
+  }
+
+  // Residual: free ring-down for a period of the lowest frequency
+  const uint32_t ring =
+      (bank->count != 0U)
+          ? (uint32_t)ceilf(bank->sample_rate_hz / bank->fn_hz[0])
+          : 0U;
+  for (uint32_t n = 0; n < ring; n++) {
+    dspSrs_step(bank, 0.0f, x1, x2, y1, y2, res->peak_mg);
+    x2 = x1;
+    x1 = 0.0f;
+  }
+  return HAL_OK;
+}
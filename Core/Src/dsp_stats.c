@@ -0,0 +1,182 @@
+/**
+ ******************************************************************************
+ * @file    dsp_stats.c
+ * @brief   Implementation of the single-pass statistics kernel
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "dsp_stats.h"
+#include "adc_sections.h"
+#include <math.h>
+#include <string.h>
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+ * @brief Widen a channel pair's partials into the 64-bit totals
+ */
+static void dspStats_flushPair(DSP_StatsAccum_t *acc,
+                               const DSP_StatsPair_t *p, uint32_t frames) {
+  for (uint8_t k = 0; k < 2U; k++) {
+    uint16_t mn = (uint16_t)(p->min >> (16U * k));
+    uint16_t mx = (uint16_t)(p->max >> (16U * k));
+    acc[k].count += frames;
+    acc[k].sum += p->sum[k];
+    acc[k].sum_sq += p->sum_sq[k];
+    acc[k].sum_cube += (double)p->sum_cube[k];
+    acc[k].sum_quad += (double)p->sum_quad[k];
+    if (mn < acc[k].min) {
+      acc[k].min = mn;
+    }
+    if (mx > acc[k].max) {
+      acc[k].max = mx;
+    }
+  }
+}
+
+/**
+ * @brief Scalar path for a trailing odd frame
+ */
+static void dspStats_addFrame(DSP_StatsAccum_t *acc, const uint16_t *frame) {
+  for (uint8_t s = 0; s < ADC_CONVERSIONS_CHANNEL_COUNT; s++) {
+    dspStats_addSample(&acc[s], frame[s]);
+  }
+}
+
+/**
+ * @brief Scalar path for the last channel of an odd channel count
+ */
+static void dspStats_addTail(DSP_StatsAccum_t *acc, const uint16_t *block,
+                             uint32_t frames) {
+  const uint8_t s = ADC_CONVERSIONS_CHANNEL_COUNT - 1U;
+  for (uint32_t f = 0; f < frames; f++) {
+    dspStats_addSample(&acc[s], block[f * ADC_CONVERSIONS_CHANNEL_COUNT + s]);
+  }
+}
+
+/* Public functions ----------------------------------------------------------*/
+
+void dspStats_reset(DSP_StatsAccum_t *acc) {
+  if (acc == NULL) {
+    return;
+  }
+  for (uint8_t s = 0; s < ADC_CONVERSIONS_CHANNEL_COUNT; s++) {
+    acc[s].count = 0;
+    acc[s].sum = 0;
+    acc[s].sum_sq = 0;
+    acc[s].sum_cube = 0.0;
+    acc[s].sum_quad = 0.0;
+    acc[s].min = 0xFFFFU;
+    acc[s].max = 0;
+  }
+}
+
+ADC_FAST_CODE void dspStats_accumulate(DSP_StatsAccum_t *acc,
+                                       const uint16_t *block,
+                                       uint32_t frames) {
+  if (acc == NULL || block == NULL) {
+    return;
+  }
+
+  uint32_t f = 0;
+  while (f + 2U <= frames) {
+    uint32_t n = frames - f;
+    if (n > DSP_STATS_CHUNK_FRAMES) {
+      n = DSP_STATS_CHUNK_FRAMES;
+    }
+    n &= ~1U;
+
+    // Constant trip count: unrolled at the default table's three pairs
+    DSP_StatsPair_t pair[DSP_STATS_PAIRS];
+    for (uint8_t k = 0; k < DSP_STATS_PAIRS; k++) {
+      pair[k] = (DSP_StatsPair_t){.min = 0xFFFFFFFFU};
+    }
+    const uint16_t *p = &block[f * ADC_CONVERSIONS_CHANNEL_COUNT];
+    for (uint32_t j = 0; j < n; j += 2U) {
+      const uint16_t *q = p + ADC_CONVERSIONS_CHANNEL_COUNT;
+      for (uint8_t k = 0; k < DSP_STATS_PAIRS; k++) {
+        dspStats_pair2(&pair[k], dspStats_load2(&p[2U * k]),
+                       dspStats_load2(&q[2U * k]));
+      }
+      p += 2U * ADC_CONVERSIONS_CHANNEL_COUNT;
+    }
+
+    for (uint8_t k = 0; k < DSP_STATS_PAIRS; k++) {
+      dspStats_flushPair(&acc[2U * k], &pair[k], n);
+    }
+    if (ADC_CONVERSIONS_CHANNEL_COUNT % 2U != 0U) {
+      dspStats_addTail(acc, &block[f * ADC_CONVERSIONS_CHANNEL_COUNT], n);
+    }
+    f += n;
+  }
+
+  if (f < frames) {
+    dspStats_addFrame(acc, &block[f * ADC_CONVERSIONS_CHANNEL_COUNT]);
+  }
+}
+
+void dspStats_merge(DSP_StatsAccum_t *dst, const DSP_StatsAccum_t *src) {
+  if (dst == NULL || src == NULL || src->count == 0U) {
+    return;
+  }
+  if (dst->count == 0U) {
+    *dst = *src;
+    return;
+  }
+  dst->count += src->count;
+  dst->sum += src->sum;
+  dst->sum_sq += src->sum_sq;
+  dst->sum_cube += src->sum_cube;
+  dst->sum_quad += src->sum_quad;
+  if (src->min < dst->min) {
+    dst->min = src->min;
+  }
+  if (src->max > dst->max) {
+    dst->max = src->max;
+  }
+}
+
+void dspStats_compute(const DSP_StatsAccum_t *acc, ADC_ChannelStats_t *out) {
+  if (acc == NULL || out == NULL) {
+    return;
+  }
+  memset(out, 0, sizeof(*out));
+  if (acc->count == 0U) {
+    return;
+  }
+
+  // Once per read; double keeps sum_sq / n - mean^2 free of cancellation
+  double n = (double)acc->count;
+  double mean = (double)acc->sum / n;
+  double variance = (double)acc->sum_sq / n - mean * mean;
+  if (variance < 0.0) {
+    variance = 0.0;
+  }
+  double rms = sqrt(variance);
+
+  out->count = acc->count;
+  out->min = acc->min;
+  out->max = acc->max;
+  out->peak_to_peak = (uint16_t)(acc->max - acc->min);
+  out->mean = (float)mean;
+  out->variance = (float)variance;
+  out->rms = (float)rms;
+
+  double peak = fmax((double)acc->max - mean, mean - (double)acc->min);
+  out->crest_factor = (rms > 0.0) ? (float)(peak / rms) : 0.0f;
+
+  // Central moments from the raw moments about the reference
+  const double a1 = mean - (double)DSP_STATS_MOMENT_REF;
+  const double a3 = acc->sum_cube / n;
+  const double a4 = acc->sum_quad / n;
+  const double a2 = variance + a1 * a1;
+  const double m3 = a3 - 3.0 * a1 * a2 + 2.0 * a1 * a1 * a1;
+  const double m4 =
+      a4 - 4.0 * a1 * a3 + 6.0 * a1 * a1 * a2 - 3.0 * a1 * a1 * a1 * a1;
+  if (variance > 0.0) {
+    out->skewness = (float)(m3 / (variance * rms));
+    out->kurtosis = (float)(m4 / (variance * variance));
+  }
+}
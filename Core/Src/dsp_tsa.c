@@ -0,0 +1,184 @@
+/**
+ ******************************************************************************
+ * @file    dsp_tsa.c
+ * @brief   Implementation of the time-synchronous averager
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "dsp_tsa.h"
+#include <stddef.h>
+#include <string.h>
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+ * @brief Drop the sums and the revolution in progress
+ */
+static void dspTsa_clear(DSP_Tsa_t *tsa) {
+  memset(tsa->sum, 0, sizeof(tsa->sum));
+  memset(tsa->sum_sq, 0, sizeof(tsa->sum_sq));
+  tsa->averaged = 0;
+  tsa->rejected = 0;
+  tsa->started = 0;
+  tsa->broken = 0;
+  tsa->next = 0;
+}
+
+/**
+ * @brief The average of the sums, its features, and a fresh start
+ */
+static void dspTsa_publish(DSP_Tsa_t *tsa) {
+  const uint16_t n = tsa->cfg.samples_per_rev;
+  const float32_t k = (float32_t)tsa->averaged;
+  DSP_TsaResult_t *res = &tsa->result;
+
+  float32_t mean = 0.0f;
+  float32_t spread = 0.0f; // sum over angles of the per-angle variance
+  float32_t lo = tsa->sum[0] / k;
+  float32_t hi = lo;
+  for (uint16_t i = 0; i < n; i++) {
+    const float32_t m = tsa->sum[i] / k;
+    const float32_t var = tsa->sum_sq[i] / k - m * m;
+    spread += (var > 0.0f) ? var : 0.0f;
+    mean += m;
+    lo = (m < lo) ? m : lo;
+    hi = (m > hi) ? m : hi;
+    res->samples[i] = m + tsa->offset;
+  }
+  mean /= (float32_t)n;
+
+  float32_t ac = 0.0f;
+  for (uint16_t i = 0; i < n; i++) {
+    const float32_t d = res->samples[i] - tsa->offset - mean;
+    ac += d * d;
+  }
+  arm_sqrt_f32(ac / (float32_t)n, &res->rms);
+  // Unbiased over the K revolutions; 0 for a single one
+  const float32_t unbias = (tsa->averaged > 1U) ? k / (k - 1.0f) : 0.0f;
+  arm_sqrt_f32(spread / (float32_t)n * unbias, &res->residual_rms);
+  res->mean = mean + tsa->offset;
+  res->peak_to_peak = hi - lo;
+  res->samples_per_rev = n;
+  res->revolutions = tsa->averaged;
+  res->rejected = tsa->rejected;
+  res->sequence = ++tsa->result_seq;
+
+  memset(tsa->sum, 0, sizeof(tsa->sum));
+  memset(tsa->sum_sq, 0, sizeof(tsa->sum_sq));
+  tsa->averaged = 0;
+  tsa->rejected = 0;
+}
+
+/**
+ * @brief Add the completed revolution to the sums, or count it dropped
+ */
+static void dspTsa_finish(DSP_Tsa_t *tsa) {
+  const uint16_t n = tsa->cfg.samples_per_rev;
+
+  tsa->started = 0;
+  tsa->next = 0;
+  if (tsa->broken) {
+    tsa->broken = 0;
+    tsa->rejected++;
+    tsa->total_rejected++;
+    return;
+  }
+
+  if (tsa->averaged == 0U) {
+    // Sums of deviations from this revolution's level: a squared code of
+    // 2048 would leave the variance to float rounding
+    float32_t level;
+    arm_mean_f32(tsa->rev, n, &level);
+    tsa->offset = level;
+  }
+  for (uint16_t i = 0; i < n; i++) {
+    const float32_t d = tsa->rev[i] - tsa->offset;
+    tsa->sum[i] += d;
+    tsa->sum_sq[i] += d * d;
+  }
+  tsa->total++;
+  if (++tsa->averaged >= tsa->cfg.revolutions) {
+    dspTsa_publish(tsa);
+  }
+}
+
+/* Public functions ----------------------------------------------------------*/
+
+HAL_StatusTypeDef dspTsa_init(DSP_Tsa_t *tsa, const DSP_TsaConfig_t *cfg) {
+  if (tsa == NULL || cfg == NULL || cfg->samples_per_rev < 2U ||
+      cfg->samples_per_rev > DSP_TSA_MAX_SAMPLES || cfg->revolutions == 0U) {
+    return HAL_ERROR;
+  }
+  memset(tsa, 0, sizeof(*tsa));
+  tsa->cfg = *cfg;
+  return HAL_OK;
+}
+
+void dspTsa_add(DSP_Tsa_t *tsa, uint16_t position, float32_t value) {
+  if (tsa == NULL || position >= tsa->cfg.samples_per_rev) {
+    return;
+  }
+
+  if (position == 0U) {
+    if (tsa->started) {
+      // The previous one never reached its last angle
+      tsa->broken = 1;
+      dspTsa_finish(tsa);
+    }
+    tsa->started = 1;
+  } else if (!tsa->started) {
+    return; // joined mid-revolution: wait for the reference
+  }
+  if (position != tsa->next) {
+    tsa->broken = 1; // angles between were lost
+  }
+  tsa->rev[position] = value;
+  tsa->next = (uint16_t)(position + 1U);
+  if (tsa->next == tsa->cfg.samples_per_rev) {
+    dspTsa_finish(tsa);
+  }
+}
+
+void dspTsa_skip(DSP_Tsa_t *tsa) {
+  if (tsa != NULL && tsa->started) {
+    tsa->broken = 1;
+  }
+}
+
+void dspTsa_restart(DSP_Tsa_t *tsa, uint8_t keep) {
+  if (tsa == NULL) {
+    return;
+  }
+  if (tsa->started) {
+    tsa->broken = 1;
+    dspTsa_finish(tsa); // counted as dropped
+  }
+  if (!keep) {
+    const uint16_t rejected = tsa->rejected;
+    dspTsa_clear(tsa);
+    tsa->rejected = rejected;
+  }
+}
+
+HAL_StatusTypeDef dspTsa_setRevolutions(DSP_Tsa_t *tsa, uint16_t revolutions) {
+  if (tsa == NULL || revolutions == 0U) {
+    return HAL_ERROR;
+  }
+  tsa->cfg.revolutions = revolutions;
+  dspTsa_clear(tsa);
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef dspTsa_getResult(DSP_Tsa_t *tsa, DSP_TsaResult_t *result) {
+  if (tsa == NULL || result == NULL) {
+    return HAL_ERROR;
+  }
+  if (tsa->result_seq == tsa->read_seq) {
+    return HAL_BUSY;
+  }
+  *result = tsa->result;
+  tsa->read_seq = tsa->result_seq;
+  return HAL_OK;
+}
@@ -0,0 +1,139 @@
+/**
+ ******************************************************************************
+ * @file    dsp_vector.c
+ * @brief   Implementation of the tri-axis magnitude and tilt computation
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "dsp_vector.h"
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define DSP_VECTOR_RAD_TO_DEG (180.0f / PI)
+
+/* q13 matrix entry -> mg per code */
+#define DSP_VECTOR_MATRIX_SCALE                                                \
+  (1.0f / (float32_t)(1U << ADC_CAL_MATRIX_FRAC_BITS))
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+ * @brief atan(t) for 0 <= t <= 1, odd minimax polynomial
+ */
+static inline float32_t dspVector_atanUnit(float32_t t) {
+  const float32_t t2 = t * t;
+  return t * (0.99997726f +
+              t2 * (-0.33262347f +
+                    t2 * (0.19354346f +
+                          t2 * (-0.11643287f +
+                                t2 * (0.05265332f + t2 * -0.01172120f)))));
+}
+
+/**
+ * @brief One group of up to DSP_VECTOR_CHUNK frames
+ */
+static void dspVector_group(const DSP_Vector_t *vec, uint8_t g,
+                            const float32_t *frames, uint32_t n,
+                            DSP_VectorSample_t *out) {
+  float32_t axis[ADC_CAL_AXES][DSP_VECTOR_CHUNK];
+  float32_t yz[DSP_VECTOR_CHUNK];
+  float32_t sq[DSP_VECTOR_CHUNK];
+  const uint8_t ch0 = (uint8_t)(g * ADC_CAL_AXES);
+
+  // Gather the group's three axes into planes, in mg
+  for (uint32_t f = 0; f < n; f++) {
+    const float32_t *src = &frames[f * ADC_CONVERSIONS_CHANNEL_COUNT + ch0];
+    if (!vec->calibrate) {
+      axis[0][f] = src[0];
+      axis[1][f] = src[1];
+      axis[2][f] = src[2];
+      continue;
+    }
+    const float32_t c0 = src[0] - vec->offset[ch0];
+    const float32_t c1 = src[1] - vec->offset[ch0 + 1U];
+    const float32_t c2 = src[2] - vec->offset[ch0 + 2U];
+    for (uint8_t r = 0; r < ADC_CAL_AXES; r++) {
+      const float32_t *m = vec->matrix[g][r];
+      axis[r][f] = m[0] * c0 + m[1] * c1 + m[2] * c2;
+    }
+  }
+
+  arm_mult_f32(axis[1], axis[1], yz, n);
+  arm_mult_f32(axis[2], axis[2], sq, n);
+  arm_add_f32(yz, sq, yz, n);
+  arm_mult_f32(axis[0], axis[0], sq, n);
+  arm_add_f32(sq, yz, sq, n);
+
+  for (uint32_t f = 0; f < n; f++) {
+    DSP_VectorSample_t *v = &out[f * DSP_VECTOR_GROUPS + g];
+    float32_t horizontal;
+    arm_sqrt_f32(sq[f], &v->magnitude);
+    arm_sqrt_f32(yz[f], &horizontal);
+    v->pitch = dspVector_atan2(-axis[0][f], horizontal) * DSP_VECTOR_RAD_TO_DEG;
+    v->roll = dspVector_atan2(axis[1][f], axis[2][f]) * DSP_VECTOR_RAD_TO_DEG;
+  }
+}
+
+/* Public functions ----------------------------------------------------------*/
+
+HAL_StatusTypeDef dspVector_init(DSP_Vector_t *vec, uint8_t input_codes) {
+  if (vec == NULL) {
+    return HAL_ERROR;
+  }
+  memset(vec, 0, sizeof(*vec));
+  vec->calibrate = (input_codes != 0U);
+  dspVector_loadCalibration(vec);
+  return HAL_OK;
+}
+
+void dspVector_loadCalibration(DSP_Vector_t *vec) {
+  if (vec == NULL || !vec->calibrate) {
+    return;
+  }
+  const ADC_CalTable_t *cal = adcCal_getTable();
+  for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+    vec->offset[ch] = (float32_t)cal->offset[ch];
+  }
+  for (uint8_t g = 0; g < DSP_VECTOR_GROUPS; g++) {
+    for (uint8_t r = 0; r < ADC_CAL_AXES; r++) {
+      for (uint8_t c = 0; c < ADC_CAL_AXES; c++) {
+        vec->matrix[g][r][c] =
+            (float32_t)cal->matrix[g][r][c] * DSP_VECTOR_MATRIX_SCALE;
+      }
+    }
+  }
+}
+
+HAL_StatusTypeDef dspVector_compute(const DSP_Vector_t *vec,
+                                    const float32_t *frames, uint32_t count,
+                                    DSP_VectorSample_t *out) {
+  if (vec == NULL || frames == NULL || out == NULL) {
+    return HAL_ERROR;
+  }
+  for (uint32_t f = 0; f < count; f += DSP_VECTOR_CHUNK) {
+    const uint32_t n =
+        (count - f < DSP_VECTOR_CHUNK) ? count - f : DSP_VECTOR_CHUNK;
+    for (uint8_t g = 0; g < DSP_VECTOR_GROUPS; g++) {
+      dspVector_group(vec, g, &frames[f * ADC_CONVERSIONS_CHANNEL_COUNT], n,
+                      &out[f * DSP_VECTOR_GROUPS]);
+    }
+  }
+  return HAL_OK;
+}
+
+float32_t dspVector_atan2(float32_t y, float32_t x) {
+  const float32_t ax = (x < 0.0f) ? -x : x;
+  const float32_t ay = (y < 0.0f) ? -y : y;
+  if (ax == 0.0f && ay == 0.0f) {
+    return 0.0f;
+  }
+  // Fold to the first octant, then back
+  float32_t r = (ay <= ax) ? dspVector_atanUnit(ay / ax)
+                           : 0.5f * PI - dspVector_atanUnit(ax / ay);
+  if (x < 0.0f) {
+    r = PI - r;
+  }
+  return (y < 0.0f) ? -r : r;
+}
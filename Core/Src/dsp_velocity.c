@@ -0,0 +1,245 @@
+/**
+ ******************************************************************************
+ * @file    dsp_velocity.c
+ * @brief   Implementation of the velocity RMS stage
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "dsp_velocity.h"
+#include "adc_sections.h"
+#include <math.h>
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define DSP_VELOCITY_MM_S2_PER_MG 9.80665f // 1 mg in mm/s^2
+#define DSP_VELOCITY_EDGE_MAX 0.45f        // low-pass edge, fraction of fs
+#define DSP_VELOCITY_LEAK_RATIO 0.1f       // integrator pole / low_hz
+#define DSP_VELOCITY_Q 0.70710678f         // Butterworth
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+ * @brief Bilinear 2nd-order Butterworth section in CMSIS order
+ *        {b0, b1, b2, -a1, -a2}
+ */
+static void dspVelocity_biquad(float32_t *c, float32_t hz, float32_t fs,
+                               uint8_t highpass) {
+  const float32_t k = tanf(PI * hz / fs);
+  const float32_t norm = 1.0f / (1.0f + k / DSP_VELOCITY_Q + k * k);
+  const float32_t b0 = highpass ? norm : k * k * norm;
+  c[0] = b0;
+  c[1] = highpass ? -2.0f * b0 : 2.0f * b0;
+  c[2] = b0;
+  c[3] = -2.0f * (k * k - 1.0f) * norm;
+  c[4] = -(1.0f - k / DSP_VELOCITY_Q + k * k) * norm;
+}
+
+/**
+ * @brief Filters, integrator and interval length for the configured rate
+ */
+static HAL_StatusTypeDef dspVelocity_design(DSP_Velocity_t *vel) {
+  const DSP_VelocityConfig_t *cfg = &vel->cfg;
+  const float32_t fs = cfg->sample_rate_hz;
+  float32_t high = cfg->high_hz;
+  if (high > DSP_VELOCITY_EDGE_MAX * fs) {
+    high = DSP_VELOCITY_EDGE_MAX * fs;
+  }
+  if (!(fs > 0.0f) || !(cfg->low_hz < high)) {
+    return HAL_ERROR;
+  }
+  dspVelocity_biquad(&vel->coeffs[0], cfg->low_hz, fs, 1);
+  dspVelocity_biquad(&vel->coeffs[5], high, fs, 0);
+  vel->gain = cfg->mg_per_code * DSP_VELOCITY_MM_S2_PER_MG / (8.0f * fs);
+  vel->leak = expf(-2.0f * PI * DSP_VELOCITY_LEAK_RATIO * cfg->low_hz / fs);
+  vel->interval_frames = (uint32_t)(fs * (float32_t)cfg->interval_ms / 1000.0f);
+  if (vel->interval_frames == 0U) {
+    vel->interval_frames = 1U;
+  }
+  return HAL_OK;
+}
+
+/**
+ * @brief Start an empty interval
+ */
+static void dspVelocity_restart(DSP_Velocity_t *vel) {
+  memset(vel->sum_sq, 0, sizeof(vel->sum_sq));
+  memset(vel->peak, 0, sizeof(vel->peak));
+  vel->samples += vel->count;
+  vel->count = 0;
+}
+
+/**
+ * @brief Close the interval: publish it unless the filters were settling
+ */
+static void dspVelocity_publish(DSP_Velocity_t *vel) {
+  if (!vel->settled) {
+    vel->settled = 1;
+    dspVelocity_restart(vel);
+    return;
+  }
+  const uint32_t seq = vel->result_seq + 1U;
+  DSP_VelocityResult_t *res = &vel->result[seq & 1U];
+  const float32_t *zone = vel->cfg.zone_mm_s;
+
+  res->sequence = seq;
+  res->first = vel->samples;
+  res->frames = vel->count;
+  res->channels = vel->cfg.channels;
+  for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+    if (!((vel->cfg.channels >> ch) & 1U)) {
+      res->rms_mm_s[ch] = 0.0f;
+      res->peak_mm_s[ch] = 0.0f;
+      res->zone[ch] = DSP_VELOCITY_ZONE_NONE;
+      continue;
+    }
+    float32_t rms;
+    arm_sqrt_f32(vel->sum_sq[ch] / (float32_t)vel->count, &rms);
+    res->rms_mm_s[ch] = rms;
+    res->peak_mm_s[ch] = vel->peak[ch];
+    uint8_t z = DSP_VELOCITY_ZONE_NONE;
+    if (zone[0] > 0.0f) {
+      z = 0;
+      while (z < DSP_VELOCITY_ZONE_LIMITS && rms >= zone[z]) {
+        z++;
+      }
+    }
+    res->zone[ch] = z;
+  }
+  __DMB();
+  vel->result_seq = seq;
+  dspVelocity_restart(vel);
+}
+
+/**
+ * @brief Filter and integrate n frames of one slot
+ */
+ADC_FAST_CODE static void dspVelocity_channel(DSP_Velocity_t *vel,
+                                              const uint16_t *src, uint8_t ch,
+                                              uint32_t n) {
+  float32_t *buf = vel->work;
+  const float32_t offset = vel->offset[ch];
+  for (uint32_t i = 0; i < n; i++) {
+    buf[i] = (float32_t)src[i * ADC_CONVERSIONS_CHANNEL_COUNT] - offset;
+  }
+  arm_biquad_cascade_df2T_f32(&vel->biquad[ch], buf, buf, n);
+
+  // v[n] = leak v[n-1] + gain (7 a[n] + a[n-1])
+  const float32_t gain = vel->gain;
+  const float32_t leak = vel->leak;
+  float32_t v = vel->velocity[ch];
+  float32_t a1 = vel->accel[ch];
+  float32_t sum = 0.0f;
+  float32_t peak = vel->peak[ch];
+  for (uint32_t i = 0; i < n; i++) {
+    const float32_t a = buf[i];
+    v = leak * v + gain * (7.0f * a + a1);
+    a1 = a;
+    sum += v * v;
+    const float32_t mag = fabsf(v);
+    peak = (mag > peak) ? mag : peak;
+  }
+  vel->velocity[ch] = v;
+  vel->accel[ch] = a1;
+  vel->sum_sq[ch] += sum;
+  vel->peak[ch] = peak;
+}
+
+/* Public functions ----------------------------------------------------------*/
+
+HAL_StatusTypeDef dspVelocity_init(DSP_Velocity_t *vel,
+                                   const DSP_VelocityConfig_t *cfg,
+                                   const uint8_t *channel_map) {
+  if (vel == NULL || cfg == NULL || !(cfg->low_hz > 0.0f) ||
+      !(cfg->mg_per_code > 0.0f) || cfg->interval_ms == 0U ||
+      (cfg->channels & ADC_CHANNELS_MASK_ALL) == 0U) {
+    return HAL_ERROR;
+  }
+  memset(vel, 0, sizeof(*vel));
+  vel->cfg = *cfg;
+  if (dspVelocity_design(vel) != HAL_OK) {
+    return HAL_ERROR;
+  }
+  for (uint8_t s = 0; s < ADC_CONVERSIONS_CHANNEL_COUNT; s++) {
+    vel->slot_channel[s] = (channel_map != NULL) ? channel_map[s] : s;
+  }
+  for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+    arm_biquad_cascade_df2T_init_f32(&vel->biquad[ch], DSP_VELOCITY_STAGES,
+                                     vel->coeffs, vel->biquad_state[ch]);
+  }
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef dspVelocity_setSampleRate(DSP_Velocity_t *vel,
+                                            float32_t sample_rate_hz) {
+  if (vel == NULL) {
+    return HAL_ERROR;
+  }
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  const float32_t old_rate = vel->cfg.sample_rate_hz;
+  vel->cfg.sample_rate_hz = sample_rate_hz;
+  HAL_StatusTypeDef status = dspVelocity_design(vel);
+  if (status != HAL_OK) {
+    vel->cfg.sample_rate_hz = old_rate;
+    (void)dspVelocity_design(vel);
+  }
+  dspVelocity_restart(vel);
+  __set_PRIMASK(primask);
+  return status;
+}
+
+ADC_FAST_CODE void dspVelocity_process(DSP_Velocity_t *vel,
+                                       const uint16_t *block,
+                                       uint32_t frames) {
+  if (vel == NULL || block == NULL || frames == 0U) {
+    return;
+  }
+  if (!vel->primed) {
+    for (uint8_t s = 0; s < ADC_CONVERSIONS_CHANNEL_COUNT; s++) {
+      vel->offset[vel->slot_channel[s]] = (float32_t)block[s];
+    }
+    vel->primed = 1;
+  }
+
+  // Chunks end on the interval boundaries and fit the work buffer
+  uint32_t f = 0;
+  while (f < frames) {
+    uint32_t n = frames - f;
+    if (n > ADC_CONVERSIONS_BLOCK_FRAMES) {
+      n = ADC_CONVERSIONS_BLOCK_FRAMES;
+    }
+    if (n > vel->interval_frames - vel->count) {
+      n = vel->interval_frames - vel->count;
+    }
+    const uint16_t *p = &block[f * ADC_CONVERSIONS_CHANNEL_COUNT];
+    for (uint8_t s = 0; s < ADC_CONVERSIONS_CHANNEL_COUNT; s++) {
+      const uint8_t ch = vel->slot_channel[s];
+      if ((vel->cfg.channels >> ch) & 1U) {
+        dspVelocity_channel(vel, &p[s], ch, n);
+      }
+    }
+    vel->count += n;
+    f += n;
+    if (vel->count >= vel->interval_frames) {
+      dspVelocity_publish(vel);
+    }
+  }
+}
+
+HAL_StatusTypeDef dspVelocity_getResult(DSP_Velocity_t *vel,
+                                        DSP_VelocityResult_t *result) {
+  if (vel == NULL || result == NULL) {
+    return HAL_ERROR;
+  }
+  const uint32_t seq = vel->result_seq;
+  if (seq == vel->read_seq) {
+    return HAL_BUSY;
+  }
+  __DMB();
+  // Rewritten by the interval after next
+  *result = vel->result[seq & 1U];
+  vel->read_seq = seq;
+  return HAL_OK;
+}
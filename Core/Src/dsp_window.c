@@ -0,0 +1,138 @@
+/**
+ ******************************************************************************
+ * @file    dsp_window.c
+ * @brief   Implementation of the sliding-window operators
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "dsp_window.h"
+#include "adc_sections.h"
+#include <math.h>
+#include <string.h>
+
+/* Private functions ---------------------------------------------------------*/
+
+static inline uint16_t dspWindow_wrap(uint32_t i) {
+  return (uint16_t)((i >= DSP_WINDOW_MAX_FRAMES) ? i - DSP_WINDOW_MAX_FRAMES
+                                                 : i);
+}
+
+/* Public functions ----------------------------------------------------------*/
+
+void dspWindow_resetChannel(DSP_WindowChannel_t *c) {
+  // The rings need no clearing: only positions in the deques are read
+  c->max_head = 0;
+  c->max_count = 0;
+  c->min_head = 0;
+  c->min_count = 0;
+  c->pos = 0;
+  c->filled = 0;
+  c->sum = 0;
+  c->sum_sq = 0;
+}
+
+ADC_FAST_CODE void dspWindow_push(DSP_WindowChannel_t *c, uint16_t window,
+                                  uint16_t x) {
+  const uint16_t pos = c->pos;
+
+  // The oldest sample leaves; if it was an extreme it is at the front
+  if (c->filled == window) {
+    const uint16_t old = c->samples[pos];
+    c->sum -= old;
+    c->sum_sq -= (uint32_t)old * old;
+    if (c->max_count != 0U && c->max_q[c->max_head] == pos) {
+      c->max_head = dspWindow_wrap(c->max_head + 1U);
+      c->max_count--;
+    }
+    if (c->min_count != 0U && c->min_q[c->min_head] == pos) {
+      c->min_head = dspWindow_wrap(c->min_head + 1U);
+      c->min_count--;
+    }
+  } else {
+    c->filled++;
+  }
+  c->samples[pos] = x;
+  c->sum += x;
+  c->sum_sq += (uint32_t)x * x;
+
+  // Older samples it beats can no longer be the extreme: off the back
+  while (c->max_count != 0U &&
+         c->samples[c->max_q[dspWindow_wrap(c->max_head + c->max_count -
+                                            1U)]] <= x) {
+    c->max_count--;
+  }
+  c->max_q[dspWindow_wrap(c->max_head + c->max_count)] = pos;
+  c->max_count++;
+  while (c->min_count != 0U &&
+         c->samples[c->min_q[dspWindow_wrap(c->min_head + c->min_count -
+                                            1U)]] >= x) {
+    c->min_count--;
+  }
+  c->min_q[dspWindow_wrap(c->min_head + c->min_count)] = pos;
+  c->min_count++;
+
+  c->pos = (pos + 1U == window) ? 0U : (uint16_t)(pos + 1U);
+}
+
+HAL_StatusTypeDef dspWindow_init(DSP_Window_t *w, uint16_t window,
+                                 const uint8_t *channel_map) {
+  if (w == NULL || window == 0U || window > DSP_WINDOW_MAX_FRAMES) {
+    return HAL_ERROR;
+  }
+  w->window = window;
+  for (uint8_t s = 0; s < ADC_CONVERSIONS_CHANNEL_COUNT; s++) {
+    w->slot_channel[s] = (channel_map != NULL) ? channel_map[s] : s;
+    dspWindow_resetChannel(&w->channels[s]);
+  }
+  w->frames = 0;
+  return HAL_OK;
+}
+
+ADC_FAST_CODE void dspWindow_process(DSP_Window_t *w, const uint16_t *block,
+                                     uint32_t frames) {
+  if (w == NULL || block == NULL) {
+    return;
+  }
+  const uint16_t window = w->window;
+  for (uint8_t s = 0; s < ADC_CONVERSIONS_CHANNEL_COUNT; s++) {
+    DSP_WindowChannel_t *c = &w->channels[w->slot_channel[s]];
+    const uint16_t *p = &block[s];
+    for (uint32_t f = 0; f < frames; f++) {
+      dspWindow_push(c, window, *p);
+      p += ADC_CONVERSIONS_CHANNEL_COUNT;
+    }
+  }
+  w->frames += frames;
+}
+
+HAL_StatusTypeDef dspWindow_get(const DSP_Window_t *w, uint8_t channel,
+                                DSP_WindowResult_t *result) {
+  if (w == NULL || result == NULL ||
+      channel >= ADC_CONVERSIONS_CHANNEL_COUNT) {
+    return HAL_ERROR;
+  }
+  const DSP_WindowChannel_t *c = &w->channels[channel];
+
+  // The block callback slides it: take the figures of one frame
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  const uint16_t n = c->filled;
+  const uint16_t max = (n != 0U) ? dspWindow_max(c) : 0U;
+  const uint16_t min = (n != 0U) ? dspWindow_min(c) : 0U;
+  const uint32_t sum = c->sum;
+  const uint64_t var_n2 = dspWindow_varianceN2(c);
+  __set_PRIMASK(primask);
+
+  memset(result, 0, sizeof(*result));
+  if (n == 0U) {
+    return HAL_OK;
+  }
+  result->max = max;
+  result->min = min;
+  result->frames = n;
+  result->mean = (float32_t)sum / (float32_t)n;
+  result->rms = sqrtf((float32_t)var_n2) / (float32_t)n;
+  return HAL_OK;
+}
@@ -0,0 +1,378 @@
+/**
+ ******************************************************************************
+ * @file    dsp_zoom.c
+ * @brief   Implementation of the zoom FFT stage
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "dsp_zoom.h"
+#include "adc_sections.h"
+#include "arm_const_structs.h"
+#include <math.h>
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+#if DSP_ZOOM_BUFFER_LENGTH < DSP_ZOOM_LENGTH_MIN ||                            \
+    DSP_ZOOM_BUFFER_LENGTH > 4096U
+#error "DSP_ZOOM_BUFFER_LENGTH must be in 64..4096"
+#endif
+
+#define DSP_ZOOM_MID_CODE 2048.0f
+
+// Transition width x taps of a Blackman windowed sinc (normalised rate)
+#define DSP_ZOOM_BLACKMAN_WIDTH 5.5f
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+ * @brief Complex FFT of a supported length, NULL otherwise
+ */
+static const arm_cfft_instance_f32 *dspZoom_cfft(uint16_t length) {
+  switch (length) {
+  case 64U:
+    return &arm_cfft_sR_f32_len64;
+  case 128U:
+    return &arm_cfft_sR_f32_len128;
+  case 256U:
+    return &arm_cfft_sR_f32_len256;
+  case 512U:
+    return &arm_cfft_sR_f32_len512;
+  case 1024U:
+    return &arm_cfft_sR_f32_len1024;
+  case 2048U:
+    return &arm_cfft_sR_f32_len2048;
+  case 4096U:
+    return &arm_cfft_sR_f32_len4096;
+  default:
+    return NULL;
+  }
+}
+
+/**
+ * @brief Low-pass of one stage: cut-off at half its output rate, taps for
+ *        the transition between pass and alias band
+ *
+ * @param st   Stage, factor set
+ * @param pass Edge of the band to keep, relative to the stage input rate
+ */
+static void dspZoom_design(DSP_ZoomStage_t *st, float32_t pass) {
+  const float32_t cutoff = 0.5f / (float32_t)st->factor;
+  // Aliases fold onto the band from 1 / M - pass
+  const float32_t width = 2.0f * cutoff - 2.0f * pass;
+  uint32_t n = (uint32_t)ceilf(DSP_ZOOM_BLACKMAN_WIDTH / width);
+  n = (n + st->factor - 1U) / st->factor * st->factor;
+  if (n > DSP_ZOOM_MAX_TAPS) {
+    n = DSP_ZOOM_MAX_TAPS;
+  }
+  st->num_taps = (uint8_t)n;
+
+  const float32_t mid = 0.5f * (float32_t)(n - 1U);
+  float32_t sum = 0.0f;
+  for (uint32_t i = 0; i < n; i++) {
+    const float32_t t = (float32_t)i - mid;
+    const float32_t a = 2.0f * PI * (float32_t)i / (float32_t)(n - 1U);
+    const float32_t w = 0.42f - 0.5f * cosf(a) + 0.08f * cosf(2.0f * a);
+    const float32_t s = (t == 0.0f) ? 2.0f * cutoff
+                                    : sinf(2.0f * PI * cutoff * t) / (PI * t);
+    st->taps[i] = s * w;
+    sum += st->taps[i];
+  }
+  for (uint32_t i = 0; i < n; i++) {
+    st->taps[i] /= sum;
+  }
+}
+
+/**
+ * @brief Append one decimated sample; hand a full segment to the main loop
+ */
+static inline void dspZoom_collect(DSP_Zoom_t *zm, float32_t re,
+                                   float32_t im) {
+  const uint16_t n_len = zm->cfg.length;
+  const uint16_t half = n_len / 2U;
+
+  zm->collect[2U * zm->collected] = re;
+  zm->collect[2U * zm->collected + 1U] = im;
+  if (++zm->collected < n_len) {
+    return;
+  }
+
+  if (zm->segment_ready) {
+    zm->overruns++;
+  } else {
+    memcpy(zm->segment, zm->collect, 2U * n_len * sizeof(float32_t));
+    __DMB();
+    zm->segment_ready = 1;
+  }
+
+  // 50 % overlap: the second half starts the next segment
+  memmove(zm->collect, &zm->collect[n_len],
+          n_len * sizeof(float32_t));
+  zm->collected = half;
+}
+
+/**
+ * @brief Mix one sample to the band and run it down the chain
+ */
+static inline void dspZoom_sample(DSP_Zoom_t *zm, float32_t x) {
+  float32_t re = x * zm->nco_re;
+  float32_t im = x * zm->nco_im;
+  const float32_t t = zm->nco_re * zm->step_re - zm->nco_im * zm->step_im;
+  zm->nco_im = zm->nco_re * zm->step_im + zm->nco_im * zm->step_re;
+  zm->nco_re = t;
+
+  for (uint8_t s = 0; s < zm->stage_count; s++) {
+    DSP_ZoomStage_t *st = &zm->stage[s];
+    const uint8_t n = st->num_taps;
+    st->pos = (st->pos == 0U) ? (uint8_t)(n - 1U) : (uint8_t)(st->pos - 1U);
+    st->re[st->pos] = re;
+    st->im[st->pos] = im;
+    if (++st->phase < st->factor) {
+      return;
+    }
+    st->phase = 0;
+
+    // Polyphase: only the kept outputs are computed; taps are symmetric,
+    // so the ring can be walked from the newest sample
+    const float32_t *h = st->taps;
+    const uint8_t head = (uint8_t)(n - st->pos);
+    float32_t acc_re = 0.0f;
+    float32_t acc_im = 0.0f;
+    for (uint8_t i = 0; i < head; i++) {
+      acc_re += h[i] * st->re[st->pos + i];
+      acc_im += h[i] * st->im[st->pos + i];
+    }
+    for (uint8_t i = head; i < n; i++) {
+      acc_re += h[i] * st->re[i - head];
+      acc_im += h[i] * st->im[i - head];
+    }
+    re = acc_re;
+    im = acc_im;
+  }
+
+  if (zm->settle != 0U) {
+    zm->settle--;
+    return;
+  }
+  dspZoom_collect(zm, re, im);
+}
+
+/**
+ * @brief Pull the rotator back onto the unit circle (one Newton step)
+ */
+static inline void dspZoom_renormalise(DSP_Zoom_t *zm) {
+  const float32_t g = 1.5f - 0.5f * (zm->nco_re * zm->nco_re +
+                                     zm->nco_im * zm->nco_im);
+  zm->nco_re *= g;
+  zm->nco_im *= g;
+}
+
+/**
+ * @brief Amplitudes of the reported bins and the peak; restart the sums
+ */
+static void dspZoom_publish(DSP_Zoom_t *zm) {
+  const uint16_t n_len = zm->cfg.length;
+  const uint16_t h = zm->half_bins;
+  const uint16_t count = (uint16_t)(2U * h + 1U);
+  DSP_ZoomResult_t *res = &zm->result;
+
+  // One-sided amplitude: 2 |X| / sum(w), |X| averaged over the segments
+  const float32_t scale = 2.0f / zm->window_sum;
+  uint16_t peak = 0;
+  for (uint16_t i = 0; i < count; i++) {
+    // The FFT puts negative offsets in its upper half
+    const uint16_t k = (uint16_t)((i + n_len - h) % n_len);
+    float32_t mag;
+    arm_sqrt_f32(zm->power[k] / (float32_t)zm->cfg.averages, &mag);
+    res->amplitude[i] = mag * scale;
+    if (res->amplitude[i] > res->amplitude[peak]) {
+      peak = i;
+    }
+  }
+
+  // Parabolic interpolation on the magnitudes around the peak bin
+  float32_t offset = 0.0f;
+  if (peak > 0U && peak + 1U < count) {
+    const float32_t a = res->amplitude[peak - 1U];
+    const float32_t b = res->amplitude[peak];
+    const float32_t c = res->amplitude[peak + 1U];
+    const float32_t denom = a - 2.0f * b + c;
+    if (denom < 0.0f) {
+      offset = 0.5f * (a - c) / denom;
+    }
+  }
+  res->bin_count = count;
+  res->peak_hz = res->first_hz + ((float32_t)peak + offset) * res->bin_hz;
+  res->peak_amplitude = res->amplitude[peak];
+  res->sequence = ++zm->result_seq;
+  memset(zm->power, 0, sizeof(zm->power));
+  zm->averaged = 0;
+}
+
+/* Public functions ----------------------------------------------------------*/
+
+HAL_StatusTypeDef dspZoom_init(DSP_Zoom_t *zm, uint8_t channel,
+                               const uint8_t *channel_map,
+                               const DSP_ZoomConfig_t *cfg) {
+  if (zm == NULL || cfg == NULL || channel >= ADC_CONVERSIONS_CHANNEL_COUNT ||
+      cfg->length < DSP_ZOOM_LENGTH_MIN ||
+      cfg->length > DSP_ZOOM_BUFFER_LENGTH ||
+      dspZoom_cfft(cfg->length) == NULL || cfg->averages == 0U ||
+      cfg->window > DSP_WINDOW_FLATTOP || !(cfg->sample_rate_hz > 0.0f) ||
+      !(cfg->span_hz > 0.0f) || cfg->centre_hz - 0.5f * cfg->span_hz < 0.0f ||
+      cfg->centre_hz + 0.5f * cfg->span_hz > 0.5f * cfg->sample_rate_hz) {
+    return HAL_ERROR;
+  }
+  const float32_t fs = cfg->sample_rate_hz;
+
+  // The largest D whose clean band still holds the span
+  uint32_t d = 2U;
+  while (d * 2U <= DSP_ZOOM_MAX_DECIMATION &&
+         DSP_ZOOM_CLEAN * fs / (float32_t)(d * 2U) >= cfg->span_hz) {
+    d *= 2U;
+  }
+  if (DSP_ZOOM_CLEAN * fs / (float32_t)d < cfg->span_hz) {
+    return HAL_ERROR;
+  }
+
+  // /2 first if log2(D) is even, /4 stages, and /2 last: the longest FIR
+  // (the sharpest one) runs at the lowest rate
+  uint8_t factors[DSP_ZOOM_MAX_STAGES];
+  uint8_t count = 0;
+  uint32_t m = 0;
+  while ((1UL << m) < d) {
+    m++;
+  }
+  uint32_t rem = m - 1U;
+  if ((rem & 1U) != 0U) {
+    factors[count++] = 2U;
+    rem--;
+  }
+  for (; rem != 0U; rem -= 2U) {
+    if (count >= DSP_ZOOM_MAX_STAGES - 1U) {
+      return HAL_ERROR;
+    }
+    factors[count++] = 4U;
+  }
+  factors[count++] = 2U;
+
+  memset(zm, 0, sizeof(*zm));
+  zm->cfg = *cfg;
+  zm->channel = channel;
+  zm->slot = channel;
+  if (channel_map != NULL) {
+    for (uint8_t s = 0; s < ADC_CONVERSIONS_CHANNEL_COUNT; s++) {
+      if (channel_map[s] == channel) {
+        zm->slot = s;
+      }
+    }
+  }
+  zm->cfft = dspZoom_cfft(cfg->length);
+  zm->decimation = (uint16_t)d;
+  zm->stage_count = count;
+
+  // Every stage only has to keep the final clean band free of aliases
+  const float32_t edge = 0.5f * DSP_ZOOM_CLEAN * fs / (float32_t)d;
+  float32_t rate = fs;
+  float32_t settle = 0.0f;
+  uint32_t left = d;
+  for (uint8_t s = 0; s < count; s++) {
+    DSP_ZoomStage_t *st = &zm->stage[s];
+    st->factor = factors[s];
+    dspZoom_design(st, edge / rate);
+    // Fill time in output samples
+    settle += (float32_t)st->num_taps / (float32_t)left;
+    left /= st->factor;
+    rate /= (float32_t)st->factor;
+  }
+  zm->settle = (uint16_t)ceilf(settle) + 1U;
+
+  // NCO in double: the step sets the centre to well below a bin
+  const double turn = -2.0 * (double)PI * (double)cfg->centre_hz / (double)fs;
+  zm->nco_re = 1.0f;
+  zm->nco_im = 0.0f;
+  zm->step_re = (float32_t)cos(turn);
+  zm->step_im = (float32_t)sin(turn);
+
+  zm->window_sum = 0.0f;
+  for (uint16_t n = 0; n < cfg->length; n++) {
+    zm->window[n] = dspSpectrum_windowValue(cfg->window, n, cfg->length);
+    zm->window_sum += zm->window[n];
+  }
+
+  const float32_t bin_hz = fs / ((float32_t)d * (float32_t)cfg->length);
+  uint32_t h = (uint32_t)(0.5f * cfg->span_hz / bin_hz);
+  const uint32_t h_max =
+      (uint32_t)(0.5f * DSP_ZOOM_CLEAN * (float32_t)cfg->length);
+  zm->half_bins = (uint16_t)((h < h_max) ? h : h_max);
+  zm->result.decimation = zm->decimation;
+  zm->result.bin_hz = bin_hz;
+  zm->result.first_hz = cfg->centre_hz - (float32_t)zm->half_bins * bin_hz;
+  return HAL_OK;
+}
+
+ADC_FAST_CODE void dspZoom_process(DSP_Zoom_t *zm, const uint16_t *block,
+                                   uint32_t frames) {
+  if (zm == NULL || block == NULL || zm->cfg.length == 0U) {
+    return;
+  }
+
+  const uint16_t *src = &block[zm->slot];
+  for (uint32_t f = 0; f < frames; f++) {
+    dspZoom_sample(zm, (float32_t)*src - DSP_ZOOM_MID_CODE);
+    src += ADC_CONVERSIONS_CHANNEL_COUNT;
+  }
+  dspZoom_renormalise(zm);
+}
+
+ADC_FAST_CODE void dspZoom_pushSamples(DSP_Zoom_t *zm,
+                                       const float32_t *samples,
+                                       uint32_t count) {
+  if (zm == NULL || samples == NULL || zm->cfg.length == 0U) {
+    return;
+  }
+
+  for (uint32_t i = 0; i < count; i++) {
+    dspZoom_sample(zm, samples[i] - DSP_ZOOM_MID_CODE);
+  }
+  dspZoom_renormalise(zm);
+}
+
+void dspZoom_poll(DSP_Zoom_t *zm) {
+  if (zm == NULL || !zm->segment_ready) {
+    return;
+  }
+  __DMB();
+
+  const uint16_t n_len = zm->cfg.length;
+  float32_t *x = zm->segment;
+  for (uint16_t n = 0; n < n_len; n++) {
+    x[2U * n] *= zm->window[n];
+    x[2U * n + 1U] *= zm->window[n];
+  }
+  arm_cfft_f32(zm->cfft, x, 0, 1);
+  for (uint16_t k = 0; k < n_len; k++) {
+    zm->power[k] += x[2U * k] * x[2U * k] + x[2U * k + 1U] * x[2U * k + 1U];
+  }
+
+  // segment[] is free again for the ISR
+  __DMB();
+  zm->segment_ready = 0;
+
+  if (++zm->averaged >= zm->cfg.averages) {
+    dspZoom_publish(zm);
+  }
+}
+
+HAL_StatusTypeDef dspZoom_getResult(DSP_Zoom_t *zm, DSP_ZoomResult_t *result) {
+  if (zm == NULL || result == NULL) {
+    return HAL_ERROR;
+  }
+  if (zm->result_seq == zm->read_seq) {
+    return HAL_BUSY;
+  }
+  *result = zm->result;
+  zm->read_seq = zm->result_seq;
+  return HAL_OK;
+}
@@ -0,0 +1,321 @@
+/**
+ ******************************************************************************
+ * @file    dwt_counters.c
+ * @brief   Implementation of the DWT event counter windows
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "dwt_counters.h"
+#include "adc_sections.h"
+#include "telemetry.h"
+#include <stdio.h>
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define DWT_COUNTERS_WRAP 256U // the 8-bit counters
+#define DWT_COUNTERS_EVENTS                                                  \
+  (DWT_CTRL_CPIEVTENA_Msk | DWT_CTRL_EXCEVTENA_Msk |                         \
+   DWT_CTRL_SLEEPEVTENA_Msk | DWT_CTRL_LSUEVTENA_Msk |                       \
+   DWT_CTRL_FOLDEVTENA_Msk)
+#define DWT_COUNTERS_NO_STAGE 0xFFU
+
+#if DWT_COUNTERS_SAMPLE_CYCLES < 128U || DWT_COUNTERS_SAMPLE_CYCLES > 240U
+#error "DWT_COUNTERS_SAMPLE_CYCLES must be 128..240"
+#endif
+
+/* Private types -------------------------------------------------------------*/
+
+/**
+ * @brief One read of all counters
+ */
+typedef struct {
+  uint32_t cyc;
+  uint8_t cpi;
+  uint8_t exc;
+  uint8_t sleep;
+  uint8_t lsu;
+  uint8_t fold;
+} DwtCounters_Snap_t;
+
+typedef enum {
+  DWT_COUNTERS_IDLE = 0,
+  DWT_COUNTERS_RUNNING,
+  DWT_COUNTERS_DONE
+} DwtCounters_State_t;
+
+/* Private variables ---------------------------------------------------------*/
+static volatile DwtCounters_State_t state = DWT_COUNTERS_IDLE;
+static volatile uint8_t armed = DWT_COUNTERS_NO_STAGE;
+static volatile uint8_t window_open = 0;
+static const char *stage_name = "";
+static uint32_t target_windows = 0;
+static uint8_t reported = 1;
+
+/* Written with the window open by the sampler, otherwise by the stage */
+static DwtCounters_Result_t acc;
+static DwtCounters_Snap_t mark;  // read of the interval's start
+static uint8_t mark_sampler = 0; // ... taken as a sampler exited
+static uint8_t exc_min = 0xFFU;  // sampler entry + exit, in EXCCNT
+
+/* DMA2 Stream0 priority before the run, restored after it */
+static uint32_t dma_priority = 0;
+static uint8_t dma_moved = 0;
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+ * @brief Input clock of TIM4 (APB1 timers run at 2x PCLK1 when APB1 is divided)
+ */
+static uint32_t dwtCounters_clockHz(void) {
+  uint32_t clk = HAL_RCC_GetPCLK1Freq();
+  if ((RCC->CFGR & RCC_CFGR_PPRE1) != RCC_HCLK_DIV1) {
+    clk *= 2U;
+  }
+  return clk;
+}
+
+/**
+ * @brief Read every counter, CYCCNT first
+ */
+static inline void dwtCounters_read(DwtCounters_Snap_t *s) {
+  s->cyc = DWT->CYCCNT;
+  s->cpi = (uint8_t)DWT->CPICNT;
+  s->exc = (uint8_t)DWT->EXCCNT;
+  s->sleep = (uint8_t)DWT->SLEEPCNT;
+  s->lsu = (uint8_t)DWT->LSUCNT;
+  s->fold = (uint8_t)DWT->FOLDCNT;
+}
+
+/**
+ * @brief Add the interval from the mark to now
+ *
+ * @param between 1 = between two samples, so its EXCCNT is the sampler's
+ *                own entry and exit plus anything else that interrupted
+ */
+ADC_FAST_CODE static void dwtCounters_add(const DwtCounters_Snap_t *now,
+                                          uint8_t between) {
+  const uint32_t cycles = now->cyc - mark.cyc;
+  const uint8_t exc = (uint8_t)(now->exc - mark.exc);
+  acc.cycles += cycles;
+  acc.cpi += (uint8_t)(now->cpi - mark.cpi);
+  acc.exc += exc;
+  acc.sleep += (uint8_t)(now->sleep - mark.sleep);
+  acc.lsu += (uint8_t)(now->lsu - mark.lsu);
+  acc.fold += (uint8_t)(now->fold - mark.fold);
+  if (cycles >= DWT_COUNTERS_WRAP) {
+    acc.inexact++;
+  }
+  if (between && exc < exc_min) {
+    exc_min = exc;
+  }
+}
+
+/**
+ * @brief Stop TIM4 and drop an update it may have raised meanwhile
+ */
+static void dwtCounters_stopTimer(void) {
+  TIM4->CR1 = 0;
+  TIM4->SR = 0;
+  NVIC_ClearPendingIRQ(TIM4_IRQn);
+}
+
+/**
+ * @brief End of a run: timer, counters and DMA priority back
+ */
+static void dwtCounters_release(void) {
+  dwtCounters_stopTimer();
+  HAL_NVIC_DisableIRQ(TIM4_IRQn);
+  DWT->CTRL &= ~DWT_COUNTERS_EVENTS;
+  if (dma_moved) {
+    NVIC_SetPriority(DMA2_Stream0_IRQn, dma_priority);
+    dma_moved = 0;
+  }
+}
+
+/**
+ * @brief A total for the PERF line (no 64-bit printf in newlib-nano)
+ */
+static unsigned long dwtCounters_clamp(uint64_t v) {
+  return (v > UINT32_MAX) ? (unsigned long)UINT32_MAX : (unsigned long)v;
+}
+
+/* Public functions ----------------------------------------------------------*/
+
+HAL_StatusTypeDef dwtCounters_start(uint8_t stage, const char *name,
+                                    uint32_t windows) {
+#if !DWT_COUNTERS_ENABLE
+  UNUSED(stage);
+  UNUSED(name);
+  UNUSED(windows);
+  return HAL_ERROR;
+#else
+  if (name == NULL) {
+    return HAL_ERROR;
+  }
+  dwtCounters_stop();
+
+  memset(&acc, 0, sizeof(acc));
+  acc.stage = stage;
+  exc_min = 0xFFU;
+  stage_name = name;
+  target_windows = (windows != 0U) ? windows : DWT_COUNTERS_DEFAULT_WINDOWS;
+  reported = 0;
+
+  // CYCCNT is already running (profiler_init()); the others only for us
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk | DWT_COUNTERS_EVENTS;
+
+  // Sample period in TIM4 ticks, rounded down so it stays under 256 cycles
+  uint32_t ticks = (uint32_t)((uint64_t)DWT_COUNTERS_SAMPLE_CYCLES *
+                              dwtCounters_clockHz() / SystemCoreClock);
+  if (ticks < 2U) {
+    ticks = 2U;
+  }
+  __HAL_RCC_TIM4_CLK_ENABLE();
+  dwtCounters_stopTimer();
+  TIM4->PSC = 0;
+  TIM4->ARR = ticks - 1U;
+  TIM4->EGR = TIM_EGR_UG;
+  TIM4->SR = 0;
+  TIM4->DIER = TIM_DIER_UIE;
+  HAL_NVIC_SetPriority(TIM4_IRQn, DWT_COUNTERS_IRQ_PRIORITY, 0);
+  HAL_NVIC_EnableIRQ(TIM4_IRQn);
+
+  // The superloop runs the stages in the DMA interrupt
+  dma_priority = NVIC_GetPriority(DMA2_Stream0_IRQn);
+  if (dma_priority <= DWT_COUNTERS_IRQ_PRIORITY) {
+    NVIC_SetPriority(DMA2_Stream0_IRQn, DWT_COUNTERS_IRQ_PRIORITY + 1U);
+    dma_moved = 1;
+  }
+
+  state = DWT_COUNTERS_RUNNING;
+  __DMB();
+  armed = stage;
+  return HAL_OK;
+#endif
+}
+
+void dwtCounters_stop(void) {
+  if (state != DWT_COUNTERS_RUNNING) {
+    return;
+  }
+  armed = DWT_COUNTERS_NO_STAGE;
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  window_open = 0;
+  dwtCounters_release();
+  state = DWT_COUNTERS_IDLE;
+  __set_PRIMASK(primask);
+}
+
+ADC_FAST_CODE void dwtCounters_begin(uint8_t stage) {
+  if (stage != armed) {
+    return;
+  }
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  mark_sampler = 0;
+  window_open = 1;
+  TIM4->CNT = 0;
+  TIM4->SR = 0;
+  TIM4->CR1 = TIM_CR1_CEN;
+  dwtCounters_read(&mark);
+  __set_PRIMASK(primask);
+}
+
+ADC_FAST_CODE void dwtCounters_end(uint8_t stage) {
+  if (stage != armed || !window_open) {
+    return;
+  }
+  DwtCounters_Snap_t now;
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  dwtCounters_read(&now);
+  dwtCounters_stopTimer();
+  window_open = 0;
+  dwtCounters_add(&now, 0U);
+  acc.windows++;
+  __set_PRIMASK(primask);
+
+  if (acc.windows >= target_windows) {
+    armed = DWT_COUNTERS_NO_STAGE;
+    dwtCounters_release();
+    state = DWT_COUNTERS_DONE;
+  }
+}
+
+ADC_FAST_CODE void dwtCounters_irqHandler(void) {
+  DwtCounters_Snap_t now;
+  dwtCounters_read(&now);
+  TIM4->SR = ~TIM_SR_UIF;
+  if (!window_open) {
+    return;
+  }
+  dwtCounters_add(&now, mark_sampler);
+  acc.samples++;
+  // The stretch from here to the re-read is the sampler's own
+  mark_sampler = 1;
+  dwtCounters_read(&mark);
+}
+
+HAL_StatusTypeDef dwtCounters_getResult(DwtCounters_Result_t *result) {
+  if (result == NULL || state == DWT_COUNTERS_IDLE) {
+    return HAL_ERROR;
+  }
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  DwtCounters_Result_t r = acc;
+  const uint8_t own = (exc_min != 0xFFU) ? exc_min : 0U;
+  const uint8_t done = (state == DWT_COUNTERS_DONE) ? 1U : 0U;
+  __set_PRIMASK(primask);
+
+  // Each sample's entry and exit, as cycles and as exception cycles
+  uint64_t overhead = (uint64_t)own * r.samples;
+  if (overhead > r.exc) {
+    overhead = r.exc;
+  }
+  r.overhead = overhead;
+  r.cycles -= overhead;
+  r.exc -= overhead;
+  const uint64_t stalls = r.cpi + r.lsu + r.exc + r.sleep;
+  r.instructions = (r.cycles + r.fold > stalls) ? r.cycles + r.fold - stalls
+                                                : 0U;
+  *result = r;
+  return done ? HAL_OK : HAL_BUSY;
+}
+
+void dwtCounters_poll(void) {
+  char line[200];
+  DwtCounters_Result_t r;
+
+  if (reported || telemetry_getFreeSlots() == 0U ||
+      dwtCounters_getResult(&r) != HAL_OK) {
+    return;
+  }
+  reported = 1;
+  // Shares of the cycles in tenths of a percent, IPC in hundredths
+  const uint64_t cyc = (r.cycles != 0U) ? r.cycles : 1U;
+  const uint32_t ipc = (uint32_t)(r.instructions * 100U / cyc);
+  const uint32_t cpi = (uint32_t)(r.cpi * 1000U / cyc);
+  const uint32_t lsu = (uint32_t)(r.lsu * 1000U / cyc);
+  const uint32_t exc = (uint32_t)(r.exc * 1000U / cyc);
+  const uint32_t slp = (uint32_t)(r.sleep * 1000U / cyc);
+  int len = snprintf(
+      line, sizeof(line),
+      "PERF %s win=%lu cyc=%lu instr=%lu ipc=%lu.%02lu cpi=%lu.%lu%% "
+      "lsu=%lu.%lu%% exc=%lu.%lu%% sleep=%lu.%lu%% fold=%lu samples=%lu "
+      "inexact=%lu\r\n",
+      stage_name, (unsigned long)r.windows, dwtCounters_clamp(r.cycles),
+      dwtCounters_clamp(r.instructions), (unsigned long)(ipc / 100U),
+      (unsigned long)(ipc % 100U), (unsigned long)(cpi / 10U),
+      (unsigned long)(cpi % 10U), (unsigned long)(lsu / 10U),
+      (unsigned long)(lsu % 10U), (unsigned long)(exc / 10U),
+      (unsigned long)(exc % 10U), (unsigned long)(slp / 10U),
+      (unsigned long)(slp % 10U), dwtCounters_clamp(r.fold),
+      (unsigned long)r.samples, (unsigned long)r.inexact);
+  if (len > 0) {
+    telemetry_send((const uint8_t *)line, (uint16_t)strlen(line));
+  }
+}
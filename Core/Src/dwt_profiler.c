@@ -0,0 +1,117 @@
+/**
+ ******************************************************************************
+ * @file    dwt_profiler.c
+ * @brief   Implementation of the DWT cycle-counter probes
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "dwt_profiler.h"
+#include "adc_sections.h"
+#include "swo_trace.h"
+#include "telemetry.h"
+#include <stdio.h>
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+
+/* Key that unlocks the DWT registers for software access on the Cortex-M7 */
+#define DWT_LAR_UNLOCK_KEY 0xC5ACCE55U
+
+/* Private variables ---------------------------------------------------------*/
+static Profiler_Stats_t probes[PROFILER_PROBE_COUNT] ADC_FAST_BSS;
+
+static const char *const probe_names[PROFILER_PROBE_COUNT] = {
+    [PROFILER_PROBE_CONFIG] = "config",
+    [PROFILER_PROBE_START] = "start",
+    [PROFILER_PROBE_POLL] = "poll",
+    [PROFILER_PROBE_DMA_CALLBACK] = "dma_cb",
+    [PROFILER_PROBE_FILTER] = "filter",
+    [PROFILER_PROBE_FORMAT] = "format",
+    [PROFILER_PROBE_TRANSMIT] = "transmit",
+    [PROFILER_PROBE_SPECTRUM] = "spectrum",
+    [PROFILER_PROBE_INJECTED] = "injected",
+    [PROFILER_PROBE_READ_HAL] = "read_hal",
+    [PROFILER_PROBE_READ_LL] = "read_ll",
+    [PROFILER_PROBE_CODEC] = "codec",
+    [PROFILER_PROBE_OVERRUN] = "overrun",
+    [PROFILER_PROBE_ANOMALY] = "anomaly"};
+
+/* Next probe to report; PROFILER_PROBE_COUNT = no dump pending */
+static uint32_t dump_next = PROFILER_PROBE_COUNT;
+
+/* Public functions ----------------------------------------------------------*/
+
+void profiler_init(void) {
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->LAR = DWT_LAR_UNLOCK_KEY;
+  // A counter already running (boot profile) keeps its origin
+  if ((DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk) == 0U) {
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+  }
+  profiler_reset();
+}
+
+ADC_FAST_CODE void profiler_record(Profiler_Probe_t probe, uint32_t cycles) {
+  if ((uint32_t)probe >= PROFILER_PROBE_COUNT) {
+    return;
+  }
+  Profiler_Stats_t *p = &probes[probe];
+  p->count++;
+  p->total += cycles;
+  if (cycles < p->min) {
+    p->min = cycles;
+  }
+  if (cycles > p->max) {
+    p->max = cycles;
+  }
+#if SWO_TRACE_ENABLE
+  swoTrace_probe((uint8_t)probe, cycles);
+#endif
+}
+
+HAL_StatusTypeDef profiler_getStats(Profiler_Probe_t probe,
+                                    Profiler_Stats_t *stats) {
+  if ((uint32_t)probe >= PROFILER_PROBE_COUNT || stats == NULL) {
+    return HAL_ERROR;
+  }
+  *stats = probes[probe];
+  return HAL_OK;
+}
+
+void profiler_reset(void) {
+  for (uint32_t i = 0; i < PROFILER_PROBE_COUNT; i++) {
+    probes[i].count = 0;
+    probes[i].min = UINT32_MAX;
+    probes[i].max = 0;
+    probes[i].total = 0;
+  }
+}
+
+void profiler_dump(void) { dump_next = 0; }
+
+void profiler_poll(void) {
+  char line[96];
+
+  while (dump_next < PROFILER_PROBE_COUNT && telemetry_getFreeSlots() > 0U) {
+    Profiler_Stats_t p;
+    if (profiler_getStats((Profiler_Probe_t)dump_next, &p) != HAL_OK) {
+      dump_next++;
+      continue;
+    }
+
+    uint32_t mean = (p.count != 0U) ? (uint32_t)(p.total / p.count) : 0U;
+    uint32_t min = (p.count != 0U) ? p.min : 0U;
+    int len = snprintf(line, sizeof(line),
+                       "PROF %-8s n=%lu min=%lu max=%lu mean=%lu cyc\r\n",
+                       probe_names[dump_next], (unsigned long)p.count,
+                       (unsigned long)min, (unsigned long)p.max,
+                       (unsigned long)mean);
+    if (len > 0) {
+      telemetry_send((const uint8_t *)line, (uint16_t)strlen(line));
+    }
+    dump_next++;
+  }
+}
@@ -0,0 +1,644 @@
+/**
+ ******************************************************************************
+ * @file    eth_stream.c
+ * @brief   Implementation of the raw UDP block stream on the Ethernet MAC
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "eth_stream.h"
+#include "adc_channels.h"
+#include "adc_conversions.h"
+#include "adc_sections.h"
+#include "block_pool.h"
+#include "ptp_sync.h"
+#include "time_sync.h"
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define ETH_STREAM_HDR_SIZE 34U       // Ethernet 14 + IPv4 20
+#define ETH_STREAM_IP_OFFSET 14U
+#define ETH_STREAM_UDP_SIZE 8U
+#define ETH_STREAM_SLOT_MAP (8U * ((ADC_CONVERSIONS_CHANNEL_COUNT + 7U) / 8U))
+#define ETH_STREAM_APP_SIZE (32U + ETH_STREAM_SLOT_MAP) // see eth_stream.h
+#define ETH_STREAM_APP_PTP (20U + ETH_STREAM_SLOT_MAP)  // PTP time, then flags
+#define ETH_STREAM_FRAG_PAYLOAD 1480U // IPv4 payload per frame, MTU 1500
+#define ETH_STREAM_IP_MF 0x2000U      // more fragments
+#define ETH_STREAM_VERSION 2U
+#define ETH_STREAM_MIN_HCLK_HZ 25000000U
+#define ETH_STREAM_PHY_RESET_MS 500U
+
+/* Reception, for PTP only: frames are kept up to one short buffer, longer
+ * ones are dropped. A few spare buffers cover the frames being parsed. */
+#define ETH_STREAM_RX_BUFFER 256U
+#define ETH_STREAM_RX_POOL (ETH_RX_DESC_CNT + 2U)
+#define ETH_STREAM_PTP_FRAME (ETH_STREAM_HDR_SIZE + ETH_STREAM_UDP_SIZE + 64U)
+#define ETH_STREAM_PTP_TTL 1U // PTP multicast stays on the segment
+
+#define ETH_STREAM_BLOCK_BYTES (ADC_CONVERSIONS_BLOCK_SAMPLES * 2U)
+#define ETH_STREAM_DGRAM_BYTES                                                 \
+  (ETH_STREAM_UDP_SIZE + ETH_STREAM_APP_SIZE + ETH_STREAM_BLOCK_BYTES)
+#define ETH_STREAM_MAX_FRAGS                                                   \
+  ((ETH_STREAM_DGRAM_BYTES + ETH_STREAM_FRAG_PAYLOAD - 1U) /                  \
+   ETH_STREAM_FRAG_PAYLOAD)
+
+/* LAN8742A registers (IEEE 802.3 clause 22, plus the vendor status) */
+#define ETH_STREAM_PHY_BCR 0x00U
+#define ETH_STREAM_PHY_BSR 0x01U
+#define ETH_STREAM_PHY_ID1 0x02U
+#define ETH_STREAM_PHY_SCSR 0x1FU
+#define ETH_STREAM_PHY_BCR_RESET 0x8000U
+#define ETH_STREAM_PHY_BCR_AUTONEG 0x1000U
+#define ETH_STREAM_PHY_BCR_RESTART_AN 0x0200U
+#define ETH_STREAM_PHY_BSR_LINK 0x0004U
+#define ETH_STREAM_PHY_BSR_AN_DONE 0x0020U
+#define ETH_STREAM_PHY_SCSR_100M 0x0008U
+#define ETH_STREAM_PHY_SCSR_FULL_DUPLEX 0x0010U
+
+_Static_assert(ETH_STREAM_FRAG_PAYLOAD % 8U == 0U,
+               "IPv4 fragment offsets count 8-byte units");
+_Static_assert(ETH_STREAM_DGRAM_BYTES + 20U <= 0xFFFFU,
+               "a block must fit in one IPv4 datagram");
+_Static_assert(2U * (2U * ETH_STREAM_MAX_FRAGS + 1U) + 1U <= ETH_TX_DESC_CNT,
+               "two datagrams (one per buffer half) and a Delay_Req must fit "
+               "the descriptors");
+_Static_assert(ETH_STREAM_RX_POOL <= 32U, "one bit per receive buffer");
+
+#if ETH_STREAM_ENABLE
+/* RMII REF_CLK, MDIO, CRS_DV, MDC, RXD0 and RXD1 sit on ADC1/2 IN1, IN2,
+ * IN7, IN11, IN14 and IN15 */
+_Static_assert((ADC_CHANNELS_PINS_A & (GPIO_PIN_1 | GPIO_PIN_2 | GPIO_PIN_7)) ==
+                       0U &&
+                   (ADC_CHANNELS_PINS_C &
+                    (GPIO_PIN_1 | GPIO_PIN_4 | GPIO_PIN_5)) == 0U,
+               "PA1/PA2/PA7/PC1/PC4/PC5 are RMII pins: move channels off "
+               "ADC IN1/IN2/IN7/IN11/IN14/IN15");
+#endif
+
+/* Private types -------------------------------------------------------------*/
+
+/**
+ * @brief Headers of one datagram, kept until its fragments are sent
+ */
+typedef struct {
+  uint8_t frag_headers[ETH_STREAM_MAX_FRAGS][ETH_STREAM_HDR_SIZE];
+  uint8_t udp_header[ETH_STREAM_UDP_SIZE + ETH_STREAM_APP_SIZE];
+  volatile uint8_t pending; // fragments still owned by the DMA
+  BlockPool_Block_t *block; // samples held until the last fragment is sent
+} EthStream_Slot_t;
+
+/* Private variables ---------------------------------------------------------*/
+static ETH_HandleTypeDef heth;
+
+/* Descriptors and headers in DTCM: reachable by the ETH DMA and outside the
+ * D-cache, so no maintenance is needed. The samples are read in place. */
+static ETH_DMADescTypeDef tx_desc[ETH_TX_DESC_CNT] ADC_FAST_BSS;
+static ETH_DMADescTypeDef rx_desc[ETH_RX_DESC_CNT] ADC_FAST_BSS;
+static EthStream_Slot_t slots[2] ADC_FAST_BSS;
+static uint8_t next_slot = 0;
+
+static uint8_t mac_addr[6];
+static uint8_t header_template[ETH_STREAM_HDR_SIZE];
+static uint32_t board_id = 0;
+static uint16_t ip_id = 0;
+
+/* Receive buffers (bit set = given to the DMA or being parsed) */
+static uint8_t rx_buffers[ETH_STREAM_RX_POOL][ETH_STREAM_RX_BUFFER]
+    ADC_FAST_BSS __attribute__((aligned(4)));
+static uint32_t rx_used = 0;
+static uint32_t rx_len = 0; // length of the frame being linked
+static uint8_t rx_cut = 0;  // longer than one buffer: dropped
+
+/* Delay_Req frame: headers and message, sent with a transmit stamp */
+static uint8_t ptp_frame[ETH_STREAM_PTP_FRAME] ADC_FAST_BSS;
+static volatile uint8_t ptp_pending = 0;
+
+static volatile uint8_t link_up = 0;
+static uint8_t mac_started_once = 0;
+static uint32_t last_link_poll_ms = 0;
+static EthStream_Stats_t stats = {0};
+
+/* Private functions ---------------------------------------------------------*/
+
+static void ethStream_putBe16(uint8_t *p, uint16_t v) {
+  p[0] = (uint8_t)(v >> 8);
+  p[1] = (uint8_t)v;
+}
+
+static void ethStream_putLe16(uint8_t *p, uint16_t v) {
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+}
+
+static void ethStream_putLe32(uint8_t *p, uint32_t v) {
+  ethStream_putLe16(p, (uint16_t)v);
+  ethStream_putLe16(p + 2, (uint16_t)(v >> 16));
+}
+
+static uint16_t ethStream_getBe16(const uint8_t *p) {
+  return (uint16_t)(((uint16_t)p[0] << 8) | p[1]);
+}
+
+/**
+ * @brief Locally administered MAC address and board id from the device UID
+ */
+static void ethStream_deriveIdentity(void) {
+  const uint32_t *uid = (const uint32_t *)UID_BASE;
+  board_id = uid[0] ^ uid[1] ^ uid[2];
+  mac_addr[0] = 0x02U;
+  mac_addr[1] = (uint8_t)(uid[0] >> 8);
+  mac_addr[2] = (uint8_t)(board_id >> 24);
+  mac_addr[3] = (uint8_t)(board_id >> 16);
+  mac_addr[4] = (uint8_t)(board_id >> 8);
+  mac_addr[5] = (uint8_t)board_id;
+}
+
+/**
+ * @brief Ethernet + IPv4 header shared by every fragment; length, id and
+ *        fragment fields are patched per frame, the checksum by the MAC
+ */
+static void ethStream_buildTemplate(void) {
+  static const uint8_t dest_mac[6] = ETH_STREAM_DEST_MAC;
+  static const uint8_t src_ip[4] = ETH_STREAM_IP_ADDR;
+  static const uint8_t dest_ip[4] = ETH_STREAM_DEST_IP;
+  uint8_t *ip = &header_template[ETH_STREAM_IP_OFFSET];
+
+  memcpy(&header_template[0], dest_mac, 6);
+  memcpy(&header_template[6], mac_addr, 6);
+  ethStream_putBe16(&header_template[12], 0x0800U); // IPv4
+
+  memset(ip, 0, 20);
+  ip[0] = 0x45U; // version 4, 5-word header
+  ip[8] = 64U;   // TTL
+  ip[9] = 17U;   // UDP
+  memcpy(&ip[12], src_ip, 4);
+  memcpy(&ip[16], dest_ip, 4);
+}
+
+static HAL_StatusTypeDef ethStream_readPhy(uint32_t reg, uint32_t *value) {
+  return HAL_ETH_ReadPHYRegister(&heth, ETH_STREAM_PHY_ADDR, reg, value);
+}
+
+static HAL_StatusTypeDef ethStream_initMac(void) {
+  heth.Instance = ETH;
+  heth.Init.MACAddr = mac_addr;
+  heth.Init.MediaInterface = HAL_ETH_RMII_MODE;
+  heth.Init.TxDesc = tx_desc;
+  heth.Init.RxDesc = rx_desc;
+  heth.Init.RxBuffLen = ETH_STREAM_RX_BUFFER;
+  if (HAL_ETH_Init(&heth) != HAL_OK) {
+    return HAL_ERROR;
+  }
+#if PTP_SYNC_ENABLE
+  // The MAC reset cleared the system time: stamping starts over
+  return ptpSync_start(mac_addr);
+#else
+  return HAL_OK;
+#endif
+}
+
+/**
+ * @brief Start the MAC at the negotiated speed with empty descriptor rings
+ */
+static HAL_StatusTypeDef ethStream_startMac(uint8_t speed_100m,
+                                            uint8_t full_duplex) {
+  // Re-initialising drops whatever a lost link left on the descriptors
+  if (mac_started_once) {
+    HAL_ETH_DeInit(&heth);
+    if (ethStream_initMac() != HAL_OK) {
+      return HAL_ERROR;
+    }
+  }
+  slots[0].pending = 0;
+  slots[1].pending = 0;
+  ptp_pending = 0;
+  rx_used = 0; // the descriptors get fresh buffers at the start
+
+#if PTP_SYNC_ENABLE
+  // PTP travels to 224.0.1.129 (01:00:5E:00:01:81)
+  ETH_MACFilterConfigTypeDef filter;
+  HAL_ETH_GetMACFilterConfig(&heth, &filter);
+  filter.PassAllMulticast = ENABLE;
+  if (HAL_ETH_SetMACFilterConfig(&heth, &filter) != HAL_OK) {
+    return HAL_ERROR;
+  }
+#endif
+
+  ETH_MACConfigTypeDef mac;
+  HAL_ETH_GetMACConfig(&heth, &mac);
+  mac.Speed = speed_100m ? ETH_SPEED_100M : ETH_SPEED_10M;
+  mac.DuplexMode = full_duplex ? ETH_FULLDUPLEX_MODE : ETH_HALFDUPLEX_MODE;
+  if (HAL_ETH_SetMACConfig(&heth, &mac) != HAL_OK ||
+      HAL_ETH_Start(&heth) != HAL_OK) {
+    return HAL_ERROR;
+  }
+  mac_started_once = 1;
+  return HAL_OK;
+}
+
+static void ethStream_freeRx(const uint8_t *buff) {
+  const uint32_t i =
+      (uint32_t)(buff - &rx_buffers[0][0]) / ETH_STREAM_RX_BUFFER;
+  if (i < ETH_STREAM_RX_POOL) {
+    rx_used &= ~(1UL << i);
+  }
+}
+
+/**
+ * @brief Hand a received PTP datagram (UDP to port 319/320) to ptp_sync
+ */
+static void ethStream_receive(const uint8_t *frame, uint32_t len,
+                              const ETH_TimeStampTypeDef *stamp) {
+  if (len < ETH_STREAM_HDR_SIZE + ETH_STREAM_UDP_SIZE ||
+      ethStream_getBe16(&frame[12]) != 0x0800U) {
+    return;
+  }
+  const uint8_t *ip = &frame[ETH_STREAM_IP_OFFSET];
+  const uint32_t ihl = (ip[0] & 0x0FU) * 4U;
+  const uint32_t ip_len = ethStream_getBe16(&ip[2]);
+  if ((ip[0] >> 4) != 4U || ihl < 20U || ip[9] != 17U ||
+      (ethStream_getBe16(&ip[6]) & 0x3FFFU) != 0U || // fragment
+      ETH_STREAM_IP_OFFSET + ip_len > len ||
+      ihl + ETH_STREAM_UDP_SIZE > ip_len) {
+    return;
+  }
+  const uint8_t *udp = &ip[ihl];
+  const uint32_t port = ethStream_getBe16(&udp[2]);
+  const uint32_t udp_len = ethStream_getBe16(&udp[4]);
+  if (udp_len < ETH_STREAM_UDP_SIZE || ihl + udp_len > ip_len) {
+    return;
+  }
+  if (port == PTP_SYNC_EVENT_PORT || port == PTP_SYNC_GENERAL_PORT) {
+    stats.ptp_received++;
+    ptpSync_receive(&udp[ETH_STREAM_UDP_SIZE], udp_len - ETH_STREAM_UDP_SIZE,
+                    (port == PTP_SYNC_EVENT_PORT) ? stamp : NULL);
+  }
+}
+
+static void ethStream_pollRx(void) {
+  void *frame = NULL;
+  for (uint32_t n = 0;
+       n < ETH_RX_DESC_CNT && HAL_ETH_ReadData(&heth, &frame) == HAL_OK; n++) {
+    ETH_TimeStampTypeDef stamp = {0};
+    HAL_ETH_PTP_GetRxTimestamp(&heth, &stamp);
+    if (!rx_cut) {
+      ethStream_receive((const uint8_t *)frame, rx_len, &stamp);
+    }
+    ethStream_freeRx((const uint8_t *)frame);
+  }
+}
+
+/**
+ * @brief Send the Delay_Req ptp_sync has due, stamped by the MAC
+ */
+static void ethStream_sendPtp(void) {
+  const uint8_t *msg = NULL;
+  if (ptp_pending) {
+    return; // the previous one is still on the descriptors
+  }
+  const uint32_t msg_len = ptpSync_takeDelayReq(&msg);
+  if (msg_len == 0U ||
+      msg_len > ETH_STREAM_PTP_FRAME - ETH_STREAM_HDR_SIZE -
+                    ETH_STREAM_UDP_SIZE) {
+    return;
+  }
+  static const uint8_t ptp_mac[6] = {0x01U, 0x00U, 0x5EU, 0x00U, 0x01U, 0x81U};
+  static const uint8_t ptp_ip[4] = {224U, 0U, 1U, 129U};
+  uint8_t *ip = &ptp_frame[ETH_STREAM_IP_OFFSET];
+  uint8_t *udp = &ptp_frame[ETH_STREAM_HDR_SIZE];
+  const uint32_t udp_len = ETH_STREAM_UDP_SIZE + msg_len;
+
+  memcpy(ptp_frame, header_template, ETH_STREAM_HDR_SIZE);
+  memcpy(&ptp_frame[0], ptp_mac, 6);
+  memcpy(&ip[16], ptp_ip, 4);
+  ip[8] = ETH_STREAM_PTP_TTL;
+  ethStream_putBe16(&ip[2], (uint16_t)(20U + udp_len));
+  ethStream_putBe16(&ip[4], ++ip_id);
+  ethStream_putBe16(&udp[0], PTP_SYNC_EVENT_PORT);
+  ethStream_putBe16(&udp[2], PTP_SYNC_EVENT_PORT);
+  ethStream_putBe16(&udp[4], (uint16_t)udp_len);
+  ethStream_putBe16(&udp[6], 0U);
+  memcpy(&udp[ETH_STREAM_UDP_SIZE], msg, msg_len);
+
+  ETH_BufferTypeDef buffer = {.buffer = ptp_frame,
+                              .len = ETH_STREAM_HDR_SIZE + udp_len};
+  ETH_TxPacketConfigTypeDef tx = {0};
+  tx.Attributes = ETH_TX_PACKETS_FEATURES_CSUM | ETH_TX_PACKETS_FEATURES_CRCPAD;
+  tx.Length = buffer.len;
+  tx.TxBuffer = &buffer;
+  tx.CRCPadCtrl = ETH_CRC_PAD_INSERT;
+  tx.ChecksumCtrl = ETH_CHECKSUM_IPHDR_INSERT;
+  tx.pData = ptp_frame;
+  ptp_pending = 1;
+  HAL_ETH_PTP_InsertTxTimestamp(&heth); // on the frame's first descriptor
+  if (HAL_ETH_Transmit_IT(&heth, &tx) != HAL_OK) {
+    ptp_pending = 0; // lost; ptp_sync sends the next one on schedule
+  }
+}
+
+/* Public functions ----------------------------------------------------------*/
+
+HAL_StatusTypeDef ethStream_init(void) {
+  if (HAL_RCC_GetHCLKFreq() < ETH_STREAM_MIN_HCLK_HZ) {
+    return HAL_ERROR;
+  }
+  ethStream_deriveIdentity();
+  ethStream_buildTemplate();
+
+  // The MAC reset completes only with the PHY's 50 MHz reference clock
+  if (ethStream_initMac() != HAL_OK) {
+    return HAL_ERROR;
+  }
+
+  uint32_t value = 0;
+  if (ethStream_readPhy(ETH_STREAM_PHY_ID1, &value) != HAL_OK ||
+      value == 0U || value == 0xFFFFU) {
+    return HAL_ERROR;
+  }
+  if (HAL_ETH_WritePHYRegister(&heth, ETH_STREAM_PHY_ADDR, ETH_STREAM_PHY_BCR,
+                               ETH_STREAM_PHY_BCR_RESET) != HAL_OK) {
+    return HAL_ERROR;
+  }
+  uint32_t start = HAL_GetTick();
+  do {
+    if (HAL_GetTick() - start > ETH_STREAM_PHY_RESET_MS ||
+        ethStream_readPhy(ETH_STREAM_PHY_BCR, &value) != HAL_OK) {
+      return HAL_ERROR;
+    }
+  } while (value & ETH_STREAM_PHY_BCR_RESET);
+
+  // The link comes up in ethStream_poll(), once negotiation has finished
+  return HAL_ETH_WritePHYRegister(&heth, ETH_STREAM_PHY_ADDR, ETH_STREAM_PHY_BCR,
+                                  ETH_STREAM_PHY_BCR_AUTONEG | ETH_STREAM_PHY_BCR_RESTART_AN);
+}
+
+void ethStream_poll(void) {
+#if PTP_SYNC_ENABLE
+  if (link_up) {
+    ethStream_pollRx();
+  }
+  ptpSync_poll();
+#endif
+  if (HAL_GetTick() - last_link_poll_ms < ETH_STREAM_LINK_POLL_MS) {
+    return;
+  }
+  last_link_poll_ms = HAL_GetTick();
+
+  uint32_t bsr = 0;
+  if (ethStream_readPhy(ETH_STREAM_PHY_BSR, &bsr) != HAL_OK) {
+    return;
+  }
+  uint8_t link = ((bsr & ETH_STREAM_PHY_BSR_LINK) && (bsr & ETH_STREAM_PHY_BSR_AN_DONE)) ? 1U : 0U;
+
+  if (link && !link_up) {
+    uint32_t scsr = 0;
+    if (ethStream_readPhy(ETH_STREAM_PHY_SCSR, &scsr) != HAL_OK) {
+      return;
+    }
+    stats.speed_100m = (scsr & ETH_STREAM_PHY_SCSR_100M) ? 1U : 0U;
+    stats.full_duplex = (scsr & ETH_STREAM_PHY_SCSR_FULL_DUPLEX) ? 1U : 0U;
+    if (ethStream_startMac(stats.speed_100m, stats.full_duplex) != HAL_OK) {
+      return;
+    }
+    __DMB();
+    link_up = 1;
+    stats.link_changes++;
+  } else if (!link && link_up) {
+    // The block callback pre-empts this loop, so once the flag is clear no
+    // transmission is left half queued
+    link_up = 0;
+    __DMB();
+    HAL_ETH_Stop(&heth);
+#if PTP_SYNC_ENABLE
+    ptpSync_stop();
+#endif
+    stats.link_changes++;
+  }
+}
+
+ADC_FAST_CODE HAL_StatusTypeDef ethStream_sendBlock(const uint16_t *block,
+                                                    uint32_t frame_count) {
+  // Blocks alternate between the buffer halves, and so do the slots: a busy
+  // slot means the MAC has not finished with this half yet
+  EthStream_Slot_t *slot = &slots[next_slot];
+  next_slot ^= 1U;
+
+  uint32_t data_len = frame_count * ADC_CONVERSIONS_CHANNEL_COUNT * 2U;
+  if (!link_up || block == NULL || data_len > ETH_STREAM_BLOCK_BYTES) {
+    return HAL_ERROR;
+  }
+  HAL_ETH_ReleaseTxPacket(&heth);
+#if PTP_SYNC_ENABLE
+  ethStream_sendPtp();
+#endif
+  if (slot->pending != 0U) {
+    stats.dropped++;
+    return HAL_BUSY;
+  }
+
+  // UDP header (checksum 0: not computed) and the stream header
+  ADC_BlockInfo_t info = {0};
+  analogSensor_getBlockInfo(&info);
+  uint32_t udp_len = ETH_STREAM_UDP_SIZE + ETH_STREAM_APP_SIZE + data_len;
+  uint8_t *udp = slot->udp_header;
+  uint8_t *app = &udp[ETH_STREAM_UDP_SIZE];
+  ethStream_putBe16(&udp[0], ETH_STREAM_PORT);
+  ethStream_putBe16(&udp[2], ETH_STREAM_PORT);
+  ethStream_putBe16(&udp[4], (uint16_t)udp_len);
+  ethStream_putBe16(&udp[6], 0U);
+  memset(app, 0, ETH_STREAM_APP_SIZE);
+  app[0] = ETH_STREAM_VERSION;
+  app[1] = ADC_CONVERSIONS_CHANNEL_COUNT;
+  ethStream_putLe16(&app[2], (uint16_t)frame_count);
+  ethStream_putLe32(&app[4], info.first_frame);
+  ethStream_putLe32(&app[8], (uint32_t)info.timestamp);
+  ethStream_putLe32(&app[12], (uint32_t)(info.timestamp >> 32));
+  ethStream_putLe32(&app[16], board_id);
+  memcpy(&app[20], analogSensor_getBlockChannelMap(),
+         ADC_CONVERSIONS_CHANNEL_COUNT);
+#if PTP_SYNC_ENABLE
+  // PTP time of the first frame's trigger, and how far to trust it
+  uint64_t ptp_ns = 0;
+  if (ptpSync_getFrameTime(info.first_frame, analogSensor_getSampleRate(),
+                           &ptp_ns) == HAL_OK) {
+    PtpSync_Status_t ptp;
+    TimeSync_Status_t sync;
+    ptpSync_getStatus(&ptp);
+    timeSync_getStatus(&sync);
+    app[ETH_STREAM_APP_PTP + 8U] =
+        (uint8_t)(ETH_STREAM_TIME_PTP |
+                  ((ptp.state == PTP_SYNC_SLAVE) ? ETH_STREAM_TIME_PTP_LOCKED
+                                                 : 0U) |
+                  ((sync.state == TIME_SYNC_LOCKED)
+                       ? ETH_STREAM_TIME_FRAMES_LOCKED
+                       : 0U));
+  }
+  ethStream_putLe32(&app[ETH_STREAM_APP_PTP], (uint32_t)ptp_ns);
+  ethStream_putLe32(&app[ETH_STREAM_APP_PTP + 4U], (uint32_t)(ptp_ns >> 32));
+#endif
+
+  // A pool block stays ours until TX-complete, however slow the link
+  slot->block = blockPool_fromData(block);
+  blockPool_retain(slot->block);
+
+  // One frame per fragment: its IPv4 header, [UDP + stream header], samples
+  const uint8_t *data = (const uint8_t *)block;
+  uint32_t offset = 0;
+  ip_id++;
+  for (uint8_t f = 0; offset < udp_len; f++) {
+    uint32_t len = udp_len - offset;
+    if (len > ETH_STREAM_FRAG_PAYLOAD) {
+      len = ETH_STREAM_FRAG_PAYLOAD;
+    }
+    uint8_t *hdr = slot->frag_headers[f];
+    uint8_t *ip = &hdr[ETH_STREAM_IP_OFFSET];
+    memcpy(hdr, header_template, ETH_STREAM_HDR_SIZE);
+    ethStream_putBe16(&ip[2], (uint16_t)(20U + len));
+    ethStream_putBe16(&ip[4], ip_id);
+    ethStream_putBe16(&ip[6],
+                      (uint16_t)((offset / 8U) | ((offset + len < udp_len)
+                                                      ? ETH_STREAM_IP_MF
+                                                      : 0U)));
+
+    // The descriptors take the buffer addresses, so the chain can be local
+    ETH_BufferTypeDef buffers[3] = {0};
+    buffers[0].buffer = hdr;
+    buffers[0].len = ETH_STREAM_HDR_SIZE;
+    buffers[0].next = &buffers[1];
+    if (offset == 0U) {
+      buffers[1].buffer = udp;
+      buffers[1].len = ETH_STREAM_UDP_SIZE + ETH_STREAM_APP_SIZE;
+      buffers[1].next = &buffers[2];
+      buffers[2].buffer = (uint8_t *)data;
+      buffers[2].len = len - buffers[1].len;
+    } else {
+      buffers[1].buffer =
+          (uint8_t *)&data[offset - ETH_STREAM_UDP_SIZE - ETH_STREAM_APP_SIZE];
+      buffers[1].len = len;
+    }
+
+    ETH_TxPacketConfigTypeDef tx = {0};
+    tx.Attributes = ETH_TX_PACKETS_FEATURES_CSUM | ETH_TX_PACKETS_FEATURES_CRCPAD;
+    tx.Length = ETH_STREAM_HDR_SIZE + len;
+    tx.TxBuffer = buffers;
+    tx.CRCPadCtrl = ETH_CRC_PAD_INSERT;
+    tx.ChecksumCtrl = ETH_CHECKSUM_IPHDR_INSERT;
+    tx.pData = slot;
+    slot->pending++;
+    if (HAL_ETH_Transmit_IT(&heth, &tx) != HAL_OK) {
+      // The collector discards the incomplete datagram after its timeout
+      slot->pending--;
+      stats.dropped++;
+      if (slot->pending == 0U) {
+        blockPool_release(slot->block);
+        slot->block = NULL;
+      }
+      return HAL_BUSY;
+    }
+    offset += len;
+  }
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef ethStream_getStats(EthStream_Stats_t *out) {
+  if (out == NULL) {
+    return HAL_ERROR;
+  }
+  *out = stats;
+  out->link_up = link_up;
+  return HAL_OK;
+}
+
+/* HAL callbacks -------------------------------------------------------------*/
+
+/**
+ * @brief RMII pins of the Nucleo-F746ZG (AF11) and the MAC clocks
+ */
+void HAL_ETH_MspInit(ETH_HandleTypeDef *h) {
+  if (h->Instance != ETH) {
+    return;
+  }
+  GPIO_InitTypeDef gpio = {0};
+  __HAL_RCC_ETH_CLK_ENABLE();
+  __HAL_RCC_GPIOA_CLK_ENABLE();
+  __HAL_RCC_GPIOB_CLK_ENABLE();
+  __HAL_RCC_GPIOC_CLK_ENABLE();
+  __HAL_RCC_GPIOG_CLK_ENABLE();
+
+  gpio.Mode = GPIO_MODE_AF_PP;
+  gpio.Pull = GPIO_NOPULL;
+  gpio.Speed = GPIO_SPEED_FREQ_VERY_HIGH;
+  gpio.Alternate = GPIO_AF11_ETH;
+  gpio.Pin = GPIO_PIN_1 | GPIO_PIN_2 | GPIO_PIN_7; // REF_CLK, MDIO, CRS_DV
+  HAL_GPIO_Init(GPIOA, &gpio);
+  gpio.Pin = GPIO_PIN_1 | GPIO_PIN_4 | GPIO_PIN_5; // MDC, RXD0, RXD1
+  HAL_GPIO_Init(GPIOC, &gpio);
+  gpio.Pin = GPIO_PIN_13; // TXD1
+  HAL_GPIO_Init(GPIOB, &gpio);
+  gpio.Pin = GPIO_PIN_11 | GPIO_PIN_13; // TX_EN, TXD0
+  HAL_GPIO_Init(GPIOG, &gpio);
+}
+
+/**
+ * @brief A fragment has left the MAC (called from HAL_ETH_ReleaseTxPacket())
+ */
+void HAL_ETH_TxFreeCallback(uint32_t *buff) {
+  if (buff == (uint32_t *)ptp_frame) {
+    ptp_pending = 0;
+    return;
+  }
+  EthStream_Slot_t *slot = (EthStream_Slot_t *)buff;
+  if (slot->pending > 0U) {
+    slot->pending--;
+    if (slot->pending == 0U) {
+      stats.datagrams_sent++;
+      blockPool_release(slot->block);
+      slot->block = NULL;
+    }
+  }
+}
+
+/**
+ * @brief Transmit stamp of a frame (HAL_ETH_ReleaseTxPacket()); only the
+ *        Delay_Req asks for one, stale stamp requests on reused
+ *        descriptors are ignored
+ */
+void HAL_ETH_TxPtpCallback(uint32_t *buff, ETH_TimeStampTypeDef *timestamp) {
+  if (buff == (uint32_t *)ptp_frame) {
+    ptpSync_txTimestamp(timestamp);
+  }
+}
+
+/**
+ * @brief A free buffer for a receive descriptor (NULL: leave it unarmed)
+ */
+void HAL_ETH_RxAllocateCallback(uint8_t **buff) {
+  *buff = NULL;
+#if PTP_SYNC_ENABLE
+  for (uint32_t i = 0; i < ETH_STREAM_RX_POOL; i++) {
+    if ((rx_used & (1UL << i)) == 0U) {
+      rx_used |= 1UL << i;
+      *buff = rx_buffers[i];
+      return;
+    }
+  }
+#endif
+}
+
+/**
+ * @brief Buffers of a received frame (HAL_ETH_ReadData()): the first is
+ *        kept, the rest are freed at once and the frame is dropped
+ */
+void HAL_ETH_RxLinkCallback(void **pStart, void **pEnd, uint8_t *buff,
+                            uint16_t Length) {
+  if (*pStart == NULL) {
+    *pStart = buff;
+    *pEnd = buff;
+    rx_len = Length;
+    rx_cut = 0;
+  } else {
+    ethStream_freeRx(buff);
+    rx_cut = 1;
+  }
+}
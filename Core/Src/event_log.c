@@ -0,0 +1,310 @@
+/**
+ ******************************************************************************
+ * @file    event_log.c
+ * @brief   Implementation of the binary event log
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "event_log.h"
+#include "retained.h"
+#include <stddef.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define EVENT_LOG_MASK (EVENT_LOG_CAPACITY - 1U)
+#define EVENT_LOG_BACKUP_MASK (EVENT_LOG_BACKUP_ENTRIES - 1U)
+#define EVENT_LOG_MAGIC 0x45564C47U // "EVLG"
+#define EVENT_LOG_BACKUP_SIZE 4096U
+
+#if (EVENT_LOG_CAPACITY & EVENT_LOG_MASK) != 0U || EVENT_LOG_CAPACITY < 2U
+#error "EVENT_LOG_CAPACITY must be a power of two"
+#endif
+
+#if (EVENT_LOG_BACKUP_ENTRIES & EVENT_LOG_BACKUP_MASK) != 0U ||               \
+    EVENT_LOG_BACKUP_ENTRIES < 2U || EVENT_LOG_BACKUP_ENTRIES > 32768U
+#error "EVENT_LOG_BACKUP_ENTRIES must be a power of two up to 32768"
+#endif
+
+/* Private types -------------------------------------------------------------*/
+
+/* One boot's entries, slot = sequence number & EVENT_LOG_BACKUP_MASK */
+typedef struct {
+  uint32_t boot;
+  uint32_t reset_flags;
+  EventLog_Entry_t entries[EVENT_LOG_BACKUP_ENTRIES];
+} EventLog_Bank_t;
+
+typedef struct {
+  uint32_t magic;
+  uint32_t boots;
+  uint32_t active; // bank written this boot
+  uint32_t reserved;
+  EventLog_Bank_t bank[2];
+} EventLog_Backup_t;
+
+_Static_assert(sizeof(EventLog_Entry_t) == EVENT_LOG_ENTRY_SIZE,
+               "EventLog_Entry_t must match the wire entry");
+_Static_assert(sizeof(EventLog_Backup_t) <=
+                   EVENT_LOG_BACKUP_SIZE - RETAINED_BACKUP_BYTES,
+               "two backup banks must fit below the retained block");
+
+/* Private variables ---------------------------------------------------------*/
+static EventLog_Entry_t ring[EVENT_LOG_CAPACITY];
+static volatile uint32_t head = 0; // next sequence number to claim
+static uint32_t tail = 0;          // next to drain (main loop)
+static uint32_t lost = 0;
+static uint32_t drained = 0;
+
+/* Backup SRAM: NULL until eventLog_init() */
+static volatile EventLog_Backup_t *backup = NULL;
+static volatile EventLog_Bank_t *mirror = NULL;
+
+/* Previous boot's bank still to drain: a window of sequence numbers */
+static const volatile EventLog_Bank_t *previous = NULL;
+static uint16_t prev_next = 0;
+static uint32_t prev_left = 0;
+
+static const char *const names[EVENT_LOG_CODE_COUNT] = {
+    [EVENT_LOG_NONE] = "none",       [EVENT_LOG_BOOT] = "boot",
+    [EVENT_LOG_ADC_ERROR] = "adc_error", [EVENT_LOG_OVERRUN] = "overrun",
+    [EVENT_LOG_DROPPED] = "dropped", [EVENT_LOG_TRIGGER] = "trigger",
+    [EVENT_LOG_MODE] = "mode",       [EVENT_LOG_CONFIG] = "config",
+    [EVENT_LOG_SHED] = "shed"};
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+ * @brief Write one slot: code cleared first, set last
+ */
+static void eventLog_fill(volatile EventLog_Entry_t *slot, uint32_t seq,
+                          uint8_t code, uint8_t arg, uint32_t tick,
+                          uint32_t value) {
+  slot->code = EVENT_LOG_NONE;
+  __DMB();
+  slot->seq = (uint16_t)seq;
+  slot->arg = arg;
+  slot->tick = tick;
+  slot->value = value;
+  __DMB();
+  slot->code = code;
+}
+
+/**
+ * @brief Copy a slot if it holds sequence number seq, complete
+ */
+static uint8_t eventLog_take(const volatile EventLog_Entry_t *slot,
+                             uint16_t seq, EventLog_Entry_t *out) {
+  const uint8_t code = slot->code;
+  if (code == EVENT_LOG_NONE || code >= EVENT_LOG_CODE_COUNT ||
+      slot->seq != seq) {
+    return 0;
+  }
+  __DMB();
+  out->seq = seq;
+  out->code = code;
+  out->arg = slot->arg;
+  out->tick = slot->tick;
+  out->value = slot->value;
+  __DMB();
+  // Rewritten meanwhile: the code went to 0 or the sequence moved on
+  return (uint8_t)(slot->code == code && slot->seq == seq);
+}
+
+/**
+ * @brief Find the previous boot's entries in its bank: the newest sequence
+ *        number, relative to any entry, ends a window of one bank
+ */
+static void eventLog_findPrevious(const volatile EventLog_Bank_t *bank) {
+  uint8_t found = 0;
+  uint16_t ref = 0;
+  int16_t newest = 0;
+
+  for (uint32_t i = 0; i < EVENT_LOG_BACKUP_ENTRIES; i++) {
+    const volatile EventLog_Entry_t *slot = &bank->entries[i];
+    if (slot->code == EVENT_LOG_NONE || slot->code >= EVENT_LOG_CODE_COUNT ||
+        (slot->seq & EVENT_LOG_BACKUP_MASK) != i) {
+      continue;
+    }
+    if (!found) {
+      ref = slot->seq;
+      found = 1;
+    }
+    const int16_t delta = (int16_t)(uint16_t)(slot->seq - ref);
+    if (delta > newest) {
+      newest = delta;
+    }
+  }
+  if (found) {
+    previous = bank;
+    prev_next =
+        (uint16_t)(ref + newest - (int32_t)EVENT_LOG_BACKUP_ENTRIES + 1);
+    prev_left = EVENT_LOG_BACKUP_ENTRIES;
+  }
+}
+
+/**
+ * @brief Copy the previous boot's oldest entries; slots left half-written
+ *        or from an older boot are skipped for good
+ */
+static uint8_t eventLog_peekPrevious(EventLog_Entry_t *entries, uint8_t max,
+                                     EventLog_Batch_t *batch) {
+  uint8_t n = 0;
+
+  while (prev_left > 0U && n < max) {
+    const uint16_t seq = (uint16_t)(prev_next + n);
+    if (eventLog_take(&previous->entries[seq & EVENT_LOG_BACKUP_MASK], seq,
+                      &entries[n])) {
+      n++;
+    } else if (n == 0U) {
+      prev_next++;
+      prev_left--;
+    } else {
+      break;
+    }
+    if (n >= prev_left) {
+      break;
+    }
+  }
+  batch->previous = 1;
+  batch->count = n;
+  batch->first = prev_next;
+  batch->lost = lost;
+  batch->boot = previous->boot;
+  return n;
+}
+
+/* Public functions ----------------------------------------------------------*/
+
+HAL_StatusTypeDef eventLog_init(void) {
+  const uint32_t reset_flags = RCC->CSR;
+  HAL_StatusTypeDef status = HAL_OK;
+
+  __HAL_RCC_PWR_CLK_ENABLE();
+  HAL_PWR_EnableBkUpAccess();
+  __HAL_RCC_BKPSRAM_CLK_ENABLE();
+  if (HAL_PWREx_EnableBkUpReg() != HAL_OK) {
+    status = HAL_TIMEOUT;
+  }
+
+  volatile EventLog_Backup_t *bkp = (volatile EventLog_Backup_t *)BKPSRAM_BASE;
+  if (bkp->magic == EVENT_LOG_MAGIC && bkp->active < 2U) {
+    eventLog_findPrevious(&bkp->bank[bkp->active]);
+    bkp->active ^= 1U;
+  } else {
+    // First power-up, or lost with VBAT: content undefined
+    bkp->magic = 0;
+    bkp->boots = 0;
+    bkp->active = 0;
+    for (uint32_t i = 0; i < EVENT_LOG_BACKUP_ENTRIES; i++) {
+      bkp->bank[1].entries[i].code = EVENT_LOG_NONE;
+    }
+  }
+  volatile EventLog_Bank_t *bank = &bkp->bank[bkp->active];
+  for (uint32_t i = 0; i < EVENT_LOG_BACKUP_ENTRIES; i++) {
+    bank->entries[i].code = EVENT_LOG_NONE;
+  }
+  bkp->boots++;
+  bank->boot = bkp->boots;
+  bank->reset_flags = reset_flags;
+  __DMB();
+  bkp->magic = EVENT_LOG_MAGIC;
+  backup = bkp;
+  mirror = bank;
+
+  __HAL_RCC_CLEAR_RESET_FLAGS(); // the next boot's flags are its own
+  eventLog_write(EVENT_LOG_BOOT, 0, reset_flags);
+  return status;
+}
+
+void eventLog_write(EventLog_Code_t code, uint8_t arg, uint32_t value) {
+  uint32_t seq;
+
+  if (code == EVENT_LOG_NONE || code >= EVENT_LOG_CODE_COUNT) {
+    return;
+  }
+  // Claim a sequence number; an interrupt in between makes the store fail
+  do {
+    seq = __LDREXW(&head);
+  } while (__STREXW(seq + 1U, &head) != 0U);
+
+  const uint32_t tick = HAL_GetTick();
+  eventLog_fill(&ring[seq & EVENT_LOG_MASK], seq, (uint8_t)code, arg, tick,
+                value);
+  volatile EventLog_Bank_t *const bank = mirror;
+  if (bank != NULL) {
+    eventLog_fill(&bank->entries[seq & EVENT_LOG_BACKUP_MASK], seq,
+                  (uint8_t)code, arg, tick, value);
+  }
+}
+
+HAL_StatusTypeDef eventLog_peek(EventLog_Entry_t *entries, uint8_t max,
+                                EventLog_Batch_t *batch) {
+  if (entries == NULL || batch == NULL || max == 0U) {
+    return HAL_ERROR;
+  }
+  if (previous != NULL) {
+    if (eventLog_peekPrevious(entries, max, batch) > 0U) {
+      return HAL_OK;
+    }
+    previous = NULL; // skipped to its end
+  }
+
+  const uint32_t now = head;
+  if (now - tail > EVENT_LOG_CAPACITY) {
+    lost += now - tail - EVENT_LOG_CAPACITY;
+    tail = now - EVENT_LOG_CAPACITY;
+  }
+  uint8_t n = 0;
+  while (n < max && tail + n != now &&
+         eventLog_take(&ring[(tail + n) & EVENT_LOG_MASK],
+                       (uint16_t)(tail + n), &entries[n])) {
+    n++;
+  }
+  batch->previous = 0;
+  batch->count = n;
+  batch->first = tail;
+  batch->lost = lost;
+  batch->boot = (backup != NULL) ? backup->boots : 0U;
+  return (n > 0U) ? HAL_OK : HAL_BUSY;
+}
+
+void eventLog_consume(const EventLog_Batch_t *batch) {
+  if (batch == NULL) {
+    return;
+  }
+  if (batch->previous) {
+    if (previous != NULL && batch->first == prev_next) {
+      const uint32_t n =
+          (batch->count < prev_left) ? batch->count : prev_left;
+      prev_next = (uint16_t)(prev_next + n);
+      prev_left -= n;
+      drained += n;
+      if (prev_left == 0U) {
+        previous = NULL;
+      }
+    }
+    return;
+  }
+  // Overwritten since the peek: the next peek resynchronises
+  if (batch->first == tail) {
+    tail += batch->count;
+    drained += batch->count;
+  }
+}
+
+const char *eventLog_getName(EventLog_Code_t code) {
+  return (code < EVENT_LOG_CODE_COUNT) ? names[code] : "?";
+}
+
+HAL_StatusTypeDef eventLog_getStats(EventLog_Stats_t *stats) {
+  if (stats == NULL) {
+    return HAL_ERROR;
+  }
+  stats->written = head;
+  stats->drained = drained;
+  stats->lost = lost;
+  stats->boot = (backup != NULL) ? backup->boots : 0U;
+  stats->previous = (previous != NULL) ? prev_left : 0U;
+  return HAL_OK;
+}
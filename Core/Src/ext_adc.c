@@ -0,0 +1,327 @@
+/**
+ ******************************************************************************
+ * @file    ext_adc.c
+ * @brief   Implementation of the external SPI ADC expansion
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "ext_adc.h"
+#include "adc_sections.h"
+#include "dma_tuning.h"
+#include "timebase.h"
+
+/* Private defines -----------------------------------------------------------*/
+#define EXT_ADC_BLOCK_BYTES (EXT_ADC_BLOCK_WORDS * sizeof(uint16_t))
+#define EXT_ADC_CC1_TICKS 1U // DMA request early in each word period
+#define EXT_ADC_NDTR_MAX 65535U
+
+#if EXT_ADC_CHANNELS < 1 || EXT_ADC_CHANNELS > 16
+#error "EXT_ADC_CHANNELS must be in 1..16"
+#endif
+
+#if EXT_ADC_LATENCY > 3
+#error "EXT_ADC_LATENCY must be in 0..3"
+#endif
+
+_Static_assert(2U * EXT_ADC_BLOCK_WORDS <= EXT_ADC_NDTR_MAX,
+               "both RX blocks must fit one DMA transfer count");
+_Static_assert(EXT_ADC_BLOCK_BYTES % ADC_DCACHE_LINE_SIZE == 0U,
+               "each RX block must start on a cache line");
+
+/* Private variables ---------------------------------------------------------*/
+static SPI_HandleTypeDef hspi_ext;
+static TIM_HandleTypeDef htim_ext;
+static DMA_HandleTypeDef hdma_ext_tx;
+static DMA_HandleTypeDef hdma_ext_rx;
+static uint8_t ready = 0;
+static uint32_t word_ns = 0; // actual word period after rounding
+
+/* Command table, sent once per trigger; results of two blocks */
+static uint16_t cmd_table[EXT_ADC_FRAME_WORDS] ADC_SRAM1_BSS ADC_DMA_ALIGNED;
+static uint16_t rx_words[2U * EXT_ADC_BLOCK_WORDS]
+    ADC_SRAM1_BSS ADC_DMA_ALIGNED;
+
+static uint32_t next_frame = 0;
+static ExtAdc_BlockCallback_t block_callback = NULL;
+static void *block_ctx = NULL;
+static ExtAdc_Stats_t stats_ = {0};
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+ * @brief Input clock of TIM8 (APB2 timers run at 2x PCLK2 when APB2 is divided)
+ */
+static uint32_t extAdc_timerClockHz(void) {
+  uint32_t clk = HAL_RCC_GetPCLK2Freq();
+  if ((RCC->CFGR & RCC_CFGR_PPRE2) != RCC_CFGR_PPRE2_DIV1) {
+    clk *= 2U;
+  }
+  return clk;
+}
+
+static void extAdc_initPins(void) {
+  GPIO_InitTypeDef gpio = {.Pin = GPIO_PIN_2 | GPIO_PIN_4 | GPIO_PIN_5 |
+                                  GPIO_PIN_6,
+                           .Mode = GPIO_MODE_AF_PP,
+                           .Pull = GPIO_NOPULL,
+                           .Speed = GPIO_SPEED_FREQ_VERY_HIGH,
+                           .Alternate = GPIO_AF5_SPI4};
+  __HAL_RCC_GPIOE_CLK_ENABLE();
+  HAL_GPIO_Init(GPIOE, &gpio);
+}
+
+static HAL_StatusTypeDef extAdc_initSpi(void) {
+  __HAL_RCC_SPI4_CLK_ENABLE();
+  hspi_ext.Instance = SPI4;
+  hspi_ext.Init.Mode = SPI_MODE_MASTER;
+  hspi_ext.Init.Direction = SPI_DIRECTION_2LINES;
+  hspi_ext.Init.DataSize = SPI_DATASIZE_16BIT;
+  hspi_ext.Init.CLKPolarity = EXT_ADC_SPI_MODE3 ? SPI_POLARITY_HIGH
+                                                : SPI_POLARITY_LOW;
+  hspi_ext.Init.CLKPhase = EXT_ADC_SPI_MODE3 ? SPI_PHASE_2EDGE
+                                             : SPI_PHASE_1EDGE;
+  hspi_ext.Init.NSS = SPI_NSS_HARD_OUTPUT;
+  hspi_ext.Init.BaudRatePrescaler = EXT_ADC_SPI_PRESCALER;
+  hspi_ext.Init.FirstBit = SPI_FIRSTBIT_MSB;
+  hspi_ext.Init.TIMode = SPI_TIMODE_DISABLE;
+  hspi_ext.Init.CRCCalculation = SPI_CRCCALCULATION_DISABLE;
+  hspi_ext.Init.CRCPolynomial = 7U;
+  hspi_ext.Init.CRCLength = SPI_CRC_LENGTH_DATASIZE;
+  // NSS (CNV) high after every frame the DMA writes: the conversion edge
+  hspi_ext.Init.NSSPMode = SPI_NSS_PULSE_ENABLE;
+  return HAL_SPI_Init(&hspi_ext);
+}
+
+/**
+ * @brief TIM8: one run of EXT_ADC_FRAME_WORDS word periods per TIM2 update
+ */
+static HAL_StatusTypeDef extAdc_initTimer(void) {
+  const uint64_t ticks =
+      ((uint64_t)extAdc_timerClockHz() * EXT_ADC_WORD_NS + 500000000ULL) /
+      1000000000ULL;
+  if (ticks <= EXT_ADC_CC1_TICKS + 1U || ticks > 0x10000ULL) {
+    return HAL_ERROR;
+  }
+
+  __HAL_RCC_TIM8_CLK_ENABLE();
+  htim_ext.Instance = TIM8;
+  htim_ext.Init.Prescaler = 0;
+  htim_ext.Init.CounterMode = TIM_COUNTERMODE_UP;
+  htim_ext.Init.Period = (uint32_t)ticks - 1U;
+  htim_ext.Init.ClockDivision = TIM_CLOCKDIVISION_DIV1;
+  htim_ext.Init.RepetitionCounter = EXT_ADC_FRAME_WORDS - 1U;
+  htim_ext.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_DISABLE;
+  if (HAL_TIM_OnePulse_Init(&htim_ext, TIM_OPMODE_SINGLE) != HAL_OK) {
+    return HAL_ERROR;
+  }
+  // Frozen output compare: CC1 only raises the DMA request
+  htim_ext.Instance->CCR1 = EXT_ADC_CC1_TICKS;
+  word_ns = (uint32_t)((ticks * 1000000000ULL) / extAdc_timerClockHz());
+  return HAL_OK;
+}
+
+static HAL_StatusTypeDef extAdc_initDma(void) {
+  __HAL_RCC_DMA2_CLK_ENABLE();
+
+  // Command words into SPI4_DR on TIM8_CH1, round the table forever
+  hdma_ext_tx.Instance = DMA2_Stream2;
+  hdma_ext_tx.Init.Channel = DMA_CHANNEL_7;
+  hdma_ext_tx.Init.Direction = DMA_MEMORY_TO_PERIPH;
+  hdma_ext_tx.Init.PeriphInc = DMA_PINC_DISABLE;
+  hdma_ext_tx.Init.MemInc = DMA_MINC_ENABLE;
+  hdma_ext_tx.Init.PeriphDataAlignment = DMA_PDATAALIGN_HALFWORD;
+  hdma_ext_tx.Init.MemDataAlignment = DMA_MDATAALIGN_HALFWORD;
+  hdma_ext_tx.Init.Mode = DMA_CIRCULAR;
+  hdma_ext_tx.Init.Priority = DMA_PRIORITY_HIGH;
+  hdma_ext_tx.Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+  if (HAL_DMA_Init(&hdma_ext_tx) != HAL_OK) {
+    return HAL_ERROR;
+  }
+
+  // Results out of SPI4_DR into both blocks
+  hdma_ext_rx.Instance = DMA2_Stream3;
+  hdma_ext_rx.Init.Channel = DMA_CHANNEL_5;
+  hdma_ext_rx.Init.Direction = DMA_PERIPH_TO_MEMORY;
+  hdma_ext_rx.Init.PeriphInc = DMA_PINC_DISABLE;
+  hdma_ext_rx.Init.MemInc = DMA_MINC_ENABLE;
+  hdma_ext_rx.Init.PeriphDataAlignment = DMA_PDATAALIGN_HALFWORD;
+  hdma_ext_rx.Init.MemDataAlignment = DMA_MDATAALIGN_HALFWORD;
+  hdma_ext_rx.Init.Mode = DMA_CIRCULAR;
+  hdma_ext_rx.Init.Priority = DMA_PRIORITY_VERY_HIGH;
+  hdma_ext_rx.Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+  dmaTuning_apply(DMA_TUNING_EXT_RX, &hdma_ext_rx.Init);
+  if (HAL_DMA_Init(&hdma_ext_rx) != HAL_OK) {
+    return HAL_ERROR;
+  }
+
+  HAL_NVIC_SetPriority(DMA2_Stream3_IRQn, EXT_ADC_IRQ_PRIORITY, 0);
+  HAL_NVIC_EnableIRQ(DMA2_Stream3_IRQn);
+  return HAL_OK;
+}
+
+/**
+ * @brief Hand one RX block over with the internal block of the same frames
+ */
+static void extAdc_blockDone(uint8_t half) {
+  ExtAdc_Block_t blk = {
+      .info = {.first_frame = next_frame,
+               .frame_count = ADC_CONVERSIONS_BLOCK_FRAMES,
+               .timestamp = timebase_now()},
+      .words = &rx_words[half * EXT_ADC_BLOCK_WORDS]};
+  SCB_InvalidateDCache_by_Addr((uint32_t *)(uintptr_t)blk.words,
+                               (int32_t)EXT_ADC_BLOCK_BYTES);
+
+  ADC_BlockInfo_t info;
+  if (analogSensor_getBlockInfo(&info) == HAL_OK &&
+      info.first_frame == next_frame &&
+      info.frame_count == ADC_CONVERSIONS_BLOCK_FRAMES) {
+    blk.info = info;
+  } else {
+    stats_.misaligned++;
+  }
+  next_frame += ADC_CONVERSIONS_BLOCK_FRAMES;
+
+  if (__HAL_SPI_GET_FLAG(&hspi_ext, SPI_FLAG_OVR)) {
+    __HAL_SPI_CLEAR_OVRFLAG(&hspi_ext);
+    stats_.overruns++;
+  }
+  if (__HAL_DMA_GET_FLAG(&hdma_ext_tx,
+                         __HAL_DMA_GET_TE_FLAG_INDEX(&hdma_ext_tx))) {
+    __HAL_DMA_CLEAR_FLAG(&hdma_ext_tx,
+                         __HAL_DMA_GET_TE_FLAG_INDEX(&hdma_ext_tx));
+    stats_.dma_errors++;
+  }
+
+  stats_.blocks++;
+  if (block_callback != NULL) {
+    block_callback(&blk, block_ctx);
+  }
+}
+
+static void extAdc_rxHalf(DMA_HandleTypeDef *hdma) {
+  (void)hdma;
+  extAdc_blockDone(0);
+}
+
+static void extAdc_rxFull(DMA_HandleTypeDef *hdma) {
+  (void)hdma;
+  extAdc_blockDone(1);
+}
+
+static void extAdc_rxError(DMA_HandleTypeDef *hdma) {
+  (void)hdma;
+  stats_.dma_errors++;
+}
+
+/* Public functions ----------------------------------------------------------*/
+
+HAL_StatusTypeDef extAdc_init(void) {
+#if !EXT_ADC_ENABLE
+  return HAL_OK; // not fitted: SPI4, TIM8 and both streams stay free
+#endif
+  extAdc_initPins();
+  if (extAdc_initSpi() != HAL_OK || extAdc_initTimer() != HAL_OK ||
+      extAdc_initDma() != HAL_OK) {
+    return HAL_ERROR;
+  }
+  hdma_ext_rx.XferHalfCpltCallback = extAdc_rxHalf;
+  hdma_ext_rx.XferCpltCallback = extAdc_rxFull;
+  hdma_ext_rx.XferErrorCallback = extAdc_rxError;
+
+  // The pipeline tail repeats the last command, so the converter stays on
+  // the same input until the next trigger
+  for (uint8_t k = 0; k < EXT_ADC_FRAME_WORDS; k++) {
+    const uint8_t ch = (k < EXT_ADC_CHANNELS) ? k : EXT_ADC_CHANNELS - 1U;
+    cmd_table[k] = EXT_ADC_COMMAND(ch);
+  }
+  SCB_CleanDCache_by_Addr((uint32_t *)cmd_table, (int32_t)sizeof(cmd_table));
+  ready = 1;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef extAdc_start(uint32_t frame_rate_hz) {
+  if (!ready || frame_rate_hz == 0U ||
+      frame_rate_hz > extAdc_getMaxFrameRate()) {
+    return HAL_ERROR;
+  }
+  extAdc_stop();
+
+  stats_ = (ExtAdc_Stats_t){0};
+  next_frame = 0;
+
+  if (HAL_DMA_Start_IT(&hdma_ext_rx, (uint32_t)(uintptr_t)&SPI4->DR,
+                       (uint32_t)(uintptr_t)rx_words,
+                       2U * EXT_ADC_BLOCK_WORDS) != HAL_OK ||
+      HAL_DMA_Start(&hdma_ext_tx, (uint32_t)(uintptr_t)cmd_table,
+                    (uint32_t)(uintptr_t)&SPI4->DR,
+                    EXT_ADC_FRAME_WORDS) != HAL_OK) {
+    extAdc_stop();
+    return HAL_ERROR;
+  }
+  SET_BIT(SPI4->CR2, SPI_CR2_RXDMAEN);
+  __HAL_SPI_ENABLE(&hspi_ext);
+
+  // Armed last: the next TIM2 update is frame 0
+  TIM_SlaveConfigTypeDef slave = {.SlaveMode = TIM_SLAVEMODE_TRIGGER,
+                                  .InputTrigger = TIM_TS_ITR1};
+  __HAL_TIM_SET_COUNTER(&htim_ext, 0U);
+  if (HAL_TIM_SlaveConfigSynchro(&htim_ext, &slave) != HAL_OK) {
+    extAdc_stop();
+    return HAL_ERROR;
+  }
+  __HAL_TIM_ENABLE_DMA(&htim_ext, TIM_DMA_CC1);
+  stats_.running = 1;
+  return HAL_OK;
+}
+
+void extAdc_stop(void) {
+  if (!ready) {
+    return;
+  }
+  // Triggers first, then let a sequence in progress end
+  CLEAR_BIT(htim_ext.Instance->SMCR, TIM_SMCR_SMS);
+  __HAL_TIM_DISABLE_DMA(&htim_ext, TIM_DMA_CC1);
+  htim_ext.Instance->CR1 &= ~TIM_CR1_CEN;
+  while (__HAL_SPI_GET_FLAG(&hspi_ext, SPI_FLAG_BSY)) {
+  }
+
+  __HAL_SPI_DISABLE(&hspi_ext);
+  CLEAR_BIT(SPI4->CR2, SPI_CR2_RXDMAEN);
+  (void)HAL_DMA_Abort(&hdma_ext_tx);
+  (void)HAL_DMA_Abort(&hdma_ext_rx);
+  while (__HAL_SPI_GET_FLAG(&hspi_ext, SPI_FLAG_RXNE)) {
+    (void)READ_REG(SPI4->DR); // stale words of the stopped sequence
+  }
+  __HAL_SPI_CLEAR_OVRFLAG(&hspi_ext);
+  stats_.running = 0;
+}
+
+uint32_t extAdc_getMaxFrameRate(void) {
+  // A spare word period between sequences for the trigger to land in
+  return (word_ns == 0U)
+             ? 0U
+             : 1000000000U / (word_ns * (EXT_ADC_FRAME_WORDS + 1U));
+}
+
+void extAdc_registerBlockCallback(ExtAdc_BlockCallback_t callback, void *ctx) {
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  block_callback = callback;
+  block_ctx = ctx;
+  __set_PRIMASK(primask);
+}
+
+HAL_StatusTypeDef extAdc_getStats(ExtAdc_Stats_t *stats) {
+  if (stats == NULL) {
+    return HAL_ERROR;
+  }
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  *stats = stats_;
+  __set_PRIMASK(primask);
+  return HAL_OK;
+}
+
+void extAdc_dmaIrqHandler(void) { HAL_DMA_IRQHandler(&hdma_ext_rx); }
@@ -0,0 +1,244 @@
+/**
+ ******************************************************************************
+ * @file    fat_view.c
+ * @brief   Implementation of the synthesised FAT32 view of the recording
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "fat_view.h"
+#include <stddef.h>
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define FAT_VIEW_RESERVED 32U      // boot region, FAT32's usual
+#define FAT_VIEW_FSINFO 1U         // FSInfo sector
+#define FAT_VIEW_BACKUP 6U         // backup boot sector (FSInfo after it)
+#define FAT_VIEW_MAX_CLUSTER 64U   // 32 kB clusters
+#define FAT_VIEW_MIN_CLUSTERS 65525U
+#define FAT_VIEW_ENTRIES (FAT_VIEW_SECTOR_SIZE / 4U) // per FAT sector
+#define FAT_VIEW_DIR_ENTRIES (FAT_VIEW_SECTOR_SIZE / 32U)
+#define FAT_VIEW_EOC 0x0FFFFFFFU
+#define FAT_VIEW_FIRST_FILE 4U     // cluster of DATA_000.BIN
+#define FAT_VIEW_DATE 0x0021U      // 1980-01-01, no clock
+
+#define FAT_ATTR_READ_ONLY 0x01U
+#define FAT_ATTR_VOLUME_ID 0x08U
+#define FAT_ATTR_ARCHIVE 0x20U
+
+/* Private variables ---------------------------------------------------------*/
+static const char volume_label[11] = {'A', 'D', 'C', '_', 'L', 'O',
+                                      'G', ' ', ' ', ' ', ' '};
+static const char index_name[11] = {'I', 'N', 'D', 'E', 'X', ' ',
+                                    ' ', ' ', 'B', 'I', 'N'};
+
+/* Private functions ---------------------------------------------------------*/
+
+static void fatView_put16(uint8_t *p, uint32_t v) {
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+}
+
+static void fatView_put32(uint8_t *p, uint32_t v) {
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+  p[2] = (uint8_t)(v >> 16);
+  p[3] = (uint8_t)(v >> 24);
+}
+
+/**
+ * @brief Sectors of data file k
+ */
+static uint32_t fatView_partSectors(const FatView_t *view, uint32_t k) {
+  const uint32_t left = view->cfg.data_sectors - k * view->part_sectors;
+  return (left < view->part_sectors) ? left : view->part_sectors;
+}
+
+/**
+ * @brief Clusters the data files use, all of them contiguous
+ */
+static uint32_t fatView_usedClusters(const FatView_t *view) {
+  const uint32_t s = view->cluster_sectors;
+  if (view->parts == 0U) {
+    return 0U;
+  }
+  const uint32_t k = view->parts - 1U;
+  return k * (view->part_sectors / s) +
+         (fatView_partSectors(view, k) + s - 1U) / s;
+}
+
+/**
+ * @brief FAT entry of one cluster: each file a chain in cluster order
+ */
+static uint32_t fatView_entry(const FatView_t *view, uint32_t cluster) {
+  if (cluster < FAT_VIEW_FIRST_FILE) {
+    // Media byte, reserved, the root directory and INDEX.BIN
+    return (cluster == 0U) ? 0x0FFFFFF8U : FAT_VIEW_EOC;
+  }
+  const uint32_t s = view->cluster_sectors;
+  const uint32_t per_part = view->part_sectors / s;
+  const uint32_t rel = cluster - FAT_VIEW_FIRST_FILE;
+  const uint32_t k = rel / per_part;
+  if (k >= view->parts) {
+    return 0U; // free
+  }
+  const uint32_t used = (fatView_partSectors(view, k) + s - 1U) / s;
+  const uint32_t r = rel - k * per_part;
+  if (r + 1U < used) {
+    return cluster + 1U;
+  }
+  return (r + 1U == used) ? FAT_VIEW_EOC : 0U;
+}
+
+static void fatView_dirEntry(uint8_t *e, const char name[11], uint8_t attr,
+                             uint32_t cluster, uint32_t size) {
+  memcpy(e, name, 11U);
+  e[11] = attr;
+  fatView_put16(&e[16], FAT_VIEW_DATE); // created
+  fatView_put16(&e[18], FAT_VIEW_DATE); // accessed
+  fatView_put16(&e[20], cluster >> 16);
+  fatView_put16(&e[24], FAT_VIEW_DATE); // written
+  fatView_put16(&e[26], cluster & 0xFFFFU);
+  fatView_put32(&e[28], size);
+}
+
+static void fatView_bootSector(const FatView_t *view, uint8_t *dst) {
+  static const uint8_t jump[3] = {0xEBU, 0x58U, 0x90U};
+  memcpy(dst, jump, sizeof(jump));
+  memcpy(&dst[3], "MSWIN4.1", 8U);
+  fatView_put16(&dst[11], FAT_VIEW_SECTOR_SIZE);
+  dst[13] = (uint8_t)view->cluster_sectors;
+  fatView_put16(&dst[14], FAT_VIEW_RESERVED);
+  dst[16] = 2U; // FAT copies
+  dst[21] = 0xF8U; // fixed disk
+  fatView_put16(&dst[24], 63U);
+  fatView_put16(&dst[26], 255U);
+  fatView_put32(&dst[32], view->total_sectors);
+  fatView_put32(&dst[36], view->fat_sectors);
+  fatView_put32(&dst[44], 2U); // root directory cluster
+  fatView_put16(&dst[48], FAT_VIEW_FSINFO);
+  fatView_put16(&dst[50], FAT_VIEW_BACKUP);
+  dst[64] = 0x80U;
+  dst[66] = 0x29U; // the next three fields are valid
+  fatView_put32(&dst[67], view->cfg.serial);
+  memcpy(&dst[71], volume_label, sizeof(volume_label));
+  memcpy(&dst[82], "FAT32   ", 8U);
+  dst[510] = 0x55U;
+  dst[511] = 0xAAU;
+}
+
+static void fatView_fsInfo(const FatView_t *view, uint8_t *dst) {
+  const uint32_t used = fatView_usedClusters(view);
+  fatView_put32(&dst[0], 0x41615252U);
+  fatView_put32(&dst[484], 0x61417272U);
+  fatView_put32(&dst[488], view->clusters - 2U - used); // free clusters
+  fatView_put32(&dst[492], FAT_VIEW_FIRST_FILE + used); // next free
+  fatView_put32(&dst[508], 0xAA550000U);
+}
+
+static void fatView_rootSector(const FatView_t *view, uint32_t sector,
+                               uint8_t *dst) {
+  for (uint32_t i = 0; i < FAT_VIEW_DIR_ENTRIES; i++) {
+    const uint32_t n = sector * FAT_VIEW_DIR_ENTRIES + i;
+    uint8_t *e = &dst[i * 32U];
+    if (n == 0U) {
+      fatView_dirEntry(e, volume_label, FAT_ATTR_VOLUME_ID, 0U, 0U);
+    } else if (n == 1U) {
+      fatView_dirEntry(e, index_name, FAT_ATTR_READ_ONLY | FAT_ATTR_ARCHIVE,
+                       3U, FAT_VIEW_SECTOR_SIZE);
+    } else if (n - 2U < view->parts) {
+      const uint32_t k = n - 2U;
+      char name[11] = {'D', 'A', 'T', 'A', '_', '0', '0', '0', 'B', 'I', 'N'};
+      name[5] = (char)('0' + k / 100U);
+      name[6] = (char)('0' + (k / 10U) % 10U);
+      name[7] = (char)('0' + k % 10U);
+      fatView_dirEntry(e, name, FAT_ATTR_READ_ONLY | FAT_ATTR_ARCHIVE,
+                       FAT_VIEW_FIRST_FILE +
+                           k * (view->part_sectors / view->cluster_sectors),
+                       fatView_partSectors(view, k) * FAT_VIEW_SECTOR_SIZE);
+    } else {
+      return; // the first free entry ends the listing
+    }
+  }
+}
+
+/* Public functions ----------------------------------------------------------*/
+
+HAL_StatusTypeDef fatView_init(FatView_t *view, const FatView_Config_t *cfg) {
+  if (view == NULL || cfg == NULL || cfg->index == NULL) {
+    return HAL_ERROR;
+  }
+  memset(view, 0, sizeof(*view));
+  view->cfg = *cfg;
+  if (view->cfg.data_sectors > view->cfg.region_sectors) {
+    view->cfg.data_sectors = view->cfg.region_sectors;
+  }
+
+  // The largest cluster that still leaves FAT32 its minimum count
+  uint32_t s = FAT_VIEW_MAX_CLUSTER;
+  while (s != 0U && 2U + (view->cfg.region_sectors + s - 1U) / s <
+                        FAT_VIEW_MIN_CLUSTERS) {
+    s >>= 1;
+  }
+  if (s == 0U) {
+    return HAL_ERROR;
+  }
+  view->cluster_sectors = s;
+  view->clusters = 2U + (view->cfg.region_sectors + s - 1U) / s;
+  view->fat_sectors = ((view->clusters + 2U) * 4U + FAT_VIEW_SECTOR_SIZE -
+                       1U) / FAT_VIEW_SECTOR_SIZE;
+  view->root_lba = FAT_VIEW_RESERVED + 2U * view->fat_sectors;
+  view->file_lba = view->root_lba + 2U * s;
+  view->total_sectors = view->root_lba + view->clusters * s;
+  view->part_sectors = FAT_VIEW_PART_MB * (1048576U / FAT_VIEW_SECTOR_SIZE);
+
+  // One root directory cluster: the label, INDEX.BIN and the data files
+  uint32_t parts = (view->cfg.data_sectors + view->part_sectors - 1U) /
+                   view->part_sectors;
+  const uint32_t max_parts = s * FAT_VIEW_DIR_ENTRIES - 2U;
+  if (parts > max_parts) {
+    parts = max_parts;
+    view->cfg.data_sectors = parts * view->part_sectors;
+  }
+  view->parts = (uint16_t)parts;
+  return HAL_OK;
+}
+
+uint32_t fatView_map(const FatView_t *view, uint32_t lba, uint32_t count,
+                     uint32_t *card_lba) {
+  const uint32_t data_end = view->file_lba + view->cfg.data_sectors;
+  uint32_t end;
+
+  if (lba >= view->file_lba && lba < data_end) {
+    *card_lba = view->cfg.data_lba + (lba - view->file_lba);
+    end = data_end;
+  } else {
+    *card_lba = FAT_VIEW_SYNTH;
+    end = (lba < view->file_lba) ? view->file_lba : view->total_sectors;
+  }
+  return (end - lba < count) ? end - lba : count;
+}
+
+void fatView_read(const FatView_t *view, uint32_t lba, uint8_t *dst) {
+  memset(dst, 0, FAT_VIEW_SECTOR_SIZE);
+  if (lba == 0U || lba == FAT_VIEW_BACKUP) {
+    fatView_bootSector(view, dst);
+  } else if (lba == FAT_VIEW_FSINFO || lba == FAT_VIEW_BACKUP + 1U) {
+    fatView_fsInfo(view, dst);
+  } else if (lba >= FAT_VIEW_RESERVED && lba < view->root_lba) {
+    // Both copies alike
+    const uint32_t first =
+        ((lba - FAT_VIEW_RESERVED) % view->fat_sectors) * FAT_VIEW_ENTRIES;
+    for (uint32_t i = 0; i < FAT_VIEW_ENTRIES; i++) {
+      const uint32_t c = first + i;
+      fatView_put32(&dst[i * 4U],
+                    (c < view->clusters + 2U) ? fatView_entry(view, c) : 0U);
+    }
+  } else if (lba >= view->root_lba &&
+             lba < view->root_lba + view->cluster_sectors) {
+    fatView_rootSector(view, lba - view->root_lba, dst);
+  } else if (lba == view->root_lba + view->cluster_sectors) {
+    memcpy(dst, view->cfg.index, FAT_VIEW_SECTOR_SIZE);
+  }
+}
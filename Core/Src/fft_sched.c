@@ -0,0 +1,206 @@
+/**
+ ******************************************************************************
+ * @file    fft_sched.c
+ * @brief   Implementation of the paced FFT scheduler
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "fft_sched.h"
+#include <string.h>
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+ * @brief Sum of the instances' dropped segments
+ */
+static uint32_t fftSched_overruns(const FftSched_t *sched) {
+  uint32_t n = 0;
+  for (uint8_t i = 0; i < sched->count; i++) {
+    n += sched->entries[i].spectrum->overruns;
+  }
+  return n;
+}
+
+/**
+ * @brief Passes left before an entry's next segment overruns this one
+ */
+static uint32_t fftSched_slack(const FftSched_t *sched,
+                               const FftSched_Entry_t *e) {
+  const uint32_t age = sched->pass - e->arrival;
+  return (e->period > age) ? e->period - age : 1U;
+}
+
+/**
+ * @brief Entry to step next: the one in progress, else the earliest
+ *        deadline; count if none is pending
+ */
+static uint8_t fftSched_pick(const FftSched_t *sched) {
+  uint8_t pick = sched->count;
+  uint32_t best = UINT32_MAX;
+  for (uint8_t i = 0; i < sched->count; i++) {
+    const FftSched_Entry_t *e = &sched->entries[i];
+    if (dspSpectrum_pendingSteps(e->spectrum) == 0U) {
+      continue;
+    }
+    if (e->spectrum->stage != DSP_SPECTRUM_STEP_NONE) {
+      return i; // finish one before starting the next
+    }
+    const uint32_t slack = fftSched_slack(sched, e);
+    if (slack < best) {
+      best = slack;
+      pick = i;
+    }
+  }
+  return pick;
+}
+
+/* Public functions ----------------------------------------------------------*/
+
+HAL_StatusTypeDef fftSched_init(FftSched_t *sched, FftSched_Mode_t mode) {
+  if (sched == NULL || (mode != FFT_SCHED_SPREAD && mode != FFT_SCHED_BURST)) {
+    return HAL_ERROR;
+  }
+  memset(sched, 0, sizeof(*sched));
+  sched->mode = mode;
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  if ((DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk) == 0U) {
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+  }
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef fftSched_add(FftSched_t *sched, DSP_Spectrum_t *spectrum) {
+  if (sched == NULL || spectrum == NULL ||
+      sched->count >= FFT_SCHED_MAX_SPECTRA) {
+    return HAL_ERROR;
+  }
+  FftSched_Entry_t *e = &sched->entries[sched->count++];
+  memset(e, 0, sizeof(*e));
+  e->spectrum = spectrum;
+  e->seen = spectrum->segments;
+  sched->overrun_base += spectrum->overruns;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef fftSched_setMode(FftSched_t *sched, FftSched_Mode_t mode) {
+  if (sched == NULL || (mode != FFT_SCHED_SPREAD && mode != FFT_SCHED_BURST)) {
+    return HAL_ERROR;
+  }
+  sched->mode = mode;
+  return HAL_OK;
+}
+
+uint32_t fftSched_poll(FftSched_t *sched) {
+  if (sched == NULL) {
+    return 0;
+  }
+  const uint32_t t0 = DWT->CYCCNT;
+  const uint32_t pass = ++sched->pass;
+  sched->stats.passes++;
+  uint32_t pending = 0;
+  uint32_t slack = UINT32_MAX;
+
+  // New segments: learn each period, stamp the ones now in hand
+  for (uint8_t i = 0; i < sched->count; i++) {
+    FftSched_Entry_t *e = &sched->entries[i];
+    const uint32_t segments = e->spectrum->segments;
+    if (segments != e->seen) {
+      // Over one segment since the last pass: the period is shorter
+      const uint32_t n = segments - e->seen;
+      e->period = (e->arrival != 0U) ? (pass - e->arrival) / n : 0U;
+      e->arrival = pass;
+      e->seen = segments;
+    }
+    const uint8_t steps = dspSpectrum_pendingSteps(e->spectrum);
+    if (steps == 0U) {
+      continue;
+    }
+    if (!e->waiting && e->spectrum->stage == DSP_SPECTRUM_STEP_NONE) {
+      e->waiting = 1;
+      e->ready_at = DWT->CYCCNT;
+    }
+    pending += steps;
+    const uint32_t s = fftSched_slack(sched, e);
+    slack = (s < slack) ? s : slack;
+  }
+  if (pending == 0U) {
+    return 0;
+  }
+
+  // Even share of the work over the passes left, never less than a step
+  const uint32_t budget = (sched->mode == FFT_SCHED_BURST)
+                              ? pending
+                              : (pending + slack - 1U) / slack;
+  uint32_t done = 0;
+  while (done < budget) {
+    const uint8_t i = fftSched_pick(sched);
+    if (i >= sched->count) {
+      break;
+    }
+    FftSched_Entry_t *e = &sched->entries[i];
+    const uint32_t s0 = DWT->CYCCNT;
+    const DSP_SpectrumStep_t step = dspSpectrum_step(e->spectrum);
+    const uint32_t cycles = DWT->CYCCNT - s0;
+    if (step == DSP_SPECTRUM_STEP_NONE) {
+      break;
+    }
+    done++;
+    if (cycles > sched->stats.peak_step_cycles) {
+      sched->stats.peak_step_cycles = cycles;
+    }
+    if (step == DSP_SPECTRUM_STEP_TRANSFORM) {
+      sched->stats.segments++;
+      if (e->waiting) {
+        const uint32_t wait = DWT->CYCCNT - e->ready_at;
+        if (wait > sched->stats.worst_wait_cycles) {
+          sched->stats.worst_wait_cycles = wait;
+        }
+        e->waiting = 0;
+      }
+    }
+  }
+
+  const uint32_t cycles = DWT->CYCCNT - t0;
+  sched->stats.steps += done;
+  if (done > sched->stats.peak_steps) {
+    sched->stats.peak_steps = (done > UINT8_MAX) ? UINT8_MAX : (uint8_t)done;
+  }
+  if (cycles > sched->stats.peak_pass_cycles) {
+    sched->stats.peak_pass_cycles = cycles;
+  }
+  return done;
+}
+
+HAL_StatusTypeDef fftSched_getStats(const FftSched_t *sched,
+                                    FftSched_Stats_t *stats,
+                                    uint32_t *peak_pass_us,
+                                    uint32_t *peak_step_us,
+                                    uint32_t *wait_us) {
+  if (sched == NULL || stats == NULL) {
+    return HAL_ERROR;
+  }
+  *stats = sched->stats;
+  stats->overruns = fftSched_overruns(sched) - sched->overrun_base;
+  const uint32_t mhz = SystemCoreClock / 1000000U;
+  if (peak_pass_us != NULL) {
+    *peak_pass_us = (mhz != 0U) ? stats->peak_pass_cycles / mhz : 0U;
+  }
+  if (peak_step_us != NULL) {
+    *peak_step_us = (mhz != 0U) ? stats->peak_step_cycles / mhz : 0U;
+  }
+  if (wait_us != NULL) {
+    *wait_us = (mhz != 0U) ? stats->worst_wait_cycles / mhz : 0U;
+  }
+  return HAL_OK;
+}
+
+void fftSched_resetStats(FftSched_t *sched) {
+  if (sched == NULL) {
+    return;
+  }
+  memset(&sched->stats, 0, sizeof(sched->stats));
+  sched->overrun_base = fftSched_overruns(sched);
+}
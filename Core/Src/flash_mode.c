@@ -0,0 +1,83 @@
+/**
+ ******************************************************************************
+ * @file    flash_mode.c
+ * @brief   Implementation of the flash instruction-fetch modes
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "flash_mode.h"
+
+/* Private defines -----------------------------------------------------------*/
+#define FLASH_MODE_AXIM_SIZE (FLASH_END - FLASHAXI_BASE + 1U)
+
+/* Private types -------------------------------------------------------------*/
+typedef struct {
+  const char *name;
+  uint8_t itcm;     // code fetched over the ITCM flash interface
+  uint8_t icache;   // L1 I-cache
+  uint8_t art;      // ART accelerator
+  uint8_t prefetch; // prefetch buffer
+} FlashMode_Info_t;
+
+/* Private variables ---------------------------------------------------------*/
+static const FlashMode_Info_t modes[FLASH_MODE_COUNT] = {
+    [FLASH_MODE_AXIM_ICACHE] = {"axim_icache", 0, 1, 0, 0},
+    [FLASH_MODE_AXIM_UNCACHED] = {"axim_uncached", 0, 0, 0, 0},
+    [FLASH_MODE_ITCM_ART_PREFETCH] = {"itcm_art_pf", 1, 1, 1, 1},
+    [FLASH_MODE_ITCM_ART] = {"itcm_art", 1, 1, 1, 0},
+    [FLASH_MODE_ITCM_PREFETCH] = {"itcm_pf", 1, 1, 0, 1},
+    [FLASH_MODE_ITCM_BARE] = {"itcm_bare", 1, 1, 0, 0}};
+
+static FlashMode_t active = FLASH_MODE_AXIM_ICACHE;
+
+/* Public functions ----------------------------------------------------------*/
+
+HAL_StatusTypeDef flashMode_apply(FlashMode_t mode) {
+  if ((uint32_t)mode >= FLASH_MODE_COUNT) {
+    return HAL_ERROR;
+  }
+  const FlashMode_Info_t *m = &modes[mode];
+
+  // The ITCM modes keep the I-cache for the AXIM code they call into
+  if (m->icache) {
+    SCB_EnableICache();
+  } else {
+    SCB_DisableICache();
+  }
+
+  // ART contents are only reset while it is disabled
+  __HAL_FLASH_ART_DISABLE();
+  if (m->art) {
+    __HAL_FLASH_ART_RESET();
+    CLEAR_BIT(FLASH->ACR, FLASH_ACR_ARTRST);
+    __HAL_FLASH_ART_ENABLE();
+  }
+  if (m->prefetch) {
+    __HAL_FLASH_PREFETCH_BUFFER_ENABLE();
+  } else {
+    __HAL_FLASH_PREFETCH_BUFFER_DISABLE();
+  }
+  __DSB();
+  __ISB();
+
+  active = mode;
+  return HAL_OK;
+}
+
+FlashMode_t flashMode_getActive(void) { return active; }
+
+FlashMode_Fn_t flashMode_entry(FlashMode_t mode, FlashMode_Fn_t fn) {
+  const uintptr_t addr = (uintptr_t)fn;
+  if ((uint32_t)mode >= FLASH_MODE_COUNT || !modes[mode].itcm ||
+      addr < FLASHAXI_BASE || addr - FLASHAXI_BASE >= FLASH_MODE_AXIM_SIZE) {
+    return fn;
+  }
+  // Same offset, Thumb bit included
+  return (FlashMode_Fn_t)(addr - FLASHAXI_BASE + FLASHITCM_BASE);
+}
+
+const char *flashMode_getName(FlashMode_t mode) {
+  return ((uint32_t)mode < FLASH_MODE_COUNT) ? modes[mode].name : "?";
+}
@@ -0,0 +1,219 @@
+/**
+ ******************************************************************************
+ * @file    frame_pack.c
+ * @brief   Implementation of the compressed frame ring
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "frame_pack.h"
+#include "adc_sections.h"
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define FRAME_PACK_STRIDE (sizeof(ADC_Frame_t) / sizeof(uint16_t))
+#define FRAME_PACK_SLOT(n) ((n) % FRAME_PACK_MAX_RUNS)
+
+_Static_assert(sizeof(ADC_Frame_t) % sizeof(uint16_t) == 0U,
+               "a channel is read with a stride of whole samples");
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+ * @brief Frame a is before frame b, across the 32-bit wrap
+ */
+static inline uint8_t framePack_before(uint32_t a, uint32_t b) {
+  return (int32_t)(a - b) < 0;
+}
+
+static uint32_t framePack_runBytes(const FramePack_Run_t *run) {
+  uint32_t bytes = 0;
+  for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+    bytes += run->bytes[ch];
+  }
+  return bytes;
+}
+
+/**
+ * @brief Drop the oldest run, unless it is held
+ *
+ * @return HAL_StatusTypeDef HAL_BUSY when held
+ */
+static HAL_StatusTypeDef framePack_evict(FramePack_t *pack) {
+  const FramePack_Run_t *run = &pack->runs[FRAME_PACK_SLOT(pack->tail)];
+  const uint32_t end = run->first_frame + run->frames;
+  if (pack->held && framePack_before(pack->hold_frame, end)) {
+    return HAL_BUSY;
+  }
+  pack->used -= framePack_runBytes(run);
+  pack->tail++;
+  if (framePack_before(pack->start_frame, end)) {
+    pack->start_frame = end;
+  }
+  return HAL_OK;
+}
+
+/**
+ * @brief Room for n bytes from pos on, at the oldest runs' expense
+ */
+static HAL_StatusTypeDef framePack_makeRoom(FramePack_t *pack, uint32_t pos,
+                                            uint32_t n) {
+  while (pack->head != pack->tail) {
+    const FramePack_Run_t *run = &pack->runs[FRAME_PACK_SLOT(pack->tail)];
+    const uint32_t bytes = framePack_runBytes(run);
+    const uint8_t overlaps =
+        run->offset < pos + n && pos < run->offset + bytes;
+    if (!overlaps && pack->head - pack->tail < FRAME_PACK_MAX_RUNS) {
+      return HAL_OK;
+    }
+    if (framePack_evict(pack) != HAL_OK) {
+      return HAL_BUSY;
+    }
+  }
+  return HAL_OK;
+}
+
+/* Public functions ----------------------------------------------------------*/
+
+HAL_StatusTypeDef framePack_init(FramePack_t *pack, uint8_t *buf,
+                                 uint32_t size) {
+  if (pack == NULL || buf == NULL || size < FRAME_PACK_RUN_BYTES) {
+    return HAL_ERROR;
+  }
+  memset(pack, 0, sizeof(*pack));
+  pack->buf = buf;
+  pack->size = size;
+  return HAL_OK;
+}
+
+ADC_FAST_CODE HAL_StatusTypeDef framePack_push(FramePack_t *pack,
+                                               const ADC_Frame_t *frames,
+                                               uint32_t count,
+                                               uint32_t first_frame) {
+  if (pack == NULL || pack->buf == NULL || frames == NULL) {
+    return HAL_ERROR;
+  }
+  if (pack->head == pack->tail || first_frame != pack->end_frame) {
+    pack->start_frame = first_frame; // nothing before it joins on
+  }
+
+  for (uint32_t done = 0; done < count;) {
+    const uint32_t n = (count - done < FRAME_PACK_RUN_FRAMES)
+                           ? count - done
+                           : FRAME_PACK_RUN_FRAMES;
+    // Room for the worst case; the run then takes what it needs
+    const uint32_t need =
+        ADC_CONVERSIONS_CHANNEL_COUNT * SAMPLE_CODEC_MAX_BYTES(n);
+    const uint32_t pos = (pack->write + need <= pack->size) ? pack->write : 0U;
+    if (framePack_makeRoom(pack, pos, need) != HAL_OK) {
+      pack->dropped_runs++;
+      return HAL_BUSY; // the next push starts the history again
+    }
+
+    FramePack_Run_t *run = &pack->runs[FRAME_PACK_SLOT(pack->head)];
+    uint32_t off = 0;
+    for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+      uint32_t len = 0;
+      (void)sampleCodec_encodeCounted(&frames[done].samples[ch], n,
+                                      FRAME_PACK_STRIDE, &pack->buf[pos + off],
+                                      need - off, &len, NULL);
+      run->bytes[ch] = (uint16_t)len;
+      off += len;
+    }
+    run->first_frame = first_frame + done;
+    run->offset = pos;
+    run->frames = (uint16_t)n;
+    if (pack->head == pack->tail) {
+      pack->start_frame = run->first_frame;
+    }
+    __DMB(); // the run is whole before a reader can find it
+    pack->head++;
+    pack->write = pos + off;
+    pack->used += off;
+    pack->end_frame = run->first_frame + n;
+    pack->runs_packed++;
+    pack->frames_packed += n;
+    pack->bytes_packed += off;
+    done += n;
+  }
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef framePack_decode(const FramePack_t *pack, uint32_t first,
+                                   uint32_t count, ADC_Frame_t *out) {
+  uint16_t samples[FRAME_PACK_RUN_FRAMES];
+
+  if (pack == NULL || out == NULL) {
+    return HAL_ERROR;
+  }
+  // Newest first: the runs passed are newer than the one asked for, so
+  // the writer has finished them and will not evict them meanwhile
+  const uint32_t head = pack->head;
+  const uint32_t tail = pack->tail;
+  uint32_t r = head;
+  while (r != tail) {
+    const FramePack_Run_t *run = &pack->runs[FRAME_PACK_SLOT(r - 1U)];
+    if (!framePack_before(first, run->first_frame)) {
+      break;
+    }
+    r--;
+  }
+  if (r == tail) {
+    return (count == 0U) ? HAL_OK : HAL_ERROR;
+  }
+  r--;
+
+  uint32_t frame = first;
+  for (uint32_t done = 0; done < count; r++) {
+    if (r == head) {
+      return HAL_ERROR; // not written yet
+    }
+    const FramePack_Run_t *run = &pack->runs[FRAME_PACK_SLOT(r)];
+    const uint32_t skip = frame - run->first_frame;
+    if (skip >= run->frames) {
+      return HAL_ERROR; // a gap in the history
+    }
+    const uint32_t n = (run->frames - skip < count - done)
+                           ? run->frames - skip
+                           : count - done;
+    uint32_t off = run->offset;
+    for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+      if (sampleCodec_decode(&pack->buf[off], run->bytes[ch], run->frames,
+                             samples, 1U) != HAL_OK) {
+        return HAL_ERROR;
+      }
+      for (uint32_t i = 0; i < n; i++) {
+        out[done + i].samples[ch] = samples[skip + i];
+      }
+      off += run->bytes[ch];
+    }
+    for (uint32_t i = 0; i < n; i++) {
+      out[done + i].error_mask = 0;
+      out[done + i].error_code = ADC_SAMPLE_OK;
+    }
+    done += n;
+    frame += n;
+  }
+  return HAL_OK;
+}
+
+void framePack_hold(FramePack_t *pack, uint32_t frame) {
+  pack->hold_frame = frame;
+  __DMB();
+  pack->held = 1;
+}
+
+void framePack_release(FramePack_t *pack) {
+  __DMB();
+  pack->held = 0;
+}
+
+uint32_t framePack_startFrame(const FramePack_t *pack) {
+  return pack->start_frame;
+}
+
+uint32_t framePack_frames(const FramePack_t *pack) {
+  return (pack->head == pack->tail) ? 0U
+                                    : pack->end_frame - pack->start_frame;
+}
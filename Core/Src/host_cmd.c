@@ -0,0 +1,312 @@
+/**
+ ******************************************************************************
+ * @file    host_cmd.c
+ * @brief   Implementation of the host command channel
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "host_cmd.h"
+#include "adc_sections.h"
+#include "app_sched.h"
+#include "telemetry.h"
+#include <stdio.h>
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define HOST_CMD_RX_MASK (HOST_CMD_RX_SIZE - 1U)
+
+_Static_assert((HOST_CMD_RX_SIZE & HOST_CMD_RX_MASK) == 0U &&
+                   HOST_CMD_RX_SIZE % ADC_DCACHE_LINE_SIZE == 0U,
+               "HOST_CMD_RX_SIZE: power of two, whole cache lines");
+
+/* Private variables ---------------------------------------------------------*/
+static UART_HandleTypeDef *rx_uart = NULL;
+static DMA_HandleTypeDef hdma_usart3_rx;
+static uint8_t rx_buf[HOST_CMD_RX_SIZE] ADC_SRAM2_BSS ADC_DMA_ALIGNED;
+
+/* Written by the RX event callback */
+static volatile uint32_t rx_total = 0; // bytes received since init
+static volatile uint32_t rx_idle = 0;  // rx_total at the last idle line
+static uint32_t rx_pos = 0;            // DMA position at the last event
+
+/* Main loop */
+static uint32_t rd_total = 0; // bytes taken out of rx_buf
+static uint32_t rd_idle = 0;  // last idle line that ended a command
+static char line[HOST_CMD_LINE_MAX + 1U];
+static uint32_t line_len = 0;
+static uint8_t line_long = 0; // over HOST_CMD_LINE_MAX: drop at the end
+static uint8_t line_skip = 0; // tail of a line cut by an overflow
+
+static const HostCmd_Command_t *commands = NULL;
+static uint32_t command_count = 0;
+static uint32_t help_next = UINT32_MAX; // next "help" line, MAX = none
+
+static HostCmd_Stats_t stats_ = {0};
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+ * @brief One "CMD" text line; dropped like any message when the queue is
+ *        full
+ */
+static void hostCmd_reply(const char *what, const char *text) {
+  char msg[HOST_CMD_LINE_MAX + 24U];
+  int len = snprintf(msg, sizeof(msg), "CMD %s %s\r\n", what, text);
+  if (len > 0) {
+    telemetry_send((const uint8_t *)msg, (uint16_t)strlen(msg));
+  }
+}
+
+/**
+ * @brief Split a line into words and run its command
+ */
+static void hostCmd_dispatch(char *text) {
+  char *argv[HOST_CMD_MAX_ARGS];
+  uint32_t argc = 0;
+  uint8_t excess = 0;
+  char *p = text;
+
+  for (;;) {
+    while (*p == ' ' || *p == '\t') {
+      *p++ = '\0';
+    }
+    if (*p == '\0') {
+      break;
+    }
+    if (argc == HOST_CMD_MAX_ARGS) {
+      excess = 1;
+      break;
+    }
+    argv[argc++] = p;
+    while (*p != '\0' && *p != ' ' && *p != '\t') {
+      p++;
+    }
+  }
+  if (argc == 0U) {
+    return;
+  }
+
+  // One-character commands are the silent single-byte controls
+  const uint8_t silent = (argv[0][1] == '\0') ? 1U : 0U;
+  const HostCmd_Command_t *cmd = NULL;
+  for (uint32_t i = 0; i < command_count; i++) {
+    if (strcmp(commands[i].name, argv[0]) == 0) {
+      cmd = &commands[i];
+      break;
+    }
+  }
+
+  if (cmd == NULL) {
+    if (strcmp(argv[0], "help") == 0) {
+      help_next = 0;
+      return;
+    }
+    stats_.unknown++;
+    if (!silent) {
+      hostCmd_reply("unknown", argv[0]);
+    }
+    return;
+  }
+
+  stats_.commands++;
+  HAL_StatusTypeDef status =
+      excess ? HAL_ERROR : cmd->handler(argc, argv, cmd->ctx);
+  if (status != HAL_OK) {
+    stats_.failed++;
+  }
+  if (!silent) {
+    hostCmd_reply((status == HAL_OK)     ? "ok"
+                  : (status == HAL_BUSY) ? "busy"
+                                         : "err",
+                  cmd->name);
+  }
+}
+
+/**
+ * @brief End of a command: terminator, idle line or end of fed data
+ */
+static void hostCmd_endLine(void) {
+  if (line_long) {
+    stats_.too_long++;
+  } else if (!line_skip && line_len != 0U) {
+    line[line_len] = '\0';
+    hostCmd_dispatch(line);
+  }
+  line_len = 0;
+  line_long = 0;
+  line_skip = 0;
+}
+
+static void hostCmd_putByte(uint8_t c) {
+  if (c == '\r' || c == '\n') {
+    hostCmd_endLine();
+  } else if (line_len < HOST_CMD_LINE_MAX) {
+    line[line_len++] = (char)c;
+  } else {
+    line_long = 1;
+  }
+}
+
+/**
+ * @brief (Re)start the circular reception; what was not read is dropped
+ */
+static HAL_StatusTypeDef hostCmd_startRx(void) {
+  HAL_UART_AbortReceive(rx_uart);
+  if (hdma_usart3_rx.State != HAL_DMA_STATE_READY) {
+    HAL_DMA_Abort(&hdma_usart3_rx); // UART re-initialised under the DMA
+  }
+
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  rx_pos = 0;
+  rd_total = rx_total;
+  rx_idle = rx_total;
+  rd_idle = rx_total;
+  __set_PRIMASK(primask);
+  line_len = 0;
+  line_long = 0;
+  line_skip = 0;
+
+  return HAL_UARTEx_ReceiveToIdle_DMA(rx_uart, rx_buf, HOST_CMD_RX_SIZE);
+}
+
+/**
+ * @brief Queue "help" lines while telemetry slots are free
+ */
+static void hostCmd_pollHelp(void) {
+  while (help_next < command_count && telemetry_getFreeSlots() > 0U) {
+    const HostCmd_Command_t *cmd = &commands[help_next++];
+    hostCmd_reply("help", (cmd->usage != NULL) ? cmd->usage : cmd->name);
+  }
+  if (help_next >= command_count) {
+    help_next = UINT32_MAX;
+  }
+}
+
+/* Public functions ----------------------------------------------------------*/
+
+HAL_StatusTypeDef hostCmd_init(UART_HandleTypeDef *huart,
+                               const HostCmd_Command_t *table,
+                               uint32_t count) {
+  if (huart == NULL || (table == NULL && count != 0U)) {
+    return HAL_ERROR;
+  }
+  for (uint32_t i = 0; i < count; i++) {
+    if (table[i].name == NULL || table[i].handler == NULL) {
+      return HAL_ERROR;
+    }
+  }
+  commands = table;
+  command_count = count;
+
+  // USART3_RX: DMA1 Stream1 channel 4, circular; the HAL reports half,
+  // full and idle line through HAL_UARTEx_RxEventCallback()
+  __HAL_RCC_DMA1_CLK_ENABLE();
+  hdma_usart3_rx.Instance = DMA1_Stream1;
+  hdma_usart3_rx.Init.Channel = DMA_CHANNEL_4;
+  hdma_usart3_rx.Init.Direction = DMA_PERIPH_TO_MEMORY;
+  hdma_usart3_rx.Init.PeriphInc = DMA_PINC_DISABLE;
+  hdma_usart3_rx.Init.MemInc = DMA_MINC_ENABLE;
+  hdma_usart3_rx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+  hdma_usart3_rx.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+  hdma_usart3_rx.Init.Mode = DMA_CIRCULAR;
+  hdma_usart3_rx.Init.Priority = DMA_PRIORITY_LOW;
+  hdma_usart3_rx.Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+  if (HAL_DMA_Init(&hdma_usart3_rx) != HAL_OK) {
+    return HAL_ERROR;
+  }
+  __HAL_LINKDMA(huart, hdmarx, hdma_usart3_rx);
+  HAL_NVIC_SetPriority(DMA1_Stream1_IRQn, HOST_CMD_IRQ_PRIORITY, 0);
+  HAL_NVIC_EnableIRQ(DMA1_Stream1_IRQn);
+
+  rx_uart = huart;
+  return hostCmd_startRx();
+}
+
+void hostCmd_poll(void) {
+  if (rx_uart == NULL) {
+    return;
+  }
+  if (rx_uart->RxState != HAL_UART_STATE_BUSY_RX ||
+      rx_uart->ReceptionType != HAL_UART_RECEPTION_TOIDLE) {
+    if (hostCmd_startRx() == HAL_OK) {
+      stats_.restarts++;
+    }
+  }
+
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  const uint32_t total = rx_total;
+  const uint32_t idle = rx_idle;
+  __set_PRIMASK(primask);
+
+  const uint32_t avail = total - rd_total;
+  if (avail > HOST_CMD_RX_SIZE) {
+    // The DMA lapped the reader: resume at the next terminator
+    stats_.overflows++;
+    rd_total = total;
+    line_len = 0;
+    line_long = 0;
+    line_skip = 1;
+  } else if (avail != 0U) {
+    // Written behind the D-cache; the CPU never writes rx_buf
+    SCB_InvalidateDCache_by_Addr((uint32_t *)rx_buf, HOST_CMD_RX_SIZE);
+    stats_.bytes += avail;
+    while (rd_total != total) {
+      hostCmd_putByte(rx_buf[rd_total & HOST_CMD_RX_MASK]);
+      rd_total++;
+      if (rd_total == idle) {
+        hostCmd_endLine();
+        rd_idle = idle;
+      }
+    }
+  }
+  // An idle event may follow the half-buffer event of its last byte
+  if (idle != rd_idle && idle == rd_total) {
+    hostCmd_endLine();
+    rd_idle = idle;
+  }
+  hostCmd_pollHelp();
+}
+
+void hostCmd_feed(const uint8_t *data, uint32_t len) {
+  if (data == NULL || len == 0U) {
+    return;
+  }
+  stats_.bytes += len;
+  for (uint32_t i = 0; i < len; i++) {
+    hostCmd_putByte(data[i]);
+  }
+  hostCmd_endLine();
+}
+
+HAL_StatusTypeDef hostCmd_getStats(HostCmd_Stats_t *stats) {
+  if (stats == NULL) {
+    return HAL_ERROR;
+  }
+  *stats = stats_;
+  return HAL_OK;
+}
+
+void hostCmd_dmaIrqHandler(void) { HAL_DMA_IRQHandler(&hdma_usart3_rx); }
+
+/* HAL callbacks -------------------------------------------------------------*/
+
+/**
+ * @brief RX half / full / idle line: count the bytes the DMA wrote
+ */
+void HAL_UARTEx_RxEventCallback(UART_HandleTypeDef *huart, uint16_t Size) {
+  if (huart != rx_uart) {
+    return;
+  }
+  // Size is the DMA position, HOST_CMD_RX_SIZE at the wrap
+  const uint32_t pos = (uint32_t)Size & HOST_CMD_RX_MASK;
+  rx_total += (pos - rx_pos) & HOST_CMD_RX_MASK;
+  rx_pos = pos;
+  if (HAL_UARTEx_GetRxEventType(huart) == HAL_UART_RXEVENT_IDLE) {
+    rx_idle = rx_total;
+  }
+  appSched_signal(APP_SCHED_EVENT_COMMAND);
+}
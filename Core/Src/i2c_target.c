@@ -0,0 +1,300 @@
+/**
+ ******************************************************************************
+ * @file    i2c_target.c
+ * @brief   Implementation of the I2C target register view
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "i2c_target.h"
+#include "adc_sections.h"
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define I2C_TARGET_MAP_BYTES ((uint16_t)sizeof(I2cTarget_Registers_t))
+#define I2C_TARGET_SNAPSHOT_BYTES                                             \
+  (((sizeof(I2cTarget_Registers_t) + ADC_DCACHE_LINE_SIZE - 1U) /             \
+    ADC_DCACHE_LINE_SIZE) *                                                    \
+   ADC_DCACHE_LINE_SIZE)
+#define I2C_TARGET_NONE 0xFFU // no read holds a snapshot
+
+/* Private types -------------------------------------------------------------*/
+
+/**
+ * @brief One snapshot, padded to whole cache lines for the clean
+ */
+typedef union {
+  I2cTarget_Registers_t regs;
+  uint8_t bytes[I2C_TARGET_SNAPSHOT_BYTES];
+} I2cTarget_Snapshot_t;
+
+/* Private variables ---------------------------------------------------------*/
+static I2C_HandleTypeDef hi2c_target;
+static DMA_HandleTypeDef hdma_target_tx;
+static uint8_t ready = 0;
+
+static I2cTarget_Snapshot_t snapshots[2] ADC_SRAM1_BSS ADC_DMA_ALIGNED;
+static volatile uint8_t published = 0;             // snapshot new reads take
+static volatile uint8_t latched = I2C_TARGET_NONE; // snapshot being read
+static uint16_t update_count = 0;
+static uint32_t last_update_ms = 0;
+
+static uint8_t reg_pointer = 0;
+static uint8_t rx_byte = 0;
+static uint8_t rx_first = 0; // next byte written is the pointer
+static I2cTarget_Stats_t stats_ = {0};
+
+/* Private functions ---------------------------------------------------------*/
+
+static void i2cTarget_initPins(void) {
+  GPIO_InitTypeDef gpio = {.Pin = GPIO_PIN_8 | GPIO_PIN_9,
+                           .Mode = GPIO_MODE_AF_OD,
+                           .Pull = GPIO_NOPULL,
+                           .Speed = GPIO_SPEED_FREQ_HIGH,
+                           .Alternate = GPIO_AF4_I2C1};
+  __HAL_RCC_GPIOB_CLK_ENABLE();
+  HAL_GPIO_Init(GPIOB, &gpio);
+}
+
+static HAL_StatusTypeDef i2cTarget_initI2c(void) {
+  __HAL_RCC_I2C1_CLK_ENABLE();
+  hi2c_target.Instance = I2C1;
+  hi2c_target.Init.Timing = I2C_TARGET_TIMING;
+  hi2c_target.Init.OwnAddress1 = (uint32_t)I2C_TARGET_ADDRESS << 1;
+  hi2c_target.Init.AddressingMode = I2C_ADDRESSINGMODE_7BIT;
+  hi2c_target.Init.DualAddressMode = I2C_DUALADDRESS_DISABLE;
+  hi2c_target.Init.OwnAddress2 = 0U;
+  hi2c_target.Init.OwnAddress2Masks = I2C_OA2_NOMASK;
+  hi2c_target.Init.GeneralCallMode = I2C_GENERALCALL_DISABLE;
+  // Stretching holds SCL while the address callback arms the DMA
+  hi2c_target.Init.NoStretchMode = I2C_NOSTRETCH_DISABLE;
+  if (HAL_I2C_Init(&hi2c_target) != HAL_OK ||
+      HAL_I2CEx_ConfigAnalogFilter(&hi2c_target, I2C_ANALOGFILTER_ENABLE) !=
+          HAL_OK) {
+    return HAL_ERROR;
+  }
+  HAL_NVIC_SetPriority(I2C1_EV_IRQn, I2C_TARGET_IRQ_PRIORITY, 0);
+  HAL_NVIC_EnableIRQ(I2C1_EV_IRQn);
+  HAL_NVIC_SetPriority(I2C1_ER_IRQn, I2C_TARGET_IRQ_PRIORITY, 0);
+  HAL_NVIC_EnableIRQ(I2C1_ER_IRQn);
+  return HAL_OK;
+}
+
+static HAL_StatusTypeDef i2cTarget_initDma(void) {
+  __HAL_RCC_DMA1_CLK_ENABLE();
+
+  // Snapshot bytes into I2C1_TXDR, one per TXIS request
+  hdma_target_tx.Instance = DMA1_Stream7;
+  hdma_target_tx.Init.Channel = DMA_CHANNEL_1;
+  hdma_target_tx.Init.Direction = DMA_MEMORY_TO_PERIPH;
+  hdma_target_tx.Init.PeriphInc = DMA_PINC_DISABLE;
+  hdma_target_tx.Init.MemInc = DMA_MINC_ENABLE;
+  hdma_target_tx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+  hdma_target_tx.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+  hdma_target_tx.Init.Mode = DMA_NORMAL;
+  hdma_target_tx.Init.Priority = DMA_PRIORITY_LOW;
+  hdma_target_tx.Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+  if (HAL_DMA_Init(&hdma_target_tx) != HAL_OK) {
+    return HAL_ERROR;
+  }
+  __HAL_LINKDMA(&hi2c_target, hdmatx, hdma_target_tx);
+
+  HAL_NVIC_SetPriority(DMA1_Stream7_IRQn, I2C_TARGET_IRQ_PRIORITY, 0);
+  HAL_NVIC_EnableIRQ(DMA1_Stream7_IRQn);
+  return HAL_OK;
+}
+
+static uint16_t i2cTarget_q4(float value) {
+  const float scaled = value * 16.0f + 0.5f;
+  if (!(scaled > 0.0f)) {
+    return 0U;
+  }
+  return (scaled >= 65535.0f) ? 65535U : (uint16_t)scaled;
+}
+
+/**
+ * @brief Fill one snapshot from the acquisition state
+ */
+static void i2cTarget_fill(I2cTarget_Registers_t *regs) {
+  memset(regs, 0, sizeof(*regs));
+  regs->magic = I2C_TARGET_MAGIC;
+  regs->version = I2C_TARGET_VERSION;
+  regs->channels = ADC_CONVERSIONS_CHANNEL_COUNT;
+  regs->mode = (uint8_t)analogSensor_getMode();
+  if (regs->mode != (uint8_t)ADC_ACQ_MODE_POLLING) {
+    regs->flags |= I2C_TARGET_FLAG_RUNNING;
+  }
+  regs->update = update_count;
+  regs->frame_rate_hz = analogSensor_getSampleRate();
+  regs->errors = analogSensor_getErrorCount();
+  regs->dropped = analogSensor_getDroppedBlocks();
+
+  ADC_LatestFrame_t latest;
+  if (analogSensor_getLatestFrame(&latest) == HAL_OK) {
+    regs->flags |= I2C_TARGET_FLAG_FRAME;
+    regs->sequence = latest.sequence;
+    regs->timestamp = latest.timestamp;
+    regs->error_mask = latest.frame.error_mask;
+    for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+      regs->samples[ch] = latest.frame.samples[ch];
+    }
+  }
+
+  ADC_ChannelStats_t ch_stats[ADC_CONVERSIONS_CHANNEL_COUNT];
+  if (analogSensor_getChannelStats(ch_stats, 0) == HAL_OK) {
+    regs->stats_count = ch_stats[0].count;
+    for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+      regs->stats[ch].mean_q4 = i2cTarget_q4(ch_stats[ch].mean);
+      regs->stats[ch].rms_q4 = i2cTarget_q4(ch_stats[ch].rms);
+      regs->stats[ch].min = ch_stats[ch].min;
+      regs->stats[ch].max = ch_stats[ch].max;
+    }
+  }
+}
+
+/**
+ * @brief Write the snapshot no read holds and make it the published one
+ *
+ * @return 0 if a read still holds the older snapshot (deferred)
+ */
+static uint8_t i2cTarget_publish(void) {
+  const uint8_t next = published ^ 1U;
+  // A read latching from here on takes published, never next
+  if (latched == next) {
+    return 0;
+  }
+  update_count++;
+  i2cTarget_fill(&snapshots[next].regs);
+  SCB_CleanDCache_by_Addr((uint32_t *)snapshots[next].bytes,
+                          (int32_t)sizeof(snapshots[next].bytes));
+  __DSB();
+  published = next;
+  return 1;
+}
+
+/**
+ * @brief Serve the latched snapshot from a register onwards
+ */
+static void i2cTarget_serve(uint8_t reg) {
+  if (HAL_I2C_Slave_Seq_Transmit_DMA(
+          &hi2c_target, &snapshots[latched].bytes[reg],
+          (uint16_t)(I2C_TARGET_MAP_BYTES - reg), I2C_NEXT_FRAME) != HAL_OK) {
+    stats_.errors++;
+  }
+}
+
+/**
+ * @brief End of a transaction: release the snapshot, listen again
+ */
+static void i2cTarget_rearm(void) {
+  latched = I2C_TARGET_NONE;
+  (void)HAL_I2C_EnableListen_IT(&hi2c_target);
+}
+
+/* HAL callbacks -------------------------------------------------------------*/
+
+void HAL_I2C_AddrCallback(I2C_HandleTypeDef *hi2c, uint8_t TransferDirection,
+                          uint16_t AddrMatchCode) {
+  (void)AddrMatchCode;
+  if (hi2c != &hi2c_target) {
+    return;
+  }
+  if (TransferDirection == I2C_DIRECTION_TRANSMIT) {
+    // Host writes: the first byte is the register pointer
+    rx_first = 1;
+    if (HAL_I2C_Slave_Seq_Receive_IT(hi2c, &rx_byte, 1U, I2C_NEXT_FRAME) !=
+        HAL_OK) {
+      stats_.errors++;
+    }
+    return;
+  }
+  latched = published;
+  stats_.reads++;
+  i2cTarget_serve(reg_pointer);
+}
+
+void HAL_I2C_SlaveRxCpltCallback(I2C_HandleTypeDef *hi2c) {
+  if (hi2c != &hi2c_target) {
+    return;
+  }
+  if (rx_first) {
+    rx_first = 0;
+    reg_pointer = (rx_byte < I2C_TARGET_MAP_BYTES) ? rx_byte : 0U;
+    stats_.writes++;
+  }
+  // Read-only registers: take and drop further bytes until the stop
+  (void)HAL_I2C_Slave_Seq_Receive_IT(hi2c, &rx_byte, 1U, I2C_NEXT_FRAME);
+}
+
+void HAL_I2C_SlaveTxCpltCallback(I2C_HandleTypeDef *hi2c) {
+  if (hi2c != &hi2c_target) {
+    return;
+  }
+  // The burst reached the end of the map: wrap to register 0
+  i2cTarget_serve(0U);
+}
+
+void HAL_I2C_ListenCpltCallback(I2C_HandleTypeDef *hi2c) {
+  if (hi2c == &hi2c_target) {
+    i2cTarget_rearm();
+  }
+}
+
+void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c) {
+  if (hi2c != &hi2c_target) {
+    return;
+  }
+  // A host that stops a burst early NACKs a byte the DMA has queued: the
+  // normal end of a read, not an error
+  if ((HAL_I2C_GetError(hi2c) & ~HAL_I2C_ERROR_AF) != HAL_I2C_ERROR_NONE) {
+    stats_.errors++;
+  }
+  i2cTarget_rearm();
+}
+
+/* Public functions ----------------------------------------------------------*/
+
+HAL_StatusTypeDef i2cTarget_init(void) {
+#if !I2C_TARGET_ENABLE
+  return HAL_OK; // no host: I2C1 and DMA1 Stream7 stay free
+#endif
+  i2cTarget_initPins();
+  if (i2cTarget_initI2c() != HAL_OK || i2cTarget_initDma() != HAL_OK) {
+    return HAL_ERROR;
+  }
+  stats_ = (I2cTarget_Stats_t){0};
+  (void)i2cTarget_publish();
+  last_update_ms = HAL_GetTick();
+  ready = 1;
+  return HAL_I2C_EnableListen_IT(&hi2c_target);
+}
+
+void i2cTarget_update(void) {
+  if (!ready || HAL_GetTick() - last_update_ms < I2C_TARGET_UPDATE_MS) {
+    return;
+  }
+  if (i2cTarget_publish()) {
+    last_update_ms = HAL_GetTick();
+    stats_.updates++;
+  } else {
+    stats_.deferred++; // retried on the next pass
+  }
+}
+
+HAL_StatusTypeDef i2cTarget_getStats(I2cTarget_Stats_t *stats) {
+  if (stats == NULL) {
+    return HAL_ERROR;
+  }
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  *stats = stats_;
+  __set_PRIMASK(primask);
+  return HAL_OK;
+}
+
+void i2cTarget_evIrqHandler(void) { HAL_I2C_EV_IRQHandler(&hi2c_target); }
+
+void i2cTarget_erIrqHandler(void) { HAL_I2C_ER_IRQHandler(&hi2c_target); }
+
+void i2cTarget_dmaIrqHandler(void) { HAL_DMA_IRQHandler(&hdma_target_tx); }
@@ -0,0 +1,159 @@
+/**
+ ******************************************************************************
+ * @file    interlock.c
+ * @brief   Implementation of the watchdog-to-GPIO interlock
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "interlock.h"
+#include "adc_conversions.h"
+#include "adc_sections.h"
+#include "latency_hist.h"
+
+/* Private defines -----------------------------------------------------------*/
+#define INTERLOCK_NO_CHANNEL 0xFFU
+#define INTERLOCK_ADCS 3U
+
+_Static_assert(INTERLOCK_DMA_PRIORITY > INTERLOCK_IRQ_PRIORITY,
+               "the ADC interrupt must pre-empt the block processing");
+
+/* Private variables ---------------------------------------------------------*/
+static GPIO_TypeDef *out_port = NULL; // NULL until interlock_init()
+static uint32_t trip_bsrr = 0;        // BSRR word that activates the output
+static uint32_t release_bsrr = 0;
+static ADC_ChannelMask_t trip_channels = 0;
+static uint32_t tim2_clock_hz = 0;
+static volatile Interlock_Stats_t stats_ = {.channel = INTERLOCK_NO_CHANNEL};
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+ * @brief Input clock of TIM2 (APB1 timers run at 2x PCLK1 when APB1 is divided)
+ */
+static uint32_t interlock_tim2ClockHz(void) {
+  uint32_t clk = HAL_RCC_GetPCLK1Freq();
+  if ((RCC->CFGR & RCC_CFGR_PPRE1) != RCC_HCLK_DIV1) {
+    clk *= 2U;
+  }
+  return clk;
+}
+
+/* Public functions ----------------------------------------------------------*/
+
+HAL_StatusTypeDef interlock_init(const Interlock_Config_t *cfg) {
+#if !INTERLOCK_ENABLE
+  return HAL_OK; // no interlock: the ADC interrupt keeps its CubeMX setup
+#endif
+  if (cfg == NULL || cfg->port == NULL || cfg->pin == 0U ||
+      (cfg->pin & (cfg->pin - 1U)) != 0U || cfg->channels == 0U) {
+    return HAL_ERROR;
+  }
+
+  // Released level first, so the pin never glitches active
+  out_port = NULL;
+  const uint32_t set = cfg->pin;
+  const uint32_t reset = (uint32_t)cfg->pin << 16;
+  trip_bsrr = cfg->active_low ? reset : set;
+  release_bsrr = cfg->active_low ? set : reset;
+  cfg->port->BSRR = release_bsrr;
+  GPIO_InitTypeDef gpio = {.Pin = cfg->pin,
+                           .Mode = GPIO_MODE_OUTPUT_PP,
+                           .Pull = GPIO_NOPULL,
+                           .Speed = GPIO_SPEED_FREQ_LOW};
+  HAL_GPIO_Init(cfg->port, &gpio);
+
+  // The handler entry -> pin count runs on CYCCNT
+  if (!(DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk)) {
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+  }
+  tim2_clock_hz = interlock_tim2ClockHz();
+  trip_channels = cfg->channels;
+  stats_ = (Interlock_Stats_t){.channel = INTERLOCK_NO_CHANNEL};
+
+  // The block callback runs in the DMA interrupt: keep it pre-emptible
+  HAL_NVIC_SetPriority(ADC_IRQn, INTERLOCK_IRQ_PRIORITY, 0);
+  HAL_NVIC_SetPriority(DMA2_Stream0_IRQn, INTERLOCK_DMA_PRIORITY, 0);
+  __DMB();
+  out_port = cfg->port;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef interlock_reset(void) {
+  if (out_port == NULL) {
+    return HAL_ERROR;
+  }
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  out_port->BSRR = release_bsrr;
+  stats_.tripped = 0;
+  stats_.channel = INTERLOCK_NO_CHANNEL;
+  __set_PRIMASK(primask);
+  analogSensor_armWatchdog();
+  return HAL_OK;
+}
+
+uint8_t interlock_isTripped(void) { return stats_.tripped; }
+
+HAL_StatusTypeDef interlock_getStats(Interlock_Stats_t *stats) {
+  if (stats == NULL) {
+    return HAL_ERROR;
+  }
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  *stats = stats_;
+  __set_PRIMASK(primask);
+  return HAL_OK;
+}
+
+ADC_FAST_CODE void interlock_irqHandler(void) {
+  const uint32_t entry = DWT->CYCCNT;
+  GPIO_TypeDef *const port = out_port;
+  if (port == NULL) {
+    return;
+  }
+
+  for (uint8_t k = 0; k < INTERLOCK_ADCS; k++) {
+    ADC_TypeDef *const adc = (k == 0U) ? ADC1 : (k == 1U) ? ADC2 : ADC3;
+    if ((adc->SR & ADC_SR_AWD) == 0U || (adc->CR1 & ADC_CR1_AWDIE) == 0U) {
+      continue;
+    }
+    const uint8_t ch = analogSensor_getWatchdogChannel(k);
+    if (ch == INTERLOCK_NO_CHANNEL || ((trip_channels >> ch) & 1U) == 0U) {
+      continue;
+    }
+    if (stats_.tripped) {
+      stats_.alarms++;
+      return;
+    }
+    port->BSRR = trip_bsrr;
+
+    // Bookkeeping after the write: none of it is on the reaction path
+    const uint32_t cycles = DWT->CYCCNT - entry;
+    const uint32_t ticks = TIM2->CNT;
+    stats_.tripped = 1;
+    stats_.channel = ch;
+    stats_.trips++;
+    stats_.last_cycles = cycles;
+    if (cycles > stats_.max_cycles) {
+      stats_.max_cycles = cycles;
+    }
+    // Since the frame's scan trigger, when TIM2 paces the scan
+    uint32_t ns = 0;
+    if (analogSensor_getScanTrigger() == ADC_SCAN_TRIGGER_TIM2 &&
+        (TIM2->CR1 & TIM_CR1_CEN) != 0U && tim2_clock_hz != 0U) {
+      ns = (uint32_t)((uint64_t)ticks * (TIM2->PSC + 1U) * 1000000000ULL /
+                      tim2_clock_hz);
+    }
+    stats_.last_trigger_ns = ns;
+    if (ns > stats_.max_trigger_ns) {
+      stats_.max_trigger_ns = ns;
+    }
+    if (ns != 0U) {
+      latencyHist_record(LATENCY_HIST_TRIGGER_OUTPUT, ns);
+    }
+    return;
+  }
+}
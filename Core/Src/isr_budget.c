@@ -0,0 +1,168 @@
+/**
+ ******************************************************************************
+ * @file    isr_budget.c
+ * @brief   Implementation of the per-handler cycle budgets
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "isr_budget.h"
+#include "adc_sections.h"
+#include "telemetry.h"
+#include <stdio.h>
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define DWT_LAR_UNLOCK_KEY 0xC5ACCE55U
+
+/* Private variables ---------------------------------------------------------*/
+volatile uint32_t isrBudget_nested ADC_FAST_BSS;
+
+static IsrBudget_Stats_t handlers[ISR_BUDGET_COUNT] ADC_FAST_BSS;
+
+static const char *const handler_names[ISR_BUDGET_COUNT] = {
+    [ISR_BUDGET_ADC_DMA] = "adc_dma",     [ISR_BUDGET_ADC] = "adc",
+    [ISR_BUDGET_TIM2] = "tim2",           [ISR_BUDGET_TIM5] = "tim5",
+    [ISR_BUDGET_TIM3] = "tim3",           [ISR_BUDGET_EXT_DMA] = "ext_dma",
+    [ISR_BUDGET_USART3] = "usart3",       [ISR_BUDGET_UART_TX] = "uart_tx",
+    [ISR_BUDGET_UART_RX] = "uart_rx",     [ISR_BUDGET_I2C] = "i2c",
+    [ISR_BUDGET_I2C_DMA] = "i2c_dma",     [ISR_BUDGET_CAN] = "can",
+    [ISR_BUDGET_MODBUS] = "modbus",       [ISR_BUDGET_TDMA] = "tdma",
+    [ISR_BUDGET_TDMA_SLOT] = "tdma_slot", [ISR_BUDGET_USB] = "usb",
+    [ISR_BUDGET_SDMMC] = "sdmmc",         [ISR_BUDGET_SD_DMA] = "sd_dma",
+    [ISR_BUDGET_CRC_DMA] = "crc_dma",     [ISR_BUDGET_DMA2D] = "dma2d",
+    [ISR_BUDGET_LPTIM] = "lptim",         [ISR_BUDGET_RTOS_NOTIFY] = "rtos",
+    [ISR_BUDGET_SYSTICK] = "systick"};
+
+/* Default budgets, ns. The ADC DMA one depends on the block period and is
+ * set by the application (0 = count only). */
+static const uint32_t default_ns[ISR_BUDGET_COUNT] = {
+    [ISR_BUDGET_ADC_DMA] = 0U,      [ISR_BUDGET_ADC] = 5000U,
+    [ISR_BUDGET_TIM2] = 3000U,      [ISR_BUDGET_TIM5] = 1000U,
+    [ISR_BUDGET_TIM3] = 2000U,      [ISR_BUDGET_EXT_DMA] = 20000U,
+    [ISR_BUDGET_USART3] = 5000U,    [ISR_BUDGET_UART_TX] = 10000U,
+    [ISR_BUDGET_UART_RX] = 3000U,   [ISR_BUDGET_I2C] = 5000U,
+    [ISR_BUDGET_I2C_DMA] = 5000U,   [ISR_BUDGET_CAN] = 5000U,
+    [ISR_BUDGET_MODBUS] = 20000U,   [ISR_BUDGET_TDMA] = 10000U,
+    [ISR_BUDGET_TDMA_SLOT] = 3000U, [ISR_BUDGET_USB] = 20000U,
+    [ISR_BUDGET_SDMMC] = 10000U,    [ISR_BUDGET_SD_DMA] = 10000U,
+    [ISR_BUDGET_CRC_DMA] = 5000U,   [ISR_BUDGET_DMA2D] = 5000U,
+    [ISR_BUDGET_LPTIM] = 5000U,     [ISR_BUDGET_RTOS_NOTIFY] = 5000U,
+    [ISR_BUDGET_SYSTICK] = 10000U};
+
+/* Next handler to report; ISR_BUDGET_COUNT = no dump pending */
+static uint32_t dump_next = ISR_BUDGET_COUNT;
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+ * @brief ns -> cycles at the current HCLK
+ */
+static uint32_t isrBudget_cycles(uint32_t ns) {
+  return (uint32_t)((uint64_t)ns * SystemCoreClock / 1000000000ULL);
+}
+
+/* Public functions ----------------------------------------------------------*/
+
+void isrBudget_init(void) {
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->LAR = DWT_LAR_UNLOCK_KEY;
+  if ((DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk) == 0U) {
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+  }
+  for (uint32_t i = 0; i < ISR_BUDGET_COUNT; i++) {
+    handlers[i].budget = isrBudget_cycles(default_ns[i]);
+  }
+  isrBudget_reset();
+}
+
+ADC_FAST_CODE void isrBudget_record(IsrBudget_Id_t id, IsrBudget_Mark_t mark) {
+  if ((uint32_t)id >= ISR_BUDGET_COUNT) {
+    return;
+  }
+  // Gross time minus what nested handlers added since the mark; this run's
+  // gross time then goes to the total for the handler it pre-empted
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  const uint32_t gross = DWT->CYCCNT - mark.start;
+  const uint32_t nested = isrBudget_nested;
+  isrBudget_nested = nested + gross;
+  __set_PRIMASK(primask);
+  const uint32_t cycles = gross - (nested - mark.nested);
+
+  IsrBudget_Stats_t *h = &handlers[id];
+  h->count++;
+  h->total += cycles;
+  if (cycles > h->max) {
+    h->max = cycles;
+  }
+  if (h->budget != 0U && cycles > h->budget) {
+    h->exceeded++;
+  }
+}
+
+HAL_StatusTypeDef isrBudget_setBudgetNs(IsrBudget_Id_t id, uint32_t ns) {
+  if ((uint32_t)id >= ISR_BUDGET_COUNT) {
+    return HAL_ERROR;
+  }
+  handlers[id].budget = isrBudget_cycles(ns);
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef isrBudget_getStats(IsrBudget_Id_t id,
+                                     IsrBudget_Stats_t *stats) {
+  if ((uint32_t)id >= ISR_BUDGET_COUNT || stats == NULL) {
+    return HAL_ERROR;
+  }
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  *stats = handlers[id];
+  __set_PRIMASK(primask);
+  return HAL_OK;
+}
+
+uint32_t isrBudget_getExceeded(void) {
+  uint32_t total = 0;
+  for (uint32_t i = 0; i < ISR_BUDGET_COUNT; i++) {
+    total += handlers[i].exceeded;
+  }
+  return total;
+}
+
+void isrBudget_reset(void) {
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  for (uint32_t i = 0; i < ISR_BUDGET_COUNT; i++) {
+    handlers[i].count = 0;
+    handlers[i].max = 0;
+    handlers[i].total = 0;
+    handlers[i].exceeded = 0;
+  }
+  __set_PRIMASK(primask);
+}
+
+void isrBudget_dump(void) { dump_next = 0; }
+
+void isrBudget_poll(void) {
+  char line[96];
+
+  while (dump_next < ISR_BUDGET_COUNT && telemetry_getFreeSlots() > 0U) {
+    IsrBudget_Stats_t h;
+    if (isrBudget_getStats((IsrBudget_Id_t)dump_next, &h) == HAL_OK &&
+        h.count != 0U) {
+      int len = snprintf(line, sizeof(line),
+                         "ISR %-8s n=%lu max=%lu mean=%lu budget=%lu "
+                         "over=%lu cyc\r\n",
+                         handler_names[dump_next], (unsigned long)h.count,
+                         (unsigned long)h.max,
+                         (unsigned long)(h.total / h.count),
+                         (unsigned long)h.budget, (unsigned long)h.exceeded);
+      if (len > 0) {
+        telemetry_send((const uint8_t *)line, (uint16_t)strlen(line));
+      }
+    }
+    dump_next++;
+  }
+}
@@ -0,0 +1,166 @@
+/**
+ ******************************************************************************
+ * @file    latency_hist.c
+ * @brief   Implementation of the log-bucketed latency histograms
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "latency_hist.h"
+#include "adc_sections.h"
+#include "telemetry.h"
+#include "timebase.h"
+#include <stdio.h>
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define LATENCY_HIST_SUB_COUNT (1U << LATENCY_HIST_SUB_BITS)
+#define LATENCY_HIST_SUB_MASK (LATENCY_HIST_SUB_COUNT - 1U)
+#define LATENCY_HIST_NS_PER_TICK (1000000000U / TIMEBASE_TICK_HZ)
+
+#if LATENCY_HIST_SUB_BITS < 1U || LATENCY_HIST_SUB_BITS > 6U
+#error "LATENCY_HIST_SUB_BITS must be 1..6"
+#endif
+
+#if (1000000000U % TIMEBASE_TICK_HZ) != 0U
+#error "TIMEBASE_TICK_HZ must divide 1 GHz for latencyHist_recordTicks()"
+#endif
+
+/* Private types -------------------------------------------------------------*/
+typedef struct {
+  uint32_t buckets[LATENCY_HIST_BUCKETS];
+  uint32_t max;
+} LatencyHist_t;
+
+/* Private variables ---------------------------------------------------------*/
+
+/* In DTCM: recorded from the interlock and DMA handlers */
+static LatencyHist_t paths[LATENCY_HIST_PATH_COUNT] ADC_FAST_BSS;
+
+static const char *const path_names[LATENCY_HIST_PATH_COUNT] = {
+    [LATENCY_HIST_DMA_CONSUMER] = "dma_consumer",
+    [LATENCY_HIST_TRIGGER_OUTPUT] = "trigger_output",
+    [LATENCY_HIST_BLOCK_TX] = "block_tx"};
+
+/* Next path to report; LATENCY_HIST_PATH_COUNT = no dump pending */
+static uint32_t dump_next = LATENCY_HIST_PATH_COUNT;
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+ * @brief Bucket of a value: exact below 2^SUB_BITS, then the octave of the
+ *        leading one and the SUB_BITS bits after it
+ */
+static inline uint32_t latencyHist_index(uint32_t ns) {
+  if (ns < LATENCY_HIST_SUB_COUNT) {
+    return ns;
+  }
+  const uint32_t shift = 31U - __CLZ(ns) - LATENCY_HIST_SUB_BITS;
+  return ((shift + 1U) << LATENCY_HIST_SUB_BITS) |
+         ((ns >> shift) & LATENCY_HIST_SUB_MASK);
+}
+
+/**
+ * @brief Largest value of a bucket
+ */
+static uint32_t latencyHist_upperEdge(uint32_t index) {
+  if (index < LATENCY_HIST_SUB_COUNT) {
+    return index;
+  }
+  const uint32_t shift = (index >> LATENCY_HIST_SUB_BITS) - 1U;
+  const uint32_t low =
+      (LATENCY_HIST_SUB_COUNT | (index & LATENCY_HIST_SUB_MASK)) << shift;
+  return low + ((1U << shift) - 1U);
+}
+
+/**
+ * @brief Value at or below which permille / 1000 of the counts lie
+ */
+static uint32_t latencyHist_percentile(const LatencyHist_t *h, uint32_t count,
+                                       uint32_t permille) {
+  // Rank of the sample, rounded up: p99.9 of 10 samples is the largest
+  const uint32_t rank =
+      (uint32_t)(((uint64_t)count * permille + 999U) / 1000U);
+  uint32_t seen = 0;
+  for (uint32_t i = 0; i < LATENCY_HIST_BUCKETS; i++) {
+    seen += h->buckets[i];
+    if (seen >= rank) {
+      const uint32_t edge = latencyHist_upperEdge(i);
+      return (edge < h->max) ? edge : h->max;
+    }
+  }
+  return h->max;
+}
+
+/* Public functions ----------------------------------------------------------*/
+
+ADC_FAST_CODE void latencyHist_record(LatencyHist_Path_t path, uint32_t ns) {
+#if LATENCY_HIST_ENABLE
+  if ((uint32_t)path >= LATENCY_HIST_PATH_COUNT) {
+    return;
+  }
+  LatencyHist_t *h = &paths[path];
+  h->buckets[latencyHist_index(ns)]++;
+  if (ns > h->max) {
+    h->max = ns;
+  }
+#else
+  (void)path;
+  (void)ns;
+#endif
+}
+
+ADC_FAST_CODE void latencyHist_recordTicks(LatencyHist_Path_t path,
+                                           uint64_t ticks) {
+  const uint64_t ns = ticks * LATENCY_HIST_NS_PER_TICK;
+  latencyHist_record(path, (ns > UINT32_MAX) ? UINT32_MAX : (uint32_t)ns);
+}
+
+HAL_StatusTypeDef latencyHist_getSummary(LatencyHist_Path_t path,
+                                         LatencyHist_Summary_t *summary) {
+  if ((uint32_t)path >= LATENCY_HIST_PATH_COUNT || summary == NULL) {
+    return HAL_ERROR;
+  }
+  const LatencyHist_t *h = &paths[path];
+  uint32_t count = 0;
+  for (uint32_t i = 0; i < LATENCY_HIST_BUCKETS; i++) {
+    count += h->buckets[i];
+  }
+  summary->count = count;
+  summary->max = h->max;
+  if (count == 0U) {
+    summary->p50 = 0;
+    summary->p99 = 0;
+    summary->p999 = 0;
+    return HAL_OK;
+  }
+  summary->p50 = latencyHist_percentile(h, count, 500U);
+  summary->p99 = latencyHist_percentile(h, count, 990U);
+  summary->p999 = latencyHist_percentile(h, count, 999U);
+  return HAL_OK;
+}
+
+void latencyHist_reset(void) { memset(paths, 0, sizeof(paths)); }
+
+void latencyHist_dump(void) { dump_next = 0; }
+
+void latencyHist_poll(void) {
+  char line[112];
+
+  while (dump_next < LATENCY_HIST_PATH_COUNT && telemetry_getFreeSlots() > 0U) {
+    LatencyHist_Summary_t s = {0};
+    latencyHist_getSummary((LatencyHist_Path_t)dump_next, &s);
+
+    int len = snprintf(line, sizeof(line),
+                       "LAT %-14s n=%lu p50=%lu p99=%lu p999=%lu max=%lu "
+                       "ns\r\n",
+                       path_names[dump_next], (unsigned long)s.count,
+                       (unsigned long)s.p50, (unsigned long)s.p99,
+                       (unsigned long)s.p999, (unsigned long)s.max);
+    if (len > 0) {
+      telemetry_send((const uint8_t *)line, (uint16_t)strlen(line));
+    }
+    dump_next++;
+  }
+}
@@ -0,0 +1,537 @@
+/**
+ ******************************************************************************
+ * @file    low_power.c
+ * @brief   Implementation of the duty-cycled STOP-mode acquisition
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "low_power.h"
+#include "adc.h"
+#include "clock_profile.h"
+#include "cpu_load.h"
+#include "dsp_stats.h"
+#include "energy_meter.h"
+#include "telemetry.h"
+#include "usart.h"
+#include <stdio.h>
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+#if LOW_POWER_USE_LSE
+#define LOW_POWER_LPTIM_HZ LSE_VALUE
+#else
+#define LOW_POWER_LPTIM_HZ LSI_VALUE
+#endif
+#define LOW_POWER_ARR_MAX 0xFFFFU
+#define LOW_POWER_PRESC_MAX_LOG2 7U // LPTIM prescaler /1 .. /128
+#define LOW_POWER_FIRST_SAMPLE_TIMEOUT_MS 10U
+
+/* Private variables ---------------------------------------------------------*/
+static LPTIM_HandleTypeDef hlptim1;
+static LowPower_Config_t config;
+static uint8_t initialised = 0;
+static uint32_t period_ticks;  // LPTIM ticks per period (ARR + 1)
+static uint32_t tick_divider;  // LPTIM prescaler
+static volatile uint8_t woken = 0;
+static volatile uint32_t blocks_done = 0;
+static uint8_t after_stop = 0; // next burst measures the wake latency
+static LowPower_Stats_t stats;
+static uint64_t wake_total_us = 0;
+static uint32_t wake_count = 0;
+static uint64_t awake_ticks = 0;
+static uint64_t elapsed_ticks = 0;
+static uint8_t sensors_on = 1;       // SENSOR_PD released (gpio.c default)
+static volatile uint8_t power_due = 0; // compare match: lead time reached
+static uint32_t lead_ticks = 0;      // power-up before the wake-up
+static uint32_t powered_ticks = 0;   // of which this cycle got
+// Settle detection, written from the DMA interrupt during a burst
+static volatile uint32_t settled_frames = 0;
+static volatile uint8_t settled = 0;
+static volatile uint8_t settle_forced = 0;
+static uint32_t burst_frame = 0;     // frames of the burst before the block
+static uint32_t settle_frame = 0;    // first settled frame of the burst
+static uint32_t window_count = 0;
+static uint8_t window_prev = 0;      // window_last holds a full window
+static uint32_t window_sum[ADC_CONVERSIONS_CHANNEL_COUNT];
+static uint32_t window_last[ADC_CONVERSIONS_CHANNEL_COUNT];
+static DSP_StatsAccum_t burst_stats[ADC_CONVERSIONS_CHANNEL_COUNT];
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+ * @brief LPTIM1 counter; the register is clocked asynchronously, so it is
+ *        only trusted when two reads agree
+ */
+static uint32_t lowPower_count(void) {
+  uint32_t a;
+  uint32_t b;
+  do {
+    a = LPTIM1->CNT;
+    b = LPTIM1->CNT;
+  } while (a != b);
+  return a;
+}
+
+static uint32_t lowPower_ticksToMicros(uint32_t ticks) {
+  return (uint32_t)((uint64_t)ticks * tick_divider * 1000000U /
+                    LOW_POWER_LPTIM_HZ);
+}
+
+static uint32_t lowPower_microsToTicks(uint32_t us) {
+  return (uint32_t)((uint64_t)us * LOW_POWER_LPTIM_HZ /
+                    (1000000U * (uint64_t)tick_divider));
+}
+
+/**
+ * @brief Drive SENSOR_PD; a no-op without LOW_POWER_SENSOR_GATING
+ */
+static void lowPower_sensorPower(uint8_t on) {
+#if LOW_POWER_SENSOR_GATING
+  const GPIO_PinState down = LOW_POWER_SENSOR_PD_ACTIVE;
+  const GPIO_PinState up = (down == GPIO_PIN_SET) ? GPIO_PIN_RESET
+                                                  : GPIO_PIN_SET;
+  HAL_GPIO_WritePin(SENSOR_PD_GPIO_Port, SENSOR_PD_Pin, on ? up : down);
+  energyMeter_setPeripheral(ENERGY_METER_PERIPH_SENSORS, on);
+#endif
+  sensors_on = on;
+}
+
+/**
+ * @brief Look for the settle point in a block of a still unsettled burst
+ *
+ * Sets settle_frame to the first of two consecutive windows whose means
+ * agree, no earlier than min_frames, or to max_frames when none do by then.
+ */
+static void lowPower_settle(const uint16_t *block, uint32_t frame_count) {
+  const LowPower_SettleProfile_t *p = &config.settle;
+  const uint32_t limit = (uint32_t)p->tolerance_codes * p->window_frames;
+  for (uint32_t f = 0; f < frame_count; f++) {
+    const uint32_t n = burst_frame + f;
+    if (n >= p->max_frames) {
+      settle_frame = n;
+      settle_forced = 1;
+      settled = 1;
+      return;
+    }
+    const uint16_t *src = &block[f * ADC_CONVERSIONS_CHANNEL_COUNT];
+    for (uint8_t i = 0; i < ADC_CONVERSIONS_CHANNEL_COUNT; i++) {
+      window_sum[i] += src[i];
+    }
+    if (++window_count < p->window_frames) {
+      continue;
+    }
+    uint8_t agree = window_prev;
+    for (uint8_t i = 0; i < ADC_CONVERSIONS_CHANNEL_COUNT && agree; i++) {
+      const uint32_t d = (window_sum[i] > window_last[i])
+                             ? window_sum[i] - window_last[i]
+                             : window_last[i] - window_sum[i];
+      agree = (d <= limit);
+    }
+    if (agree) {
+      const uint32_t first = n + 1U - 2U * p->window_frames;
+      settle_frame = (first > p->min_frames) ? first : p->min_frames;
+      settled = 1;
+      return;
+    }
+    memcpy(window_last, window_sum, sizeof(window_last));
+    memset(window_sum, 0, sizeof(window_sum));
+    window_count = 0;
+    window_prev = 1;
+  }
+}
+
+/**
+ * @brief Hand on the settled frames of a block; the rest are discarded
+ */
+static void lowPower_blockCallback(const uint16_t *block, uint32_t frame_count,
+                                   void *ctx) {
+  UNUSED(ctx);
+  blocks_done++;
+  if (!settled) {
+    lowPower_settle(block, frame_count);
+  }
+  uint32_t first = frame_count;
+  if (settled) {
+    first = (settle_frame <= burst_frame) ? 0U : settle_frame - burst_frame;
+    if (first > frame_count) {
+      first = frame_count;
+    }
+  }
+  burst_frame += frame_count;
+  if (first == frame_count) {
+    return;
+  }
+  // Whole frames stay 4-byte aligned for the paired loads
+  const uint16_t *valid = &block[first * ADC_CONVERSIONS_CHANNEL_COUNT];
+  dspStats_accumulate(burst_stats, valid, frame_count - first);
+  settled_frames += frame_count - first;
+  if (config.block_cb != NULL) {
+    config.block_cb(valid, frame_count - first, config.ctx);
+  }
+}
+
+/**
+ * @brief Clear the settle detection for a new burst
+ */
+static void lowPower_settleReset(void) {
+  burst_frame = 0;
+  window_count = 0;
+  window_prev = 0;
+  memset(window_sum, 0, sizeof(window_sum));
+  dspStats_reset(burst_stats);
+  settled_frames = 0;
+  settle_forced = 0;
+  settle_frame = 0;
+  settled = (config.settle.window_frames == 0U) ? 1U : 0U;
+}
+
+/**
+ * @brief Time the settling of a burst and lengthen the lead to it
+ *
+ * Only a burst that discarded frames beyond min_frames has its settle time
+ * in the data; one already settled at its first sample only bounds it.
+ */
+static void lowPower_learn(uint32_t first_sample_us) {
+  const LowPower_SettleProfile_t *p = &config.settle;
+  stats.discarded = settle_frame;
+  if (settle_forced) {
+    stats.settle_forced++;
+    return;
+  }
+  if (settle_frame <= p->min_frames) {
+    return;
+  }
+  stats.settle_us = first_sample_us +
+                    (uint32_t)((uint64_t)settle_frame * 1000000U /
+                               config.frame_rate_hz);
+#if LOW_POWER_SENSOR_GATING
+  // Half a period at most: the sensors would hardly ever be off
+  uint32_t ticks = lowPower_microsToTicks(stats.settle_us + p->margin_us);
+  if (ticks > period_ticks / 2U) {
+    ticks = period_ticks / 2U;
+  }
+  if (ticks > lead_ticks) {
+    lead_ticks = ticks;
+    stats.lead_us = lowPower_ticksToMicros(lead_ticks);
+  }
+#endif
+}
+
+/**
+ * @brief Wait until every queued telemetry byte has left USART3
+ */
+static void lowPower_drain(void) {
+  Telemetry_Stats_t tx;
+  uint32_t start = HAL_GetTick();
+  do {
+    telemetry_poll();
+    telemetry_getStats(&tx);
+  } while ((tx.queued != 0U ||
+            __HAL_UART_GET_FLAG(&huart3, UART_FLAG_TC) == RESET) &&
+           HAL_GetTick() - start < LOW_POWER_DRAIN_TIMEOUT_MS);
+}
+
+/**
+ * @brief Start the LPTIM1 kernel clock (LSE needs backup-domain access)
+ */
+static HAL_StatusTypeDef lowPower_startClock(void) {
+  RCC_OscInitTypeDef osc = {0};
+  RCC_PeriphCLKInitTypeDef periph = {0};
+
+  osc.PLL.PLLState = RCC_PLL_NONE;
+#if LOW_POWER_USE_LSE
+  HAL_PWR_EnableBkUpAccess();
+  osc.OscillatorType = RCC_OSCILLATORTYPE_LSE;
+  osc.LSEState = RCC_LSE_ON;
+  periph.Lptim1ClockSelection = RCC_LPTIM1CLKSOURCE_LSE;
+#else
+  osc.OscillatorType = RCC_OSCILLATORTYPE_LSI;
+  osc.LSIState = RCC_LSI_ON;
+  periph.Lptim1ClockSelection = RCC_LPTIM1CLKSOURCE_LSI;
+#endif
+  if (HAL_RCC_OscConfig(&osc) != HAL_OK) {
+    return HAL_ERROR;
+  }
+  periph.PeriphClockSelection = RCC_PERIPHCLK_LPTIM1;
+  return HAL_RCCEx_PeriphCLKConfig(&periph);
+}
+
+/* Public functions ----------------------------------------------------------*/
+
+HAL_StatusTypeDef lowPower_init(const LowPower_Config_t *cfg) {
+  if (cfg == NULL || cfg->period_ms == 0U || cfg->burst_frames == 0U ||
+      cfg->frame_rate_hz == 0U ||
+      (cfg->settle.window_frames != 0U &&
+       (cfg->settle.window_frames > cfg->settle.max_frames ||
+        cfg->settle.min_frames > cfg->settle.max_frames))) {
+    return HAL_ERROR;
+  }
+
+  // Smallest prescaler that fits the period in the 16-bit autoreload
+  uint64_t ticks = (uint64_t)cfg->period_ms * LOW_POWER_LPTIM_HZ / 1000U;
+  uint32_t presc_log2 = 0;
+  while ((ticks >> presc_log2) > LOW_POWER_ARR_MAX + 1U &&
+         presc_log2 < LOW_POWER_PRESC_MAX_LOG2) {
+    presc_log2++;
+  }
+  if ((ticks >> presc_log2) > LOW_POWER_ARR_MAX + 1U ||
+      (ticks >> presc_log2) < 2U) {
+    return HAL_ERROR;
+  }
+
+  initialised = 0;
+  config = *cfg;
+  tick_divider = 1UL << presc_log2;
+  period_ticks = (uint32_t)(ticks >> presc_log2);
+  memset(&stats, 0, sizeof(stats));
+  wake_total_us = 0;
+  wake_count = 0;
+  awake_ticks = 0;
+  elapsed_ticks = 0;
+
+  if (lowPower_startClock() != HAL_OK) {
+    return HAL_ERROR;
+  }
+
+  hlptim1.Instance = LPTIM1;
+  hlptim1.Init.Clock.Source = LPTIM_CLOCKSOURCE_APBCLOCK_LPOSC;
+  hlptim1.Init.Clock.Prescaler = presc_log2 << LPTIM_CFGR_PRESC_Pos;
+  hlptim1.Init.Trigger.Source = LPTIM_TRIGSOURCE_SOFTWARE;
+  hlptim1.Init.OutputPolarity = LPTIM_OUTPUTPOLARITY_HIGH;
+  hlptim1.Init.UpdateMode = LPTIM_UPDATE_IMMEDIATE;
+  hlptim1.Init.CounterSource = LPTIM_COUNTERSOURCE_INTERNAL;
+  if (HAL_LPTIM_Init(&hlptim1) != HAL_OK ||
+      HAL_LPTIM_Counter_Start_IT(&hlptim1, period_ticks - 1U) != HAL_OK) {
+    return HAL_ERROR;
+  }
+  // The compare match wakes the core to power the sensors up; IER is only
+  // writable with the timer off, CMP only with it on
+  __HAL_LPTIM_DISABLE(&hlptim1);
+  __HAL_LPTIM_ENABLE_IT(&hlptim1, LPTIM_IT_CMPM);
+  __HAL_LPTIM_ENABLE(&hlptim1);
+  __HAL_LPTIM_COMPARE_SET(&hlptim1, period_ticks - 1U);
+  __HAL_LPTIM_START_CONTINUOUS(&hlptim1);
+  lead_ticks = lowPower_microsToTicks(cfg->settle.lead_us);
+  if (lead_ticks > period_ticks / 2U) {
+    lead_ticks = period_ticks / 2U;
+  }
+  stats.lead_us = lowPower_ticksToMicros(lead_ticks);
+
+  // Flash off in STOP: a few us more wake-up for a lower STOP current
+  HAL_PWREx_EnableFlashPowerDown();
+
+  woken = 0;
+  after_stop = 0;
+  initialised = 1;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef lowPower_burst(void) {
+  if (!initialised) {
+    return HAL_ERROR;
+  }
+  const uint32_t block_frames = analogSensor_getBlockFrames();
+  uint32_t blocks = (config.burst_frames + block_frames - 1U) / block_frames;
+  // The settling may take up to max_frames more
+  if (config.settle.window_frames != 0U) {
+    blocks += (config.settle.max_frames + block_frames - 1U) / block_frames;
+  }
+  uint32_t timeout_ms =
+      2U * blocks * block_frames * 1000U / config.frame_rate_hz +
+      LOW_POWER_FIRST_SAMPLE_TIMEOUT_MS;
+
+  // Powered by the lead, or from here (first burst, overrun)
+  uint32_t lead_us = sensors_on ? lowPower_ticksToMicros(powered_ticks) : 0U;
+  if (!sensors_on) {
+    lowPower_sensorPower(1);
+  }
+  powered_ticks = 0;
+
+  blocks_done = 0;
+  lowPower_settleReset();
+  analogSensor_registerBlockCallback(lowPower_blockCallback, NULL);
+  if (analogSensor_startTimedDMA(config.frame_rate_hz) != HAL_OK) {
+    analogSensor_registerBlockCallback(config.block_cb, config.ctx);
+    lowPower_sensorPower(0);
+    stats.errors++;
+    return HAL_ERROR;
+  }
+  energyMeter_setPeripheral(ENERGY_METER_PERIPH_ADC, 1);
+
+  uint32_t start = HAL_GetTick();
+  if (after_stop) {
+    // First transfer of the scan = first sample in memory
+    const DMA_Stream_TypeDef *stream = hadc1.DMA_Handle->Instance;
+    uint32_t initial = stream->NDTR;
+    while (stream->NDTR == initial &&
+           HAL_GetTick() - start < LOW_POWER_FIRST_SAMPLE_TIMEOUT_MS) {
+    }
+    uint32_t wake_us = lowPower_ticksToMicros(lowPower_count());
+    after_stop = 0;
+    stats.wake_us = wake_us;
+    if (wake_us > stats.wake_max_us) {
+      stats.wake_max_us = wake_us;
+    }
+    wake_total_us += wake_us;
+    wake_count++;
+    stats.wake_mean_us = (uint32_t)(wake_total_us / wake_count);
+    if (lead_us != 0U) {
+      lead_us += wake_us;
+    }
+  }
+
+  while (settled_frames < config.burst_frames &&
+         HAL_GetTick() - start < timeout_ms) {
+    cpuLoad_idle();
+  }
+  analogSensor_stopDMA();
+  energyMeter_setPeripheral(ENERGY_METER_PERIPH_ADC, 0);
+  analogSensor_registerBlockCallback(config.block_cb, config.ctx);
+  lowPower_sensorPower(0);
+
+  if (settled_frames < config.burst_frames) {
+    stats.errors++;
+    return HAL_TIMEOUT;
+  }
+  lowPower_learn(lead_us);
+  stats.bursts++;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef lowPower_sleep(void) {
+  if (!initialised) {
+    return HAL_ERROR;
+  }
+  lowPower_drain();
+
+  // Work since the last wake-up; a wake-up already taken means the work
+  // outlasted the period and a new one is running
+  power_due = 0;
+  uint32_t entry = lowPower_count();
+  elapsed_ticks += period_ticks;
+  uint8_t overrun = woken;
+  awake_ticks += overrun ? period_ticks : entry;
+  stats.duty_centi_pct = (uint32_t)(awake_ticks * 10000U / elapsed_ticks);
+  if (overrun) {
+    woken = 0;
+    stats.overruns++;
+    return HAL_BUSY;
+  }
+
+  // Sensors up lead_ticks before the wake-up: now if that is past
+  const uint32_t power_at = period_ticks - lead_ticks;
+  if (lead_ticks != 0U) {
+    if (entry + 1U >= power_at) {
+      lowPower_sensorPower(1);
+      powered_ticks = period_ticks - entry;
+    } else {
+      __HAL_LPTIM_CLEAR_FLAG(&hlptim1, LPTIM_FLAG_CMPOK);
+      __HAL_LPTIM_COMPARE_SET(&hlptim1, power_at - 1U);
+    }
+  }
+
+  // STOP is booked to the energy meter in LPTIM ticks, split where the
+  // sensors come up
+  uint32_t stop_from = entry;
+  HAL_SuspendTick();
+  while (!woken) {
+    // Any other EXTI wake-up (e.g. a sync pulse) goes straight back
+    HAL_PWR_EnterSTOPMode(PWR_LOWPOWERREGULATOR_ON, PWR_STOPENTRY_WFI);
+    if (power_due && !sensors_on && lead_ticks != 0U) {
+      // Still on HSI: the pin, then straight back to STOP
+      const uint32_t now = lowPower_count();
+      energyMeter_addStop(lowPower_ticksToMicros(now - stop_from));
+      stop_from = now;
+      lowPower_sensorPower(1);
+      powered_ticks = period_ticks - now;
+    }
+  }
+  uint32_t t0 = DWT->CYCCNT;
+  woken = 0;
+  HAL_ResumeTick();
+
+  HAL_StatusTypeDef status = clockProfile_resume();
+  // Still on HSI until the switch: cycles at HSI_VALUE dominate
+  stats.resume_us = (DWT->CYCCNT - t0) / (HSI_VALUE / 1000000U);
+
+  // The HAL tick stopped with its clock (TIM5 or SysTick); add the time
+  // spent in STOP
+  const uint32_t now = lowPower_count();
+  uint32_t slept = period_ticks - entry + now;
+  energyMeter_addStop(lowPower_ticksToMicros(period_ticks - stop_from + now));
+  uwTick += (uint32_t)((uint64_t)slept * tick_divider * 1000U /
+                       LOW_POWER_LPTIM_HZ);
+
+  if (status != HAL_OK) {
+    stats.errors++;
+    return HAL_ERROR;
+  }
+  after_stop = 1;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef lowPower_getStats(LowPower_Stats_t *out) {
+  if (out == NULL) {
+    return HAL_ERROR;
+  }
+  *out = stats;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef lowPower_getBurstStats(ADC_ChannelStats_t *out) {
+  if (out == NULL) {
+    return HAL_ERROR;
+  }
+  const uint8_t *map = analogSensor_getBlockChannelMap();
+  for (uint8_t i = 0; i < ADC_CONVERSIONS_CHANNEL_COUNT; i++) {
+    dspStats_compute(&burst_stats[i], &out[map[i]]);
+  }
+  return HAL_OK;
+}
+
+void lowPower_report(void) {
+  char line[192];
+  int len = snprintf(
+      line, sizeof(line),
+      "LPWR n=%lu wake_us=%lu max_us=%lu mean_us=%lu resume_us=%lu "
+      "duty=%lu.%02lu overruns=%lu errors=%lu discarded=%lu settle_us=%lu "
+      "lead_us=%lu forced=%lu\r\n",
+      (unsigned long)stats.bursts, (unsigned long)stats.wake_us,
+      (unsigned long)stats.wake_max_us, (unsigned long)stats.wake_mean_us,
+      (unsigned long)stats.resume_us,
+      (unsigned long)(stats.duty_centi_pct / 100U),
+      (unsigned long)(stats.duty_centi_pct % 100U),
+      (unsigned long)stats.overruns, (unsigned long)stats.errors,
+      (unsigned long)stats.discarded, (unsigned long)stats.settle_us,
+      (unsigned long)stats.lead_us, (unsigned long)stats.settle_forced);
+  if (len > 0) {
+    telemetry_send((const uint8_t *)line, (uint16_t)len);
+  }
+}
+
+void lowPower_irqHandler(void) { HAL_LPTIM_IRQHandler(&hlptim1); }
+
+/* HAL callbacks -------------------------------------------------------------*/
+
+void HAL_LPTIM_AutoReloadMatchCallback(LPTIM_HandleTypeDef *hlptim) {
+  if (hlptim->Instance == LPTIM1) {
+    woken = 1;
+  }
+}
+
+void HAL_LPTIM_CompareMatchCallback(LPTIM_HandleTypeDef *hlptim) {
+  if (hlptim->Instance == LPTIM1) {
+    power_due = 1;
+  }
+}
+
+void HAL_LPTIM_MspInit(LPTIM_HandleTypeDef *hlptim) {
+  if (hlptim->Instance != LPTIM1) {
+    return;
+  }
+  __HAL_RCC_LPTIM1_CLK_ENABLE();
+  HAL_NVIC_SetPriority(LPTIM1_IRQn, LOW_POWER_IRQ_PRIORITY, 0);
+  HAL_NVIC_EnableIRQ(LPTIM1_IRQn);
+}
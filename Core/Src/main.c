@@ -19,13 +19,103 @@
 /* Includes ------------------------------------------------------------------*/
 #include "main.h"
 #include "adc.h"
+#include "dma.h"
+#include "tim.h"
 #include "usart.h"
 #include "gpio.h"
 
 /* Private includes ----------------------------------------------------------*/
 /* USER CODE BEGIN Includes */
+#include "acq_tune.h"
+#include "adaptive_rate.h"
+#include "adc_calibration.h"
+#include "app_rtos.h"
+#include "app_sched.h"
+#include "adc_bench.h"
+#include "block_pool.h"
+#include "boot_profile.h"
+#include "burst_capture.h"
+#include "can_bus.h"
 #include "adc_conversions.h"
+#include "adc_linearity.h"
+#include "adc_mux.h"
+#include "adc_range.h"
+#include "adc_replay.h"
+#include "adc_ring.h"
+#include "adc_sections.h"
+#include "adc_supply.h"
+#include "adc_trigger.h"
+#include "clock_gov.h"
+#include "clock_profile.h"
+#include "config_store.h"
+#include "cpu_load.h"
+#include "crc_unit.h"
+#include "dac_loopback.h"
+#include "digital_in.h"
+#include "dsp_arrival.h"
+#include "dsp_asrc.h"
+#include "dsp_bands.h"
+#include "dsp_baseline.h"
+#include "dsp_coherence.h"
+#include "dsp_dctrack.h"
+#include "dsp_despike.h"
+#include "dsp_deskew.h"
+#include "dsp_filter.h"
+#include "dsp_goertzel.h"
+#include "dsp_histogram.h"
+#include "dsp_order.h"
+#include "dsp_oversample.h"
+#include "dsp_quality.h"
+#include "dsp_rainflow.h"
+#include "dsp_spectrum.h"
+#include "dsp_srs.h"
+#include "dsp_tsa.h"
+#include "dsp_vector.h"
+#include "dsp_velocity.h"
+#include "dsp_window.h"
+#include "dwt_counters.h"
+#include "dwt_profiler.h"
+#include "energy_meter.h"
+#include "eth_stream.h"
+#include "event_log.h"
+#include "ext_adc.h"
+#include "fft_sched.h"
+#include "flash_mode.h"
+#include "host_cmd.h"
+#include "i2c_target.h"
+#include "interlock.h"
+#include "irq_priority.h"
+#include "isr_budget.h"
+#include "latency_hist.h"
+#include "low_power.h"
+#include "mem_budget.h"
+#include "modbus_server.h"
+#include "nn_anomaly.h"
+#include "pc_profile.h"
+#include "pipeline.h"
+#include "ptp_sync.h"
+#include "pwm_sync.h"
+#include "qspi_recorder.h"
+#include "retained.h"
+#include "sample_codec.h"
+#include "scan_jitter.h"
+#include "sd_logger.h"
+#include "stage_deadline.h"
+#include "swo_trace.h"
+#include "tach.h"
+#include "tdma_bus.h"
+#include "telemetry.h"
+#include "telemetry_frame.h"
+#include "text_format.h"
+#include "time_sync.h"
+#include "timebase.h"
+#include "trigger_expr.h"
+#include "usb_msc.h"
+#include "usb_stream.h"
+#include "wavelet_codec.h"
+#include <math.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 /* USER CODE END Includes */
@@ -37,31 +127,7374 @@
 
 /* Private define ------------------------------------------------------------*/
 /* USER CODE BEGIN PD */
-#define ADC_CHANNEL_COUNT 6 // Assuming buffer size is 6
+#define ADC_FRAME_RATE_HZ 4000U // Nyquist for the 2 kHz LISXXXALH bandwidth
+#define REPORT_PERIOD_MS 100U   // 10 Hz status packet
+#define STATS_PERIOD_MS 1000U   // 1 s statistics window per stats packet
+#define PROFILER_DUMP_CMD "p"   // host command: dump the DWT probes
+#define BACKEND_BENCH_CMD "b"   // ... time the HAL vs LL polling reads
+#define BACKEND_BENCH_ROUNDS 100U
+#define LINK_RATE_CMD '0'       // '0'..'3' on USART3: link rate (link_rates[])
+#define LINK_FLOW_CMD 'h'       // ... toggle RTS/CTS
+#define CODEC_STREAM_CMD "z"    // ... toggle the lossless full-rate stream
+#define USB_CMD_READ 32U        // command bytes taken from USB per loop
+#define STAGE_SPECTRUM 0x01U    // block stages "pipeline" switches
+#define STAGE_ENVELOPE 0x02U
+#define STAGE_HARMONICS 0x04U
+#define STAGE_ORDER 0x08U       // TACH_ENABLE only
+#define STAGE_DESPIKE 0x10U     // DSP_DESPIKE_ENABLE only
+#define STAGE_VELOCITY 0x20U
+#define STAGE_DISPLAY 0x40U     // min/max stream, off until the host asks
+#define STAGE_HISTOGRAM 0x80U
+#define STAGE_ALL                                                             \
+  (STAGE_SPECTRUM | STAGE_ENVELOPE | STAGE_HARMONICS | STAGE_ORDER |          \
+   STAGE_DESPIKE | STAGE_VELOCITY | STAGE_DISPLAY | STAGE_HISTOGRAM)
+#define STAGE_DEFAULT (STAGE_ALL & ~STAGE_DISPLAY)
+#define DEADLINE_SPECTRUM 0U    // stage_deadline.h entries, in run order
+#define DEADLINE_ENVELOPE 1U
+#define DEADLINE_DISPLAY 2U
+#define DEADLINE_HARMONICS 3U
+#define DEADLINE_VELOCITY 4U
+#define DEADLINE_HISTOGRAM 5U
+#define DEADLINE_RECORD 6U      // raw recorders, never shed
+#define DEADLINE_COUNT 7U
+#define SETTINGS_VERSION 1U     // layout of the config_store.h values
+#define CODEC_RUN_FRAMES TELEMETRY_FRAME_CODEC_FRAMES
+#define STREAM_DECIMATION 8U    // 200 Hz low-pass, then every 8th frame
+#define STREAM_DEGRADE_MAX 2U   // back-pressure: decimation up to 4x ...
+#define STREAM_DEGRADE_MS 1000U // ... one step per second of bulk losses,
+#define STREAM_RECOVER_MS 10000U // ... one back per 10 s without
+#define LINK_BULK_SHARE_PCT 75U // sample streams: 3/4 of the UART at most
+#define LINK_BULK_BURST 1024U   // ... plus two slots of burst
+#define QUALITY_IDLE 0xFFU      // no "quality" capture in progress
+#define ASCII_LINE_MAX                                                        \
+  (2U + TEXT_FORMAT_U32_MAX + 5U * ADC_CONVERSIONS_CHANNEL_COUNT + 4U)
+#define TILT_OVERSAMPLE_RATIO 256U // X/Y/Z tilt: 256x -> 16 bit at 15.6 Hz
+#define TILT_RESULT_BITS 16U
+#define VIBRATION_CHANNELS 4U      // spectra of X/Y/Z and sensor 2 X (0-3)
+#define VIBRATION_FFT_LENGTH 1024U // 3.9 Hz bins at 4 kHz
+#define VIBRATION_AVERAGES 4U      // 50 % overlap: a result per axis / 512 ms
+#define LOG_BANDS_LOW_HZ 10.0f     // "bands": midbands 10 Hz ... (12.5 Hz
+#define LOG_BANDS_HIGH_HZ 1600.0f  // at 3.9 Hz bins) to 1.6 kHz, 22 thirds
+#define CEPSTRUM_MIN_MS 5U         // "cepstrum": spacings up to 200 Hz ...
+#define CEPSTRUM_MAX_MS 0U         // ... down to 7.8 Hz (half the window)
+#define COHERENCE_AVERAGES 16U     // cross-spectra: a result per 2 s
+#define ENVELOPE_CHANNEL ADC_CH_SENSOR1_X // bearing envelope on X ...
+#define ENVELOPE_DECIMATION 4U     // ... at 1 kHz after the 200 Hz low-pass
+#define ENVELOPE_FFT_LENGTH 1024U  // 0.98 Hz bins: a result every 2 s
+#define ENVELOPE_SEARCH_HZ 3.0f    // fault tone search +-3 Hz (slip)
+#ifndef ENVELOPE_SPECTRUM_Q15
+#define ENVELOPE_SPECTRUM_Q15 0    // 1: envelope FFT on the q15 path (RAM)
+#endif
+#define HARMONIC_WINDOW 4000U      // Goertzel: 1 Hz bins, a result per second
+#define VELOCITY_INTERVAL_MS 1000U // velocity RMS 10-1000 Hz, every second
+#define DISPLAY_BUCKET_FRAMES 8U   // min/max of 8 frames: 1000 points/s/ch
+#define HISTOGRAM_SHIFT 4U         // 256 bins of 16 codes per channel
+#define RAINFLOW_HYSTERESIS 8U     // codes: reversals within the noise are not
+#define RAINFLOW_RANGE_BIN 32.0f   // codes: ranges 0-512, larger in the last
+#define RAINFLOW_MEAN_LOW 1792.0f  // codes: means 1792-2304 around mid-scale
+#define RAINFLOW_MEAN_BIN 64.0f
+#define SRS_FIRST_HZ 10.0f         // captures' SRS: 10 Hz ...
+#define SRS_LAST_HZ 1000.0f        // ... to 1 kHz (or a quarter of the rate)
+#define SRS_PER_OCTAVE 6U          // ... in 1/6 octaves (40 at 4 kHz) ...
+#define SRS_Q 10.0f                // ... at 5 % damping
+#define SRS_OFF 0U                 // srs_mode: captures sent raw only
+#define SRS_ON 1U                  // ... an SRS per channel, then raw
+#define SRS_ONLY 2U                // ... the SRS instead of the raw frames
+#define ARRIVAL_SIGMA 8.0f         // onset: 8 noise deviations ...
+#define ARRIVAL_MIN_CODES 40U      // ... and at least ~50 mg
+#define ARRIVAL_PAIR_A ADC_CH_SENSOR1_X // impact located between the ...
+#define ARRIVAL_PAIR_B ADC_CH_SENSOR2_X // ... two X axes ...
+#define ARRIVAL_SPACING_M 1.0f     // ... this far apart ...
+#define ARRIVAL_SPEED_M_S 0.0f     // ... at this wave speed; 0 = not located
+#define VELOCITY_ZONE_AB 1.4f      // ISO 10816-3 group 2, rigid: A/B ...
+#define VELOCITY_ZONE_BC 2.8f      // ... B/C ...
+#define VELOCITY_ZONE_CD 4.5f      // ... C/D, mm/s RMS
+#define EVENT_POST_FRAMES 768U     // 192 ms from the trigger on
+// The rest of the capture window before it: 64 ms, 320 ms packed
+#define EVENT_PRE_FRAMES (ADC_TRIGGER_CAPTURE_FRAMES - EVENT_POST_FRAMES)
+#define EVENT_SLOPE_CODES 400U     // ~0.5 g change ...
+#define EVENT_SLOPE_FRAMES 4U      // ... within 1 ms
+#define EVENT_SHOCK_CODES 2457U    // sensor 2 vector beyond 3 g, any direction
+#define RANGE_LOW_CODES 205U       // watchdog window on channels 3-5: 5 %
+#define RANGE_HIGH_CODES 3890U     // from either rail means out of range
+#define DUTY_PERIOD_MS 1000U       // LOW_POWER_DUTY_CYCLE: 1 Hz bursts ...
+#define DUTY_BURST_FRAMES 256U     // ... of 64 ms at ADC_FRAME_RATE_HZ
+#define DUTY_REPORT_BURSTS 10U     // LPWR line every 10 bursts
+#define DUTY_SETTLE_MAX 1024U      // sensors settled within 256 ms ...
+#define DUTY_SETTLE_WINDOW 16U     // ... when 4 ms means ...
+#define DUTY_SETTLE_TOL_CODES 8U   // ... agree to ~10 mg
+#define DUTY_SETTLE_MARGIN_US 500U // lead beyond the measured settle time
+#define RATE_STEP_UP_CODES 40.0f   // ADAPTIVE_RATE_ENABLE: ~50 mg RMS wakes
+#define RATE_STEP_DOWN_CODES 10.0f // ... below ~12 mg RMS is quiet ...
+#define RATE_QUIET_MS 10000U       // ... for 10 s per step down
+#define SUPPLY_CORRECT 1U          // ADC_SUPPLY_ENABLE: sensors on own rail
+#define FIRST_SAMPLE_TIMEOUT_MS 10U // BOOT_PROFILE_ENABLE: first DMA transfer
+#define EXT_STREAM_DECIMATION 64U  // EXT_ADC_ENABLE: every 64th frame sent
+#define ORDER_CHANNEL ADC_CH_SENSOR1_X // TACH_ENABLE: order spectrum of X ...
+#define ORDER_SAMPLES_PER_REV 64U  // ... up to order 32, 4 kHz up to 3750 rpm
+#define ORDER_FFT_LENGTH 1024U     // 1/16 order bins: 16 revolutions a segment
+#define ORDER_MIN_RPM 300.0f       // slower is a gap (history: 0.2 s per edge)
+#define ORDER_SEARCH 0.1f          // order tone search +-0.1 order
+#define TSA_REVOLUTIONS 32U        // "tsa": X revolutions averaged per packet
+#define INTERLOCK_LOW_CODES 1024U  // INTERLOCK_ENABLE: sensor 1 X/Y/Z beyond
+#define INTERLOCK_HIGH_CODES 3072U // ... +-1.25 g drives PG1 high
+#define DMA_BUDGET_SHARE 2U        // ADC DMA handler: 1/2 of a block period
+#define DESPIKE_TAPS 5U            // DSP_DESPIKE_ENABLE: 5-frame median ...
+#define DESPIKE_THRESHOLD_CODES 800U // ... replaces samples ~1 g off it
+#define REPORT_HEARTBEAT_MS 60000U // "report exception": whole record a minute
+#define REPORT_DEADBAND_MEAN 8.0f  // ... or a feature change beyond: ~10 mg
+#define REPORT_DEADBAND_RMS 4.0f   // ... ~5 mg RMS
+#define REPORT_DEADBAND_PK_PK 24.0f // ... ~30 mg peak-to-peak
+#define REPORT_DEADBAND_CREST 0.5f
+#define REPORT_DEADBAND_KURTOSIS 0.5f
+#define REPORT_DEADBAND_BIAS 2.0f  // ... ~2.5 mg of zero-g drift
+#define REPORT_FULL 0U             // report_mode: stats packet per window
+#define REPORT_EXCEPTION 1U        // ... features beyond their dead-band
+#define REPORT_SCORE 2U            // ... anomaly score per channel group
+#define ANOMALY_CADENCE 10U        // "report score": a score per 10 windows
+#define ANOMALY_LEARN_WINDOWS 600U // ... normalisation over the first 10 min
+#define ANOMALY_THRESHOLD 4.0f     // ... alarm at 4x the learned mean z^2
+#define BURST_PACKETS_PER_POLL 4U  // "burst": drained 4 packets a pass at most
+#define SNAPSHOT_PACKETS_PER_POLL 4U // "snapshot": the same
+#define ROLLUP_PACKETS_PER_POLL 4U   // "rollup": the same
+#define PRESET_NONE 0xFFU          // "preset": none chosen, the build's block
+#define PRESET_HOLD_MS 5U          // ... "throughput": TX batched up to 5 ms
+#define MSC_STOP_TIMEOUT_MS 1000U  // "msc on": the recorder's last writes
+#define GOV_BURST_BOOST_MS 10000U  // "burst": fast profile held this long
+#define GOV_BOOST_MAX_MS 600000U   // "gov boost": 10 min at most
+
+_Static_assert(DSP_SPECTRUM_MAX_BANDS <= TELEMETRY_FRAME_MAX_BANDS,
+               "spectrum packets must carry every band");
+_Static_assert(DSP_SPECTRUM_MAX_TONES <= TELEMETRY_FRAME_MAX_TONES,
+               "envelope packets must carry every tone");
+_Static_assert(DSP_GOERTZEL_MAX_BINS <= TELEMETRY_FRAME_MAX_HARMONICS,
+               "harmonics packets must carry every bin");
+_Static_assert(DSP_VECTOR_GROUPS == TELEMETRY_FRAME_VECTOR_GROUPS,
+               "vector packets carry one magnitude per group");
+_Static_assert(sizeof(((TelemetryFrame_Diagnostics_t *)0)->counts) ==
+                   sizeof(((ADC_ErrorInfo_t *)0)->counts),
+               "diagnostics packets carry the whole error matrix");
+_Static_assert(TELEMETRY_FRAME_ENCODED_MAX <= TELEMETRY_SLOT_SIZE,
+               "a telemetry packet must fit in one TX slot");
+_Static_assert(TELEMETRY_FRAME_CODEC_ENCODED_MAX <= TELEMETRY_SLOT_SIZE,
+               "a compressed packet must fit in one TX slot");
+_Static_assert(sizeof(ADC_Frame_t) % sizeof(uint16_t) == 0U,
+               "the codec reads one channel of a frame array by stride");
+#if BOOT_FAST_START && (ADC_BENCH_BUILD || LOW_POWER_DUTY_CYCLE)
+#error "BOOT_FAST_START: the bench and duty-cycle builds need telemetry first"
+#endif
+#if EXT_ADC_ENABLE
+_Static_assert(EXT_ADC_CHANNELS <= TELEMETRY_FRAME_EXT_CHANNELS,
+               "external packets must carry every SPI ADC channel");
+#if LOW_POWER_DUTY_CYCLE
+#error "EXT_ADC_ENABLE: the SPI ADC follows the continuous scan only"
+#endif
+#endif
+#if PWM_SYNC_ENABLE && (EXT_ADC_ENABLE || ADAPTIVE_RATE_ENABLE || \
+                        LOW_POWER_DUTY_CYCLE)
+#error "PWM_SYNC_ENABLE: TIM2 is idle and the PWM sets the scan rate"
+#endif
+#if ADC_MUX_ENABLE && (PWM_SYNC_ENABLE || LOW_POWER_DUTY_CYCLE || \
+                       DSP_DESPIKE_ENABLE || DSP_DESKEW_ENABLE)
+#error "ADC_MUX_ENABLE: TIM1 switches the muxes on every continuous scan"
+#endif
+#if CLOCK_GOV_ENABLE && (EXT_ADC_ENABLE || ADC_MUX_ENABLE || PWM_SYNC_ENABLE)
+#error "CLOCK_GOV_ENABLE: TIM1/TIM8 on PCLK2 run at 16 MHz through a switch"
+#endif
+#if DIGITAL_IN_ENABLE && (ADC_MUX_ENABLE || PWM_SYNC_ENABLE)
+#error "DIGITAL_IN_ENABLE: TIM1 samples the inputs on every TIM2 trigger"
+#endif
 
 /* USER CODE END PD */
 
-/* Private macro -------------------------------------------------------------*/
-/* USER CODE BEGIN PM */
+/* Private macro -------------------------------------------------------------*/
+/* USER CODE BEGIN PM */
+
+/* USER CODE END PM */
+
+/* Private variables ---------------------------------------------------------*/
+
+/* USER CODE BEGIN PV */
+// Rates the host can select; a repeat of the current one confirms it
+static const uint32_t link_rates[] = {TELEMETRY_DEFAULT_BAUD, 921600U,
+                                      2000000U, 4000000U};
+static DSP_Oversampler_t oversampler;
+static DSP_DcTrack_t dc_track;      // zero-g drift, reported in stats packets
+#if DSP_WINDOW_ENABLE
+static DSP_Window_t sliding ADC_FAST_BSS; // max/min/RMS of the last frames
+#endif
+#if DSP_DESPIKE_ENABLE
+static DSP_Despike_t despike;       // EMI spikes, ahead of every consumer
+#endif
+#if DSP_DESKEW_ENABLE
+static DSP_Deskew_t deskew;         // channels on the frame trigger's instant
+static volatile uint8_t deskew_on = 1;
+static uint32_t deskew_rate_hz = ADC_FRAME_RATE_HZ;
+#endif
+static DSP_Filter_t stream_filter;
+#if DSP_ASRC_ENABLE
+static DSP_Asrc_t stream_asrc; // stream decimation on the nominal grid
+static uint32_t asrc_pulses = 0;
+#endif
+#if DSP_VECTOR_STREAM_ENABLE
+static DSP_Vector_t stream_vector;          // stream as group magnitudes
+static TelemetryFrame_Vector_t vector_batch;
+#endif
+static DSP_Spectrum_t vibration[VIBRATION_CHANNELS];
+static FftSched_t fft_sched; // their segments, and the orders', paced
+static DSP_BandTable_t log_bands; // octave levels of the vibration spectra
+// Learned band levels per vibration channel, scored with every result
+static DSP_Baseline_t baseline[VIBRATION_CHANNELS] ADC_FAST_BSS;
+_Static_assert(CONFIG_KEY_BASELINE_3 - CONFIG_KEY_BASELINE_0 + 1 ==
+                   VIBRATION_CHANNELS,
+               "one stored baseline per vibration channel");
+// Phase and coherence of X1 against Y1, Z1 and X2, on the vibration FFTs
+static DSP_Coherence_t coherence;
+// Envelope branch: band-pass -> rectify -> low-pass -> decimate -> FFT
+static Pipeline_Biquad_t envelope_band;
+static Pipeline_Biquad_t envelope_lowpass;
+static Pipeline_Decimate_t envelope_decimate = {.factor = ENVELOPE_DECIMATION};
+#if ENVELOPE_SPECTRUM_Q15
+static DSP_SpectrumQ15_t envelope;
+static Pipeline_SpectrumQ15_t envelope_fft = {.channel = {[ENVELOPE_CHANNEL] =
+                                                              &envelope}};
+#define ENVELOPE_FFT_STAGE PIPELINE_STAGE_SPECTRUM_Q15(&envelope_fft)
+#else
+static DSP_Spectrum_t envelope;
+static Pipeline_Spectrum_t envelope_fft = {.channel = {[ENVELOPE_CHANNEL] =
+                                                           &envelope}};
+#define ENVELOPE_FFT_STAGE PIPELINE_STAGE_SPECTRUM(&envelope_fft)
+#endif
+static const Pipeline_Stage_t envelope_path[] = {
+    PIPELINE_STAGE_BIQUAD(&envelope_band), PIPELINE_STAGE_RECTIFY(),
+    PIPELINE_STAGE_BIQUAD(&envelope_lowpass),
+    PIPELINE_STAGE_DECIMATE(&envelope_decimate), ENVELOPE_FFT_STAGE};
+static const Pipeline_Branch_t envelope_branches[] = {
+    PIPELINE_BRANCH(1U << ENVELOPE_CHANNEL, envelope_path)};
+static Pipeline_t envelope_pipeline;
+// Dashboard branch: min/max of every bucket of raw frames, every channel
+static HAL_StatusTypeDef App_DisplaySink(const uint8_t *data, uint16_t len);
+static Pipeline_Display_t display_minmax = {.sink = App_DisplaySink};
+static const Pipeline_Stage_t display_path[] = {
+    PIPELINE_STAGE_DISPLAY(&display_minmax)};
+static const Pipeline_Branch_t display_branches[] = {
+    PIPELINE_BRANCH(TELEMETRY_FRAME_ALL_CHANNELS, display_path)};
+static Pipeline_t display_pipeline;
+// Shaft harmonics 1x-4x at 1500 rpm on every channel
+static DSP_Goertzel_t harmonics;
+static const float32_t harmonic_hz[] = {25.0f, 50.0f, 75.0f, 100.0f};
+// ISO 10816 velocity severity on every channel
+static DSP_Velocity_t velocity;
+// Amplitude distribution of the raw codes, read by "histogram"
+static DSP_Histogram_t histogram;
+// Fatigue cycles of the channels in rainflow_mask, read by "rainflow"
+static DSP_Rainflow_t rainflow;
+// Example S-N curve in mg of range, Basquin slope 3; a structure's own
+// curve is in stress, with units_per_code its stress per code
+static const DSP_RainflowSn_t rainflow_sn = {
+    .count = 2, .range = {100.0f, 1000.0f}, .cycles = {1e7f, 1e4f}};
+static uint32_t rainflow_requests = 0;
+// Oscillators of the capture SRS, rebuilt when the frame rate changes
+static DSP_SrsBank_t srs_bank;
+// Fault frequencies of a 6205 bearing at 1500 rpm: BPFO, BPFI, BSF, FTF
+static const float32_t envelope_tones[] = {89.6f, 135.4f, 58.9f, 9.96f};
+#if TACH_ENABLE
+// Order tracking: X resampled per shaft angle, FFT'd in orders
+static DSP_Order_t order;
+static DSP_Spectrum_t order_fft;
+// Unbalance, misalignment, looseness
+static const float32_t order_tones[] = {1.0f, 2.0f, 3.0f};
+// Time-synchronous average of the same angle samples
+static DSP_Tsa_t tsa;
+static DSP_TsaResult_t tsa_result;
+static uint16_t tsa_revolutions = TSA_REVOLUTIONS; // 0 = off
+#endif
+// Full-rate compressed stream: one run fills while the other is sent
+static uint8_t codec_stream = 0;
+static uint16_t codec_error = 0;    // wavelet bound in codes, 0 = lossless
+static ADC_Frame_t codec_frames[2][CODEC_RUN_FRAMES];
+static uint32_t codec_first[2];
+static uint32_t codec_time[2];
+static uint32_t codec_fill = 0;     // frames in the filling run
+static uint8_t codec_active = 0;    // run being filled
+static uint8_t codec_pending = 0;   // other run waiting to be sent
+static uint8_t codec_channel = 0;   // next channel of the pending run
+#if EXT_ADC_ENABLE
+// External SPI ADC frames: one batch fills (ISR) while the other is sent
+static TelemetryFrame_External_t ext_batch[2];
+static uint8_t ext_active = 0;
+static volatile uint8_t ext_pending = 0;
+static uint32_t ext_dropped = 0;    // batches the main loop had not sent
+#endif
+// Main loop state (the comms task in the RTOS build)
+static ADC_RingEntry_t last_entry = {0};
+static uint32_t last_report_ms = 0;
+static uint32_t last_stats_ms = 0;
+static uint32_t diag_sequence = 0;
+static uint32_t last_sync_ms = 0;
+static uint32_t last_sync_pulses = 0;
+static TelemetryFrame_Batch_t batch;
+static TelemetryFrame_Batch_t usb_batch;
+static uint8_t usb_cursor; // optional: a stalled host never stops the loop
+#if TDMA_BUS_ENABLE && TDMA_BUS_ADDRESS != 0
+static TelemetryFrame_Batch_t tdma_batch; // every frame, to the bus master
+#endif
+static uint8_t packet[TELEMETRY_FRAME_ENCODED_MAX];
+static uint16_t packet_len = 0;
+#if !APP_RTOS_ENABLE
+static uint8_t dsp_packet[TELEMETRY_FRAME_ENCODED_MAX];
+#endif
+// Block stages run once their state is set up (later with BOOT_FAST_START)
+static volatile uint8_t app_running = 0;
+static uint8_t first_block_marked = 0;
+// Blocks with a clipped sample; the stream flags its next packet after one
+static uint32_t clipped_blocks = 0;
+static volatile uint8_t stream_clipped = 0;
+// Stream decimation: the rate's (block boundary) times 2^degrade (loop)
+static volatile uint16_t stream_base_decimation = STREAM_DECIMATION;
+static volatile uint8_t stream_degrade = 0;
+static uint8_t stream_degrade_announce = 0;
+static uint32_t bulk_losses = 0;
+static uint32_t degrade_check_ms = 0;
+static uint32_t degrade_clear_ms = 0;
+// Block stage deadlines after the block's arrival, % of the block period,
+// and the order they are shed in under overload: display first, the raw
+// recorders never
+static const StageDeadline_Stage_t deadline_table[DEADLINE_COUNT] = {
+    [DEADLINE_SPECTRUM] = {"spectrum", 30U, 1U},
+    [DEADLINE_ENVELOPE] = {"envelope", 40U, 2U},
+    [DEADLINE_DISPLAY] = {"display", 50U, 6U},
+    [DEADLINE_HARMONICS] = {"harmonics", 60U, 4U},
+    [DEADLINE_VELOCITY] = {"velocity", 70U, 3U},
+    [DEADLINE_HISTOGRAM] = {"histogram", 80U, 5U},
+    [DEADLINE_RECORD] = {"record", 95U, 0U}};
+static const uint8_t deadline_stage_bits[DEADLINE_COUNT] = {
+    [DEADLINE_SPECTRUM] = STAGE_SPECTRUM,
+    [DEADLINE_ENVELOPE] = STAGE_ENVELOPE,
+    [DEADLINE_DISPLAY] = STAGE_DISPLAY,
+    [DEADLINE_HARMONICS] = STAGE_HARMONICS,
+    [DEADLINE_VELOCITY] = STAGE_VELOCITY,
+    [DEADLINE_HISTOGRAM] = STAGE_HISTOGRAM,
+    [DEADLINE_RECORD] = 0U};
+static StageDeadline_t deadlines;
+static uint32_t deadline_changes = 0;   // shed changes announced
+static uint32_t deadline_overflows = 0; // ring overflows counted
+// Settings the host commands change at run time
+static uint32_t scan_rate_hz = ADC_FRAME_RATE_HZ;
+static ADC_ChannelMask_t stream_mask = TELEMETRY_FRAME_ALL_CHANNELS;
+static volatile uint8_t block_stages = STAGE_DEFAULT;
+static uint8_t capture_enabled = 1; // re-arm the trigger after a capture
+static uint8_t report_mode = REPORT_FULL; // what a stats window sends
+static uint8_t ascii_stream = 0; // bring-up: text lines instead of samples
+static uint8_t feature_cbor = 0; // stats, spectra, velocity as CBOR packets
+static uint8_t log_bands_fraction = DSP_BANDS_THIRD_OCTAVE; // 0 = no bands
+static uint8_t baseline_gate = 0; // bands packets only while a channel alarms
+static uint8_t cepstrum_peaks = 0; // quefrency peaks per spectrum, 0 = off
+static uint8_t cepstrum_min_ms = CEPSTRUM_MIN_MS; // range searched, ms
+static uint8_t cepstrum_max_ms = CEPSTRUM_MAX_MS; // ... 0 = half the window
+static ADC_ChannelMask_t rainflow_mask = 0; // channels cycle-counted
+static uint8_t srs_mode = SRS_ON; // shock response spectra of captures
+// Operating points "preset" selects: block length, a partial packet sent
+// after every stream output, the lossless stream and the TX batch hold
+static const struct {
+  const char *name;
+  uint16_t block_frames;
+  uint8_t flush;
+  uint8_t codec;
+  uint8_t hold_ms;
+} presets[] = {
+    {"latency", ADC_CONVERSIONS_MIN_BLOCK_FRAMES, 1U, 0U, 0U},
+    {"throughput", ADC_CONVERSIONS_BLOCK_FRAMES, 0U, 1U, PRESET_HOLD_MS}};
+static uint8_t preset = PRESET_NONE;
+static uint8_t scan_bits = 12U; // resolution of the three scan ADCs
+#if ACQ_TUNE_ENABLE
+static uint8_t tune_saved_bits = 12U; // resolution before a tuning run
+static uint8_t tune_at_boot = 0;      // nothing saved: tune once running
+#endif
+static uint8_t stream_flush = 0;
+static uint32_t stream_packets = 0;    // stamped stream packets sent ...
+static uint64_t stream_span_ticks = 0; // ... and their oldest-newest spans
+static uint8_t quality_channel = QUALITY_IDLE; // input of the "quality" capture
+static uint8_t quality_switched = 0; // ... taken out of the running scan
+static uint32_t switch_announced = 0; // captures marked in the stream
+static uint32_t burst_offset = 0; // next burst sample to send
+static uint8_t burst_draining = 0; // burst full, the scan back, sending
+static ADC_TriggerSnapshot_t snapshot; // "snapshot": pinned in the history
+static uint32_t snapshot_sent = 0;     // ... frames of it sent
+#if ADC_TRIGGER_RETAIN_ENABLE
+static uint8_t snapshot_recovered = 0; // kept across the reset: 1 = to tell
+#endif
+#if QSPI_REC_ROLLUP_ENABLE
+static QspiRec_RollupQuery_t rollup_query; // "rollup": range being sent
+static QspiRec_Rollup_t rollup_record;     // ... record going out
+static uint8_t rollup_channel = 0;         // ... its next channel
+static uint8_t rollup_active = 0;
+static uint32_t rollup_sent = 0;           // ... records sent
+#endif
+static char expr_edit[TRIGGER_EXPR_TEXT_MAX]; // "expr +" text being typed
+static char expr_text[TRIGGER_EXPR_TEXT_MAX]; // installed, "" = none, saved
+static TriggerExpr_t trigger_expr;            // its program, in the engine
+static volatile uint32_t expr_rate_hz = ADC_FRAME_RATE_HZ; // its hold's rate
+_Static_assert(TRIGGER_EXPR_TEXT_MAX <= CONFIG_STORE_VALUE_MAX,
+               "the expression text is one config value");
+static TelemetryFrame_Exception_t report_state;
+#if PWM_SYNC_ENABLE
+static int32_t pwm_phase_ns = PWM_SYNC_PHASE_NS;
+#endif
+// Grouped scan: hand-off time of each group, and how far ahead of its
+// frame's last group it came, summed over the frames
+static uint64_t group_stamp[ADC_CONVERSIONS_CHANNEL_COUNT];
+static uint64_t group_lead[ADC_CONVERSIONS_CHANNEL_COUNT];
+static uint32_t group_frames = 0;
+static uint8_t group_size = 0; // of the last start, 0 = none yet
+#if MODBUS_SERVER_ENABLE
+// Modbus register map: the fields themselves, read and written in place
+#define MODBUS_NOTIFY_REPORT 0x01U  // report_mode written
+#define MODBUS_NOTIFY_CAPTURE 0x02U // capture_enabled written
+#define MODBUS_NOTIFY_SETTING 0x04U // another saved setting written
+#define MODBUS_FEATURE(addr, kind, field)                                      \
+  {.address = (addr), .type = (kind), .count = VIBRATION_CHANNELS,             \
+   .stride = sizeof(vibration[0]), .data = &vibration[0].result.field}
+#define MODBUS_BASELINE(addr, kind, field)                                     \
+  {.address = (addr), .type = (kind), .count = VIBRATION_CHANNELS,             \
+   .stride = sizeof(baseline[0]), .data = &baseline[0].field}
+#define MODBUS_SETTING(addr, var, hi, bit)                                     \
+  {.address = (addr), .type = MODBUS_RTU_U8, .count = 1U, .data = &(var),      \
+   .min = 0, .max = (hi), .notify = (bit)}
+_Static_assert(VIBRATION_CHANNELS <= 5U,
+               "a 32-bit field of each vibration channel in 10 registers");
+static const ModbusRtu_Region_t modbus_input[] = {
+    {.address = 0U, .type = MODBUS_RTU_U32, .count = 1U,
+     .data = &scan_rate_hz},
+    MODBUS_FEATURE(100U, MODBUS_RTU_U32, sequence),
+    MODBUS_FEATURE(110U, MODBUS_RTU_F32, peak_hz),
+    MODBUS_FEATURE(120U, MODBUS_RTU_F32, peak_amplitude),
+    MODBUS_FEATURE(130U, MODBUS_RTU_F32, rms),
+    MODBUS_BASELINE(140U, MODBUS_RTU_U8, alarm),
+    MODBUS_BASELINE(150U, MODBUS_RTU_U8, worst_band),
+    MODBUS_BASELINE(160U, MODBUS_RTU_F32, score)};
+static const ModbusRtu_Region_t modbus_holding[] = {
+    MODBUS_SETTING(0U, report_mode, REPORT_SCORE, MODBUS_NOTIFY_REPORT),
+    MODBUS_SETTING(1U, capture_enabled, 1, MODBUS_NOTIFY_CAPTURE),
+    MODBUS_SETTING(2U, feature_cbor, 1, MODBUS_NOTIFY_SETTING),
+    MODBUS_SETTING(3U, baseline_gate, 1, MODBUS_NOTIFY_SETTING)};
+static const ModbusRtu_Map_t modbus_map = {
+    .address = MODBUS_SERVER_ADDRESS,
+    .input = modbus_input,
+    .input_count = sizeof(modbus_input) / sizeof(modbus_input[0]),
+    .holding = modbus_holding,
+    .holding_count = sizeof(modbus_holding) / sizeof(modbus_holding[0])};
+#endif
+/* USER CODE END PV */
+
+/* Private function prototypes -----------------------------------------------*/
+void SystemClock_Config(void);
+static void MPU_Config(void);
+/* USER CODE BEGIN PFP */
+static uint16_t App_StreamDecimation(uint16_t base);
+static void App_AnnounceDegrade(uint32_t first_frame, uint16_t decimation);
+static void App_SendSamples(const TelemetryFrame_Batch_t *b,
+                            Telemetry_Class_t cls, uint64_t origin);
+#if !DSP_VECTOR_STREAM_ENABLE
+static void App_SendAscii(const ADC_RingEntry_t *entry);
+#endif
+static void App_ReportPreset(void);
+#if ADC_MUX_ENABLE
+static void App_ReportMux(void);
+#endif
+static void App_ReportMemory(void);
+static void App_ReportEnergy(void);
+/* USER CODE END PFP */
+
+/* Private user code ---------------------------------------------------------*/
+/* USER CODE BEGIN 0 */
+/**
+  * @brief Stages that must see every block before the DMA refills it:
+  *        trigger history, order tracking, Ethernet and the recorders
+  */
+static void App_AcquireBlock(const uint16_t *block, uint32_t frame_count)
+{
+  adcTrigger_process(block, frame_count, analogSensor_getBlockChannelMap());
+#if ADC_MUX_ENABLE
+  adcMux_processBlock(block, frame_count, analogSensor_getBlockChannelMap());
+#endif
+#if DIGITAL_IN_ENABLE
+  digitalIn_processBlock(frame_count);
+#endif
+#if TACH_ENABLE
+  // Needs the stamp of this very block, before the next one replaces it
+  ADC_BlockInfo_t info;
+  if ((block_stages & STAGE_ORDER) &&
+      analogSensor_getBlockInfo(&info) == HAL_OK) {
+    dspOrder_process(&order, block, frame_count, &info);
+  }
+#endif
+#if ADAPTIVE_RATE_ENABLE
+  adaptiveRate_processBlock(block, frame_count);
+#endif
+#if ADC_SUPPLY_ENABLE
+  adcSupply_processBlock(frame_count);
+#endif
+#if ETH_STREAM_ENABLE
+  ethStream_sendBlock(block, frame_count);
+#endif
+  // A replay must not overwrite the recordings it may be playing, nor
+  // count as frames acquired
+  if (!adcReplay_isActive()) {
+    energyMeter_addFrames(frame_count);
+    sdLogger_pushBlock(block, frame_count);
+    qspiRec_pushBlock(block, frame_count);
+  }
+  swoTrace_pushBlock(block, frame_count);
+#if DAC_LOOPBACK_ENABLE
+  // Last, so the self-test reaction comes after everything above
+  dacLoop_processBlock(block, frame_count);
+#endif
+}
+
+/**
+  * @brief Channels with a clipped sample in a block: from its pool stamp,
+  *        or the newest block's when the DMA is not on the pool
+  */
+static ADC_ChannelMask_t App_BlockClipped(const uint16_t *block)
+{
+  const BlockPool_Block_t *pooled = blockPool_fromData(block);
+  if (pooled != NULL) {
+    return pooled->info.clipped;
+  }
+  ADC_BlockInfo_t info;
+  return (analogSensor_getBlockInfo(&info) == HAL_OK) ? info.clipped : 0U;
+}
+
+/**
+  * @brief Arrival of a block on the timebase, found the same way
+  */
+static uint64_t App_BlockArrival(const uint16_t *block)
+{
+  const BlockPool_Block_t *pooled = blockPool_fromData(block);
+  if (pooled != NULL) {
+    return pooled->info.timestamp;
+  }
+  ADC_BlockInfo_t info;
+  return (analogSensor_getBlockInfo(&info) == HAL_OK) ? info.timestamp
+                                                      : timebase_now();
+}
+
+/**
+  * @brief Block stages the deadline monitor has shed
+  */
+static uint8_t App_ShedStages(void)
+{
+  const uint32_t shed = stageDeadline_getShed(&deadlines);
+  uint8_t bits = 0;
+  for (uint8_t i = 0; i < DEADLINE_COUNT; i++) {
+    if ((shed >> i) & 1U) {
+      bits |= deadline_stage_bits[i];
+    }
+  }
+  return bits;
+}
+
+/**
+  * @brief Signal processing of a block: oversampling, stream filter,
+  *        spectrum and envelope input, then the block subscribers
+  */
+static void App_ProcessBlock(const uint16_t *block, uint32_t frame_count)
+{
+  if (!first_block_marked) {
+    bootProfile_mark(BOOT_PHASE_FIRST_BLOCK);
+    first_block_marked = 1;
+  }
+  if (App_BlockClipped(block) != 0U) {
+    clipped_blocks++;
+    stream_clipped = 1;
+  }
+  const uint64_t arrival = App_BlockArrival(block);
+  latencyHist_recordTicks(LATENCY_HIST_DMA_CONSUMER, timebase_now() - arrival);
+  stageDeadline_begin(&deadlines, arrival);
+  dspDcTrack_process(&dc_track, block, frame_count);
+#if DSP_WINDOW_ENABLE
+  dspWindow_process(&sliding, block, frame_count);
+#endif
+  dspOversample_process(&oversampler, block, frame_count);
+  dspFilter_process(&stream_filter, block, frame_count);
+  // Under overload the optional stages go first, the data paths stay
+  const uint8_t stages = block_stages & (uint8_t)~App_ShedStages();
+  if (stages & STAGE_SPECTRUM) {
+    dwtCounters_begin(DEADLINE_SPECTRUM);
+    for (uint8_t i = 0; i < VIBRATION_CHANNELS; i++) {
+      dspSpectrum_process(&vibration[i], block, frame_count);
+    }
+    dwtCounters_end(DEADLINE_SPECTRUM);
+    stageDeadline_done(&deadlines, DEADLINE_SPECTRUM);
+  }
+  if (stages & STAGE_ENVELOPE) {
+    dwtCounters_begin(DEADLINE_ENVELOPE);
+    pipeline_run(&envelope_pipeline, block, frame_count);
+    dwtCounters_end(DEADLINE_ENVELOPE);
+    stageDeadline_done(&deadlines, DEADLINE_ENVELOPE);
+  }
+  if (stages & STAGE_DISPLAY) {
+    dwtCounters_begin(DEADLINE_DISPLAY);
+    pipeline_run(&display_pipeline, block, frame_count);
+    dwtCounters_end(DEADLINE_DISPLAY);
+    stageDeadline_done(&deadlines, DEADLINE_DISPLAY);
+  }
+  if (stages & STAGE_HARMONICS) {
+    dwtCounters_begin(DEADLINE_HARMONICS);
+    dspGoertzel_process(&harmonics, block, frame_count);
+    dwtCounters_end(DEADLINE_HARMONICS);
+    stageDeadline_done(&deadlines, DEADLINE_HARMONICS);
+  }
+  if (stages & STAGE_VELOCITY) {
+    dwtCounters_begin(DEADLINE_VELOCITY);
+    dspVelocity_process(&velocity, block, frame_count);
+    dwtCounters_end(DEADLINE_VELOCITY);
+    stageDeadline_done(&deadlines, DEADLINE_VELOCITY);
+  }
+  if (stages & STAGE_HISTOGRAM) {
+    dwtCounters_begin(DEADLINE_HISTOGRAM);
+    dspHistogram_process(&histogram, block, frame_count);
+    dwtCounters_end(DEADLINE_HISTOGRAM);
+    stageDeadline_done(&deadlines, DEADLINE_HISTOGRAM);
+  }
+  dspRainflow_process(&rainflow, block, frame_count); // rainflow_mask only
+  analogSensor_dispatchBlock(block, frame_count);
+}
+
+/**
+  * @brief DMA block hand-off (ISR): every block stage, superloop build
+  */
+static void App_BlockReady(const uint16_t *block, uint32_t frame_count,
+                           void *ctx)
+{
+  uint32_t t0 = profiler_begin();
+  UNUSED(ctx);
+  // The stream task pops the ring, fast start or not
+  appSched_signal(APP_SCHED_EVENT_BLOCK);
+  if (!app_running) {
+    return; // fast start: the frames are in the ring, the stages not ready
+  }
+  App_ProcessBlock(block, frame_count);
+  dwtCounters_begin(DEADLINE_RECORD);
+  App_AcquireBlock(block, frame_count);
+  dwtCounters_end(DEADLINE_RECORD);
+  stageDeadline_done(&deadlines, DEADLINE_RECORD);
+  stageDeadline_end(&deadlines);
+  profiler_end(PROFILER_PROBE_FILTER, t0);
+}
+
+#if EXT_ADC_ENABLE
+/**
+  * @brief SPI ADC block hand-off (ISR): every EXT_STREAM_DECIMATION-th
+  *        frame of the external channels into the filling batch
+  */
+static void App_ExtBlockReady(const ExtAdc_Block_t *block, void *ctx)
+{
+  const uint32_t per_packet = TELEMETRY_FRAME_EXT_SAMPLES / EXT_ADC_CHANNELS;
+  UNUSED(ctx);
+
+  const uint32_t first = block->info.first_frame;
+  uint32_t f = (EXT_STREAM_DECIMATION - first % EXT_STREAM_DECIMATION) %
+               EXT_STREAM_DECIMATION;
+  for (; f < block->info.frame_count; f += EXT_STREAM_DECIMATION) {
+    TelemetryFrame_External_t *b = &ext_batch[ext_active];
+    if (b->frame_count == 0U) {
+      b->first_frame = first + f;
+      b->timestamp = HAL_GetTick();
+      b->stride = EXT_STREAM_DECIMATION;
+      b->channel_count = EXT_ADC_CHANNELS;
+    }
+    for (uint8_t ch = 0; ch < EXT_ADC_CHANNELS; ch++) {
+      b->samples[b->frame_count * EXT_ADC_CHANNELS + ch] =
+          extAdc_getSample(block, f, ch);
+    }
+    if (++b->frame_count < per_packet) {
+      continue;
+    }
+    if (ext_pending) {
+      ext_dropped++; // the last one is still unsent: refill this one
+      b->frame_count = 0;
+      continue;
+    }
+    ext_active ^= 1U;
+    ext_batch[ext_active].frame_count = 0;
+    ext_pending = 1;
+    appSched_signal(APP_SCHED_EVENT_BLOCK);
+  }
+}
+
+/**
+  * @brief Send the full external batch, if any
+  */
+static void App_SendExternal(void)
+{
+  uint8_t packet[TELEMETRY_FRAME_ENCODED_MAX];
+  uint16_t packet_len = 0;
+
+  if (!ext_pending) {
+    return;
+  }
+  if (telemetryFrame_encodeExternal(&ext_batch[ext_active ^ 1U], packet,
+                                    sizeof(packet), &packet_len) == HAL_OK) {
+    telemetry_sendClass(packet, packet_len, TELEMETRY_CLASS_BULK);
+  }
+  ext_pending = 0;
+}
+#endif
+
+/**
+  * @brief Send the impact arrival times of a capture
+  * @retval HAL_OK when sent (or no channel saw an onset), HAL_BUSY when the
+  *         TX queue has no room yet
+  */
+static HAL_StatusTypeDef App_SendArrival(const ADC_TriggerEvent_t *event,
+                                         const ADC_Frame_t *frames)
+{
+  static DSP_ArrivalResult_t res;
+  const DSP_ArrivalConfig_t cfg = {.threshold_sigma = ARRIVAL_SIGMA,
+                                   .min_threshold_codes = ARRIVAL_MIN_CODES,
+                                   .mask = TELEMETRY_FRAME_ALL_CHANNELS};
+  uint8_t packet[TELEMETRY_FRAME_ENCODED_MAX];
+  uint16_t packet_len = 0;
+
+  if (telemetry_getClassFreeSlots(TELEMETRY_CLASS_ALARM) == 0U) {
+    return HAL_BUSY;
+  }
+  // The older half of the pre-trigger history is the baseline
+  if (dspArrival_compute(&cfg, frames, event->frame_count,
+                         event->pre_frames / 2U, &res) != HAL_OK) {
+    return HAL_OK;
+  }
+
+  // Frame times on the timebase, at the measured period over the capture
+  const uint32_t last = event->first_frame + event->frame_count - 1U;
+  const uint64_t t0 = analogSensor_getFrameTime(event->first_frame);
+  const uint64_t t1 = analogSensor_getFrameTime(last);
+  const float32_t period_us =
+      (t0 != 0U && t1 > t0)
+          ? (float32_t)timebase_toMicros(t1 - t0) /
+                (float32_t)(event->frame_count - 1U)
+          : 1.0e6f / (float32_t)analogSensor_getSampleRate();
+  TelemetryFrame_Arrival_t pkt = {
+      .trigger_frame = event->trigger_frame,
+      .timestamp = event->timestamp,
+      .first_channel = res.first_channel,
+      .first_us = timebase_toMicros(t0) +
+                  (uint64_t)lrintf(res.first_frame * period_us),
+      .frame_period_us = period_us,
+      .position_m = NAN,
+      .channel_mask = res.detected};
+  for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+    pkt.delta_us[ch] = res.delta_frames[ch] * period_us;
+    pkt.threshold_codes[ch] = res.threshold_codes[ch];
+  }
+  const ADC_ChannelMask_t pair = (ADC_ChannelMask_t)(
+      (1U << ARRIVAL_PAIR_A) | (1U << ARRIVAL_PAIR_B));
+  if (ARRIVAL_SPEED_M_S > 0.0f && (res.detected & pair) == pair) {
+    pkt.position_m = dspArrival_locateLine(
+        pkt.delta_us[ARRIVAL_PAIR_A] - pkt.delta_us[ARRIVAL_PAIR_B],
+        ARRIVAL_SPACING_M, ARRIVAL_SPEED_M_S);
+  }
+  if (telemetryFrame_encodeArrival(&pkt, packet, sizeof(packet),
+                                   &packet_len) == HAL_OK) {
+    telemetry_sendClass(packet, packet_len, TELEMETRY_CLASS_ALARM);
+  }
+  return HAL_OK;
+}
+
+/**
+  * @brief Send the shock response spectrum of one channel of a capture
+  * @retval HAL_OK when sent (or the channel has no spectrum), HAL_BUSY when
+  *         the TX queue has no room yet
+  */
+static HAL_StatusTypeDef App_SendSrs(const ADC_TriggerEvent_t *event,
+                                     const ADC_Frame_t *frames,
+                                     uint8_t channel)
+{
+  static DSP_SrsResult_t res;
+  uint8_t packet[TELEMETRY_FRAME_ENCODED_MAX];
+  uint16_t packet_len = 0;
+
+  if (telemetry_getClassFreeSlots(TELEMETRY_CLASS_CONTROL) == 0U) {
+    return HAL_BUSY;
+  }
+  const float32_t rate = (float32_t)analogSensor_getSampleRate();
+  if (srs_bank.sample_rate_hz != rate &&
+      dspSrs_init(&srs_bank, rate, SRS_FIRST_HZ, SRS_LAST_HZ, SRS_PER_OCTAVE,
+                  SRS_Q) != HAL_OK) {
+    return HAL_OK; // a rate too low for the first frequency
+  }
+  if (dspSrs_compute(&srs_bank, frames, event->frame_count, channel,
+                     event->pre_frames, ADC_CAL_NOMINAL_MG_PER_CODE,
+                     &res) != HAL_OK) {
+    return HAL_OK;
+  }
+  TelemetryFrame_Srs_t pkt = {
+      .trigger_frame = event->trigger_frame,
+      .timestamp = event->timestamp,
+      .channel = channel,
+      .per_octave = srs_bank.per_octave,
+      .freq_count = res.count,
+      .first_hz = srs_bank.fn_hz[0],
+      .q = srs_bank.q,
+      .input_peak_mg = res.input_peak_mg};
+  _Static_assert(DSP_SRS_MAX_FREQS <= TELEMETRY_FRAME_SRS_FREQS,
+                 "a whole spectrum must fit one SRS packet");
+  memcpy(pkt.peak_mg, res.peak_mg, res.count * sizeof(res.peak_mg[0]));
+  if (telemetryFrame_encodeSrs(&pkt, packet, sizeof(packet), &packet_len) ==
+      HAL_OK) {
+    telemetry_sendClass(packet, packet_len, TELEMETRY_CLASS_CONTROL);
+  }
+  return HAL_OK;
+}
+
+/**
+  * @brief Send a frozen trigger capture as far as the TX queue allows,
+  *        then re-arm the trigger
+  * @retval 1 while a capture is being sent, 0 otherwise
+  */
+static uint8_t App_SendCapture(void)
+{
+  static int32_t frames_sent = -1; // -1 = event packet not sent yet
+  static uint8_t srs_sent = 0;     // channels whose SRS has gone
+  static uint8_t arrival_sent = 0; // arrival packet gone
+  const ADC_TriggerEvent_t *event;
+  const ADC_Frame_t *frames;
+  uint8_t packet[TELEMETRY_FRAME_ENCODED_MAX];
+  uint16_t packet_len = 0;
+
+  if (adcTrigger_getCapture(&event, &frames) != HAL_OK) {
+    return 0;
+  }
+
+  if (frames_sent < 0) {
+    const TelemetryFrame_Event_t info = {
+        .trigger_frame = event->trigger_frame,
+        .timestamp = event->timestamp,
+        .channel = event->channel,
+        .condition = (uint8_t)event->condition,
+        .value = event->value,
+        .pre_frames = event->pre_frames,
+        .frame_count = event->frame_count,
+        .first_frame = event->first_frame};
+    if (telemetry_getClassFreeSlots(TELEMETRY_CLASS_ALARM) == 0U ||
+        telemetryFrame_encodeEvent(&info, packet, sizeof(packet),
+                                   &packet_len) != HAL_OK) {
+      return 1;
+    }
+    telemetry_sendClass(packet, packet_len, TELEMETRY_CLASS_ALARM);
+    frames_sent = (srs_mode == SRS_ONLY) ? (int32_t)event->frame_count : 0;
+    srs_sent = (srs_mode == SRS_OFF) ? VIBRATION_CHANNELS : 0U;
+    arrival_sent = 0;
+#if ADAPTIVE_RATE_ENABLE
+    adaptiveRate_wake(); // an event is worth the full rate
+#endif
+    // Black-box copy; fails quietly when no flash is fitted
+    qspiRec_commitCapture(event, frames);
+  }
+
+  // Arrival times right behind the event, the deltas needed to locate it
+  if (!arrival_sent) {
+    arrival_sent = (App_SendArrival(event, frames) == HAL_OK) ? 1U : 0U;
+    return 1;
+  }
+
+  // One channel's SRS per pass: a few ms of the main loop each
+  if (srs_sent < VIBRATION_CHANNELS) {
+    if (App_SendSrs(event, frames, srs_sent) == HAL_OK) {
+      srs_sent++;
+    }
+    return 1;
+  }
+
+  // Raw 4 kHz frames, one sequence number apart; keep a slot for status
+  while (frames_sent < (int32_t)event->frame_count &&
+         telemetry_getFreeSlots() > 1U) {
+    TelemetryFrame_Batch_t batch;
+    ADC_RingEntry_t entry = {.timestamp = event->timestamp};
+    telemetryFrame_initBatch(&batch, TELEMETRY_FRAME_ALL_CHANNELS);
+    while (frames_sent < (int32_t)event->frame_count &&
+           !telemetryFrame_isFull(&batch)) {
+      entry.frame = frames[frames_sent];
+      entry.sequence = event->first_frame + (uint32_t)frames_sent;
+      telemetryFrame_addFrame(&batch, &entry);
+      frames_sent++;
+    }
+    App_SendSamples(&batch, TELEMETRY_CLASS_CONTROL, 0U);
+  }
+
+  // The capture stays frozen until the link has its arrivals, spectra and
+  // frames, and the flash has it
+  if (frames_sent < (int32_t)event->frame_count || qspiRec_isCommitting()) {
+    return 1;
+  }
+  frames_sent = -1;
+  swoTrace_marker(SWO_TRACE_MARK_CAPTURE, event->first_frame);
+  if (capture_enabled) {
+    adcTrigger_arm();
+    analogSensor_armWatchdog();
+  }
+  return 0;
+}
+
+/**
+  * @brief Count a stamped stream packet for the PRESET line, with the time
+  *        from its oldest frame to its newest
+  */
+static void App_CountPacket(uint32_t oldest, uint32_t newest)
+{
+  stream_packets++;
+  stream_span_ticks +=
+      analogSensor_getFrameTime(newest) - analogSensor_getFrameTime(oldest);
+}
+
+/**
+  * @brief Add one full-rate frame to the run being compressed
+  */
+static void App_CodecAdd(const ADC_RingEntry_t *entry)
+{
+  uint8_t r = codec_active;
+  if (codec_fill != 0U && entry->sequence != codec_first[r] + codec_fill) {
+    codec_fill = 0; // ring overflow: a run covers consecutive frames only
+  }
+  if (codec_fill == 0U) {
+    codec_first[r] = entry->sequence;
+    codec_time[r] = entry->timestamp;
+  }
+  codec_frames[r][codec_fill] = entry->frame;
+  if (++codec_fill < CODEC_RUN_FRAMES) {
+    return;
+  }
+  // A run still pending is overwritten: the host sees the gap in first_frame
+  codec_pending = 1;
+  codec_channel = 0;
+  codec_active ^= 1U;
+  codec_fill = 0;
+}
+
+/**
+  * @brief Send the pending run, one compressed packet per channel, as far
+  *        as the bulk TX class allows
+  */
+static void App_SendCodec(void)
+{
+  const ADC_Frame_t *run = codec_frames[codec_active ^ 1U];
+  const uint32_t first = codec_first[codec_active ^ 1U];
+  const uint32_t newest = first + CODEC_RUN_FRAMES - 1U;
+  uint8_t data[SAMPLE_CODEC_MAX_BYTES(CODEC_RUN_FRAMES)];
+
+  while (codec_pending &&
+         telemetry_getClassFreeSlots(TELEMETRY_CLASS_BULK) > 0U) {
+    uint8_t ch = codec_channel;
+    uint32_t len = 0;
+    uint32_t t0 = profiler_begin();
+    const uint16_t max_error = codec_error;
+    HAL_StatusTypeDef status =
+        (max_error != 0U)
+            ? waveletCodec_encode(&run[0].samples[ch], CODEC_RUN_FRAMES,
+                                  sizeof(ADC_Frame_t) / sizeof(uint16_t),
+                                  max_error, data, sizeof(data), &len)
+            : sampleCodec_encode(&run[0].samples[ch], CODEC_RUN_FRAMES,
+                                 sizeof(ADC_Frame_t) / sizeof(uint16_t), data,
+                                 sizeof(data), &len);
+    profiler_record(PROFILER_PROBE_CODEC,
+                    (profiler_now() - t0) / CODEC_RUN_FRAMES);
+
+    TelemetryFrame_Compressed_t info = {
+        .first_frame = first,
+        .timestamp = codec_time[codec_active ^ 1U],
+        .channel = ch,
+        .frame_count = CODEC_RUN_FRAMES,
+        .max_error = max_error,
+        .data = data,
+        .length = (uint16_t)len};
+    for (uint32_t f = 0; f < CODEC_RUN_FRAMES; f++) {
+      info.error_count += (run[f].error_mask >> ch) & 1U;
+    }
+    // Encoded in the TX slot, stamped with the run's newest frame
+    uint8_t *out = (status == HAL_OK)
+                       ? telemetry_reserve(TELEMETRY_CLASS_BULK,
+                                           TELEMETRY_FRAME_CODEC_ENCODED_MAX)
+                       : NULL;
+    uint16_t out_len = 0;
+    if (out != NULL) {
+      if (telemetryFrame_encodeCompressed(&info, out,
+                                          TELEMETRY_FRAME_CODEC_ENCODED_MAX,
+                                          &out_len) != HAL_OK) {
+        out_len = 0;
+      }
+      if (telemetry_commitStamped(out_len, analogSensor_getFrameTime(newest)) ==
+              HAL_OK &&
+          out_len != 0U) {
+        App_CountPacket(first, newest);
+      }
+    }
+    if (++codec_channel == ADC_CONVERSIONS_CHANNEL_COUNT) {
+      codec_pending = 0;
+    }
+  }
+}
+
+#if TDMA_BUS_ENABLE
+#if TDMA_BUS_ADDRESS != 0
+/**
+  * @brief Add one full-rate frame to the node's sample packet; a full one
+  *        is encoded straight into the next slot frame
+  */
+static void App_TdmaAdd(const ADC_RingEntry_t *entry)
+{
+  telemetryFrame_addFrame(&tdma_batch, entry);
+  if (!telemetryFrame_isFull(&tdma_batch)) {
+    return;
+  }
+  uint8_t *out = tdmaBus_reserve(TELEMETRY_FRAME_SAMPLES_ENCODED_MAX);
+  uint16_t out_len = 0;
+  if (out != NULL &&
+      telemetryFrame_encodeSamples(&tdma_batch, out,
+                                   TELEMETRY_FRAME_SAMPLES_ENCODED_MAX,
+                                   &out_len) != HAL_OK) {
+    out_len = 0;
+  }
+  if (out != NULL) {
+    tdmaBus_commit(out_len);
+  }
+  telemetryFrame_initBatch(&tdma_batch, TELEMETRY_FRAME_ALL_CHANNELS);
+}
+#else
+/**
+  * @brief A node's slot payload (bus master, main loop): pass it to the
+  *        host in relay packets
+  */
+static void App_TdmaFrame(uint8_t node, uint32_t cycle, const uint8_t *payload,
+                          uint16_t len, void *ctx)
+{
+  UNUSED(ctx);
+  TelemetryFrame_Relay_t relay = {
+      .cycle = cycle, .timestamp = HAL_GetTick(), .node = node};
+  for (uint16_t off = 0; off < len; off += relay.count) {
+    const uint16_t left = (uint16_t)(len - off);
+    relay.count = (uint8_t)((left > TELEMETRY_FRAME_RELAY_BYTES)
+                                ? TELEMETRY_FRAME_RELAY_BYTES
+                                : left);
+    relay.offset = off;
+    relay.data = &payload[off];
+    uint8_t *out =
+        telemetry_reserve(TELEMETRY_CLASS_BULK, TELEMETRY_FRAME_ENCODED_MAX);
+    if (out == NULL) {
+      return; // counted as dropped; the host resyncs on the next slot
+    }
+    uint16_t out_len = 0;
+    if (telemetryFrame_encodeRelay(&relay, out, TELEMETRY_FRAME_ENCODED_MAX,
+                                   &out_len) != HAL_OK) {
+      out_len = 0;
+    }
+    (void)telemetry_commit(out_len);
+  }
+}
+#endif
+#endif
+
+/**
+  * @brief Link rate / flow control commands received on USART3
+  */
+static void App_LinkCommand(uint8_t cmd)
+{
+  Telemetry_LinkInfo_t link;
+  telemetry_getLink(&link);
+  Telemetry_LinkConfig_t cfg = {.baud_rate = link.baud_rate,
+                                .flow_control = link.flow_control};
+
+  if (cmd >= LINK_RATE_CMD &&
+      cmd < LINK_RATE_CMD + sizeof(link_rates) / sizeof(link_rates[0])) {
+    cfg.baud_rate = link_rates[cmd - LINK_RATE_CMD];
+    if (!link.confirmed && cfg.baud_rate == link.baud_rate) {
+      // Arrived intact at the new setting: the host follows
+      telemetry_confirmLink();
+      return;
+    }
+  } else if (cmd == LINK_FLOW_CMD) {
+    cfg.flow_control = !link.flow_control;
+  } else {
+    return;
+  }
+  telemetry_setLink(&cfg);
+}
+
+/**
+  * @brief Packet buffer for the DSP stage: a pool buffer handed to the comms
+  *        task in the RTOS build, a static one sent on commit otherwise
+  */
+static uint8_t *App_ReservePacket(void)
+{
+#if APP_RTOS_ENABLE
+  return appRtos_reservePacket();
+#else
+  return dsp_packet;
+#endif
+}
+
+/**
+  * @brief Send a buffer from App_ReservePacket() in a TX class; len 0
+  *        releases it
+  */
+static void App_CommitPacket(uint8_t *buf, uint16_t len, Telemetry_Class_t cls)
+{
+  if (buf != NULL && len != 0U) {
+    energyMeter_addMessages(1);
+  }
+#if APP_RTOS_ENABLE
+  appRtos_commitPacket(buf, len, cls);
+#else
+  if (buf != NULL && len != 0U) {
+    telemetry_sendClass(buf, len, cls);
+  }
+#endif
+}
+
+/**
+  * @brief Pipeline_Display_t sink: one display packet through the DSP
+  *        packet path
+  */
+static HAL_StatusTypeDef App_DisplaySink(const uint8_t *data, uint16_t len)
+{
+  uint8_t *out = App_ReservePacket();
+  if (out == NULL) {
+    return HAL_BUSY;
+  }
+  memcpy(out, data, len);
+  App_CommitPacket(out, len, TELEMETRY_CLASS_BULK);
+  return HAL_OK;
+}
+
+/**
+  * @brief Encode a samples packet in place in the UART queue: no staging
+  *        buffer, no copy; origin times live data to the wire (0 = not
+  *        timed)
+  */
+static void App_SendSamples(const TelemetryFrame_Batch_t *b,
+                            Telemetry_Class_t cls, uint64_t origin)
+{
+  uint32_t t0 = profiler_begin();
+  uint8_t *out = telemetry_reserve(cls, TELEMETRY_FRAME_SAMPLES_ENCODED_MAX);
+  uint16_t out_len = 0;
+  if (out != NULL &&
+      telemetryFrame_encodeSamples(b, out, TELEMETRY_FRAME_SAMPLES_ENCODED_MAX,
+                                   &out_len) != HAL_OK) {
+    out_len = 0;
+  }
+  profiler_end(PROFILER_PROBE_FORMAT, t0);
+
+  if (out != NULL) {
+    t0 = profiler_begin();
+    telemetry_commitStamped(out_len, origin);
+    profiler_end(PROFILER_PROBE_TRANSMIT, t0);
+  }
+}
+
+#if !DSP_VECTOR_STREAM_ENABLE
+/**
+  * @brief Send the stream batch stamped with its newest frame, counted for
+  *        the PRESET line, and start the next one
+  */
+static void App_SendStream(uint32_t newest)
+{
+  App_CountPacket(batch.first_sequence, newest);
+  App_SendSamples(&batch, TELEMETRY_CLASS_BULK,
+                  analogSensor_getFrameTime(newest));
+  telemetryFrame_initBatch(&batch, stream_mask);
+}
+
+/**
+  * @brief One frame as a text line in the UART queue:
+  *        "F <sequence> <code> ...[ C]\r\n", codes of the streamed channels
+  *        in 4 columns, C after clipped input
+  */
+static void App_SendAscii(const ADC_RingEntry_t *entry)
+{
+  uint32_t t0 = profiler_begin();
+  char *line = (char *)telemetry_reserve(TELEMETRY_CLASS_BULK, ASCII_LINE_MAX);
+  if (line == NULL) {
+    profiler_end(PROFILER_PROBE_FORMAT, t0);
+    return;
+  }
+  char *p = line;
+  *p++ = 'F';
+  *p++ = ' ';
+  p += textFormat_u32(p, entry->sequence);
+  for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+    if ((stream_mask >> ch) & 1U) {
+      *p++ = ' ';
+      p += textFormat_u32Width(p, entry->frame.samples[ch], 4U);
+    }
+  }
+  if ((entry->flags & ADC_RING_FLAG_CLIPPED) != 0U) {
+    *p++ = ' ';
+    *p++ = 'C';
+  }
+  *p++ = '\r';
+  *p++ = '\n';
+  profiler_end(PROFILER_PROBE_FORMAT, t0);
+
+  t0 = profiler_begin();
+  telemetry_commit((uint16_t)(p - line));
+  profiler_end(PROFILER_PROBE_TRANSMIT, t0);
+}
+#endif
+
+#if DSP_VECTOR_STREAM_ENABLE || ADC_SUPPLY_ENABLE
+/**
+  * @brief 0.01 degree (of angle or of temperature), rounded
+  */
+static int16_t App_CentiDegrees(float32_t deg)
+{
+  return (int16_t)(deg * 100.0f + ((deg < 0.0f) ? -0.5f : 0.5f));
+}
+#endif
+
+#if DSP_VECTOR_STREAM_ENABLE
+/**
+  * @brief Filtered, decimated frames into vector packets: 2 magnitudes per
+  *        frame instead of 6 axes, tilt of the last frame of each packet
+  */
+static void App_StreamVector(const float32_t *filtered, uint32_t frames,
+                             uint32_t first_input)
+{
+  DSP_VectorSample_t v[DSP_VECTOR_CHUNK * DSP_VECTOR_GROUPS];
+  const uint16_t stride = stream_filter.output_decimation;
+
+  for (uint32_t k0 = 0; k0 < frames; k0 += DSP_VECTOR_CHUNK) {
+    const uint32_t n =
+        (frames - k0 < DSP_VECTOR_CHUNK) ? frames - k0 : DSP_VECTOR_CHUNK;
+    dspVector_compute(&stream_vector,
+                      &filtered[k0 * ADC_CONVERSIONS_CHANNEL_COUNT], n, v);
+
+    for (uint32_t k = 0; k < n; k++) {
+      const DSP_VectorSample_t *fv = &v[k * DSP_VECTOR_GROUPS];
+      if (vector_batch.frame_count == 0U) {
+        vector_batch.first_frame = first_input + (k0 + k + 1U) * stride - 1U;
+        vector_batch.timestamp = HAL_GetTick();
+        vector_batch.stride = stride;
+      }
+      for (uint8_t g = 0; g < DSP_VECTOR_GROUPS; g++) {
+        const float32_t mg = fv[g].magnitude + 0.5f;
+        vector_batch.magnitude_mg[vector_batch.frame_count][g] =
+            (mg >= 65535.0f) ? 65535U : (uint16_t)mg;
+      }
+      if (++vector_batch.frame_count < TELEMETRY_FRAME_MAX_FRAMES) {
+        continue;
+      }
+      for (uint8_t g = 0; g < DSP_VECTOR_GROUPS; g++) {
+        vector_batch.pitch_cdeg[g] = App_CentiDegrees(fv[g].pitch);
+        vector_batch.roll_cdeg[g] = App_CentiDegrees(fv[g].roll);
+      }
+
+      // Encoded in place in the UART queue
+      uint32_t t0 = profiler_begin();
+      uint8_t *out =
+          telemetry_reserve(TELEMETRY_CLASS_BULK, TELEMETRY_FRAME_ENCODED_MAX);
+      uint16_t out_len = 0;
+      if (out != NULL &&
+          telemetryFrame_encodeVector(&vector_batch, out,
+                                      TELEMETRY_FRAME_ENCODED_MAX,
+                                      &out_len) != HAL_OK) {
+        out_len = 0;
+      }
+      profiler_end(PROFILER_PROBE_FORMAT, t0);
+
+      if (out != NULL) {
+        const uint32_t newest = first_input + (k0 + k + 1U) * stride - 1U;
+        t0 = profiler_begin();
+        telemetry_commitStamped(out_len, analogSensor_getFrameTime(newest));
+        profiler_end(PROFILER_PROBE_TRANSMIT, t0);
+      }
+
+      vector_batch.frame_count = 0;
+    }
+  }
+}
+#endif
+
+#if DSP_ASRC_ENABLE
+/**
+  * @brief Hand each new measured pulse to the stream's resampler: its
+  *        position among the free-running frames and the clock error
+  */
+static void App_SteerStream(void)
+{
+  TimeSync_Status_t sync;
+  timeSync_getStatus(&sync);
+  if (sync.pulses == asrc_pulses || sync.state != TIME_SYNC_MEASURING) {
+    return;
+  }
+  asrc_pulses = sync.pulses;
+  const uint32_t rate = analogSensor_getSampleRate();
+  const float frames_q32 = (float)rate * 4294967296.0f;
+  const int64_t offset =
+      (int64_t)((float)sync.phase_ns * 1.0e-9f * frames_q32);
+  dspAsrc_steer(&stream_asrc,
+                ((uint64_t)sync.pulse_frame << 32) + (uint64_t)offset,
+                sync.clock_ppm, rate / TIME_SYNC_PULSE_HZ);
+}
+#endif
+
+/**
+  * @brief Send the full USB batch
+  * @retval 1 if the batch was sent (or the frames in it lost), 0 if the
+  *         endpoint buffers are full and it waits
+  */
+static uint8_t App_FlushUsb(void)
+{
+  uint8_t *usb_packet = usbStream_reserve(TELEMETRY_FRAME_ENCODED_MAX);
+  if (usb_packet == NULL) {
+    return 0;
+  }
+  uint16_t usb_len = 0;
+  // The frames taken from the ring while this span was lent are whole
+  if (telemetryFrame_encodeSamples(&usb_batch, usb_packet,
+                                   TELEMETRY_FRAME_ENCODED_MAX,
+                                   &usb_len) == HAL_OK &&
+      adcRing_intactFor(usb_cursor)) {
+    usbStream_commit(usb_len);
+  } else {
+    usbStream_commit(0);
+  }
+  telemetryFrame_initBatch(&usb_batch, TELEMETRY_FRAME_ALL_CHANNELS);
+  return 1;
+}
+
+/**
+  * @brief Every frame to the USB stream, encoded in its endpoint buffers,
+  *        through the stream's own ring cursor: frames wait in the ring
+  *        while the buffers are full, and a host slow enough to be lapped
+  *        loses the oldest ones rather than holding the scan up
+  */
+static void App_StreamUsb(void)
+{
+  if (!usbStream_isOpen()) {
+    (void)adcRing_consumeFor(usb_cursor, adcRing_countFor(usb_cursor));
+    return;
+  }
+  const ADC_RingEntry_t *span;
+  uint32_t span_len;
+  while ((span_len = adcRing_peekFor(usb_cursor, &span,
+                                     ADC_RING_CAPACITY)) != 0U) {
+    if (adcRing_takeOverrun(usb_cursor)) {
+      // Frames were skipped: a batch holds consecutive ones only
+      telemetryFrame_initBatch(&usb_batch, TELEMETRY_FRAME_ALL_CHANNELS);
+    }
+    uint32_t i = 0;
+    while (i < span_len &&
+           (!telemetryFrame_isFull(&usb_batch) || App_FlushUsb())) {
+      telemetryFrame_addFrame(&usb_batch, &span[i]);
+      i++;
+    }
+    if (adcRing_consumeFor(usb_cursor, i) != HAL_OK) {
+      telemetryFrame_initBatch(&usb_batch, TELEMETRY_FRAME_ALL_CHANNELS);
+    }
+    if (i < span_len) {
+      return; // the rest when the endpoint has room
+    }
+  }
+  if (telemetryFrame_isFull(&usb_batch)) {
+    (void)App_FlushUsb();
+  }
+}
+
+/**
+  * @brief Frame ring, USB/Ethernet/SD/QSPI service and the telemetry stream
+  *        (captures, compressed runs or filtered frames)
+  */
+static void App_Stream(void)
+{
+  // Sample all channels using helper function (no-op in DMA mode)
+  analogSensor_operation_all_channels(ADC_CONVERSIONS_CHANNEL_COUNT);
+
+  // Keep the ring drained; the newest frame feeds the status packet.
+  // The frames are read in place, a span of ring slots at a time.
+  const ADC_RingEntry_t *span;
+  uint32_t span_len;
+  while ((span_len = adcRing_peek(&span, ADC_RING_CAPACITY)) != 0U) {
+    for (uint32_t i = 0; i < span_len; i++) {
+      const ADC_RingEntry_t *entry = &span[i];
+      if (codec_stream) {
+        App_CodecAdd(entry);
+      }
+#if TDMA_BUS_ENABLE && TDMA_BUS_ADDRESS != 0
+      App_TdmaAdd(entry);
+#endif
+    }
+    last_entry = span[span_len - 1U];
+    adcRing_consume(span_len);
+  }
+  App_StreamUsb();
+  usbStream_poll();
+#if ETH_STREAM_ENABLE
+  ethStream_poll();
+#endif
+  sdLogger_poll();
+  qspiRec_poll();
+#if I2C_TARGET_ENABLE
+  i2cTarget_update();
+#endif
+#if CAN_BUS_ENABLE
+  canBus_poll();
+#endif
+#if MODBUS_SERVER_ENABLE
+  modbusServer_poll();
+#endif
+#if TDMA_BUS_ENABLE
+  tdmaBus_poll();
+#endif
+#if EXT_ADC_ENABLE
+  App_SendExternal();
+#endif
+
+  // A trigger capture pre-empts the stream until it has been sent
+  uint8_t capture_busy = App_SendCapture();
+  if (capture_busy) {
+    telemetryFrame_initBatch(&batch, stream_mask);
+#if DSP_VECTOR_STREAM_ENABLE
+    vector_batch.frame_count = 0;
+#endif
+  } else if (codec_stream) {
+    App_SendCodec();
+  }
+
+  // Filtered, decimated frames into binary sample packets
+#if DSP_ASRC_ENABLE
+  App_SteerStream();
+#endif
+  const float32_t *filtered;
+  uint32_t filtered_frames;
+  uint32_t first_input;
+  HAL_StatusTypeDef output = dspFilter_getOutput(
+      &stream_filter, &filtered, &filtered_frames, &first_input);
+  if (output == HAL_OK && stream_degrade_announce &&
+      stream_filter.output_decimation ==
+          App_StreamDecimation(stream_base_decimation)) {
+    // First output at the back-pressure decimation: it starts at this block
+    App_AnnounceDegrade(first_input, stream_filter.output_decimation);
+    stream_degrade_announce = 0;
+  }
+  if (output == HAL_OK && !capture_busy && !codec_stream) {
+#if DSP_VECTOR_STREAM_ENABLE
+    App_StreamVector(filtered, filtered_frames, first_input);
+#else
+    // Clipped input since the previous output: flag the frames it spans
+    ADC_RingEntry_t entry = {.timestamp = HAL_GetTick(),
+                             .flags = stream_clipped ? ADC_RING_FLAG_CLIPPED
+                                                     : 0U};
+    stream_clipped = 0;
+    for (uint32_t k = 0; k < filtered_frames; k++) {
+      const float32_t *src = &filtered[k * ADC_CONVERSIONS_CHANNEL_COUNT];
+      for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+        float32_t v = src[ch] + 0.5f;
+        entry.frame.samples[ch] =
+            (v <= 0.0f) ? 0U : (v >= 4095.0f) ? 4095U : (uint16_t)v;
+      }
+      entry.sequence =
+          first_input + (k + 1U) * stream_filter.output_decimation - 1U;
+      if (ascii_stream) {
+        App_SendAscii(&entry);
+        continue;
+      }
+      telemetryFrame_addFrame(&batch, &entry);
+      if (telemetryFrame_isFull(&batch)) {
+        App_SendStream(entry.sequence);
+      }
+    }
+    // "preset latency": what this output added leaves now, not when full
+    if (stream_flush && batch.frame_count != 0U) {
+      App_SendStream(entry.sequence);
+    }
+#endif
+  }
+}
+
+/**
+  * @brief One coherence packet per channel pair for each finished average
+  */
+static void App_PollCoherence(void)
+{
+  DSP_CoherenceResult_t result;
+  if (dspCoherence_getResult(&coherence, &result) != HAL_OK) {
+    return;
+  }
+  for (uint8_t p = 0; p < result.pair_count; p++) {
+    TelemetryFrame_Coherence_t pair = {.sequence = result.sequence,
+                                       .timestamp = HAL_GetTick(),
+                                       .channel_x = result.pairs[p].x,
+                                       .channel_y = result.pairs[p].y,
+                                       .length = VIBRATION_FFT_LENGTH,
+                                       .averages = result.averages,
+                                       .freq_count = result.freq_count};
+    for (uint8_t f = 0; f < result.freq_count; f++) {
+      pair.hz[f] = result.hz[f];
+      pair.coherence[f] = result.coherence[p][f];
+      pair.phase_deg[f] = result.phase_deg[p][f];
+      pair.gain[f] = result.gain[p][f];
+    }
+    uint8_t *out = App_ReservePacket();
+    uint16_t out_len = 0;
+    if (out != NULL &&
+        telemetryFrame_encodeCoherence(&pair, out,
+                                       TELEMETRY_FRAME_ENCODED_MAX,
+                                       &out_len) != HAL_OK) {
+      out_len = 0;
+    }
+    App_CommitPacket(out, out_len, TELEMETRY_CLASS_CONTROL);
+  }
+}
+
+/**
+  * @brief Queue the learned baseline of vibration channel i for flash
+  */
+static void App_SaveBaseline(uint8_t i)
+{
+  DSP_BaselineRecord_t rec;
+  const uint16_t len = dspBaseline_save(&baseline[i], &rec);
+  if (len != 0U) {
+    (void)configStore_set((ConfigStore_Key_t)(CONFIG_KEY_BASELINE_0 + i),
+                          SETTINGS_VERSION, &rec, len);
+  }
+}
+
+/**
+  * @brief Send the baseline state of vibration channel i; changes go out as
+  *        alarm class, status replies as control
+  */
+static void App_SendBaseline(uint8_t i, uint32_t sequence,
+                             DSP_BaselineEvent_t change)
+{
+  const DSP_Baseline_t *bl = &baseline[i];
+  const TelemetryFrame_Baseline_t pkt = {
+      .sequence = sequence,
+      .timestamp = HAL_GetTick(),
+      .channel = vibration[i].channel,
+      .event = (uint8_t)change,
+      .alarm = bl->alarm,
+      .worst_band = bl->worst_band,
+      .windows = bl->windows,
+      .score = bl->score,
+      .worst_centre_hz = dspBands_centreHz(&log_bands, bl->worst_band),
+      .worst_db = bl->worst_db};
+  uint8_t packet[TELEMETRY_FRAME_ENCODED_MAX];
+  uint16_t packet_len = 0;
+  if (telemetryFrame_encodeBaseline(&pkt, packet, sizeof(packet),
+                                    &packet_len) != HAL_OK) {
+    return;
+  }
+  telemetry_sendClass(packet, packet_len,
+                      (change == DSP_BASELINE_NONE) ? TELEMETRY_CLASS_CONTROL
+                                                    : TELEMETRY_CLASS_ALARM);
+}
+
+/**
+  * @brief Send the log band levels of one vibration spectrum result
+  */
+static void App_SendBands(uint8_t channel, const DSP_SpectrumResult_t *result)
+{
+  _Static_assert(DSP_BANDS_MAX <= TELEMETRY_FRAME_LOG_BANDS,
+                 "a band table must fit one bands packet");
+  TelemetryFrame_Bands_t bands = {
+      .sequence = result->sequence,
+      .timestamp = HAL_GetTick(),
+      .channel = channel,
+      .fraction = log_bands.fraction,
+      .band_count = result->log_band_count,
+      .first_centre_hz = dspBands_centreHz(&log_bands, 0)};
+  memcpy(bands.level_rms, result->log_band_rms,
+         result->log_band_count * sizeof(bands.level_rms[0]));
+  uint8_t *out = App_ReservePacket();
+  uint16_t out_len = 0;
+  if (out != NULL &&
+      telemetryFrame_encodeBands(&bands, out, TELEMETRY_FRAME_ENCODED_MAX,
+                                 &out_len) != HAL_OK) {
+    out_len = 0;
+  }
+  App_CommitPacket(out, out_len, TELEMETRY_CLASS_CONTROL);
+}
+
+/**
+  * @brief Send the cepstrum peaks of one vibration spectrum result
+  */
+static void App_SendCepstrum(uint8_t channel,
+                             const DSP_SpectrumResult_t *result)
+{
+  _Static_assert(DSP_SPECTRUM_MAX_CEPSTRUM <= TELEMETRY_FRAME_CEPSTRUM_PEAKS,
+                 "the peaks of a result must fit one cepstrum packet");
+  TelemetryFrame_Cepstrum_t cepstrum = {.sequence = result->sequence,
+                                        .timestamp = HAL_GetTick(),
+                                        .channel = channel,
+                                        .peak_count = result->cepstrum_count};
+  for (uint8_t p = 0; p < result->cepstrum_count; p++) {
+    cepstrum.quefrency_ms[p] = result->cepstrum_ms[p];
+    cepstrum.amplitude[p] = result->cepstrum_amplitude[p];
+  }
+  uint8_t *out = App_ReservePacket();
+  uint16_t out_len = 0;
+  if (out != NULL &&
+      telemetryFrame_encodeCepstrum(&cepstrum, out,
+                                    TELEMETRY_FRAME_ENCODED_MAX,
+                                    &out_len) != HAL_OK) {
+    out_len = 0;
+  }
+  App_CommitPacket(out, out_len, TELEMETRY_CLASS_CONTROL);
+}
+
+/**
+  * @brief Pending FFT segments, one spectrum packet per finished average
+  */
+static void App_PollSpectra(void)
+{
+  // This pass's share of the FFT steps, not every segment that completed
+  uint32_t t0 = profiler_begin();
+  (void)fftSched_poll(&fft_sched);
+  profiler_end(PROFILER_PROBE_SPECTRUM, t0);
+
+  for (uint8_t i = 0; i < VIBRATION_CHANNELS; i++) {
+    DSP_SpectrumResult_t result;
+    if (dspSpectrum_getResult(&vibration[i], &result) != HAL_OK) {
+      continue;
+    }
+    TelemetryFrame_Spectrum_t spectrum = {
+        .sequence = result.sequence,
+        .timestamp = HAL_GetTick(),
+        .channel = vibration[i].channel,
+        .window = (uint8_t)vibration[i].cfg.window,
+        .length = vibration[i].cfg.length,
+        .averages = vibration[i].cfg.averages,
+        .peak_hz = result.peak_hz,
+        .peak_amplitude = result.peak_amplitude,
+        .rms = result.rms,
+        .band_count = result.band_count};
+    for (uint8_t b = 0; b < result.band_count; b++) {
+      spectrum.band_rms[b] = result.band_rms[b];
+      spectrum.band_kurtosis[b] = result.band_kurtosis[b];
+    }
+#if ADAPTIVE_RATE_ENABLE
+    adaptiveRate_noteActivity(result.rms);
+#endif
+    nnAnomaly_setBands(vibration[i].channel, result.band_rms,
+                       result.band_kurtosis, result.band_count);
+#if CAN_BUS_ENABLE
+    const uint64_t result_ts = timebase_now();
+    const CanBus_Features_t can_features = {
+        .channel = vibration[i].channel,
+        .band_count = result.band_count,
+        .sequence = result.sequence,
+        .rms = result.rms,
+        .peak_hz = result.peak_hz,
+        .peak_amplitude = result.peak_amplitude,
+        .event = result_ts};
+    (void)canBus_sendFeatures(&can_features);
+#endif
+    const DSP_BaselineEvent_t change = dspBaseline_update(
+        &baseline[i], result.log_band_rms, result.log_band_count);
+    if (change == DSP_BASELINE_LEARNED) {
+      App_SaveBaseline(i);
+    }
+    if (change != DSP_BASELINE_NONE) {
+      App_SendBaseline(i, result.sequence, change);
+#if CAN_BUS_ENABLE
+      const CanBus_Alarm_t can_alarm = {.channel = vibration[i].channel,
+                                        .event = (uint8_t)change,
+                                        .alarm = baseline[i].alarm,
+                                        .worst_band = baseline[i].worst_band,
+                                        .score = baseline[i].score,
+                                        .event_ts = result_ts};
+      (void)canBus_sendAlarm(&can_alarm);
+#endif
+    }
+    if (report_mode == REPORT_SCORE) {
+      continue; // the bands go out inside the score
+    }
+    uint8_t *out = App_ReservePacket();
+    uint16_t out_len = 0;
+    if (out != NULL &&
+        (feature_cbor ? telemetryFrame_encodeSpectrumCbor(
+                            &spectrum, out, TELEMETRY_FRAME_ENCODED_MAX,
+                            &out_len)
+                      : telemetryFrame_encodeSpectrum(
+                            &spectrum, out, TELEMETRY_FRAME_ENCODED_MAX,
+                            &out_len)) != HAL_OK) {
+      out_len = 0;
+    }
+    App_CommitPacket(out, out_len, TELEMETRY_CLASS_CONTROL);
+    if (result.log_band_count != 0U &&
+        (baseline_gate == 0U || baseline[i].alarm != 0U)) {
+      App_SendBands(vibration[i].channel, &result);
+    }
+    if (vibration[i].cfg.cepstrum_count != 0U) {
+      App_SendCepstrum(vibration[i].channel, &result);
+    }
+  }
+  // The segment hooks of the polls above feed the cross-spectra
+  App_PollCoherence();
+}
+
+/**
+  * @brief Min/max buckets of the display branch into display packets
+  */
+static void App_PollDisplay(void)
+{
+  pipeline_poll(&display_pipeline);
+}
+
+/**
+  * @brief Pending envelope FFT segments, one envelope packet per average
+  */
+static void App_PollEnvelope(void)
+{
+  uint32_t t0 = profiler_begin();
+  pipeline_poll(&envelope_pipeline);
+  profiler_end(PROFILER_PROBE_SPECTRUM, t0);
+
+  DSP_SpectrumResult_t result;
+#if ENVELOPE_SPECTRUM_Q15
+  if (dspSpectrumQ15_getResult(&envelope, &result) != HAL_OK) {
+#else
+  if (dspSpectrum_getResult(&envelope, &result) != HAL_OK) {
+#endif
+    return;
+  }
+  TelemetryFrame_Envelope_t features = {
+      .sequence = result.sequence,
+      .timestamp = HAL_GetTick(),
+      .channel = envelope.channel,
+      .length = envelope.cfg.length,
+      .averages = envelope.cfg.averages,
+      .sample_rate_hz = envelope.cfg.sample_rate_hz,
+      .rms = result.rms,
+      .tone_count = result.tone_count};
+  for (uint8_t t = 0; t < result.tone_count; t++) {
+    features.tone_hz[t] = result.tone_hz[t];
+    features.tone_amplitude[t] = result.tone_amplitude[t];
+  }
+  uint8_t *out = App_ReservePacket();
+  uint16_t out_len = 0;
+  if (out != NULL &&
+      telemetryFrame_encodeEnvelope(&features, out,
+                                    TELEMETRY_FRAME_ENCODED_MAX,
+                                    &out_len) != HAL_OK) {
+    out_len = 0;
+  }
+  App_CommitPacket(out, out_len, TELEMETRY_CLASS_CONTROL);
+}
+
+/**
+  * @brief One harmonics packet per channel for each finished Goertzel window
+  */
+static void App_PollHarmonics(void)
+{
+  DSP_GoertzelResult_t result;
+  if (dspGoertzel_getResult(&harmonics, &result) != HAL_OK) {
+    return;
+  }
+  for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+    if (result.bin_count[ch] == 0U) {
+      continue;
+    }
+    TelemetryFrame_Harmonics_t bins = {.sequence = result.sequence,
+                                       .timestamp = HAL_GetTick(),
+                                       .channel = ch,
+                                       .length = harmonics.length,
+                                       .bin_count = result.bin_count[ch]};
+    for (uint8_t b = 0; b < result.bin_count[ch]; b++) {
+      bins.hz[b] = result.hz[ch][b];
+      bins.amplitude[b] = result.amplitude[ch][b];
+    }
+    uint8_t *out = App_ReservePacket();
+    uint16_t out_len = 0;
+    if (out != NULL &&
+        telemetryFrame_encodeHarmonics(&bins, out,
+                                       TELEMETRY_FRAME_ENCODED_MAX,
+                                       &out_len) != HAL_OK) {
+      out_len = 0;
+    }
+    App_CommitPacket(out, out_len, TELEMETRY_CLASS_CONTROL);
+  }
+}
+
+/**
+  * @brief One velocity packet for each finished interval
+  */
+static void App_PollVelocity(void)
+{
+  DSP_VelocityResult_t result;
+  if (dspVelocity_getResult(&velocity, &result) != HAL_OK) {
+    return;
+  }
+  TelemetryFrame_Velocity_t frame = {
+      .sequence = result.sequence,
+      .timestamp = HAL_GetTick(),
+      .interval_ms = velocity.cfg.interval_ms,
+      .low_hz = (uint16_t)velocity.cfg.low_hz,
+      .high_hz = (uint16_t)velocity.cfg.high_hz,
+      .channel_mask = result.channels};
+  for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+    frame.rms_mm_s[ch] = result.rms_mm_s[ch];
+    frame.peak_mm_s[ch] = result.peak_mm_s[ch];
+    frame.zone[ch] = result.zone[ch];
+  }
+  uint8_t *out = App_ReservePacket();
+  uint16_t out_len = 0;
+  if (out != NULL &&
+      (feature_cbor ? telemetryFrame_encodeVelocityCbor(
+                          &frame, out, TELEMETRY_FRAME_ENCODED_MAX, &out_len)
+                    : telemetryFrame_encodeVelocity(
+                          &frame, out, TELEMETRY_FRAME_ENCODED_MAX,
+                          &out_len)) != HAL_OK) {
+    out_len = 0;
+  }
+  App_CommitPacket(out, out_len, TELEMETRY_CLASS_CONTROL);
+}
+
+#if TACH_ENABLE
+/**
+  * @brief Send an averaged revolution in TSA packets of up to
+  *        TELEMETRY_FRAME_TSA_SAMPLES angles
+  */
+static void App_SendTsa(const DSP_TsaResult_t *res, float32_t rpm)
+{
+  // One scale for all the slices: the widest swing in 15 bits
+  float32_t swing = 0.0f;
+  for (uint16_t i = 0; i < res->samples_per_rev; i++) {
+    const float32_t d = fabsf(res->samples[i] - res->mean);
+    swing = (d > swing) ? d : swing;
+  }
+  TelemetryFrame_Tsa_t slice = {
+      .sequence = res->sequence,
+      .timestamp = HAL_GetTick(),
+      .channel = order.channel,
+      .samples_per_rev = res->samples_per_rev,
+      .revolutions = res->revolutions,
+      .rejected = res->rejected,
+      .rpm = rpm,
+      .mean = res->mean,
+      .rms = res->rms,
+      .peak_to_peak = res->peak_to_peak,
+      .residual_rms = res->residual_rms,
+      .scale = (swing > 0.0f) ? swing / 32767.0f : 1.0f};
+  for (uint16_t first = 0; first < res->samples_per_rev;
+       first += TELEMETRY_FRAME_TSA_SAMPLES) {
+    const uint16_t left = (uint16_t)(res->samples_per_rev - first);
+    slice.first = first;
+    slice.count = (uint8_t)((left < TELEMETRY_FRAME_TSA_SAMPLES)
+                                ? left
+                                : TELEMETRY_FRAME_TSA_SAMPLES);
+    slice.samples = &res->samples[first];
+    uint8_t *out = App_ReservePacket();
+    uint16_t out_len = 0;
+    if (out != NULL &&
+        telemetryFrame_encodeTsa(&slice, out, TELEMETRY_FRAME_ENCODED_MAX,
+                                 &out_len) != HAL_OK) {
+      out_len = 0;
+    }
+    App_CommitPacket(out, out_len, TELEMETRY_CLASS_CONTROL);
+  }
+}
+
+/**
+  * @brief Tach edges into the resampler, its angle samples into the order
+  *        FFT and the TSA, one order packet per finished average and the
+  *        TSA packets of each averaged revolution
+  */
+static void App_PollOrders(void)
+{
+  uint64_t edge;
+  while (tach_popEdge(&edge) == HAL_OK) {
+    dspOrder_pushEdge(&order, edge);
+  }
+  (void)dspOrder_poll(&order, &order_fft);
+  if (dspTsa_getResult(&tsa, &tsa_result) == HAL_OK) {
+    DSP_OrderStatus_t now;
+    (void)dspOrder_getStatus(&order, &now);
+    App_SendTsa(&tsa_result, now.rpm);
+  }
+  // Its FFT runs in the scheduler's pass (App_PollSpectra())
+  DSP_SpectrumResult_t result;
+  if (dspSpectrum_getResult(&order_fft, &result) != HAL_OK) {
+    return;
+  }
+  DSP_OrderStatus_t status;
+  (void)dspOrder_getStatus(&order, &status);
+  TelemetryFrame_Order_t features = {
+      .sequence = result.sequence,
+      .timestamp = HAL_GetTick(),
+      .channel = order.channel,
+      .length = order_fft.cfg.length,
+      .averages = order_fft.cfg.averages,
+      .samples_per_rev = order.cfg.samples_per_rev,
+      .rpm = status.rpm,
+      .peak_order = result.peak_hz,
+      .peak_amplitude = result.peak_amplitude,
+      .rms = result.rms,
+      .tone_count = result.tone_count};
+  for (uint8_t t = 0; t < result.tone_count; t++) {
+    features.tone_order[t] = result.tone_hz[t];
+    features.tone_amplitude[t] = result.tone_amplitude[t];
+  }
+  uint8_t *out = App_ReservePacket();
+  uint16_t out_len = 0;
+  if (out != NULL &&
+      telemetryFrame_encodeOrder(&features, out, TELEMETRY_FRAME_ENCODED_MAX,
+                                 &out_len) != HAL_OK) {
+    out_len = 0;
+  }
+  App_CommitPacket(out, out_len, TELEMETRY_CLASS_CONTROL);
+}
+#endif
+
+/**
+  * @brief Queue the host-changeable settings for flash; unchanged ones cost
+  *        nothing
+  */
+static void App_SaveSettings(void)
+{
+  const uint8_t stages = block_stages;
+  (void)configStore_set(CONFIG_KEY_SCAN_RATE, SETTINGS_VERSION, &scan_rate_hz,
+                        sizeof(scan_rate_hz));
+  (void)configStore_set(CONFIG_KEY_STREAM_MASK, SETTINGS_VERSION, &stream_mask,
+                        sizeof(stream_mask));
+  (void)configStore_set(CONFIG_KEY_BLOCK_STAGES, SETTINGS_VERSION, &stages,
+                        sizeof(stages));
+  (void)configStore_set(CONFIG_KEY_CODEC_STREAM, SETTINGS_VERSION,
+                        &codec_stream, sizeof(codec_stream));
+  (void)configStore_set(CONFIG_KEY_CAPTURE, SETTINGS_VERSION, &capture_enabled,
+                        sizeof(capture_enabled));
+  (void)configStore_set(CONFIG_KEY_REPORT_MODE, SETTINGS_VERSION,
+                        &report_mode, sizeof(report_mode));
+  (void)configStore_set(CONFIG_KEY_FEATURE_FORMAT, SETTINGS_VERSION,
+                        &feature_cbor, sizeof(feature_cbor));
+  (void)configStore_set(CONFIG_KEY_LOG_BANDS, SETTINGS_VERSION,
+                        &log_bands_fraction, sizeof(log_bands_fraction));
+  (void)configStore_set(CONFIG_KEY_BASELINE_GATE, SETTINGS_VERSION,
+                        &baseline_gate, sizeof(baseline_gate));
+  (void)configStore_set(CONFIG_KEY_RAINFLOW_MASK, SETTINGS_VERSION,
+                        &rainflow_mask, sizeof(rainflow_mask));
+  (void)configStore_set(CONFIG_KEY_SRS_MODE, SETTINGS_VERSION, &srs_mode,
+                        sizeof(srs_mode));
+  (void)configStore_set(CONFIG_KEY_TRIGGER_EXPR, SETTINGS_VERSION, expr_text,
+                        sizeof(expr_text));
+  (void)configStore_set(CONFIG_KEY_PRESET, SETTINGS_VERSION, &preset,
+                        sizeof(preset));
+  (void)configStore_set(CONFIG_KEY_CODEC_ERROR, SETTINGS_VERSION,
+                        &codec_error, sizeof(codec_error));
+  (void)configStore_set(CONFIG_KEY_RESOLUTION, SETTINGS_VERSION, &scan_bits,
+                        sizeof(scan_bits));
+  const uint8_t cepstrum[3] = {cepstrum_peaks, cepstrum_min_ms,
+                               cepstrum_max_ms};
+  (void)configStore_set(CONFIG_KEY_CEPSTRUM, SETTINGS_VERSION, cepstrum,
+                        sizeof(cepstrum));
+#if TACH_ENABLE
+  (void)configStore_set(CONFIG_KEY_TSA, SETTINGS_VERSION, &tsa_revolutions,
+                        sizeof(tsa_revolutions));
+#endif
+#if PWM_SYNC_ENABLE
+  (void)configStore_set(CONFIG_KEY_PWM_PHASE, SETTINGS_VERSION, &pwm_phase_ns,
+                        sizeof(pwm_phase_ns));
+#endif
+}
+
+#if DSP_DESPIKE_ENABLE || DSP_DESKEW_ENABLE
+/**
+  * @brief The driver's block filter (DMA ISR): spikes out first, then the
+  *        channels aligned, so the spike filter sees the samples as taken
+  */
+static void App_BlockFilter(uint16_t *block, uint32_t frames, void *ctx)
+{
+  UNUSED(ctx);
+#if DSP_DESPIKE_ENABLE
+  if (block_stages & STAGE_DESPIKE) {
+    dspDespike_process(&despike, block, frames);
+  }
+#endif
+#if DSP_DESKEW_ENABLE
+  if (deskew_on) {
+    dspDeskew_process(&deskew, block, frames);
+  }
+#endif
+}
+
+/**
+  * @brief Attach the block filter while the despike stage bit or the
+  *        deskew switch wants it, detach it otherwise
+  */
+static void App_ApplyBlockFilter(void)
+{
+  uint8_t on = 0;
+#if DSP_DESPIKE_ENABLE
+  on |= (block_stages & STAGE_DESPIKE) ? 1U : 0U;
+#endif
+#if DSP_DESKEW_ENABLE
+  on |= deskew_on;
+#endif
+  if (on) {
+    analogSensor_setBlockFilter(App_BlockFilter, NULL);
+  } else {
+    analogSensor_setBlockFilter(NULL, NULL);
+  }
+}
+#endif
+
+#if DSP_DESKEW_ENABLE
+/**
+  * @brief Skew of every channel from the current layout, ADCCLK and
+  *        profiles, filters designed at the scan rate (scan stopped, or
+  *        before the filter is attached)
+  */
+static void App_InitDeskew(void)
+{
+  float skew_ns[ADC_CONVERSIONS_CHANNEL_COUNT];
+
+  if (analogSensor_getScanSkew(skew_ns) != HAL_OK ||
+      dspDeskew_init(&deskew, skew_ns,
+                     analogSensor_getBlockChannelMap()) != HAL_OK) {
+    Error_Handler();
+  }
+  // A skew of a frame or more at this rate leaves it pass-through
+  (void)dspDeskew_setRate(&deskew, deskew_rate_hz);
+}
+#endif
+
+/**
+  * @brief Budget of the ADC DMA handler (isr_budget.h): a share of the block
+  *        period, so a handler over it leaves too little for the main loop;
+  *        the stage deadlines follow the same period
+  */
+static void App_SetDmaBudget(uint32_t frame_rate_hz)
+{
+  const uint64_t block_ns = (uint64_t)analogSensor_getBlockFrames() *
+                            1000000000ULL / frame_rate_hz;
+  (void)isrBudget_setBudgetNs(ISR_BUDGET_ADC_DMA,
+                              (uint32_t)(block_ns / DMA_BUDGET_SHARE));
+  (void)stageDeadline_setPeriod(&deadlines, (uint32_t)(block_ns / 1000U));
+}
+
+/**
+  * @brief Stream decimation for a rate's own one, under the back-pressure
+  *        level: doubled per level as long as it divides the block
+  */
+static uint16_t App_StreamDecimation(uint16_t base)
+{
+  uint32_t d = (uint32_t)base << stream_degrade;
+  while (d > base && (ADC_CONVERSIONS_BLOCK_FRAMES % d) != 0U) {
+    d >>= 1;
+  }
+  return (uint16_t)d;
+}
+
+/**
+  * @brief Retune the rate-dependent stages (DMA ISR, block boundary): stream
+  *        decimation and the spectrum frequency scale
+  */
+static void App_RetuneStages(uint32_t frame_rate_hz, uint16_t decimation)
+{
+  App_SetDmaBudget(frame_rate_hz);
+  stream_base_decimation = decimation;
+  dspFilter_setDecimation(&stream_filter, App_StreamDecimation(decimation));
+  // A float store: the spectrum in progress is scaled at the new rate; the
+  // log bands keep their edges in Hz and find their bins again
+  for (uint8_t i = 0; i < VIBRATION_CHANNELS; i++) {
+    vibration[i].cfg.sample_rate_hz = (float32_t)frame_rate_hz;
+  }
+  // The envelope filters scale with the rate, and so do its bins
+  envelope.cfg.sample_rate_hz =
+      (float32_t)frame_rate_hz / (float32_t)ENVELOPE_DECIMATION;
+  // Same frequencies, new bins; the window in progress is dropped
+  (void)dspGoertzel_setSampleRate(&harmonics, (float32_t)frame_rate_hz);
+  // Filters and integrator redesigned; the interval in progress restarts
+  (void)dspVelocity_setSampleRate(&velocity, (float32_t)frame_rate_hz);
+#if TACH_ENABLE
+  // New frame period; the orders and their bins stay where they are
+  (void)dspOrder_setSampleRate(&order, (float32_t)frame_rate_hz);
+#endif
+  // The expression's hold stays in ms; a hold in progress goes on
+  expr_rate_hz = frame_rate_hz;
+  (void)triggerExpr_setRate(&trigger_expr, frame_rate_hz);
+#if DSP_DESKEW_ENABLE
+  // Same skews in ns, more or fewer frames: taps redesigned between blocks
+  deskew_rate_hz = frame_rate_hz;
+  (void)dspDeskew_setRate(&deskew, frame_rate_hz);
+#endif
+}
+
+/**
+  * @brief Send the frames collected in the stream batch, then restart it
+  */
+static void App_FlushBatch(void)
+{
+  if (batch.frame_count != 0U) {
+    App_SendSamples(&batch, TELEMETRY_CLASS_BULK, 0U);
+  }
+  telemetryFrame_initBatch(&batch, stream_mask);
+}
+
+/**
+  * @brief Close the batch at the old rate, announce the new one and flag
+  *        the next batch
+  */
+static void App_AnnounceRate(const TelemetryFrame_Rate_t *info)
+{
+  App_FlushBatch();
+  swoTrace_marker(SWO_TRACE_MARK_RATE, info->frame_rate_hz);
+  batch.flags = TELEMETRY_FRAME_FLAG_RATE_CHANGE;
+  if (telemetryFrame_encodeRate(info, packet, sizeof(packet),
+                                &packet_len) == HAL_OK) {
+    telemetry_send(packet, packet_len);
+  }
+}
+
+/**
+  * @brief Announce the stream decimation taken on at first_frame after a
+  *        back-pressure step, at the unchanged scan rate
+  */
+static void App_AnnounceDegrade(uint32_t first_frame, uint16_t decimation)
+{
+  TelemetryFrame_Rate_t info = {.first_frame = first_frame,
+                                .timestamp = HAL_GetTick(),
+                                .frame_rate_hz = scan_rate_hz,
+                                .decimation = decimation};
+#if ADAPTIVE_RATE_ENABLE
+  AdaptiveRate_Status_t rate;
+  if (adaptiveRate_getStatus(&rate) == HAL_OK) {
+    info.frame_rate_hz = rate.frame_rate_hz;
+    info.level = rate.level;
+    info.activity = rate.activity;
+  }
+#endif
+  App_AnnounceRate(&info);
+}
+
+/**
+  * @brief Degrade the sample stream while the bulk TX class loses packets
+  *        (full or over budget), one decimation step per STREAM_DEGRADE_MS;
+  *        recover a step per STREAM_RECOVER_MS without losses
+  */
+static void App_PollBackPressure(void)
+{
+  const uint32_t now = HAL_GetTick();
+  Telemetry_ClassStats_t bulk;
+  if (now - degrade_check_ms < STREAM_DEGRADE_MS ||
+      telemetry_getClassStats(TELEMETRY_CLASS_BULK, &bulk) != HAL_OK) {
+    return;
+  }
+  degrade_check_ms = now;
+  const uint32_t losses = bulk.dropped + bulk.throttled;
+  uint8_t level = stream_degrade;
+  if (losses != bulk_losses) {
+    bulk_losses = losses;
+    degrade_clear_ms = now;
+    if (level < STREAM_DEGRADE_MAX) {
+      level++;
+    }
+  } else if (level > 0U && now - degrade_clear_ms >= STREAM_RECOVER_MS) {
+    degrade_clear_ms = now;
+    level--;
+  }
+  if (level == stream_degrade) {
+    return;
+  }
+
+  // The rate's own decimation may change at a block boundary meanwhile
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  stream_degrade = level;
+  dspFilter_setDecimation(&stream_filter,
+                          App_StreamDecimation(stream_base_decimation));
+  __set_PRIMASK(primask);
+  stream_degrade_announce = 1;
+}
+
+/**
+  * @brief Ring overflows count as missed blocks for the stage deadlines;
+  *        announce the shed stages whenever they change
+  */
+static void App_PollDeadlines(void)
+{
+  ADC_RingStats_t ring;
+  if (adcRing_getStats(&ring) == HAL_OK &&
+      ring.overflows != deadline_overflows) {
+    deadline_overflows = ring.overflows;
+    stageDeadline_miss(&deadlines);
+  }
+  const uint32_t changes = stageDeadline_getChanges(&deadlines);
+  if (changes == deadline_changes) {
+    return;
+  }
+  deadline_changes = changes;
+  char names[96];
+  char line[112];
+  stageDeadline_formatShed(&deadlines, names, sizeof(names));
+  int len = snprintf(line, sizeof(line), "SHED stages=%s\r\n", names);
+  if (len > 0) {
+    telemetry_send((const uint8_t *)line, (uint16_t)strlen(line));
+  }
+}
+
+/**
+  * @brief Mark a capture taken out of the scan once the scan is back: the
+  *        batch at hand closes and a mode packet spans the skipped frames
+  */
+static void App_PollModeSwitch(void)
+{
+  ADC_SwitchInfo_t sw;
+  if (analogSensor_getSwitchInfo(&sw) != HAL_OK ||
+      sw.switches == switch_announced) {
+    return;
+  }
+  switch_announced = sw.switches;
+  App_FlushBatch();
+  const TelemetryFrame_Mode_t pkt = {
+      .gap_sequence = sw.gap_sequence,
+      .timestamp = HAL_GetTick(),
+      .channel = sw.channel,
+      .gap_frames = sw.gap_frames,
+      .capture_start_us = timebase_toMicros(sw.capture_start),
+      .capture_samples = ADC_CONVERSIONS_CAPTURE_SAMPLES,
+      .capture_rate_hz = analogSensor_getCaptureRate(),
+      .enter_us = sw.enter_us,
+      .leave_us = sw.leave_us,
+      .frame_period_us = (float)sw.frame_period_us};
+  if (telemetryFrame_encodeMode(&pkt, packet, sizeof(packet),
+                                &packet_len) == HAL_OK) {
+    telemetry_sendClass(packet, packet_len, TELEMETRY_CLASS_CONTROL);
+  }
+}
+
+#if ADAPTIVE_RATE_ENABLE
+/**
+  * @brief Rate level reached (DMA ISR, block boundary)
+  */
+static void App_ApplyRate(const AdaptiveRate_Level_t *level, void *ctx)
+{
+  UNUSED(ctx);
+  App_RetuneStages(level->frame_rate_hz, level->decimation);
+}
+
+/**
+  * @brief Rate controller step; announces a change
+  */
+static void App_PollRate(void)
+{
+  AdaptiveRate_Status_t rate;
+  if (adaptiveRate_poll(&rate) != HAL_OK) {
+    return;
+  }
+  const TelemetryFrame_Rate_t info = {.first_frame = rate.first_frame,
+                                      .timestamp = rate.changed_ms,
+                                      .frame_rate_hz = rate.frame_rate_hz,
+                                      .decimation =
+                                          App_StreamDecimation(rate.decimation),
+                                      .level = rate.level,
+                                      .activity = rate.activity};
+  App_AnnounceRate(&info);
+}
+#else
+/**
+  * @brief Host rate change swapped in (DMA ISR, block boundary)
+  */
+static void App_RateApplied(uint32_t first_frame, void *ctx)
+{
+  const uint32_t frame_rate_hz = (uint32_t)(uintptr_t)ctx;
+  UNUSED(first_frame);
+  (void)timeSync_setFrameRate(frame_rate_hz); // HAL_ERROR: discipline off
+  App_RetuneStages(frame_rate_hz, STREAM_DECIMATION);
+}
+#endif
+
+/**
+  * @brief "rate <hz>": stage a new scan rate for the next block
+  */
+static HAL_StatusTypeDef App_CmdRate(uint32_t argc, char *argv[], void *ctx)
+{
+  UNUSED(ctx);
+#if ADAPTIVE_RATE_ENABLE || PWM_SYNC_ENABLE
+  UNUSED(argc);
+  UNUSED(argv);
+  return HAL_BUSY; // the rate controller or the motor PWM owns the scan rate
+#else
+  char *end = NULL;
+  if (argc != 2U) {
+    return HAL_ERROR;
+  }
+  const unsigned long hz = strtoul(argv[1], &end, 10);
+  if (end == argv[1] || *end != '\0' || hz == 0UL) {
+    return HAL_ERROR;
+  }
+#if EXT_ADC_ENABLE
+  // Each trigger must also hold a whole SPI ADC sequence
+  if (hz > extAdc_getMaxFrameRate()) {
+    return HAL_ERROR;
+  }
+#endif
+#if ADC_MUX_ENABLE
+  // ... and leave the muxes their settle time
+  if (hz > adcMux_getMaxFrameRate()) {
+    return HAL_ERROR;
+  }
+#endif
+  // The driver checks the rate against the sampling times and TIM2
+  const ADC_ScanConfig_t cfg = {.fields = ADC_SCAN_CONFIG_RATE,
+                                .frame_rate_hz = (uint32_t)hz,
+                                .applied = App_RateApplied,
+                                .ctx = (void *)(uintptr_t)hz};
+  TelemetryFrame_Rate_t info = {.timestamp = HAL_GetTick(),
+                                .frame_rate_hz = (uint32_t)hz,
+                                .decimation =
+                                    App_StreamDecimation(STREAM_DECIMATION)};
+  HAL_StatusTypeDef status = analogSensor_stageConfig(&cfg, &info.first_frame);
+  if (status != HAL_OK) {
+    return status;
+  }
+  scan_rate_hz = (uint32_t)hz;
+#if TDMA_BUS_ENABLE
+  (void)tdmaBus_start(scan_rate_hz); // HAL_ERROR: slots too short, off
+#endif
+  App_AnnounceRate(&info);
+  App_SaveSettings();
+  return HAL_OK;
+#endif
+}
+
+/**
+  * @brief "phase <ns>": move the scan trigger within the motor PWM period,
+  *        from the counter peak (negative: before it)
+  */
+static HAL_StatusTypeDef App_CmdPhase(uint32_t argc, char *argv[], void *ctx)
+{
+  char *end = NULL;
+
+  UNUSED(ctx);
+  if (argc != 2U) {
+    return HAL_ERROR;
+  }
+  const long ns = strtol(argv[1], &end, 10);
+  if (end == argv[1] || *end != '\0' || ns < INT32_MIN || ns > INT32_MAX ||
+      pwmSync_setPhase((int32_t)ns) != HAL_OK) {
+    return HAL_ERROR; // also without PWM_SYNC_ENABLE: never started
+  }
+#if PWM_SYNC_ENABLE
+  pwm_phase_ns = pwmSync_getPhase();
+  App_SaveSettings();
+#endif
+  return HAL_OK;
+}
+
+/**
+  * @brief "interlock reset": release the interlock output; a channel still
+  *        beyond its limit trips it again on the next frame
+  */
+static HAL_StatusTypeDef App_CmdInterlock(uint32_t argc, char *argv[],
+                                          void *ctx)
+{
+  UNUSED(ctx);
+  if (argc != 2U || strcmp(argv[1], "reset") != 0) {
+    return HAL_ERROR;
+  }
+  return interlock_reset(); // HAL_ERROR without INTERLOCK_ENABLE
+}
+
+/**
+  * @brief "mask <channels>": channels of the filtered sample stream, e.g.
+  *        0x07 for sensor 1 only
+  */
+static HAL_StatusTypeDef App_CmdMask(uint32_t argc, char *argv[], void *ctx)
+{
+  UNUSED(ctx);
+  char *end = NULL;
+  if (argc != 2U) {
+    return HAL_ERROR;
+  }
+  const unsigned long mask = strtoul(argv[1], &end, 0);
+  if (end == argv[1] || *end != '\0' || mask == 0UL ||
+      (mask & ~(unsigned long)TELEMETRY_FRAME_ALL_CHANNELS) != 0UL) {
+    return HAL_ERROR;
+  }
+  App_FlushBatch(); // frames so far go out under the old mask
+  stream_mask = (ADC_ChannelMask_t)mask;
+  telemetryFrame_initBatch(&batch, stream_mask);
+  App_SaveSettings();
+  return HAL_OK;
+}
+
+/**
+  * @brief Compressed full-rate stream in place of the filtered one
+  */
+static void App_SetCodec(uint8_t on)
+{
+  codec_stream = on;
+  codec_fill = 0;
+  codec_pending = 0;
+  sampleCodec_resetStats();
+  waveletCodec_resetStats();
+  App_SaveSettings();
+}
+
+/**
+  * @brief "codec [lossless|<max_error>]": the CODEC line, or the codec of
+  *        the compressed stream
+  *
+  * A bound of 1..WAVELET_CODEC_MAX_ERROR codes sends wavelet packets, each
+  * sample within that of the scan; "lossless" (or 0) goes back to the
+  * predictor codec. The CODEC line has the totals of the codec in use:
+  * runs, samples, bytes and the ratio to 12-bit packing in hundredths.
+  */
+static HAL_StatusTypeDef App_CmdCodec(uint32_t argc, char *argv[], void *ctx)
+{
+  char line[192];
+  char *end = NULL;
+  int len;
+
+  UNUSED(ctx);
+  if (argc == 2U) {
+    const unsigned long bound =
+        (strcmp(argv[1], "lossless") == 0) ? 0UL : strtoul(argv[1], &end, 10);
+    if ((end != NULL && (end == argv[1] || *end != '\0')) ||
+        bound > WAVELET_CODEC_MAX_ERROR) {
+      return HAL_ERROR;
+    }
+    codec_error = (uint16_t)bound;
+    sampleCodec_resetStats();
+    waveletCodec_resetStats();
+    App_SaveSettings();
+    return HAL_OK;
+  }
+  if (argc != 1U) {
+    return HAL_ERROR;
+  }
+
+  if (codec_error == 0U) {
+    SampleCodec_Stats_t st;
+    (void)sampleCodec_getStats(&st);
+    len = snprintf(line, sizeof(line),
+                   "CODEC on=%u lossless runs=%lu samples=%lu bytes=%lu "
+                   "ratio=%lu verbatim=%lu\r\n",
+                   codec_stream, (unsigned long)st.runs,
+                   (unsigned long)st.samples, (unsigned long)st.bytes,
+                   (unsigned long)(st.bytes != 0U ? (uint64_t)st.samples *
+                                                        150U / st.bytes
+                                                  : 0U),
+                   (unsigned long)st.verbatim_runs);
+  } else {
+    WaveletCodec_Stats_t st;
+    (void)waveletCodec_getStats(&st);
+    len = snprintf(line, sizeof(line),
+                   "CODEC on=%u max_error=%u runs=%lu samples=%lu bytes=%lu "
+                   "ratio=%lu verbatim=%lu trials=%lu zeroed=%lu\r\n",
+                   codec_stream, codec_error, (unsigned long)st.runs,
+                   (unsigned long)st.samples, (unsigned long)st.bytes,
+                   (unsigned long)(st.bytes != 0U ? (uint64_t)st.samples *
+                                                        150U / st.bytes
+                                                  : 0U),
+                   (unsigned long)st.verbatim_runs, (unsigned long)st.trials,
+                   (unsigned long)st.zeroed);
+  }
+  if (len > 0) {
+    telemetry_send((const uint8_t *)line, (uint16_t)strlen(line));
+  }
+  return HAL_OK;
+}
+
+/**
+  * @brief "pipeline <stage> on|off": switch a block stage (spectrum,
+  *        envelope, harmonics, velocity, display, histogram, order,
+  *        despike) or the codec stream
+  *
+  * A stage switched back on resumes mid-window, so its first result spans
+  * the gap.
+  */
+static HAL_StatusTypeDef App_CmdPipeline(uint32_t argc, char *argv[],
+                                         void *ctx)
+{
+  static const struct {
+    const char *name;
+    uint8_t bit;
+  } stages[] = {{"spectrum", STAGE_SPECTRUM},
+                {"envelope", STAGE_ENVELOPE},
+                {"harmonics", STAGE_HARMONICS},
+                {"velocity", STAGE_VELOCITY},
+                {"display", STAGE_DISPLAY},
+                {"histogram", STAGE_HISTOGRAM},
+#if TACH_ENABLE
+                {"order", STAGE_ORDER},
+#endif
+#if DSP_DESPIKE_ENABLE
+                {"despike", STAGE_DESPIKE},
+#endif
+  };
+  uint8_t on;
+
+  UNUSED(ctx);
+  if (argc != 3U) {
+    return HAL_ERROR;
+  }
+  if (strcmp(argv[2], "on") == 0) {
+    on = 1;
+  } else if (strcmp(argv[2], "off") == 0) {
+    on = 0;
+  } else {
+    return HAL_ERROR;
+  }
+  if (strcmp(argv[1], "codec") == 0) {
+    App_SetCodec(on);
+    return HAL_OK;
+  }
+  for (uint32_t i = 0; i < sizeof(stages) / sizeof(stages[0]); i++) {
+    if (strcmp(argv[1], stages[i].name) == 0) {
+      // Only the main loop writes it; the DMA ISR reads it once per block
+      block_stages = on ? (uint8_t)(block_stages | stages[i].bit)
+                        : (uint8_t)(block_stages & ~stages[i].bit);
+#if DSP_DESPIKE_ENABLE
+      App_ApplyBlockFilter();
+#endif
+      App_SaveSettings();
+      return HAL_OK;
+    }
+  }
+  return HAL_ERROR;
+}
+
+/**
+  * @brief "capture start|stop": arm the event trigger, or leave it disarmed
+  *        once the capture in progress has been sent
+  */
+static HAL_StatusTypeDef App_CmdCapture(uint32_t argc, char *argv[],
+                                        void *ctx)
+{
+  UNUSED(ctx);
+  if (argc != 2U) {
+    return HAL_ERROR;
+  }
+  const ADC_TriggerState_t state = adcTrigger_getState();
+  if (strcmp(argv[1], "start") == 0) {
+    capture_enabled = 1;
+    if (state == ADC_TRIGGER_STATE_IDLE) {
+      adcTrigger_arm();
+      analogSensor_armWatchdog();
+    }
+  } else if (strcmp(argv[1], "stop") == 0) {
+    capture_enabled = 0;
+    if (state != ADC_TRIGGER_STATE_READY) {
+      adcTrigger_disarm(); // a frozen capture is still sent
+    }
+  } else {
+    return HAL_ERROR;
+  }
+  App_SaveSettings();
+  return HAL_OK;
+}
+
+#if MODBUS_SERVER_ENABLE
+/**
+  * @brief Holding registers stored by the Modbus client (main loop): do what
+  *        the command of each setting does beside the store, then save
+  */
+static void App_ModbusWritten(uint32_t written, void *ctx)
+{
+  UNUSED(ctx);
+  if ((written & MODBUS_NOTIFY_REPORT) != 0U &&
+      report_mode == REPORT_EXCEPTION) {
+    telemetryFrame_resetException(&report_state);
+  }
+  if ((written & MODBUS_NOTIFY_CAPTURE) != 0U) {
+    const ADC_TriggerState_t state = adcTrigger_getState();
+    if (capture_enabled && state == ADC_TRIGGER_STATE_IDLE) {
+      adcTrigger_arm();
+      analogSensor_armWatchdog();
+    } else if (!capture_enabled && state != ADC_TRIGGER_STATE_READY) {
+      adcTrigger_disarm(); // a frozen capture is still sent
+    }
+  }
+  App_SaveSettings();
+}
+#endif
+
+/**
+  * @brief Compile a trigger expression and hand it to the engine, "" to
+  *        remove it; the one installed stays on an error
+  */
+static HAL_StatusTypeDef App_SetExpression(const char *text,
+                                           TriggerExpr_Error_t *err)
+{
+  static TriggerExpr_t compiled; // 300 bytes, off the stack
+  const ADC_TriggerState_t state = adcTrigger_getState();
+  if (state == ADC_TRIGGER_STATE_TRIGGERED) {
+    return HAL_BUSY; // the capture in progress first
+  }
+  if (text[0] != '\0' && triggerExpr_compile(text, &compiled, err) != HAL_OK) {
+    return HAL_ERROR;
+  }
+  adcTrigger_disarm();
+  if (text[0] == '\0') {
+    (void)adcTrigger_setExpression(NULL);
+  } else {
+    // The rate hook writes the hold from the DMA interrupt
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    trigger_expr = compiled;
+    (void)triggerExpr_setRate(&trigger_expr, expr_rate_hz);
+    __set_PRIMASK(primask);
+    (void)adcTrigger_setExpression(&trigger_expr);
+  }
+  if (text != expr_text) {
+    memset(expr_text, 0, sizeof(expr_text));
+    strncpy(expr_text, text, sizeof(expr_text) - 1U);
+  }
+  if (state == ADC_TRIGGER_STATE_ARMED) {
+    adcTrigger_arm();
+  }
+  return HAL_OK;
+}
+
+/**
+  * @brief "expr [+ <text>|clear|set|off]": type a trigger expression in
+  *        pieces ("+" appends, with a space), compile and install it with
+  *        "set", remove it with "off"; alone, the installed one and its
+  *        counters as a text line
+  */
+static HAL_StatusTypeDef App_CmdExpr(uint32_t argc, char *argv[], void *ctx)
+{
+  char line[TRIGGER_EXPR_TEXT_MAX + 96U];
+
+  UNUSED(ctx);
+  if (argc == 1U) {
+    int len = (expr_text[0] == '\0')
+                  ? snprintf(line, sizeof(line), "EXPR none\r\n")
+                  : snprintf(line, sizeof(line),
+                             "EXPR \"%s\" ops=%u channels=0x%02lX "
+                             "hold_ms=%lu evaluations=%lu fired=%lu\r\n",
+                             expr_text, trigger_expr.op_count,
+                             (unsigned long)trigger_expr.channel_mask,
+                             (unsigned long)trigger_expr.hold_ms,
+                             (unsigned long)trigger_expr.evaluations,
+                             (unsigned long)trigger_expr.fired);
+    if (len > 0 && (size_t)len < sizeof(line)) {
+      telemetry_send((const uint8_t *)line, (uint16_t)len);
+    }
+    return HAL_OK;
+  }
+  if (strcmp(argv[1], "+") == 0 && argc >= 3U) {
+    size_t used = strlen(expr_edit);
+    for (uint32_t i = 2; i < argc; i++) {
+      const size_t n = strlen(argv[i]);
+      if (used + n + 2U > sizeof(expr_edit)) {
+        return HAL_ERROR; // too long for a config value
+      }
+      if (used != 0U) {
+        expr_edit[used++] = ' ';
+      }
+      memcpy(&expr_edit[used], argv[i], n + 1U);
+      used += n;
+    }
+    return HAL_OK;
+  }
+  if (argc != 2U) {
+    return HAL_ERROR;
+  }
+  if (strcmp(argv[1], "clear") == 0) {
+    expr_edit[0] = '\0';
+    return HAL_OK;
+  }
+  if (strcmp(argv[1], "off") == 0) {
+    const HAL_StatusTypeDef status = App_SetExpression("", NULL);
+    if (status == HAL_OK) {
+      App_SaveSettings();
+    }
+    return status;
+  }
+  if (strcmp(argv[1], "set") != 0 || expr_edit[0] == '\0') {
+    return HAL_ERROR;
+  }
+  TriggerExpr_Error_t err = {0};
+  const HAL_StatusTypeDef status = App_SetExpression(expr_edit, &err);
+  if (status == HAL_ERROR && err.reason != NULL) {
+    // Where it stopped, so the host can point at it
+    const int len = snprintf(line, sizeof(line), "EXPR err at=%u %s\r\n",
+                             err.position, err.reason);
+    if (len > 0 && (size_t)len < sizeof(line)) {
+      telemetry_send((const uint8_t *)line, (uint16_t)len);
+    }
+  }
+  if (status != HAL_OK) {
+    return status;
+  }
+  expr_edit[0] = '\0';
+  App_SaveSettings();
+  return HAL_OK;
+}
+
+/**
+  * @brief "report full|exception|score": a stats packet per window, only
+  *        the channel features that moved beyond their dead-band (and a
+  *        whole record per channel every REPORT_HEARTBEAT_MS), or an
+  *        anomaly packet every ANOMALY_CADENCE windows. Repeating
+  *        "report exception" resends every whole record.
+  */
+static HAL_StatusTypeDef App_CmdReport(uint32_t argc, char *argv[], void *ctx)
+{
+  UNUSED(ctx);
+  if (argc != 2U) {
+    return HAL_ERROR;
+  }
+  if (strcmp(argv[1], "full") == 0) {
+    report_mode = REPORT_FULL;
+  } else if (strcmp(argv[1], "exception") == 0) {
+    report_mode = REPORT_EXCEPTION;
+    telemetryFrame_resetException(&report_state);
+  } else if (strcmp(argv[1], "score") == 0) {
+    report_mode = REPORT_SCORE;
+  } else {
+    return HAL_ERROR;
+  }
+  App_SaveSettings();
+  return HAL_OK;
+}
+
+/**
+  * @brief "features binary|cbor": encoding of the stats, spectrum and
+  *        velocity packets
+  */
+static HAL_StatusTypeDef App_CmdFeatures(uint32_t argc, char *argv[],
+                                         void *ctx)
+{
+  UNUSED(ctx);
+  if (argc != 2U) {
+    return HAL_ERROR;
+  }
+  if (strcmp(argv[1], "binary") == 0) {
+    feature_cbor = 0;
+  } else if (strcmp(argv[1], "cbor") == 0) {
+    feature_cbor = 1;
+  } else {
+    return HAL_ERROR;
+  }
+  App_SaveSettings();
+  return HAL_OK;
+}
+
+/**
+  * @brief Build the log band table for log_bands_fraction at the vibration
+  *        rate and attach it to the vibration spectra, or detach it
+  */
+static void App_ApplyLogBands(void)
+{
+  const DSP_BandTable_t *tbl = NULL;
+  if (log_bands_fraction != 0U &&
+      dspBands_initFractional(&log_bands, log_bands_fraction,
+                              LOG_BANDS_LOW_HZ, LOG_BANDS_HIGH_HZ,
+                              VIBRATION_FFT_LENGTH,
+                              vibration[0].cfg.sample_rate_hz) == HAL_OK) {
+    tbl = &log_bands;
+  }
+  // Read by the publish step, in this same main loop context
+  for (uint8_t i = 0; i < VIBRATION_CHANNELS; i++) {
+    vibration[i].cfg.band_table = tbl;
+    // The stored baseline if it was learned on the same bands, else learn
+    DSP_BaselineRecord_t rec;
+    const uint16_t len = (uint16_t)DSP_BASELINE_RECORD_SIZE(log_bands.count);
+    dspBaseline_reset(&baseline[i], log_bands.fraction,
+                      (tbl != NULL) ? log_bands.count : 0U);
+    if (tbl != NULL &&
+        configStore_get((ConfigStore_Key_t)(CONFIG_KEY_BASELINE_0 + i),
+                        SETTINGS_VERSION, &rec, len) == HAL_OK) {
+      (void)dspBaseline_load(&baseline[i], &rec, len);
+    }
+  }
+}
+
+/**
+  * @brief "bands off|octave|third": log band levels after each vibration
+  *        spectrum packet
+  */
+static HAL_StatusTypeDef App_CmdBands(uint32_t argc, char *argv[], void *ctx)
+{
+  UNUSED(ctx);
+  if (argc != 2U) {
+    return HAL_ERROR;
+  }
+  if (strcmp(argv[1], "off") == 0) {
+    log_bands_fraction = 0;
+  } else if (strcmp(argv[1], "octave") == 0) {
+    log_bands_fraction = DSP_BANDS_OCTAVE;
+  } else if (strcmp(argv[1], "third") == 0) {
+    log_bands_fraction = DSP_BANDS_THIRD_OCTAVE;
+  } else {
+    return HAL_ERROR;
+  }
+  App_ApplyLogBands();
+  App_SaveSettings();
+  return HAL_OK;
+}
+
+/**
+  * @brief Set the cepstrum search of the vibration spectra
+  *
+  * @return HAL_ERROR if they refuse it (too many peaks, a bad range)
+  */
+static HAL_StatusTypeDef App_ApplyCepstrum(void)
+{
+  // Read by the cepstrum step, in this same main loop context
+  for (uint8_t i = 0; i < VIBRATION_CHANNELS; i++) {
+    if (dspSpectrum_setCepstrum(&vibration[i], cepstrum_peaks,
+                                (float32_t)cepstrum_min_ms,
+                                (float32_t)cepstrum_max_ms) != HAL_OK) {
+      return HAL_ERROR;
+    }
+  }
+  return HAL_OK;
+}
+
+/**
+  * @brief "cepstrum off|<peaks> [<min_ms> <max_ms>]": the largest power
+  *        cepstrum peaks of each vibration spectrum (gear sideband
+  *        families), 1..4, in a cepstrum packet after the spectrum packet;
+  *        max_ms 0 searches to half the window
+  */
+static HAL_StatusTypeDef App_CmdCepstrum(uint32_t argc, char *argv[],
+                                         void *ctx)
+{
+  // Without a range the one set stays
+  unsigned long value[3] = {0, cepstrum_min_ms, cepstrum_max_ms};
+  char *end = NULL;
+
+  UNUSED(ctx);
+  if (argc != 2U && argc != 4U) {
+    return HAL_ERROR;
+  }
+  if (argc != 2U || strcmp(argv[1], "off") != 0) {
+    for (uint32_t i = 1; i < argc; i++) {
+      value[i - 1U] = strtoul(argv[i], &end, 10);
+      if (end == argv[i] || *end != '\0' || value[i - 1U] > UINT8_MAX) {
+        return HAL_ERROR;
+      }
+    }
+    if (value[0] == 0UL || value[0] > DSP_SPECTRUM_MAX_CEPSTRUM) {
+      return HAL_ERROR;
+    }
+  }
+
+  const uint8_t previous[3] = {cepstrum_peaks, cepstrum_min_ms,
+                               cepstrum_max_ms};
+  cepstrum_peaks = (uint8_t)value[0];
+  cepstrum_min_ms = (uint8_t)value[1];
+  cepstrum_max_ms = (uint8_t)value[2];
+  if (App_ApplyCepstrum() != HAL_OK) {
+    cepstrum_peaks = previous[0];
+    cepstrum_min_ms = previous[1];
+    cepstrum_max_ms = previous[2];
+    (void)App_ApplyCepstrum();
+    return HAL_ERROR;
+  }
+  App_SaveSettings();
+  return HAL_OK;
+}
+
+#if TACH_ENABLE
+/**
+  * @brief "tsa off|<revolutions>": average that many order-tracked
+  *        revolutions of the order channel per set of TSA packets
+  */
+static HAL_StatusTypeDef App_CmdTsa(uint32_t argc, char *argv[], void *ctx)
+{
+  unsigned long revs = 0;
+  char *end = NULL;
+
+  UNUSED(ctx);
+  if (argc != 2U) {
+    return HAL_ERROR;
+  }
+  if (strcmp(argv[1], "off") != 0) {
+    revs = strtoul(argv[1], &end, 10);
+    if (end == argv[1] || *end != '\0' || revs == 0UL || revs > UINT16_MAX) {
+      return HAL_ERROR;
+    }
+  }
+  tsa_revolutions = (uint16_t)revs;
+  // Off: detached, the sums wait; on: a fresh average of the new length
+  if (revs != 0UL) {
+    (void)dspTsa_setRevolutions(&tsa, tsa_revolutions);
+  }
+  (void)dspOrder_attachTsa(&order, (revs != 0UL) ? &tsa : NULL);
+  App_SaveSettings();
+  return HAL_OK;
+}
+#endif
+
+/**
+  * @brief "baseline [learn|save|gate on|off]": learn the spectral baselines
+  *        again, store them as they are now, or send bands packets only
+  *        while a channel alarms; no argument sends each channel's state
+  */
+static HAL_StatusTypeDef App_CmdBaseline(uint32_t argc, char *argv[],
+                                         void *ctx)
+{
+  UNUSED(ctx);
+  if (argc == 1U) {
+    for (uint8_t i = 0; i < VIBRATION_CHANNELS; i++) {
+      App_SendBaseline(i, vibration[i].result.sequence, DSP_BASELINE_NONE);
+    }
+    return HAL_OK;
+  }
+  if (argc == 2U && strcmp(argv[1], "learn") == 0) {
+    for (uint8_t i = 0; i < VIBRATION_CHANNELS; i++) {
+      dspBaseline_reset(&baseline[i], baseline[i].fraction,
+                        baseline[i].band_count);
+    }
+    return HAL_OK;
+  }
+  if (argc == 2U && strcmp(argv[1], "save") == 0) {
+    for (uint8_t i = 0; i < VIBRATION_CHANNELS; i++) {
+      App_SaveBaseline(i);
+    }
+    return HAL_OK;
+  }
+  if (argc == 3U && strcmp(argv[1], "gate") == 0) {
+    if (strcmp(argv[2], "on") == 0) {
+      baseline_gate = 1;
+    } else if (strcmp(argv[2], "off") == 0) {
+      baseline_gate = 0;
+    } else {
+      return HAL_ERROR;
+    }
+    App_SaveSettings();
+    return HAL_OK;
+  }
+  return HAL_ERROR;
+}
+
+/**
+  * @brief "ascii on|off": filtered frames as text lines instead of samples
+  *        packets (bring-up, not saved)
+  */
+static HAL_StatusTypeDef App_CmdAscii(uint32_t argc, char *argv[], void *ctx)
+{
+  UNUSED(ctx);
+  if (argc != 2U) {
+    return HAL_ERROR;
+  }
+  if (strcmp(argv[1], "on") == 0) {
+    ascii_stream = 1;
+  } else if (strcmp(argv[1], "off") == 0) {
+    ascii_stream = 0;
+  } else {
+    return HAL_ERROR;
+  }
+  telemetryFrame_initBatch(&batch, stream_mask);
+  return HAL_OK;
+}
+
+#if DSP_DESKEW_ENABLE
+/**
+  * @brief DSKW line: switch, rate, frames filtered and each channel's
+  *        compensated delay in thousandths of a frame
+  */
+static void App_ReportDeskew(void)
+{
+  char line[128];
+  int len = snprintf(line, sizeof(line), "DSKW on=%u rate=%lu frames=%lu",
+                     deskew_on, (unsigned long)deskew.rate_hz,
+                     (unsigned long)deskew.samples);
+  for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT && len > 0 &&
+                       (size_t)len < sizeof(line);
+       ch++) {
+    len += snprintf(&line[len], sizeof(line) - (size_t)len, " ch%u=%ld", ch,
+                    (long)lroundf(dspDeskew_getDelay(&deskew, ch) * 1000.0f));
+  }
+  if (len > 0 && (size_t)len < sizeof(line) - 2U) {
+    memcpy(&line[len], "\r\n", 3U);
+    telemetry_send((const uint8_t *)line, (uint16_t)strlen(line));
+  }
+}
+#endif
+
+/**
+  * @brief "deskew [on|off]": align the channels on the frame trigger ahead
+  *        of every consumer, or the delays compensated (not saved)
+  */
+static HAL_StatusTypeDef App_CmdDeskew(uint32_t argc, char *argv[], void *ctx)
+{
+  UNUSED(ctx);
+#if DSP_DESKEW_ENABLE
+  if (argc == 1U) {
+    App_ReportDeskew();
+    return HAL_OK;
+  }
+  if (argc != 2U) {
+    return HAL_ERROR;
+  }
+  if (strcmp(argv[1], "on") == 0) {
+    if (!deskew_on) {
+      deskew.primed = 0; // the ISR leaves it alone while off
+      deskew_on = 1;
+    }
+  } else if (strcmp(argv[1], "off") == 0) {
+    deskew_on = 0;
+  } else {
+    return HAL_ERROR;
+  }
+  App_ApplyBlockFilter();
+  return HAL_OK;
+#else
+  UNUSED(argc);
+  UNUSED(argv);
+  return HAL_ERROR;
+#endif
+}
+
+/**
+  * @brief FFTS line: policy, FFT steps and segments, drops, the busiest
+  *        pass (steps, us), the longest step, the worst segment wait and
+  *        the worst DMA -> consumer latency
+  */
+static void App_ReportFft(void)
+{
+  FftSched_Stats_t st;
+  LatencyHist_Summary_t consumer;
+  uint32_t pass_us = 0;
+  uint32_t step_us = 0;
+  uint32_t wait_us = 0;
+  char line[160];
+
+  (void)fftSched_getStats(&fft_sched, &st, &pass_us, &step_us, &wait_us);
+  if (latencyHist_getSummary(LATENCY_HIST_DMA_CONSUMER, &consumer) !=
+      HAL_OK) {
+    consumer.max = 0;
+  }
+  const int len = snprintf(
+      line, sizeof(line),
+      "FFTS mode=%s passes=%lu steps=%lu segments=%lu overruns=%lu "
+      "peak_steps=%u peak_pass_us=%lu peak_step_us=%lu wait_max_us=%lu "
+      "consumer_max_us=%lu\r\n",
+      (fft_sched.mode == FFT_SCHED_BURST) ? "burst" : "spread",
+      (unsigned long)st.passes, (unsigned long)st.steps,
+      (unsigned long)st.segments, (unsigned long)st.overruns, st.peak_steps,
+      (unsigned long)pass_us, (unsigned long)step_us,
+      (unsigned long)wait_us, (unsigned long)(consumer.max / 1000U));
+  if (len > 0) {
+    telemetry_send((const uint8_t *)line, (uint16_t)strlen(line));
+  }
+}
+
+/**
+  * @brief "fft [spread|burst|reset]": the FFT pacing policy (not saved),
+  *        clear its peaks, or the FFTS line
+  */
+static HAL_StatusTypeDef App_CmdFft(uint32_t argc, char *argv[], void *ctx)
+{
+  UNUSED(ctx);
+  if (argc == 1U) {
+    App_ReportFft();
+    return HAL_OK;
+  }
+  if (argc != 2U) {
+    return HAL_ERROR;
+  }
+  if (strcmp(argv[1], "spread") == 0) {
+    return fftSched_setMode(&fft_sched, FFT_SCHED_SPREAD);
+  }
+  if (strcmp(argv[1], "burst") == 0) {
+    return fftSched_setMode(&fft_sched, FFT_SCHED_BURST);
+  }
+  if (strcmp(argv[1], "reset") == 0) {
+    fftSched_resetStats(&fft_sched);
+    return HAL_OK;
+  }
+  return HAL_ERROR;
+}
+
+/**
+  * @brief "budget alarm|control|bulk <pct>": bandwidth share of a TX class,
+  *        0 = unlimited
+  */
+static HAL_StatusTypeDef App_CmdBudget(uint32_t argc, char *argv[], void *ctx)
+{
+  static const char *const classes[TELEMETRY_CLASS_COUNT] = {
+      "alarm", "control", "bulk"};
+  char *end = NULL;
+  UNUSED(ctx);
+  if (argc != 3U) {
+    return HAL_ERROR;
+  }
+  uint8_t c = 0;
+  while (c < TELEMETRY_CLASS_COUNT && strcmp(argv[1], classes[c]) != 0) {
+    c++;
+  }
+  const unsigned long pct = strtoul(argv[2], &end, 10);
+  if (c == TELEMETRY_CLASS_COUNT || end == argv[2] || *end != '\0' ||
+      pct > 100UL) {
+    return HAL_ERROR;
+  }
+  const Telemetry_Budget_t budget = {.share_pct = (uint8_t)pct,
+                                     .burst_bytes = LINK_BULK_BURST};
+  return telemetry_setBudget((Telemetry_Class_t)c, &budget);
+}
+
+/**
+  * @brief "stats": settings and link counters, then the profiler and boot
+  *        reports
+  */
+static HAL_StatusTypeDef App_CmdStats(uint32_t argc, char *argv[], void *ctx)
+{
+  Telemetry_Stats_t tx;
+  HostCmd_Stats_t rx;
+  char line[160];
+
+  UNUSED(argc);
+  UNUSED(argv);
+  UNUSED(ctx);
+  telemetry_getStats(&tx);
+  hostCmd_getStats(&rx);
+  int len = snprintf(line, sizeof(line),
+                     "STAT rate=%lu mask=0x%02lx stages=0x%02x codec=%u "
+                     "capture=%u report=%u cbor=%u tx=%lu drop=%lu "
+                     "cmds=%lu fail=%lu\r\n",
+                     (unsigned long)scan_rate_hz, (unsigned long)stream_mask,
+                     block_stages, codec_stream, capture_enabled,
+                     report_mode, feature_cbor,
+                     (unsigned long)tx.sent, (unsigned long)tx.dropped,
+                     (unsigned long)rx.commands, (unsigned long)rx.failed);
+  if (len > 0) {
+    telemetry_send((const uint8_t *)line, (uint16_t)strlen(line));
+  }
+  len = snprintf(line, sizeof(line),
+                 "UART transfers=%lu batched=%lu high=%lu errors=%lu\r\n",
+                 (unsigned long)tx.transfers, (unsigned long)tx.batched,
+                 (unsigned long)tx.high_water, (unsigned long)tx.tx_errors);
+  if (len > 0) {
+    telemetry_send((const uint8_t *)line, (uint16_t)strlen(line));
+  }
+  // Queue depth and losses per class, and the stream's back-pressure level
+  static const char *const class_names[TELEMETRY_CLASS_COUNT] = {
+      "alarm", "control", "bulk"};
+  for (uint8_t c = 0; c < TELEMETRY_CLASS_COUNT; c++) {
+    Telemetry_ClassStats_t cls;
+    (void)telemetry_getClassStats((Telemetry_Class_t)c, &cls);
+    len = snprintf(line, sizeof(line),
+                   "QOS %s queued=%lu high=%lu sent=%lu drop=%lu "
+                   "throttled=%lu degrade=%u\r\n",
+                   class_names[c], (unsigned long)cls.queued,
+                   (unsigned long)cls.high_water, (unsigned long)cls.sent,
+                   (unsigned long)cls.dropped, (unsigned long)cls.throttled,
+                   (c == TELEMETRY_CLASS_BULK) ? stream_degrade : 0U);
+    if (len > 0) {
+      telemetry_send((const uint8_t *)line, (uint16_t)strlen(line));
+    }
+  }
+  // Stage deadlines: worst finish after the block's arrival, misses, sheds
+  for (uint8_t i = 0; i < DEADLINE_COUNT; i++) {
+    StageDeadline_Stats_t dl;
+    (void)stageDeadline_getStats(&deadlines, i, &dl);
+    len = snprintf(line, sizeof(line),
+                   "DEADLINE %s deadline_us=%lu worst_us=%lu misses=%lu "
+                   "sheds=%lu shed=%u\r\n",
+                   deadline_table[i].name, (unsigned long)dl.deadline_us,
+                   (unsigned long)dl.worst_us, (unsigned long)dl.misses,
+                   (unsigned long)dl.sheds, dl.shed);
+    if (len > 0) {
+      telemetry_send((const uint8_t *)line, (uint16_t)strlen(line));
+    }
+  }
+  // Ring cursors: how far each consumer is behind the scan, and its losses
+  for (uint8_t i = 0; i < ADC_RING_MAX_CONSUMERS; i++) {
+    ADC_RingConsumerStats_t rc;
+    if (adcRing_getConsumerStats(i, &rc) != HAL_OK || !rc.active) {
+      continue;
+    }
+    len = snprintf(line, sizeof(line),
+                   "RING id=%u required=%u lag=%lu max_lag=%lu overruns=%lu "
+                   "lost=%lu\r\n",
+                   i, rc.required, (unsigned long)rc.lag,
+                   (unsigned long)rc.max_lag, (unsigned long)rc.overruns,
+                   (unsigned long)rc.lost);
+    if (len > 0) {
+      telemetry_send((const uint8_t *)line, (uint16_t)strlen(line));
+    }
+  }
+  App_ReportPreset();
+  // Captures taken out of the scan: transition times against one frame
+  ADC_SwitchInfo_t sw;
+  if (analogSensor_getSwitchInfo(&sw) == HAL_OK &&
+      (sw.switches | sw.failures) != 0U) {
+    len = snprintf(line, sizeof(line),
+                   "MODE switches=%lu failures=%lu enter_us=%lu/%lu "
+                   "leave_us=%lu/%lu target_us=%lu over=%lu\r\n",
+                   (unsigned long)sw.switches, (unsigned long)sw.failures,
+                   (unsigned long)sw.enter_us, (unsigned long)sw.enter_max_us,
+                   (unsigned long)sw.leave_us, (unsigned long)sw.leave_max_us,
+                   (unsigned long)sw.frame_period_us,
+                   (unsigned long)sw.over_target);
+    if (len > 0) {
+      telemetry_send((const uint8_t *)line, (uint16_t)strlen(line));
+    }
+  }
+  if (report_mode == REPORT_EXCEPTION) {
+    len = snprintf(line, sizeof(line),
+                   "RBE features=%lu/%lu packets=%lu heartbeat=%lu\r\n",
+                   (unsigned long)report_state.reported,
+                   (unsigned long)report_state.evaluated,
+                   (unsigned long)report_state.packets,
+                   (unsigned long)REPORT_HEARTBEAT_MS);
+    if (len > 0) {
+      telemetry_send((const uint8_t *)line, (uint16_t)strlen(line));
+    }
+  }
+  ConfigStore_Stats_t store;
+  if (configStore_getStats(&store) == HAL_OK) {
+    len = snprintf(line, sizeof(line),
+                   "CFG gen=%lu used=%lu pending=%u records=%lu compact=%lu "
+                   "deferred=%lu errors=%lu\r\n",
+                   (unsigned long)store.generation,
+                   (unsigned long)store.used_bytes, configStore_isPending(),
+                   (unsigned long)store.records,
+                   (unsigned long)store.compactions,
+                   (unsigned long)store.deferred,
+                   (unsigned long)store.errors);
+    if (len > 0) {
+      telemetry_send((const uint8_t *)line, (uint16_t)strlen(line));
+    }
+  }
+#if ETH_STREAM_ENABLE && PTP_SYNC_ENABLE
+  PtpSync_Status_t ptp;
+  if (ptpSync_getStatus(&ptp) == HAL_OK) {
+    len = snprintf(line, sizeof(line),
+                   "PTP state=%u offset=%ld delay=%ld ppb=%ld syncs=%lu "
+                   "steps=%lu lost=%lu\r\n",
+                   (unsigned)ptp.state, (long)ptp.offset_ns,
+                   (long)ptp.path_delay_ns, (long)ptp.freq_ppb,
+                   (unsigned long)ptp.syncs, (unsigned long)ptp.steps,
+                   (unsigned long)ptp.timeouts);
+    if (len > 0) {
+      telemetry_send((const uint8_t *)line, (uint16_t)strlen(line));
+    }
+  }
+#endif
+  SwoTrace_Stats_t trace;
+  if (swoTrace_getBaud() != 0U && swoTrace_getStats(&trace) == HAL_OK) {
+    len = snprintf(line, sizeof(line),
+                   "SWO baud=%lu ports=0x%02lx events=%lu markers=%lu "
+                   "blocks=%lu drop=%lu/%lu\r\n",
+                   (unsigned long)swoTrace_getBaud(),
+                   (unsigned long)swoTrace_getPorts(),
+                   (unsigned long)trace.events, (unsigned long)trace.markers,
+                   (unsigned long)trace.blocks,
+                   (unsigned long)trace.dropped_events,
+                   (unsigned long)trace.dropped_blocks);
+    if (len > 0) {
+      telemetry_send((const uint8_t *)line, (uint16_t)strlen(line));
+    }
+  }
+#if PWM_SYNC_ENABLE
+  len = snprintf(line, sizeof(line), "PWM rate=%lu phase=%ld trigger=%u\r\n",
+                 (unsigned long)pwmSync_getRate(), (long)pwmSync_getPhase(),
+                 (unsigned)analogSensor_getScanTrigger());
+  if (len > 0) {
+    telemetry_send((const uint8_t *)line, (uint16_t)strlen(line));
+  }
+#endif
+#if INTERLOCK_ENABLE
+  Interlock_Stats_t lock;
+  if (interlock_getStats(&lock) == HAL_OK) {
+    len = snprintf(line, sizeof(line),
+                   "ILCK tripped=%u ch=%u trips=%lu alarms=%lu cycles=%lu/%lu "
+                   "trigger_ns=%lu/%lu\r\n",
+                   lock.tripped, lock.channel, (unsigned long)lock.trips,
+                   (unsigned long)lock.alarms,
+                   (unsigned long)lock.last_cycles,
+                   (unsigned long)lock.max_cycles,
+                   (unsigned long)lock.last_trigger_ns,
+                   (unsigned long)lock.max_trigger_ns);
+    if (len > 0) {
+      telemetry_send((const uint8_t *)line, (uint16_t)strlen(line));
+    }
+  }
+#endif
+#if DSP_DESPIKE_ENABLE
+  uint32_t spikes = 0;
+  uint32_t spikes_max = 0;
+  uint8_t spikes_ch = 0;
+  for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+    const uint32_t n = dspDespike_getReplaced(&despike, ch);
+    spikes += n;
+    if (n > spikes_max) {
+      spikes_max = n;
+      spikes_ch = ch;
+    }
+  }
+  len = snprintf(line, sizeof(line),
+                 "SPIK on=%u taps=%u thr=%u frames=%lu replaced=%lu "
+                 "worst=ch%u/%lu\r\n",
+                 (block_stages & STAGE_DESPIKE) ? 1U : 0U, DESPIKE_TAPS,
+                 DESPIKE_THRESHOLD_CODES, (unsigned long)despike.samples,
+                 (unsigned long)spikes, spikes_ch,
+                 (unsigned long)spikes_max);
+  if (len > 0) {
+    telemetry_send((const uint8_t *)line, (uint16_t)strlen(line));
+  }
+#endif
+#if DSP_DESKEW_ENABLE
+  App_ReportDeskew();
+#endif
+  App_ReportFft();
+#if ADC_CONVERSIONS_CLIP_DETECT
+  ADC_ClipStats_t clip[ADC_CONVERSIONS_CHANNEL_COUNT];
+  if (analogSensor_getClipStats(clip, 0) == HAL_OK) {
+    uint32_t clip_samples = 0;
+    uint32_t clip_episodes = 0;
+    uint32_t clip_active = 0;
+    uint8_t clip_ch = 0;
+    for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+      clip_samples += clip[ch].samples;
+      clip_episodes += clip[ch].episodes;
+      clip_active |= (uint32_t)clip[ch].active << ch;
+      if (clip[ch].samples > clip[clip_ch].samples) {
+        clip_ch = ch;
+      }
+    }
+    len = snprintf(line, sizeof(line),
+                   "CLIP samples=%lu episodes=%lu blocks=%lu active=0x%lx "
+                   "worst=ch%u/%lu\r\n",
+                   (unsigned long)clip_samples, (unsigned long)clip_episodes,
+                   (unsigned long)clipped_blocks, (unsigned long)clip_active,
+                   clip_ch, (unsigned long)clip[clip_ch].samples);
+    if (len > 0) {
+      telemetry_send((const uint8_t *)line, (uint16_t)strlen(line));
+    }
+  }
+#endif
+#if TACH_ENABLE
+  Tach_Stats_t tach;
+  DSP_OrderStatus_t ord;
+  if (tach_getStats(&tach) == HAL_OK &&
+      dspOrder_getStatus(&order, &ord) == HAL_OK) {
+    len = snprintf(line, sizeof(line),
+                   "TACH rpm=%lu edges=%lu glitch=%lu drop=%lu revs=%lu "
+                   "samples=%lu gaps=%lu stale=%lu tsa_revs=%lu "
+                   "tsa_rejected=%lu\r\n",
+                   (unsigned long)tach_getRpm(), (unsigned long)tach.edges,
+                   (unsigned long)tach.glitches,
+                   (unsigned long)(tach.dropped + ord.dropped_edges),
+                   (unsigned long)ord.revolutions, (unsigned long)ord.samples,
+                   (unsigned long)ord.gaps, (unsigned long)ord.stale,
+                   (unsigned long)tsa.total,
+                   (unsigned long)tsa.total_rejected);
+    if (len > 0) {
+      telemetry_send((const uint8_t *)line, (uint16_t)strlen(line));
+    }
+  }
+#endif
+#if EXT_ADC_ENABLE
+  ExtAdc_Stats_t ext;
+  if (extAdc_getStats(&ext) == HAL_OK) {
+    len = snprintf(line, sizeof(line),
+                   "EXT run=%u max=%lu blocks=%lu misaligned=%lu ovr=%lu "
+                   "dma=%lu drop=%lu\r\n",
+                   ext.running, (unsigned long)extAdc_getMaxFrameRate(),
+                   (unsigned long)ext.blocks, (unsigned long)ext.misaligned,
+                   (unsigned long)ext.overruns, (unsigned long)ext.dma_errors,
+                   (unsigned long)ext_dropped);
+    if (len > 0) {
+      telemetry_send((const uint8_t *)line, (uint16_t)strlen(line));
+    }
+  }
+#endif
+#if ADC_MUX_ENABLE
+  App_ReportMux();
+#endif
+  App_ReportMemory();
+  App_ReportEnergy();
+#if CAN_BUS_ENABLE
+  CanBus_Stats_t can;
+  if (canBus_getStats(&can) == HAL_OK) {
+    len = snprintf(line, sizeof(line),
+                   "CAN node=%u mask=0x%02x queued=%lu drop=%lu preempt=%lu "
+                   "txerr=%lu cmd=%lu rxovr=%lu busoff=%lu tec=%u rec=%u\r\n",
+                   (unsigned)CAN_BUS_NODE_ID, can.mask,
+                   (unsigned long)can.queued, (unsigned long)can.dropped,
+                   (unsigned long)can.preempted, (unsigned long)can.tx_errors,
+                   (unsigned long)can.commands, (unsigned long)can.rx_overruns,
+                   (unsigned long)can.bus_off, can.tec, can.rec);
+    if (len > 0) {
+      telemetry_send((const uint8_t *)line, (uint16_t)strlen(line));
+    }
+    static const char *const can_class[CAN_BUS_CLASS_COUNT] = {
+        "alarm", "feature", "status"};
+    for (uint8_t c = 0; c < CAN_BUS_CLASS_COUNT; c++) {
+      const CanBus_Latency_t *lat = &can.latency[c];
+      const uint32_t mean_us =
+          (lat->sent == 0U) ? 0U : (uint32_t)(lat->sum_us / lat->sent);
+      len = snprintf(line, sizeof(line),
+                     "CAN lat class=%s sent=%lu min_us=%lu mean_us=%lu "
+                     "max_us=%lu\r\n",
+                     can_class[c], (unsigned long)lat->sent,
+                     (unsigned long)lat->min_us, (unsigned long)mean_us,
+                     (unsigned long)lat->max_us);
+      if (len > 0) {
+        telemetry_send((const uint8_t *)line, (uint16_t)strlen(line));
+      }
+    }
+  }
+#endif
+#if MODBUS_SERVER_ENABLE
+  ModbusServer_Stats_t mb;
+  if (modbusServer_getStats(&mb) == HAL_OK) {
+    const uint32_t cyc_us = SystemCoreClock / 1000000U;
+    const uint32_t mean_ns =
+        (mb.measured == 0U)
+            ? 0U
+            : (uint32_t)(mb.turn_sum_cyc * 1000U / mb.measured / cyc_us);
+    len = snprintf(line, sizeof(line),
+                   "MODBUS addr=%u req=%lu reply=%lu exc=%lu bcast=%lu "
+                   "bad=%lu uart=%lu\r\n",
+                   (unsigned)MODBUS_SERVER_ADDRESS, (unsigned long)mb.requests,
+                   (unsigned long)mb.replies, (unsigned long)mb.exceptions,
+                   (unsigned long)mb.broadcasts, (unsigned long)mb.bad_frames,
+                   (unsigned long)mb.uart_errors);
+    if (len > 0) {
+      telemetry_send((const uint8_t *)line, (uint16_t)strlen(line));
+    }
+    len = snprintf(line, sizeof(line),
+                   "MODBUS turn min_ns=%lu mean_ns=%lu max_ns=%lu "
+                   "reply_max_us=%lu\r\n",
+                   (unsigned long)(mb.turn_min_cyc * 1000U / cyc_us),
+                   (unsigned long)mean_ns,
+                   (unsigned long)(mb.turn_max_cyc * 1000U / cyc_us),
+                   (unsigned long)mb.reply_max_us);
+    if (len > 0) {
+      telemetry_send((const uint8_t *)line, (uint16_t)strlen(line));
+    }
+  }
+#endif
+#if TDMA_BUS_ENABLE
+  TdmaBus_Stats_t tdma;
+  if (tdmaBus_getStats(&tdma) == HAL_OK) {
+    len = snprintf(line, sizeof(line),
+                   "TDMA addr=%u run=%u lock=%u nodes=%u present=0x%02X "
+                   "slot=%u cap=%u cycle_us=%lu\r\n",
+                   (unsigned)TDMA_BUS_ADDRESS, (unsigned)tdma.running,
+                   (unsigned)tdma.locked, (unsigned)tdma.nodes,
+                   (unsigned)tdma.present_mask, (unsigned)tdma.slot_frames,
+                   (unsigned)tdma.capacity, (unsigned long)tdma.cycle_us);
+    if (len > 0) {
+      telemetry_send((const uint8_t *)line, (uint16_t)strlen(line));
+    }
+    len = snprintf(line, sizeof(line),
+                   "TDMA cycles=%lu frames=%lu hb=%lu missed=%lu late=%lu "
+                   "bad=%lu\r\n",
+                   (unsigned long)tdma.cycles, (unsigned long)tdma.frames,
+                   (unsigned long)tdma.heartbeats, (unsigned long)tdma.missed,
+                   (unsigned long)tdma.late, (unsigned long)tdma.bad_frames);
+    if (len > 0) {
+      telemetry_send((const uint8_t *)line, (uint16_t)strlen(line));
+    }
+    len = snprintf(line, sizeof(line),
+                   "TDMA ovr=%lu uart=%lu resync=%lu mismatch=%lu hold=%lu "
+                   "drop=%lu\r\n",
+                   (unsigned long)tdma.overruns,
+                   (unsigned long)tdma.uart_errors,
+                   (unsigned long)tdma.resyncs, (unsigned long)tdma.mismatches,
+                   (unsigned long)tdma.holdovers, (unsigned long)tdma.dropped);
+    if (len > 0) {
+      telemetry_send((const uint8_t *)line, (uint16_t)strlen(line));
+    }
+    len = snprintf(line, sizeof(line),
+                   "TDMA util last=%u.%u%% max=%u.%u%% mean=%u.%u%% "
+                   "payload_kb=%lu\r\n",
+                   tdma.util_last / 10U, tdma.util_last % 10U,
+                   tdma.util_max / 10U, tdma.util_max % 10U,
+                   tdma.util_mean / 10U, tdma.util_mean % 10U,
+                   (unsigned long)(tdma.payload_bytes / 1024U));
+    if (len > 0) {
+      telemetry_send((const uint8_t *)line, (uint16_t)strlen(line));
+    }
+  }
+#endif
+#if DSP_ASRC_ENABLE
+  DSP_Asrc_Stats_t asrc;
+  if (dspAsrc_getStats(&stream_asrc, &asrc) == HAL_OK) {
+    len = snprintf(line, sizeof(line),
+                   "ASRC ppm_x100=%ld err_mframes=%ld anchors=%lu jumps=%lu "
+                   "resets=%lu skipped=%lu in=%lu out=%lu\r\n",
+                   (long)lroundf(asrc.ppm * 100.0f),
+                   (long)lroundf(asrc.error * 1000.0f),
+                   (unsigned long)asrc.anchors, (unsigned long)asrc.jumps,
+                   (unsigned long)asrc.resets, (unsigned long)asrc.skipped,
+                   (unsigned long)asrc.frames_in,
+                   (unsigned long)asrc.frames_out);
+    if (len > 0) {
+      telemetry_send((const uint8_t *)line, (uint16_t)strlen(line));
+    }
+  }
+#endif
+#if I2C_TARGET_ENABLE
+  I2cTarget_Stats_t i2c;
+  if (i2cTarget_getStats(&i2c) == HAL_OK) {
+    len = snprintf(line, sizeof(line),
+                   "I2C addr=0x%02x reads=%lu writes=%lu updates=%lu "
+                   "deferred=%lu err=%lu\r\n",
+                   (unsigned)I2C_TARGET_ADDRESS, (unsigned long)i2c.reads,
+                   (unsigned long)i2c.writes, (unsigned long)i2c.updates,
+                   (unsigned long)i2c.deferred, (unsigned long)i2c.errors);
+    if (len > 0) {
+      telemetry_send((const uint8_t *)line, (uint16_t)strlen(line));
+    }
+  }
+#endif
+  profiler_dump();
+  isrBudget_dump();
+  latencyHist_dump();
+  bootProfile_dump();
+  return HAL_OK;
+}
+
+/**
+  * @brief "retained [clear]": lifetime counters, the previous boot's
+  *        breadcrumbs and the fault records kept in the backup SRAM
+  *        (retained.h)
+  */
+static HAL_StatusTypeDef App_CmdRetained(uint32_t argc, char *argv[],
+                                         void *ctx)
+{
+  Retained_Stats_t rs;
+  Retained_Mark_t marks[RETAINED_MARKS];
+  Retained_Fault_t fault;
+  char line[128];
+  int len;
+
+  UNUSED(ctx);
+  if (argc == 2U && strcmp(argv[1], "clear") == 0) {
+    retained_clear();
+    return HAL_OK;
+  }
+  if (argc != 1U) {
+    return HAL_ERROR;
+  }
+  (void)retained_getStats(&rs);
+  len = snprintf(line, sizeof(line),
+                 "RETAINED restored=%u vbat=%u repaired=%lu boots=%lu "
+                 "csr=0x%08lx faults=%lu\r\n",
+                 rs.restored, rs.vbat, (unsigned long)rs.repaired,
+                 (unsigned long)retained_get(RETAINED_BOOTS),
+                 (unsigned long)rs.reset_flags,
+                 (unsigned long)retained_get(RETAINED_FAULTS));
+  if (len > 0) {
+    telemetry_send((const uint8_t *)line, (uint16_t)strlen(line));
+  }
+  len = snprintf(line, sizeof(line),
+                 "RETAINED reset power=%lu pin=%lu soft=%lu iwdg=%lu "
+                 "wwdg=%lu lowpower=%lu\r\n",
+                 (unsigned long)retained_get(RETAINED_RESET_POWER),
+                 (unsigned long)retained_get(RETAINED_RESET_PIN),
+                 (unsigned long)retained_get(RETAINED_RESET_SOFTWARE),
+                 (unsigned long)retained_get(RETAINED_RESET_IWDG),
+                 (unsigned long)retained_get(RETAINED_RESET_WWDG),
+                 (unsigned long)retained_get(RETAINED_RESET_LOWPOWER));
+  if (len > 0) {
+    telemetry_send((const uint8_t *)line, (uint16_t)strlen(line));
+  }
+  len = snprintf(line, sizeof(line),
+                 "RETAINED errors=%lu overrun_frames=%lu dropped=%lu\r\n",
+                 (unsigned long)retained_get(RETAINED_ERRORS),
+                 (unsigned long)retained_get(RETAINED_OVERRUN_FRAMES),
+                 (unsigned long)retained_get(RETAINED_DROPPED_BLOCKS));
+  if (len > 0) {
+    telemetry_send((const uint8_t *)line, (uint16_t)strlen(line));
+  }
+  // Where the previous boot was when it ended, oldest first
+  const uint8_t count = retained_getPreviousMarks(marks);
+  for (uint8_t i = 0; i < count; i++) {
+    len = snprintf(line, sizeof(line),
+                   "MARK seq=%u %s value=0x%08lx tick=%lu\r\n",
+                   (unsigned)marks[i].seq,
+                   retained_getMarkName((Retained_MarkId_t)marks[i].id),
+                   (unsigned long)marks[i].value,
+                   (unsigned long)marks[i].tick);
+    if (len > 0) {
+      telemetry_send((const uint8_t *)line, (uint16_t)strlen(line));
+    }
+  }
+  // Newest fault first
+  for (uint8_t i = 0; retained_getFault(i, &fault) == HAL_OK; i++) {
+    len = snprintf(line, sizeof(line),
+                   "FAULT exc=%lu boot=%lu tick=%lu pc=0x%08lx lr=0x%08lx "
+                   "cfsr=0x%08lx hfsr=0x%08lx\r\n",
+                   (unsigned long)fault.kind, (unsigned long)fault.boot,
+                   (unsigned long)fault.tick, (unsigned long)fault.pc,
+                   (unsigned long)fault.lr, (unsigned long)fault.cfsr,
+                   (unsigned long)fault.hfsr);
+    if (len > 0) {
+      telemetry_send((const uint8_t *)line, (uint16_t)strlen(line));
+    }
+    len = snprintf(line, sizeof(line),
+                   "FAULT xpsr=0x%08lx sp=0x%08lx exc_return=0x%08lx "
+                   "mmfar=0x%08lx bfar=0x%08lx\r\n",
+                   (unsigned long)fault.xpsr, (unsigned long)fault.sp,
+                   (unsigned long)fault.exc_return,
+                   (unsigned long)fault.mmfar, (unsigned long)fault.bfar);
+    if (len > 0) {
+      telemetry_send((const uint8_t *)line, (uint16_t)strlen(line));
+    }
+  }
+  return HAL_OK;
+}
+
+/**
+  * @brief "trace <port bits>": select the SWO stimulus ports (swo_trace.h)
+  */
+static HAL_StatusTypeDef App_CmdTrace(uint32_t argc, char *argv[], void *ctx)
+{
+  char *end = NULL;
+
+  UNUSED(ctx);
+  if (argc != 2U) {
+    return HAL_ERROR;
+  }
+  const unsigned long mask = strtoul(argv[1], &end, 0);
+  if (end == argv[1] || *end != '\0' || swoTrace_getBaud() == 0U) {
+    return HAL_ERROR;
+  }
+  swoTrace_setPorts((uint32_t)mask);
+  return HAL_OK;
+}
+
+/**
+  * @brief "pcs start [hz] [lr]|stop|dump": PC-sampling profiler
+  *        (pc_profile.h); the dump goes out as PCS lines
+  */
+static HAL_StatusTypeDef App_CmdPcs(uint32_t argc, char *argv[], void *ctx)
+{
+  UNUSED(ctx);
+  if (argc == 2U && strcmp(argv[1], "stop") == 0) {
+    pcProfile_stop();
+    return HAL_OK;
+  }
+  if (argc == 2U && strcmp(argv[1], "dump") == 0) {
+    pcProfile_dump();
+    return HAL_OK;
+  }
+  if (argc < 2U || argc > 4U || strcmp(argv[1], "start") != 0) {
+    return HAL_ERROR;
+  }
+  uint32_t rate_hz = PC_PROFILE_DEFAULT_HZ;
+  uint8_t flags = 0;
+  for (uint32_t i = 2; i < argc; i++) {
+    char *end = NULL;
+    if (strcmp(argv[i], "lr") == 0) {
+      flags |= PC_PROFILE_LR;
+      continue;
+    }
+    rate_hz = (uint32_t)strtoul(argv[i], &end, 10);
+    if (end == argv[i] || *end != '\0') {
+      return HAL_ERROR;
+    }
+  }
+  return pcProfile_start(rate_hz, flags);
+}
+
+/**
+  * @brief "perf <stage> [windows]|off": DWT event counters over runs of one
+  *        block stage (dwt_counters.h), a PERF line when done
+  */
+static HAL_StatusTypeDef App_CmdPerf(uint32_t argc, char *argv[], void *ctx)
+{
+  UNUSED(ctx);
+  if (argc == 2U && strcmp(argv[1], "off") == 0) {
+    dwtCounters_stop();
+    return HAL_OK;
+  }
+  if (argc < 2U || argc > 3U) {
+    return HAL_ERROR;
+  }
+  uint32_t windows = 0;
+  if (argc == 3U) {
+    char *end = NULL;
+    windows = (uint32_t)strtoul(argv[2], &end, 10);
+    if (end == argv[2] || *end != '\0' || windows == 0U) {
+      return HAL_ERROR;
+    }
+  }
+  for (uint8_t i = 0; i < DEADLINE_COUNT; i++) {
+    if (strcmp(argv[1], deadline_table[i].name) == 0) {
+      return dwtCounters_start(i, deadline_table[i].name, windows);
+    }
+  }
+  return HAL_ERROR;
+}
+
+/**
+  * @brief "dmaisr [fast|hal|reset]": scan DMA interrupt path
+  *        (analogSensor_dmaIrqFast()), or one DMAISR line per path with its
+  *        dispatch cycles to the block hand-off
+  */
+static HAL_StatusTypeDef App_CmdDmaIsr(uint32_t argc, char *argv[], void *ctx)
+{
+  static const char *const path_names[] = {"hal", "fast"};
+
+  UNUSED(ctx);
+  if (argc == 2U && strcmp(argv[1], "fast") == 0) {
+    analogSensor_setFastDmaIsr(1);
+    return HAL_OK;
+  }
+  if (argc == 2U && strcmp(argv[1], "hal") == 0) {
+    analogSensor_setFastDmaIsr(0);
+    return HAL_OK;
+  }
+  if (argc == 2U && strcmp(argv[1], "reset") == 0) {
+    analogSensor_resetDmaDispatch();
+    return HAL_OK;
+  }
+  if (argc != 1U) {
+    return HAL_ERROR;
+  }
+  for (uint8_t p = 0; p < ADC_DMA_DISPATCH_COUNT; p++) {
+    ADC_DmaDispatchStats_t stats;
+    char line[96];
+    if (analogSensor_getDmaDispatch((ADC_DmaDispatch_t)p, &stats) != HAL_OK ||
+        stats.count == 0U) {
+      continue;
+    }
+    const int len = snprintf(line, sizeof(line),
+                             "DMAISR path=%s n=%lu mean=%lu max=%lu\r\n",
+                             path_names[p], (unsigned long)stats.count,
+                             (unsigned long)(stats.total / stats.count),
+                             (unsigned long)stats.max);
+    if (len > 0) {
+      telemetry_send((const uint8_t *)line, (uint16_t)strlen(line));
+    }
+  }
+  return HAL_OK;
+}
+
+/**
+  * @brief "latency [reset]": path latency percentiles (latency_hist.h) as
+  *        LAT lines, or clear them
+  */
+static HAL_StatusTypeDef App_CmdLatency(uint32_t argc, char *argv[],
+                                        void *ctx)
+{
+  UNUSED(ctx);
+  if (argc == 1U) {
+    latencyHist_dump();
+    return HAL_OK;
+  }
+  if (argc == 2U && strcmp(argv[1], "reset") == 0) {
+    latencyHist_reset();
+    return HAL_OK;
+  }
+  return HAL_ERROR;
+}
+
+#if SCAN_JITTER_ENABLE
+/**
+  * @brief The JITTER line: trigger intervals of the window (scan_jitter.h)
+  *        next to the CPU load they were taken under
+  */
+static void App_ReportJitter(void)
+{
+  ScanJitter_Stats_t js;
+  CpuLoad_Stats_t load;
+  char line[200];
+
+  (void)scanJitter_getStats(&js);
+  (void)cpuLoad_getStats(&load);
+  const uint32_t rms_cns = (uint32_t)(js.rms_ns * 100.0f + 0.5f);
+  const uint32_t snr_ddb =
+      (js.snr_db > 0.0f) ? (uint32_t)(js.snr_db * 10.0f + 0.5f) : 0U;
+  const int len = snprintf(
+      line, sizeof(line),
+      "JITTER %s n=%lu period=%lu rms=%lu.%02lu pp=%lu ns ticks=%lu..%lu "
+      "nominal=%lu tick_hz=%lu snr=%lu.%lu dB lag=%ld overruns=%lu "
+      "load=%lu.%02lu peak=%lu.%02lu %%\r\n",
+      js.running ? "on" : "off", (unsigned long)js.intervals,
+      (unsigned long)(js.mean_ns + 0.5f), (unsigned long)(rms_cns / 100U),
+      (unsigned long)(rms_cns % 100U), (unsigned long)(js.pp_ns + 0.5f),
+      (unsigned long)js.min_ticks, (unsigned long)js.max_ticks,
+      (unsigned long)js.nominal_ticks, (unsigned long)js.tick_hz,
+      (unsigned long)(snr_ddb / 10U), (unsigned long)(snr_ddb % 10U),
+      (long)js.lag, (unsigned long)js.overruns,
+      (unsigned long)(load.load_centi_pct / 100U),
+      (unsigned long)(load.load_centi_pct % 100U),
+      (unsigned long)(load.peak_centi_pct / 100U),
+      (unsigned long)(load.peak_centi_pct % 100U));
+  if (len > 0) {
+    telemetry_send((const uint8_t *)line, (uint16_t)strlen(line));
+  }
+}
+
+/**
+  * @brief "jitter [on|off|reset]": capture the scan trigger on TIM3, stop
+  *        it, or start a new window together with the peak CPU load; the
+  *        JITTER line after each
+  */
+static HAL_StatusTypeDef App_CmdJitter(uint32_t argc, char *argv[], void *ctx)
+{
+  HAL_StatusTypeDef status = HAL_OK;
+
+  UNUSED(ctx);
+  if (argc == 2U && strcmp(argv[1], "on") == 0) {
+    status = scanJitter_start();
+  } else if (argc == 2U && strcmp(argv[1], "off") == 0) {
+    scanJitter_stop();
+  } else if (argc == 2U && strcmp(argv[1], "reset") == 0) {
+    scanJitter_resetWindow();
+    cpuLoad_resetPeak();
+  } else if (argc != 1U) {
+    return HAL_ERROR;
+  }
+  if (status == HAL_OK) {
+    App_ReportJitter();
+  }
+  return status;
+}
+#endif
+
+/**
+  * @brief Start the live scan again after polling mode or a replay
+  */
+static void App_RestartScan(void)
+{
+#if DSP_DESKEW_ENABLE
+  // A profile or clock change moved the sampling instants
+  deskew_rate_hz = scan_rate_hz;
+  App_InitDeskew();
+#endif
+  if (analogSensor_startTimedDMA(scan_rate_hz) != HAL_OK) {
+    Error_Handler();
+  }
+#if EXT_ADC_ENABLE
+  if (extAdc_start(scan_rate_hz) != HAL_OK) {
+    Error_Handler();
+  }
+#endif
+#if ADC_MUX_ENABLE
+  if (adcMux_start(scan_rate_hz) != HAL_OK) {
+    Error_Handler();
+  }
+#endif
+#if ADAPTIVE_RATE_ENABLE
+  adaptiveRate_wake(); // the scan restarted at level 0's rate
+#endif
+}
+
+/**
+  * @brief Replay result line: blocks, achieved frame rate, late blocks and
+  *        source waits
+  */
+static void App_ReportReplay(void)
+{
+  ADC_ReplayStats_t st;
+  char line[96];
+
+  analogSensor_getReplayStats(&st);
+  // elapsed_ticks spans the hand-offs, one block short of all of them
+  const uint64_t frames =
+      (uint64_t)(st.blocks - 1U) * analogSensor_getBlockFrames();
+  const uint32_t rate = (st.blocks > 1U && st.elapsed_ticks != 0U)
+                            ? (uint32_t)(frames * TIMEBASE_TICK_HZ /
+                                         st.elapsed_ticks)
+                            : 0U;
+  const int len = snprintf(line, sizeof(line),
+                           "REPLAY run=%u paced=%u blocks=%lu frames/s=%lu "
+                           "late=%lu waits=%lu\r\n",
+                           st.running, st.paced, (unsigned long)st.blocks,
+                           (unsigned long)rate, (unsigned long)st.late,
+                           (unsigned long)st.waits);
+  if (len > 0) {
+    telemetry_send((const uint8_t *)line, (uint16_t)strlen(line));
+  }
+}
+
+/**
+  * @brief "replay vector|qspi [fast] [count]|off": recorded blocks through
+  *        the pipeline in place of the ADCs (adc_replay.h); no argument
+  *        reports the current or last run
+  */
+static HAL_StatusTypeDef App_CmdReplay(uint32_t argc, char *argv[], void *ctx)
+{
+  ADC_ReplayInput_t input;
+  uint8_t paced = 1;
+  uint32_t count = 0;
+  char *end = NULL;
+
+  UNUSED(ctx);
+  if (argc == 1U) {
+    App_ReportReplay();
+    return HAL_OK;
+  }
+  if (strcmp(argv[1], "off") == 0) {
+    if (!adcReplay_isActive()) {
+      return HAL_ERROR;
+    }
+    analogSensor_stopDMA();
+    App_ReportReplay();
+    App_RestartScan();
+    return HAL_OK;
+  }
+  if (strcmp(argv[1], "vector") == 0) {
+    input = ADC_REPLAY_VECTOR;
+  } else if (strcmp(argv[1], "qspi") == 0) {
+    input = ADC_REPLAY_QSPI;
+  } else {
+    return HAL_ERROR;
+  }
+  for (uint32_t i = 2U; i < argc; i++) {
+    if (strcmp(argv[i], "fast") == 0) {
+      paced = 0;
+      continue;
+    }
+    const unsigned long n = strtoul(argv[i], &end, 10);
+    if (end == argv[i] || *end != '\0') {
+      return HAL_ERROR;
+    }
+    count = (uint32_t)n;
+  }
+  if (adcReplay_isActive() ||
+      burstCapture_getState() == BURST_CAPTURE_RUNNING) {
+    return HAL_BUSY;
+  }
+#if EXT_ADC_ENABLE
+  extAdc_stop();
+#endif
+#if ADC_MUX_ENABLE
+  adcMux_stop();
+#endif
+  analogSensor_stopDMA();
+  const HAL_StatusTypeDef status =
+      adcReplay_start(input, count, scan_rate_hz, paced);
+  if (status != HAL_OK) {
+    App_RestartScan();
+  }
+  return status;
+}
+
+/**
+  * @brief Grouped-scan hand-off: stamp the group, and at the frame's last
+  *        one add up how early each group was
+  */
+static void App_GroupDone(uint8_t group, const uint16_t *samples,
+                          uint8_t count, uint32_t frame, void *ctx)
+{
+  const uint8_t groups = (uint8_t)(ADC_CONVERSIONS_CHANNEL_COUNT / count);
+
+  UNUSED(samples);
+  UNUSED(frame);
+  UNUSED(ctx);
+  group_stamp[group] = timebase_now();
+  if (group + 1U == groups) {
+    for (uint8_t g = 0; g < groups; g++) {
+      group_lead[g] += group_stamp[group] - group_stamp[g];
+    }
+    group_frames++;
+  }
+}
+
+/**
+  * @brief One GROUP line per group: its channels and how many us before
+  *        the frame's last group it was handed off, on average
+  */
+static void App_ReportGroups(void)
+{
+  if (group_size == 0U) {
+    return;
+  }
+  const uint32_t frames = group_frames;
+  for (uint8_t g = 0; g < ADC_CONVERSIONS_CHANNEL_COUNT / group_size; g++) {
+    char line[80];
+    const uint64_t lead = (frames != 0U) ? group_lead[g] / frames : 0U;
+    const int len = snprintf(
+        line, sizeof(line), "GROUP g=%u ch=%u-%u frames=%lu lead_us=%lu\r\n",
+        g, (unsigned)(g * group_size), (unsigned)((g + 1U) * group_size - 1U),
+        (unsigned long)frames,
+        (unsigned long)(lead * 1000000U / TIMEBASE_TICK_HZ));
+    if (len > 0) {
+      telemetry_send((const uint8_t *)line, (uint16_t)strlen(line));
+    }
+  }
+}
+
+/**
+  * @brief "groups on [size]|off": the scan in discontinuous groups of size
+  *        channels (analogSensor_startGrouped()), back to the live scan, or
+  *        the GROUP lines
+  */
+static HAL_StatusTypeDef App_CmdGroups(uint32_t argc, char *argv[], void *ctx)
+{
+  uint8_t size = ADC_CONVERSIONS_GROUP_SIZE;
+  char *end = NULL;
+
+  UNUSED(ctx);
+  if (argc == 1U) {
+    App_ReportGroups();
+    return HAL_OK;
+  }
+  if (argc == 2U && strcmp(argv[1], "off") == 0) {
+    if (analogSensor_getMode() != ADC_ACQ_MODE_GROUPED) {
+      return HAL_ERROR;
+    }
+    analogSensor_stopDMA();
+    App_ReportGroups();
+    App_RestartScan();
+    return HAL_OK;
+  }
+  if (strcmp(argv[1], "on") != 0 || argc > 3U) {
+    return HAL_ERROR;
+  }
+  if (argc == 3U) {
+    const unsigned long n = strtoul(argv[2], &end, 10);
+    if (end == argv[2] || *end != '\0' || n == 0UL ||
+        n > ADC_GROUP_MAX_SIZE) {
+      return HAL_ERROR;
+    }
+    size = (uint8_t)n;
+  }
+  if (adcReplay_isActive() ||
+      analogSensor_getMode() == ADC_ACQ_MODE_GROUPED ||
+      burstCapture_getState() == BURST_CAPTURE_RUNNING) {
+    return HAL_BUSY;
+  }
+
+#if EXT_ADC_ENABLE
+  extAdc_stop();
+#endif
+#if ADC_MUX_ENABLE
+  adcMux_stop();
+#endif
+  analogSensor_stopDMA();
+  memset(group_lead, 0, sizeof(group_lead));
+  group_frames = 0;
+  group_size = size;
+  const HAL_StatusTypeDef status =
+      analogSensor_startGrouped(scan_rate_hz, size, App_GroupDone, NULL);
+  if (status != HAL_OK) {
+    group_size = 0;
+    App_RestartScan();
+  }
+  return status;
+}
+
+/**
+  * @brief PRESET line: the operating point, DMA dispatch overhead per block
+  *        and per frame, and the end-to-end latency of the stream packets
+  *        (oldest frame -> wire: their span plus the p99 newest -> wire)
+  */
+static void App_ReportPreset(void)
+{
+  const uint32_t frames = analogSensor_getBlockFrames();
+  ADC_DmaDispatchStats_t st;
+  uint64_t cycles = 0;
+  uint32_t count = 0;
+  uint32_t max = 0;
+  LatencyHist_Summary_t consumer;
+  LatencyHist_Summary_t tx;
+  char line[224];
+
+  for (uint8_t p = 0; p < (uint8_t)ADC_DMA_DISPATCH_COUNT; p++) {
+    if (analogSensor_getDmaDispatch((ADC_DmaDispatch_t)p, &st) == HAL_OK) {
+      cycles += st.total;
+      count += st.count;
+      max = (st.max > max) ? st.max : max;
+    }
+  }
+  const uint32_t mean = (count != 0U) ? (uint32_t)(cycles / count) : 0U;
+  // Centi-percent of the core in the handler at this block rate
+  const uint32_t load = (uint32_t)((uint64_t)mean * scan_rate_hz * 10000U /
+                                   frames / SystemCoreClock);
+  const uint32_t packets = stream_packets;
+  const uint32_t span_us =
+      (packets != 0U)
+          ? (uint32_t)(stream_span_ticks / packets * 1000000U /
+                       TIMEBASE_TICK_HZ)
+          : 0U;
+  if (latencyHist_getSummary(LATENCY_HIST_DMA_CONSUMER, &consumer) !=
+          HAL_OK ||
+      latencyHist_getSummary(LATENCY_HIST_BLOCK_TX, &tx) != HAL_OK) {
+    return;
+  }
+  const int len = snprintf(
+      line, sizeof(line),
+      "PRESET name=%s block=%lu block_us=%lu flush=%u codec=%u hold_ms=%lu "
+      "blocks=%lu isr_cycles=%lu isr_max=%lu frame_cycles=%lu "
+      "isr_load_cpct=%lu consumer_p99_us=%lu packets=%lu span_us=%lu "
+      "tx_p50_us=%lu tx_p99_us=%lu e2e_p99_us=%lu missed=%lu\r\n",
+      (preset < sizeof(presets) / sizeof(presets[0])) ? presets[preset].name
+                                                      : "build",
+      (unsigned long)frames,
+      (unsigned long)((uint64_t)frames * 1000000U / scan_rate_hz),
+      (unsigned)stream_flush, (unsigned)codec_stream,
+      (unsigned long)telemetry_getBatchHold(), (unsigned long)count,
+      (unsigned long)mean, (unsigned long)max,
+      (unsigned long)(mean / frames), (unsigned long)load,
+      (unsigned long)(consumer.p99 / 1000U), (unsigned long)packets,
+      (unsigned long)span_us, (unsigned long)(tx.p50 / 1000U),
+      (unsigned long)(tx.p99 / 1000U),
+      (unsigned long)(tx.p99 / 1000U + span_us),
+      (unsigned long)stream_filter.blocks_missed);
+  if (len > 0) {
+    telemetry_send((const uint8_t *)line, (uint16_t)strlen(line));
+  }
+}
+
+/**
+  * @brief Start the PRESET measurements over
+  */
+static void App_ResetPreset(void)
+{
+  analogSensor_resetDmaDispatch();
+  latencyHist_reset();
+  stream_packets = 0;
+  stream_span_ticks = 0;
+  stream_filter.blocks_missed = 0;
+}
+
+/**
+  * @brief Block length, stream flush and TX batching of a preset; the scan
+  *        must be stopped
+  */
+static HAL_StatusTypeDef App_ApplyPreset(uint8_t index)
+{
+#if EXT_ADC_ENABLE
+  // The SPI ADC's RX halves are whole build blocks (ext_adc.h)
+  if (presets[index].block_frames != ADC_CONVERSIONS_BLOCK_FRAMES) {
+    return HAL_ERROR;
+  }
+#endif
+  const HAL_StatusTypeDef status =
+      analogSensor_setBlockFrames(presets[index].block_frames);
+  if (status != HAL_OK) {
+    return status;
+  }
+  preset = index;
+  stream_flush = presets[index].flush;
+  telemetry_setBatchHold(presets[index].hold_ms);
+  return HAL_OK;
+}
+
+/**
+  * @brief "preset [latency|throughput|reset]": switch the operating point,
+  *        start its measurements over, or the PRESET line
+  *
+  * "latency" takes the shortest block (ADC_CONVERSIONS_MIN_BLOCK_FRAMES)
+  * and sends each stream output as it comes, partial packet or not;
+  * "throughput" the build's block, the lossless codec stream and TX
+  * batching. The scan restarts with the new block length.
+  */
+static HAL_StatusTypeDef App_CmdPreset(uint32_t argc, char *argv[], void *ctx)
+{
+  uint8_t index = 0;
+
+  UNUSED(ctx);
+  if (argc == 1U) {
+    App_ReportPreset();
+    return HAL_OK;
+  }
+  if (argc != 2U) {
+    return HAL_ERROR;
+  }
+  if (strcmp(argv[1], "reset") == 0) {
+    App_ResetPreset();
+    return HAL_OK;
+  }
+  while (index < sizeof(presets) / sizeof(presets[0]) &&
+         strcmp(argv[1], presets[index].name) != 0) {
+    index++;
+  }
+  if (index == sizeof(presets) / sizeof(presets[0])) {
+    return HAL_ERROR;
+  }
+  if (adcReplay_isActive() ||
+      analogSensor_getMode() == ADC_ACQ_MODE_GROUPED ||
+      burstCapture_getState() == BURST_CAPTURE_RUNNING) {
+    return HAL_BUSY;
+  }
+
+#if EXT_ADC_ENABLE
+  extAdc_stop();
+#endif
+#if ADC_MUX_ENABLE
+  adcMux_stop();
+#endif
+  analogSensor_stopDMA();
+  App_FlushBatch();
+  const HAL_StatusTypeDef status = App_ApplyPreset(index);
+  if (status == HAL_OK) {
+    if (codec_stream != presets[index].codec) {
+      App_SetCodec(presets[index].codec); // saves the settings too
+    } else {
+      App_SaveSettings();
+    }
+    App_SetDmaBudget(scan_rate_hz);
+  }
+  App_RestartScan();
+  App_ResetPreset();
+  return status;
+}
+
+/**
+  * @brief ADC_RESOLUTION_xB of a bit count, UINT32_MAX for one the ADC
+  *        lacks
+  */
+static uint32_t App_ResolutionOf(uint8_t bits)
+{
+  switch (bits) {
+  case 12U:
+    return ADC_RESOLUTION_12B;
+  case 10U:
+    return ADC_RESOLUTION_10B;
+  case 8U:
+    return ADC_RESOLUTION_8B;
+  case 6U:
+    return ADC_RESOLUTION_6B;
+  default:
+    return UINT32_MAX;
+  }
+}
+
+/**
+  * @brief Put the three scan ADCs at one resolution (polling mode only)
+  */
+static HAL_StatusTypeDef App_SetScanBits(uint8_t bits)
+{
+  const uint32_t res = App_ResolutionOf(bits);
+  if (res == UINT32_MAX) {
+    return HAL_ERROR;
+  }
+  for (uint8_t k = 0; k < 3U; k++) {
+    const HAL_StatusTypeDef status = analogSensor_setResolution(k, res);
+    if (status != HAL_OK) {
+      return status;
+    }
+  }
+  scan_bits = bits;
+  return HAL_OK;
+}
+
+/**
+  * @brief RES line: the bits of each ADC and the fastest rate they allow
+  */
+static void App_ReportResolution(void)
+{
+  static const uint8_t bits_of[] = {12U, 10U, 8U, 6U}; // by ADC_CR1_RES
+  uint8_t bits[3];
+  char line[96];
+
+  for (uint8_t k = 0; k < 3U; k++) {
+    bits[k] = bits_of[(analogSensor_getResolution(k) & ADC_CR1_RES) >>
+                      ADC_CR1_RES_Pos];
+  }
+  const int len = snprintf(
+      line, sizeof(line),
+      "RES adc1=%u adc2=%u adc3=%u rate=%lu max=%lu\r\n", bits[0], bits[1],
+      bits[2], (unsigned long)scan_rate_hz,
+      (unsigned long)analogSensor_getMaxFrameRate(
+          clockProfile_getActive()->adc_prescaler));
+  if (len > 0) {
+    telemetry_send((const uint8_t *)line, (uint16_t)strlen(line));
+  }
+}
+
+#if ADC_RANGE_ENABLE
+/**
+  * @brief The RANGE line: mode, groups on +-6 g, switches and peaks
+  */
+static void App_ReportRange(void)
+{
+  static const char *const mode_names[] = {"auto", "2", "6"};
+  AdcRange_Stats_t rs;
+  char line[128];
+
+  (void)adcRange_getStats(&rs);
+  const int len = snprintf(
+      line, sizeof(line),
+      "RANGE mode=%s wide=0x%02x up=%lu down=%lu settle=%lu voided=%lu "
+      "peak_mg=%u,%u\r\n",
+      mode_names[rs.mode], rs.range, (unsigned long)rs.switches_up,
+      (unsigned long)rs.switches_down, (unsigned long)rs.settle_frames,
+      (unsigned long)rs.voided, rs.peak_mg[0],
+      rs.peak_mg[ADC_CAL_GROUP_COUNT - 1U]);
+  if (len > 0) {
+    telemetry_send((const uint8_t *)line, (uint16_t)strlen(line));
+  }
+}
+
+/**
+  * @brief "range [auto|2|6]": automatic gain ranging or a fixed +-2 g /
+  *        +-6 g on every sensor, or the RANGE line
+  */
+static HAL_StatusTypeDef App_CmdRange(uint32_t argc, char *argv[], void *ctx)
+{
+  UNUSED(ctx);
+  if (argc == 2U) {
+    if (strcmp(argv[1], "auto") == 0) {
+      adcRange_setMode(ADC_RANGE_AUTO);
+    } else if (strcmp(argv[1], "2") == 0) {
+      adcRange_setMode(ADC_RANGE_NARROW);
+    } else if (strcmp(argv[1], "6") == 0) {
+      adcRange_setMode(ADC_RANGE_WIDE);
+    } else {
+      return HAL_ERROR;
+    }
+  } else if (argc != 1U) {
+    return HAL_ERROR;
+  }
+  App_ReportRange();
+  return HAL_OK;
+}
+#endif
+
+/**
+  * @brief "resolution [12|10|8|6]": convert the scan at fewer bits, or the
+  *        RES line
+  *
+  * Fewer bits take fewer ADC cycles per rank and raise the fastest scan
+  * rate; the samples stay 12-bit codes (the low bits repeat the top ones).
+  * A resolution the current rate would overrun is refused. The scan
+  * restarts with it.
+  */
+static HAL_StatusTypeDef App_CmdResolution(uint32_t argc, char *argv[],
+                                           void *ctx)
+{
+  char *end = NULL;
+
+  UNUSED(ctx);
+  if (argc == 1U) {
+    App_ReportResolution();
+    return HAL_OK;
+  }
+  if (argc != 2U) {
+    return HAL_ERROR;
+  }
+  const unsigned long bits = strtoul(argv[1], &end, 10);
+  if (end == argv[1] || *end != '\0' || bits > 12UL ||
+      App_ResolutionOf((uint8_t)bits) == UINT32_MAX) {
+    return HAL_ERROR;
+  }
+  if (adcReplay_isActive() ||
+      analogSensor_getMode() == ADC_ACQ_MODE_GROUPED ||
+      burstCapture_getState() == BURST_CAPTURE_RUNNING) {
+    return HAL_BUSY;
+  }
+
+  const uint8_t old_bits = scan_bits;
+#if EXT_ADC_ENABLE
+  extAdc_stop();
+#endif
+#if ADC_MUX_ENABLE
+  adcMux_stop();
+#endif
+  analogSensor_stopDMA();
+  HAL_StatusTypeDef status = App_SetScanBits((uint8_t)bits);
+  if (status == HAL_OK &&
+      scan_rate_hz > analogSensor_getMaxFrameRate(
+                         clockProfile_getActive()->adc_prescaler)) {
+    status = HAL_ERROR;
+  }
+  if (status != HAL_OK) {
+    (void)App_SetScanBits(old_bits);
+  }
+  App_RestartScan();
+  if (status == HAL_OK) {
+    App_SaveSettings();
+    App_ReportResolution();
+  }
+  return status;
+}
+
+#if USB_MSC_ENABLE
+/**
+  * @brief MSC line: drive state, size and transfer counters
+  */
+static void App_ReportMsc(void)
+{
+  UsbMsc_Stats_t msc;
+  char line[192];
+
+  (void)usbMsc_getStats(&msc);
+  const int len = snprintf(
+      line, sizeof(line),
+      "MSC active=%u ejected=%u volume=%lu files=%lu commands=%lu "
+      "failed=%lu sent=%lu reads=%lu read_errors=%lu resets=%lu\r\n",
+      msc.active, msc.ejected, (unsigned long)msc.volume_sectors,
+      (unsigned long)msc.file_sectors, (unsigned long)msc.commands,
+      (unsigned long)msc.failed, (unsigned long)msc.sectors_sent,
+      (unsigned long)msc.card_reads, (unsigned long)msc.read_errors,
+      (unsigned long)msc.resets);
+  if (len > 0) {
+    telemetry_send((const uint8_t *)line, (uint16_t)strlen(line));
+  }
+}
+
+/**
+  * @brief Leave the drive mode: the CDC port, a new recording, the scan
+  */
+static void App_StopMsc(void)
+{
+  App_ReportMsc();
+  usbMsc_stop();
+  (void)sdLogger_start(scan_rate_hz);
+  App_RestartScan();
+}
+
+/**
+  * @brief "msc on|off": the SD recording as a USB drive, or the MSC line
+  *
+  * The scan and the recorder stop for as long as the drive is on: the
+  * card serves the host alone. Off, or an eject from the host, brings back
+  * the CDC port and starts a new recording session.
+  */
+static HAL_StatusTypeDef App_CmdMsc(uint32_t argc, char *argv[], void *ctx)
+{
+  UNUSED(ctx);
+  if (argc == 1U) {
+    App_ReportMsc();
+    return HAL_OK;
+  }
+  if (argc != 2U) {
+    return HAL_ERROR;
+  }
+  if (strcmp(argv[1], "off") == 0) {
+    if (usbMsc_isActive()) {
+      App_StopMsc();
+    }
+    return HAL_OK;
+  }
+  if (strcmp(argv[1], "on") != 0) {
+    return HAL_ERROR;
+  }
+  if (usbMsc_isActive()) {
+    return HAL_OK;
+  }
+  if (adcReplay_isActive() ||
+      analogSensor_getMode() == ADC_ACQ_MODE_GROUPED ||
+      burstCapture_getState() == BURST_CAPTURE_RUNNING) {
+    return HAL_BUSY;
+  }
+
+#if EXT_ADC_ENABLE
+  extAdc_stop();
+#endif
+#if ADC_MUX_ENABLE
+  adcMux_stop();
+#endif
+  analogSensor_stopDMA();
+  (void)sdLogger_stop(MSC_STOP_TIMEOUT_MS);
+  const HAL_StatusTypeDef status = usbMsc_start();
+  if (status != HAL_OK) {
+    // No card or no index: back to recording what there is
+    (void)sdLogger_start(scan_rate_hz);
+    App_RestartScan();
+    return status;
+  }
+  App_ReportMsc();
+  return HAL_OK;
+}
+
+/**
+  * @brief Drive mode service: the SCSI commands, and its end on an eject
+  */
+static void App_PollMsc(void)
+{
+  usbMsc_poll();
+  if (usbMsc_isEjected()) {
+    App_StopMsc();
+  }
+}
+#endif
+
+#if ADC_MUX_ENABLE
+/**
+  * @brief MUX line: chain state, switch and settle times, the rate they
+  *        allow and the frame counters; MUXF the newest mux frame
+  */
+static void App_ReportMux(void)
+{
+  AdcMux_Stats_t mux;
+  static uint16_t codes[ADC_MUX_CHANNELS];
+  uint32_t frame = 0;
+  char line[256];
+  int len;
+
+  if (adcMux_getStats(&mux) != HAL_OK) {
+    return;
+  }
+  len = snprintf(line, sizeof(line),
+                 "MUX run=%u pos=%u phase=%u switch_ns=%lu settle_ns=%lu "
+                 "max=%lu frames=%lu blocks=%lu drop=%lu checked=%lu "
+                 "realigned=%lu dma=%lu\r\n",
+                 mux.running, (unsigned)ADC_MUX_POSITIONS, mux.phase,
+                 (unsigned long)mux.switch_ns, (unsigned long)mux.settle_ns,
+                 (unsigned long)adcMux_getMaxFrameRate(),
+                 (unsigned long)mux.frames, (unsigned long)mux.blocks,
+                 (unsigned long)mux.dropped, (unsigned long)mux.checked,
+                 (unsigned long)mux.realigned, (unsigned long)mux.dma_errors);
+  if (len > 0) {
+    telemetry_send((const uint8_t *)line, (uint16_t)strlen(line));
+  }
+  if (adcMux_getLatest(codes, &frame) != HAL_OK) {
+    return;
+  }
+  // One line per input: its positions in order
+  for (uint8_t in = 0; in < ADC_CONVERSIONS_CHANNEL_COUNT; in++) {
+    len = snprintf(line, sizeof(line), "MUXF frame=%lu in=%u",
+                   (unsigned long)frame, in);
+    for (uint8_t p = 0; p < ADC_MUX_POSITIONS && len > 0 &&
+                        (size_t)len < sizeof(line); p++) {
+      len += snprintf(&line[len], sizeof(line) - (size_t)len, " %u",
+                      codes[in * ADC_MUX_POSITIONS + p]);
+    }
+    if (len > 0 && (size_t)len + 2U < sizeof(line)) {
+      memcpy(&line[len], "\r\n", 3U);
+      telemetry_send((const uint8_t *)line, (uint16_t)strlen(line));
+    }
+  }
+}
+
+/**
+  * @brief "mux [settle <ns>]": the MUX and MUXF lines, or a new settle time
+  *
+  * A longer settle time lowers adcMux_getMaxFrameRate(); one the current
+  * scan rate would not leave is refused. The scan restarts so the chain
+  * is armed again on its first trigger.
+  */
+static HAL_StatusTypeDef App_CmdMux(uint32_t argc, char *argv[], void *ctx)
+{
+  char *end = NULL;
+  AdcMux_Stats_t mux;
+
+  UNUSED(ctx);
+  if (argc == 1U) {
+    App_ReportMux();
+    return HAL_OK;
+  }
+  if (argc != 3U || strcmp(argv[1], "settle") != 0) {
+    return HAL_ERROR;
+  }
+  const unsigned long ns = strtoul(argv[2], &end, 10);
+  if (end == argv[2] || *end != '\0' || ns > 1000000UL) {
+    return HAL_ERROR;
+  }
+  if (adcReplay_isActive() ||
+      analogSensor_getMode() == ADC_ACQ_MODE_GROUPED ||
+      burstCapture_getState() == BURST_CAPTURE_RUNNING) {
+    return HAL_BUSY;
+  }
+  if (adcMux_getStats(&mux) != HAL_OK) {
+    return HAL_ERROR;
+  }
+  adcMux_setSettle((uint32_t)ns);
+  if (scan_rate_hz > adcMux_getMaxFrameRate()) {
+    adcMux_setSettle(mux.settle_ns);
+    return HAL_ERROR;
+  }
+
+#if EXT_ADC_ENABLE
+  extAdc_stop();
+#endif
+  adcMux_stop();
+  analogSensor_stopDMA();
+  App_RestartScan();
+  return HAL_OK;
+}
+#endif
+
+/**
+  * @brief MEM lines: each RAM bank as linked, the main stack's high-water
+  *        mark, the heap and, with the RTOS, the tasks' stack margins
+  */
+static void App_ReportMemory(void)
+{
+  MemBudget_Bank_t bank;
+  MemBudget_Stack_t stack;
+  MemBudget_Heap_t heap;
+  char line[128];
+  int len;
+
+  for (uint8_t b = 0; b < MEM_BUDGET_BANK_COUNT; b++) {
+    if (memBudget_getBank((MemBudget_BankId_t)b, &bank) != HAL_OK) {
+      continue;
+    }
+    len = snprintf(line, sizeof(line),
+                   "MEM %s size=%lu data=%lu dma=%lu reserved=%lu "
+                   "free=%lu\r\n",
+                   bank.name, (unsigned long)bank.size,
+                   (unsigned long)bank.data, (unsigned long)bank.dma,
+                   (unsigned long)bank.reserved, (unsigned long)bank.free);
+    if (len > 0) {
+      telemetry_send((const uint8_t *)line, (uint16_t)strlen(line));
+    }
+  }
+  (void)memBudget_getStack(&stack);
+  (void)memBudget_getHeap(&heap);
+  len = snprintf(line, sizeof(line),
+                 "MEM stack size=%lu used=%lu overflow=%u heap=%lu "
+                 "reserved=%lu sealed=%u refused=%lu\r\n",
+                 (unsigned long)stack.size, (unsigned long)stack.used,
+                 stack.overflow, (unsigned long)heap.used,
+                 (unsigned long)heap.reserved, heap.sealed,
+                 (unsigned long)heap.refused);
+  if (len > 0) {
+    telemetry_send((const uint8_t *)line, (uint16_t)strlen(line));
+  }
+#if APP_RTOS_ENABLE
+  AppRtos_Stats_t rtos;
+  if (appRtos_getStats(&rtos) == HAL_OK) {
+    len = snprintf(line, sizeof(line),
+                   "MEM tasks acq_free=%lu dsp_free=%lu comms_free=%lu\r\n",
+                   (unsigned long)rtos.acq_stack_free,
+                   (unsigned long)rtos.dsp_stack_free,
+                   (unsigned long)rtos.comms_stack_free);
+    if (len > 0) {
+      telemetry_send((const uint8_t *)line, (uint16_t)strlen(line));
+    }
+  }
+#endif
+}
+
+/**
+  * @brief "mem": the memory budget and the stack high-water marks
+  */
+static HAL_StatusTypeDef App_CmdMem(uint32_t argc, char *argv[], void *ctx)
+{
+  UNUSED(argc);
+  UNUSED(argv);
+  UNUSED(ctx);
+  App_ReportMemory();
+  return HAL_OK;
+}
+
+/**
+  * @brief One ENERGY line per state or peripheral that has time booked
+  */
+static void App_ReportEnergyPart(const char *name, uint64_t us, uint64_t nj,
+                                 uint32_t ua, uint64_t elapsed_us)
+{
+  char line[128];
+  const uint64_t ms = us / 1000U;
+  const uint64_t mj = nj / 1000000U;
+  const uint32_t share =
+      (elapsed_us != 0U) ? (uint32_t)(us * 10000U / elapsed_us) : 0U;
+  int len = snprintf(line, sizeof(line),
+                     "ENERGY %s s=%lu.%03lu pct=%lu.%02lu mj=%lu ua=%lu\r\n",
+                     name, (unsigned long)(ms / 1000U),
+                     (unsigned long)(ms % 1000U),
+                     (unsigned long)(share / 100U),
+                     (unsigned long)(share % 100U),
+                     (unsigned long)(mj > UINT32_MAX ? UINT32_MAX : mj),
+                     (unsigned long)ua);
+  if (len > 0) {
+    telemetry_send((const uint8_t *)line, (uint16_t)strlen(line));
+  }
+}
+
+/**
+  * @brief ENERGY lines: the totals since the last reset at the current
+  *        model, energy per frame and per feature message in uJ, then the
+  *        states and peripherals they come from
+  */
+static void App_ReportEnergy(void)
+{
+  EnergyMeter_Report_t r;
+  EnergyMeter_Model_t model;
+  char line[160];
+
+  if (energyMeter_getReport(&r) != HAL_OK ||
+      energyMeter_getModel(&model) != HAL_OK) {
+    return;
+  }
+  const uint64_t mj = r.total_nj / 1000000U;
+  int len = snprintf(
+      line, sizeof(line),
+      "ENERGY s=%lu mj=%lu uw=%lu mv=%lu frames=%lu msgs=%lu "
+      "uj_frame=%lu.%03lu uj_msg=%lu.%03lu\r\n",
+      (unsigned long)(r.elapsed_us / 1000000U),
+      (unsigned long)(mj > UINT32_MAX ? UINT32_MAX : mj),
+      (unsigned long)r.average_uw, (unsigned long)model.supply_mv,
+      (unsigned long)r.frames, (unsigned long)r.messages,
+      (unsigned long)(r.nj_per_frame / 1000U),
+      (unsigned long)(r.nj_per_frame % 1000U),
+      (unsigned long)(r.nj_per_message / 1000U),
+      (unsigned long)(r.nj_per_message % 1000U));
+  if (len > 0) {
+    telemetry_send((const uint8_t *)line, (uint16_t)strlen(line));
+  }
+  for (uint8_t st = 0; st < ENERGY_METER_STATE_COUNT; st++) {
+    if (r.state_us[st] != 0U) {
+      App_ReportEnergyPart(energyMeter_stateName((EnergyMeter_State_t)st),
+                           r.state_us[st], r.state_nj[st], model.state_ua[st],
+                           r.elapsed_us);
+    }
+  }
+  for (uint8_t p = 0; p < ENERGY_METER_PERIPH_COUNT; p++) {
+    if (r.periph_us[p] != 0U) {
+      App_ReportEnergyPart(energyMeter_periphName((EnergyMeter_Periph_t)p),
+                           r.periph_us[p], r.periph_nj[p], model.periph_ua[p],
+                           r.elapsed_us);
+    }
+  }
+}
+
+/**
+  * @brief "energy [reset|model [<state> <ua>|mv <mv>|default]]": the ENERGY
+  *        lines, a new accounting period, or the current model
+  *
+  * "energy model" lists the current of every state and peripheral, by the
+  * names of the ENERGY lines (run_balanced, stop, adc, ...). Setting one,
+  * the supply voltage or the defaults saves the model to flash; it prices
+  * the time already booked as well, so a changed figure shows at once.
+  */
+static HAL_StatusTypeDef App_CmdEnergy(uint32_t argc, char *argv[], void *ctx)
+{
+  _Static_assert(sizeof(EnergyMeter_Model_t) <= CONFIG_STORE_VALUE_MAX,
+                 "the energy model fits one config record");
+  EnergyMeter_Model_t model;
+  char line[256];
+  char *end = NULL;
+  int len;
+
+  UNUSED(ctx);
+  if (argc == 1U) {
+    App_ReportEnergy();
+    return HAL_OK;
+  }
+  if (strcmp(argv[1], "reset") == 0 && argc == 2U) {
+    energyMeter_reset();
+    return HAL_OK;
+  }
+  if (strcmp(argv[1], "model") != 0 || argc > 4U) {
+    return HAL_ERROR;
+  }
+  (void)energyMeter_getModel(&model);
+
+  if (argc == 2U) {
+    len = snprintf(line, sizeof(line), "ENERGYM mv=%lu",
+                   (unsigned long)model.supply_mv);
+    for (uint8_t st = 0; st < ENERGY_METER_STATE_COUNT && len > 0; st++) {
+      len += snprintf(&line[len], sizeof(line) - (size_t)len, " %s=%lu",
+                      energyMeter_stateName((EnergyMeter_State_t)st),
+                      (unsigned long)model.state_ua[st]);
+    }
+    if (len > 0 && (size_t)len < sizeof(line)) {
+      len += snprintf(&line[len], sizeof(line) - (size_t)len, "\r\n");
+      telemetry_send((const uint8_t *)line, (uint16_t)strlen(line));
+    }
+    len = snprintf(line, sizeof(line), "ENERGYM");
+    for (uint8_t p = 0; p < ENERGY_METER_PERIPH_COUNT && len > 0; p++) {
+      len += snprintf(&line[len], sizeof(line) - (size_t)len, " %s=%lu",
+                      energyMeter_periphName((EnergyMeter_Periph_t)p),
+                      (unsigned long)model.periph_ua[p]);
+    }
+    if (len > 0 && (size_t)len < sizeof(line)) {
+      len += snprintf(&line[len], sizeof(line) - (size_t)len, "\r\n");
+      telemetry_send((const uint8_t *)line, (uint16_t)strlen(line));
+    }
+    return HAL_OK;
+  }
+
+  if (argc == 3U) {
+    if (strcmp(argv[2], "default") != 0) {
+      return HAL_ERROR;
+    }
+    (void)energyMeter_setModel(NULL);
+    (void)energyMeter_getModel(&model);
+  } else {
+    // Up to 2 A: no supply of this board gives more
+    const unsigned long value = strtoul(argv[3], &end, 10);
+    if (end == argv[3] || *end != '\0' || value > 2000000UL) {
+      return HAL_ERROR;
+    }
+    uint32_t *field = NULL;
+    if (strcmp(argv[2], "mv") == 0) {
+      field = (value != 0UL && value <= 5000UL) ? &model.supply_mv : NULL;
+    }
+    for (uint8_t st = 0; st < ENERGY_METER_STATE_COUNT && field == NULL;
+         st++) {
+      if (strcmp(argv[2], energyMeter_stateName((EnergyMeter_State_t)st)) ==
+          0) {
+        field = &model.state_ua[st];
+      }
+    }
+    for (uint8_t p = 0; p < ENERGY_METER_PERIPH_COUNT && field == NULL; p++) {
+      if (strcmp(argv[2], energyMeter_periphName((EnergyMeter_Periph_t)p)) ==
+          0) {
+        field = &model.periph_ua[p];
+      }
+    }
+    if (field == NULL) {
+      return HAL_ERROR;
+    }
+    *field = (uint32_t)value;
+    if (energyMeter_setModel(&model) != HAL_OK) {
+      return HAL_ERROR;
+    }
+  }
+  (void)configStore_set(CONFIG_KEY_ENERGY_MODEL, SETTINGS_VERSION, &model,
+                        sizeof(model));
+  return HAL_OK;
+}
+
+/**
+  * @brief Single-byte controls: dump, backend benchmark, codec, link
+  */
+static HAL_StatusTypeDef App_CmdByte(uint32_t argc, char *argv[], void *ctx)
+{
+  const uint8_t cmd = (uint8_t)argv[0][0];
+
+  UNUSED(argc);
+  UNUSED(ctx);
+  if (cmd == (uint8_t)BACKEND_BENCH_CMD[0]) {
+    if (burstCapture_getState() == BURST_CAPTURE_RUNNING) {
+      return HAL_BUSY;
+    }
+    // Needs polling mode, so the scan pauses for a few ms
+#if EXT_ADC_ENABLE
+    extAdc_stop();
+#endif
+#if ADC_MUX_ENABLE
+    adcMux_stop();
+#endif
+    analogSensor_stopDMA();
+    analogSensor_benchmarkBackends(BACKEND_BENCH_ROUNDS);
+    App_RestartScan();
+  } else if (cmd == (uint8_t)CODEC_STREAM_CMD[0]) {
+    App_SetCodec(!codec_stream);
+    return HAL_OK;
+  } else if (cmd != (uint8_t)PROFILER_DUMP_CMD[0]) {
+    App_LinkCommand(cmd);
+    return HAL_OK;
+  }
+  profiler_dump();
+  isrBudget_dump();
+  latencyHist_dump();
+  bootProfile_dump();
+  return HAL_OK;
+}
+
+/**
+  * @brief Append " name=x.yy", value in hundredths, to a report line
+  *
+  * @retval New length of the line
+  */
+static int App_AppendCenti(char *line, size_t size, int len, const char *name,
+                           int32_t centi)
+{
+  const uint32_t mag = (centi < 0) ? (uint32_t)-centi : (uint32_t)centi;
+  if (len < 0 || (size_t)len >= size) {
+    return len;
+  }
+  return len + snprintf(&line[len], size - (size_t)len, " %s=%s%lu.%02lu",
+                        name, (centi < 0) ? "-" : "",
+                        (unsigned long)(mag / 100U),
+                        (unsigned long)(mag % 100U));
+}
+
+/**
+  * @brief Anomaly packet of the newest score (nn_anomaly.h)
+  */
+static HAL_StatusTypeDef App_EncodeAnomaly(uint32_t timestamp, uint8_t *out,
+                                           uint16_t cap, uint16_t *out_len)
+{
+  NnAnomaly_Result_t r;
+  if (nnAnomaly_getResult(&r) != HAL_OK) {
+    return HAL_ERROR;
+  }
+  TelemetryFrame_Anomaly_t anomaly = {.sequence = r.sequence,
+                                      .timestamp = timestamp,
+                                      .windows = r.windows,
+                                      .learning = r.learning,
+                                      .group_count = r.group_count,
+                                      .alarm_mask = r.alarm_mask,
+                                      .cycles_max = r.cycles_max};
+  for (uint8_t g = 0; g < r.group_count; g++) {
+    anomaly.channel_mask[g] = r.channel_mask[g];
+    anomaly.score_mean[g] = r.score_mean[g];
+    anomaly.score_peak[g] = r.score_peak[g];
+  }
+  return telemetryFrame_encodeAnomaly(&anomaly, out, cap, out_len);
+}
+
+/**
+  * @brief "anomaly [learn [windows]|cadence <n>]": learn the normalisation
+  *        again (over ANOMALY_LEARN_WINDOWS by default) or set the windows
+  *        per score; with no argument, the newest score as a text line
+  */
+static HAL_StatusTypeDef App_CmdAnomaly(uint32_t argc, char *argv[], void *ctx)
+{
+  char *end = NULL;
+  char line[160];
+
+  UNUSED(ctx);
+  if (argc == 1U) {
+    NnAnomaly_Result_t r;
+    if (nnAnomaly_getResult(&r) != HAL_OK) {
+      return HAL_BUSY;
+    }
+    int len = snprintf(line, sizeof(line),
+                       "ANOMALY seq=%lu windows=%u learning=%u cadence=%u "
+                       "alarms=0x%02x cycles=%lu",
+                       (unsigned long)r.sequence, r.windows, r.learning,
+                       nnAnomaly_getCadence(), r.alarm_mask,
+                       (unsigned long)r.cycles_max);
+    for (uint8_t g = 0; g < r.group_count && len > 0; g++) {
+      if ((size_t)len < sizeof(line)) {
+        len += snprintf(&line[len], sizeof(line) - (size_t)len, " g%u=0x%02lx",
+                        g, (unsigned long)r.channel_mask[g]);
+      }
+      len = App_AppendCenti(line, sizeof(line), len, "mean",
+                            (int32_t)lroundf(r.score_mean[g] * 100.0f));
+      len = App_AppendCenti(line, sizeof(line), len, "peak",
+                            (int32_t)lroundf(r.score_peak[g] * 100.0f));
+    }
+    if (len > 0 && (size_t)len + 2U < sizeof(line)) {
+      strcpy(&line[len], "\r\n");
+      telemetry_send((const uint8_t *)line, (uint16_t)strlen(line));
+    }
+    return HAL_OK;
+  }
+  if (strcmp(argv[1], "learn") == 0 && argc <= 3U) {
+    unsigned long windows = 0;
+    if (argc == 3U) {
+      windows = strtoul(argv[2], &end, 10);
+      if (end == argv[2] || *end != '\0' || windows < 2UL ||
+          windows > UINT16_MAX) {
+        return HAL_ERROR;
+      }
+    }
+    return nnAnomaly_learn((uint16_t)windows);
+  }
+  if (strcmp(argv[1], "cadence") == 0 && argc == 3U) {
+    const unsigned long windows = strtoul(argv[2], &end, 10);
+    if (end == argv[2] || *end != '\0' || windows == 0UL ||
+        windows > UINT16_MAX) {
+      return HAL_ERROR;
+    }
+    return nnAnomaly_setCadence((uint16_t)windows);
+  }
+  return HAL_ERROR;
+}
+
+#if DAC_LOOPBACK_ENABLE
+/**
+  * @brief Linearity sweep line: the table built from it and its INL/DNL
+  *        (adc_linearity.h)
+  */
+static void App_ReportLinearity(const DacLoop_Result_t *r)
+{
+  DacLoop_Sweep_t sw;
+  AdcLin_Info_t info = {0};
+  uint8_t adc = 0;
+  char line[256];
+
+  HAL_StatusTypeDef status = dacLoop_getSweep(&sw);
+  if (status == HAL_OK) {
+    adc = adcLin_slotAdc(sw.slot);
+    status = adcLin_build(adc, sw.mean_x16, sw.first, sw.step, sw.points);
+  }
+  if (status == HAL_OK) {
+    (void)adcLin_getInfo(adc, &info);
+  }
+  int len = snprintf(
+      line, sizeof(line),
+      "LIN ok=%u adc=%u points=%lu rate_mhz=%lu dac=%u-%u codes=%u-%u "
+      "gain_ppm=%ld folds=%lu inl_code=%u",
+      (status == HAL_OK) ? 1U : 0U, (unsigned)adc + 1U,
+      (unsigned long)r->points, (unsigned long)r->rate_mhz, info.first,
+      info.last, info.code_lo, info.code_hi, (long)info.gain_ppm,
+      (unsigned long)info.folds, info.inl_code);
+  len = App_AppendCenti(line, sizeof(line), len, "offset", info.offset_centi);
+  len = App_AppendCenti(line, sizeof(line), len, "inl", info.inl_max_centi);
+  len = App_AppendCenti(line, sizeof(line), len, "dnl", info.dnl_max_centi);
+  if (len > 0 && (size_t)len + 2U < sizeof(line)) {
+    strcpy(&line[len], "\r\n");
+    telemetry_send((const uint8_t *)line, (uint16_t)strlen(line));
+  }
+}
+
+/**
+  * @brief Self-test result line: clock, sampling time, latencies, rate and
+  *        ENOB (dac_loopback.h)
+  */
+static void App_ReportSelfTest(void)
+{
+  DacLoop_Result_t r;
+  char line[256];
+
+  if (dacLoop_getResult(&r) != HAL_OK) {
+    return;
+  }
+  if (r.sweep) {
+    App_ReportLinearity(&r);
+    return;
+  }
+  int len = snprintf(
+      line, sizeof(line),
+      "SELFTEST ok=%u adcclk=%lu smp=%lu rate_mhz=%lu steps=%lu miss=%lu "
+      "sample_us=%lu/%lu/%lu react_us=%lu/%lu/%lu total_max_us=%lu "
+      "tone_mhz=%lu amp=%lu",
+      r.ok, (unsigned long)r.adcclk_hz, (unsigned long)r.sampling_cycles,
+      (unsigned long)r.rate_mhz, (unsigned long)r.steps,
+      (unsigned long)r.missed, (unsigned long)r.sample_min_us,
+      (unsigned long)r.sample_mean_us, (unsigned long)r.sample_max_us,
+      (unsigned long)r.react_min_us, (unsigned long)r.react_mean_us,
+      (unsigned long)r.react_max_us, (unsigned long)r.total_max_us,
+      (unsigned long)r.tone_mhz, (unsigned long)r.amplitude);
+  // Sine fit, then the FFT figures of the same frames (dsp_quality.h)
+  len = App_AppendCenti(line, sizeof(line), len, "enob", r.enob_centi);
+  len = App_AppendCenti(line, sizeof(line), len, "snr", r.snr_centi_db);
+  len = App_AppendCenti(line, sizeof(line), len, "thd", r.thd_centi_db);
+  len = App_AppendCenti(line, sizeof(line), len, "sfdr", r.sfdr_centi_db);
+  len = App_AppendCenti(line, sizeof(line), len, "fft_enob",
+                        r.fft_enob_centi);
+  if (len > 0 && (size_t)len + 2U < sizeof(line)) {
+    strcpy(&line[len], "\r\n");
+    telemetry_send((const uint8_t *)line, (uint16_t)strlen(line));
+  }
+}
+#endif
+
+/**
+  * @brief "selftest [bits]|linearity [reset]|off": DAC loopback run on the
+  *        live scan; bits first sets the test channel's settling accuracy
+  *        (it stays set). "linearity" sweeps the DAC code by code and builds
+  *        the linearity table of the ADC on PA4; "reset" puts every table
+  *        back to the identity instead
+  */
+static HAL_StatusTypeDef App_CmdSelfTest(uint32_t argc, char *argv[],
+                                         void *ctx)
+{
+  UNUSED(ctx);
+#if DAC_LOOPBACK_ENABLE
+  ADC_ChannelProfile_t profile;
+  char *end = NULL;
+
+  const uint8_t linearity = (argc >= 2U && strcmp(argv[1], "linearity") == 0);
+  if (argc > (linearity ? 3U : 2U)) {
+    return HAL_ERROR;
+  }
+  if (argc == 2U && strcmp(argv[1], "off") == 0) {
+    dacLoop_stop();
+    return HAL_OK;
+  }
+  if (linearity && argc == 3U) {
+    if (strcmp(argv[2], "reset") != 0) {
+      return HAL_ERROR;
+    }
+    adcLin_init();
+    return (adcLin_getTable(0) != NULL) ? HAL_OK : HAL_ERROR;
+  }
+  if (dacLoop_isRunning() ||
+      burstCapture_getState() == BURST_CAPTURE_RUNNING) {
+    return HAL_BUSY;
+  }
+  if (linearity) {
+    return dacLoop_startSweep();
+  }
+  if (argc == 2U) {
+    // The sampling time only changes with the scan stopped
+    const unsigned long bits = strtoul(argv[1], &end, 10);
+    if (end == argv[1] || *end != '\0' ||
+        analogSensor_getChannelProfile(ADC_CH_SENSOR2_Y, &profile) !=
+            HAL_OK) {
+      return HAL_ERROR;
+    }
+    profile.accuracy_bits = (uint8_t)bits;
+#if EXT_ADC_ENABLE
+    extAdc_stop();
+#endif
+#if ADC_MUX_ENABLE
+    adcMux_stop();
+#endif
+    analogSensor_stopDMA();
+    const HAL_StatusTypeDef status =
+        analogSensor_setChannelProfile(ADC_CH_SENSOR2_Y, &profile);
+    App_RestartScan();
+    if (status != HAL_OK) {
+      return status;
+    }
+  }
+  return dacLoop_start();
+#else
+  UNUSED(argc);
+  UNUSED(argv);
+  return HAL_ERROR; // built without DAC_LOOPBACK_ENABLE
+#endif
+}
+
+#if ACQ_TUNE_ENABLE
+/**
+  * @brief Stop the scan and its companions, as before a profile change
+  */
+static void App_TuneStopScan(void)
+{
+#if EXT_ADC_ENABLE
+  extAdc_stop();
+#endif
+#if ADC_MUX_ENABLE
+  adcMux_stop();
+#endif
+  analogSensor_stopDMA();
+}
+
+/**
+  * @brief Tuner hook: stop the scan and apply a candidate; NULL puts back
+  *        the resolution from before the run
+  */
+static HAL_StatusTypeDef App_TuneConfigure(const AcqTune_Candidate_t *cand,
+                                           void *ctx)
+{
+  UNUSED(ctx);
+  App_TuneStopScan();
+  if (cand == NULL) {
+    return App_SetScanBits(tune_saved_bits);
+  }
+  const HAL_StatusTypeDef status = App_SetScanBits(cand->bits);
+  return (status == HAL_OK) ? acqTune_applyAnalog(cand) : status;
+}
+
+/**
+  * @brief Tuner hook: restart the scan at a rate, the rate-dependent stages
+  *        retuned and the new rate announced
+  */
+static HAL_StatusTypeDef App_TuneStart(uint32_t rate_hz, void *ctx)
+{
+  UNUSED(ctx);
+  App_TuneStopScan();
+  // App_RestartScan() stops in Error_Handler() on a rate the scan refuses
+  if (rate_hz == 0U ||
+      rate_hz > analogSensor_getMaxFrameRate(
+                    clockProfile_getActive()->adc_prescaler)) {
+    return HAL_ERROR;
+  }
+  // The restart numbers frames from 0 again
+  const TelemetryFrame_Rate_t info = {.timestamp = HAL_GetTick(),
+                                      .frame_rate_hz = rate_hz,
+                                      .decimation = App_StreamDecimation(
+                                          STREAM_DECIMATION)};
+  scan_rate_hz = rate_hz;
+  (void)timeSync_setFrameRate(rate_hz); // HAL_ERROR: discipline off
+  App_RetuneStages(rate_hz, STREAM_DECIMATION);
+  App_RestartScan();
+#if TDMA_BUS_ENABLE
+  (void)tdmaBus_start(scan_rate_hz); // HAL_ERROR: slots too short, off
+#endif
+  App_AnnounceRate(&info);
+  return HAL_OK;
+}
+
+/**
+  * @brief Start a tuning run from the current settings
+  */
+static HAL_StatusTypeDef App_StartTune(int32_t enob_centi,
+                                       uint16_t headroom_centi)
+{
+#if ADAPTIVE_RATE_ENABLE || PWM_SYNC_ENABLE
+  return HAL_BUSY; // the rate controller or the motor PWM owns the scan rate
+#endif
+  if (adcReplay_isActive() ||
+      analogSensor_getMode() != ADC_ACQ_MODE_DMA_TIMER ||
+      burstCapture_getState() == BURST_CAPTURE_RUNNING ||
+      quality_channel != QUALITY_IDLE) {
+    return HAL_BUSY;
+  }
+  AcqTune_Config_t cfg = {.target_enob_centi = enob_centi,
+                          .headroom_centi_pct = headroom_centi,
+                          .limit_hz = 0,
+                          .configure = App_TuneConfigure,
+                          .start = App_TuneStart,
+                          .ctx = NULL};
+#if EXT_ADC_ENABLE
+  cfg.limit_hz = extAdc_getMaxFrameRate();
+#endif
+#if ADC_MUX_ENABLE
+  if (cfg.limit_hz == 0U || adcMux_getMaxFrameRate() < cfg.limit_hz) {
+    cfg.limit_hz = adcMux_getMaxFrameRate();
+  }
+#endif
+  tune_saved_bits = scan_bits;
+  return acqTune_start(&cfg);
+}
+
+/**
+  * @brief Tuning result line of one candidate, or of the winner
+  */
+static void App_ReportTune(const char *what, int32_t index)
+{
+  AcqTune_Result_t r;
+  char line[192];
+
+  if (index < 0 || acqTune_getResult((uint32_t)index, &r) != HAL_OK) {
+    snprintf(line, sizeof(line), "TUNE %s none\r\n", what);
+    telemetry_send((const uint8_t *)line, (uint16_t)strlen(line));
+    return;
+  }
+  int len = snprintf(line, sizeof(line),
+                     "TUNE %s=%ld bits=%u acc=%u dma=%u max_hz=%lu rate=%lu",
+                     what, (long)index, r.cand.bits, r.cand.accuracy_bits,
+                     r.cand.dma, (unsigned long)r.max_hz,
+                     (unsigned long)r.rate_hz);
+  len = App_AppendCenti(line, sizeof(line), len, "load", r.load_centi_pct);
+  len = App_AppendCenti(line, sizeof(line), len, "peak", r.peak_centi_pct);
+  len = App_AppendCenti(line, sizeof(line), len, "enob", r.enob_centi);
+  if (len > 0 && (size_t)len < sizeof(line)) {
+    len += snprintf(&line[len], sizeof(line) - (size_t)len,
+                    " err=%lu %s\r\n", (unsigned long)r.errors,
+                    acqTune_verdictName(r.verdict));
+  }
+  if (len > 0 && (size_t)len < sizeof(line)) {
+    telemetry_send((const uint8_t *)line, (uint16_t)len);
+  }
+}
+
+/**
+  * @brief Tuner step (main loop, after the loopback poll): a line per
+  *        candidate, and the winner saved for the next boot
+  */
+static void App_PollTune(void)
+{
+  AcqTune_Status_t st;
+
+  if (tune_at_boot) {
+    tune_at_boot = 0;
+    (void)App_StartTune(ACQ_TUNE_BOOT_ENOB_CENTI,
+                        ACQ_TUNE_BOOT_HEADROOM_CENTI);
+  }
+  const AcqTune_Event_t event = acqTune_poll();
+  if (event == ACQ_TUNE_EVENT_NONE || acqTune_getStatus(&st) != HAL_OK) {
+    return;
+  }
+  if (event == ACQ_TUNE_EVENT_RESULT) {
+    App_ReportTune("cand", st.last);
+    return;
+  }
+  AcqTune_Result_t r;
+  if (acqTune_getResult((uint32_t)st.best, &r) == HAL_OK) {
+    App_SaveSettings(); // rate and resolution
+    (void)configStore_set(CONFIG_KEY_ACQ_TUNE, SETTINGS_VERSION, &r.cand,
+                          sizeof(r.cand));
+  }
+  App_ReportTune("best", st.best);
+}
+
+/**
+  * @brief Parse "x", "x.y" or "x.yy" into hundredths
+  */
+static HAL_StatusTypeDef App_ParseCenti(const char *text, int32_t *centi)
+{
+  char *end = NULL;
+  const unsigned long whole = strtoul(text, &end, 10);
+  uint32_t frac = 0;
+  if (end == text || whole > 1000UL) {
+    return HAL_ERROR;
+  }
+  if (*end == '.') {
+    const char *digit = end + 1;
+    for (uint32_t scale = 10U; scale != 0U; scale /= 10U, digit++) {
+      if (*digit < '0' || *digit > '9') {
+        break;
+      }
+      frac += (uint32_t)(*digit - '0') * scale;
+    }
+    end = (char *)digit;
+  }
+  if (*end != '\0') {
+    return HAL_ERROR;
+  }
+  *centi = (int32_t)(whole * 100UL + frac);
+  return HAL_OK;
+}
+#endif
+
+/**
+  * @brief "autotune [<enob> [<headroom %>]|off]": sweep resolution,
+  *        settling accuracy and ADC DMA FIFO for the fastest scan that keeps
+  *        the loopback ENOB with the CPU headroom (acq_tune.h); no argument
+  *        reports the progress
+  */
+static HAL_StatusTypeDef App_CmdAutotune(uint32_t argc, char *argv[],
+                                         void *ctx)
+{
+  UNUSED(ctx);
+#if ACQ_TUNE_ENABLE
+  AcqTune_Status_t st;
+  int32_t enob = 0;
+  int32_t headroom = ACQ_TUNE_BOOT_HEADROOM_CENTI;
+  char line[80];
+
+  if (argc == 1U) {
+    (void)acqTune_getStatus(&st);
+    snprintf(line, sizeof(line), "TUNE running=%u judged=%lu/%lu best=%ld\r\n",
+             st.running, (unsigned long)st.judged,
+             (unsigned long)st.candidates, (long)st.best);
+    telemetry_send((const uint8_t *)line, (uint16_t)strlen(line));
+    return HAL_OK;
+  }
+  if (argc == 2U && strcmp(argv[1], "off") == 0) {
+    acqTune_stop();
+    return HAL_OK;
+  }
+  if (argc > 3U || App_ParseCenti(argv[1], &enob) != HAL_OK ||
+      (argc == 3U && App_ParseCenti(argv[2], &headroom) != HAL_OK) ||
+      enob > 1200 || headroom >= 10000) {
+    return HAL_ERROR;
+  }
+  return App_StartTune(enob, (uint16_t)headroom);
+#else
+  UNUSED(argc);
+  UNUSED(argv);
+  return HAL_ERROR; // built without ACQ_TUNE_ENABLE
+#endif
+}
+
+#if CLOCK_GOV_ENABLE
+/**
+  * @brief Safe point of the clock governor: nothing in flight that the
+  *        16 MHz window of a switch would garble or skew
+  */
+static uint8_t App_GovernorReady(void *ctx)
+{
+  UNUSED(ctx);
+  // A byte on the wire at the old baud rate, or a measurement in progress
+  return telemetry_getFreeSlots() == TELEMETRY_SLOT_COUNT &&
+         !dacLoop_isRunning() && !acqTune_isRunning() &&
+         !adcReplay_isActive() && quality_channel == QUALITY_IDLE &&
+         burstCapture_getState() == BURST_CAPTURE_IDLE;
+}
+
+/**
+  * @brief The GOV line: policy, profile and switch figures (clock_gov.h)
+  */
+static void App_ReportGov(void)
+{
+  ClockGov_Stats_t gs;
+  char line[200];
+
+  (void)clockGov_getStats(&gs);
+  int len = snprintf(
+      line, sizeof(line),
+      "GOV %s %s profile=%u target=%u boost_ms=%lu fill=%u%%",
+      gs.running ? "on" : "off", clockGov_modeName(gs.mode), gs.profile,
+      gs.target, (unsigned long)gs.boost_ms, gs.fill_pct);
+  len = App_AppendCenti(line, sizeof(line), len, "load", gs.load_centi_pct);
+  if (len > 0 && (size_t)len < sizeof(line)) {
+    len += snprintf(&line[len], sizeof(line) - (size_t)len,
+                    " switches=%lu refused=%lu failed=%lu window=%lu/%lu us"
+                    " fast_ms=%lu slow_ms=%lu\r\n",
+                    (unsigned long)gs.switches, (unsigned long)gs.refused,
+                    (unsigned long)gs.failed,
+                    (unsigned long)gs.last_window_us,
+                    (unsigned long)gs.max_window_us,
+                    (unsigned long)gs.fast_ms, (unsigned long)gs.slow_ms);
+  }
+  if (len > 0 && (size_t)len < sizeof(line)) {
+    telemetry_send((const uint8_t *)line, (uint16_t)len);
+  }
+}
+
+/**
+  * @brief "gov [auto|fast|slow|boost <ms>]": the clock governor's policy,
+  *        or the fast profile held for a time; the GOV line after each
+  */
+static HAL_StatusTypeDef App_CmdGov(uint32_t argc, char *argv[], void *ctx)
+{
+  char *end = NULL;
+
+  UNUSED(ctx);
+  if (argc == 3U && strcmp(argv[1], "boost") == 0) {
+    const unsigned long ms = strtoul(argv[2], &end, 10);
+    if (end == argv[2] || *end != '\0' || ms > GOV_BOOST_MAX_MS) {
+      return HAL_ERROR;
+    }
+    clockGov_boost((uint32_t)ms);
+  } else if (argc == 2U && strcmp(argv[1], "auto") == 0) {
+    clockGov_setMode(CLOCK_GOV_AUTO);
+  } else if (argc == 2U && strcmp(argv[1], "fast") == 0) {
+    clockGov_setMode(CLOCK_GOV_FAST);
+  } else if (argc == 2U && strcmp(argv[1], "slow") == 0) {
+    clockGov_setMode(CLOCK_GOV_SLOW);
+  } else if (argc != 1U) {
+    return HAL_ERROR;
+  }
+  App_ReportGov();
+  return HAL_OK;
+}
+#endif
+
+#if DIGITAL_IN_ENABLE
+/**
+  * @brief Send the queued digital input records as digital packets while
+  *        control slots are free (digital_in.h)
+  */
+static void App_PollDigital(void)
+{
+  static TelemetryFrame_DigitalEdge_t edges[TELEMETRY_FRAME_DIGITAL_EDGES];
+  static uint8_t count = 0; // popped, not sent yet
+  uint8_t packet[TELEMETRY_FRAME_ENCODED_MAX];
+  uint16_t packet_len = 0;
+  DigitalIn_Edge_t edge;
+
+  while (telemetry_getClassFreeSlots(TELEMETRY_CLASS_CONTROL) > 0U) {
+    while (count < TELEMETRY_FRAME_DIGITAL_EDGES &&
+           digitalIn_popEdge(&edge) == HAL_OK) {
+      edges[count++] = (TelemetryFrame_DigitalEdge_t){
+          .frame = edge.frame,
+          .time_us = timebase_toMicros(edge.time),
+          .levels = edge.levels,
+          .changed = edge.changed};
+    }
+    if (count == 0U) {
+      return;
+    }
+    DigitalIn_Stats_t ds;
+    (void)digitalIn_getStats(&ds);
+    const TelemetryFrame_Digital_t pkt = {.timestamp = HAL_GetTick(),
+                                          .pins = ds.pins,
+                                          .dropped = ds.dropped,
+                                          .count = count,
+                                          .edges = edges};
+    if (telemetryFrame_encodeDigital(&pkt, packet, sizeof(packet),
+                                     &packet_len) == HAL_OK) {
+      telemetry_sendClass(packet, packet_len, TELEMETRY_CLASS_CONTROL);
+    }
+    count = 0;
+  }
+}
+
+/**
+  * @brief The DIN line: input levels and sampler counters (digital_in.h)
+  */
+static void App_ReportDigital(void)
+{
+  DigitalIn_Stats_t ds;
+  char line[160];
+
+  (void)digitalIn_getStats(&ds);
+  const int len = snprintf(
+      line, sizeof(line),
+      "DIN %s aligned=%u pins=0x%04x levels=0x%04x frames=%lu edges=%lu "
+      "dropped=%lu realigned=%lu dma_errors=%lu\r\n",
+      ds.running ? "on" : "off", ds.aligned, ds.pins, ds.levels,
+      (unsigned long)ds.frames, (unsigned long)ds.edges,
+      (unsigned long)ds.dropped, (unsigned long)ds.realigned,
+      (unsigned long)ds.dma_errors);
+  if (len > 0) {
+    telemetry_send((const uint8_t *)line, (uint16_t)strlen(line));
+  }
+}
+
+/**
+  * @brief "din [on|off]": sample the digital inputs on every scan trigger,
+  *        or stop; the DIN line after each
+  */
+static HAL_StatusTypeDef App_CmdDin(uint32_t argc, char *argv[], void *ctx)
+{
+  HAL_StatusTypeDef status = HAL_OK;
+
+  UNUSED(ctx);
+  if (argc == 2U && strcmp(argv[1], "on") == 0) {
+    status = digitalIn_start();
+  } else if (argc == 2U && strcmp(argv[1], "off") == 0) {
+    digitalIn_stop();
+  } else if (argc != 1U) {
+    return HAL_ERROR;
+  }
+  if (status == HAL_OK) {
+    App_ReportDigital();
+  }
+  return status;
+}
+#endif
+
+#if DSP_WINDOW_ENABLE
+/**
+  * @brief One WINDOW line per channel: max, min, peak-to-peak, mean and
+  *        AC RMS of its last frames (dsp_window.h)
+  */
+static void App_ReportWindow(void)
+{
+  DSP_WindowResult_t r;
+  char line[128];
+
+  for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+    if (dspWindow_get(&sliding, ch, &r) != HAL_OK) {
+      continue;
+    }
+    int len = snprintf(line, sizeof(line),
+                       "WINDOW ch=%u window=%u frames=%u max=%u min=%u pp=%u",
+                       ch, sliding.window, r.frames, r.max, r.min,
+                       (unsigned)(r.max - r.min));
+    len = App_AppendCenti(line, sizeof(line), len, "mean",
+                          (int32_t)lroundf(r.mean * 100.0f));
+    len = App_AppendCenti(line, sizeof(line), len, "rms",
+                          (int32_t)lroundf(r.rms * 100.0f));
+    if (len > 0 && (size_t)len + 2U < sizeof(line)) {
+      strcpy(&line[len], "\r\n");
+      telemetry_send((const uint8_t *)line, (uint16_t)strlen(line));
+    }
+  }
+}
+
+/**
+  * @brief "window [<ms>]": slide the metrics over the last ms of frames at
+  *        the scan rate, up to DSP_WINDOW_MAX_FRAMES; the WINDOW lines after
+  */
+static HAL_StatusTypeDef App_CmdWindow(uint32_t argc, char *argv[], void *ctx)
+{
+  char *end = NULL;
+
+  UNUSED(ctx);
+  if (argc == 2U) {
+    const unsigned long ms = strtoul(argv[1], &end, 10);
+    if (end == argv[1] || *end != '\0' || ms == 0U || ms > 60000U) {
+      return HAL_ERROR;
+    }
+    const uint32_t frames = (uint32_t)((uint64_t)ms * scan_rate_hz / 1000U);
+    if (frames == 0U || frames > DSP_WINDOW_MAX_FRAMES) {
+      return HAL_ERROR;
+    }
+    // The block callback slides it: restart it between two blocks
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    const HAL_StatusTypeDef status = dspWindow_init(
+        &sliding, (uint16_t)frames, analogSensor_getBlockChannelMap());
+    __set_PRIMASK(primask);
+    if (status != HAL_OK) {
+      return status;
+    }
+  } else if (argc != 1U) {
+    return HAL_ERROR;
+  }
+  App_ReportWindow();
+  return HAL_OK;
+}
+#endif
+
+/**
+  * @brief Quality result line of a finished capture: rate, tone and the FFT
+  *        figures (dsp_quality.h)
+  */
+static void App_ReportQuality(const uint16_t *samples, uint32_t count)
+{
+  DSP_QualityResult_t q;
+  char line[160];
+  const uint32_t rate = analogSensor_getCaptureRate();
+
+  if (dspQuality_analyse(samples, count, &q) != HAL_OK) {
+    const int len = snprintf(line, sizeof(line), "QUALITY ch=%u error\r\n",
+                             quality_channel);
+    if (len > 0) {
+      telemetry_send((const uint8_t *)line, (uint16_t)strlen(line));
+    }
+    return;
+  }
+  int len = snprintf(line, sizeof(line),
+                     "QUALITY ch=%u rate=%lu points=%lu tone_hz=%lu amp=%lu",
+                     quality_channel, (unsigned long)rate,
+                     (unsigned long)q.length,
+                     (unsigned long)lroundf(q.tone * (float32_t)rate),
+                     (unsigned long)lroundf(q.amplitude));
+  len = App_AppendCenti(line, sizeof(line), len, "snr",
+                        (int32_t)lroundf(q.snr_db * 100.0f));
+  len = App_AppendCenti(line, sizeof(line), len, "sinad",
+                        (int32_t)lroundf(q.sinad_db * 100.0f));
+  len = App_AppendCenti(line, sizeof(line), len, "thd",
+                        (int32_t)lroundf(q.thd_db * 100.0f));
+  len = App_AppendCenti(line, sizeof(line), len, "sfdr",
+                        (int32_t)lroundf(q.sfdr_db * 100.0f));
+  len = App_AppendCenti(line, sizeof(line), len, "enob",
+                        (int32_t)lroundf(q.enob * 100.0f));
+  if (len > 0 && (size_t)len + 2U < sizeof(line)) {
+    strcpy(&line[len], "\r\n");
+    telemetry_send((const uint8_t *)line, (uint16_t)strlen(line));
+  }
+}
+
+/**
+  * @brief "quality <channel>": a reference tone from an external generator,
+  *        taken by the interleaved capture and analysed once it is full;
+  *        the scan pauses for the capture
+  */
+static HAL_StatusTypeDef App_CmdQuality(uint32_t argc, char *argv[], void *ctx)
+{
+  char *end = NULL;
+
+  UNUSED(ctx);
+  if (argc != 2U) {
+    return HAL_ERROR;
+  }
+  const unsigned long channel = strtoul(argv[1], &end, 10);
+  if (end == argv[1] || *end != '\0' ||
+      channel >= ADC_CONVERSIONS_CHANNEL_COUNT) {
+    return HAL_ERROR;
+  }
+  if (quality_channel != QUALITY_IDLE || adcReplay_isActive() ||
+      burstCapture_getState() == BURST_CAPTURE_RUNNING) {
+    return HAL_BUSY;
+  }
+#if DAC_LOOPBACK_ENABLE
+  if (dacLoop_isRunning()) {
+    return HAL_BUSY;
+  }
+#endif
+  // Out of the running scan at a block boundary, its timeline kept
+  if (analogSensor_switchToCapture((uint8_t)channel, NULL, NULL) == HAL_OK) {
+    quality_channel = (uint8_t)channel;
+    quality_switched = 1;
+    return HAL_OK;
+  }
+#if EXT_ADC_ENABLE
+  extAdc_stop();
+#endif
+#if ADC_MUX_ENABLE
+  adcMux_stop();
+#endif
+  analogSensor_stopDMA();
+  const HAL_StatusTypeDef status =
+      analogSensor_startCapture((uint8_t)channel, NULL, NULL);
+  if (status != HAL_OK) {
+    App_RestartScan();
+    return status;
+  }
+  quality_channel = (uint8_t)channel;
+  quality_switched = 0;
+  return HAL_OK;
+}
+
+/**
+  * @brief "histogram <channel> [reset]": percentiles and rail counts of one
+  *        channel's raw codes since the last reset, as a text line, then
+  *        optionally a reset; "histogram reset" only resets
+  */
+static HAL_StatusTypeDef App_CmdHistogram(uint32_t argc, char *argv[],
+                                          void *ctx)
+{
+  // Minimum, 1st, 5th, median, 95th, 99th percentile and maximum
+  static const float32_t pct[] = {0.0f, 1.0f, 5.0f, 50.0f, 95.0f, 99.0f,
+                                  100.0f};
+  static const char *const names[] = {"min", "p1",  "p5", "p50",
+                                      "p95", "p99", "max"};
+  static DSP_HistogramSnapshot_t snap; // 1 kB, off the stack
+  float32_t code[sizeof(pct) / sizeof(pct[0])];
+  char *end = NULL;
+  char line[200];
+
+  UNUSED(ctx);
+  if (argc == 2U && strcmp(argv[1], "reset") == 0) {
+    dspHistogram_reset(&histogram);
+    return HAL_OK;
+  }
+  if (argc < 2U || argc > 3U ||
+      (argc == 3U && strcmp(argv[2], "reset") != 0)) {
+    return HAL_ERROR;
+  }
+  const unsigned long channel = strtoul(argv[1], &end, 10);
+  if (end == argv[1] || *end != '\0' ||
+      channel >= ADC_CONVERSIONS_CHANNEL_COUNT) {
+    return HAL_ERROR;
+  }
+  if (dspHistogram_snapshot(&histogram, (uint8_t)channel, &snap,
+                            (uint8_t)(argc == 3U)) != HAL_OK) {
+    return HAL_ERROR;
+  }
+  HAL_StatusTypeDef status = dspHistogram_percentiles(
+      &snap, pct, (uint8_t)(sizeof(pct) / sizeof(pct[0])), code);
+  if (status != HAL_OK) {
+    return status;
+  }
+
+  // The end bins hold the rails: a clipping input piles up there
+  int len = snprintf(line, sizeof(line),
+                     "HIST ch=%lu n=%lu bin=%u low=%lu high=%lu", channel,
+                     (unsigned long)snap.total, 1U << snap.shift,
+                     (unsigned long)snap.counts[0],
+                     (unsigned long)snap.counts[snap.bin_count - 1U]);
+  for (uint8_t i = 0; i < sizeof(pct) / sizeof(pct[0]); i++) {
+    len = App_AppendCenti(line, sizeof(line), len, names[i],
+                          (int32_t)lroundf(code[i] * 100.0f));
+  }
+  if (len > 0 && (size_t)len + 2U < sizeof(line)) {
+    strcpy(&line[len], "\r\n");
+    telemetry_send((const uint8_t *)line, (uint16_t)strlen(line));
+  }
+  return HAL_OK;
+}
+
+/**
+  * @brief Send one channel's rainflow matrix, a packet per slice of rows
+  */
+static void App_SendRainflow(const DSP_RainflowResult_t *res)
+{
+  _Static_assert(DSP_RAINFLOW_MEAN_BINS <= TELEMETRY_FRAME_RAINFLOW_CELLS,
+                 "a matrix row must fit one rainflow packet");
+  const uint8_t rows = TELEMETRY_FRAME_RAINFLOW_CELLS / DSP_RAINFLOW_MEAN_BINS;
+  TelemetryFrame_Rainflow_t pkt = {
+      .sequence = ++rainflow_requests,
+      .timestamp = HAL_GetTick(),
+      .channel = res->channel,
+      .range_bins = DSP_RAINFLOW_RANGE_BINS,
+      .mean_bins = DSP_RAINFLOW_MEAN_BINS,
+      .residual = res->residual,
+      .range_bin_codes = RAINFLOW_RANGE_BIN,
+      .mean_low_codes = RAINFLOW_MEAN_LOW,
+      .mean_bin_codes = RAINFLOW_MEAN_BIN,
+      .cycles = 0.5f * (float32_t)res->half_total,
+      .damage = res->damage,
+      .damage_residual = res->damage_residual};
+  uint8_t packet[TELEMETRY_FRAME_ENCODED_MAX];
+  uint16_t packet_len = 0;
+  for (uint8_t r = 0; r < DSP_RAINFLOW_RANGE_BINS; r += rows) {
+    pkt.first_row = r;
+    pkt.row_count = (uint8_t)((DSP_RAINFLOW_RANGE_BINS - r < rows)
+                                  ? DSP_RAINFLOW_RANGE_BINS - r
+                                  : rows);
+    memcpy(pkt.half_cycles, res->half_cycles[r],
+           pkt.row_count * sizeof(res->half_cycles[0]));
+    if (telemetryFrame_encodeRainflow(&pkt, packet, sizeof(packet),
+                                      &packet_len) == HAL_OK) {
+      telemetry_sendClass(packet, packet_len, TELEMETRY_CLASS_CONTROL);
+    }
+  }
+}
+
+/**
+  * @brief "rainflow <channel> [reset]|mask <bits>|reset": one channel's
+  *        cycle matrix and damage as type-24 packets, then optionally a
+  *        reset; the channels counted (saved); or a reset of every count
+  */
+static HAL_StatusTypeDef App_CmdRainflow(uint32_t argc, char *argv[],
+                                         void *ctx)
+{
+  static DSP_RainflowResult_t res; // half a kB, off the stack
+  char *end = NULL;
+
+  UNUSED(ctx);
+  if (argc == 2U && strcmp(argv[1], "reset") == 0) {
+    dspRainflow_reset(&rainflow);
+    return HAL_OK;
+  }
+  if (argc == 3U && strcmp(argv[1], "mask") == 0) {
+    const unsigned long bits = strtoul(argv[2], &end, 0);
+    if (end == argv[2] || *end != '\0' ||
+        (bits & ~(unsigned long)TELEMETRY_FRAME_ALL_CHANNELS) != 0UL) {
+      return HAL_ERROR;
+    }
+    rainflow_mask = (ADC_ChannelMask_t)bits;
+    dspRainflow_setChannels(&rainflow, rainflow_mask);
+    App_SaveSettings();
+    return HAL_OK;
+  }
+  if (argc < 2U || argc > 3U ||
+      (argc == 3U && strcmp(argv[2], "reset") != 0)) {
+    return HAL_ERROR;
+  }
+  const unsigned long channel = strtoul(argv[1], &end, 10);
+  if (end == argv[1] || *end != '\0' ||
+      channel >= ADC_CONVERSIONS_CHANNEL_COUNT) {
+    return HAL_ERROR;
+  }
+  if (dspRainflow_snapshot(&rainflow, (uint8_t)channel, &res,
+                           (uint8_t)(argc == 3U)) != HAL_OK) {
+    return HAL_ERROR;
+  }
+  App_SendRainflow(&res);
+  return HAL_OK;
+}
+
+/**
+  * @brief "srs off|on|only": no shock response spectra of captures, the
+  *        spectra before the raw frames, or the spectra alone (saved)
+  */
+static HAL_StatusTypeDef App_CmdSrs(uint32_t argc, char *argv[], void *ctx)
+{
+  UNUSED(ctx);
+  if (argc != 2U) {
+    return HAL_ERROR;
+  }
+  if (strcmp(argv[1], "off") == 0) {
+    srs_mode = SRS_OFF;
+  } else if (strcmp(argv[1], "on") == 0) {
+    srs_mode = SRS_ON;
+  } else if (strcmp(argv[1], "only") == 0) {
+    srs_mode = SRS_ONLY;
+  } else {
+    return HAL_ERROR;
+  }
+  App_SaveSettings(); // the capture in progress keeps its mode
+  return HAL_OK;
+}
+
+/**
+  * @brief Drain a full burst: the scan first comes back, then the samples
+  *        go out as burst packets while bulk slots are free, and the region
+  *        is given back after the last one
+  */
+static void App_PollBurst(void)
+{
+  const uint16_t *samples = NULL;
+  uint32_t count = 0;
+
+  if (burstCapture_getSamples(&samples, &count) != HAL_OK) {
+    return;
+  }
+  if (!burst_draining) {
+    analogSensor_stopDMA();
+    App_RestartScan();
+    burst_draining = 1;
+    burst_offset = 0;
+  }
+  for (uint32_t n = 0; n < BURST_PACKETS_PER_POLL && burst_offset < count &&
+                       telemetry_getClassFreeSlots(TELEMETRY_CLASS_BULK) > 0U;
+       n++) {
+    const uint32_t left = count - burst_offset;
+    const TelemetryFrame_Burst_t pkt = {
+        .offset = burst_offset,
+        .timestamp = burstCapture_getStartTick(),
+        .channel = burstCapture_getChannel(),
+        .count = (uint8_t)((left < TELEMETRY_FRAME_BURST_SAMPLES)
+                               ? left
+                               : TELEMETRY_FRAME_BURST_SAMPLES),
+        .total = count,
+        .sample_rate_hz = analogSensor_getCaptureRate(),
+        .samples = &samples[burst_offset]};
+    if (telemetryFrame_encodeBurst(&pkt, packet, sizeof(packet),
+                                   &packet_len) == HAL_OK) {
+      telemetry_sendClass(packet, packet_len, TELEMETRY_CLASS_BULK);
+    }
+    burst_offset += pkt.count;
+  }
+  if (burst_offset < count) {
+    return;
+  }
+  burst_draining = 0;
+  (void)burstCapture_release();
+  char line[64];
+  const int len = snprintf(line, sizeof(line), "BURST done samples=%lu\r\n",
+                           (unsigned long)count);
+  if (len > 0) {
+    telemetry_send((const uint8_t *)line, (uint16_t)strlen(line));
+  }
+}
+
+/**
+  * @brief Send the pinned snapshot from the history as sample packets while
+  *        bulk slots are free, giving back each packet's frames once queued
+  */
+static void App_PollSnapshot(void)
+{
+  if (!adcTrigger_isPinned()) {
+    return;
+  }
+  uint8_t recovered = 0; // frames of the last boot: not timed on this one
+#if ADC_TRIGGER_RETAIN_ENABLE
+  if (snapshot_recovered == 1U) {
+    char head[80];
+    const int n = snprintf(head, sizeof(head),
+                           "SNAP recovered first=%lu frames=%lu tick=%lu\r\n",
+                           (unsigned long)snapshot.first_frame,
+                           (unsigned long)snapshot.frame_count,
+                           (unsigned long)snapshot.timestamp);
+    if (n > 0 && telemetry_send((const uint8_t *)head,
+                                (uint16_t)strlen(head)) == HAL_OK) {
+      snapshot_recovered = 2;
+    }
+    return;
+  }
+  recovered = (snapshot_recovered != 0U);
+#endif
+  for (uint32_t n = 0; n < SNAPSHOT_PACKETS_PER_POLL &&
+                       snapshot_sent < snapshot.frame_count &&
+                       telemetry_getClassFreeSlots(TELEMETRY_CLASS_BULK) > 0U;
+       n++) {
+    TelemetryFrame_Batch_t snap_batch;
+    ADC_RingEntry_t entry = {.timestamp = snapshot.timestamp};
+    telemetryFrame_initBatch(&snap_batch, TELEMETRY_FRAME_ALL_CHANNELS);
+    while (snapshot_sent < snapshot.frame_count &&
+           !telemetryFrame_isFull(&snap_batch)) {
+      entry.sequence = snapshot.first_frame + snapshot_sent;
+      const ADC_Frame_t *frame = adcTrigger_getSnapshotFrame(entry.sequence);
+      if (frame == NULL) {
+        return; // dropped by "snapshot off"
+      }
+      entry.frame = *frame;
+      telemetryFrame_addFrame(&snap_batch, &entry);
+      snapshot_sent++;
+    }
+    App_SendSamples(&snap_batch, TELEMETRY_CLASS_BULK,
+                    recovered ? 0U : analogSensor_getFrameTime(entry.sequence));
+    adcTrigger_releaseSnapshot(snapshot.first_frame + snapshot_sent);
+  }
+  if (snapshot_sent < snapshot.frame_count) {
+    return;
+  }
+#if ADC_TRIGGER_RETAIN_ENABLE
+  snapshot_recovered = 0;
+#endif
+  ADC_TriggerStats_t stats;
+  adcTrigger_getStats(&stats);
+  char line[96];
+  const int len = snprintf(
+      line, sizeof(line),
+      "SNAP done first=%lu frames=%lu pinned_frames=%lu cut_captures=%lu\r\n",
+      (unsigned long)snapshot.first_frame, (unsigned long)snapshot.frame_count,
+      (unsigned long)stats.pinned_frames, (unsigned long)stats.cut_captures);
+  if (len > 0) {
+    telemetry_send((const uint8_t *)line, (uint16_t)strlen(line));
+  }
+}
+
+/**
+  * @brief Send one log packet while a bulk slot is free: the previous
+  *        boot's entries first, then this boot's; consumed once queued
+  */
+static void App_PollEventLog(void)
+{
+  EventLog_Entry_t entries[TELEMETRY_FRAME_LOG_ENTRIES];
+  EventLog_Batch_t batch;
+
+  if (telemetry_getClassFreeSlots(TELEMETRY_CLASS_BULK) == 0U ||
+      eventLog_peek(entries, TELEMETRY_FRAME_LOG_ENTRIES, &batch) != HAL_OK) {
+    return;
+  }
+  const TelemetryFrame_Log_t pkt = {.first = batch.first,
+                                    .timestamp = HAL_GetTick(),
+                                    .boot = batch.boot,
+                                    .previous = batch.previous,
+                                    .count = batch.count,
+                                    .lost = batch.lost,
+                                    .entries = entries};
+  if (telemetryFrame_encodeLog(&pkt, packet, sizeof(packet), &packet_len) ==
+          HAL_OK &&
+      telemetry_sendClass(packet, packet_len, TELEMETRY_CLASS_BULK) ==
+          HAL_OK) {
+    eventLog_consume(&batch);
+  }
+}
+
+#if QSPI_REC_ROLLUP_ENABLE
+/**
+  * @brief Send the records of a "rollup" range, a packet per channel,
+  *        while bulk slots are free, and a ROLLUP done line after the last
+  */
+static void App_PollRollups(void)
+{
+  uint32_t n = 0;
+
+  while (rollup_active && n < ROLLUP_PACKETS_PER_POLL &&
+         telemetry_getClassFreeSlots(TELEMETRY_CLASS_BULK) > 0U) {
+    if (rollup_channel >= ADC_CONVERSIONS_CHANNEL_COUNT) {
+      const HAL_StatusTypeDef status =
+          qspiRec_nextRollup(&rollup_query, &rollup_record);
+      if (status == HAL_BUSY) {
+        return;
+      }
+      if (status != HAL_OK) {
+        rollup_active = 0;
+        char line[48];
+        const int len = snprintf(line, sizeof(line),
+                                 "ROLLUP done records=%lu\r\n",
+                                 (unsigned long)rollup_sent);
+        if (len > 0) {
+          telemetry_send((const uint8_t *)line, (uint16_t)strlen(line));
+        }
+        return;
+      }
+      rollup_channel = 0;
+      rollup_sent++;
+    }
+    const uint8_t ch = rollup_channel++;
+    if (!((rollup_record.channel_mask >> ch) & 1U)) {
+      continue;
+    }
+    const TelemetryFrame_Rollup_t pkt = {.time_s = rollup_record.time_s,
+                                         .timestamp = HAL_GetTick(),
+                                         .tier = rollup_record.tier,
+                                         .channel = ch,
+                                         .windows = rollup_record.windows,
+                                         .min = rollup_record.min[ch],
+                                         .max = rollup_record.max[ch],
+                                         .mean = rollup_record.mean[ch]};
+    if (telemetryFrame_encodeRollup(&pkt, packet, sizeof(packet),
+                                    &packet_len) == HAL_OK) {
+      telemetry_sendClass(packet, packet_len, TELEMETRY_CLASS_BULK);
+    }
+    n++;
+  }
+}
+#endif
+
+/**
+  * @brief Budget line of a burst plan
+  */
+static void App_ReportBurstPlan(const BurstCapture_Plan_t *plan)
+{
+  char line[224];
+  const int len = snprintf(
+      line, sizeof(line),
+      "BURST plan region=%s base=0x%08lx bytes=%lu sram1=%lu sram2=%lu "
+      "dtcm_free=%lu sram_free=%lu samples=%lu rate=%lu duration_us=%lu "
+      "dma_Bps=%lu drain_ms=%lu\r\n",
+      (plan->region == BURST_CAPTURE_REGION_DTCM)   ? "dtcm"
+      : (plan->region == BURST_CAPTURE_REGION_SRAM) ? "sram"
+                                                    : "none",
+      (unsigned long)plan->base, (unsigned long)plan->bytes,
+      (unsigned long)plan->sram1_bytes, (unsigned long)plan->sram2_bytes,
+      (unsigned long)plan->dtcm_free, (unsigned long)plan->sram_free,
+      (unsigned long)plan->samples, (unsigned long)plan->sample_rate_hz,
+      (unsigned long)plan->duration_us, (unsigned long)plan->dma_bytes_per_s,
+      (unsigned long)plan->drain_ms);
+  if (len > 0) {
+    telemetry_send((const uint8_t *)line, (uint16_t)strlen(line));
+  }
+}
+
+/**
+  * @brief "burst plan|<channel>|off": report the largest free RAM region and
+  *        its budget, record one channel into it at the capture rate, or
+  *        abort / drop the burst held
+  */
+static HAL_StatusTypeDef App_CmdBurst(uint32_t argc, char *argv[], void *ctx)
+{
+  BurstCapture_Plan_t plan;
+  Telemetry_LinkInfo_t link;
+  char *end = NULL;
+
+  UNUSED(ctx);
+  if (argc != 2U) {
+    return HAL_ERROR;
+  }
+  if (strcmp(argv[1], "off") == 0) {
+    if (burstCapture_getState() == BURST_CAPTURE_RUNNING) {
+      analogSensor_stopDMA();
+      App_RestartScan();
+    }
+    burst_draining = 0;
+    return burstCapture_release();
+  }
+  telemetry_getLink(&link);
+  if (strcmp(argv[1], "plan") == 0) {
+    const HAL_StatusTypeDef status =
+        burstCapture_plan(link.actual_baud, &plan);
+    App_ReportBurstPlan(&plan);
+    return (status == HAL_BUSY) ? HAL_OK : status;
+  }
+  const unsigned long channel = strtoul(argv[1], &end, 10);
+  if (end == argv[1] || *end != '\0' ||
+      channel >= ADC_CONVERSIONS_CHANNEL_COUNT) {
+    return HAL_ERROR;
+  }
+  if (quality_channel != QUALITY_IDLE || adcReplay_isActive() ||
+      burstCapture_getState() != BURST_CAPTURE_IDLE) {
+    return HAL_BUSY;
+  }
+#if DAC_LOOPBACK_ENABLE
+  if (dacLoop_isRunning()) {
+    return HAL_BUSY;
+  }
+#endif
+  HAL_StatusTypeDef status = burstCapture_plan(link.actual_baud, &plan);
+  App_ReportBurstPlan(&plan);
+  if (status != HAL_OK) {
+    return status;
+  }
+#if EXT_ADC_ENABLE
+  extAdc_stop();
+#endif
+#if ADC_MUX_ENABLE
+  adcMux_stop();
+#endif
+#if CLOCK_GOV_ENABLE
+  clockGov_boost(GOV_BURST_BOOST_MS); // fast for the capture and its drain
+#endif
+  analogSensor_stopDMA();
+  status = burstCapture_start((uint8_t)channel, &plan);
+  if (status != HAL_OK) {
+    App_RestartScan();
+  }
+  return status;
+}
+
+/**
+  * @brief "snapshot <ms>|off": pin the last ms of the trigger history and
+  *        send it at bulk priority while acquisition goes on, or drop the
+  *        snapshot being sent
+  */
+static HAL_StatusTypeDef App_CmdSnapshot(uint32_t argc, char *argv[],
+                                         void *ctx)
+{
+  char *end = NULL;
+
+  UNUSED(ctx);
+  if (argc != 2U) {
+    return HAL_ERROR;
+  }
+  if (strcmp(argv[1], "off") == 0) {
+    adcTrigger_unpinSnapshot();
+    return HAL_OK;
+  }
+  const unsigned long ms = strtoul(argv[1], &end, 10);
+  if (end == argv[1] || *end != '\0' || ms == 0UL) {
+    return HAL_ERROR;
+  }
+  const uint64_t frames =
+      ((uint64_t)ms * analogSensor_getSampleRate() + 999U) / 1000U;
+  if (frames > ADC_TRIGGER_SNAPSHOT_MAX_FRAMES) {
+    return HAL_ERROR;
+  }
+  const HAL_StatusTypeDef status =
+      adcTrigger_pinSnapshot((uint32_t)frames, &snapshot);
+  if (status != HAL_OK) {
+    return status;
+  }
+  snapshot_sent = 0;
+  char line[64];
+  const int len = snprintf(line, sizeof(line), "SNAP first=%lu frames=%lu\r\n",
+                           (unsigned long)snapshot.first_frame,
+                           (unsigned long)snapshot.frame_count);
+  if (len > 0) {
+    telemetry_send((const uint8_t *)line, (uint16_t)strlen(line));
+  }
+  return HAL_OK;
+}
+
+#if QSPI_REC_ROLLUP_ENABLE
+/**
+  * @brief ROLLUP line: clock, held span and writes per tier (-1 = none)
+  */
+static void App_ReportRollups(void)
+{
+  QspiRec_RollupStats_t st;
+  char line[224];
+
+  (void)qspiRec_getRollupStats(&st);
+  const int len = snprintf(
+      line, sizeof(line),
+      "ROLLUP clock=%lu 1s=%ld..%ld 1m=%ld..%ld 1h=%ld..%ld "
+      "written=%lu,%lu,%lu slots=%lu,%lu,%lu dropped=%lu\r\n",
+      (unsigned long)st.clock_s, (long)(int32_t)st.oldest_s[0],
+      (long)(int32_t)st.newest_s[0], (long)(int32_t)st.oldest_s[1],
+      (long)(int32_t)st.newest_s[1], (long)(int32_t)st.oldest_s[2],
+      (long)(int32_t)st.newest_s[2], (unsigned long)st.records[0],
+      (unsigned long)st.records[1], (unsigned long)st.records[2],
+      (unsigned long)st.capacity[0], (unsigned long)st.capacity[1],
+      (unsigned long)st.capacity[2], (unsigned long)st.dropped);
+  if (len > 0) {
+    telemetry_send((const uint8_t *)line, (uint16_t)strlen(line));
+  }
+}
+
+/**
+  * @brief "rollup [1s|1m|1h <from_s> <to_s>|time <s>|off]": send the stored
+  *        records of a tier starting in [from_s, to_s), set the rollup
+  *        clock, or stop sending; no argument sends the ROLLUP line
+  */
+static HAL_StatusTypeDef App_CmdRollup(uint32_t argc, char *argv[],
+                                       void *ctx)
+{
+  static const char *const tier_names[QSPI_REC_TIER_COUNT] = {"1s", "1m",
+                                                              "1h"};
+  unsigned long value[2] = {0};
+  char *end = NULL;
+
+  UNUSED(ctx);
+  if (argc == 1U) {
+    App_ReportRollups();
+    return HAL_OK;
+  }
+  if (argc == 2U && strcmp(argv[1], "off") == 0) {
+    rollup_active = 0;
+    return HAL_OK;
+  }
+  if (argc == 3U && strcmp(argv[1], "time") == 0) {
+    value[0] = strtoul(argv[2], &end, 10);
+    if (end == argv[2] || *end != '\0') {
+      return HAL_ERROR;
+    }
+    return qspiRec_setClock((uint32_t)value[0]);
+  }
+  if (argc != 4U) {
+    return HAL_ERROR;
+  }
+  uint8_t tier = 0;
+  while (tier < QSPI_REC_TIER_COUNT && strcmp(argv[1], tier_names[tier]) != 0) {
+    tier++;
+  }
+  for (uint32_t i = 0; i < 2U; i++) {
+    value[i] = strtoul(argv[i + 2U], &end, 10);
+    if (end == argv[i + 2U] || *end != '\0') {
+      return HAL_ERROR;
+    }
+  }
+  if (tier == QSPI_REC_TIER_COUNT || value[1] <= value[0]) {
+    return HAL_ERROR;
+  }
+  const HAL_StatusTypeDef status =
+      qspiRec_queryRollups((QspiRec_Tier_t)tier, (uint32_t)value[0],
+                           (uint32_t)value[1], &rollup_query);
+  if (status == HAL_OK) {
+    rollup_channel = ADC_CONVERSIONS_CHANNEL_COUNT; // read a record first
+    rollup_sent = 0;
+    rollup_active = 1;
+  }
+  return status;
+}
+#endif
+
+// Host commands (host_cmd.h); "help" lists them
+static const HostCmd_Command_t host_commands[] = {
+    {"rate", App_CmdRate, NULL, "rate <hz>"},
+    {"phase", App_CmdPhase, NULL, "phase <ns from PWM peak>"},
+    {"mask", App_CmdMask, NULL, "mask <channel bits>"},
+    {"pipeline", App_CmdPipeline, NULL,
+     "pipeline spectrum|envelope|harmonics|velocity|display|histogram|order|"
+     "despike|codec on|off"},
+    {"codec", App_CmdCodec, NULL, "codec [lossless|<max_error>]"},
+    {"capture", App_CmdCapture, NULL, "capture start|stop"},
+    {"report", App_CmdReport, NULL, "report full|exception|score"},
+    {"anomaly", App_CmdAnomaly, NULL, "anomaly [learn [windows]|cadence <n>]"},
+    {"budget", App_CmdBudget, NULL, "budget alarm|control|bulk <pct>"},
+    {"features", App_CmdFeatures, NULL, "features binary|cbor"},
+    {"bands", App_CmdBands, NULL, "bands off|octave|third"},
+    {"cepstrum", App_CmdCepstrum, NULL,
+     "cepstrum off|<peaks> [<min_ms> <max_ms>]"},
+#if TACH_ENABLE
+    {"tsa", App_CmdTsa, NULL, "tsa off|<revolutions>"},
+#endif
+    {"baseline", App_CmdBaseline, NULL, "baseline [learn|save|gate on|off]"},
+    {"ascii", App_CmdAscii, NULL, "ascii on|off"},
+    {"deskew", App_CmdDeskew, NULL, "deskew [on|off]"},
+    {"fft", App_CmdFft, NULL, "fft [spread|burst|reset]"},
+    {"replay", App_CmdReplay, NULL, "replay vector|qspi [fast] [count]|off"},
+    {"selftest", App_CmdSelfTest, NULL,
+     "selftest [settling bits]|linearity [reset]|off"},
+    {"autotune", App_CmdAutotune, NULL,
+     "autotune [<enob> [<headroom %>]|off]"},
+    {"quality", App_CmdQuality, NULL, "quality <channel>"},
+    {"histogram", App_CmdHistogram, NULL, "histogram <channel> [reset]|reset"},
+    {"rainflow", App_CmdRainflow, NULL,
+     "rainflow <channel> [reset]|mask <bits>|reset"},
+    {"srs", App_CmdSrs, NULL, "srs off|on|only"},
+    {"expr", App_CmdExpr, NULL, "expr [+ <text>|clear|set|off]"},
+    {"burst", App_CmdBurst, NULL, "burst plan|<channel>|off"},
+    {"snapshot", App_CmdSnapshot, NULL, "snapshot <ms>|off"},
+#if QSPI_REC_ROLLUP_ENABLE
+    {"rollup", App_CmdRollup, NULL,
+     "rollup [1s|1m|1h <from_s> <to_s>|time <s>|off]"},
+#endif
+    {"interlock", App_CmdInterlock, NULL, "interlock reset"},
+    {"stats", App_CmdStats, NULL, "stats"},
+    {"retained", App_CmdRetained, NULL, "retained [clear]"},
+    {"trace", App_CmdTrace, NULL, "trace <SWO port bits>"},
+    {"pcs", App_CmdPcs, NULL, "pcs start [hz] [lr]|stop|dump"},
+    {"latency", App_CmdLatency, NULL, "latency [reset]"},
+#if SCAN_JITTER_ENABLE
+    {"jitter", App_CmdJitter, NULL, "jitter [on|off|reset]"},
+#endif
+#if CLOCK_GOV_ENABLE
+    {"gov", App_CmdGov, NULL, "gov [auto|fast|slow|boost <ms>]"},
+#endif
+#if DIGITAL_IN_ENABLE
+    {"din", App_CmdDin, NULL, "din [on|off]"},
+#endif
+#if DSP_WINDOW_ENABLE
+    {"window", App_CmdWindow, NULL, "window [<ms>]"},
+#endif
+    {"perf", App_CmdPerf, NULL, "perf <stage> [windows]|off"},
+    {"dmaisr", App_CmdDmaIsr, NULL, "dmaisr [fast|hal|reset]"},
+    {"groups", App_CmdGroups, NULL, "groups on [size]|off"},
+    {"preset", App_CmdPreset, NULL, "preset [latency|throughput|reset]"},
+    {"resolution", App_CmdResolution, NULL, "resolution [12|10|8|6]"},
+#if ADC_RANGE_ENABLE
+    {"range", App_CmdRange, NULL, "range [auto|2|6]"},
+#endif
+#if USB_MSC_ENABLE
+    {"msc", App_CmdMsc, NULL, "msc [on|off]"},
+#endif
+#if ADC_MUX_ENABLE
+    {"mux", App_CmdMux, NULL, "mux [settle <ns>]"},
+#endif
+    {"mem", App_CmdMem, NULL, "mem"},
+    {"energy", App_CmdEnergy, NULL,
+     "energy [reset|model [<state> <ua>|mv <mv>|default]]"},
+    {PROFILER_DUMP_CMD, App_CmdByte, NULL, "p (dump profiler)"},
+    {BACKEND_BENCH_CMD, App_CmdByte, NULL, "b (backend benchmark)"},
+    {CODEC_STREAM_CMD, App_CmdByte, NULL, "z (toggle codec stream)"},
+    {"0", App_CmdByte, NULL, "0..3 (link rate)"},
+    {"1", App_CmdByte, NULL, NULL},
+    {"2", App_CmdByte, NULL, NULL},
+    {"3", App_CmdByte, NULL, NULL},
+    {"h", App_CmdByte, NULL, "h (toggle RTS/CTS)"}};
+_Static_assert(sizeof(link_rates) / sizeof(link_rates[0]) == 4U,
+               "one host command per link rate");
+
+/**
+  * @brief Commands from either link, profiler and TX queue service
+  */
+static void App_Service(void)
+{
+  // Commands from either link, parsed and run here, never in the ISRs
+  uint8_t usb_cmd[USB_CMD_READ];
+  hostCmd_poll();
+  hostCmd_feed(usb_cmd, usbStream_read(usb_cmd, sizeof(usb_cmd)));
+  // Changed settings go to flash a few words per pass; never erases here
+  (void)configStore_poll(0U);
+  // Raw block on the SWO, a bounded slice per pass
+  swoTrace_poll();
+  profiler_poll();
+  pcProfile_poll();
+  isrBudget_poll();
+  latencyHist_poll();
+  scanJitter_poll();
+#if CLOCK_GOV_ENABLE
+  clockGov_poll();
+#endif
+#if DIGITAL_IN_ENABLE
+  App_PollDigital();
+#endif
+  dwtCounters_poll();
+  bootProfile_poll();
+  // The ADCs draw while a scan converts; a replay or a poll leaves them off
+  energyMeter_setPeripheral(ENERGY_METER_PERIPH_ADC,
+                            analogSensor_getMode() != ADC_ACQ_MODE_POLLING &&
+                                analogSensor_getMode() != ADC_ACQ_MODE_REPLAY);
+  energyMeter_poll();
+  telemetry_poll();
+  App_PollBackPressure();
+  App_PollDeadlines();
+  App_PollModeSwitch();
+  App_PollBurst();
+  App_PollSnapshot();
+  App_PollEventLog();
+#if QSPI_REC_ROLLUP_ENABLE
+  App_PollRollups();
+#endif
+#if USB_MSC_ENABLE
+  App_PollMsc();
+#endif
+#if ADAPTIVE_RATE_ENABLE
+  App_PollRate();
+#endif
+#if DAC_LOOPBACK_ENABLE
+  if (dacLoop_poll() == HAL_OK) {
+    App_ReportSelfTest();
+  }
+#endif
+#if ACQ_TUNE_ENABLE
+  App_PollTune(); // after the loopback: its result is complete
+#endif
+  // Quality capture: analysed once full, then the live scan resumes
+  if (quality_channel != QUALITY_IDLE) {
+    const uint16_t *samples = NULL;
+    uint32_t count = 0;
+    const HAL_StatusTypeDef status = analogSensor_getCapture(&samples, &count);
+    if (status != HAL_BUSY) {
+      App_ReportQuality(samples, count);
+      quality_channel = QUALITY_IDLE;
+      if (!quality_switched) {
+        analogSensor_stopDMA();
+        App_RestartScan();
+      } else if (analogSensor_getMode() == ADC_ACQ_MODE_POLLING) {
+        App_RestartScan(); // the scan failed to come back
+      }
+    }
+  }
+  // Replay: next block from its source; the live scan resumes at the end
+  if (adcReplay_isActive()) {
+    ADC_ReplayStats_t replay;
+    analogSensor_pollReplay();
+    analogSensor_getReplayStats(&replay);
+    if (replay.finished) {
+      analogSensor_stopDMA();
+      App_ReportReplay();
+      App_RestartScan();
+    }
+  }
+}
+
+/**
+  * @brief The periodic status, timing, sync and stats packets, every
+  *        REPORT_PERIOD_MS
+  */
+static void App_Report(void)
+{
+  last_report_ms = HAL_GetTick();
+
+  // Status packet: error counters and queue headroom
+  ADC_ErrorInfo_t adc_errors;
+  analogSensor_getErrors(&adc_errors);
+  ADC_RingStats_t ring_stats;
+  adcRing_getStats(&ring_stats);
+  Telemetry_Stats_t tx_stats;
+  telemetry_getStats(&tx_stats);
+  CpuLoad_Stats_t cpu_load;
+  cpuLoad_getStats(&cpu_load);
+  uint16_t vdda_mv = 0;
+  int16_t temperature = 0;
+#if ADC_SUPPLY_ENABLE
+  AdcSupply_Status_t supply;
+  adcSupply_getStatus(&supply);
+  vdda_mv = (uint16_t)(supply.vdda_mv + 0.5f);
+  temperature = App_CentiDegrees(supply.temperature_c);
+#endif
 
-/* USER CODE END PM */
+  TelemetryFrame_Status_t status = {
+      .sequence = last_entry.sequence,
+      .timestamp = last_report_ms,
+      .total_errors = adc_errors.total_errors,
+      .last_failed_channel = adc_errors.last_failed_channel,
+      .ring_high_water = ring_stats.high_water,
+      .ring_overflows = ring_stats.overflows,
+      .telemetry_dropped = tx_stats.dropped,
+      .cpu_load = cpu_load.load_centi_pct,
+      .cpu_peak = cpu_load.peak_centi_pct,
+      .vdda_mv = vdda_mv,
+      .temperature = temperature};
+  if (telemetryFrame_encodeStatus(&status, packet, sizeof(packet),
+                                  &packet_len) == HAL_OK) {
+    telemetry_send(packet, packet_len);
+  }
 
-/* Private variables ---------------------------------------------------------*/
+  // Timing packet: newest block stamp and the measured frame rate
+  ADC_BlockInfo_t block_info;
+  ADC_TimingInfo_t timing_info;
+  if (analogSensor_getBlockInfo(&block_info) == HAL_OK &&
+      analogSensor_getTiming(&timing_info) == HAL_OK) {
+    TelemetryFrame_Timing_t timing = {
+        .first_frame = block_info.first_frame,
+        .timestamp = last_report_ms,
+        .block_time = block_info.timestamp,
+        .frame_count = (uint16_t)block_info.frame_count,
+        .tick_hz = TIMEBASE_TICK_HZ,
+        .nominal_mhz = timing_info.nominal_mhz,
+        .measured_mhz = timing_info.measured_mhz,
+        .drift_ppm = timing_info.drift_ppm,
+        .jitter_ticks = timing_info.jitter_ticks};
+    if (telemetryFrame_encodeTiming(&timing, packet, sizeof(packet),
+                                    &packet_len) == HAL_OK) {
+      telemetry_send(packet, packet_len);
+    }
+  }
 
-/* USER CODE BEGIN PV */
+  // Sync packet: after every pulse, and once a second without one
+  TimeSync_Status_t sync_status;
+  timeSync_getStatus(&sync_status);
+  if (sync_status.pulses != last_sync_pulses ||
+      last_report_ms - last_sync_ms >= STATS_PERIOD_MS) {
+    last_sync_pulses = sync_status.pulses;
+    last_sync_ms = last_report_ms;
+    TelemetryFrame_Sync_t sync = {
+        .pulse_frame = sync_status.pulse_frame,
+        .timestamp = last_report_ms,
+        .state = (uint8_t)sync_status.state,
+        .pulses = sync_status.pulses,
+        .rejected = sync_status.rejected,
+        .missed_updates = sync_status.missed_updates,
+        .phase_ns = sync_status.phase_ns,
+        .clock_ppm = sync_status.clock_ppm,
+        .pulse_time = sync_status.pulse_time};
+    if (telemetryFrame_encodeSync(&sync, packet, sizeof(packet),
+                                  &packet_len) == HAL_OK) {
+      telemetry_send(packet, packet_len);
+    }
+  }
 
-/* USER CODE END PV */
+  if (last_report_ms - last_stats_ms < STATS_PERIOD_MS) {
+    return;
+  }
+  last_stats_ms = last_report_ms;
 
-/* Private function prototypes -----------------------------------------------*/
-void SystemClock_Config(void);
-static void MPU_Config(void);
-/* USER CODE BEGIN PFP */
+  // Stats packet: per-channel aggregates of the window, then restart it;
+  // by exception only what moved since the host's copy
+  TelemetryFrame_Stats_t stats = {.sequence = last_entry.sequence,
+                                  .timestamp = last_report_ms};
+  for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+    stats.dc_bias[ch] = dspDcTrack_getBias(&dc_track, ch);
+  }
+  if (analogSensor_getChannelStats(stats.channels, 1) == HAL_OK) {
+    // Every window is scored, so the normalisation is learned whatever the
+    // mode and "report score" has scores at once
+    TelemetryFrame_Features_t features;
+    telemetryFrame_statsFeatures(&stats, &features);
+    qspiRec_addFeatures(&features);
+    const HAL_StatusTypeDef scored = nnAnomaly_addWindow(&features);
+    HAL_StatusTypeDef encoded;
+    if (report_mode == REPORT_SCORE) {
+      encoded = (scored == HAL_OK)
+                    ? App_EncodeAnomaly(last_report_ms, packet, sizeof(packet),
+                                        &packet_len)
+                    : HAL_BUSY;
+    } else if (report_mode == REPORT_EXCEPTION) {
+      encoded = telemetryFrame_encodeException(&report_state, &features, packet,
+                                               sizeof(packet), &packet_len);
+    } else if (feature_cbor) {
+      encoded = telemetryFrame_encodeStatsCbor(&stats, packet, sizeof(packet),
+                                               &packet_len);
+    } else {
+      encoded = telemetryFrame_encodeStats(&stats, packet, sizeof(packet),
+                                           &packet_len);
+    }
+    if (encoded == HAL_OK) {
+      telemetry_send(packet, packet_len);
+      energyMeter_addMessages(1);
+    }
+  }
 
-/* USER CODE END PFP */
+  // Diagnostics packet: error matrix and every loss counter of the path
+  ADC_TriggerStats_t trigger_stats;
+  adcTrigger_getStats(&trigger_stats);
+  TelemetryFrame_Diagnostics_t diag = {
+      .sequence = diag_sequence++,
+      .timestamp = last_report_ms,
+      .total_errors = adc_errors.total_errors,
+      .ring_overflows = ring_stats.overflows,
+      .telemetry_dropped = tx_stats.dropped,
+      .blocks_dropped = analogSensor_getDroppedBlocks(),
+      .trigger_missed = trigger_stats.missed_alarms,
+      .trigger_blind_frames = trigger_stats.blind_frames};
+  for (uint8_t r = 0; r < ADC_ERROR_ROWS; r++) {
+    for (uint8_t k = 0; k < ADC_ERROR_KIND_COUNT; k++) {
+      diag.counts[r][k] = adc_errors.counts[r][k];
+    }
+  }
+  if (telemetryFrame_encodeDiagnostics(&diag, packet, sizeof(packet),
+                                       &packet_len) == HAL_OK) {
+    telemetry_send(packet, packet_len);
+  }
+}
 
-/* Private user code ---------------------------------------------------------*/
-/* USER CODE BEGIN 0 */
+/**
+  * @brief Service pass, and the reports once REPORT_PERIOD_MS is up: the
+  *        RTOS comms task and the plain superloop
+  */
+static void App_Housekeeping(void)
+{
+  App_Service();
+  if (HAL_GetTick() - last_report_ms >= REPORT_PERIOD_MS) {
+    App_Report();
+  }
+}
+
+/**
+  * @brief Stream and block stages of the main loop, timed on PG0
+  */
+static void App_Pipeline(void)
+{
+  // Toggle GPIO for timing measurement
+  HAL_GPIO_WritePin(GPIOG, GPIO_PIN_0, GPIO_PIN_SET);
+  App_Stream();
+  App_PollSpectra();
+  App_PollEnvelope();
+  App_PollDisplay();
+  App_PollHarmonics();
+  App_PollVelocity();
+#if TACH_ENABLE
+  App_PollOrders();
+#endif
+  HAL_GPIO_WritePin(GPIOG, GPIO_PIN_0, GPIO_PIN_RESET);
+}
+
+#if LOW_POWER_DUTY_CYCLE
+/**
+  * @brief Battery node: one burst per DUTY_PERIOD_MS, a stats packet per
+  *        burst, STOP mode in between. Does not return.
+  */
+static void App_DutyCycle(void)
+{
+  const LowPower_Config_t cfg = {.period_ms = DUTY_PERIOD_MS,
+                                 .burst_frames = DUTY_BURST_FRAMES,
+                                 .frame_rate_hz = ADC_FRAME_RATE_HZ,
+                                 .settle = {.min_frames = 0,
+                                            .max_frames =
+                                                DUTY_SETTLE_MAX,
+                                            .window_frames =
+                                                DUTY_SETTLE_WINDOW,
+                                            .tolerance_codes =
+                                                DUTY_SETTLE_TOL_CODES,
+                                            .lead_us = 0,
+                                            .margin_us =
+                                                DUTY_SETTLE_MARGIN_US},
+                                 .block_cb = NULL,
+                                 .ctx = NULL};
+  ADC_RingEntry_t entry = {0};
+  uint8_t packet[TELEMETRY_FRAME_ENCODED_MAX];
+  uint16_t packet_len = 0;
+  uint32_t cycles = 0;
+
+  if (lowPower_init(&cfg) != HAL_OK) {
+    Error_Handler();
+  }
+  while (1) {
+    if (lowPower_burst() == HAL_OK) {
+      while (adcRing_pop(&entry) == HAL_OK) {
+      }
+      // The burst's per-channel aggregates of its settled frames are its
+      // result
+      TelemetryFrame_Stats_t stats = {.sequence = entry.sequence,
+                                      .timestamp = HAL_GetTick()};
+      if (lowPower_getBurstStats(stats.channels) == HAL_OK &&
+          (feature_cbor ? telemetryFrame_encodeStatsCbor(
+                              &stats, packet, sizeof(packet), &packet_len)
+                        : telemetryFrame_encodeStats(
+                              &stats, packet, sizeof(packet),
+                              &packet_len)) == HAL_OK) {
+        telemetry_send(packet, packet_len);
+        energyMeter_addMessages(1);
+      }
+      // The settled frames are the useful ones; the settling costs them
+      energyMeter_addFrames(cfg.burst_frames);
+    }
+
+    if (++cycles % DUTY_REPORT_BURSTS == 0U) {
+      lowPower_report();
+      App_ReportEnergy();
+    }
+    lowPower_sleep();
+  }
+}
+#endif
+
+#if APP_RTOS_ENABLE
+/**
+  * @brief DSP task: block processing, then the spectra it completes
+  */
+static void App_DspTask(const uint16_t *block, uint32_t frame_count)
+{
+  uint32_t t0 = profiler_begin();
+  App_ProcessBlock(block, frame_count);
+  stageDeadline_end(&deadlines);
+  profiler_end(PROFILER_PROBE_FILTER, t0);
+  App_PollSpectra();
+  App_PollEnvelope();
+  App_PollDisplay();
+  App_PollHarmonics();
+  App_PollVelocity();
+#if TACH_ENABLE
+  App_PollOrders();
+#endif
+}
+
+/**
+  * @brief Comms task: the superloop minus the DSP stages
+  */
+static void App_CommsTask(void)
+{
+  App_Stream();
+  App_Housekeeping();
+}
+#endif
+
+/**
+  * @brief Settings saved by the host commands, before anything uses them;
+  *        out-of-range values keep their defaults
+  */
+static void App_LoadConfig(void)
+{
+  uint32_t rate = 0;
+  ADC_ChannelMask_t mask = 0;
+  uint8_t value = 0;
+
+  configStore_init();
+  // A sector spent by a compaction is erased here, before the scan starts
+  (void)configStore_poll(1U);
+#if ACQ_TUNE_ENABLE
+  // Settling accuracy and ADC DMA of the last tuning run, before the rate
+  AcqTune_Candidate_t tune;
+  if (configStore_get(CONFIG_KEY_ACQ_TUNE, SETTINGS_VERSION, &tune,
+                      sizeof(tune)) != HAL_OK ||
+      acqTune_applyAnalog(&tune) != HAL_OK) {
+    tune_at_boot = ACQ_TUNE_AT_BOOT;
+  }
+#endif
+  // First: the fastest rate accepted below depends on it
+  if (configStore_get(CONFIG_KEY_RESOLUTION, SETTINGS_VERSION, &value,
+                      sizeof(value)) == HAL_OK &&
+      App_SetScanBits(value) != HAL_OK) {
+    (void)App_SetScanBits(12U);
+  }
+#if !ADAPTIVE_RATE_ENABLE
+  if (configStore_get(CONFIG_KEY_SCAN_RATE, SETTINGS_VERSION, &rate,
+                      sizeof(rate)) == HAL_OK &&
+      rate != 0U &&
+      rate <= analogSensor_getMaxFrameRate(
+                  clockProfile_getActive()->adc_prescaler)) {
+    scan_rate_hz = rate;
+  }
+#else
+  UNUSED(rate); // the rate controller starts at level 0
+#endif
+  if (configStore_get(CONFIG_KEY_STREAM_MASK, SETTINGS_VERSION, &mask,
+                      sizeof(mask)) == HAL_OK &&
+      mask != 0U &&
+      (mask & (ADC_ChannelMask_t)~TELEMETRY_FRAME_ALL_CHANNELS) == 0U) {
+    stream_mask = mask;
+  }
+  if (configStore_get(CONFIG_KEY_BLOCK_STAGES, SETTINGS_VERSION, &value,
+                      sizeof(value)) == HAL_OK) {
+    block_stages = value & STAGE_ALL;
+  }
+  if (configStore_get(CONFIG_KEY_CODEC_STREAM, SETTINGS_VERSION, &value,
+                      sizeof(value)) == HAL_OK) {
+    codec_stream = (value != 0U) ? 1U : 0U;
+  }
+  if (configStore_get(CONFIG_KEY_CAPTURE, SETTINGS_VERSION, &value,
+                      sizeof(value)) == HAL_OK) {
+    capture_enabled = (value != 0U) ? 1U : 0U;
+  }
+  if (configStore_get(CONFIG_KEY_REPORT_MODE, SETTINGS_VERSION, &value,
+                      sizeof(value)) == HAL_OK) {
+    report_mode = (value <= REPORT_SCORE) ? value : REPORT_FULL;
+  }
+  if (configStore_get(CONFIG_KEY_FEATURE_FORMAT, SETTINGS_VERSION, &value,
+                      sizeof(value)) == HAL_OK) {
+    feature_cbor = (value != 0U) ? 1U : 0U;
+  }
+  if (configStore_get(CONFIG_KEY_LOG_BANDS, SETTINGS_VERSION, &value,
+                      sizeof(value)) == HAL_OK) {
+    log_bands_fraction = (value == DSP_BANDS_OCTAVE ||
+                          value == DSP_BANDS_THIRD_OCTAVE)
+                             ? value
+                             : 0U;
+  }
+  if (configStore_get(CONFIG_KEY_BASELINE_GATE, SETTINGS_VERSION, &value,
+                      sizeof(value)) == HAL_OK) {
+    baseline_gate = (value != 0U) ? 1U : 0U;
+  }
+  if (configStore_get(CONFIG_KEY_RAINFLOW_MASK, SETTINGS_VERSION, &mask,
+                      sizeof(mask)) == HAL_OK &&
+      (mask & (ADC_ChannelMask_t)~TELEMETRY_FRAME_ALL_CHANNELS) == 0U) {
+    rainflow_mask = mask;
+  }
+  if (configStore_get(CONFIG_KEY_SRS_MODE, SETTINGS_VERSION, &value,
+                      sizeof(value)) == HAL_OK) {
+    srs_mode = (value <= SRS_ONLY) ? value : SRS_ON;
+  }
+  // Compiled once the trigger is set up; a text that fails is dropped then
+  if (configStore_get(CONFIG_KEY_TRIGGER_EXPR, SETTINGS_VERSION, expr_text,
+                      sizeof(expr_text)) != HAL_OK ||
+      expr_text[sizeof(expr_text) - 1U] != '\0') {
+    memset(expr_text, 0, sizeof(expr_text));
+  }
+  if (configStore_get(CONFIG_KEY_CODEC_ERROR, SETTINGS_VERSION, &codec_error,
+                      sizeof(codec_error)) != HAL_OK ||
+      codec_error > WAVELET_CODEC_MAX_ERROR) {
+    codec_error = 0;
+  }
+#if TACH_ENABLE
+  (void)configStore_get(CONFIG_KEY_TSA, SETTINGS_VERSION, &tsa_revolutions,
+                        sizeof(tsa_revolutions));
+#endif
+  // Checked by the spectra when the search is applied after their init
+  uint8_t cepstrum[3];
+  if (configStore_get(CONFIG_KEY_CEPSTRUM, SETTINGS_VERSION, cepstrum,
+                      sizeof(cepstrum)) == HAL_OK) {
+    cepstrum_peaks = cepstrum[0];
+    cepstrum_min_ms = cepstrum[1];
+    cepstrum_max_ms = cepstrum[2];
+  }
+  // The measured currents, if the host set them; a bad record is refused
+  EnergyMeter_Model_t energy_model;
+  if (configStore_get(CONFIG_KEY_ENERGY_MODEL, SETTINGS_VERSION,
+                      &energy_model, sizeof(energy_model)) == HAL_OK) {
+    (void)energyMeter_setModel(&energy_model);
+  }
+  // Before the scan starts; the codec stream was loaded with its own key
+  if (configStore_get(CONFIG_KEY_PRESET, SETTINGS_VERSION, &value,
+                      sizeof(value)) == HAL_OK &&
+      value < sizeof(presets) / sizeof(presets[0])) {
+    (void)App_ApplyPreset(value);
+  }
+#if PWM_SYNC_ENABLE
+  // Checked against the PWM period when the trigger is set up
+  (void)configStore_get(CONFIG_KEY_PWM_PHASE, SETTINGS_VERSION, &pwm_phase_ns,
+                        sizeof(pwm_phase_ns));
+#endif
+}
+
+#if PWM_SYNC_ENABLE
+/**
+  * @brief Scans on the motor PWM, one per period: the frame rate becomes the
+  *        PWM frequency before anything is set up for it
+  */
+static void App_InitPwmSync(void)
+{
+  PwmSync_Config_t cfg = {.timer = (PWM_SYNC_TIMER == 8) ? PWM_SYNC_TIM8
+                                                         : PWM_SYNC_TIM1,
+                          .pwm_hz = PWM_SYNC_HZ,
+                          .phase_ns = pwm_phase_ns};
+  if (pwmSync_start(&cfg) != HAL_OK) {
+    // A saved phase outside a changed period falls back to the default
+    cfg.phase_ns = PWM_SYNC_PHASE_NS;
+    if (pwmSync_start(&cfg) != HAL_OK) {
+      Error_Handler();
+    }
+  }
+  pwm_phase_ns = pwmSync_getPhase();
+  scan_rate_hz = pwmSync_getRate();
+}
+#endif
+
+/**
+  * @brief Link and storage: UART telemetry, USB, Ethernet, SD card, QSPI
+  */
+static void App_InitComms(void)
+{
+  // Reports go out through USART3 TX DMA; the loop never waits on the link
+  if (telemetry_init(&huart3) != HAL_OK ||
+      telemetryFrame_initBatch(&batch, stream_mask) != HAL_OK ||
+      telemetryFrame_initBatch(&usb_batch, TELEMETRY_FRAME_ALL_CHANNELS) !=
+          HAL_OK) {
+    Error_Handler();
+  }
+  // Sample streams leave a quarter of the UART to events and control
+  const Telemetry_Budget_t bulk_budget = {.share_pct = LINK_BULK_SHARE_PCT,
+                                          .burst_bytes = LINK_BULK_BURST};
+  if (telemetry_setBudget(TELEMETRY_CLASS_BULK, &bulk_budget) != HAL_OK) {
+    Error_Handler();
+  }
+  // Stats by exception: dead-bands in codes, well above the noise floor
+  const TelemetryFrame_ExceptionConfig_t report_cfg = {
+      .deadband = {[TELEMETRY_FRAME_FEATURE_MEAN] = REPORT_DEADBAND_MEAN,
+                   [TELEMETRY_FRAME_FEATURE_RMS] = REPORT_DEADBAND_RMS,
+                   [TELEMETRY_FRAME_FEATURE_PEAK_TO_PEAK] =
+                       REPORT_DEADBAND_PK_PK,
+                   [TELEMETRY_FRAME_FEATURE_CREST] = REPORT_DEADBAND_CREST,
+                   [TELEMETRY_FRAME_FEATURE_KURTOSIS] =
+                       REPORT_DEADBAND_KURTOSIS,
+                   [TELEMETRY_FRAME_FEATURE_DC_BIAS] = REPORT_DEADBAND_BIAS},
+      .heartbeat_ms = REPORT_HEARTBEAT_MS};
+  if (telemetryFrame_initException(&report_state, &report_cfg) != HAL_OK) {
+    Error_Handler();
+  }
+  // Anomaly score of each sensor, on the linked model or the baseline
+  const NnAnomaly_Config_t anomaly_cfg = {
+      .group = {{.channel_mask = (1U << ADC_CH_SENSOR1_X) |
+                                 (1U << ADC_CH_SENSOR1_Y) |
+                                 (1U << ADC_CH_SENSOR1_Z),
+                 .model = &nn_anomaly_model,
+                 .threshold = ANOMALY_THRESHOLD},
+                {.channel_mask = (1U << ADC_CH_SENSOR2_X) |
+                                 (1U << ADC_CH_SENSOR2_Y) |
+                                 (1U << ADC_CH_SENSOR2_Z),
+                 .model = &nn_anomaly_model,
+                 .threshold = ANOMALY_THRESHOLD}},
+      .group_count = 2,
+      .cadence = ANOMALY_CADENCE,
+      .learn_windows = ANOMALY_LEARN_WINDOWS};
+  if (nnAnomaly_init(&anomaly_cfg) != HAL_OK) {
+    Error_Handler();
+  }
+  // Commands arrive on USART3 RX DMA and are run from the loop
+  if (hostCmd_init(&huart3, host_commands,
+                   sizeof(host_commands) / sizeof(host_commands[0])) !=
+      HAL_OK) {
+    Error_Handler();
+  }
+
+  // Raw full-rate frames over the USB user connector while a host listens,
+  // read from the ring by a cursor of their own
+  if (usbStream_init() != HAL_OK || adcRing_attach(0, &usb_cursor) != HAL_OK) {
+    Error_Handler();
+  }
+  energyMeter_setPeripheral(ENERGY_METER_PERIPH_USB, 1);
+#if ETH_STREAM_ENABLE
+  // ... and as one UDP datagram per DMA block to the rack collector
+  if (ethStream_init() != HAL_OK) {
+    Error_Handler();
+  }
+  energyMeter_setPeripheral(ENERGY_METER_PERIPH_ETH, 1);
+#endif
+  bootProfile_mark(BOOT_PHASE_COMMS);
+
+  // Record every block to an SD card when one is fitted; optional
+  if (sdLogger_init() == HAL_OK) {
+    sdLogger_start(scan_rate_hz);
+    energyMeter_setPeripheral(ENERGY_METER_PERIPH_SD, 1);
+  }
+  // Keep the last minutes and the trigger captures in QSPI flash; optional
+  qspiRec_init();
+  bootProfile_mark(BOOT_PHASE_STORAGE);
+}
+
+/**
+  * @brief ADC set-up that must precede the scan start: clock, calibration,
+  *        multimode, watchdogs and their trigger, block pool, sync
+  */
+static void App_InitAcquisition(void)
+{
+  // MX_ADCx_Init() set the CubeMX prescaler; use the profile's ADCCLK
+  if (analogSensor_setClockPrescaler(clockProfile_getActive()->adc_prescaler) !=
+      HAL_OK) {
+    Error_Handler();
+  }
+
+  // Per-channel offsets and gain/cross-axis matrices from flash sector 7
+  adcCal_init();
+  // Per-code linearity tables, identity until a "selftest linearity" sweep
+  adcLin_init();
+#if ADC_RANGE_ENABLE
+  // FS pins of the two sensors: each picks +-2 g or +-6 g from its peaks,
+  // zero g from the calibration just loaded
+  const AdcRange_Config_t range_cfg = {.port = GPIOG,
+                                       .pins = {GPIO_PIN_4, GPIO_PIN_5}};
+  if (adcRange_init(&range_cfg) != HAL_OK) {
+    Error_Handler();
+  }
+#endif
+
+#if ADC_BENCH_BUILD
+  // ADC_6_channels_bench: report the scenarios instead of the application
+  adcBench_main();
+#endif
+
+  // ADC1/2/3 in lock-step: channels 0/1/2 (and 3/4/5) share a sample instant
+  if (analogSensor_setMultimode(ADC_MULTI_TRIPLE_SIMULT) != HAL_OK) {
+    Error_Handler();
+  }
+
+  // Slope triggers on X/Y/Z, with history from before the event
+  if (adcTrigger_init(EVENT_PRE_FRAMES, EVENT_POST_FRAMES) != HAL_OK) {
+    Error_Handler();
+  }
+#if ADC_TRIGGER_RETAIN_ENABLE
+  // A watchdog, fault or software reset kept SRAM: the history before it
+  // goes out as a snapshot ahead of anything else
+  Retained_Stats_t boot;
+  const uint8_t warm =
+      retained_getStats(&boot) == HAL_OK &&
+      (boot.reset_flags & (RCC_CSR_PORRSTF | RCC_CSR_BORRSTF)) == 0U;
+  if (adcTrigger_recoverHistory(warm, &snapshot) == HAL_OK) {
+    snapshot_sent = 0;
+    snapshot_recovered = 1;
+  }
+#endif
+  const ADC_TriggerConfig_t event_cfg = {.condition = ADC_TRIGGER_SLOPE,
+                                         .threshold = EVENT_SLOPE_CODES,
+                                         .window = EVENT_SLOPE_FRAMES};
+  for (uint8_t ch = ADC_CH_SENSOR1_X; ch <= ADC_CH_SENSOR1_Z; ch++) {
+    adcTrigger_configChannel(ch, &event_cfg);
+  }
+  // Shock in any direction on sensor 2: one vector test for X/Y/Z
+  const ADC_TriggerConfig_t shock_cfg = {
+      .condition = ADC_TRIGGER_MAGNITUDE_ABOVE, .threshold = EVENT_SHOCK_CODES};
+  if (adcTrigger_configGroup(1, &shock_cfg) != HAL_OK) {
+    Error_Handler();
+  }
+#if INTERLOCK_ENABLE
+  // Sensor 1 sits on ADC1, ADC2 and ADC3: the watchdogs guard its limits
+  // and drive PG1 from the ADC interrupt, instead of checking the range of
+  // sensor 2
+  for (uint8_t ch = ADC_CH_SENSOR1_X; ch <= ADC_CH_SENSOR1_Z; ch++) {
+    if (analogSensor_configWatchdog(ch, INTERLOCK_LOW_CODES,
+                                    INTERLOCK_HIGH_CODES) != HAL_OK) {
+      Error_Handler();
+    }
+  }
+  const Interlock_Config_t interlock_cfg = {
+      .port = GPIOG,
+      .pin = GPIO_PIN_1,
+      .active_low = 0,
+      .channels = (1U << ADC_CH_SENSOR1_X) | (1U << ADC_CH_SENSOR1_Y) |
+                  (1U << ADC_CH_SENSOR1_Z)};
+  if (interlock_init(&interlock_cfg) != HAL_OK) {
+    Error_Handler();
+  }
+#else
+  // Channels 3-5 sit on ADC3, ADC1 and ADC2: one hardware watchdog each
+  for (uint8_t ch = ADC_CH_SENSOR2_X; ch <= ADC_CH_SENSOR2_Z; ch++) {
+    if (analogSensor_configWatchdog(ch, RANGE_LOW_CODES, RANGE_HIGH_CODES) !=
+        HAL_OK) {
+      Error_Handler();
+    }
+  }
+#endif
+  analogSensor_registerWatchdogCallback(adcTrigger_watchdogCallback, NULL);
+  expr_rate_hz = scan_rate_hz;
+  if (expr_text[0] != '\0' && App_SetExpression(expr_text, NULL) != HAL_OK) {
+    memset(expr_text, 0, sizeof(expr_text));
+  }
+  if (capture_enabled) {
+    adcTrigger_arm();
+  }
+  analogSensor_registerBlockCallback(App_BlockReady, NULL);
+
+#if DAC_LOOPBACK_ENABLE
+  // Self-test from DAC1 on PA4 into sensor 2 Y; reaction pin PG2
+  const DacLoop_Config_t loop_cfg = {.channel = ADC_CH_SENSOR2_Y,
+                                     .port = GPIOG,
+                                     .pin = GPIO_PIN_2};
+  if (dacLoop_init(&loop_cfg) != HAL_OK) {
+    Error_Handler();
+  }
+#endif
+
+#if EXT_ADC_ENABLE
+  // >12-bit channels on the SPI4 expansion, read on the same triggers
+  if (extAdc_init() != HAL_OK) {
+    Error_Handler();
+  }
+  extAdc_registerBlockCallback(App_ExtBlockReady, NULL);
+#endif
+
+#if ADC_MUX_ENABLE
+  // Select lines of the input multiplexers, switched on the scan triggers
+  if (adcMux_init() != HAL_OK) {
+    Error_Handler();
+  }
+#endif
+
+#if DIGITAL_IN_ENABLE
+  // Machine signals sampled on the scan triggers, as edges by frame; the
+  // sampler follows TIM2 through every scan restart
+  if (digitalIn_init() != HAL_OK || digitalIn_start() != HAL_OK) {
+    Error_Handler();
+  }
+#endif
+
+#if CAN_BUS_ENABLE
+  // Features and alarms broadcast on CAN1, commands through its filter
+  if (canBus_init() != HAL_OK) {
+    Error_Handler();
+  }
+#endif
+
+#if MODBUS_SERVER_ENABLE
+  // Modbus RTU server on RS-485, answering from the variables in place
+  if (modbusServer_init(&modbus_map) != HAL_OK) {
+    Error_Handler();
+  }
+  modbusServer_registerWriteCallback(App_ModbusWritten, NULL);
+#endif
+
+#if TDMA_BUS_ENABLE
+  // Time-slotted RS-485 bus, slots counted in scan frames: the master relays
+  // the nodes' packets to the host, a node sends its every frame
+#if TDMA_BUS_ADDRESS == 0
+  tdmaBus_registerFrameCallback(App_TdmaFrame, NULL);
+#else
+  if (telemetryFrame_initBatch(&tdma_batch, TELEMETRY_FRAME_ALL_CHANNELS) !=
+      HAL_OK) {
+    Error_Handler();
+  }
+#endif
+  if (tdmaBus_init() != HAL_OK || tdmaBus_start(scan_rate_hz) != HAL_OK) {
+    Error_Handler();
+  }
+#endif
+
+#if I2C_TARGET_ENABLE
+  // Register view of the newest frame for an I2C host, served by DMA
+  if (i2cTarget_init() != HAL_OK) {
+    Error_Handler();
+  }
+#endif
+
+#if TACH_ENABLE
+  // Shaft pulses on PC6, stamped on the timebase for the order tracking
+  if (tach_init() != HAL_OK) {
+    Error_Handler();
+  }
+#endif
+
+#if LOW_POWER_DUTY_CYCLE
+  // Battery nodes: bursts paced by LPTIM1 instead of the stream below
+  App_DutyCycle();
+#endif
+
+  // DMA straight into pool blocks: the Ethernet stream and the RTOS tasks
+  // hold them by reference instead of copying
+  if (analogSensor_setBlockPool(1U) != HAL_OK) {
+    Error_Handler();
+  }
+
+  // Pace TIM2 from the shared sync pulse on PB11 while one is present, or
+  // from the whole PTP seconds of the Ethernet MAC clock; idle under the PWM
+#if !PWM_SYNC_ENABLE
+#if ETH_STREAM_ENABLE && PTP_SYNC_ENABLE
+  (void)timeSync_setInput(TIME_SYNC_INPUT_PTP);
+#endif
+#if DSP_ASRC_ENABLE
+  // Measure the pulses only: the stream is resampled instead
+  (void)timeSync_setDiscipline(0);
+#endif
+  if (timeSync_start(scan_rate_hz) != HAL_OK) {
+    Error_Handler();
+  }
+#endif
+  bootProfile_mark(BOOT_PHASE_ACQ);
+}
+
+/**
+  * @brief Filters, oversampling, spectra and harmonics of the block stages
+  */
+static void App_InitDsp(void)
+{
+  // Background zero-g tracking, ~8 s time constant at 4 kHz
+  if (dspDcTrack_init(&dc_track, DSP_DCTRACK_SHIFT_DEFAULT,
+                      analogSensor_getBlockChannelMap()) != HAL_OK) {
+    Error_Handler();
+  }
+#if DSP_WINDOW_ENABLE
+  // Sliding metrics over the longest window until "window" sets another
+  if (dspWindow_init(&sliding, DSP_WINDOW_MAX_FRAMES,
+                     analogSensor_getBlockChannelMap()) != HAL_OK) {
+    Error_Handler();
+  }
+#endif
+#if DSP_DESPIKE_ENABLE
+  // Single-sample EMI spikes out of every channel, before the stats see them
+  const DSP_DespikeConfig_t despike_cfg = {
+      .taps = DESPIKE_TAPS,
+      .mode = DSP_DESPIKE_HAMPEL,
+      .threshold = DESPIKE_THRESHOLD_CODES,
+      .channels = TELEMETRY_FRAME_ALL_CHANNELS};
+  if (dspDespike_init(&despike, &despike_cfg,
+                      analogSensor_getBlockChannelMap()) != HAL_OK) {
+    Error_Handler();
+  }
+#endif
+#if DSP_DESKEW_ENABLE
+  // Every channel at the trigger's instant, three frames late
+  deskew_rate_hz = scan_rate_hz;
+  App_InitDeskew();
+#endif
+#if DSP_DESPIKE_ENABLE || DSP_DESKEW_ENABLE
+  App_ApplyBlockFilter();
+#endif
+
+  // Extra resolution for low-g tilt on the accelerometer axes
+  dspOversample_init(&oversampler, analogSensor_getBlockChannelMap());
+  for (uint8_t ch = 0; ch < 3U; ch++) {
+    dspOversample_configChannel(&oversampler, ch, TILT_OVERSAMPLE_RATIO,
+                                TILT_RESULT_BITS);
+  }
+
+  // Anti-alias every channel before the stream is decimated
+  if (dspFilter_init(&stream_filter, STREAM_DECIMATION,
+                     analogSensor_getBlockChannelMap()) != HAL_OK) {
+    Error_Handler();
+  }
+  for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+    dspFilter_configChannel(&stream_filter, ch, &dspFilter_lowpass200Hz);
+  }
+#if DSP_ASRC_ENABLE
+  // Decimated on the nominal grid of the pulses TIM2 no longer follows
+  dspAsrc_init(&stream_asrc);
+  dspFilter_setResampler(&stream_filter, &stream_asrc);
+#endif
+#if DSP_VECTOR_STREAM_ENABLE
+  dspVector_init(&stream_vector, 1); // filtered codes, calibrated per group
+#endif
+
+  // Vibration features instead of raw spectra: peak, overall and band RMS
+  const DSP_SpectrumConfig_t vibration_cfg = {
+      .length = VIBRATION_FFT_LENGTH,
+      .window = DSP_WINDOW_HANN,
+      .averages = VIBRATION_AVERAGES,
+      .sample_rate_hz = (float32_t)scan_rate_hz,
+      .min_peak_hz = 5.0f,
+      .band_count = 2,
+      .bands = {{10.0f, 1000.0f}, {1000.0f, 2000.0f}}};
+  for (uint8_t i = 0; i < VIBRATION_CHANNELS; i++) {
+    if (dspSpectrum_init(&vibration[i], i, analogSensor_getBlockChannelMap(),
+                         &vibration_cfg) != HAL_OK) {
+      Error_Handler();
+    }
+  }
+  App_ApplyLogBands(); // after the settings: octave levels as saved
+  if (App_ApplyCepstrum() != HAL_OK) {
+    cepstrum_peaks = 0; // a stored search the stage refuses: off
+    (void)App_ApplyCepstrum();
+  }
+
+  // Between axes and between the sensors, at the shaft harmonics
+  DSP_Spectrum_t *const coherence_inputs[] = {&vibration[0], &vibration[1],
+                                              &vibration[2], &vibration[3]};
+  const DSP_CoherenceConfig_t coherence_cfg = {
+      .averages = COHERENCE_AVERAGES,
+      .pair_count = 3,
+      .pairs = {{ADC_CH_SENSOR1_X, ADC_CH_SENSOR1_Y},
+                {ADC_CH_SENSOR1_X, ADC_CH_SENSOR1_Z},
+                {ADC_CH_SENSOR1_X, ADC_CH_SENSOR2_X}},
+      .freq_count = (uint8_t)(sizeof(harmonic_hz) / sizeof(harmonic_hz[0])),
+      .freq_hz = {harmonic_hz[0], harmonic_hz[1], harmonic_hz[2],
+                  harmonic_hz[3]}};
+  if (dspCoherence_init(&coherence, &coherence_cfg, coherence_inputs,
+                        VIBRATION_CHANNELS) != HAL_OK) {
+    Error_Handler();
+  }
+
+  // Bearing faults: envelope of the 500-1500 Hz resonance band of X
+  const DSP_SpectrumConfig_t envelope_cfg = {
+      .length = ENVELOPE_FFT_LENGTH,
+      .window = DSP_WINDOW_HANN,
+      .averages = VIBRATION_AVERAGES,
+      .sample_rate_hz =
+          (float32_t)scan_rate_hz / (float32_t)ENVELOPE_DECIMATION,
+      .min_peak_hz = 5.0f,
+      .tone_count = (uint8_t)(sizeof(envelope_tones) /
+                              sizeof(envelope_tones[0])),
+      .tone_search_hz = ENVELOPE_SEARCH_HZ};
+#if ENVELOPE_SPECTRUM_Q15
+  if (dspSpectrumQ15_init(&envelope, ENVELOPE_CHANNEL, NULL, &envelope_cfg) !=
+          HAL_OK ||
+      dspSpectrumQ15_setTones(&envelope, envelope_tones,
+                              envelope_cfg.tone_count) != HAL_OK ||
+#else
+  if (dspSpectrum_init(&envelope, ENVELOPE_CHANNEL, NULL, &envelope_cfg) !=
+          HAL_OK ||
+      dspSpectrum_setTones(&envelope, envelope_tones,
+                           envelope_cfg.tone_count) != HAL_OK ||
+#endif
+      pipelineBiquad_init(&envelope_band, &dspFilter_bandpass500to1500Hz) !=
+          HAL_OK ||
+      pipelineBiquad_init(&envelope_lowpass, &dspFilter_lowpass200Hz) !=
+          HAL_OK ||
+      pipeline_init(&envelope_pipeline, envelope_branches, 1U,
+                    analogSensor_getBlockChannelMap()) != HAL_OK) {
+    Error_Handler();
+  }
+
+  // Live-plot stream: a min/max pair per DISPLAY_BUCKET_FRAMES frames
+  if (pipelineDisplay_init(&display_minmax, TELEMETRY_FRAME_ALL_CHANNELS,
+                           DISPLAY_BUCKET_FRAMES) != HAL_OK ||
+      pipeline_init(&display_pipeline, display_branches, 1U,
+                    analogSensor_getBlockChannelMap()) != HAL_OK) {
+    Error_Handler();
+  }
+
+  // Stage deadlines at the boot rate; App_SetDmaBudget() follows changes
+  if (stageDeadline_init(&deadlines, deadline_table, DEADLINE_COUNT,
+                         (uint32_t)((uint64_t)analogSensor_getBlockFrames() *
+                                    1000000U / scan_rate_hz)) != HAL_OK) {
+    Error_Handler();
+  }
+
+  // Amplitude distribution per channel, counted with the block stages
+  if (dspHistogram_init(&histogram, HISTOGRAM_SHIFT,
+                        analogSensor_getBlockChannelMap()) != HAL_OK) {
+    Error_Handler();
+  }
+
+  // Rainflow cycles and fatigue damage of the channels the host picked
+  const DSP_RainflowConfig_t rainflow_cfg = {
+      .hysteresis_codes = RAINFLOW_HYSTERESIS,
+      .range_bin_codes = RAINFLOW_RANGE_BIN,
+      .mean_low_codes = RAINFLOW_MEAN_LOW,
+      .mean_bin_codes = RAINFLOW_MEAN_BIN,
+      .units_per_code = ADC_CAL_NOMINAL_MG_PER_CODE,
+      .sn = &rainflow_sn};
+  if (dspRainflow_init(&rainflow, &rainflow_cfg,
+                       analogSensor_getBlockChannelMap()) != HAL_OK) {
+    Error_Handler();
+  }
+  dspRainflow_setChannels(&rainflow, rainflow_mask);
+
+  // Shaft harmonics on every channel at the cost of a few bins, no FFT
+  if (dspGoertzel_init(&harmonics, (float32_t)scan_rate_hz,
+                       HARMONIC_WINDOW,
+                       analogSensor_getBlockChannelMap()) != HAL_OK) {
+    Error_Handler();
+  }
+  for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+    if (dspGoertzel_setBins(&harmonics, ch, harmonic_hz,
+                            (uint8_t)(sizeof(harmonic_hz) /
+                                      sizeof(harmonic_hz[0]))) != HAL_OK) {
+      Error_Handler();
+    }
+  }
+
+  // Machine-health severity: velocity RMS over the ISO 10816 band
+  const DSP_VelocityConfig_t velocity_cfg = {
+      .sample_rate_hz = (float32_t)scan_rate_hz,
+      .low_hz = DSP_VELOCITY_LOW_HZ,
+      .high_hz = DSP_VELOCITY_HIGH_HZ,
+      .mg_per_code = ADC_CAL_NOMINAL_MG_PER_CODE,
+      .interval_ms = VELOCITY_INTERVAL_MS,
+      .channels = ADC_CHANNELS_MASK_ALL,
+      .zone_mm_s = {VELOCITY_ZONE_AB, VELOCITY_ZONE_BC, VELOCITY_ZONE_CD}};
+  if (dspVelocity_init(&velocity, &velocity_cfg,
+                       analogSensor_getBlockChannelMap()) != HAL_OK) {
+    Error_Handler();
+  }
+#if TACH_ENABLE
+  // Order spectrum of X: the spectrum runs at samples_per_rev "Hz", so its
+  // frequencies are orders
+  const DSP_OrderConfig_t order_cfg = {
+      .pulses_per_rev = TACH_PULSES_PER_REV,
+      .samples_per_rev = ORDER_SAMPLES_PER_REV,
+      .sample_rate_hz = (float32_t)scan_rate_hz,
+      .min_rpm = ORDER_MIN_RPM};
+  const DSP_SpectrumConfig_t order_fft_cfg = {
+      .length = ORDER_FFT_LENGTH,
+      .window = DSP_WINDOW_HANN,
+      .averages = VIBRATION_AVERAGES,
+      .sample_rate_hz = (float32_t)ORDER_SAMPLES_PER_REV,
+      .min_peak_hz = 0.5f,
+      .tone_count = (uint8_t)(sizeof(order_tones) / sizeof(order_tones[0])),
+      .tone_search_hz = ORDER_SEARCH};
+  if (dspOrder_init(&order, ORDER_CHANNEL, analogSensor_getBlockChannelMap(),
+                    &order_cfg) != HAL_OK ||
+      dspSpectrum_init(&order_fft, ORDER_CHANNEL, NULL, &order_fft_cfg) !=
+          HAL_OK ||
+      dspSpectrum_setTones(&order_fft, order_tones, order_fft_cfg.tone_count) !=
+          HAL_OK) {
+    Error_Handler();
+  }
+  // A revolution of X at the same angles, averaged apart from the FFT
+  const DSP_TsaConfig_t tsa_cfg = {
+      .samples_per_rev = ORDER_SAMPLES_PER_REV,
+      .revolutions = (tsa_revolutions != 0U) ? tsa_revolutions
+                                             : TSA_REVOLUTIONS};
+  if (dspTsa_init(&tsa, &tsa_cfg) != HAL_OK ||
+      dspOrder_attachTsa(&order, (tsa_revolutions != 0U) ? &tsa : NULL) !=
+          HAL_OK) {
+    Error_Handler();
+  }
+#endif
 
+  // FFT segments paced to their deadlines instead of all in one pass
+  if (fftSched_init(&fft_sched, FFT_SCHED_SPREAD) != HAL_OK) {
+    Error_Handler();
+  }
+  for (uint8_t i = 0; i < VIBRATION_CHANNELS; i++) {
+    (void)fftSched_add(&fft_sched, &vibration[i]);
+  }
+#if TACH_ENABLE
+  (void)fftSched_add(&fft_sched, &order_fft);
+#endif
+  bootProfile_mark(BOOT_PHASE_DSP);
+}
+
+/**
+  * @brief Stream the scan into the frame ring at a fixed TIM2-paced rate;
+  *        the profile build also waits for the first DMA transfer
+  */
+static void App_StartAcquisition(void)
+{
+  App_SetDmaBudget(scan_rate_hz);
+  if (analogSensor_startTimedDMA(scan_rate_hz) != HAL_OK) {
+    Error_Handler();
+  }
+#if EXT_ADC_ENABLE
+  // Before the first TIM2 update, so both count frames from the same one
+  if (extAdc_start(scan_rate_hz) != HAL_OK) {
+    Error_Handler();
+  }
+#endif
+#if ADC_MUX_ENABLE
+  // Likewise: the first update is position 0
+  if (adcMux_start(scan_rate_hz) != HAL_OK) {
+    Error_Handler();
+  }
+#endif
+#if BOOT_PROFILE_ENABLE
+  const DMA_Stream_TypeDef *stream = hadc1.DMA_Handle->Instance;
+  const uint32_t ndtr = stream->NDTR;
+  const uint32_t t0 = HAL_GetTick();
+  while (stream->NDTR == ndtr &&
+         HAL_GetTick() - t0 < FIRST_SAMPLE_TIMEOUT_MS) {
+  }
+  bootProfile_mark(BOOT_PHASE_FIRST_SAMPLE);
+#endif
+}
 /* USER CODE END 0 */
 
 /**
@@ -72,18 +7505,36 @@ int main(void)
 {
 
   /* USER CODE BEGIN 1 */
-
+  bootProfile_start();
   /* USER CODE END 1 */
 
   /* MPU Configuration--------------------------------------------------------*/
   MPU_Config();
 
+  /* Enable the CPU Cache */
+
+  /* Enable I-Cache---------------------------------------------------------*/
+  SCB_EnableICache();
+
+  /* Enable D-Cache---------------------------------------------------------*/
+  SCB_EnableDCache();
+
   /* MCU Configuration--------------------------------------------------------*/
 
   /* Reset of all peripherals, Initializes the Flash interface and the Systick. */
   HAL_Init();
 
   /* USER CODE BEGIN Init */
+  // I-cache / ART / prefetch as measured by the BENCH flash lines
+  flashMode_apply(FLASH_MODE_DEFAULT);
+  // Frame and record CRCs, before anything checksums
+  crcUnit_init();
+  // Lifetime counters and breadcrumbs, before the event log clears the
+  // reset flags
+  (void)retained_init();
+  // Event log mirrored to the backup SRAM; the previous boot's kept apart
+  (void)eventLog_init();
+  bootProfile_mark(BOOT_PHASE_HAL);
 
   /* USER CODE END Init */
 
@@ -91,17 +7542,128 @@ int main(void)
   SystemClock_Config();
 
   /* USER CODE BEGIN SysInit */
-
+  bootProfile_mark(BOOT_PHASE_CLOCK);
+  // Replace the CubeMX clock before any peripheral derives its settings
+  if (clockProfile_apply(CLOCK_PROFILE_DEFAULT,
+                         CLOCK_PROFILE_HSE_BYPASS ? CLOCK_SOURCE_HSE_BYPASS
+                                                  : CLOCK_SOURCE_HSI) !=
+      HAL_OK) {
+    Error_Handler();
+  }
+  bootProfile_mark(BOOT_PHASE_CLOCK_PROFILE);
+  profiler_init();
+  // Handler cycle budgets, scaled to the final HCLK
+  isrBudget_init();
+  // ITM/SWO trace on PB3 for the debug probe; the prescaler needs the final
+  // HCLK
+  (void)swoTrace_init();
+  // 64-bit block timestamps; TIM5 is derived from the final PCLK1 (already
+  // running as the HAL tick with TIMEBASE_HAL_TICK, and kept counting)
+  if (timebase_init() != HAL_OK) {
+    Error_Handler();
+  }
+  // Awake/asleep accounting of the WFI idle loop (and of HAL_Delay())
+  cpuLoad_init();
+#if CLOCK_GOV_ENABLE
+  // Fast or slow profile by that load, from the boot profile if it is one
+  const ClockGov_Config_t gov = {.fast = CLOCK_PROFILE_PERFORMANCE,
+                                 .slow = CLOCK_PROFILE_BALANCED,
+                                 .ready = App_GovernorReady,
+                                 .ctx = NULL};
+  (void)clockGov_init(&gov);
+#endif
+  // ... and the power states priced in energy, from here; the sensor
+  // supply is up from reset unless the duty cycle gates it
+  energyMeter_init();
+  energyMeter_setPeripheral(ENERGY_METER_PERIPH_SENSORS, 1);
+  bootProfile_mark(BOOT_PHASE_TIMEBASE);
   /* USER CODE END SysInit */
 
   /* Initialize all configured peripherals */
   MX_GPIO_Init();
+  MX_DMA_Init();
   MX_ADC1_Init();
+  MX_ADC2_Init();
+  MX_ADC3_Init();
   MX_USART3_UART_Init();
+  MX_TIM2_Init();
   /* USER CODE BEGIN 2 */
-  // if (HAL_ADC_Start_DMA(&hadc1, (uint32_t*)adc_dma_buffer, 6) != HAL_OK) {
-  //   Error_Handler();
-  // }
+  // The CubeMX vectors onto the priority plan, before any module moves one
+  irqPriority_apply();
+  bootProfile_mark(BOOT_PHASE_PERIPH);
+  // Rate, stream mask and stages as the host last set them
+  App_LoadConfig();
+#if PWM_SYNC_ENABLE
+  App_InitPwmSync();
+#endif
+#if BOOT_FAST_START
+  // Acquisition first; the link, storage and DSP come up while it runs
+  App_InitAcquisition();
+  App_StartAcquisition();
+  App_InitComms();
+  App_InitDsp();
+  app_running = 1;
+#else
+  App_InitComms();
+  App_InitAcquisition();
+  App_InitDsp();
+  app_running = 1;
+  App_StartAcquisition();
+#endif
+
+#if ADAPTIVE_RATE_ENABLE
+  // ... or slower while the accelerometers are still
+  const AdaptiveRate_Config_t rate_cfg = {
+      .levels = NULL,
+      .channel_mask = TELEMETRY_FRAME_ALL_CHANNELS,
+      .step_up_codes = RATE_STEP_UP_CODES,
+      .step_down_codes = RATE_STEP_DOWN_CODES,
+      .quiet_ms = RATE_QUIET_MS,
+      .apply = App_ApplyRate,
+      .ctx = NULL};
+  if (adaptiveRate_init(&rate_cfg, analogSensor_getBlockChannelMap()) !=
+      HAL_OK) {
+    Error_Handler();
+  }
+#endif
+
+#if ADC_SUPPLY_ENABLE
+  // VDDA and die temperature between scans, and the supply correction
+  const AdcSupply_Config_t supply_cfg = {.period_frames = 0,
+                                         .correct = SUPPLY_CORRECT,
+                                         .nominal_mv = 0};
+  if (adcSupply_init(&supply_cfg) != HAL_OK) {
+    Error_Handler();
+  }
+#endif
+
+  // Everything is allocated: heap growth from here on is a bug. The budget
+  // goes out once, with the stack used by init
+  memBudget_seal();
+  App_ReportMemory();
+
+#if APP_RTOS_ENABLE
+  // Acquisition, DSP and comms tasks instead of the loop below
+  const AppRtos_Hooks_t hooks = {.acquire = App_AcquireBlock,
+                                 .process = App_DspTask,
+                                 .service = App_CommsTask};
+  appRtos_start(&hooks);
+  Error_Handler(); // only returns if the kernel could not start
+#endif
+
+#if APP_SCHED_ENABLE
+  // Blocks and TX slots drive the stages, any wake-up the service pass, the
+  // report timer the packets
+  static const AppSched_Task_t app_tasks[] = {
+      {"pipeline", App_Pipeline,
+       APP_SCHED_EVENT_BLOCK | APP_SCHED_EVENT_TX_DONE, 0U},
+      {"service", App_Service, APP_SCHED_EVENT_ALL, 0U},
+      {"report", App_Report, 0U, REPORT_PERIOD_MS}};
+  if (appSched_init(app_tasks, sizeof(app_tasks) / sizeof(app_tasks[0])) !=
+      HAL_OK) {
+    Error_Handler();
+  }
+#endif
   /* USER CODE END 2 */
 
   /* Infinite loop */
@@ -112,30 +7674,19 @@ int main(void)
 
     /* USER CODE BEGIN 3 */
 
-    // Toggle GPIO for timing measurement
-    HAL_GPIO_WritePin(GPIOG, GPIO_PIN_0, GPIO_PIN_SET);
-
-    // Sample all 6 channels using helper function
-    analogSensor_operation_all_channels(ADC_CHANNEL_COUNT);
-
-    HAL_GPIO_WritePin(GPIOG, GPIO_PIN_0, GPIO_PIN_RESET);
-
-    // Print all channel values over UART
-    ADC_ErrorInfo_t adc_errors;
-    analogSensor_getErrors(&adc_errors);
-
-    char buf[200];
-    snprintf(buf, sizeof(buf),
-             "ADC: CH0=%4lu CH1=%4lu CH2=%4lu CH3=%4lu CH4=%4lu CH5=%4lu | "
-             "Errors=%lu last_failed_channel=%lu\r\n",
-             (unsigned long)raw_LISXXXALH[0], (unsigned long)raw_LISXXXALH[1],
-             (unsigned long)raw_LISXXXALH[2], (unsigned long)raw_LISXXXALH[3],
-             (unsigned long)raw_LISXXXALH[4], (unsigned long)raw_LISXXXALH[5],
-             (unsigned long)adc_errors.total_errors,
-             (unsigned long)adc_errors.last_failed_channel);
-    HAL_UART_Transmit(&huart3, (uint8_t *)buf, strlen(buf), HAL_MAX_DELAY);
+#if APP_SCHED_ENABLE
+    // Every ready task once, then sleep until a flag or the next timer
+    appSched_run();
+    appSched_idle();
+#else
+    retained_mark(RETAINED_MARK_PIPELINE, last_entry.sequence);
+    App_Pipeline();
+    retained_mark(RETAINED_MARK_HOUSEKEEPING, last_entry.sequence);
+    App_Housekeeping();
 
-    HAL_Delay(100); // 10 Hz sampling rate
+    // Nothing left until the next DMA half, timer or link interrupt
+    cpuLoad_idle();
+#endif
   }
   /* USER CODE END 3 */
 }
@@ -234,6 +7785,7 @@ void Error_Handler(void)
 {
   /* USER CODE BEGIN Error_Handler_Debug */
   /* User can add his own implementation to report the HAL error return state */
+  retained_mark(RETAINED_MARK_ERROR, (uint32_t)__builtin_return_address(0));
   __disable_irq();
   while (1)
   {
@@ -0,0 +1,125 @@
+/**
+ ******************************************************************************
+ * @file    mem_budget.c
+ * @brief   Implementation of the static memory budget and the stack
+ *          high-water mark
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "mem_budget.h"
+#include "main.h"
+#include <stddef.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define MEM_BUDGET_SPAN(start, end) ((uint32_t)&(end) - (uint32_t)&(start))
+
+/* Private variables ---------------------------------------------------------*/
+
+/* Linker script symbols */
+extern uint8_t _sdtcm, _edtcm, _sdtcm_bss, _edtcm_bss; // DTCM data
+extern uint8_t _sstack, _estack;                       // main stack
+extern uint8_t _sitcm, _eitcm, _eitcmram;              // ITCM code
+extern uint8_t _sdata, _ebss;                          // SRAM1 .data/.bss
+extern uint8_t _ssram1_bss, _esram1_bss;
+extern uint8_t _snoinit, _enoinit;                     // kept across resets
+extern uint8_t _end, _eheap, _esram1; // heap reservation, SRAM1 end
+extern uint8_t _ssram2_bss, _esram2_bss, _esram2;
+
+/* newlib heap break (sysmem.c) */
+extern void *_sbrk(ptrdiff_t incr);
+
+static volatile uint8_t sealed = 0;
+static volatile uint32_t refused = 0;
+
+/* Public functions ----------------------------------------------------------*/
+
+HAL_StatusTypeDef memBudget_getBank(MemBudget_BankId_t id,
+                                    MemBudget_Bank_t *bank) {
+  if (bank == NULL) {
+    return HAL_ERROR;
+  }
+  switch (id) {
+  case MEM_BUDGET_BANK_DTCM:
+    *bank = (MemBudget_Bank_t){
+        .name = "dtcm",
+        .base = RAMDTCM_BASE,
+        .size = (uint32_t)&_estack - RAMDTCM_BASE,
+        .data = MEM_BUDGET_SPAN(_sdtcm, _edtcm) +
+                MEM_BUDGET_SPAN(_sdtcm_bss, _edtcm_bss),
+        .reserved = MEM_BUDGET_SPAN(_sstack, _estack),
+        .free = MEM_BUDGET_SPAN(_edtcm_bss, _sstack)};
+    break;
+  case MEM_BUDGET_BANK_ITCM:
+    *bank = (MemBudget_Bank_t){.name = "itcm",
+                               .base = RAMITCM_BASE,
+                               .size = (uint32_t)&_eitcmram - RAMITCM_BASE,
+                               .data = MEM_BUDGET_SPAN(_sitcm, _eitcm),
+                               .free = MEM_BUDGET_SPAN(_eitcm, _eitcmram)};
+    break;
+  case MEM_BUDGET_BANK_SRAM1:
+    *bank = (MemBudget_Bank_t){
+        .name = "sram1",
+        .base = SRAM1_BASE,
+        .size = (uint32_t)&_esram1 - SRAM1_BASE,
+        .data = MEM_BUDGET_SPAN(_sdata, _ebss) +
+                MEM_BUDGET_SPAN(_snoinit, _enoinit),
+        .dma = MEM_BUDGET_SPAN(_ssram1_bss, _esram1_bss),
+        .reserved = MEM_BUDGET_SPAN(_end, _eheap),
+        .free = MEM_BUDGET_SPAN(_eheap, _esram1)};
+    break;
+  case MEM_BUDGET_BANK_SRAM2:
+    *bank = (MemBudget_Bank_t){
+        .name = "sram2",
+        .base = SRAM2_BASE,
+        .size = (uint32_t)&_esram2 - SRAM2_BASE,
+        .dma = MEM_BUDGET_SPAN(_ssram2_bss, _esram2_bss),
+        .free = MEM_BUDGET_SPAN(_esram2_bss, _esram2)};
+    break;
+  default:
+    return HAL_ERROR;
+  }
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef memBudget_getStack(MemBudget_Stack_t *stack) {
+  if (stack == NULL) {
+    return HAL_ERROR;
+  }
+  const volatile uint32_t *word = (const volatile uint32_t *)&_sstack;
+  const volatile uint32_t *const top = (const volatile uint32_t *)&_estack;
+
+  // The stack grows down: the lowest word changed is the deepest it went
+  while (word < top && *word == MEM_BUDGET_STACK_PAINT) {
+    word++;
+  }
+  stack->size = MEM_BUDGET_SPAN(_sstack, _estack);
+  stack->used = (uint32_t)top - (uint32_t)word;
+  stack->overflow = (word == (const volatile uint32_t *)&_sstack);
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef memBudget_getHeap(MemBudget_Heap_t *heap) {
+  if (heap == NULL) {
+    return HAL_ERROR;
+  }
+  heap->reserved = MEM_BUDGET_SPAN(_end, _eheap);
+  heap->used = (uint32_t)_sbrk(0) - (uint32_t)&_end;
+  heap->sealed = sealed;
+  heap->refused = refused;
+  return HAL_OK;
+}
+
+void memBudget_seal(void) { sealed = 1; }
+
+HAL_StatusTypeDef memBudget_onHeapGrowth(int32_t incr) {
+  if (!sealed || incr <= 0) {
+    return HAL_OK; // giving memory back is always fine
+  }
+#if MEM_BUDGET_HEAP_TRAP
+  Error_Handler();
+#endif
+  refused++;
+  return HAL_ERROR;
+}
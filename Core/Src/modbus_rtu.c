@@ -0,0 +1,355 @@
+/**
+ ******************************************************************************
+ * @file    modbus_rtu.c
+ * @brief   Implementation of the Modbus RTU request processing
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "modbus_rtu.h"
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define MODBUS_RTU_READ_LEN 8U   // address, FC, start, quantity, CRC
+#define MODBUS_RTU_WRITE_HDR 7U  // address, FC, start, quantity, byte count
+#define MODBUS_RTU_EXCEPTION_FLAG 0x80U
+
+/* Private variables ---------------------------------------------------------*/
+
+// Byte-wise table of the reflected polynomial 0xA001
+static const uint16_t crc_table[256] = {
+    0x0000U, 0xC0C1U, 0xC181U, 0x0140U, 0xC301U, 0x03C0U, 0x0280U, 0xC241U,
+    0xC601U, 0x06C0U, 0x0780U, 0xC741U, 0x0500U, 0xC5C1U, 0xC481U, 0x0440U,
+    0xCC01U, 0x0CC0U, 0x0D80U, 0xCD41U, 0x0F00U, 0xCFC1U, 0xCE81U, 0x0E40U,
+    0x0A00U, 0xCAC1U, 0xCB81U, 0x0B40U, 0xC901U, 0x09C0U, 0x0880U, 0xC841U,
+    0xD801U, 0x18C0U, 0x1980U, 0xD941U, 0x1B00U, 0xDBC1U, 0xDA81U, 0x1A40U,
+    0x1E00U, 0xDEC1U, 0xDF81U, 0x1F40U, 0xDD01U, 0x1DC0U, 0x1C80U, 0xDC41U,
+    0x1400U, 0xD4C1U, 0xD581U, 0x1540U, 0xD701U, 0x17C0U, 0x1680U, 0xD641U,
+    0xD201U, 0x12C0U, 0x1380U, 0xD341U, 0x1100U, 0xD1C1U, 0xD081U, 0x1040U,
+    0xF001U, 0x30C0U, 0x3180U, 0xF141U, 0x3300U, 0xF3C1U, 0xF281U, 0x3240U,
+    0x3600U, 0xF6C1U, 0xF781U, 0x3740U, 0xF501U, 0x35C0U, 0x3480U, 0xF441U,
+    0x3C00U, 0xFCC1U, 0xFD81U, 0x3D40U, 0xFF01U, 0x3FC0U, 0x3E80U, 0xFE41U,
+    0xFA01U, 0x3AC0U, 0x3B80U, 0xFB41U, 0x3900U, 0xF9C1U, 0xF881U, 0x3840U,
+    0x2800U, 0xE8C1U, 0xE981U, 0x2940U, 0xEB01U, 0x2BC0U, 0x2A80U, 0xEA41U,
+    0xEE01U, 0x2EC0U, 0x2F80U, 0xEF41U, 0x2D00U, 0xEDC1U, 0xEC81U, 0x2C40U,
+    0xE401U, 0x24C0U, 0x2580U, 0xE541U, 0x2700U, 0xE7C1U, 0xE681U, 0x2640U,
+    0x2200U, 0xE2C1U, 0xE381U, 0x2340U, 0xE101U, 0x21C0U, 0x2080U, 0xE041U,
+    0xA001U, 0x60C0U, 0x6180U, 0xA141U, 0x6300U, 0xA3C1U, 0xA281U, 0x6240U,
+    0x6600U, 0xA6C1U, 0xA781U, 0x6740U, 0xA501U, 0x65C0U, 0x6480U, 0xA441U,
+    0x6C00U, 0xACC1U, 0xAD81U, 0x6D40U, 0xAF01U, 0x6FC0U, 0x6E80U, 0xAE41U,
+    0xAA01U, 0x6AC0U, 0x6B80U, 0xAB41U, 0x6900U, 0xA9C1U, 0xA881U, 0x6840U,
+    0x7800U, 0xB8C1U, 0xB981U, 0x7940U, 0xBB01U, 0x7BC0U, 0x7A80U, 0xBA41U,
+    0xBE01U, 0x7EC0U, 0x7F80U, 0xBF41U, 0x7D00U, 0xBDC1U, 0xBC81U, 0x7C40U,
+    0xB401U, 0x74C0U, 0x7580U, 0xB541U, 0x7700U, 0xB7C1U, 0xB681U, 0x7640U,
+    0x7200U, 0xB2C1U, 0xB381U, 0x7340U, 0xB101U, 0x71C0U, 0x7080U, 0xB041U,
+    0x5000U, 0x90C1U, 0x9181U, 0x5140U, 0x9301U, 0x53C0U, 0x5280U, 0x9241U,
+    0x9601U, 0x56C0U, 0x5780U, 0x9741U, 0x5500U, 0x95C1U, 0x9481U, 0x5440U,
+    0x9C01U, 0x5CC0U, 0x5D80U, 0x9D41U, 0x5F00U, 0x9FC1U, 0x9E81U, 0x5E40U,
+    0x5A00U, 0x9AC1U, 0x9B81U, 0x5B40U, 0x9901U, 0x59C0U, 0x5880U, 0x9841U,
+    0x8801U, 0x48C0U, 0x4980U, 0x8941U, 0x4B00U, 0x8BC1U, 0x8A81U, 0x4A40U,
+    0x4E00U, 0x8EC1U, 0x8F81U, 0x4F40U, 0x8D01U, 0x4DC0U, 0x4C80U, 0x8C41U,
+    0x4400U, 0x84C1U, 0x8581U, 0x4540U, 0x8701U, 0x47C0U, 0x4680U, 0x8641U,
+    0x8201U, 0x42C0U, 0x4380U, 0x8341U, 0x4100U, 0x81C1U, 0x8081U, 0x4040U};
+
+/* Private functions ---------------------------------------------------------*/
+
+static uint16_t modbusRtu_get16(const uint8_t *p) {
+  return (uint16_t)(((uint16_t)p[0] << 8) | p[1]);
+}
+
+static void modbusRtu_put16(uint8_t *p, uint16_t value) {
+  p[0] = (uint8_t)(value >> 8);
+  p[1] = (uint8_t)value;
+}
+
+/**
+ * @brief Registers one field of a type takes
+ */
+static uint8_t modbusRtu_width(uint8_t type) {
+  return (type >= (uint8_t)MODBUS_RTU_U32) ? 2U : 1U;
+}
+
+/**
+ * @brief Address of a region's field
+ */
+static uint8_t *modbusRtu_field(const ModbusRtu_Region_t *region,
+                                uint16_t index) {
+  static const uint8_t sizes[] = {1U, 2U, 2U, 4U, 4U, 4U};
+  const uint32_t stride =
+      (region->stride != 0U) ? region->stride : sizes[region->type];
+  return (uint8_t *)region->data + (uint32_t)index * stride;
+}
+
+/**
+ * @brief Region covering a register, with the field and the half of it
+ *
+ * @return NULL if no region covers it
+ */
+static const ModbusRtu_Region_t *
+modbusRtu_find(const ModbusRtu_Region_t *regions, uint8_t count,
+               uint16_t reg, uint16_t *index, uint8_t *half) {
+  for (uint8_t i = 0; i < count; i++) {
+    const ModbusRtu_Region_t *region = &regions[i];
+    const uint8_t width = modbusRtu_width(region->type);
+    const uint32_t offset = (uint32_t)reg - region->address;
+    if (reg >= region->address &&
+        offset < (uint32_t)region->count * width) {
+      *index = (uint16_t)(offset / width);
+      *half = (uint8_t)(offset % width);
+      return region;
+    }
+  }
+  return NULL;
+}
+
+/**
+ * @brief Register value of a field, read where it lives
+ */
+static uint16_t modbusRtu_read(const ModbusRtu_Region_t *region,
+                               uint16_t index, uint8_t half) {
+  const uint8_t *field = modbusRtu_field(region, index);
+  switch ((ModbusRtu_Type_t)region->type) {
+  case MODBUS_RTU_U8:
+    return *field;
+  case MODBUS_RTU_U16:
+  case MODBUS_RTU_I16: {
+    uint16_t value;
+    memcpy(&value, field, sizeof(value));
+    return value;
+  }
+  default: {
+    uint32_t value; // one load, so both halves come from the same value
+    memcpy(&value, field, sizeof(value));
+    return (half == 0U) ? (uint16_t)(value >> 16) : (uint16_t)value;
+  }
+  }
+}
+
+/**
+ * @brief Check a field value against the region's bounds
+ */
+static uint8_t modbusRtu_inRange(const ModbusRtu_Region_t *region,
+                                 uint32_t raw) {
+  int64_t value;
+  switch ((ModbusRtu_Type_t)region->type) {
+  case MODBUS_RTU_I16:
+    value = (int16_t)raw;
+    break;
+  case MODBUS_RTU_I32:
+    value = (int32_t)raw;
+    break;
+  case MODBUS_RTU_F32: {
+    float f;
+    memcpy(&f, &raw, sizeof(f));
+    // NaN fails both comparisons
+    return (f >= (float)region->min && f <= (float)region->max) ? 1U : 0U;
+  }
+  default:
+    value = (int64_t)raw;
+    break;
+  }
+  return (value >= region->min && value <= region->max) ? 1U : 0U;
+}
+
+static void modbusRtu_store(const ModbusRtu_Region_t *region, uint16_t index,
+                            uint32_t raw) {
+  uint8_t *field = modbusRtu_field(region, index);
+  switch ((ModbusRtu_Type_t)region->type) {
+  case MODBUS_RTU_U8:
+    *field = (uint8_t)raw;
+    break;
+  case MODBUS_RTU_U16:
+  case MODBUS_RTU_I16: {
+    const uint16_t value = (uint16_t)raw;
+    memcpy(field, &value, sizeof(value));
+    break;
+  }
+  default:
+    memcpy(field, &raw, sizeof(raw));
+    break;
+  }
+}
+
+/**
+ * @brief Check, then with store set store, count registers from start
+ *
+ * @param values Big-endian register values, count of them
+ *
+ * @return 0, or the exception code
+ */
+static uint8_t modbusRtu_write(const ModbusRtu_Map_t *map, uint16_t start,
+                               uint16_t count, const uint8_t *values,
+                               uint8_t store, uint32_t *written) {
+  uint16_t done = 0;
+  while (done < count) {
+    uint16_t index;
+    uint8_t half;
+    const ModbusRtu_Region_t *region = modbusRtu_find(
+        map->holding, map->holding_count, (uint16_t)(start + done), &index,
+        &half);
+    const uint8_t width =
+        (region != NULL) ? modbusRtu_width(region->type) : 1U;
+    // A 32-bit field is written whole or not at all
+    if (region == NULL || half != 0U || done + width > count) {
+      return MODBUS_RTU_EX_ADDRESS;
+    }
+    uint32_t raw = modbusRtu_get16(&values[2U * done]);
+    if (width == 2U) {
+      raw = (raw << 16) | modbusRtu_get16(&values[2U * done + 2U]);
+    }
+    if (!modbusRtu_inRange(region, raw)) {
+      return MODBUS_RTU_EX_VALUE;
+    }
+    if (store) {
+      modbusRtu_store(region, index, raw);
+      if (region->notify != 0U && written != NULL) {
+        *written |= region->notify;
+      }
+    }
+    done = (uint16_t)(done + width);
+  }
+  return 0;
+}
+
+/**
+ * @brief Reply to FC03/FC04
+ *
+ * @return 0, or the exception code
+ */
+static uint8_t modbusRtu_readRegs(const ModbusRtu_Region_t *regions,
+                                  uint8_t region_count, const uint8_t *req,
+                                  uint16_t len, uint8_t *resp,
+                                  uint16_t *resp_len) {
+  if (len != MODBUS_RTU_READ_LEN) {
+    return MODBUS_RTU_EX_VALUE;
+  }
+  const uint16_t start = modbusRtu_get16(&req[2]);
+  const uint16_t count = modbusRtu_get16(&req[4]);
+  if (count == 0U || count > MODBUS_RTU_READ_MAX) {
+    return MODBUS_RTU_EX_VALUE;
+  }
+  if ((uint32_t)start + count > 0x10000UL) {
+    return MODBUS_RTU_EX_ADDRESS;
+  }
+  for (uint16_t i = 0; i < count; i++) {
+    uint16_t index;
+    uint8_t half;
+    const ModbusRtu_Region_t *region = modbusRtu_find(
+        regions, region_count, (uint16_t)(start + i), &index, &half);
+    if (region == NULL) {
+      return MODBUS_RTU_EX_ADDRESS;
+    }
+    modbusRtu_put16(&resp[3U + 2U * i], modbusRtu_read(region, index, half));
+  }
+  resp[2] = (uint8_t)(2U * count);
+  *resp_len = (uint16_t)(3U + 2U * count);
+  return 0;
+}
+
+/**
+ * @brief Reply to FC06/FC16
+ *
+ * @return 0, or the exception code
+ */
+static uint8_t modbusRtu_writeRegs(const ModbusRtu_Map_t *map,
+                                   const uint8_t *req, uint16_t len,
+                                   uint8_t *resp, uint16_t *resp_len,
+                                   uint32_t *written) {
+  uint16_t start = modbusRtu_get16(&req[2]);
+  uint16_t count = 1U;
+  const uint8_t *values = &req[4];
+  if (req[1] == MODBUS_RTU_FC_WRITE_SINGLE) {
+    if (len != MODBUS_RTU_READ_LEN) {
+      return MODBUS_RTU_EX_VALUE;
+    }
+  } else {
+    count = (len >= MODBUS_RTU_WRITE_HDR + 2U) ? modbusRtu_get16(&req[4]) : 0U;
+    if (count == 0U || count > MODBUS_RTU_WRITE_MAX ||
+        req[6] != 2U * count ||
+        len != MODBUS_RTU_WRITE_HDR + 2U * count + 2U) {
+      return MODBUS_RTU_EX_VALUE;
+    }
+    values = &req[MODBUS_RTU_WRITE_HDR];
+  }
+  if ((uint32_t)start + count > 0x10000UL) {
+    return MODBUS_RTU_EX_ADDRESS;
+  }
+  const uint8_t ex = modbusRtu_write(map, start, count, values, 0U, NULL);
+  if (ex != 0U) {
+    return ex;
+  }
+  (void)modbusRtu_write(map, start, count, values, 1U, written);
+  // Both replies echo the start and the quantity or value
+  memcpy(&resp[2], &req[2], 4U);
+  *resp_len = 6U;
+  return 0;
+}
+
+/* Public functions ----------------------------------------------------------*/
+
+uint16_t modbusRtu_crc16(const uint8_t *data, uint16_t len) {
+  uint16_t crc = 0xFFFFU;
+  for (uint16_t i = 0; i < len; i++) {
+    crc = (uint16_t)((crc >> 8) ^ crc_table[(uint8_t)(crc ^ data[i])]);
+  }
+  return crc;
+}
+
+ModbusRtu_Result_t modbusRtu_process(const ModbusRtu_Map_t *map,
+                                     const uint8_t *req, uint16_t len,
+                                     uint8_t *resp, uint16_t *resp_len,
+                                     uint32_t *written) {
+  *resp_len = 0;
+  if (len < MODBUS_RTU_ADU_MIN || len > MODBUS_RTU_ADU_MAX) {
+    return MODBUS_RTU_BAD_FRAME;
+  }
+  const uint16_t crc = (uint16_t)(req[len - 2U] | (req[len - 1U] << 8));
+  if (modbusRtu_crc16(req, (uint16_t)(len - 2U)) != crc) {
+    return MODBUS_RTU_BAD_FRAME;
+  }
+  const uint8_t broadcast = (req[0] == MODBUS_RTU_BROADCAST);
+  if (!broadcast && req[0] != map->address) {
+    return MODBUS_RTU_OTHER;
+  }
+
+  uint16_t out_len = 0;
+  uint8_t ex;
+  switch (req[1]) {
+  case MODBUS_RTU_FC_READ_HOLDING:
+  case MODBUS_RTU_FC_READ_INPUT:
+    if (broadcast) {
+      return MODBUS_RTU_SILENT; // nothing to read for nobody
+    }
+    ex = (req[1] == MODBUS_RTU_FC_READ_INPUT)
+             ? modbusRtu_readRegs(map->input, map->input_count, req, len,
+                                  resp, &out_len)
+             : modbusRtu_readRegs(map->holding, map->holding_count, req, len,
+                                  resp, &out_len);
+    break;
+  case MODBUS_RTU_FC_WRITE_SINGLE:
+  case MODBUS_RTU_FC_WRITE_MULTIPLE:
+    ex = modbusRtu_writeRegs(map, req, len, resp, &out_len, written);
+    break;
+  default:
+    ex = MODBUS_RTU_EX_FUNCTION;
+    break;
+  }
+  if (broadcast) {
+    return MODBUS_RTU_SILENT;
+  }
+
+  resp[0] = map->address;
+  if (ex != 0U) {
+    resp[1] = (uint8_t)(req[1] | MODBUS_RTU_EXCEPTION_FLAG);
+    resp[2] = ex;
+    out_len = 3U;
+  } else {
+    resp[1] = req[1];
+  }
+  const uint16_t out_crc = modbusRtu_crc16(resp, out_len);
+  resp[out_len] = (uint8_t)out_crc;
+  resp[out_len + 1U] = (uint8_t)(out_crc >> 8);
+  *resp_len = (uint16_t)(out_len + 2U);
+  return (ex != 0U) ? MODBUS_RTU_EXCEPTION : MODBUS_RTU_REPLY;
+}
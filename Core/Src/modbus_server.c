@@ -0,0 +1,325 @@
+/**
+ ******************************************************************************
+ * @file    modbus_server.c
+ * @brief   Implementation of the Modbus RTU server on USART2
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "modbus_server.h"
+#include "adc_sections.h"
+#include "dac_loopback.h"
+
+#if MODBUS_SERVER_ENABLE && DAC_LOOPBACK_ENABLE
+#error "MODBUS_SERVER_ENABLE and DAC_LOOPBACK_ENABLE both need DMA1 Stream5"
+#endif
+
+/* Private defines -----------------------------------------------------------*/
+#define MODBUS_SERVER_RX_COUNT (MODBUS_RTU_ADU_MAX + 1U) // one more: overlong
+#define MODBUS_SERVER_BUFFER_BYTES                                            \
+  (((MODBUS_SERVER_RX_COUNT + ADC_DCACHE_LINE_SIZE - 1U) /                     \
+    ADC_DCACHE_LINE_SIZE) *                                                    \
+   ADC_DCACHE_LINE_SIZE)
+#define MODBUS_SERVER_T35_BITS 39U // 3.5 characters of 11 bits
+#define MODBUS_SERVER_T35_BAUD 19200U
+#define MODBUS_SERVER_T35_US 1750U // fixed above MODBUS_SERVER_T35_BAUD
+#define MODBUS_SERVER_RX_ERRORS                                               \
+  (USART_ISR_PE | USART_ISR_FE | USART_ISR_NE | USART_ISR_ORE)
+#define MODBUS_SERVER_RX_CLEAR                                                \
+  (USART_ICR_PECF | USART_ICR_FECF | USART_ICR_NCF | USART_ICR_ORECF)
+
+/* Private variables ---------------------------------------------------------*/
+static UART_HandleTypeDef huart_modbus;
+static DMA_HandleTypeDef hdma_modbus_rx;
+static DMA_HandleTypeDef hdma_modbus_tx;
+static const ModbusRtu_Map_t *server_map = NULL;
+static uint8_t ready = 0;
+
+static uint8_t rx_buffer[MODBUS_SERVER_BUFFER_BYTES] ADC_SRAM1_BSS
+    ADC_DMA_ALIGNED;
+static uint8_t tx_buffer[MODBUS_SERVER_BUFFER_BYTES] ADC_SRAM1_BSS
+    ADC_DMA_ALIGNED;
+static uint8_t rx_armed = 0;     // stream 5 is receiving a frame
+static uint8_t rx_error = 0;     // ... and the USART flagged one of its bytes
+static uint8_t tx_exception = 0; // reply being sent is an exception
+static uint32_t tx_entry = 0;    // CYCCNT at the RTOF of its request
+
+static volatile uint32_t written_bits = 0; // for modbusServer_poll()
+static ModbusServer_WriteCallback_t write_callback = NULL;
+static void *write_ctx = NULL;
+static ModbusServer_Stats_t stats_ = {0};
+
+/* Private functions ---------------------------------------------------------*/
+
+static void modbusServer_initPins(void) {
+  GPIO_InitTypeDef gpio = {.Pin = GPIO_PIN_4 | GPIO_PIN_5 | GPIO_PIN_6,
+                           .Mode = GPIO_MODE_AF_PP,
+                           .Pull = GPIO_NOPULL,
+                           .Speed = GPIO_SPEED_FREQ_HIGH,
+                           .Alternate = GPIO_AF7_USART2};
+  __HAL_RCC_GPIOD_CLK_ENABLE();
+  HAL_GPIO_Init(GPIOD, &gpio);
+}
+
+static HAL_StatusTypeDef modbusServer_initUart(void) {
+  RCC_PeriphCLKInitTypeDef clk = {0};
+  clk.PeriphClockSelection = RCC_PERIPHCLK_USART2;
+  clk.Usart2ClockSelection = RCC_USART2CLKSOURCE_PCLK1;
+  if (HAL_RCCEx_PeriphCLKConfig(&clk) != HAL_OK) {
+    return HAL_ERROR;
+  }
+  __HAL_RCC_USART2_CLK_ENABLE();
+
+  huart_modbus.Instance = USART2;
+  huart_modbus.Init.BaudRate = MODBUS_SERVER_BAUD;
+  // 11 bits per character either way: the parity bit or a second stop bit
+  huart_modbus.Init.Parity = MODBUS_SERVER_PARITY;
+  if (MODBUS_SERVER_PARITY == UART_PARITY_NONE) {
+    huart_modbus.Init.WordLength = UART_WORDLENGTH_8B;
+    huart_modbus.Init.StopBits = UART_STOPBITS_2;
+  } else {
+    huart_modbus.Init.WordLength = UART_WORDLENGTH_9B;
+    huart_modbus.Init.StopBits = UART_STOPBITS_1;
+  }
+  huart_modbus.Init.Mode = UART_MODE_TX_RX;
+  huart_modbus.Init.HwFlowCtl = UART_HWCONTROL_NONE;
+  huart_modbus.Init.OverSampling = UART_OVERSAMPLING_16;
+  huart_modbus.Init.OneBitSampling = UART_ONE_BIT_SAMPLE_DISABLE;
+  huart_modbus.AdvancedInit.AdvFeatureInit = UART_ADVFEATURE_NO_INIT;
+  // DE asserted and released by the USART around each reply
+  if (HAL_RS485Ex_Init(&huart_modbus, UART_DE_POLARITY_HIGH, 0U, 0U) !=
+      HAL_OK) {
+    return HAL_ERROR;
+  }
+
+  const uint32_t rto_bits =
+      (MODBUS_SERVER_BAUD <= MODBUS_SERVER_T35_BAUD)
+          ? MODBUS_SERVER_T35_BITS
+          : (uint32_t)(((uint64_t)MODBUS_SERVER_T35_US * MODBUS_SERVER_BAUD +
+                        999999U) /
+                       1000000U);
+  HAL_UART_ReceiverTimeout_Config(&huart_modbus, rto_bits);
+  if (HAL_UART_EnableReceiverTimeout(&huart_modbus) != HAL_OK) {
+    return HAL_ERROR;
+  }
+  SET_BIT(USART2->CR1, USART_CR1_RTOIE | USART_CR1_PEIE);
+  SET_BIT(USART2->CR3, USART_CR3_EIE);
+
+  HAL_NVIC_SetPriority(USART2_IRQn, MODBUS_SERVER_IRQ_PRIORITY, 0);
+  HAL_NVIC_EnableIRQ(USART2_IRQn);
+  return HAL_OK;
+}
+
+static HAL_StatusTypeDef modbusServer_initStream(DMA_HandleTypeDef *hdma,
+                                                 DMA_Stream_TypeDef *stream,
+                                                 uint32_t direction) {
+  hdma->Instance = stream;
+  hdma->Init.Channel = DMA_CHANNEL_4;
+  hdma->Init.Direction = direction;
+  hdma->Init.PeriphInc = DMA_PINC_DISABLE;
+  hdma->Init.MemInc = DMA_MINC_ENABLE;
+  hdma->Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+  hdma->Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+  hdma->Init.Mode = DMA_NORMAL;
+  hdma->Init.Priority = DMA_PRIORITY_MEDIUM;
+  hdma->Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+  return HAL_DMA_Init(hdma);
+}
+
+static HAL_StatusTypeDef modbusServer_initDma(void) {
+  __HAL_RCC_DMA1_CLK_ENABLE();
+  // No stream interrupts: the USART's RTOF and TC end both transfers
+  if (modbusServer_initStream(&hdma_modbus_rx, DMA1_Stream5,
+                              DMA_PERIPH_TO_MEMORY) != HAL_OK ||
+      modbusServer_initStream(&hdma_modbus_tx, DMA1_Stream6,
+                              DMA_MEMORY_TO_PERIPH) != HAL_OK) {
+    return HAL_ERROR;
+  }
+  return HAL_OK;
+}
+
+/**
+ * @brief Wait for the next request
+ */
+static void modbusServer_armRx(void) {
+  rx_error = 0;
+  USART2->ICR = MODBUS_SERVER_RX_CLEAR | USART_ICR_RTOCF;
+  USART2->RQR = USART_RQR_RXFRQ; // a byte left over from the reply time
+  if (HAL_DMA_Start(&hdma_modbus_rx, (uint32_t)&USART2->RDR,
+                    (uint32_t)rx_buffer, MODBUS_SERVER_RX_COUNT) != HAL_OK) {
+    return; // not armed: counted as nothing, the next init recovers
+  }
+  SET_BIT(USART2->CR3, USART_CR3_DMAR);
+  rx_armed = 1;
+}
+
+/**
+ * @brief RTOF: a frame ended; execute it and start its reply
+ */
+static void modbusServer_request(uint32_t entry) {
+  const uint16_t len = (uint16_t)(MODBUS_SERVER_RX_COUNT -
+                                  __HAL_DMA_GET_COUNTER(&hdma_modbus_rx));
+  CLEAR_BIT(USART2->CR3, USART_CR3_DMAR);
+  (void)HAL_DMA_Abort(&hdma_modbus_rx);
+  rx_armed = 0;
+  if (rx_error) {
+    stats_.uart_errors++;
+    modbusServer_armRx();
+    return;
+  }
+  SCB_InvalidateDCache_by_Addr((uint32_t *)rx_buffer,
+                               (int32_t)sizeof(rx_buffer));
+
+  uint16_t out_len = 0;
+  uint32_t written = 0;
+  const ModbusRtu_Result_t result = modbusRtu_process(
+      server_map, rx_buffer, len, tx_buffer, &out_len, &written);
+  written_bits |= written;
+  switch (result) {
+  case MODBUS_RTU_REPLY:
+  case MODBUS_RTU_EXCEPTION:
+    stats_.requests++;
+    break;
+  case MODBUS_RTU_SILENT:
+    stats_.requests++;
+    if (rx_buffer[0] == MODBUS_RTU_BROADCAST) {
+      stats_.broadcasts++;
+    }
+    modbusServer_armRx();
+    return;
+  case MODBUS_RTU_OTHER:
+    stats_.other++;
+    modbusServer_armRx();
+    return;
+  default:
+    stats_.bad_frames++;
+    modbusServer_armRx();
+    return;
+  }
+
+  SCB_CleanDCache_by_Addr((uint32_t *)tx_buffer, (int32_t)sizeof(tx_buffer));
+  USART2->ICR = USART_ICR_TCCF;
+  if (HAL_DMA_Start(&hdma_modbus_tx, (uint32_t)tx_buffer,
+                    (uint32_t)&USART2->TDR, out_len) != HAL_OK) {
+    modbusServer_armRx();
+    return;
+  }
+  SET_BIT(USART2->CR3, USART_CR3_DMAT);
+
+  const uint32_t turn = DWT->CYCCNT - entry;
+  stats_.measured++;
+  stats_.turn_sum_cyc += turn;
+  if (turn < stats_.turn_min_cyc) {
+    stats_.turn_min_cyc = turn;
+  }
+  if (turn > stats_.turn_max_cyc) {
+    stats_.turn_max_cyc = turn;
+  }
+  tx_exception = (result == MODBUS_RTU_EXCEPTION);
+  tx_entry = entry;
+  SET_BIT(USART2->CR1, USART_CR1_TCIE);
+}
+
+/**
+ * @brief TC: the reply's last stop bit is out (DE released); listen again
+ */
+static void modbusServer_replyDone(void) {
+  CLEAR_BIT(USART2->CR1, USART_CR1_TCIE);
+  CLEAR_BIT(USART2->CR3, USART_CR3_DMAT);
+  (void)HAL_DMA_Abort(&hdma_modbus_tx); // finished; back to READY
+  USART2->ICR = USART_ICR_TCCF;
+
+  const uint32_t us = (DWT->CYCCNT - tx_entry) / (SystemCoreClock / 1000000U);
+  if (us > stats_.reply_max_us) {
+    stats_.reply_max_us = us;
+  }
+  if (tx_exception) {
+    stats_.exceptions++;
+  } else {
+    stats_.replies++;
+  }
+  modbusServer_armRx();
+}
+
+/* Public functions ----------------------------------------------------------*/
+
+HAL_StatusTypeDef modbusServer_init(const ModbusRtu_Map_t *map) {
+#if !MODBUS_SERVER_ENABLE
+  return HAL_OK; // no transceiver: USART2 and its streams stay free
+#endif
+  if (map == NULL) {
+    return HAL_ERROR;
+  }
+  server_map = map;
+  modbusServer_initPins();
+  if (modbusServer_initDma() != HAL_OK || modbusServer_initUart() != HAL_OK) {
+    return HAL_ERROR;
+  }
+  // Turnaround is counted on CYCCNT
+  if (!(DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk)) {
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+  }
+  stats_ = (ModbusServer_Stats_t){.turn_min_cyc = UINT32_MAX};
+  ready = 1;
+  modbusServer_armRx();
+  return rx_armed ? HAL_OK : HAL_ERROR;
+}
+
+void modbusServer_poll(void) {
+  if (!ready) {
+    return;
+  }
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  const uint32_t written = written_bits;
+  written_bits = 0;
+  __set_PRIMASK(primask);
+  if (written != 0U && write_callback != NULL) {
+    write_callback(written, write_ctx);
+  }
+}
+
+void modbusServer_registerWriteCallback(ModbusServer_WriteCallback_t callback,
+                                        void *ctx) {
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  write_callback = callback;
+  write_ctx = ctx;
+  __set_PRIMASK(primask);
+}
+
+HAL_StatusTypeDef modbusServer_getStats(ModbusServer_Stats_t *stats) {
+  if (stats == NULL) {
+    return HAL_ERROR;
+  }
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  *stats = stats_;
+  __set_PRIMASK(primask);
+  if (stats->measured == 0U) {
+    stats->turn_min_cyc = 0U;
+  }
+  return HAL_OK;
+}
+
+void modbusServer_irqHandler(void) {
+  const uint32_t entry = DWT->CYCCNT; // first, so the turnaround is whole
+  const uint32_t isr = USART2->ISR;
+  if ((isr & MODBUS_SERVER_RX_ERRORS) != 0U) {
+    USART2->ICR = MODBUS_SERVER_RX_CLEAR;
+    if (rx_armed) {
+      rx_error = 1; // the frame is dropped at its RTOF
+    }
+  }
+  if ((isr & USART_ISR_RTOF) != 0U) {
+    USART2->ICR = USART_ICR_RTOCF;
+    if (rx_armed) {
+      modbusServer_request(entry);
+    }
+  }
+  if ((isr & USART_ISR_TC) != 0U && (USART2->CR1 & USART_CR1_TCIE) != 0U) {
+    modbusServer_replyDone();
+  }
+}
@@ -0,0 +1,399 @@
+/**
+ ******************************************************************************
+ * @file    nn_anomaly.c
+ * @brief   Implementation of the per-group anomaly score
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "nn_anomaly.h"
+#include "arm_nnfunctions.h"
+#include "dwt_profiler.h"
+#include <math.h>
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+#if NN_ANOMALY_MAX_GROUPS < 1 ||                                              \
+    NN_ANOMALY_MAX_GROUPS > TELEMETRY_FRAME_ANOMALY_GROUPS
+#error "NN_ANOMALY_MAX_GROUPS must be in 1..TELEMETRY_FRAME_ANOMALY_GROUPS"
+#endif
+
+#if NN_ANOMALY_MAX_INPUTS > NN_ANOMALY_MAX_UNITS
+#error "NN_ANOMALY_MAX_UNITS must hold the largest input vector"
+#endif
+
+#if NN_ANOMALY_BANDS > TELEMETRY_FRAME_MAX_BANDS
+#error "NN_ANOMALY_BANDS must not exceed TELEMETRY_FRAME_MAX_BANDS"
+#endif
+
+/* Private types -------------------------------------------------------------*/
+
+typedef struct {
+  const NnAnomaly_Model_t *model; ///< Valid model, or the baseline
+  uint16_t inputs;                ///< Vector length of the mask
+  uint16_t active;                ///< Inputs with inv_std > 0
+  const float32_t *mean;          ///< Model's, or learned[]
+  const float32_t *inv_std;
+  float32_t learn_mean[NN_ANOMALY_MAX_INPUTS];
+  float32_t learn_inv_std[NN_ANOMALY_MAX_INPUTS]; ///< M2 while learning
+  float sum;                      ///< Window scores of the period
+  float peak;
+} NnAnomaly_GroupState_t;
+
+/* Private variables ---------------------------------------------------------*/
+
+/* Default model: none. A generated file defines it without the weak. */
+__attribute__((weak)) const NnAnomaly_Model_t nn_anomaly_model = {0};
+
+/* Baseline: no layers, the learned normalisation; 3 fraction bits reach
+   16 sigma, so one feature far out can lift a 24-input mean past a few */
+static const NnAnomaly_Model_t baseline = {.magic = NN_ANOMALY_MAGIC,
+                                           .input_frac_bits = 3};
+
+static NnAnomaly_Config_t config;
+static NnAnomaly_GroupState_t state[NN_ANOMALY_MAX_GROUPS];
+static float bands[ADC_CONVERSIONS_CHANNEL_COUNT][2U * NN_ANOMALY_BANDS];
+static NnAnomaly_Result_t result;
+static uint8_t ready = 0;
+static uint8_t have_result = 0;
+static uint16_t learn_seen = 0; ///< Windows learned so far
+static uint16_t learning = 0;   ///< Windows left, 0 = scoring
+static uint16_t period_windows = 0;
+static uint8_t period_learned = 0; ///< The period had a learning window
+static uint32_t period_cycles = 0;
+
+/* Quantised input, kept for the reconstruction error; layer scratch:
+   ping-pong activations and the q15 copy of a vector */
+static q7_t input[NN_ANOMALY_MAX_INPUTS];
+static q7_t act[2][NN_ANOMALY_MAX_UNITS];
+static q15_t vec_buffer[NN_ANOMALY_MAX_UNITS];
+
+/* Private functions ---------------------------------------------------------*/
+
+static uint8_t nnAnomaly_popcount(ADC_ChannelMask_t mask) {
+  uint8_t n = 0;
+  while (mask != 0U) {
+    n += (uint8_t)(mask & 1U);
+    mask >>= 1;
+  }
+  return n;
+}
+
+/**
+ * @brief Whether a model's layers chain from its inputs to its inputs
+ *        (autoencoder) or to one output (classifier)
+ */
+static uint8_t nnAnomaly_checkModel(const NnAnomaly_Model_t *m,
+                                    uint16_t inputs) {
+  if (m->inputs != inputs || m->layer_count > NN_ANOMALY_MAX_LAYERS ||
+      m->input_frac_bits > 7U || m->output_frac_bits > 7U ||
+      (m->mean == NULL) != (m->inv_std == NULL)) {
+    return 0;
+  }
+  uint16_t width = inputs;
+  for (uint8_t l = 0; l < m->layer_count; l++) {
+    const NnAnomaly_Layer_t *layer = &m->layer[l];
+    if (layer->weights == NULL || layer->bias == NULL ||
+        layer->inputs != width || layer->outputs == 0U ||
+        layer->outputs > NN_ANOMALY_MAX_UNITS) {
+      return 0;
+    }
+    width = layer->outputs;
+  }
+  return (width == inputs || width == 1U) ? 1U : 0U;
+}
+
+/**
+ * @brief Input vector of a group, in channel order
+ */
+static void nnAnomaly_vector(ADC_ChannelMask_t mask,
+                             const TelemetryFrame_Features_t *features,
+                             float32_t *x) {
+  uint16_t n = 0;
+  for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+    if (!((mask >> ch) & 1U)) {
+      continue;
+    }
+    const float *v = features->value[ch];
+    x[n++] = v[TELEMETRY_FRAME_FEATURE_RMS];
+    x[n++] = v[TELEMETRY_FRAME_FEATURE_PEAK_TO_PEAK];
+    x[n++] = v[TELEMETRY_FRAME_FEATURE_CREST];
+    x[n++] = v[TELEMETRY_FRAME_FEATURE_KURTOSIS];
+    for (uint8_t b = 0; b < 2U * NN_ANOMALY_BANDS; b++) {
+      x[n++] = bands[ch][b];
+    }
+  }
+}
+
+/**
+ * @brief Point a group at its normalisation and count its active inputs
+ */
+static void nnAnomaly_useNormalisation(NnAnomaly_GroupState_t *g) {
+  if (g->model->mean != NULL) {
+    g->mean = g->model->mean;
+    g->inv_std = g->model->inv_std;
+  } else {
+    g->mean = g->learn_mean;
+    g->inv_std = g->learn_inv_std;
+  }
+  g->active = 0;
+  for (uint16_t i = 0; i < g->inputs; i++) {
+    if (g->inv_std[i] > 0.0f) {
+      g->active++;
+    }
+  }
+}
+
+/**
+ * @brief One learning window: Welford update of every learning group,
+ *        and the normalisation at the last one
+ */
+static void nnAnomaly_learnWindow(const TelemetryFrame_Features_t *features) {
+  float32_t x[NN_ANOMALY_MAX_INPUTS];
+  learn_seen++;
+  const float32_t n = (float32_t)learn_seen;
+  for (uint8_t g = 0; g < config.group_count; g++) {
+    NnAnomaly_GroupState_t *s = &state[g];
+    if (s->model->mean != NULL) {
+      continue;
+    }
+    nnAnomaly_vector(config.group[g].channel_mask, features, x);
+    for (uint16_t i = 0; i < s->inputs; i++) {
+      const float32_t d = x[i] - s->learn_mean[i];
+      s->learn_mean[i] += d / n;
+      s->learn_inv_std[i] += d * (x[i] - s->learn_mean[i]);
+    }
+  }
+  if (--learning != 0U) {
+    return;
+  }
+  for (uint8_t g = 0; g < config.group_count; g++) {
+    NnAnomaly_GroupState_t *s = &state[g];
+    if (s->model->mean != NULL) {
+      continue;
+    }
+    for (uint16_t i = 0; i < s->inputs; i++) {
+      float32_t sd = sqrtf(s->learn_inv_std[i] / (n - 1.0f));
+      const float32_t floor = NN_ANOMALY_STD_FLOOR * fabsf(s->learn_mean[i]);
+      if (sd < floor) {
+        sd = floor;
+      }
+      s->learn_inv_std[i] = (sd > 0.0f) ? 1.0f / sd : 0.0f;
+    }
+    nnAnomaly_useNormalisation(s);
+  }
+}
+
+/**
+ * @brief Score of one group on one window
+ */
+static float nnAnomaly_infer(const NnAnomaly_GroupState_t *s,
+                             const float32_t *x) {
+  const NnAnomaly_Model_t *m = s->model;
+  const float32_t in_scale = (float32_t)(1U << m->input_frac_bits);
+  for (uint16_t i = 0; i < s->inputs; i++) {
+    const float32_t q =
+        roundf((x[i] - s->mean[i]) * s->inv_std[i] * in_scale);
+    input[i] = (q7_t)((q > 127.0f) ? 127 : (q < -128.0f) ? -128 : q);
+  }
+
+  q7_t *cur = input;
+  for (uint8_t l = 0; l < m->layer_count; l++) {
+    const NnAnomaly_Layer_t *layer = &m->layer[l];
+    q7_t *next = act[l & 1U];
+    (void)arm_fully_connected_q7(cur, layer->weights, layer->inputs,
+                                 layer->outputs, layer->bias_shift,
+                                 layer->out_shift, layer->bias, next,
+                                 vec_buffer);
+    if (layer->relu) {
+      arm_relu_q7(next, layer->outputs);
+    }
+    cur = next;
+  }
+
+  if (s->active == 0U) {
+    return 0.0f;
+  }
+  const float32_t out_scale =
+      1.0f / (float32_t)(1U << ((m->layer_count != 0U) ? m->output_frac_bits
+                                                       : m->input_frac_bits));
+  if (m->layer_count != 0U && m->layer[m->layer_count - 1U].outputs == 1U) {
+    return (float)cur[0] * out_scale; // classifier
+  }
+  // Reconstruction error; the baseline reconstructs every input as 0
+  float32_t sum = 0.0f;
+  for (uint16_t i = 0; i < s->inputs; i++) {
+    if (s->inv_std[i] <= 0.0f) {
+      continue;
+    }
+    const float32_t z = (float32_t)input[i] / in_scale;
+    const float32_t y =
+        (m->layer_count != 0U) ? (float32_t)cur[i] * out_scale : 0.0f;
+    sum += (z - y) * (z - y);
+  }
+  return sum / (float32_t)s->active;
+}
+
+/* Public functions ----------------------------------------------------------*/
+
+HAL_StatusTypeDef nnAnomaly_init(const NnAnomaly_Config_t *cfg) {
+  ready = 0;
+  if (cfg == NULL || cfg->group_count == 0U ||
+      cfg->group_count > NN_ANOMALY_MAX_GROUPS || cfg->cadence == 0U ||
+      cfg->learn_windows < 2U) {
+    return HAL_ERROR;
+  }
+  uint8_t needs_learning = 0;
+  for (uint8_t g = 0; g < cfg->group_count; g++) {
+    const NnAnomaly_Group_t *group = &cfg->group[g];
+    const uint8_t channels = nnAnomaly_popcount(group->channel_mask);
+    if (channels == 0U || channels > NN_ANOMALY_GROUP_CHANNELS ||
+        (group->channel_mask >> ADC_CONVERSIONS_CHANNEL_COUNT) != 0U ||
+        group->threshold < 0.0f) {
+      return HAL_ERROR;
+    }
+    const uint16_t inputs =
+        (uint16_t)(channels * NN_ANOMALY_CHANNEL_INPUTS);
+    const NnAnomaly_Model_t *m = group->model;
+    if (m == NULL || m->magic != NN_ANOMALY_MAGIC) {
+      m = &baseline;
+    } else if (!nnAnomaly_checkModel(m, inputs)) {
+      return HAL_ERROR;
+    }
+    memset(&state[g], 0, sizeof(state[g]));
+    state[g].model = m;
+    state[g].inputs = inputs;
+    if (m->mean != NULL) {
+      nnAnomaly_useNormalisation(&state[g]);
+    } else {
+      needs_learning = 1;
+    }
+  }
+  config = *cfg;
+  memset(bands, 0, sizeof(bands));
+  have_result = 0;
+  result.sequence = 0;
+  ready = 1;
+  if (needs_learning) {
+    return nnAnomaly_learn(0);
+  }
+  learning = 0;
+  period_windows = 0;
+  period_cycles = 0;
+  period_learned = 0;
+  return HAL_OK;
+}
+
+void nnAnomaly_setBands(uint8_t channel, const float *band_rms,
+                        const float *band_kurtosis, uint8_t count) {
+  if (channel >= ADC_CONVERSIONS_CHANNEL_COUNT || band_rms == NULL ||
+      band_kurtosis == NULL) {
+    return;
+  }
+  for (uint8_t b = 0; b < NN_ANOMALY_BANDS; b++) {
+    bands[channel][b] = (b < count) ? band_rms[b] : 0.0f;
+    bands[channel][NN_ANOMALY_BANDS + b] =
+        (b < count) ? band_kurtosis[b] : 0.0f;
+  }
+}
+
+HAL_StatusTypeDef nnAnomaly_addWindow(
+    const TelemetryFrame_Features_t *features) {
+  if (features == NULL || !ready) {
+    return HAL_ERROR;
+  }
+  if (learning != 0U) {
+    nnAnomaly_learnWindow(features);
+    period_learned = 1;
+  } else {
+    float32_t x[NN_ANOMALY_MAX_INPUTS];
+    for (uint8_t g = 0; g < config.group_count; g++) {
+      NnAnomaly_GroupState_t *s = &state[g];
+      nnAnomaly_vector(config.group[g].channel_mask, features, x);
+      const uint32_t t0 = profiler_now();
+      const float score = nnAnomaly_infer(s, x);
+      const uint32_t cycles = profiler_now() - t0;
+#if PROFILER_ENABLE
+      profiler_record(PROFILER_PROBE_ANOMALY, cycles);
+#endif
+      if (cycles > period_cycles) {
+        period_cycles = cycles;
+      }
+      s->sum += score;
+      if (score > s->peak) {
+        s->peak = score;
+      }
+    }
+  }
+  if (++period_windows < config.cadence) {
+    return HAL_BUSY;
+  }
+
+  // A period with learning windows in it has no scores
+  const uint16_t scored = period_learned ? 0U : period_windows;
+  result.sequence++;
+  result.windows = scored;
+  result.learning = learning;
+  result.group_count = config.group_count;
+  result.alarm_mask = 0;
+  result.cycles_max = period_cycles;
+  for (uint8_t g = 0; g < config.group_count; g++) {
+    NnAnomaly_GroupState_t *s = &state[g];
+    result.channel_mask[g] = config.group[g].channel_mask;
+    result.score_mean[g] = (scored != 0U) ? s->sum / (float)scored : 0.0f;
+    result.score_peak[g] = (scored != 0U) ? s->peak : 0.0f;
+    if (config.group[g].threshold > 0.0f &&
+        result.score_peak[g] > config.group[g].threshold) {
+      result.alarm_mask |= (uint8_t)(1U << g);
+    }
+    s->sum = 0.0f;
+    s->peak = 0.0f;
+  }
+  period_windows = 0;
+  period_cycles = 0;
+  period_learned = 0;
+  have_result = 1;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef nnAnomaly_learn(uint16_t windows) {
+  if (!ready || windows == 1U) {
+    return HAL_ERROR;
+  }
+  learn_seen = 0;
+  for (uint8_t g = 0; g < config.group_count; g++) {
+    NnAnomaly_GroupState_t *s = &state[g];
+    if (s->model->mean != NULL) {
+      continue;
+    }
+    memset(s->learn_mean, 0, sizeof(s->learn_mean));
+    memset(s->learn_inv_std, 0, sizeof(s->learn_inv_std));
+    s->active = 0;
+    s->sum = 0.0f;
+    s->peak = 0.0f;
+  }
+  learning = (windows != 0U) ? windows : config.learn_windows;
+  period_windows = 0;
+  period_cycles = 0;
+  period_learned = 0;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef nnAnomaly_setCadence(uint16_t windows) {
+  if (!ready || windows == 0U) {
+    return HAL_ERROR;
+  }
+  config.cadence = windows;
+  return HAL_OK;
+}
+
+uint16_t nnAnomaly_getCadence(void) { return config.cadence; }
+
+HAL_StatusTypeDef nnAnomaly_getResult(NnAnomaly_Result_t *out) {
+  if (out == NULL || !have_result) {
+    return HAL_ERROR;
+  }
+  *out = result;
+  return HAL_OK;
+}
@@ -0,0 +1,229 @@
+/**
+ ******************************************************************************
+ * @file    pc_profile.c
+ * @brief   Implementation of the PC-sampling profiler
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "pc_profile.h"
+#include "adc_sections.h"
+#include "telemetry.h"
+#include <stdio.h>
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define PC_PROFILE_MASK (PC_PROFILE_SLOTS - 1U)
+#define PC_PROFILE_PROBES 8U        // slots tried before a sample is missed
+#define PC_PROFILE_TICK_HZ 1000000U // TIM7 counts microseconds
+#define PC_PROFILE_KEY_USED 0x1U    // bit 0 of a key: slot taken
+#define PC_PROFILE_KEY_LR 0x2U      // bit 1: stacked LR, not PC
+#define PC_PROFILE_DUMP_PAIRS 16U   // address:count pairs per PCS line
+#define EXC_RETURN_THREAD 0x8U      // EXC_RETURN bit 3: back to thread mode
+
+#if (PC_PROFILE_SLOTS & PC_PROFILE_MASK) != 0U || PC_PROFILE_SLOTS < 16U
+#error "PC_PROFILE_SLOTS must be a power of two of at least 16"
+#endif
+
+#if (PC_PROFILE_BIN_BYTES & (PC_PROFILE_BIN_BYTES - 1U)) != 0U ||             \
+    PC_PROFILE_BIN_BYTES < 4U
+#error "PC_PROFILE_BIN_BYTES must be a power of two of at least 4"
+#endif
+
+/* Private types -------------------------------------------------------------*/
+typedef struct {
+  uint32_t key; // bin address | PC_PROFILE_KEY_*, 0 = empty
+  uint32_t count;
+} PcProfile_Slot_t;
+
+typedef enum {
+  PC_PROFILE_DUMP_IDLE = 0,
+  PC_PROFILE_DUMP_BEGIN,
+  PC_PROFILE_DUMP_BINS,
+  PC_PROFILE_DUMP_END
+} PcProfile_DumpStage_t;
+
+/* Private variables ---------------------------------------------------------*/
+
+/* In DTCM: the sampler's writes do not evict the profiled code's lines */
+static PcProfile_Slot_t slots[PC_PROFILE_SLOTS] ADC_FAST_BSS;
+static volatile PcProfile_Stats_t stats;
+static uint16_t period_ticks = 0;
+static uint16_t jitter_ticks = 0;
+static uint32_t lfsr = 0xACE1ACE1U;
+
+static PcProfile_DumpStage_t dump_stage = PC_PROFILE_DUMP_IDLE;
+static uint32_t dump_next = 0;
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+ * @brief Input clock of TIM7 (APB1 timers run at 2x PCLK1 when APB1 is divided)
+ */
+static uint32_t pcProfile_clockHz(void) {
+  uint32_t clk = HAL_RCC_GetPCLK1Freq();
+  if ((RCC->CFGR & RCC_CFGR_PPRE1) != RCC_HCLK_DIV1) {
+    clk *= 2U;
+  }
+  return clk;
+}
+
+/**
+ * @brief Count one address
+ */
+static inline void pcProfile_count(uint32_t addr, uint32_t tag) {
+  const uint32_t key =
+      (addr & ~(PC_PROFILE_BIN_BYTES - 1U)) | PC_PROFILE_KEY_USED | tag;
+  uint32_t i = (key * 2654435761U) >> 16;
+
+  for (uint32_t n = 0; n < PC_PROFILE_PROBES; n++, i++) {
+    PcProfile_Slot_t *slot = &slots[i & PC_PROFILE_MASK];
+    if (slot->key == key) {
+      slot->count++;
+      return;
+    }
+    if (slot->key == 0U) {
+      slot->key = key;
+      slot->count = 1U;
+      stats.slots++;
+      return;
+    }
+  }
+  stats.missed++;
+}
+
+/* Public functions ----------------------------------------------------------*/
+
+HAL_StatusTypeDef pcProfile_start(uint32_t rate_hz, uint8_t flags) {
+#if !PC_PROFILE_ENABLE
+  UNUSED(rate_hz);
+  UNUSED(flags);
+  return HAL_ERROR;
+#else
+  if (rate_hz < PC_PROFILE_MIN_HZ || rate_hz > PC_PROFILE_MAX_HZ) {
+    return HAL_ERROR;
+  }
+  pcProfile_stop();
+  memset(slots, 0, sizeof(slots));
+  stats.flags = flags & PC_PROFILE_LR;
+  stats.rate_hz = rate_hz;
+  stats.samples = 0;
+  stats.handler = 0;
+  stats.missed = 0;
+  stats.slots = 0;
+  period_ticks = (uint16_t)(PC_PROFILE_TICK_HZ / rate_hz);
+  jitter_ticks = (uint16_t)(period_ticks * PC_PROFILE_JITTER_PCT / 100U);
+
+  __HAL_RCC_TIM7_CLK_ENABLE();
+  TIM7->CR1 = 0;
+  TIM7->PSC = pcProfile_clockHz() / PC_PROFILE_TICK_HZ - 1U;
+  TIM7->ARR = period_ticks - 1U;
+  TIM7->EGR = TIM_EGR_UG; // load PSC now
+  TIM7->SR = 0;
+  TIM7->DIER = TIM_DIER_UIE;
+  HAL_NVIC_SetPriority(TIM7_IRQn, PC_PROFILE_IRQ_PRIORITY, 0);
+  HAL_NVIC_ClearPendingIRQ(TIM7_IRQn);
+  HAL_NVIC_EnableIRQ(TIM7_IRQn);
+  stats.running = 1;
+  TIM7->CR1 = TIM_CR1_CEN;
+  return HAL_OK;
+#endif
+}
+
+void pcProfile_stop(void) {
+#if PC_PROFILE_ENABLE
+  if (!stats.running) {
+    return;
+  }
+  TIM7->CR1 = 0;
+  TIM7->DIER = 0;
+  HAL_NVIC_DisableIRQ(TIM7_IRQn);
+  TIM7->SR = 0;
+  stats.running = 0;
+#endif
+}
+
+ADC_FAST_CODE void pcProfile_sample(const uint32_t *frame,
+                                    uint32_t exc_return) {
+  TIM7->SR = ~TIM_SR_UIF;
+
+  // Next period, jittered around the nominal one
+  if (jitter_ticks != 0U) {
+    lfsr ^= lfsr << 13;
+    lfsr ^= lfsr >> 17;
+    lfsr ^= lfsr << 5;
+    TIM7->ARR = period_ticks - jitter_ticks / 2U + lfsr % jitter_ticks - 1U;
+  }
+
+  stats.samples++;
+  if ((exc_return & EXC_RETURN_THREAD) == 0U) {
+    stats.handler++;
+  }
+  pcProfile_count(frame[6], 0U);
+  if (stats.flags & PC_PROFILE_LR) {
+    pcProfile_count(frame[5], PC_PROFILE_KEY_LR);
+  }
+}
+
+HAL_StatusTypeDef pcProfile_getStats(PcProfile_Stats_t *out) {
+  if (out == NULL) {
+    return HAL_ERROR;
+  }
+  *out = stats;
+  return HAL_OK;
+}
+
+void pcProfile_dump(void) {
+  dump_stage = PC_PROFILE_DUMP_BEGIN;
+  dump_next = 0;
+}
+
+void pcProfile_poll(void) {
+  char line[PC_PROFILE_DUMP_PAIRS * 24U + 8U];
+  int len = 0;
+
+  while (dump_stage != PC_PROFILE_DUMP_IDLE && telemetry_getFreeSlots() > 0U) {
+    if (dump_stage == PC_PROFILE_DUMP_BEGIN) {
+      len = snprintf(line, sizeof(line),
+                     "PCS begin hz=%lu bin=%u samples=%lu handler=%lu "
+                     "missed=%lu lr=%u\r\n",
+                     (unsigned long)stats.rate_hz, PC_PROFILE_BIN_BYTES,
+                     (unsigned long)stats.samples,
+                     (unsigned long)stats.handler,
+                     (unsigned long)stats.missed,
+                     (stats.flags & PC_PROFILE_LR) ? 1U : 0U);
+      dump_stage = PC_PROFILE_DUMP_BINS;
+    } else if (dump_stage == PC_PROFILE_DUMP_BINS) {
+      uint32_t pairs = 0;
+      len = snprintf(line, sizeof(line), "PCS");
+      while (dump_next < PC_PROFILE_SLOTS && pairs < PC_PROFILE_DUMP_PAIRS) {
+        const PcProfile_Slot_t slot = slots[dump_next++];
+        if (slot.key == 0U) {
+          continue;
+        }
+        len += snprintf(&line[len], sizeof(line) - (size_t)len,
+                        " %s%08lx:%lu",
+                        (slot.key & PC_PROFILE_KEY_LR) ? "L" : "",
+                        (unsigned long)(slot.key & ~(PC_PROFILE_BIN_BYTES -
+                                                     1U)),
+                        (unsigned long)slot.count);
+        pairs++;
+      }
+      if (dump_next >= PC_PROFILE_SLOTS) {
+        dump_stage = PC_PROFILE_DUMP_END;
+      }
+      if (pairs == 0U) {
+        continue;
+      }
+      len += snprintf(&line[len], sizeof(line) - (size_t)len, "\r\n");
+    } else {
+      len = snprintf(line, sizeof(line), "PCS end slots=%lu\r\n",
+                     (unsigned long)stats.slots);
+      dump_stage = PC_PROFILE_DUMP_IDLE;
+    }
+    if (len > 0) {
+      telemetry_send((const uint8_t *)line, (uint16_t)strlen(line));
+    }
+  }
+}
@@ -0,0 +1,508 @@
+/**
+ ******************************************************************************
+ * @file    pipeline.c
+ * @brief   Implementation of the block processing pipeline and its stages
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "pipeline.h"
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define PIPELINE_CHANNEL_BITS ADC_CHANNELS_MASK_ALL
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+ * @brief Round a filtered sample back to a 12-bit code
+ */
+static inline uint16_t pipeline_toCode(float32_t v) {
+  v += 0.5f;
+  return (v <= 0.0f) ? 0U : (v >= 4095.0f) ? 4095U : (uint16_t)v;
+}
+
+/* Public functions ----------------------------------------------------------*/
+
+HAL_StatusTypeDef pipeline_init(Pipeline_t *pl,
+                                const Pipeline_Branch_t *branches,
+                                uint8_t branch_count,
+                                const uint8_t *channel_map) {
+  if (pl == NULL || branches == NULL || branch_count == 0U ||
+      branch_count > PIPELINE_MAX_BRANCHES) {
+    return HAL_ERROR;
+  }
+  for (uint8_t b = 0; b < branch_count; b++) {
+    const Pipeline_Branch_t *br = &branches[b];
+    if (br->channel_mask == 0U ||
+        (br->channel_mask & (ADC_ChannelMask_t)~PIPELINE_CHANNEL_BITS) != 0U ||
+        br->stages == NULL || br->stage_count == 0U ||
+        br->stage_count > PIPELINE_MAX_STAGES) {
+      return HAL_ERROR;
+    }
+    for (uint8_t s = 0; s < br->stage_count; s++) {
+      if (br->stages[s].run == NULL ||
+          (br->stages[s].run == pipelineDecimate_run &&
+           br->stages[s].state == NULL)) {
+        return HAL_ERROR;
+      }
+    }
+  }
+
+  memset(pl, 0, sizeof(*pl));
+  pl->branches = branches;
+  pl->branch_count = branch_count;
+  // frames_in starts again: so do the decimate() groups
+  for (uint8_t b = 0; b < branch_count; b++) {
+    for (uint8_t s = 0; s < branches[b].stage_count; s++) {
+      if (branches[b].stages[s].run == pipelineDecimate_run) {
+        Pipeline_Decimate_t *dec = branches[b].stages[s].state;
+        memset(dec->phase, 0, sizeof(dec->phase));
+      }
+    }
+  }
+  for (uint8_t s = 0; s < ADC_CONVERSIONS_CHANNEL_COUNT; s++) {
+    uint8_t ch = (channel_map != NULL) ? channel_map[s] : s;
+    if (ch < ADC_CONVERSIONS_CHANNEL_COUNT) {
+      pl->channel_slot[ch] = s;
+    }
+  }
+  return HAL_OK;
+}
+
+void pipeline_run(Pipeline_t *pl, const uint16_t *block, uint32_t frames) {
+  if (pl == NULL || block == NULL || frames == 0U ||
+      frames > ADC_CONVERSIONS_BLOCK_FRAMES) {
+    return;
+  }
+
+  for (uint8_t b = 0; b < pl->branch_count; b++) {
+    const Pipeline_Branch_t *br = &pl->branches[b];
+    for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+      if ((br->channel_mask & (1UL << ch)) == 0U) {
+        continue;
+      }
+
+      // One strided read of the block; the chain then stays in work[]
+      const uint16_t *src = &block[pl->channel_slot[ch]];
+      for (uint32_t f = 0; f < frames; f++) {
+        pl->work[f] = (float32_t)*src;
+        src += ADC_CONVERSIONS_CHANNEL_COUNT;
+      }
+      Pipeline_Segment_t seg = {.x = pl->work,
+                                .count = frames,
+                                .first = pl->frames_in,
+                                .stride = 1U,
+                                .channel = ch};
+      for (uint8_t s = 0; s < br->stage_count && seg.count != 0U; s++) {
+        br->stages[s].run(br->stages[s].state, &seg);
+      }
+    }
+    for (uint8_t s = 0; s < br->stage_count; s++) {
+      if (br->stages[s].end != NULL) {
+        br->stages[s].end(br->stages[s].state);
+      }
+    }
+  }
+  pl->frames_in += frames;
+}
+
+void pipeline_blockCallback(const uint16_t *block, uint32_t frame_count,
+                            void *ctx) {
+  pipeline_run((Pipeline_t *)ctx, block, frame_count);
+}
+
+void pipeline_poll(Pipeline_t *pl) {
+  if (pl == NULL) {
+    return;
+  }
+  for (uint8_t b = 0; b < pl->branch_count; b++) {
+    const Pipeline_Branch_t *br = &pl->branches[b];
+    for (uint8_t s = 0; s < br->stage_count; s++) {
+      if (br->stages[s].poll != NULL) {
+        br->stages[s].poll(br->stages[s].state);
+      }
+    }
+  }
+}
+
+/* decimate() ----------------------------------------------------------------*/
+
+void pipelineDecimate_run(void *state, Pipeline_Segment_t *seg) {
+  Pipeline_Decimate_t *st = state;
+  const uint32_t factor = st->factor;
+  if (factor <= 1U) {
+    return;
+  }
+
+  // Keep the last sample of each group, as dspFilter does. A group may have
+  // started in the last block: its samples there are the channel's phase,
+  // and the segment starts that many of them earlier
+  const uint32_t phase = st->phase[seg->channel];
+  const uint32_t count = (phase + seg->count) / factor;
+  for (uint32_t k = 0; k < count; k++) {
+    seg->x[k] = seg->x[(k + 1U) * factor - 1U - phase];
+  }
+  st->phase[seg->channel] = (uint16_t)(phase + seg->count - count * factor);
+  seg->first -= phase * seg->stride;
+  seg->count = count;
+  seg->stride *= factor;
+}
+
+/* biquad() ------------------------------------------------------------------*/
+
+HAL_StatusTypeDef pipelineBiquad_init(Pipeline_Biquad_t *st,
+                                      const DSP_FilterDesign_t *design) {
+  if (st == NULL || design == NULL || design->coeffs == NULL ||
+      design->num_stages == 0U ||
+      design->num_stages > DSP_FILTER_MAX_STAGES) {
+    return HAL_ERROR;
+  }
+  for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+    // Init also clears the delay line
+    arm_biquad_cascade_df2T_init_f32(&st->biquad[ch], design->num_stages,
+                                     (float32_t *)design->coeffs,
+                                     st->state[ch]);
+  }
+  return HAL_OK;
+}
+
+void pipelineBiquad_run(void *state, Pipeline_Segment_t *seg) {
+  Pipeline_Biquad_t *st = state;
+  // df2T reads each input before writing its output: in place is safe
+  arm_biquad_cascade_df2T_f32(&st->biquad[seg->channel], seg->x, seg->x,
+                              seg->count);
+}
+
+/* rectify() -----------------------------------------------------------------*/
+
+void pipelineRectify_run(void *state, Pipeline_Segment_t *seg) {
+  (void)state;
+  for (uint32_t k = 0; k < seg->count; k++) {
+    const float32_t v = seg->x[k];
+    seg->x[k] = ((v < 0.0f) ? -v : v) * (0.5f * PI);
+  }
+}
+
+/* autozero() ----------------------------------------------------------------*/
+
+void pipelineAutozero_run(void *state, Pipeline_Segment_t *seg) {
+  const DSP_DcTrack_t *dc = state;
+  if (dc->blocks == 0U) {
+    return; // nothing tracked yet
+  }
+  arm_offset_f32(seg->x,
+                 (float32_t)DSP_DCTRACK_MID_CODE -
+                     dspDcTrack_getBias(dc, seg->channel),
+                 seg->x, seg->count);
+}
+
+/* dcblock() -----------------------------------------------------------------*/
+
+void pipelineDcBlock_run(void *state, Pipeline_Segment_t *seg) {
+  // One context runs the pipelines, so one scratch serves every branch
+  static q15_t q[ADC_CONVERSIONS_BLOCK_FRAMES];
+  for (uint32_t k = 0; k < seg->count; k++) {
+    float32_t v = (seg->x[k] - DSP_DCBLOCK_MID_CODE) * DSP_DCBLOCK_Q15_PER_CODE;
+    v += (v >= 0.0f) ? 0.5f : -0.5f;
+    q[k] = (v >= 32767.0f)    ? INT16_MAX
+           : (v <= -32768.0f) ? INT16_MIN
+                              : (q15_t)v;
+  }
+  dspDcBlock_runQ15(state, seg->channel, q, q, seg->count);
+  for (uint32_t k = 0; k < seg->count; k++) {
+    seg->x[k] = (float32_t)q[k] / DSP_DCBLOCK_Q15_PER_CODE +
+                DSP_DCBLOCK_MID_CODE;
+  }
+}
+
+/* stats() -------------------------------------------------------------------*/
+
+void pipelineStats_reset(Pipeline_Stats_t *st) {
+  if (st == NULL) {
+    return;
+  }
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  dspStats_reset(st->acc);
+  __set_PRIMASK(primask);
+}
+
+HAL_StatusTypeDef pipelineStats_read(Pipeline_Stats_t *st, uint8_t channel,
+                                     ADC_ChannelStats_t *out, uint8_t reset) {
+  if (st == NULL || out == NULL || channel >= ADC_CONVERSIONS_CHANNEL_COUNT) {
+    return HAL_ERROR;
+  }
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  DSP_StatsAccum_t acc = st->acc[channel];
+  if (reset) {
+    st->acc[channel] = (DSP_StatsAccum_t){.min = 0xFFFFU};
+  }
+  __set_PRIMASK(primask);
+
+  dspStats_compute(&acc, out);
+  return HAL_OK;
+}
+
+void pipelineStats_run(void *state, Pipeline_Segment_t *seg) {
+  Pipeline_Stats_t *st = state;
+  DSP_StatsAccum_t *acc = &st->acc[seg->channel];
+  uint32_t sum = 0; // one block of 12-bit codes
+  uint64_t sum_sq = 0;
+  int64_t sum_cube = 0;
+  uint64_t sum_quad = 0;
+  uint16_t min = acc->min;
+  uint16_t max = acc->max;
+
+  for (uint32_t k = 0; k < seg->count; k++) {
+    uint16_t code = pipeline_toCode(seg->x[k]);
+    const int32_t d = (int32_t)code - (int32_t)DSP_STATS_MOMENT_REF;
+    const int32_t d2 = d * d;
+    sum += code;
+    sum_sq += (uint32_t)code * code;
+    sum_cube += (int64_t)d2 * d;
+    sum_quad += (uint64_t)(uint32_t)d2 * (uint32_t)d2;
+    min = (code < min) ? code : min;
+    max = (code > max) ? code : max;
+  }
+  acc->count += seg->count;
+  acc->sum += sum;
+  acc->sum_sq += sum_sq;
+  acc->sum_cube += (double)sum_cube;
+  acc->sum_quad += (double)sum_quad;
+  acc->min = min;
+  acc->max = max;
+}
+
+/* frame() + sink ------------------------------------------------------------*/
+
+HAL_StatusTypeDef pipelineFrame_init(Pipeline_Frame_t *st,
+                                     ADC_ChannelMask_t channel_mask) {
+  if (st == NULL || st->sink == NULL ||
+      telemetryFrame_initBatch(&st->batch, channel_mask) != HAL_OK) {
+    return HAL_ERROR;
+  }
+  st->channel_mask = channel_mask;
+  st->frame_count[0] = 0;
+  st->frame_count[1] = 0;
+  st->blocks_done = 0;
+  st->blocks_read = 0;
+  st->overruns = 0;
+  st->sink_errors = 0;
+  return HAL_OK;
+}
+
+void pipelineFrame_run(void *state, Pipeline_Segment_t *seg) {
+  Pipeline_Frame_t *st = state;
+  ADC_RingEntry_t *frames = st->frames[st->blocks_done & 1U];
+
+  for (uint32_t k = 0; k < seg->count; k++) {
+    frames[k].sequence = seg->first + (k + 1U) * seg->stride - 1U;
+    frames[k].frame.samples[seg->channel] = pipeline_toCode(seg->x[k]);
+    frames[k].frame.error_mask = 0;
+  }
+  st->frame_count[st->blocks_done & 1U] = seg->count;
+}
+
+void pipelineFrame_end(void *state) {
+  Pipeline_Frame_t *st = state;
+  const uint32_t idx = st->blocks_done & 1U;
+  const uint32_t now = HAL_GetTick();
+
+  for (uint32_t k = 0; k < st->frame_count[idx]; k++) {
+    st->frames[idx][k].timestamp = now;
+  }
+  __DMB();
+  st->blocks_done++;
+}
+
+void pipelineFrame_poll(void *state) {
+  Pipeline_Frame_t *st = state;
+  const uint32_t done = st->blocks_done;
+  if (done == st->blocks_read) {
+    return;
+  }
+  __DMB();
+  if (done - st->blocks_read > 1U) {
+    st->overruns += done - st->blocks_read - 1U;
+  }
+  st->blocks_read = done;
+
+  // Newest block only; valid for one input block period, as dspFilter
+  const uint32_t idx = (done - 1U) & 1U;
+  for (uint32_t k = 0; k < st->frame_count[idx]; k++) {
+    telemetryFrame_addFrame(&st->batch, &st->frames[idx][k]);
+    if (!telemetryFrame_isFull(&st->batch)) {
+      continue;
+    }
+    uint16_t len = 0;
+    if (telemetryFrame_encodeSamples(&st->batch, st->packet,
+                                     sizeof(st->packet), &len) != HAL_OK ||
+        st->sink(st->packet, len) != HAL_OK) {
+      st->sink_errors++;
+    }
+    telemetryFrame_initBatch(&st->batch, st->channel_mask);
+  }
+}
+
+/* display() + sink ----------------------------------------------------------*/
+
+/**
+ * @brief Encode the batch, hand it to the sink and start an empty one
+ */
+static void pipelineDisplay_send(Pipeline_Display_t *st) {
+  uint16_t len = 0;
+  if (telemetryFrame_encodeDisplay(&st->batch, st->packet, sizeof(st->packet),
+                                   &len) != HAL_OK ||
+      st->sink(st->packet, len) != HAL_OK) {
+    st->sink_errors++;
+  }
+  st->batch.bucket_count = 0;
+}
+
+HAL_StatusTypeDef pipelineDisplay_init(Pipeline_Display_t *st,
+                                       ADC_ChannelMask_t channel_mask,
+                                       uint16_t bucket) {
+  uint32_t k = 0;
+  for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+    k += (channel_mask >> ch) & 1U;
+  }
+  if (st == NULL || st->sink == NULL || bucket == 0U || k == 0U ||
+      k > TELEMETRY_FRAME_DISPLAY_PAIRS ||
+      (channel_mask & (ADC_ChannelMask_t)~PIPELINE_CHANNEL_BITS) != 0U) {
+    return HAL_ERROR;
+  }
+  HAL_StatusTypeDef (*sink)(const uint8_t *, uint16_t) = st->sink;
+  memset(st, 0, sizeof(*st));
+  st->sink = sink;
+  st->bucket = bucket;
+  st->channel_mask = channel_mask;
+  st->stride = 1U;
+  st->batch.channel_mask = channel_mask;
+  return HAL_OK;
+}
+
+void pipelineDisplay_run(void *state, Pipeline_Segment_t *seg) {
+  Pipeline_Display_t *st = state;
+  const uint8_t ch = seg->channel;
+  float32_t lo = st->lo[ch];
+  float32_t hi = st->hi[ch];
+  uint32_t filled = st->filled[ch];
+  uint32_t closed = 0;
+
+  for (uint32_t k = 0; k < seg->count; k++) {
+    const float32_t v = seg->x[k];
+    if (filled == 0U) {
+      lo = v;
+      hi = v;
+      st->start[ch] = seg->first + k * seg->stride;
+    } else {
+      lo = (v < lo) ? v : lo;
+      hi = (v > hi) ? v : hi;
+    }
+    if (++filled == st->bucket) {
+      Pipeline_DisplayBucket_t *b =
+          &st->ring[(st->head + closed++) % PIPELINE_DISPLAY_BUCKETS];
+      b->first_frame = st->start[ch];
+      b->min[ch] = pipeline_toCode(lo);
+      b->max[ch] = pipeline_toCode(hi);
+      filled = 0;
+    }
+  }
+  st->lo[ch] = lo;
+  st->hi[ch] = hi;
+  st->filled[ch] = (uint16_t)filled;
+  st->stride = seg->stride;
+  st->closed = closed; // the same for every channel of the branch
+}
+
+void pipelineDisplay_end(void *state) {
+  Pipeline_Display_t *st = state;
+  const uint32_t now = HAL_GetTick();
+
+  for (uint32_t j = 0; j < st->closed; j++) {
+    st->ring[(st->head + j) % PIPELINE_DISPLAY_BUCKETS].timestamp = now;
+  }
+  __DMB();
+  st->head += st->closed;
+  st->closed = 0;
+}
+
+void pipelineDisplay_poll(void *state) {
+  Pipeline_Display_t *st = state;
+  const uint32_t head = st->head;
+  __DMB();
+  if (head - st->tail > PIPELINE_DISPLAY_BUCKETS) {
+    st->overruns += head - st->tail - PIPELINE_DISPLAY_BUCKETS;
+    st->tail = head - PIPELINE_DISPLAY_BUCKETS;
+  }
+
+  TelemetryFrame_Display_t *batch = &st->batch;
+  uint32_t k = 0;
+  for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+    k += (st->channel_mask >> ch) & 1U;
+  }
+  for (; st->tail != head; st->tail++) {
+    const Pipeline_DisplayBucket_t *b =
+        &st->ring[st->tail % PIPELINE_DISPLAY_BUCKETS];
+    if (batch->bucket_count == 0U) {
+      batch->first_frame = b->first_frame;
+      batch->timestamp = b->timestamp;
+      batch->bucket_frames = (uint16_t)(st->bucket * st->stride);
+    }
+    uint32_t i = batch->bucket_count * k;
+    for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+      if ((st->channel_mask >> ch) & 1U) {
+        batch->min[i] = b->min[ch];
+        batch->max[i++] = b->max[ch];
+      }
+    }
+    if (++batch->bucket_count * k + k > TELEMETRY_FRAME_DISPLAY_PAIRS) {
+      pipelineDisplay_send(st);
+    }
+  }
+  if (batch->bucket_count != 0U &&
+      HAL_GetTick() - batch->timestamp >= PIPELINE_DISPLAY_FLUSH_MS) {
+    pipelineDisplay_send(st);
+  }
+}
+
+/* FFT -----------------------------------------------------------------------*/
+
+void pipelineSpectrum_run(void *state, Pipeline_Segment_t *seg) {
+  Pipeline_Spectrum_t *st = state;
+  dspSpectrum_pushSamples(st->channel[seg->channel], seg->x, seg->count);
+}
+
+void pipelineSpectrum_poll(void *state) {
+  Pipeline_Spectrum_t *st = state;
+  for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+    dspSpectrum_poll(st->channel[ch]);
+  }
+}
+
+void pipelineSpectrumQ15_run(void *state, Pipeline_Segment_t *seg) {
+  Pipeline_SpectrumQ15_t *st = state;
+  dspSpectrumQ15_pushSamples(st->channel[seg->channel], seg->x, seg->count);
+}
+
+void pipelineSpectrumQ15_poll(void *state) {
+  Pipeline_SpectrumQ15_t *st = state;
+  for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+    dspSpectrumQ15_poll(st->channel[ch]);
+  }
+}
+
+void pipelineZoom_run(void *state, Pipeline_Segment_t *seg) {
+  Pipeline_Zoom_t *st = state;
+  dspZoom_pushSamples(st->channel[seg->channel], seg->x, seg->count);
+}
+
+void pipelineZoom_poll(void *state) {
+  Pipeline_Zoom_t *st = state;
+  for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+    dspZoom_poll(st->channel[ch]);
+  }
+}
@@ -0,0 +1,535 @@
+/**
+ ******************************************************************************
+ * @file    ptp_sync.c
+ * @brief   Implementation of the PTPv2 slave and the MAC clock servo
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "ptp_sync.h"
+#include "time_sync.h"
+#include "timebase.h"
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define PTP_SYNC_MSG_SYNC 0x0U
+#define PTP_SYNC_MSG_DELAY_REQ 0x1U
+#define PTP_SYNC_MSG_FOLLOW_UP 0x8U
+#define PTP_SYNC_MSG_DELAY_RESP 0x9U
+#define PTP_SYNC_MSG_ANNOUNCE 0xBU
+
+#define PTP_SYNC_VERSION 2U
+#define PTP_SYNC_HEADER_SIZE 34U
+#define PTP_SYNC_BODY_SIZE 44U   // header + one timestamp
+#define PTP_SYNC_RESP_SIZE 54U   // + requesting port identity
+#define PTP_SYNC_PORT_ID_SIZE 10U // clock identity + port number
+#define PTP_SYNC_FLAG_TWO_STEP 0x02U
+#define PTP_SYNC_CONTROL_DELAY_REQ 0x01U
+#define PTP_SYNC_LOG_INTERVAL_NONE 0x7FU
+
+#define PTP_SYNC_NS_PER_S 1000000000LL
+#define PTP_SYNC_PULSE_NS (PTP_SYNC_NS_PER_S / TIME_SYNC_PULSE_HZ)
+#define PTP_SYNC_ARM_MARGIN_NS 1000000LL // never arm a target this close
+#define PTP_SYNC_MAX_INTERVAL_NS (16LL * PTP_SYNC_NS_PER_S)
+#define PTP_SYNC_WAIT_MS 10U
+
+/* Servo gains as divisors, per Sync: P = 1/2, I = 1/8; delay filter 1/8 */
+#define PTP_SYNC_KP_DIV 2
+#define PTP_SYNC_KI_DIV 8
+#define PTP_SYNC_DELAY_DIV 8
+
+_Static_assert(PTP_SYNC_NS_PER_S % PTP_SYNC_CLOCK_HZ == 0,
+               "PTP_SYNC_CLOCK_HZ: whole nanoseconds per step");
+_Static_assert(PTP_SYNC_NS_PER_S % TIMEBASE_TICK_HZ == 0,
+               "TIMEBASE_TICK_HZ: whole nanoseconds per tick");
+
+/* Private variables ---------------------------------------------------------*/
+static uint8_t started = 0;
+static uint8_t port_id[PTP_SYNC_PORT_ID_SIZE]; // ours: EUI-64 + port 1
+static uint32_t base_addend = 0;
+static int64_t drift_ppb = 0;
+static uint32_t lock_count = 0;
+static int64_t trigger_ns = 0; // target time armed, 0 = none
+
+/* Master followed */
+static uint8_t have_master = 0;
+static uint8_t master_port[PTP_SYNC_PORT_ID_SIZE];
+static uint32_t last_sync_ms = 0;
+
+/* Sync: t2 waiting for its Follow_Up, and the newest t2 - t1 */
+static uint8_t sync_waiting = 0;
+static uint16_t sync_seq = 0;
+static int64_t sync_t2 = 0;
+static int64_t sync_corr = 0;
+static int64_t last_t1 = 0;
+static uint8_t have_t1 = 0;
+static int64_t master_to_slave = 0;
+static uint8_t have_m2s = 0;
+
+/* Delay_Req: built by the main loop, sent and stamped by the block callback */
+static uint8_t delay_req[PTP_SYNC_BODY_SIZE];
+static uint16_t delay_seq = 0;
+static uint32_t delay_req_ms = 0;
+static uint8_t delay_in_flight = 0;
+static volatile uint8_t delay_due = 0;
+static volatile uint8_t t3_valid = 0;
+static int64_t t3 = 0;
+static uint8_t t4_valid = 0;
+static int64_t t4 = 0;
+static int64_t path_delay = 0;
+static uint8_t have_delay = 0;
+
+static PtpSync_Status_t status = {.state = PTP_SYNC_DISABLED};
+
+/* Private functions ---------------------------------------------------------*/
+
+static uint16_t ptpSync_getBe16(const uint8_t *p) {
+  return (uint16_t)(((uint16_t)p[0] << 8) | p[1]);
+}
+
+static uint64_t ptpSync_getBe(const uint8_t *p, uint32_t bytes) {
+  uint64_t v = 0;
+  for (uint32_t i = 0; i < bytes; i++) {
+    v = (v << 8) | p[i];
+  }
+  return v;
+}
+
+static void ptpSync_putBe16(uint8_t *p, uint16_t v) {
+  p[0] = (uint8_t)(v >> 8);
+  p[1] = (uint8_t)v;
+}
+
+/**
+ * @brief 48-bit seconds + 32-bit nanoseconds, as nanoseconds
+ */
+static int64_t ptpSync_getTimestamp(const uint8_t *p) {
+  return (int64_t)ptpSync_getBe(p, 6) * PTP_SYNC_NS_PER_S +
+         (int64_t)ptpSync_getBe(&p[6], 4);
+}
+
+/**
+ * @brief correctionField: nanoseconds scaled by 2^16
+ */
+static int64_t ptpSync_getCorrection(const uint8_t *msg) {
+  return (int64_t)ptpSync_getBe(&msg[8], 8) / 65536;
+}
+
+static int64_t ptpSync_stampNs(const ETH_TimeStampTypeDef *stamp) {
+  // Digital rollover: the low word counts nanoseconds
+  return (int64_t)stamp->TimeStampHigh * PTP_SYNC_NS_PER_S +
+         (int64_t)(stamp->TimeStampLow & ETH_PTPTSLR_STSS);
+}
+
+static int32_t ptpSync_saturate(int64_t v) {
+  return (v > INT32_MAX) ? INT32_MAX : (v < INT32_MIN) ? INT32_MIN : (int32_t)v;
+}
+
+static HAL_StatusTypeDef ptpSync_waitClear(uint32_t bit) {
+  uint32_t start = HAL_GetTick();
+  while (ETH->PTPTSCR & bit) {
+    if (HAL_GetTick() - start > PTP_SYNC_WAIT_MS) {
+      return HAL_ERROR;
+    }
+  }
+  return HAL_OK;
+}
+
+/**
+ * @brief Run the MAC clock ppb slower than nominal (negative: faster)
+ */
+static void ptpSync_setRate(int64_t ppb) {
+  if (ETH->PTPTSCR & ETH_PTPTSCR_TSARU) {
+    return; // previous update still being taken; the next Sync retries
+  }
+  ETH->PTPTSAR = (uint32_t)((int64_t)base_addend -
+                            (int64_t)base_addend * ppb / PTP_SYNC_NS_PER_S);
+  ETH->PTPTSCR |= ETH_PTPTSCR_TSARU;
+  status.freq_ppb = (int32_t)-ppb;
+}
+
+/**
+ * @brief Take offset_ns off the MAC clock at once
+ */
+static void ptpSync_step(int64_t offset_ns) {
+  const uint64_t magnitude =
+      (uint64_t)((offset_ns < 0) ? -offset_ns : offset_ns);
+  if (ptpSync_waitClear(ETH_PTPTSCR_TSSTU | ETH_PTPTSCR_TSSTI) != HAL_OK) {
+    return;
+  }
+  ETH->PTPTSHUR = (uint32_t)(magnitude / PTP_SYNC_NS_PER_S);
+  ETH->PTPTSLUR = (uint32_t)(magnitude % PTP_SYNC_NS_PER_S) |
+                  ((offset_ns > 0) ? ETH_PTPTSLUR_TSUPNS : 0U);
+  ETH->PTPTSCR |= ETH_PTPTSCR_TSSTU;
+  status.steps++;
+
+  // Everything measured against the old time is void
+  lock_count = 0;
+  have_m2s = 0;
+  sync_waiting = 0;
+  delay_in_flight = 0;
+  t4_valid = 0;
+  trigger_ns = 0;
+}
+
+static void ptpSync_follow(const uint8_t *source) {
+  memcpy(master_port, source, PTP_SYNC_PORT_ID_SIZE);
+  have_master = 1;
+  have_t1 = 0;
+  have_m2s = 0;
+  have_delay = 0;
+  sync_waiting = 0;
+  delay_in_flight = 0;
+  lock_count = 0;
+  last_sync_ms = HAL_GetTick();
+  status.master_id = ptpSync_getBe(source, 8);
+  status.state = PTP_SYNC_UNCALIBRATED;
+}
+
+static uint8_t ptpSync_fromMaster(const uint8_t *msg) {
+  return (have_master &&
+          memcmp(&msg[20], master_port, PTP_SYNC_PORT_ID_SIZE) == 0)
+             ? 1U
+             : 0U;
+}
+
+/**
+ * @brief One t1/t2 pair: offset, then a step or a servo update
+ */
+static void ptpSync_sync(int64_t t1, int64_t t2, int64_t corr) {
+  status.syncs++;
+  last_sync_ms = HAL_GetTick();
+
+  int64_t interval = have_t1 ? t1 - last_t1 : PTP_SYNC_NS_PER_S;
+  if (interval <= 0 || interval > PTP_SYNC_MAX_INTERVAL_NS) {
+    interval = PTP_SYNC_NS_PER_S;
+  }
+  last_t1 = t1;
+  have_t1 = 1;
+
+  const int64_t m2s = t2 - t1 - corr;
+  const int64_t offset = m2s - (have_delay ? path_delay : 0);
+  status.offset_ns = ptpSync_saturate(offset);
+  master_to_slave = m2s;
+  have_m2s = 1;
+
+  const int64_t magnitude = (offset < 0) ? -offset : offset;
+  if (magnitude > (int64_t)PTP_SYNC_STEP_NS) {
+    ptpSync_step(offset);
+    status.state = PTP_SYNC_UNCALIBRATED;
+    return;
+  }
+
+  // PI on the offset, as a rate over one Sync interval
+  const int64_t ppb = offset * PTP_SYNC_NS_PER_S / interval;
+  drift_ppb += ppb / PTP_SYNC_KI_DIV;
+  if (drift_ppb > PTP_SYNC_MAX_PPB) {
+    drift_ppb = PTP_SYNC_MAX_PPB;
+  } else if (drift_ppb < -PTP_SYNC_MAX_PPB) {
+    drift_ppb = -PTP_SYNC_MAX_PPB;
+  }
+  int64_t rate = drift_ppb + ppb / PTP_SYNC_KP_DIV;
+  if (rate > PTP_SYNC_MAX_PPB) {
+    rate = PTP_SYNC_MAX_PPB;
+  } else if (rate < -PTP_SYNC_MAX_PPB) {
+    rate = -PTP_SYNC_MAX_PPB;
+  }
+  ptpSync_setRate(rate);
+
+  lock_count = (magnitude <= (int64_t)PTP_SYNC_LOCK_NS) ? lock_count + 1U : 0U;
+  status.state = (lock_count >= PTP_SYNC_LOCK_SYNCS) ? PTP_SYNC_SLAVE
+                                                     : PTP_SYNC_UNCALIBRATED;
+}
+
+/**
+ * @brief Path delay once both t3 (our stamp) and t4 (master's) are in
+ */
+static void ptpSync_completeDelay(void) {
+  if (!delay_in_flight || !t4_valid || !t3_valid || !have_m2s) {
+    return;
+  }
+  __DMB(); // t3 was written before its flag
+  const int64_t d = (master_to_slave + (t4 - t3)) / 2;
+  if (!have_delay) {
+    path_delay = d;
+    have_delay = 1;
+  } else {
+    path_delay += (d - path_delay) / PTP_SYNC_DELAY_DIV;
+  }
+  status.path_delay_ns = ptpSync_saturate(path_delay);
+  status.delay_resps++;
+  delay_in_flight = 0;
+  t4_valid = 0;
+}
+
+static void ptpSync_buildDelayReq(void) {
+  memset(delay_req, 0, sizeof(delay_req));
+  delay_req[0] = PTP_SYNC_MSG_DELAY_REQ;
+  delay_req[1] = PTP_SYNC_VERSION;
+  ptpSync_putBe16(&delay_req[2], PTP_SYNC_BODY_SIZE);
+  delay_req[4] = PTP_SYNC_DOMAIN;
+  memcpy(&delay_req[20], port_id, PTP_SYNC_PORT_ID_SIZE);
+  ptpSync_putBe16(&delay_req[30], ++delay_seq);
+  delay_req[32] = PTP_SYNC_CONTROL_DELAY_REQ;
+  delay_req[33] = PTP_SYNC_LOG_INTERVAL_NONE;
+  // originTimestamp stays 0: t3 is the MAC stamp, not this field
+}
+
+/**
+ * @brief Keep the target time on the next pulse boundary; its trigger
+ *        reaches TIM2 ITR1 (time_sync.h)
+ */
+static void ptpSync_armTrigger(void) {
+  const int64_t now = (int64_t)ptpSync_now();
+  if (trigger_ns != 0 && now < trigger_ns) {
+    return;
+  }
+  trigger_ns = (now / PTP_SYNC_PULSE_NS + 1) * PTP_SYNC_PULSE_NS;
+  if (trigger_ns - now < PTP_SYNC_ARM_MARGIN_NS) {
+    trigger_ns += PTP_SYNC_PULSE_NS;
+  }
+  ETH->PTPTTHR = (uint32_t)(trigger_ns / PTP_SYNC_NS_PER_S);
+  ETH->PTPTTLR = (uint32_t)(trigger_ns % PTP_SYNC_NS_PER_S);
+  ETH->PTPTSCR |= ETH_PTPTSCR_TSITE;
+}
+
+/* Public functions ----------------------------------------------------------*/
+
+HAL_StatusTypeDef ptpSync_start(const uint8_t mac[6]) {
+  const uint32_t hclk = HAL_RCC_GetHCLKFreq();
+  if (mac == NULL || hclk <= PTP_SYNC_CLOCK_HZ) {
+    return HAL_ERROR;
+  }
+  started = 0;
+
+  // EUI-64 clock identity from the MAC address, port 1
+  port_id[0] = mac[0];
+  port_id[1] = mac[1];
+  port_id[2] = mac[2];
+  port_id[3] = 0xFFU;
+  port_id[4] = 0xFEU;
+  port_id[5] = mac[3];
+  port_id[6] = mac[4];
+  port_id[7] = mac[5];
+  ptpSync_putBe16(&port_id[8], 1U);
+
+  // The trigger is used as a signal to TIM2, not as an interrupt
+  ETH->MACIMR |= ETH_MACIMR_TSTIM;
+
+  // Ordinary clock, slave: stamp PTPv2 event messages over IPv4/UDP;
+  // nanosecond (digital) rollover, fine update through the addend
+  ETH->PTPTSCR = ETH_PTPTSCR_TSE | ETH_PTPTSCR_TSSSR | ETH_PTPTSCR_TSPTPPSV2E |
+                 ETH_PTPTSCR_TSSIPV4FE | ETH_PTPTSCR_TSSEME;
+  ETH->PTPSSIR = (uint32_t)(PTP_SYNC_NS_PER_S / PTP_SYNC_CLOCK_HZ);
+  base_addend = (uint32_t)(((uint64_t)PTP_SYNC_CLOCK_HZ << 32) / hclk);
+  ETH->PTPTSAR = base_addend;
+  ETH->PTPTSCR |= ETH_PTPTSCR_TSARU;
+  if (ptpSync_waitClear(ETH_PTPTSCR_TSARU) != HAL_OK) {
+    return HAL_ERROR;
+  }
+  ETH->PTPTSCR |= ETH_PTPTSCR_TSFCU;
+  ETH->PTPTSHUR = 0;
+  ETH->PTPTSLUR = 0;
+  ETH->PTPTSCR |= ETH_PTPTSCR_TSSTI;
+  if (ptpSync_waitClear(ETH_PTPTSCR_TSSTI) != HAL_OK) {
+    return HAL_ERROR;
+  }
+
+  drift_ppb = 0;
+  trigger_ns = 0;
+  have_master = 0;
+  have_t1 = 0;
+  have_m2s = 0;
+  have_delay = 0;
+  sync_waiting = 0;
+  delay_in_flight = 0;
+  delay_due = 0;
+  t3_valid = 0;
+  t4_valid = 0;
+  lock_count = 0;
+  status.state = PTP_SYNC_LISTENING;
+  status.offset_ns = 0;
+  status.path_delay_ns = 0;
+  status.freq_ppb = 0;
+  started = 1;
+  return HAL_OK;
+}
+
+void ptpSync_stop(void) {
+  started = 0;
+  have_master = 0;
+  delay_due = 0;
+  ETH->PTPTSCR &= ~ETH_PTPTSCR_TSITE;
+  status.state = PTP_SYNC_DISABLED;
+}
+
+void ptpSync_receive(const uint8_t *msg, uint32_t len,
+                     const ETH_TimeStampTypeDef *stamp) {
+  if (!started || msg == NULL || len < PTP_SYNC_HEADER_SIZE) {
+    return;
+  }
+  const uint32_t type = msg[0] & 0x0FU;
+  if ((msg[1] & 0x0FU) != PTP_SYNC_VERSION ||
+      ptpSync_getBe16(&msg[2]) > len) {
+    status.rejected++;
+    return;
+  }
+  if (msg[4] != PTP_SYNC_DOMAIN) {
+    return; // another domain shares the segment
+  }
+  const uint16_t seq = ptpSync_getBe16(&msg[30]);
+
+  switch (type) {
+  case PTP_SYNC_MSG_ANNOUNCE:
+    if (!have_master) {
+      ptpSync_follow(&msg[20]);
+    }
+    break;
+
+  case PTP_SYNC_MSG_SYNC:
+    if (!ptpSync_fromMaster(msg) || stamp == NULL ||
+        len < PTP_SYNC_BODY_SIZE) {
+      status.rejected++;
+      break;
+    }
+    if (msg[6] & PTP_SYNC_FLAG_TWO_STEP) {
+      sync_waiting = 1;
+      sync_seq = seq;
+      sync_t2 = ptpSync_stampNs(stamp);
+      sync_corr = ptpSync_getCorrection(msg);
+    } else {
+      ptpSync_sync(ptpSync_getTimestamp(&msg[34]), ptpSync_stampNs(stamp),
+                   ptpSync_getCorrection(msg));
+    }
+    break;
+
+  case PTP_SYNC_MSG_FOLLOW_UP:
+    if (!ptpSync_fromMaster(msg) || !sync_waiting || seq != sync_seq ||
+        len < PTP_SYNC_BODY_SIZE) {
+      status.rejected++;
+      break;
+    }
+    sync_waiting = 0;
+    ptpSync_sync(ptpSync_getTimestamp(&msg[34]), sync_t2,
+                 sync_corr + ptpSync_getCorrection(msg));
+    break;
+
+  case PTP_SYNC_MSG_DELAY_RESP:
+    // Responses to the other slaves arrive on the same multicast group
+    if (len < PTP_SYNC_RESP_SIZE ||
+        memcmp(&msg[44], port_id, PTP_SYNC_PORT_ID_SIZE) != 0) {
+      break;
+    }
+    if (!ptpSync_fromMaster(msg) || !delay_in_flight || seq != delay_seq) {
+      status.rejected++;
+      break;
+    }
+    t4 = ptpSync_getTimestamp(&msg[34]) - ptpSync_getCorrection(msg);
+    t4_valid = 1;
+    ptpSync_completeDelay();
+    break;
+
+  default:
+    break; // Delay_Req of other slaves, management, signalling
+  }
+}
+
+void ptpSync_poll(void) {
+  if (!started) {
+    return;
+  }
+  const uint32_t now_ms = HAL_GetTick();
+  if (have_master && now_ms - last_sync_ms > PTP_SYNC_MASTER_TIMEOUT_MS) {
+    // Silent master: free-run on the last rate, take the next announced
+    have_master = 0;
+    delay_due = 0;
+    status.timeouts++;
+    status.state = PTP_SYNC_LISTENING;
+  }
+  if (!have_master) {
+    return;
+  }
+
+  ptpSync_completeDelay(); // t3 may come after the response
+  if (have_m2s && !delay_due &&
+      now_ms - delay_req_ms >= PTP_SYNC_DELAY_REQ_MS) {
+    ptpSync_buildDelayReq();
+    t3_valid = 0;
+    t4_valid = 0;
+    delay_in_flight = 1;
+    delay_req_ms = now_ms;
+    __DMB();
+    delay_due = 1;
+  }
+  ptpSync_armTrigger();
+}
+
+uint32_t ptpSync_takeDelayReq(const uint8_t **msg) {
+  if (!delay_due || msg == NULL) {
+    return 0;
+  }
+  delay_due = 0;
+  *msg = delay_req;
+  return PTP_SYNC_BODY_SIZE;
+}
+
+void ptpSync_txTimestamp(const ETH_TimeStampTypeDef *stamp) {
+  if (stamp == NULL) {
+    return;
+  }
+  t3 = ptpSync_stampNs(stamp);
+  __DMB();
+  t3_valid = 1;
+}
+
+uint64_t ptpSync_now(void) {
+  uint32_t sec = ETH->PTPTSHR;
+  uint32_t ns = ETH->PTPTSLR;
+  const uint32_t again = ETH->PTPTSHR;
+  if (again != sec) {
+    sec = again; // rolled over between the reads
+    ns = ETH->PTPTSLR;
+  }
+  return (uint64_t)sec * PTP_SYNC_NS_PER_S + (ns & ETH_PTPTSLR_STSS);
+}
+
+HAL_StatusTypeDef ptpSync_getFrameTime(uint32_t frame, uint32_t frame_rate_hz,
+                                       uint64_t *ptp_ns) {
+  if (ptp_ns == NULL || frame_rate_hz == 0U ||
+      status.state < PTP_SYNC_UNCALIBRATED) {
+    return HAL_ERROR;
+  }
+  TimeSync_Status_t sync;
+  timeSync_getStatus(&sync);
+  if (sync.pulses == 0U || (sync.state != TIME_SYNC_ACQUIRING &&
+                            sync.state != TIME_SYNC_LOCKED &&
+                            sync.state != TIME_SYNC_MEASURING)) {
+    return HAL_ERROR;
+  }
+
+  // The pulse fired on a pulse boundary; the timebase says which one
+  const int64_t elapsed = (int64_t)(timebase_now() - sync.pulse_time) *
+                          (PTP_SYNC_NS_PER_S / TIMEBASE_TICK_HZ);
+  int64_t pulse = (int64_t)ptpSync_now() - elapsed;
+  pulse = (pulse + PTP_SYNC_PULSE_NS / 2) / PTP_SYNC_PULSE_NS *
+          PTP_SYNC_PULSE_NS;
+
+  // The trigger of pulse_frame came phase_ns before the pulse; free-running
+  // frames (measure only) are short by the clock error
+  const int64_t frames = (int64_t)(int32_t)(frame - sync.pulse_frame);
+  int64_t span = frames * PTP_SYNC_NS_PER_S / (int64_t)frame_rate_hz;
+  if (sync.state == TIME_SYNC_MEASURING) {
+    span -= (int64_t)((float)span * sync.clock_ppm * 1.0e-6f);
+  }
+  *ptp_ns = (uint64_t)(pulse - sync.phase_ns + span);
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef ptpSync_getStatus(PtpSync_Status_t *out) {
+  if (out == NULL) {
+    return HAL_ERROR;
+  }
+  *out = status;
+  return HAL_OK;
+}
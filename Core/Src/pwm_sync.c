@@ -0,0 +1,183 @@
+/**
+ ******************************************************************************
+ * @file    pwm_sync.c
+ * @brief   Implementation of the PWM-synchronised scan trigger
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "pwm_sync.h"
+#include "adc_conversions.h"
+
+/* Private defines -----------------------------------------------------------*/
+#define PWM_SYNC_ARR_MAX 0xFFFFU
+#define PWM_SYNC_PSC_MAX 0xFFFFU
+#define PWM_SYNC_OC6_SHIFT 8U // OC6 fields sit one byte above OC5's in CCMR3
+
+/* Private variables ---------------------------------------------------------*/
+static TIM_HandleTypeDef htim_pwm;
+static TIM_TypeDef *timer = NULL; // NULL while stopped
+static uint8_t own_timer = 0;
+static uint32_t tick_hz = 0;
+static uint32_t period_arr = 0;
+static int32_t phase_ticks = 0;
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+ * @brief Input clock of TIM1/TIM8 (APB2 timers run at 2x PCLK2 when APB2 is
+ *        divided)
+ */
+static uint32_t pwmSync_timerClockHz(void) {
+  uint32_t clk = HAL_RCC_GetPCLK2Freq();
+  if ((RCC->CFGR & RCC_CFGR_PPRE2) != RCC_CFGR_PPRE2_DIV1) {
+    clk *= 2U;
+  }
+  return clk;
+}
+
+/**
+ * @brief Centre-aligned, no outputs, PSC/ARR for pwm_hz
+ */
+static HAL_StatusTypeDef pwmSync_initTimer(TIM_TypeDef *instance,
+                                           uint32_t pwm_hz) {
+  const uint64_t clk = pwmSync_timerClockHz();
+  const uint64_t ticks = clk / (2ULL * pwm_hz); // counts per half period
+  const uint64_t psc = ticks / (PWM_SYNC_ARR_MAX + 1ULL);
+  if (psc > PWM_SYNC_PSC_MAX) {
+    return HAL_ERROR;
+  }
+  const uint64_t arr =
+      (clk / (psc + 1U) + pwm_hz) / (2ULL * pwm_hz); // rounded
+  if (arr < 2U || arr > PWM_SYNC_ARR_MAX) {
+    return HAL_ERROR;
+  }
+
+  if (instance == TIM1) {
+    __HAL_RCC_TIM1_CLK_ENABLE();
+  } else {
+    __HAL_RCC_TIM8_CLK_ENABLE();
+  }
+  htim_pwm.Instance = instance;
+  htim_pwm.Init.Prescaler = (uint32_t)psc;
+  htim_pwm.Init.CounterMode = TIM_COUNTERMODE_CENTERALIGNED1;
+  htim_pwm.Init.Period = (uint32_t)arr;
+  htim_pwm.Init.ClockDivision = TIM_CLOCKDIVISION_DIV1;
+  htim_pwm.Init.RepetitionCounter = 0;
+  htim_pwm.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_ENABLE;
+  return HAL_TIM_Base_Init(&htim_pwm);
+}
+
+/**
+ * @brief Timer ticks from the peak for a phase, if within the period
+ */
+static HAL_StatusTypeDef pwmSync_toTicks(int32_t phase_ns, int32_t *ticks) {
+  const int64_t scaled = (int64_t)phase_ns * (int64_t)tick_hz;
+  const int64_t half = (scaled < 0) ? -500000000LL : 500000000LL;
+  const int64_t t = (scaled + half) / 1000000000LL;
+  if (t > (int64_t)period_arr - 1 || t < 1 - (int64_t)period_arr) {
+    return HAL_ERROR;
+  }
+  *ticks = (int32_t)t;
+  return HAL_OK;
+}
+
+/**
+ * @brief OC6REF rises ticks after the counter peak (before it if negative)
+ */
+static void pwmSync_writeOc6(int32_t ticks) {
+  const uint32_t mode = (ticks >= 0) ? TIM_OCMODE_PWM1 : TIM_OCMODE_PWM2;
+  timer->CCR6 = period_arr - (uint32_t)((ticks >= 0) ? ticks : -ticks);
+  timer->CCMR3 = (timer->CCMR3 & ~(TIM_CCMR3_OC6M | TIM_CCMR3_OC6FE)) |
+                 (mode << PWM_SYNC_OC6_SHIFT) | TIM_CCMR3_OC6PE;
+  phase_ticks = ticks;
+}
+
+/* Public functions ----------------------------------------------------------*/
+
+HAL_StatusTypeDef pwmSync_start(const PwmSync_Config_t *cfg) {
+  if (cfg == NULL ||
+      (cfg->timer != PWM_SYNC_TIM1 && cfg->timer != PWM_SYNC_TIM8)) {
+    return HAL_ERROR;
+  }
+  const ADC_ScanTrigger_t source = (cfg->timer == PWM_SYNC_TIM1)
+                                       ? ADC_SCAN_TRIGGER_TIM1_TRGO2
+                                       : ADC_SCAN_TRIGGER_TIM8_TRGO2;
+  TIM_TypeDef *instance = (cfg->timer == PWM_SYNC_TIM1) ? TIM1 : TIM8;
+  HAL_StatusTypeDef status = pwmSync_stop();
+  if (status != HAL_OK) {
+    return status;
+  }
+
+  if (cfg->pwm_hz != 0U) {
+    if (pwmSync_initTimer(instance, cfg->pwm_hz) != HAL_OK) {
+      return HAL_ERROR;
+    }
+  } else if ((instance->CR1 & TIM_CR1_CEN) == 0U ||
+             (instance->CR1 & TIM_CR1_CMS) == 0U || instance->ARR < 2U) {
+    // Motor control has not started it, or runs it edge-aligned
+    return HAL_ERROR;
+  }
+  timer = instance;
+  own_timer = (cfg->pwm_hz != 0U) ? 1U : 0U;
+  tick_hz = pwmSync_timerClockHz() / (instance->PSC + 1U);
+  period_arr = instance->ARR;
+
+  int32_t ticks = 0;
+  if (pwmSync_toTicks(cfg->phase_ns, &ticks) != HAL_OK) {
+    (void)pwmSync_stop();
+    return HAL_ERROR;
+  }
+  pwmSync_writeOc6(ticks);
+  timer->CR2 = (timer->CR2 & ~TIM_CR2_MMS2) | TIM_TRGO2_OC6REF;
+  if (own_timer) {
+    // Update event: PSC, ARR and CCR6 out of their preload registers
+    timer->EGR = TIM_EGR_UG;
+    if (HAL_TIM_Base_Start(&htim_pwm) != HAL_OK) {
+      (void)pwmSync_stop();
+      return HAL_ERROR;
+    }
+  }
+  return analogSensor_setScanTrigger(source);
+}
+
+HAL_StatusTypeDef pwmSync_stop(void) {
+  HAL_StatusTypeDef status = analogSensor_setScanTrigger(ADC_SCAN_TRIGGER_TIM2);
+  if (status != HAL_OK || timer == NULL) {
+    return status;
+  }
+  timer->CR2 &= ~TIM_CR2_MMS2;
+  timer->CCMR3 &= ~(TIM_CCMR3_OC6M | TIM_CCMR3_OC6PE);
+  if (own_timer) {
+    (void)HAL_TIM_Base_Stop(&htim_pwm);
+  }
+  timer = NULL;
+  tick_hz = 0;
+  period_arr = 0;
+  phase_ticks = 0;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef pwmSync_setPhase(int32_t phase_ns) {
+  int32_t ticks = 0;
+  if (timer == NULL || pwmSync_toTicks(phase_ns, &ticks) != HAL_OK) {
+    return HAL_ERROR;
+  }
+  pwmSync_writeOc6(ticks);
+  return HAL_OK;
+}
+
+int32_t pwmSync_getPhase(void) {
+  if (tick_hz == 0U) {
+    return 0;
+  }
+  return (int32_t)(((int64_t)phase_ticks * 1000000000LL) / (int64_t)tick_hz);
+}
+
+uint32_t pwmSync_getRate(void) {
+  if (period_arr == 0U) {
+    return 0;
+  }
+  return (tick_hz + period_arr) / (2U * period_arr);
+}
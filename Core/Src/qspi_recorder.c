@@ -0,0 +1,1182 @@
+/**
+ ******************************************************************************
+ * @file    qspi_recorder.c
+ * @brief   Implementation of the QSPI NOR flash black-box recorder
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "qspi_recorder.h"
+#include "adc_sections.h"
+#include "crc_unit.h"
+#include "telemetry_frame.h"
+#include <stddef.h>
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define QSPI_REC_PAGES_PER_SECTOR (QSPI_REC_SECTOR_SIZE / QSPI_REC_PAGE_SIZE)
+#define QSPI_REC_SECTORS (QSPI_REC_FLASH_SIZE / QSPI_REC_SECTOR_SIZE)
+#define QSPI_REC_CAPTURE_BYTES                                                 \
+  (QSPI_REC_PAGE_SIZE + ADC_TRIGGER_CAPTURE_FRAMES * sizeof(ADC_Frame_t))
+#define QSPI_REC_SLOT_SECTORS                                                  \
+  ((QSPI_REC_CAPTURE_BYTES + QSPI_REC_SECTOR_SIZE - 1U) / QSPI_REC_SECTOR_SIZE)
+#if QSPI_REC_ROLLUP_ENABLE
+#define QSPI_REC_ROLLUP_SECTORS                                                \
+  (QSPI_REC_ROLLUP_SECTORS_1S + QSPI_REC_ROLLUP_SECTORS_1MIN +                 \
+   QSPI_REC_ROLLUP_SECTORS_1H)
+#define QSPI_REC_ROLLUP_DEPTH QSPI_REC_ROLLUP_QUEUE
+#else
+#define QSPI_REC_ROLLUP_SECTORS 0U
+#define QSPI_REC_ROLLUP_DEPTH 1U
+#endif
+#define QSPI_REC_HISTORY_SECTORS                                               \
+  (QSPI_REC_SECTORS - QSPI_REC_CAPTURE_SLOTS * QSPI_REC_SLOT_SECTORS -         \
+   QSPI_REC_ROLLUP_SECTORS)
+#define QSPI_REC_HISTORY_PAGES                                                 \
+  (QSPI_REC_HISTORY_SECTORS * QSPI_REC_PAGES_PER_SECTOR)
+#define QSPI_REC_ROLLUP_BASE (QSPI_REC_HISTORY_SECTORS * QSPI_REC_SECTOR_SIZE)
+#define QSPI_REC_CAPTURE_BASE                                                  \
+  ((QSPI_REC_HISTORY_SECTORS + QSPI_REC_ROLLUP_SECTORS) * QSPI_REC_SECTOR_SIZE)
+// A rollup record takes whole pages, and a sector holds whole records
+#define QSPI_REC_ROLLUP_SLOT_SIZE                                              \
+  (((sizeof(QspiRec_Rollup_t) + QSPI_REC_PAGE_SIZE - 1U) /                     \
+    QSPI_REC_PAGE_SIZE) *                                                      \
+   QSPI_REC_PAGE_SIZE)
+#define QSPI_REC_ROLLUP_PER_SECTOR                                             \
+  (QSPI_REC_SECTOR_SIZE / QSPI_REC_ROLLUP_SLOT_SIZE)
+#define QSPI_REC_ROLLUP_INDEX                                                  \
+  ((QSPI_REC_ROLLUP_SECTORS > 0U) ? QSPI_REC_ROLLUP_SECTORS : 1U)
+// Page numbers wrap at a multiple of the ring, so positions stay continuous
+#define QSPI_REC_SEQ_WRAP                                                      \
+  ((0xFFFFFFFFUL / QSPI_REC_HISTORY_PAGES) * QSPI_REC_HISTORY_PAGES)
+#define QSPI_REC_ERASED 0xFFFFFFFFU
+
+/* SPI NOR commands, all single-line with 3-byte addresses */
+#define QSPI_REC_CMD_WRITE_ENABLE 0x06U
+#define QSPI_REC_CMD_READ_STATUS 0x05U
+#define QSPI_REC_CMD_READ_ID 0x9FU
+#define QSPI_REC_CMD_FAST_READ 0x0BU
+#define QSPI_REC_CMD_PAGE_PROGRAM 0x02U
+#define QSPI_REC_CMD_SECTOR_ERASE 0x20U
+#define QSPI_REC_CMD_RESET_ENABLE 0x66U
+#define QSPI_REC_CMD_RESET 0x99U
+#define QSPI_REC_STATUS_WIP 0x01U
+#define QSPI_REC_FAST_READ_DUMMY 8U
+#define QSPI_REC_TIMEOUT_MS 10U
+
+_Static_assert(sizeof(QspiRec_Page_t) == QSPI_REC_PAGE_SIZE,
+               "a history page must fill one flash page");
+_Static_assert(offsetof(QspiRec_Page_t, samples) == QSPI_REC_PAGE_HEADER,
+               "page header size mismatch");
+_Static_assert(sizeof(QspiRec_CaptureHeader_t) <= QSPI_REC_PAGE_SIZE,
+               "the capture header must fit one page");
+_Static_assert(QSPI_REC_FLASH_SIZE <= (1UL << 24),
+               "3-byte addressing reaches 16 MB");
+_Static_assert(QSPI_REC_ERASE_AHEAD >= 1U &&
+                   QSPI_REC_HISTORY_SECTORS > QSPI_REC_ERASE_AHEAD + 1U,
+               "the history ring is too small");
+_Static_assert(QSPI_REC_PAGE_FRAMES >= 1U, "a frame must fit one page");
+_Static_assert(QSPI_REC_SECTOR_SIZE % QSPI_REC_ROLLUP_SLOT_SIZE == 0U,
+               "a sector must hold whole rollup records");
+_Static_assert(!QSPI_REC_ROLLUP_ENABLE || (QSPI_REC_ROLLUP_SECTORS_1S >= 2U &&
+                                           QSPI_REC_ROLLUP_SECTORS_1MIN >= 2U &&
+                                           QSPI_REC_ROLLUP_SECTORS_1H >= 2U),
+               "a rollup segment needs a sector beside the one being erased");
+
+/* Private variables ---------------------------------------------------------*/
+static QSPI_HandleTypeDef hqspi;
+
+/* Staging ring: filled by the block callback, programmed by the main loop */
+static QspiRec_Page_t stage[QSPI_REC_STAGE_PAGES];
+static volatile uint32_t stage_head = 0; // pages complete, block callback
+static volatile uint32_t stage_tail = 0; // pages programmed, main loop
+static uint32_t fill_frames = 0;         // frames in stage[stage_head]
+static uint32_t fill_next_frame = 0;     // frame number expected next
+static volatile uint8_t ready = 0;
+
+/* Flash write position, page numbers mod QSPI_REC_SEQ_WRAP */
+static uint32_t prog_seq = 0;     // next history page to program
+static uint32_t erased_until = 0; // history pages before this are erased
+static uint32_t newest_seq = 0;   // last history page programmed
+static uint8_t has_history = 0;
+static uint8_t flash_busy = 0;    // program or erase started, WIP not seen
+
+/* Capture slots */
+static uint8_t next_slot = 0;
+static uint8_t slot_erased = 0; // sectors of next_slot erased so far
+static uint8_t has_capture = 0;
+static uint8_t newest_slot = 0;
+static uint32_t newest_capture = 0;
+
+/* Capture commit in progress */
+static uint8_t cap_active = 0;
+static const ADC_Frame_t *cap_frames = NULL;
+static uint32_t cap_bytes = 0;
+static uint32_t cap_offset = 0; // data bytes programmed
+static uint32_t cap_crc = 0;
+static uint8_t cap_crc_dma = 0; // data CRC runs on the CRC unit's DMA
+static uint8_t cap_step = 0;    // 0 data, 1 header, 2 commit word
+static QspiRec_CaptureHeader_t cap_header;
+
+/* Rollups: the interval being aggregated, and the records closed but not
+   yet programmed, per tier */
+typedef struct {
+  uint8_t open;
+  uint32_t start_s;
+  uint32_t windows;
+  uint32_t count[ADC_CONVERSIONS_CHANNEL_COUNT]; // windows per channel
+  float min[ADC_CONVERSIONS_CHANNEL_COUNT][TELEMETRY_FRAME_FEATURES];
+  float max[ADC_CONVERSIONS_CHANNEL_COUNT][TELEMETRY_FRAME_FEATURES];
+  float sum[ADC_CONVERSIONS_CHANNEL_COUNT][TELEMETRY_FRAME_FEATURES];
+} QspiRec_RollupAcc_t;
+
+typedef struct {
+  QspiRec_RollupAcc_t acc;
+  QspiRec_Rollup_t queue[QSPI_REC_ROLLUP_DEPTH];
+  uint32_t head;     // records closed
+  uint32_t tail;     // records programmed
+  uint32_t write;    // slot of queue[tail]
+  uint8_t page;      // pages of queue[tail] programmed
+  uint8_t erased;    // the sector write is in has been erased
+  uint32_t next_s;   // first second after the intervals closed
+  uint32_t newest_s; // newest record in the flash
+  uint32_t records;  // written since init
+} QspiRec_RollupTier_t;
+
+static const uint32_t rollup_period_s[QSPI_REC_TIER_COUNT] = {1U, 60U, 3600U};
+static const uint32_t rollup_sectors[QSPI_REC_TIER_COUNT] = {
+    QSPI_REC_ROLLUP_SECTORS_1S, QSPI_REC_ROLLUP_SECTORS_1MIN,
+    QSPI_REC_ROLLUP_SECTORS_1H};
+static QspiRec_RollupTier_t tiers[QSPI_REC_TIER_COUNT];
+static uint32_t rollup_index[QSPI_REC_ROLLUP_INDEX]; // first time per sector
+#if QSPI_REC_ROLLUP_ENABLE
+static QspiRec_Rollup_t rollup_spill[QSPI_REC_TIER_COUNT]; // on a full queue
+static uint32_t clock_s = 0;  // rollup clock at clock_ms
+static uint32_t clock_ms = 0; // HAL tick
+#endif
+static uint32_t rollup_dropped = 0;
+
+static QspiRec_Stats_t stats_ = {0};
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+ * @brief CRC-32 (IEEE), running: crc = qspiRec_crc32(crc, ...) from 0
+ */
+static uint32_t qspiRec_crc32(uint32_t crc, const uint8_t *data, uint32_t len) {
+#if CRC_UNIT_ENABLE
+  uint32_t hw;
+  if (crcUnit_crc32(crc, data, len, &hw) == HAL_OK) {
+    return hw;
+  }
+#endif
+  crc = ~crc;
+  for (uint32_t i = 0; i < len; i++) {
+    crc ^= data[i];
+    for (uint8_t bit = 0; bit < 8U; bit++) {
+      crc = (crc & 1U) ? (crc >> 1) ^ 0xEDB88320U : crc >> 1;
+    }
+  }
+  return ~crc;
+}
+
+static uint32_t qspiRec_seqAdd(uint32_t seq, uint32_t n) {
+  return (uint32_t)(((uint64_t)seq + n) % QSPI_REC_SEQ_WRAP);
+}
+
+static uint32_t qspiRec_seqDiff(uint32_t a, uint32_t b) {
+  return (a >= b) ? a - b : a + QSPI_REC_SEQ_WRAP - b;
+}
+
+static uint32_t qspiRec_historyAddr(uint32_t seq) {
+  return (seq % QSPI_REC_HISTORY_PAGES) * QSPI_REC_PAGE_SIZE;
+}
+
+static uint32_t qspiRec_slotAddr(uint8_t slot) {
+  return QSPI_REC_CAPTURE_BASE +
+         (uint32_t)slot * QSPI_REC_SLOT_SECTORS * QSPI_REC_SECTOR_SIZE;
+}
+
+/**
+ * @brief Send one instruction; address < 0 = none
+ */
+static HAL_StatusTypeDef qspiRec_command(uint8_t instruction, int32_t address,
+                                         uint32_t dummy, uint32_t length) {
+  QSPI_CommandTypeDef cmd = {0};
+  cmd.Instruction = instruction;
+  cmd.InstructionMode = QSPI_INSTRUCTION_1_LINE;
+  cmd.AddressSize = QSPI_ADDRESS_24_BITS;
+  cmd.AddressMode = (address < 0) ? QSPI_ADDRESS_NONE : QSPI_ADDRESS_1_LINE;
+  cmd.Address = (address < 0) ? 0U : (uint32_t)address;
+  cmd.AlternateByteMode = QSPI_ALTERNATE_BYTES_NONE;
+  cmd.DummyCycles = dummy;
+  cmd.DataMode = (length == 0U) ? QSPI_DATA_NONE : QSPI_DATA_1_LINE;
+  cmd.NbData = length;
+  cmd.DdrMode = QSPI_DDR_MODE_DISABLE;
+  cmd.DdrHoldHalfCycle = QSPI_DDR_HHC_ANALOG_DELAY;
+  cmd.SIOOMode = QSPI_SIOO_INST_EVERY_CMD;
+  if (HAL_QSPI_Command(&hqspi, &cmd, QSPI_REC_TIMEOUT_MS) != HAL_OK) {
+    stats_.flash_errors++;
+    return HAL_ERROR;
+  }
+  return HAL_OK;
+}
+
+static HAL_StatusTypeDef qspiRec_read(uint32_t addr, void *buf, uint32_t len) {
+  if (qspiRec_command(QSPI_REC_CMD_FAST_READ, (int32_t)addr,
+                      QSPI_REC_FAST_READ_DUMMY, len) != HAL_OK ||
+      HAL_QSPI_Receive(&hqspi, (uint8_t *)buf, QSPI_REC_TIMEOUT_MS) !=
+          HAL_OK) {
+    return HAL_ERROR;
+  }
+  return HAL_OK;
+}
+
+/**
+ * @brief Whether the last program or erase has finished
+ */
+static uint8_t qspiRec_idle(void) {
+  uint8_t status = QSPI_REC_STATUS_WIP;
+  if (!flash_busy) {
+    return 1;
+  }
+  if (qspiRec_command(QSPI_REC_CMD_READ_STATUS, -1, 0, 1) != HAL_OK ||
+      HAL_QSPI_Receive(&hqspi, &status, QSPI_REC_TIMEOUT_MS) != HAL_OK ||
+      (status & QSPI_REC_STATUS_WIP) != 0U) {
+    return 0;
+  }
+  flash_busy = 0;
+  return 1;
+}
+
+static HAL_StatusTypeDef qspiRec_program(uint32_t addr, const void *data,
+                                         uint32_t len) {
+  if (qspiRec_command(QSPI_REC_CMD_WRITE_ENABLE, -1, 0, 0) != HAL_OK ||
+      qspiRec_command(QSPI_REC_CMD_PAGE_PROGRAM, (int32_t)addr, 0, len) !=
+          HAL_OK ||
+      HAL_QSPI_Transmit(&hqspi, (uint8_t *)data, QSPI_REC_TIMEOUT_MS) !=
+          HAL_OK) {
+    return HAL_ERROR;
+  }
+  flash_busy = 1;
+  return HAL_OK;
+}
+
+static HAL_StatusTypeDef qspiRec_erase(uint32_t addr) {
+  if (qspiRec_command(QSPI_REC_CMD_WRITE_ENABLE, -1, 0, 0) != HAL_OK ||
+      qspiRec_command(QSPI_REC_CMD_SECTOR_ERASE, (int32_t)addr, 0, 0) !=
+          HAL_OK) {
+    return HAL_ERROR;
+  }
+  flash_busy = 1;
+  stats_.erases++;
+  return HAL_OK;
+}
+
+static uint8_t qspiRec_captureValid(const QspiRec_CaptureHeader_t *hdr) {
+  return hdr->magic == QSPI_REC_CAPTURE_MAGIC &&
+         hdr->commit == QSPI_REC_COMMIT &&
+         hdr->header_crc ==
+             qspiRec_crc32(0, (const uint8_t *)hdr,
+                           offsetof(QspiRec_CaptureHeader_t, header_crc));
+}
+
+/**
+ * @brief Find the newest history page and resume at the next sector
+ */
+static HAL_StatusTypeDef qspiRec_scanHistory(void) {
+  uint32_t max_all = 0;
+  uint32_t min_all = QSPI_REC_ERASED;
+  uint32_t max_small = 0;
+  uint8_t found = 0;
+  uint8_t found_small = 0;
+
+  // First page of every sector, valid if it sits where its number says
+  for (uint32_t s = 0; s < QSPI_REC_HISTORY_SECTORS; s++) {
+    uint32_t seq;
+    if (qspiRec_read(s * QSPI_REC_SECTOR_SIZE +
+                         offsetof(QspiRec_Page_t, sequence),
+                     &seq, sizeof(seq)) != HAL_OK) {
+      return HAL_ERROR;
+    }
+    if (seq >= QSPI_REC_SEQ_WRAP ||
+        qspiRec_historyAddr(seq) != s * QSPI_REC_SECTOR_SIZE) {
+      continue;
+    }
+    found = 1;
+    max_all = (seq > max_all) ? seq : max_all;
+    min_all = (seq < min_all) ? seq : min_all;
+    if (seq < QSPI_REC_HISTORY_PAGES) {
+      found_small = 1;
+      max_small = (seq > max_small) ? seq : max_small;
+    }
+  }
+  if (!found) {
+    prog_seq = 0;
+    has_history = 0;
+  } else {
+    // The ring spans less than one lap unless the numbers wrapped
+    uint32_t base = (found_small && max_all - min_all >= QSPI_REC_HISTORY_PAGES)
+                        ? max_small
+                        : max_all;
+    newest_seq = base;
+    for (uint32_t p = 1; p < QSPI_REC_PAGES_PER_SECTOR; p++) {
+      uint32_t seq;
+      if (qspiRec_read(qspiRec_historyAddr(base + p) +
+                           offsetof(QspiRec_Page_t, sequence),
+                       &seq, sizeof(seq)) != HAL_OK) {
+        return HAL_ERROR;
+      }
+      if (seq != base + p) {
+        break;
+      }
+      newest_seq = seq;
+    }
+    has_history = 1;
+    prog_seq = qspiRec_seqAdd(base, QSPI_REC_PAGES_PER_SECTOR);
+  }
+  erased_until = prog_seq; // nothing ahead is known to be erased
+  return HAL_OK;
+}
+
+/**
+ * @brief Find the newest committed capture; the next slot follows it
+ */
+static HAL_StatusTypeDef qspiRec_scanCaptures(void) {
+  QspiRec_CaptureHeader_t hdr;
+  has_capture = 0;
+  for (uint8_t slot = 0; slot < QSPI_REC_CAPTURE_SLOTS; slot++) {
+    if (qspiRec_read(qspiRec_slotAddr(slot), &hdr, sizeof(hdr)) != HAL_OK) {
+      return HAL_ERROR;
+    }
+    if (qspiRec_captureValid(&hdr) &&
+        (!has_capture || hdr.sequence > newest_capture)) {
+      has_capture = 1;
+      newest_capture = hdr.sequence;
+      newest_slot = slot;
+    }
+  }
+  next_slot = has_capture ? (uint8_t)((newest_slot + 1U) %
+                                      QSPI_REC_CAPTURE_SLOTS)
+                          : 0U;
+  slot_erased = 0;
+  return HAL_OK;
+}
+
+/**
+ * @brief Program the oldest staged page into the history ring
+ */
+static void qspiRec_programHistory(void) {
+  QspiRec_Page_t *page = &stage[stage_tail % QSPI_REC_STAGE_PAGES];
+  page->sequence = prog_seq;
+  page->crc = telemetryFrame_crc16((const uint8_t *)page + 2U,
+                                   QSPI_REC_PAGE_SIZE - 2U);
+  if (qspiRec_program(qspiRec_historyAddr(prog_seq), page,
+                      QSPI_REC_PAGE_SIZE) != HAL_OK) {
+    return; // retried on the next poll
+  }
+  // The flash has the page once the transfer is done; free the slot
+  stage_tail = stage_tail + 1U;
+  newest_seq = prog_seq;
+  has_history = 1;
+  prog_seq = qspiRec_seqAdd(prog_seq, 1U);
+  stats_.pages_written++;
+}
+
+/**
+ * @brief Next step of the capture commit: data, header, commit word
+ */
+static void qspiRec_captureStep(void) {
+  uint32_t slot_addr = qspiRec_slotAddr(next_slot);
+
+  if (cap_step == 0U) {
+    if (cap_offset < cap_bytes) {
+      uint32_t len = cap_bytes - cap_offset;
+      if (len > QSPI_REC_PAGE_SIZE) {
+        len = QSPI_REC_PAGE_SIZE;
+      }
+      const uint8_t *src = (const uint8_t *)cap_frames + cap_offset;
+      if (qspiRec_program(slot_addr + QSPI_REC_PAGE_SIZE + cap_offset, src,
+                          len) != HAL_OK) {
+        return;
+      }
+      if (!cap_crc_dma) {
+        cap_crc = qspiRec_crc32(cap_crc, src, len);
+      }
+      cap_offset += len;
+      if (cap_offset < cap_bytes) {
+        return;
+      }
+    }
+    if (cap_crc_dma) {
+      HAL_StatusTypeDef status = crcUnit_getDmaResult(&cap_crc);
+      if (status == HAL_BUSY) {
+        return; // checked again on the next poll
+      }
+      if (status != HAL_OK) {
+        cap_crc = qspiRec_crc32(0, (const uint8_t *)cap_frames, cap_bytes);
+      }
+      cap_crc_dma = 0;
+    }
+    cap_header.data_crc = cap_crc;
+    cap_header.header_crc = qspiRec_crc32(
+        0, (const uint8_t *)&cap_header,
+        offsetof(QspiRec_CaptureHeader_t, header_crc));
+    cap_step = 1U;
+  } else if (cap_step == 1U) {
+    // commit stays erased (0xFFFFFFFF) until the last step
+    if (qspiRec_program(slot_addr, &cap_header,
+                        offsetof(QspiRec_CaptureHeader_t, commit)) == HAL_OK) {
+      cap_step = 2U;
+    }
+  } else {
+    const uint32_t commit = QSPI_REC_COMMIT;
+    if (qspiRec_program(slot_addr + offsetof(QspiRec_CaptureHeader_t, commit),
+                        &commit, sizeof(commit)) != HAL_OK) {
+      return;
+    }
+    has_capture = 1;
+    newest_capture = cap_header.sequence;
+    newest_slot = next_slot;
+    next_slot = (uint8_t)((next_slot + 1U) % QSPI_REC_CAPTURE_SLOTS);
+    slot_erased = 0;
+    stats_.captures++;
+    cap_active = 0;
+  }
+}
+
+#if QSPI_REC_ROLLUP_ENABLE
+/**
+ * @brief Rollup clock at a HAL tick; a tick before the last reading counts
+ *        as that reading
+ */
+static uint32_t qspiRec_clockAt(uint32_t tick) {
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  const int32_t ms = (int32_t)(tick - clock_ms);
+  const uint32_t now_s = (ms > 0) ? clock_s + (uint32_t)ms / 1000U : clock_s;
+  __set_PRIMASK(primask);
+  return now_s;
+}
+
+/**
+ * @brief Rollup clock now; whole seconds move into the base so the tick
+ *        difference never wraps
+ */
+static uint32_t qspiRec_clockNow(void) {
+  // Masked: two callers moving the same seconds would count them twice
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  const uint32_t whole = (HAL_GetTick() - clock_ms) / 1000U;
+  clock_s += whole;
+  clock_ms += whole * 1000U;
+  const uint32_t now_s = clock_s;
+  __set_PRIMASK(primask);
+  return now_s;
+}
+#endif
+
+static uint32_t qspiRec_rollupFirstSector(uint8_t tier) {
+  uint32_t first = 0;
+  for (uint8_t t = 0; t < tier; t++) {
+    first += rollup_sectors[t];
+  }
+  return first;
+}
+
+static uint32_t qspiRec_rollupSlots(uint8_t tier) {
+  return rollup_sectors[tier] * QSPI_REC_ROLLUP_PER_SECTOR;
+}
+
+static uint32_t qspiRec_rollupAddr(uint8_t tier, uint32_t slot) {
+  return QSPI_REC_ROLLUP_BASE +
+         qspiRec_rollupFirstSector(tier) * QSPI_REC_SECTOR_SIZE +
+         slot * QSPI_REC_ROLLUP_SLOT_SIZE;
+}
+
+static uint16_t qspiRec_rollupCrc(const QspiRec_Rollup_t *rec) {
+  return telemetryFrame_crc16((const uint8_t *)rec + 2U,
+                              sizeof(*rec) - 2U);
+}
+
+static uint8_t qspiRec_rollupValid(const QspiRec_Rollup_t *rec,
+                                   uint8_t tier) {
+  return rec->time_s != QSPI_REC_ERASED && rec->tier == tier &&
+         rec->channels == ADC_CONVERSIONS_CHANNEL_COUNT &&
+         rec->time_s % rollup_period_s[tier] == 0U &&
+         rec->crc == qspiRec_rollupCrc(rec);
+}
+
+#if QSPI_REC_ROLLUP_ENABLE
+static void qspiRec_rollupMerge(uint8_t tier, const QspiRec_Rollup_t *rec);
+
+/**
+ * @brief Close a tier's interval: queue its record and pass it up
+ */
+static void qspiRec_rollupClose(uint8_t tier) {
+  QspiRec_RollupTier_t *t = &tiers[tier];
+  QspiRec_RollupAcc_t *acc = &t->acc;
+  QspiRec_Rollup_t *rec = &rollup_spill[tier];
+  if (t->head - t->tail < QSPI_REC_ROLLUP_DEPTH) {
+    rec = &t->queue[t->head % QSPI_REC_ROLLUP_DEPTH];
+  } else {
+    rollup_dropped++;
+  }
+
+  memset(rec, 0, sizeof(*rec));
+  rec->tier = tier;
+  rec->channels = ADC_CONVERSIONS_CHANNEL_COUNT;
+  rec->time_s = acc->start_s;
+  rec->windows = acc->windows;
+  for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+    if (acc->count[ch] == 0U) {
+      continue;
+    }
+    rec->channel_mask |= 1UL << ch;
+    for (uint8_t f = 0; f < TELEMETRY_FRAME_FEATURES; f++) {
+      rec->min[ch][f] = acc->min[ch][f];
+      rec->max[ch][f] = acc->max[ch][f];
+      rec->mean[ch][f] = acc->sum[ch][f] / (float)acc->count[ch];
+    }
+  }
+  rec->crc = qspiRec_rollupCrc(rec);
+  acc->open = 0;
+  t->next_s = acc->start_s + rollup_period_s[tier];
+  if (rec != &rollup_spill[tier]) {
+    t->head++;
+  }
+  if (tier + 1U < QSPI_REC_TIER_COUNT) {
+    qspiRec_rollupMerge((uint8_t)(tier + 1U), rec);
+  }
+}
+
+/**
+ * @brief Add a record, or a window as a record of one, to a tier's
+ *        interval, closing the interval first if the record is past it
+ */
+static void qspiRec_rollupMerge(uint8_t tier, const QspiRec_Rollup_t *rec) {
+  QspiRec_RollupTier_t *t = &tiers[tier];
+  QspiRec_RollupAcc_t *acc = &t->acc;
+  // A late window joins the first interval still open, so the times of a
+  // tier keep increasing
+  const uint32_t time = (rec->time_s > t->next_s) ? rec->time_s : t->next_s;
+  const uint32_t start = time - time % rollup_period_s[tier];
+  if (acc->open && start > acc->start_s) {
+    qspiRec_rollupClose(tier);
+  }
+  if (!acc->open) {
+    memset(acc, 0, sizeof(*acc));
+    acc->open = 1;
+    acc->start_s = start;
+  }
+
+  acc->windows += rec->windows;
+  for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+    if (!((rec->channel_mask >> ch) & 1U)) {
+      continue;
+    }
+    const uint8_t first = (acc->count[ch] == 0U);
+    for (uint8_t f = 0; f < TELEMETRY_FRAME_FEATURES; f++) {
+      if (first || rec->min[ch][f] < acc->min[ch][f]) {
+        acc->min[ch][f] = rec->min[ch][f];
+      }
+      if (first || rec->max[ch][f] > acc->max[ch][f]) {
+        acc->max[ch][f] = rec->max[ch][f];
+      }
+      acc->sum[ch][f] += rec->mean[ch][f] * (float)rec->windows;
+    }
+    acc->count[ch] += rec->windows;
+  }
+}
+
+/**
+ * @brief Close the intervals the clock has passed, finest first, so the
+ *        last record of a coarser interval is in before it closes
+ */
+static void qspiRec_rollupAdvance(uint32_t now_s) {
+  for (uint8_t tier = 0; tier < QSPI_REC_TIER_COUNT; tier++) {
+    const QspiRec_RollupAcc_t *acc = &tiers[tier].acc;
+    if (acc->open && now_s - acc->start_s >= rollup_period_s[tier]) {
+      qspiRec_rollupClose(tier);
+    }
+  }
+}
+
+/**
+ * @brief Rebuild a tier's index from the first record of each sector and
+ *        resume at the sector after the newest one
+ */
+static HAL_StatusTypeDef qspiRec_scanRollups(uint8_t tier) {
+  QspiRec_RollupTier_t *t = &tiers[tier];
+  QspiRec_Rollup_t rec;
+  uint32_t *index = &rollup_index[qspiRec_rollupFirstSector(tier)];
+  uint32_t newest = 0;
+  uint8_t found = 0;
+
+  memset(t, 0, sizeof(*t));
+  t->newest_s = QSPI_REC_ERASED;
+  for (uint32_t s = 0; s < rollup_sectors[tier]; s++) {
+    if (qspiRec_read(qspiRec_rollupAddr(tier, s * QSPI_REC_ROLLUP_PER_SECTOR),
+                     &rec, sizeof(rec)) != HAL_OK) {
+      return HAL_ERROR;
+    }
+    index[s] = qspiRec_rollupValid(&rec, tier) ? rec.time_s : QSPI_REC_ERASED;
+    if (index[s] != QSPI_REC_ERASED &&
+        (!found || index[s] > index[newest])) {
+      found = 1;
+      newest = s;
+    }
+  }
+  if (!found) {
+    return HAL_OK; // write from slot 0
+  }
+
+  // Newest record of the newest sector; a record cut short by a power
+  // loss ends the search, and the writer starts on a fresh sector anyway
+  t->newest_s = index[newest];
+  for (uint32_t i = 1; i < QSPI_REC_ROLLUP_PER_SECTOR; i++) {
+    if (qspiRec_read(qspiRec_rollupAddr(
+                         tier, newest * QSPI_REC_ROLLUP_PER_SECTOR + i),
+                     &rec, sizeof(rec)) != HAL_OK) {
+      return HAL_ERROR;
+    }
+    if (!qspiRec_rollupValid(&rec, tier) || rec.time_s <= t->newest_s) {
+      break;
+    }
+    t->newest_s = rec.time_s;
+  }
+  t->next_s = t->newest_s + rollup_period_s[tier];
+  t->write =
+      ((newest + 1U) % rollup_sectors[tier]) * QSPI_REC_ROLLUP_PER_SECTOR;
+  return HAL_OK;
+}
+#endif
+
+/**
+ * @brief Tier with a closed record waiting, coarsest first
+ */
+static int8_t qspiRec_rollupPending(void) {
+  for (int8_t tier = QSPI_REC_TIER_COUNT - 1; tier >= 0; tier--) {
+    if (tiers[tier].head != tiers[tier].tail) {
+      return tier;
+    }
+  }
+  return -1;
+}
+
+/**
+ * @brief Next step of the oldest queued record of a tier: erase the sector
+ *        it enters, then its pages
+ */
+static void qspiRec_rollupStep(uint8_t tier) {
+  QspiRec_RollupTier_t *t = &tiers[tier];
+  const QspiRec_Rollup_t *rec = &t->queue[t->tail % QSPI_REC_ROLLUP_DEPTH];
+  const uint32_t addr = qspiRec_rollupAddr(tier, t->write);
+  const uint32_t sector = t->write / QSPI_REC_ROLLUP_PER_SECTOR;
+  uint32_t *index = &rollup_index[qspiRec_rollupFirstSector(tier)];
+
+  if (!t->erased) {
+    if (qspiRec_erase(qspiRec_rollupAddr(
+            tier, sector * QSPI_REC_ROLLUP_PER_SECTOR)) == HAL_OK) {
+      index[sector] = QSPI_REC_ERASED;
+      t->erased = 1;
+    }
+    return;
+  }
+
+  const uint32_t offset = (uint32_t)t->page * QSPI_REC_PAGE_SIZE;
+  const uint32_t len = (sizeof(*rec) - offset < QSPI_REC_PAGE_SIZE)
+                           ? sizeof(*rec) - offset
+                           : QSPI_REC_PAGE_SIZE;
+  if (qspiRec_program(addr + offset, (const uint8_t *)rec + offset, len) !=
+      HAL_OK) {
+    return; // retried on the next poll
+  }
+  if (offset + len < sizeof(*rec)) {
+    t->page++;
+    return;
+  }
+  // queue[tail] is free for a closing interval once tail moves
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  if (t->write % QSPI_REC_ROLLUP_PER_SECTOR == 0U) {
+    index[sector] = rec->time_s;
+  }
+  t->newest_s = rec->time_s;
+  t->records++;
+  t->page = 0;
+  t->tail++;
+  t->write = (t->write + 1U) % qspiRec_rollupSlots(tier);
+  if (t->write % QSPI_REC_ROLLUP_PER_SECTOR == 0U) {
+    t->erased = 0;
+  }
+  __set_PRIMASK(primask);
+}
+
+/* Public functions ----------------------------------------------------------*/
+
+HAL_StatusTypeDef qspiRec_init(void) {
+  uint8_t id[3] = {0};
+  uint32_t hclk = HAL_RCC_GetHCLKFreq();
+  uint32_t prescaler = (hclk + QSPI_REC_MAX_CLOCK_HZ - 1U) /
+                       QSPI_REC_MAX_CLOCK_HZ;
+
+  ready = 0;
+  hqspi.Instance = QUADSPI;
+  hqspi.Init.ClockPrescaler = (prescaler > 0U) ? prescaler - 1U : 0U;
+  hqspi.Init.FifoThreshold = 4;
+  hqspi.Init.SampleShifting = QSPI_SAMPLE_SHIFTING_HALFCYCLE;
+  hqspi.Init.FlashSize = POSITION_VAL(QSPI_REC_FLASH_SIZE) - 1U;
+  hqspi.Init.ChipSelectHighTime = QSPI_CS_HIGH_TIME_2_CYCLE;
+  hqspi.Init.ClockMode = QSPI_CLOCK_MODE_0;
+  hqspi.Init.FlashID = QSPI_FLASH_ID_1;
+  hqspi.Init.DualFlash = QSPI_DUALFLASH_DISABLE;
+  if (HAL_QSPI_Init(&hqspi) != HAL_OK) {
+    return HAL_ERROR;
+  }
+
+  // Software reset ends any program or erase cut short by a reset
+  if (qspiRec_command(QSPI_REC_CMD_RESET_ENABLE, -1, 0, 0) != HAL_OK ||
+      qspiRec_command(QSPI_REC_CMD_RESET, -1, 0, 0) != HAL_OK) {
+    return HAL_ERROR;
+  }
+  HAL_Delay(1);
+  if (qspiRec_command(QSPI_REC_CMD_READ_ID, -1, 0, sizeof(id)) != HAL_OK ||
+      HAL_QSPI_Receive(&hqspi, id, QSPI_REC_TIMEOUT_MS) != HAL_OK ||
+      id[0] == 0x00U || id[0] == 0xFFU) {
+    return HAL_ERROR;
+  }
+
+  flash_busy = 0;
+  if (qspiRec_scanHistory() != HAL_OK || qspiRec_scanCaptures() != HAL_OK) {
+    return HAL_ERROR;
+  }
+#if QSPI_REC_ROLLUP_ENABLE
+  // The clock goes on after the newest record of any tier
+  clock_s = 0;
+  for (uint8_t tier = 0; tier < QSPI_REC_TIER_COUNT; tier++) {
+    if (qspiRec_scanRollups(tier) != HAL_OK) {
+      return HAL_ERROR;
+    }
+    if (tiers[tier].newest_s != QSPI_REC_ERASED &&
+        tiers[tier].next_s > clock_s) {
+      clock_s = tiers[tier].next_s;
+    }
+  }
+  clock_ms = HAL_GetTick();
+  rollup_dropped = 0;
+#endif
+
+  stage_head = 0;
+  stage_tail = 0;
+  fill_frames = 0;
+  cap_active = 0;
+  memset(&stats_, 0, sizeof(stats_));
+  stats_.history_pages = QSPI_REC_HISTORY_PAGES;
+  __DMB();
+  ready = 1;
+  return HAL_OK;
+}
+
+ADC_FAST_CODE void qspiRec_pushBlock(const uint16_t *block,
+                                     uint32_t frame_count) {
+  ADC_BlockInfo_t info = {0};
+  if (!ready || block == NULL) {
+    return;
+  }
+  analogSensor_getBlockInfo(&info);
+  const uint8_t *map = analogSensor_getBlockChannelMap();
+  uint32_t now = HAL_GetTick();
+
+  // A gap in the frame numbers closes the page being filled
+  if (fill_frames != 0U && info.first_frame != fill_next_frame) {
+    stage[stage_head % QSPI_REC_STAGE_PAGES].frame_count =
+        (uint16_t)fill_frames;
+    __DMB();
+    stage_head = stage_head + 1U;
+    fill_frames = 0;
+  }
+
+  for (uint32_t f = 0; f < frame_count; f++) {
+    QspiRec_Page_t *page = &stage[stage_head % QSPI_REC_STAGE_PAGES];
+    if (fill_frames == 0U) {
+      uint32_t used = stage_head - stage_tail;
+      if (used >= QSPI_REC_STAGE_PAGES) {
+        stats_.frames_dropped += frame_count - f;
+        break;
+      }
+      if (used + 1U > stats_.stage_high_water) {
+        stats_.stage_high_water = used + 1U;
+      }
+      page->first_frame = info.first_frame + f;
+      page->time_ms = now;
+    }
+    const uint16_t *src = &block[f * ADC_CONVERSIONS_CHANNEL_COUNT];
+    uint16_t *dst = &page->samples[fill_frames * ADC_CONVERSIONS_CHANNEL_COUNT];
+    for (uint8_t slot = 0; slot < ADC_CONVERSIONS_CHANNEL_COUNT; slot++) {
+      dst[map[slot]] = src[slot];
+    }
+    if (++fill_frames == QSPI_REC_PAGE_FRAMES) {
+      page->frame_count = (uint16_t)fill_frames;
+      // The page must be complete before the main loop can see it
+      __DMB();
+      stage_head = stage_head + 1U;
+      fill_frames = 0;
+    }
+  }
+  fill_next_frame = info.first_frame + frame_count;
+}
+
+void qspiRec_poll(void) {
+  if (!ready) {
+    return;
+  }
+#if QSPI_REC_ROLLUP_ENABLE
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  qspiRec_rollupAdvance(qspiRec_clockNow());
+  __set_PRIMASK(primask);
+#endif
+  if (!qspiRec_idle()) {
+    return;
+  }
+  uint32_t pending = stage_head - stage_tail;
+
+  // Keep QSPI_REC_ERASE_AHEAD sectors past the write position erased
+  if (qspiRec_seqDiff(erased_until, prog_seq) <
+      QSPI_REC_ERASE_AHEAD * QSPI_REC_PAGES_PER_SECTOR) {
+    if (qspiRec_erase(qspiRec_historyAddr(erased_until)) == HAL_OK) {
+      erased_until = qspiRec_seqAdd(erased_until, QSPI_REC_PAGES_PER_SECTOR);
+    }
+    return;
+  }
+
+  // Pre-erase the next capture slot while the staging ring has room
+  if (slot_erased < QSPI_REC_SLOT_SECTORS &&
+      (cap_active || pending < QSPI_REC_STAGE_PAGES / 2U)) {
+    if (qspiRec_erase(qspiRec_slotAddr(next_slot) +
+                      slot_erased * QSPI_REC_SECTOR_SIZE) == HAL_OK) {
+      slot_erased++;
+    }
+    return;
+  }
+
+  // A commit goes first, then the rollups, unless the history is backing up
+  const int8_t rollup = qspiRec_rollupPending();
+  if (cap_active && slot_erased == QSPI_REC_SLOT_SECTORS &&
+      pending < QSPI_REC_STAGE_PAGES / 2U) {
+    qspiRec_captureStep();
+  } else if (rollup >= 0 && pending < QSPI_REC_STAGE_PAGES / 2U) {
+    qspiRec_rollupStep((uint8_t)rollup);
+  } else if (pending != 0U) {
+    qspiRec_programHistory();
+  }
+}
+
+HAL_StatusTypeDef qspiRec_commitCapture(const ADC_TriggerEvent_t *event,
+                                        const ADC_Frame_t *frames) {
+  if (!ready || event == NULL || frames == NULL ||
+      event->frame_count == 0U ||
+      event->frame_count > ADC_TRIGGER_CAPTURE_FRAMES) {
+    return HAL_ERROR;
+  }
+  if (cap_active) {
+    return HAL_BUSY;
+  }
+
+  memset(&cap_header, 0xFF, sizeof(cap_header));
+  cap_header.magic = QSPI_REC_CAPTURE_MAGIC;
+  cap_header.sequence = has_capture ? newest_capture + 1U : 0U;
+  cap_header.trigger_frame = event->trigger_frame;
+  cap_header.first_frame = event->first_frame;
+  cap_header.timestamp = event->timestamp;
+  cap_header.history_page =
+      qspiRec_seqAdd(prog_seq, stage_head - stage_tail);
+  cap_header.pre_frames = event->pre_frames;
+  cap_header.frame_count = event->frame_count;
+  cap_header.value = event->value;
+  cap_header.channel = event->channel;
+  cap_header.condition = (uint8_t)event->condition;
+  cap_header.frame_size = sizeof(ADC_Frame_t);
+  cap_header.channels = ADC_CONVERSIONS_CHANNEL_COUNT;
+
+  cap_frames = frames;
+  cap_bytes = (uint32_t)event->frame_count * sizeof(ADC_Frame_t);
+  cap_offset = 0;
+  cap_crc = 0;
+#if CRC_UNIT_ENABLE
+  // The frames stay frozen until the commit is done: checksum them by DMA
+  // while the pages program, per page in software if the unit is taken
+  cap_crc_dma =
+      (crcUnit_startDma(CRC_UNIT_CRC32, 0, frames, cap_bytes) == HAL_OK) ? 1U
+                                                                         : 0U;
+#endif
+  cap_step = 0;
+  cap_active = 1;
+  return HAL_OK;
+}
+
+uint8_t qspiRec_isCommitting(void) { return cap_active; }
+
+HAL_StatusTypeDef qspiRec_readHistory(uint32_t age, QspiRec_Page_t *page) {
+  if (page == NULL || !ready || !has_history ||
+      age >= QSPI_REC_HISTORY_PAGES) {
+    return HAL_ERROR;
+  }
+  if (!qspiRec_idle()) {
+    return HAL_BUSY;
+  }
+  uint32_t seq = qspiRec_seqDiff(newest_seq, age);
+  if (qspiRec_read(qspiRec_historyAddr(seq), page, sizeof(*page)) != HAL_OK ||
+      page->sequence != seq ||
+      page->crc != telemetryFrame_crc16((const uint8_t *)page + 2U,
+                                        QSPI_REC_PAGE_SIZE - 2U)) {
+    return HAL_ERROR;
+  }
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef qspiRec_readCapture(uint32_t age,
+                                      QspiRec_CaptureHeader_t *header,
+                                      ADC_Frame_t *frames,
+                                      uint16_t max_frames) {
+  if (header == NULL || !ready || !has_capture ||
+      age >= QSPI_REC_CAPTURE_SLOTS) {
+    return HAL_ERROR;
+  }
+  if (!qspiRec_idle()) {
+    return HAL_BUSY;
+  }
+  uint8_t slot = (uint8_t)((newest_slot + QSPI_REC_CAPTURE_SLOTS - age) %
+                           QSPI_REC_CAPTURE_SLOTS);
+  uint32_t addr = qspiRec_slotAddr(slot);
+  if (qspiRec_read(addr, header, sizeof(*header)) != HAL_OK ||
+      !qspiRec_captureValid(header) ||
+      header->sequence != newest_capture - age) {
+    return HAL_ERROR;
+  }
+  if (frames == NULL) {
+    return HAL_OK;
+  }
+
+  uint16_t n = (header->frame_count < max_frames) ? header->frame_count
+                                                  : max_frames;
+  if (n != 0U && qspiRec_read(addr + QSPI_REC_PAGE_SIZE, frames,
+                              (uint32_t)n * sizeof(ADC_Frame_t)) != HAL_OK) {
+    return HAL_ERROR;
+  }
+  if (n == header->frame_count &&
+      qspiRec_crc32(0, (const uint8_t *)frames,
+                    (uint32_t)n * sizeof(ADC_Frame_t)) != header->data_crc) {
+    return HAL_ERROR;
+  }
+  return HAL_OK;
+}
+
+void qspiRec_addFeatures(const TelemetryFrame_Features_t *features) {
+#if !QSPI_REC_ROLLUP_ENABLE
+  UNUSED(features);
+  return; // no segments in the flash
+#else
+  QspiRec_Rollup_t rec;
+  if (!ready || features == NULL) {
+    return;
+  }
+  const uint32_t now_s = qspiRec_clockAt(features->timestamp);
+
+  // A window is a record of one: its values are min, max and mean
+  memset(&rec, 0, sizeof(rec));
+  rec.time_s = now_s;
+  rec.windows = 1U;
+  rec.channel_mask = features->channel_mask;
+  for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+    for (uint8_t f = 0; f < TELEMETRY_FRAME_FEATURES; f++) {
+      const float v = features->value[ch][f];
+      rec.min[ch][f] = v;
+      rec.max[ch][f] = v;
+      rec.mean[ch][f] = v;
+    }
+  }
+  // Closing and merging as one: no other caller sees half an interval
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  qspiRec_rollupAdvance(now_s);
+  qspiRec_rollupMerge(QSPI_REC_TIER_1S, &rec);
+  __set_PRIMASK(primask);
+#endif
+}
+
+HAL_StatusTypeDef qspiRec_setClock(uint32_t time_s) {
+#if !QSPI_REC_ROLLUP_ENABLE
+  UNUSED(time_s);
+  return HAL_ERROR;
+#else
+  HAL_StatusTypeDef status = HAL_ERROR;
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  if (time_s >= qspiRec_clockNow()) {
+    clock_s = time_s;
+    clock_ms = HAL_GetTick();
+    status = HAL_OK;
+  }
+  __set_PRIMASK(primask);
+  return status;
+#endif
+}
+
+uint32_t qspiRec_getClock(void) {
+#if QSPI_REC_ROLLUP_ENABLE
+  return qspiRec_clockNow();
+#else
+  return 0;
+#endif
+}
+
+HAL_StatusTypeDef qspiRec_queryRollups(QspiRec_Tier_t tier, uint32_t from_s,
+                                       uint32_t to_s,
+                                       QspiRec_RollupQuery_t *query) {
+  if (!QSPI_REC_ROLLUP_ENABLE || !ready || query == NULL ||
+      tier >= QSPI_REC_TIER_COUNT) {
+    return HAL_ERROR;
+  }
+  const uint32_t *index = &rollup_index[qspiRec_rollupFirstSector(tier)];
+  const uint32_t sectors = rollup_sectors[tier];
+  const uint32_t slots = qspiRec_rollupSlots(tier);
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  const uint32_t write = tiers[tier].write;
+
+  // Sectors oldest first: from the writer's, unless it has started it
+  const uint32_t w = write / QSPI_REC_ROLLUP_PER_SECTOR;
+  const uint32_t oldest =
+      (write % QSPI_REC_ROLLUP_PER_SECTOR == 0U) ? w : (w + 1U) % sectors;
+  uint32_t start = sectors; // none
+  for (uint32_t k = 0; k < sectors; k++) {
+    const uint32_t s = (oldest + k) % sectors;
+    if (index[s] == QSPI_REC_ERASED) {
+      continue;
+    }
+    if (start != sectors && index[s] > from_s) {
+      break; // the range starts in the sector before
+    }
+    start = s;
+    if (index[s] >= from_s) {
+      break;
+    }
+  }
+  __set_PRIMASK(primask);
+
+  query->tier = (uint8_t)tier;
+  query->from_s = from_s;
+  query->to_s = to_s;
+  query->left = 0;
+  if (start != sectors && from_s < to_s) {
+    query->slot = start * QSPI_REC_ROLLUP_PER_SECTOR;
+    query->left = (write + slots - query->slot - 1U) % slots + 1U;
+  }
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef qspiRec_nextRollup(QspiRec_RollupQuery_t *query,
+                                     QspiRec_Rollup_t *record) {
+  if (!ready || query == NULL || record == NULL ||
+      query->tier >= QSPI_REC_TIER_COUNT) {
+    return HAL_ERROR;
+  }
+  while (query->left != 0U) {
+    if (!qspiRec_idle()) {
+      return HAL_BUSY;
+    }
+    if (qspiRec_read(qspiRec_rollupAddr(query->tier, query->slot), record,
+                     sizeof(*record)) != HAL_OK) {
+      return HAL_ERROR;
+    }
+    query->slot = (query->slot + 1U) % qspiRec_rollupSlots(query->tier);
+    query->left--;
+    // Records before the range, erased or overwritten meanwhile are passed
+    if (!qspiRec_rollupValid(record, query->tier) ||
+        record->time_s < query->from_s) {
+      continue;
+    }
+    if (record->time_s >= query->to_s) {
+      break;
+    }
+    query->from_s = record->time_s + 1U;
+    return HAL_OK;
+  }
+  query->left = 0;
+  return HAL_ERROR;
+}
+
+HAL_StatusTypeDef qspiRec_getRollupStats(QspiRec_RollupStats_t *stats) {
+  if (stats == NULL) {
+    return HAL_ERROR;
+  }
+  memset(stats, 0, sizeof(*stats));
+  stats->clock_s = qspiRec_getClock();
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  stats->dropped = rollup_dropped;
+  for (uint8_t tier = 0; tier < QSPI_REC_TIER_COUNT; tier++) {
+    const QspiRec_RollupTier_t *t = &tiers[tier];
+    stats->oldest_s[tier] = QSPI_REC_ERASED;
+    stats->newest_s[tier] = QSPI_REC_ERASED;
+    if (!QSPI_REC_ROLLUP_ENABLE) {
+      continue;
+    }
+    const uint32_t *index = &rollup_index[qspiRec_rollupFirstSector(tier)];
+    stats->records[tier] = t->records;
+    stats->capacity[tier] = qspiRec_rollupSlots(tier);
+    stats->newest_s[tier] = t->newest_s;
+    for (uint32_t s = 0; s < rollup_sectors[tier]; s++) {
+      if (index[s] < stats->oldest_s[tier]) {
+        stats->oldest_s[tier] = index[s];
+      }
+    }
+  }
+  __set_PRIMASK(primask);
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef qspiRec_getStats(QspiRec_Stats_t *stats) {
+  if (stats == NULL) {
+    return HAL_ERROR;
+  }
+  *stats = stats_;
+  stats->ready = ready;
+  return HAL_OK;
+}
+
+/* HAL callbacks -------------------------------------------------------------*/
+
+/**
+ * @brief QUADSPI bank 1 pins: PB2 CLK, PB6 NCS, PF8/PF9/PF7/PF6 IO0-IO3
+ */
+void HAL_QSPI_MspInit(QSPI_HandleTypeDef *qspi) {
+  if (qspi->Instance != QUADSPI) {
+    return;
+  }
+  GPIO_InitTypeDef gpio = {0};
+  __HAL_RCC_QSPI_CLK_ENABLE();
+  __HAL_RCC_QSPI_FORCE_RESET();
+  __HAL_RCC_QSPI_RELEASE_RESET();
+  __HAL_RCC_GPIOB_CLK_ENABLE();
+  __HAL_RCC_GPIOF_CLK_ENABLE();
+
+  gpio.Mode = GPIO_MODE_AF_PP;
+  gpio.Pull = GPIO_NOPULL;
+  gpio.Speed = GPIO_SPEED_FREQ_VERY_HIGH;
+  gpio.Alternate = GPIO_AF9_QUADSPI;
+  gpio.Pin = GPIO_PIN_2;
+  HAL_GPIO_Init(GPIOB, &gpio);
+  gpio.Pin = GPIO_PIN_6 | GPIO_PIN_7;
+  HAL_GPIO_Init(GPIOF, &gpio);
+
+  gpio.Alternate = GPIO_AF10_QUADSPI;
+  gpio.Pin = GPIO_PIN_8 | GPIO_PIN_9;
+  HAL_GPIO_Init(GPIOF, &gpio);
+  gpio.Pull = GPIO_PULLUP; // keep the flash deselected during reset
+  gpio.Pin = GPIO_PIN_6;
+  HAL_GPIO_Init(GPIOB, &gpio);
+}
@@ -0,0 +1,468 @@
+/**
+ ******************************************************************************
+ * @file    retained.c
+ * @brief   Implementation of the backup SRAM counters and breadcrumbs
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "retained.h"
+#include <stddef.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define RETAINED_MAGIC 0x52544E44U // "RTND"
+#define RETAINED_VERSION 1U        // bump when the counters change order
+#define RETAINED_BKPSRAM_SIZE 4096U
+#define RETAINED_MARK_MASK (RETAINED_MARKS - 1U)
+#define RETAINED_FAULT_WORDS                                                   \
+  (offsetof(Retained_Fault_t, crc) / sizeof(uint32_t))
+#define RETAINED_VECTACTIVE 0x1FFU   // SCB ICSR: active exception number
+#define RETAINED_C_DEBUGEN 0x1U      // CoreDebug DHCSR: debugger attached
+#define RETAINED_RAM_START RAMDTCM_BASE
+#define RETAINED_RAM_END (SRAM2_BASE + 0x4000U) // DTCM, SRAM1, SRAM2
+
+#if (RETAINED_MARKS & RETAINED_MARK_MASK) != 0U || RETAINED_MARKS < 2U ||      \
+    RETAINED_MARKS > 256U
+#error "RETAINED_MARKS must be a power of two up to 256"
+#endif
+
+#if RETAINED_FAULT_RECORDS < 1U
+#error "RETAINED_FAULT_RECORDS must be at least 1"
+#endif
+
+/* Private types -------------------------------------------------------------*/
+
+/* A counter next to its complement */
+typedef struct {
+  uint32_t value;
+  uint32_t check;
+} Retained_Word_t;
+
+typedef struct {
+  uint32_t magic;
+  uint32_t layout; // size | version << 16
+  uint32_t reserved;
+  uint32_t crc; // CRC-32 of the words above
+  Retained_Word_t counters[RETAINED_COUNTER_COUNT];
+  Retained_Word_t adc[ADC_ERROR_ROWS][ADC_ERROR_KIND_COUNT];
+  Retained_Mark_t marks[RETAINED_MARKS];
+  Retained_Fault_t faults[RETAINED_FAULT_RECORDS];
+} Retained_Block_t;
+
+_Static_assert(sizeof(Retained_Block_t) <= RETAINED_BACKUP_BYTES,
+               "the retained block must fit RETAINED_BACKUP_BYTES");
+_Static_assert(sizeof(Retained_Fault_t) % sizeof(uint32_t) == 0U,
+               "fault records are copied word by word");
+
+/* Private variables ---------------------------------------------------------*/
+
+/* Backup SRAM: NULL until retained_init() */
+static volatile Retained_Block_t *block = NULL;
+static uint16_t mark_seq = 0;
+
+/* Previous boot's breadcrumbs, copied at boot before the ring is reused */
+static Retained_Mark_t previous_marks[RETAINED_MARKS];
+static uint8_t previous_count = 0;
+
+static Retained_Stats_t stats = {0};
+
+static const char *const mark_names[RETAINED_MARK_COUNT] = {
+    [RETAINED_MARK_NONE] = "none",
+    [RETAINED_MARK_PIPELINE] = "pipeline",
+    [RETAINED_MARK_HOUSEKEEPING] = "housekeeping",
+    [RETAINED_MARK_ERROR] = "error"};
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+ * @brief CRC-32 (reflected, 0xEDB88320) in software: the CRC unit may be
+ *        mid-transfer when a fault comes
+ */
+static uint32_t retained_crc32(const volatile uint32_t *words,
+                               uint32_t count) {
+  uint32_t crc = 0xFFFFFFFFU;
+
+  for (uint32_t i = 0; i < count; i++) {
+    crc ^= words[i];
+    for (uint8_t bit = 0; bit < 32U; bit++) {
+      crc = (crc & 1U) ? (crc >> 1) ^ 0xEDB88320U : crc >> 1;
+    }
+  }
+  return ~crc;
+}
+
+static uint32_t retained_layout(void) {
+  return (uint32_t)sizeof(Retained_Block_t) | (RETAINED_VERSION << 16);
+}
+
+/**
+ * @brief Add to a pair, saturating: value first, complement last
+ */
+static inline void retained_addWord(volatile Retained_Word_t *word,
+                                    uint32_t n) {
+  const uint32_t v = word->value;
+  const uint32_t sum = (v + n < v) ? 0xFFFFFFFFU : v + n;
+  word->value = sum;
+  word->check = ~sum;
+}
+
+/**
+ * @brief A pair torn by a reset between its stores goes back to the last
+ *        complete value, the one its complement holds
+ */
+static void retained_repairWord(volatile Retained_Word_t *word) {
+  if (word->value != ~word->check) {
+    word->value = ~word->check;
+    stats.repaired++;
+  }
+}
+
+static void retained_setWord(volatile Retained_Word_t *word, uint32_t v) {
+  word->value = v;
+  word->check = ~v;
+}
+
+static uint8_t retained_markCheck(uint16_t seq, uint8_t id, uint32_t tick,
+                                  uint32_t value) {
+  uint32_t x = seq ^ ((uint32_t)id << 16) ^ tick ^ value;
+  x ^= x >> 16;
+  x ^= x >> 8;
+  return (uint8_t)(x ^ 0xA5U);
+}
+
+static uint8_t retained_markValid(const volatile Retained_Mark_t *mark) {
+  return (uint8_t)(mark->id != RETAINED_MARK_NONE &&
+                   mark->id < RETAINED_MARK_COUNT &&
+                   mark->check == retained_markCheck(mark->seq, mark->id,
+                                                     mark->tick, mark->value));
+}
+
+/**
+ * @brief Copy the previous boot's breadcrumbs, oldest first: the newest
+ *        sequence number, relative to any mark, ends a window of the ring
+ */
+static void retained_keepMarks(const volatile Retained_Block_t *b) {
+  uint8_t found = 0;
+  uint16_t ref = 0;
+  int16_t newest = 0;
+
+  for (uint32_t i = 0; i < RETAINED_MARKS; i++) {
+    const volatile Retained_Mark_t *mark = &b->marks[i];
+    if (!retained_markValid(mark) || (mark->seq & RETAINED_MARK_MASK) != i) {
+      continue;
+    }
+    if (!found) {
+      ref = mark->seq;
+      found = 1;
+    }
+    const int16_t delta = (int16_t)(uint16_t)(mark->seq - ref);
+    if (delta > newest) {
+      newest = delta;
+    }
+  }
+  previous_count = 0;
+  if (!found) {
+    return;
+  }
+  const uint16_t first =
+      (uint16_t)(ref + newest - (int32_t)RETAINED_MARKS + 1);
+  for (uint32_t k = 0; k < RETAINED_MARKS; k++) {
+    const uint16_t seq = (uint16_t)(first + k);
+    const volatile Retained_Mark_t *mark = &b->marks[seq & RETAINED_MARK_MASK];
+    if (retained_markValid(mark) && mark->seq == seq) {
+      previous_marks[previous_count].seq = mark->seq;
+      previous_marks[previous_count].id = mark->id;
+      previous_marks[previous_count].check = mark->check;
+      previous_marks[previous_count].tick = mark->tick;
+      previous_marks[previous_count].value = mark->value;
+      previous_count++;
+    }
+  }
+}
+
+/**
+ * @brief Counter of the reset cause, the most specific flag first (a
+ *        power-on also sets PINRSTF)
+ */
+static Retained_Counter_t retained_resetCause(uint32_t flags) {
+  if (flags & RCC_CSR_LPWRRSTF) {
+    return RETAINED_RESET_LOWPOWER;
+  }
+  if (flags & RCC_CSR_WWDGRSTF) {
+    return RETAINED_RESET_WWDG;
+  }
+  if (flags & RCC_CSR_IWDGRSTF) {
+    return RETAINED_RESET_IWDG;
+  }
+  if (flags & RCC_CSR_SFTRSTF) {
+    return RETAINED_RESET_SOFTWARE;
+  }
+  if (flags & (RCC_CSR_PORRSTF | RCC_CSR_BORRSTF)) {
+    return RETAINED_RESET_POWER;
+  }
+  return RETAINED_RESET_PIN;
+}
+
+/**
+ * @brief Frame of 8 words inside the RAM, word aligned; a stack overflow
+ *        leaves SP outside it
+ */
+static uint8_t retained_stackUsable(const uint32_t *frame) {
+  const uint32_t sp = (uint32_t)frame;
+  return (uint8_t)((sp & 3U) == 0U && sp >= RETAINED_RAM_START &&
+                   sp <= RETAINED_RAM_END - 8U * sizeof(uint32_t));
+}
+
+/* Public functions ----------------------------------------------------------*/
+
+HAL_StatusTypeDef retained_init(void) {
+  const uint32_t reset_flags = RCC->CSR;
+  HAL_StatusTypeDef status = HAL_OK;
+
+  __HAL_RCC_PWR_CLK_ENABLE();
+  HAL_PWR_EnableBkUpAccess();
+  __HAL_RCC_BKPSRAM_CLK_ENABLE();
+  if (HAL_PWREx_EnableBkUpReg() != HAL_OK) {
+    status = HAL_TIMEOUT;
+  }
+
+  volatile Retained_Block_t *b =
+      (volatile Retained_Block_t *)(BKPSRAM_BASE + RETAINED_BKPSRAM_SIZE -
+                                    RETAINED_BACKUP_BYTES);
+  stats.repaired = 0;
+  if (b->magic == RETAINED_MAGIC && b->layout == retained_layout() &&
+      b->crc == retained_crc32(&b->magic, 3U)) {
+    for (uint32_t i = 0; i < RETAINED_COUNTER_COUNT; i++) {
+      retained_repairWord(&b->counters[i]);
+    }
+    for (uint32_t r = 0; r < ADC_ERROR_ROWS; r++) {
+      for (uint32_t k = 0; k < ADC_ERROR_KIND_COUNT; k++) {
+        retained_repairWord(&b->adc[r][k]);
+      }
+    }
+    retained_keepMarks(b);
+    stats.restored = 1;
+  } else {
+    // First power-up, VBAT lost or another layout: content undefined
+    volatile uint32_t *words = (volatile uint32_t *)b;
+    for (uint32_t i = 0; i < sizeof(Retained_Block_t) / sizeof(uint32_t);
+         i++) {
+      words[i] = 0;
+    }
+    for (uint32_t i = 0; i < RETAINED_COUNTER_COUNT; i++) {
+      retained_setWord(&b->counters[i], 0);
+    }
+    for (uint32_t r = 0; r < ADC_ERROR_ROWS; r++) {
+      for (uint32_t k = 0; k < ADC_ERROR_KIND_COUNT; k++) {
+        retained_setWord(&b->adc[r][k], 0);
+      }
+    }
+    b->layout = retained_layout();
+    b->reserved = 0;
+    b->magic = RETAINED_MAGIC;
+    b->crc = retained_crc32(&b->magic, 3U);
+    previous_count = 0;
+    stats.restored = 0;
+  }
+  for (uint32_t i = 0; i < RETAINED_MARKS; i++) {
+    b->marks[i].id = RETAINED_MARK_NONE;
+  }
+  mark_seq = 0;
+  stats.vbat = (uint8_t)(status == HAL_OK);
+  stats.reset_flags = reset_flags;
+  block = b;
+
+  retained_add(RETAINED_BOOTS, 1U);
+  retained_add(retained_resetCause(reset_flags), 1U);
+  return status;
+}
+
+void retained_add(Retained_Counter_t counter, uint32_t n) {
+  volatile Retained_Block_t *const b = block;
+  if (b == NULL || (uint32_t)counter >= RETAINED_COUNTER_COUNT) {
+    return;
+  }
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  retained_addWord(&b->counters[counter], n);
+  __set_PRIMASK(primask);
+}
+
+void retained_countAdcError(uint8_t row, ADC_ErrorKind_t kind) {
+  volatile Retained_Block_t *const b = block;
+  if (b == NULL || row >= ADC_ERROR_ROWS ||
+      (uint32_t)kind >= ADC_ERROR_KIND_COUNT) {
+    return;
+  }
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  retained_addWord(&b->adc[row][kind], 1U);
+  retained_addWord(&b->counters[RETAINED_ERRORS], 1U);
+  __set_PRIMASK(primask);
+}
+
+uint32_t retained_get(Retained_Counter_t counter) {
+  const volatile Retained_Block_t *const b = block;
+  if (b == NULL || (uint32_t)counter >= RETAINED_COUNTER_COUNT) {
+    return 0;
+  }
+  return b->counters[counter].value;
+}
+
+HAL_StatusTypeDef retained_getAdcErrors(ADC_ErrorInfo_t *error_info) {
+  if (error_info == NULL) {
+    return HAL_ERROR;
+  }
+  const volatile Retained_Block_t *const b = block;
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  for (uint32_t r = 0; r < ADC_ERROR_ROWS; r++) {
+    for (uint32_t k = 0; k < ADC_ERROR_KIND_COUNT; k++) {
+      error_info->counts[r][k] = (b != NULL) ? b->adc[r][k].value : 0U;
+    }
+  }
+  error_info->total_errors =
+      (b != NULL) ? b->counters[RETAINED_ERRORS].value : 0U;
+  __set_PRIMASK(primask);
+  error_info->last_error_status = HAL_OK;
+  error_info->last_failed_channel = 0xFF;
+  return HAL_OK;
+}
+
+void retained_mark(Retained_MarkId_t id, uint32_t value) {
+  volatile Retained_Block_t *const b = block;
+  if (b == NULL || id == RETAINED_MARK_NONE || id >= RETAINED_MARK_COUNT) {
+    return;
+  }
+  const uint16_t seq = mark_seq++;
+  const uint32_t tick = HAL_GetTick();
+  volatile Retained_Mark_t *mark = &b->marks[seq & RETAINED_MARK_MASK];
+
+  // Invalid while written: id cleared first, set last
+  mark->id = RETAINED_MARK_NONE;
+  mark->seq = seq;
+  mark->tick = tick;
+  mark->value = value;
+  mark->check = retained_markCheck(seq, (uint8_t)id, tick, value);
+  mark->id = (uint8_t)id;
+}
+
+uint8_t retained_getPreviousMarks(Retained_Mark_t *marks) {
+  if (marks == NULL) {
+    return 0;
+  }
+  for (uint8_t i = 0; i < previous_count; i++) {
+    marks[i] = previous_marks[i];
+  }
+  return previous_count;
+}
+
+HAL_StatusTypeDef retained_getFault(uint8_t index, Retained_Fault_t *fault) {
+  if (fault == NULL) {
+    return HAL_ERROR;
+  }
+  const volatile Retained_Block_t *const b = block;
+  if (b == NULL) {
+    return HAL_BUSY;
+  }
+  const uint32_t written = b->counters[RETAINED_FAULTS].value;
+  if (index >= written || index >= RETAINED_FAULT_RECORDS) {
+    return HAL_BUSY;
+  }
+  const volatile uint32_t *src =
+      (const volatile uint32_t *)&b->faults[(written - 1U - index) %
+                                            RETAINED_FAULT_RECORDS];
+  uint32_t *dst = (uint32_t *)fault;
+  for (uint32_t i = 0; i < sizeof(Retained_Fault_t) / sizeof(uint32_t); i++) {
+    dst[i] = src[i];
+  }
+  return (retained_crc32(dst, RETAINED_FAULT_WORDS) == fault->crc) ? HAL_OK
+                                                                   : HAL_BUSY;
+}
+
+const char *retained_getMarkName(Retained_MarkId_t id) {
+  return (id < RETAINED_MARK_COUNT) ? mark_names[id] : "?";
+}
+
+void retained_clear(void) {
+  volatile Retained_Block_t *const b = block;
+  if (b == NULL) {
+    return;
+  }
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  for (uint32_t i = 0; i < RETAINED_COUNTER_COUNT; i++) {
+    if (i != RETAINED_BOOTS) {
+      retained_setWord(&b->counters[i], 0);
+    }
+  }
+  for (uint32_t r = 0; r < ADC_ERROR_ROWS; r++) {
+    for (uint32_t k = 0; k < ADC_ERROR_KIND_COUNT; k++) {
+      retained_setWord(&b->adc[r][k], 0);
+    }
+  }
+  for (uint32_t i = 0; i < RETAINED_FAULT_RECORDS; i++) {
+    b->faults[i].crc = 0;
+  }
+  __set_PRIMASK(primask);
+}
+
+HAL_StatusTypeDef retained_getStats(Retained_Stats_t *out) {
+  if (out == NULL) {
+    return HAL_ERROR;
+  }
+  Retained_Fault_t fault;
+  uint8_t faults = 0;
+  for (uint8_t i = 0; i < RETAINED_FAULT_RECORDS; i++) {
+    if (retained_getFault(i, &fault) == HAL_OK) {
+      faults++;
+    }
+  }
+  *out = stats;
+  out->marks = previous_count;
+  out->faults = faults;
+  return HAL_OK;
+}
+
+void retained_fault(const uint32_t *frame, uint32_t exc_return) {
+  volatile Retained_Block_t *const b = block;
+
+  __disable_irq();
+  if (b != NULL) {
+    Retained_Fault_t rec = {0};
+    rec.kind = SCB->ICSR & RETAINED_VECTACTIVE;
+    rec.boot = b->counters[RETAINED_BOOTS].value;
+    rec.tick = HAL_GetTick();
+    rec.exc_return = exc_return;
+    rec.sp = (uint32_t)frame;
+    if (retained_stackUsable(frame)) {
+      rec.lr = frame[5];
+      rec.pc = frame[6];
+      rec.xpsr = frame[7];
+    }
+    rec.cfsr = SCB->CFSR;
+    rec.hfsr = SCB->HFSR;
+    rec.mmfar = SCB->MMFAR;
+    rec.bfar = SCB->BFAR;
+    rec.crc = retained_crc32((const uint32_t *)&rec, RETAINED_FAULT_WORDS);
+
+    const uint32_t written = b->counters[RETAINED_FAULTS].value;
+    volatile uint32_t *dst = (volatile uint32_t *)&b->faults[
+        written % RETAINED_FAULT_RECORDS];
+    const uint32_t *src = (const uint32_t *)&rec;
+    for (uint32_t i = 0; i < sizeof(Retained_Fault_t) / sizeof(uint32_t);
+         i++) {
+      dst[i] = src[i];
+    }
+    retained_addWord(&b->counters[RETAINED_FAULTS], 1U);
+    __DSB();
+  }
+#if RETAINED_FAULT_RESET
+  if ((CoreDebug->DHCSR & RETAINED_C_DEBUGEN) == 0U) {
+    NVIC_SystemReset();
+  }
+#endif
+  while (1) {
+  }
+}
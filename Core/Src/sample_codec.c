@@ -0,0 +1,254 @@
+/**
+ ******************************************************************************
+ * @file    sample_codec.c
+ * @brief   Implementation of the fixed-predictor Rice sample codec
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "sample_codec.h"
+#include "adc_sections.h"
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define SAMPLE_CODEC_BITS 12U
+#define SAMPLE_CODEC_MAX_CODE 4095U
+#define SAMPLE_CODEC_MIDSCALE 2048
+#define SAMPLE_CODEC_MAX_ORDER 2U
+#define SAMPLE_CODEC_ESCAPE_BITS 16U
+#define SAMPLE_CODEC_MAX_K 14U
+
+/* Private types -------------------------------------------------------------*/
+typedef struct {
+  uint8_t *p;
+  uint32_t acc;
+  uint32_t bits; // pending bits in acc, < 8 between calls
+} SampleCodec_Writer_t;
+
+typedef struct {
+  const uint8_t *p;
+  const uint8_t *end;
+  uint32_t acc;
+  uint32_t bits;
+  uint8_t overrun;
+} SampleCodec_Reader_t;
+
+/* Private variables ---------------------------------------------------------*/
+static SampleCodec_Stats_t stats_ = {0};
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+ * @brief Append n <= 25 bits, MSB first
+ */
+static inline void sampleCodec_put(SampleCodec_Writer_t *w, uint32_t value,
+                                   uint32_t n) {
+  w->acc = (w->acc << n) | value;
+  w->bits += n;
+  while (w->bits >= 8U) {
+    w->bits -= 8U;
+    *w->p++ = (uint8_t)(w->acc >> w->bits);
+  }
+}
+
+static inline uint32_t sampleCodec_get(SampleCodec_Reader_t *r, uint32_t n) {
+  while (r->bits < n) {
+    if (r->p >= r->end) {
+      r->overrun = 1;
+      return 0;
+    }
+    r->acc = (r->acc << 8) | *r->p++;
+    r->bits += 8U;
+  }
+  r->bits -= n;
+  return (r->acc >> r->bits) & ((1UL << n) - 1U);
+}
+
+static inline int32_t sampleCodec_residual(const int16_t *x, uint32_t n,
+                                           uint32_t order) {
+  if (order == 0U) {
+    return (int32_t)x[n] - SAMPLE_CODEC_MIDSCALE;
+  }
+  if (order == 1U) {
+    return (int32_t)x[n] - x[n - 1U];
+  }
+  return (int32_t)x[n] - 2 * (int32_t)x[n - 1U] + x[n - 2U];
+}
+
+static inline uint32_t sampleCodec_zigzag(int32_t e) {
+  return (e >= 0) ? (uint32_t)e << 1 : ((uint32_t)(-e) << 1) - 1U;
+}
+
+/* Public functions ----------------------------------------------------------*/
+
+ADC_FAST_CODE HAL_StatusTypeDef sampleCodec_encode(const uint16_t *samples,
+                                                   uint32_t count,
+                                                   uint32_t stride,
+                                                   uint8_t *out, uint32_t cap,
+                                                   uint32_t *out_len) {
+  return sampleCodec_encodeCounted(samples, count, stride, out, cap, out_len,
+                                   &stats_);
+}
+
+ADC_FAST_CODE HAL_StatusTypeDef
+sampleCodec_encodeCounted(const uint16_t *samples, uint32_t count,
+                          uint32_t stride, uint8_t *out, uint32_t cap,
+                          uint32_t *out_len, SampleCodec_Stats_t *stats) {
+  int16_t x[SAMPLE_CODEC_MAX_SAMPLES];
+  uint32_t sum[SAMPLE_CODEC_MAX_ORDER + 1U] = {0};
+
+  if (samples == NULL || out == NULL || out_len == NULL || count == 0U ||
+      count > SAMPLE_CODEC_MAX_SAMPLES || stride == 0U) {
+    return HAL_ERROR;
+  }
+
+  // Gather the channel; score all three predictors in the same pass
+  for (uint32_t n = 0; n < count; n++) {
+    uint16_t v = samples[n * stride];
+    x[n] = (int16_t)((v > SAMPLE_CODEC_MAX_CODE) ? SAMPLE_CODEC_MAX_CODE : v);
+    for (uint32_t order = 0; order <= SAMPLE_CODEC_MAX_ORDER && order <= n;
+         order++) {
+      int32_t e = sampleCodec_residual(x, n, order);
+      sum[order] += (uint32_t)((e < 0) ? -e : e);
+    }
+  }
+  uint32_t order = 0;
+  for (uint32_t o = 1; o <= SAMPLE_CODEC_MAX_ORDER && o < count; o++) {
+    // Normalise to the same residual count before comparing
+    if ((uint64_t)sum[o] * (count - order) < (uint64_t)sum[order] * (count - o)) {
+      order = o;
+    }
+  }
+
+  // Rice parameter: 2^k close to the mean zigzag value (2 * mean |e|)
+  uint32_t residuals = count - order;
+  uint32_t k = 0;
+  while (k < SAMPLE_CODEC_MAX_K &&
+         ((uint64_t)residuals << (k + 1U)) <= 2ULL * sum[order]) {
+    k++;
+  }
+
+  // Exact size, to fall back to verbatim when Rice does not pay off
+  uint32_t bits = order * SAMPLE_CODEC_BITS;
+  for (uint32_t n = order; n < count; n++) {
+    uint32_t q = sampleCodec_zigzag(sampleCodec_residual(x, n, order)) >> k;
+    bits += (q < SAMPLE_CODEC_ESCAPE) ? q + 1U + k
+                                      : SAMPLE_CODEC_ESCAPE +
+                                            SAMPLE_CODEC_ESCAPE_BITS;
+  }
+  uint8_t verbatim = (bits >= count * SAMPLE_CODEC_BITS);
+  if (verbatim) {
+    bits = count * SAMPLE_CODEC_BITS;
+  }
+  uint32_t len = 1U + (bits + 7U) / 8U;
+  if (len > cap) {
+    return HAL_ERROR;
+  }
+
+  SampleCodec_Writer_t w = {.p = out, .acc = 0, .bits = 0};
+  if (verbatim) {
+    *w.p++ = SAMPLE_CODEC_VERBATIM;
+    for (uint32_t n = 0; n < count; n++) {
+      sampleCodec_put(&w, (uint32_t)x[n], SAMPLE_CODEC_BITS);
+    }
+  } else {
+    *w.p++ = (uint8_t)(order << 4 | k);
+    for (uint32_t n = 0; n < order; n++) {
+      sampleCodec_put(&w, (uint32_t)x[n], SAMPLE_CODEC_BITS);
+    }
+    uint32_t low_mask = (1UL << k) - 1U;
+    for (uint32_t n = order; n < count; n++) {
+      uint32_t u = sampleCodec_zigzag(sampleCodec_residual(x, n, order));
+      uint32_t q = u >> k;
+      if (q < SAMPLE_CODEC_ESCAPE) {
+        // q ones and the terminating zero, then the low bits
+        sampleCodec_put(&w, ((1UL << q) - 1U) << 1, q + 1U);
+        sampleCodec_put(&w, u & low_mask, k);
+      } else {
+        sampleCodec_put(&w, (1UL << SAMPLE_CODEC_ESCAPE) - 1U,
+                        SAMPLE_CODEC_ESCAPE);
+        sampleCodec_put(&w, u, SAMPLE_CODEC_ESCAPE_BITS);
+      }
+    }
+  }
+  if (w.bits != 0U) {
+    sampleCodec_put(&w, 0U, 8U - w.bits);
+  }
+
+  *out_len = len;
+  if (stats == NULL) {
+    return HAL_OK;
+  }
+  stats->runs++;
+  stats->samples += count;
+  stats->bytes += len;
+  if (verbatim) {
+    stats->verbatim_runs++;
+  } else {
+    stats->order_runs[order]++;
+  }
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef sampleCodec_decode(const uint8_t *in, uint32_t len,
+                                     uint32_t count, uint16_t *samples,
+                                     uint32_t stride) {
+  if (in == NULL || samples == NULL || len == 0U || count == 0U ||
+      count > SAMPLE_CODEC_MAX_SAMPLES || stride == 0U) {
+    return HAL_ERROR;
+  }
+  uint32_t order = in[0] >> 4;
+  uint32_t k = in[0] & 0x0FU;
+  SampleCodec_Reader_t r = {.p = &in[1], .end = &in[len]};
+
+  if (k == SAMPLE_CODEC_VERBATIM) {
+    for (uint32_t n = 0; n < count; n++) {
+      samples[n * stride] = (uint16_t)sampleCodec_get(&r, SAMPLE_CODEC_BITS);
+    }
+    return r.overrun ? HAL_ERROR : HAL_OK;
+  }
+  if (order > SAMPLE_CODEC_MAX_ORDER || order > count ||
+      k > SAMPLE_CODEC_MAX_K) {
+    return HAL_ERROR;
+  }
+
+  int32_t prev1 = 0;
+  int32_t prev2 = 0;
+  for (uint32_t n = 0; n < count; n++) {
+    int32_t x;
+    if (n < order) {
+      x = (int32_t)sampleCodec_get(&r, SAMPLE_CODEC_BITS);
+    } else {
+      uint32_t q = 0;
+      while (q < SAMPLE_CODEC_ESCAPE && sampleCodec_get(&r, 1U) != 0U &&
+             !r.overrun) {
+        q++;
+      }
+      uint32_t u = (q < SAMPLE_CODEC_ESCAPE)
+                       ? (q << k) | sampleCodec_get(&r, k)
+                       : sampleCodec_get(&r, SAMPLE_CODEC_ESCAPE_BITS);
+      int32_t e = (u & 1U) ? -(int32_t)((u + 1U) >> 1) : (int32_t)(u >> 1);
+      x = (order == 0U)   ? e + SAMPLE_CODEC_MIDSCALE
+          : (order == 1U) ? e + prev1
+                          : e + 2 * prev1 - prev2;
+    }
+    if (r.overrun || x < 0 || x > (int32_t)SAMPLE_CODEC_MAX_CODE) {
+      return HAL_ERROR;
+    }
+    samples[n * stride] = (uint16_t)x;
+    prev2 = prev1;
+    prev1 = x;
+  }
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef sampleCodec_getStats(SampleCodec_Stats_t *stats) {
+  if (stats == NULL) {
+    return HAL_ERROR;
+  }
+  *stats = stats_;
+  return HAL_OK;
+}
+
+void sampleCodec_resetStats(void) { memset(&stats_, 0, sizeof(stats_)); }
@@ -0,0 +1,268 @@
+/**
+ ******************************************************************************
+ * @file    scan_jitter.c
+ * @brief   Implementation of the scan trigger capture on TIM3
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "scan_jitter.h"
+#include "adc_conversions.h"
+#include "adc_sections.h"
+#include "tach.h"
+#include "timebase.h"
+#include <math.h>
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define SCAN_JITTER_MASK (SCAN_JITTER_STAMPS - 1U)
+#define SCAN_JITTER_MAX_TICKS 0x8000U // an interval fits 15 bits of TIM3
+#define SCAN_JITTER_PI 3.14159265f
+
+#if (SCAN_JITTER_STAMPS & SCAN_JITTER_MASK) != 0U
+#error "SCAN_JITTER_STAMPS must be a power of two"
+#endif
+
+#if SCAN_JITTER_ENABLE && TACH_ENABLE
+#error "SCAN_JITTER_ENABLE and TACH_ENABLE both take TIM3"
+#endif
+
+/* Private variables ---------------------------------------------------------*/
+
+/* In DTCM: written by DMA1 through the AHB slave port, never cached */
+static uint16_t stamps[SCAN_JITTER_STAMPS] ADC_FAST_BSS;
+
+static DMA_HandleTypeDef hdma_jitter;
+static uint8_t running = 0;
+static uint16_t prescaler = 0;  // TIM3 PSC + 1
+static uint32_t period = 0;     // TIM2 period it was chosen for
+static uint32_t read_pos = 0;   // next stamp to fold in
+static uint64_t last_poll = 0;  // timebase
+static uint8_t have_last = 0;
+static uint16_t last_stamp = 0;
+static uint32_t frame_base = 0; // frames delivered at the start
+static uint32_t triggers = 0;
+static uint32_t overruns = 0;
+
+/* Window, as deviations from its first interval */
+static uint32_t ref_ticks = 0;
+static uint32_t intervals = 0;
+static uint32_t min_ticks = 0;
+static uint32_t max_ticks = 0;
+static int64_t dev_sum = 0;
+static uint64_t dev_sq = 0;
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+ * @brief Input clock of TIM2 and TIM3 (2x PCLK1 when APB1 is divided)
+ */
+static uint32_t scanJitter_clockHz(void) {
+  uint32_t clk = HAL_RCC_GetPCLK1Freq();
+  if ((RCC->CFGR & RCC_CFGR_PPRE1) != RCC_HCLK_DIV1) {
+    clk *= 2U;
+  }
+  return clk;
+}
+
+/**
+ * @brief TIM2 scan period in timer clocks
+ */
+static uint32_t scanJitter_scanPeriod(void) {
+  return (TIM2->PSC + 1U) * (TIM2->ARR + 1U);
+}
+
+/**
+ * @brief Frames the DMA has delivered, by the newest block
+ */
+static uint32_t scanJitter_frames(void) {
+  ADC_BlockInfo_t info;
+  if (analogSensor_getBlockInfo(&info) != HAL_OK) {
+    return 0;
+  }
+  return info.first_frame + info.frame_count;
+}
+
+static void scanJitter_clearWindow(void) {
+  intervals = 0;
+  ref_ticks = 0;
+  min_ticks = UINT32_MAX;
+  max_ticks = 0;
+  dev_sum = 0;
+  dev_sq = 0;
+}
+
+/**
+ * @brief TIM3 prescaler for a TIM2 period: an interval fits 15 bits
+ */
+static uint16_t scanJitter_prescalerFor(uint32_t clocks) {
+  return (uint16_t)((clocks - 1U) / SCAN_JITTER_MAX_TICKS + 1U);
+}
+
+static void scanJitter_addInterval(uint32_t ticks) {
+  if (intervals == 0U) {
+    ref_ticks = ticks;
+  }
+  const int64_t dev = (int64_t)ticks - (int64_t)ref_ticks;
+  dev_sum += dev;
+  dev_sq += (uint64_t)(dev * dev);
+  min_ticks = (ticks < min_ticks) ? ticks : min_ticks;
+  max_ticks = (ticks > max_ticks) ? ticks : max_ticks;
+  intervals++;
+}
+
+/* Public functions ----------------------------------------------------------*/
+
+HAL_StatusTypeDef scanJitter_start(void) {
+#if !SCAN_JITTER_ENABLE
+  return HAL_ERROR; // TIM3 may belong to the tachometer
+#endif
+  if ((TIM2->CR1 & TIM_CR1_CEN) == 0U) {
+    return HAL_BUSY;
+  }
+  scanJitter_stop();
+
+  period = scanJitter_scanPeriod();
+  prescaler = scanJitter_prescalerFor(period);
+  __HAL_RCC_TIM3_CLK_ENABLE();
+  TIM3->CR1 = 0;
+  TIM3->PSC = prescaler - 1U;
+  TIM3->ARR = 0xFFFFU;
+  TIM3->SMCR = TIM_TS_ITR1;          // TRGI = TIM2 TRGO, no slave mode
+  TIM3->CCMR1 = TIM_CCMR1_CC1S;      // IC1 on TRC
+  TIM3->CCER = TIM_CCER_CC1E;
+  TIM3->EGR = TIM_EGR_UG;            // load PSC now
+  TIM3->SR = 0;
+
+  // One half-word per capture, round the buffer forever
+  __HAL_RCC_DMA1_CLK_ENABLE();
+  hdma_jitter.Instance = DMA1_Stream4;
+  hdma_jitter.Init.Channel = DMA_CHANNEL_5;
+  hdma_jitter.Init.Direction = DMA_PERIPH_TO_MEMORY;
+  hdma_jitter.Init.PeriphInc = DMA_PINC_DISABLE;
+  hdma_jitter.Init.MemInc = DMA_MINC_ENABLE;
+  hdma_jitter.Init.PeriphDataAlignment = DMA_PDATAALIGN_HALFWORD;
+  hdma_jitter.Init.MemDataAlignment = DMA_MDATAALIGN_HALFWORD;
+  hdma_jitter.Init.Mode = DMA_CIRCULAR;
+  hdma_jitter.Init.Priority = DMA_PRIORITY_LOW;
+  hdma_jitter.Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+  if (HAL_DMA_Init(&hdma_jitter) != HAL_OK ||
+      HAL_DMA_Start(&hdma_jitter, (uint32_t)&TIM3->CCR1, (uint32_t)stamps,
+                    SCAN_JITTER_STAMPS) != HAL_OK) {
+    return HAL_ERROR;
+  }
+
+  read_pos = 0;
+  have_last = 0;
+  triggers = 0;
+  overruns = 0;
+  scanJitter_clearWindow();
+  frame_base = scanJitter_frames();
+  last_poll = timebase_now();
+  TIM3->DIER = TIM_DIER_CC1DE;
+  TIM3->CR1 |= TIM_CR1_CEN;
+  running = 1;
+  return HAL_OK;
+}
+
+void scanJitter_stop(void) {
+  if (!running) {
+    return;
+  }
+  scanJitter_poll();
+  TIM3->CR1 &= ~TIM_CR1_CEN;
+  TIM3->DIER = 0;
+  (void)HAL_DMA_Abort(&hdma_jitter);
+  running = 0;
+}
+
+void scanJitter_poll(void) {
+  if (!running) {
+    return;
+  }
+  const uint64_t now = timebase_now();
+  const uint32_t write =
+      (SCAN_JITTER_STAMPS - hdma_jitter.Instance->NDTR) & SCAN_JITTER_MASK;
+
+  // Late: the buffer may have lapped since the last poll
+  const uint64_t clocks = (now - last_poll) * scanJitter_clockHz() /
+                          TIMEBASE_TICK_HZ;
+  last_poll = now;
+  const uint64_t lap =
+      (uint64_t)scanJitter_scanPeriod() * (SCAN_JITTER_STAMPS - 1U);
+  if (clocks >= lap) {
+    overruns++;
+    have_last = 0;
+    read_pos = write;
+    frame_base = scanJitter_frames() - triggers; // the lag starts over
+    return;
+  }
+
+  // A new rate (not the one-tick dither of time_sync.h): new window
+  const uint32_t now_period = scanJitter_scanPeriod();
+  const uint32_t change =
+      (now_period > period) ? now_period - period : period - now_period;
+  if (change > period / 64U) {
+    period = now_period;
+    prescaler = scanJitter_prescalerFor(period);
+    TIM3->PSC = prescaler - 1U;
+    TIM3->EGR = TIM_EGR_UG;
+    scanJitter_clearWindow();
+    have_last = 0;
+    read_pos = write; // stamps of the old rate and scale
+    frame_base = scanJitter_frames() - triggers;
+    return;
+  }
+
+  for (; read_pos != write; read_pos = (read_pos + 1U) & SCAN_JITTER_MASK) {
+    const uint16_t stamp = stamps[read_pos];
+    if (have_last) {
+      scanJitter_addInterval((uint16_t)(stamp - last_stamp));
+    }
+    last_stamp = stamp;
+    have_last = 1;
+    triggers++;
+  }
+}
+
+void scanJitter_resetWindow(void) { scanJitter_clearWindow(); }
+
+HAL_StatusTypeDef scanJitter_getStats(ScanJitter_Stats_t *stats) {
+  if (stats == NULL) {
+    return HAL_ERROR;
+  }
+  memset(stats, 0, sizeof(*stats));
+  const float clk = (float)scanJitter_clockHz();
+  const uint16_t psc = (prescaler != 0U) ? prescaler : 1U;
+  const float ns_per_tick = 1e9f * (float)psc / clk;
+  stats->running = running;
+  stats->tick_hz = scanJitter_clockHz() / psc;
+  stats->nominal_ticks = scanJitter_scanPeriod() / psc;
+  stats->triggers = triggers;
+  stats->lag = (int32_t)(triggers - (scanJitter_frames() - frame_base));
+  stats->overruns = overruns;
+  stats->intervals = intervals;
+  if (intervals == 0U) {
+    return HAL_OK;
+  }
+
+  // Sums of deviations from the first interval: exact in 64 bits
+  const int64_t n = intervals;
+  const float mean_dev = (float)dev_sum / (float)n;
+  const float var =
+      (float)(n * (int64_t)dev_sq - dev_sum * dev_sum) / ((float)n * (float)n);
+  stats->min_ticks = min_ticks;
+  stats->max_ticks = max_ticks;
+  stats->mean_ns = ((float)ref_ticks + mean_dev) * ns_per_tick;
+  stats->rms_ns = sqrtf(var) * ns_per_tick;
+  stats->pp_ns = (float)(max_ticks - min_ticks) * ns_per_tick;
+
+  // No better than the stamps can show: one tick, uniform, is 1/sqrt(12)
+  const float floor_ns = ns_per_tick / sqrtf(12.0f);
+  const float sigma_s =
+      1e-9f * ((stats->rms_ns > floor_ns) ? stats->rms_ns : floor_ns);
+  const float tone_hz = 0.5e9f / stats->mean_ns;
+  stats->snr_db = -20.0f * log10f(2.0f * SCAN_JITTER_PI * tone_hz * sigma_s);
+  return HAL_OK;
+}
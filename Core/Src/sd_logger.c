@@ -0,0 +1,540 @@
+/**
+ ******************************************************************************
+ * @file    sd_logger.c
+ * @brief   Implementation of the raw SD card block recorder
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "sd_logger.h"
+#include "adc_sections.h"
+#include "dma_tuning.h"
+#include "timebase.h"
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define SD_LOGGER_DATA_BYTES (ADC_CONVERSIONS_BLOCK_SAMPLES * 2U)
+#define SD_LOGGER_RECORD_SECTORS                                               \
+  (1U + SD_LOGGER_DATA_BYTES / SD_LOGGER_SECTOR_SIZE)
+#define SD_LOGGER_IO_TIMEOUT_MS 250U
+#define SD_LOGGER_MAX_RETRIES 3U // consecutive failed writes before giving up
+
+_Static_assert(SD_LOGGER_DATA_BYTES % SD_LOGGER_SECTOR_SIZE == 0U,
+               "a DMA block must fill whole sectors");
+_Static_assert(sizeof(SdLogger_Index_t) <= SD_LOGGER_SECTOR_SIZE,
+               "the index must fit one sector");
+_Static_assert(sizeof(SdLogger_Record_t) <= SD_LOGGER_SECTOR_SIZE,
+               "the record header must fit one sector");
+_Static_assert(SD_LOGGER_MAX_BURST <= SD_LOGGER_SLOTS,
+               "a burst cannot exceed the ring");
+
+/* Private types -------------------------------------------------------------*/
+
+/**
+ * @brief One record, laid out exactly as on the card
+ */
+typedef struct {
+  union {
+    SdLogger_Record_t info;
+    uint8_t raw[SD_LOGGER_SECTOR_SIZE];
+  } header;
+  uint16_t samples[ADC_CONVERSIONS_BLOCK_SAMPLES];
+} SdLogger_Slot_t;
+
+typedef enum {
+  SD_WRITE_NONE = 0,
+  SD_WRITE_RECORDS,
+  SD_WRITE_INDEX
+} SdLogger_Write_t;
+
+typedef enum {
+  SD_READ_NONE = 0,
+  SD_READ_BUSY,
+  SD_READ_DONE,
+  SD_READ_FAILED
+} SdLogger_Read_t;
+
+/* Private variables ---------------------------------------------------------*/
+static SD_HandleTypeDef hsd1;
+static DMA_HandleTypeDef hdma_sdmmc1; // both directions, set per transfer
+
+/* DMA source: SRAM, cache-line aligned so it can be cleaned before a write */
+static SdLogger_Slot_t ring[SD_LOGGER_SLOTS] ADC_DMA_ALIGNED;
+static union {
+  SdLogger_Index_t info;
+  uint8_t raw[SD_LOGGER_SECTOR_SIZE];
+} index_sector ADC_DMA_ALIGNED;
+
+static volatile uint32_t ring_head = 0; // records queued, block callback
+static volatile uint32_t ring_tail = 0; // records on the card, SD interrupt
+
+/* Write in flight: set by the main loop, cleared by the SD interrupt */
+static volatile SdLogger_Write_t write_kind = SD_WRITE_NONE;
+static uint32_t write_count = 0;
+static uint32_t write_start_ms = 0;
+static uint8_t card_busy = 0; // card still programming the last write
+static uint8_t retries = 0;
+
+static volatile SdLogger_State_t state = SD_LOGGER_NO_CARD;
+static uint8_t index_due = 0;
+static uint8_t full_indexed = 0;
+static uint32_t last_index_ms = 0;
+static uint32_t last_session = 0;
+static uint32_t capacity = 0;
+static volatile uint32_t dropped = 0;
+static uint32_t write_errors = 0;
+static uint32_t high_water = 0;
+static uint32_t max_write_ms = 0;
+
+/* Reader: the card lent between sessions */
+static uint8_t reader = 0;
+static volatile SdLogger_Read_t read_state = SD_READ_NONE;
+static uint8_t *read_dst = NULL;
+static uint32_t read_sectors = 0;
+static uint32_t sectors_read = 0;
+static uint32_t read_errors = 0;
+
+/* Private functions ---------------------------------------------------------*/
+
+static HAL_StatusTypeDef sdLogger_waitReady(uint32_t timeout_ms) {
+  uint32_t start = HAL_GetTick();
+  while (HAL_SD_GetCardState(&hsd1) != HAL_SD_CARD_TRANSFER) {
+    if (HAL_GetTick() - start > timeout_ms) {
+      return HAL_TIMEOUT;
+    }
+  }
+  return HAL_OK;
+}
+
+/**
+ * @brief Start a DMA write of the next records, or of the index when due
+ */
+static void sdLogger_submit(void) {
+  uint32_t tail = ring_tail;
+  uint32_t pending = ring_head - tail;
+  uint8_t *src;
+  uint32_t lba;
+  uint32_t sectors;
+
+  if (index_due || (pending == 0U && state == SD_LOGGER_RECORDING &&
+                    HAL_GetTick() - last_index_ms >=
+                        SD_LOGGER_INDEX_PERIOD_MS)) {
+    index_sector.info.records = tail;
+    index_sector.info.dropped = dropped;
+    write_kind = SD_WRITE_INDEX;
+    write_count = 0;
+    src = index_sector.raw;
+    lba = SD_LOGGER_START_LBA;
+    sectors = 1U;
+    index_due = 0;
+    last_index_ms = HAL_GetTick();
+  } else if (pending != 0U) {
+    // One run of records, contiguous in the ring and on the card
+    uint32_t slot = tail % SD_LOGGER_SLOTS;
+    uint32_t n = pending;
+    if (n > SD_LOGGER_SLOTS - slot) {
+      n = SD_LOGGER_SLOTS - slot;
+    }
+    if (n > SD_LOGGER_MAX_BURST) {
+      n = SD_LOGGER_MAX_BURST;
+    }
+    write_kind = SD_WRITE_RECORDS;
+    write_count = n;
+    src = (uint8_t *)&ring[slot];
+    lba = index_sector.info.data_lba + tail * SD_LOGGER_RECORD_SECTORS;
+    sectors = n * SD_LOGGER_RECORD_SECTORS;
+  } else {
+    return;
+  }
+
+  SCB_CleanDCache_by_Addr((uint32_t *)src,
+                          (int32_t)(sectors * SD_LOGGER_SECTOR_SIZE));
+  write_start_ms = HAL_GetTick();
+  if (HAL_SD_WriteBlocks_DMA(&hsd1, src, lba, sectors) != HAL_OK) {
+    write_errors++;
+    if (write_kind == SD_WRITE_INDEX) {
+      index_due = 1;
+    }
+    write_kind = SD_WRITE_NONE;
+    if (++retries >= SD_LOGGER_MAX_RETRIES) {
+      state = SD_LOGGER_ERROR;
+    }
+    return;
+  }
+  card_busy = 1;
+}
+
+/* Public functions ----------------------------------------------------------*/
+
+HAL_StatusTypeDef sdLogger_init(void) {
+  RCC_PeriphCLKInitTypeDef clk = {0};
+  clk.PeriphClockSelection = RCC_PERIPHCLK_SDMMC1 | RCC_PERIPHCLK_CLK48;
+  clk.Clk48ClockSelection = RCC_CLK48SOURCE_PLL;
+  clk.Sdmmc1ClockSelection = RCC_SDMMC1CLKSOURCE_CLK48;
+  if (HAL_RCCEx_PeriphCLKConfig(&clk) != HAL_OK) {
+    return HAL_ERROR;
+  }
+
+  // Identification runs at 400 kHz, then 48 MHz / (0 + 2) = 24 MHz
+  hsd1.Instance = SDMMC1;
+  hsd1.Init.ClockEdge = SDMMC_CLOCK_EDGE_RISING;
+  hsd1.Init.ClockBypass = SDMMC_CLOCK_BYPASS_DISABLE;
+  hsd1.Init.ClockPowerSave = SDMMC_CLOCK_POWER_SAVE_DISABLE;
+  hsd1.Init.BusWide = SDMMC_BUS_WIDE_1B;
+  hsd1.Init.HardwareFlowControl = SDMMC_HARDWARE_FLOW_CONTROL_ENABLE;
+  hsd1.Init.ClockDiv = 0;
+  if (HAL_SD_Init(&hsd1) != HAL_OK ||
+      HAL_SD_ConfigWideBusOperation(&hsd1, SDMMC_BUS_WIDE_4B) != HAL_OK ||
+      sdLogger_waitReady(SD_LOGGER_IO_TIMEOUT_MS) != HAL_OK) {
+    state = SD_LOGGER_NO_CARD;
+    return HAL_ERROR;
+  }
+
+  uint32_t data_lba = SD_LOGGER_START_LBA + 1U;
+  if (hsd1.SdCard.LogBlockNbr <= data_lba + SD_LOGGER_RECORD_SECTORS) {
+    return HAL_ERROR;
+  }
+  capacity = (hsd1.SdCard.LogBlockNbr - data_lba) / SD_LOGGER_RECORD_SECTORS;
+
+  // Continue the session numbering of the card
+  last_session = 0;
+  if (HAL_SD_ReadBlocks(&hsd1, index_sector.raw, SD_LOGGER_START_LBA, 1U,
+                        SD_LOGGER_IO_TIMEOUT_MS) == HAL_OK &&
+      index_sector.info.magic == SD_LOGGER_MAGIC) {
+    last_session = index_sector.info.session;
+  }
+  if (sdLogger_waitReady(SD_LOGGER_IO_TIMEOUT_MS) != HAL_OK) {
+    return HAL_ERROR;
+  }
+
+  state = SD_LOGGER_IDLE;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef sdLogger_start(uint32_t sample_rate_hz) {
+  if (state == SD_LOGGER_NO_CARD) {
+    return HAL_ERROR;
+  }
+  if (state == SD_LOGGER_RECORDING || write_kind != SD_WRITE_NONE ||
+      reader) {
+    return HAL_BUSY;
+  }
+
+  memset(index_sector.raw, 0, sizeof(index_sector.raw));
+  SdLogger_Index_t *idx = &index_sector.info;
+  idx->magic = SD_LOGGER_MAGIC;
+  idx->version = SD_LOGGER_VERSION;
+  idx->record_sectors = SD_LOGGER_RECORD_SECTORS;
+  idx->session = last_session + 1U;
+  idx->sample_rate_hz = sample_rate_hz;
+  idx->block_frames = (uint16_t)analogSensor_getBlockFrames();
+  idx->channels = ADC_CONVERSIONS_CHANNEL_COUNT;
+  memcpy(idx->slot_map, analogSensor_getBlockChannelMap(),
+         ADC_CONVERSIONS_CHANNEL_COUNT);
+  idx->data_lba = SD_LOGGER_START_LBA + 1U;
+  idx->capacity = capacity;
+  idx->start_time = timebase_now();
+
+  // The index goes out before the first record can refer to its session
+  if (HAL_SD_WriteBlocks(&hsd1, index_sector.raw, SD_LOGGER_START_LBA, 1U,
+                         SD_LOGGER_IO_TIMEOUT_MS) != HAL_OK ||
+      sdLogger_waitReady(SD_LOGGER_IO_TIMEOUT_MS) != HAL_OK) {
+    write_errors++;
+    return HAL_ERROR;
+  }
+  last_session = idx->session;
+
+  ring_head = 0;
+  ring_tail = 0;
+  dropped = 0;
+  high_water = 0;
+  retries = 0;
+  index_due = 0;
+  full_indexed = 0;
+  last_index_ms = HAL_GetTick();
+  __DMB();
+  state = SD_LOGGER_RECORDING;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef sdLogger_stop(uint32_t timeout_ms) {
+  if (state == SD_LOGGER_RECORDING) {
+    state = SD_LOGGER_IDLE;
+  }
+  index_due = 1;
+
+  uint32_t start = HAL_GetTick();
+  while (index_due || ring_head != ring_tail ||
+         write_kind != SD_WRITE_NONE || card_busy) {
+    if (state == SD_LOGGER_ERROR || state == SD_LOGGER_NO_CARD ||
+        HAL_GetTick() - start > timeout_ms) {
+      return HAL_TIMEOUT;
+    }
+    sdLogger_poll();
+  }
+  return HAL_OK;
+}
+
+ADC_FAST_CODE void sdLogger_pushBlock(const uint16_t *block,
+                                      uint32_t frame_count) {
+  if (state != SD_LOGGER_RECORDING || block == NULL ||
+      frame_count > ADC_CONVERSIONS_BLOCK_FRAMES) {
+    return;
+  }
+  uint32_t head = ring_head;
+  if (head >= capacity) {
+    state = SD_LOGGER_FULL;
+    return;
+  }
+  uint32_t used = head - ring_tail;
+  if (used >= SD_LOGGER_SLOTS) {
+    dropped++;
+    return;
+  }
+
+  ADC_BlockInfo_t info = {0};
+  analogSensor_getBlockInfo(&info);
+  SdLogger_Slot_t *slot = &ring[head % SD_LOGGER_SLOTS];
+  memset(slot->header.raw, 0, sizeof(slot->header.raw));
+  slot->header.info.magic = SD_LOGGER_MAGIC;
+  slot->header.info.session = index_sector.info.session;
+  slot->header.info.record = head;
+  slot->header.info.first_frame = info.first_frame;
+  slot->header.info.timestamp = info.timestamp;
+  slot->header.info.frame_count = (uint16_t)frame_count;
+  slot->header.info.dropped = dropped;
+
+  uint32_t bytes = frame_count * ADC_CONVERSIONS_CHANNEL_COUNT * 2U;
+  memcpy(slot->samples, block, bytes);
+  memset((uint8_t *)slot->samples + bytes, 0, SD_LOGGER_DATA_BYTES - bytes);
+
+  // The record must be complete before the main loop can see it
+  __DMB();
+  ring_head = head + 1U;
+  if (used + 1U > high_water) {
+    high_water = used + 1U;
+  }
+}
+
+void sdLogger_poll(void) {
+  if (state == SD_LOGGER_NO_CARD || state == SD_LOGGER_ERROR ||
+      write_kind != SD_WRITE_NONE || reader) {
+    return;
+  }
+
+  // The DMA is done; the card may still be programming its flash
+  if (card_busy) {
+    if (HAL_SD_GetCardState(&hsd1) != HAL_SD_CARD_TRANSFER) {
+      return;
+    }
+    card_busy = 0;
+    uint32_t elapsed = HAL_GetTick() - write_start_ms;
+    if (elapsed > max_write_ms) {
+      max_write_ms = elapsed;
+    }
+  }
+
+  if (state == SD_LOGGER_FULL && ring_head == ring_tail && !full_indexed) {
+    // Final index once the last record is on the card
+    full_indexed = 1;
+    index_due = 1;
+  }
+  sdLogger_submit();
+}
+
+HAL_StatusTypeDef sdLogger_getStats(SdLogger_Stats_t *stats) {
+  if (stats == NULL) {
+    return HAL_ERROR;
+  }
+  stats->state = state;
+  stats->session = last_session;
+  stats->records = ring_tail;
+  stats->capacity = capacity;
+  stats->dropped = dropped;
+  stats->write_errors = write_errors;
+  stats->high_water = high_water;
+  stats->max_write_ms = max_write_ms;
+  stats->sectors_read = sectors_read;
+  stats->read_errors = read_errors;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef sdLogger_getIndex(SdLogger_Index_t *index) {
+  if (index == NULL || state == SD_LOGGER_NO_CARD ||
+      index_sector.info.magic != SD_LOGGER_MAGIC) {
+    return HAL_ERROR;
+  }
+  *index = index_sector.info;
+  if (state == SD_LOGGER_RECORDING) {
+    index->records = ring_tail;
+  }
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef sdLogger_openReader(void) {
+  if (state == SD_LOGGER_NO_CARD || state == SD_LOGGER_ERROR) {
+    return HAL_ERROR;
+  }
+  if (state == SD_LOGGER_RECORDING || write_kind != SD_WRITE_NONE ||
+      ring_head != ring_tail || index_due) {
+    return HAL_BUSY;
+  }
+  read_state = SD_READ_NONE;
+  reader = 1;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef sdLogger_read(uint8_t *dst, uint32_t lba, uint32_t sectors) {
+  if (!reader || dst == NULL || sectors == 0U ||
+      ((uintptr_t)dst & 31U) != 0U) {
+    return HAL_ERROR;
+  }
+  if (read_state == SD_READ_BUSY) {
+    return HAL_BUSY;
+  }
+  // A write's programming, or the read before, may still hold the card
+  if (HAL_SD_GetCardState(&hsd1) != HAL_SD_CARD_TRANSFER) {
+    return HAL_BUSY;
+  }
+  card_busy = 0;
+
+  // Dirty lines written back later would land on the DMA's data
+  SCB_InvalidateDCache_by_Addr((uint32_t *)dst,
+                               (int32_t)(sectors * SD_LOGGER_SECTOR_SIZE));
+  read_dst = dst;
+  read_sectors = sectors;
+  read_state = SD_READ_BUSY;
+  if (HAL_SD_ReadBlocks_DMA(&hsd1, dst, lba, sectors) != HAL_OK) {
+    read_errors++;
+    read_state = SD_READ_NONE;
+    return HAL_ERROR;
+  }
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef sdLogger_pollRead(void) {
+  switch (read_state) {
+  case SD_READ_BUSY:
+    return HAL_BUSY;
+  case SD_READ_DONE:
+    // Lines the CPU speculatively fetched during the transfer
+    SCB_InvalidateDCache_by_Addr(
+        (uint32_t *)read_dst, (int32_t)(read_sectors * SD_LOGGER_SECTOR_SIZE));
+    sectors_read += read_sectors;
+    read_state = SD_READ_NONE;
+    return HAL_OK;
+  default:
+    read_state = SD_READ_NONE;
+    return HAL_ERROR;
+  }
+}
+
+HAL_StatusTypeDef sdLogger_closeReader(void) {
+  if (read_state == SD_READ_BUSY) {
+    return HAL_BUSY;
+  }
+  read_state = SD_READ_NONE;
+  reader = 0;
+  return HAL_OK;
+}
+
+void sdLogger_irqHandler(void) { HAL_SD_IRQHandler(&hsd1); }
+
+void sdLogger_dmaIrqHandler(void) { HAL_DMA_IRQHandler(&hdma_sdmmc1); }
+
+/* HAL callbacks -------------------------------------------------------------*/
+
+/**
+ * @brief SDMMC1 pins (PC8-PC12 D0-D3/CK, PD2 CMD), clock and TX DMA
+ */
+void HAL_SD_MspInit(SD_HandleTypeDef *hsd) {
+  if (hsd->Instance != SDMMC1) {
+    return;
+  }
+  GPIO_InitTypeDef gpio = {0};
+  __HAL_RCC_SDMMC1_CLK_ENABLE();
+  __HAL_RCC_DMA2_CLK_ENABLE();
+  __HAL_RCC_GPIOC_CLK_ENABLE();
+  __HAL_RCC_GPIOD_CLK_ENABLE();
+
+  gpio.Mode = GPIO_MODE_AF_PP;
+  gpio.Pull = GPIO_PULLUP;
+  gpio.Speed = GPIO_SPEED_FREQ_VERY_HIGH;
+  gpio.Alternate = GPIO_AF12_SDMMC1;
+  gpio.Pin = GPIO_PIN_8 | GPIO_PIN_9 | GPIO_PIN_10 | GPIO_PIN_11;
+  HAL_GPIO_Init(GPIOC, &gpio);
+  gpio.Pin = GPIO_PIN_2;
+  HAL_GPIO_Init(GPIOD, &gpio);
+  gpio.Pull = GPIO_NOPULL;
+  gpio.Pin = GPIO_PIN_12;
+  HAL_GPIO_Init(GPIOC, &gpio);
+
+  // Peripheral flow control: the SDMMC sets the length, 4-word bursts.
+  // Stream 6 channel 4 carries SDMMC1 both ways; HAL_SD_ReadBlocks_DMA()
+  // and HAL_SD_WriteBlocks_DMA() set its direction
+  hdma_sdmmc1.Instance = DMA2_Stream6;
+  hdma_sdmmc1.Init.Channel = DMA_CHANNEL_4;
+  hdma_sdmmc1.Init.Direction = DMA_MEMORY_TO_PERIPH;
+  hdma_sdmmc1.Init.PeriphInc = DMA_PINC_DISABLE;
+  hdma_sdmmc1.Init.MemInc = DMA_MINC_ENABLE;
+  hdma_sdmmc1.Init.PeriphDataAlignment = DMA_PDATAALIGN_WORD;
+  hdma_sdmmc1.Init.MemDataAlignment = DMA_MDATAALIGN_WORD;
+  hdma_sdmmc1.Init.Mode = DMA_PFCTRL;
+  hdma_sdmmc1.Init.Priority = DMA_PRIORITY_MEDIUM;
+  hdma_sdmmc1.Init.PeriphBurst = DMA_PBURST_INC4;
+  dmaTuning_apply(DMA_TUNING_SDMMC, &hdma_sdmmc1.Init);
+  if (HAL_DMA_Init(&hdma_sdmmc1) != HAL_OK) {
+    return;
+  }
+  __HAL_LINKDMA(hsd, hdmatx, hdma_sdmmc1);
+  __HAL_LINKDMA(hsd, hdmarx, hdma_sdmmc1);
+
+  HAL_NVIC_SetPriority(SDMMC1_IRQn, SD_LOGGER_IRQ_PRIORITY, 0);
+  HAL_NVIC_EnableIRQ(SDMMC1_IRQn);
+  HAL_NVIC_SetPriority(DMA2_Stream6_IRQn, SD_LOGGER_IRQ_PRIORITY, 0);
+  HAL_NVIC_EnableIRQ(DMA2_Stream6_IRQn);
+}
+
+/**
+ * @brief Write finished on the bus: release the records
+ */
+void HAL_SD_TxCpltCallback(SD_HandleTypeDef *hsd) {
+  UNUSED(hsd);
+  if (write_kind == SD_WRITE_RECORDS) {
+    ring_tail += write_count;
+  }
+  retries = 0;
+  __DMB();
+  write_kind = SD_WRITE_NONE;
+}
+
+/**
+ * @brief Read finished on the bus
+ */
+void HAL_SD_RxCpltCallback(SD_HandleTypeDef *hsd) {
+  UNUSED(hsd);
+  read_state = SD_READ_DONE;
+}
+
+/**
+ * @brief Transfer failed: a read ends for its reader; a write keeps the
+ *        records queued and the main loop retries
+ */
+void HAL_SD_ErrorCallback(SD_HandleTypeDef *hsd) {
+  UNUSED(hsd);
+  if (read_state == SD_READ_BUSY) {
+    read_errors++;
+    read_state = SD_READ_FAILED;
+    return;
+  }
+  write_errors++;
+  if (write_kind == SD_WRITE_INDEX) {
+    index_due = 1;
+  }
+  if (++retries >= SD_LOGGER_MAX_RETRIES) {
+    state = SD_LOGGER_ERROR;
+  }
+  __DMB();
+  write_kind = SD_WRITE_NONE;
+}
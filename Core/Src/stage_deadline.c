@@ -0,0 +1,197 @@
+/**
+ ******************************************************************************
+ * @file    stage_deadline.c
+ * @brief   Implementation of the stage deadlines and load shedding
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "stage_deadline.h"
+#include "event_log.h"
+#include "timebase.h"
+#include <string.h>
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+ * @brief Shed the running optional stage of highest rank, if any
+ */
+static void stageDeadline_shedNext(StageDeadline_t *mon) {
+  uint8_t pick = mon->count;
+  for (uint8_t s = 0; s < mon->count; s++) {
+    const uint8_t rank = mon->stages[s].shed_rank;
+    if (rank == 0U || stageDeadline_isShed(mon, s)) {
+      continue;
+    }
+    if (pick == mon->count || rank >= mon->stages[pick].shed_rank) {
+      pick = s;
+    }
+  }
+  if (pick == mon->count) {
+    return; // only essential stages left: nothing more to give
+  }
+  mon->shed_order[mon->shed_depth++] = pick;
+  mon->sheds[pick]++;
+  mon->shed_mask |= 1UL << pick;
+  mon->changes++;
+  eventLog_write(EVENT_LOG_SHED, pick, 1U);
+}
+
+/**
+ * @brief Bring back the stage shed last
+ */
+static void stageDeadline_restoreLast(StageDeadline_t *mon) {
+  if (mon->shed_depth == 0U) {
+    return;
+  }
+  const uint8_t s = mon->shed_order[--mon->shed_depth];
+  mon->shed_mask &= ~(1UL << s);
+  mon->changes++;
+  eventLog_write(EVENT_LOG_SHED, s, 0U);
+}
+
+/* Public functions ----------------------------------------------------------*/
+
+HAL_StatusTypeDef stageDeadline_init(StageDeadline_t *mon,
+                                     const StageDeadline_Stage_t *stages,
+                                     uint8_t count, uint32_t block_period_us) {
+  if (mon == NULL || stages == NULL || count == 0U ||
+      count > STAGE_DEADLINE_MAX_STAGES || block_period_us == 0U) {
+    return HAL_ERROR;
+  }
+  for (uint8_t s = 0; s < count; s++) {
+    if (stages[s].deadline_pct == 0U || stages[s].deadline_pct > 100U) {
+      return HAL_ERROR;
+    }
+  }
+  memset(mon, 0, sizeof(*mon));
+  mon->stages = stages;
+  mon->count = count;
+  return stageDeadline_setPeriod(mon, block_period_us);
+}
+
+HAL_StatusTypeDef stageDeadline_setPeriod(StageDeadline_t *mon,
+                                          uint32_t block_period_us) {
+  if (mon == NULL || block_period_us == 0U) {
+    return HAL_ERROR;
+  }
+  for (uint8_t s = 0; s < mon->count; s++) {
+    mon->deadline_us[s] = (uint32_t)((uint64_t)block_period_us *
+                                     mon->stages[s].deadline_pct / 100U);
+  }
+  return HAL_OK;
+}
+
+void stageDeadline_begin(StageDeadline_t *mon, uint64_t arrival) {
+  if (mon == NULL) {
+    return;
+  }
+  mon->arrival = arrival;
+  mon->block_missed = 0;
+}
+
+void stageDeadline_done(StageDeadline_t *mon, uint8_t stage) {
+  if (mon == NULL || stage >= mon->count) {
+    return;
+  }
+  const uint64_t late = timebase_toMicros(timebase_now() - mon->arrival);
+  const uint32_t us = (late > UINT32_MAX) ? UINT32_MAX : (uint32_t)late;
+  if (us > mon->worst_us[stage]) {
+    mon->worst_us[stage] = us;
+  }
+  if (us > mon->deadline_us[stage]) {
+    mon->misses[stage]++;
+    mon->block_missed = 1;
+  }
+}
+
+void stageDeadline_end(StageDeadline_t *mon) {
+  if (mon == NULL) {
+    return;
+  }
+  // The main loop may raise the flag between the read and the clear
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  const uint8_t missed = mon->block_missed | mon->overflowed;
+  mon->overflowed = 0;
+  __set_PRIMASK(primask);
+
+  mon->blocks++;
+  if (missed) {
+    mon->missed_blocks++;
+    mon->clean = 0;
+    if (++mon->level >= STAGE_DEADLINE_SHED_LEVEL) {
+      mon->level = 0;
+      stageDeadline_shedNext(mon);
+    }
+    return;
+  }
+  if (mon->level > 0U) {
+    mon->level--;
+  }
+  if (++mon->clean >= STAGE_DEADLINE_RESTORE_BLOCKS) {
+    mon->clean = 0;
+    stageDeadline_restoreLast(mon);
+  }
+}
+
+void stageDeadline_miss(StageDeadline_t *mon) {
+  if (mon != NULL) {
+    mon->overflowed = 1;
+  }
+}
+
+uint32_t stageDeadline_getShed(const StageDeadline_t *mon) {
+  return (mon != NULL) ? mon->shed_mask : 0U;
+}
+
+uint32_t stageDeadline_getChanges(const StageDeadline_t *mon) {
+  return (mon != NULL) ? mon->changes : 0U;
+}
+
+HAL_StatusTypeDef stageDeadline_getStats(const StageDeadline_t *mon,
+                                         uint8_t stage,
+                                         StageDeadline_Stats_t *stats) {
+  if (mon == NULL || stats == NULL || stage >= mon->count) {
+    return HAL_ERROR;
+  }
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  stats->deadline_us = mon->deadline_us[stage];
+  stats->worst_us = mon->worst_us[stage];
+  stats->misses = mon->misses[stage];
+  stats->sheds = mon->sheds[stage];
+  stats->shed = stageDeadline_isShed(mon, stage);
+  __set_PRIMASK(primask);
+  return HAL_OK;
+}
+
+void stageDeadline_formatShed(const StageDeadline_t *mon, char *out,
+                              uint32_t size) {
+  if (out == NULL || size == 0U) {
+    return;
+  }
+  out[0] = '\0';
+  const uint32_t shed = stageDeadline_getShed(mon);
+  uint32_t used = 0;
+  for (uint8_t s = 0; mon != NULL && s < mon->count; s++) {
+    if (!((shed >> s) & 1U)) {
+      continue;
+    }
+    const uint32_t len = (uint32_t)strlen(mon->stages[s].name);
+    if (used + len + 2U > size) {
+      break;
+    }
+    if (used != 0U) {
+      out[used++] = ',';
+    }
+    memcpy(&out[used], mon->stages[s].name, len);
+    used += len;
+    out[used] = '\0';
+  }
+  if (used == 0U && size >= 2U) {
+    out[0] = '-';
+    out[1] = '\0';
+  }
+}
@@ -0,0 +1,86 @@
+/* USER CODE BEGIN Header */
+/**
+  ******************************************************************************
+  * @file    stm32f7xx_hal_timebase_tim.c
+  * @brief   HAL time base based on the hardware TIM.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2025 STMicroelectronics.
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  ******************************************************************************
+  */
+/* USER CODE END Header */
+
+/* Includes ------------------------------------------------------------------*/
+#include "stm32f7xx_hal.h"
+/* USER CODE BEGIN Includes */
+#include "timebase.h"
+/* USER CODE END Includes */
+
+/* USER CODE BEGIN 0 */
+/*
+ * Tickless HAL tick, derived from stm32f7xx_hal_timebase_tim_template.c but
+ * on the free-running TIM5 timebase instead of a 1 ms TIM6 update: nothing
+ * interrupts once a millisecond. HAL_GetTick() divides the 64-bit timebase
+ * count down to ms when it is called, and uwTick is only an offset, which
+ * low_power.c advances over STOP (TIM5 stops with the APB clock there).
+ * Sleepers that need waking at a deadline arm the TIM5 compare with
+ * timebase_wakeAt(), as HAL_Delay() and cpuLoad_idle() do.
+ */
+#if TIMEBASE_HAL_TICK
+
+#define HAL_TICK_TIMEBASE_PER_MS (TIMEBASE_TICK_HZ / 1000U)
+
+#if (TIMEBASE_TICK_HZ % 1000U) != 0U
+#error "TIMEBASE_TICK_HZ must be a multiple of 1 kHz for the HAL tick"
+#endif
+/* USER CODE END 0 */
+
+/**
+  * @brief  This function starts TIM5 as the time base source, or re-derives
+  *         its prescaler from the new clocks without losing the count.
+  * @note   This function is called automatically at the beginning of program
+  *         after reset by HAL_Init() or at any time when clock is configured,
+  *         by HAL_RCC_ClockConfig().
+  * @param  TickPriority Tick interrupt priority (TIM5 keeps
+  *         TIMEBASE_IRQ_PRIORITY).
+  * @retval HAL status
+  */
+HAL_StatusTypeDef HAL_InitTick(uint32_t TickPriority)
+{
+  if (TickPriority < (1UL << __NVIC_PRIO_BITS))
+  {
+    uwTickPrio = TickPriority;
+  }
+
+  /* SysTick stays off (its reset state) unless the RTOS kernel starts it */
+  return timebase_init();
+}
+
+/**
+  * @brief  Provides a tick value in millisecond, computed from the timebase.
+  * @retval tick value
+  */
+uint32_t HAL_GetTick(void)
+{
+  return uwTick + (uint32_t)(timebase_now() / HAL_TICK_TIMEBASE_PER_MS);
+}
+
+/**
+  * @brief  Nothing to count: the tick is computed in HAL_GetTick(). Keeps
+  *         the RTOS build's SysTick_Handler() from moving the offset.
+  * @retval None
+  */
+void HAL_IncTick(void)
+{
+}
+
+/* USER CODE BEGIN 1 */
+#endif /* TIMEBASE_HAL_TICK */
+/* USER CODE END 1 */
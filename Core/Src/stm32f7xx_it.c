@@ -22,6 +22,31 @@
 #include "stm32f7xx_it.h"
 /* Private includes ----------------------------------------------------------*/
 /* USER CODE BEGIN Includes */
+#include "adc_bench.h"
+#include "adc_conversions.h"
+#include "can_bus.h"
+#include "app_rtos.h"
+#include "crc_unit.h"
+#include "dsp_deinterleave.h"
+#include "dwt_counters.h"
+#include "ext_adc.h"
+#include "host_cmd.h"
+#include "i2c_target.h"
+#include "interlock.h"
+#include "isr_budget.h"
+#include "low_power.h"
+#include "modbus_server.h"
+#include "pc_profile.h"
+#include "retained.h"
+#include "sd_logger.h"
+#include "tach.h"
+#include "tdma_bus.h"
+#include "time_sync.h"
+#include "timebase.h"
+#include "usb_stream.h"
+#if APP_RTOS_ENABLE
+#include "cmsis_os2.h"
+#endif
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
@@ -46,6 +71,10 @@
 
 /* Private function prototypes -----------------------------------------------*/
 /* USER CODE BEGIN PFP */
+#if APP_RTOS_ENABLE
+// FreeRTOS port.c; SysTick is shared with the HAL tick
+extern void xPortSysTickHandler(void);
+#endif
 
 /* USER CODE END PFP */
 
@@ -55,8 +84,14 @@
 /* USER CODE END 0 */
 
 /* External variables --------------------------------------------------------*/
+extern DMA_HandleTypeDef hdma_adc1;
+extern ADC_HandleTypeDef hadc1;
+extern DMA_HandleTypeDef hdma_usart3_tx;
+extern UART_HandleTypeDef huart3;
 
 /* USER CODE BEGIN EV */
+extern ADC_HandleTypeDef hadc2;
+extern ADC_HandleTypeDef hadc3;
 
 /* USER CODE END EV */
 
@@ -80,64 +115,72 @@ void NMI_Handler(void)
 
 /**
   * @brief This function handles Hard fault interrupt.
+  *        Naked: hands the frame stacked on MSP or PSP, per EXC_RETURN, and
+  *        EXC_RETURN itself to retained_fault(), which records the fault in
+  *        the backup SRAM, then resets or halts.
   */
-void HardFault_Handler(void)
+__attribute__((naked)) void HardFault_Handler(void)
 {
   /* USER CODE BEGIN HardFault_IRQn 0 */
-
+  __asm volatile("tst lr, #4\n"
+                 "ite eq\n"
+                 "mrseq r0, msp\n"
+                 "mrsne r0, psp\n"
+                 "mov r1, lr\n"
+                 "b retained_fault\n");
   /* USER CODE END HardFault_IRQn 0 */
-  while (1)
-  {
-    /* USER CODE BEGIN W1_HardFault_IRQn 0 */
-    /* USER CODE END W1_HardFault_IRQn 0 */
-  }
 }
 
 /**
   * @brief This function handles Memory management fault.
+  *        Naked, as HardFault_Handler().
   */
-void MemManage_Handler(void)
+__attribute__((naked)) void MemManage_Handler(void)
 {
   /* USER CODE BEGIN MemoryManagement_IRQn 0 */
-
+  __asm volatile("tst lr, #4\n"
+                 "ite eq\n"
+                 "mrseq r0, msp\n"
+                 "mrsne r0, psp\n"
+                 "mov r1, lr\n"
+                 "b retained_fault\n");
   /* USER CODE END MemoryManagement_IRQn 0 */
-  while (1)
-  {
-    /* USER CODE BEGIN W1_MemoryManagement_IRQn 0 */
-    /* USER CODE END W1_MemoryManagement_IRQn 0 */
-  }
 }
 
 /**
   * @brief This function handles Pre-fetch fault, memory access fault.
+  *        Naked, as HardFault_Handler().
   */
-void BusFault_Handler(void)
+__attribute__((naked)) void BusFault_Handler(void)
 {
   /* USER CODE BEGIN BusFault_IRQn 0 */
-
+  __asm volatile("tst lr, #4\n"
+                 "ite eq\n"
+                 "mrseq r0, msp\n"
+                 "mrsne r0, psp\n"
+                 "mov r1, lr\n"
+                 "b retained_fault\n");
   /* USER CODE END BusFault_IRQn 0 */
-  while (1)
-  {
-    /* USER CODE BEGIN W1_BusFault_IRQn 0 */
-    /* USER CODE END W1_BusFault_IRQn 0 */
-  }
 }
 
 /**
   * @brief This function handles Undefined instruction or illegal state.
+  *        Naked, as HardFault_Handler().
   */
-void UsageFault_Handler(void)
+__attribute__((naked)) void UsageFault_Handler(void)
 {
   /* USER CODE BEGIN UsageFault_IRQn 0 */
-
+  __asm volatile("tst lr, #4\n"
+                 "ite eq\n"
+                 "mrseq r0, msp\n"
+                 "mrsne r0, psp\n"
+                 "mov r1, lr\n"
+                 "b retained_fault\n");
   /* USER CODE END UsageFault_IRQn 0 */
-  while (1)
-  {
-    /* USER CODE BEGIN W1_UsageFault_IRQn 0 */
-    /* USER CODE END W1_UsageFault_IRQn 0 */
-  }
 }
 
+#if !APP_RTOS_ENABLE
+/* The RTOS build takes SVC and PendSV from the FreeRTOS port */
 /**
   * @brief This function handles System service call via SWI instruction.
   */
@@ -150,6 +193,7 @@ void SVC_Handler(void)
 
   /* USER CODE END SVCall_IRQn 1 */
 }
+#endif
 
 /**
   * @brief This function handles Debug monitor.
@@ -164,6 +208,7 @@ void DebugMon_Handler(void)
   /* USER CODE END DebugMonitor_IRQn 1 */
 }
 
+#if !APP_RTOS_ENABLE
 /**
   * @brief This function handles Pendable request for system service.
   */
@@ -176,6 +221,7 @@ void PendSV_Handler(void)
 
   /* USER CODE END PendSV_IRQn 1 */
 }
+#endif
 
 /**
   * @brief This function handles System tick timer.
@@ -183,11 +229,16 @@ void PendSV_Handler(void)
 void SysTick_Handler(void)
 {
   /* USER CODE BEGIN SysTick_IRQn 0 */
-
+  const IsrBudget_Mark_t mark = isrBudget_begin();
   /* USER CODE END SysTick_IRQn 0 */
   HAL_IncTick();
   /* USER CODE BEGIN SysTick_IRQn 1 */
-
+#if APP_RTOS_ENABLE
+  if (osKernelGetState() == osKernelRunning) {
+    xPortSysTickHandler();
+  }
+#endif
+  isrBudget_end(ISR_BUDGET_SYSTICK, mark);
   /* USER CODE END SysTick_IRQn 1 */
 }
 
@@ -198,6 +249,348 @@ void SysTick_Handler(void)
 /* please refer to the startup file (startup_stm32f7xx.s).                    */
 /******************************************************************************/
 
+/**
+  * @brief This function handles DMA1 stream3 global interrupt.
+  */
+void DMA1_Stream3_IRQHandler(void)
+{
+  /* USER CODE BEGIN DMA1_Stream3_IRQn 0 */
+  const IsrBudget_Mark_t mark = isrBudget_begin();
+  /* USER CODE END DMA1_Stream3_IRQn 0 */
+  HAL_DMA_IRQHandler(&hdma_usart3_tx);
+  /* USER CODE BEGIN DMA1_Stream3_IRQn 1 */
+  isrBudget_end(ISR_BUDGET_UART_TX, mark);
+  /* USER CODE END DMA1_Stream3_IRQn 1 */
+}
+
+/**
+  * @brief This function handles ADC1, ADC2 and ADC3 global interrupts.
+  */
+void ADC_IRQHandler(void)
+{
+  /* USER CODE BEGIN ADC_IRQn 0 */
+#if INTERLOCK_ENABLE
+  // Before the HAL dispatch: the output must not wait for it
+  interlock_irqHandler();
+#endif
+  // Measured from here, off the interlock path
+  const IsrBudget_Mark_t mark = isrBudget_begin();
+  /* USER CODE END ADC_IRQn 0 */
+  HAL_ADC_IRQHandler(&hadc1);
+  /* USER CODE BEGIN ADC_IRQn 1 */
+  // ADC2/3 share the vector; their analog watchdogs guard scan channels
+  HAL_ADC_IRQHandler(&hadc2);
+  HAL_ADC_IRQHandler(&hadc3);
+  isrBudget_end(ISR_BUDGET_ADC, mark);
+  /* USER CODE END ADC_IRQn 1 */
+}
+
+/**
+  * @brief This function handles USART3 global interrupt.
+  */
+void USART3_IRQHandler(void)
+{
+  /* USER CODE BEGIN USART3_IRQn 0 */
+  const IsrBudget_Mark_t mark = isrBudget_begin();
+  /* USER CODE END USART3_IRQn 0 */
+  HAL_UART_IRQHandler(&huart3);
+  /* USER CODE BEGIN USART3_IRQn 1 */
+  isrBudget_end(ISR_BUDGET_USART3, mark);
+  /* USER CODE END USART3_IRQn 1 */
+}
+
+/**
+  * @brief This function handles DMA2 stream0 global interrupt.
+  */
+void DMA2_Stream0_IRQHandler(void)
+{
+  /* USER CODE BEGIN DMA2_Stream0_IRQn 0 */
+  const IsrBudget_Mark_t mark = isrBudget_begin();
+  // Replay mode pends this vector for each recorded block
+  analogSensor_replayIrqHandler();
+  // The scan's half-blocks without the HAL dispatch
+  if (analogSensor_dmaIrqFast()) {
+    isrBudget_end(ISR_BUDGET_ADC_DMA, mark);
+    return;
+  }
+  /* USER CODE END DMA2_Stream0_IRQn 0 */
+  HAL_DMA_IRQHandler(&hdma_adc1);
+  /* USER CODE BEGIN DMA2_Stream0_IRQn 1 */
+  isrBudget_end(ISR_BUDGET_ADC_DMA, mark);
+  /* USER CODE END DMA2_Stream0_IRQn 1 */
+}
+
 /* USER CODE BEGIN 1 */
+/**
+  * @brief This function handles TIM2 global interrupt (sync discipline).
+  */
+void TIM2_IRQHandler(void)
+{
+  const IsrBudget_Mark_t mark = isrBudget_begin();
+  timeSync_irqHandler();
+  isrBudget_end(ISR_BUDGET_TIM2, mark);
+}
+
+/**
+  * @brief This function handles TIM5 global interrupt (timebase wraps).
+  */
+void TIM5_IRQHandler(void)
+{
+  const IsrBudget_Mark_t mark = isrBudget_begin();
+  timebase_irqHandler();
+  isrBudget_end(ISR_BUDGET_TIM5, mark);
+}
+
+/**
+  * @brief This function handles USB On The Go FS global interrupt.
+  */
+void OTG_FS_IRQHandler(void)
+{
+  const IsrBudget_Mark_t mark = isrBudget_begin();
+  usbStream_irqHandler();
+  isrBudget_end(ISR_BUDGET_USB, mark);
+}
+
+/**
+  * @brief This function handles SDMMC1 global interrupt.
+  */
+void SDMMC1_IRQHandler(void)
+{
+  const IsrBudget_Mark_t mark = isrBudget_begin();
+  sdLogger_irqHandler();
+  isrBudget_end(ISR_BUDGET_SDMMC, mark);
+}
+
+/**
+  * @brief This function handles DMA2 stream6 global interrupt.
+  */
+void DMA2_Stream6_IRQHandler(void)
+{
+  const IsrBudget_Mark_t mark = isrBudget_begin();
+  sdLogger_dmaIrqHandler();
+  isrBudget_end(ISR_BUDGET_SD_DMA, mark);
+}
+
+/**
+  * @brief This function handles DMA1 stream1 global interrupt (USART3 RX).
+  */
+void DMA1_Stream1_IRQHandler(void)
+{
+  const IsrBudget_Mark_t mark = isrBudget_begin();
+  hostCmd_dmaIrqHandler();
+  isrBudget_end(ISR_BUDGET_UART_RX, mark);
+}
+
+/**
+  * @brief This function handles DMA2 stream7 global interrupt (CRC unit feed).
+  */
+void DMA2_Stream7_IRQHandler(void)
+{
+  const IsrBudget_Mark_t mark = isrBudget_begin();
+  crcUnit_dmaIrqHandler();
+  isrBudget_end(ISR_BUDGET_CRC_DMA, mark);
+}
+
+#if EXT_ADC_ENABLE
+/**
+  * @brief This function handles DMA2 stream3 global interrupt (SPI ADC results).
+  */
+void DMA2_Stream3_IRQHandler(void)
+{
+  const IsrBudget_Mark_t mark = isrBudget_begin();
+  extAdc_dmaIrqHandler();
+  isrBudget_end(ISR_BUDGET_EXT_DMA, mark);
+}
+#endif
+
+#if I2C_TARGET_ENABLE
+/**
+  * @brief This function handles I2C1 event interrupt (I2C target).
+  */
+void I2C1_EV_IRQHandler(void)
+{
+  const IsrBudget_Mark_t mark = isrBudget_begin();
+  i2cTarget_evIrqHandler();
+  isrBudget_end(ISR_BUDGET_I2C, mark);
+}
+
+/**
+  * @brief This function handles I2C1 error interrupt (I2C target).
+  */
+void I2C1_ER_IRQHandler(void)
+{
+  const IsrBudget_Mark_t mark = isrBudget_begin();
+  i2cTarget_erIrqHandler();
+  isrBudget_end(ISR_BUDGET_I2C, mark);
+}
+
+/**
+  * @brief This function handles DMA1 stream7 global interrupt (I2C target TX).
+  */
+void DMA1_Stream7_IRQHandler(void)
+{
+  const IsrBudget_Mark_t mark = isrBudget_begin();
+  i2cTarget_dmaIrqHandler();
+  isrBudget_end(ISR_BUDGET_I2C_DMA, mark);
+}
+#endif
+
+#if CAN_BUS_ENABLE
+/**
+  * @brief This function handles CAN1 TX interrupt (mailbox refill).
+  */
+void CAN1_TX_IRQHandler(void)
+{
+  const IsrBudget_Mark_t mark = isrBudget_begin();
+  canBus_irqHandler();
+  isrBudget_end(ISR_BUDGET_CAN, mark);
+}
+
+/**
+  * @brief This function handles CAN1 RX0 interrupt (filtered commands).
+  */
+void CAN1_RX0_IRQHandler(void)
+{
+  const IsrBudget_Mark_t mark = isrBudget_begin();
+  canBus_irqHandler();
+  isrBudget_end(ISR_BUDGET_CAN, mark);
+}
+
+/**
+  * @brief This function handles CAN1 SCE interrupt (bus errors).
+  */
+void CAN1_SCE_IRQHandler(void)
+{
+  const IsrBudget_Mark_t mark = isrBudget_begin();
+  canBus_irqHandler();
+  isrBudget_end(ISR_BUDGET_CAN, mark);
+}
+#endif
+
+#if MODBUS_SERVER_ENABLE
+/**
+  * @brief This function handles USART2 global interrupt (Modbus server).
+  */
+void USART2_IRQHandler(void)
+{
+  const IsrBudget_Mark_t mark = isrBudget_begin();
+  modbusServer_irqHandler();
+  isrBudget_end(ISR_BUDGET_MODBUS, mark);
+}
+#endif
+
+#if TDMA_BUS_ENABLE
+/**
+  * @brief This function handles UART8 global interrupt (TDMA bus frames).
+  */
+void UART8_IRQHandler(void)
+{
+  const IsrBudget_Mark_t mark = isrBudget_begin();
+  tdmaBus_uartIrqHandler();
+  isrBudget_end(ISR_BUDGET_TDMA, mark);
+}
+
+/**
+  * @brief This function handles TIM1 break and TIM9 global interrupts (TDMA
+  *        bus cycle and slot starts; the TIM1 break is not used).
+  */
+void TIM1_BRK_TIM9_IRQHandler(void)
+{
+  const IsrBudget_Mark_t mark = isrBudget_begin();
+  tdmaBus_timIrqHandler();
+  isrBudget_end(ISR_BUDGET_TDMA_SLOT, mark);
+}
+#endif
+
+#if TACH_ENABLE
+/**
+  * @brief This function handles TIM3 global interrupt (tach capture).
+  */
+void TIM3_IRQHandler(void)
+{
+  const IsrBudget_Mark_t mark = isrBudget_begin();
+  tach_irqHandler();
+  isrBudget_end(ISR_BUDGET_TIM3, mark);
+}
+#endif
+
+#if PC_PROFILE_ENABLE
+/**
+  * @brief This function handles TIM7 global interrupt (PC sampling).
+  *        Naked: hands the frame stacked on MSP or PSP, per EXC_RETURN, and
+  *        EXC_RETURN itself to pcProfile_sample(), which returns from the
+  *        exception. Not measured by isr_budget.h.
+  */
+__attribute__((naked)) void TIM7_IRQHandler(void)
+{
+  __asm volatile("tst lr, #4\n"
+                 "ite eq\n"
+                 "mrseq r0, msp\n"
+                 "mrsne r0, psp\n"
+                 "mov r1, lr\n"
+                 "b pcProfile_sample\n");
+}
+#endif
+
+#if DWT_COUNTERS_ENABLE
+/**
+  * @brief This function handles TIM4 global interrupt (DWT counter reads).
+  *        Not measured by isr_budget.h: it runs inside the windows it
+  *        measures.
+  */
+void TIM4_IRQHandler(void)
+{
+  dwtCounters_irqHandler();
+}
+#endif
+
+/**
+  * @brief This function handles LPTIM1 global interrupt (duty-cycle wake-up).
+  */
+void LPTIM1_IRQHandler(void)
+{
+  const IsrBudget_Mark_t mark = isrBudget_begin();
+  lowPower_irqHandler();
+  isrBudget_end(ISR_BUDGET_LPTIM, mark);
+}
+
+/**
+  * @brief This function handles DMA2D global interrupt (block transpose).
+  */
+void DMA2D_IRQHandler(void)
+{
+  const IsrBudget_Mark_t mark = isrBudget_begin();
+  dspDeinterleave_dma2dIrqHandler();
+  isrBudget_end(ISR_BUDGET_DMA2D, mark);
+}
+
+#if ADC_BENCH_BUILD
+/**
+  * @brief This function handles the spare HDMI-CEC vector, pended by the
+  *        bench's interrupt entry scenario. Naked: CYCCNT is its first
+  *        load, handed to adcBench_irqEntry(), which returns from the
+  *        exception. Not measured by isr_budget.h.
+  */
+__attribute__((naked)) void CEC_IRQHandler(void)
+{
+  __asm volatile("movw r1, #0x1004\n" // DWT->CYCCNT
+                 "movt r1, #0xE000\n"
+                 "ldr r0, [r1]\n"
+                 "b adcBench_irqEntry\n");
+}
+#endif
+
+#if APP_RTOS_ENABLE
+/**
+  * @brief This function handles the block notification of the RTOS build
+  *        (spare SPDIF-RX vector, see APP_RTOS_NOTIFY_IRQn).
+  */
+void SPDIF_RX_IRQHandler(void)
+{
+  const IsrBudget_Mark_t mark = isrBudget_begin();
+  appRtos_notifyIrqHandler();
+  isrBudget_end(ISR_BUDGET_RTOS_NOTIFY, mark);
+}
+#endif
 
 /* USER CODE END 1 */
@@ -0,0 +1,214 @@
+/**
+ ******************************************************************************
+ * @file    swo_trace.c
+ * @brief   Implementation of the ITM/SWO development trace
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "swo_trace.h"
+#include "adc_sections.h"
+#include "block_pool.h"
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define SWO_TRACE_LAR_KEY 0xC5ACCE55U // CoreSight lock access
+#define SWO_TRACE_TPIU_NRZ 2U         // SPPR: asynchronous, UART framing
+#define SWO_TRACE_HEADER_WORDS 4U     // tag, first frame, timestamp x2
+#define SWO_TRACE_FIELD_MAX 0x00FFFFFFU
+
+/* Private variables ---------------------------------------------------------*/
+static uint8_t ready = 0;
+static uint32_t baud = 0;
+static uint32_t poll_cycles = 0;
+
+/* Block in flight: set by the block callback, cleared by the main loop */
+static BlockPool_Block_t *volatile blk = NULL;
+static uint32_t blk_header[SWO_TRACE_HEADER_WORDS];
+static uint32_t blk_words = 0;
+static uint32_t blk_pos = 0;
+
+static SwoTrace_Stats_t stats_ = {0};
+
+/* Private functions ---------------------------------------------------------*/
+
+ADC_HOT_CODE static inline uint8_t swoTrace_portOn(uint32_t port) {
+  return (ready && (ITM->TCR & ITM_TCR_ITMENA_Msk) != 0U &&
+          (ITM->TER & (1UL << port)) != 0U)
+             ? 1U
+             : 0U;
+}
+
+/**
+ * @brief Write one word if the FIFO takes it; the check and the store
+ *        cannot be split by another writer
+ */
+ADC_HOT_CODE static uint8_t swoTrace_put(uint32_t port, uint32_t word) {
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  const uint8_t free = (ITM->PORT[port].u32 != 0U) ? 1U : 0U;
+  if (free) {
+    ITM->PORT[port].u32 = word;
+  }
+  __set_PRIMASK(primask);
+  return free;
+}
+
+static void swoTrace_endBlock(void) {
+  blockPool_release(blk);
+  __DMB();
+  blk = NULL;
+}
+
+/* Public functions ----------------------------------------------------------*/
+
+HAL_StatusTypeDef swoTrace_init(void) {
+#if SWO_TRACE_ENABLE
+  const uint32_t hclk = HAL_RCC_GetHCLKFreq();
+  const uint32_t prescaler = (hclk + SWO_TRACE_BAUD / 2U) / SWO_TRACE_BAUD;
+  if (prescaler == 0U || prescaler > TPI_ACPR_PRESCALER_Msk + 1U) {
+    return HAL_ERROR;
+  }
+
+  // PB3 is TRACESWO (AF0) out of reset; claim it in case it was changed
+  GPIO_InitTypeDef gpio = {.Pin = GPIO_PIN_3,
+                           .Mode = GPIO_MODE_AF_PP,
+                           .Pull = GPIO_NOPULL,
+                           .Speed = GPIO_SPEED_FREQ_VERY_HIGH,
+                           .Alternate = GPIO_AF0_TRACE};
+  __HAL_RCC_GPIOB_CLK_ENABLE();
+  HAL_GPIO_Init(GPIOB, &gpio);
+
+  ready = 0;
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DBGMCU->CR = (DBGMCU->CR & ~DBGMCU_CR_TRACE_MODE) | DBGMCU_CR_TRACE_IOEN;
+  TPI->CSPSR = 1U; // 1-bit port
+  TPI->ACPR = prescaler - 1U;
+  TPI->SPPR = SWO_TRACE_TPIU_NRZ;
+  TPI->FFCR = TPI_FFCR_TrigIn_Msk; // formatter bypassed: ITM packets only
+
+  ITM->LAR = SWO_TRACE_LAR_KEY;
+  ITM->TCR = 0;
+  ITM->TPR = 0; // every port usable from unprivileged tasks
+  ITM->TER = SWO_TRACE_PORTS;
+  ITM->TCR = (1UL << ITM_TCR_TraceBusID_Pos) | ITM_TCR_SYNCENA_Msk |
+             ITM_TCR_ITMENA_Msk;
+
+  baud = hclk / prescaler;
+  poll_cycles = (hclk / 1000000U) * SWO_TRACE_POLL_US;
+  ready = 1;
+#endif
+  return HAL_OK;
+}
+
+uint32_t swoTrace_getBaud(void) { return baud; }
+
+void swoTrace_setPorts(uint32_t mask) {
+  if (ready) {
+    ITM->TER = mask;
+  }
+}
+
+uint32_t swoTrace_getPorts(void) { return ready ? ITM->TER : 0U; }
+
+ADC_HOT_CODE void swoTrace_probe(uint8_t probe, uint32_t cycles) {
+  if (!swoTrace_portOn(SWO_TRACE_PORT_PROBE)) {
+    return;
+  }
+  const uint32_t field =
+      (cycles > SWO_TRACE_FIELD_MAX) ? SWO_TRACE_FIELD_MAX : cycles;
+  if (swoTrace_put(SWO_TRACE_PORT_PROBE, ((uint32_t)probe << 24) | field)) {
+    stats_.events++;
+  } else {
+    stats_.dropped_events++;
+  }
+}
+
+ADC_HOT_CODE void swoTrace_marker(uint8_t id, uint32_t value) {
+  if (!swoTrace_portOn(SWO_TRACE_PORT_MARKER)) {
+    return;
+  }
+  if (swoTrace_put(SWO_TRACE_PORT_MARKER,
+                   ((uint32_t)id << 24) | (value & SWO_TRACE_FIELD_MAX))) {
+    stats_.markers++;
+  } else {
+    stats_.dropped_events++;
+  }
+}
+
+ADC_HOT_CODE void swoTrace_pushBlock(const uint16_t *block,
+                                     uint32_t frame_count) {
+  if (!swoTrace_portOn(SWO_TRACE_PORT_BLOCK) || block == NULL ||
+      frame_count == 0U || frame_count > ADC_CONVERSIONS_BLOCK_FRAMES) {
+    return;
+  }
+  BlockPool_Block_t *b = (blk == NULL) ? blockPool_fromData(block) : NULL;
+  if (b == NULL) {
+    stats_.dropped_blocks++;
+    return;
+  }
+  blockPool_retain(b); // the DMA refills it only after the release
+
+  blk_header[0] = SWO_TRACE_BLOCK_TAG | frame_count;
+  blk_header[1] = b->info.first_frame;
+  blk_header[2] = (uint32_t)b->info.timestamp;
+  blk_header[3] = (uint32_t)(b->info.timestamp >> 32);
+  blk_words = SWO_TRACE_HEADER_WORDS +
+              (frame_count * ADC_CONVERSIONS_CHANNEL_COUNT + 1U) / 2U;
+  blk_pos = 0;
+  __DMB();
+  blk = b;
+}
+
+void swoTrace_poll(void) {
+  BlockPool_Block_t *b = blk;
+  if (b == NULL) {
+    return;
+  }
+  if (!swoTrace_portOn(SWO_TRACE_PORT_BLOCK)) {
+    swoTrace_endBlock(); // switched off mid-block
+    return;
+  }
+
+  // Wait on the FIFO, but only for so long per main-loop pass
+  const uint32_t t0 = DWT->CYCCNT;
+  while (blk_pos < blk_words && DWT->CYCCNT - t0 < poll_cycles) {
+    uint32_t word;
+    if (blk_pos < SWO_TRACE_HEADER_WORDS) {
+      word = blk_header[blk_pos];
+    } else {
+      memcpy(&word, &b->data[(blk_pos - SWO_TRACE_HEADER_WORDS) * 2U],
+             sizeof(word));
+    }
+    if (swoTrace_put(SWO_TRACE_PORT_BLOCK, word)) {
+      blk_pos++;
+    }
+  }
+  if (blk_pos == blk_words) {
+    stats_.blocks++;
+    swoTrace_endBlock();
+  }
+}
+
+HAL_StatusTypeDef swoTrace_getStats(SwoTrace_Stats_t *stats) {
+  if (stats == NULL) {
+    return HAL_ERROR;
+  }
+  *stats = stats_;
+  return HAL_OK;
+}
+
+#if SWO_TRACE_ENABLE
+/**
+ * @brief printf() backend (syscalls.c _write()); waits for the FIFO
+ */
+int __io_putchar(int ch) {
+  if (swoTrace_portOn(SWO_TRACE_PORT_PRINTF)) {
+    while (ITM->PORT[SWO_TRACE_PORT_PRINTF].u32 == 0U) {
+    }
+    ITM->PORT[SWO_TRACE_PORT_PRINTF].u8 = (uint8_t)ch;
+  }
+  return ch;
+}
+#endif
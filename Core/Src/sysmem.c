@@ -23,6 +23,7 @@
 /* Includes */
 #include <errno.h>
 #include <stdint.h>
+#include "mem_budget.h"
 
 /**
  * Pointer to the current high watermark of the heap usage
@@ -35,17 +36,17 @@ static uint8_t *__sbrk_heap_end = NULL;
  *
  * @verbatim
  * ############################################################################
- * #  .data  #  .bss  #       newlib heap       #          MSP stack          #
- * #         #        #                         # Reserved by _Min_Stack_Size #
+ * #  .data  #  .bss  # .sram1_bss #  heap  #          free (burst)           #
  * ############################################################################
- * ^-- RAM start      ^-- _end                             _estack, RAM end --^
+ * ^-- SRAM1 start              ^-- _end  ^-- _eheap              SRAM1 end --^
  * @endverbatim
  *
  * This implementation starts allocating at the '_end' linker symbol
- * The '_Min_Stack_Size' linker symbol reserves a memory for the MSP stack
- * The implementation considers '_estack' linker symbol to be RAM end
- * NOTE: If the MSP stack, at any point during execution, grows larger than the
- * reserved size, please increase the '_Min_Stack_Size'.
+ * The implementation considers '_eheap' linker symbol to be the heap end:
+ * the heap is no larger than '_Min_Heap_Size' (0, nothing allocates) and
+ * must not grow at all once memBudget_seal() has been called
+ * The MSP stack is in DTCM (_estack), reserved there by '_Min_Stack_Size';
+ * SRAM2 holds only the link DMA buffers
  *
  * @param incr Memory size
  * @return Pointer to allocated memory
@@ -53,10 +54,8 @@ static uint8_t *__sbrk_heap_end = NULL;
 void *_sbrk(ptrdiff_t incr)
 {
   extern uint8_t _end; /* Symbol defined in the linker script */
-  extern uint8_t _estack; /* Symbol defined in the linker script */
-  extern uint32_t _Min_Stack_Size; /* Symbol defined in the linker script */
-  const uint32_t stack_limit = (uint32_t)&_estack - (uint32_t)&_Min_Stack_Size;
-  const uint8_t *max_heap = (uint8_t *)stack_limit;
+  extern uint8_t _eheap; /* Symbol defined in the linker script */
+  const uint8_t *max_heap = &_eheap;
   uint8_t *prev_heap_end;
 
   /* Initialize heap end at first call */
@@ -65,8 +64,9 @@ void *_sbrk(ptrdiff_t incr)
     __sbrk_heap_end = &_end;
   }
 
-  /* Protect heap from growing into the reserved MSP stack */
-  if (__sbrk_heap_end + incr > max_heap)
+  /* Protect heap from growing past its reservation, or after init */
+  if (__sbrk_heap_end + incr > max_heap ||
+      memBudget_onHeapGrowth((int32_t)incr) != HAL_OK)
   {
     errno = ENOMEM;
     return (void *)-1;
@@ -0,0 +1,169 @@
+/**
+ ******************************************************************************
+ * @file    tach.c
+ * @brief   Implementation of the TIM3 tachometer capture
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "tach.h"
+#include "adc_sections.h"
+#include "timebase.h"
+
+/* Private defines -----------------------------------------------------------*/
+#define TACH_INPUT_FILTER 0xFU // fDTS / 32, 8 samples: ~2.4 us at 108 MHz
+#define TACH_MIN_TICKS                                                         \
+  ((uint64_t)TACH_MIN_INTERVAL_US * TIMEBASE_TICK_HZ / 1000000U)
+
+#if (TACH_EDGE_QUEUE & (TACH_EDGE_QUEUE - 1U)) != 0U
+#error "TACH_EDGE_QUEUE must be a power of two"
+#endif
+
+/* Private variables ---------------------------------------------------------*/
+
+/* Stamps: written by the capture interrupt, read by the main loop */
+static uint64_t queue[TACH_EDGE_QUEUE];
+static volatile uint32_t queue_head = 0;
+static volatile uint32_t queue_tail = 0;
+
+static uint8_t have_last = 0;
+static uint64_t last_edge = 0;
+static Tach_Stats_t stats_ = {0};
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+ * @brief Input clock of TIM3 (APB1 timers run at 2x PCLK1 when APB1 is divided)
+ */
+static uint32_t tach_clockHz(void) {
+  uint32_t clk = HAL_RCC_GetPCLK1Freq();
+  if ((RCC->CFGR & RCC_CFGR_PPRE1) != RCC_HCLK_DIV1) {
+    clk *= 2U;
+  }
+  return clk;
+}
+
+/* Public functions ----------------------------------------------------------*/
+
+HAL_StatusTypeDef tach_init(void) {
+#if !TACH_ENABLE
+  return HAL_OK; // no pick-up: PC6 and TIM3 stay free
+#endif
+  const uint32_t clk = tach_clockHz();
+  if (clk % TIMEBASE_TICK_HZ != 0U || clk / TIMEBASE_TICK_HZ > 0x10000U) {
+    return HAL_ERROR;
+  }
+
+  // Open-collector pick-ups need the pull-up
+  GPIO_InitTypeDef gpio = {.Pin = GPIO_PIN_6,
+                           .Mode = GPIO_MODE_AF_PP,
+                           .Pull = GPIO_PULLUP,
+                           .Speed = GPIO_SPEED_FREQ_LOW,
+                           .Alternate = GPIO_AF2_TIM3};
+  __HAL_RCC_GPIOC_CLK_ENABLE();
+  HAL_GPIO_Init(GPIOC, &gpio);
+
+  // Same prescaler as TIM5: both count timebase ticks
+  __HAL_RCC_TIM3_CLK_ENABLE();
+  TIM3->CR1 = TIM_CLOCKDIVISION_DIV4; // fDTS for the input filter
+  TIM3->PSC = clk / TIMEBASE_TICK_HZ - 1U;
+  TIM3->ARR = 0xFFFFU;
+  TIM3->CCMR1 = TIM_CCMR1_CC1S_0 | (TACH_INPUT_FILTER << TIM_CCMR1_IC1F_Pos);
+  TIM3->CCER = TIM_CCER_CC1E; // rising edge
+  TIM3->EGR = TIM_EGR_UG;     // load PSC now
+  TIM3->SR = 0;
+
+  queue_head = 0;
+  queue_tail = 0;
+  have_last = 0;
+  stats_ = (Tach_Stats_t){0};
+  TIM3->DIER = TIM_DIER_CC1IE;
+  TIM3->CR1 |= TIM_CR1_CEN;
+
+  HAL_NVIC_SetPriority(TIM3_IRQn, TACH_IRQ_PRIORITY, 0);
+  HAL_NVIC_EnableIRQ(TIM3_IRQn);
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef tach_popEdge(uint64_t *time) {
+  if (time == NULL) {
+    return HAL_ERROR;
+  }
+  const uint32_t tail = queue_tail;
+  if (tail == queue_head) {
+    return HAL_BUSY;
+  }
+  *time = queue[tail & (TACH_EDGE_QUEUE - 1U)];
+  __DMB();
+  queue_tail = tail + 1U;
+  return HAL_OK;
+}
+
+float tach_getRpm(void) {
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  const uint64_t last = last_edge;
+  const uint32_t period = stats_.period_ticks;
+  __set_PRIMASK(primask);
+
+  if (period == 0U ||
+      timebase_now() - last >
+          (uint64_t)TACH_TIMEOUT_MS * TIMEBASE_TICK_HZ / 1000U) {
+    return 0.0f;
+  }
+  return 60.0f * (float)TIMEBASE_TICK_HZ /
+         ((float)period * (float)TACH_PULSES_PER_REV);
+}
+
+HAL_StatusTypeDef tach_getStats(Tach_Stats_t *stats) {
+  if (stats == NULL) {
+    return HAL_ERROR;
+  }
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  *stats = stats_;
+  __set_PRIMASK(primask);
+  return HAL_OK;
+}
+
+ADC_FAST_CODE void tach_irqHandler(void) {
+  const uint32_t sr = TIM3->SR;
+  TIM3->SR = ~(TIM_SR_CC1IF | TIM_SR_CC1OF); // rc_w0: only these clear
+  if ((sr & TIM_SR_CC1IF) == 0U) {
+    return;
+  }
+
+  // The ticks since the edge, back from a timebase read taken with TIM3
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  const uint16_t ccr = (uint16_t)TIM3->CCR1;
+  const uint64_t now = timebase_now();
+  const uint16_t cnt = (uint16_t)TIM3->CNT;
+  __set_PRIMASK(primask);
+  const uint64_t edge = now - (uint16_t)(cnt - ccr);
+
+  // An overcapture is a second edge before this interrupt: bounce
+  if ((sr & TIM_SR_CC1OF) != 0U ||
+      (have_last && edge - last_edge < TACH_MIN_TICKS)) {
+    stats_.glitches++;
+    return;
+  }
+  if (have_last) {
+    const uint64_t period = edge - last_edge;
+    stats_.period_ticks =
+        (period > 0xFFFFFFFFULL) ? 0xFFFFFFFFU : (uint32_t)period;
+  }
+  have_last = 1;
+  last_edge = edge;
+  stats_.edges++;
+
+  const uint32_t head = queue_head;
+  if (head - queue_tail >= TACH_EDGE_QUEUE) {
+    stats_.dropped++;
+    return;
+  }
+  queue[head & (TACH_EDGE_QUEUE - 1U)] = edge;
+  __DMB();
+  queue_head = head + 1U;
+}
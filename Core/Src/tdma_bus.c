@@ -0,0 +1,685 @@
+/**
+ ******************************************************************************
+ * @file    tdma_bus.c
+ * @brief   Implementation of the time-slotted RS-485 bus on UART8
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "tdma_bus.h"
+#include "adc_sections.h"
+#include "modbus_server.h"
+#include "pwm_sync.h"
+#include "telemetry_frame.h"
+
+#if TDMA_BUS_ENABLE && MODBUS_SERVER_ENABLE
+#error "TDMA_BUS_ENABLE and MODBUS_SERVER_ENABLE both need DMA1 Stream6"
+#endif
+
+#if TDMA_BUS_ENABLE && PWM_SYNC_ENABLE
+#error "TDMA_BUS_ENABLE counts TIM2 scan triggers, idle under PWM_SYNC_ENABLE"
+#endif
+
+/* Private defines -----------------------------------------------------------*/
+#define TDMA_BUS_MASTER (TDMA_BUS_ADDRESS == 0U)
+#define TDMA_BUS_TYPE_BEACON 0xB0U
+#define TDMA_BUS_TYPE_DATA 0xD0U
+#define TDMA_BUS_BEACON_SIZE 15U // type, cycle, slot, nodes, rate, CRC
+#define TDMA_BUS_BITS_PER_BYTE 10U
+#define TDMA_BUS_RX_COUNT (TDMA_BUS_FRAME_MAX + 1U) // one more: overlong
+#define TDMA_BUS_LINES(bytes)                                                  \
+  ((((bytes) + ADC_DCACHE_LINE_SIZE - 1U) / ADC_DCACHE_LINE_SIZE) *            \
+   ADC_DCACHE_LINE_SIZE)
+#define TDMA_BUS_BUFFER_BYTES TDMA_BUS_LINES(TDMA_BUS_RX_COUNT)
+#define TDMA_BUS_RX_RING (TDMA_BUS_MASTER ? TDMA_BUS_RX_BUFFERS : 1U)
+#define TDMA_BUS_TX_BUFFERS (TDMA_BUS_MASTER ? 1U : 2U)
+#define TDMA_BUS_SHORT_INDEX 2U // tx_index of the beacon or a heartbeat
+#define TDMA_BUS_RX_ERRORS (USART_ISR_FE | USART_ISR_NE | USART_ISR_ORE)
+#define TDMA_BUS_RX_CLEAR (USART_ICR_FECF | USART_ICR_NCF | USART_ICR_ORECF)
+
+#if TDMA_BUS_FRAME_MAX < TDMA_BUS_BEACON_SIZE || TDMA_BUS_FRAME_MAX > 65534
+#error "TDMA_BUS_FRAME_MAX must hold a beacon and fit 16 bits"
+#endif
+
+/* Private variables ---------------------------------------------------------*/
+static UART_HandleTypeDef huart_tdma;
+static DMA_HandleTypeDef hdma_tdma_rx;
+static DMA_HandleTypeDef hdma_tdma_tx;
+static uint8_t ready = 0;
+static volatile uint8_t running = 0;
+
+// Schedule; a node takes slot_frames and nodes from the beacon
+static uint32_t rate_hz = 0;
+static uint16_t slot_frames = 0;
+static uint8_t nodes = 0;
+static volatile uint16_t capacity = 0; // payload bytes per slot
+static uint32_t cycle_frames = 0;
+static uint32_t cycle_bits = 0;
+
+static uint8_t rx_buffer[TDMA_BUS_RX_RING][TDMA_BUS_BUFFER_BYTES]
+    ADC_SRAM1_BSS ADC_DMA_ALIGNED;
+static uint16_t rx_len[TDMA_BUS_RX_RING];
+static uint32_t rx_cycle[TDMA_BUS_RX_RING];
+static uint8_t rx_head = 0;           // buffer the stream is filling
+static uint8_t rx_tail = 0;           // oldest frame for tdmaBus_poll()
+static volatile uint8_t rx_count = 0; // frames waiting for tdmaBus_poll()
+static uint8_t rx_armed = 0;
+static uint8_t rx_error = 0;
+
+static uint8_t tx_buffer[TDMA_BUS_TX_BUFFERS][TDMA_BUS_BUFFER_BYTES]
+    ADC_SRAM1_BSS ADC_DMA_ALIGNED;
+static uint8_t short_frame[ADC_DCACHE_LINE_SIZE] ADC_SRAM1_BSS
+    ADC_DMA_ALIGNED;
+static volatile uint16_t sealed_len[TDMA_BUS_TX_BUFFERS]; // 0 = free
+static uint8_t fill = 0;          // buffer tdmaBus_reserve() appends to
+static uint16_t fill_len = 0;     // ... its payload so far
+static uint16_t reserved = 0;     // ... and the open reservation
+static volatile uint16_t seq = 0; // of the next data frame
+static uint8_t tx_busy = 0;
+static uint8_t tx_index = 0;
+
+static uint32_t cycle = 0;        // master: current, node: last beacon's
+static uint32_t busy_bits = 0;    // master: on the wire this cycle
+static uint8_t present = 0;       // master: nodes heard this cycle
+static uint32_t closed = 0;       // master: updates since the start
+static uint64_t util_sum = 0;     // ... and their util, summed
+static uint8_t locked = 0;        // node: beacon seen, phase set
+static uint32_t beacon_age = 0;   // node: slots since the last beacon
+
+static TdmaBus_FrameCallback_t frame_callback = NULL;
+static void *frame_ctx = NULL;
+static TdmaBus_Stats_t stats_ = {0};
+
+/* Private functions ---------------------------------------------------------*/
+
+static void tdmaBus_put16(uint8_t *p, uint16_t v) {
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+}
+
+static void tdmaBus_put32(uint8_t *p, uint32_t v) {
+  tdmaBus_put16(p, (uint16_t)v);
+  tdmaBus_put16(p + 2, (uint16_t)(v >> 16));
+}
+
+static uint16_t tdmaBus_get16(const uint8_t *p) {
+  return (uint16_t)(p[0] | ((uint16_t)p[1] << 8));
+}
+
+static uint32_t tdmaBus_get32(const uint8_t *p) {
+  return tdmaBus_get16(p) | ((uint32_t)tdmaBus_get16(p + 2) << 16);
+}
+
+/**
+ * @brief Payload bytes a slot of sf frames carries at rate_hz, after the
+ *        guard and the receiver timeout (0 = not even a beacon fits)
+ */
+static uint16_t tdmaBus_capacity(uint16_t sf) {
+  const uint64_t slot_bits = (uint64_t)sf * TDMA_BUS_BAUD / rate_hz;
+  const uint64_t guard_bits =
+      (uint64_t)TDMA_BUS_GUARD_US * TDMA_BUS_BAUD / 1000000U +
+      TDMA_BUS_RTO_BITS;
+  if (slot_bits <= guard_bits) {
+    return 0;
+  }
+  uint64_t bytes = (slot_bits - guard_bits) / TDMA_BUS_BITS_PER_BYTE;
+  if (bytes > TDMA_BUS_FRAME_MAX) {
+    bytes = TDMA_BUS_FRAME_MAX;
+  }
+  if (bytes < TDMA_BUS_BEACON_SIZE) {
+    return 0;
+  }
+  return (uint16_t)(bytes - TDMA_BUS_HEADER_SIZE - TDMA_BUS_CRC_SIZE);
+}
+
+/**
+ * @brief Apply a schedule to the slot counter (TIM9 stopped or running)
+ */
+static HAL_StatusTypeDef tdmaBus_schedule(uint16_t sf, uint8_t n) {
+  const uint32_t frames = (uint32_t)(n + 1U) * sf;
+  const uint16_t cap = tdmaBus_capacity(sf);
+  if (sf == 0U || n < 1U || n > TDMA_BUS_MAX_NODES || frames > 65536U ||
+      cap == 0U) {
+    return HAL_ERROR;
+  }
+  slot_frames = sf;
+  nodes = n;
+  cycle_frames = frames;
+  cycle_bits = (uint32_t)((uint64_t)frames * TDMA_BUS_BAUD / rate_hz);
+  capacity = cap;
+  TIM9->ARR = frames - 1U;
+  TIM9->CCR1 = (uint32_t)TDMA_BUS_ADDRESS * sf;
+  return HAL_OK;
+}
+
+static void tdmaBus_initPins(void) {
+  GPIO_InitTypeDef gpio = {.Pin = GPIO_PIN_0 | GPIO_PIN_1,
+                           .Mode = GPIO_MODE_AF_PP,
+                           .Pull = GPIO_NOPULL,
+                           .Speed = GPIO_SPEED_FREQ_VERY_HIGH,
+                           .Alternate = GPIO_AF8_UART8};
+  __HAL_RCC_GPIOE_CLK_ENABLE();
+  __HAL_RCC_GPIOD_CLK_ENABLE();
+  HAL_GPIO_Init(GPIOE, &gpio);
+  gpio.Pin = GPIO_PIN_15; // UART8_DE
+  HAL_GPIO_Init(GPIOD, &gpio);
+}
+
+static HAL_StatusTypeDef tdmaBus_initUart(void) {
+  RCC_PeriphCLKInitTypeDef clk = {0};
+  clk.PeriphClockSelection = RCC_PERIPHCLK_UART8;
+  clk.Uart8ClockSelection = RCC_UART8CLKSOURCE_PCLK1;
+  if (HAL_RCCEx_PeriphCLKConfig(&clk) != HAL_OK) {
+    return HAL_ERROR;
+  }
+  __HAL_RCC_UART8_CLK_ENABLE();
+
+  huart_tdma.Instance = UART8;
+  huart_tdma.Init.BaudRate = TDMA_BUS_BAUD;
+  huart_tdma.Init.WordLength = UART_WORDLENGTH_8B;
+  huart_tdma.Init.StopBits = UART_STOPBITS_1;
+  huart_tdma.Init.Parity = UART_PARITY_NONE; // the frame CRC covers it
+  huart_tdma.Init.Mode = UART_MODE_TX_RX;
+  huart_tdma.Init.HwFlowCtl = UART_HWCONTROL_NONE;
+  huart_tdma.Init.OverSampling = UART_OVERSAMPLING_16;
+  huart_tdma.Init.OneBitSampling = UART_ONE_BIT_SAMPLE_DISABLE;
+  huart_tdma.AdvancedInit.AdvFeatureInit = UART_ADVFEATURE_NO_INIT;
+  // DE asserted and released by the USART around each frame
+  if (HAL_RS485Ex_Init(&huart_tdma, UART_DE_POLARITY_HIGH, 0U, 0U) !=
+      HAL_OK) {
+    return HAL_ERROR;
+  }
+  HAL_UART_ReceiverTimeout_Config(&huart_tdma, TDMA_BUS_RTO_BITS);
+  if (HAL_UART_EnableReceiverTimeout(&huart_tdma) != HAL_OK) {
+    return HAL_ERROR;
+  }
+  SET_BIT(UART8->CR1, USART_CR1_RTOIE);
+  SET_BIT(UART8->CR3, USART_CR3_EIE);
+
+  HAL_NVIC_SetPriority(UART8_IRQn, TDMA_BUS_IRQ_PRIORITY, 0);
+  HAL_NVIC_EnableIRQ(UART8_IRQn);
+  return HAL_OK;
+}
+
+static HAL_StatusTypeDef tdmaBus_initStream(DMA_HandleTypeDef *hdma,
+                                            DMA_Stream_TypeDef *stream,
+                                            uint32_t direction) {
+  hdma->Instance = stream;
+  hdma->Init.Channel = DMA_CHANNEL_5;
+  hdma->Init.Direction = direction;
+  hdma->Init.PeriphInc = DMA_PINC_DISABLE;
+  hdma->Init.MemInc = DMA_MINC_ENABLE;
+  hdma->Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+  hdma->Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+  hdma->Init.Mode = DMA_NORMAL;
+  hdma->Init.Priority = DMA_PRIORITY_HIGH; // the slot edge waits for it
+  hdma->Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+  return HAL_DMA_Init(hdma);
+}
+
+static HAL_StatusTypeDef tdmaBus_initDma(void) {
+  __HAL_RCC_DMA1_CLK_ENABLE();
+  // No stream interrupts: the USART's RTOF and TC end both transfers
+  if (tdmaBus_initStream(&hdma_tdma_rx, DMA1_Stream6, DMA_PERIPH_TO_MEMORY) !=
+          HAL_OK ||
+      tdmaBus_initStream(&hdma_tdma_tx, DMA1_Stream0, DMA_MEMORY_TO_PERIPH) !=
+          HAL_OK) {
+    return HAL_ERROR;
+  }
+  return HAL_OK;
+}
+
+/**
+ * @brief Receive the next frame into rx_buffer[rx_head]
+ */
+static void tdmaBus_armRx(void) {
+  rx_error = 0;
+  UART8->ICR = TDMA_BUS_RX_CLEAR | USART_ICR_RTOCF;
+  UART8->RQR = USART_RQR_RXFRQ;
+  if (HAL_DMA_Start(&hdma_tdma_rx, (uint32_t)&UART8->RDR,
+                    (uint32_t)rx_buffer[rx_head], TDMA_BUS_RX_COUNT) !=
+      HAL_OK) {
+    return; // not armed: the next tdmaBus_start() recovers
+  }
+  SET_BIT(UART8->CR3, USART_CR3_DMAR);
+  rx_armed = 1;
+}
+
+/**
+ * @brief Send len bytes by DMA; TC releases the buffer
+ */
+static void tdmaBus_send(const uint8_t *data, uint16_t len, uint8_t index) {
+  UART8->ICR = USART_ICR_TCCF;
+  if (HAL_DMA_Start(&hdma_tdma_tx, (uint32_t)data, (uint32_t)&UART8->TDR,
+                    len) != HAL_OK) {
+    return;
+  }
+  SET_BIT(UART8->CR3, USART_CR3_DMAT);
+  SET_BIT(UART8->CR1, USART_CR1_TCIE);
+  tx_busy = 1;
+  tx_index = index;
+}
+
+/**
+ * @brief Node: a beacon arrived; take its schedule and cycle phase
+ */
+static void tdmaBus_beacon(const uint8_t *f) {
+  const uint16_t sf = tdmaBus_get16(&f[6]);
+  const uint8_t n = f[8];
+  stats_.cycles++;
+  if (tdmaBus_get32(&f[9]) != rate_hz ||
+      n < (TDMA_BUS_MASTER ? 1U : TDMA_BUS_ADDRESS) ||
+      ((sf != slot_frames || n != nodes) &&
+       tdmaBus_schedule(sf, n) != HAL_OK)) {
+    stats_.mismatches++;
+    locked = 0;
+    return;
+  }
+  cycle = tdmaBus_get32(&f[2]);
+  beacon_age = 0;
+
+  // The master's update was one beacon and one timeout ago
+  const uint32_t target =
+      (uint32_t)((uint64_t)(TDMA_BUS_BEACON_SIZE * TDMA_BUS_BITS_PER_BYTE +
+                            TDMA_BUS_RTO_BITS) *
+                 rate_hz / TDMA_BUS_BAUD) %
+      cycle_frames;
+  const uint32_t cnt = TIM9->CNT;
+  uint32_t diff = (cnt >= target) ? cnt - target : target - cnt;
+  if (diff > cycle_frames - diff) {
+    diff = cycle_frames - diff;
+  }
+  if (!locked) {
+    TIM9->CNT = target;
+  } else if (diff > 1U) {
+    TIM9->CNT = target;
+    stats_.resyncs++;
+  }
+  locked = 1;
+}
+
+/**
+ * @brief RTOF: a frame ended; queue it (master) or look for a beacon (node)
+ */
+static void tdmaBus_frameEnd(void) {
+  const uint16_t len =
+      (uint16_t)(TDMA_BUS_RX_COUNT - __HAL_DMA_GET_COUNTER(&hdma_tdma_rx));
+  CLEAR_BIT(UART8->CR3, USART_CR3_DMAR);
+  (void)HAL_DMA_Abort(&hdma_tdma_rx);
+  rx_armed = 0;
+  const uint8_t *f = rx_buffer[rx_head];
+  if (rx_error || len == 0U) {
+    stats_.uart_errors += rx_error;
+    busy_bits += (uint32_t)len * TDMA_BUS_BITS_PER_BYTE;
+    tdmaBus_armRx();
+    return;
+  }
+  SCB_InvalidateDCache_by_Addr((uint32_t *)rx_buffer[rx_head],
+                               (int32_t)ADC_DCACHE_LINE_SIZE); // the header
+
+  if (!TDMA_BUS_MASTER) {
+    // Other nodes' frames are heard and ignored
+    if (len == TDMA_BUS_BEACON_SIZE && f[0] == 0U &&
+        f[1] == TDMA_BUS_TYPE_BEACON &&
+        telemetryFrame_crc16(f, TDMA_BUS_BEACON_SIZE - TDMA_BUS_CRC_SIZE) ==
+            tdmaBus_get16(&f[TDMA_BUS_BEACON_SIZE - TDMA_BUS_CRC_SIZE])) {
+      tdmaBus_beacon(f);
+    }
+    tdmaBus_armRx();
+    return;
+  }
+
+  const uint8_t node = f[0];
+  if (node == 0U) {
+    tdmaBus_armRx(); // the transceiver's echo of the beacon
+    return;
+  }
+  busy_bits += (uint32_t)len * TDMA_BUS_BITS_PER_BYTE;
+  if (len < TDMA_BUS_HEADER_SIZE + TDMA_BUS_CRC_SIZE ||
+      len > capacity + TDMA_BUS_HEADER_SIZE + TDMA_BUS_CRC_SIZE ||
+      node > nodes || f[1] != TDMA_BUS_TYPE_DATA) {
+    stats_.bad_frames++;
+    tdmaBus_armRx();
+    return;
+  }
+  if (TIM9->CNT / slot_frames != node) {
+    stats_.late++;
+  }
+  present |= (uint8_t)(1U << (node - 1U));
+  rx_len[rx_head] = len;
+  rx_cycle[rx_head] = cycle;
+  if (rx_count + 1U < TDMA_BUS_RX_RING) {
+    rx_head = (uint8_t)((rx_head + 1U) % TDMA_BUS_RX_RING);
+    rx_count++;
+  } else {
+    stats_.overruns++; // the buffer is reused for the next frame
+  }
+  tdmaBus_armRx();
+}
+
+/**
+ * @brief TC: the frame's last stop bit is out (DE released)
+ */
+static void tdmaBus_sendDone(void) {
+  CLEAR_BIT(UART8->CR1, USART_CR1_TCIE);
+  CLEAR_BIT(UART8->CR3, USART_CR3_DMAT);
+  (void)HAL_DMA_Abort(&hdma_tdma_tx); // finished; back to READY
+  UART8->ICR = USART_ICR_TCCF;
+  if (tx_index < TDMA_BUS_TX_BUFFERS) {
+    sealed_len[tx_index] = 0;
+  }
+  tx_busy = 0;
+}
+
+/**
+ * @brief Master, TIM9 update: close the last cycle, open the next one
+ */
+static void tdmaBus_cycleStart(void) {
+  if (closed++ != 0U) { // the first update only opens a cycle
+    uint32_t util = (uint32_t)((uint64_t)busy_bits * 1000U / cycle_bits);
+    if (util > 1000U) {
+      util = 1000U;
+    }
+    stats_.util_last = (uint16_t)util;
+    if (util > stats_.util_max) {
+      stats_.util_max = (uint16_t)util;
+    }
+    util_sum += util;
+    stats_.util_mean = (uint16_t)(util_sum / (closed - 1U));
+    const uint8_t expected = (uint8_t)((1U << nodes) - 1U);
+    stats_.missed += (uint32_t)__builtin_popcount(expected & ~present);
+    stats_.present_mask = present;
+  }
+  present = 0;
+  busy_bits = 0;
+  cycle++;
+  if (tx_busy) {
+    return; // the last beacon is still out: this cycle goes without
+  }
+
+  short_frame[0] = 0U;
+  short_frame[1] = TDMA_BUS_TYPE_BEACON;
+  tdmaBus_put32(&short_frame[2], cycle);
+  tdmaBus_put16(&short_frame[6], slot_frames);
+  short_frame[8] = nodes;
+  tdmaBus_put32(&short_frame[9], rate_hz);
+  tdmaBus_put16(&short_frame[13],
+                telemetryFrame_crc16(short_frame, TDMA_BUS_BEACON_SIZE -
+                                                      TDMA_BUS_CRC_SIZE));
+  SCB_CleanDCache_by_Addr((uint32_t *)short_frame,
+                          (int32_t)sizeof(short_frame));
+  tdmaBus_send(short_frame, TDMA_BUS_BEACON_SIZE, TDMA_BUS_SHORT_INDEX);
+  busy_bits += TDMA_BUS_BEACON_SIZE * TDMA_BUS_BITS_PER_BYTE;
+  stats_.cycles++;
+}
+
+/**
+ * @brief Node, TIM9 CC1: this node's slot begins; send the sealed frame or
+ *        a heartbeat
+ */
+static void tdmaBus_slotStart(void) {
+  if (locked && ++beacon_age > TDMA_BUS_HOLDOVER_CYCLES) {
+    locked = 0;
+  }
+  if (!locked) {
+    stats_.holdovers++;
+    return;
+  }
+  if (tx_busy) {
+    stats_.late++;
+    return;
+  }
+  const uint16_t max_len = capacity + TDMA_BUS_HEADER_SIZE + TDMA_BUS_CRC_SIZE;
+  for (uint8_t i = 0; i < TDMA_BUS_TX_BUFFERS; i++) {
+    const uint16_t len = sealed_len[i];
+    if (len == 0U) {
+      continue;
+    }
+    if (len > max_len) {
+      sealed_len[i] = 0; // sealed before the schedule shrank
+      stats_.dropped++;
+      break;
+    }
+    tdmaBus_send(tx_buffer[i], len, i);
+    stats_.frames++;
+    stats_.payload_bytes += len - TDMA_BUS_HEADER_SIZE - TDMA_BUS_CRC_SIZE;
+    return;
+  }
+
+  short_frame[0] = TDMA_BUS_ADDRESS;
+  short_frame[1] = TDMA_BUS_TYPE_DATA;
+  tdmaBus_put16(&short_frame[2], seq);
+  tdmaBus_put16(&short_frame[4],
+                telemetryFrame_crc16(short_frame, TDMA_BUS_HEADER_SIZE));
+  SCB_CleanDCache_by_Addr((uint32_t *)short_frame,
+                          (int32_t)sizeof(short_frame));
+  tdmaBus_send(short_frame, TDMA_BUS_HEADER_SIZE + TDMA_BUS_CRC_SIZE,
+               TDMA_BUS_SHORT_INDEX);
+  stats_.heartbeats++;
+}
+
+/**
+ * @brief Node: close the filling buffer into a frame once the other one
+ *        is free
+ */
+static void tdmaBus_seal(void) {
+  const uint8_t other = fill ^ 1U;
+  if (fill_len == 0U || sealed_len[other] != 0U) {
+    return;
+  }
+  uint8_t *b = tx_buffer[fill];
+  b[0] = TDMA_BUS_ADDRESS;
+  b[1] = TDMA_BUS_TYPE_DATA;
+  tdmaBus_put16(&b[2], seq);
+  const uint16_t n = (uint16_t)(TDMA_BUS_HEADER_SIZE + fill_len);
+  tdmaBus_put16(&b[n], telemetryFrame_crc16(b, n));
+  const uint16_t len = (uint16_t)(n + TDMA_BUS_CRC_SIZE);
+  SCB_CleanDCache_by_Addr((uint32_t *)b, (int32_t)TDMA_BUS_LINES(len));
+  __DMB();
+  sealed_len[fill] = len; // the slot may send it from here on
+  seq++;
+  fill = other;
+  fill_len = 0;
+}
+
+/**
+ * @brief Master: check the queued frames and hand their payload over
+ */
+static void tdmaBus_deliver(void) {
+  while (rx_count != 0U) {
+    const uint8_t i = rx_tail;
+    const uint8_t *f = rx_buffer[i];
+    const uint16_t len = rx_len[i];
+    SCB_InvalidateDCache_by_Addr((uint32_t *)rx_buffer[i],
+                                 (int32_t)TDMA_BUS_LINES(len));
+    const uint16_t n = (uint16_t)(len - TDMA_BUS_CRC_SIZE);
+    const uint8_t good = telemetryFrame_crc16(f, n) == tdmaBus_get16(&f[n]);
+    const uint16_t payload = (uint16_t)(n - TDMA_BUS_HEADER_SIZE);
+    if (good && payload != 0U && frame_callback != NULL) {
+      frame_callback(f[0], rx_cycle[i], &f[TDMA_BUS_HEADER_SIZE], payload,
+                     frame_ctx);
+    }
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    if (!good) {
+      stats_.bad_frames++;
+    } else if (payload == 0U) {
+      stats_.heartbeats++;
+    } else {
+      stats_.frames++;
+      stats_.payload_bytes += payload;
+    }
+    rx_tail = (uint8_t)((i + 1U) % TDMA_BUS_RX_RING);
+    rx_count--;
+    __set_PRIMASK(primask);
+  }
+}
+
+/* Public functions ----------------------------------------------------------*/
+
+HAL_StatusTypeDef tdmaBus_init(void) {
+#if !TDMA_BUS_ENABLE
+  return HAL_OK; // not on a bus: UART8, TIM9 and the streams stay free
+#endif
+  tdmaBus_initPins();
+  if (tdmaBus_initDma() != HAL_OK || tdmaBus_initUart() != HAL_OK) {
+    return HAL_ERROR;
+  }
+  // TIM9 counts TIM2 updates (ITR0, external clock mode 1): scan frames
+  __HAL_RCC_TIM9_CLK_ENABLE();
+  TIM9->CR1 = 0;
+  TIM9->DIER = 0;
+  TIM9->SMCR = TIM_SMCR_SMS_2 | TIM_SMCR_SMS_1 | TIM_SMCR_SMS_0; // TS = ITR0
+  TIM9->PSC = 0;
+  HAL_NVIC_SetPriority(TIM1_BRK_TIM9_IRQn, TDMA_BUS_IRQ_PRIORITY, 0);
+  HAL_NVIC_EnableIRQ(TIM1_BRK_TIM9_IRQn);
+  ready = 1;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef tdmaBus_start(uint32_t frame_rate_hz) {
+  if (!ready || frame_rate_hz == 0U) {
+    return HAL_ERROR;
+  }
+  tdmaBus_stop();
+  rate_hz = frame_rate_hz;
+  if (tdmaBus_schedule(TDMA_BUS_SLOT_FRAMES, TDMA_BUS_NODES) != HAL_OK) {
+    return HAL_ERROR;
+  }
+  stats_ = (TdmaBus_Stats_t){0};
+  cycle = 0;
+  busy_bits = 0;
+  present = 0;
+  closed = 0;
+  util_sum = 0;
+  locked = 0;
+  beacon_age = 0;
+  rx_head = 0;
+  rx_tail = 0;
+  rx_count = 0;
+  fill = 0;
+  fill_len = 0;
+  reserved = 0;
+
+  TIM9->EGR = TIM_EGR_UG; // load PSC, CNT = 0
+  TIM9->CNT = TIM9->ARR;  // master: the next scan frame opens a cycle
+  TIM9->SR = 0;
+  TIM9->DIER = TDMA_BUS_MASTER ? TIM_DIER_UIE : TIM_DIER_CC1IE;
+  running = 1;
+  tdmaBus_armRx();
+  TIM9->CR1 = TIM_CR1_CEN;
+  return rx_armed ? HAL_OK : HAL_ERROR;
+}
+
+void tdmaBus_stop(void) {
+  if (!ready) {
+    return;
+  }
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  TIM9->CR1 = 0;
+  TIM9->DIER = 0;
+  TIM9->SR = 0;
+  CLEAR_BIT(UART8->CR1, USART_CR1_TCIE);
+  CLEAR_BIT(UART8->CR3, USART_CR3_DMAR | USART_CR3_DMAT);
+  (void)HAL_DMA_Abort(&hdma_tdma_rx);
+  (void)HAL_DMA_Abort(&hdma_tdma_tx);
+  rx_armed = 0;
+  tx_busy = 0;
+  for (uint8_t i = 0; i < TDMA_BUS_TX_BUFFERS; i++) {
+    sealed_len[i] = 0;
+  }
+  running = 0;
+  __set_PRIMASK(primask);
+}
+
+uint8_t *tdmaBus_reserve(uint16_t len) {
+  if (TDMA_BUS_MASTER || !running) {
+    return NULL;
+  }
+  if ((uint32_t)fill_len + len > capacity) {
+    stats_.dropped++;
+    reserved = 0;
+    return NULL;
+  }
+  reserved = len;
+  return &tx_buffer[fill][TDMA_BUS_HEADER_SIZE + fill_len];
+}
+
+void tdmaBus_commit(uint16_t len) {
+  fill_len = (uint16_t)(fill_len + ((len < reserved) ? len : reserved));
+  reserved = 0;
+}
+
+void tdmaBus_poll(void) {
+  if (!running) {
+    return;
+  }
+  if (TDMA_BUS_MASTER) {
+    tdmaBus_deliver();
+  } else {
+    tdmaBus_seal();
+  }
+}
+
+void tdmaBus_registerFrameCallback(TdmaBus_FrameCallback_t callback,
+                                   void *ctx) {
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  frame_callback = callback;
+  frame_ctx = ctx;
+  __set_PRIMASK(primask);
+}
+
+HAL_StatusTypeDef tdmaBus_getStats(TdmaBus_Stats_t *stats) {
+  if (stats == NULL) {
+    return HAL_ERROR;
+  }
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  *stats = stats_;
+  stats->running = running;
+  stats->locked = TDMA_BUS_MASTER ? running : locked;
+  stats->nodes = nodes;
+  stats->slot_frames = slot_frames;
+  stats->capacity = capacity;
+  __set_PRIMASK(primask);
+  stats->cycle_us =
+      rate_hz ? (uint32_t)((uint64_t)cycle_frames * 1000000U / rate_hz) : 0U;
+  return HAL_OK;
+}
+
+void tdmaBus_uartIrqHandler(void) {
+  const uint32_t isr = UART8->ISR;
+  if ((isr & TDMA_BUS_RX_ERRORS) != 0U) {
+    UART8->ICR = TDMA_BUS_RX_CLEAR;
+    if (rx_armed) {
+      rx_error = 1; // the frame is dropped at its RTOF
+    }
+  }
+  if ((isr & USART_ISR_RTOF) != 0U) {
+    UART8->ICR = USART_ICR_RTOCF;
+    if (rx_armed) {
+      tdmaBus_frameEnd();
+    }
+  }
+  if ((isr & USART_ISR_TC) != 0U && (UART8->CR1 & USART_CR1_TCIE) != 0U) {
+    tdmaBus_sendDone();
+  }
+}
+
+void tdmaBus_timIrqHandler(void) {
+  const uint32_t sr = TIM9->SR & TIM9->DIER;
+  TIM9->SR = ~sr;
+  if (!running) {
+    return;
+  }
+  if ((sr & TIM_SR_UIF) != 0U) {
+    tdmaBus_cycleStart();
+  }
+  if ((sr & TIM_SR_CC1IF) != 0U) {
+    tdmaBus_slotStart();
+  }
+}
@@ -0,0 +1,554 @@
+/**
+ ******************************************************************************
+ * @file    telemetry.c
+ * @brief   Implementation of the USART3 TX DMA telemetry queues
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "telemetry.h"
+#include "adc_sections.h"
+#include "app_sched.h"
+#include "irq_priority.h"
+#include "latency_hist.h"
+#include "timebase.h"
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define TELEMETRY_SLOT_MASK (TELEMETRY_SLOT_COUNT - 1U)
+
+/* NVIC priority of DMA1_Stream3 and USART3 (irq_priority.h). The kick in
+ * telemetry_send() masks only this level and below through BASEPRI, so the
+ * ADC DMA interrupt keeps running. */
+#define TELEMETRY_IRQ_PRIORITY IRQ_PRIORITY_COMMS
+
+#if (TELEMETRY_SLOT_COUNT & TELEMETRY_SLOT_MASK) != 0
+#error "TELEMETRY_SLOT_COUNT must be a power of two"
+#endif
+
+/* Budget arithmetic: a full byte-rate second per refill at most */
+#define TELEMETRY_REFILL_MAX_MS 1000U
+
+#if (TELEMETRY_SLOT_SIZE % ADC_DCACHE_LINE_SIZE) != 0
+#error "TELEMETRY_SLOT_SIZE must be a multiple of ADC_DCACHE_LINE_SIZE"
+#endif
+
+/* Private types -------------------------------------------------------------*/
+
+/**
+ * @brief Slots and counters of one class
+ */
+typedef struct {
+  uint16_t lengths[TELEMETRY_SLOT_COUNT];
+  uint16_t counts[TELEMETRY_SLOT_COUNT]; // messages in each slot
+  volatile uint32_t head;                // written by the producer only
+  volatile uint32_t tail;                // written by the TX callbacks only
+  uint32_t opened_ms;                    // first slot queued on an empty class
+  volatile uint8_t holding;              // newest slot is being appended to
+  volatile uint32_t sent;
+  uint32_t dropped;
+  uint32_t throttled;
+  uint32_t high_water;
+  uint64_t origins[TELEMETRY_SLOT_COUNT]; // oldest data stamp, 0 = none
+  Telemetry_Budget_t budget;
+  uint32_t tokens;    // milli-bytes, so a 1 ms refill keeps its fraction
+  uint32_t refill_ms;
+} Telemetry_Queue_t;
+
+/* Private variables ---------------------------------------------------------*/
+static UART_HandleTypeDef *tx_uart = NULL;
+
+/* DMA source: SRAM2, cache-line aligned so each slot can be cleaned alone */
+static uint8_t tx_slots[TELEMETRY_CLASS_COUNT][TELEMETRY_SLOT_COUNT]
+                       [TELEMETRY_SLOT_SIZE] ADC_SRAM2_BSS ADC_DMA_ALIGNED;
+static Telemetry_Queue_t tx_queues[TELEMETRY_CLASS_COUNT];
+
+static volatile uint8_t tx_active = 0;  // a DMA transfer is in flight
+static volatile uint8_t tx_class = 0;   // class of that transfer
+
+/* Open telemetry_reserve(): none, appending to the class's newest slot, or
+ * filling its next slot before it is published */
+static enum { RESERVE_NONE, RESERVE_APPEND, RESERVE_FRESH } tx_reserved;
+static Telemetry_Class_t tx_reserved_cls;
+static uint16_t tx_reserved_max;
+
+static volatile uint32_t tx_transfers = 0;
+static uint32_t tx_batched = 0;
+static volatile uint32_t tx_errors = 0;
+
+/* Batch hold (telemetry_setBatchHold()), TELEMETRY_BATCH_HOLD_MS at boot */
+static volatile uint32_t batch_hold_ms = TELEMETRY_BATCH_HOLD_MS;
+
+/* Link settings, changed from the producer context only */
+static Telemetry_LinkInfo_t link_info = {0};
+static uint32_t link_set_ms = 0;
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+ * @brief Start DMA on the oldest slot of the highest queued class if the
+ *        link is idle
+ *
+ * @note Runs from the TX callbacks or with TELEMETRY_IRQ_PRIORITY masked
+ */
+static void telemetry_startNext(void) {
+  while (!tx_active) {
+    uint8_t cls = 0;
+    // A slot being appended to by telemetry_reserve() must wait
+    while (cls < TELEMETRY_CLASS_COUNT &&
+           tx_queues[cls].head - tx_queues[cls].tail <=
+               (tx_queues[cls].holding ? 1U : 0U)) {
+      cls++;
+    }
+    if (cls == TELEMETRY_CLASS_COUNT) {
+      return;
+    }
+    Telemetry_Queue_t *q = &tx_queues[cls];
+    uint32_t slot = q->tail & TELEMETRY_SLOT_MASK;
+
+    // Push the CPU-written bytes out to SRAM before DMA reads them
+    SCB_CleanDCache_by_Addr((uint32_t *)tx_slots[cls][slot],
+                            TELEMETRY_SLOT_SIZE);
+
+    tx_active = 1;
+    tx_class = cls;
+    if (HAL_UART_Transmit_DMA(tx_uart, tx_slots[cls][slot],
+                              q->lengths[slot]) == HAL_OK) {
+      return;
+    }
+
+    // Could not start: discard this slot so the queue cannot stall
+    tx_active = 0;
+    tx_errors++;
+    q->tail++;
+  }
+}
+
+/**
+ * @brief Release the in-flight slot and chain the next one
+ */
+static void telemetry_txDone(uint8_t failed) {
+  if (!tx_active) {
+    return;
+  }
+  Telemetry_Queue_t *q = &tx_queues[tx_class];
+  if (failed) {
+    tx_errors++;
+  } else {
+    const uint32_t slot = q->tail & TELEMETRY_SLOT_MASK;
+    q->sent += q->counts[slot];
+    tx_transfers++;
+    if (q->origins[slot] != 0U) {
+      latencyHist_recordTicks(LATENCY_HIST_BLOCK_TX,
+                              timebase_now() - q->origins[slot]);
+    }
+  }
+  q->tail++;
+  tx_active = 0;
+  telemetry_startNext();
+  // A slot is free again for whatever waits on one
+  appSched_signal(APP_SCHED_EVENT_TX_DONE);
+}
+
+/**
+ * @brief Refill a class bucket and check it holds len bytes
+ *
+ * @return uint8_t 1 = the message may be queued (or the class is unlimited)
+ */
+static uint8_t telemetry_budgetAllows(Telemetry_Queue_t *q, uint16_t len) {
+  if (q->budget.share_pct == 0U) {
+    return 1;
+  }
+  // 10 bits per byte (8N1)
+  const uint32_t rate = link_info.actual_baud / 10U * q->budget.share_pct /
+                        100U;
+  const uint32_t now = HAL_GetTick();
+  uint32_t dt = now - q->refill_ms;
+  q->refill_ms = now;
+  if (dt > TELEMETRY_REFILL_MAX_MS) {
+    dt = TELEMETRY_REFILL_MAX_MS;
+  }
+  const uint32_t cap = (uint32_t)q->budget.burst_bytes * 1000U;
+  q->tokens += rate * dt; // bytes/s * ms = milli-bytes
+  if (q->tokens > cap) {
+    q->tokens = cap;
+  }
+  return (q->tokens >= (uint32_t)len * 1000U) ? 1U : 0U;
+}
+
+/**
+ * @brief Whether any class has a slot waiting or in flight
+ */
+static uint8_t telemetry_isQueued(void) {
+  for (uint8_t c = 0; c < TELEMETRY_CLASS_COUNT; c++) {
+    if (tx_queues[c].head != tx_queues[c].tail) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/**
+ * @brief telemetry_startNext() from the producer context
+ */
+static void telemetry_kick(void) {
+  uint32_t basepri = __get_BASEPRI();
+  __set_BASEPRI(TELEMETRY_IRQ_PRIORITY << (8U - __NVIC_PRIO_BITS));
+  __ISB();
+  telemetry_startNext();
+  __set_BASEPRI(basepri);
+}
+
+/**
+ * @brief Rate error in ppm of a divider result
+ */
+static uint32_t telemetry_errorPpm(uint32_t actual, uint32_t wanted) {
+  uint32_t diff = (actual > wanted) ? actual - wanted : wanted - actual;
+  return (uint32_t)((uint64_t)diff * 1000000U / wanted);
+}
+
+/**
+ * @brief Pick the oversampling for a rate: 16x unless 8x is needed or
+ *        clearly closer (BRR = fck / baud at 16x, 2 fck / baud at 8x)
+ */
+static HAL_StatusTypeDef telemetry_pickOversampling(uint32_t clk, uint32_t baud,
+                                                    uint8_t *over8,
+                                                    uint32_t *actual) {
+  uint32_t div16 = (clk + baud / 2U) / baud;
+  uint32_t div8 = (2U * clk + baud / 2U) / baud;
+  uint32_t err16 = UINT32_MAX;
+  uint32_t err8 = UINT32_MAX;
+
+  if (div16 >= 16U && div16 <= 0xFFFFU) {
+    err16 = telemetry_errorPpm(clk / div16, baud);
+  }
+  if (div8 >= 16U && div8 <= 0xFFFFU) {
+    err8 = telemetry_errorPpm(2U * clk / div8, baud);
+  }
+  if (err16 <= TELEMETRY_BAUD_TOLERANCE_PPM && err16 <= 2U * err8) {
+    *over8 = 0;
+    *actual = clk / div16;
+    return HAL_OK;
+  }
+  if (err8 <= TELEMETRY_BAUD_TOLERANCE_PPM) {
+    *over8 = 1;
+    *actual = 2U * clk / div8;
+    return HAL_OK;
+  }
+  return HAL_ERROR;
+}
+
+/* Public functions ----------------------------------------------------------*/
+
+HAL_StatusTypeDef telemetry_init(UART_HandleTypeDef *huart) {
+  if (huart == NULL || huart->hdmatx == NULL) {
+    return HAL_ERROR;
+  }
+  tx_uart = huart;
+  memset(tx_queues, 0, sizeof(tx_queues));
+  tx_active = 0;
+  tx_class = 0;
+  tx_reserved = RESERVE_NONE;
+  tx_transfers = 0;
+  tx_batched = 0;
+  tx_errors = 0;
+
+  link_info.baud_rate = huart->Init.BaudRate;
+  link_info.actual_baud = huart->Init.BaudRate;
+  link_info.oversampling_8 =
+      (huart->Init.OverSampling == UART_OVERSAMPLING_8) ? 1U : 0U;
+  link_info.flow_control =
+      (huart->Init.HwFlowCtl == UART_HWCONTROL_RTS_CTS) ? 1U : 0U;
+  link_info.confirmed = 1;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef telemetry_send(const uint8_t *data, uint16_t len) {
+  return telemetry_sendClass(data, len, TELEMETRY_CLASS_CONTROL);
+}
+
+HAL_StatusTypeDef telemetry_sendClass(const uint8_t *data, uint16_t len,
+                                      Telemetry_Class_t cls) {
+  if (tx_uart == NULL || data == NULL || len == 0U ||
+      len > TELEMETRY_SLOT_SIZE || (uint32_t)cls >= TELEMETRY_CLASS_COUNT ||
+      tx_reserved != RESERVE_NONE) {
+    return HAL_ERROR;
+  }
+  uint8_t *p = telemetry_reserve(cls, len);
+  if (p == NULL) {
+    return HAL_BUSY;
+  }
+  memcpy(p, data, len);
+  return telemetry_commit(len);
+}
+
+uint8_t *telemetry_reserve(Telemetry_Class_t cls, uint16_t max_len) {
+  if (tx_uart == NULL || max_len == 0U || max_len > TELEMETRY_SLOT_SIZE ||
+      (uint32_t)cls >= TELEMETRY_CLASS_COUNT ||
+      tx_reserved != RESERVE_NONE) {
+    return NULL;
+  }
+  Telemetry_Queue_t *q = &tx_queues[cls];
+
+  // Only the TX interrupts are held off: the newest slot cannot start
+  // between the check and the holding flag
+  uint32_t basepri = __get_BASEPRI();
+  __set_BASEPRI(TELEMETRY_IRQ_PRIORITY << (8U - __NVIC_PRIO_BITS));
+  __ISB();
+
+  uint8_t *p = NULL;
+  uint32_t head = q->head;
+  uint32_t used = head - q->tail;
+  uint32_t last = (head - 1U) & TELEMETRY_SLOT_MASK;
+  uint8_t in_flight = (tx_active && tx_class == (uint8_t)cls) ? 1U : 0U;
+  if (used > in_flight && q->lengths[last] + max_len <= TELEMETRY_SLOT_SIZE) {
+    // Newest slot is still waiting: share its transfer
+    q->holding = 1;
+    p = &tx_slots[cls][last][q->lengths[last]];
+    tx_reserved = RESERVE_APPEND;
+  } else if (used < TELEMETRY_SLOT_COUNT) {
+    // Not visible to the callbacks until the commit publishes it
+    p = tx_slots[cls][head & TELEMETRY_SLOT_MASK];
+    tx_reserved = RESERVE_FRESH;
+  } else {
+    q->dropped++;
+  }
+  __set_BASEPRI(basepri);
+
+  tx_reserved_cls = cls;
+  tx_reserved_max = max_len;
+  return p;
+}
+
+HAL_StatusTypeDef telemetry_commit(uint16_t len) {
+  return telemetry_commitStamped(len, 0U);
+}
+
+HAL_StatusTypeDef telemetry_commitStamped(uint16_t len, uint64_t origin) {
+  if (tx_reserved == RESERVE_NONE) {
+    return HAL_ERROR;
+  }
+  const Telemetry_Class_t cls = tx_reserved_cls;
+  Telemetry_Queue_t *q = &tx_queues[cls];
+  const uint8_t append = (tx_reserved == RESERVE_APPEND) ? 1U : 0U;
+  HAL_StatusTypeDef status = HAL_OK;
+  tx_reserved = RESERVE_NONE;
+  if (len > tx_reserved_max) {
+    status = HAL_ERROR;
+    len = 0;
+  } else if (len != 0U && !telemetry_budgetAllows(q, len)) {
+    q->throttled++;
+    status = HAL_BUSY;
+    len = 0;
+  }
+
+  uint32_t basepri = __get_BASEPRI();
+  __set_BASEPRI(TELEMETRY_IRQ_PRIORITY << (8U - __NVIC_PRIO_BITS));
+  __ISB();
+
+  uint32_t head = q->head;
+  if (append) {
+    uint32_t last = (head - 1U) & TELEMETRY_SLOT_MASK;
+    if (len != 0U) {
+      q->lengths[last] += len;
+      q->counts[last]++;
+      if (q->origins[last] == 0U) {
+        q->origins[last] = origin;
+      }
+      tx_batched++;
+    }
+    q->holding = 0;
+  } else if (len != 0U) {
+    uint32_t slot = head & TELEMETRY_SLOT_MASK;
+    uint32_t used = head - q->tail;
+    q->lengths[slot] = len;
+    q->counts[slot] = 1;
+    q->origins[slot] = origin;
+    if (used == 0U && batch_hold_ms > 0U) {
+      q->opened_ms = HAL_GetTick();
+    }
+
+    // Slot contents must be complete before the callbacks see the new head
+    __DMB();
+    q->head = head + 1U;
+    if (used + 1U > q->high_water) {
+      q->high_water = used + 1U;
+    }
+  }
+
+  // Kick the link if idle, unless the class's only slot may wait for more
+  if ((append || len != 0U) &&
+      (batch_hold_ms == 0U || cls == TELEMETRY_CLASS_ALARM ||
+       q->head - q->tail > 1U)) {
+    telemetry_startNext();
+  }
+  __set_BASEPRI(basepri);
+
+  if (len != 0U && q->budget.share_pct != 0U) {
+    q->tokens -= (uint32_t)len * 1000U;
+  }
+  return status;
+}
+
+uint32_t telemetry_getFreeSlots(void) {
+  return telemetry_getClassFreeSlots(TELEMETRY_CLASS_CONTROL);
+}
+
+uint32_t telemetry_getClassFreeSlots(Telemetry_Class_t cls) {
+  if ((uint32_t)cls >= TELEMETRY_CLASS_COUNT) {
+    return 0;
+  }
+  return TELEMETRY_SLOT_COUNT - (tx_queues[cls].head - tx_queues[cls].tail);
+}
+
+HAL_StatusTypeDef telemetry_setBudget(Telemetry_Class_t cls,
+                                      const Telemetry_Budget_t *budget) {
+  if ((uint32_t)cls >= TELEMETRY_CLASS_COUNT || budget == NULL ||
+      budget->share_pct > 100U ||
+      (budget->share_pct != 0U &&
+       budget->burst_bytes < TELEMETRY_SLOT_SIZE)) {
+    return HAL_ERROR;
+  }
+  Telemetry_Queue_t *q = &tx_queues[cls];
+  q->budget = *budget;
+  q->tokens = (uint32_t)budget->burst_bytes * 1000U;
+  q->refill_ms = HAL_GetTick();
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef telemetry_getStats(Telemetry_Stats_t *stats) {
+  if (stats == NULL) {
+    return HAL_ERROR;
+  }
+  memset(stats, 0, sizeof(*stats));
+  for (uint8_t c = 0; c < TELEMETRY_CLASS_COUNT; c++) {
+    const Telemetry_Queue_t *q = &tx_queues[c];
+    stats->queued += q->head - q->tail;
+    stats->sent += q->sent;
+    stats->dropped += q->dropped + q->throttled;
+    stats->throttled += q->throttled;
+    if (q->high_water > stats->high_water) {
+      stats->high_water = q->high_water;
+    }
+  }
+  stats->transfers = tx_transfers;
+  stats->batched = tx_batched;
+  stats->tx_errors = tx_errors;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef telemetry_getClassStats(Telemetry_Class_t cls,
+                                          Telemetry_ClassStats_t *stats) {
+  if ((uint32_t)cls >= TELEMETRY_CLASS_COUNT || stats == NULL) {
+    return HAL_ERROR;
+  }
+  const Telemetry_Queue_t *q = &tx_queues[cls];
+  stats->queued = q->head - q->tail;
+  stats->sent = q->sent;
+  stats->dropped = q->dropped;
+  stats->throttled = q->throttled;
+  stats->high_water = q->high_water;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef telemetry_setLink(const Telemetry_LinkConfig_t *cfg) {
+  if (tx_uart == NULL || cfg == NULL || cfg->baud_rate == 0U) {
+    return HAL_ERROR;
+  }
+
+  // USART3 is clocked from PCLK1 (usart.c)
+  uint8_t over8 = 0;
+  uint32_t actual = 0;
+  if (telemetry_pickOversampling(HAL_RCC_GetPCLK1Freq(), cfg->baud_rate,
+                                 &over8, &actual) != HAL_OK) {
+    return HAL_ERROR;
+  }
+
+  // Let queued packets (and the last stop bit) leave at the old rate
+  telemetry_kick();
+  uint32_t start = HAL_GetTick();
+  while (tx_active || telemetry_isQueued()) {
+    if (HAL_GetTick() - start > TELEMETRY_DRAIN_TIMEOUT_MS) {
+      return HAL_BUSY;
+    }
+  }
+
+  // Idle link, and telemetry_send() runs in this context: no DMA to race
+  tx_uart->Init.BaudRate = cfg->baud_rate;
+  tx_uart->Init.OverSampling = over8 ? UART_OVERSAMPLING_8
+                                     : UART_OVERSAMPLING_16;
+  tx_uart->Init.HwFlowCtl = cfg->flow_control ? UART_HWCONTROL_RTS_CTS
+                                              : UART_HWCONTROL_NONE;
+  if (HAL_UART_Init(tx_uart) != HAL_OK) {
+    return HAL_ERROR;
+  }
+
+  link_info.baud_rate = cfg->baud_rate;
+  link_info.actual_baud = actual;
+  link_info.oversampling_8 = over8;
+  link_info.flow_control = cfg->flow_control ? 1U : 0U;
+  link_info.confirmed = (cfg->baud_rate == TELEMETRY_DEFAULT_BAUD &&
+                         !cfg->flow_control)
+                            ? 1U
+                            : 0U;
+  link_set_ms = HAL_GetTick();
+  return HAL_OK;
+}
+
+void telemetry_confirmLink(void) { link_info.confirmed = 1; }
+
+void telemetry_setBatchHold(uint32_t hold_ms) {
+  batch_hold_ms = hold_ms;
+  if (hold_ms == 0U && tx_uart != NULL) {
+    telemetry_kick(); // nothing polls a slot held under the old setting
+  }
+}
+
+uint32_t telemetry_getBatchHold(void) { return batch_hold_ms; }
+
+void telemetry_poll(void) {
+  const uint32_t hold = batch_hold_ms;
+  for (uint8_t c = 0; c < TELEMETRY_CLASS_COUNT && hold > 0U; c++) {
+    const Telemetry_Queue_t *q = &tx_queues[c];
+    if (tx_uart != NULL && !tx_active && q->head != q->tail &&
+        HAL_GetTick() - q->opened_ms >= hold) {
+      telemetry_kick();
+    }
+  }
+  if (link_info.confirmed ||
+      HAL_GetTick() - link_set_ms < TELEMETRY_LINK_CONFIRM_MS) {
+    return;
+  }
+  const Telemetry_LinkConfig_t fallback = {.baud_rate = TELEMETRY_DEFAULT_BAUD,
+                                           .flow_control = 0};
+  telemetry_setLink(&fallback); // retried next poll if still draining
+}
+
+HAL_StatusTypeDef telemetry_getLink(Telemetry_LinkInfo_t *info) {
+  if (info == NULL || tx_uart == NULL) {
+    return HAL_ERROR;
+  }
+  *info = link_info;
+  return HAL_OK;
+}
+
+/* HAL callbacks -------------------------------------------------------------*/
+
+/**
+ * @brief UART TX complete: chain the next queued message
+ */
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart) {
+  if (huart == tx_uart) {
+    telemetry_txDone(0);
+  }
+}
+
+/**
+ * @brief UART error: drop the in-flight message if TX was aborted
+ */
+void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart) {
+  if (huart == tx_uart && huart->gState == HAL_UART_STATE_READY) {
+    telemetry_txDone(1);
+  }
+}
@@ -0,0 +1,1545 @@
+/**
+ ******************************************************************************
+ * @file    telemetry_frame.c
+ * @brief   Implementation of the binary telemetry packet encoder
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "telemetry_frame.h"
+#include "adc_sections.h"
+#include "cbor_writer.h"
+#include "crc_unit.h"
+#include "wavelet_codec.h"
+#include <math.h>
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define TELEMETRY_FRAME_HEADER_SIZE 12U  // sync, version, type, seq, time
+#define TELEMETRY_FRAME_STATUS_SIZE 37U  // header + 25 bytes of counters
+#define TELEMETRY_FRAME_SPECTRUM_SIZE                                          \
+  (30U + 8U * TELEMETRY_FRAME_MAX_BANDS) // header + 18 bytes + bands
+#define TELEMETRY_FRAME_STATS_SIZE                                             \
+  (TELEMETRY_FRAME_STATS_RAW - 2U) // header + count + ch + bias + moments
+#define TELEMETRY_FRAME_EVENT_SIZE 24U   // header + 12 bytes of event
+#define TELEMETRY_FRAME_TIMING_SIZE 42U  // header + 30 bytes of timing
+#define TELEMETRY_FRAME_SYNC_SIZE 41U    // header + 29 bytes of sync status
+#define TELEMETRY_FRAME_RATE_SIZE 23U    // header + 11 bytes of rate change
+#define TELEMETRY_FRAME_ENVELOPE_SIZE                                          \
+  (25U + 8U * TELEMETRY_FRAME_MAX_TONES) // header + 13 bytes + tones
+#define TELEMETRY_FRAME_HARMONICS_SIZE                                         \
+  (16U + 8U * TELEMETRY_FRAME_MAX_HARMONICS) // header + 4 bytes + bins
+#define TELEMETRY_FRAME_VECTOR_SIZE                                            \
+  (16U + 4U * TELEMETRY_FRAME_VECTOR_GROUPS +                                  \
+   2U * TELEMETRY_FRAME_VECTOR_GROUPS *                                        \
+       TELEMETRY_FRAME_MAX_FRAMES) // header + 4 bytes + tilt + magnitudes
+#define TELEMETRY_FRAME_DIAGNOSTICS_SIZE                                       \
+  (14U + 2U * TELEMETRY_FRAME_DIAG_ROWS * TELEMETRY_FRAME_DIAG_KINDS +         \
+   24U) // header + shape + matrix + 6 counters
+#define TELEMETRY_FRAME_EXTERNAL_SIZE                                          \
+  (16U + 2U * TELEMETRY_FRAME_EXT_SAMPLES) // header + 4 bytes + samples
+#define TELEMETRY_FRAME_ORDER_SIZE                                             \
+  (35U + 8U * TELEMETRY_FRAME_MAX_TONES) // header + 23 bytes + tones
+#define TELEMETRY_FRAME_VELOCITY_SIZE                                          \
+  (22U + 9U * ADC_CONVERSIONS_CHANNEL_COUNT) // header + 10 bytes + channels
+#define TELEMETRY_FRAME_COHERENCE_SIZE                                         \
+  (18U + 16U * TELEMETRY_FRAME_MAX_COHERENCE) // header + 6 bytes + freqs
+#define TELEMETRY_FRAME_EXCEPTION_SIZE                                         \
+  (17U + (1U + 4U * TELEMETRY_FRAME_FEATURES) *                                \
+             ADC_CONVERSIONS_CHANNEL_COUNT) // header + 5 bytes + channels
+#define TELEMETRY_FRAME_DISPLAY_SIZE                                           \
+  (19U + 3U * TELEMETRY_FRAME_DISPLAY_PAIRS) // header + 7 bytes + pairs
+#define TELEMETRY_FRAME_ANOMALY_SIZE                                           \
+  (22U + 12U * TELEMETRY_FRAME_ANOMALY_GROUPS) // header + 10 bytes + groups
+#define TELEMETRY_FRAME_BANDS_SIZE                                             \
+  (19U + 2U * TELEMETRY_FRAME_LOG_BANDS) // header + 7 bytes + bands
+#define TELEMETRY_FRAME_BASELINE_SIZE 30U // header + 18 bytes
+#define TELEMETRY_FRAME_RAINFLOW_SIZE                                          \
+  (42U + 2U * TELEMETRY_FRAME_RAINFLOW_CELLS) // header + 30 bytes + cells
+#define TELEMETRY_FRAME_SRS_SIZE                                               \
+  (27U + 2U * TELEMETRY_FRAME_SRS_FREQS) // header + 15 bytes + frequencies
+#define TELEMETRY_FRAME_ARRIVAL_SIZE                                           \
+  (33U + 6U * ADC_CONVERSIONS_CHANNEL_COUNT) // header + 21 bytes + channels
+#define TELEMETRY_FRAME_MODE_SIZE 45U // header + 33 bytes of mode switch
+#define TELEMETRY_FRAME_BURST_SIZE                                             \
+  (22U + (TELEMETRY_FRAME_BURST_SAMPLES * 3U) / 2U) // header + 10 + samples
+#define TELEMETRY_FRAME_LOG_SIZE                                               \
+  (22U + EVENT_LOG_ENTRY_SIZE * TELEMETRY_FRAME_LOG_ENTRIES) // header + 10
+#define TELEMETRY_FRAME_RELAY_SIZE                                             \
+  (16U + TELEMETRY_FRAME_RELAY_BYTES) // header + 4 bytes + node bytes
+#define TELEMETRY_FRAME_CEPSTRUM_SIZE                                          \
+  (14U + 8U * TELEMETRY_FRAME_CEPSTRUM_PEAKS) // header + 2 bytes + peaks
+#define TELEMETRY_FRAME_TSA_SIZE                                               \
+  (46U + 2U * TELEMETRY_FRAME_TSA_SAMPLES) // header + 34 bytes + angles
+#define TELEMETRY_FRAME_ROLLUP_SIZE                                            \
+  (18U + 12U * TELEMETRY_FRAME_FEATURES) // header + 6 bytes + features
+#define TELEMETRY_FRAME_DIGITAL_SIZE                                           \
+  (19U + 16U * TELEMETRY_FRAME_DIGITAL_EDGES) // header + 7 bytes + records
+#define TELEMETRY_FRAME_CRC_SIZE 2U
+#define TELEMETRY_FRAME_DELIMITER 0x00U
+
+#if TELEMETRY_FRAME_MAX_FRAMES < 1 || TELEMETRY_FRAME_MAX_FRAMES > 32
+#error "TELEMETRY_FRAME_MAX_FRAMES must be in 1..32"
+#endif
+
+#if TELEMETRY_FRAME_CODEC_FRAMES < 1 || TELEMETRY_FRAME_CODEC_FRAMES > 255 || \
+    TELEMETRY_FRAME_CODEC_FRAMES > SAMPLE_CODEC_MAX_SAMPLES
+#error "TELEMETRY_FRAME_CODEC_FRAMES must be in 1..255"
+#endif
+_Static_assert(WAVELET_CODEC_MAX_BYTES(TELEMETRY_FRAME_CODEC_FRAMES) ==
+                   SAMPLE_CODEC_MAX_BYTES(TELEMETRY_FRAME_CODEC_FRAMES),
+               "both codecs' runs are bounded the same");
+
+#if TELEMETRY_FRAME_HARMONICS_SIZE + TELEMETRY_FRAME_CRC_SIZE >                \
+    TELEMETRY_FRAME_RAW_MAX
+#error "a full harmonics packet must fit TELEMETRY_FRAME_ENCODED_MAX"
+#endif
+
+#if TELEMETRY_FRAME_VECTOR_SIZE + TELEMETRY_FRAME_CRC_SIZE >                   \
+    TELEMETRY_FRAME_RAW_MAX
+#error "a full vector packet must fit TELEMETRY_FRAME_ENCODED_MAX"
+#endif
+
+#if TELEMETRY_FRAME_DIAGNOSTICS_SIZE + TELEMETRY_FRAME_CRC_SIZE >              \
+    TELEMETRY_FRAME_RAW_MAX
+#error "a diagnostics packet must fit TELEMETRY_FRAME_ENCODED_MAX"
+#endif
+
+#if TELEMETRY_FRAME_EXTERNAL_SIZE + TELEMETRY_FRAME_CRC_SIZE >                 \
+    TELEMETRY_FRAME_RAW_MAX
+#error "a full external packet must fit TELEMETRY_FRAME_ENCODED_MAX"
+#endif
+
+#if TELEMETRY_FRAME_COHERENCE_SIZE + TELEMETRY_FRAME_CRC_SIZE >                \
+    TELEMETRY_FRAME_RAW_MAX
+#error "a full coherence packet must fit TELEMETRY_FRAME_ENCODED_MAX"
+#endif
+
+#if TELEMETRY_FRAME_EXCEPTION_SIZE + TELEMETRY_FRAME_CRC_SIZE >                \
+    TELEMETRY_FRAME_RAW_MAX
+#error "a full exception packet must fit TELEMETRY_FRAME_ENCODED_MAX"
+#endif
+
+#if TELEMETRY_FRAME_DISPLAY_SIZE + TELEMETRY_FRAME_CRC_SIZE >                  \
+    TELEMETRY_FRAME_RAW_MAX
+#error "a full display packet must fit TELEMETRY_FRAME_ENCODED_MAX"
+#endif
+
+#if TELEMETRY_FRAME_ANOMALY_SIZE + TELEMETRY_FRAME_CRC_SIZE >                  \
+    TELEMETRY_FRAME_RAW_MAX
+#error "a full anomaly packet must fit TELEMETRY_FRAME_ENCODED_MAX"
+#endif
+
+#if TELEMETRY_FRAME_BANDS_SIZE + TELEMETRY_FRAME_CRC_SIZE >                    \
+    TELEMETRY_FRAME_RAW_MAX
+#error "a full bands packet must fit TELEMETRY_FRAME_ENCODED_MAX"
+#endif
+
+#if TELEMETRY_FRAME_TSA_SIZE + TELEMETRY_FRAME_CRC_SIZE >                      \
+    TELEMETRY_FRAME_RAW_MAX
+#error "a full TSA packet must fit TELEMETRY_FRAME_ENCODED_MAX"
+#endif
+
+#if TELEMETRY_FRAME_ROLLUP_SIZE + TELEMETRY_FRAME_CRC_SIZE >                   \
+    TELEMETRY_FRAME_RAW_MAX
+#error "a rollup packet must fit TELEMETRY_FRAME_ENCODED_MAX"
+#endif
+
+#if TELEMETRY_FRAME_DIGITAL_SIZE + TELEMETRY_FRAME_CRC_SIZE >                  \
+    TELEMETRY_FRAME_RAW_MAX
+#error "a full digital packet must fit TELEMETRY_FRAME_ENCODED_MAX"
+#endif
+
+#if TELEMETRY_FRAME_CEPSTRUM_SIZE + TELEMETRY_FRAME_CRC_SIZE >                 \
+    TELEMETRY_FRAME_RAW_MAX
+#error "a full cepstrum packet must fit TELEMETRY_FRAME_ENCODED_MAX"
+#endif
+
+#if TELEMETRY_FRAME_RAINFLOW_SIZE + TELEMETRY_FRAME_CRC_SIZE >                 \
+    TELEMETRY_FRAME_RAW_MAX
+#error "a full rainflow packet must fit TELEMETRY_FRAME_ENCODED_MAX"
+#endif
+
+#if TELEMETRY_FRAME_SRS_SIZE + TELEMETRY_FRAME_CRC_SIZE >                      \
+    TELEMETRY_FRAME_RAW_MAX
+#error "a full SRS packet must fit TELEMETRY_FRAME_ENCODED_MAX"
+#endif
+
+#if TELEMETRY_FRAME_ARRIVAL_SIZE + TELEMETRY_FRAME_CRC_SIZE >                  \
+    TELEMETRY_FRAME_RAW_MAX
+#error "a full arrival packet must fit TELEMETRY_FRAME_ENCODED_MAX"
+#endif
+
+#if TELEMETRY_FRAME_BURST_SAMPLES < 2 ||                                       \
+    TELEMETRY_FRAME_BURST_SAMPLES > 254 ||                                     \
+    (TELEMETRY_FRAME_BURST_SAMPLES % 2) != 0
+#error "TELEMETRY_FRAME_BURST_SAMPLES must be even and in 2..254"
+#endif
+
+#if TELEMETRY_FRAME_BURST_SIZE + TELEMETRY_FRAME_CRC_SIZE >                    \
+    TELEMETRY_FRAME_RAW_MAX
+#error "a full burst packet must fit TELEMETRY_FRAME_ENCODED_MAX"
+#endif
+
+#if TELEMETRY_FRAME_LOG_ENTRIES < 1 || TELEMETRY_FRAME_LOG_ENTRIES > 255 ||    \
+    TELEMETRY_FRAME_LOG_SIZE + TELEMETRY_FRAME_CRC_SIZE >                      \
+        TELEMETRY_FRAME_RAW_MAX
+#error "a full log packet must fit TELEMETRY_FRAME_ENCODED_MAX"
+#endif
+
+#if TELEMETRY_FRAME_RELAY_SIZE + TELEMETRY_FRAME_CRC_SIZE >                   \
+    TELEMETRY_FRAME_RAW_MAX
+#error "a full relay packet must fit TELEMETRY_FRAME_ENCODED_MAX"
+#endif
+
+#if TELEMETRY_FRAME_FEATURES > 8
+#error "TELEMETRY_FRAME_FEATURES must fit the 8-bit feature mask"
+#endif
+
+_Static_assert(TELEMETRY_FRAME_FEATURE_DC_BIAS + 1 == TELEMETRY_FRAME_FEATURES,
+               "one feature-mask bit per TelemetryFrame_Feature_t");
+
+/* Private functions ---------------------------------------------------------*/
+
+static uint8_t *telemetryFrame_put16(uint8_t *p, uint16_t v) {
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+  return p + 2;
+}
+
+static uint8_t *telemetryFrame_put32(uint8_t *p, uint32_t v) {
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+  p[2] = (uint8_t)(v >> 16);
+  p[3] = (uint8_t)(v >> 24);
+  return p + 4;
+}
+
+static uint8_t *telemetryFrame_putFloat(uint8_t *p, float v) {
+  uint32_t bits;
+  memcpy(&bits, &v, sizeof(bits));
+  return telemetryFrame_put32(p, bits);
+}
+
+static uint8_t *telemetryFrame_putHeader(uint8_t *p, TelemetryFrame_Type_t type,
+                                         uint32_t sequence,
+                                         uint32_t timestamp) {
+  p = telemetryFrame_put16(p, TELEMETRY_FRAME_SYNC);
+  *p++ = TELEMETRY_FRAME_VERSION;
+  *p++ = (uint8_t)type;
+  p = telemetryFrame_put32(p, sequence);
+  return telemetryFrame_put32(p, timestamp);
+}
+
+/**
+ * @brief Append the CRC, COBS-encode and wrap in 0x00 delimiters
+ */
+ADC_HOT_CODE static HAL_StatusTypeDef
+telemetryFrame_finish(uint8_t *raw, uint16_t raw_len, uint8_t *out,
+                      uint16_t cap, uint16_t *out_len) {
+  telemetryFrame_put16(&raw[raw_len], telemetryFrame_crc16(raw, raw_len));
+  raw_len += TELEMETRY_FRAME_CRC_SIZE;
+
+  // Leading delimiter, N data bytes, one code byte per 254-byte run, trailer
+  uint32_t worst = 1U + raw_len + (raw_len / 254U) + 1U + 1U;
+  if (worst > cap) {
+    return HAL_ERROR;
+  }
+
+  uint16_t o = 0;
+  out[o++] = TELEMETRY_FRAME_DELIMITER;
+
+  uint16_t code_pos = o++;
+  uint8_t code = 1;
+  for (uint16_t i = 0; i < raw_len; i++) {
+    if (raw[i] == 0U) {
+      out[code_pos] = code;
+      code_pos = o++;
+      code = 1;
+      continue;
+    }
+    out[o++] = raw[i];
+    if (++code == 0xFFU) {
+      out[code_pos] = code;
+      code_pos = o++;
+      code = 1;
+    }
+  }
+  out[code_pos] = code;
+  out[o++] = TELEMETRY_FRAME_DELIMITER;
+
+  *out_len = o;
+  return HAL_OK;
+}
+
+/**
+ * @brief Packet header, then the CBOR map head and its message, sequence
+ *        and time entries
+ */
+static void telemetryFrame_cborStart(CborWriter_t *w, uint8_t *raw,
+                                     TelemetryFrame_Type_t msg,
+                                     uint32_t sequence, uint32_t timestamp,
+                                     uint8_t pairs) {
+  uint8_t *p = telemetryFrame_putHeader(raw, TELEMETRY_FRAME_TYPE_CBOR,
+                                        sequence, timestamp);
+  cborWriter_init(w, p,
+                  (uint16_t)(TELEMETRY_FRAME_RAW_MAX -
+                             TELEMETRY_FRAME_HEADER_SIZE -
+                             TELEMETRY_FRAME_CRC_SIZE));
+  cborWriter_map(w, pairs);
+  cborWriter_uint(w, TELEMETRY_FRAME_CBOR_MSG);
+  cborWriter_uint(w, (uint32_t)msg);
+  cborWriter_uint(w, TELEMETRY_FRAME_CBOR_SEQ);
+  cborWriter_uint(w, sequence);
+  cborWriter_uint(w, TELEMETRY_FRAME_CBOR_TIME);
+  cborWriter_uint(w, timestamp);
+}
+
+/**
+ * @brief Key and an array of n floats
+ */
+static void telemetryFrame_cborFloats(CborWriter_t *w,
+                                      TelemetryFrame_CborKey_t key,
+                                      const float *values, uint8_t n,
+                                      float rel_tol) {
+  cborWriter_uint(w, (uint32_t)key);
+  cborWriter_array(w, n);
+  for (uint8_t i = 0; i < n; i++) {
+    cborWriter_float(w, values[i], rel_tol);
+  }
+}
+
+/**
+ * @brief Frame the finished map like any other packet
+ */
+static HAL_StatusTypeDef telemetryFrame_cborFinish(const CborWriter_t *w,
+                                                   uint8_t *raw, uint8_t *out,
+                                                   uint16_t cap,
+                                                   uint16_t *out_len) {
+  uint16_t len;
+  if (cborWriter_finish(w, &len) != HAL_OK) {
+    return HAL_ERROR;
+  }
+  return telemetryFrame_finish(
+      raw, (uint16_t)(TELEMETRY_FRAME_HEADER_SIZE + len), out, cap, out_len);
+}
+
+/* Public functions ----------------------------------------------------------*/
+
+HAL_StatusTypeDef telemetryFrame_initBatch(TelemetryFrame_Batch_t *batch,
+                                           ADC_ChannelMask_t channel_mask) {
+  if (batch == NULL || channel_mask == 0U ||
+      (channel_mask & (ADC_ChannelMask_t)~TELEMETRY_FRAME_ALL_CHANNELS) != 0U) {
+    return HAL_ERROR;
+  }
+  batch->channel_mask = channel_mask;
+  batch->frame_count = 0;
+  batch->error_mask = 0;
+  batch->error_bitmap = 0;
+  batch->first_sequence = 0;
+  batch->first_timestamp = 0;
+  batch->sample_count = 0;
+  batch->flags = 0;
+  return HAL_OK;
+}
+
+ADC_HOT_CODE HAL_StatusTypeDef
+telemetryFrame_addFrame(TelemetryFrame_Batch_t *batch,
+                        const ADC_RingEntry_t *entry) {
+  if (batch == NULL || entry == NULL) {
+    return HAL_ERROR;
+  }
+  if (batch->frame_count >= TELEMETRY_FRAME_MAX_FRAMES) {
+    return HAL_BUSY;
+  }
+
+  if (batch->frame_count == 0U) {
+    batch->first_sequence = entry->sequence;
+    batch->first_timestamp = entry->timestamp;
+  }
+
+  for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+    if (batch->channel_mask & (1UL << ch)) {
+      batch->samples[batch->sample_count++] = entry->frame.samples[ch];
+    }
+  }
+
+  ADC_ChannelMask_t errors = entry->frame.error_mask & batch->channel_mask;
+  if (errors != 0U) {
+    batch->error_mask |= errors;
+    batch->error_bitmap |= 1UL << batch->frame_count;
+  }
+  if (entry->flags & ADC_RING_FLAG_CLIPPED) {
+    batch->flags |= TELEMETRY_FRAME_FLAG_CLIPPED;
+  }
+  batch->frame_count++;
+  return HAL_OK;
+}
+
+uint8_t telemetryFrame_isFull(const TelemetryFrame_Batch_t *batch) {
+  return (batch != NULL && batch->frame_count >= TELEMETRY_FRAME_MAX_FRAMES)
+             ? 1U
+             : 0U;
+}
+
+ADC_HOT_CODE HAL_StatusTypeDef telemetryFrame_encodeSamples(
+    const TelemetryFrame_Batch_t *batch, uint8_t *out, uint16_t cap,
+    uint16_t *out_len) {
+  if (batch == NULL || out == NULL || out_len == NULL ||
+      batch->frame_count == 0U) {
+    return HAL_ERROR;
+  }
+
+  uint8_t raw[TELEMETRY_FRAME_RAW_MAX];
+  uint8_t *p = telemetryFrame_putHeader(raw, TELEMETRY_FRAME_TYPE_SAMPLES,
+                                        batch->first_sequence,
+                                        batch->first_timestamp);
+#if TELEMETRY_FRAME_VERSION == 1U
+  *p++ = (uint8_t)(batch->channel_mask |
+                   (batch->flags & TELEMETRY_FRAME_FLAGS_MASK));
+  *p++ = batch->frame_count;
+  *p++ = (uint8_t)batch->error_mask;
+#else
+  *p++ = (uint8_t)(batch->flags & TELEMETRY_FRAME_FLAGS_MASK);
+  *p++ = batch->frame_count;
+  p = telemetryFrame_put32(p, batch->channel_mask);
+  p = telemetryFrame_put32(p, batch->error_mask);
+#endif
+  p = telemetryFrame_put32(p, batch->error_bitmap);
+
+  // Two 12-bit samples per three bytes, low nibble first
+  uint16_t i = 0;
+  for (; i + 1U < batch->sample_count; i += 2U) {
+    uint16_t a = batch->samples[i] & 0x0FFFU;
+    uint16_t b = batch->samples[i + 1U] & 0x0FFFU;
+    *p++ = (uint8_t)a;
+    *p++ = (uint8_t)((a >> 8) | (b << 4));
+    *p++ = (uint8_t)(b >> 4);
+  }
+  if (i < batch->sample_count) {
+    uint16_t a = batch->samples[i] & 0x0FFFU;
+    *p++ = (uint8_t)a;
+    *p++ = (uint8_t)(a >> 8);
+  }
+
+  return telemetryFrame_finish(raw, (uint16_t)(p - raw), out, cap, out_len);
+}
+
+HAL_StatusTypeDef telemetryFrame_encodeStatus(
+    const TelemetryFrame_Status_t *status, uint8_t *out, uint16_t cap,
+    uint16_t *out_len) {
+  if (status == NULL || out == NULL || out_len == NULL) {
+    return HAL_ERROR;
+  }
+
+  uint8_t raw[TELEMETRY_FRAME_STATUS_SIZE + TELEMETRY_FRAME_CRC_SIZE];
+  uint8_t *p = telemetryFrame_putHeader(raw, TELEMETRY_FRAME_TYPE_STATUS,
+                                        status->sequence, status->timestamp);
+  p = telemetryFrame_put32(p, status->total_errors);
+  *p++ = status->last_failed_channel;
+  p = telemetryFrame_put32(p, status->ring_high_water);
+  p = telemetryFrame_put32(p, status->ring_overflows);
+  p = telemetryFrame_put32(p, status->telemetry_dropped);
+  p = telemetryFrame_put16(p, status->cpu_load);
+  p = telemetryFrame_put16(p, status->cpu_peak);
+  p = telemetryFrame_put16(p, status->vdda_mv);
+  p = telemetryFrame_put16(p, (uint16_t)status->temperature);
+
+  return telemetryFrame_finish(raw, (uint16_t)(p - raw), out, cap, out_len);
+}
+
+HAL_StatusTypeDef telemetryFrame_encodeSpectrum(
+    const TelemetryFrame_Spectrum_t *spectrum, uint8_t *out, uint16_t cap,
+    uint16_t *out_len) {
+  if (spectrum == NULL || out == NULL || out_len == NULL ||
+      spectrum->band_count > TELEMETRY_FRAME_MAX_BANDS) {
+    return HAL_ERROR;
+  }
+
+  uint8_t raw[TELEMETRY_FRAME_SPECTRUM_SIZE + TELEMETRY_FRAME_CRC_SIZE];
+  uint8_t *p = telemetryFrame_putHeader(raw, TELEMETRY_FRAME_TYPE_SPECTRUM,
+                                        spectrum->sequence,
+                                        spectrum->timestamp);
+  *p++ = spectrum->channel;
+  *p++ = spectrum->window;
+  p = telemetryFrame_put16(p, spectrum->length);
+  *p++ = spectrum->averages;
+  p = telemetryFrame_putFloat(p, spectrum->peak_hz);
+  p = telemetryFrame_putFloat(p, spectrum->peak_amplitude);
+  p = telemetryFrame_putFloat(p, spectrum->rms);
+  *p++ = spectrum->band_count;
+  for (uint8_t i = 0; i < spectrum->band_count; i++) {
+    p = telemetryFrame_putFloat(p, spectrum->band_rms[i]);
+  }
+  // Appended, so decoders that stop after band_rms still work
+  for (uint8_t i = 0; i < spectrum->band_count; i++) {
+    p = telemetryFrame_putFloat(p, spectrum->band_kurtosis[i]);
+  }
+
+  return telemetryFrame_finish(raw, (uint16_t)(p - raw), out, cap, out_len);
+}
+
+HAL_StatusTypeDef telemetryFrame_encodeStats(const TelemetryFrame_Stats_t *stats,
+                                             uint8_t *out, uint16_t cap,
+                                             uint16_t *out_len) {
+  if (stats == NULL || out == NULL || out_len == NULL) {
+    return HAL_ERROR;
+  }
+
+  uint8_t raw[TELEMETRY_FRAME_STATS_SIZE + TELEMETRY_FRAME_CRC_SIZE];
+  uint8_t *p = telemetryFrame_putHeader(raw, TELEMETRY_FRAME_TYPE_STATS,
+                                        stats->sequence, stats->timestamp);
+  *p++ = ADC_CONVERSIONS_CHANNEL_COUNT;
+  p = telemetryFrame_put32(p, stats->channels[0].count);
+
+  // Variance and peak-to-peak follow from rms and min/max on the host
+  for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+    const ADC_ChannelStats_t *c = &stats->channels[ch];
+    p = telemetryFrame_put16(p, c->min);
+    p = telemetryFrame_put16(p, c->max);
+    p = telemetryFrame_putFloat(p, c->mean);
+    p = telemetryFrame_putFloat(p, c->rms);
+    p = telemetryFrame_putFloat(p, c->crest_factor);
+  }
+  // Appended, so decoders that stop after the records still work
+  for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+    p = telemetryFrame_putFloat(p, stats->dc_bias[ch]);
+  }
+  for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+    p = telemetryFrame_putFloat(p, stats->channels[ch].skewness);
+    p = telemetryFrame_putFloat(p, stats->channels[ch].kurtosis);
+  }
+
+  return telemetryFrame_finish(raw, (uint16_t)(p - raw), out, cap, out_len);
+}
+
+HAL_StatusTypeDef telemetryFrame_encodeEvent(const TelemetryFrame_Event_t *event,
+                                             uint8_t *out, uint16_t cap,
+                                             uint16_t *out_len) {
+  if (event == NULL || out == NULL || out_len == NULL) {
+    return HAL_ERROR;
+  }
+
+  uint8_t raw[TELEMETRY_FRAME_EVENT_SIZE + TELEMETRY_FRAME_CRC_SIZE];
+  uint8_t *p = telemetryFrame_putHeader(raw, TELEMETRY_FRAME_TYPE_EVENT,
+                                        event->trigger_frame, event->timestamp);
+  *p++ = event->channel;
+  *p++ = event->condition;
+  p = telemetryFrame_put16(p, event->value);
+  p = telemetryFrame_put16(p, event->pre_frames);
+  p = telemetryFrame_put16(p, event->frame_count);
+  p = telemetryFrame_put32(p, event->first_frame);
+
+  return telemetryFrame_finish(raw, (uint16_t)(p - raw), out, cap, out_len);
+}
+
+HAL_StatusTypeDef telemetryFrame_encodeTiming(
+    const TelemetryFrame_Timing_t *timing, uint8_t *out, uint16_t cap,
+    uint16_t *out_len) {
+  if (timing == NULL || out == NULL || out_len == NULL) {
+    return HAL_ERROR;
+  }
+
+  uint8_t raw[TELEMETRY_FRAME_TIMING_SIZE + TELEMETRY_FRAME_CRC_SIZE];
+  uint8_t *p = telemetryFrame_putHeader(raw, TELEMETRY_FRAME_TYPE_TIMING,
+                                        timing->first_frame, timing->timestamp);
+  p = telemetryFrame_put32(p, (uint32_t)timing->block_time);
+  p = telemetryFrame_put32(p, (uint32_t)(timing->block_time >> 32));
+  p = telemetryFrame_put16(p, timing->frame_count);
+  p = telemetryFrame_put32(p, timing->tick_hz);
+  p = telemetryFrame_put32(p, timing->nominal_mhz);
+  p = telemetryFrame_put32(p, timing->measured_mhz);
+  p = telemetryFrame_putFloat(p, timing->drift_ppm);
+  p = telemetryFrame_put32(p, timing->jitter_ticks);
+
+  return telemetryFrame_finish(raw, (uint16_t)(p - raw), out, cap, out_len);
+}
+
+HAL_StatusTypeDef telemetryFrame_encodeSync(const TelemetryFrame_Sync_t *sync,
+                                            uint8_t *out, uint16_t cap,
+                                            uint16_t *out_len) {
+  if (sync == NULL || out == NULL || out_len == NULL) {
+    return HAL_ERROR;
+  }
+
+  uint8_t raw[TELEMETRY_FRAME_SYNC_SIZE + TELEMETRY_FRAME_CRC_SIZE];
+  uint8_t *p = telemetryFrame_putHeader(raw, TELEMETRY_FRAME_TYPE_SYNC,
+                                        sync->pulse_frame, sync->timestamp);
+  *p++ = sync->state;
+  p = telemetryFrame_put32(p, sync->pulses);
+  p = telemetryFrame_put32(p, sync->rejected);
+  p = telemetryFrame_put32(p, sync->missed_updates);
+  p = telemetryFrame_put32(p, (uint32_t)sync->phase_ns);
+  p = telemetryFrame_putFloat(p, sync->clock_ppm);
+  p = telemetryFrame_put32(p, (uint32_t)sync->pulse_time);
+  p = telemetryFrame_put32(p, (uint32_t)(sync->pulse_time >> 32));
+
+  return telemetryFrame_finish(raw, (uint16_t)(p - raw), out, cap, out_len);
+}
+
+HAL_StatusTypeDef telemetryFrame_encodeCompressed(
+    const TelemetryFrame_Compressed_t *run, uint8_t *out, uint16_t cap,
+    uint16_t *out_len) {
+  if (run == NULL || run->data == NULL || out == NULL || out_len == NULL ||
+      run->frame_count == 0U ||
+      run->frame_count > TELEMETRY_FRAME_CODEC_FRAMES ||
+      run->length == 0U ||
+      run->length > SAMPLE_CODEC_MAX_BYTES(run->frame_count) ||
+      run->max_error > WAVELET_CODEC_MAX_ERROR) {
+    return HAL_ERROR;
+  }
+
+  uint8_t raw[TELEMETRY_FRAME_CODEC_RAW_MAX];
+  uint8_t *p = telemetryFrame_putHeader(
+      raw,
+      (run->max_error != 0U) ? TELEMETRY_FRAME_TYPE_WAVELET
+                             : TELEMETRY_FRAME_TYPE_COMPRESSED,
+      run->first_frame, run->timestamp);
+  *p++ = run->channel;
+  *p++ = run->frame_count;
+  *p++ = run->error_count;
+  if (run->max_error != 0U) {
+    p = telemetryFrame_put16(p, run->max_error);
+  }
+  memcpy(p, run->data, run->length);
+  p += run->length;
+
+  return telemetryFrame_finish(raw, (uint16_t)(p - raw), out, cap, out_len);
+}
+
+HAL_StatusTypeDef telemetryFrame_encodeRate(const TelemetryFrame_Rate_t *rate,
+                                            uint8_t *out, uint16_t cap,
+                                            uint16_t *out_len) {
+  if (rate == NULL || out == NULL || out_len == NULL) {
+    return HAL_ERROR;
+  }
+
+  uint8_t raw[TELEMETRY_FRAME_RATE_SIZE + TELEMETRY_FRAME_CRC_SIZE];
+  uint8_t *p = telemetryFrame_putHeader(raw, TELEMETRY_FRAME_TYPE_RATE,
+                                        rate->first_frame, rate->timestamp);
+  p = telemetryFrame_put32(p, rate->frame_rate_hz);
+  p = telemetryFrame_put16(p, rate->decimation);
+  *p++ = rate->level;
+  p = telemetryFrame_putFloat(p, rate->activity);
+
+  return telemetryFrame_finish(raw, (uint16_t)(p - raw), out, cap, out_len);
+}
+
+HAL_StatusTypeDef telemetryFrame_encodeEnvelope(
+    const TelemetryFrame_Envelope_t *envelope, uint8_t *out, uint16_t cap,
+    uint16_t *out_len) {
+  if (envelope == NULL || out == NULL || out_len == NULL ||
+      envelope->tone_count > TELEMETRY_FRAME_MAX_TONES) {
+    return HAL_ERROR;
+  }
+
+  uint8_t raw[TELEMETRY_FRAME_ENVELOPE_SIZE + TELEMETRY_FRAME_CRC_SIZE];
+  uint8_t *p = telemetryFrame_putHeader(raw, TELEMETRY_FRAME_TYPE_ENVELOPE,
+                                        envelope->sequence,
+                                        envelope->timestamp);
+  *p++ = envelope->channel;
+  p = telemetryFrame_put16(p, envelope->length);
+  *p++ = envelope->averages;
+  p = telemetryFrame_putFloat(p, envelope->sample_rate_hz);
+  p = telemetryFrame_putFloat(p, envelope->rms);
+  *p++ = envelope->tone_count;
+  for (uint8_t i = 0; i < envelope->tone_count; i++) {
+    p = telemetryFrame_putFloat(p, envelope->tone_hz[i]);
+    p = telemetryFrame_putFloat(p, envelope->tone_amplitude[i]);
+  }
+
+  return telemetryFrame_finish(raw, (uint16_t)(p - raw), out, cap, out_len);
+}
+
+HAL_StatusTypeDef telemetryFrame_encodeHarmonics(
+    const TelemetryFrame_Harmonics_t *harmonics, uint8_t *out, uint16_t cap,
+    uint16_t *out_len) {
+  if (harmonics == NULL || out == NULL || out_len == NULL ||
+      harmonics->bin_count > TELEMETRY_FRAME_MAX_HARMONICS) {
+    return HAL_ERROR;
+  }
+
+  uint8_t raw[TELEMETRY_FRAME_HARMONICS_SIZE + TELEMETRY_FRAME_CRC_SIZE];
+  uint8_t *p = telemetryFrame_putHeader(raw, TELEMETRY_FRAME_TYPE_HARMONICS,
+                                        harmonics->sequence,
+                                        harmonics->timestamp);
+  *p++ = harmonics->channel;
+  p = telemetryFrame_put16(p, harmonics->length);
+  *p++ = harmonics->bin_count;
+  for (uint8_t i = 0; i < harmonics->bin_count; i++) {
+    p = telemetryFrame_putFloat(p, harmonics->hz[i]);
+    p = telemetryFrame_putFloat(p, harmonics->amplitude[i]);
+  }
+
+  return telemetryFrame_finish(raw, (uint16_t)(p - raw), out, cap, out_len);
+}
+
+HAL_StatusTypeDef telemetryFrame_encodeVector(
+    const TelemetryFrame_Vector_t *vector, uint8_t *out, uint16_t cap,
+    uint16_t *out_len) {
+  if (vector == NULL || out == NULL || out_len == NULL ||
+      vector->frame_count == 0U ||
+      vector->frame_count > TELEMETRY_FRAME_MAX_FRAMES) {
+    return HAL_ERROR;
+  }
+
+  uint8_t raw[TELEMETRY_FRAME_VECTOR_SIZE + TELEMETRY_FRAME_CRC_SIZE];
+  uint8_t *p = telemetryFrame_putHeader(raw, TELEMETRY_FRAME_TYPE_VECTOR,
+                                        vector->first_frame,
+                                        vector->timestamp);
+  p = telemetryFrame_put16(p, vector->stride);
+  *p++ = TELEMETRY_FRAME_VECTOR_GROUPS;
+  *p++ = vector->frame_count;
+  for (uint8_t g = 0; g < TELEMETRY_FRAME_VECTOR_GROUPS; g++) {
+    p = telemetryFrame_put16(p, (uint16_t)vector->pitch_cdeg[g]);
+    p = telemetryFrame_put16(p, (uint16_t)vector->roll_cdeg[g]);
+  }
+  for (uint8_t f = 0; f < vector->frame_count; f++) {
+    for (uint8_t g = 0; g < TELEMETRY_FRAME_VECTOR_GROUPS; g++) {
+      p = telemetryFrame_put16(p, vector->magnitude_mg[f][g]);
+    }
+  }
+
+  return telemetryFrame_finish(raw, (uint16_t)(p - raw), out, cap, out_len);
+}
+
+HAL_StatusTypeDef telemetryFrame_encodeDiagnostics(
+    const TelemetryFrame_Diagnostics_t *diag, uint8_t *out, uint16_t cap,
+    uint16_t *out_len) {
+  if (diag == NULL || out == NULL || out_len == NULL) {
+    return HAL_ERROR;
+  }
+
+  uint8_t raw[TELEMETRY_FRAME_DIAGNOSTICS_SIZE + TELEMETRY_FRAME_CRC_SIZE];
+  uint8_t *p = telemetryFrame_putHeader(raw, TELEMETRY_FRAME_TYPE_DIAGNOSTICS,
+                                        diag->sequence, diag->timestamp);
+  *p++ = TELEMETRY_FRAME_DIAG_ROWS;
+  *p++ = TELEMETRY_FRAME_DIAG_KINDS;
+  // Wrapping 16-bit counters: the host takes rates from differences
+  for (uint8_t r = 0; r < TELEMETRY_FRAME_DIAG_ROWS; r++) {
+    for (uint8_t k = 0; k < TELEMETRY_FRAME_DIAG_KINDS; k++) {
+      p = telemetryFrame_put16(p, (uint16_t)diag->counts[r][k]);
+    }
+  }
+  p = telemetryFrame_put32(p, diag->total_errors);
+  p = telemetryFrame_put32(p, diag->ring_overflows);
+  p = telemetryFrame_put32(p, diag->telemetry_dropped);
+  p = telemetryFrame_put32(p, diag->blocks_dropped);
+  p = telemetryFrame_put32(p, diag->trigger_missed);
+  p = telemetryFrame_put32(p, diag->trigger_blind_frames);
+
+  return telemetryFrame_finish(raw, (uint16_t)(p - raw), out, cap, out_len);
+}
+
+HAL_StatusTypeDef telemetryFrame_encodeExternal(
+    const TelemetryFrame_External_t *ext, uint8_t *out, uint16_t cap,
+    uint16_t *out_len) {
+  if (ext == NULL || out == NULL || out_len == NULL ||
+      ext->channel_count == 0U ||
+      ext->channel_count > TELEMETRY_FRAME_EXT_CHANNELS ||
+      ext->frame_count == 0U ||
+      (uint32_t)ext->frame_count * ext->channel_count >
+          TELEMETRY_FRAME_EXT_SAMPLES) {
+    return HAL_ERROR;
+  }
+
+  uint8_t raw[TELEMETRY_FRAME_EXTERNAL_SIZE + TELEMETRY_FRAME_CRC_SIZE];
+  uint8_t *p = telemetryFrame_putHeader(raw, TELEMETRY_FRAME_TYPE_EXTERNAL,
+                                        ext->first_frame, ext->timestamp);
+  p = telemetryFrame_put16(p, ext->stride);
+  *p++ = ext->channel_count;
+  *p++ = ext->frame_count;
+  const uint32_t n = (uint32_t)ext->frame_count * ext->channel_count;
+  for (uint32_t i = 0; i < n; i++) {
+    p = telemetryFrame_put16(p, ext->samples[i]);
+  }
+
+  return telemetryFrame_finish(raw, (uint16_t)(p - raw), out, cap, out_len);
+}
+
+HAL_StatusTypeDef telemetryFrame_encodeOrder(
+    const TelemetryFrame_Order_t *order, uint8_t *out, uint16_t cap,
+    uint16_t *out_len) {
+  if (order == NULL || out == NULL || out_len == NULL ||
+      order->tone_count > TELEMETRY_FRAME_MAX_TONES) {
+    return HAL_ERROR;
+  }
+
+  uint8_t raw[TELEMETRY_FRAME_ORDER_SIZE + TELEMETRY_FRAME_CRC_SIZE];
+  uint8_t *p = telemetryFrame_putHeader(raw, TELEMETRY_FRAME_TYPE_ORDER,
+                                        order->sequence, order->timestamp);
+  *p++ = order->channel;
+  p = telemetryFrame_put16(p, order->length);
+  *p++ = order->averages;
+  p = telemetryFrame_put16(p, order->samples_per_rev);
+  p = telemetryFrame_putFloat(p, order->rpm);
+  p = telemetryFrame_putFloat(p, order->peak_order);
+  p = telemetryFrame_putFloat(p, order->peak_amplitude);
+  p = telemetryFrame_putFloat(p, order->rms);
+  *p++ = order->tone_count;
+  for (uint8_t i = 0; i < order->tone_count; i++) {
+    p = telemetryFrame_putFloat(p, order->tone_order[i]);
+    p = telemetryFrame_putFloat(p, order->tone_amplitude[i]);
+  }
+
+  return telemetryFrame_finish(raw, (uint16_t)(p - raw), out, cap, out_len);
+}
+
+HAL_StatusTypeDef telemetryFrame_encodeVelocity(
+    const TelemetryFrame_Velocity_t *vel, uint8_t *out, uint16_t cap,
+    uint16_t *out_len) {
+  if (vel == NULL || out == NULL || out_len == NULL) {
+    return HAL_ERROR;
+  }
+
+  uint8_t raw[TELEMETRY_FRAME_VELOCITY_SIZE + TELEMETRY_FRAME_CRC_SIZE];
+  uint8_t *p = telemetryFrame_putHeader(raw, TELEMETRY_FRAME_TYPE_VELOCITY,
+                                        vel->sequence, vel->timestamp);
+  p = telemetryFrame_put16(p, vel->interval_ms);
+  p = telemetryFrame_put16(p, vel->low_hz);
+  p = telemetryFrame_put16(p, vel->high_hz);
+  p = telemetryFrame_put32(p, (uint32_t)vel->channel_mask);
+  for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+    if (!((vel->channel_mask >> ch) & 1U)) {
+      continue;
+    }
+    p = telemetryFrame_putFloat(p, vel->rms_mm_s[ch]);
+    p = telemetryFrame_putFloat(p, vel->peak_mm_s[ch]);
+    *p++ = vel->zone[ch];
+  }
+
+  return telemetryFrame_finish(raw, (uint16_t)(p - raw), out, cap, out_len);
+}
+
+HAL_StatusTypeDef telemetryFrame_encodeAnomaly(
+    const TelemetryFrame_Anomaly_t *anomaly, uint8_t *out, uint16_t cap,
+    uint16_t *out_len) {
+  if (anomaly == NULL || out == NULL || out_len == NULL ||
+      anomaly->group_count > TELEMETRY_FRAME_ANOMALY_GROUPS) {
+    return HAL_ERROR;
+  }
+
+  uint8_t raw[TELEMETRY_FRAME_ANOMALY_SIZE + TELEMETRY_FRAME_CRC_SIZE];
+  uint8_t *p = telemetryFrame_putHeader(raw, TELEMETRY_FRAME_TYPE_ANOMALY,
+                                        anomaly->sequence, anomaly->timestamp);
+  p = telemetryFrame_put16(p, anomaly->windows);
+  p = telemetryFrame_put16(p, anomaly->learning);
+  *p++ = anomaly->group_count;
+  *p++ = anomaly->alarm_mask;
+  p = telemetryFrame_put32(p, anomaly->cycles_max);
+  for (uint8_t g = 0; g < anomaly->group_count; g++) {
+    p = telemetryFrame_put32(p, (uint32_t)anomaly->channel_mask[g]);
+    p = telemetryFrame_putFloat(p, anomaly->score_mean[g]);
+    p = telemetryFrame_putFloat(p, anomaly->score_peak[g]);
+  }
+
+  return telemetryFrame_finish(raw, (uint16_t)(p - raw), out, cap, out_len);
+}
+
+HAL_StatusTypeDef telemetryFrame_encodeBands(
+    const TelemetryFrame_Bands_t *bands, uint8_t *out, uint16_t cap,
+    uint16_t *out_len) {
+  if (bands == NULL || out == NULL || out_len == NULL ||
+      bands->band_count > TELEMETRY_FRAME_LOG_BANDS) {
+    return HAL_ERROR;
+  }
+
+  uint8_t raw[TELEMETRY_FRAME_BANDS_SIZE + TELEMETRY_FRAME_CRC_SIZE];
+  uint8_t *p = telemetryFrame_putHeader(raw, TELEMETRY_FRAME_TYPE_BANDS,
+                                        bands->sequence, bands->timestamp);
+  *p++ = bands->channel;
+  *p++ = bands->fraction;
+  *p++ = bands->band_count;
+  p = telemetryFrame_putFloat(p, bands->first_centre_hz);
+  for (uint8_t b = 0; b < bands->band_count; b++) {
+    int16_t level = TELEMETRY_FRAME_LEVEL_NONE;
+    if (bands->level_rms[b] > 0.0f) {
+      // 0.01 dB re 1 code, clamped to +-327 dB
+      float cdb = 2000.0f * log10f(bands->level_rms[b]);
+      if (cdb > 32767.0f) {
+        cdb = 32767.0f;
+      } else if (cdb < -32767.0f) {
+        cdb = -32767.0f;
+      }
+      level = (int16_t)lrintf(cdb);
+    }
+    p = telemetryFrame_put16(p, (uint16_t)level);
+  }
+
+  return telemetryFrame_finish(raw, (uint16_t)(p - raw), out, cap, out_len);
+}
+
+HAL_StatusTypeDef telemetryFrame_encodeBaseline(
+    const TelemetryFrame_Baseline_t *baseline, uint8_t *out, uint16_t cap,
+    uint16_t *out_len) {
+  if (baseline == NULL || out == NULL || out_len == NULL) {
+    return HAL_ERROR;
+  }
+
+  uint8_t raw[TELEMETRY_FRAME_BASELINE_SIZE + TELEMETRY_FRAME_CRC_SIZE];
+  uint8_t *p = telemetryFrame_putHeader(raw, TELEMETRY_FRAME_TYPE_BASELINE,
+                                        baseline->sequence,
+                                        baseline->timestamp);
+  *p++ = baseline->channel;
+  *p++ = baseline->event;
+  *p++ = baseline->alarm;
+  *p++ = baseline->worst_band;
+  p = telemetryFrame_put16(p, baseline->windows);
+  p = telemetryFrame_putFloat(p, baseline->score);
+  p = telemetryFrame_putFloat(p, baseline->worst_centre_hz);
+  p = telemetryFrame_putFloat(p, baseline->worst_db);
+
+  return telemetryFrame_finish(raw, (uint16_t)(p - raw), out, cap, out_len);
+}
+
+HAL_StatusTypeDef telemetryFrame_encodeRainflow(
+    const TelemetryFrame_Rainflow_t *rainflow, uint8_t *out, uint16_t cap,
+    uint16_t *out_len) {
+  if (rainflow == NULL || out == NULL || out_len == NULL ||
+      (uint32_t)rainflow->row_count * rainflow->mean_bins >
+          TELEMETRY_FRAME_RAINFLOW_CELLS) {
+    return HAL_ERROR;
+  }
+
+  uint8_t raw[TELEMETRY_FRAME_RAINFLOW_SIZE + TELEMETRY_FRAME_CRC_SIZE];
+  uint8_t *p = telemetryFrame_putHeader(raw, TELEMETRY_FRAME_TYPE_RAINFLOW,
+                                        rainflow->sequence,
+                                        rainflow->timestamp);
+  *p++ = rainflow->channel;
+  *p++ = rainflow->range_bins;
+  *p++ = rainflow->mean_bins;
+  *p++ = rainflow->first_row;
+  *p++ = rainflow->row_count;
+  *p++ = rainflow->residual;
+  p = telemetryFrame_putFloat(p, rainflow->range_bin_codes);
+  p = telemetryFrame_putFloat(p, rainflow->mean_low_codes);
+  p = telemetryFrame_putFloat(p, rainflow->mean_bin_codes);
+  p = telemetryFrame_putFloat(p, rainflow->cycles);
+  p = telemetryFrame_putFloat(p, rainflow->damage);
+  p = telemetryFrame_putFloat(p, rainflow->damage_residual);
+  const uint32_t cells = (uint32_t)rainflow->row_count * rainflow->mean_bins;
+  for (uint32_t i = 0; i < cells; i++) {
+    // Half cycles, saturated: the damage and cycles fields stay exact
+    const uint32_t n = rainflow->half_cycles[i];
+    p = telemetryFrame_put16(p, (n > UINT16_MAX) ? UINT16_MAX : (uint16_t)n);
+  }
+
+  return telemetryFrame_finish(raw, (uint16_t)(p - raw), out, cap, out_len);
+}
+
+HAL_StatusTypeDef telemetryFrame_encodeSrs(const TelemetryFrame_Srs_t *srs,
+                                           uint8_t *out, uint16_t cap,
+                                           uint16_t *out_len) {
+  if (srs == NULL || out == NULL || out_len == NULL ||
+      srs->freq_count > TELEMETRY_FRAME_SRS_FREQS) {
+    return HAL_ERROR;
+  }
+
+  uint8_t raw[TELEMETRY_FRAME_SRS_SIZE + TELEMETRY_FRAME_CRC_SIZE];
+  uint8_t *p = telemetryFrame_putHeader(raw, TELEMETRY_FRAME_TYPE_SRS,
+                                        srs->trigger_frame, srs->timestamp);
+  *p++ = srs->channel;
+  *p++ = srs->per_octave;
+  *p++ = srs->freq_count;
+  p = telemetryFrame_putFloat(p, srs->first_hz);
+  p = telemetryFrame_putFloat(p, srs->q);
+  p = telemetryFrame_putFloat(p, srs->input_peak_mg);
+  for (uint8_t k = 0; k < srs->freq_count; k++) {
+    // Whole mg, saturated at 65.5 g
+    const float mg = srs->peak_mg[k];
+    p = telemetryFrame_put16(p, (mg >= 65535.0f) ? UINT16_MAX
+                                : (mg > 0.0f)    ? (uint16_t)lrintf(mg)
+                                                 : 0U);
+  }
+
+  return telemetryFrame_finish(raw, (uint16_t)(p - raw), out, cap, out_len);
+}
+
+HAL_StatusTypeDef telemetryFrame_encodeArrival(
+    const TelemetryFrame_Arrival_t *arrival, uint8_t *out, uint16_t cap,
+    uint16_t *out_len) {
+  if (arrival == NULL || out == NULL || out_len == NULL) {
+    return HAL_ERROR;
+  }
+
+  uint8_t raw[TELEMETRY_FRAME_ARRIVAL_SIZE + TELEMETRY_FRAME_CRC_SIZE];
+  uint8_t *p = telemetryFrame_putHeader(raw, TELEMETRY_FRAME_TYPE_ARRIVAL,
+                                        arrival->trigger_frame,
+                                        arrival->timestamp);
+  *p++ = arrival->first_channel;
+  p = telemetryFrame_put32(p, (uint32_t)arrival->first_us);
+  p = telemetryFrame_put32(p, (uint32_t)(arrival->first_us >> 32));
+  p = telemetryFrame_putFloat(p, arrival->frame_period_us);
+  p = telemetryFrame_putFloat(p, arrival->position_m);
+  p = telemetryFrame_put32(p, (uint32_t)arrival->channel_mask);
+  for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+    if (!((arrival->channel_mask >> ch) & 1U)) {
+      continue;
+    }
+    p = telemetryFrame_putFloat(p, arrival->delta_us[ch]);
+    p = telemetryFrame_put16(p, arrival->threshold_codes[ch]);
+  }
+
+  return telemetryFrame_finish(raw, (uint16_t)(p - raw), out, cap, out_len);
+}
+
+HAL_StatusTypeDef telemetryFrame_encodeMode(const TelemetryFrame_Mode_t *mode,
+                                            uint8_t *out, uint16_t cap,
+                                            uint16_t *out_len) {
+  if (mode == NULL || out == NULL || out_len == NULL) {
+    return HAL_ERROR;
+  }
+
+  uint8_t raw[TELEMETRY_FRAME_MODE_SIZE + TELEMETRY_FRAME_CRC_SIZE];
+  uint8_t *p = telemetryFrame_putHeader(raw, TELEMETRY_FRAME_TYPE_MODE,
+                                        mode->gap_sequence, mode->timestamp);
+  *p++ = mode->channel;
+  p = telemetryFrame_put32(p, mode->gap_frames);
+  p = telemetryFrame_put32(p, (uint32_t)mode->capture_start_us);
+  p = telemetryFrame_put32(p, (uint32_t)(mode->capture_start_us >> 32));
+  p = telemetryFrame_put32(p, mode->capture_samples);
+  p = telemetryFrame_put32(p, mode->capture_rate_hz);
+  p = telemetryFrame_put32(p, mode->enter_us);
+  p = telemetryFrame_put32(p, mode->leave_us);
+  p = telemetryFrame_putFloat(p, mode->frame_period_us);
+
+  return telemetryFrame_finish(raw, (uint16_t)(p - raw), out, cap, out_len);
+}
+
+HAL_StatusTypeDef telemetryFrame_encodeBurst(
+    const TelemetryFrame_Burst_t *burst, uint8_t *out, uint16_t cap,
+    uint16_t *out_len) {
+  if (burst == NULL || burst->samples == NULL || out == NULL ||
+      out_len == NULL || burst->count == 0U ||
+      burst->count > TELEMETRY_FRAME_BURST_SAMPLES) {
+    return HAL_ERROR;
+  }
+
+  uint8_t raw[TELEMETRY_FRAME_BURST_SIZE + TELEMETRY_FRAME_CRC_SIZE];
+  uint8_t *p = telemetryFrame_putHeader(raw, TELEMETRY_FRAME_TYPE_BURST,
+                                        burst->offset, burst->timestamp);
+  *p++ = burst->channel;
+  *p++ = burst->count;
+  p = telemetryFrame_put32(p, burst->total);
+  p = telemetryFrame_put32(p, burst->sample_rate_hz);
+
+  // Packed as the sample packet: two per three bytes, low nibble first
+  uint8_t i = 0;
+  for (; i + 1U < burst->count; i += 2U) {
+    const uint16_t a = burst->samples[i] & 0x0FFFU;
+    const uint16_t b = burst->samples[i + 1U] & 0x0FFFU;
+    *p++ = (uint8_t)a;
+    *p++ = (uint8_t)((a >> 8) | (b << 4));
+    *p++ = (uint8_t)(b >> 4);
+  }
+  if (i < burst->count) {
+    const uint16_t a = burst->samples[i] & 0x0FFFU;
+    *p++ = (uint8_t)a;
+    *p++ = (uint8_t)(a >> 8);
+  }
+
+  return telemetryFrame_finish(raw, (uint16_t)(p - raw), out, cap, out_len);
+}
+
+HAL_StatusTypeDef telemetryFrame_encodeLog(const TelemetryFrame_Log_t *log,
+                                           uint8_t *out, uint16_t cap,
+                                           uint16_t *out_len) {
+  if (log == NULL || log->entries == NULL || out == NULL ||
+      out_len == NULL || log->count == 0U ||
+      log->count > TELEMETRY_FRAME_LOG_ENTRIES) {
+    return HAL_ERROR;
+  }
+
+  uint8_t raw[TELEMETRY_FRAME_LOG_SIZE + TELEMETRY_FRAME_CRC_SIZE];
+  uint8_t *p = telemetryFrame_putHeader(raw, TELEMETRY_FRAME_TYPE_LOG,
+                                        log->first, log->timestamp);
+  p = telemetryFrame_put32(p, log->boot);
+  *p++ = log->previous;
+  *p++ = log->count;
+  p = telemetryFrame_put32(p, log->lost);
+  for (uint8_t i = 0; i < log->count; i++) {
+    const EventLog_Entry_t *e = &log->entries[i];
+    p = telemetryFrame_put16(p, e->seq);
+    *p++ = e->code;
+    *p++ = e->arg;
+    p = telemetryFrame_put32(p, e->tick);
+    p = telemetryFrame_put32(p, e->value);
+  }
+
+  return telemetryFrame_finish(raw, (uint16_t)(p - raw), out, cap, out_len);
+}
+
+HAL_StatusTypeDef telemetryFrame_encodeRelay(
+    const TelemetryFrame_Relay_t *relay, uint8_t *out, uint16_t cap,
+    uint16_t *out_len) {
+  if (relay == NULL || relay->data == NULL || out == NULL ||
+      out_len == NULL || relay->count == 0U) {
+    return HAL_ERROR;
+  }
+#if TELEMETRY_FRAME_RELAY_BYTES < 255
+  if (relay->count > TELEMETRY_FRAME_RELAY_BYTES) {
+    return HAL_ERROR;
+  }
+#endif
+
+  uint8_t raw[TELEMETRY_FRAME_RELAY_SIZE + TELEMETRY_FRAME_CRC_SIZE];
+  uint8_t *p = telemetryFrame_putHeader(raw, TELEMETRY_FRAME_TYPE_RELAY,
+                                        relay->cycle, relay->timestamp);
+  *p++ = relay->node;
+  *p++ = relay->count;
+  p = telemetryFrame_put16(p, relay->offset);
+  memcpy(p, relay->data, relay->count);
+  p += relay->count;
+
+  return telemetryFrame_finish(raw, (uint16_t)(p - raw), out, cap, out_len);
+}
+
+HAL_StatusTypeDef telemetryFrame_encodeCepstrum(
+    const TelemetryFrame_Cepstrum_t *cepstrum, uint8_t *out, uint16_t cap,
+    uint16_t *out_len) {
+  if (cepstrum == NULL || out == NULL || out_len == NULL ||
+      cepstrum->peak_count > TELEMETRY_FRAME_CEPSTRUM_PEAKS) {
+    return HAL_ERROR;
+  }
+
+  uint8_t raw[TELEMETRY_FRAME_CEPSTRUM_SIZE + TELEMETRY_FRAME_CRC_SIZE];
+  uint8_t *p = telemetryFrame_putHeader(raw, TELEMETRY_FRAME_TYPE_CEPSTRUM,
+                                        cepstrum->sequence,
+                                        cepstrum->timestamp);
+  *p++ = cepstrum->channel;
+  *p++ = cepstrum->peak_count;
+  for (uint8_t i = 0; i < cepstrum->peak_count; i++) {
+    p = telemetryFrame_putFloat(p, cepstrum->quefrency_ms[i]);
+    p = telemetryFrame_putFloat(p, cepstrum->amplitude[i]);
+  }
+
+  return telemetryFrame_finish(raw, (uint16_t)(p - raw), out, cap, out_len);
+}
+
+HAL_StatusTypeDef telemetryFrame_encodeTsa(const TelemetryFrame_Tsa_t *tsa,
+                                           uint8_t *out, uint16_t cap,
+                                           uint16_t *out_len) {
+  if (tsa == NULL || tsa->samples == NULL || out == NULL ||
+      out_len == NULL || tsa->count == 0U ||
+      tsa->count > TELEMETRY_FRAME_TSA_SAMPLES || !(tsa->scale > 0.0f)) {
+    return HAL_ERROR;
+  }
+
+  uint8_t raw[TELEMETRY_FRAME_TSA_SIZE + TELEMETRY_FRAME_CRC_SIZE];
+  uint8_t *p = telemetryFrame_putHeader(raw, TELEMETRY_FRAME_TYPE_TSA,
+                                        tsa->sequence, tsa->timestamp);
+  *p++ = tsa->channel;
+  p = telemetryFrame_put16(p, tsa->first);
+  *p++ = tsa->count;
+  p = telemetryFrame_put16(p, tsa->samples_per_rev);
+  p = telemetryFrame_put16(p, tsa->revolutions);
+  p = telemetryFrame_put16(p, tsa->rejected);
+  p = telemetryFrame_putFloat(p, tsa->rpm);
+  p = telemetryFrame_putFloat(p, tsa->mean);
+  p = telemetryFrame_putFloat(p, tsa->rms);
+  p = telemetryFrame_putFloat(p, tsa->peak_to_peak);
+  p = telemetryFrame_putFloat(p, tsa->residual_rms);
+  p = telemetryFrame_putFloat(p, tsa->scale);
+  for (uint8_t i = 0; i < tsa->count; i++) {
+    float v = (tsa->samples[i] - tsa->mean) / tsa->scale;
+    if (v > 32767.0f) {
+      v = 32767.0f;
+    } else if (v < -32767.0f) {
+      v = -32767.0f;
+    }
+    p = telemetryFrame_put16(p, (uint16_t)(int16_t)lrintf(v));
+  }
+
+  return telemetryFrame_finish(raw, (uint16_t)(p - raw), out, cap, out_len);
+}
+
+HAL_StatusTypeDef telemetryFrame_encodeRollup(
+    const TelemetryFrame_Rollup_t *rollup, uint8_t *out, uint16_t cap,
+    uint16_t *out_len) {
+  if (rollup == NULL || rollup->min == NULL || rollup->max == NULL ||
+      rollup->mean == NULL || out == NULL || out_len == NULL) {
+    return HAL_ERROR;
+  }
+
+  uint8_t raw[TELEMETRY_FRAME_ROLLUP_SIZE + TELEMETRY_FRAME_CRC_SIZE];
+  uint8_t *p = telemetryFrame_putHeader(raw, TELEMETRY_FRAME_TYPE_ROLLUP,
+                                        rollup->time_s, rollup->timestamp);
+  *p++ = rollup->tier;
+  *p++ = rollup->channel;
+  p = telemetryFrame_put32(p, rollup->windows);
+  for (uint8_t f = 0; f < TELEMETRY_FRAME_FEATURES; f++) {
+    p = telemetryFrame_putFloat(p, rollup->min[f]);
+    p = telemetryFrame_putFloat(p, rollup->max[f]);
+    p = telemetryFrame_putFloat(p, rollup->mean[f]);
+  }
+
+  return telemetryFrame_finish(raw, (uint16_t)(p - raw), out, cap, out_len);
+}
+
+HAL_StatusTypeDef telemetryFrame_encodeDigital(
+    const TelemetryFrame_Digital_t *digital, uint8_t *out, uint16_t cap,
+    uint16_t *out_len) {
+  if (digital == NULL || digital->edges == NULL || digital->count == 0U ||
+      digital->count > TELEMETRY_FRAME_DIGITAL_EDGES || out == NULL ||
+      out_len == NULL) {
+    return HAL_ERROR;
+  }
+
+  uint8_t raw[TELEMETRY_FRAME_DIGITAL_SIZE + TELEMETRY_FRAME_CRC_SIZE];
+  uint8_t *p = telemetryFrame_putHeader(raw, TELEMETRY_FRAME_TYPE_DIGITAL,
+                                        digital->edges[0].frame,
+                                        digital->timestamp);
+  *p++ = digital->count;
+  p = telemetryFrame_put16(p, digital->pins);
+  p = telemetryFrame_put32(p, digital->dropped);
+  for (uint8_t i = 0; i < digital->count; i++) {
+    const TelemetryFrame_DigitalEdge_t *e = &digital->edges[i];
+    p = telemetryFrame_put32(p, e->frame);
+    p = telemetryFrame_put32(p, (uint32_t)e->time_us);
+    p = telemetryFrame_put32(p, (uint32_t)(e->time_us >> 32));
+    p = telemetryFrame_put16(p, e->levels);
+    p = telemetryFrame_put16(p, e->changed);
+  }
+
+  return telemetryFrame_finish(raw, (uint16_t)(p - raw), out, cap, out_len);
+}
+
+HAL_StatusTypeDef telemetryFrame_encodeCoherence(
+    const TelemetryFrame_Coherence_t *coh, uint8_t *out, uint16_t cap,
+    uint16_t *out_len) {
+  if (coh == NULL || out == NULL || out_len == NULL ||
+      coh->freq_count > TELEMETRY_FRAME_MAX_COHERENCE) {
+    return HAL_ERROR;
+  }
+
+  uint8_t raw[TELEMETRY_FRAME_COHERENCE_SIZE + TELEMETRY_FRAME_CRC_SIZE];
+  uint8_t *p = telemetryFrame_putHeader(raw, TELEMETRY_FRAME_TYPE_COHERENCE,
+                                        coh->sequence, coh->timestamp);
+  *p++ = coh->channel_x;
+  *p++ = coh->channel_y;
+  p = telemetryFrame_put16(p, coh->length);
+  *p++ = coh->averages;
+  *p++ = coh->freq_count;
+  for (uint8_t i = 0; i < coh->freq_count; i++) {
+    p = telemetryFrame_putFloat(p, coh->hz[i]);
+    p = telemetryFrame_putFloat(p, coh->coherence[i]);
+    p = telemetryFrame_putFloat(p, coh->phase_deg[i]);
+    p = telemetryFrame_putFloat(p, coh->gain[i]);
+  }
+
+  return telemetryFrame_finish(raw, (uint16_t)(p - raw), out, cap, out_len);
+}
+
+HAL_StatusTypeDef telemetryFrame_encodeDisplay(
+    const TelemetryFrame_Display_t *disp, uint8_t *out, uint16_t cap,
+    uint16_t *out_len) {
+  if (disp == NULL || out == NULL || out_len == NULL ||
+      disp->bucket_count == 0U || disp->channel_mask == 0U ||
+      (disp->channel_mask & (ADC_ChannelMask_t)~TELEMETRY_FRAME_ALL_CHANNELS) !=
+          0U) {
+    return HAL_ERROR;
+  }
+  uint32_t k = 0;
+  for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+    k += (disp->channel_mask >> ch) & 1U;
+  }
+  const uint32_t n = k * disp->bucket_count;
+  if (n > TELEMETRY_FRAME_DISPLAY_PAIRS) {
+    return HAL_ERROR;
+  }
+
+  uint8_t raw[TELEMETRY_FRAME_DISPLAY_SIZE + TELEMETRY_FRAME_CRC_SIZE];
+  uint8_t *p = telemetryFrame_putHeader(raw, TELEMETRY_FRAME_TYPE_DISPLAY,
+                                        disp->first_frame, disp->timestamp);
+  p = telemetryFrame_put16(p, disp->bucket_frames);
+  *p++ = disp->bucket_count;
+  p = telemetryFrame_put32(p, (uint32_t)disp->channel_mask);
+  // min and max packed as in sample packets, low nibble first
+  for (uint32_t i = 0; i < n; i++) {
+    const uint16_t a = disp->min[i] & 0x0FFFU;
+    const uint16_t b = disp->max[i] & 0x0FFFU;
+    *p++ = (uint8_t)a;
+    *p++ = (uint8_t)((a >> 8) | (b << 4));
+    *p++ = (uint8_t)(b >> 4);
+  }
+
+  return telemetryFrame_finish(raw, (uint16_t)(p - raw), out, cap, out_len);
+}
+
+HAL_StatusTypeDef telemetryFrame_encodeStatsCbor(
+    const TelemetryFrame_Stats_t *stats, uint8_t *out, uint16_t cap,
+    uint16_t *out_len) {
+  if (stats == NULL || out == NULL || out_len == NULL) {
+    return HAL_ERROR;
+  }
+  const uint8_t n = ADC_CONVERSIONS_CHANNEL_COUNT;
+  const float tol = TELEMETRY_FRAME_CBOR_TOLERANCE;
+  float v[ADC_CONVERSIONS_CHANNEL_COUNT];
+
+  uint8_t raw[TELEMETRY_FRAME_RAW_MAX];
+  CborWriter_t w;
+  telemetryFrame_cborStart(&w, raw, TELEMETRY_FRAME_TYPE_STATS,
+                           stats->sequence, stats->timestamp, 13U);
+  cborWriter_uint(&w, TELEMETRY_FRAME_CBOR_CHANNELS);
+  cborWriter_uint(&w, (uint32_t)TELEMETRY_FRAME_ALL_CHANNELS);
+  cborWriter_uint(&w, TELEMETRY_FRAME_CBOR_FRAMES);
+  cborWriter_uint(&w, stats->channels[0].count);
+  cborWriter_uint(&w, TELEMETRY_FRAME_CBOR_MIN);
+  cborWriter_array(&w, n);
+  for (uint8_t ch = 0; ch < n; ch++) {
+    cborWriter_uint(&w, stats->channels[ch].min);
+  }
+  cborWriter_uint(&w, TELEMETRY_FRAME_CBOR_MAX);
+  cborWriter_array(&w, n);
+  for (uint8_t ch = 0; ch < n; ch++) {
+    cborWriter_uint(&w, stats->channels[ch].max);
+  }
+  for (uint8_t ch = 0; ch < n; ch++) {
+    v[ch] = stats->channels[ch].mean;
+  }
+  telemetryFrame_cborFloats(&w, TELEMETRY_FRAME_CBOR_MEAN, v, n, 0.0f);
+  for (uint8_t ch = 0; ch < n; ch++) {
+    v[ch] = stats->channels[ch].rms;
+  }
+  telemetryFrame_cborFloats(&w, TELEMETRY_FRAME_CBOR_RMS, v, n, tol);
+  for (uint8_t ch = 0; ch < n; ch++) {
+    v[ch] = stats->channels[ch].crest_factor;
+  }
+  telemetryFrame_cborFloats(&w, TELEMETRY_FRAME_CBOR_CREST, v, n, tol);
+  telemetryFrame_cborFloats(&w, TELEMETRY_FRAME_CBOR_DC_BIAS, stats->dc_bias,
+                            n, 0.0f);
+  for (uint8_t ch = 0; ch < n; ch++) {
+    v[ch] = stats->channels[ch].skewness;
+  }
+  telemetryFrame_cborFloats(&w, TELEMETRY_FRAME_CBOR_SKEWNESS, v, n, tol);
+  for (uint8_t ch = 0; ch < n; ch++) {
+    v[ch] = stats->channels[ch].kurtosis;
+  }
+  telemetryFrame_cborFloats(&w, TELEMETRY_FRAME_CBOR_KURTOSIS, v, n, tol);
+
+  return telemetryFrame_cborFinish(&w, raw, out, cap, out_len);
+}
+
+HAL_StatusTypeDef telemetryFrame_encodeSpectrumCbor(
+    const TelemetryFrame_Spectrum_t *spectrum, uint8_t *out, uint16_t cap,
+    uint16_t *out_len) {
+  if (spectrum == NULL || out == NULL || out_len == NULL ||
+      spectrum->band_count > TELEMETRY_FRAME_MAX_BANDS) {
+    return HAL_ERROR;
+  }
+  const float tol = TELEMETRY_FRAME_CBOR_TOLERANCE;
+
+  uint8_t raw[TELEMETRY_FRAME_RAW_MAX];
+  CborWriter_t w;
+  telemetryFrame_cborStart(&w, raw, TELEMETRY_FRAME_TYPE_SPECTRUM,
+                           spectrum->sequence, spectrum->timestamp, 12U);
+  cborWriter_uint(&w, TELEMETRY_FRAME_CBOR_CHANNELS);
+  cborWriter_uint(&w, spectrum->channel);
+  cborWriter_uint(&w, TELEMETRY_FRAME_CBOR_WINDOW);
+  cborWriter_uint(&w, spectrum->window);
+  cborWriter_uint(&w, TELEMETRY_FRAME_CBOR_LENGTH);
+  cborWriter_uint(&w, spectrum->length);
+  cborWriter_uint(&w, TELEMETRY_FRAME_CBOR_AVERAGES);
+  cborWriter_uint(&w, spectrum->averages);
+  cborWriter_uint(&w, TELEMETRY_FRAME_CBOR_PEAK_HZ);
+  cborWriter_float(&w, spectrum->peak_hz, tol);
+  cborWriter_uint(&w, TELEMETRY_FRAME_CBOR_PEAK_AMPLITUDE);
+  cborWriter_float(&w, spectrum->peak_amplitude, tol);
+  cborWriter_uint(&w, TELEMETRY_FRAME_CBOR_RMS);
+  cborWriter_float(&w, spectrum->rms, tol);
+  telemetryFrame_cborFloats(&w, TELEMETRY_FRAME_CBOR_BAND_RMS,
+                            spectrum->band_rms, spectrum->band_count, tol);
+  telemetryFrame_cborFloats(&w, TELEMETRY_FRAME_CBOR_BAND_KURTOSIS,
+                            spectrum->band_kurtosis, spectrum->band_count, tol);
+
+  return telemetryFrame_cborFinish(&w, raw, out, cap, out_len);
+}
+
+HAL_StatusTypeDef telemetryFrame_encodeVelocityCbor(
+    const TelemetryFrame_Velocity_t *vel, uint8_t *out, uint16_t cap,
+    uint16_t *out_len) {
+  if (vel == NULL || out == NULL || out_len == NULL) {
+    return HAL_ERROR;
+  }
+  const float tol = TELEMETRY_FRAME_CBOR_TOLERANCE;
+  uint8_t n = 0;
+  for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+    n += (uint8_t)((vel->channel_mask >> ch) & 1U);
+  }
+
+  uint8_t raw[TELEMETRY_FRAME_RAW_MAX];
+  CborWriter_t w;
+  telemetryFrame_cborStart(&w, raw, TELEMETRY_FRAME_TYPE_VELOCITY,
+                           vel->sequence, vel->timestamp, 9U);
+  cborWriter_uint(&w, TELEMETRY_FRAME_CBOR_CHANNELS);
+  cborWriter_uint(&w, (uint32_t)vel->channel_mask);
+  cborWriter_uint(&w, TELEMETRY_FRAME_CBOR_INTERVAL);
+  cborWriter_uint(&w, vel->interval_ms);
+  cborWriter_uint(&w, TELEMETRY_FRAME_CBOR_BAND);
+  cborWriter_array(&w, 2U);
+  cborWriter_uint(&w, vel->low_hz);
+  cborWriter_uint(&w, vel->high_hz);
+  cborWriter_uint(&w, TELEMETRY_FRAME_CBOR_RMS);
+  cborWriter_array(&w, n);
+  for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+    if ((vel->channel_mask >> ch) & 1U) {
+      cborWriter_float(&w, vel->rms_mm_s[ch], tol);
+    }
+  }
+  cborWriter_uint(&w, TELEMETRY_FRAME_CBOR_PEAK);
+  cborWriter_array(&w, n);
+  for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+    if ((vel->channel_mask >> ch) & 1U) {
+      cborWriter_float(&w, vel->peak_mm_s[ch], tol);
+    }
+  }
+  cborWriter_uint(&w, TELEMETRY_FRAME_CBOR_ZONE);
+  cborWriter_array(&w, n);
+  for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+    if ((vel->channel_mask >> ch) & 1U) {
+      cborWriter_uint(&w, vel->zone[ch]);
+    }
+  }
+
+  return telemetryFrame_cborFinish(&w, raw, out, cap, out_len);
+}
+
+HAL_StatusTypeDef telemetryFrame_initException(
+    TelemetryFrame_Exception_t *exc, const TelemetryFrame_ExceptionConfig_t *cfg) {
+  if (exc == NULL || cfg == NULL) {
+    return HAL_ERROR;
+  }
+  for (uint8_t f = 0; f < TELEMETRY_FRAME_FEATURES; f++) {
+    if (!(cfg->deadband[f] >= 0.0f)) {
+      return HAL_ERROR;
+    }
+  }
+  memset(exc, 0, sizeof(*exc));
+  exc->cfg = *cfg;
+  return HAL_OK;
+}
+
+void telemetryFrame_resetException(TelemetryFrame_Exception_t *exc) {
+  if (exc != NULL) {
+    exc->known = 0;
+  }
+}
+
+void telemetryFrame_statsFeatures(const TelemetryFrame_Stats_t *stats,
+                                  TelemetryFrame_Features_t *features) {
+  if (stats == NULL || features == NULL) {
+    return;
+  }
+  features->sequence = stats->sequence;
+  features->timestamp = stats->timestamp;
+  features->channel_mask = TELEMETRY_FRAME_ALL_CHANNELS;
+  for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+    const ADC_ChannelStats_t *c = &stats->channels[ch];
+    float *v = features->value[ch];
+    v[TELEMETRY_FRAME_FEATURE_MEAN] = c->mean;
+    v[TELEMETRY_FRAME_FEATURE_RMS] = c->rms;
+    v[TELEMETRY_FRAME_FEATURE_PEAK_TO_PEAK] = (float)c->peak_to_peak;
+    v[TELEMETRY_FRAME_FEATURE_CREST] = c->crest_factor;
+    v[TELEMETRY_FRAME_FEATURE_KURTOSIS] = c->kurtosis;
+    v[TELEMETRY_FRAME_FEATURE_DC_BIAS] = stats->dc_bias[ch];
+  }
+}
+
+HAL_StatusTypeDef telemetryFrame_encodeException(
+    TelemetryFrame_Exception_t *exc, const TelemetryFrame_Features_t *features,
+    uint8_t *out, uint16_t cap, uint16_t *out_len) {
+  if (exc == NULL || features == NULL || out == NULL || out_len == NULL) {
+    return HAL_ERROR;
+  }
+
+  const uint8_t all = (uint8_t)((1U << TELEMETRY_FRAME_FEATURES) - 1U);
+  uint8_t due[ADC_CONVERSIONS_CHANNEL_COUNT];
+  ADC_ChannelMask_t channel_mask = 0;
+  ADC_ChannelMask_t whole = 0;
+  uint32_t offered = 0;
+  for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+    due[ch] = 0;
+    if (!((features->channel_mask >> ch) & 1U)) {
+      continue;
+    }
+    offered += TELEMETRY_FRAME_FEATURES;
+    if (!((exc->known >> ch) & 1U) ||
+        (exc->cfg.heartbeat_ms != 0U &&
+         features->timestamp - exc->record_ms[ch] >= exc->cfg.heartbeat_ms)) {
+      due[ch] = all;
+      whole |= (ADC_ChannelMask_t)(1UL << ch);
+    } else {
+      for (uint8_t f = 0; f < TELEMETRY_FRAME_FEATURES; f++) {
+        if (fabsf(features->value[ch][f] - exc->sent[ch][f]) >
+            exc->cfg.deadband[f]) {
+          due[ch] |= (uint8_t)(1U << f);
+        }
+      }
+    }
+    if (due[ch] != 0U) {
+      channel_mask |= (ADC_ChannelMask_t)(1UL << ch);
+    }
+  }
+  exc->evaluated += offered;
+  if (channel_mask == 0U) {
+    return HAL_BUSY;
+  }
+
+  uint8_t raw[TELEMETRY_FRAME_EXCEPTION_SIZE + TELEMETRY_FRAME_CRC_SIZE];
+  uint8_t *p = telemetryFrame_putHeader(raw, TELEMETRY_FRAME_TYPE_EXCEPTION,
+                                        features->sequence,
+                                        features->timestamp);
+  *p++ = TELEMETRY_FRAME_FEATURES;
+  p = telemetryFrame_put32(p, (uint32_t)channel_mask);
+  for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+    if (due[ch] == 0U) {
+      continue;
+    }
+    *p++ = due[ch];
+    for (uint8_t f = 0; f < TELEMETRY_FRAME_FEATURES; f++) {
+      if ((due[ch] >> f) & 1U) {
+        p = telemetryFrame_putFloat(p, features->value[ch][f]);
+      }
+    }
+  }
+  HAL_StatusTypeDef status =
+      telemetryFrame_finish(raw, (uint16_t)(p - raw), out, cap, out_len);
+  if (status != HAL_OK) {
+    return status;
+  }
+
+  // The host now holds these values
+  for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+    for (uint8_t f = 0; f < TELEMETRY_FRAME_FEATURES; f++) {
+      if ((due[ch] >> f) & 1U) {
+        exc->sent[ch][f] = features->value[ch][f];
+        exc->reported++;
+      }
+    }
+    if ((whole >> ch) & 1U) {
+      exc->record_ms[ch] = features->timestamp;
+    }
+  }
+  exc->known |= whole;
+  exc->packets++;
+  return HAL_OK;
+}
+
+ADC_HOT_CODE uint16_t telemetryFrame_crc16(const uint8_t *data, uint16_t len) {
+  uint16_t crc = 0xFFFFU;
+#if CRC_UNIT_ENABLE
+  // Bitwise below only while another transport holds the unit
+  if (crcUnit_crc16(data, len, &crc) == HAL_OK) {
+    return crc;
+  }
+#endif
+  for (uint16_t i = 0; i < len; i++) {
+    crc ^= (uint16_t)data[i] << 8;
+    for (uint8_t bit = 0; bit < 8U; bit++) {
+      crc = (crc & 0x8000U) ? (uint16_t)((crc << 1) ^ 0x1021U)
+                            : (uint16_t)(crc << 1);
+    }
+  }
+  return crc;
+}
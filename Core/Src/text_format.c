@@ -0,0 +1,95 @@
+/**
+ ******************************************************************************
+ * @file    text_format.c
+ * @brief   Implementation of the printf-free number formatting
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "text_format.h"
+
+/* Private variables ---------------------------------------------------------*/
+static const char digit_pairs[200] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+static const char hex_digits[16] = "0123456789abcdef";
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+ * @brief Decimal digits in value
+ */
+static uint8_t textFormat_digits(uint32_t value) {
+  uint8_t n = 1;
+  while (n < TEXT_FORMAT_U32_MAX && value >= 10U) {
+    // Four at a time first: frame codes and counters are mostly short
+    if (value >= 10000U) {
+      value /= 10000U;
+      n += 4U;
+    } else {
+      value /= 10U;
+      n++;
+    }
+  }
+  return n;
+}
+
+/**
+ * @brief The n digits of value, ending at end (exclusive), pairs first
+ */
+static void textFormat_backwards(char *end, uint32_t value, uint8_t n) {
+  while (n >= 2U) {
+    const uint32_t pair = (value % 100U) * 2U;
+    value /= 100U;
+    *--end = digit_pairs[pair + 1U];
+    *--end = digit_pairs[pair];
+    n -= 2U;
+  }
+  if (n != 0U) {
+    *--end = (char)('0' + value);
+  }
+}
+
+/* Public functions ----------------------------------------------------------*/
+
+uint8_t textFormat_u32(char *out, uint32_t value) {
+  const uint8_t n = textFormat_digits(value);
+  textFormat_backwards(out + n, value, n);
+  return n;
+}
+
+uint8_t textFormat_u32Width(char *out, uint32_t value, uint8_t width) {
+  const uint8_t n = textFormat_digits(value);
+  if (n >= width) {
+    textFormat_backwards(out + n, value, n);
+    return n;
+  }
+  for (uint8_t i = 0; i < width - n; i++) {
+    out[i] = ' ';
+  }
+  textFormat_backwards(out + width, value, n);
+  return width;
+}
+
+uint8_t textFormat_hex(char *out, uint32_t value, uint8_t digits) {
+  if (digits == 0U) {
+    digits = 1U;
+  } else if (digits > TEXT_FORMAT_HEX_MAX) {
+    digits = TEXT_FORMAT_HEX_MAX;
+  }
+  for (uint8_t i = digits; i > 0U; i--) {
+    out[i - 1U] = hex_digits[value & 0xFU];
+    value >>= 4;
+  }
+  return digits;
+}
@@ -0,0 +1,323 @@
+/**
+ ******************************************************************************
+ * @file    time_sync.c
+ * @brief   Implementation of the 1PPS discipline of the TIM2 frame trigger
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "time_sync.h"
+#include "adc_sections.h"
+#include "tim.h"
+#include "timebase.h"
+
+/* Private defines -----------------------------------------------------------*/
+#define TIME_SYNC_HOLDOVER_PULSES 2U // pulse intervals without an edge
+#define TIME_SYNC_INPUT_FILTER 0x3U  // 8 samples at the timer clock
+
+/* Private variables ---------------------------------------------------------*/
+
+/* Configuration, fixed while running */
+static volatile uint8_t running = 0;
+static TimeSync_Input_t input = TIME_SYNC_INPUT_PIN;
+static uint8_t discipline = 1; // 0 = measure only, TIM2 left at nominal
+static uint32_t timer_clk_hz = 0;
+static uint32_t frames_per_pulse = 0;
+static uint64_t nominal_interval = 0; // timer ticks per pulse interval
+
+/* Frame pacing: period in 32.32 fixed point and its phase accumulator */
+static uint64_t period_q32 = 0;
+static uint32_t period_acc = 0;
+static uint32_t period_active = 0; // ticks of the period now counting
+static uint32_t period_next = 0;   // ticks loaded into ARR (next period)
+
+/* Elapsed timer ticks and updates since TIM2 started, at the last update */
+static uint32_t updates = 0;
+static uint64_t ticks_total = 0;
+static uint64_t last_update_time = 0;
+
+/* Pulse tracking */
+static uint8_t have_reference = 0;
+static uint64_t last_pulse_ticks = 0;
+static uint32_t lock_count = 0;
+static TimeSync_Status_t status = {.state = TIME_SYNC_OFF};
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+ * @brief Input clock of TIM2 (APB1 timers run at 2x PCLK1 when APB1 is divided)
+ */
+static uint32_t timeSync_clockHz(void) {
+  uint32_t clk = HAL_RCC_GetPCLK1Freq();
+  if ((RCC->CFGR & RCC_CFGR_PPRE1) != RCC_HCLK_DIV1) {
+    clk *= 2U;
+  }
+  return clk;
+}
+
+/**
+ * @brief Next period from the 32.32 period: the integer part, plus one
+ *        whenever the fraction accumulator carries
+ */
+ADC_FAST_CODE static uint32_t timeSync_nextPeriod(void) {
+  uint32_t before = period_acc;
+  period_acc += (uint32_t)period_q32;
+  return (uint32_t)(period_q32 >> 32) + ((period_acc < before) ? 1U : 0U);
+}
+
+/**
+ * @brief TIM2 update: account the finished period(s) and load the next one
+ */
+ADC_FAST_CODE static void timeSync_update(void) {
+  uint64_t now = timebase_now();
+
+  if ((TIM2->CR1 & TIM_CR1_CEN) == 0U) {
+    // Software update (analogSensor_startTimedDMA()): counting restarts
+    updates = 0;
+    ticks_total = 0;
+    period_acc = 0;
+    period_active = TIM2->ARR + 1U;
+    period_next = period_active;
+    have_reference = 0;
+    return;
+  }
+
+  // A late interrupt covers several updates, and ARR was not rewritten in
+  // between, so every extra period was period_next long
+  uint32_t n = 1U;
+  if (updates != 0U) {
+    uint64_t elapsed = (now - last_update_time) * timer_clk_hz /
+                       TIMEBASE_TICK_HZ;
+    if (elapsed > (uint64_t)period_active + period_next / 2U) {
+      n += (uint32_t)((elapsed - period_active + period_next / 2U) /
+                      period_next);
+      status.missed_updates += n - 1U;
+    }
+  }
+  last_update_time = now;
+
+  updates += n;
+  ticks_total += period_active + (uint64_t)(n - 1U) * period_next;
+  period_active = period_next;
+  period_next = timeSync_nextPeriod();
+  TIM2->ARR = period_next - 1U;
+}
+
+/**
+ * @brief Sync edge captured at count ccr of the current period
+ */
+static void timeSync_pulse(uint32_t ccr) {
+  uint64_t now = timebase_now();
+  uint64_t at = ticks_total + ccr;
+
+  // Distance from the nearest trigger, and the frame that trigger started
+  // (update k starts frame k - 1)
+  int32_t phase = (ccr < period_active / 2U)
+                      ? (int32_t)ccr
+                      : (int32_t)ccr - (int32_t)period_active;
+  if (phase >= 0 && updates == 0U) {
+    return; // before the first trigger
+  }
+  uint32_t frame = (phase >= 0) ? updates - 1U : updates;
+
+  if (!have_reference) {
+    have_reference = 1;
+    last_pulse_ticks = at;
+    return;
+  }
+  uint64_t interval = at - last_pulse_ticks;
+  last_pulse_ticks = at;
+
+  uint64_t tolerance = nominal_interval * TIME_SYNC_MAX_PPM / 1000000U;
+  if (interval + tolerance < nominal_interval ||
+      interval > nominal_interval + tolerance) {
+    // Glitch or missed pulses: keep the rate, restart from this edge
+    status.rejected++;
+    lock_count = 0;
+    if (status.state == TIME_SYNC_LOCKED) {
+      status.state = TIME_SYNC_ACQUIRING;
+    }
+    return;
+  }
+
+  // Pace the next interval at the measured rate, closing half of the phase
+  // error over it: e_next = e / 2
+  if (discipline) {
+    int64_t target = (int64_t)(interval << 32) + ((int64_t)phase << 31);
+    period_q32 = (uint64_t)(target / (int64_t)frames_per_pulse);
+  }
+
+  int32_t phase_ns = (int32_t)((int64_t)phase * 1000000000LL /
+                               (int64_t)timer_clk_hz);
+  uint32_t magnitude = (uint32_t)((phase_ns < 0) ? -phase_ns : phase_ns);
+  lock_count = (magnitude <= TIME_SYNC_LOCK_NS) ? lock_count + 1U : 0U;
+
+  status.pulses++;
+  status.phase_ns = phase_ns;
+  status.clock_ppm =
+      (float)((int64_t)(interval * TIME_SYNC_PULSE_HZ) - (int64_t)timer_clk_hz) *
+      1.0e6f / (float)timer_clk_hz;
+  status.pulse_frame = frame;
+  status.pulse_time = now;
+  if (!discipline) {
+    status.state = TIME_SYNC_MEASURING;
+  } else {
+    status.state = (lock_count >= TIME_SYNC_LOCK_PULSES) ? TIME_SYNC_LOCKED
+                                                         : TIME_SYNC_ACQUIRING;
+  }
+}
+
+/* Public functions ----------------------------------------------------------*/
+
+HAL_StatusTypeDef timeSync_setInput(TimeSync_Input_t source) {
+  if (running) {
+    return HAL_BUSY;
+  }
+  if (source != TIME_SYNC_INPUT_PIN && source != TIME_SYNC_INPUT_PTP) {
+    return HAL_ERROR;
+  }
+  input = source;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef timeSync_setDiscipline(uint8_t enable) {
+  if (running) {
+    return HAL_BUSY;
+  }
+  discipline = (enable != 0U) ? 1U : 0U;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef timeSync_start(uint32_t frame_rate_hz) {
+  if (TIM2->CR1 & TIM_CR1_CEN) {
+    return HAL_BUSY;
+  }
+  uint32_t clk = timeSync_clockHz();
+  if (frame_rate_hz == 0U || frame_rate_hz % TIME_SYNC_PULSE_HZ != 0U ||
+      clk / frame_rate_hz < 2U) {
+    return HAL_ERROR;
+  }
+
+  TIM_IC_InitTypeDef ic = {0};
+  ic.ICPolarity = TIM_ICPOLARITY_RISING;
+  ic.ICPrescaler = TIM_ICPSC_DIV1;
+  if (input == TIME_SYNC_INPUT_PTP) {
+    // ITR1 = Ethernet PTP trigger; TS only routes it to TRC (no slave mode)
+    TIM2->OR = (TIM2->OR & ~TIM2_OR_ITR1_RMP) | TIM2_OR_ITR1_RMP_0;
+    TIM2->SMCR = (TIM2->SMCR & ~TIM_SMCR_TS) | TIM_TS_ITR1;
+    ic.ICSelection = TIM_ICSELECTION_TRC;
+    ic.ICFilter = 0; // on-chip signal, no glitches to filter
+  } else {
+    GPIO_InitTypeDef gpio = {0};
+    TIME_SYNC_GPIO_CLK_ENABLE();
+    gpio.Pin = TIME_SYNC_GPIO_PIN;
+    gpio.Mode = GPIO_MODE_AF_PP;
+    gpio.Pull = GPIO_PULLDOWN;
+    gpio.Speed = GPIO_SPEED_FREQ_LOW;
+    gpio.Alternate = GPIO_AF1_TIM2;
+    HAL_GPIO_Init(TIME_SYNC_GPIO_PORT, &gpio);
+    ic.ICSelection = TIM_ICSELECTION_DIRECTTI;
+    ic.ICFilter = TIME_SYNC_INPUT_FILTER;
+  }
+  if (HAL_TIM_IC_ConfigChannel(&htim2, &ic, TIM_CHANNEL_4) != HAL_OK) {
+    return HAL_ERROR;
+  }
+
+  HAL_NVIC_DisableIRQ(TIM2_IRQn);
+  timer_clk_hz = clk;
+  frames_per_pulse = frame_rate_hz / TIME_SYNC_PULSE_HZ;
+  nominal_interval = clk / TIME_SYNC_PULSE_HZ;
+  period_q32 = ((uint64_t)clk << 32) / frame_rate_hz;
+  period_acc = 0;
+  period_active = TIM2->ARR + 1U;
+  period_next = period_active;
+  updates = 0;
+  ticks_total = 0;
+  have_reference = 0;
+  lock_count = 0;
+  status = (TimeSync_Status_t){.state = TIME_SYNC_NO_SIGNAL};
+
+  TIM2->SR = 0;
+  TIM2->CCER |= TIM_CCER_CC4E;
+  TIM2->DIER |= TIM_DIER_UIE | TIM_DIER_CC4IE;
+  running = 1;
+  HAL_NVIC_SetPriority(TIM2_IRQn, TIME_SYNC_IRQ_PRIORITY, 0);
+  HAL_NVIC_EnableIRQ(TIM2_IRQn);
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef timeSync_setFrameRate(uint32_t frame_rate_hz) {
+  if (!running || frame_rate_hz == 0U ||
+      frame_rate_hz % TIME_SYNC_PULSE_HZ != 0U ||
+      timer_clk_hz / frame_rate_hz < 2U) {
+    return HAL_ERROR;
+  }
+  uint32_t fpp = frame_rate_hz / TIME_SYNC_PULSE_HZ;
+
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  // Same ticks per pulse interval, split into fpp periods: the disciplined
+  // rate survives, the trigger grid moves so the phase is relearned
+  period_q32 = period_q32 * frames_per_pulse / fpp;
+  frames_per_pulse = fpp;
+  have_reference = 0;
+  lock_count = 0;
+  if (status.state == TIME_SYNC_LOCKED) {
+    status.state = TIME_SYNC_ACQUIRING;
+  }
+  __set_PRIMASK(primask);
+  return HAL_OK;
+}
+
+void timeSync_stop(void) {
+  HAL_NVIC_DisableIRQ(TIM2_IRQn);
+  TIM2->DIER &= ~(TIM_DIER_UIE | TIM_DIER_CC4IE);
+  TIM2->CCER &= ~TIM_CCER_CC4E;
+  running = 0;
+  status.state = TIME_SYNC_OFF;
+}
+
+HAL_StatusTypeDef timeSync_getStatus(TimeSync_Status_t *out) {
+  if (out == NULL) {
+    return HAL_ERROR;
+  }
+
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  *out = status;
+  __set_PRIMASK(primask);
+
+  // Reported only: the rate in use is simply kept until pulses return
+  uint64_t silence = timebase_now() - out->pulse_time;
+  if ((out->state == TIME_SYNC_ACQUIRING || out->state == TIME_SYNC_LOCKED ||
+       out->state == TIME_SYNC_MEASURING) &&
+      silence > (uint64_t)TIME_SYNC_HOLDOVER_PULSES * TIMEBASE_TICK_HZ /
+                    TIME_SYNC_PULSE_HZ) {
+    out->state = TIME_SYNC_HOLDOVER;
+  }
+  return HAL_OK;
+}
+
+ADC_FAST_CODE void timeSync_irqHandler(void) {
+  uint32_t sr = TIM2->SR & TIM2->DIER;
+  TIM2->SR = (uint32_t)~(sr | TIM_SR_CC4OF); // rc_w0: only these clear
+  if (!running) {
+    return;
+  }
+
+  // With both flags set, a capture late in the period (high count)
+  // happened before the update
+  uint32_t ccr = TIM2->CCR4;
+  uint8_t capture = (sr & TIM_SR_CC4IF) != 0U;
+  if (capture && (sr & TIM_SR_UIF) && ccr >= period_active / 2U) {
+    timeSync_pulse(ccr);
+    capture = 0;
+  }
+  if (sr & TIM_SR_UIF) {
+    timeSync_update();
+  }
+  if (capture) {
+    timeSync_pulse(ccr);
+  }
+}
@@ -0,0 +1,156 @@
+/**
+ ******************************************************************************
+ * @file    timebase.c
+ * @brief   Implementation of the 64-bit TIM5 timebase
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "timebase.h"
+#include "adc_sections.h"
+
+/* Private defines -----------------------------------------------------------*/
+#define TIMEBASE_HALF_RANGE 0x80000000U
+
+/* Private variables ---------------------------------------------------------*/
+
+/* Upper 32 bits of the tick count, written by the TIM5 interrupt only */
+static volatile uint32_t wraps = 0;
+
+/* Compare alarm of timebase_wakeAt(): armed flag and its low 32 bits */
+static volatile uint8_t wake_armed = 0;
+static uint32_t wake_at = 0;
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+ * @brief Input clock of TIM5 (APB1 timers run at 2x PCLK1 when APB1 is divided)
+ */
+static uint32_t timebase_clockHz(void) {
+  uint32_t clk = HAL_RCC_GetPCLK1Freq();
+  if ((RCC->CFGR & RCC_CFGR_PPRE1) != RCC_HCLK_DIV1) {
+    clk *= 2U;
+  }
+  return clk;
+}
+
+/* Public functions ----------------------------------------------------------*/
+
+HAL_StatusTypeDef timebase_setClock(uint32_t clk_hz) {
+  if (clk_hz % TIMEBASE_TICK_HZ != 0U ||
+      clk_hz / TIMEBASE_TICK_HZ > 0x10000U) {
+    return HAL_ERROR;
+  }
+  const uint32_t psc = clk_hz / TIMEBASE_TICK_HZ - 1U;
+
+  // Load the new prescaler now. UG clears the counter and, with URS set,
+  // raises no update, so the count is written back
+  if (TIM5->PSC != psc) {
+    const uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    const uint32_t cnt = TIM5->CNT;
+    TIM5->PSC = psc;
+    TIM5->EGR = TIM_EGR_UG;
+    TIM5->CNT = cnt;
+    __set_PRIMASK(primask);
+  }
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef timebase_init(void) {
+  uint32_t clk = timebase_clockHz();
+  if (clk % TIMEBASE_TICK_HZ != 0U || clk / TIMEBASE_TICK_HZ > 0x10000U) {
+    return HAL_ERROR;
+  }
+
+  const uint32_t psc = clk / TIMEBASE_TICK_HZ - 1U;
+
+  __HAL_RCC_TIM5_CLK_ENABLE();
+  if (TIM5->CR1 & TIM_CR1_CEN) {
+    return timebase_setClock(clk); // clock change: keep counting
+  }
+
+  TIM5->CR1 = 0;
+  TIM5->PSC = psc;
+  TIM5->ARR = 0xFFFFFFFFU;
+  TIM5->CNT = 0;
+  TIM5->EGR = TIM_EGR_UG; // load PSC now
+  TIM5->SR = 0;
+  wraps = 0;
+  wake_armed = 0;
+  TIM5->DIER = TIM_DIER_UIE;
+  // Only counter overflow raises an update from here on
+  TIM5->CR1 = TIM_CR1_URS | TIM_CR1_CEN;
+
+  HAL_NVIC_SetPriority(TIM5_IRQn, TIMEBASE_IRQ_PRIORITY, 0);
+  HAL_NVIC_EnableIRQ(TIM5_IRQn);
+  return HAL_OK;
+}
+
+ADC_FAST_CODE uint64_t timebase_now(void) {
+  uint32_t hi;
+  uint32_t lo;
+  uint32_t pending;
+
+  do {
+    hi = wraps;
+    lo = TIM5->CNT;
+    pending = TIM5->SR & TIM_SR_UIF;
+  } while (hi != wraps);
+
+  // A wrap the interrupt has not counted yet: only a low count read after
+  // the flag rose belongs to the next period
+  if (pending && lo < TIMEBASE_HALF_RANGE) {
+    hi++;
+  }
+  return ((uint64_t)hi << 32) | lo;
+}
+
+uint64_t timebase_toMicros(uint64_t ticks) {
+#if TIMEBASE_TICK_HZ == 1000000U
+  return ticks;
+#else
+  return (ticks / TIMEBASE_TICK_HZ) * 1000000U +
+         (ticks % TIMEBASE_TICK_HZ) * 1000000U / TIMEBASE_TICK_HZ;
+#endif
+}
+
+void timebase_wakeAt(uint64_t tick) {
+  const uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  const uint64_t now = timebase_now();
+  if (tick <= now) {
+    __set_PRIMASK(primask);
+    return;
+  }
+  if (tick - now >= TIMEBASE_HALF_RANGE) {
+    tick = now + TIMEBASE_HALF_RANGE - 1U; // early; the caller re-arms
+  }
+  const uint32_t at = (uint32_t)tick;
+  if (!wake_armed || (int32_t)(at - wake_at) < 0) {
+    wake_at = at;
+    wake_armed = 1;
+    TIM5->CCR1 = at; // frozen output compare: only CC1IF
+    TIM5->SR = (uint32_t)~TIM_SR_CC1IF;
+    TIM5->DIER |= TIM_DIER_CC1IE;
+    // The count may have passed it while it was written
+    if ((int32_t)(TIM5->CNT - at) >= 0) {
+      TIM5->EGR = TIM_EGR_CC1G;
+    }
+  }
+  __set_PRIMASK(primask);
+}
+
+void timebase_irqHandler(void) {
+  const uint32_t sr = TIM5->SR;
+  if (sr & TIM_SR_UIF) {
+    TIM5->SR = (uint32_t)~TIM_SR_UIF; // rc_w0: only UIF is cleared
+    wraps++;
+  }
+  if ((sr & TIM_SR_CC1IF) && (TIM5->DIER & TIM_DIER_CC1IE)) {
+    TIM5->SR = (uint32_t)~TIM_SR_CC1IF;
+    TIM5->DIER &= ~TIM_DIER_CC1IE; // one shot: the WFI has ended
+    wake_armed = 0;
+  }
+}
@@ -0,0 +1,456 @@
+/**
+ ******************************************************************************
+ * @file    trigger_expr.c
+ * @brief   Implementation of the trigger expression compiler and evaluator
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "trigger_expr.h"
+#include "adc_sections.h"
+#include <string.h>
+
+/* Private types -------------------------------------------------------------*/
+
+/**
+ * @brief Recursive-descent state; each rule emits its postfix operations
+ */
+typedef struct {
+  const char *text;
+  uint16_t pos;
+  uint8_t nesting;
+  TriggerExpr_t *expr;
+  const char *reason; ///< First error, NULL while none
+  uint16_t error_pos;
+} TriggerExpr_Parser_t;
+
+/* Private variables ---------------------------------------------------------*/
+
+static const char *const feature_names[TRIGGER_EXPR_FEATURE_COUNT] = {
+    [TRIGGER_EXPR_FEATURE_MEAN] = "mean",
+    [TRIGGER_EXPR_FEATURE_RMS] = "rms",
+    [TRIGGER_EXPR_FEATURE_PEAK] = "peak",
+    [TRIGGER_EXPR_FEATURE_PP] = "pp",
+    [TRIGGER_EXPR_FEATURE_CREST] = "crest",
+    [TRIGGER_EXPR_FEATURE_SKEW] = "skew",
+    [TRIGGER_EXPR_FEATURE_KURT] = "kurt"};
+
+/* Private functions ---------------------------------------------------------*/
+
+static inline char triggerExpr_lower(char c) {
+  return (c >= 'A' && c <= 'Z') ? (char)(c - 'A' + 'a') : c;
+}
+
+static inline uint8_t triggerExpr_isAlpha(char c) {
+  c = triggerExpr_lower(c);
+  return (c >= 'a' && c <= 'z') ? 1U : 0U;
+}
+
+static inline uint8_t triggerExpr_isDigit(char c) {
+  return (c >= '0' && c <= '9') ? 1U : 0U;
+}
+
+/**
+ * @brief Record the first error only
+ */
+static void triggerExpr_fail(TriggerExpr_Parser_t *ps, const char *reason) {
+  if (ps->reason == NULL) {
+    ps->reason = reason;
+    ps->error_pos = ps->pos;
+  }
+}
+
+static void triggerExpr_skipSpaces(TriggerExpr_Parser_t *ps) {
+  while (ps->text[ps->pos] == ' ' || ps->text[ps->pos] == '\t') {
+    ps->pos++;
+  }
+}
+
+/**
+ * @brief Take a symbol, or a keyword not followed by another letter
+ */
+static uint8_t triggerExpr_accept(TriggerExpr_Parser_t *ps, const char *sym) {
+  triggerExpr_skipSpaces(ps);
+  uint16_t n = 0;
+  while (sym[n] != '\0') {
+    if (triggerExpr_lower(ps->text[ps->pos + n]) != sym[n]) {
+      return 0;
+    }
+    n++;
+  }
+  if (triggerExpr_isAlpha(sym[0]) &&
+      triggerExpr_isAlpha(ps->text[ps->pos + n])) {
+    return 0;
+  }
+  ps->pos = (uint16_t)(ps->pos + n);
+  return 1;
+}
+
+/**
+ * @brief Take a decimal number: [+-]digits[.digits][e[+-]digits]
+ *
+ * Parsed here rather than by strtof(): newlib's allocates from the heap,
+ * which is sealed after init (mem_budget.h).
+ *
+ * @return uint8_t 1 if a number was taken, into value
+ */
+static uint8_t triggerExpr_number(TriggerExpr_Parser_t *ps, float *value) {
+  const char *text = &ps->text[ps->pos];
+  uint16_t n = 0;
+  uint32_t mantissa = 0;
+  int32_t exponent = 0; // decimal, applied to the mantissa
+  uint8_t digits = 0;
+
+  const uint8_t negative = (text[n] == '-');
+  if (text[n] == '-' || text[n] == '+') {
+    n++;
+  }
+  for (uint8_t fraction = 0;; n++) {
+    if (text[n] == '.' && !fraction) {
+      fraction = 1;
+      continue;
+    }
+    if (!triggerExpr_isDigit(text[n])) {
+      break;
+    }
+    digits = 1;
+    if (mantissa < 100000000U) { // nine significant digits
+      mantissa = mantissa * 10U + (uint32_t)(text[n] - '0');
+      exponent -= fraction;
+    } else {
+      exponent += !fraction;
+    }
+  }
+  if (!digits) {
+    return 0;
+  }
+  if (triggerExpr_lower(text[n]) == 'e') {
+    uint16_t e = (uint16_t)(n + 1U);
+    const uint8_t e_negative = (text[e] == '-');
+    if (text[e] == '-' || text[e] == '+') {
+      e++;
+    }
+    if (triggerExpr_isDigit(text[e])) {
+      int32_t power = 0;
+      while (triggerExpr_isDigit(text[e])) {
+        if (power < 100) {
+          power = power * 10 + (text[e] - '0');
+        }
+        e++;
+      }
+      exponent += e_negative ? -power : power;
+      n = e;
+    }
+  }
+
+  float v = (float)mantissa;
+  for (; exponent > 0 && v < 1e38f; exponent--) {
+    v *= 10.0f;
+  }
+  for (; exponent < 0 && v != 0.0f; exponent++) {
+    v /= 10.0f;
+  }
+  *value = negative ? -v : v;
+  ps->pos = (uint16_t)(ps->pos + n);
+  return 1;
+}
+
+static void triggerExpr_emit(TriggerExpr_Parser_t *ps,
+                             const TriggerExpr_Op_t *op) {
+  TriggerExpr_t *expr = ps->expr;
+  if (expr->op_count >= TRIGGER_EXPR_MAX_OPS) {
+    triggerExpr_fail(ps, "too many operations");
+    return;
+  }
+  expr->ops[expr->op_count++] = *op;
+}
+
+static void triggerExpr_emitLogic(TriggerExpr_Parser_t *ps, uint8_t code) {
+  const TriggerExpr_Op_t op = {.code = code};
+  triggerExpr_emit(ps, &op);
+}
+
+/**
+ * @brief compare := <feature><channel> <op> <number>
+ */
+static void triggerExpr_compare(TriggerExpr_Parser_t *ps) {
+  triggerExpr_skipSpaces(ps);
+  const uint16_t start = ps->pos; // errors point at the feature
+  char name[8];
+  uint8_t len = 0;
+  while (triggerExpr_isAlpha(ps->text[ps->pos])) {
+    if (len + 1U >= sizeof(name)) {
+      ps->pos = start;
+      triggerExpr_fail(ps, "unknown feature");
+      return;
+    }
+    name[len++] = triggerExpr_lower(ps->text[ps->pos++]);
+  }
+  name[len] = '\0';
+  uint8_t feature = TRIGGER_EXPR_FEATURE_COUNT;
+  for (uint8_t f = 0; f < TRIGGER_EXPR_FEATURE_COUNT; f++) {
+    if (strcmp(name, feature_names[f]) == 0) {
+      feature = f;
+    }
+  }
+  if (feature == TRIGGER_EXPR_FEATURE_COUNT) {
+    ps->pos = start;
+    triggerExpr_fail(ps, (len == 0U) ? "expected a feature"
+                                     : "unknown feature");
+    return;
+  }
+  uint32_t channel = 0;
+  if (!triggerExpr_isDigit(ps->text[ps->pos])) {
+    triggerExpr_fail(ps, "expected a channel");
+    return;
+  }
+  while (triggerExpr_isDigit(ps->text[ps->pos])) {
+    channel = channel * 10U + (uint32_t)(ps->text[ps->pos++] - '0');
+    if (channel >= ADC_CONVERSIONS_CHANNEL_COUNT) {
+      triggerExpr_fail(ps, "channel out of range");
+      return;
+    }
+  }
+
+  // Two-character operators first
+  uint8_t code;
+  if (triggerExpr_accept(ps, ">=")) {
+    code = TRIGGER_EXPR_OP_GE;
+  } else if (triggerExpr_accept(ps, "<=")) {
+    code = TRIGGER_EXPR_OP_LE;
+  } else if (triggerExpr_accept(ps, ">")) {
+    code = TRIGGER_EXPR_OP_GT;
+  } else if (triggerExpr_accept(ps, "<")) {
+    code = TRIGGER_EXPR_OP_LT;
+  } else {
+    triggerExpr_fail(ps, "expected > >= < <=");
+    return;
+  }
+
+  triggerExpr_skipSpaces(ps);
+  float threshold = 0.0f;
+  if (!triggerExpr_number(ps, &threshold) ||
+      triggerExpr_isAlpha(ps->text[ps->pos])) {
+    triggerExpr_fail(ps, "expected a number");
+    return;
+  }
+
+  const TriggerExpr_Op_t op = {.code = code,
+                               .feature = feature,
+                               .channel = (uint8_t)channel,
+                               .threshold = threshold};
+  triggerExpr_emit(ps, &op);
+  ps->expr->channel_mask |= (ADC_ChannelMask_t)(1UL << channel);
+}
+
+static void triggerExpr_or(TriggerExpr_Parser_t *ps);
+
+/**
+ * @brief unary := '!' unary | '(' or ')' | compare
+ */
+static void triggerExpr_unary(TriggerExpr_Parser_t *ps) {
+  if (ps->reason != NULL) {
+    return;
+  }
+  const uint8_t negate =
+      triggerExpr_accept(ps, "!") || triggerExpr_accept(ps, "not");
+  const uint8_t group = !negate && triggerExpr_accept(ps, "(");
+  if (!negate && !group) {
+    triggerExpr_compare(ps);
+    return;
+  }
+  if (++ps->nesting > TRIGGER_EXPR_MAX_NESTING) {
+    triggerExpr_fail(ps, "nested too deep");
+    return;
+  }
+  if (negate) {
+    triggerExpr_unary(ps);
+    triggerExpr_emitLogic(ps, TRIGGER_EXPR_OP_NOT);
+  } else {
+    triggerExpr_or(ps);
+    if (ps->reason == NULL && !triggerExpr_accept(ps, ")")) {
+      triggerExpr_fail(ps, "expected )");
+    }
+  }
+  ps->nesting--;
+}
+
+/**
+ * @brief and := unary {'&' unary}
+ */
+static void triggerExpr_and(TriggerExpr_Parser_t *ps) {
+  triggerExpr_unary(ps);
+  while (ps->reason == NULL &&
+         (triggerExpr_accept(ps, "&&") || triggerExpr_accept(ps, "&") ||
+          triggerExpr_accept(ps, "and"))) {
+    triggerExpr_unary(ps);
+    triggerExpr_emitLogic(ps, TRIGGER_EXPR_OP_AND);
+  }
+}
+
+/**
+ * @brief or := and {'|' and}
+ */
+static void triggerExpr_or(TriggerExpr_Parser_t *ps) {
+  triggerExpr_and(ps);
+  while (ps->reason == NULL &&
+         (triggerExpr_accept(ps, "||") || triggerExpr_accept(ps, "|") ||
+          triggerExpr_accept(ps, "or"))) {
+    triggerExpr_and(ps);
+    triggerExpr_emitLogic(ps, TRIGGER_EXPR_OP_OR);
+  }
+}
+
+/**
+ * @brief Statistic of one channel a comparison reads
+ */
+static inline float triggerExpr_feature(const ADC_ChannelStats_t *s,
+                                        uint8_t feature) {
+  switch (feature) {
+  case TRIGGER_EXPR_FEATURE_MEAN:
+    return s->mean;
+  case TRIGGER_EXPR_FEATURE_RMS:
+    return s->rms;
+  case TRIGGER_EXPR_FEATURE_PEAK:
+    return s->crest_factor * s->rms;
+  case TRIGGER_EXPR_FEATURE_PP:
+    return (float)s->peak_to_peak;
+  case TRIGGER_EXPR_FEATURE_CREST:
+    return s->crest_factor;
+  case TRIGGER_EXPR_FEATURE_SKEW:
+    return s->skewness;
+  default:
+    return s->kurtosis;
+  }
+}
+
+/* Public functions ----------------------------------------------------------*/
+
+HAL_StatusTypeDef triggerExpr_compile(const char *text, TriggerExpr_t *expr,
+                                      TriggerExpr_Error_t *err) {
+  if (text == NULL || expr == NULL) {
+    return HAL_ERROR;
+  }
+  memset(expr, 0, sizeof(*expr));
+  TriggerExpr_Parser_t ps = {.text = text, .expr = expr};
+  if (strlen(text) >= TRIGGER_EXPR_TEXT_MAX) {
+    triggerExpr_fail(&ps, "too long");
+  }
+  if (ps.reason == NULL) {
+    triggerExpr_or(&ps);
+  }
+  if (ps.reason == NULL && triggerExpr_accept(&ps, "for")) {
+    triggerExpr_skipSpaces(&ps);
+    if (!triggerExpr_isDigit(text[ps.pos])) {
+      triggerExpr_fail(&ps, "expected a hold in ms");
+    }
+    while (ps.reason == NULL && triggerExpr_isDigit(text[ps.pos])) {
+      expr->hold_ms = expr->hold_ms * 10U + (uint32_t)(text[ps.pos++] - '0');
+      if (expr->hold_ms > 3600000U) {
+        triggerExpr_fail(&ps, "hold above 1 h");
+      }
+    }
+    (void)triggerExpr_accept(&ps, "ms");
+  }
+  triggerExpr_skipSpaces(&ps);
+  if (ps.reason == NULL && text[ps.pos] != '\0') {
+    triggerExpr_fail(&ps, "unexpected text");
+  }
+
+  if (ps.reason != NULL) {
+    if (err != NULL) {
+      err->position = ps.error_pos;
+      err->reason = ps.reason;
+    }
+    memset(expr, 0, sizeof(*expr));
+    return HAL_ERROR;
+  }
+  if (err != NULL) {
+    err->position = 0;
+    err->reason = NULL;
+  }
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef triggerExpr_setRate(TriggerExpr_t *expr,
+                                      uint32_t frame_rate_hz) {
+  if (expr == NULL || frame_rate_hz == 0U) {
+    return HAL_ERROR;
+  }
+  expr->hold_frames =
+      (uint32_t)(((uint64_t)expr->hold_ms * frame_rate_hz + 999U) / 1000U);
+  return HAL_OK;
+}
+
+void triggerExpr_reset(TriggerExpr_t *expr) {
+  if (expr == NULL) {
+    return;
+  }
+  expr->true_frames = 0;
+  expr->latched = 0;
+}
+
+ADC_FAST_CODE uint8_t triggerExpr_evaluate(const TriggerExpr_t *expr,
+                                           const ADC_ChannelStats_t *stats) {
+  if (expr == NULL || stats == NULL || expr->op_count == 0U) {
+    return 0;
+  }
+  // Bit 0 is the top; the compiler only emits well-formed programs
+  uint32_t stack = 0;
+  for (uint8_t i = 0; i < expr->op_count; i++) {
+    const TriggerExpr_Op_t *op = &expr->ops[i];
+    uint32_t top = stack & 1U;
+    switch (op->code) {
+    case TRIGGER_EXPR_OP_AND:
+      stack >>= 1;
+      stack = (stack & ~1U) | (stack & top);
+      break;
+    case TRIGGER_EXPR_OP_OR:
+      stack >>= 1;
+      stack |= top;
+      break;
+    case TRIGGER_EXPR_OP_NOT:
+      stack ^= 1U;
+      break;
+    default: {
+      const float v = triggerExpr_feature(&stats[op->channel], op->feature);
+      const float t = op->threshold;
+      const uint8_t bit = (op->code == TRIGGER_EXPR_OP_GT)   ? (v > t)
+                          : (op->code == TRIGGER_EXPR_OP_GE) ? (v >= t)
+                          : (op->code == TRIGGER_EXPR_OP_LT) ? (v < t)
+                                                             : (v <= t);
+      stack = (stack << 1) | bit;
+      break;
+    }
+    }
+  }
+  return (uint8_t)(stack & 1U);
+}
+
+ADC_FAST_CODE uint8_t triggerExpr_step(TriggerExpr_t *expr,
+                                       const ADC_ChannelStats_t *stats,
+                                       uint32_t frames, uint32_t *offset) {
+  if (expr == NULL || offset == NULL) {
+    return 0;
+  }
+  expr->evaluations++;
+  if (!triggerExpr_evaluate(expr, stats)) {
+    expr->true_frames = 0;
+    expr->latched = 0;
+    return 0;
+  }
+  const uint32_t before = expr->true_frames;
+  expr->true_frames =
+      (before > UINT32_MAX - frames) ? UINT32_MAX : before + frames;
+  if (expr->latched || expr->true_frames < expr->hold_frames) {
+    return 0;
+  }
+  // The block is judged whole: the hold is reached inside it
+  const uint32_t need =
+      (expr->hold_frames > before) ? expr->hold_frames - before : 0U;
+  *offset = (need != 0U) ? need - 1U : 0U;
+  expr->latched = 1;
+  expr->fired++;
+  return 1;
+}
@@ -0,0 +1,698 @@
+/**
+ ******************************************************************************
+ * @file    usb_msc.c
+ * @brief   Implementation of the USB mass storage mode
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "usb_msc.h"
+#include "adc_sections.h"
+#include "fat_view.h"
+#include "sd_logger.h"
+#include "usb_stream.h"
+#include <string.h>
+
+#if USB_MSC_ENABLE
+
+/* Private defines -----------------------------------------------------------*/
+#define MSC_CBW_SIGNATURE 0x43425355U // "USBC"
+#define MSC_CSW_SIGNATURE 0x53425355U // "USBS"
+#define MSC_CBW_SIZE 31U
+#define MSC_CSW_SIZE 13U
+#define MSC_PACKET_SIZE 64U
+
+/* Bulk-Only class requests */
+#define MSC_REQ_GET_MAX_LUN 0xFEU
+#define MSC_REQ_RESET 0xFFU
+
+#define MSC_CSW_PASSED 0x00U
+#define MSC_CSW_FAILED 0x01U
+
+/* SCSI operation codes */
+#define SCSI_TEST_UNIT_READY 0x00U
+#define SCSI_REQUEST_SENSE 0x03U
+#define SCSI_FORMAT_UNIT 0x04U
+#define SCSI_WRITE_6 0x0AU
+#define SCSI_INQUIRY 0x12U
+#define SCSI_MODE_SENSE_6 0x1AU
+#define SCSI_START_STOP_UNIT 0x1BU
+#define SCSI_ALLOW_REMOVAL 0x1EU
+#define SCSI_READ_FORMAT_CAPACITIES 0x23U
+#define SCSI_READ_CAPACITY_10 0x25U
+#define SCSI_READ_10 0x28U
+#define SCSI_WRITE_10 0x2AU
+#define SCSI_VERIFY_10 0x2FU
+#define SCSI_SYNCHRONIZE_CACHE 0x35U
+#define SCSI_MODE_SENSE_10 0x5AU
+#define SCSI_WRITE_12 0xAAU
+
+/* Sense keys and their additional codes */
+#define SENSE_NOT_READY 0x02U
+#define SENSE_MEDIUM_ERROR 0x03U
+#define SENSE_ILLEGAL_REQUEST 0x05U
+#define SENSE_DATA_PROTECT 0x07U
+#define ASC_UNRECOVERED_READ 0x11U
+#define ASC_INVALID_COMMAND 0x20U
+#define ASC_LBA_OUT_OF_RANGE 0x21U
+#define ASC_INVALID_FIELD 0x24U
+#define ASC_WRITE_PROTECTED 0x27U
+#define ASC_MEDIUM_NOT_PRESENT 0x3AU
+
+#define MSC_BUFFER_BYTES (USB_MSC_BUFFER_SECTORS * FAT_VIEW_SECTOR_SIZE)
+
+_Static_assert(MSC_BUFFER_BYTES <= 0xFFFFU,
+               "a buffer is one bulk transfer of at most 64 kB");
+
+/* Private types -------------------------------------------------------------*/
+
+typedef enum {
+  MSC_IDLE = 0, ///< Waiting for a CBW
+  MSC_DATA_IN,  ///< Short reply on the bus
+  MSC_READ,     ///< Read pipeline running
+  MSC_STALL_IN, ///< IN stalled, the CSW follows the host's clear
+  MSC_CSW,      ///< CSW on the bus
+  MSC_RECOVERY  ///< Invalid CBW: both stalled until a Bulk-Only reset
+} Msc_Phase_t;
+
+typedef enum {
+  BUF_FREE = 0,
+  BUF_FILLING, ///< Card read into it
+  BUF_FULL,
+  BUF_SENDING  ///< On the bulk IN endpoint
+} Msc_Buffer_t;
+
+/* Private variables ---------------------------------------------------------*/
+
+/* ST's VID with the PID of its mass storage example */
+static const uint8_t device_desc[18] = {
+    0x12, 0x01, 0x00, 0x02, // device, USB 2.0
+    0x00, 0x00, 0x00,       // class per interface
+    MSC_PACKET_SIZE, 0x83, 0x04, // VID 0x0483
+    0x20, 0x57,                  // PID 0x5720
+    0x00, 0x02,                  // bcdDevice 2.00
+    1, 2, 3,                     // manufacturer, product, serial
+    1};
+
+static const uint8_t config_desc[32] = {
+    // Configuration: 1 interface, bus powered, 100 mA
+    0x09, 0x02, 32, 0x00, 0x01, 0x01, 0x00, 0x80, 0x32,
+    // Interface 0: mass storage, SCSI transparent, Bulk-Only
+    0x09, 0x04, 0x00, 0x00, 0x02, 0x08, 0x06, 0x50, 0x00,
+    0x07, 0x05, USB_STREAM_EP_IN, 0x02, MSC_PACKET_SIZE, 0x00, 0x00,
+    0x07, 0x05, USB_STREAM_EP_OUT, 0x02, MSC_PACKET_SIZE, 0x00, 0x00};
+
+static const uint8_t inquiry_data[36] = {
+    0x00, 0x80, 0x02, 0x02, 31, 0x00, 0x00, 0x00, // disk, removable
+    'A', 'D', 'C', '6', 'C', 'H', ' ', ' ',       // vendor
+    'S', 'D', ' ', 'r', 'e', 'c', 'o', 'r',       // product
+    'd', 'i', 'n', 'g', ' ', ' ', ' ', ' ',
+    '1', '.', '0', '0'};
+
+static void usbMsc_configured(uint8_t on);
+static HAL_StatusTypeDef usbMsc_request(const uint8_t *setup,
+                                        const uint8_t **reply, uint16_t *len);
+static void usbMsc_dataIn(void);
+static void usbMsc_dataOut(uint16_t len);
+static void usbMsc_haltCleared(uint8_t ep);
+
+static const UsbStream_Function_t msc_function = {
+    .device_desc = device_desc,
+    .config_desc = config_desc,
+    .product = "ADC_6_channels SD drive",
+    .configured = usbMsc_configured,
+    .request = usbMsc_request,
+    .data_in = usbMsc_dataIn,
+    .data_out = usbMsc_dataOut,
+    .halt_cleared = usbMsc_haltCleared};
+
+static FatView_t view;
+static uint8_t index_sector[FAT_VIEW_SECTOR_SIZE];
+static uint8_t active = 0;
+static uint8_t ejected = 0;
+
+/* Set by the OTG FS interrupt, taken by usbMsc_poll() */
+static uint8_t cbw[MSC_PACKET_SIZE] __ALIGNED(4);
+static volatile uint16_t cbw_len = 0;
+static volatile uint8_t cbw_ready = 0;
+static volatile uint8_t in_busy = 0;
+static volatile uint8_t in_cleared = 0;
+static volatile uint8_t reset_pending = 0;
+static volatile uint8_t usb_configured = 0;
+
+/* Command in progress */
+static Msc_Phase_t phase = MSC_IDLE;
+static uint32_t tag = 0;
+static uint32_t data_length = 0; // dCBWDataTransferLength
+static uint8_t data_in = 0;      // the host expects IN data
+static uint32_t residue = 0;
+static uint8_t csw_status = MSC_CSW_PASSED;
+static uint8_t sense_key = 0;
+static uint8_t sense_asc = 0;
+static uint8_t reply[MSC_PACKET_SIZE] __ALIGNED(4);
+static uint8_t csw[MSC_CSW_SIZE] __ALIGNED(4);
+
+/* Read pipeline: filled and sent in turn */
+static uint8_t buffers[2][MSC_BUFFER_BYTES] ADC_DMA_ALIGNED;
+static Msc_Buffer_t buf_state[2];
+static uint32_t buf_sectors[2];
+static uint8_t fill_next = 0;
+static uint8_t send_next = 0;
+static uint32_t read_lba = 0;
+static uint32_t fill_left = 0;
+static uint32_t send_left = 0;
+static uint32_t read_total = 0;
+
+static UsbMsc_Stats_t stats;
+
+/* Private functions ---------------------------------------------------------*/
+
+static uint32_t usbMsc_get32(const uint8_t *p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) |
+         ((uint32_t)p[3] << 24);
+}
+
+static void usbMsc_put32(uint8_t *p, uint32_t v) {
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+  p[2] = (uint8_t)(v >> 16);
+  p[3] = (uint8_t)(v >> 24);
+}
+
+static uint32_t usbMsc_getBe32(const uint8_t *p) {
+  return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+         ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+static void usbMsc_putBe32(uint8_t *p, uint32_t v) {
+  p[0] = (uint8_t)(v >> 24);
+  p[1] = (uint8_t)(v >> 16);
+  p[2] = (uint8_t)(v >> 8);
+  p[3] = (uint8_t)v;
+}
+
+static void usbMsc_armCbw(void) {
+  phase = MSC_IDLE;
+  (void)usbStream_bulkReceive(cbw, MSC_PACKET_SIZE);
+}
+
+static void usbMsc_sendCsw(void) {
+  usbMsc_put32(&csw[0], MSC_CSW_SIGNATURE);
+  usbMsc_put32(&csw[4], tag);
+  usbMsc_put32(&csw[8], residue);
+  csw[12] = csw_status;
+  phase = MSC_CSW;
+  in_busy = 1;
+  if (usbStream_bulkTransmit(csw, MSC_CSW_SIZE) != HAL_OK) {
+    in_busy = 0;
+  }
+}
+
+/**
+ * @brief Command done without a data stage: the CSW, after a stall of
+ *        the stage the host still expects
+ */
+static void usbMsc_finish(void) {
+  if (residue != 0U && data_in) {
+    usbStream_bulkStall(USB_STREAM_EP_IN);
+    phase = MSC_STALL_IN;
+    return;
+  }
+  if (residue != 0U) {
+    usbStream_bulkStall(USB_STREAM_EP_OUT); // Bulk-Only lets the CSW go
+  }
+  usbMsc_sendCsw();
+}
+
+/**
+ * @brief Check condition: the sense for REQUEST SENSE, a failed CSW
+ */
+static void usbMsc_fail(uint8_t key, uint8_t asc) {
+  sense_key = key;
+  sense_asc = asc;
+  csw_status = MSC_CSW_FAILED;
+  stats.failed++;
+  usbMsc_finish();
+}
+
+/**
+ * @brief Short reply, cut to what the host asked for
+ */
+static void usbMsc_reply(const uint8_t *data, uint32_t len) {
+  if (!data_in || data_length == 0U) {
+    usbMsc_finish();
+    return;
+  }
+  const uint32_t n = (len < data_length) ? len : data_length;
+  memcpy(reply, data, n);
+  residue = data_length - n;
+  phase = MSC_DATA_IN;
+  in_busy = 1;
+  if (usbStream_bulkTransmit(reply, (uint16_t)n) != HAL_OK) {
+    in_busy = 0;
+  }
+}
+
+/**
+ * @brief READ(10): start the pipeline
+ */
+static void usbMsc_startRead(const uint8_t *cb) {
+  const uint32_t lba = usbMsc_getBe32(&cb[2]);
+  const uint32_t count = ((uint32_t)cb[7] << 8) | cb[8];
+
+  if (ejected) {
+    usbMsc_fail(SENSE_NOT_READY, ASC_MEDIUM_NOT_PRESENT);
+    return;
+  }
+  if (lba >= view.total_sectors || count > view.total_sectors - lba) {
+    usbMsc_fail(SENSE_ILLEGAL_REQUEST, ASC_LBA_OUT_OF_RANGE);
+    return;
+  }
+  if (!data_in || data_length / FAT_VIEW_SECTOR_SIZE < count) {
+    usbMsc_fail(SENSE_ILLEGAL_REQUEST, ASC_INVALID_FIELD);
+    return;
+  }
+  if (count == 0U) {
+    usbMsc_finish();
+    return;
+  }
+  read_lba = lba;
+  fill_left = count;
+  send_left = count;
+  read_total = count;
+  fill_next = 0;
+  send_next = 0;
+  buf_state[0] = BUF_FREE;
+  buf_state[1] = BUF_FREE;
+  residue = data_length - count * FAT_VIEW_SECTOR_SIZE;
+  phase = MSC_READ;
+  // The first buffer starts now; usbMsc_poll() keeps it going
+}
+
+/**
+ * @brief The card read in flight, if any, has ended
+ *
+ * @return HAL_StatusTypeDef HAL_BUSY while it runs
+ */
+static HAL_StatusTypeDef usbMsc_settleRead(void) {
+  for (uint8_t b = 0; b < 2U; b++) {
+    if (buf_state[b] == BUF_FILLING) {
+      if (sdLogger_pollRead() == HAL_BUSY) {
+        return HAL_BUSY;
+      }
+      buf_state[b] = BUF_FREE;
+    }
+  }
+  return HAL_OK;
+}
+
+/**
+ * @brief Read failed part way: what was sent stays sent
+ */
+static void usbMsc_abortRead(void) {
+  const uint32_t sent = read_total - send_left;
+  residue = data_length - sent * FAT_VIEW_SECTOR_SIZE;
+  if (in_busy) {
+    usbStream_bulkAbort();
+    in_busy = 0;
+  }
+  buf_state[0] = BUF_FREE;
+  buf_state[1] = BUF_FREE;
+  fill_left = 0;
+  stats.read_errors++;
+  usbMsc_fail(SENSE_MEDIUM_ERROR, ASC_UNRECOVERED_READ);
+}
+
+/**
+ * @brief One step of the pipeline: card read ended, buffer sent, next
+ *        fill, next send
+ */
+static void usbMsc_pollRead(void) {
+  uint8_t b = fill_next ^ 1U;
+  if (buf_state[b] != BUF_FILLING) {
+    b = fill_next; // only one read in flight
+  }
+  if (buf_state[b] == BUF_FILLING) {
+    const HAL_StatusTypeDef status = sdLogger_pollRead();
+    if (status == HAL_ERROR) {
+      usbMsc_abortRead();
+      return;
+    }
+    if (status == HAL_OK) {
+      buf_state[b] = BUF_FULL;
+      stats.card_reads++;
+    }
+  }
+
+  if (buf_state[send_next] == BUF_SENDING && !in_busy) {
+    stats.sectors_sent += buf_sectors[send_next];
+    send_left -= buf_sectors[send_next];
+    buf_state[send_next] = BUF_FREE;
+    send_next ^= 1U;
+    if (send_left == 0U) {
+      usbMsc_sendCsw();
+      return;
+    }
+  }
+
+  const uint8_t card_busy = (buf_state[0] == BUF_FILLING ||
+                             buf_state[1] == BUF_FILLING);
+  if (fill_left != 0U && buf_state[fill_next] == BUF_FREE && !card_busy) {
+    uint8_t *dst = buffers[fill_next];
+    uint32_t card = FAT_VIEW_SYNTH;
+    const uint32_t want = (fill_left < USB_MSC_BUFFER_SECTORS)
+                              ? fill_left
+                              : USB_MSC_BUFFER_SECTORS;
+    const uint32_t n = fatView_map(&view, read_lba, want, &card);
+    if (card == FAT_VIEW_SYNTH) {
+      for (uint32_t i = 0; i < n; i++) {
+        fatView_read(&view, read_lba + i, &dst[i * FAT_VIEW_SECTOR_SIZE]);
+      }
+      buf_state[fill_next] = BUF_FULL;
+    } else {
+      const HAL_StatusTypeDef status = sdLogger_read(dst, card, n);
+      if (status == HAL_BUSY) {
+        return; // the card is still programming: next pass
+      }
+      if (status != HAL_OK) {
+        usbMsc_abortRead();
+        return;
+      }
+      buf_state[fill_next] = BUF_FILLING;
+    }
+    buf_sectors[fill_next] = n;
+    read_lba += n;
+    fill_left -= n;
+    fill_next ^= 1U;
+  }
+
+  if (buf_state[send_next] == BUF_FULL && !in_busy) {
+    buf_state[send_next] = BUF_SENDING;
+    in_busy = 1;
+    if (usbStream_bulkTransmit(
+            buffers[send_next],
+            (uint16_t)(buf_sectors[send_next] * FAT_VIEW_SECTOR_SIZE)) !=
+        HAL_OK) {
+      in_busy = 0;
+    }
+  }
+}
+
+/**
+ * @brief Decode a CBW and run its SCSI command
+ */
+static void usbMsc_command(void) {
+  const uint8_t *cb = &cbw[15];
+  uint8_t data[18] = {0};
+
+  if (cbw_len != MSC_CBW_SIZE || usbMsc_get32(cbw) != MSC_CBW_SIGNATURE ||
+      cbw[13] != 0U || cbw[14] == 0U || cbw[14] > 16U) {
+    // Not meaningful: the host must reset the interface
+    stats.resets++;
+    usbStream_bulkStall(USB_STREAM_EP_IN);
+    usbStream_bulkStall(USB_STREAM_EP_OUT);
+    phase = MSC_RECOVERY;
+    return;
+  }
+  tag = usbMsc_get32(&cbw[4]);
+  data_length = usbMsc_get32(&cbw[8]);
+  data_in = (cbw[12] & 0x80U) ? 1U : 0U;
+  residue = data_length;
+  csw_status = MSC_CSW_PASSED;
+  stats.commands++;
+
+  switch (cb[0]) {
+  case SCSI_TEST_UNIT_READY:
+    if (ejected) {
+      usbMsc_fail(SENSE_NOT_READY, ASC_MEDIUM_NOT_PRESENT);
+    } else {
+      usbMsc_finish();
+    }
+    return;
+  case SCSI_REQUEST_SENSE:
+    data[0] = 0x70U; // current error, fixed format
+    data[2] = sense_key;
+    data[7] = 10U;
+    data[12] = sense_asc;
+    sense_key = 0;
+    sense_asc = 0;
+    usbMsc_reply(data, 18U);
+    return;
+  case SCSI_INQUIRY:
+    if ((cb[1] & 0x01U) != 0U) {
+      usbMsc_fail(SENSE_ILLEGAL_REQUEST, ASC_INVALID_FIELD); // no VPD pages
+    } else {
+      usbMsc_reply(inquiry_data, sizeof(inquiry_data));
+    }
+    return;
+  case SCSI_MODE_SENSE_6:
+    data[0] = 3U;     // bytes after this one
+    data[2] = 0x80U;  // write-protected
+    usbMsc_reply(data, 4U);
+    return;
+  case SCSI_MODE_SENSE_10:
+    data[1] = 6U;
+    data[3] = 0x80U;
+    usbMsc_reply(data, 8U);
+    return;
+  case SCSI_READ_FORMAT_CAPACITIES:
+    data[3] = 8U; // one descriptor
+    usbMsc_putBe32(&data[4], view.total_sectors);
+    data[8] = 0x02U; // formatted
+    data[10] = (uint8_t)(FAT_VIEW_SECTOR_SIZE >> 8);
+    usbMsc_reply(data, 12U);
+    return;
+  case SCSI_READ_CAPACITY_10:
+    usbMsc_putBe32(&data[0], view.total_sectors - 1U);
+    usbMsc_putBe32(&data[4], FAT_VIEW_SECTOR_SIZE);
+    usbMsc_reply(data, 8U);
+    return;
+  case SCSI_READ_10:
+    usbMsc_startRead(cb);
+    return;
+  case SCSI_START_STOP_UNIT:
+    if ((cb[4] & 0x03U) == 0x02U) {
+      ejected = 1; // LoEj without Start
+    }
+    usbMsc_finish();
+    return;
+  case SCSI_ALLOW_REMOVAL:
+  case SCSI_VERIFY_10:
+  case SCSI_SYNCHRONIZE_CACHE:
+    usbMsc_finish();
+    return;
+  case SCSI_FORMAT_UNIT:
+  case SCSI_WRITE_6:
+  case SCSI_WRITE_10:
+  case SCSI_WRITE_12:
+    usbMsc_fail(SENSE_DATA_PROTECT, ASC_WRITE_PROTECTED);
+    return;
+  default:
+    usbMsc_fail(SENSE_ILLEGAL_REQUEST, ASC_INVALID_COMMAND);
+    return;
+  }
+}
+
+/* USB function callbacks (OTG FS interrupt) ---------------------------------*/
+
+static void usbMsc_configured(uint8_t on) {
+  usb_configured = on;
+  reset_pending = 1;
+}
+
+static HAL_StatusTypeDef usbMsc_request(const uint8_t *setup,
+                                        const uint8_t **reply_data,
+                                        uint16_t *len) {
+  static const uint8_t max_lun = 0;
+  switch (setup[1]) {
+  case MSC_REQ_RESET:
+    stats.resets++;
+    reset_pending = 1;
+    *len = 0;
+    return HAL_OK;
+  case MSC_REQ_GET_MAX_LUN:
+    *reply_data = &max_lun;
+    *len = 1U;
+    return HAL_OK;
+  default:
+    return HAL_ERROR;
+  }
+}
+
+static void usbMsc_dataIn(void) { in_busy = 0; }
+
+static void usbMsc_dataOut(uint16_t len) {
+  cbw_len = len;
+  cbw_ready = 1;
+}
+
+static void usbMsc_haltCleared(uint8_t ep) {
+  if (ep == USB_STREAM_EP_IN) {
+    in_cleared = 1;
+  }
+}
+
+#endif /* USB_MSC_ENABLE */
+
+/* Public functions ----------------------------------------------------------*/
+
+HAL_StatusTypeDef usbMsc_start(void) {
+#if USB_MSC_ENABLE
+  SdLogger_Index_t idx;
+
+  if (active) {
+    return HAL_BUSY;
+  }
+  if (sdLogger_getIndex(&idx) != HAL_OK) {
+    return HAL_ERROR;
+  }
+  const HAL_StatusTypeDef status = sdLogger_openReader();
+  if (status != HAL_OK) {
+    return status;
+  }
+
+  memset(index_sector, 0, sizeof(index_sector));
+  memcpy(index_sector, &idx, sizeof(idx));
+  const FatView_Config_t cfg = {
+      .data_lba = idx.data_lba,
+      .data_sectors = idx.records * idx.record_sectors,
+      .region_sectors = idx.capacity * idx.record_sectors,
+      .serial = idx.session,
+      .index = index_sector};
+  if (fatView_init(&view, &cfg) != HAL_OK) {
+    (void)sdLogger_closeReader();
+    return HAL_ERROR;
+  }
+
+  memset(&stats, 0, sizeof(stats));
+  stats.volume_sectors = view.total_sectors;
+  stats.file_sectors = view.cfg.data_sectors;
+  ejected = 0;
+  phase = MSC_IDLE;
+  buf_state[0] = BUF_FREE;
+  buf_state[1] = BUF_FREE;
+  sense_key = 0;
+  sense_asc = 0;
+  cbw_ready = 0;
+  in_busy = 0;
+  in_cleared = 0;
+  reset_pending = 0;
+  usb_configured = 0;
+  active = 1;
+  if (usbStream_setFunction(&msc_function) != HAL_OK) {
+    active = 0;
+    (void)sdLogger_closeReader();
+    return HAL_ERROR;
+  }
+  return HAL_OK;
+#else
+  return HAL_ERROR;
+#endif
+}
+
+void usbMsc_stop(void) {
+#if USB_MSC_ENABLE
+  if (!active) {
+    return;
+  }
+  (void)usbStream_setFunction(NULL);
+  // A card read still running must end before the recorder writes again
+  while (usbMsc_settleRead() == HAL_BUSY) {
+  }
+  (void)sdLogger_closeReader();
+  active = 0;
+#endif
+}
+
+void usbMsc_poll(void) {
+#if USB_MSC_ENABLE
+  if (!active) {
+    return;
+  }
+  if (reset_pending) {
+    // Bus reset, new configuration or Bulk-Only reset: drop the command
+    if (usbMsc_settleRead() == HAL_BUSY) {
+      return;
+    }
+    reset_pending = 0;
+    if (in_busy) {
+      usbStream_bulkAbort();
+      in_busy = 0;
+    }
+    cbw_ready = 0;
+    in_cleared = 0;
+    if (usb_configured) {
+      usbMsc_armCbw();
+    } else {
+      phase = MSC_IDLE;
+    }
+    return;
+  }
+
+  switch (phase) {
+  case MSC_IDLE:
+    if (cbw_ready) {
+      cbw_ready = 0;
+      usbMsc_command();
+    }
+    break;
+  case MSC_DATA_IN:
+    if (!in_busy) {
+      usbMsc_sendCsw();
+    }
+    break;
+  case MSC_READ:
+    // Twice: a buffer just sent frees the fill of the next one
+    usbMsc_pollRead();
+    if (phase == MSC_READ) {
+      usbMsc_pollRead();
+    }
+    break;
+  case MSC_STALL_IN:
+    if (in_cleared) {
+      in_cleared = 0;
+      usbMsc_sendCsw();
+    }
+    break;
+  case MSC_CSW:
+    if (!in_busy) {
+      usbMsc_armCbw();
+    }
+    break;
+  case MSC_RECOVERY:
+  default:
+    break; // until the host's reset
+  }
+#endif
+}
+
+uint8_t usbMsc_isActive(void) {
+#if USB_MSC_ENABLE
+  return active;
+#else
+  return 0;
+#endif
+}
+
+uint8_t usbMsc_isEjected(void) {
+#if USB_MSC_ENABLE
+  return active && ejected;
+#else
+  return 0;
+#endif
+}
+
+HAL_StatusTypeDef usbMsc_getStats(UsbMsc_Stats_t *out) {
+  if (out == NULL) {
+    return HAL_ERROR;
+  }
+#if USB_MSC_ENABLE
+  *out = stats;
+  out->active = active;
+  out->ejected = ejected;
+#else
+  memset(out, 0, sizeof(*out));
+#endif
+  return HAL_OK;
+}
@@ -0,0 +1,701 @@
+/**
+ ******************************************************************************
+ * @file    usb_stream.c
+ * @brief   Implementation of the USB OTG FS CDC-ACM streaming endpoint
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "usb_stream.h"
+#include "app_sched.h"
+#include "clock_profile.h"
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define USB_EP0_SIZE 64U
+#define USB_BULK_SIZE 64U  // full-speed bulk maximum
+#define USB_NOTIFY_SIZE 8U
+#define USB_EP_DATA_IN USB_STREAM_EP_IN
+#define USB_EP_DATA_OUT USB_STREAM_EP_OUT
+#define USB_EP_NOTIFY 0x82U
+
+/* bmRequestType: type and recipient fields */
+#define USB_REQ_TYPE_MASK 0x60U
+#define USB_REQ_TYPE_STANDARD 0x00U
+#define USB_REQ_TYPE_CLASS 0x20U
+#define USB_REQ_RECIPIENT_MASK 0x03U
+#define USB_REQ_RECIPIENT_ENDPOINT 0x02U
+
+/* Standard requests (USB 2.0, 9.4) */
+#define USB_REQ_GET_STATUS 0x00U
+#define USB_REQ_CLEAR_FEATURE 0x01U
+#define USB_REQ_SET_FEATURE 0x03U
+#define USB_REQ_SET_ADDRESS 0x05U
+#define USB_REQ_GET_DESCRIPTOR 0x06U
+#define USB_REQ_GET_CONFIGURATION 0x08U
+#define USB_REQ_SET_CONFIGURATION 0x09U
+#define USB_REQ_GET_INTERFACE 0x0AU
+#define USB_REQ_SET_INTERFACE 0x0BU
+
+/* CDC PSTN requests */
+#define CDC_SET_LINE_CODING 0x20U
+#define CDC_GET_LINE_CODING 0x21U
+#define CDC_SET_CONTROL_LINE_STATE 0x22U
+#define CDC_SEND_BREAK 0x23U
+#define CDC_LINE_CODING_SIZE 7U
+#define CDC_CONTROL_DTR 0x01U
+
+#define USB_DESC_DEVICE 0x01U
+#define USB_DESC_CONFIGURATION 0x02U
+#define USB_DESC_STRING 0x03U
+
+/* Words of the 1.25 kB OTG FS FIFO RAM: RX, EP0 IN, bulk IN, notify IN */
+#define USB_FIFO_RX_WORDS 0x80U
+#define USB_FIFO_EP0_WORDS 0x20U
+#define USB_FIFO_DATA_WORDS 0x80U
+#define USB_FIFO_NOTIFY_WORDS 0x10U
+
+/* NVIC priority shifted for BASEPRI, to mask the OTG FS interrupt only */
+#define USB_STREAM_BASEPRI (USB_STREAM_IRQ_PRIORITY << (8U - __NVIC_PRIO_BITS))
+
+_Static_assert(USB_FIFO_RX_WORDS + USB_FIFO_EP0_WORDS + USB_FIFO_DATA_WORDS +
+                       USB_FIFO_NOTIFY_WORDS <= 320U,
+               "OTG FS FIFO RAM is 320 words");
+
+/* Private types -------------------------------------------------------------*/
+
+typedef enum {
+  EP0_IDLE = 0,
+  EP0_DATA_IN,
+  EP0_DATA_OUT,
+  EP0_STATUS_IN,
+  EP0_STATUS_OUT
+} Ep0_State_t;
+
+/* Private variables ---------------------------------------------------------*/
+static PCD_HandleTypeDef hpcd_USB_OTG_FS;
+
+/* ST's VID with the PID of its virtual COM port example */
+static const uint8_t device_desc[18] = {
+    0x12, USB_DESC_DEVICE, 0x00, 0x02, // USB 2.0
+    0x02, 0x00, 0x00,                  // CDC at device level
+    USB_EP0_SIZE, 0x83, 0x04,          // VID 0x0483
+    0x40, 0x57,                        // PID 0x5740
+    0x00, 0x02,                        // bcdDevice 2.00
+    1, 2, 3,                           // manufacturer, product, serial
+    1};                                // one configuration
+
+static const uint8_t config_desc[67] = {
+    // Configuration: 2 interfaces, bus powered, 100 mA
+    0x09, USB_DESC_CONFIGURATION, 67, 0x00, 0x02, 0x01, 0x00, 0x80, 0x32,
+    // Interface 0: CDC communication, ACM, AT commands
+    0x09, 0x04, 0x00, 0x00, 0x01, 0x02, 0x02, 0x01, 0x00,
+    0x05, 0x24, 0x00, 0x10, 0x01,                        // header, CDC 1.10
+    0x05, 0x24, 0x01, 0x00, 0x01,                        // call management
+    0x04, 0x24, 0x02, 0x02,                              // ACM: line coding
+    0x05, 0x24, 0x06, 0x00, 0x01,                        // union 0 -> 1
+    0x07, 0x05, USB_EP_NOTIFY, 0x03, USB_NOTIFY_SIZE, 0x00, 0x10,
+    // Interface 1: CDC data, two bulk endpoints
+    0x09, 0x04, 0x01, 0x00, 0x02, 0x0A, 0x00, 0x00, 0x00,
+    0x07, 0x05, USB_EP_DATA_OUT, 0x02, USB_BULK_SIZE, 0x00, 0x00,
+    0x07, 0x05, USB_EP_DATA_IN, 0x02, USB_BULK_SIZE, 0x00, 0x00};
+
+static const uint8_t lang_desc[4] = {0x04, USB_DESC_STRING, 0x09, 0x04};
+static const char *const strings[] = {NULL, "ADC_6_channels",
+                                      "ADC_6_channels stream"};
+
+/* Control endpoint */
+static Ep0_State_t ep0_state = EP0_IDLE;
+static uint8_t ep0_buf[2U + 2U * 32U];  // built string descriptors
+static const uint8_t *ep0_data = NULL;
+static uint16_t ep0_remaining = 0;
+static uint8_t ep0_zlp = 0;
+static uint8_t line_coding[CDC_LINE_CODING_SIZE] = {0x00, 0xC2, 0x01, 0x00,
+                                                    0, 0, 8}; // 115200 8N1
+static uint8_t config_value = 0;
+static const UsbStream_Function_t *function = NULL; // NULL: CDC-ACM
+
+/* Bulk IN double buffer: tx_fill is written by the producer; tx_busy is set
+ * by the producer and cleared by the interrupt */
+static uint8_t tx_buf[2][USB_STREAM_BUFFER_SIZE] __ALIGNED(4);
+static uint16_t tx_len[2];
+static uint8_t tx_fill = 0;
+static uint16_t tx_reserved = 0;
+static uint16_t tx_inflight_len = 0;
+static volatile uint8_t tx_busy = 0;
+static volatile uint8_t tx_discard = 0; // port closed: producer drops data
+
+/* Bulk OUT: one packet, re-armed once read */
+static uint8_t rx_buf[USB_BULK_SIZE] __ALIGNED(4);
+static volatile uint16_t rx_len = 0;
+static volatile uint8_t rx_ready = 0;
+
+static volatile uint8_t port_open = 0;
+static volatile uint32_t bytes_sent = 0;
+static volatile uint32_t transfers = 0;
+static uint32_t dropped = 0;
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+ * @brief Build a UTF-16 string descriptor in ep0_buf
+ */
+static uint16_t usbStream_stringDesc(const char *s) {
+  uint16_t n = 0;
+  while (s[n] != '\0' && n < (sizeof(ep0_buf) - 2U) / 2U) {
+    ep0_buf[2U + 2U * n] = (uint8_t)s[n];
+    ep0_buf[3U + 2U * n] = 0;
+    n++;
+  }
+  ep0_buf[0] = (uint8_t)(2U + 2U * n);
+  ep0_buf[1] = USB_DESC_STRING;
+  return ep0_buf[0];
+}
+
+/**
+ * @brief Serial number string (hex device UID)
+ */
+static uint16_t usbStream_serialDesc(void) {
+  static const char hex[] = "0123456789ABCDEF";
+  char serial[25];
+  for (uint8_t w = 0; w < 3U; w++) {
+    uint32_t uid = *(const uint32_t *)(UID_BASE + 4U * w);
+    for (uint8_t d = 0; d < 8U; d++) {
+      serial[w * 8U + d] = hex[(uid >> (28U - 4U * d)) & 0xFU];
+    }
+  }
+  serial[24] = '\0';
+  return usbStream_stringDesc(serial);
+}
+
+static void usbStream_ep0Stall(void) {
+  HAL_PCD_EP_SetStall(&hpcd_USB_OTG_FS, 0x80U);
+  HAL_PCD_EP_SetStall(&hpcd_USB_OTG_FS, 0x00U);
+  ep0_state = EP0_IDLE;
+}
+
+static void usbStream_ep0Status(void) {
+  ep0_state = EP0_STATUS_IN;
+  HAL_PCD_EP_Transmit(&hpcd_USB_OTG_FS, 0x00U, NULL, 0U);
+}
+
+/**
+ * @brief Next EP0 IN packet (the core sends one packet per transfer on EP0)
+ */
+static void usbStream_ep0Continue(void) {
+  uint16_t chunk = (ep0_remaining > USB_EP0_SIZE) ? USB_EP0_SIZE
+                                                  : ep0_remaining;
+  HAL_PCD_EP_Transmit(&hpcd_USB_OTG_FS, 0x00U, (uint8_t *)ep0_data, chunk);
+  ep0_data += chunk;
+  ep0_remaining -= chunk;
+}
+
+static void usbStream_ep0Send(const uint8_t *data, uint16_t len,
+                              uint16_t w_length) {
+  if (len > w_length) {
+    len = w_length;
+  }
+  ep0_data = data;
+  ep0_remaining = len;
+  // A reply shorter than asked that ends on a full packet needs a ZLP
+  ep0_zlp = (len < w_length && (len % USB_EP0_SIZE) == 0U) ? 1U : 0U;
+  ep0_state = EP0_DATA_IN;
+  usbStream_ep0Continue();
+}
+
+/**
+ * @brief Port closed or bus reset: abandon the bulk IN transfer
+ */
+static void usbStream_closePort(void) {
+  port_open = 0;
+  if (tx_busy) {
+    HAL_PCD_EP_Abort(&hpcd_USB_OTG_FS, USB_EP_DATA_IN);
+    HAL_PCD_EP_Flush(&hpcd_USB_OTG_FS, USB_EP_DATA_IN);
+    tx_busy = 0;
+  }
+  tx_discard = 1;
+}
+
+/**
+ * @brief Configuration gone (reset, detach, SET_CONFIGURATION 0): the
+ *        function stops using its endpoints
+ */
+static void usbStream_unconfigure(void) {
+  usbStream_closePort();
+  if (config_value != 0U && function != NULL) {
+    function->configured(0);
+  }
+  config_value = 0;
+}
+
+static void usbStream_setConfiguration(uint8_t value) {
+  if (value == config_value) {
+    return;
+  }
+  if (config_value != 0U) {
+    usbStream_unconfigure();
+    HAL_PCD_EP_Close(&hpcd_USB_OTG_FS, USB_EP_DATA_IN);
+    HAL_PCD_EP_Close(&hpcd_USB_OTG_FS, USB_EP_DATA_OUT);
+    HAL_PCD_EP_Close(&hpcd_USB_OTG_FS, USB_EP_NOTIFY);
+  }
+  config_value = value;
+  if (value != 0U) {
+    HAL_PCD_EP_Open(&hpcd_USB_OTG_FS, USB_EP_DATA_IN, USB_BULK_SIZE,
+                    EP_TYPE_BULK);
+    HAL_PCD_EP_Open(&hpcd_USB_OTG_FS, USB_EP_DATA_OUT, USB_BULK_SIZE,
+                    EP_TYPE_BULK);
+    if (function != NULL) {
+      function->configured(1); // it arms its own OUT transfer
+      return;
+    }
+    HAL_PCD_EP_Open(&hpcd_USB_OTG_FS, USB_EP_NOTIFY, USB_NOTIFY_SIZE,
+                    EP_TYPE_INTR);
+    rx_ready = 0;
+    HAL_PCD_EP_Receive(&hpcd_USB_OTG_FS, USB_EP_DATA_OUT, rx_buf,
+                       USB_BULK_SIZE);
+  }
+}
+
+static void usbStream_getDescriptor(uint16_t w_value, uint16_t w_length) {
+  uint8_t index = (uint8_t)w_value;
+  const uint8_t *config = (function != NULL) ? function->config_desc
+                                             : config_desc;
+  switch (w_value >> 8) {
+  case USB_DESC_DEVICE:
+    usbStream_ep0Send((function != NULL) ? function->device_desc
+                                         : device_desc,
+                      sizeof(device_desc), w_length);
+    return;
+  case USB_DESC_CONFIGURATION:
+    usbStream_ep0Send(config, (uint16_t)(config[2] | (config[3] << 8)),
+                      w_length);
+    return;
+  case USB_DESC_STRING:
+    if (index == 0U) {
+      usbStream_ep0Send(lang_desc, sizeof(lang_desc), w_length);
+    } else if (index == 2U && function != NULL) {
+      usbStream_ep0Send(ep0_buf, usbStream_stringDesc(function->product),
+                        w_length);
+    } else if (index < sizeof(strings) / sizeof(strings[0])) {
+      usbStream_ep0Send(ep0_buf, usbStream_stringDesc(strings[index]),
+                        w_length);
+    } else if (index == 3U) {
+      usbStream_ep0Send(ep0_buf, usbStream_serialDesc(), w_length);
+    } else {
+      usbStream_ep0Stall();
+    }
+    return;
+  default:
+    // Device qualifier and others: full-speed only device
+    usbStream_ep0Stall();
+    return;
+  }
+}
+
+static void usbStream_standardRequest(const uint8_t *setup) {
+  uint16_t w_value = (uint16_t)(setup[2] | (setup[3] << 8));
+  uint16_t w_index = (uint16_t)(setup[4] | (setup[5] << 8));
+  uint16_t w_length = (uint16_t)(setup[6] | (setup[7] << 8));
+  static const uint8_t zeros[2] = {0, 0};
+
+  switch (setup[1]) {
+  case USB_REQ_GET_DESCRIPTOR:
+    usbStream_getDescriptor(w_value, w_length);
+    break;
+  case USB_REQ_SET_ADDRESS:
+    // The OTG core takes the address before the status stage
+    HAL_PCD_SetAddress(&hpcd_USB_OTG_FS, (uint8_t)(w_value & 0x7FU));
+    usbStream_ep0Status();
+    break;
+  case USB_REQ_SET_CONFIGURATION:
+    if (w_value > 1U) {
+      usbStream_ep0Stall();
+      break;
+    }
+    usbStream_setConfiguration((uint8_t)w_value);
+    usbStream_ep0Status();
+    break;
+  case USB_REQ_GET_CONFIGURATION:
+    usbStream_ep0Send(&config_value, 1U, w_length);
+    break;
+  case USB_REQ_GET_STATUS:
+  case USB_REQ_GET_INTERFACE:
+    usbStream_ep0Send(zeros, (setup[1] == USB_REQ_GET_STATUS) ? 2U : 1U,
+                      w_length);
+    break;
+  case USB_REQ_SET_INTERFACE:
+    usbStream_ep0Status();
+    break;
+  case USB_REQ_CLEAR_FEATURE:
+  case USB_REQ_SET_FEATURE:
+    if ((setup[0] & USB_REQ_RECIPIENT_MASK) == USB_REQ_RECIPIENT_ENDPOINT &&
+        (w_index & 0x7FU) != 0U) {
+      if (setup[1] == USB_REQ_SET_FEATURE) {
+        HAL_PCD_EP_SetStall(&hpcd_USB_OTG_FS, (uint8_t)w_index);
+      } else {
+        HAL_PCD_EP_ClrStall(&hpcd_USB_OTG_FS, (uint8_t)w_index);
+        if (function != NULL) {
+          function->halt_cleared((uint8_t)w_index);
+        }
+      }
+    }
+    usbStream_ep0Status();
+    break;
+  default:
+    usbStream_ep0Stall();
+    break;
+  }
+}
+
+static void usbStream_classRequest(const uint8_t *setup) {
+  uint16_t w_value = (uint16_t)(setup[2] | (setup[3] << 8));
+  uint16_t w_length = (uint16_t)(setup[6] | (setup[7] << 8));
+
+  switch (setup[1]) {
+  case CDC_SET_LINE_CODING:
+    // Accepted and echoed back; the bulk pipe has no baud rate
+    ep0_state = EP0_DATA_OUT;
+    HAL_PCD_EP_Receive(&hpcd_USB_OTG_FS, 0x00U, line_coding,
+                       (w_length < CDC_LINE_CODING_SIZE)
+                           ? w_length
+                           : CDC_LINE_CODING_SIZE);
+    break;
+  case CDC_GET_LINE_CODING:
+    usbStream_ep0Send(line_coding, CDC_LINE_CODING_SIZE, w_length);
+    break;
+  case CDC_SET_CONTROL_LINE_STATE:
+    if (w_value & CDC_CONTROL_DTR) {
+      port_open = 1;
+    } else {
+      usbStream_closePort();
+    }
+    usbStream_ep0Status();
+    break;
+  case CDC_SEND_BREAK:
+    usbStream_ep0Status();
+    break;
+  default:
+    usbStream_ep0Stall();
+    break;
+  }
+}
+
+/**
+ * @brief Class request of another function: its reply, or a stall
+ */
+static void usbStream_functionRequest(const uint8_t *setup) {
+  uint16_t w_length = (uint16_t)(setup[6] | (setup[7] << 8));
+  const uint8_t *reply = NULL;
+  uint16_t len = 0;
+
+  if (function->request(setup, &reply, &len) != HAL_OK) {
+    usbStream_ep0Stall();
+  } else if ((setup[0] & 0x80U) != 0U && w_length != 0U) {
+    usbStream_ep0Send(reply, len, w_length);
+  } else if (w_length == 0U) {
+    usbStream_ep0Status();
+  } else {
+    usbStream_ep0Stall(); // no function takes an OUT data stage
+  }
+}
+
+/* Public functions ----------------------------------------------------------*/
+
+HAL_StatusTypeDef usbStream_init(void) {
+  // PLLQ is 48 MHz in every clock profile, not in the CubeMX clock tree
+  if (clockProfile_getActive() == NULL) {
+    return HAL_ERROR;
+  }
+  RCC_PeriphCLKInitTypeDef clk = {0};
+  clk.PeriphClockSelection = RCC_PERIPHCLK_CLK48;
+  clk.Clk48ClockSelection = RCC_CLK48SOURCE_PLL;
+  if (HAL_RCCEx_PeriphCLKConfig(&clk) != HAL_OK) {
+    return HAL_ERROR;
+  }
+
+  hpcd_USB_OTG_FS.Instance = USB_OTG_FS;
+  hpcd_USB_OTG_FS.Init.dev_endpoints = 6;
+  hpcd_USB_OTG_FS.Init.speed = PCD_SPEED_FULL;
+  hpcd_USB_OTG_FS.Init.dma_enable = DISABLE;
+  hpcd_USB_OTG_FS.Init.phy_itface = PCD_PHY_EMBEDDED;
+  hpcd_USB_OTG_FS.Init.Sof_enable = DISABLE;
+  hpcd_USB_OTG_FS.Init.low_power_enable = DISABLE;
+  hpcd_USB_OTG_FS.Init.lpm_enable = DISABLE;
+  hpcd_USB_OTG_FS.Init.vbus_sensing_enable = DISABLE; // PA9 left free
+  hpcd_USB_OTG_FS.Init.use_dedicated_ep1 = DISABLE;
+  if (HAL_PCD_Init(&hpcd_USB_OTG_FS) != HAL_OK) {
+    return HAL_ERROR;
+  }
+  HAL_PCDEx_SetRxFiFo(&hpcd_USB_OTG_FS, USB_FIFO_RX_WORDS);
+  HAL_PCDEx_SetTxFiFo(&hpcd_USB_OTG_FS, 0, USB_FIFO_EP0_WORDS);
+  HAL_PCDEx_SetTxFiFo(&hpcd_USB_OTG_FS, 1, USB_FIFO_DATA_WORDS);
+  HAL_PCDEx_SetTxFiFo(&hpcd_USB_OTG_FS, 2, USB_FIFO_NOTIFY_WORDS);
+
+  tx_len[0] = 0;
+  tx_len[1] = 0;
+  tx_fill = 0;
+  tx_busy = 0;
+  tx_discard = 0;
+  return HAL_PCD_Start(&hpcd_USB_OTG_FS);
+}
+
+uint8_t usbStream_isOpen(void) { return port_open; }
+
+uint8_t *usbStream_reserve(uint16_t max_len) {
+  if (tx_discard) {
+    tx_discard = 0;
+    tx_len[0] = 0;
+    tx_len[1] = 0;
+  }
+  if (!port_open || max_len > USB_STREAM_BUFFER_SIZE) {
+    return NULL;
+  }
+
+  if (tx_len[tx_fill] + max_len > USB_STREAM_BUFFER_SIZE) {
+    usbStream_poll();
+    if (tx_len[tx_fill] + max_len > USB_STREAM_BUFFER_SIZE) {
+      dropped++;
+      return NULL;
+    }
+  }
+  tx_reserved = max_len;
+  return &tx_buf[tx_fill][tx_len[tx_fill]];
+}
+
+void usbStream_commit(uint16_t len) {
+  // A close in between discards whatever was reserved
+  if (!tx_discard && len <= tx_reserved) {
+    tx_len[tx_fill] += len;
+  }
+  tx_reserved = 0;
+  usbStream_poll();
+}
+
+void usbStream_poll(void) {
+  if (tx_busy || tx_discard || tx_len[tx_fill] == 0U || !port_open) {
+    return;
+  }
+
+  uint32_t basepri = __get_BASEPRI();
+  __set_BASEPRI(USB_STREAM_BASEPRI);
+  __ISB();
+  if (port_open) {
+    tx_busy = 1;
+    tx_inflight_len = tx_len[tx_fill];
+    HAL_PCD_EP_Transmit(&hpcd_USB_OTG_FS, USB_EP_DATA_IN, tx_buf[tx_fill],
+                        tx_inflight_len);
+    tx_fill ^= 1U;
+    tx_len[tx_fill] = 0;
+  }
+  __set_BASEPRI(basepri);
+}
+
+uint16_t usbStream_read(uint8_t *buf, uint16_t cap) {
+  if (buf == NULL || !rx_ready) {
+    return 0;
+  }
+  uint16_t n = (rx_len < cap) ? rx_len : cap;
+  memcpy(buf, rx_buf, n);
+
+  uint32_t basepri = __get_BASEPRI();
+  __set_BASEPRI(USB_STREAM_BASEPRI);
+  __ISB();
+  rx_ready = 0;
+  if (config_value != 0U) {
+    HAL_PCD_EP_Receive(&hpcd_USB_OTG_FS, USB_EP_DATA_OUT, rx_buf,
+                       USB_BULK_SIZE);
+  }
+  __set_BASEPRI(basepri);
+  return n;
+}
+
+HAL_StatusTypeDef usbStream_getStats(UsbStream_Stats_t *stats) {
+  if (stats == NULL) {
+    return HAL_ERROR;
+  }
+  stats->bytes_sent = bytes_sent;
+  stats->transfers = transfers;
+  stats->dropped = dropped;
+  stats->configured = (config_value != 0U) ? 1U : 0U;
+  stats->open = port_open;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef usbStream_setFunction(const UsbStream_Function_t *fn) {
+  if (hpcd_USB_OTG_FS.Instance != USB_OTG_FS) {
+    return HAL_ERROR;
+  }
+  // Pull-up off: to the host the device is unplugged
+  HAL_PCD_DevDisconnect(&hpcd_USB_OTG_FS);
+  uint32_t basepri = __get_BASEPRI();
+  __set_BASEPRI(USB_STREAM_BASEPRI);
+  __ISB();
+  if (config_value != 0U) {
+    usbStream_unconfigure();
+    HAL_PCD_EP_Close(&hpcd_USB_OTG_FS, USB_EP_DATA_IN);
+    HAL_PCD_EP_Close(&hpcd_USB_OTG_FS, USB_EP_DATA_OUT);
+    HAL_PCD_EP_Close(&hpcd_USB_OTG_FS, USB_EP_NOTIFY);
+  }
+  function = fn;
+  __set_BASEPRI(basepri);
+
+  HAL_Delay(USB_STREAM_REATTACH_MS);
+  HAL_PCD_DevConnect(&hpcd_USB_OTG_FS); // the bus reset follows
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef usbStream_bulkTransmit(const uint8_t *buf, uint16_t len) {
+  if (function == NULL || config_value == 0U) {
+    return HAL_ERROR;
+  }
+  uint32_t basepri = __get_BASEPRI();
+  __set_BASEPRI(USB_STREAM_BASEPRI);
+  __ISB();
+  HAL_StatusTypeDef status = HAL_PCD_EP_Transmit(
+      &hpcd_USB_OTG_FS, USB_EP_DATA_IN, (uint8_t *)buf, len);
+  __set_BASEPRI(basepri);
+  return status;
+}
+
+HAL_StatusTypeDef usbStream_bulkReceive(uint8_t *buf, uint16_t len) {
+  if (function == NULL || config_value == 0U) {
+    return HAL_ERROR;
+  }
+  uint32_t basepri = __get_BASEPRI();
+  __set_BASEPRI(USB_STREAM_BASEPRI);
+  __ISB();
+  HAL_StatusTypeDef status =
+      HAL_PCD_EP_Receive(&hpcd_USB_OTG_FS, USB_EP_DATA_OUT, buf, len);
+  __set_BASEPRI(basepri);
+  return status;
+}
+
+void usbStream_bulkStall(uint8_t ep) {
+  if (function == NULL || config_value == 0U ||
+      (ep != USB_EP_DATA_IN && ep != USB_EP_DATA_OUT)) {
+    return;
+  }
+  uint32_t basepri = __get_BASEPRI();
+  __set_BASEPRI(USB_STREAM_BASEPRI);
+  __ISB();
+  HAL_PCD_EP_SetStall(&hpcd_USB_OTG_FS, ep);
+  __set_BASEPRI(basepri);
+}
+
+void usbStream_bulkAbort(void) {
+  if (function == NULL || config_value == 0U) {
+    return;
+  }
+  uint32_t basepri = __get_BASEPRI();
+  __set_BASEPRI(USB_STREAM_BASEPRI);
+  __ISB();
+  HAL_PCD_EP_Abort(&hpcd_USB_OTG_FS, USB_EP_DATA_IN);
+  HAL_PCD_EP_Flush(&hpcd_USB_OTG_FS, USB_EP_DATA_IN);
+  __set_BASEPRI(basepri);
+}
+
+void usbStream_irqHandler(void) { HAL_PCD_IRQHandler(&hpcd_USB_OTG_FS); }
+
+/* HAL callbacks -------------------------------------------------------------*/
+
+/**
+ * @brief OTG FS pins (PA11 DM, PA12 DP), clock and interrupt
+ */
+void HAL_PCD_MspInit(PCD_HandleTypeDef *hpcd) {
+  if (hpcd->Instance != USB_OTG_FS) {
+    return;
+  }
+  GPIO_InitTypeDef gpio = {0};
+  __HAL_RCC_GPIOA_CLK_ENABLE();
+  gpio.Pin = GPIO_PIN_11 | GPIO_PIN_12;
+  gpio.Mode = GPIO_MODE_AF_PP;
+  gpio.Pull = GPIO_NOPULL;
+  gpio.Speed = GPIO_SPEED_FREQ_VERY_HIGH;
+  gpio.Alternate = GPIO_AF10_OTG_FS;
+  HAL_GPIO_Init(GPIOA, &gpio);
+
+  __HAL_RCC_USB_OTG_FS_CLK_ENABLE();
+  HAL_NVIC_SetPriority(OTG_FS_IRQn, USB_STREAM_IRQ_PRIORITY, 0);
+  HAL_NVIC_EnableIRQ(OTG_FS_IRQn);
+}
+
+void HAL_PCD_ResetCallback(PCD_HandleTypeDef *hpcd) {
+  usbStream_unconfigure();
+  ep0_state = EP0_IDLE;
+  HAL_PCD_EP_Open(hpcd, 0x00U, USB_EP0_SIZE, EP_TYPE_CTRL);
+  HAL_PCD_EP_Open(hpcd, 0x80U, USB_EP0_SIZE, EP_TYPE_CTRL);
+}
+
+void HAL_PCD_SetupStageCallback(PCD_HandleTypeDef *hpcd) {
+  const uint8_t *setup = (const uint8_t *)hpcd->Setup;
+  ep0_state = EP0_IDLE;
+
+  switch (setup[0] & USB_REQ_TYPE_MASK) {
+  case USB_REQ_TYPE_STANDARD:
+    usbStream_standardRequest(setup);
+    break;
+  case USB_REQ_TYPE_CLASS:
+    if (function != NULL) {
+      usbStream_functionRequest(setup);
+    } else {
+      usbStream_classRequest(setup);
+    }
+    break;
+  default:
+    usbStream_ep0Stall();
+    break;
+  }
+}
+
+void HAL_PCD_DataInStageCallback(PCD_HandleTypeDef *hpcd, uint8_t epnum) {
+  if (epnum == (USB_EP_DATA_IN & 0x7FU) && function != NULL) {
+    function->data_in();
+    return;
+  }
+  if (epnum == (USB_EP_DATA_IN & 0x7FU)) {
+    bytes_sent += tx_inflight_len;
+    transfers++;
+    tx_busy = 0;
+    return;
+  }
+  if (epnum != 0U || ep0_state != EP0_DATA_IN) {
+    return;
+  }
+
+  if (ep0_remaining > 0U) {
+    usbStream_ep0Continue();
+  } else if (ep0_zlp) {
+    ep0_zlp = 0;
+    HAL_PCD_EP_Transmit(hpcd, 0x00U, NULL, 0U);
+  } else {
+    ep0_state = EP0_STATUS_OUT;
+    HAL_PCD_EP_Receive(hpcd, 0x00U, NULL, 0U);
+  }
+}
+
+void HAL_PCD_DataOutStageCallback(PCD_HandleTypeDef *hpcd, uint8_t epnum) {
+  if (epnum == USB_EP_DATA_OUT && function != NULL) {
+    function->data_out((uint16_t)HAL_PCD_EP_GetRxCount(hpcd, USB_EP_DATA_OUT));
+    return;
+  }
+  if (epnum == USB_EP_DATA_OUT) {
+    rx_len = (uint16_t)HAL_PCD_EP_GetRxCount(hpcd, USB_EP_DATA_OUT);
+    rx_ready = 1;
+    appSched_signal(APP_SCHED_EVENT_COMMAND);
+    return;
+  }
+  if (epnum == 0U && ep0_state == EP0_DATA_OUT) {
+    usbStream_ep0Status();
+  }
+}
+
+void HAL_PCD_SuspendCallback(PCD_HandleTypeDef *hpcd) {
+  UNUSED(hpcd);
+  usbStream_closePort();
+}
+
+void HAL_PCD_DisconnectCallback(PCD_HandleTypeDef *hpcd) {
+  UNUSED(hpcd);
+  usbStream_unconfigure();
+}
@@ -0,0 +1,572 @@
+/**
+ ******************************************************************************
+ * @file    wavelet_codec.c
+ * @brief   Implementation of the error-bounded 5/3 wavelet codec
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "wavelet_codec.h"
+#include "adc_sections.h"
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define WAVELET_CODEC_BITS 12U
+#define WAVELET_CODEC_MAX_CODE 4095
+#define WAVELET_CODEC_MIDSCALE 2048
+#define WAVELET_CODEC_MAX_LEVELS 7U
+#define WAVELET_CODEC_ESCAPE_BITS 18U
+#define WAVELET_CODEC_MAX_K 14U
+#define WAVELET_CODEC_EMPTY_BAND 15U
+#define WAVELET_CODEC_MAX_RUN_BITS 16U
+#define WAVELET_CODEC_MAX_COEF (1L << 20) // far past any 12-bit run's
+
+/* Private types -------------------------------------------------------------*/
+typedef struct {
+  uint8_t *p;
+  uint8_t *end;
+  uint32_t acc;
+  uint32_t bits; // pending bits in acc, < 8 between calls
+  uint8_t overrun;
+} WaveletCodec_Writer_t;
+
+typedef struct {
+  const uint8_t *p;
+  const uint8_t *end;
+  uint32_t acc;
+  uint32_t bits;
+  uint8_t overrun;
+} WaveletCodec_Reader_t;
+
+/* Private variables ---------------------------------------------------------*/
+static WaveletCodec_Stats_t stats_ = {0};
+
+/* Encoder work area: the run, its coefficients, one trial's codes and
+ * decoded run (then residual), and the two trials being compared */
+static uint16_t work_x[WAVELET_CODEC_MAX_SAMPLES];
+static int32_t work_coef[WAVELET_CODEC_MAX_SAMPLES];
+static int32_t work_codes[WAVELET_CODEC_MAX_SAMPLES];
+static int32_t work_rec[WAVELET_CODEC_MAX_SAMPLES];
+static uint8_t work_out[2][WAVELET_CODEC_MAX_BYTES(WAVELET_CODEC_MAX_SAMPLES)];
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+ * @brief Append n <= 25 bits, MSB first; past end only the overrun is kept
+ */
+static inline void waveletCodec_put(WaveletCodec_Writer_t *w, uint32_t value,
+                                    uint32_t n) {
+  w->acc = (w->acc << n) | value;
+  w->bits += n;
+  while (w->bits >= 8U) {
+    w->bits -= 8U;
+    if (w->p < w->end) {
+      *w->p++ = (uint8_t)(w->acc >> w->bits);
+    } else {
+      w->overrun = 1;
+    }
+  }
+}
+
+static inline uint32_t waveletCodec_get(WaveletCodec_Reader_t *r,
+                                        uint32_t n) {
+  while (r->bits < n) {
+    if (r->p >= r->end) {
+      r->overrun = 1;
+      return 0;
+    }
+    r->acc = (r->acc << 8) | *r->p++;
+    r->bits += 8U;
+  }
+  r->bits -= n;
+  return (r->acc >> r->bits) & ((1UL << n) - 1U);
+}
+
+static inline int32_t waveletCodec_clip(int32_t v) {
+  if (v < 0) {
+    return 0;
+  }
+  return (v > WAVELET_CODEC_MAX_CODE) ? WAVELET_CODEC_MAX_CODE : v;
+}
+
+/**
+ * @brief Levels a run of count samples takes: each halves an even length,
+ *        down to an approximation of two values at least
+ */
+static uint32_t waveletCodec_levels(uint32_t count) {
+  uint32_t levels = 0;
+  while (levels < WAVELET_CODEC_LEVELS &&
+         levels < WAVELET_CODEC_MAX_LEVELS &&
+         (count & ((2UL << levels) - 1U)) == 0U &&
+         (count >> (levels + 1U)) >= 2U) {
+    levels++;
+  }
+  return levels;
+}
+
+/**
+ * @brief One 5/3 analysis step on buf[0..m): s to the first half, d to the
+ *        second; m even
+ */
+static void waveletCodec_analyse(int32_t *buf, uint32_t m, int32_t *tmp) {
+  const uint32_t h = m / 2U;
+  for (uint32_t i = 0; i < h; i++) {
+    const int32_t right = (i + 1U < h) ? buf[2U * i + 2U] : buf[2U * i];
+    tmp[i] = buf[2U * i + 1U] - ((buf[2U * i] + right) >> 1);
+  }
+  // s[i] only reads even samples at or past 2i, not yet overwritten
+  for (uint32_t i = 0; i < h; i++) {
+    const int32_t left = (i > 0U) ? tmp[i - 1U] : tmp[0];
+    buf[i] = buf[2U * i] + ((left + tmp[i] + 2) >> 2);
+  }
+  memcpy(&buf[h], tmp, h * sizeof(int32_t));
+}
+
+/**
+ * @brief Inverse of waveletCodec_analyse()
+ */
+static void waveletCodec_synthesise(int32_t *buf, uint32_t m, int32_t *tmp) {
+  const uint32_t h = m / 2U;
+  memcpy(tmp, &buf[h], h * sizeof(int32_t));
+  // Backwards, so s[j] for j < i is still in place
+  for (uint32_t i = h; i-- > 0U;) {
+    const int32_t left = (i > 0U) ? tmp[i - 1U] : tmp[0];
+    buf[2U * i] = buf[i] - ((left + tmp[i] + 2) >> 2);
+  }
+  for (uint32_t i = 0; i < h; i++) {
+    const int32_t right = (i + 1U < h) ? buf[2U * i + 2U] : buf[2U * i];
+    buf[2U * i + 1U] = tmp[i] + ((buf[2U * i] + right) >> 1);
+  }
+}
+
+static void waveletCodec_forward(int32_t *buf, uint32_t count,
+                                 uint32_t levels) {
+  int32_t tmp[WAVELET_CODEC_MAX_SAMPLES / 2U];
+  for (uint32_t l = 0, m = count; l < levels; l++, m /= 2U) {
+    waveletCodec_analyse(buf, m, tmp);
+  }
+}
+
+static ADC_FAST_CODE void waveletCodec_inverse(int32_t *buf, uint32_t count,
+                                               uint32_t levels) {
+  int32_t tmp[WAVELET_CODEC_MAX_SAMPLES / 2U];
+  for (uint32_t m = count >> (levels - 1U); levels > 0U; levels--, m *= 2U) {
+    waveletCodec_synthesise(buf, m, tmp);
+  }
+}
+
+/**
+ * @brief Quantise: the approximation rounded, a detail through the dead zone
+ */
+static inline int32_t waveletCodec_quantise(int32_t c, uint8_t approx,
+                                            uint32_t shift) {
+  if (approx) {
+    return (c + (int32_t)((1UL << shift) >> 1)) >> shift;
+  }
+  const int32_t m = (int32_t)((uint32_t)((c < 0) ? -c : c) >> shift);
+  return (c < 0) ? -m : m;
+}
+
+/**
+ * @brief Value a quantised code stands for: the approximation's step, the
+ *        middle of a detail's interval (exact at shift 0)
+ */
+static inline int32_t waveletCodec_dequantise(int32_t q, uint8_t approx,
+                                              uint32_t shift) {
+  const int32_t step = (int32_t)(1UL << shift);
+  if (approx || q == 0) {
+    return q * step;
+  }
+  const int32_t half = step >> 1;
+  return (q < 0) ? q * step - half : q * step + half;
+}
+
+static inline uint32_t waveletCodec_zigzag(int32_t v) {
+  return (v >= 0) ? (uint32_t)v << 1 : ((uint32_t)(-v) << 1) - 1U;
+}
+
+/**
+ * @brief Zigzag of a value known to be nonzero, without the hole at 0
+ */
+static inline uint32_t waveletCodec_map(int32_t v) {
+  return (v < 0) ? ((uint32_t)(-v - 1) << 1) | 1U : (uint32_t)(v - 1) << 1;
+}
+
+/**
+ * @brief Exp-Golomb order 0: n zeros, then run + 1 in n + 1 bits
+ */
+static void waveletCodec_putRun(WaveletCodec_Writer_t *w, uint32_t run) {
+  const uint32_t v = run + 1U;
+  uint32_t n = 0;
+  while ((v >> (n + 1U)) != 0U) {
+    n++;
+  }
+  waveletCodec_put(w, 0U, n);
+  waveletCodec_put(w, v, n + 1U);
+}
+
+static uint32_t waveletCodec_getRun(WaveletCodec_Reader_t *r) {
+  uint32_t n = 0;
+  while (n <= WAVELET_CODEC_MAX_RUN_BITS && waveletCodec_get(r, 1U) == 0U &&
+         !r->overrun) {
+    n++;
+  }
+  if (n > WAVELET_CODEC_MAX_RUN_BITS) {
+    r->overrun = 1; // no run is that long: corrupt
+    return 0;
+  }
+  return ((1UL << n) | waveletCodec_get(r, n)) - 1U;
+}
+
+/**
+ * @brief Rice code of u, or the escape
+ */
+static inline void waveletCodec_putRice(WaveletCodec_Writer_t *w, uint32_t u,
+                                        uint32_t k) {
+  const uint32_t q = u >> k;
+  if (q < WAVELET_CODEC_ESCAPE) {
+    waveletCodec_put(w, ((1UL << q) - 1U) << 1, q + 1U);
+    waveletCodec_put(w, u & ((1UL << k) - 1U), k);
+  } else {
+    waveletCodec_put(w, (1UL << WAVELET_CODEC_ESCAPE) - 1U,
+                     WAVELET_CODEC_ESCAPE);
+    waveletCodec_put(w, u, WAVELET_CODEC_ESCAPE_BITS);
+  }
+}
+
+static inline uint32_t waveletCodec_riceBits(uint32_t u, uint32_t k) {
+  const uint32_t q = u >> k;
+  return (q < WAVELET_CODEC_ESCAPE)
+             ? q + 1U + k
+             : WAVELET_CODEC_ESCAPE + WAVELET_CODEC_ESCAPE_BITS;
+}
+
+static inline uint32_t waveletCodec_runBits(uint32_t run) {
+  uint32_t n = 0;
+  while (((run + 1U) >> (n + 1U)) != 0U) {
+    n++;
+  }
+  return 2U * n + 1U;
+}
+
+static inline uint32_t waveletCodec_riceK(uint32_t n, uint32_t sum) {
+  uint32_t k = 0;
+  while (k < WAVELET_CODEC_MAX_K && ((uint64_t)n << (k + 1U)) <= sum) {
+    k++;
+  }
+  return k;
+}
+
+/**
+ * @brief Code one band of values, densely (every value in Rice code) or
+ *        sparsely (zero runs and nonzero values), whichever is shorter
+ */
+static void waveletCodec_putBand(WaveletCodec_Writer_t *w, const int32_t *v,
+                                 uint32_t len) {
+  uint32_t nonzero = 0;
+  uint32_t sum_dense = 0;
+  uint32_t sum_sparse = 0;
+  for (uint32_t i = 0; i < len; i++) {
+    sum_dense += waveletCodec_zigzag(v[i]);
+    if (v[i] != 0) {
+      nonzero++;
+      sum_sparse += waveletCodec_map(v[i]);
+    }
+  }
+  if (nonzero == 0U) {
+    waveletCodec_put(w, WAVELET_CODEC_EMPTY_BAND, 4U);
+    return;
+  }
+
+  // Rice parameters: 2^k close to the mean value, then the exact sizes
+  const uint32_t k_dense = waveletCodec_riceK(len, sum_dense);
+  const uint32_t k_sparse = waveletCodec_riceK(nonzero, sum_sparse);
+  uint32_t bits_dense = 0;
+  uint32_t bits_sparse = 0;
+  uint32_t run = 0;
+  for (uint32_t i = 0; i < len; i++) {
+    bits_dense += waveletCodec_riceBits(waveletCodec_zigzag(v[i]), k_dense);
+    if (v[i] == 0) {
+      run++;
+      continue;
+    }
+    bits_sparse += waveletCodec_runBits(run) +
+                   waveletCodec_riceBits(waveletCodec_map(v[i]), k_sparse);
+    run = 0;
+  }
+  bits_sparse += (run != 0U) ? waveletCodec_runBits(run) : 0U;
+
+  if (bits_dense <= bits_sparse) {
+    waveletCodec_put(w, k_dense << 1, 5U);
+    for (uint32_t i = 0; i < len; i++) {
+      waveletCodec_putRice(w, waveletCodec_zigzag(v[i]), k_dense);
+    }
+    return;
+  }
+  waveletCodec_put(w, k_sparse << 1 | 1U, 5U);
+  run = 0;
+  for (uint32_t i = 0; i < len; i++) {
+    if (v[i] == 0) {
+      run++;
+      continue;
+    }
+    waveletCodec_putRun(w, run);
+    waveletCodec_putRice(w, waveletCodec_map(v[i]), k_sparse);
+    run = 0;
+  }
+  if (run != 0U) {
+    waveletCodec_putRun(w, run); // to the end of the band
+  }
+}
+
+static inline uint32_t waveletCodec_getRice(WaveletCodec_Reader_t *r,
+                                            uint32_t k) {
+  uint32_t q = 0;
+  while (q < WAVELET_CODEC_ESCAPE && waveletCodec_get(r, 1U) != 0U &&
+         !r->overrun) {
+    q++;
+  }
+  return (q < WAVELET_CODEC_ESCAPE)
+             ? (q << k) | waveletCodec_get(r, k)
+             : waveletCodec_get(r, WAVELET_CODEC_ESCAPE_BITS);
+}
+
+static void waveletCodec_getBand(WaveletCodec_Reader_t *r, int32_t *v,
+                                 uint32_t len) {
+  memset(v, 0, len * sizeof(int32_t));
+  const uint32_t k = waveletCodec_get(r, 4U);
+  if (k == WAVELET_CODEC_EMPTY_BAND) {
+    return;
+  }
+  if (k > WAVELET_CODEC_MAX_K) {
+    r->overrun = 1;
+    return;
+  }
+  if (waveletCodec_get(r, 1U) == 0U) {
+    for (uint32_t i = 0; i < len && !r->overrun; i++) {
+      const uint32_t u = waveletCodec_getRice(r, k);
+      v[i] = (u & 1U) ? -(int32_t)((u + 1U) >> 1) : (int32_t)(u >> 1);
+    }
+    return;
+  }
+  uint32_t pos = 0;
+  while (pos < len && !r->overrun) {
+    pos += waveletCodec_getRun(r);
+    if (pos >= len) {
+      r->overrun |= (pos > len);
+      return;
+    }
+    const uint32_t u = waveletCodec_getRice(r, k);
+    const int32_t m = (int32_t)(u >> 1) + 1;
+    v[pos++] = (u & 1U) ? -m : m;
+  }
+}
+
+/**
+ * @brief Code the run at one shift into out (at most cap bytes)
+ *
+ * @return Bytes written, 0 if they would not fit
+ */
+static uint32_t waveletCodec_trial(uint32_t count, uint32_t levels,
+                                   uint32_t shift, uint16_t max_error,
+                                   uint8_t *out, uint32_t cap,
+                                   uint32_t *zeroed) {
+  const uint32_t approx = count >> levels;
+  const int32_t step = 2 * (int32_t)max_error + 1;
+
+  // Wavelet layer: codes (the approximation as differences) and the run
+  // they decode to
+  int32_t prev = waveletCodec_quantise(WAVELET_CODEC_MIDSCALE, 1U, shift);
+  *zeroed = 0;
+  for (uint32_t i = 0; i < count; i++) {
+    const uint8_t a = (i < approx);
+    const int32_t q = waveletCodec_quantise(work_coef[i], a, shift);
+    *zeroed += (q == 0 && work_coef[i] != 0);
+    work_codes[i] = a ? q - prev : q;
+    prev = a ? q : prev;
+    work_rec[i] = waveletCodec_dequantise(q, a, shift);
+  }
+  if (levels > 0U) {
+    waveletCodec_inverse(work_rec, count, levels);
+  }
+  // Residual layer: what is left, in steps of 2 max_error + 1, rounded
+  for (uint32_t n = 0; n < count; n++) {
+    const int32_t e = (int32_t)work_x[n] - waveletCodec_clip(work_rec[n]);
+    const int32_t m = (((e < 0) ? -e : e) + (int32_t)max_error) / step;
+    work_rec[n] = (e < 0) ? -m : m;
+  }
+
+  WaveletCodec_Writer_t w = {.p = out, .end = out + cap};
+  *w.p++ = (uint8_t)(levels << 4 | shift);
+  waveletCodec_putBand(&w, work_codes, approx);
+  for (uint32_t l = levels; l > 0U; l--) {
+    waveletCodec_putBand(&w, &work_codes[count >> l], count >> l);
+  }
+  waveletCodec_putBand(&w, work_rec, count);
+  if (w.bits != 0U) {
+    waveletCodec_put(&w, 0U, 8U - w.bits);
+  }
+  return w.overrun ? 0U : (uint32_t)(w.p - out);
+}
+
+/* Public functions ----------------------------------------------------------*/
+
+ADC_FAST_CODE HAL_StatusTypeDef waveletCodec_encode(const uint16_t *samples,
+                                                    uint32_t count,
+                                                    uint32_t stride,
+                                                    uint16_t max_error,
+                                                    uint8_t *out, uint32_t cap,
+                                                    uint32_t *out_len) {
+  if (samples == NULL || out == NULL || out_len == NULL || count == 0U ||
+      count > WAVELET_CODEC_MAX_SAMPLES || stride == 0U ||
+      max_error > WAVELET_CODEC_MAX_ERROR) {
+    return HAL_ERROR;
+  }
+  const uint32_t verbatim_len = WAVELET_CODEC_MAX_BYTES(count);
+  // Shorter than packing, or not worth it
+  const uint32_t limit = verbatim_len - 1U;
+
+  for (uint32_t n = 0; n < count; n++) {
+    const uint16_t v = samples[n * stride];
+    work_x[n] = (v > WAVELET_CODEC_MAX_CODE) ? WAVELET_CODEC_MAX_CODE : v;
+    work_coef[n] = (int32_t)work_x[n];
+  }
+  const uint32_t levels = waveletCodec_levels(count);
+  waveletCodec_forward(work_coef, count, levels);
+
+  // Start at the step of the residual layer, then coarser (or finer) while
+  // the run gets shorter
+  uint32_t shift = 0;
+  while (shift < WAVELET_CODEC_MAX_SHIFT &&
+         (2UL << shift) <= 2UL * max_error + 1U) {
+    shift++;
+  }
+  uint8_t best = 0;
+  uint32_t zeroed = 0;
+  uint32_t best_len =
+      waveletCodec_trial(count, levels, shift, max_error, work_out[0], limit,
+                         &zeroed);
+  uint32_t best_shift = shift;
+  uint32_t best_zeroed = zeroed;
+  stats_.trials++;
+  for (int32_t dir = 1; dir >= -1; dir -= 2) {
+    uint32_t s = shift;
+    while ((dir > 0) ? s < WAVELET_CODEC_MAX_SHIFT : s > 0U) {
+      s = (uint32_t)((int32_t)s + dir);
+      const uint32_t len = waveletCodec_trial(
+          count, levels, s, max_error, work_out[best ^ 1U], limit, &zeroed);
+      stats_.trials++;
+      if (len == 0U || (best_len != 0U && len >= best_len)) {
+        break;
+      }
+      best ^= 1U;
+      best_len = len;
+      best_shift = s;
+      best_zeroed = zeroed;
+    }
+    if (best_shift != shift) {
+      break; // coarser paid off, finer will not
+    }
+  }
+
+  if (best_len == 0U) {
+    // No smaller than packing: store the samples themselves
+    if (cap < verbatim_len) {
+      return HAL_ERROR;
+    }
+    WaveletCodec_Writer_t w = {.p = out, .end = out + verbatim_len};
+    *w.p++ = WAVELET_CODEC_VERBATIM;
+    for (uint32_t n = 0; n < count; n++) {
+      waveletCodec_put(&w, work_x[n], WAVELET_CODEC_BITS);
+    }
+    if (w.bits != 0U) {
+      waveletCodec_put(&w, 0U, 8U - w.bits);
+    }
+    best_len = verbatim_len;
+    stats_.verbatim_runs++;
+  } else {
+    if (best_len > cap) {
+      return HAL_ERROR;
+    }
+    memcpy(out, work_out[best], best_len);
+    stats_.zeroed += best_zeroed;
+    stats_.shift_runs[best_shift]++;
+  }
+
+  *out_len = best_len;
+  stats_.runs++;
+  stats_.samples += count;
+  stats_.bytes += best_len;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef waveletCodec_decode(const uint8_t *in, uint32_t len,
+                                      uint32_t count, uint16_t max_error,
+                                      uint16_t *samples, uint32_t stride) {
+  int32_t buf[WAVELET_CODEC_MAX_SAMPLES];
+  int32_t res[WAVELET_CODEC_MAX_SAMPLES];
+
+  if (in == NULL || samples == NULL || len == 0U || count == 0U ||
+      count > WAVELET_CODEC_MAX_SAMPLES || stride == 0U ||
+      max_error > WAVELET_CODEC_MAX_ERROR) {
+    return HAL_ERROR;
+  }
+  WaveletCodec_Reader_t r = {.p = &in[1], .end = &in[len]};
+
+  if (in[0] == WAVELET_CODEC_VERBATIM) {
+    for (uint32_t n = 0; n < count; n++) {
+      samples[n * stride] = (uint16_t)waveletCodec_get(&r, WAVELET_CODEC_BITS);
+    }
+    return r.overrun ? HAL_ERROR : HAL_OK;
+  }
+  const uint32_t levels = in[0] >> 4;
+  const uint32_t shift = in[0] & 0x0FU;
+  if (levels > WAVELET_CODEC_MAX_LEVELS || shift > WAVELET_CODEC_MAX_SHIFT ||
+      (count & ((1UL << levels) - 1U)) != 0U) {
+    return HAL_ERROR;
+  }
+  const uint32_t approx = count >> levels;
+
+  waveletCodec_getBand(&r, buf, approx);
+  for (uint32_t l = levels; l > 0U && !r.overrun; l--) {
+    waveletCodec_getBand(&r, &buf[count >> l], count >> l);
+  }
+  waveletCodec_getBand(&r, res, count);
+  if (r.overrun) {
+    return HAL_ERROR;
+  }
+  // A corrupt run could overflow the synthesis: codes are range checked
+  const int32_t limit = (int32_t)(WAVELET_CODEC_MAX_COEF >> shift);
+  int32_t prev = waveletCodec_quantise(WAVELET_CODEC_MIDSCALE, 1U, shift);
+  for (uint32_t i = 0; i < count; i++) {
+    const uint8_t a = (i < approx);
+    if (a) {
+      prev += buf[i];
+      buf[i] = prev;
+    }
+    if (buf[i] > limit || buf[i] < -limit) {
+      return HAL_ERROR;
+    }
+    buf[i] = waveletCodec_dequantise(buf[i], a, shift);
+  }
+  if (levels > 0U) {
+    waveletCodec_inverse(buf, count, levels);
+  }
+  const int32_t step = 2 * (int32_t)max_error + 1;
+  for (uint32_t n = 0; n < count; n++) {
+    samples[n * stride] =
+        (uint16_t)waveletCodec_clip(waveletCodec_clip(buf[n]) + res[n] * step);
+  }
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef waveletCodec_getStats(WaveletCodec_Stats_t *stats) {
+  if (stats == NULL) {
+    return HAL_ERROR;
+  }
+  *stats = stats_;
+  return HAL_OK;
+}
+
+void waveletCodec_resetStats(void) { memset(&stats_, 0, sizeof(stats_)); }
@@ -0,0 +1,105 @@
+# FPU-free interrupt paths, checked after the link:
+#   cmake -DELF_FILE=<image>.elf [-DOBJDUMP=arm-none-eabi-objdump]
+#         -DTREE="fn;..." [-DSELF="fn;..."] -P cmake/fpu_free.cmake
+#
+# A TREE function and every function it calls directly (bl, tail-call b,
+# through the long-call veneers between flash and ITCM) must not contain a
+# single FP instruction, i.e. no v-prefixed mnemonic (VFP). A SELF function
+# is checked alone: what it hands off to may use the FPU. An indirect call
+# (blx rN) cannot be followed and is listed. A listed function missing from
+# the image fails the check, so a rename cannot switch it off.
+#
+# With lazy stacking (irq_priority.h) an FPU-free handler never writes the
+# FP context, so its entry costs the same with and without it.
+
+cmake_policy(SET CMP0057 NEW)
+
+if(NOT ELF_FILE OR NOT EXISTS "${ELF_FILE}")
+    message(FATAL_ERROR "fpu_free: ELF_FILE=<image>.elf not found")
+endif()
+if(NOT OBJDUMP)
+    set(OBJDUMP arm-none-eabi-objdump)
+endif()
+
+# Instruction lines of one function, empty if the image has no such symbol
+function(fpu_free_disassemble name out)
+    execute_process(
+        COMMAND ${OBJDUMP} -d --no-show-raw-insn --disassemble=${name}
+                ${ELF_FILE}
+        OUTPUT_VARIABLE text
+        RESULT_VARIABLE rc
+        ERROR_QUIET)
+    if(NOT rc EQUAL 0 OR NOT text MATCHES "<${name}>:")
+        set(${out} "" PARENT_SCOPE)
+        return()
+    endif()
+    # Brackets and semicolons would upset the list split
+    string(REPLACE ";" "," text "${text}")
+    string(REPLACE "[" "(" text "${text}")
+    string(REPLACE "]" ")" text "${text}")
+    string(REPLACE "\n" ";" text "${text}")
+    set(${out} "${text}" PARENT_SCOPE)
+endfunction()
+
+# Work list of mode|function|listed root
+set(queue "")
+foreach(name IN LISTS TREE)
+    list(APPEND queue "tree|${name}|${name}")
+endforeach()
+foreach(name IN LISTS SELF)
+    list(APPEND queue "self|${name}|${name}")
+endforeach()
+
+set(checked "")
+set(violations "")
+set(indirect "")
+while(queue)
+    list(POP_FRONT queue item)
+    string(REPLACE "|" ";" parts "${item}")
+    list(GET parts 0 mode)
+    list(GET parts 1 name)
+    list(GET parts 2 root)
+    if("${mode}|${name}" IN_LIST checked)
+        continue()
+    endif()
+    list(APPEND checked "${mode}|${name}")
+
+    fpu_free_disassemble(${name} lines)
+    if(NOT lines)
+        if(name STREQUAL root)
+            list(APPEND violations "${name}: not in the image")
+        endif()
+        continue()
+    endif()
+    foreach(line IN LISTS lines)
+        if(line MATCHES "^ +([0-9a-f]+):\t(v[a-z0-9.]*)")
+            list(APPEND violations
+                 "${name} (from ${root}): 0x${CMAKE_MATCH_1} ${CMAKE_MATCH_2}")
+        elseif(NOT mode STREQUAL "tree")
+            continue()
+        elseif(line MATCHES "^ +[0-9a-f]+:\tb[a-z]*(\\.[nw])?\t[0-9a-f]+ <([A-Za-z0-9_.$]+)>")
+            # Branches inside the function read <name+0x..> and do not match
+            set(callee "${CMAKE_MATCH_2}")
+            if(callee MATCHES "^__(.+)_veneer$")
+                set(callee "${CMAKE_MATCH_1}")
+            endif()
+            list(APPEND queue "tree|${callee}|${root}")
+        elseif(line MATCHES "^ +([0-9a-f]+):\tblx\t")
+            list(APPEND indirect "${name} (from ${root}): 0x${CMAKE_MATCH_1}")
+        endif()
+    endforeach()
+endwhile()
+
+list(LENGTH checked checked_count)
+get_filename_component(elf_name "${ELF_FILE}" NAME)
+set(report "FPU-free paths in ${elf_name}: ${checked_count} functions\n")
+foreach(entry IN LISTS indirect)
+    string(APPEND report "  indirect call not followed: ${entry}\n")
+endforeach()
+if(violations)
+    foreach(entry IN LISTS violations)
+        string(APPEND report "  ${entry}\n")
+    endforeach()
+    message(FATAL_ERROR "${report}fpu_free: FP code on a reaction path")
+endif()
+message("${report}")
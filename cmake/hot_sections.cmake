@@ -0,0 +1,112 @@
+# Hot code placement report, run after the link:
+#   cmake -DMAP_FILE=<image>.map [-DITCM_SIZE=16384] -P cmake/hot_sections.cmake
+#
+# Lists every function the map file shows in ITCM (.itcm_text, ADC_FAST_CODE)
+# and in the flash hot group between _stext_hot and _etext_hot (.text.hot,
+# ADC_HOT_CODE, and the vendor ISR path the linker script collects by name),
+# with its address, input section size and object file, then both totals.
+
+if(NOT MAP_FILE OR NOT EXISTS "${MAP_FILE}")
+    message(FATAL_ERROR "hot_sections: MAP_FILE=<image>.map not found")
+endif()
+if(NOT ITCM_SIZE)
+    set(ITCM_SIZE 16384)
+endif()
+
+file(STRINGS "${MAP_FILE}" map_lines)
+
+set(zone "")          # itcm | hot | empty while outside both
+set(in_memory_map OFF)
+set(pending_name "")  # input section whose address is on the next line
+set(section_size 0)
+set(section_file "")
+set(itcm_bytes 0)
+set(hot_bytes 0)
+set(itcm_report "")
+set(hot_report "")
+
+foreach(line IN LISTS map_lines)
+    if(line MATCHES "^Linker script and memory map")
+        set(in_memory_map ON)
+        continue()
+    endif()
+    if(NOT in_memory_map)
+        continue()
+    endif()
+
+    # Output section: .name  0xADDR  0xSIZE
+    if(line MATCHES "^(\\.[A-Za-z0-9_.]+)")
+        if(CMAKE_MATCH_1 STREQUAL ".itcm_text")
+            set(zone "itcm")
+        else()
+            set(zone "")
+        endif()
+        continue()
+    endif()
+
+    # Group bounds inside .text
+    if(line MATCHES "^[ ]+0x[0-9a-f]+[ ]+_stext_hot = ")
+        set(zone "hot")
+        continue()
+    endif()
+    if(line MATCHES "^[ ]+0x[0-9a-f]+[ ]+_etext_hot = ")
+        set(zone "")
+        continue()
+    endif()
+    if(zone STREQUAL "")
+        continue()
+    endif()
+
+    # Input section, on one line or with the name alone on the first
+    set(input_line "")
+    if(pending_name AND line MATCHES "^[ ]+(0x[0-9a-f]+)[ ]+(0x[0-9a-f]+)[ ]+(.+)$")
+        set(input_line "${pending_name} ${CMAKE_MATCH_1} ${CMAKE_MATCH_2} ${CMAKE_MATCH_3}")
+        set(pending_name "")
+    elseif(line MATCHES "^ (\\.[^ ]+)$")
+        set(pending_name "${CMAKE_MATCH_1}")
+        continue()
+    elseif(line MATCHES "^ (\\.[^ ]+)[ ]+(0x[0-9a-f]+)[ ]+(0x[0-9a-f]+)[ ]+(.+)$")
+        set(input_line "${CMAKE_MATCH_1} ${CMAKE_MATCH_2} ${CMAKE_MATCH_3} ${CMAKE_MATCH_4}")
+    endif()
+    if(input_line)
+        string(REGEX MATCH "^([^ ]+) (0x[0-9a-f]+) (0x[0-9a-f]+) (.+)$" _ "${input_line}")
+        math(EXPR section_size "${CMAKE_MATCH_3}")
+        get_filename_component(section_file "${CMAKE_MATCH_4}" NAME)
+        if(zone STREQUAL "itcm")
+            math(EXPR itcm_bytes "${itcm_bytes} + ${section_size}")
+        else()
+            math(EXPR hot_bytes "${hot_bytes} + ${section_size}")
+        endif()
+        continue()
+    endif()
+
+    # Symbol of the current input section: 0xADDR  name
+    if(section_size GREATER 0 AND
+       line MATCHES "^[ ]+(0x[0-9a-f]+)[ ]+([A-Za-z_][A-Za-z0-9_]*)$")
+        set(symbol "${CMAKE_MATCH_2}")
+        string(REGEX REPLACE "^0x0*([0-9a-f]+)$" "\\1" addr "${CMAKE_MATCH_1}")
+        string(LENGTH "${addr}" addr_len)
+        if(addr_len LESS 8)
+            math(EXPR pad "8 - ${addr_len}")
+            string(REPEAT "0" ${pad} zeros)
+            set(addr "${zeros}${addr}")
+        endif()
+        set(entry "  0x${addr}  ${symbol}  (${section_file}, section ${section_size} B)\n")
+        if(zone STREQUAL "itcm")
+            string(APPEND itcm_report "${entry}")
+        else()
+            string(APPEND hot_report "${entry}")
+        endif()
+    endif()
+endforeach()
+
+math(EXPR itcm_pct "${itcm_bytes} * 100 / ${ITCM_SIZE}")
+get_filename_component(map_name "${MAP_FILE}" NAME)
+message("Hot code in ${map_name}:\n"
+        "ITCM (.itcm_text): ${itcm_bytes} of ${ITCM_SIZE} B (${itcm_pct} %)\n"
+        "${itcm_report}"
+        "Flash hot group (_stext_hot.._etext_hot): ${hot_bytes} B\n"
+        "${hot_report}")
+if(itcm_bytes GREATER ITCM_SIZE)
+    message(FATAL_ERROR "hot_sections: ITCM code exceeds ${ITCM_SIZE} B")
+endif()
@@ -0,0 +1,224 @@
+# PC-sampling profile by function, from a "pcs dump" and the map file:
+#   cmake -DMAP_FILE=<image>.map -DDUMP_FILE=<captured PCS lines>
+#         [-DTOP=30] -P cmake/pc_profile.cmake
+#
+# DUMP_FILE is the text the board sent after "pcs dump" (other lines are
+# ignored, so a whole terminal log will do). Every code input section of
+# the map file (.isr_vector, .text, .itcm_text) and every symbol the map
+# lists inside one starts a function; a bin counts for the last one at or
+# below its address. Static functions only have a name of their own with
+# -ffunction-sections (.text.<name>); those in a shared section
+# (.itcm_text, .text.hot) count for the global symbol before them. A bin
+# straddling two functions counts for the first.
+
+if(NOT MAP_FILE OR NOT EXISTS "${MAP_FILE}")
+    message(FATAL_ERROR "pc_profile: MAP_FILE=<image>.map not found")
+endif()
+if(NOT DUMP_FILE OR NOT EXISTS "${DUMP_FILE}")
+    message(FATAL_ERROR "pc_profile: DUMP_FILE=<PCS lines> not found")
+endif()
+if(NOT TOP)
+    set(TOP 30)
+endif()
+
+# 0x-prefixed address to 8 lower-case hex digits, sortable as a string
+function(pc_profile_hex value out)
+    string(TOLOWER "${value}" value)
+    string(REGEX REPLACE "^0x0*([0-9a-f]*)$" "\\1" value "${value}")
+    string(LENGTH "${value}" len)
+    if(len LESS 8)
+        math(EXPR pad "8 - ${len}")
+        string(REPEAT "0" ${pad} zeros)
+        set(value "${zeros}${value}")
+    endif()
+    set(${out} "${value}" PARENT_SCOPE)
+endfunction()
+
+# Entries "address|kind|payload", kind 0 = end of a section (no function
+# until the next start), 1 = section start, 2 = symbol, 3 = sample; sorted
+# as strings, starts and symbols come before the samples at their address
+set(entries "")
+set(anchor_count 0)
+
+file(STRINGS "${MAP_FILE}" map_lines)
+set(in_memory_map OFF)
+set(in_code OFF)
+set(pending_name "")
+set(section_size 0)
+
+foreach(line IN LISTS map_lines)
+    if(line MATCHES "^Linker script and memory map")
+        set(in_memory_map ON)
+        continue()
+    endif()
+    if(NOT in_memory_map)
+        continue()
+    endif()
+
+    # Output section
+    if(line MATCHES "^(\\.[A-Za-z0-9_.]+)")
+        if(CMAKE_MATCH_1 MATCHES "^\\.(isr_vector|text|itcm_text)$")
+            set(in_code ON)
+        else()
+            set(in_code OFF)
+        endif()
+        set(section_size 0)
+        continue()
+    endif()
+    if(NOT in_code)
+        continue()
+    endif()
+
+    # Input section, on one line or with the name alone on the first
+    set(input_line "")
+    if(pending_name AND line MATCHES "^[ ]+(0x[0-9a-f]+)[ ]+(0x[0-9a-f]+)[ ]+(.+)$")
+        set(input_line "${pending_name} ${CMAKE_MATCH_1} ${CMAKE_MATCH_2} ${CMAKE_MATCH_3}")
+        set(pending_name "")
+    elseif(line MATCHES "^ (\\.[^ ]+)$")
+        set(pending_name "${CMAKE_MATCH_1}")
+        continue()
+    elseif(line MATCHES "^ (\\.[^ ]+)[ ]+(0x[0-9a-f]+)[ ]+(0x[0-9a-f]+)[ ]+(.+)$")
+        set(input_line "${CMAKE_MATCH_1} ${CMAKE_MATCH_2} ${CMAKE_MATCH_3} ${CMAKE_MATCH_4}")
+    endif()
+    if(input_line)
+        string(REGEX MATCH "^([^ ]+) (0x[0-9a-f]+) (0x[0-9a-f]+) (.+)$" _ "${input_line}")
+        set(section "${CMAKE_MATCH_1}")
+        set(start "${CMAKE_MATCH_2}")
+        math(EXPR section_size "${CMAKE_MATCH_3}")
+        get_filename_component(section_file "${CMAKE_MATCH_4}" NAME)
+        if(section_size EQUAL 0)
+            continue()
+        endif()
+        if(section MATCHES "^\\.text\\.(unlikely\\.|startup\\.)?([A-Za-z_][A-Za-z0-9_.$]*)$" AND
+           NOT section STREQUAL ".text.hot")
+            set(label "${CMAKE_MATCH_2}")
+        else()
+            set(label "(${section})")
+        endif()
+        math(EXPR end "${start} + ${section_size}" OUTPUT_FORMAT HEXADECIMAL)
+        pc_profile_hex("${start}" start_hex)
+        pc_profile_hex("${end}" end_hex)
+        set(anchor_${anchor_count} "${label}  ${section_file}")
+        list(APPEND entries "${start_hex}|1|${anchor_count}" "${end_hex}|0|-")
+        math(EXPR anchor_count "${anchor_count} + 1")
+        continue()
+    endif()
+
+    # Symbol inside the current input section: 0xADDR  name
+    if(section_size GREATER 0 AND
+       line MATCHES "^[ ]+(0x[0-9a-f]+)[ ]+([A-Za-z_][A-Za-z0-9_.$]*)$")
+        pc_profile_hex("${CMAKE_MATCH_1}" addr_hex)
+        set(anchor_${anchor_count} "${CMAKE_MATCH_2}  ${section_file}")
+        list(APPEND entries "${addr_hex}|2|${anchor_count}")
+        math(EXPR anchor_count "${anchor_count} + 1")
+    endif()
+endforeach()
+
+# PCS lines: " 08004a10:3120" (PC bin) or " L08012f30:77" (stacked LR bin)
+file(STRINGS "${DUMP_FILE}" dump_lines REGEX "^PCS ")
+set(header "")
+foreach(line IN LISTS dump_lines)
+    if(line MATCHES "^PCS (begin|end) ")
+        if(CMAKE_MATCH_1 STREQUAL "begin")
+            string(STRIP "${line}" header)
+        endif()
+        continue()
+    endif()
+    string(REGEX MATCHALL "L?[0-9a-fA-F]+:[0-9]+" pairs "${line}")
+    foreach(pair IN LISTS pairs)
+        string(REGEX MATCH "^(L?)([0-9a-fA-F]+):([0-9]+)$" _ "${pair}")
+        set(kind "P")
+        if(CMAKE_MATCH_1)
+            set(kind "L")
+        endif()
+        set(count "${CMAKE_MATCH_3}")
+        pc_profile_hex("0x${CMAKE_MATCH_2}" addr_hex)
+        list(APPEND entries "${addr_hex}|3|${kind}${count}")
+    endforeach()
+endforeach()
+if(header STREQUAL "")
+    message(FATAL_ERROR "pc_profile: no \"PCS begin\" line in ${DUMP_FILE}")
+endif()
+
+# One pass in address order: each sample bin counts for the current anchor
+list(SORT entries)
+set(current "")
+set(hit_ids "")
+set(total_P 0)
+set(total_L 0)
+set(unmapped_P 0)
+set(unmapped_L 0)
+foreach(entry IN LISTS entries)
+    string(REPLACE "|" ";" fields "${entry}")
+    list(GET fields 1 kind)
+    if(kind LESS 3)
+        if(kind EQUAL 0)
+            set(current "")
+        else()
+            list(GET fields 2 current)
+        endif()
+        continue()
+    endif()
+    list(GET fields 2 sample)
+    string(SUBSTRING "${sample}" 0 1 source)
+    string(SUBSTRING "${sample}" 1 -1 count)
+    math(EXPR total_${source} "${total_${source}} + ${count}")
+    if(current STREQUAL "")
+        math(EXPR unmapped_${source} "${unmapped_${source}} + ${count}")
+        continue()
+    endif()
+    if(NOT DEFINED hits_${source}_${current})
+        set(hits_${source}_${current} 0)
+        list(APPEND hit_ids "${current}")
+    endif()
+    math(EXPR hits_${source}_${current} "${hits_${source}_${current}} + ${count}")
+endforeach()
+list(REMOVE_DUPLICATES hit_ids)
+
+# Table of the TOP functions by samples, percent to one decimal
+function(pc_profile_report source title out)
+    set(total "${total_${source}}")
+    set(rows "")
+    foreach(id IN LISTS hit_ids)
+        if(DEFINED hits_${source}_${id})
+            set(n "${hits_${source}_${id}}")
+            string(LENGTH "${n}" len)
+            math(EXPR pad "10 - ${len}")
+            string(REPEAT "0" ${pad} zeros)
+            list(APPEND rows "${zeros}${n}|${id}")
+        endif()
+    endforeach()
+    list(SORT rows ORDER DESCENDING)
+    set(text "${title}: ${total} samples\n")
+    set(shown 0)
+    foreach(row IN LISTS rows)
+        if(NOT shown LESS TOP)
+            break()
+        endif()
+        string(REPLACE "|" ";" fields "${row}")
+        list(GET fields 0 n)
+        list(GET fields 1 id)
+        math(EXPR n "${n}")
+        math(EXPR permille "${n} * 1000 / ${total}")
+        math(EXPR whole "${permille} / 10")
+        math(EXPR tenth "${permille} % 10")
+        string(APPEND text "  ${whole}.${tenth} %  ${n}  ${anchor_${id}}\n")
+        math(EXPR shown "${shown} + 1")
+    endforeach()
+    if(unmapped_${source} GREATER 0)
+        string(APPEND text "  (outside the map's code: ${unmapped_${source}})\n")
+    endif()
+    set(${out} "${text}" PARENT_SCOPE)
+endfunction()
+
+get_filename_component(map_name "${MAP_FILE}" NAME)
+set(report "PC samples in ${map_name}, ${header}\n")
+if(total_P GREATER 0)
+    pc_profile_report(P "Interrupted PC" pc_text)
+    string(APPEND report "${pc_text}")
+endif()
+if(total_L GREATER 0)
+    pc_profile_report(L "Stacked LR (callers of leaf functions)" lr_text)
+    string(APPEND report "${lr_text}")
+endif()
+message("${report}")
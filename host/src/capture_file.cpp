@@ -0,0 +1,318 @@
+/**
+ ******************************************************************************
+ * @file    capture_file.cpp
+ * @brief   Implementation of the memory-mapped capture file
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "capture_file.hpp"
+
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace telemetry {
+
+namespace {
+
+/* Private constants ----------------------------------------------------------*/
+
+constexpr uint64_t grow_step = 64ULL << 20; ///< ftruncate() granularity
+constexpr uint64_t block_align = 64U;
+constexpr uint64_t column_align = 8U;
+
+/* Private functions ----------------------------------------------------------*/
+
+uint64_t alignUp(uint64_t v, uint64_t a) { return (v + a - 1U) / a * a; }
+
+/**
+ * @brief Column offsets of a block relative to its header; returns the
+ *        padded block size
+ */
+uint64_t blockLayout(uint32_t capacity, uint32_t columns, uint64_t *offset) {
+  uint64_t o = sizeof(BlockHeader);
+  offset[0] = o; // sequence
+  o = alignUp(o + 4ULL * capacity, column_align);
+  offset[1] = o; // flags
+  o = alignUp(o + capacity, column_align);
+  for (uint32_t c = 0; c < columns; c++) {
+    offset[2U + c] = o;
+    o = alignUp(o + 2ULL * capacity, column_align);
+  }
+  return alignUp(o, block_align);
+}
+
+uint32_t channelMask(const BlockHeader &b) {
+  uint32_t mask = 0;
+  for (uint32_t c = 0; c < b.column_count; c++) {
+    mask |= 1U << (b.column_channel[c] & 31U);
+  }
+  return mask;
+}
+
+} // namespace
+
+const char *sourceName(Source source) {
+  switch (source) {
+  case Source::serial:
+    return "serial";
+  case Source::usb:
+    return "usb";
+  case Source::udp:
+    return "udp";
+  case Source::capture:
+    return "capture";
+  }
+  return "?";
+}
+
+/* CaptureWriter --------------------------------------------------------------*/
+
+CaptureWriter::~CaptureWriter() { close(); }
+
+bool CaptureWriter::open(const std::string &path, uint32_t block_frames) {
+  fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd_ < 0) {
+    return false;
+  }
+  block_frames_ = block_frames;
+  used_ = sizeof(FileHeader);
+  if (!reserve(used_)) {
+    ::close(fd_);
+    fd_ = -1;
+    return false;
+  }
+  FileHeader h{};
+  std::memcpy(h.magic, capture_magic, sizeof(h.magic));
+  h.version = capture_version;
+  h.block_frames = block_frames;
+  h.data_end = used_;
+  std::memcpy(at(0), &h, sizeof(h));
+  return true;
+}
+
+bool CaptureWriter::reserve(uint64_t end) {
+  if (end <= mapped_) {
+    return true;
+  }
+  const uint64_t size = alignUp(end, grow_step);
+  if (::ftruncate(fd_, static_cast<off_t>(size)) != 0) {
+    return false;
+  }
+  if (map_ != nullptr) {
+    ::munmap(map_, mapped_);
+  }
+  void *m = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+  if (m == MAP_FAILED) {
+    map_ = nullptr;
+    mapped_ = 0;
+    return false;
+  }
+  map_ = static_cast<uint8_t *>(m);
+  mapped_ = size;
+  return true;
+}
+
+bool CaptureWriter::startBlock(const SampleBatch &batch, uint32_t sequence,
+                               Source source) {
+  const uint64_t bytes =
+      blockLayout(block_frames_, batch.column_count, column_offset_);
+  if (!reserve(used_ + bytes)) {
+    return false;
+  }
+  block_ = used_;
+  used_ += bytes;
+
+  BlockHeader b{};
+  b.magic = block_magic;
+  b.capacity = block_frames_;
+  b.column_count = static_cast<uint8_t>(batch.column_count);
+  b.source = static_cast<uint8_t>(source);
+  b.first_sequence = sequence;
+  b.last_sequence = sequence;
+  b.first_time = batch.time;
+  b.block_bytes = bytes;
+  std::memcpy(b.column_channel, batch.column_channel, batch.column_count);
+  std::memcpy(at(block_), &b, sizeof(b));
+  in_block_ = true;
+  return true;
+}
+
+void CaptureWriter::finishBlock() {
+  if (!in_block_) {
+    return;
+  }
+  BlockHeader b;
+  std::memcpy(&b, at(block_), sizeof(b));
+  index_.push_back({block_, b.first_sequence, b.last_sequence, b.frames,
+                    channelMask(b)});
+
+  FileHeader h;
+  std::memcpy(&h, at(0), sizeof(h));
+  h.block_count = index_.size();
+  h.data_end = used_;
+  std::memcpy(at(0), &h, sizeof(h));
+  in_block_ = false;
+}
+
+bool CaptureWriter::append(const SampleBatch &batch, uint32_t stride,
+                           Source source, uint32_t lost_before) {
+  if (fd_ < 0 || batch.column_count == 0U) {
+    return false;
+  }
+  if (stride == 0U) {
+    stride = 1U;
+  }
+  const uint32_t k = batch.column_count;
+  const uint8_t clipped =
+      (batch.flags & flag_clipped) != 0U ? flag_frame_clipped : 0U;
+
+  for (uint32_t i = 0; i < batch.frame_count; i++) {
+    BlockHeader *b =
+        in_block_ ? reinterpret_cast<BlockHeader *>(at(block_)) : nullptr;
+    if (b != nullptr &&
+        (b->frames == b->capacity || b->source != static_cast<uint8_t>(source) ||
+         b->column_count != k ||
+         std::memcmp(b->column_channel, batch.column_channel, k) != 0)) {
+      finishBlock();
+      b = nullptr;
+    }
+    const uint32_t seq = batch.first_sequence + i * stride;
+    if (b == nullptr) {
+      if (!startBlock(batch, seq, source)) {
+        return false;
+      }
+      b = reinterpret_cast<BlockHeader *>(at(block_));
+    }
+    if (i == 0U) {
+      b->lost_frames += lost_before;
+    }
+
+    const uint32_t row = b->frames;
+    uint8_t *base = at(block_);
+    std::memcpy(base + column_offset_[0] + 4ULL * row, &seq, sizeof(seq));
+    uint8_t flags = clipped;
+    if (i < 32U && ((batch.error_bitmap >> i) & 1U) != 0U) {
+      flags |= flag_frame_error;
+    }
+    base[column_offset_[1] + row] = flags;
+    const uint16_t *frame = &batch.samples[static_cast<size_t>(i) * k];
+    for (uint32_t c = 0; c < k; c++) {
+      std::memcpy(base + column_offset_[2U + c] + 2ULL * row, &frame[c],
+                  sizeof(uint16_t));
+    }
+    b->last_sequence = seq;
+    b->frames = row + 1U;
+  }
+  return true;
+}
+
+bool CaptureWriter::close() {
+  if (fd_ < 0) {
+    return true;
+  }
+  finishBlock();
+
+  // Index: magic, entry count, then the entries
+  const uint64_t index_offset = used_;
+  const uint64_t count = index_.size();
+  const uint64_t end = index_offset + 8U + count * sizeof(IndexEntry);
+  bool ok = reserve(end);
+  if (ok) {
+    const uint32_t head[2] = {index_magic, static_cast<uint32_t>(count)};
+    std::memcpy(at(index_offset), head, sizeof(head));
+    if (count != 0U) {
+      std::memcpy(at(index_offset + 8U), index_.data(),
+                  count * sizeof(IndexEntry));
+    }
+    FileHeader h;
+    std::memcpy(&h, at(0), sizeof(h));
+    h.index_offset = index_offset;
+    std::memcpy(at(0), &h, sizeof(h));
+  }
+  if (map_ != nullptr) {
+    ::munmap(map_, mapped_);
+    map_ = nullptr;
+  }
+  ok = ok && ::ftruncate(fd_, static_cast<off_t>(end)) == 0;
+  ::close(fd_);
+  fd_ = -1;
+  mapped_ = 0;
+  return ok;
+}
+
+/* Reader ---------------------------------------------------------------------*/
+
+bool readIndex(const std::string &path, std::vector<IndexEntry> &index,
+               std::vector<BlockHeader> &blocks, bool &closed) {
+  const int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat st {};
+  if (::fstat(fd, &st) != 0 ||
+      static_cast<uint64_t>(st.st_size) < sizeof(FileHeader)) {
+    ::close(fd);
+    return false;
+  }
+  const uint64_t size = static_cast<uint64_t>(st.st_size);
+  void *m = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (m == MAP_FAILED) {
+    return false;
+  }
+  const uint8_t *base = static_cast<const uint8_t *>(m);
+
+  FileHeader h;
+  std::memcpy(&h, base, sizeof(h));
+  bool ok = std::memcmp(h.magic, capture_magic, sizeof(h.magic)) == 0;
+  closed = ok && h.index_offset != 0U;
+
+  index.clear();
+  blocks.clear();
+  if (ok && closed) {
+    // Closed file: trust the index
+    uint32_t head[2] = {};
+    ok = h.index_offset + 8U <= size;
+    if (ok) {
+      std::memcpy(head, base + h.index_offset, sizeof(head));
+      ok = head[0] == index_magic &&
+           h.index_offset + 8U + head[1] * sizeof(IndexEntry) <= size;
+    }
+    if (ok) {
+      index.resize(head[1]);
+      std::memcpy(index.data(), base + h.index_offset + 8U,
+                  index.size() * sizeof(IndexEntry));
+    }
+  } else if (ok) {
+    // Writer did not close: walk the blocks, including the open one
+    uint64_t offset = sizeof(FileHeader);
+    while (offset + sizeof(BlockHeader) <= size) {
+      BlockHeader b;
+      std::memcpy(&b, base + offset, sizeof(b));
+      if (b.magic != block_magic || b.block_bytes == 0U ||
+          offset + b.block_bytes > size) {
+        break;
+      }
+      index.push_back(
+          {offset, b.first_sequence, b.last_sequence, b.frames, channelMask(b)});
+      offset += b.block_bytes;
+    }
+  }
+  for (size_t i = 0; ok && i < index.size(); i++) {
+    BlockHeader b;
+    ok = index[i].offset + sizeof(b) <= size;
+    if (ok) {
+      std::memcpy(&b, base + index[i].offset, sizeof(b));
+      blocks.push_back(b);
+    }
+  }
+  ::munmap(m, size);
+  return ok;
+}
+
+} // namespace telemetry
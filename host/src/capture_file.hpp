@@ -0,0 +1,171 @@
+/**
+ ******************************************************************************
+ * @file    capture_file.hpp
+ * @brief   Append-only, memory-mapped columnar capture file
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * A capture file is a 64-byte file header, then blocks of up to
+ * block_frames frames, then a block index written on close. Each block
+ * holds one source (serial, USB, UDP or a trigger capture) with one
+ * channel set, stored column by column so that one channel of a long run
+ * can be read, or mapped, without touching the others:
+ *
+ *   BlockHeader (96 bytes)
+ *   uint32_t sequence[capacity]
+ *   uint8_t  flags[capacity]        bit 0 frame error, bit 1 clipped
+ *   uint16_t samples[capacity]      one column per entry of column_channel
+ *   ...
+ *
+ * Every column starts 8-byte aligned and blocks are 64-byte aligned. A
+ * block is allocated at full capacity, so appending a frame is a store per
+ * column into the mapping and nothing is ever moved. The file grows by
+ * ftruncate() in large steps and is mapped again after each step; offsets,
+ * not pointers, are kept across a remap.
+ *
+ * index_offset in the file header stays 0 until close() has written the
+ * index. A file whose writer was killed still has valid blocks up to
+ * data_end, updated after every block; readIndex() walks them in that
+ * case.
+ *
+ * All fields are little-endian, which is the host byte order this tool is
+ * built for.
+ ******************************************************************************
+ */
+
+#ifndef TELEMETRY_CAPTURE_FILE_HPP
+#define TELEMETRY_CAPTURE_FILE_HPP
+
+#include "protocol.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace telemetry {
+
+/* File layout ----------------------------------------------------------------*/
+
+constexpr char capture_magic[8] = {'A', 'D', 'C', 'C', 'A', 'P', 'T', '1'};
+constexpr uint32_t block_magic = 0x4B4C4231U; ///< "1BLK" little-endian
+constexpr uint32_t index_magic = 0x31584449U; ///< "IDX1" little-endian
+constexpr uint32_t capture_version = 1U;
+
+constexpr uint8_t flag_frame_error = 0x01U; ///< Column flag bits
+constexpr uint8_t flag_frame_clipped = 0x02U;
+
+/**
+ * @brief Where the frames of a block came from
+ */
+enum class Source : uint8_t {
+  serial = 0,
+  usb = 1,
+  udp = 2,
+  capture = 3, ///< Full-rate trigger capture frames (type 5 follow-up)
+};
+
+const char *sourceName(Source source);
+
+struct FileHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t block_frames;  ///< Capacity of a full block
+  uint64_t index_offset;  ///< 0 = not closed, walk the blocks
+  uint64_t block_count;
+  uint64_t data_end;      ///< End of the last complete block
+  uint8_t reserved[24];
+};
+static_assert(sizeof(FileHeader) == 64, "file header layout");
+
+struct BlockHeader {
+  uint32_t magic;
+  uint32_t frames;        ///< Frames written
+  uint32_t capacity;      ///< Entries allocated in every column
+  uint8_t column_count;
+  uint8_t source;         ///< Source
+  uint8_t reserved0[2];
+  uint32_t first_sequence;
+  uint32_t last_sequence;
+  uint32_t lost_frames;   ///< Frames missing inside this block
+  uint32_t reserved1;
+  uint64_t first_time;    ///< Board time of the batch that started it
+  uint64_t block_bytes;   ///< Header and all columns, padded
+  uint8_t column_channel[max_columns];
+  uint8_t reserved2[16];
+};
+static_assert(sizeof(BlockHeader) == 96, "block header layout");
+
+/**
+ * @brief One entry of the block index
+ */
+struct IndexEntry {
+  uint64_t offset;
+  uint32_t first_sequence;
+  uint32_t last_sequence;
+  uint32_t frames;
+  uint32_t channel_mask;
+};
+static_assert(sizeof(IndexEntry) == 24, "index entry layout");
+
+/* Writer ---------------------------------------------------------------------*/
+
+class CaptureWriter {
+public:
+  CaptureWriter() = default;
+  ~CaptureWriter();
+  CaptureWriter(const CaptureWriter &) = delete;
+  CaptureWriter &operator=(const CaptureWriter &) = delete;
+
+  /**
+   * @brief Create (truncate) path; false with errno set on failure
+   */
+  bool open(const std::string &path, uint32_t block_frames);
+
+  /**
+   * @brief Append the frames of batch, which are stride sequence numbers
+   *        apart (1 if not known)
+   */
+  bool append(const SampleBatch &batch, uint32_t stride, Source source,
+              uint32_t lost_before);
+
+  /**
+   * @brief Finish the open block, write the index and unmap
+   */
+  bool close();
+
+  bool isOpen() const { return fd_ >= 0; }
+  uint64_t bytesWritten() const { return used_; }
+  uint64_t blocks() const { return index_.size(); }
+
+private:
+  bool startBlock(const SampleBatch &batch, uint32_t sequence, Source source);
+  void finishBlock();
+  bool reserve(uint64_t end);
+  uint8_t *at(uint64_t offset) { return map_ + offset; }
+
+  int fd_ = -1;
+  uint8_t *map_ = nullptr;
+  uint64_t mapped_ = 0;   ///< Size of the file and of the mapping
+  uint64_t used_ = 0;     ///< End of the last block started
+  uint32_t block_frames_ = 0;
+  bool in_block_ = false;
+  uint64_t block_ = 0;    ///< Offset of the open block
+  uint64_t column_offset_[max_columns + 2U] = {}; ///< seq, flags, samples
+  std::vector<IndexEntry> index_;
+};
+
+/* Reader ---------------------------------------------------------------------*/
+
+/**
+ * @brief Block index of path, from its index or by walking the blocks;
+ *        false if the file is not a capture file
+ */
+bool readIndex(const std::string &path, std::vector<IndexEntry> &index,
+               std::vector<BlockHeader> &blocks, bool &closed);
+
+} // namespace telemetry
+
+#endif /* TELEMETRY_CAPTURE_FILE_HPP */
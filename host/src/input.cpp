@@ -0,0 +1,160 @@
+/**
+ ******************************************************************************
+ * @file    input.cpp
+ * @brief   Implementation of the host receiver sources
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "input.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <termios.h>
+#include <unistd.h>
+
+namespace telemetry {
+
+namespace {
+
+/* Private functions ----------------------------------------------------------*/
+
+bool baudConstant(uint32_t baud, speed_t &speed) {
+  switch (baud) {
+  case 115200U:
+    speed = B115200;
+    return true;
+  case 230400U:
+    speed = B230400;
+    return true;
+  case 460800U:
+    speed = B460800;
+    return true;
+  case 921600U:
+    speed = B921600;
+    return true;
+  case 1000000U:
+    speed = B1000000;
+    return true;
+  case 2000000U:
+    speed = B2000000;
+    return true;
+  case 3000000U:
+    speed = B3000000;
+    return true;
+  case 4000000U:
+    speed = B4000000;
+    return true;
+  default:
+    return false;
+  }
+}
+
+} // namespace
+
+/* Public functions -----------------------------------------------------------*/
+
+int openSerial(const std::string &device, uint32_t baud) {
+  speed_t speed;
+  if (!baudConstant(baud, speed)) {
+    errno = EINVAL;
+    return -1;
+  }
+  const int fd = ::open(device.c_str(), O_RDONLY | O_NOCTTY);
+  if (fd < 0) {
+    return -1;
+  }
+  termios tio{};
+  if (::tcgetattr(fd, &tio) != 0) {
+    // USB CDC ports of some hosts refuse termios; their baud is moot anyway
+    return fd;
+  }
+  ::cfmakeraw(&tio);
+  tio.c_cflag |= CLOCAL | CREAD;
+  tio.c_cc[VMIN] = 0;
+  tio.c_cc[VTIME] = 0;
+  ::cfsetispeed(&tio, speed);
+  ::cfsetospeed(&tio, speed);
+  ::tcsetattr(fd, TCSANOW, &tio);
+  ::tcflush(fd, TCIFLUSH);
+  return fd;
+}
+
+int openStream(const std::string &path) {
+  if (path == "-") {
+    return STDIN_FILENO;
+  }
+  return ::open(path.c_str(), O_RDONLY);
+}
+
+long readSome(int fd, uint8_t *buf, size_t cap, int timeout_ms) {
+  pollfd p{fd, POLLIN, 0};
+  const int ready = ::poll(&p, 1, timeout_ms);
+  if (ready < 0) {
+    return (errno == EINTR) ? 0 : -1;
+  }
+  if (ready == 0) {
+    return 0;
+  }
+  const ssize_t n = ::read(fd, buf, cap);
+  if (n < 0) {
+    return (errno == EINTR || errno == EAGAIN) ? 0 : -1;
+  }
+  return (n == 0) ? -1 : static_cast<long>(n);
+}
+
+/* UdpReceiver ----------------------------------------------------------------*/
+
+UdpReceiver::UdpReceiver() : buffer_(udp_batch * udp_datagram_max) {}
+
+UdpReceiver::~UdpReceiver() {
+  if (fd_ >= 0) {
+    ::close(fd_);
+  }
+}
+
+bool UdpReceiver::bind(uint16_t port) {
+  fd_ = ::socket(AF_INET, SOCK_DGRAM, 0);
+  if (fd_ < 0) {
+    return false;
+  }
+  // Room for a second of blocks while the writer grows the file
+  const int rcvbuf = 8 * 1024 * 1024;
+  ::setsockopt(fd_, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+  sockaddr_in addr{};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  return ::bind(fd_, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) == 0;
+}
+
+int UdpReceiver::receive(int timeout_ms) {
+  pollfd p{fd_, POLLIN, 0};
+  const int ready = ::poll(&p, 1, timeout_ms);
+  if (ready <= 0) {
+    return (ready == 0 || errno == EINTR) ? 0 : -1;
+  }
+  mmsghdr msgs[udp_batch] = {};
+  iovec iov[udp_batch];
+  for (size_t i = 0; i < udp_batch; i++) {
+    iov[i].iov_base = &buffer_[i * udp_datagram_max];
+    iov[i].iov_len = udp_datagram_max;
+    msgs[i].msg_hdr.msg_iov = &iov[i];
+    msgs[i].msg_hdr.msg_iovlen = 1;
+  }
+  const int n = ::recvmmsg(fd_, msgs, udp_batch, MSG_DONTWAIT, nullptr);
+  if (n < 0) {
+    return (errno == EAGAIN || errno == EINTR) ? 0 : -1;
+  }
+  for (int i = 0; i < n; i++) {
+    sizes_[i] = msgs[i].msg_len;
+  }
+  return n;
+}
+
+} // namespace telemetry
@@ -0,0 +1,79 @@
+/**
+ ******************************************************************************
+ * @file    input.hpp
+ * @brief   Byte and datagram sources of the host receiver
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * Reads are batched: a serial port or file is read in 64 kB chunks after
+ * poll() says there is data, and UDP datagrams are taken up to 32 per
+ * recvmmsg() call, so the per-call cost is spread over many packets at
+ * full rate instead of being paid per byte or per datagram.
+ ******************************************************************************
+ */
+
+#ifndef TELEMETRY_INPUT_HPP
+#define TELEMETRY_INPUT_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace telemetry {
+
+constexpr size_t read_chunk = 64U * 1024U;
+constexpr size_t udp_batch = 32U;
+constexpr size_t udp_datagram_max = 9216U; ///< Block datagram, jumbo margin
+
+/**
+ * @brief Open a tty in raw mode at baud; -1 with errno set on failure
+ */
+int openSerial(const std::string &device, uint32_t baud);
+
+/**
+ * @brief Open a recorded byte stream, or stdin for "-"
+ */
+int openStream(const std::string &path);
+
+/**
+ * @brief Read what is available, waiting at most timeout_ms
+ *
+ * @return Bytes read, 0 on timeout, -1 at end of file or on error
+ */
+long readSome(int fd, uint8_t *buf, size_t cap, int timeout_ms);
+
+/**
+ * @brief UDP socket bound to a port, read in batches
+ */
+class UdpReceiver {
+public:
+  UdpReceiver();
+  ~UdpReceiver();
+  UdpReceiver(const UdpReceiver &) = delete;
+  UdpReceiver &operator=(const UdpReceiver &) = delete;
+
+  bool bind(uint16_t port);
+
+  /**
+   * @brief Receive up to udp_batch datagrams, waiting at most timeout_ms
+   *
+   * @return Datagrams received (see data() and size()), 0 on timeout, -1 on
+   *         error
+   */
+  int receive(int timeout_ms);
+
+  const uint8_t *data(size_t i) const { return &buffer_[i * udp_datagram_max]; }
+  size_t size(size_t i) const { return sizes_[i]; }
+
+private:
+  int fd_ = -1;
+  std::vector<uint8_t> buffer_;
+  size_t sizes_[udp_batch] = {};
+};
+
+} // namespace telemetry
+
+#endif /* TELEMETRY_INPUT_HPP */
@@ -0,0 +1,380 @@
+/**
+ ******************************************************************************
+ * @file    main.cpp
+ * @brief   telemetry_rx: receive the board's telemetry, report throughput
+ *          and sequence gaps, and record the frames to a capture file
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ *   telemetry_rx <source> [-o capture.adc] [--baud N] [--usb]
+ *                [--decimation N] [--block-frames N] [--report-ms N]
+ *   telemetry_rx --info capture.adc
+ *
+ * <source> is a tty (/dev/ttyACM* is taken as the USB CDC port, which
+ * carries every raw frame), udp:<port> for the block stream, a file with a
+ * recorded byte stream, or - for stdin. --usb marks a recorded stream as
+ * USB CDC data. --decimation is the frame spacing of the serial stream
+ * (STREAM_DECIMATION, 8) until a rate packet or two consecutive packets
+ * give it.
+ *
+ * Every report interval one line goes to stderr: receive rate, decode
+ * throughput (bytes over the time spent deframing, decoding and writing),
+ * packets, CRC failures, frames, lost frames and gaps. The totals are
+ * printed at the end of input or on Ctrl-C, after the capture file has
+ * been closed.
+ ******************************************************************************
+ */
+
+#include "capture_file.hpp"
+#include "input.hpp"
+#include "protocol.hpp"
+
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+volatile std::sig_atomic_t stop_requested = 0;
+
+void onSignal(int) { stop_requested = 1; }
+
+/* Options --------------------------------------------------------------------*/
+
+struct Options {
+  std::string source;
+  std::string output;
+  std::string info;
+  uint32_t baud = 115200U;
+  uint32_t decimation = 8U;
+  uint32_t block_frames = 8192U;
+  uint32_t report_ms = 1000U;
+  bool usb = false;
+};
+
+void usage() {
+  std::fprintf(stderr,
+               "usage: telemetry_rx <tty|udp:PORT|file|-> [-o FILE] "
+               "[--baud N] [--usb]\n"
+               "                    [--decimation N] [--block-frames N] "
+               "[--report-ms N]\n"
+               "       telemetry_rx --info FILE\n");
+}
+
+bool parseOptions(int argc, char **argv, Options &o) {
+  for (int i = 1; i < argc; i++) {
+    const std::string a = argv[i];
+    const bool has_value = i + 1 < argc;
+    if (a == "-o" && has_value) {
+      o.output = argv[++i];
+    } else if (a == "--info" && has_value) {
+      o.info = argv[++i];
+    } else if (a == "--baud" && has_value) {
+      o.baud = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+    } else if (a == "--decimation" && has_value) {
+      o.decimation =
+          static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+    } else if (a == "--block-frames" && has_value) {
+      o.block_frames =
+          static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+    } else if (a == "--report-ms" && has_value) {
+      o.report_ms = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+    } else if (a == "--usb") {
+      o.usb = true;
+    } else if (!a.empty() && (a[0] != '-' || a == "-") && o.source.empty()) {
+      o.source = a;
+    } else {
+      return false;
+    }
+  }
+  return (!o.source.empty() || !o.info.empty()) && o.block_frames != 0U &&
+         o.decimation != 0U && o.report_ms != 0U;
+}
+
+/* Capture file info ----------------------------------------------------------*/
+
+int printInfo(const std::string &path) {
+  std::vector<telemetry::IndexEntry> index;
+  std::vector<telemetry::BlockHeader> blocks;
+  bool closed = false;
+  if (!telemetry::readIndex(path, index, blocks, closed)) {
+    std::fprintf(stderr, "%s: not a capture file\n", path.c_str());
+    return 1;
+  }
+  uint64_t frames = 0;
+  uint64_t lost = 0;
+  std::printf("%s: %zu blocks%s\n", path.c_str(), index.size(),
+              closed ? "" : " (not closed, blocks walked)");
+  std::printf("%8s %10s %10s %8s %6s %8s %-8s %s\n", "offset", "first",
+              "last", "frames", "lost", "columns", "source", "channels");
+  for (size_t i = 0; i < blocks.size(); i++) {
+    const telemetry::BlockHeader &b = blocks[i];
+    std::string channels;
+    for (uint32_t c = 0; c < b.column_count; c++) {
+      channels += (c != 0U ? "," : "") + std::to_string(b.column_channel[c]);
+    }
+    std::printf("%8llu %10u %10u %8u %6u %8u %-8s %s\n",
+                static_cast<unsigned long long>(index[i].offset),
+                b.first_sequence, b.last_sequence, b.frames, b.lost_frames,
+                static_cast<unsigned>(b.column_count),
+                telemetry::sourceName(static_cast<telemetry::Source>(b.source)),
+                channels.c_str());
+    frames += b.frames;
+    lost += b.lost_frames;
+  }
+  std::printf("total: %llu frames, %llu lost\n",
+              static_cast<unsigned long long>(frames),
+              static_cast<unsigned long long>(lost));
+  return 0;
+}
+
+/* Receiver -------------------------------------------------------------------*/
+
+struct Counters {
+  uint64_t rx_bytes = 0;
+  uint64_t packets = 0;
+  uint64_t bad_packets = 0; ///< CRC, sync or version
+  uint64_t captures = 0;
+  double decode_s = 0.0;
+};
+
+class Receiver {
+public:
+  Receiver(telemetry::Source source, uint32_t decimation,
+           telemetry::CaptureWriter *writer)
+      : source_(source), writer_(writer),
+        default_stride_(source == telemetry::Source::serial ? decimation : 1U),
+        stream_(source == telemetry::Source::serial ? 0U : 1U), capture_(1U) {}
+
+  /**
+   * @brief A decoded COBS packet of the serial or USB stream
+   */
+  void onPacket(const uint8_t *p, size_t len) {
+    telemetry::Header h;
+    if (!telemetry::parseHeader(p, len, h)) {
+      counters.bad_packets++;
+      return;
+    }
+    counters.packets++;
+    if (h.type == telemetry::type_samples) {
+      if (telemetry::decodeSamples(p, len, h, batch_)) {
+        onBatch();
+      } else {
+        counters.bad_packets++;
+      }
+    } else if (h.type == telemetry::type_rate) {
+      uint32_t decimation = 0;
+      if (source_ == telemetry::Source::serial &&
+          telemetry::decodeRate(p, len, decimation)) {
+        stream_.setStride(decimation);
+      }
+    } else if (h.type == telemetry::type_event) {
+      if (telemetry::decodeEvent(p, len, window_) &&
+          window_.frame_count != 0U) {
+        in_capture_ = true;
+        capture_.resync();
+        counters.captures++;
+      }
+    }
+  }
+
+  /**
+   * @brief A UDP block datagram
+   */
+  void onDatagram(const uint8_t *d, size_t len) {
+    counters.packets++;
+    if (telemetry::decodeUdpBlock(d, len, batch_)) {
+      onBatch();
+    } else {
+      counters.bad_packets++;
+    }
+  }
+
+  uint64_t frames() const { return stream_.frames() + capture_.frames(); }
+  uint64_t lost() const { return stream_.lostFrames() + capture_.lostFrames(); }
+  uint64_t gaps() const { return stream_.gaps() + capture_.gaps(); }
+
+  Counters counters;
+
+private:
+  void onBatch() {
+    const uint32_t first = batch_.first_sequence;
+    const bool restart = (batch_.flags & telemetry::flag_rate_change) != 0U;
+    if (in_capture_ && first - window_.first_frame < window_.frame_count) {
+      record(capture_, telemetry::Source::capture, false);
+      if (first + batch_.frame_count - window_.first_frame >=
+          window_.frame_count) {
+        // Last capture packet: the decimated stream resumes after a pause
+        in_capture_ = false;
+        stream_.resync();
+      }
+      return;
+    }
+    record(stream_, source_, restart);
+  }
+
+  void record(telemetry::SequenceTracker &tracker, telemetry::Source source,
+              bool restart) {
+    const uint64_t lost_before = tracker.lostFrames();
+    const uint32_t stride =
+        tracker.add(batch_.first_sequence, batch_.frame_count, restart);
+    if (writer_ != nullptr) {
+      writer_->append(batch_, stride != 0U ? stride : default_stride_, source,
+                      static_cast<uint32_t>(tracker.lostFrames() - lost_before));
+    }
+  }
+
+  telemetry::Source source_;
+  telemetry::CaptureWriter *writer_;
+  uint32_t default_stride_; ///< Until the tracker knows the stride
+  telemetry::SequenceTracker stream_;
+  telemetry::SequenceTracker capture_;
+  telemetry::CaptureWindow window_;
+  bool in_capture_ = false;
+  telemetry::SampleBatch batch_;
+};
+
+void report(const Receiver &rx, const Counters &last, double seconds,
+            const char *prefix) {
+  const Counters &c = rx.counters;
+  const double rx_bytes = static_cast<double>(c.rx_bytes - last.rx_bytes);
+  const double decode_s = c.decode_s - last.decode_s;
+  std::fprintf(stderr,
+               "%srx %.1f kB/s  decode %.1f MB/s  packets %llu  bad %llu  "
+               "frames %llu  lost %llu  gaps %llu  captures %llu\n",
+               prefix, rx_bytes / 1e3 / seconds,
+               decode_s > 0.0 ? rx_bytes / 1e6 / decode_s : 0.0,
+               static_cast<unsigned long long>(c.packets),
+               static_cast<unsigned long long>(c.bad_packets),
+               static_cast<unsigned long long>(rx.frames()),
+               static_cast<unsigned long long>(rx.lost()),
+               static_cast<unsigned long long>(rx.gaps()),
+               static_cast<unsigned long long>(c.captures));
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  Options opt;
+  if (!parseOptions(argc, argv, opt)) {
+    usage();
+    return 2;
+  }
+  if (!opt.info.empty()) {
+    return printInfo(opt.info);
+  }
+
+  std::signal(SIGINT, onSignal);
+  std::signal(SIGTERM, onSignal);
+
+  const bool udp = opt.source.rfind("udp:", 0) == 0;
+  const bool tty = opt.source.rfind("/dev/tty", 0) == 0;
+  telemetry::Source source = telemetry::Source::serial;
+  if (udp) {
+    source = telemetry::Source::udp;
+  } else if (opt.usb || opt.source.rfind("/dev/ttyACM", 0) == 0) {
+    source = telemetry::Source::usb;
+  }
+
+  telemetry::UdpReceiver udp_rx;
+  int fd = -1;
+  if (udp) {
+    const auto port =
+        static_cast<uint16_t>(std::strtoul(opt.source.c_str() + 4, nullptr, 10));
+    if (!udp_rx.bind(port)) {
+      std::perror(opt.source.c_str());
+      return 1;
+    }
+  } else {
+    fd = tty ? telemetry::openSerial(opt.source, opt.baud)
+             : telemetry::openStream(opt.source);
+    if (fd < 0) {
+      std::perror(opt.source.c_str());
+      return 1;
+    }
+  }
+
+  telemetry::CaptureWriter writer;
+  if (!opt.output.empty() && !writer.open(opt.output, opt.block_frames)) {
+    std::perror(opt.output.c_str());
+    return 1;
+  }
+
+  Receiver rx(source, opt.decimation, writer.isOpen() ? &writer : nullptr);
+  telemetry::Deframer deframer;
+  std::vector<uint8_t> buf(telemetry::read_chunk);
+  const auto on_packet = [&rx](const uint8_t *p, size_t len) {
+    rx.onPacket(p, len);
+  };
+
+  const auto start = Clock::now();
+  auto last_report = start;
+  Counters last;
+  const int poll_ms = static_cast<int>(opt.report_ms < 100U ? opt.report_ms
+                                                            : 100U);
+  while (stop_requested == 0) {
+    bool eof = false;
+    if (udp) {
+      const int n = udp_rx.receive(poll_ms);
+      const auto t1 = Clock::now();
+      eof = n < 0;
+      for (int i = 0; i < n; i++) {
+        rx.counters.rx_bytes += udp_rx.size(i);
+        rx.onDatagram(udp_rx.data(i), udp_rx.size(i));
+      }
+      rx.counters.decode_s +=
+          std::chrono::duration<double>(Clock::now() - t1).count();
+    } else {
+      const long n = telemetry::readSome(fd, buf.data(), buf.size(), poll_ms);
+      const auto t1 = Clock::now();
+      eof = n < 0;
+      if (n > 0) {
+        rx.counters.rx_bytes += static_cast<uint64_t>(n);
+        deframer.feed(buf.data(), static_cast<size_t>(n), on_packet);
+      }
+      rx.counters.decode_s +=
+          std::chrono::duration<double>(Clock::now() - t1).count();
+    }
+
+    const auto now = Clock::now();
+    const double since =
+        std::chrono::duration<double>(now - last_report).count();
+    if (since * 1000.0 >= opt.report_ms) {
+      report(rx, last, since, "");
+      last = rx.counters;
+      last_report = now;
+    }
+    if (eof) {
+      break;
+    }
+  }
+
+  if (fd > STDIN_FILENO) {
+    ::close(fd);
+  }
+  const bool closed = writer.close();
+  Counters zero;
+  const double total =
+      std::chrono::duration<double>(Clock::now() - start).count();
+  report(rx, zero, total > 0.0 ? total : 1.0, "total: ");
+  if (deframer.oversize() != 0U || deframer.malformed() != 0U) {
+    std::fprintf(stderr, "deframer: %llu oversize, %llu malformed\n",
+                 static_cast<unsigned long long>(deframer.oversize()),
+                 static_cast<unsigned long long>(deframer.malformed()));
+  }
+  if (!opt.output.empty()) {
+    std::fprintf(stderr, "%s: %llu blocks%s\n", opt.output.c_str(),
+                 static_cast<unsigned long long>(writer.blocks()),
+                 closed ? "" : " (close failed)");
+  }
+  return closed ? 0 : 1;
+}
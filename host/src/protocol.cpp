@@ -0,0 +1,228 @@
+/**
+ ******************************************************************************
+ * @file    protocol.cpp
+ * @brief   Implementation of the host-side telemetry decoder
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "protocol.hpp"
+
+#include <array>
+
+namespace telemetry {
+
+namespace {
+
+/* Private constants ----------------------------------------------------------*/
+
+constexpr uint8_t v1_channel_bits = 0x3FU;
+constexpr size_t v1_samples_offset = 19U;
+constexpr size_t v2_samples_offset = 26U;
+constexpr size_t udp_fixed_size = 32U; ///< Header and PTP fields without m
+constexpr uint8_t udp_version = 2U;
+
+/* Private functions ----------------------------------------------------------*/
+
+uint16_t le16(const uint8_t *p) {
+  return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+uint32_t le32(const uint8_t *p) {
+  return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+         (static_cast<uint32_t>(p[2]) << 16) |
+         (static_cast<uint32_t>(p[3]) << 24);
+}
+
+uint64_t le64(const uint8_t *p) {
+  return static_cast<uint64_t>(le32(p)) |
+         (static_cast<uint64_t>(le32(p + 4)) << 32);
+}
+
+std::array<uint16_t, 256> makeCrcTable() {
+  std::array<uint16_t, 256> table{};
+  for (uint32_t i = 0; i < 256U; i++) {
+    uint16_t crc = static_cast<uint16_t>(i << 8);
+    for (int bit = 0; bit < 8; bit++) {
+      crc = static_cast<uint16_t>((crc & 0x8000U) ? (crc << 1) ^ 0x1021U
+                                                  : (crc << 1));
+    }
+    table[i] = crc;
+  }
+  return table;
+}
+
+const std::array<uint16_t, 256> crc_table = makeCrcTable();
+
+uint32_t popcount(uint32_t v) {
+  return static_cast<uint32_t>(__builtin_popcount(v));
+}
+
+/**
+ * @brief Unpack count 12-bit codes, two per three bytes
+ */
+void unpack12(const uint8_t *in, size_t count, uint16_t *out) {
+  size_t i = 0;
+  for (; i + 1U < count; i += 2U) {
+    out[i] = static_cast<uint16_t>(in[0] | ((in[1] & 0x0FU) << 8));
+    out[i + 1U] = static_cast<uint16_t>((in[1] >> 4) | (in[2] << 4));
+    in += 3;
+  }
+  if (i < count) {
+    out[i] = static_cast<uint16_t>(in[0] | ((in[1] & 0x0FU) << 8));
+  }
+}
+
+size_t packedSize(size_t count) { return (count / 2U) * 3U + (count & 1U) * 2U; }
+
+} // namespace
+
+/* Public functions -----------------------------------------------------------*/
+
+uint16_t crc16(const uint8_t *data, size_t len) {
+  uint16_t crc = 0xFFFFU;
+  for (size_t i = 0; i < len; i++) {
+    crc = static_cast<uint16_t>((crc << 8) ^
+                                crc_table[((crc >> 8) ^ data[i]) & 0xFFU]);
+  }
+  return crc;
+}
+
+bool parseHeader(const uint8_t *p, size_t len, Header &h) {
+  if (len < header_size + crc_size) {
+    return false;
+  }
+  const size_t body = len - crc_size;
+  if (crc16(p, body) != le16(p + body)) {
+    return false;
+  }
+  if (le16(p) != frame_sync || p[2] < 1U || p[2] > 2U) {
+    return false;
+  }
+  h.version = p[2];
+  h.type = p[3];
+  h.sequence = le32(p + 4);
+  h.timestamp = le32(p + 8);
+  return true;
+}
+
+bool decodeSamples(const uint8_t *p, size_t len, const Header &h,
+                   SampleBatch &batch) {
+  const size_t body = len - crc_size;
+  uint32_t mask = 0;
+  size_t offset = 0;
+  if (h.version == 1U) {
+    if (body < v1_samples_offset) {
+      return false;
+    }
+    mask = p[12] & v1_channel_bits;
+    batch.flags = static_cast<uint8_t>(p[12] & (flag_clipped | flag_rate_change));
+    batch.frame_count = p[13];
+    batch.error_bitmap = le32(p + 15);
+    offset = v1_samples_offset;
+  } else {
+    if (body < v2_samples_offset) {
+      return false;
+    }
+    batch.flags = static_cast<uint8_t>(p[12] & (flag_clipped | flag_rate_change));
+    batch.frame_count = p[13];
+    mask = le32(p + 14);
+    batch.error_bitmap = le32(p + 22);
+    offset = v2_samples_offset;
+  }
+
+  const uint32_t k = popcount(mask);
+  const size_t count = static_cast<size_t>(k) * batch.frame_count;
+  if (k == 0U || offset + packedSize(count) != body) {
+    return false;
+  }
+  batch.column_count = 0;
+  for (uint32_t ch = 0; ch < max_columns; ch++) {
+    if ((mask >> ch) & 1U) {
+      batch.column_channel[batch.column_count++] = static_cast<uint8_t>(ch);
+    }
+  }
+  batch.first_sequence = h.sequence;
+  batch.time = h.timestamp;
+  batch.samples.resize(count);
+  unpack12(p + offset, count, batch.samples.data());
+  return true;
+}
+
+bool decodeRate(const uint8_t *p, size_t len, uint32_t &decimation) {
+  if (len != header_size + 11U + crc_size) {
+    return false;
+  }
+  decimation = le16(p + 16);
+  return decimation != 0U;
+}
+
+bool decodeEvent(const uint8_t *p, size_t len, CaptureWindow &window) {
+  if (len != header_size + 12U + crc_size) {
+    return false;
+  }
+  window.frame_count = le16(p + 18);
+  window.first_frame = le32(p + 20);
+  return true;
+}
+
+bool decodeUdpBlock(const uint8_t *d, size_t len, SampleBatch &batch) {
+  if (len < udp_fixed_size || d[0] != udp_version) {
+    return false;
+  }
+  const uint32_t k = d[1];
+  const size_t m = (static_cast<size_t>(k) + 7U) / 8U * 8U;
+  const uint32_t frames = le16(d + 2);
+  const size_t count = static_cast<size_t>(k) * frames;
+  if (k == 0U || k > max_columns ||
+      len != udp_fixed_size + m + 2U * count) {
+    return false;
+  }
+  batch.first_sequence = le32(d + 4);
+  batch.time = le64(d + 8);
+  batch.frame_count = frames;
+  batch.column_count = k;
+  std::memcpy(batch.column_channel, d + 20, k);
+  batch.error_bitmap = 0;
+  batch.flags = 0;
+  batch.samples.resize(count);
+  std::memcpy(batch.samples.data(), d + udp_fixed_size + m, 2U * count);
+  return true;
+}
+
+/* SequenceTracker ------------------------------------------------------------*/
+
+uint32_t SequenceTracker::add(uint32_t first, uint32_t frames, bool restart) {
+  frames_ += frames;
+  if (announced_ != 0U) {
+    stride_ = announced_;
+    announced_ = 0;
+    restart = true;
+  } else if (restart) {
+    stride_ = 0; // rate changed without a rate packet: learn it again
+  }
+
+  if (have_last_ && !restart) {
+    const uint32_t delta = first - last_first_;
+    if (stride_ == 0U && delta != 0U && delta % last_frames_ == 0U) {
+      // Assumes nothing was lost between the first two batches
+      stride_ = delta / last_frames_;
+    } else if (stride_ != 0U) {
+      const uint32_t expected = last_first_ + last_frames_ * stride_;
+      const int32_t ahead = static_cast<int32_t>(first - expected);
+      if (ahead > 0) {
+        lost_frames_ += static_cast<uint32_t>(ahead) / stride_;
+        gaps_++;
+      } else if (ahead < 0) {
+        resets_++; // board restarted, or a replay
+      }
+    }
+  }
+  have_last_ = true;
+  last_first_ = first;
+  last_frames_ = frames;
+  return stride_;
+}
+
+} // namespace telemetry
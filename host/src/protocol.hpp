@@ -0,0 +1,277 @@
+/**
+ ******************************************************************************
+ * @file    protocol.hpp
+ * @brief   Host-side decoder of the telemetry protocol: COBS deframing,
+ *          CRC, samples packets and UDP blocks, sequence gap tracking
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * The wire format is specified in docs/telemetry_protocol.md; this is the
+ * C++ counterpart of its Python reference decoder, written for full-rate
+ * streams. The deframer takes whatever a batched read returned, finds the
+ * 0x00 delimiters with memchr and COBS-decodes each packet once, straight
+ * from the read buffer unless it straddles two reads. The CRC is table
+ * driven. Only the packets the receiver acts on are decoded: samples
+ * (type 1), event (type 5) and rate (type 9); every other valid packet is
+ * counted and passed on undecoded.
+ *
+ * Usage Example:
+ *   telemetry::Deframer deframer;
+ *   telemetry::SampleBatch batch;
+ *   deframer.feed(buf, n, [&](const uint8_t *p, size_t len) {
+ *     telemetry::Header h;
+ *     if (telemetry::parseHeader(p, len, h) &&
+ *         h.type == telemetry::type_samples &&
+ *         telemetry::decodeSamples(p, len, h, batch)) {
+ *       ...
+ *     }
+ *   });
+ ******************************************************************************
+ */
+
+#ifndef TELEMETRY_PROTOCOL_HPP
+#define TELEMETRY_PROTOCOL_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace telemetry {
+
+/* Wire constants -------------------------------------------------------------*/
+
+constexpr uint16_t frame_sync = 0xA55AU;
+constexpr size_t header_size = 12U;
+constexpr size_t crc_size = 2U;
+constexpr uint32_t max_columns = 32U; ///< Samples per frame, both transports
+
+constexpr uint8_t type_samples = 1U;
+constexpr uint8_t type_event = 5U;
+constexpr uint8_t type_rate = 9U;
+
+constexpr uint8_t flag_clipped = 0x40U;
+constexpr uint8_t flag_rate_change = 0x80U;
+
+/* Decoded content ------------------------------------------------------------*/
+
+/**
+ * @brief Fields every packet starts with
+ */
+struct Header {
+  uint8_t version = 0;
+  uint8_t type = 0;
+  uint32_t sequence = 0;
+  uint32_t timestamp = 0; ///< HAL tick, ms
+};
+
+/**
+ * @brief Frames of one samples packet or UDP block, frame by frame
+ */
+struct SampleBatch {
+  uint32_t first_sequence = 0;
+  uint32_t frame_count = 0;
+  uint32_t column_count = 0;              ///< Samples per frame
+  uint8_t column_channel[max_columns] = {}; ///< Channel of each sample slot
+  uint32_t error_bitmap = 0;              ///< Bit i = frame i had an error
+  uint8_t flags = 0;                      ///< flag_clipped, flag_rate_change
+  uint64_t time = 0; ///< Header timestamp (ms), or block_time ticks (UDP)
+  std::vector<uint16_t> samples;          ///< frame_count x column_count
+};
+
+/**
+ * @brief A trigger capture announced by an event packet: its frames follow
+ *        as samples packets one sequence number apart
+ */
+struct CaptureWindow {
+  uint32_t first_frame = 0;
+  uint32_t frame_count = 0;
+};
+
+/* Functions ------------------------------------------------------------------*/
+
+/**
+ * @brief CRC-16/CCITT-FALSE, as telemetryFrame_crc16()
+ */
+uint16_t crc16(const uint8_t *data, size_t len);
+
+/**
+ * @brief Check length, CRC, sync and version of a decoded packet and read
+ *        its header
+ */
+bool parseHeader(const uint8_t *p, size_t len, Header &h);
+
+/**
+ * @brief Unpack a type 1 packet (version 1 or 2) into batch
+ */
+bool decodeSamples(const uint8_t *p, size_t len, const Header &h,
+                   SampleBatch &batch);
+
+/**
+ * @brief Decimation of a type 9 packet
+ */
+bool decodeRate(const uint8_t *p, size_t len, uint32_t &decimation);
+
+/**
+ * @brief Capture range of a type 5 packet
+ */
+bool decodeEvent(const uint8_t *p, size_t len, CaptureWindow &window);
+
+/**
+ * @brief Unpack a UDP block datagram (version 2) into batch
+ */
+bool decodeUdpBlock(const uint8_t *d, size_t len, SampleBatch &batch);
+
+/* Deframer -------------------------------------------------------------------*/
+
+/**
+ * @brief Splits a byte stream on 0x00 and COBS-decodes each chunk
+ */
+class Deframer {
+public:
+  explicit Deframer(size_t max_packet = 4096U)
+      : max_packet_(max_packet), packet_(max_packet) {
+    partial_.reserve(max_packet);
+  }
+
+  /**
+   * @brief Feed the bytes of one read; on_packet(p, len) gets every
+   *        complete decoded packet, valid or not
+   */
+  template <class OnPacket>
+  void feed(const uint8_t *data, size_t len, OnPacket &&on_packet) {
+    const uint8_t *end = data + len;
+    while (data < end) {
+      const uint8_t *zero = static_cast<const uint8_t *>(
+          std::memchr(data, 0, static_cast<size_t>(end - data)));
+      const uint8_t *stop = (zero != nullptr) ? zero : end;
+      const size_t n = static_cast<size_t>(stop - data);
+
+      if (zero != nullptr && partial_.empty() && !overflow_) {
+        // Whole chunk inside this read: decode it where it is
+        emit(data, n, on_packet);
+      } else if (!overflow_) {
+        if (partial_.size() + n > max_packet_) {
+          overflow_ = true;
+          partial_.clear();
+        } else {
+          partial_.insert(partial_.end(), data, stop);
+        }
+        if (zero != nullptr) {
+          emit(partial_.data(), partial_.size(), on_packet);
+        }
+      }
+      if (zero == nullptr) {
+        return;
+      }
+      if (overflow_) {
+        oversize_++;
+      }
+      partial_.clear();
+      overflow_ = false;
+      data = zero + 1;
+    }
+  }
+
+  uint64_t oversize() const { return oversize_; }   ///< Chunks too long
+  uint64_t malformed() const { return malformed_; } ///< Bad COBS codes
+
+private:
+  template <class OnPacket>
+  void emit(const uint8_t *chunk, size_t n, OnPacket &on_packet) {
+    if (n == 0U) {
+      return; // back-to-back delimiters
+    }
+    if (n > max_packet_) {
+      oversize_++;
+      return;
+    }
+    size_t out = 0;
+    if (!cobsDecode(chunk, n, packet_.data(), out)) {
+      malformed_++;
+      return;
+    }
+    on_packet(static_cast<const uint8_t *>(packet_.data()), out);
+  }
+
+  static bool cobsDecode(const uint8_t *in, size_t n, uint8_t *out,
+                         size_t &out_len) {
+    size_t i = 0;
+    size_t o = 0;
+    while (i < n) {
+      const uint8_t code = in[i++];
+      const size_t run = static_cast<size_t>(code) - 1U;
+      if (code == 0U || i + run > n) {
+        return false;
+      }
+      std::memcpy(&out[o], &in[i], run);
+      o += run;
+      i += run;
+      if (code != 0xFFU && i < n) {
+        out[o++] = 0;
+      }
+    }
+    out_len = o;
+    return true;
+  }
+
+  size_t max_packet_;
+  std::vector<uint8_t> packet_;
+  std::vector<uint8_t> partial_;
+  bool overflow_ = false;
+  uint64_t oversize_ = 0;
+  uint64_t malformed_ = 0;
+};
+
+/* Sequence tracking ----------------------------------------------------------*/
+
+/**
+ * @brief Frames lost between consecutive batches of one stream
+ *
+ * Frames of a batch are stride sequence numbers apart (the stream
+ * decimation on the UART, 1 on USB and UDP). The stride comes from rate
+ * packets when there are any and is learned from the first two batches
+ * otherwise; a batch flagged as the first at a new rate starts over.
+ */
+class SequenceTracker {
+public:
+  explicit SequenceTracker(uint32_t stride = 0) : stride_(stride) {}
+
+  /**
+   * @brief Account one batch; returns its stride (0 = not known yet)
+   */
+  uint32_t add(uint32_t first, uint32_t frames, bool restart);
+
+  /**
+   * @brief Stride announced by a rate packet, from the next batch on
+   */
+  void setStride(uint32_t stride) { announced_ = stride; }
+
+  /**
+   * @brief Take the next batch as is, e.g. after the decimated stream paused
+   *        for a trigger capture
+   */
+  void resync() { have_last_ = false; }
+
+  uint64_t lostFrames() const { return lost_frames_; }
+  uint64_t gaps() const { return gaps_; }         ///< Batches after a loss
+  uint64_t resets() const { return resets_; }     ///< Backwards jumps
+  uint64_t frames() const { return frames_; }
+
+private:
+  uint32_t stride_;
+  uint32_t announced_ = 0;
+  bool have_last_ = false;
+  uint32_t last_first_ = 0;
+  uint32_t last_frames_ = 0;
+  uint64_t lost_frames_ = 0;
+  uint64_t gaps_ = 0;
+  uint64_t resets_ = 0;
+  uint64_t frames_ = 0;
+};
+
+} // namespace telemetry
+
+#endif /* TELEMETRY_PROTOCOL_HPP */
@@ -0,0 +1,1029 @@
+/**
+ ******************************************************************************
+ * @file    bench_adc.c
+ * @brief   Benchmarks of the acquisition paths of adc_conversions.c
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * Each benchmark starts from simHal_init() (the CubeMX configuration) and
+ * leaves the helper back in polling mode. One iteration is one DMA block,
+ * one polled frame (also queued asynchronously) or one injected read. The
+ * fault benchmarks arm a simHal_injectFault() per iteration and report what
+ * the helper counted, so a regression in the error paths shows up in the
+ * counters as well as in the timings.
+ *
+ ******************************************************************************
+ */
+
+#include "adc.h"
+#include "adc_range.h"
+#include "adc_ring.h"
+#include "bench_common.h"
+#include "block_pool.h"
+#include "dwt_profiler.h"
+#include "interlock.h"
+#include "isr_budget.h"
+#include <math.h>
+#include <string.h>
+
+/* Private variables ---------------------------------------------------------*/
+static volatile uint32_t sink;
+
+/* Private functions ---------------------------------------------------------*/
+
+static void bench_blockCallback(const uint16_t *block, uint32_t frame_count,
+                                void *ctx) {
+  (void)ctx;
+  sink += block[0] + frame_count;
+}
+
+static void bench_captureCallback(const uint16_t *samples, uint32_t count,
+                                  void *ctx) {
+  (void)ctx;
+  sink += samples[count - 1U];
+}
+
+/**
+ * @brief Stream blocks of a length in one multimode, one DMA half per
+ *        iteration
+ */
+static void bench_streamBlocks(SimBench_State_t *state, ADC_Multimode_t mode,
+                               uint8_t timed, uint32_t frames) {
+  Profiler_Stats_t hand_off;
+
+  bench_initHal();
+  profiler_init();
+  analogSensor_registerBlockCallback(bench_blockCallback, NULL);
+  if (analogSensor_setBlockFrames(frames) != HAL_OK ||
+      analogSensor_setMultimode(mode) != HAL_OK ||
+      (timed ? analogSensor_startTimedDMA(BENCH_FRAME_RATE_HZ)
+             : analogSensor_startDMA()) != HAL_OK) {
+    simBench_skipWithError(state, "DMA start failed");
+    return;
+  }
+  while (simBench_keepRunning(state)) {
+    simHal_runBlocks(1);
+  }
+  simBench_setCounter(state, "dropped", analogSensor_getDroppedBlocks());
+  // The time above includes the signal model; the probe is the helper alone
+  if (profiler_getStats(PROFILER_PROBE_DMA_CALLBACK, &hand_off) == HAL_OK &&
+      hand_off.count != 0U) {
+    simBench_setCounter(state, "callback_cycles",
+                        (double)hand_off.total / hand_off.count);
+    simBench_setCounter(state, "frame_cycles",
+                        (double)hand_off.total / hand_off.count / frames);
+  }
+  analogSensor_stopDMA();
+  analogSensor_registerBlockCallback(NULL, NULL);
+  analogSensor_setMultimode(ADC_MULTI_INDEPENDENT);
+  analogSensor_setBlockFrames(ADC_CONVERSIONS_BLOCK_FRAMES);
+  simBench_setItemsProcessed(state, simBench_iterations(state) * frames);
+  simBench_setBytesProcessed(state, simBench_iterations(state) * frames *
+                                        ADC_CONVERSIONS_CHANNEL_COUNT *
+                                        sizeof(uint16_t));
+}
+
+/**
+ * @brief Block callback of the pool benchmark: keep each block for
+ *        BENCH_POOL_HOLD blocks, like a transport waiting for TX-complete
+ */
+#define BENCH_POOL_HOLD 4U
+static BlockPool_Block_t *pool_held[BENCH_POOL_HOLD];
+static uint32_t pool_next = 0;
+
+static void bench_poolCallback(const uint16_t *block, uint32_t frame_count,
+                               void *ctx) {
+  (void)ctx;
+  BlockPool_Block_t *blk = blockPool_fromData(block);
+  uint32_t k = pool_next++ % BENCH_POOL_HOLD;
+  blockPool_release(pool_held[k]);
+  blockPool_retain(blk);
+  pool_held[k] = blk;
+  sink += block[0] + frame_count;
+}
+
+/* Benchmarks ----------------------------------------------------------------*/
+
+SIM_BENCH(BM_dmaBlockIndependent) {
+  bench_streamBlocks(state, ADC_MULTI_INDEPENDENT, 1,
+                     ADC_CONVERSIONS_BLOCK_FRAMES);
+}
+
+SIM_BENCH(BM_dmaBlockDual) {
+  bench_streamBlocks(state, ADC_MULTI_DUAL_SIMULT, 1,
+                     ADC_CONVERSIONS_BLOCK_FRAMES);
+}
+
+SIM_BENCH(BM_dmaBlockTriple) {
+  bench_streamBlocks(state, ADC_MULTI_TRIPLE_SIMULT, 1,
+                     ADC_CONVERSIONS_BLOCK_FRAMES);
+}
+
+SIM_BENCH(BM_dmaBlockContinuous) {
+  bench_streamBlocks(state, ADC_MULTI_INDEPENDENT, 0,
+                     ADC_CONVERSIONS_BLOCK_FRAMES);
+}
+
+// "preset latency": the per-block cost spread over a few frames
+SIM_BENCH(BM_dmaBlockShort) {
+  bench_streamBlocks(state, ADC_MULTI_TRIPLE_SIMULT, 1,
+                     ADC_CONVERSIONS_MIN_BLOCK_FRAMES);
+}
+
+/**
+ * @brief Block callback of the resolution benchmark: every code must be an
+ *        8-bit one widened by repeating its top bits
+ */
+static void bench_resolutionCheck(const uint16_t *block, uint32_t frame_count,
+                                  void *ctx) {
+  uint32_t *bad = ctx;
+  for (uint32_t i = 0; i < frame_count * ADC_CONVERSIONS_CHANNEL_COUNT; i++) {
+    if ((block[i] & 0x0FU) != (block[i] >> 8)) {
+      (*bad)++;
+    }
+  }
+  sink += block[0];
+}
+
+// ADC1 alone at 8 bits: the same scan on fewer ADCCLK cycles per rank
+SIM_BENCH(BM_dmaBlockResolution8) {
+  static uint32_t bad;
+
+  bad = 0;
+  bench_initHal();
+  const uint32_t prescaler = hadc1.Init.ClockPrescaler;
+  const uint32_t rate_12 = analogSensor_getMaxFrameRate(prescaler);
+  analogSensor_registerBlockCallback(bench_resolutionCheck, &bad);
+  if (analogSensor_setResolution(0, ADC_RESOLUTION_8B) != HAL_OK ||
+      analogSensor_startTimedDMA(BENCH_FRAME_RATE_HZ) != HAL_OK) {
+    analogSensor_setResolution(0, ADC_RESOLUTION_12B);
+    simBench_skipWithError(state, "DMA start failed");
+    return;
+  }
+  const uint32_t rate_8 = analogSensor_getMaxFrameRate(prescaler);
+  while (simBench_keepRunning(state)) {
+    simHal_runBlocks(1);
+  }
+  analogSensor_stopDMA();
+  analogSensor_registerBlockCallback(NULL, NULL);
+  analogSensor_setResolution(0, ADC_RESOLUTION_12B);
+  simBench_setCounter(state, "max_rate_12b", rate_12);
+  simBench_setCounter(state, "max_rate_8b", rate_8);
+  simBench_setCounter(state, "unrescaled", bad);
+  simBench_setCounter(state, "dropped", analogSensor_getDroppedBlocks());
+  simBench_setItemsProcessed(state, simBench_iterations(state) *
+                                        ADC_CONVERSIONS_BLOCK_FRAMES);
+}
+
+SIM_BENCH(BM_dmaBlockPool) {
+  BlockPool_Stats_t pool;
+
+  bench_initHal();
+  profiler_init();
+  pool_next = 0;
+  analogSensor_registerBlockCallback(bench_poolCallback, NULL);
+  if (analogSensor_setMultimode(ADC_MULTI_TRIPLE_SIMULT) != HAL_OK ||
+      analogSensor_setBlockPool(1) != HAL_OK ||
+      analogSensor_startTimedDMA(BENCH_FRAME_RATE_HZ) != HAL_OK) {
+    simBench_skipWithError(state, "DMA start failed");
+    return;
+  }
+  while (simBench_keepRunning(state)) {
+    simHal_runBlocks(1);
+  }
+  blockPool_getStats(&pool);
+  simBench_setCounter(state, "pool_high_water", pool.high_water);
+  simBench_setCounter(state, "pool_failures", pool.failures);
+  simBench_setCounter(state, "starved", analogSensor_getPoolStarved());
+  analogSensor_stopDMA();
+  for (uint32_t k = 0; k < BENCH_POOL_HOLD; k++) {
+    blockPool_release(pool_held[k]);
+    pool_held[k] = NULL;
+  }
+  blockPool_getStats(&pool);
+  simBench_setCounter(state, "pool_leaked", pool.in_use);
+  analogSensor_setBlockPool(0);
+  analogSensor_registerBlockCallback(NULL, NULL);
+  analogSensor_setMultimode(ADC_MULTI_INDEPENDENT);
+  simBench_setItemsProcessed(state, simBench_iterations(state) *
+                                        ADC_CONVERSIONS_BLOCK_FRAMES);
+}
+
+static uint32_t staged_applied_at;
+
+static void bench_configApplied(uint32_t first_frame, void *ctx) {
+  (void)ctx;
+  staged_applied_at = first_frame;
+}
+
+/**
+ * @brief Swap rate and profiles into the running scan each iteration; the
+ *        flagged ring frame must be the one stageConfig() predicted
+ */
+SIM_BENCH(BM_stagedConfig) {
+  ADC_ScanConfig_t cfg = {.fields = ADC_SCAN_CONFIG_RATE |
+                                    ADC_SCAN_CONFIG_PROFILES,
+                          .applied = bench_configApplied};
+  ADC_RingEntry_t entry;
+  uint32_t misplaced = 0;
+  uint32_t swaps = 0;
+  uint64_t i = 0;
+
+  bench_initHal();
+  for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+    analogSensor_getChannelProfile(ch, &cfg.profile[ch]);
+  }
+  if (analogSensor_startTimedDMA(BENCH_FRAME_RATE_HZ) != HAL_OK) {
+    simBench_skipWithError(state, "DMA start failed");
+    return;
+  }
+  while (simBench_keepRunning(state)) {
+    uint32_t predicted;
+    const uint8_t slow = (uint8_t)(i++ & 1U);
+    cfg.frame_rate_hz = slow ? BENCH_FRAME_RATE_HZ / 2U : BENCH_FRAME_RATE_HZ;
+    cfg.profile[0].accuracy_bits = slow ? 12U : 8U;
+    if (analogSensor_stageConfig(&cfg, &predicted) != HAL_OK) {
+      misplaced++;
+      continue;
+    }
+    simHal_runBlocks(2);
+    uint32_t flagged = UINT32_MAX;
+    while (adcRing_pop(&entry) == HAL_OK) {
+      if (entry.flags & ADC_RING_FLAG_CONFIG) {
+        flagged = entry.sequence;
+      }
+    }
+    if (flagged != predicted || staged_applied_at != predicted ||
+        analogSensor_getSampleRate() != cfg.frame_rate_hz) {
+      misplaced++;
+    } else {
+      swaps++;
+    }
+  }
+  analogSensor_stopDMA();
+  cfg.profile[0].accuracy_bits = 12U;
+  analogSensor_setChannelProfile(0, &cfg.profile[0]);
+  simBench_setCounter(state, "swaps", swaps);
+  simBench_setCounter(state, "misplaced", misplaced);
+  simBench_setItemsProcessed(state, simBench_iterations(state) * 2U *
+                                        ADC_CONVERSIONS_BLOCK_FRAMES);
+}
+
+/**
+ * @brief Latest-frame snapshot after each block: it must be the ring's
+ *        newest frame, samples and sequence alike
+ */
+SIM_BENCH(BM_latestFrame) {
+  ADC_LatestFrame_t latest;
+  ADC_RingEntry_t entry;
+  ADC_RingEntry_t newest = {0};
+  uint32_t mismatched = 0;
+
+  bench_initHal();
+  if (analogSensor_startTimedDMA(BENCH_FRAME_RATE_HZ) != HAL_OK) {
+    simBench_skipWithError(state, "DMA start failed");
+    return;
+  }
+  while (simBench_keepRunning(state)) {
+    simHal_runBlocks(1);
+    while (adcRing_pop(&entry) == HAL_OK) {
+      newest = entry;
+    }
+    if (analogSensor_getLatestFrame(&latest) != HAL_OK ||
+        latest.sequence != newest.sequence ||
+        memcmp(latest.frame.samples, newest.frame.samples,
+               sizeof(latest.frame.samples)) != 0) {
+      mismatched++;
+    }
+  }
+  analogSensor_stopDMA();
+  simBench_setCounter(state, "mismatched", mismatched);
+  simBench_setItemsProcessed(state, simBench_iterations(state) *
+                                        ADC_CONVERSIONS_BLOCK_FRAMES);
+}
+
+typedef struct {
+  uint32_t calls;
+  uint32_t sum;
+} BenchSubscriber_t;
+
+static void bench_subscriber(const ADC_BlockView_t *view, void *ctx) {
+  BenchSubscriber_t *sub = ctx;
+  sub->calls++;
+  for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+    if (view->channel_mask & (1U << ch)) {
+      sub->sum += analogSensor_viewSample(view, view->frame_count - 1U, ch);
+    }
+  }
+}
+
+static void bench_dispatch(const uint16_t *block, uint32_t frame_count,
+                           void *ctx) {
+  (void)ctx;
+  analogSensor_dispatchBlock(block, frame_count);
+}
+
+/**
+ * @brief A fast (every block, CH0-2) and a slow (every 8th, all channels)
+ *        subscriber on the same stream
+ */
+SIM_BENCH(BM_blockSubscribers) {
+  static BenchSubscriber_t fast;
+  static BenchSubscriber_t slow;
+  memset(&fast, 0, sizeof(fast));
+  memset(&slow, 0, sizeof(slow));
+
+  bench_initHal();
+  analogSensor_subscribe(bench_subscriber, &fast, 0x07U, 1U);
+  analogSensor_subscribe(bench_subscriber, &slow,
+                         (1U << ADC_CONVERSIONS_CHANNEL_COUNT) - 1U, 8U);
+  analogSensor_registerBlockCallback(bench_dispatch, NULL);
+  if (analogSensor_startTimedDMA(BENCH_FRAME_RATE_HZ) != HAL_OK) {
+    simBench_skipWithError(state, "DMA start failed");
+    return;
+  }
+  while (simBench_keepRunning(state)) {
+    simHal_runBlocks(8);
+  }
+  analogSensor_stopDMA();
+  analogSensor_registerBlockCallback(NULL, NULL);
+  analogSensor_unsubscribe(bench_subscriber, &fast);
+  analogSensor_unsubscribe(bench_subscriber, &slow);
+  sink = fast.sum + slow.sum;
+  simBench_setCounter(state, "fast_calls", fast.calls);
+  simBench_setCounter(state, "slow_calls", slow.calls);
+  simBench_setItemsProcessed(state, simBench_iterations(state) * 8U *
+                                        ADC_CONVERSIONS_BLOCK_FRAMES);
+}
+
+SIM_BENCH(BM_pollFrame) {
+  bench_initHal();
+  while (simBench_keepRunning(state)) {
+    analogSensor_operation_all_channels(ADC_CONVERSIONS_CHANNEL_COUNT);
+  }
+  simBench_setCounter(state, "errors", analogSensor_getErrorCount());
+  simBench_setItemsProcessed(state, simBench_iterations(state) *
+                                        ADC_CONVERSIONS_CHANNEL_COUNT);
+}
+
+/**
+ * @brief ADC2 polled as an instance of its own while ADC1 streams the
+ *        independent timed scan; refused while the dual scan owns ADC2
+ */
+SIM_BENCH(BM_ctxPollAdc2) {
+  extern ADC_HandleTypeDef hadc2;
+  static const ADC_ChannelConfTypeDef channels[] = {
+      {.Channel = ADC_CHANNEL_0, .SamplingTime = ADC_SAMPLETIME_15CYCLES},
+      {.Channel = ADC_CHANNEL_1, .SamplingTime = ADC_SAMPLETIME_15CYCLES},
+      {.Channel = ADC_CHANNEL_2, .SamplingTime = ADC_SAMPLETIME_15CYCLES}};
+  static ADC_SensorCtx_t adc2;
+  ADC_ErrorInfo_t errors;
+  uint32_t failed = 0;
+
+  bench_initHal();
+  if (analogSensor_ctxInit(&adc2, &hadc2, channels, 3U) != HAL_OK ||
+      analogSensor_startTimedDMA(BENCH_FRAME_RATE_HZ) != HAL_OK) {
+    simBench_skipWithError(state, "start failed");
+    return;
+  }
+  while (simBench_keepRunning(state)) {
+    if (analogSensor_ctxOperationChannels(&adc2, 0x07U) != HAL_OK) {
+      failed++;
+    }
+  }
+  analogSensor_stopDMA();
+
+  ADC_LatestFrame_t latest;
+  analogSensor_ctxGetLatestFrame(&adc2, &latest);
+  analogSensor_ctxGetErrors(&adc2, &errors);
+  analogSensor_setMultimode(ADC_MULTI_DUAL_SIMULT);
+  analogSensor_startTimedDMA(BENCH_FRAME_RATE_HZ);
+  const uint8_t refused =
+      (analogSensor_ctxOperation(&adc2, 0U) == HAL_BUSY);
+  analogSensor_stopDMA();
+  analogSensor_setMultimode(ADC_MULTI_INDEPENDENT);
+
+  simBench_setCounter(state, "failed", failed);
+  simBench_setCounter(state, "errors", errors.total_errors);
+  simBench_setCounter(state, "frames", latest.sequence + 1U);
+  simBench_setCounter(state, "refused_in_dual", refused);
+  simBench_setItemsProcessed(state, simBench_iterations(state) * 3U);
+}
+
+SIM_BENCH(BM_pollBackends) {
+  Profiler_Stats_t hal;
+  Profiler_Stats_t ll;
+
+  bench_initHal();
+  profiler_init();
+  while (simBench_keepRunning(state)) {
+    analogSensor_benchmarkBackends(1);
+  }
+  // Host cycles at SystemCoreClock: compare the two, not with the board
+  if (profiler_getStats(PROFILER_PROBE_READ_HAL, &hal) == HAL_OK &&
+      profiler_getStats(PROFILER_PROBE_READ_LL, &ll) == HAL_OK &&
+      hal.count != 0U && ll.count != 0U) {
+    simBench_setCounter(state, "hal_cycles", (double)hal.total / hal.count);
+    simBench_setCounter(state, "ll_cycles", (double)ll.total / ll.count);
+  }
+  simBench_setItemsProcessed(state, simBench_iterations(state) * 2U *
+                                        ADC_CONVERSIONS_CHANNEL_COUNT);
+}
+
+static uint32_t sequence_halves;
+
+static void bench_sequenceCallback(const uint16_t *scans, uint32_t scan_count,
+                                   const ADC_ScanSequence_t *seq, void *ctx) {
+  (void)ctx;
+  sink += scans[scan_count * seq->ranks - 1U];
+  sequence_halves++;
+}
+
+/**
+ * @brief CH0 at 4x, CH5 off: one half buffer of scans per iteration
+ */
+SIM_BENCH(BM_weightedSequence) {
+  static const uint8_t weights[ADC_CONVERSIONS_CHANNEL_COUNT] = {4, 1, 1, 1,
+                                                                 1, 1};
+  ADC_ScanSequence_t seq;
+
+  bench_initHal();
+  sequence_halves = 0;
+  if (analogSensor_setSequence(0x1F, weights) != HAL_OK ||
+      analogSensor_getSequence(&seq) != HAL_OK ||
+      analogSensor_startSequence(analogSensor_getSequenceMaxRate() / 2U,
+                                 bench_sequenceCallback, NULL) != HAL_OK) {
+    simBench_skipWithError(state, "sequence start failed");
+    return;
+  }
+  while (simBench_keepRunning(state)) {
+    simHal_runBlocks(1);
+  }
+  analogSensor_stopDMA();
+  analogSensor_setSequence((1U << ADC_CONVERSIONS_CHANNEL_COUNT) - 1U, NULL);
+
+  // Widest distance between two CH0 ranks, around the scan
+  uint32_t spacing = 0;
+  uint32_t prev = UINT32_MAX;
+  for (uint32_t r = 0; r < 2U * seq.ranks; r++) {
+    if (seq.channel[r % seq.ranks] != 0U) {
+      continue;
+    }
+    if (prev != UINT32_MAX && r - prev > spacing) {
+      spacing = r - prev;
+    }
+    prev = r;
+  }
+  simBench_setCounter(state, "ranks", seq.ranks);
+  simBench_setCounter(state, "ch0_spacing", spacing);
+  simBench_setCounter(state, "missed_halves",
+                      (double)simBench_iterations(state) - sequence_halves);
+  simBench_setItemsProcessed(state, simBench_iterations(state) *
+                                        ADC_CONVERSIONS_SEQUENCE_SCANS *
+                                        seq.ranks);
+}
+
+static uint32_t group_handoffs;
+static uint32_t group_misordered;
+static uint8_t group_expected;
+
+static void bench_groupCallback(uint8_t group, const uint16_t *samples,
+                                uint8_t count, uint32_t frame, void *ctx) {
+  (void)frame;
+  (void)ctx;
+  sink += samples[count - 1U];
+  if (group != group_expected) {
+    group_misordered++;
+  }
+  group_expected =
+      (uint8_t)((group + 1U) % (ADC_CONVERSIONS_CHANNEL_COUNT / count));
+  group_handoffs++;
+}
+
+/**
+ * @brief One tri-axis group per iteration, each handed off by its own
+ *        half or full transfer
+ */
+SIM_BENCH(BM_groupedScan) {
+  ADC_LatestFrame_t latest;
+
+  bench_initHal();
+  group_handoffs = 0;
+  group_misordered = 0;
+  group_expected = 0;
+  if (analogSensor_startGrouped(BENCH_FRAME_RATE_HZ,
+                                ADC_CONVERSIONS_GROUP_SIZE,
+                                bench_groupCallback, NULL) != HAL_OK) {
+    simBench_skipWithError(state, "grouped start failed");
+    return;
+  }
+  while (simBench_keepRunning(state)) {
+    simHal_runBlocks(1);
+  }
+  const uint32_t rate = analogSensor_getSampleRate();
+  const uint8_t published = (analogSensor_getLatestFrame(&latest) == HAL_OK);
+  analogSensor_stopDMA();
+
+  const uint32_t groups =
+      ADC_CONVERSIONS_CHANNEL_COUNT / ADC_CONVERSIONS_GROUP_SIZE;
+  simBench_setCounter(state, "groups", groups);
+  simBench_setCounter(state, "misordered", group_misordered);
+  simBench_setCounter(state, "missed",
+                      (double)simBench_iterations(state) - group_handoffs);
+  simBench_setCounter(state, "frames",
+                      published ? (double)latest.sequence + 1.0 : 0.0);
+  simBench_setCounter(state, "frame_hz", rate);
+  simBench_setItemsProcessed(state, simBench_iterations(state) *
+                                        ADC_CONVERSIONS_GROUP_SIZE);
+}
+
+SIM_BENCH(BM_injectedRead) {
+  uint16_t value;
+  uint32_t failures = 0;
+
+  bench_initHal();
+  while (simBench_keepRunning(state)) {
+    if (analogSensor_readInjected(0, &value) != HAL_OK) {
+      failures++;
+    }
+  }
+  simBench_setCounter(state, "failures", failures);
+  simBench_setItemsProcessed(state, simBench_iterations(state));
+}
+
+SIM_BENCH(BM_injectedReadDuringDMA) {
+  uint16_t value;
+  uint32_t failures = 0;
+
+  bench_initHal();
+  if (analogSensor_startTimedDMA(BENCH_FRAME_RATE_HZ) != HAL_OK) {
+    simBench_skipWithError(state, "DMA start failed");
+    return;
+  }
+  while (simBench_keepRunning(state)) {
+    if (analogSensor_readInjected(1, &value) != HAL_OK) {
+      failures++;
+    }
+  }
+  analogSensor_stopDMA();
+  simBench_setCounter(state, "failures", failures);
+  simBench_setItemsProcessed(state, simBench_iterations(state));
+}
+
+static uint32_t async_done;
+static uint32_t async_failed;
+
+static void bench_asyncCallback(uint8_t channel, uint16_t value,
+                                ADC_SampleError_t error, void *ctx) {
+  (void)ctx;
+  sink = channel + value;
+  async_done++;
+  if (error != ADC_SAMPLE_OK) {
+    async_failed++;
+  }
+}
+
+/**
+ * @brief One frame of asynchronous reads, queued at once and run
+ *        back-to-back from the EOC interrupt
+ */
+static void bench_asyncFrames(SimBench_State_t *state) {
+  uint32_t rejected = 0;
+  async_done = 0;
+  async_failed = 0;
+  while (simBench_keepRunning(state)) {
+    for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+      if (analogSensor_operation_async(ch, bench_asyncCallback, NULL) !=
+          HAL_OK) {
+        rejected++;
+      }
+    }
+    while (analogSensor_asyncPending() != 0U) {
+      (void)HAL_GetTick(); // the simulated ADC interrupt
+    }
+  }
+  simBench_setCounter(state, "rejected", rejected);
+  simBench_setCounter(state, "failures", async_failed);
+  simBench_setCounter(state, "callbacks", async_done);
+  simBench_setItemsProcessed(state, simBench_iterations(state) *
+                                        ADC_CONVERSIONS_CHANNEL_COUNT);
+}
+
+SIM_BENCH(BM_asyncRead) {
+  bench_initHal();
+  bench_asyncFrames(state);
+}
+
+SIM_BENCH(BM_asyncReadDuringDMA) {
+  bench_initHal();
+  if (analogSensor_startTimedDMA(BENCH_FRAME_RATE_HZ) != HAL_OK) {
+    simBench_skipWithError(state, "DMA start failed");
+    return;
+  }
+  bench_asyncFrames(state);
+  analogSensor_stopDMA();
+}
+
+SIM_BENCH(BM_capture) {
+  const uint16_t *samples;
+  uint32_t count;
+
+  bench_initHal();
+  while (simBench_keepRunning(state)) {
+    if (analogSensor_startCapture(0, bench_captureCallback, NULL) != HAL_OK) {
+      simBench_skipWithError(state, "capture start failed");
+      return;
+    }
+    simHal_runBlocks(1);
+    if (analogSensor_getCapture(&samples, &count) != HAL_OK) {
+      simBench_skipWithError(state, "capture incomplete");
+      return;
+    }
+    analogSensor_stopDMA();
+  }
+  simBench_setItemsProcessed(state, simBench_iterations(state) *
+                                        ADC_CONVERSIONS_CAPTURE_SAMPLES);
+}
+
+/* Fault scenarios -----------------------------------------------------------*/
+
+SIM_BENCH(BM_faultPollTimeout) {
+  ADC_ConvTiming_t timing;
+
+  bench_initHal();
+  analogSensor_resetErrors();
+  analogSensor_resetConvTiming();
+  while (simBench_keepRunning(state)) {
+    simHal_injectFault(SIM_FAULT_TIMEOUT, 1, 0);
+    analogSensor_operation_all_channels(ADC_CONVERSIONS_CHANNEL_COUNT);
+  }
+  simBench_setCounter(state, "errors", analogSensor_getErrorCount());
+  // The dead channel costs its cycle limit, not a millisecond tick
+  if (analogSensor_getConvTiming(&timing) == HAL_OK) {
+    simBench_setCounter(state, "timeouts", timing.timeouts);
+    simBench_setCounter(state, "limit_cycles", timing.timeout_cycles[0]);
+  }
+  simBench_setItemsProcessed(state, simBench_iterations(state) *
+                                        ADC_CONVERSIONS_CHANNEL_COUNT);
+}
+
+SIM_BENCH(BM_faultInjectedConfig) {
+  uint16_t value;
+  uint32_t failures = 0;
+
+  // The polling path loads register images (ADC_CONVERSIONS_FAST_CONFIG);
+  // the injected read still configures through the HAL every time
+  bench_initHal();
+  while (simBench_keepRunning(state)) {
+    simHal_injectFault(SIM_FAULT_CONFIG, 1, 0);
+    if (analogSensor_readInjected(0, &value) != HAL_OK) {
+      failures++;
+    }
+  }
+  simBench_setCounter(state, "failures", failures);
+  simBench_setItemsProcessed(state, simBench_iterations(state));
+}
+
+SIM_BENCH(BM_faultMissedIrq) {
+  SimHal_Stats_t stats;
+
+  bench_initHal();
+  analogSensor_registerBlockCallback(bench_blockCallback, NULL);
+  if (analogSensor_startTimedDMA(BENCH_FRAME_RATE_HZ) != HAL_OK) {
+    simBench_skipWithError(state, "DMA start failed");
+    return;
+  }
+  while (simBench_keepRunning(state)) {
+    simHal_injectFault(SIM_FAULT_MISSED_IRQ, 1, 0);
+    simHal_runBlocks(2);
+  }
+  simHal_getStats(&stats);
+  simBench_setCounter(state, "missed", stats.faults[SIM_FAULT_MISSED_IRQ]);
+  simBench_setCounter(state, "dropped", analogSensor_getDroppedBlocks());
+  analogSensor_stopDMA();
+  analogSensor_registerBlockCallback(NULL, NULL);
+  simBench_setItemsProcessed(state, simBench_iterations(state) * 2U *
+                                        ADC_CONVERSIONS_BLOCK_FRAMES);
+}
+
+SIM_BENCH(BM_faultOverrun) {
+  bench_initHal();
+  analogSensor_resetErrors();
+  if (analogSensor_startTimedDMA(BENCH_FRAME_RATE_HZ) != HAL_OK) {
+    simBench_skipWithError(state, "DMA start failed");
+    return;
+  }
+  while (simBench_keepRunning(state)) {
+    simHal_injectFault(SIM_FAULT_OVERRUN, 1, 0);
+    simHal_runBlocks(1);
+  }
+  ADC_OverrunInfo_t overrun;
+  analogSensor_getOverrunInfo(&overrun);
+  simBench_setCounter(state, "errors", analogSensor_getErrorCount());
+  simBench_setCounter(state, "recoveries", overrun.recoveries);
+  simBench_setCounter(state, "lost", overrun.frames_lost);
+  analogSensor_stopDMA();
+  simBench_setItemsProcessed(state, simBench_iterations(state) *
+                                        ADC_CONVERSIONS_BLOCK_FRAMES);
+}
+
+SIM_BENCH(BM_faultOverrunPool) {
+  BlockPool_Stats_t pool;
+  ADC_OverrunInfo_t overrun;
+  ADC_BlockInfo_t last;
+
+  bench_initHal();
+  if (analogSensor_setMultimode(ADC_MULTI_TRIPLE_SIMULT) != HAL_OK ||
+      analogSensor_setBlockPool(1) != HAL_OK ||
+      analogSensor_startTimedDMA(BENCH_FRAME_RATE_HZ) != HAL_OK) {
+    simBench_skipWithError(state, "DMA start failed");
+    return;
+  }
+  while (simBench_keepRunning(state)) {
+    simHal_injectFault(SIM_FAULT_OVERRUN, 1, 0);
+    simHal_runBlocks(1);
+  }
+  analogSensor_getOverrunInfo(&overrun);
+  analogSensor_getBlockInfo(&last);
+  simBench_setCounter(state, "recoveries", overrun.recoveries);
+  simBench_setCounter(state, "lost", overrun.frames_lost);
+  // Frames handed off against blocks run: 0 when the sequence kept up
+  simBench_setCounter(state, "seq_skew",
+                      (double)(last.first_frame + last.frame_count) -
+                          (double)simBench_iterations(state) *
+                              ADC_CONVERSIONS_BLOCK_FRAMES);
+  analogSensor_stopDMA();
+  blockPool_getStats(&pool);
+  simBench_setCounter(state, "pool_leaked", pool.in_use);
+  analogSensor_setBlockPool(0);
+  analogSensor_setMultimode(ADC_MULTI_INDEPENDENT);
+  simBench_setItemsProcessed(state, simBench_iterations(state) *
+                                        ADC_CONVERSIONS_BLOCK_FRAMES);
+}
+
+SIM_BENCH(BM_faultRailWatchdog) {
+  bench_initHal();
+  if (analogSensor_configWatchdog(0, 205, 3890) != HAL_OK ||
+      analogSensor_startTimedDMA(BENCH_FRAME_RATE_HZ) != HAL_OK) {
+    simBench_skipWithError(state, "watchdog / DMA start failed");
+    return;
+  }
+  while (simBench_keepRunning(state)) {
+    simHal_injectFault(SIM_FAULT_RAIL_HIGH, 1, 0);
+    analogSensor_armWatchdog();
+    simHal_runBlocks(1);
+  }
+  simBench_setCounter(state, "alarms", analogSensor_getWatchdogAlarms());
+  analogSensor_stopDMA();
+  analogSensor_clearWatchdog(0);
+  simBench_setItemsProcessed(state, simBench_iterations(state) *
+                                        ADC_CONVERSIONS_BLOCK_FRAMES);
+}
+
+/* Three rail samples per block on one input: one episode of 3 clipped
+ * samples, and 3 ring frames flagged */
+SIM_BENCH(BM_clipDetect) {
+  ADC_ClipStats_t clip[ADC_CONVERSIONS_CHANNEL_COUNT];
+  ADC_BlockInfo_t info;
+  ADC_RingEntry_t entry;
+  uint32_t flagged = 0;
+  uint32_t clipped_blocks = 0;
+
+  bench_initHal();
+  adcRing_reset();
+  if (analogSensor_startTimedDMA(BENCH_FRAME_RATE_HZ) != HAL_OK) {
+    simBench_skipWithError(state, "DMA start failed");
+    return;
+  }
+  analogSensor_getClipStats(clip, 1);
+  while (simBench_keepRunning(state)) {
+    simHal_injectFault(SIM_FAULT_RAIL_HIGH, 3, 0);
+    simHal_runBlocks(1);
+    while (adcRing_pop(&entry) == HAL_OK) {
+      flagged += (entry.flags & ADC_RING_FLAG_CLIPPED) ? 1U : 0U;
+    }
+    if (analogSensor_getBlockInfo(&info) == HAL_OK && info.clipped != 0U) {
+      clipped_blocks++;
+    }
+  }
+  analogSensor_stopDMA();
+  analogSensor_getClipStats(clip, 1);
+  uint32_t samples = 0;
+  uint32_t episodes = 0;
+  for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+    samples += clip[ch].samples;
+    episodes += clip[ch].episodes;
+  }
+  simBench_setCounter(state, "clip_samples", samples);
+  simBench_setCounter(state, "episodes", episodes);
+  simBench_setCounter(state, "flagged", flagged);
+  simBench_setCounter(state, "clipped_blocks", clipped_blocks);
+  simBench_setItemsProcessed(state, simBench_iterations(state) *
+                                        ADC_CONVERSIONS_BLOCK_FRAMES);
+}
+
+/* Sensor 1 X behind a LIS344ALH model: 1 g of DC, and every 2 s a 50 Hz
+ * burst of 4 g peak for 0.25 s; the FS pin of group 0 sets its scale */
+typedef struct {
+  GPIO_TypeDef port; // RAM stand-in: BSRR keeps the last word written
+  uint8_t wide;
+} BenchRange_Sensor_t;
+
+static uint16_t bench_rangeSource(uint32_t adc_channel, double t_us,
+                                  void *ctx) {
+  BenchRange_Sensor_t *sensor = ctx;
+  if (sensor->port.BSRR & GPIO_PIN_4) {
+    sensor->wide = 1;
+  } else if (sensor->port.BSRR & (GPIO_PIN_4 << 16)) {
+    sensor->wide = 0;
+  }
+  if (adc_channel != 0U) {
+    return ADC_CAL_NOMINAL_OFFSET;
+  }
+  const double t = fmod(t_us * 1e-6, 2.0);
+  const double mg =
+      1000.0 + ((t < 0.25) ? 4000.0 * sin(2.0 * M_PI * 50.0 * t) : 0.0);
+  const double scale = sensor->wide ? ADC_RANGE_WIDE_SCALE_Q8 / 256.0 : 1.0;
+  const double per_code = ADC_CAL_NOMINAL_MG_PER_CODE * scale;
+  const double code = ADC_CAL_NOMINAL_OFFSET + mg / per_code + 0.5;
+  return (uint16_t)((code < 0.0) ? 0.0 : (code > 4095.0) ? 4095.0 : code);
+}
+
+/* Gain ranging on the model: each burst switches group 0 up (the first
+ * burst block clips on +-2 g), 0.5 s of DC after it switches it back; the
+ * DC must read the same in mg on either range, settling frames voided */
+SIM_BENCH(BM_gainRange) {
+  static BenchRange_Sensor_t sensor;
+  const AdcRange_Config_t cfg = {.port = &sensor.port,
+                                 .pins = {GPIO_PIN_4, GPIO_PIN_5}};
+  ADC_RingEntry_t entry;
+  AdcRange_Stats_t rs;
+  int16_t mg[ADC_CONVERSIONS_CHANNEL_COUNT];
+  double dc_sum[2] = {0.0, 0.0};
+  uint32_t dc_count[2] = {0, 0};
+  uint32_t settling = 0;
+  uint32_t clipped = 0;
+
+  bench_initHal();
+  memset(&sensor, 0, sizeof(sensor));
+  simHal_setSource(bench_rangeSource, &sensor);
+  adcCal_init();
+  adcRing_reset();
+  if (adcRange_init(&cfg) != HAL_OK ||
+      analogSensor_startTimedDMA(BENCH_FRAME_RATE_HZ) != HAL_OK) {
+    simBench_skipWithError(state, "range / DMA start failed");
+    return;
+  }
+  while (simBench_keepRunning(state)) {
+    simHal_runBlocks(1);
+    while (adcRing_pop(&entry) == HAL_OK) {
+      if (entry.flags & ADC_RING_FLAG_SETTLING) {
+        settling++;
+        continue;
+      }
+      clipped += (entry.flags & ADC_RING_FLAG_CLIPPED) ? 1U : 0U;
+      adcRange_convertEntry_q15(&entry, mg);
+      if (mg[0] > 900 && mg[0] < 1100) {
+        dc_sum[entry.range & 1U] += mg[0];
+        dc_count[entry.range & 1U]++;
+      }
+    }
+  }
+  analogSensor_stopDMA();
+  adcRange_getStats(&rs);
+  adcRange_deinit();
+  simBench_setCounter(state, "switches_up", rs.switches_up);
+  simBench_setCounter(state, "switches_down", rs.switches_down);
+  simBench_setCounter(state, "settle_frames", rs.settle_frames);
+  simBench_setCounter(state, "settling", settling);
+  simBench_setCounter(state, "clipped", clipped);
+  simBench_setCounter(state, "dc_narrow_mg",
+                      dc_count[0] ? dc_sum[0] / dc_count[0] : 0.0);
+  simBench_setCounter(state, "dc_wide_mg",
+                      dc_count[1] ? dc_sum[1] / dc_count[1] : 0.0);
+  simBench_setItemsProcessed(state, simBench_iterations(state) *
+                                        ADC_CONVERSIONS_BLOCK_FRAMES);
+}
+
+SIM_BENCH(BM_interlockTrip) {
+  static GPIO_TypeDef port; // RAM stand-in: BSRR keeps the last word written
+  const Interlock_Config_t cfg = {
+      .port = &port, .pin = GPIO_PIN_1, .active_low = 0, .channels = 1U << 0};
+  Interlock_Stats_t lock;
+  uint32_t pin_ok = 0;
+
+  bench_initHal();
+  if (analogSensor_configWatchdog(0, 205, 3890) != HAL_OK ||
+      interlock_init(&cfg) != HAL_OK ||
+      analogSensor_startTimedDMA(BENCH_FRAME_RATE_HZ) != HAL_OK) {
+    simBench_skipWithError(state, "watchdog / interlock / DMA start failed");
+    return;
+  }
+  // One iteration: the watchdog flag as the ADC interrupt finds it, the
+  // handler head, then the release
+  while (simBench_keepRunning(state)) {
+    ADC1->SR |= ADC_SR_AWD;
+    interlock_irqHandler();
+    pin_ok += (port.BSRR == GPIO_PIN_1) ? 1U : 0U;
+    ADC1->SR &= ~ADC_SR_AWD;
+    interlock_reset();
+  }
+  interlock_getStats(&lock);
+  simBench_setCounter(state, "trips", lock.trips);
+  simBench_setCounter(state, "pin_ok", pin_ok);
+  analogSensor_stopDMA();
+  analogSensor_clearWatchdog(0);
+  simBench_setItemsProcessed(state, simBench_iterations(state));
+}
+
+SIM_BENCH(BM_isrBudgetNested) {
+  IsrBudget_Stats_t outer;
+  IsrBudget_Stats_t inner;
+  volatile uint32_t work = 0;
+
+  bench_initHal();
+  isrBudget_init();
+  // One iteration: a TIM5 run pre-empted by an ADC DMA run doing the work;
+  // the TIM5 figure should be the bracket cost only
+  while (simBench_keepRunning(state)) {
+    const IsrBudget_Mark_t tim5 = isrBudget_begin();
+    const IsrBudget_Mark_t dma = isrBudget_begin();
+    for (uint32_t i = 0; i < 256U; i++) {
+      work += i;
+    }
+    isrBudget_end(ISR_BUDGET_ADC_DMA, dma);
+    isrBudget_end(ISR_BUDGET_TIM5, tim5);
+  }
+  isrBudget_getStats(ISR_BUDGET_TIM5, &outer);
+  isrBudget_getStats(ISR_BUDGET_ADC_DMA, &inner);
+  simBench_setCounter(state, "outer_mean_cyc",
+                      outer.count ? (double)outer.total / outer.count : 0.0);
+  simBench_setCounter(state, "inner_mean_cyc",
+                      inner.count ? (double)inner.total / inner.count : 0.0);
+  simBench_setCounter(state, "outer_over", outer.exceeded);
+  simBench_setItemsProcessed(state, simBench_iterations(state));
+}
+
+typedef struct {
+  uint16_t next; ///< Value of the next sample
+  uint32_t blocks;
+} BenchReplay_t;
+
+static HAL_StatusTypeDef bench_replaySource(uint16_t *block,
+                                            uint32_t frame_count, void *ctx) {
+  BenchReplay_t *src = ctx;
+  for (uint32_t i = 0; i < frame_count * ADC_CONVERSIONS_CHANNEL_COUNT; i++) {
+    block[i] = src->next++ & 0x0FFFU;
+  }
+  src->blocks++;
+  return HAL_OK;
+}
+
+static void bench_replayCheck(const uint16_t *block, uint32_t frame_count,
+                              void *ctx) {
+  uint16_t *expect = ctx;
+  for (uint32_t i = 0; i < frame_count * ADC_CONVERSIONS_CHANNEL_COUNT; i++) {
+    if (block[i] != (*expect & 0x0FFFU)) {
+      sink++;
+    }
+    (*expect)++;
+  }
+}
+
+/**
+ * @brief Unpaced replay: one iteration is a block filled, pended and handed
+ *        off as the DMA interrupt would, through the check callback
+ */
+SIM_BENCH(BM_replayBlock) {
+  static BenchReplay_t src;
+  static uint16_t expect;
+  ADC_ReplayStats_t st;
+  ADC_RingEntry_t entry;
+
+  memset(&src, 0, sizeof(src));
+  expect = 0;
+  sink = 0;
+  bench_initHal();
+  analogSensor_registerBlockCallback(bench_replayCheck, &expect);
+  if (analogSensor_startReplay(BENCH_FRAME_RATE_HZ, 0, bench_replaySource,
+                               &src) != HAL_OK) {
+    simBench_skipWithError(state, "replay start failed");
+    return;
+  }
+  while (simBench_keepRunning(state)) {
+    analogSensor_pollReplay();
+    analogSensor_replayIrqHandler();
+    while (adcRing_pop(&entry) == HAL_OK) {
+    }
+  }
+  analogSensor_getReplayStats(&st);
+  const uint32_t mismatched = sink;
+  analogSensor_stopDMA();
+  analogSensor_registerBlockCallback(NULL, NULL);
+  simBench_setCounter(state, "blocks", st.blocks);
+  simBench_setCounter(state, "mismatched", mismatched);
+  simBench_setItemsProcessed(state, simBench_iterations(state) *
+                                        ADC_CONVERSIONS_BLOCK_FRAMES);
+}
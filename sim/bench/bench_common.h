@@ -0,0 +1,50 @@
+/**
+ ******************************************************************************
+ * @file    bench_common.h
+ * @brief   Signal selection shared by the simulation benchmarks
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * Every benchmark converts the same signal: the synthetic default of
+ * sim_wave.h, or the recording given with --replay=<file> (played at
+ * --replay_rate=<Hz>, 4000 by default). bench_main.c parses those two
+ * options and hands the rest to simBench_main().
+ *
+ ******************************************************************************
+ */
+
+#ifndef BENCH_COMMON_H
+#define BENCH_COMMON_H
+
+#include "adc_conversions.h"
+#include "sim_bench.h"
+#include "sim_hal.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Frame rate of the timer-paced benchmarks
+ */
+#define BENCH_FRAME_RATE_HZ 4000U
+
+/**
+ * @brief simHal_init() with the selected signal source attached
+ */
+void bench_initHal(void);
+
+/**
+ * @brief Fill a block of interleaved frames (table channel order) from the
+ *        selected source, frame n at first_frame + n at BENCH_FRAME_RATE_HZ
+ */
+void bench_fillBlock(uint16_t *block, uint32_t frames, uint32_t first_frame);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BENCH_COMMON_H */
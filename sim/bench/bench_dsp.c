@@ -0,0 +1,3407 @@
+/**
+ ******************************************************************************
+ * @file    bench_dsp.c
+ * @brief   Benchmarks of the block processing stages and the frame pipeline
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * One iteration processes one block of ADC_CONVERSIONS_BLOCK_FRAMES frames,
+ * pre-filled from the selected signal so only the stage itself is timed.
+ * The input blocks hold several periods of the signal so the filters and
+ * the trigger see a changing input instead of one repeated frame.
+ *
+ ******************************************************************************
+ */
+
+#include "adaptive_rate.h"
+#include "adc_calibration.h"
+#include "adc_linearity.h"
+#include "adc_ring.h"
+#include "adc_trigger.h"
+#include "bench_common.h"
+#include "dsp_arrival.h"
+#include "dsp_asrc.h"
+#include "dsp_bands.h"
+#include "dsp_baseline.h"
+#include "dsp_coherence.h"
+#include "dsp_dcblock.h"
+#include "dsp_dctrack.h"
+#include "dsp_deinterleave.h"
+#include "dsp_deskew.h"
+#include "dsp_despike.h"
+#include "dsp_filter.h"
+#include "dsp_fused.h"
+#include "dsp_goertzel.h"
+#include "dsp_histogram.h"
+#include "dsp_sdft.h"
+#include "dsp_multirate.h"
+#include "dsp_oversample.h"
+#include "dsp_quality.h"
+#include "dsp_rainflow.h"
+#include "dsp_spectrum.h"
+#include "dsp_spectrum_q15.h"
+#include "dsp_srs.h"
+#include "dsp_stats.h"
+#include "dsp_tsa.h"
+#include "dsp_vector.h"
+#include "dsp_velocity.h"
+#include "dsp_window.h"
+#include "dsp_zoom.h"
+#include "fat_view.h"
+#include "fft_sched.h"
+#include "frame_pack.h"
+#include "modbus_rtu.h"
+#include "nn_anomaly.h"
+#include "pipeline.h"
+#include "sample_codec.h"
+#include "telemetry_frame.h"
+#include "text_format.h"
+#include "wavelet_codec.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define BENCH_DSP_BLOCKS 16U
+
+/* Private variables ---------------------------------------------------------*/
+static uint16_t blocks[BENCH_DSP_BLOCKS][ADC_CONVERSIONS_BLOCK_SAMPLES]
+    __attribute__((aligned(32)));
+static DSP_Filter_t filt;
+static DSP_Oversampler_t os;
+static DSP_Spectrum_t spec;
+static volatile uint32_t sink;
+
+/* The filter and stats benchmarks as one fused branch over all channels */
+static Pipeline_Biquad_t pipe_lp;
+static Pipeline_Decimate_t pipe_dec = {.factor = 8};
+static Pipeline_Stats_t pipe_stats;
+static const Pipeline_Stage_t pipe_stages[] = {
+    PIPELINE_STAGE_BIQUAD(&pipe_lp), PIPELINE_STAGE_DECIMATE(&pipe_dec),
+    PIPELINE_STAGE_STATS(&pipe_stats)};
+static const Pipeline_Branch_t pipe_branches[] = {
+    PIPELINE_BRANCH((1U << ADC_CONVERSIONS_CHANNEL_COUNT) - 1U, pipe_stages)};
+static Pipeline_t pipe;
+
+/* dcblock() ahead of stats, with 1 g of gravity on Z (channel 2) */
+#define BENCH_DCBLOCK_GRAVITY 819U
+static DSP_DcBlock_t dcblock;
+static Pipeline_Stats_t dcblock_stats;
+static const Pipeline_Stage_t dcblock_stages[] = {
+    PIPELINE_STAGE_DCBLOCK(&dcblock), PIPELINE_STAGE_STATS(&dcblock_stats)};
+static const Pipeline_Branch_t dcblock_branches[] = {
+    PIPELINE_BRANCH((1U << ADC_CONVERSIONS_CHANNEL_COUNT) - 1U,
+                    dcblock_stages)};
+static DSP_Fused_t fused;
+static int16_t mg_block[ADC_CONVERSIONS_BLOCK_SAMPLES];
+static float32_t mg_out[ADC_CONVERSIONS_BLOCK_SAMPLES];
+static uint16_t planes[ADC_CONVERSIONS_CHANNEL_COUNT]
+                      [ADC_CONVERSIONS_BLOCK_FRAMES] __attribute__((aligned(32)));
+static volatile uint8_t dma2d_done;
+static uint16_t quiet_block[ADC_CONVERSIONS_BLOCK_SAMPLES];
+static DSP_Multirate_t multirate;
+static DSP_DcTrack_t dctrack;
+static DSP_Window_t sliding;
+
+/* One spike every 64 frames on channel 1 */
+#define BENCH_DESPIKE_SPACING 64U
+#define BENCH_DESPIKE_CODE 4095U
+static DSP_Despike_t despike;
+static uint16_t despike_block[ADC_CONVERSIONS_BLOCK_SAMPLES]
+    __attribute__((aligned(32)));
+
+/* Envelope branch of main.c on channel 0 */
+static Pipeline_Biquad_t env_band;
+static Pipeline_Biquad_t env_lp;
+static Pipeline_Decimate_t env_dec = {.factor = 4};
+static DSP_Spectrum_t env_spec;
+static Pipeline_Spectrum_t env_fft = {.channel = {&env_spec}};
+static const Pipeline_Stage_t env_stages[] = {
+    PIPELINE_STAGE_BIQUAD(&env_band), PIPELINE_STAGE_RECTIFY(),
+    PIPELINE_STAGE_BIQUAD(&env_lp), PIPELINE_STAGE_DECIMATE(&env_dec),
+    PIPELINE_STAGE_SPECTRUM(&env_fft)};
+static const Pipeline_Branch_t env_branches[] = {
+    PIPELINE_BRANCH(0x01U, env_stages)};
+static Pipeline_t env_pipe;
+
+/* 16 bins per channel, windows of 1024 frames: 3.9 Hz bins */
+#define BENCH_GOERTZEL_WINDOW 1024U
+static DSP_Goertzel_t goertzel;
+
+/* 4 bins per channel, windows of 256 frames: the Goertzel tone on bin 3 */
+#define BENCH_SDFT_WINDOW 256U
+static DSP_Sdft_t sdft;
+
+/* 256 bins of 16 codes, as main.c; percentiles against the sorted codes */
+#define BENCH_HISTOGRAM_SHIFT 4U
+static DSP_Histogram_t hist;
+static DSP_HistogramSnapshot_t hist_snap;
+static uint16_t hist_sorted[BENCH_DSP_BLOCKS * ADC_CONVERSIONS_BLOCK_FRAMES];
+
+/* main.c's rainflow settings; the ASTM E1049 example in 100-code units */
+#define BENCH_RAINFLOW_UNIT 100
+static DSP_Rainflow_t rainflow;
+static DSP_RainflowResult_t rainflow_res;
+static const DSP_RainflowSn_t rainflow_sn = {
+    .count = 2, .range = {100.0f, 1000.0f}, .cycles = {1e7f, 1e4f}};
+static uint16_t rainflow_block[ADC_CONVERSIONS_BLOCK_SAMPLES];
+
+/* main.c's capture SRS on an 11 ms half-sine of 400 codes after the trigger */
+#define BENCH_SRS_PRE_FRAMES 256U
+#define BENCH_SRS_FRAMES 1024U
+#define BENCH_SRS_PULSE_S 0.011f
+#define BENCH_SRS_PULSE_CODES 400.0f
+static DSP_SrsBank_t srs_bank;
+static DSP_SrsResult_t srs_res;
+static ADC_Frame_t srs_frames[BENCH_SRS_FRAMES];
+
+/* An 800-code raised-cosine front over 4 ms reaching channel c 1.37 c
+ * frames after frame 300, with +-4 codes of noise */
+#define BENCH_ARRIVAL_ONSET 300.0f
+#define BENCH_ARRIVAL_STEP 1.37f
+#define BENCH_ARRIVAL_RISE 16.0f
+static DSP_ArrivalResult_t arrival_res;
+
+/* The 4 kHz filtered signal of a board whose clock runs 200 ppm fast,
+ * decimated by 8 on the nominal grid, one pulse a second; the error is
+ * counted from the 4th second on */
+#define BENCH_ASRC_D 8U
+#define BENCH_ASRC_PPM 200.0
+#define BENCH_ASRC_SECONDS 12U
+#define BENCH_ASRC_SETTLE_S 4U
+#define BENCH_ASRC_AMPLITUDE 1000.0
+static DSP_Asrc_t asrc;
+static DSP_AsrcTap_t asrc_taps[ADC_CONVERSIONS_BLOCK_FRAMES];
+static float32_t asrc_in[ADC_CONVERSIONS_CHANNEL_COUNT]
+                        [ADC_CONVERSIONS_BLOCK_FRAMES];
+static float32_t asrc_out[ADC_CONVERSIONS_BLOCK_SAMPLES];
+static DSP_Filter_t asrc_filter[2];
+
+/* Channel c sampled 0.15 c frames after the trigger (37.5 us per channel
+ * at 4 kHz, far past the real scan's ~1 us per rank, so the error of the
+ * filter shows above the 12-bit quantization) */
+#define BENCH_DESKEW_STEP_NS 37500.0f
+#define BENCH_DESKEW_AMPLITUDE 1500.0
+#define BENCH_DESKEW_SETTLE 16U
+static DSP_Deskew_t deskew;
+static uint16_t deskew_block[ADC_CONVERSIONS_BLOCK_SAMPLES];
+
+/* Both sensors at 1 g, pitched 30 and rolled 45 degrees, in float codes */
+#define BENCH_VECTOR_PITCH_DEG 30.0f
+#define BENCH_VECTOR_ROLL_DEG 45.0f
+static DSP_Vector_t vec;
+static float32_t vec_frames[ADC_CONVERSIONS_BLOCK_SAMPLES];
+static DSP_VectorSample_t vec_out[ADC_CONVERSIONS_BLOCK_FRAMES *
+                                  DSP_VECTOR_GROUPS];
+
+/* 62.5 Hz at 4 kHz: 64 frames a period, so the 16 blocks repeat seamlessly.
+ * 100 codes 0-pk is 1.20 m/s^2, 2.16 mm/s RMS. */
+#define BENCH_VELOCITY_RATE_HZ 4000.0f
+#define BENCH_VELOCITY_PERIOD 64U
+#define BENCH_VELOCITY_CODES 100.0
+static DSP_Velocity_t velocity;
+
+/* Float and q15 spectrum paths on one 1000-code tone at 484.4 Hz (on a bin
+ * at every length), as a filtered stream: float samples, no ADC rounding.
+ * The band above 1 kHz holds no signal, so its RMS is the path's floor. */
+#define BENCH_PATH_PERIOD 256U
+#define BENCH_PATH_CYCLES 31U
+#define BENCH_PATH_AMPLITUDE 1000.0
+#define BENCH_PATH_LOW_HZ 1000.0f
+static DSP_Spectrum_t path_f32;
+static DSP_SpectrumQ15_t path_q15;
+static float32_t path_signal[BENCH_PATH_PERIOD];
+
+/* Same 62.5 Hz tone (bin 16 at 1024 points) on channels 0 and 1, channel 1
+ * leading by 30 degrees; LCG noise on channel 2 */
+#define BENCH_COHERENCE_LEAD_DEG 30.0
+static DSP_Spectrum_t coh_spec[3];
+static DSP_Coherence_t coh;
+
+/* 62.5 Hz of 400 codes on channels 0 and 1; channel 1 also takes a 1500
+ * code impact per block on average, at random frames */
+#define BENCH_MOMENTS_IMPACT 1500U
+static DSP_Spectrum_t moment_spec[2];
+
+/* Four 1024-point spectra on the same blocks, as main.c runs them: every
+ * two blocks four segments complete together */
+#define BENCH_SCHED_SPECTRA 4U
+#define BENCH_SCHED_BLOCKS 64U
+#define BENCH_SCHED_WARMUP 8U
+static DSP_Spectrum_t sched_spec[BENCH_SCHED_SPECTRA];
+static FftSched_t sched;
+
+/* One-second stats windows of the same tone with +-16 codes of noise; from
+ * window 32 on, channel 1 swings 600 codes instead of 400. Dead-bands and
+ * heartbeat of main.c. */
+#define BENCH_REPORT_WINDOWS 64U
+#define BENCH_REPORT_BLOCKS 4U
+#define BENCH_REPORT_STEP 32U
+static TelemetryFrame_Stats_t report_windows[BENCH_REPORT_WINDOWS];
+static TelemetryFrame_Exception_t report_exc;
+
+/* Dashboard branch of main.c: min/max of 8 raw frames on every channel; a
+ * one-frame spike on channel 2 every 1000 frames */
+#define BENCH_DISPLAY_BUCKET 8U
+#define BENCH_DISPLAY_SPIKE_SPACING 1000U
+#define BENCH_DISPLAY_SPIKE_CODE 4000U
+static HAL_StatusTypeDef bench_displaySink(const uint8_t *data, uint16_t len);
+static Pipeline_Display_t disp = {.sink = bench_displaySink};
+static const Pipeline_Stage_t disp_stages[] = {PIPELINE_STAGE_DISPLAY(&disp)};
+static const Pipeline_Branch_t disp_branches[] = {
+    PIPELINE_BRANCH((1U << ADC_CONVERSIONS_CHANNEL_COUNT) - 1U, disp_stages)};
+static Pipeline_t disp_pipe;
+static uint64_t disp_bytes;
+static uint32_t disp_packets;
+
+/* ASCII bring-up lines: all six channels, sequence numbers of a stream
+ * about four minutes in at 4 kHz */
+#define BENCH_ASCII_LINE_MAX 64U
+#define BENCH_ASCII_FIRST_SEQ 1000000U
+
+/* Private functions ---------------------------------------------------------*/
+
+static void bench_fillBlocks(void) {
+  for (uint32_t b = 0; b < BENCH_DSP_BLOCKS; b++) {
+    bench_fillBlock(blocks[b], ADC_CONVERSIONS_BLOCK_FRAMES,
+                    b * ADC_CONVERSIONS_BLOCK_FRAMES);
+  }
+}
+
+static HAL_StatusTypeDef bench_displaySink(const uint8_t *data, uint16_t len) {
+  (void)data;
+  disp_bytes += len;
+  disp_packets++;
+  return HAL_OK;
+}
+
+static const uint16_t *bench_block(uint64_t iteration) {
+  return blocks[iteration % BENCH_DSP_BLOCKS];
+}
+
+static void bench_blockThroughput(SimBench_State_t *state) {
+  simBench_setItemsProcessed(state, simBench_iterations(state) *
+                                        ADC_CONVERSIONS_BLOCK_FRAMES);
+  simBench_setBytesProcessed(state, simBench_iterations(state) *
+                                        ADC_CONVERSIONS_BLOCK_SAMPLES *
+                                        sizeof(uint16_t));
+}
+
+static void bench_planesDone(HAL_StatusTypeDef status, void *ctx) {
+  (void)ctx;
+  dma2d_done = (status == HAL_OK) ? 1U : 2U;
+}
+
+/* Planes that differ from a plain strided copy of block */
+static uint32_t bench_planeErrors(const uint16_t *block) {
+  uint32_t errors = 0;
+  for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+    for (uint32_t f = 0; f < ADC_CONVERSIONS_BLOCK_FRAMES; f++) {
+      errors += planes[ch][f] != block[f * ADC_CONVERSIONS_CHANNEL_COUNT + ch];
+    }
+  }
+  return errors;
+}
+
+/* Benchmarks ----------------------------------------------------------------*/
+
+SIM_BENCH(BM_dspStats) {
+  DSP_StatsAccum_t acc[ADC_CONVERSIONS_CHANNEL_COUNT];
+  uint64_t i = 0;
+
+  bench_fillBlocks();
+  dspStats_reset(acc);
+  while (simBench_keepRunning(state)) {
+    dspStats_accumulate(acc, bench_block(i++), ADC_CONVERSIONS_BLOCK_FRAMES);
+  }
+  bench_blockThroughput(state);
+}
+
+SIM_BENCH(BM_dspFilter) {
+  const float32_t *out;
+  uint32_t frames;
+  uint64_t i = 0;
+
+  bench_fillBlocks();
+  dspFilter_init(&filt, 8, NULL);
+  for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+    dspFilter_configChannel(&filt, ch, &dspFilter_lowpass200Hz);
+  }
+  while (simBench_keepRunning(state)) {
+    dspFilter_process(&filt, bench_block(i++), ADC_CONVERSIONS_BLOCK_FRAMES);
+    if (dspFilter_getOutput(&filt, &out, &frames, NULL) == HAL_OK) {
+      sink += frames;
+    }
+  }
+  bench_blockThroughput(state);
+}
+
+SIM_BENCH(BM_dspFilterThenStats) {
+  DSP_StatsAccum_t acc[ADC_CONVERSIONS_CHANNEL_COUNT];
+  const float32_t *out;
+  uint32_t frames;
+  uint64_t i = 0;
+
+  bench_fillBlocks();
+  dspStats_reset(acc);
+  dspFilter_init(&filt, 8, NULL);
+  for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+    dspFilter_configChannel(&filt, ch, &dspFilter_lowpass200Hz);
+  }
+  // Two modules, each walking the whole block
+  while (simBench_keepRunning(state)) {
+    const uint16_t *block = bench_block(i++);
+    dspFilter_process(&filt, block, ADC_CONVERSIONS_BLOCK_FRAMES);
+    dspStats_accumulate(acc, block, ADC_CONVERSIONS_BLOCK_FRAMES);
+    if (dspFilter_getOutput(&filt, &out, &frames, NULL) == HAL_OK) {
+      sink += frames;
+    }
+  }
+  bench_blockThroughput(state);
+}
+
+SIM_BENCH(BM_pipelineFused) {
+  ADC_ChannelStats_t st;
+  uint64_t i = 0;
+
+  bench_fillBlocks();
+  if (pipelineBiquad_init(&pipe_lp, &dspFilter_lowpass200Hz) != HAL_OK ||
+      pipeline_init(&pipe, pipe_branches, 1, NULL) != HAL_OK) {
+    simBench_skipWithError(state, "pipeline init failed");
+    return;
+  }
+  pipelineStats_reset(&pipe_stats);
+  while (simBench_keepRunning(state)) {
+    pipeline_run(&pipe, bench_block(i++), ADC_CONVERSIONS_BLOCK_FRAMES);
+  }
+  pipelineStats_read(&pipe_stats, 0, &st, 1);
+  simBench_setCounter(state, "ch0_rms", st.rms);
+
+  // Short blocks the factor does not divide (analogSensor_setBlockFrames()
+  // down to the minimum): the groups carry over, 8 x 12 frames give 12
+  pipelineStats_reset(&pipe_stats);
+  for (uint32_t b = 0; b < 8U; b++) {
+    pipeline_run(&pipe, bench_block(i++), 12U);
+  }
+  pipelineStats_read(&pipe_stats, 0, &st, 1);
+  simBench_setCounter(state, "short_block_outputs", (double)st.count);
+  bench_blockThroughput(state);
+}
+
+SIM_BENCH(BM_pipelineDcBlock) {
+  ADC_ChannelStats_t st;
+  uint64_t i = 0;
+
+  bench_fillBlocks();
+  for (uint32_t b = 0; b < BENCH_DSP_BLOCKS; b++) {
+    for (uint32_t f = 0; f < ADC_CONVERSIONS_BLOCK_FRAMES; f++) {
+      blocks[b][f * ADC_CONVERSIONS_CHANNEL_COUNT + 2U] +=
+          BENCH_DCBLOCK_GRAVITY;
+    }
+  }
+  if (dspDcBlock_init(&dcblock, DSP_DCBLOCK_CUTOFF_DEFAULT,
+                      (float32_t)BENCH_FRAME_RATE_HZ) != HAL_OK ||
+      pipeline_init(&pipe, dcblock_branches, 1, NULL) != HAL_OK) {
+    simBench_skipWithError(state, "dcblock init failed");
+    return;
+  }
+  // One second to settle, then the statistics of the rest
+  for (uint32_t b = 0; b < BENCH_FRAME_RATE_HZ / ADC_CONVERSIONS_BLOCK_FRAMES;
+       b++) {
+    pipeline_run(&pipe, bench_block(i++), ADC_CONVERSIONS_BLOCK_FRAMES);
+  }
+  pipelineStats_reset(&dcblock_stats);
+  while (simBench_keepRunning(state)) {
+    pipeline_run(&pipe, bench_block(i++), ADC_CONVERSIONS_BLOCK_FRAMES);
+  }
+  // Gravity gone, the 84 Hz tone (600 codes, 424 RMS) kept
+  pipelineStats_read(&dcblock_stats, 2, &st, 1);
+  simBench_setCounter(state, "ch2_mean_off", st.mean - DSP_DCBLOCK_MID_CODE);
+  simBench_setCounter(state, "ch2_rms", st.rms);
+  simBench_setCounter(state, "cutoff_hz", dcblock.cutoff_hz);
+  bench_blockThroughput(state);
+}
+
+SIM_BENCH(BM_displayMinMax) {
+  uint32_t spikes = 0;
+  uint32_t seen = 0;
+  uint64_t i = 0;
+
+  bench_fillBlocks();
+  for (uint32_t b = 0; b < BENCH_DSP_BLOCKS; b++) {
+    for (uint32_t f = 0; f < ADC_CONVERSIONS_BLOCK_FRAMES; f++) {
+      if ((b * ADC_CONVERSIONS_BLOCK_FRAMES + f) %
+              BENCH_DISPLAY_SPIKE_SPACING == 0U) {
+        blocks[b][f * ADC_CONVERSIONS_CHANNEL_COUNT + 2U] =
+            BENCH_DISPLAY_SPIKE_CODE;
+        spikes++;
+      }
+    }
+  }
+  if (pipelineDisplay_init(&disp, (1U << ADC_CONVERSIONS_CHANNEL_COUNT) - 1U,
+                           BENCH_DISPLAY_BUCKET) != HAL_OK ||
+      pipeline_init(&disp_pipe, disp_branches, 1, NULL) != HAL_OK) {
+    simBench_skipWithError(state, "display init failed");
+    return;
+  }
+  disp_bytes = 0;
+  disp_packets = 0;
+  while (simBench_keepRunning(state)) {
+    pipeline_run(&disp_pipe, bench_block(i++), ADC_CONVERSIONS_BLOCK_FRAMES);
+    // Buckets of one pass over the 16 blocks, checked before poll packs them
+    if (i <= BENCH_DSP_BLOCKS) {
+      for (uint32_t t = disp.tail; t != disp.head; t++) {
+        seen += disp.ring[t % PIPELINE_DISPLAY_BUCKETS].max[2] ==
+                BENCH_DISPLAY_SPIKE_CODE;
+      }
+    }
+    pipeline_poll(&disp_pipe);
+  }
+  const double frames =
+      (double)simBench_iterations(state) * ADC_CONVERSIONS_BLOCK_FRAMES;
+  simBench_setCounter(state, "spikes_seen", seen);
+  simBench_setCounter(state, "spikes", spikes);
+  simBench_setCounter(state, "bytes_per_frame",
+                      frames > 0.0 ? (double)disp_bytes / frames : 0.0);
+  simBench_setCounter(state, "overruns", disp.overruns);
+  bench_blockThroughput(state);
+}
+
+SIM_BENCH(BM_calFilterStatsSeparate) {
+  DSP_StatsAccum_t acc[ADC_CONVERSIONS_CHANNEL_COUNT];
+  const float32_t *out;
+  uint32_t frames;
+  uint64_t i = 0;
+
+  bench_fillBlocks();
+  adcCal_init();
+  dspStats_reset(acc);
+  dspFilter_init(&filt, 8, NULL);
+  for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+    dspFilter_configChannel(&filt, ch, &dspFilter_lowpass200Hz);
+  }
+  // Three passes over the block; the filter reads raw codes, not mg
+  while (simBench_keepRunning(state)) {
+    const uint16_t *block = bench_block(i++);
+    dspStats_accumulate(acc, block, ADC_CONVERSIONS_BLOCK_FRAMES);
+    adcCal_convertBlock_q15(block, ADC_CONVERSIONS_BLOCK_FRAMES, NULL,
+                            mg_block);
+    dspFilter_process(&filt, block, ADC_CONVERSIONS_BLOCK_FRAMES);
+    if (dspFilter_getOutput(&filt, &out, &frames, NULL) == HAL_OK) {
+      sink += frames + (uint32_t)mg_block[0];
+    }
+  }
+  bench_blockThroughput(state);
+}
+
+SIM_BENCH(BM_dspFused) {
+  ADC_ChannelStats_t st[ADC_CONVERSIONS_CHANNEL_COUNT];
+  uint64_t i = 0;
+
+  bench_fillBlocks();
+  adcCal_init();
+  if (dspFused_init(&fused, 8, NULL, &dspFilter_lowpass200Hz) != HAL_OK) {
+    simBench_skipWithError(state, "fused init failed");
+    return;
+  }
+  while (simBench_keepRunning(state)) {
+    sink += dspFused_process(&fused, bench_block(i++),
+                             ADC_CONVERSIONS_BLOCK_FRAMES, mg_out);
+  }
+  dspFused_getStats(&fused, st, 1);
+  simBench_setCounter(state, "ch0_mean", st[0].mean);
+  simBench_setCounter(state, "ch0_mg", mg_out[0]);
+  bench_blockThroughput(state);
+}
+
+/**
+ * @brief Synthetic ADC transfer curve: a 3 LSB bow and a 1 LSB wide code
+ *        at the mid-scale carry
+ */
+static float bench_bowedCode(float dac) {
+  float code = 12.0f + 0.998f * dac +
+               3.0f * sinf(3.14159265f * dac / 4096.0f);
+  if (code >= 2048.0f) {
+    code = (code < 2049.0f) ? 2048.0f : code - 1.0f;
+  }
+  return code;
+}
+
+SIM_BENCH(BM_dspFusedLinearity) {
+  static uint16_t mean_x16[3584];
+  const uint16_t first = 256;
+  AdcLin_Info_t info;
+  uint64_t i = 0;
+
+  // A sweep of the curve, then its residual before and after the table
+  for (uint16_t p = 0; p < 3584U; p++) {
+    mean_x16[p] =
+        (uint16_t)lroundf(16.0f * floorf(bench_bowedCode(first + p) + 0.5f));
+  }
+  adcLin_init();
+  if (adcLin_build(0, mean_x16, first, 1, 3584) != HAL_OK ||
+      adcLin_getInfo(0, &info) != HAL_OK) {
+    simBench_skipWithError(state, "linearity build failed");
+    return;
+  }
+  const int16_t *table = adcLin_getTable(0);
+  const float gain = 1.0f + (float)info.gain_ppm / 1e6f;
+  const float offset = (float)info.offset_centi / 100.0f;
+  // Worst and rms error against the fitted line: a code as read leaves
+  // +-0.5 LSB (+-1 at the wide code) no table can take out
+  float before = 0.0f, after = 0.0f;
+  double sq_before = 0.0, sq_after = 0.0;
+  for (uint16_t p = 0; p < 3584U; p++) {
+    const float ideal = offset + gain * (float)(first + p);
+    const uint16_t code = (uint16_t)(mean_x16[p] / 16U);
+    const float e0 = (float)code - ideal;
+    const float e1 = (float)table[code] / 4.0f - ideal;
+    before = fmaxf(before, fabsf(e0));
+    after = fmaxf(after, fabsf(e1));
+    sq_before += (double)e0 * e0;
+    sq_after += (double)e1 * e1;
+  }
+
+  bench_fillBlocks();
+  adcCal_init();
+  if (dspFused_init(&fused, 8, NULL, &dspFilter_lowpass200Hz) != HAL_OK ||
+      dspFused_attachLinearity(&fused, 1) != HAL_OK) {
+    simBench_skipWithError(state, "fused init failed");
+    return;
+  }
+  while (simBench_keepRunning(state)) {
+    sink += dspFused_process(&fused, bench_block(i++),
+                             ADC_CONVERSIONS_BLOCK_FRAMES, mg_out);
+  }
+  simBench_setCounter(state, "inl_centi", (double)info.inl_max_centi);
+  simBench_setCounter(state, "err_before_lsb", before);
+  simBench_setCounter(state, "err_after_lsb", after);
+  simBench_setCounter(state, "rms_before_lsb", sqrt(sq_before / 3584.0));
+  simBench_setCounter(state, "rms_after_lsb", sqrt(sq_after / 3584.0));
+  simBench_setCounter(state, "ch0_mg", mg_out[0]);
+  bench_blockThroughput(state);
+}
+
+SIM_BENCH(BM_deinterleaveStrided) {
+  uint64_t i = 0;
+
+  bench_fillBlocks();
+  // Baseline: one strided pass per channel
+  while (simBench_keepRunning(state)) {
+    const uint16_t *block = bench_block(i++);
+    for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+      const uint16_t *src = &block[ch];
+      for (uint32_t f = 0; f < ADC_CONVERSIONS_BLOCK_FRAMES; f++) {
+        planes[ch][f] = *src;
+        src += ADC_CONVERSIONS_CHANNEL_COUNT;
+      }
+    }
+    sink += planes[0][0];
+  }
+  bench_blockThroughput(state);
+}
+
+SIM_BENCH(BM_deinterleave) {
+  uint64_t i = 0;
+  const uint16_t *block = blocks[0];
+
+  bench_fillBlocks();
+  while (simBench_keepRunning(state)) {
+    block = bench_block(i++);
+    dspDeinterleave_process(block, ADC_CONVERSIONS_BLOCK_FRAMES, NULL,
+                            &planes[0][0], ADC_CONVERSIONS_BLOCK_FRAMES);
+    sink += planes[0][0];
+  }
+  simBench_setCounter(state, "errors", bench_planeErrors(block));
+  bench_blockThroughput(state);
+}
+
+SIM_BENCH(BM_deinterleaveDma2d) {
+  uint64_t i = 0;
+  const uint16_t *block = blocks[0];
+
+  bench_fillBlocks();
+  if (dspDeinterleave_initDma2d() != HAL_OK) {
+    simBench_skipWithError(state, "DMA2D init failed");
+    return;
+  }
+  // The mock copies at start: this times the driver and chaining only
+  while (simBench_keepRunning(state)) {
+    block = bench_block(i++);
+    dma2d_done = 0;
+    if (dspDeinterleave_startDma2d(block, ADC_CONVERSIONS_BLOCK_FRAMES, NULL,
+                                   &planes[0][0], ADC_CONVERSIONS_BLOCK_FRAMES,
+                                   bench_planesDone, NULL) != HAL_OK) {
+      simBench_skipWithError(state, "DMA2D start failed");
+      return;
+    }
+    while (dma2d_done == 0U) {
+      dspDeinterleave_dma2dIrqHandler();
+    }
+  }
+  simBench_setCounter(state, "errors",
+                      bench_planeErrors(block) + (dma2d_done != 1U));
+  bench_blockThroughput(state);
+}
+
+SIM_BENCH(BM_dspMultirate) {
+  const q15_t *out;
+  uint32_t frames;
+  uint32_t frames_1k = 0;
+  uint32_t frames_10 = 0;
+  uint64_t i = 0;
+
+  bench_fillBlocks();
+  // Vibration channels at 1 kHz, tilt channels at 10 Hz
+  if (dspMultirate_init(&multirate, NULL, NULL) != HAL_OK) {
+    simBench_skipWithError(state, "multirate init failed");
+    return;
+  }
+  for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+    dspMultirate_setChannelRates(&multirate, ch,
+                                 DSP_MULTIRATE_LEVEL_BIT(ch < 3U ? 0U : 1U));
+  }
+  while (simBench_keepRunning(state)) {
+    dspMultirate_process(&multirate, bench_block(i++),
+                         ADC_CONVERSIONS_BLOCK_FRAMES);
+    if (dspMultirate_getOutput(&multirate, 0, &out, &frames, NULL) ==
+        HAL_OK) {
+      frames_1k += frames;
+    }
+    if (dspMultirate_getOutput(&multirate, 1, &out, &frames, NULL) ==
+        HAL_OK) {
+      frames_10 += frames;
+    }
+  }
+  simBench_setCounter(state, "frames_1k", frames_1k);
+  simBench_setCounter(state, "frames_10Hz", frames_10);
+  bench_blockThroughput(state);
+}
+
+SIM_BENCH(BM_dcTrack) {
+  DSP_StatsAccum_t acc[ADC_CONVERSIONS_CHANNEL_COUNT];
+  uint64_t i = 0;
+
+  bench_fillBlocks();
+  dspStats_reset(acc);
+  for (uint32_t b = 0; b < BENCH_DSP_BLOCKS; b++) {
+    dspStats_accumulate(acc, blocks[b], ADC_CONVERSIONS_BLOCK_FRAMES);
+  }
+  dspDcTrack_init(&dctrack, DSP_DCTRACK_SHIFT_DEFAULT, NULL);
+  while (simBench_keepRunning(state)) {
+    dspDcTrack_process(&dctrack, bench_block(i++),
+                       ADC_CONVERSIONS_BLOCK_FRAMES);
+  }
+  // Settles on the mean of the 16 blocks it cycles through
+  simBench_setCounter(state, "bias_ch2", dspDcTrack_getBias(&dctrack, 2));
+  simBench_setCounter(state, "mean_ch2",
+                      (double)acc[2].sum / (double)acc[2].count);
+  bench_blockThroughput(state);
+}
+
+/* The last window lies in the last block: checked against a plain scan */
+#define BENCH_WINDOW_FRAMES                                                    \
+  (DSP_WINDOW_MAX_FRAMES < ADC_CONVERSIONS_BLOCK_FRAMES                        \
+       ? DSP_WINDOW_MAX_FRAMES                                                 \
+       : ADC_CONVERSIONS_BLOCK_FRAMES)
+
+SIM_BENCH(BM_slidingWindow) {
+  const uint16_t *block = blocks[0];
+  DSP_WindowResult_t r;
+  uint64_t i = 0;
+  uint32_t errors = 0;
+
+  bench_fillBlocks();
+  dspWindow_init(&sliding, BENCH_WINDOW_FRAMES, NULL);
+  while (simBench_keepRunning(state)) {
+    block = bench_block(i++);
+    dspWindow_process(&sliding, block, ADC_CONVERSIONS_BLOCK_FRAMES);
+  }
+  for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+    uint16_t max = 0;
+    uint16_t min = UINT16_MAX;
+    double sum = 0.0;
+    double sum_sq = 0.0;
+    for (uint32_t f = ADC_CONVERSIONS_BLOCK_FRAMES - BENCH_WINDOW_FRAMES;
+         f < ADC_CONVERSIONS_BLOCK_FRAMES; f++) {
+      const uint16_t x = block[f * ADC_CONVERSIONS_CHANNEL_COUNT + ch];
+      max = (x > max) ? x : max;
+      min = (x < min) ? x : min;
+      sum += x;
+      sum_sq += (double)x * x;
+    }
+    const double mean = sum / BENCH_WINDOW_FRAMES;
+    const double rms = sqrt(sum_sq / BENCH_WINDOW_FRAMES - mean * mean);
+    if (dspWindow_get(&sliding, ch, &r) != HAL_OK || r.max != max ||
+        r.min != min || fabs(r.mean - mean) > 0.01 ||
+        fabs(r.rms - rms) > 0.05) {
+      errors++;
+    }
+  }
+  dspWindow_get(&sliding, 2, &r);
+  simBench_setCounter(state, "window", BENCH_WINDOW_FRAMES);
+  simBench_setCounter(state, "pp_ch2", r.max - r.min);
+  simBench_setCounter(state, "rms_ch2", r.rms);
+  simBench_setCounter(state, "errors", errors);
+  bench_blockThroughput(state);
+}
+
+/* The copy into the work block is timed too: about 1 cycle per sample */
+SIM_BENCH(BM_despike) {
+  const DSP_DespikeConfig_t cfg = {.taps = 5,
+                                   .mode = DSP_DESPIKE_HAMPEL,
+                                   .threshold = 800,
+                                   .channels = ADC_CHANNELS_MASK_ALL};
+  uint64_t i = 0;
+  uint64_t injected = 0;
+
+  bench_fillBlocks();
+  for (uint32_t b = 0; b < BENCH_DSP_BLOCKS; b++) {
+    for (uint32_t f = 0; f < ADC_CONVERSIONS_BLOCK_FRAMES;
+         f += BENCH_DESPIKE_SPACING) {
+      blocks[b][f * ADC_CONVERSIONS_CHANNEL_COUNT + 1U] = BENCH_DESPIKE_CODE;
+    }
+  }
+  dspDespike_init(&despike, &cfg, NULL);
+  while (simBench_keepRunning(state)) {
+    memcpy(despike_block, bench_block(i++), sizeof(despike_block));
+    dspDespike_process(&despike, despike_block, ADC_CONVERSIONS_BLOCK_FRAMES);
+    injected += ADC_CONVERSIONS_BLOCK_FRAMES / BENCH_DESPIKE_SPACING;
+  }
+  // Every spike replaced, and little else (edges of the test signal)
+  simBench_setCounter(state, "injected", (double)injected);
+  simBench_setCounter(state, "replaced_ch1",
+                      dspDespike_getReplaced(&despike, 1));
+  simBench_setCounter(state, "replaced_ch0",
+                      dspDespike_getReplaced(&despike, 0));
+  bench_blockThroughput(state);
+}
+
+SIM_BENCH(BM_dspMultirateAutozero) {
+  const q15_t *out;
+  uint32_t frames;
+  int64_t sum_1k = 0;
+  uint32_t frames_1k = 0;
+  uint64_t i = 0;
+
+  bench_fillBlocks();
+  // As BM_dspMultirate, centred on the tracked DC: level 0 averages to 0
+  if (dspMultirate_init(&multirate, NULL, NULL) != HAL_OK ||
+      dspDcTrack_init(&dctrack, DSP_DCTRACK_SHIFT_DEFAULT, NULL) != HAL_OK ||
+      dspMultirate_attachDcTrack(&multirate, &dctrack) != HAL_OK) {
+    simBench_skipWithError(state, "multirate init failed");
+    return;
+  }
+  for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+    dspMultirate_setChannelRates(&multirate, ch,
+                                 DSP_MULTIRATE_LEVEL_BIT(ch < 3U ? 0U : 1U));
+  }
+  while (simBench_keepRunning(state)) {
+    const uint16_t *block = bench_block(i++);
+    dspDcTrack_process(&dctrack, block, ADC_CONVERSIONS_BLOCK_FRAMES);
+    dspMultirate_process(&multirate, block, ADC_CONVERSIONS_BLOCK_FRAMES);
+    if (dspMultirate_getOutput(&multirate, 0, &out, &frames, NULL) ==
+        HAL_OK) {
+      for (uint32_t k = 0; k < frames; k++) {
+        sum_1k += out[k * ADC_CONVERSIONS_CHANNEL_COUNT + 2U];
+      }
+      frames_1k += frames;
+    }
+  }
+  simBench_setCounter(state, "mean_1k_q15",
+                      frames_1k ? (double)sum_1k / frames_1k : 0.0);
+  bench_blockThroughput(state);
+}
+
+SIM_BENCH(BM_adaptiveRate) {
+  const AdaptiveRate_Config_t cfg = {.levels = NULL,
+                                     .channel_mask = 0x3FU,
+                                     .step_up_codes = 40.0f,
+                                     .step_down_codes = 10.0f,
+                                     .quiet_ms = 0U};
+  AdaptiveRate_Status_t st;
+  uint64_t i = 0;
+
+  bench_initHal(); // TIM2 takes the rate changes
+  bench_fillBlocks();
+  for (uint32_t k = 0; k < ADC_CONVERSIONS_BLOCK_SAMPLES; k++) {
+    quiet_block[k] = (uint16_t)(2048U + (k % 3U)); // ~1 code RMS
+  }
+  if (adaptiveRate_init(&cfg, NULL) != HAL_OK) {
+    simBench_skipWithError(state, "adaptive rate init failed");
+    return;
+  }
+  // Eight signal blocks, then eight still ones: up once, down every poll
+  while (simBench_keepRunning(state)) {
+    const uint16_t *block = ((i / 8U) & 1U) ? quiet_block : bench_block(i);
+    i++;
+    adaptiveRate_processBlock(block, ADC_CONVERSIONS_BLOCK_FRAMES);
+    adaptiveRate_poll(NULL);
+  }
+  adaptiveRate_getStatus(&st);
+  simBench_setCounter(state, "steps_up", st.steps_up);
+  simBench_setCounter(state, "steps_down", st.steps_down);
+  bench_blockThroughput(state);
+}
+
+SIM_BENCH(BM_dspOversample) {
+  uint64_t i = 0;
+
+  bench_fillBlocks();
+  dspOversample_init(&os, NULL);
+  dspOversample_configChannel(&os, 0, 256, 16);
+  while (simBench_keepRunning(state)) {
+    dspOversample_process(&os, bench_block(i++), ADC_CONVERSIONS_BLOCK_FRAMES);
+  }
+  bench_blockThroughput(state);
+}
+
+SIM_BENCH(BM_dspSpectrum) {
+  DSP_SpectrumConfig_t cfg = {.length = 1024,
+                              .window = DSP_WINDOW_HANN,
+                              .averages = 4,
+                              .sample_rate_hz = (float)BENCH_FRAME_RATE_HZ,
+                              .min_peak_hz = 5.0f,
+                              .band_count = 1,
+                              .bands = {{10.0f, 1000.0f}}};
+  DSP_SpectrumResult_t res;
+  uint64_t i = 0;
+
+  bench_fillBlocks();
+  if (dspSpectrum_init(&spec, 0, NULL, &cfg) != HAL_OK) {
+    simBench_skipWithError(state, "spectrum init failed");
+    return;
+  }
+  while (simBench_keepRunning(state)) {
+    dspSpectrum_process(&spec, bench_block(i++), ADC_CONVERSIONS_BLOCK_FRAMES);
+    dspSpectrum_poll(&spec);
+    if (dspSpectrum_getResult(&spec, &res) == HAL_OK) {
+      simBench_setCounter(state, "peak_hz", res.peak_hz);
+    }
+  }
+  bench_blockThroughput(state);
+}
+
+/* BENCH_SCHED_BLOCKS blocks through the scheduler, its figures counted
+ * once it knows the periods; the rms of the last result of each instance
+ * goes to rms */
+static void bench_schedRun(FftSched_Mode_t mode, FftSched_Stats_t *st,
+                           uint32_t *pass_us, uint32_t *wait_us,
+                           float32_t *rms) {
+  const DSP_SpectrumConfig_t cfg = {.length = 1024,
+                                    .window = DSP_WINDOW_HANN,
+                                    .averages = 4,
+                                    .sample_rate_hz =
+                                        (float)BENCH_FRAME_RATE_HZ,
+                                    .min_peak_hz = 5.0f};
+  fftSched_init(&sched, mode);
+  for (uint8_t i = 0; i < BENCH_SCHED_SPECTRA; i++) {
+    dspSpectrum_init(&sched_spec[i], i, NULL, &cfg);
+    fftSched_add(&sched, &sched_spec[i]);
+  }
+  for (uint32_t b = 0; b < BENCH_SCHED_BLOCKS; b++) {
+    for (uint8_t i = 0; i < BENCH_SCHED_SPECTRA; i++) {
+      dspSpectrum_process(&sched_spec[i], bench_block(b),
+                          ADC_CONVERSIONS_BLOCK_FRAMES);
+    }
+    fftSched_poll(&sched); // one pass per block, as the block task
+    if (b == BENCH_SCHED_WARMUP) {
+      fftSched_resetStats(&sched);
+    }
+    for (uint8_t i = 0; i < BENCH_SCHED_SPECTRA; i++) {
+      DSP_SpectrumResult_t res;
+      if (dspSpectrum_getResult(&sched_spec[i], &res) == HAL_OK) {
+        rms[i] = res.rms;
+      }
+    }
+  }
+  fftSched_getStats(&sched, st, pass_us, NULL, wait_us);
+}
+
+/* Spread of the RMS of white noise in a 3-bin band over
+ * BENCH_OVERLAP_RESULTS results of averages segments each, std / mean in
+ * percent */
+#define BENCH_OVERLAP_RESULTS 400U
+static double bench_overlapSpread(DSP_SpectrumOverlap_t overlap,
+                                  uint8_t averages) {
+  const DSP_SpectrumConfig_t cfg = {.length = 1024,
+                                    .window = DSP_WINDOW_HANN,
+                                    .averages = averages,
+                                    .overlap = overlap,
+                                    .sample_rate_hz =
+                                        (float)BENCH_FRAME_RATE_HZ,
+                                    .min_peak_hz = 5.0f,
+                                    .band_count = 1,
+                                    .bands = {{100.0f, 110.0f}}};
+  static float32_t noise[ADC_CONVERSIONS_BLOCK_FRAMES];
+  uint32_t lcg = 4242U;
+  double sum = 0.0;
+  double sum_sq = 0.0;
+  uint32_t n = 0;
+  dspSpectrum_init(&spec, 0, NULL, &cfg);
+  while (n < BENCH_OVERLAP_RESULTS) {
+    for (uint32_t f = 0; f < ADC_CONVERSIONS_BLOCK_FRAMES; f++) {
+      lcg = lcg * 1664525U + 1013904223U;
+      noise[f] = (float32_t)(1792U + (lcg >> 23));
+    }
+    // At most one window ends per block at either hop
+    dspSpectrum_pushSamples(&spec, noise, ADC_CONVERSIONS_BLOCK_FRAMES);
+    dspSpectrum_poll(&spec);
+    DSP_SpectrumResult_t res;
+    if (dspSpectrum_getResult(&spec, &res) == HAL_OK) {
+      sum += res.band_rms[0];
+      sum_sq += (double)res.band_rms[0] * res.band_rms[0];
+      n++;
+    }
+  }
+  const double mean = sum / n;
+  return 100.0 * sqrt(sum_sq / n - mean * mean) / mean;
+}
+
+/* RMS spread of results spanning the same 640 ms: 4 segments at 50 %,
+ * 8 at 75 % overlap, read from the same ring without a copy */
+SIM_BENCH(BM_spectrumOverlap) {
+  const double spread_50 = bench_overlapSpread(DSP_SPECTRUM_OVERLAP_50, 4);
+  const double spread_75 = bench_overlapSpread(DSP_SPECTRUM_OVERLAP_75, 8);
+  const DSP_SpectrumConfig_t cfg = {.length = 1024,
+                                    .window = DSP_WINDOW_HANN,
+                                    .averages = 8,
+                                    .overlap = DSP_SPECTRUM_OVERLAP_75,
+                                    .sample_rate_hz =
+                                        (float)BENCH_FRAME_RATE_HZ,
+                                    .min_peak_hz = 5.0f};
+  uint64_t i = 0;
+
+  // Timed: a block collected and every window it ends transformed
+  bench_fillBlocks();
+  dspSpectrum_init(&spec, 0, NULL, &cfg);
+  while (simBench_keepRunning(state)) {
+    dspSpectrum_process(&spec, bench_block(i++), ADC_CONVERSIONS_BLOCK_FRAMES);
+    dspSpectrum_poll(&spec);
+  }
+  simBench_setCounter(state, "rms_spread_pct_50", spread_50);
+  simBench_setCounter(state, "rms_spread_pct_75", spread_75);
+  simBench_setCounter(state, "overruns", (double)spec.overruns);
+  simBench_setCounter(state, "ram_bytes", (double)sizeof(DSP_Spectrum_t));
+  bench_blockThroughput(state);
+}
+
+/* A gear mesh at BENCH_CEPSTRUM_MESH_HZ, amplitude-modulated by a pulse at
+ * the shaft rate (a cracked tooth): a family of sidebands
+ * BENCH_CEPSTRUM_SHAFT_HZ apart, whose cepstrum peaks at 1000 / shaft ms.
+ * depth 0 is the healthy gear, the mesh tone alone. */
+#define BENCH_CEPSTRUM_MESH_HZ 850.0
+#define BENCH_CEPSTRUM_SHAFT_HZ 25.0
+#define BENCH_CEPSTRUM_HARMONICS 10U
+static void bench_cepstrumRun(double depth, DSP_SpectrumResult_t *res) {
+  const DSP_SpectrumConfig_t cfg = {.length = 1024,
+                                    .window = DSP_WINDOW_HANN,
+                                    .averages = 4,
+                                    .sample_rate_hz =
+                                        (float)BENCH_FRAME_RATE_HZ,
+                                    .min_peak_hz = 5.0f,
+                                    .cepstrum_count = 2,
+                                    .cepstrum_min_ms = 5.0f};
+  static float32_t x[ADC_CONVERSIONS_BLOCK_FRAMES];
+  uint32_t lcg = 777U;
+  uint32_t n = 0;
+  dspSpectrum_init(&spec, 0, NULL, &cfg);
+  do {
+    for (uint32_t f = 0; f < ADC_CONVERSIONS_BLOCK_FRAMES; f++, n++) {
+      const double t = (double)n / BENCH_FRAME_RATE_HZ;
+      double m = 0.0;
+      for (uint32_t h = 1; h <= BENCH_CEPSTRUM_HARMONICS; h++) {
+        m += cos(2.0 * M_PI * BENCH_CEPSTRUM_SHAFT_HZ * h * t);
+      }
+      lcg = lcg * 1664525U + 1013904223U;
+      x[f] = (float32_t)(2048.0 +
+                         400.0 * (1.0 + depth * m / BENCH_CEPSTRUM_HARMONICS) *
+                             sin(2.0 * M_PI * BENCH_CEPSTRUM_MESH_HZ * t) +
+                         (double)(lcg >> 28) - 7.5);
+    }
+    dspSpectrum_pushSamples(&spec, x, ADC_CONVERSIONS_BLOCK_FRAMES);
+    dspSpectrum_poll(&spec);
+  } while (dspSpectrum_getResult(&spec, res) != HAL_OK);
+}
+
+/* Timed: blocks collected and every average taken to its cepstrum peaks */
+SIM_BENCH(BM_spectrumCepstrum) {
+  DSP_SpectrumResult_t healthy;
+  DSP_SpectrumResult_t faulty;
+  bench_cepstrumRun(0.0, &healthy);
+  bench_cepstrumRun(0.8, &faulty);
+  uint64_t i = 0;
+
+  bench_fillBlocks();
+  while (simBench_keepRunning(state)) {
+    dspSpectrum_process(&spec, bench_block(i++), ADC_CONVERSIONS_BLOCK_FRAMES);
+    dspSpectrum_poll(&spec);
+  }
+  simBench_setCounter(state, "quefrency_ms", faulty.cepstrum_ms[0]);
+  simBench_setCounter(state, "spacing_hz", 1000.0 / faulty.cepstrum_ms[0]);
+  simBench_setCounter(state, "amplitude", faulty.cepstrum_amplitude[0]);
+  simBench_setCounter(state, "healthy_amplitude",
+                      (healthy.cepstrum_count != 0U)
+                          ? healthy.cepstrum_amplitude[0]
+                          : 0.0);
+  bench_blockThroughput(state);
+}
+
+/* Angle-domain samples as the order resampler gives them: a mesh at order
+ * 12 and a tooth fault at one angle, locked to the shaft, under a second
+ * shaft at order 7.37 and noise. The error of the TSA against the locked
+ * part, and of one revolution, in codes RMS. Every 50th revolution loses a
+ * sample and is rejected. */
+#define BENCH_TSA_ANGLES 64U
+#define BENCH_TSA_REVS 32U
+static void bench_tsaRevolution(uint32_t rev, uint32_t *lcg, float32_t *x,
+                                float32_t *locked) {
+  for (uint32_t a = 0; a < BENCH_TSA_ANGLES; a++) {
+    const double turn = (double)a / BENCH_TSA_ANGLES;
+    const int32_t from_fault = (int32_t)a - 40;
+    locked[a] = (float32_t)(20.0 * sin(2.0 * M_PI * 12.0 * turn) +
+                            30.0 * exp(-0.5 * from_fault * from_fault));
+    *lcg = *lcg * 1664525U + 1013904223U;
+    x[a] = 2048.0f + locked[a] +
+           (float32_t)(60.0 * sin(2.0 * M_PI * 7.37 * (rev + turn)) +
+                       (double)(*lcg >> 25) - 63.5);
+  }
+}
+
+SIM_BENCH(BM_tsa) {
+  static DSP_Tsa_t bench_tsa;
+  static DSP_TsaResult_t avg;
+  static float32_t x[BENCH_TSA_ANGLES];
+  static float32_t locked[BENCH_TSA_ANGLES];
+  const DSP_TsaConfig_t cfg = {.samples_per_rev = BENCH_TSA_ANGLES,
+                               .revolutions = BENCH_TSA_REVS};
+  uint32_t lcg = 99U;
+  uint32_t rev = 0;
+  double single = 0.0;
+
+  dspTsa_init(&bench_tsa, &cfg);
+  do {
+    bench_tsaRevolution(rev, &lcg, x, locked);
+    for (uint32_t a = 0; a < BENCH_TSA_ANGLES; a++) {
+      if (rev == 0U) {
+        const double d = x[a] - 2048.0f - locked[a];
+        single += d * d;
+      }
+      if (rev % 50U == 7U && a == 20U) {
+        dspTsa_skip(&bench_tsa);
+        continue;
+      }
+      dspTsa_add(&bench_tsa, (uint16_t)a, x[a]);
+    }
+    rev++;
+  } while (dspTsa_getResult(&bench_tsa, &avg) != HAL_OK);
+  double err = 0.0;
+  for (uint32_t a = 0; a < BENCH_TSA_ANGLES; a++) {
+    const double d = avg.samples[a] - avg.mean - locked[a];
+    err += d * d;
+  }
+  err = sqrt(err / BENCH_TSA_ANGLES);
+  single = sqrt(single / BENCH_TSA_ANGLES);
+
+  // Timed: one angle sample into the TSA
+  uint32_t a = 0;
+  while (simBench_keepRunning(state)) {
+    dspTsa_add(&bench_tsa, (uint16_t)a, x[a]);
+    a = (a + 1U) % BENCH_TSA_ANGLES;
+  }
+  simBench_setCounter(state, "single_rev_err", single);
+  simBench_setCounter(state, "tsa_err", err);
+  simBench_setCounter(state, "gain_db", 20.0 * log10(single / err));
+  simBench_setCounter(state, "residual_rms", avg.residual_rms);
+  simBench_setCounter(state, "rejected", avg.rejected);
+  simBench_setCounter(state, "revolutions_used", rev);
+}
+
+SIM_BENCH(BM_fftSched) {
+  FftSched_Stats_t burst;
+  FftSched_Stats_t spread;
+  uint32_t burst_us = 0;
+  uint32_t spread_us = 0;
+  uint32_t burst_wait = 0;
+  uint32_t spread_wait = 0;
+  float32_t rms_burst[BENCH_SCHED_SPECTRA] = {0};
+  float32_t rms_spread[BENCH_SCHED_SPECTRA] = {0};
+  bench_fillBlocks();
+  bench_schedRun(FFT_SCHED_BURST, &burst, &burst_us, &burst_wait, rms_burst);
+  bench_schedRun(FFT_SCHED_SPREAD, &spread, &spread_us, &spread_wait,
+                 rms_spread);
+  // Same segments, same sums: the results must match exactly
+  const uint32_t differ =
+      (memcmp(rms_burst, rms_spread, sizeof(rms_burst)) != 0) ? 1U : 0U;
+
+  // Timed: one block collected by every instance and its paced pass
+  uint64_t b = 0;
+  while (simBench_keepRunning(state)) {
+    for (uint8_t i = 0; i < BENCH_SCHED_SPECTRA; i++) {
+      dspSpectrum_process(&sched_spec[i], bench_block(b),
+                          ADC_CONVERSIONS_BLOCK_FRAMES);
+    }
+    sink += fftSched_poll(&sched);
+    b++;
+  }
+  simBench_setCounter(state, "burst_peak_steps", burst.peak_steps);
+  simBench_setCounter(state, "spread_peak_steps", spread.peak_steps);
+  simBench_setCounter(state, "burst_peak_pass_us", (double)burst_us);
+  simBench_setCounter(state, "spread_peak_pass_us", (double)spread_us);
+  simBench_setCounter(state, "burst_wait_max_us", (double)burst_wait);
+  simBench_setCounter(state, "spread_wait_max_us", (double)spread_wait);
+  simBench_setCounter(state, "overruns",
+                      (double)(burst.overruns + spread.overruns));
+  simBench_setCounter(state, "results_differ", (double)differ);
+  bench_blockThroughput(state);
+}
+
+/* One iteration collects and transforms one segment (length / 2 new
+ * samples). RAM is per instance at that length, the rfft output buffer
+ * shared by all instances not counted. */
+static void bench_spectrumPath(SimBench_State_t *state, uint16_t length,
+                               uint8_t q15) {
+  DSP_SpectrumConfig_t cfg = {.length = length,
+                              .window = DSP_WINDOW_HANN,
+                              .averages = 4,
+                              .sample_rate_hz = (float)BENCH_FRAME_RATE_HZ,
+                              .min_peak_hz = 5.0f,
+                              .band_count = 1,
+                              .bands = {{BENCH_PATH_LOW_HZ,
+                                         (float)BENCH_FRAME_RATE_HZ / 2.0f}}};
+  const uint32_t half = length / 2U;
+  DSP_SpectrumResult_t res;
+  uint32_t ram;
+  uint64_t i = 0;
+
+  for (uint32_t n = 0; n < BENCH_PATH_PERIOD; n++) {
+    path_signal[n] = (float32_t)(
+        2048.0 + BENCH_PATH_AMPLITUDE *
+                     sin(2.0 * M_PI * BENCH_PATH_CYCLES * n /
+                         BENCH_PATH_PERIOD));
+  }
+  const HAL_StatusTypeDef st =
+      q15 ? dspSpectrumQ15_init(&path_q15, 0, NULL, &cfg)
+          : dspSpectrum_init(&path_f32, 0, NULL, &cfg);
+  if (st != HAL_OK) {
+    simBench_skipWithError(state, "spectrum init failed");
+    return;
+  }
+  // Everything but the length-sized buffers, then those at this length
+  if (q15) {
+    ram = (uint32_t)(sizeof(path_q15) - 3U * sizeof(path_q15.window) -
+                     2U * sizeof(path_q15.power) +
+                     length * 3U * sizeof(q15_t) +
+                     (half + 1U) * 2U * sizeof(float32_t));
+  } else {
+    ram = (uint32_t)(sizeof(path_f32) - 3U * sizeof(path_f32.window) -
+                     2U * sizeof(path_f32.power) +
+                     length * 3U * sizeof(float32_t) +
+                     (half + 1U) * 2U * sizeof(float32_t));
+  }
+
+  while (simBench_keepRunning(state)) {
+    // The period divides every length: each push continues the tone
+    for (uint32_t n = 0; n < half; n += BENCH_PATH_PERIOD) {
+      if (q15) {
+        dspSpectrumQ15_pushSamples(&path_q15, path_signal, BENCH_PATH_PERIOD);
+      } else {
+        dspSpectrum_pushSamples(&path_f32, path_signal, BENCH_PATH_PERIOD);
+      }
+    }
+    if (q15) {
+      dspSpectrumQ15_poll(&path_q15);
+    } else {
+      dspSpectrum_poll(&path_f32);
+    }
+    i++;
+  }
+  if ((q15 ? dspSpectrumQ15_getResult(&path_q15, &res)
+           : dspSpectrum_getResult(&path_f32, &res)) != HAL_OK) {
+    if (i > 8U) {
+      simBench_skipWithError(state, "no spectrum result");
+    }
+    return;
+  }
+  simBench_setCounter(state, "ram_bytes", ram);
+  simBench_setCounter(state, "amp_err_pct",
+                      100.0 * (res.peak_amplitude - BENCH_PATH_AMPLITUDE) /
+                          BENCH_PATH_AMPLITUDE);
+  simBench_setCounter(state, "floor_db",
+                      20.0 * log10((res.band_rms[0] + 1e-30) /
+                                   (BENCH_PATH_AMPLITUDE / M_SQRT2)));
+  simBench_setItemsProcessed(state, simBench_iterations(state) * half);
+}
+
+SIM_BENCH(BM_spectrumF32_256) { bench_spectrumPath(state, 256U, 0); }
+SIM_BENCH(BM_spectrumQ15_256) { bench_spectrumPath(state, 256U, 1); }
+SIM_BENCH(BM_spectrumF32_1024) { bench_spectrumPath(state, 1024U, 0); }
+SIM_BENCH(BM_spectrumQ15_1024) { bench_spectrumPath(state, 1024U, 1); }
+SIM_BENCH(BM_spectrumF32_4096) { bench_spectrumPath(state, 4096U, 0); }
+SIM_BENCH(BM_spectrumQ15_4096) { bench_spectrumPath(state, 4096U, 1); }
+
+/* Feature extraction of one averaged 1024-point result, alone and with
+ * the 22 third octaves of the firmware (12.5 Hz to 1.6 kHz). The tone at
+ * 484 Hz is in the 500 Hz band and should read 1000 / sqrt(2) codes RMS;
+ * the bands packet is compared with the 513 float bins it summarises. */
+static DSP_BandTable_t bench_bands;
+
+static void bench_features(SimBench_State_t *state, uint8_t with_bands) {
+  DSP_SpectrumConfig_t cfg = {.length = 1024,
+                              .window = DSP_WINDOW_HANN,
+                              .averages = 4,
+                              .sample_rate_hz = (float)BENCH_FRAME_RATE_HZ,
+                              .min_peak_hz = 5.0f,
+                              .band_count = 2,
+                              .bands = {{10.0f, 1000.0f}, {1000.0f, 2000.0f}}};
+  DSP_SpectrumResult_t res;
+
+  if (dspBands_initFractional(&bench_bands, DSP_BANDS_THIRD_OCTAVE, 10.0f,
+                              1600.0f, cfg.length,
+                              cfg.sample_rate_hz) != HAL_OK) {
+    simBench_skipWithError(state, "band table failed");
+    return;
+  }
+  cfg.band_table = with_bands ? &bench_bands : NULL;
+  for (uint32_t n = 0; n < BENCH_PATH_PERIOD; n++) {
+    path_signal[n] = (float32_t)(
+        2048.0 + BENCH_PATH_AMPLITUDE *
+                     sin(2.0 * M_PI * BENCH_PATH_CYCLES * n /
+                         BENCH_PATH_PERIOD));
+  }
+  if (dspSpectrum_init(&path_f32, 0, NULL, &cfg) != HAL_OK) {
+    simBench_skipWithError(state, "spectrum init failed");
+    return;
+  }
+  // Untimed: one result; the sums of the last segments stay for the timing
+  for (uint32_t seg = 0; seg < 16U &&
+                         dspSpectrum_getResult(&path_f32, &res) != HAL_OK;
+       seg++) {
+    for (uint32_t n = 0; n < cfg.length / 2U; n += BENCH_PATH_PERIOD) {
+      dspSpectrum_pushSamples(&path_f32, path_signal, BENCH_PATH_PERIOD);
+    }
+    dspSpectrum_poll(&path_f32);
+  }
+  if (with_bands) {
+    const float32_t tone_hz = (float32_t)(BENCH_PATH_CYCLES *
+                                          BENCH_FRAME_RATE_HZ /
+                                          BENCH_PATH_PERIOD);
+    uint8_t tone_band = 0;
+    while (tone_band + 1U < res.log_band_count &&
+           bench_bands.edge_hz[tone_band + 1U] <= tone_hz) {
+      tone_band++;
+    }
+    TelemetryFrame_Bands_t pkt = {.band_count = res.log_band_count};
+    uint8_t out[TELEMETRY_FRAME_ENCODED_MAX];
+    uint16_t out_len = 0;
+    (void)telemetryFrame_encodeBands(&pkt, out, sizeof(out), &out_len);
+    simBench_setCounter(state, "bands", res.log_band_count);
+    simBench_setCounter(state, "tone_err_db",
+                        20.0 * log10(res.log_band_rms[tone_band] /
+                                     (BENCH_PATH_AMPLITUDE / M_SQRT2)));
+    simBench_setCounter(state, "next_band_db",
+                        20.0 * log10((res.log_band_rms[tone_band + 2U] +
+                                      1e-30) /
+                                     res.log_band_rms[tone_band]));
+    simBench_setCounter(state, "packet_bytes", out_len);
+    simBench_setCounter(state, "bins_bytes",
+                        (cfg.length / 2U + 1U) * sizeof(float32_t));
+  }
+
+  const DSP_SpectrumSums_t sums = {.cfg = &path_f32.cfg,
+                                   .power = path_f32.power,
+                                   .power_sq = path_f32.power_sq,
+                                   .window_sum = path_f32.window_sum,
+                                   .window_power = path_f32.window_power};
+  while (simBench_keepRunning(state)) {
+    dspSpectrum_features(&sums, &res);
+    sink = (uint32_t)res.log_band_count;
+  }
+  simBench_setItemsProcessed(state, simBench_iterations(state));
+}
+
+SIM_BENCH(BM_spectrumFeatures) { bench_features(state, 0); }
+SIM_BENCH(BM_spectrumFeaturesBands) { bench_features(state, 1); }
+
+/* 22 band levels, each with +-10 % uniform noise per result (about
+ * 0.5 dB RMS): learn, score 4096 unchanged results (false alarms should be
+ * 0), then raise band 12 by 6 dB and count the results the alarm takes.
+ * Timed: scoring and tracking of unchanged results. */
+#define BENCH_BASELINE_BANDS 22U
+#define BENCH_BASELINE_QUIET 4096U
+static DSP_Baseline_t bench_baseline;
+
+static void bench_baselineLevels(float32_t *rms, uint32_t *seed,
+                                 float32_t step) {
+  for (uint32_t b = 0; b < BENCH_BASELINE_BANDS; b++) {
+    *seed = *seed * 1664525U + 1013904223U;
+    const float32_t u = (float32_t)*seed / 4294967296.0f - 0.5f;
+    rms[b] = (float32_t)(10U + 5U * b) * (1.0f + 0.2f * u) *
+             ((b == 12U) ? step : 1.0f);
+  }
+}
+
+SIM_BENCH(BM_baseline) {
+  float32_t rms[BENCH_BASELINE_BANDS];
+  uint32_t seed = 12345U;
+  uint32_t false_alarms = 0;
+  uint32_t to_alarm = 0;
+
+  dspBaseline_reset(&bench_baseline, DSP_BANDS_THIRD_OCTAVE,
+                    BENCH_BASELINE_BANDS);
+  for (uint32_t n = 0; n < DSP_BASELINE_LEARN_WINDOWS; n++) {
+    bench_baselineLevels(rms, &seed, 1.0f);
+    (void)dspBaseline_update(&bench_baseline, rms, BENCH_BASELINE_BANDS);
+  }
+  for (uint32_t n = 0; n < BENCH_BASELINE_QUIET; n++) {
+    bench_baselineLevels(rms, &seed, 1.0f);
+    if (dspBaseline_update(&bench_baseline, rms, BENCH_BASELINE_BANDS) ==
+        DSP_BASELINE_RAISED) {
+      false_alarms++;
+    }
+  }
+  const float32_t quiet_score = bench_baseline.score;
+  while (to_alarm < 100U && !bench_baseline.alarm) {
+    bench_baselineLevels(rms, &seed, 2.0f);
+    (void)dspBaseline_update(&bench_baseline, rms, BENCH_BASELINE_BANDS);
+    to_alarm++;
+  }
+  DSP_BaselineRecord_t rec;
+  simBench_setCounter(state, "false_alarms", false_alarms);
+  simBench_setCounter(state, "quiet_score", quiet_score);
+  simBench_setCounter(state, "step_score", bench_baseline.score);
+  simBench_setCounter(state, "to_alarm", to_alarm);
+  simBench_setCounter(state, "worst_band", bench_baseline.worst_band);
+  simBench_setCounter(state, "worst_db", bench_baseline.worst_db);
+  simBench_setCounter(state, "state_bytes", sizeof(bench_baseline));
+  simBench_setCounter(state, "record_bytes",
+                      dspBaseline_save(&bench_baseline, &rec));
+
+  dspBaseline_reset(&bench_baseline, DSP_BANDS_THIRD_OCTAVE,
+                    BENCH_BASELINE_BANDS);
+  while (simBench_keepRunning(state)) {
+    bench_baselineLevels(rms, &seed, 1.0f);
+    sink = (uint32_t)dspBaseline_update(&bench_baseline, rms,
+                                        BENCH_BASELINE_BANDS);
+  }
+  simBench_setItemsProcessed(state, simBench_iterations(state));
+}
+
+/* Gear mesh at 750 Hz, 500 codes, with sidebands of 25 codes 8 zoom bins
+ * (0.49 Hz) either side: 256 x 256 points, as a 65536-point FFT */
+#define BENCH_ZOOM_CENTRE_HZ 750.0
+#define BENCH_ZOOM_CARRIER 500.0
+#define BENCH_ZOOM_SIDEBAND 25.0
+#define BENCH_ZOOM_OFFSET_BINS 8U
+#define BENCH_ZOOM_CHUNK 256U
+static DSP_Zoom_t zoom;
+static DSP_ZoomResult_t zoom_res;
+
+/* Untimed: feed the sidebands until a result. Timed: a block per
+ * iteration, and the FFT when a segment is due. */
+SIM_BENCH(BM_zoom) {
+  const DSP_ZoomConfig_t cfg = {.centre_hz = (float)BENCH_ZOOM_CENTRE_HZ,
+                                .span_hz = 10.0f,
+                                .length = 256,
+                                .window = DSP_WINDOW_HANN,
+                                .averages = 1,
+                                .sample_rate_hz = (float)BENCH_FRAME_RATE_HZ};
+  float32_t chunk[BENCH_ZOOM_CHUNK];
+  uint64_t i = 0;
+  uint32_t n = 0;
+
+  if (dspZoom_init(&zoom, 0, NULL, &cfg) != HAL_OK) {
+    simBench_skipWithError(state, "zoom init failed");
+    return;
+  }
+  const double side_hz = (double)zoom.result.bin_hz * BENCH_ZOOM_OFFSET_BINS;
+  while (dspZoom_getResult(&zoom, &zoom_res) != HAL_OK) {
+    for (uint32_t k = 0; k < BENCH_ZOOM_CHUNK; k++, n++) {
+      const double t = (double)n / BENCH_FRAME_RATE_HZ;
+      const double w = 2.0 * M_PI * BENCH_ZOOM_CENTRE_HZ * t;
+      const double m = 2.0 * M_PI * side_hz * t;
+      chunk[k] = (float32_t)(2048.0 + BENCH_ZOOM_CARRIER * sin(w) +
+                             BENCH_ZOOM_SIDEBAND * sin(w - m) +
+                             BENCH_ZOOM_SIDEBAND * sin(w + m));
+    }
+    dspZoom_pushSamples(&zoom, chunk, BENCH_ZOOM_CHUNK);
+    dspZoom_poll(&zoom);
+  }
+
+  // Largest bin more than 3 bins away from the three lines
+  const uint32_t h = (zoom_res.bin_count - 1U) / 2U;
+  float32_t floor_amp = 0.0f;
+  for (uint32_t k = 0; k < zoom_res.bin_count; k++) {
+    const uint32_t d = (k > h) ? k - h : h - k;
+    const uint32_t e = (d > BENCH_ZOOM_OFFSET_BINS)
+                           ? d - BENCH_ZOOM_OFFSET_BINS
+                           : BENCH_ZOOM_OFFSET_BINS - d;
+    if (d > 3U && e > 3U && zoom_res.amplitude[k] > floor_amp) {
+      floor_amp = zoom_res.amplitude[k];
+    }
+  }
+  simBench_setCounter(state, "bin_hz", zoom_res.bin_hz);
+  simBench_setCounter(state, "equiv_points",
+                      (float)BENCH_FRAME_RATE_HZ / zoom_res.bin_hz);
+  simBench_setCounter(state, "ram_bytes", sizeof(zoom));
+  simBench_setCounter(state, "carrier_amp", zoom_res.amplitude[h]);
+  simBench_setCounter(state, "lower_amp",
+                      zoom_res.amplitude[h - BENCH_ZOOM_OFFSET_BINS]);
+  simBench_setCounter(state, "upper_amp",
+                      zoom_res.amplitude[h + BENCH_ZOOM_OFFSET_BINS]);
+  simBench_setCounter(state, "peak_err_hz",
+                      zoom_res.peak_hz - BENCH_ZOOM_CENTRE_HZ);
+  simBench_setCounter(state, "floor_db",
+                      20.0 * log10((floor_amp + 1e-30) / BENCH_ZOOM_CARRIER));
+
+  while (simBench_keepRunning(state)) {
+    dspZoom_process(&zoom, bench_block(i++), ADC_CONVERSIONS_BLOCK_FRAMES);
+    dspZoom_poll(&zoom);
+  }
+  bench_blockThroughput(state);
+}
+
+/* 1.1 kHz carrier of 500 codes, 50 % modulated at 93.75 Hz, both whole
+   cycles in the 16 blocks: the tone should read 250 codes. Not fs / 4: its
+   samples would only hit four phases, and rectify 0 and 1 */
+SIM_BENCH(BM_envelope) {
+  DSP_SpectrumConfig_t cfg = {.length = 1024,
+                              .window = DSP_WINDOW_HANN,
+                              .averages = 4,
+                              .sample_rate_hz = (float)BENCH_FRAME_RATE_HZ / 4.0f,
+                              .min_peak_hz = 5.0f,
+                              .tone_count = 2,
+                              .tone_hz = {93.75f, 135.4f},
+                              .tone_search_hz = 3.0f};
+  DSP_SpectrumResult_t res;
+  uint64_t i = 0;
+
+  for (uint32_t b = 0; b < BENCH_DSP_BLOCKS; b++) {
+    for (uint32_t f = 0; f < ADC_CONVERSIONS_BLOCK_FRAMES; f++) {
+      const float t = (float)(b * ADC_CONVERSIONS_BLOCK_FRAMES + f) /
+                      (float)BENCH_FRAME_RATE_HZ;
+      const float x = 500.0f * (1.0f + 0.5f * cosf(2.0f * PI * 93.75f * t)) *
+                      sinf(2.0f * PI * 1100.5859375f * t);
+      for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+        blocks[b][f * ADC_CONVERSIONS_CHANNEL_COUNT + ch] =
+            (uint16_t)lrintf(2048.0f + x);
+      }
+    }
+  }
+  if (dspSpectrum_init(&env_spec, 0, NULL, &cfg) != HAL_OK ||
+      pipelineBiquad_init(&env_band, &dspFilter_bandpass500to1500Hz) !=
+          HAL_OK ||
+      pipelineBiquad_init(&env_lp, &dspFilter_lowpass200Hz) != HAL_OK ||
+      pipeline_init(&env_pipe, env_branches, 1, NULL) != HAL_OK) {
+    simBench_skipWithError(state, "envelope init failed");
+    return;
+  }
+  while (simBench_keepRunning(state)) {
+    pipeline_run(&env_pipe, bench_block(i++), ADC_CONVERSIONS_BLOCK_FRAMES);
+    pipeline_poll(&env_pipe);
+    if (dspSpectrum_getResult(&env_spec, &res) == HAL_OK) {
+      simBench_setCounter(state, "fault_hz", res.tone_hz[0]);
+      simBench_setCounter(state, "fault_amp", res.tone_amplitude[0]);
+      simBench_setCounter(state, "other_amp", res.tone_amplitude[1]);
+    }
+  }
+  bench_blockThroughput(state);
+}
+
+/* The loopback tone, 1640 codes at 1/67 of the rate (not a whole number of
+   cycles), a -70 dBc third harmonic and 0.5 code RMS of uniform noise on
+   top of the rounding: SINAD 64.6 dB, ENOB 10.4. The rounding repeats every
+   67 samples too, so a little of it reads as harmonics, not noise */
+SIM_BENCH(BM_dspQuality) {
+  static uint16_t record[DSP_QUALITY_LENGTH_MAX];
+  const float h3 = 1640.0f * powf(10.0f, -70.0f / 20.0f);
+  uint32_t seed = 2463534242U;
+  DSP_QualityResult_t q = {0};
+
+  for (uint32_t i = 0; i < DSP_QUALITY_LENGTH_MAX; i++) {
+    const float x = 2.0f * PI * (float)i / 67.0f;
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    const float noise = ((float)seed / 4294967296.0f - 0.5f) * sqrtf(3.0f);
+    record[i] = (uint16_t)lrintf(2048.0f + 1640.0f * sinf(x) +
+                                 h3 * sinf(3.0f * x) + noise);
+  }
+  while (simBench_keepRunning(state)) {
+    if (dspQuality_analyse(record, DSP_QUALITY_LENGTH_MAX, &q) != HAL_OK) {
+      simBench_skipWithError(state, "no tone found");
+      return;
+    }
+  }
+  simBench_setCounter(state, "tone_x67", q.tone * 67.0f);
+  simBench_setCounter(state, "amplitude", q.amplitude);
+  simBench_setCounter(state, "snr_db", q.snr_db);
+  simBench_setCounter(state, "thd_db", q.thd_db);
+  simBench_setCounter(state, "sinad_db", q.sinad_db);
+  simBench_setCounter(state, "sfdr_db", q.sfdr_db);
+  simBench_setCounter(state, "enob", q.enob);
+  simBench_setItemsProcessed(state, simBench_iterations(state) *
+                                        DSP_QUALITY_LENGTH_MAX);
+}
+
+/* Window features of sensor 1: RMS 100, peak-to-peak 600, crest 3,
+   kurtosis 3, bands 70/70 codes with kurtosis 3, each with 2 % noise;
+   shift adds 30 % to the RMS of X */
+static void bench_anomalyWindow(TelemetryFrame_Features_t *f, uint32_t *seed,
+                                float shift) {
+  static const float level[NN_ANOMALY_CHANNEL_INPUTS] = {
+      100.0f, 600.0f, 3.0f, 3.0f, 70.0f, 70.0f, 3.0f, 3.0f};
+  float v[NN_ANOMALY_CHANNEL_INPUTS];
+
+  memset(f, 0, sizeof(*f));
+  for (uint8_t ch = 0; ch < 3U; ch++) {
+    for (uint8_t i = 0; i < NN_ANOMALY_CHANNEL_INPUTS; i++) {
+      *seed ^= *seed << 13;
+      *seed ^= *seed >> 17;
+      *seed ^= *seed << 5;
+      const float u = (float)*seed / 4294967296.0f - 0.5f;
+      v[i] = level[i] * (1.0f + 0.02f * sqrtf(12.0f) * u);
+    }
+    if (ch == 0U) {
+      v[0] *= 1.0f + shift;
+    }
+    f->value[ch][TELEMETRY_FRAME_FEATURE_RMS] = v[0];
+    f->value[ch][TELEMETRY_FRAME_FEATURE_PEAK_TO_PEAK] = v[1];
+    f->value[ch][TELEMETRY_FRAME_FEATURE_CREST] = v[2];
+    f->value[ch][TELEMETRY_FRAME_FEATURE_KURTOSIS] = v[3];
+    nnAnomaly_setBands(ch, &v[4], &v[6], NN_ANOMALY_BANDS);
+  }
+}
+
+/* Sensor 1 scored twice: on the baseline (mean z^2, learned over 200
+   windows), and through a 24-8-24 int8 autoencoder with arbitrary weights,
+   which only times the CMSIS-NN layers. Counters are the baseline scores of
+   normal and shifted windows; a score per window */
+SIM_BENCH(BM_nnAnomaly) {
+  enum { IN = 3U * NN_ANOMALY_CHANNEL_INPUTS, HIDDEN = 8U };
+  static q7_t w1[HIDDEN * IN], b1[HIDDEN], w2[IN * HIDDEN], b2[IN];
+  TelemetryFrame_Features_t f;
+  uint32_t seed = 88172645U;
+
+  for (uint32_t i = 0; i < HIDDEN * IN; i++) {
+    w1[i] = (q7_t)((int32_t)(i * 37U % 61U) - 30);
+    w2[i] = (q7_t)((int32_t)(i * 53U % 59U) - 29);
+  }
+  memset(b1, 1, sizeof(b1));
+  memset(b2, 0, sizeof(b2));
+  const NnAnomaly_Model_t model = {
+      .magic = NN_ANOMALY_MAGIC,
+      .inputs = IN,
+      .input_frac_bits = 4,
+      .output_frac_bits = 4,
+      .layer_count = 2,
+      .layer = {{w1, b1, IN, HIDDEN, 4, 7, 1}, {w2, b2, HIDDEN, IN, 4, 6, 0}}};
+  const NnAnomaly_Config_t cfg = {
+      .group = {{.channel_mask = 0x07, .threshold = 4.0f},
+                {.channel_mask = 0x07, .model = &model}},
+      .group_count = 2,
+      .cadence = 1,
+      .learn_windows = 200};
+  if (nnAnomaly_init(&cfg) != HAL_OK) {
+    simBench_skipWithError(state, "anomaly init failed");
+    return;
+  }
+  for (uint32_t w = 0; w < cfg.learn_windows; w++) {
+    bench_anomalyWindow(&f, &seed, 0.0f);
+    (void)nnAnomaly_addWindow(&f);
+  }
+
+  NnAnomaly_Result_t r = {0};
+  float normal = 0.0f;
+  uint32_t n = 0;
+  while (simBench_keepRunning(state)) {
+    bench_anomalyWindow(&f, &seed, 0.0f);
+    if (nnAnomaly_addWindow(&f) == HAL_OK &&
+        nnAnomaly_getResult(&r) == HAL_OK) {
+      normal += r.score_mean[0];
+      n++;
+    }
+  }
+  bench_anomalyWindow(&f, &seed, 0.3f);
+  (void)nnAnomaly_addWindow(&f);
+  (void)nnAnomaly_getResult(&r);
+  simBench_setCounter(state, "normal_score", (n != 0U) ? normal / n : 0.0f);
+  simBench_setCounter(state, "shifted_score", r.score_mean[0]);
+  simBench_setCounter(state, "alarm", (float)(r.alarm_mask & 1U));
+  simBench_setItemsProcessed(state, simBench_iterations(state));
+}
+
+/* 250 codes at 46.9 Hz (bin 12) on every channel; bins at 6, 12 .. 96 */
+static HAL_StatusTypeDef bench_goertzelSetup(void) {
+  float32_t hz[DSP_GOERTZEL_MAX_BINS];
+  const float32_t bin_hz =
+      (float32_t)BENCH_FRAME_RATE_HZ / (float32_t)BENCH_GOERTZEL_WINDOW;
+
+  for (uint32_t b = 0; b < BENCH_DSP_BLOCKS; b++) {
+    for (uint32_t f = 0; f < ADC_CONVERSIONS_BLOCK_FRAMES; f++) {
+      const float t = (float)(b * ADC_CONVERSIONS_BLOCK_FRAMES + f) /
+                      (float)BENCH_FRAME_RATE_HZ;
+      const float x = 250.0f * sinf(2.0f * PI * 12.0f * bin_hz * t);
+      for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+        blocks[b][f * ADC_CONVERSIONS_CHANNEL_COUNT + ch] =
+            (uint16_t)lrintf(2048.0f + x);
+      }
+    }
+  }
+  for (uint8_t k = 0; k < DSP_GOERTZEL_MAX_BINS; k++) {
+    hz[k] = 6.0f * (float32_t)(k + 1U) * bin_hz;
+  }
+  if (dspGoertzel_init(&goertzel, (float32_t)BENCH_FRAME_RATE_HZ,
+                       BENCH_GOERTZEL_WINDOW, NULL) != HAL_OK) {
+    return HAL_ERROR;
+  }
+  for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+    if (dspGoertzel_setBins(&goertzel, ch, hz, DSP_GOERTZEL_MAX_BINS) !=
+        HAL_OK) {
+      return HAL_ERROR;
+    }
+  }
+  return HAL_OK;
+}
+
+static void bench_goertzelCounters(SimBench_State_t *state) {
+  DSP_GoertzelResult_t res;
+  if (dspGoertzel_getResult(&goertzel, &res) == HAL_OK) {
+    simBench_setCounter(state, "tone_amp", res.amplitude[0][1]);
+    simBench_setCounter(state, "other_amp", res.amplitude[0][2]);
+  }
+}
+
+SIM_BENCH(BM_goertzel) {
+  uint64_t i = 0;
+
+  if (bench_goertzelSetup() != HAL_OK) {
+    simBench_skipWithError(state, "goertzel init failed");
+    return;
+  }
+  while (simBench_keepRunning(state)) {
+    dspGoertzel_process(&goertzel, bench_block(i++),
+                        ADC_CONVERSIONS_BLOCK_FRAMES);
+  }
+  bench_goertzelCounters(state);
+  bench_blockThroughput(state);
+}
+
+SIM_BENCH(BM_velocity) {
+  const DSP_VelocityConfig_t cfg = {
+      .sample_rate_hz = BENCH_VELOCITY_RATE_HZ,
+      .low_hz = DSP_VELOCITY_LOW_HZ,
+      .high_hz = DSP_VELOCITY_HIGH_HZ,
+      .mg_per_code = ADC_CAL_NOMINAL_MG_PER_CODE,
+      .interval_ms = 1000,
+      .channels = ADC_CHANNELS_MASK_ALL,
+      .zone_mm_s = {1.4f, 2.8f, 4.5f}};
+  DSP_VelocityResult_t res = {0};
+  uint64_t i = 0;
+
+  for (uint32_t b = 0; b < BENCH_DSP_BLOCKS; b++) {
+    for (uint32_t f = 0; f < ADC_CONVERSIONS_BLOCK_FRAMES; f++) {
+      const double phase = 2.0 * M_PI * (double)(f % BENCH_VELOCITY_PERIOD) /
+                           (double)BENCH_VELOCITY_PERIOD;
+      const uint16_t code =
+          (uint16_t)lrint(2048.0 + BENCH_VELOCITY_CODES * sin(phase));
+      for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+        blocks[b][f * ADC_CONVERSIONS_CHANNEL_COUNT + ch] = code;
+      }
+    }
+  }
+  if (dspVelocity_init(&velocity, &cfg, NULL) != HAL_OK) {
+    simBench_skipWithError(state, "velocity init failed");
+    return;
+  }
+  while (simBench_keepRunning(state)) {
+    dspVelocity_process(&velocity, bench_block(i++),
+                        ADC_CONVERSIONS_BLOCK_FRAMES);
+    (void)dspVelocity_getResult(&velocity, &res);
+  }
+  const double ideal = BENCH_VELOCITY_CODES * ADC_CAL_NOMINAL_MG_PER_CODE *
+                       9.80665 /
+                       (2.0 * M_PI * BENCH_VELOCITY_RATE_HZ /
+                        BENCH_VELOCITY_PERIOD) /
+                       sqrt(2.0);
+  simBench_setCounter(state, "rms_ch0_mm_s", res.rms_mm_s[0]);
+  simBench_setCounter(state, "ideal_mm_s", ideal);
+  simBench_setCounter(state, "zone_ch0", res.zone[0]);
+  simBench_setCounter(state, "results", res.sequence);
+  bench_blockThroughput(state);
+}
+
+SIM_BENCH(BM_coherence) {
+  const DSP_SpectrumConfig_t spec_cfg = {.length = 1024,
+                                         .window = DSP_WINDOW_HANN,
+                                         .averages = 4,
+                                         .sample_rate_hz = 4000.0f,
+                                         .min_peak_hz = 5.0f};
+  const DSP_CoherenceConfig_t cfg = {.averages = 16,
+                                     .pair_count = 2,
+                                     .pairs = {{0, 1}, {0, 2}},
+                                     .freq_count = 1,
+                                     .freq_hz = {62.5f}};
+  DSP_Spectrum_t *const inputs[] = {&coh_spec[0], &coh_spec[1], &coh_spec[2]};
+  DSP_CoherenceResult_t res = {0};
+  uint32_t lcg = 12345U;
+  uint64_t i = 0;
+
+  for (uint32_t b = 0; b < BENCH_DSP_BLOCKS; b++) {
+    for (uint32_t f = 0; f < ADC_CONVERSIONS_BLOCK_FRAMES; f++) {
+      const double phase = 2.0 * M_PI * (double)(f % BENCH_VELOCITY_PERIOD) /
+                           (double)BENCH_VELOCITY_PERIOD;
+      uint16_t *frame = &blocks[b][f * ADC_CONVERSIONS_CHANNEL_COUNT];
+      lcg = lcg * 1664525U + 1013904223U;
+      frame[0] = (uint16_t)lrint(2048.0 + 200.0 * sin(phase));
+      frame[1] = (uint16_t)lrint(
+          2048.0 +
+          100.0 * sin(phase + BENCH_COHERENCE_LEAD_DEG * M_PI / 180.0));
+      frame[2] = (uint16_t)(1848U + (lcg >> 23)); // +-256 codes
+      for (uint8_t ch = 3; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+        frame[ch] = 2048U;
+      }
+    }
+  }
+  for (uint8_t ch = 0; ch < 3U; ch++) {
+    if (dspSpectrum_init(&coh_spec[ch], ch, NULL, &spec_cfg) != HAL_OK) {
+      simBench_skipWithError(state, "spectrum init failed");
+      return;
+    }
+  }
+  if (dspCoherence_init(&coh, &cfg, inputs, 3) != HAL_OK) {
+    simBench_skipWithError(state, "coherence init failed");
+    return;
+  }
+  while (simBench_keepRunning(state)) {
+    const uint16_t *block = bench_block(i++);
+    for (uint8_t ch = 0; ch < 3U; ch++) {
+      dspSpectrum_process(&coh_spec[ch], block, ADC_CONVERSIONS_BLOCK_FRAMES);
+      dspSpectrum_poll(&coh_spec[ch]);
+    }
+    (void)dspCoherence_getResult(&coh, &res);
+  }
+  simBench_setCounter(state, "coh_01", res.coherence[0][0]);
+  simBench_setCounter(state, "phase_01_deg", res.phase_deg[0][0]);
+  simBench_setCounter(state, "gain_01", res.gain[0][0]);
+  simBench_setCounter(state, "coh_02", res.coherence[1][0]);
+  simBench_setCounter(state, "results", res.sequence);
+  simBench_setCounter(state, "missed", coh.missed);
+  bench_blockThroughput(state);
+}
+
+SIM_BENCH(BM_moments) {
+  const DSP_SpectrumConfig_t spec_cfg = {.length = 1024,
+                                         .window = DSP_WINDOW_HANN,
+                                         .averages = 8,
+                                         .sample_rate_hz = 4000.0f,
+                                         .min_peak_hz = 5.0f,
+                                         .band_count = 1,
+                                         .bands = {{100.0f, 1900.0f}}};
+  DSP_StatsAccum_t acc[ADC_CONVERSIONS_CHANNEL_COUNT];
+  DSP_SpectrumResult_t res[2] = {0};
+  uint32_t lcg = 2024U;
+  uint64_t i = 0;
+
+  for (uint32_t b = 0; b < BENCH_DSP_BLOCKS; b++) {
+    for (uint32_t f = 0; f < ADC_CONVERSIONS_BLOCK_FRAMES; f++) {
+      const double phase = 2.0 * M_PI * (double)(f % BENCH_VELOCITY_PERIOD) /
+                           (double)BENCH_VELOCITY_PERIOD;
+      const uint16_t code = (uint16_t)lrint(2048.0 + 400.0 * sin(phase));
+      uint16_t *frame = &blocks[b][f * ADC_CONVERSIONS_CHANNEL_COUNT];
+      lcg = lcg * 1664525U + 1013904223U;
+      for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+        frame[ch] = code;
+      }
+      if ((lcg >> 24) == 0U) { // 1 in 256 frames
+        frame[1] = (uint16_t)(code + BENCH_MOMENTS_IMPACT);
+      }
+    }
+  }
+  for (uint8_t ch = 0; ch < 2U; ch++) {
+    if (dspSpectrum_init(&moment_spec[ch], ch, NULL, &spec_cfg) != HAL_OK) {
+      simBench_skipWithError(state, "spectrum init failed");
+      return;
+    }
+  }
+  dspStats_reset(acc);
+  while (simBench_keepRunning(state)) {
+    const uint16_t *block = bench_block(i++);
+    dspStats_accumulate(acc, block, ADC_CONVERSIONS_BLOCK_FRAMES);
+    for (uint8_t ch = 0; ch < 2U; ch++) {
+      dspSpectrum_process(&moment_spec[ch], block, ADC_CONVERSIONS_BLOCK_FRAMES);
+      dspSpectrum_poll(&moment_spec[ch]);
+      (void)dspSpectrum_getResult(&moment_spec[ch], &res[ch]);
+    }
+  }
+  ADC_ChannelStats_t tone;
+  ADC_ChannelStats_t impact;
+  dspStats_compute(&acc[0], &tone);
+  dspStats_compute(&acc[1], &impact);
+  simBench_setCounter(state, "kurt_tone", tone.kurtosis);
+  simBench_setCounter(state, "skew_tone", tone.skewness);
+  simBench_setCounter(state, "kurt_impact", impact.kurtosis);
+  simBench_setCounter(state, "skew_impact", impact.skewness);
+  simBench_setCounter(state, "sk_tone", res[0].band_kurtosis[0]);
+  simBench_setCounter(state, "sk_impact", res[1].band_kurtosis[0]);
+  bench_blockThroughput(state);
+}
+
+SIM_BENCH(BM_dspFusedGoertzel) {
+  uint64_t i = 0;
+
+  adcCal_init();
+  if (bench_goertzelSetup() != HAL_OK ||
+      dspFused_init(&fused, 8, NULL, &dspFilter_lowpass200Hz) != HAL_OK ||
+      dspFused_attachGoertzel(&fused, &goertzel) != HAL_OK) {
+    simBench_skipWithError(state, "fused init failed");
+    return;
+  }
+  while (simBench_keepRunning(state)) {
+    sink += dspFused_process(&fused, bench_block(i++),
+                             ADC_CONVERSIONS_BLOCK_FRAMES, mg_out);
+  }
+  bench_goertzelCounters(state);
+  bench_blockThroughput(state);
+}
+
+/* Blocks of bench_goertzelSetup(); bins at 3, 6, 9 and 12 */
+static HAL_StatusTypeDef bench_sdftSetup(void) {
+  float32_t hz[DSP_SDFT_MAX_BINS];
+  const float32_t bin_hz =
+      (float32_t)BENCH_FRAME_RATE_HZ / (float32_t)BENCH_SDFT_WINDOW;
+
+  if (bench_goertzelSetup() != HAL_OK ||
+      dspSdft_init(&sdft, (float32_t)BENCH_FRAME_RATE_HZ, BENCH_SDFT_WINDOW,
+                   0.0f, NULL) != HAL_OK) {
+    return HAL_ERROR;
+  }
+  for (uint8_t k = 0; k < DSP_SDFT_MAX_BINS; k++) {
+    hz[k] = 3.0f * (float32_t)(k + 1U) * bin_hz;
+  }
+  for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+    if (dspSdft_setBins(&sdft, ch, hz, DSP_SDFT_MAX_BINS) != HAL_OK) {
+      return HAL_ERROR;
+    }
+  }
+  return HAL_OK;
+}
+
+/* The tone is a sine: its cosine phase at sample n is w n - 90 degrees */
+static void bench_sdftCounters(SimBench_State_t *state) {
+  DSP_SdftLatest_t now;
+  if (dspSdft_getLatest(&sdft, &now) != HAL_OK) {
+    return;
+  }
+  const uint32_t n = now.sample % (BENCH_DSP_BLOCKS *
+                                   ADC_CONVERSIONS_BLOCK_FRAMES);
+  const float32_t w = 2.0f * PI * 3.0f / (float32_t)BENCH_SDFT_WINDOW;
+  float32_t err = now.phase[0][0] - (w * (float32_t)n - PI / 2.0f);
+  err = fmodf(err, 2.0f * PI);
+  err += (err > PI) ? -2.0f * PI : (err <= -PI) ? 2.0f * PI : 0.0f;
+  simBench_setCounter(state, "tone_amp", now.amplitude[0][0]);
+  simBench_setCounter(state, "other_amp", now.amplitude[0][1]);
+  simBench_setCounter(state, "phase_err_deg", err * 180.0f / PI);
+}
+
+SIM_BENCH(BM_sdft) {
+  uint64_t i = 0;
+
+  if (bench_sdftSetup() != HAL_OK) {
+    simBench_skipWithError(state, "sdft init failed");
+    return;
+  }
+  while (simBench_keepRunning(state)) {
+    dspSdft_process(&sdft, bench_block(i++), ADC_CONVERSIONS_BLOCK_FRAMES);
+  }
+  bench_sdftCounters(state);
+  bench_blockThroughput(state);
+}
+
+SIM_BENCH(BM_dspFusedSdft) {
+  uint64_t i = 0;
+
+  adcCal_init();
+  if (bench_sdftSetup() != HAL_OK ||
+      dspFused_init(&fused, 8, NULL, &dspFilter_lowpass200Hz) != HAL_OK ||
+      dspFused_attachSdft(&fused, &sdft) != HAL_OK) {
+    simBench_skipWithError(state, "fused init failed");
+    return;
+  }
+  while (simBench_keepRunning(state)) {
+    sink += dspFused_process(&fused, bench_block(i++),
+                             ADC_CONVERSIONS_BLOCK_FRAMES, mg_out);
+  }
+  bench_sdftCounters(state);
+  bench_blockThroughput(state);
+}
+
+static int bench_codeCompare(const void *a, const void *b) {
+  return (int)*(const uint16_t *)a - (int)*(const uint16_t *)b;
+}
+
+/* Channel 0 over the 16 blocks once: histogram percentiles minus exact */
+static void bench_histogramCounters(SimBench_State_t *state) {
+  static const float32_t pct[] = {1.0f, 50.0f, 99.0f};
+  static const char *const names[] = {"p1_err", "p50_err", "p99_err"};
+  const uint32_t n = BENCH_DSP_BLOCKS * ADC_CONVERSIONS_BLOCK_FRAMES;
+  float32_t code[3];
+
+  dspHistogram_reset(&hist);
+  for (uint32_t b = 0; b < BENCH_DSP_BLOCKS; b++) {
+    dspHistogram_process(&hist, blocks[b], ADC_CONVERSIONS_BLOCK_FRAMES);
+    for (uint32_t f = 0; f < ADC_CONVERSIONS_BLOCK_FRAMES; f++) {
+      hist_sorted[b * ADC_CONVERSIONS_BLOCK_FRAMES + f] =
+          blocks[b][f * ADC_CONVERSIONS_CHANNEL_COUNT];
+    }
+  }
+  qsort(hist_sorted, n, sizeof(hist_sorted[0]), bench_codeCompare);
+  if (dspHistogram_snapshot(&hist, 0, &hist_snap, 0) != HAL_OK ||
+      dspHistogram_percentiles(&hist_snap, pct, 3, code) != HAL_OK) {
+    return;
+  }
+  for (uint8_t i = 0; i < 3U; i++) {
+    const uint32_t rank = (uint32_t)(pct[i] / 100.0f * (float32_t)(n - 1U));
+    simBench_setCounter(state, names[i],
+                        code[i] - (float32_t)hist_sorted[rank]);
+  }
+  simBench_setCounter(state, "bin_codes",
+                      (float32_t)(1U << BENCH_HISTOGRAM_SHIFT));
+}
+
+SIM_BENCH(BM_histogram) {
+  uint64_t i = 0;
+
+  bench_fillBlocks();
+  if (dspHistogram_init(&hist, BENCH_HISTOGRAM_SHIFT, NULL) != HAL_OK) {
+    simBench_skipWithError(state, "histogram init failed");
+    return;
+  }
+  while (simBench_keepRunning(state)) {
+    dspHistogram_process(&hist, bench_block(i++),
+                         ADC_CONVERSIONS_BLOCK_FRAMES);
+  }
+  bench_histogramCounters(state);
+  bench_blockThroughput(state);
+}
+
+SIM_BENCH(BM_dspFusedHistogram) {
+  uint64_t i = 0;
+
+  bench_fillBlocks();
+  adcCal_init();
+  if (dspHistogram_init(&hist, BENCH_HISTOGRAM_SHIFT, NULL) != HAL_OK ||
+      dspFused_init(&fused, 8, NULL, &dspFilter_lowpass200Hz) != HAL_OK ||
+      dspFused_attachHistogram(&fused, &hist) != HAL_OK) {
+    simBench_skipWithError(state, "fused init failed");
+    return;
+  }
+  while (simBench_keepRunning(state)) {
+    sink += dspFused_process(&fused, bench_block(i++),
+                             ADC_CONVERSIONS_BLOCK_FRAMES, mg_out);
+  }
+  // Every frame counted once, as many as the kernel was fed
+  simBench_setCounter(state, "frames_missed",
+                      (float32_t)(i * ADC_CONVERSIONS_BLOCK_FRAMES -
+                                  hist.frames));
+  bench_histogramCounters(state);
+  bench_blockThroughput(state);
+}
+
+/* E1049 X1.4: peaks -2 1 -3 5 -1 3 -4 4 -2 make, counting the residual
+ * as half cycles, ranges 3 4 6 8 9 x 0.5 1.5 0.5 1 0.5 */
+static float32_t bench_rainflowAstm(void) {
+  static const int8_t peaks[] = {-2, 1, -3, 5, -1, 3, -4, 4, -2};
+  static const float32_t expect[DSP_RAINFLOW_RANGE_BINS] = {
+      [3] = 0.5f, [4] = 1.5f, [6] = 0.5f, [8] = 1.0f, [9] = 0.5f};
+  const DSP_RainflowConfig_t cfg = {.range_bin_codes = BENCH_RAINFLOW_UNIT,
+                                    .mean_low_codes = 0.0f,
+                                    .mean_bin_codes = 4096.0f,
+                                    .units_per_code = 1.0f};
+  float32_t got[DSP_RAINFLOW_RANGE_BINS] = {0};
+  uint32_t f = 0;
+
+  if (dspRainflow_init(&rainflow, &cfg, NULL) != HAL_OK) {
+    return -1.0f;
+  }
+  dspRainflow_setChannels(&rainflow, 0x01U);
+  // Straight lines between the peaks, a code per 10 frames
+  for (uint8_t i = 0; i + 1U < sizeof(peaks); i++) {
+    const int32_t a = 2048 + BENCH_RAINFLOW_UNIT * peaks[i];
+    const int32_t b = 2048 + BENCH_RAINFLOW_UNIT * peaks[i + 1U];
+    for (int32_t x = a; x != b; x += (b > a) ? 10 : -10) {
+      rainflow_block[f++ * ADC_CONVERSIONS_CHANNEL_COUNT] = (uint16_t)x;
+      if (f == ADC_CONVERSIONS_BLOCK_FRAMES) {
+        dspRainflow_process(&rainflow, rainflow_block, f);
+        f = 0;
+      }
+    }
+  }
+  rainflow_block[f++ * ADC_CONVERSIONS_CHANNEL_COUNT] =
+      (uint16_t)(2048 + BENCH_RAINFLOW_UNIT * peaks[sizeof(peaks) - 1U]);
+  dspRainflow_process(&rainflow, rainflow_block, f);
+
+  // Full cycles from the matrix, then the residual and the last extreme
+  const DSP_RainflowChannel_t *c = &rainflow.slot[0];
+  for (uint8_t r = 0; r < DSP_RAINFLOW_RANGE_BINS; r++) {
+    got[r] = 0.5f * (float32_t)c->half_cycles[r][0];
+  }
+  int16_t points[DSP_RAINFLOW_STACK + 1U];
+  uint8_t n = c->depth;
+  memcpy(points, c->stack, n * sizeof(points[0]));
+  points[n++] = c->extreme;
+  for (uint8_t i = 1; i < n; i++) {
+    got[abs(points[i] - points[i - 1U]) / BENCH_RAINFLOW_UNIT] += 0.5f;
+  }
+  float32_t err = 0.0f;
+  for (uint8_t r = 0; r < DSP_RAINFLOW_RANGE_BINS; r++) {
+    err += fabsf(got[r] - expect[r]);
+  }
+  return err;
+}
+
+SIM_BENCH(BM_rainflow) {
+  const DSP_RainflowConfig_t cfg = {.hysteresis_codes = 8,
+                                    .range_bin_codes = 32.0f,
+                                    .mean_low_codes = 1792.0f,
+                                    .mean_bin_codes = 64.0f,
+                                    .units_per_code =
+                                        ADC_CAL_NOMINAL_MG_PER_CODE,
+                                    .sn = &rainflow_sn};
+  uint64_t i = 0;
+
+  const float32_t astm_err = bench_rainflowAstm();
+  bench_fillBlocks();
+  if (dspRainflow_init(&rainflow, &cfg, NULL) != HAL_OK) {
+    simBench_skipWithError(state, "rainflow init failed");
+    return;
+  }
+  dspRainflow_setChannels(&rainflow,
+                          (1U << ADC_CONVERSIONS_CHANNEL_COUNT) - 1U);
+  while (simBench_keepRunning(state)) {
+    dspRainflow_process(&rainflow, bench_block(i++),
+                        ADC_CONVERSIONS_BLOCK_FRAMES);
+  }
+  // A cycle per period of the tone, all near its 1200-code range, but for
+  // the seam where the 16 blocks wrap
+  if (dspRainflow_snapshot(&rainflow, 0, &rainflow_res, 0) == HAL_OK) {
+    const float32_t cycles = 0.5f * (float32_t)rainflow_res.half_total;
+    const float32_t seconds = (float32_t)(i * ADC_CONVERSIONS_BLOCK_FRAMES) /
+                              (float32_t)BENCH_FRAME_RATE_HZ;
+    const float32_t expect =
+        cycles * dspRainflow_cycleDamage(&rainflow,
+                                         (float32_t)rainflow_res.largest_range);
+    simBench_setCounter(state, "cycles_per_s", cycles / seconds);
+    simBench_setCounter(state, "range_codes",
+                        (float32_t)rainflow_res.largest_range);
+    simBench_setCounter(state, "damage_ratio",
+                        rainflow_res.damage / expect);
+  }
+  simBench_setCounter(state, "astm_err", astm_err);
+  bench_blockThroughput(state);
+}
+
+SIM_BENCH(BM_srs) {
+  const uint32_t pulse =
+      (uint32_t)(BENCH_SRS_PULSE_S * (float32_t)BENCH_FRAME_RATE_HZ);
+  memset(srs_frames, 0, sizeof(srs_frames));
+  for (uint32_t n = 0; n < BENCH_SRS_FRAMES; n++) {
+    const uint32_t t = n - BENCH_SRS_PRE_FRAMES;
+    const float32_t x = (n >= BENCH_SRS_PRE_FRAMES && t <= pulse)
+                            ? BENCH_SRS_PULSE_CODES *
+                                  sinf(PI * (float32_t)t / (float32_t)pulse)
+                            : 0.0f;
+    srs_frames[n].samples[0] = (uint16_t)lrintf(2048.0f + x);
+  }
+  if (dspSrs_init(&srs_bank, (float32_t)BENCH_FRAME_RATE_HZ, 10.0f, 1000.0f,
+                  6, 10.0f) != HAL_OK) {
+    simBench_skipWithError(state, "srs init failed");
+    return;
+  }
+  while (simBench_keepRunning(state)) {
+    dspSrs_compute(&srs_bank, srs_frames, BENCH_SRS_FRAMES, 0,
+                   BENCH_SRS_PRE_FRAMES, ADC_CAL_NOMINAL_MG_PER_CODE,
+                   &srs_res);
+  }
+  // Well above 1 / pulse the mass follows the base; the peak of a
+  // half-sine's SRS at Q = 10 is about 1.7 times the input's
+  float32_t peak = 0.0f;
+  for (uint8_t k = 0; k < srs_res.count; k++) {
+    peak = fmaxf(peak, srs_res.peak_mg[k]);
+  }
+  simBench_setCounter(state, "freqs", (float32_t)srs_res.count);
+  simBench_setCounter(state, "high_ratio",
+                      srs_res.peak_mg[srs_res.count - 1U] /
+                          srs_res.input_peak_mg);
+  simBench_setCounter(state, "peak_ratio", peak / srs_res.input_peak_mg);
+  simBench_setItemsProcessed(state, simBench_iterations(state));
+}
+
+SIM_BENCH(BM_arrival) {
+  const DSP_ArrivalConfig_t cfg = {.threshold_sigma = 8.0f,
+                                   .min_threshold_codes = 40,
+                                   .mask = TELEMETRY_FRAME_ALL_CHANNELS};
+  uint32_t lcg = 1;
+  for (uint32_t n = 0; n < BENCH_SRS_FRAMES; n++) {
+    srs_frames[n].error_mask = 0;
+    for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+      const float32_t t =
+          (float32_t)n - BENCH_ARRIVAL_ONSET - BENCH_ARRIVAL_STEP * ch;
+      lcg = lcg * 1664525U + 1013904223U;
+      const float32_t noise = (float32_t)(lcg >> 29) - 3.5f;
+      const float32_t front =
+          (t <= 0.0f)                  ? 0.0f
+          : (t >= BENCH_ARRIVAL_RISE) ? 800.0f
+              : 400.0f * (1.0f - cosf(PI * t / BENCH_ARRIVAL_RISE));
+      srs_frames[n].samples[ch] = (uint16_t)lrintf(2048.0f + noise + front);
+    }
+  }
+  uint32_t detected = 0;
+  while (simBench_keepRunning(state)) {
+    detected += (dspArrival_compute(&cfg, srs_frames, BENCH_SRS_FRAMES,
+                                    BENCH_SRS_PRE_FRAMES / 2U,
+                                    &arrival_res) == HAL_OK);
+  }
+  // The front crosses the threshold equally late on every channel
+  float32_t err = 0.0f;
+  for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+    err = fmaxf(err, fabsf(arrival_res.delta_frames[ch] -
+                           BENCH_ARRIVAL_STEP * (float32_t)ch));
+  }
+  simBench_setCounter(state, "channels",
+                      (float32_t)__builtin_popcount(arrival_res.detected));
+  simBench_setCounter(state, "max_err_us",
+                      err * 1.0e6f / (float32_t)BENCH_FRAME_RATE_HZ);
+  simBench_setCounter(state, "detected", (float32_t)(detected != 0U));
+  simBench_setItemsProcessed(state, simBench_iterations(state));
+}
+
+/* Full-rate frames of block b: a sine of hz true Hz on the fast clock */
+static void bench_asrcBlock(uint32_t b, double hz) {
+  const double local_hz = BENCH_FRAME_RATE_HZ * (1.0 + BENCH_ASRC_PPM * 1e-6);
+  for (uint32_t f = 0; f < ADC_CONVERSIONS_BLOCK_FRAMES; f++) {
+    const double t = (double)(b * ADC_CONVERSIONS_BLOCK_FRAMES + f) / local_hz;
+    for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+      asrc_in[ch][f] =
+          (float32_t)(BENCH_ASRC_AMPLITUDE * sin(2.0 * PI * hz * t + ch));
+    }
+  }
+}
+
+/* One block through the converter, as dspFilter_process() runs it */
+static uint32_t bench_asrcProcess(uint32_t b, uint32_t *seq) {
+  const uint32_t n = dspAsrc_plan(&asrc, b * ADC_CONVERSIONS_BLOCK_FRAMES,
+                                  ADC_CONVERSIONS_BLOCK_FRAMES, BENCH_ASRC_D,
+                                  asrc_taps, ADC_CONVERSIONS_BLOCK_FRAMES, seq);
+  for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+    dspAsrc_interpolate(&asrc, ch, asrc_in[ch], ADC_CONVERSIONS_BLOCK_FRAMES,
+                        asrc_taps, n, &asrc_out[ch],
+                        ADC_CONVERSIONS_CHANNEL_COUNT);
+  }
+  return n;
+}
+
+/* Resample BENCH_ASRC_SECONDS of hz, steered on every pulse as main.c
+ * does; returns the error against the nominal grid, dB of the signal */
+static double bench_asrcRun(double hz, uint32_t *misplaced) {
+  const double local_hz = BENCH_FRAME_RATE_HZ * (1.0 + BENCH_ASRC_PPM * 1e-6);
+  double err = 0.0;
+  double sig = 0.0;
+  uint32_t pulse = 1;
+  *misplaced = 0;
+  dspAsrc_init(&asrc);
+  for (uint32_t b = 0;
+       b < BENCH_ASRC_SECONDS * BENCH_FRAME_RATE_HZ /
+               ADC_CONVERSIONS_BLOCK_FRAMES;
+       b++) {
+    bench_asrcBlock(b, hz);
+    const double pulse_pos = pulse * local_hz;
+    if ((double)(b * ADC_CONVERSIONS_BLOCK_FRAMES) >= pulse_pos) {
+      dspAsrc_steer(&asrc, (uint64_t)(pulse_pos * 4294967296.0),
+                    (float32_t)BENCH_ASRC_PPM, BENCH_FRAME_RATE_HZ);
+      pulse++;
+    }
+    uint32_t seq = 0;
+    const uint32_t n = bench_asrcProcess(b, &seq);
+    if (pulse <= BENCH_ASRC_SETTLE_S) {
+      continue;
+    }
+    for (uint32_t k = 0; k < n; k++) {
+      // Output k is nominal frame seq + k D: true time (seq + k D) / rate
+      const uint32_t s = seq + k * BENCH_ASRC_D;
+      const double t = (double)s / (double)BENCH_FRAME_RATE_HZ;
+      for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+        const double ref = BENCH_ASRC_AMPLITUDE * sin(2.0 * PI * hz * t + ch);
+        const double d = asrc_out[k * ADC_CONVERSIONS_CHANNEL_COUNT + ch] - ref;
+        err += d * d;
+        sig += ref * ref;
+      }
+      *misplaced += (s % BENCH_ASRC_D) != BENCH_ASRC_D - 1U;
+    }
+  }
+  return 10.0 * log10(err / sig);
+}
+
+/* Frames where the filter with an unsteered resampler differs from its
+ * plain decimation: none, the taps all fall on mu = 0 (the last output of
+ * a block comes with the next one) */
+static uint32_t bench_asrcIdentity(void) {
+  const uint32_t per_block = ADC_CONVERSIONS_BLOCK_FRAMES / BENCH_ASRC_D;
+  static float32_t plain[BENCH_DSP_BLOCKS * ADC_CONVERSIONS_BLOCK_SAMPLES /
+                         BENCH_ASRC_D];
+  uint32_t differ = 0;
+  dspAsrc_init(&asrc);
+  for (uint8_t i = 0; i < 2U; i++) {
+    dspFilter_init(&asrc_filter[i], BENCH_ASRC_D, NULL);
+    for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+      dspFilter_configChannel(&asrc_filter[i], ch, &dspFilter_lowpass200Hz);
+    }
+  }
+  dspFilter_setResampler(&asrc_filter[1], &asrc);
+  for (uint32_t b = 0; b < BENCH_DSP_BLOCKS; b++) {
+    const float32_t *out;
+    uint32_t frames;
+    uint32_t first;
+    dspFilter_process(&asrc_filter[0], bench_block(b),
+                      ADC_CONVERSIONS_BLOCK_FRAMES);
+    dspFilter_getOutput(&asrc_filter[0], &out, &frames, NULL);
+    memcpy(&plain[b * per_block * ADC_CONVERSIONS_CHANNEL_COUNT], out,
+           frames * ADC_CONVERSIONS_CHANNEL_COUNT * sizeof(float32_t));
+
+    dspFilter_process(&asrc_filter[1], bench_block(b),
+                      ADC_CONVERSIONS_BLOCK_FRAMES);
+    dspFilter_getOutput(&asrc_filter[1], &out, &frames, &first);
+    // Output k is plain output first / D + k
+    const uint32_t index = first / BENCH_ASRC_D;
+    if (index + frames > (b + 1U) * per_block ||
+        memcmp(&plain[index * ADC_CONVERSIONS_CHANNEL_COUNT], out,
+               frames * ADC_CONVERSIONS_CHANNEL_COUNT *
+                   sizeof(float32_t)) != 0) {
+      differ++;
+    }
+  }
+  return differ;
+}
+
+SIM_BENCH(BM_dspAsrc) {
+  uint32_t misplaced_50 = 0;
+  uint32_t misplaced_190 = 0;
+  const double db_50 = bench_asrcRun(50.0, &misplaced_50);
+  const double db_190 = bench_asrcRun(190.0, &misplaced_190);
+  DSP_Asrc_Stats_t stats;
+  dspAsrc_getStats(&asrc, &stats);
+  const uint32_t differ = bench_asrcIdentity();
+
+  // Timed: plan and interpolate one block of every channel, free-running
+  bench_asrcBlock(0, 50.0);
+  dspAsrc_init(&asrc);
+  dspAsrc_steer(&asrc, 0, (float32_t)BENCH_ASRC_PPM, 0);
+  uint32_t b = 0;
+  while (simBench_keepRunning(state)) {
+    uint32_t seq;
+    sink += bench_asrcProcess(b++, &seq);
+  }
+  simBench_setCounter(state, "err_dB_50Hz", db_50);
+  simBench_setCounter(state, "err_dB_190Hz", db_190);
+  simBench_setCounter(state, "anchors", (double)stats.anchors);
+  simBench_setCounter(state, "jumps", (double)stats.jumps);
+  simBench_setCounter(state, "misplaced", misplaced_50 + misplaced_190);
+  simBench_setCounter(state, "identity_differ", (double)differ);
+  bench_blockThroughput(state);
+}
+
+/* Raw block b of a tone, each channel at its own sampling instant */
+static void bench_deskewBlock(uint32_t b, double hz, const float *skew_ns) {
+  for (uint32_t f = 0; f < ADC_CONVERSIONS_BLOCK_FRAMES; f++) {
+    const double n = (double)(b * ADC_CONVERSIONS_BLOCK_FRAMES + f);
+    for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+      const double t = n / BENCH_FRAME_RATE_HZ + skew_ns[ch] * 1e-9;
+      deskew_block[f * ADC_CONVERSIONS_CHANNEL_COUNT + ch] = (uint16_t)lround(
+          2048.0 + BENCH_DESKEW_AMPLITUDE * sin(2.0 * PI * hz * t + ch));
+    }
+  }
+}
+
+/* Error of the frames against the tone at the trigger of frame n - delay,
+ * dB of the signal, with or without the compensation */
+static double bench_deskewRun(double hz, uint8_t compensate) {
+  float skew_ns[ADC_CONVERSIONS_CHANNEL_COUNT];
+  double err = 0.0;
+  double sig = 0.0;
+  for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+    skew_ns[ch] = BENCH_DESKEW_STEP_NS * ch;
+  }
+  dspDeskew_init(&deskew, skew_ns, NULL);
+  dspDeskew_setRate(&deskew, compensate ? BENCH_FRAME_RATE_HZ : 0U);
+  const uint32_t delay = compensate ? DSP_DESKEW_LATENCY : 0U;
+  for (uint32_t b = 0; b < BENCH_DSP_BLOCKS; b++) {
+    bench_deskewBlock(b, hz, skew_ns);
+    dspDeskew_process(&deskew, deskew_block, ADC_CONVERSIONS_BLOCK_FRAMES);
+    for (uint32_t f = 0; f < ADC_CONVERSIONS_BLOCK_FRAMES; f++) {
+      const uint32_t n = b * ADC_CONVERSIONS_BLOCK_FRAMES + f;
+      if (n < BENCH_DESKEW_SETTLE) {
+        continue;
+      }
+      const double t = (double)(n - delay) / BENCH_FRAME_RATE_HZ;
+      for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+        const double ref =
+            BENCH_DESKEW_AMPLITUDE * sin(2.0 * PI * hz * t + ch);
+        const double d =
+            deskew_block[f * ADC_CONVERSIONS_CHANNEL_COUNT + ch] - 2048.0 -
+            ref;
+        err += d * d;
+        sig += ref * ref;
+      }
+    }
+  }
+  return 10.0 * log10(err / sig);
+}
+
+/* Samples where a zero skew is not the input three frames late: none */
+static uint32_t bench_deskewIdentity(void) {
+  static const float zero[ADC_CONVERSIONS_CHANNEL_COUNT] = {0};
+  static uint16_t previous[ADC_CONVERSIONS_BLOCK_SAMPLES];
+  uint32_t differ = 0;
+  dspDeskew_init(&deskew, zero, NULL);
+  dspDeskew_setRate(&deskew, BENCH_FRAME_RATE_HZ);
+  for (uint32_t b = 0; b < BENCH_DSP_BLOCKS; b++) {
+    const uint16_t *in = bench_block(b);
+    memcpy(deskew_block, in, sizeof(deskew_block));
+    dspDeskew_process(&deskew, deskew_block, ADC_CONVERSIONS_BLOCK_FRAMES);
+    for (uint32_t i = 0; i < ADC_CONVERSIONS_BLOCK_SAMPLES; i++) {
+      const uint32_t back = DSP_DESKEW_LATENCY * ADC_CONVERSIONS_CHANNEL_COUNT;
+      const uint16_t want =
+          (i >= back) ? in[i - back]
+          : (b == 0U) ? in[i % ADC_CONVERSIONS_CHANNEL_COUNT]
+                      : previous[ADC_CONVERSIONS_BLOCK_SAMPLES - back + i];
+      differ += deskew_block[i] != want;
+    }
+    memcpy(previous, in, sizeof(previous));
+  }
+  return differ;
+}
+
+SIM_BENCH(BM_dspDeskew) {
+  const double raw_200 = bench_deskewRun(200.0, 0);
+  const double raw_1k = bench_deskewRun(1000.0, 0);
+  const double db_200 = bench_deskewRun(200.0, 1);
+  const double db_1k = bench_deskewRun(1000.0, 1);
+  const uint32_t differ = bench_deskewIdentity();
+  float scan_ns[ADC_CONVERSIONS_CHANNEL_COUNT];
+  analogSensor_getScanSkew(scan_ns);
+  float scan_max = 0.0f;
+  for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+    scan_max = (scan_ns[ch] > scan_max) ? scan_ns[ch] : scan_max;
+  }
+
+  // Timed: one block of every channel at the bench skews
+  bench_deskewRun(200.0, 1);
+  while (simBench_keepRunning(state)) {
+    dspDeskew_process(&deskew, deskew_block, ADC_CONVERSIONS_BLOCK_FRAMES);
+    sink += deskew_block[0];
+  }
+  simBench_setCounter(state, "raw_dB_200Hz", raw_200);
+  simBench_setCounter(state, "raw_dB_1kHz", raw_1k);
+  simBench_setCounter(state, "err_dB_200Hz", db_200);
+  simBench_setCounter(state, "err_dB_1kHz", db_1k);
+  simBench_setCounter(state, "identity_differ", (double)differ);
+  simBench_setCounter(state, "scan_skew_ns", (double)scan_max);
+  bench_blockThroughput(state);
+}
+
+static void bench_vectorFill(void) {
+  const float32_t p = BENCH_VECTOR_PITCH_DEG * PI / 180.0f;
+  const float32_t r = BENCH_VECTOR_ROLL_DEG * PI / 180.0f;
+  const float32_t g[ADC_CAL_AXES] = {-sinf(p), cosf(p) * sinf(r),
+                                     cosf(p) * cosf(r)};
+  for (uint32_t f = 0; f < ADC_CONVERSIONS_BLOCK_FRAMES; f++) {
+    for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+      vec_frames[f * ADC_CONVERSIONS_CHANNEL_COUNT + ch] =
+          (float32_t)ADC_CAL_NOMINAL_OFFSET +
+          1000.0f * g[ch % ADC_CAL_AXES] / ADC_CAL_NOMINAL_MG_PER_CODE;
+    }
+  }
+}
+
+SIM_BENCH(BM_vector) {
+  adcCal_init();
+  bench_vectorFill();
+  if (dspVector_init(&vec, 1) != HAL_OK) {
+    simBench_skipWithError(state, "vector init failed");
+    return;
+  }
+  while (simBench_keepRunning(state)) {
+    dspVector_compute(&vec, vec_frames, ADC_CONVERSIONS_BLOCK_FRAMES,
+                      vec_out);
+    sink += (uint32_t)vec_out[0].magnitude;
+  }
+  // Last frame of sensor 2: expect 1000 mg, 30 and 45 degrees
+  const DSP_VectorSample_t *v =
+      &vec_out[ADC_CONVERSIONS_BLOCK_FRAMES * DSP_VECTOR_GROUPS - 1U];
+  simBench_setCounter(state, "magnitude_mg", v->magnitude);
+  simBench_setCounter(state, "pitch_deg", v->pitch);
+  simBench_setCounter(state, "roll_deg", v->roll);
+  bench_blockThroughput(state);
+}
+
+SIM_BENCH(BM_triggerArmed) {
+  ADC_TriggerConfig_t slope = {
+      .condition = ADC_TRIGGER_SLOPE, .threshold = 4000, .window = 4};
+  uint64_t i = 0;
+
+  bench_fillBlocks();
+  // Threshold above any slope of the signal: the armed scan never fires
+  adcTrigger_init(256, 768);
+  adcTrigger_configChannel(0, &slope);
+  adcTrigger_arm();
+  while (simBench_keepRunning(state)) {
+    adcTrigger_process(bench_block(i++), ADC_CONVERSIONS_BLOCK_FRAMES, NULL);
+  }
+  adcTrigger_disarm();
+  bench_blockThroughput(state);
+}
+
+/* A snapshot of 768 frames read out while blocks keep coming: frames that
+ * differ from what was pinned (0 expected), and the blocks left out when
+ * the consumer gives back 128 frames per block (fast enough) or 16 (too
+ * slow for the 1280 free frames) */
+static uint32_t bench_snapshotDrain(uint64_t *i, uint32_t per_block,
+                                    uint32_t *mismatched) {
+  static ADC_Frame_t pinned_copy[ADC_TRIGGER_SNAPSHOT_MAX_FRAMES];
+  ADC_TriggerSnapshot_t snap;
+  ADC_TriggerStats_t before;
+  ADC_TriggerStats_t after;
+
+  adcTrigger_getStats(&before);
+  if (adcTrigger_pinSnapshot(ADC_TRIGGER_SNAPSHOT_MAX_FRAMES, &snap) !=
+      HAL_OK) {
+    return 0;
+  }
+  for (uint32_t f = 0; f < snap.frame_count; f++) {
+    pinned_copy[f] = *adcTrigger_getSnapshotFrame(snap.first_frame + f);
+  }
+  uint32_t sent = 0;
+  while (sent < snap.frame_count) {
+    adcTrigger_process(bench_block((*i)++), ADC_CONVERSIONS_BLOCK_FRAMES,
+                       NULL);
+    for (uint32_t n = 0; n < per_block && sent < snap.frame_count; n++) {
+      const ADC_Frame_t *fr = adcTrigger_getSnapshotFrame(snap.first_frame +
+                                                          sent);
+      if (memcmp(fr->samples, pinned_copy[sent].samples,
+                 sizeof(fr->samples)) != 0) {
+        (*mismatched)++;
+      }
+      sent++;
+    }
+    adcTrigger_releaseSnapshot(snap.first_frame + sent);
+  }
+  adcTrigger_getStats(&after);
+  return after.pinned_frames - before.pinned_frames;
+}
+
+SIM_BENCH(BM_triggerSnapshot) {
+  ADC_TriggerConfig_t slope = {
+      .condition = ADC_TRIGGER_SLOPE, .threshold = 4000, .window = 4};
+  ADC_TriggerSnapshot_t snap;
+  uint32_t mismatched = 0;
+  uint64_t i = 0;
+
+  bench_fillBlocks();
+  adcTrigger_init(256, 768);
+  adcTrigger_configChannel(0, &slope);
+  adcTrigger_arm();
+  for (uint32_t b = 0; b < 8U; b++) {
+    adcTrigger_process(bench_block(i++), ADC_CONVERSIONS_BLOCK_FRAMES, NULL);
+  }
+  const uint32_t fast = bench_snapshotDrain(&i, 128U, &mismatched);
+  const uint32_t slow = bench_snapshotDrain(&i, 16U, &mismatched);
+
+  // Timed: the armed trigger with a snapshot pinned, a block given back
+  // per block and pinned again once all of it is
+  uint32_t released = 0;
+  while (simBench_keepRunning(state)) {
+    if (!adcTrigger_isPinned()) {
+      (void)adcTrigger_pinSnapshot(ADC_TRIGGER_SNAPSHOT_MAX_FRAMES, &snap);
+      released = 0;
+    }
+    adcTrigger_process(bench_block(i++), ADC_CONVERSIONS_BLOCK_FRAMES, NULL);
+    released += ADC_CONVERSIONS_BLOCK_FRAMES;
+    adcTrigger_releaseSnapshot(
+        snap.first_frame +
+        ((released < snap.frame_count) ? released : snap.frame_count));
+  }
+  adcTrigger_unpinSnapshot();
+  adcTrigger_disarm();
+  simBench_setCounter(state, "mismatched_frames", mismatched);
+  simBench_setCounter(state, "left_out_fast", fast);
+  simBench_setCounter(state, "left_out_slow", slow);
+  bench_blockThroughput(state);
+}
+
+SIM_BENCH(BM_ringPushPop) {
+  ADC_RingEntry_t entry = {0};
+
+  bench_fillBlocks();
+  adcRing_reset();
+  memcpy(entry.frame.samples, blocks[0], sizeof(entry.frame.samples));
+  while (simBench_keepRunning(state)) {
+    entry.sequence++;
+    adcRing_push(&entry);
+    adcRing_pop(&entry);
+  }
+  simBench_setItemsProcessed(state, simBench_iterations(state));
+}
+
+/**
+ * @brief One block's worth of frames through the ring, drained in one
+ *        analogSensor_readFrames() call, across the slot wrap
+ */
+SIM_BENCH(BM_ringReadFrames) {
+  static ADC_Frame_t frames[ADC_CONVERSIONS_BLOCK_FRAMES];
+  ADC_RingEntry_t entry = {0};
+  uint32_t first = 0;
+  uint32_t short_reads = 0;
+
+  bench_fillBlocks();
+  adcRing_reset();
+  memcpy(entry.frame.samples, blocks[0], sizeof(entry.frame.samples));
+  while (simBench_keepRunning(state)) {
+    const uint32_t expected = entry.sequence;
+    for (uint32_t f = 0; f < ADC_CONVERSIONS_BLOCK_FRAMES; f++) {
+      adcRing_push(&entry);
+      entry.sequence++;
+    }
+    if (analogSensor_readFrames(frames, ADC_CONVERSIONS_BLOCK_FRAMES,
+                                &first) != ADC_CONVERSIONS_BLOCK_FRAMES ||
+        first != expected) {
+      short_reads++;
+    }
+  }
+  simBench_setCounter(state, "short_reads", short_reads);
+  simBench_setItemsProcessed(state, simBench_iterations(state) *
+                                        ADC_CONVERSIONS_BLOCK_FRAMES);
+}
+
+/**
+ * @brief One block into the ring read by three cursors: the default and a
+ *        second required consumer every block, an optional one every
+ *        sixth block, so the producer laps it (1536 frames behind a 1024
+ *        ring); its frames must run on between overruns
+ */
+SIM_BENCH(BM_ringBroadcast) {
+  ADC_RingEntry_t entry = {0};
+  ADC_RingConsumerStats_t slow_stats;
+  ADC_RingStats_t ring;
+  const ADC_RingEntry_t *span;
+  uint8_t dsp_id = 0;
+  uint8_t slow_id = 0;
+  uint32_t expected = 0;
+  uint32_t gaps = 0;
+  uint32_t blocks_pushed = 0;
+  uint32_t n;
+
+  bench_fillBlocks();
+  adcRing_reset();
+  if (adcRing_attach(1, &dsp_id) != HAL_OK ||
+      adcRing_attach(0, &slow_id) != HAL_OK) {
+    return;
+  }
+  memcpy(entry.frame.samples, blocks[0], sizeof(entry.frame.samples));
+  while (simBench_keepRunning(state)) {
+    for (uint32_t f = 0; f < ADC_CONVERSIONS_BLOCK_FRAMES; f++) {
+      adcRing_push(&entry);
+      entry.sequence++;
+    }
+    while ((n = adcRing_peek(&span, ADC_RING_CAPACITY)) != 0U) {
+      adcRing_consume(n);
+    }
+    while ((n = adcRing_peekFor(dsp_id, &span, ADC_RING_CAPACITY)) != 0U) {
+      adcRing_consumeFor(dsp_id, n);
+    }
+    if (++blocks_pushed % 6U != 0U) {
+      continue;
+    }
+    while ((n = adcRing_peekFor(slow_id, &span, ADC_RING_CAPACITY)) != 0U) {
+      if (adcRing_takeOverrun(slow_id)) {
+        expected = span[0].sequence;
+      }
+      for (uint32_t i = 0; i < n; i++) {
+        gaps += (span[i].sequence != expected + i) ? 1U : 0U;
+      }
+      expected += n;
+      adcRing_consumeFor(slow_id, n);
+    }
+  }
+  adcRing_getConsumerStats(slow_id, &slow_stats);
+  adcRing_getStats(&ring);
+  adcRing_detach(dsp_id);
+  adcRing_detach(slow_id);
+  simBench_setCounter(state, "slow_max_lag", slow_stats.max_lag);
+  simBench_setCounter(state, "slow_overruns", slow_stats.overruns);
+  simBench_setCounter(state, "slow_lost", slow_stats.lost);
+  simBench_setCounter(state, "gaps", gaps);
+  simBench_setCounter(state, "overflows", ring.overflows);
+  simBench_setItemsProcessed(state, simBench_iterations(state) *
+                                        ADC_CONVERSIONS_BLOCK_FRAMES);
+}
+
+SIM_BENCH(BM_telemetryEncode) {
+  TelemetryFrame_Batch_t batch;
+  ADC_RingEntry_t entry = {0};
+  uint8_t out[TELEMETRY_FRAME_ENCODED_MAX];
+  uint16_t len = 0;
+  uint64_t bytes = 0;
+
+  bench_fillBlocks();
+  while (simBench_keepRunning(state)) {
+    telemetryFrame_initBatch(&batch, (1U << ADC_CONVERSIONS_CHANNEL_COUNT) - 1U);
+    for (uint32_t f = 0; f < TELEMETRY_FRAME_MAX_FRAMES; f++) {
+      memcpy(entry.frame.samples,
+             &blocks[0][f * ADC_CONVERSIONS_CHANNEL_COUNT],
+             sizeof(entry.frame.samples));
+      entry.sequence = f;
+      telemetryFrame_addFrame(&batch, &entry);
+    }
+    telemetryFrame_encodeSamples(&batch, out, sizeof(out), &len);
+    bytes += len;
+  }
+  simBench_setItemsProcessed(state, simBench_iterations(state) *
+                                        TELEMETRY_FRAME_MAX_FRAMES);
+  simBench_setBytesProcessed(state, bytes);
+}
+
+/* Stats windows of a 400-code sine plus noise; channel 1 steps to 600
+ * codes at window BENCH_REPORT_STEP */
+static void bench_reportWindows(void) {
+  DSP_StatsAccum_t acc[ADC_CONVERSIONS_CHANNEL_COUNT];
+  uint32_t lcg = 777U;
+
+  for (uint32_t w = 0; w < BENCH_REPORT_WINDOWS; w++) {
+    dspStats_reset(acc);
+    for (uint32_t b = 0; b < BENCH_REPORT_BLOCKS; b++) {
+      for (uint32_t f = 0; f < ADC_CONVERSIONS_BLOCK_FRAMES; f++) {
+        const double phase = 2.0 * M_PI * (double)(f % BENCH_VELOCITY_PERIOD) /
+                             (double)BENCH_VELOCITY_PERIOD;
+        uint16_t *frame = &blocks[0][f * ADC_CONVERSIONS_CHANNEL_COUNT];
+        for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+          const double amp =
+              (ch == 1U && w >= BENCH_REPORT_STEP) ? 600.0 : 400.0;
+          lcg = lcg * 1664525U + 1013904223U;
+          frame[ch] = (uint16_t)lrint(2048.0 + amp * sin(phase) +
+                                      (double)(lcg >> 27) - 16.0);
+        }
+      }
+      dspStats_accumulate(acc, blocks[0], ADC_CONVERSIONS_BLOCK_FRAMES);
+    }
+    for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+      dspStats_compute(&acc[ch], &report_windows[w].channels[ch]);
+      report_windows[w].dc_bias[ch] = report_windows[w].channels[ch].mean;
+    }
+  }
+}
+
+SIM_BENCH(BM_reportException) {
+  const TelemetryFrame_ExceptionConfig_t cfg = {
+      .deadband = {8.0f, 4.0f, 24.0f, 0.5f, 0.5f, 2.0f},
+      .heartbeat_ms = 60000U};
+  uint8_t out[TELEMETRY_FRAME_ENCODED_MAX];
+  uint16_t len = 0;
+  uint16_t full_len = 0;
+  uint64_t bytes = 0;
+  uint64_t i = 0;
+
+  bench_reportWindows();
+  telemetryFrame_encodeStats(&report_windows[0], out, sizeof(out), &full_len);
+  telemetryFrame_initException(&report_exc, &cfg);
+  while (simBench_keepRunning(state)) {
+    TelemetryFrame_Stats_t *win = &report_windows[i % BENCH_REPORT_WINDOWS];
+    TelemetryFrame_Features_t features;
+    win->timestamp = (uint32_t)(i++ * 1000U);
+    telemetryFrame_statsFeatures(win, &features);
+    if (telemetryFrame_encodeException(&report_exc, &features, out,
+                                       sizeof(out), &len) == HAL_OK) {
+      bytes += len;
+    }
+  }
+  const double windows = (double)simBench_iterations(state);
+  simBench_setCounter(state, "full_bytes", full_len);
+  simBench_setCounter(state, "rbe_bytes", windows > 0.0 ? bytes / windows : 0.0);
+  simBench_setCounter(state, "ratio", bytes != 0U ? full_len * windows / bytes
+                                                  : 0.0);
+  simBench_setCounter(state, "sent_pct",
+                      report_exc.evaluated != 0U
+                          ? 100.0 * report_exc.reported / report_exc.evaluated
+                          : 0.0);
+  simBench_setItemsProcessed(state, simBench_iterations(state));
+}
+
+/* Register map shaped like the application's: features of four spectra
+ * read field-major from their structures, settings written in place */
+#define BENCH_MODBUS_CHANNELS 4U
+#define BENCH_MODBUS_ADDRESS 17U
+static DSP_SpectrumResult_t modbus_results[BENCH_MODBUS_CHANNELS];
+static uint8_t modbus_settings[4];
+#define BENCH_MODBUS_BANDS(ch)                                                 \
+  {.address = (uint16_t)(24U + 2U * DSP_SPECTRUM_MAX_BANDS * (ch)),            \
+   .type = MODBUS_RTU_F32, .count = DSP_SPECTRUM_MAX_BANDS,                    \
+   .data = modbus_results[ch].band_rms}
+static const ModbusRtu_Region_t modbus_bench_input[] = {
+    {.address = 0U, .type = MODBUS_RTU_U32, .count = BENCH_MODBUS_CHANNELS,
+     .stride = sizeof(modbus_results[0]), .data = &modbus_results[0].sequence},
+    {.address = 8U, .type = MODBUS_RTU_F32, .count = BENCH_MODBUS_CHANNELS,
+     .stride = sizeof(modbus_results[0]), .data = &modbus_results[0].peak_hz},
+    {.address = 16U, .type = MODBUS_RTU_F32, .count = BENCH_MODBUS_CHANNELS,
+     .stride = sizeof(modbus_results[0]), .data = &modbus_results[0].rms},
+    BENCH_MODBUS_BANDS(0U), BENCH_MODBUS_BANDS(1U), BENCH_MODBUS_BANDS(2U),
+    BENCH_MODBUS_BANDS(3U)};
+static const ModbusRtu_Region_t modbus_bench_holding[] = {
+    {.address = 0U, .type = MODBUS_RTU_U8, .count = 4U, .data = modbus_settings,
+     .min = 0, .max = 2, .notify = 0x01U}};
+static const ModbusRtu_Map_t modbus_bench_map = {
+    .address = BENCH_MODBUS_ADDRESS,
+    .input = modbus_bench_input,
+    .input_count = sizeof(modbus_bench_input) / sizeof(modbus_bench_input[0]),
+    .holding = modbus_bench_holding,
+    .holding_count = 1U};
+
+static uint16_t bench_modbusRequest(uint8_t *adu, uint16_t pdu_len) {
+  const uint16_t crc = modbusRtu_crc16(adu, pdu_len);
+  adu[pdu_len] = (uint8_t)crc;
+  adu[pdu_len + 1U] = (uint8_t)(crc >> 8);
+  return (uint16_t)(pdu_len + 2U);
+}
+
+SIM_BENCH(BM_modbusReadInput) {
+  // FC04 over every input register the map has, the largest reply
+  const uint16_t count = 24U + 2U * BENCH_MODBUS_CHANNELS *
+                                   DSP_SPECTRUM_MAX_BANDS;
+  uint8_t req[8] = {BENCH_MODBUS_ADDRESS, MODBUS_RTU_FC_READ_INPUT, 0U, 0U,
+                    (uint8_t)(count >> 8), (uint8_t)count};
+  const uint16_t req_len = bench_modbusRequest(req, 6U);
+  uint8_t resp[MODBUS_RTU_ADU_MAX];
+  uint16_t resp_len = 0;
+  uint64_t bytes = 0;
+  uint64_t errors = 0;
+
+  for (uint8_t ch = 0; ch < BENCH_MODBUS_CHANNELS; ch++) {
+    modbus_results[ch].sequence = ch;
+    modbus_results[ch].peak_hz = 50.0f * (float32_t)(ch + 1U);
+    modbus_results[ch].rms = 12.5f;
+  }
+  while (simBench_keepRunning(state)) {
+    modbus_results[0].sequence++;
+    if (modbusRtu_process(&modbus_bench_map, req, req_len, resp, &resp_len,
+                          NULL) != MODBUS_RTU_REPLY) {
+      errors++;
+    }
+    bytes += resp_len;
+  }
+  simBench_setCounter(state, "registers", count);
+  simBench_setCounter(state, "reply_bytes", resp_len);
+  simBench_setCounter(state, "errors", (double)errors);
+  simBench_setItemsProcessed(state, simBench_iterations(state));
+  simBench_setBytesProcessed(state, bytes);
+}
+
+SIM_BENCH(BM_modbusWriteMultiple) {
+  // FC16 of the four settings, checked in full and then stored
+  uint8_t req[17] = {BENCH_MODBUS_ADDRESS, MODBUS_RTU_FC_WRITE_MULTIPLE,
+                     0U, 0U, 0U, 4U, 8U};
+  uint8_t resp[MODBUS_RTU_ADU_MAX];
+  uint16_t resp_len = 0;
+  uint32_t written = 0;
+  uint64_t errors = 0;
+  uint64_t i = 0;
+
+  while (simBench_keepRunning(state)) {
+    for (uint8_t r = 0; r < 4U; r++) {
+      req[7U + 2U * r] = 0U;
+      req[8U + 2U * r] = (uint8_t)((i + r) % 3U);
+    }
+    i++;
+    const uint16_t req_len = bench_modbusRequest(req, 15U);
+    if (modbusRtu_process(&modbus_bench_map, req, req_len, resp, &resp_len,
+                          &written) != MODBUS_RTU_REPLY) {
+      errors++;
+    }
+  }
+  simBench_setCounter(state, "errors", (double)errors);
+  simBench_setCounter(state, "written", written);
+  simBench_setItemsProcessed(state, simBench_iterations(state));
+}
+
+SIM_BENCH(BM_codecEncode) {
+  uint8_t out[SAMPLE_CODEC_MAX_BYTES(SAMPLE_CODEC_MAX_SAMPLES)];
+  uint32_t len = 0;
+  uint64_t total = 0;
+  uint64_t i = 0;
+
+  bench_fillBlocks();
+  while (simBench_keepRunning(state)) {
+    const uint16_t *block = bench_block(i++);
+    sampleCodec_encode(block, SAMPLE_CODEC_MAX_SAMPLES,
+                       ADC_CONVERSIONS_CHANNEL_COUNT, out, sizeof(out), &len);
+    total += len;
+  }
+  simBench_setCounter(state, "bits_per_sample",
+                      simBench_iterations(state) != 0U
+                          ? 8.0 * (double)total /
+                                ((double)simBench_iterations(state) *
+                                 SAMPLE_CODEC_MAX_SAMPLES)
+                          : 0.0);
+  simBench_setItemsProcessed(state, simBench_iterations(state) *
+                                        SAMPLE_CODEC_MAX_SAMPLES);
+}
+
+SIM_BENCH(BM_codecDecode) {
+  uint8_t encoded[BENCH_DSP_BLOCKS]
+                 [SAMPLE_CODEC_MAX_BYTES(SAMPLE_CODEC_MAX_SAMPLES)];
+  uint32_t len[BENCH_DSP_BLOCKS];
+  uint16_t decoded[SAMPLE_CODEC_MAX_SAMPLES];
+  uint64_t i = 0;
+
+  bench_fillBlocks();
+  for (uint32_t b = 0; b < BENCH_DSP_BLOCKS; b++) {
+    sampleCodec_encode(blocks[b], SAMPLE_CODEC_MAX_SAMPLES,
+                       ADC_CONVERSIONS_CHANNEL_COUNT, encoded[b],
+                       sizeof(encoded[b]), &len[b]);
+  }
+  while (simBench_keepRunning(state)) {
+    uint32_t b = (uint32_t)(i++ % BENCH_DSP_BLOCKS);
+    if (sampleCodec_decode(encoded[b], len[b], SAMPLE_CODEC_MAX_SAMPLES,
+                           decoded, 1) != HAL_OK ||
+        decoded[0] != blocks[b][0]) {
+      simBench_skipWithError(state, "decode mismatch");
+      return;
+    }
+  }
+  simBench_setItemsProcessed(state, simBench_iterations(state) *
+                                        SAMPLE_CODEC_MAX_SAMPLES);
+}
+
+#define BENCH_PACK_BYTES 16384U  // ADC_TRIGGER_PACKED_BYTES' default
+#define BENCH_PACK_WINDOW 2048U  // ... and its capture window
+
+static uint8_t pack_buf[BENCH_PACK_BYTES];
+static FramePack_t pack;
+static ADC_Frame_t pack_frames[BENCH_DSP_BLOCKS][ADC_CONVERSIONS_BLOCK_FRAMES];
+static ADC_Frame_t pack_window[BENCH_PACK_WINDOW];
+
+/* The bench blocks as frames, in the order the trigger records them */
+static void bench_packFrames(void) {
+  bench_fillBlocks();
+  for (uint32_t b = 0; b < BENCH_DSP_BLOCKS; b++) {
+    for (uint32_t f = 0; f < ADC_CONVERSIONS_BLOCK_FRAMES; f++) {
+      memcpy(pack_frames[b][f].samples,
+             &blocks[b][f * ADC_CONVERSIONS_CHANNEL_COUNT],
+             sizeof(pack_frames[b][f].samples));
+    }
+  }
+}
+
+static const ADC_Frame_t *bench_packFrame(uint32_t frame) {
+  return &pack_frames[(frame / ADC_CONVERSIONS_BLOCK_FRAMES) %
+                      BENCH_DSP_BLOCKS][frame % ADC_CONVERSIONS_BLOCK_FRAMES];
+}
+
+/* Frames of the window that do not decode to what was pushed */
+static uint32_t bench_packCheck(uint32_t first, uint32_t count) {
+  uint32_t errors = 0;
+  if (framePack_decode(&pack, first, count, pack_window) != HAL_OK) {
+    return count;
+  }
+  for (uint32_t i = 0; i < count; i++) {
+    errors += memcmp(pack_window[i].samples,
+                     bench_packFrame(first + i)->samples,
+                     sizeof(pack_window[i].samples)) != 0;
+  }
+  return errors;
+}
+
+/* The packed trigger history (ADC_TRIGGER_PACKED_ENABLE) in the ISR: one
+ * block encoded into a 16 KB ring per iteration. Counters: bytes a frame,
+ * the look-back the ring holds against the 1170 frames of 16 KB raw, and
+ * frames of a held 2048-frame window that fail the round trip (0) */
+SIM_BENCH(BM_framePackPush) {
+  uint64_t i = 0;
+
+  bench_packFrames();
+  framePack_init(&pack, pack_buf, sizeof(pack_buf));
+  while (simBench_keepRunning(state)) {
+    framePack_push(&pack, pack_frames[i % BENCH_DSP_BLOCKS],
+                   ADC_CONVERSIONS_BLOCK_FRAMES,
+                   (uint32_t)(i * ADC_CONVERSIONS_BLOCK_FRAMES));
+    i++;
+  }
+  for (uint32_t b = 0; b < 2U * BENCH_DSP_BLOCKS; b++, i++) {
+    framePack_push(&pack, pack_frames[i % BENCH_DSP_BLOCKS],
+                   ADC_CONVERSIONS_BLOCK_FRAMES,
+                   (uint32_t)(i * ADC_CONVERSIONS_BLOCK_FRAMES));
+  }
+  const uint32_t lookback = framePack_frames(&pack);
+  const uint32_t end = pack.end_frame;
+  const uint32_t window = (lookback < BENCH_PACK_WINDOW) ? lookback
+                                                         : BENCH_PACK_WINDOW;
+  framePack_hold(&pack, end - window);
+  const uint32_t mismatched = bench_packCheck(end - window, window);
+  framePack_release(&pack);
+  simBench_setCounter(state, "bytes_per_frame",
+                      pack.frames_packed != 0U
+                          ? (double)pack.bytes_packed / pack.frames_packed
+                          : 0.0);
+  simBench_setCounter(state, "lookback_frames", lookback);
+  simBench_setCounter(state, "vs_raw",
+                      lookback * sizeof(ADC_Frame_t) /
+                          (double)BENCH_PACK_BYTES);
+  simBench_setCounter(state, "mismatched_frames", mismatched);
+  bench_blockThroughput(state);
+}
+
+/* The decode adcTrigger_getCapture() does once per capture: a 2048-frame
+ * window out of the ring */
+SIM_BENCH(BM_framePackDecode) {
+  bench_packFrames();
+  framePack_init(&pack, pack_buf, sizeof(pack_buf));
+  for (uint32_t b = 0; b < 2U * BENCH_DSP_BLOCKS; b++) {
+    framePack_push(&pack, pack_frames[b % BENCH_DSP_BLOCKS],
+                   ADC_CONVERSIONS_BLOCK_FRAMES,
+                   b * ADC_CONVERSIONS_BLOCK_FRAMES);
+  }
+  const uint32_t lookback = framePack_frames(&pack);
+  const uint32_t window = (lookback < BENCH_PACK_WINDOW) ? lookback
+                                                         : BENCH_PACK_WINDOW;
+  const uint32_t first = pack.end_frame - window;
+  uint32_t mismatched = 0;
+  while (simBench_keepRunning(state)) {
+    mismatched += bench_packCheck(first, window);
+  }
+  simBench_setCounter(state, "window_frames", window);
+  simBench_setCounter(state, "mismatched_frames", mismatched);
+  simBench_setItemsProcessed(state, simBench_iterations(state) * window);
+}
+
+/* A full capture window, pre-trigger frames as deep as the build allows:
+ * an alarm fires at a block's first frame, the post-trigger blocks come
+ * in, and adcTrigger_getCapture() hands the window out (decoding it with
+ * ADC_TRIGGER_PACKED_ENABLE). Frames that differ from what was recorded
+ * (0 expected), the pre-trigger frames the capture has and those a full
+ * packed ring took */
+SIM_BENCH(BM_triggerCapture) {
+  const uint16_t post = 768U;
+  const uint16_t pre = (uint16_t)(ADC_TRIGGER_CAPTURE_FRAMES - post);
+  const ADC_TriggerEvent_t *event = NULL;
+  const ADC_Frame_t *frames = NULL;
+  ADC_TriggerStats_t stats;
+  uint32_t mismatched = 0;
+  uint32_t pre_frames = 0;
+  uint64_t i = 0;
+
+  bench_packFrames();
+  adcTrigger_init(pre, post);
+  adcTrigger_arm();
+  while (simBench_keepRunning(state)) {
+    // Enough history for the whole pre-trigger part, then the alarm
+    for (uint32_t b = 0; b < pre / ADC_CONVERSIONS_BLOCK_FRAMES + 1U; b++) {
+      adcTrigger_process(bench_block(i++), ADC_CONVERSIONS_BLOCK_FRAMES, NULL);
+    }
+    adcTrigger_fire(0, 0, 0x0FFFU, 0);
+    const uint64_t fire_block = i;
+    while (adcTrigger_getCapture(&event, &frames) == HAL_BUSY) {
+      adcTrigger_process(bench_block(i++), ADC_CONVERSIONS_BLOCK_FRAMES, NULL);
+    }
+    // Frame numbers run on from earlier benches: line them up with blocks
+    const uint32_t shift = event->trigger_frame -
+                           (uint32_t)fire_block * ADC_CONVERSIONS_BLOCK_FRAMES;
+    pre_frames = event->pre_frames;
+    for (uint16_t f = 0; f < event->frame_count; f++) {
+      mismatched +=
+          memcmp(frames[f].samples,
+                 bench_packFrame(event->first_frame + f - shift)->samples,
+                 sizeof(frames[f].samples)) != 0;
+    }
+    adcTrigger_arm();
+  }
+  adcTrigger_disarm();
+  adcTrigger_getStats(&stats);
+  simBench_setCounter(state, "pre_frames", pre_frames);
+  simBench_setCounter(state, "trimmed_frames", stats.trimmed_frames);
+  simBench_setCounter(state, "mismatched_frames", mismatched);
+  simBench_setItemsProcessed(state, simBench_iterations(state));
+}
+
+/* The wavelet codec on the same runs as BM_codecEncode (channel 0 of each
+ * block, 256 samples) at an error bound; every run is decoded once up
+ * front and checked against the bound. */
+static void bench_waveletEncode(SimBench_State_t *state, uint16_t max_error) {
+  uint8_t out[WAVELET_CODEC_MAX_BYTES(WAVELET_CODEC_MAX_SAMPLES)];
+  uint16_t decoded[WAVELET_CODEC_MAX_SAMPLES];
+  uint32_t len = 0;
+  uint64_t total = 0;
+  uint32_t worst = 0;
+  uint64_t i = 0;
+
+  bench_fillBlocks();
+  for (uint32_t b = 0; b < BENCH_DSP_BLOCKS; b++) {
+    if (waveletCodec_encode(blocks[b], WAVELET_CODEC_MAX_SAMPLES,
+                            ADC_CONVERSIONS_CHANNEL_COUNT, max_error, out,
+                            sizeof(out), &len) != HAL_OK ||
+        waveletCodec_decode(out, len, WAVELET_CODEC_MAX_SAMPLES, max_error,
+                            decoded, 1) != HAL_OK) {
+      simBench_skipWithError(state, "wavelet run failed");
+      return;
+    }
+    for (uint32_t n = 0; n < WAVELET_CODEC_MAX_SAMPLES; n++) {
+      const int32_t e = (int32_t)decoded[n] -
+                        (int32_t)blocks[b][n * ADC_CONVERSIONS_CHANNEL_COUNT];
+      worst = ((uint32_t)abs(e) > worst) ? (uint32_t)abs(e) : worst;
+    }
+  }
+  if (worst > max_error) {
+    simBench_skipWithError(state, "error bound exceeded");
+    return;
+  }
+  waveletCodec_resetStats();
+  while (simBench_keepRunning(state)) {
+    const uint16_t *block = bench_block(i++);
+    waveletCodec_encode(block, WAVELET_CODEC_MAX_SAMPLES,
+                        ADC_CONVERSIONS_CHANNEL_COUNT, max_error, out,
+                        sizeof(out), &len);
+    total += len;
+  }
+  WaveletCodec_Stats_t st;
+  waveletCodec_getStats(&st);
+  const double samples =
+      (double)simBench_iterations(state) * WAVELET_CODEC_MAX_SAMPLES;
+  simBench_setCounter(state, "bits_per_sample",
+                      samples != 0.0 ? 8.0 * (double)total / samples : 0.0);
+  simBench_setCounter(state, "ratio",
+                      total != 0U ? 1.5 * samples / (double)total : 0.0);
+  simBench_setCounter(state, "max_error", worst);
+  simBench_setCounter(state, "trials_per_run",
+                      st.runs != 0U ? (double)st.trials / st.runs : 0.0);
+  simBench_setItemsProcessed(state, simBench_iterations(state) *
+                                        WAVELET_CODEC_MAX_SAMPLES);
+}
+
+SIM_BENCH(BM_waveletEncode) { bench_waveletEncode(state, 8U); }
+
+SIM_BENCH(BM_waveletEncodeCoarse) { bench_waveletEncode(state, 32U); }
+
+SIM_BENCH(BM_waveletEncodeLossless) { bench_waveletEncode(state, 0U); }
+
+SIM_BENCH(BM_waveletDecode) {
+  uint8_t encoded[BENCH_DSP_BLOCKS]
+                 [WAVELET_CODEC_MAX_BYTES(WAVELET_CODEC_MAX_SAMPLES)];
+  uint32_t len[BENCH_DSP_BLOCKS];
+  uint16_t decoded[WAVELET_CODEC_MAX_SAMPLES];
+  uint64_t i = 0;
+
+  bench_fillBlocks();
+  for (uint32_t b = 0; b < BENCH_DSP_BLOCKS; b++) {
+    waveletCodec_encode(blocks[b], WAVELET_CODEC_MAX_SAMPLES,
+                        ADC_CONVERSIONS_CHANNEL_COUNT, 8U, encoded[b],
+                        sizeof(encoded[b]), &len[b]);
+  }
+  while (simBench_keepRunning(state)) {
+    uint32_t b = (uint32_t)(i++ % BENCH_DSP_BLOCKS);
+    if (waveletCodec_decode(encoded[b], len[b], WAVELET_CODEC_MAX_SAMPLES, 8U,
+                            decoded, 1) != HAL_OK ||
+        abs((int32_t)decoded[0] - (int32_t)blocks[b][0]) > 8) {
+      simBench_skipWithError(state, "decode out of bound");
+      return;
+    }
+  }
+  simBench_setItemsProcessed(state, simBench_iterations(state) *
+                                        WAVELET_CODEC_MAX_SAMPLES);
+}
+
+/* The ASCII bring-up line of main.c, by the formatter and by snprintf. One
+ * iteration prints the frames of one block; the first block is checked
+ * byte for byte between the two. */
+static uint16_t bench_asciiLine(char *out, uint32_t seq, const uint16_t *f) {
+  char *p = out;
+  *p++ = 'F';
+  *p++ = ' ';
+  p += textFormat_u32(p, seq);
+  for (uint8_t ch = 0; ch < ADC_CONVERSIONS_CHANNEL_COUNT; ch++) {
+    *p++ = ' ';
+    p += textFormat_u32Width(p, f[ch], 4U);
+  }
+  *p++ = '\r';
+  *p++ = '\n';
+  return (uint16_t)(p - out);
+}
+
+static uint16_t bench_asciiSnprintf(char *out, size_t size, uint32_t seq,
+                                    const uint16_t *f) {
+  return (uint16_t)snprintf(out, size, "F %lu %4u %4u %4u %4u %4u %4u\r\n",
+                            (unsigned long)seq, f[0], f[1], f[2], f[3], f[4],
+                            f[5]);
+}
+
+static void bench_ascii(SimBench_State_t *state, uint8_t use_snprintf) {
+  char line[BENCH_ASCII_LINE_MAX];
+  char check[BENCH_ASCII_LINE_MAX];
+  uint64_t bytes = 0;
+  uint64_t i = 0;
+
+  bench_fillBlocks();
+  for (uint32_t f = 0; f < ADC_CONVERSIONS_BLOCK_FRAMES; f++) {
+    const uint16_t *frame = &blocks[0][f * ADC_CONVERSIONS_CHANNEL_COUNT];
+    const uint32_t seq = BENCH_ASCII_FIRST_SEQ + f;
+    const uint16_t n = bench_asciiLine(line, seq, frame);
+    if (bench_asciiSnprintf(check, sizeof(check), seq, frame) != n ||
+        memcmp(line, check, n) != 0) {
+      simBench_skipWithError(state, "formatter differs from snprintf");
+      return;
+    }
+  }
+  while (simBench_keepRunning(state)) {
+    const uint16_t *block = bench_block(i);
+    uint32_t seq = BENCH_ASCII_FIRST_SEQ +
+                   (uint32_t)i * ADC_CONVERSIONS_BLOCK_FRAMES;
+    for (uint32_t f = 0; f < ADC_CONVERSIONS_BLOCK_FRAMES; f++) {
+      const uint16_t *frame = &block[f * ADC_CONVERSIONS_CHANNEL_COUNT];
+      bytes += use_snprintf
+                   ? bench_asciiSnprintf(line, sizeof(line), seq++, frame)
+                   : bench_asciiLine(line, seq++, frame);
+    }
+    sink += (uint8_t)line[2];
+    i++;
+  }
+  const double lines =
+      (double)simBench_iterations(state) * ADC_CONVERSIONS_BLOCK_FRAMES;
+  simBench_setCounter(state, "bytes_per_line",
+                      lines > 0.0 ? (double)bytes / lines : 0.0);
+  bench_blockThroughput(state);
+}
+
+SIM_BENCH(BM_asciiFormat) { bench_ascii(state, 0); }
+
+SIM_BENCH(BM_asciiSnprintf) { bench_ascii(state, 1); }
+
+/* Length of the well-formed CBOR item at p (definite lengths, no tags), 0
+ * if it is malformed or runs past end */
+static uint32_t bench_cborItem(const uint8_t *p, const uint8_t *end) {
+  if (p >= end) {
+    return 0;
+  }
+  const uint8_t major = (uint8_t)(*p >> 5);
+  const uint8_t info = (uint8_t)(*p & 0x1FU);
+  uint32_t n = 1;
+  uint64_t arg = info;
+  if (info >= 24U && info <= 27U) {
+    const uint32_t bytes = 1U << (info - 24U);
+    if (p + 1 + bytes > end) {
+      return 0;
+    }
+    arg = 0;
+    for (uint32_t b = 0; b < bytes; b++) {
+      arg = (arg << 8) | p[1 + b];
+    }
+    n += bytes;
+  } else if (info > 27U) {
+    return 0;
+  }
+  if (major == 4U || major == 5U) {
+    const uint64_t items = (major == 5U) ? 2U * arg : arg;
+    for (uint64_t k = 0; k < items; k++) {
+      const uint32_t len = bench_cborItem(p + n, end);
+      if (len == 0U) {
+        return 0;
+      }
+      n += len;
+    }
+  } else if (major == 2U || major == 3U) {
+    n += (uint32_t)arg;
+  } else if (major == 6U) {
+    return 0;
+  }
+  return (p + n <= end) ? n : 0U;
+}
+
+/* COBS packet back to its raw bytes (header, payload, CRC) */
+static uint16_t bench_cobsDecode(const uint8_t *in, uint16_t len,
+                                 uint8_t *raw) {
+  uint16_t o = 0;
+  uint16_t i = 1; // leading delimiter
+  while (i < len - 1U) {
+    const uint8_t code = in[i++];
+    for (uint8_t k = 1; k < code && i < len - 1U; k++) {
+      raw[o++] = in[i++];
+    }
+    if (code != 0xFFU && i < len - 1U) {
+      raw[o++] = 0;
+    }
+  }
+  return o;
+}
+
+/* The feature packets of BM_reportException's windows as CBOR instead of the
+ * binary stats packet: bytes of both, and every map checked well-formed */
+SIM_BENCH(BM_featuresCbor) {
+  uint8_t out[TELEMETRY_FRAME_ENCODED_MAX];
+  uint8_t raw[TELEMETRY_FRAME_ENCODED_MAX];
+  uint16_t len = 0;
+  uint64_t binary_bytes = 0;
+  uint64_t cbor_bytes = 0;
+  uint64_t i = 0;
+
+  bench_reportWindows();
+  for (uint32_t w = 0; w < BENCH_REPORT_WINDOWS; w++) {
+    if (telemetryFrame_encodeStatsCbor(&report_windows[w], out, sizeof(out),
+                                       &len) != HAL_OK) {
+      simBench_skipWithError(state, "CBOR stats encode failed");
+      return;
+    }
+    const uint16_t raw_len = bench_cobsDecode(out, len, raw);
+    const uint8_t *map = &raw[12];
+    const uint8_t *map_end = &raw[raw_len - 2U];
+    if (raw_len < 15U || raw[3] != TELEMETRY_FRAME_TYPE_CBOR ||
+        bench_cborItem(map, map_end) != (uint32_t)(map_end - map)) {
+      simBench_skipWithError(state, "CBOR stats malformed");
+      return;
+    }
+  }
+  while (simBench_keepRunning(state)) {
+    TelemetryFrame_Stats_t *win = &report_windows[i % BENCH_REPORT_WINDOWS];
+    win->timestamp = (uint32_t)(i++ * 1000U);
+    if (telemetryFrame_encodeStatsCbor(win, out, sizeof(out), &len) ==
+        HAL_OK) {
+      cbor_bytes += len;
+    }
+    if (telemetryFrame_encodeStats(win, out, sizeof(out), &len) == HAL_OK) {
+      binary_bytes += len;
+    }
+  }
+  const double windows = (double)simBench_iterations(state);
+  simBench_setCounter(state, "binary_bytes",
+                      windows > 0.0 ? binary_bytes / windows : 0.0);
+  simBench_setCounter(state, "cbor_bytes",
+                      windows > 0.0 ? cbor_bytes / windows : 0.0);
+  simBench_setCounter(state, "size_ratio",
+                      binary_bytes != 0U ? (double)cbor_bytes / binary_bytes
+                                         : 0.0);
+  simBench_setItemsProcessed(state, simBench_iterations(state));
+}
+
+#define BENCH_FAT_REGION 62333952U // sectors of a 32 GB card's region
+#define BENCH_FAT_DATA 4610000U    // 2.2 GB recorded: three data files
+#define BENCH_FAT_DATA_LBA 2048U
+#define BENCH_FAT_ENTRIES (FAT_VIEW_SECTOR_SIZE / 4U) // per FAT sector
+
+static uint32_t bench_get32(const uint8_t *p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) |
+         ((uint32_t)p[3] << 24);
+}
+
+/**
+ * @brief Walk the volume as a host would, from the boot sector alone:
+ *        every data file's chain, each cluster on its card sector
+ *
+ * @return uint32_t Inconsistencies found
+ */
+static uint32_t bench_fatWalk(const FatView_t *view, uint32_t *files,
+                              uint64_t *bytes) {
+  uint8_t boot[FAT_VIEW_SECTOR_SIZE];
+  uint8_t fat[FAT_VIEW_SECTOR_SIZE];
+  uint8_t dir[FAT_VIEW_SECTOR_SIZE];
+  uint32_t errors = 0;
+  uint32_t fat_cached = UINT32_MAX;
+  uint32_t card = 0;
+
+  fatView_read(view, 0, boot);
+  const uint32_t spc = boot[13];
+  const uint32_t reserved = boot[14] | ((uint32_t)boot[15] << 8);
+  const uint32_t fat_size = bench_get32(&boot[36]);
+  const uint32_t data_start = reserved + boot[16] * fat_size;
+  if (boot[510] != 0x55U || boot[511] != 0xAAU ||
+      bench_get32(&boot[32]) != view->total_sectors) {
+    errors++;
+  }
+  *files = 0;
+  *bytes = 0;
+  // The root directory: its first cluster covers every entry here
+  const uint32_t root = data_start + (bench_get32(&boot[44]) - 2U) * spc;
+  for (uint32_t s = 0; s < spc; s++) {
+    fatView_read(view, root + s, dir);
+    for (uint32_t e = 0; e < FAT_VIEW_SECTOR_SIZE; e += 32U) {
+      const uint8_t *d = &dir[e];
+      if (d[0] == 0U) {
+        return errors;
+      }
+      if (memcmp(d, "DATA_", 5U) != 0) {
+        continue;
+      }
+      const uint32_t size = bench_get32(&d[28]);
+      uint32_t cluster = (uint32_t)(d[26] | (d[27] << 8)) |
+                         ((uint32_t)(d[20] | (d[21] << 8)) << 16);
+      uint32_t left = size / FAT_VIEW_SECTOR_SIZE;
+      uint32_t expect = UINT32_MAX;
+      while (left != 0U) {
+        const uint32_t lba = data_start + (cluster - 2U) * spc;
+        const uint32_t run = (left < spc) ? left : spc;
+        if (fatView_map(view, lba, run, &card) != run ||
+            card == FAT_VIEW_SYNTH ||
+            (expect != UINT32_MAX && card != expect)) {
+          errors++;
+        }
+        expect = card + run;
+        left -= run;
+        const uint32_t sector = reserved + cluster / BENCH_FAT_ENTRIES;
+        if (sector != fat_cached) {
+          fatView_read(view, sector, fat);
+          fat_cached = sector;
+        }
+        const uint32_t next =
+            bench_get32(&fat[(cluster % BENCH_FAT_ENTRIES) * 4U]) &
+            0x0FFFFFFFU;
+        if ((left == 0U) != (next >= 0x0FFFFFF8U)) {
+          errors++; // chain and size disagree
+          break;
+        }
+        cluster = next;
+      }
+      (*files)++;
+      *bytes += size;
+    }
+  }
+  return errors;
+}
+
+/* The FAT32 view usb_msc.h exposes over a 32 GB card: every data cluster
+ * maps to the card sector of the recording, the chains end with the files,
+ * and the files add up to what was recorded */
+SIM_BENCH(BM_fatView) {
+  static uint8_t index[FAT_VIEW_SECTOR_SIZE];
+  static FatView_t view;
+  const FatView_Config_t cfg = {.data_lba = BENCH_FAT_DATA_LBA,
+                                .data_sectors = BENCH_FAT_DATA,
+                                .region_sectors = BENCH_FAT_REGION,
+                                .serial = 7U,
+                                .index = index};
+  uint32_t files = 0;
+  uint64_t bytes = 0;
+  uint32_t errors = 0;
+
+  if (fatView_init(&view, &cfg) != HAL_OK) {
+    simBench_skipWithError(state, "fatView_init failed");
+    return;
+  }
+  while (simBench_keepRunning(state)) {
+    errors += bench_fatWalk(&view, &files, &bytes);
+  }
+  if (bytes != (uint64_t)BENCH_FAT_DATA * FAT_VIEW_SECTOR_SIZE) {
+    errors++;
+  }
+  simBench_setCounter(state, "files", files);
+  simBench_setCounter(state, "cluster_kb",
+                      view.cluster_sectors * FAT_VIEW_SECTOR_SIZE / 1024.0);
+  simBench_setCounter(state, "volume_mb",
+                      view.total_sectors / 2048.0);
+  simBench_setCounter(state, "errors", errors);
+  simBench_setItemsProcessed(state, simBench_iterations(state));
+}
@@ -0,0 +1,81 @@
+/**
+ ******************************************************************************
+ * @file    bench_main.c
+ * @brief   Entry point of adc_sim_bench: signal options, then the harness
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "bench_common.h"
+#include "sim_wave.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define BENCH_X_INPUT(name, channel, ohms, bits, adcs, slot) channel,
+
+/* Private variables ---------------------------------------------------------*/
+static SimWave_Synth_t synth;
+static SimWave_Replay_t replay;
+static uint8_t replaying = 0;
+
+static const uint32_t table_inputs[ADC_CONVERSIONS_CHANNEL_COUNT] = {
+    ADC_CHANNELS_TABLE(BENCH_X_INPUT)};
+
+/* Public functions ----------------------------------------------------------*/
+
+void bench_initHal(void) {
+  simHal_init();
+  if (replaying) {
+    simHal_setSource(simWave_replay, &replay);
+  } else {
+    simWave_synthDefaults(&synth);
+    simHal_setSource(simWave_synth, &synth);
+  }
+}
+
+void bench_fillBlock(uint16_t *block, uint32_t frames, uint32_t first_frame) {
+  if (!replaying) {
+    simWave_synthDefaults(&synth);
+  }
+  for (uint32_t f = 0; f < frames; f++) {
+    double t_us = (double)(first_frame + f) * 1e6 / BENCH_FRAME_RATE_HZ;
+    for (uint32_t c = 0; c < ADC_CONVERSIONS_CHANNEL_COUNT; c++) {
+      uint32_t input = (uint16_t)table_inputs[c];
+      block[f * ADC_CONVERSIONS_CHANNEL_COUNT + c] =
+          replaying ? simWave_replay(input, t_us, &replay)
+                    : simWave_synth(input, t_us, &synth);
+    }
+  }
+}
+
+int main(int argc, char **argv) {
+  const char *replay_path = NULL;
+  double replay_rate = BENCH_FRAME_RATE_HZ;
+  int out = 1;
+
+  // Strip the signal options; the harness rejects anything it does not know
+  for (int i = 1; i < argc; i++) {
+    if (strncmp(argv[i], "--replay=", 9) == 0) {
+      replay_path = argv[i] + 9;
+    } else if (strncmp(argv[i], "--replay_rate=", 14) == 0) {
+      replay_rate = strtod(argv[i] + 14, NULL);
+    } else {
+      argv[out++] = argv[i];
+    }
+  }
+
+  if (replay_path != NULL) {
+    if (simWave_replayLoad(&replay, replay_path, replay_rate) != 0) {
+      fprintf(stderr, "%s: cannot replay '%s'\n", argv[0], replay_path);
+      return 1;
+    }
+    replaying = 1;
+  }
+
+  int rc = simBench_main(out, argv);
+  simWave_replayFree(&replay);
+  return rc;
+}
@@ -0,0 +1,282 @@
+/**
+ ******************************************************************************
+ * @file    sim_bench.c
+ * @brief   Micro-benchmark harness: calibration, console and JSON reports
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "sim_bench.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define SIM_BENCH_DEFAULT_MIN_TIME 0.5
+#define SIM_BENCH_MAX_ITERATIONS 1000000000ULL
+#define SIM_BENCH_GROWTH_LIMIT 10.0
+
+/* Private types -------------------------------------------------------------*/
+typedef struct {
+  const char *name;
+  SimBench_Fn_t fn;
+} SimBench_Entry_t;
+
+typedef enum { SIM_BENCH_CONSOLE = 0, SIM_BENCH_JSON } SimBench_Format_t;
+
+/* Private variables ---------------------------------------------------------*/
+static SimBench_Entry_t benchmarks[SIM_BENCH_MAX_BENCHMARKS];
+static uint32_t benchmark_count = 0;
+
+/* Private functions ---------------------------------------------------------*/
+
+static double simBench_clock(clockid_t id) {
+  struct timespec ts;
+  clock_gettime(id, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static void simBench_run(const SimBench_Entry_t *b, uint64_t iterations,
+                         SimBench_State_t *state) {
+  memset(state, 0, sizeof(*state));
+  state->max_iterations = iterations;
+  b->fn(state);
+  if (state->timing) {
+    simBench_pauseTiming(state);
+  }
+}
+
+/**
+ * @brief Grow the iteration count until a run lasts min_time (as Google
+ *        Benchmark does: predict from the last run, at most 10x per step)
+ */
+static void simBench_measure(const SimBench_Entry_t *b, double min_time,
+                             SimBench_State_t *state) {
+  uint64_t iterations = 1;
+
+  for (;;) {
+    simBench_run(b, iterations, state);
+    if (state->error != NULL || state->real_time >= min_time ||
+        iterations >= SIM_BENCH_MAX_ITERATIONS) {
+      return;
+    }
+    double multiplier = SIM_BENCH_GROWTH_LIMIT;
+    if (state->real_time > 0.0) {
+      multiplier = min_time * 1.4 / state->real_time;
+      if (multiplier > SIM_BENCH_GROWTH_LIMIT) {
+        multiplier = SIM_BENCH_GROWTH_LIMIT;
+      }
+    }
+    uint64_t next = (uint64_t)((double)iterations * multiplier);
+    iterations = (next > iterations) ? next : iterations + 1U;
+    if (iterations > SIM_BENCH_MAX_ITERATIONS) {
+      iterations = SIM_BENCH_MAX_ITERATIONS;
+    }
+  }
+}
+
+static void simBench_printConsole(const char *name,
+                                  const SimBench_State_t *s) {
+  if (s->error != NULL) {
+    printf("%-40s ERROR OCCURRED: '%s'\n", name, s->error);
+    return;
+  }
+  double n = (double)s->iterations;
+  printf("%-40s %12.1f ns %12.1f ns %12llu", name, s->real_time * 1e9 / n,
+         s->cpu_time * 1e9 / n, (unsigned long long)s->iterations);
+  if (s->bytes != 0U && s->cpu_time > 0.0) {
+    printf(" bytes_per_second=%.5gM/s", (double)s->bytes / s->cpu_time / 1e6);
+  }
+  if (s->items != 0U && s->cpu_time > 0.0) {
+    printf(" items_per_second=%.5gM/s", (double)s->items / s->cpu_time / 1e6);
+  }
+  for (uint32_t i = 0; i < s->counter_count; i++) {
+    printf(" %s=%g", s->counter_name[i], s->counter_value[i]);
+  }
+  printf("\n");
+}
+
+static void simBench_printJsonContext(const char *executable) {
+  char host[64] = "unknown";
+  char date[32] = "";
+  time_t now = time(NULL);
+  struct tm tm_now;
+
+  gethostname(host, sizeof(host) - 1U);
+  localtime_r(&now, &tm_now);
+  strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S%z", &tm_now);
+  printf("{\n  \"context\": {\n");
+  printf("    \"date\": \"%s\",\n", date);
+  printf("    \"host_name\": \"%s\",\n", host);
+  printf("    \"executable\": \"%s\",\n", executable);
+  printf("    \"num_cpus\": %ld,\n", sysconf(_SC_NPROCESSORS_ONLN));
+  printf("    \"mhz_per_cpu\": 0,\n");
+  printf("    \"cpu_scaling_enabled\": false,\n");
+  printf("    \"library_build_type\": \"release\"\n");
+  printf("  },\n  \"benchmarks\": [");
+}
+
+static void simBench_printJson(const char *name, const SimBench_State_t *s,
+                               uint8_t first) {
+  printf("%s\n    {\n", first ? "" : ",");
+  printf("      \"name\": \"%s\",\n", name);
+  printf("      \"run_name\": \"%s\",\n", name);
+  printf("      \"run_type\": \"iteration\",\n");
+  printf("      \"repetitions\": 1,\n");
+  printf("      \"repetition_index\": 0,\n");
+  printf("      \"threads\": 1,\n");
+  if (s->error != NULL) {
+    printf("      \"error_occurred\": true,\n");
+    printf("      \"error_message\": \"%s\"\n    }", s->error);
+    return;
+  }
+  double n = (double)s->iterations;
+  printf("      \"iterations\": %llu,\n", (unsigned long long)s->iterations);
+  printf("      \"real_time\": %.6e,\n", s->real_time * 1e9 / n);
+  printf("      \"cpu_time\": %.6e,\n", s->cpu_time * 1e9 / n);
+  printf("      \"time_unit\": \"ns\"");
+  if (s->bytes != 0U && s->cpu_time > 0.0) {
+    printf(",\n      \"bytes_per_second\": %.6e", (double)s->bytes / s->cpu_time);
+  }
+  if (s->items != 0U && s->cpu_time > 0.0) {
+    printf(",\n      \"items_per_second\": %.6e", (double)s->items / s->cpu_time);
+  }
+  for (uint32_t i = 0; i < s->counter_count; i++) {
+    printf(",\n      \"%s\": %.6e", s->counter_name[i], s->counter_value[i]);
+  }
+  printf("\n    }");
+}
+
+/* Public functions ----------------------------------------------------------*/
+
+void simBench_register(const char *name, SimBench_Fn_t fn) {
+  if (benchmark_count < SIM_BENCH_MAX_BENCHMARKS) {
+    benchmarks[benchmark_count].name = name;
+    benchmarks[benchmark_count].fn = fn;
+    benchmark_count++;
+  }
+}
+
+int simBench_keepRunning(SimBench_State_t *state) {
+  if (state->error != NULL) {
+    return 0;
+  }
+  if (!state->started) {
+    state->started = 1;
+    simBench_resumeTiming(state);
+  } else {
+    state->iterations++;
+  }
+  if (state->iterations < state->max_iterations) {
+    return 1;
+  }
+  simBench_pauseTiming(state);
+  return 0;
+}
+
+void simBench_pauseTiming(SimBench_State_t *state) {
+  if (state->timing) {
+    state->real_time += simBench_clock(CLOCK_MONOTONIC) - state->real_start;
+    state->cpu_time +=
+        simBench_clock(CLOCK_PROCESS_CPUTIME_ID) - state->cpu_start;
+    state->timing = 0;
+  }
+}
+
+void simBench_resumeTiming(SimBench_State_t *state) {
+  if (!state->timing) {
+    state->cpu_start = simBench_clock(CLOCK_PROCESS_CPUTIME_ID);
+    state->real_start = simBench_clock(CLOCK_MONOTONIC);
+    state->timing = 1;
+  }
+}
+
+void simBench_setItemsProcessed(SimBench_State_t *state, uint64_t items) {
+  state->items = items;
+}
+
+void simBench_setBytesProcessed(SimBench_State_t *state, uint64_t bytes) {
+  state->bytes = bytes;
+}
+
+void simBench_setCounter(SimBench_State_t *state, const char *name,
+                         double value) {
+  for (uint32_t i = 0; i < state->counter_count; i++) {
+    if (strcmp(state->counter_name[i], name) == 0) {
+      state->counter_value[i] = value;
+      return;
+    }
+  }
+  if (state->counter_count < SIM_BENCH_MAX_COUNTERS) {
+    state->counter_name[state->counter_count] = name;
+    state->counter_value[state->counter_count] = value;
+    state->counter_count++;
+  }
+}
+
+void simBench_skipWithError(SimBench_State_t *state, const char *message) {
+  state->error = message;
+  simBench_pauseTiming(state);
+}
+
+int simBench_main(int argc, char **argv) {
+  const char *filter = NULL;
+  double min_time = SIM_BENCH_DEFAULT_MIN_TIME;
+  SimBench_Format_t format = SIM_BENCH_CONSOLE;
+  uint8_t list_only = 0;
+  int failed = 0;
+
+  for (int i = 1; i < argc; i++) {
+    const char *arg = argv[i];
+    if (strncmp(arg, "--benchmark_filter=", 19) == 0) {
+      filter = arg + 19;
+    } else if (strncmp(arg, "--benchmark_min_time=", 21) == 0) {
+      min_time = strtod(arg + 21, NULL);
+    } else if (strcmp(arg, "--benchmark_format=json") == 0) {
+      format = SIM_BENCH_JSON;
+    } else if (strcmp(arg, "--benchmark_format=console") == 0) {
+      format = SIM_BENCH_CONSOLE;
+    } else if (strcmp(arg, "--benchmark_list_tests") == 0) {
+      list_only = 1;
+    } else {
+      fprintf(stderr, "%s: unknown option '%s'\n", argv[0], arg);
+      return 1;
+    }
+  }
+
+  if (format == SIM_BENCH_JSON) {
+    simBench_printJsonContext(argv[0]);
+  } else if (!list_only) {
+    printf("%-40s %15s %15s %12s\n", "Benchmark", "Time", "CPU",
+           "Iterations");
+  }
+
+  uint8_t first = 1;
+  for (uint32_t i = 0; i < benchmark_count; i++) {
+    const SimBench_Entry_t *b = &benchmarks[i];
+    if (filter != NULL && strstr(b->name, filter) == NULL) {
+      continue;
+    }
+    if (list_only) {
+      printf("%s\n", b->name);
+      continue;
+    }
+    SimBench_State_t state;
+    simBench_measure(b, min_time, &state);
+    failed |= (state.error != NULL);
+    if (format == SIM_BENCH_JSON) {
+      simBench_printJson(b->name, &state, first);
+    } else {
+      simBench_printConsole(b->name, &state);
+    }
+    first = 0;
+  }
+
+  if (format == SIM_BENCH_JSON) {
+    printf("\n  ]\n}\n");
+  }
+  return failed;
+}
@@ -0,0 +1,129 @@
+/**
+ ******************************************************************************
+ * @file    sim_bench.h
+ * @brief   Micro-benchmark harness for the host simulation build
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * Same model and output as Google Benchmark, in C so the firmware sources
+ * link without a C++ toolchain or a vendored library:
+ *   - A benchmark is a function holding a timed loop; setup before the loop
+ *     is not measured. SIM_BENCH() registers it at load time.
+ *   - The iteration count grows until one run lasts --benchmark_min_time
+ *     seconds, then that run is reported (real and CPU time per iteration).
+ *   - Items/bytes per second and named counters are reported next to it.
+ *   - --benchmark_format=json writes Google Benchmark's JSON layout, so
+ *     tools/compare.py of that project diffs two runs (e.g. in CI).
+ *
+ * Options: --benchmark_filter=<substring>, --benchmark_min_time=<seconds>,
+ * --benchmark_format=console|json, --benchmark_list_tests.
+ *
+ * Usage Example:
+ *   SIM_BENCH(BM_ringPush) {
+ *     ADC_RingEntry_t entry = {0};
+ *     while (simBench_keepRunning(state)) {
+ *       adcRing_push(&entry);
+ *     }
+ *     simBench_setItemsProcessed(state, simBench_iterations(state));
+ *   }
+ *
+ ******************************************************************************
+ */
+
+#ifndef SIM_BENCH_H
+#define SIM_BENCH_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+#define SIM_BENCH_MAX_BENCHMARKS 128U
+#define SIM_BENCH_MAX_COUNTERS 8U
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief Run state handed to a benchmark
+ */
+typedef struct {
+  uint64_t max_iterations; ///< Iterations of this run
+  uint64_t iterations;     ///< Done so far
+  double real_start;       ///< Seconds, monotonic
+  double cpu_start;        ///< Seconds, process CPU time
+  double real_time;        ///< Accumulated while the timer runs
+  double cpu_time;
+  uint8_t started;         ///< 1 = timed loop entered
+  uint8_t timing;          ///< 1 = timer running
+  uint64_t items;          ///< simBench_setItemsProcessed()
+  uint64_t bytes;          ///< simBench_setBytesProcessed()
+  const char *error;       ///< simBench_skipWithError()
+  uint32_t counter_count;
+  const char *counter_name[SIM_BENCH_MAX_COUNTERS];
+  double counter_value[SIM_BENCH_MAX_COUNTERS];
+} SimBench_State_t;
+
+typedef void (*SimBench_Fn_t)(SimBench_State_t *state);
+
+/* Exported macros -----------------------------------------------------------*/
+
+/**
+ * @brief Define and register a benchmark; the body sees `state`
+ */
+#define SIM_BENCH(name)                                                        \
+  static void name(SimBench_State_t *state);                                   \
+  __attribute__((constructor)) static void name##_register(void) {             \
+    simBench_register(#name, name);                                            \
+  }                                                                            \
+  static void name(SimBench_State_t *state)
+
+/* Exported functions --------------------------------------------------------*/
+
+void simBench_register(const char *name, SimBench_Fn_t fn);
+
+/**
+ * @brief Loop condition of the timed loop; starts the timer on first call
+ *        and stops it when the run is complete
+ */
+int simBench_keepRunning(SimBench_State_t *state);
+
+/**
+ * @brief Exclude a section of the loop body from the measurement
+ */
+void simBench_pauseTiming(SimBench_State_t *state);
+void simBench_resumeTiming(SimBench_State_t *state);
+
+static inline uint64_t simBench_iterations(const SimBench_State_t *state) {
+  return state->iterations;
+}
+
+void simBench_setItemsProcessed(SimBench_State_t *state, uint64_t items);
+void simBench_setBytesProcessed(SimBench_State_t *state, uint64_t bytes);
+
+/**
+ * @brief Report a named value with the run (e.g. faults seen, error count)
+ */
+void simBench_setCounter(SimBench_State_t *state, const char *name,
+                         double value);
+
+/**
+ * @brief Abort the benchmark; reported with the message, no timings
+ */
+void simBench_skipWithError(SimBench_State_t *state, const char *message);
+
+/**
+ * @brief Parse the options, run the matching benchmarks, print the report
+ *
+ * @return 0, or 1 on a bad option or a benchmark error
+ */
+int simBench_main(int argc, char **argv);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SIM_BENCH_H */
@@ -0,0 +1,276 @@
+/**
+ ******************************************************************************
+ * @file    cmsis_compiler.h
+ * @brief   Host stand-in for the CMSIS compiler header (simulation build)
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * Shadows Drivers/CMSIS/Include/cmsis_compiler.h in the host build only.
+ * Keeps the attribute macros and replaces every Cortex-M intrinsic the
+ * firmware and CMSIS-DSP use with plain C of the same semantics:
+ *   - barriers become compiler/CPU fences
+ *   - PRIMASK is a variable; __disable_irq() masks the simulated interrupts
+ *     (sim_hal.c delivers none while it is set)
+ *   - the exclusive monitor is a flag: an exclusive store succeeds when it
+ *     is still set, __CLREX() clears it
+ *   - the DSP extension (SMLAD, PKHBT, SEL, ...) is computed lane by lane;
+ *     the APSR.GE bits live in simCore_ge so that __USUB16() + __SEL()
+ *     behave as on the core.
+ *
+ ******************************************************************************
+ */
+
+#ifndef SIM_CMSIS_COMPILER_H
+#define SIM_CMSIS_COMPILER_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Attribute macros ----------------------------------------------------------*/
+#define __ASM __asm
+#define __INLINE inline
+#define __STATIC_INLINE static inline
+#define __STATIC_FORCEINLINE __attribute__((always_inline)) static inline
+#define __NO_RETURN __attribute__((__noreturn__))
+#define __USED __attribute__((used))
+#define __WEAK __attribute__((weak))
+#define __PACKED __attribute__((packed, aligned(1)))
+#define __PACKED_STRUCT struct __attribute__((packed, aligned(1)))
+#define __PACKED_UNION union __attribute__((packed, aligned(1)))
+#define __ALIGNED(x) __attribute__((aligned(x)))
+#define __RESTRICT __restrict
+#define __COMPILER_BARRIER() __asm volatile("" ::: "memory")
+
+/* Simulated core state ------------------------------------------------------*/
+extern volatile uint32_t simCore_primask; ///< 1 = interrupts masked
+extern uint32_t simCore_ge;               ///< APSR.GE[3:0]
+extern uint32_t simCore_exclusive;        ///< Exclusive monitor open
+
+/* Core instructions ---------------------------------------------------------*/
+#define __NOP() ((void)0)
+#define __WFI() ((void)0)
+#define __WFE() ((void)0)
+#define __SEV() ((void)0)
+#define __BKPT(value) ((void)(value))
+#define __ISB() __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#define __DSB() __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#define __DMB() __atomic_thread_fence(__ATOMIC_SEQ_CST)
+
+__STATIC_INLINE void __enable_irq(void) { simCore_primask = 0U; }
+__STATIC_INLINE void __disable_irq(void) { simCore_primask = 1U; }
+__STATIC_INLINE uint32_t __get_PRIMASK(void) { return simCore_primask; }
+__STATIC_INLINE void __set_PRIMASK(uint32_t primask) {
+  simCore_primask = primask & 1U;
+}
+
+__STATIC_INLINE uint32_t __LDREXW(volatile uint32_t *addr) {
+  simCore_exclusive = 1U;
+  return *addr;
+}
+__STATIC_INLINE uint32_t __STREXW(uint32_t value, volatile uint32_t *addr) {
+  if (!simCore_exclusive) {
+    return 1U;
+  }
+  simCore_exclusive = 0U;
+  *addr = value;
+  return 0U;
+}
+__STATIC_INLINE void __CLREX(void) { simCore_exclusive = 0U; }
+
+__STATIC_INLINE uint32_t __REV(uint32_t value) {
+  return __builtin_bswap32(value);
+}
+__STATIC_INLINE uint32_t __REV16(uint32_t value) {
+  return ((value & 0x00FF00FFU) << 8) | ((value >> 8) & 0x00FF00FFU);
+}
+__STATIC_INLINE int16_t __REVSH(int16_t value) {
+  return (int16_t)__builtin_bswap16((uint16_t)value);
+}
+__STATIC_INLINE uint32_t __ROR(uint32_t op1, uint32_t op2) {
+  op2 %= 32U;
+  return (op2 == 0U) ? op1 : (op1 >> op2) | (op1 << (32U - op2));
+}
+__STATIC_INLINE uint32_t __RBIT(uint32_t value) {
+  uint32_t result = 0;
+  for (uint32_t i = 0; i < 32U; i++) {
+    result = (result << 1) | ((value >> i) & 1U);
+  }
+  return result;
+}
+__STATIC_INLINE uint8_t __CLZ(uint32_t value) {
+  return (value == 0U) ? 32U : (uint8_t)__builtin_clz(value);
+}
+
+__STATIC_INLINE int32_t simCore_ssat(int32_t val, uint32_t sat) {
+  if (sat >= 1U && sat <= 32U) {
+    const int32_t max = (int32_t)((1ULL << (sat - 1U)) - 1U);
+    const int32_t min = -1 - max;
+    if (val > max) {
+      return max;
+    }
+    if (val < min) {
+      return min;
+    }
+  }
+  return val;
+}
+__STATIC_INLINE uint32_t simCore_usat(int32_t val, uint32_t sat) {
+  if (sat <= 31U) {
+    const uint32_t max = (1UL << sat) - 1U;
+    if (val > (int32_t)max) {
+      return max;
+    }
+    if (val < 0) {
+      return 0U;
+    }
+  }
+  return (uint32_t)val;
+}
+#define __SSAT(ARG1, ARG2) simCore_ssat((int32_t)(ARG1), (ARG2))
+#define __USAT(ARG1, ARG2) simCore_usat((int32_t)(ARG1), (ARG2))
+
+/* DSP extension, lane helpers -----------------------------------------------*/
+#define SIM_LO16(x) ((int32_t)(int16_t)(x))
+#define SIM_HI16(x) ((int32_t)(int16_t)((x) >> 16))
+#define SIM_PACK16(hi, lo)                                                     \
+  ((((uint32_t)(hi) & 0xFFFFU) << 16) | ((uint32_t)(lo) & 0xFFFFU))
+
+__STATIC_INLINE int32_t simCore_sat16(int32_t v) { return simCore_ssat(v, 16); }
+__STATIC_INLINE int32_t simCore_sat8(int32_t v) { return simCore_ssat(v, 8); }
+
+/* DSP extension -------------------------------------------------------------*/
+__STATIC_INLINE uint32_t __QADD8(uint32_t x, uint32_t y) {
+  uint32_t r = 0;
+  for (uint32_t i = 0; i < 32U; i += 8U) {
+    int32_t s = (int32_t)(int8_t)(x >> i) + (int32_t)(int8_t)(y >> i);
+    r |= ((uint32_t)simCore_sat8(s) & 0xFFU) << i;
+  }
+  return r;
+}
+__STATIC_INLINE uint32_t __QSUB8(uint32_t x, uint32_t y) {
+  uint32_t r = 0;
+  for (uint32_t i = 0; i < 32U; i += 8U) {
+    int32_t s = (int32_t)(int8_t)(x >> i) - (int32_t)(int8_t)(y >> i);
+    r |= ((uint32_t)simCore_sat8(s) & 0xFFU) << i;
+  }
+  return r;
+}
+__STATIC_INLINE uint32_t __QADD16(uint32_t x, uint32_t y) {
+  return SIM_PACK16(simCore_sat16(SIM_HI16(x) + SIM_HI16(y)),
+                    simCore_sat16(SIM_LO16(x) + SIM_LO16(y)));
+}
+__STATIC_INLINE uint32_t __QSUB16(uint32_t x, uint32_t y) {
+  return SIM_PACK16(simCore_sat16(SIM_HI16(x) - SIM_HI16(y)),
+                    simCore_sat16(SIM_LO16(x) - SIM_LO16(y)));
+}
+__STATIC_INLINE uint32_t __SHADD16(uint32_t x, uint32_t y) {
+  return SIM_PACK16((SIM_HI16(x) + SIM_HI16(y)) >> 1,
+                    (SIM_LO16(x) + SIM_LO16(y)) >> 1);
+}
+__STATIC_INLINE uint32_t __SHSUB16(uint32_t x, uint32_t y) {
+  return SIM_PACK16((SIM_HI16(x) - SIM_HI16(y)) >> 1,
+                    (SIM_LO16(x) - SIM_LO16(y)) >> 1);
+}
+__STATIC_INLINE uint32_t __QASX(uint32_t x, uint32_t y) {
+  return SIM_PACK16(simCore_sat16(SIM_HI16(x) + SIM_LO16(y)),
+                    simCore_sat16(SIM_LO16(x) - SIM_HI16(y)));
+}
+__STATIC_INLINE uint32_t __SHASX(uint32_t x, uint32_t y) {
+  return SIM_PACK16((SIM_HI16(x) + SIM_LO16(y)) >> 1,
+                    (SIM_LO16(x) - SIM_HI16(y)) >> 1);
+}
+__STATIC_INLINE uint32_t __QSAX(uint32_t x, uint32_t y) {
+  return SIM_PACK16(simCore_sat16(SIM_HI16(x) - SIM_LO16(y)),
+                    simCore_sat16(SIM_LO16(x) + SIM_HI16(y)));
+}
+__STATIC_INLINE uint32_t __SHSAX(uint32_t x, uint32_t y) {
+  return SIM_PACK16((SIM_HI16(x) - SIM_LO16(y)) >> 1,
+                    (SIM_LO16(x) + SIM_HI16(y)) >> 1);
+}
+__STATIC_INLINE uint32_t __SADD16(uint32_t x, uint32_t y) {
+  return SIM_PACK16(SIM_HI16(x) + SIM_HI16(y), SIM_LO16(x) + SIM_LO16(y));
+}
+__STATIC_INLINE uint32_t __SSUB16(uint32_t x, uint32_t y) {
+  return SIM_PACK16(SIM_HI16(x) - SIM_HI16(y), SIM_LO16(x) - SIM_LO16(y));
+}
+__STATIC_INLINE uint32_t __UADD16(uint32_t x, uint32_t y) {
+  uint32_t lo = (x & 0xFFFFU) + (y & 0xFFFFU);
+  uint32_t hi = (x >> 16) + (y >> 16);
+  simCore_ge = ((lo > 0xFFFFU) ? 0x3U : 0U) | ((hi > 0xFFFFU) ? 0xCU : 0U);
+  return SIM_PACK16(hi, lo);
+}
+__STATIC_INLINE uint32_t __USUB16(uint32_t x, uint32_t y) {
+  uint32_t lo = (x & 0xFFFFU) - (y & 0xFFFFU);
+  uint32_t hi = (x >> 16) - (y >> 16);
+  simCore_ge = (((x & 0xFFFFU) >= (y & 0xFFFFU)) ? 0x3U : 0U) |
+               (((x >> 16) >= (y >> 16)) ? 0xCU : 0U);
+  return SIM_PACK16(hi, lo);
+}
+__STATIC_INLINE uint32_t __SEL(uint32_t x, uint32_t y) {
+  uint32_t r = 0;
+  for (uint32_t i = 0; i < 4U; i++) {
+    uint32_t lane = 0xFFUL << (8U * i);
+    r |= ((simCore_ge >> i) & 1U) ? (x & lane) : (y & lane);
+  }
+  return r;
+}
+__STATIC_INLINE int32_t __QADD(int32_t x, int32_t y) {
+  int64_t s = (int64_t)x + y;
+  return (s > INT32_MAX) ? INT32_MAX : (s < INT32_MIN) ? INT32_MIN : (int32_t)s;
+}
+__STATIC_INLINE int32_t __QSUB(int32_t x, int32_t y) {
+  int64_t s = (int64_t)x - y;
+  return (s > INT32_MAX) ? INT32_MAX : (s < INT32_MIN) ? INT32_MIN : (int32_t)s;
+}
+__STATIC_INLINE uint32_t __SMUAD(uint32_t x, uint32_t y) {
+  return (uint32_t)(SIM_LO16(x) * SIM_LO16(y) + SIM_HI16(x) * SIM_HI16(y));
+}
+__STATIC_INLINE uint32_t __SMUADX(uint32_t x, uint32_t y) {
+  return (uint32_t)(SIM_LO16(x) * SIM_HI16(y) + SIM_HI16(x) * SIM_LO16(y));
+}
+__STATIC_INLINE uint32_t __SMUSD(uint32_t x, uint32_t y) {
+  return (uint32_t)(SIM_LO16(x) * SIM_LO16(y) - SIM_HI16(x) * SIM_HI16(y));
+}
+__STATIC_INLINE uint32_t __SMUSDX(uint32_t x, uint32_t y) {
+  return (uint32_t)(SIM_LO16(x) * SIM_HI16(y) - SIM_HI16(x) * SIM_LO16(y));
+}
+__STATIC_INLINE uint32_t __SMLAD(uint32_t x, uint32_t y, uint32_t sum) {
+  return __SMUAD(x, y) + sum;
+}
+__STATIC_INLINE uint32_t __SMLADX(uint32_t x, uint32_t y, uint32_t sum) {
+  return __SMUADX(x, y) + sum;
+}
+__STATIC_INLINE uint32_t __SMLSDX(uint32_t x, uint32_t y, uint32_t sum) {
+  return __SMUSDX(x, y) + sum;
+}
+__STATIC_INLINE uint64_t __SMLALD(uint32_t x, uint32_t y, uint64_t sum) {
+  return (uint64_t)((int64_t)SIM_LO16(x) * SIM_LO16(y) +
+                    (int64_t)SIM_HI16(x) * SIM_HI16(y) + (int64_t)sum);
+}
+__STATIC_INLINE uint64_t __SMLALDX(uint32_t x, uint32_t y, uint64_t sum) {
+  return (uint64_t)((int64_t)SIM_LO16(x) * SIM_HI16(y) +
+                    (int64_t)SIM_HI16(x) * SIM_LO16(y) + (int64_t)sum);
+}
+__STATIC_INLINE uint32_t __SXTB16(uint32_t x) {
+  return SIM_PACK16((int32_t)(int8_t)(x >> 16), (int32_t)(int8_t)x);
+}
+__STATIC_INLINE int32_t __SMMLA(int32_t x, int32_t y, int32_t sum) {
+  return (int32_t)((((int64_t)sum << 32) + (int64_t)x * y) >> 32);
+}
+#define __PKHBT(ARG1, ARG2, ARG3)                                              \
+  ((((uint32_t)(ARG1)) & 0x0000FFFFUL) |                                       \
+   ((((uint32_t)(ARG2)) << (ARG3)) & 0xFFFF0000UL))
+#define __PKHTB(ARG1, ARG2, ARG3)                                              \
+  ((((uint32_t)(ARG1)) & 0xFFFF0000UL) |                                       \
+   ((((uint32_t)(ARG2)) >> (ARG3)) & 0x0000FFFFUL))
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SIM_CMSIS_COMPILER_H */
@@ -0,0 +1,166 @@
+/**
+ ******************************************************************************
+ * @file    core_cm7.h
+ * @brief   Host stand-in for the Cortex-M7 core header (simulation build)
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * Shadows Drivers/CMSIS/Include/core_cm7.h when stm32f746xx.h and
+ * arm_math.h are compiled for the host. Only the core peripherals the
+ * simulated sources touch exist, as RAM:
+ *   - DWT: every DWT-> access goes through simCore_dwt(), which refreshes
+ *     CYCCNT from the host monotonic clock scaled to SystemCoreClock. So
+ *     the profiler probes and the cycle-counted timeouts read host time in
+ *     target cycles.
+ *   - CoreDebug, SCB, FPU: plain registers; cache maintenance is a no-op
+ *     (there is no DMA behind the cache on the host).
+ *   - NVIC: enable and priority calls are accepted and ignored.
+ *
+ ******************************************************************************
+ */
+
+#ifndef SIM_CORE_CM7_H
+#define SIM_CORE_CM7_H
+
+#include "cmsis_compiler.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Core configuration --------------------------------------------------------*/
+#define __CM7_CMSIS_VERSION_MAIN 5U
+#define __CM7_CMSIS_VERSION_SUB 0U
+#define __CORTEX_M 7U
+#define __FPU_USED 1U
+
+/* IO type qualifiers --------------------------------------------------------*/
+#ifdef __cplusplus
+#define __I volatile
+#else
+#define __I volatile const
+#endif
+#define __O volatile
+#define __IO volatile
+#define __IM volatile const
+#define __OM volatile
+#define __IOM volatile
+
+/* Core registers ------------------------------------------------------------*/
+typedef struct {
+  __IOM uint32_t CPUID;
+  __IOM uint32_t ICSR;
+  __IOM uint32_t VTOR;
+  __IOM uint32_t AIRCR;
+  __IOM uint32_t SCR;
+  __IOM uint32_t CCR;
+  __IOM uint8_t SHPR[12U];
+  __IOM uint32_t SHCSR;
+  __IOM uint32_t CFSR;
+  __IOM uint32_t HFSR;
+  __IOM uint32_t DFSR;
+  __IOM uint32_t MMFAR;
+  __IOM uint32_t BFAR;
+  __IOM uint32_t AFSR;
+  __IOM uint32_t CPACR;
+} SCB_Type;
+
+typedef struct {
+  __IOM uint32_t CTRL;
+  __IOM uint32_t CYCCNT;
+  __IOM uint32_t CPICNT;
+  __IOM uint32_t EXCCNT;
+  __IOM uint32_t SLEEPCNT;
+  __IOM uint32_t LSUCNT;
+  __IOM uint32_t FOLDCNT;
+  __IM uint32_t PCSR;
+  __OM uint32_t LAR;
+  __IM uint32_t LSR;
+} DWT_Type;
+
+typedef struct {
+  uint32_t RESERVED0[1U];
+  __IOM uint32_t FPCCR;
+  __IOM uint32_t FPCAR;
+  __IOM uint32_t FPDSCR;
+} FPU_Type;
+
+typedef struct {
+  __IOM uint32_t DHCSR;
+  __OM uint32_t DCRSR;
+  __IOM uint32_t DCRDR;
+  __IOM uint32_t DEMCR;
+} CoreDebug_Type;
+
+#define DWT_CTRL_CYCCNTENA_Pos 0U
+#define DWT_CTRL_CYCCNTENA_Msk (1UL << DWT_CTRL_CYCCNTENA_Pos)
+#define CoreDebug_DEMCR_TRCENA_Pos 24U
+#define CoreDebug_DEMCR_TRCENA_Msk (1UL << CoreDebug_DEMCR_TRCENA_Pos)
+#define SCB_CCR_DC_Pos 16U
+#define SCB_CCR_DC_Msk (1UL << SCB_CCR_DC_Pos)
+#define SCB_CCR_IC_Pos 17U
+#define SCB_CCR_IC_Msk (1UL << SCB_CCR_IC_Pos)
+#define FPU_FPCCR_ASPEN_Pos 31U
+#define FPU_FPCCR_ASPEN_Msk (1UL << FPU_FPCCR_ASPEN_Pos)
+#define FPU_FPCCR_LSPEN_Pos 30U
+#define FPU_FPCCR_LSPEN_Msk (1UL << FPU_FPCCR_LSPEN_Pos)
+
+extern SCB_Type simCore_scb;
+extern FPU_Type simCore_fpu;
+extern CoreDebug_Type simCore_coreDebug;
+
+/**
+ * @brief DWT with CYCCNT brought up to date (counts only while CYCCNTENA)
+ */
+DWT_Type *simCore_dwt(void);
+
+#define SCB (&simCore_scb)
+#define FPU (&simCore_fpu)
+#define CoreDebug (&simCore_coreDebug)
+#define DWT (simCore_dwt())
+
+/* NVIC ----------------------------------------------------------------------*/
+#ifndef __CMSIS_GENERIC
+__STATIC_INLINE void NVIC_SetPriorityGrouping(uint32_t group) { (void)group; }
+__STATIC_INLINE void NVIC_SetPriority(IRQn_Type irq, uint32_t priority) {
+  (void)irq;
+  (void)priority;
+}
+__STATIC_INLINE void NVIC_EnableIRQ(IRQn_Type irq) { (void)irq; }
+__STATIC_INLINE void NVIC_DisableIRQ(IRQn_Type irq) { (void)irq; }
+__STATIC_INLINE void NVIC_SetPendingIRQ(IRQn_Type irq) { (void)irq; }
+__STATIC_INLINE void NVIC_ClearPendingIRQ(IRQn_Type irq) { (void)irq; }
+__STATIC_INLINE void NVIC_SystemReset(void) {}
+#endif
+
+/* Cache maintenance ---------------------------------------------------------*/
+__STATIC_INLINE void SCB_EnableICache(void) { SCB->CCR |= SCB_CCR_IC_Msk; }
+__STATIC_INLINE void SCB_EnableDCache(void) { SCB->CCR |= SCB_CCR_DC_Msk; }
+__STATIC_INLINE void SCB_InvalidateICache(void) {}
+__STATIC_INLINE void SCB_InvalidateDCache(void) {}
+__STATIC_INLINE void SCB_CleanDCache(void) {}
+__STATIC_INLINE void SCB_CleanInvalidateDCache(void) {}
+__STATIC_INLINE void SCB_InvalidateDCache_by_Addr(volatile void *addr,
+                                                  int32_t dsize) {
+  (void)addr;
+  (void)dsize;
+}
+__STATIC_INLINE void SCB_CleanDCache_by_Addr(volatile void *addr,
+                                             int32_t dsize) {
+  (void)addr;
+  (void)dsize;
+}
+__STATIC_INLINE void SCB_CleanInvalidateDCache_by_Addr(volatile void *addr,
+                                                       int32_t dsize) {
+  (void)addr;
+  (void)dsize;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SIM_CORE_CM7_H */
@@ -0,0 +1,171 @@
+/**
+ ******************************************************************************
+ * @file    sim_hal.h
+ * @brief   Mock ADC/DMA/TIM HAL for the host simulation build
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * Implements the HAL_ADC_*, HAL_ADCEx_*, HAL_DMA_*, HAL_TIM_* and HAL_RCC_*
+ * calls of adc_conversions.c, adc.c and tim.c against RAM registers, so the
+ * firmware sources run unmodified on the host.
+ *
+ * Conversion model:
+ *   - The programmed registers are the only configuration: the rank ->
+ *     channel map comes from SQRx, the sample times from SMPRx, the
+ *     multimode from the common CCR, and the frame rate from TIM2 (external
+ *     trigger) or from the scan length at ADCCLK (continuous).
+ *   - Values come from a source function, called with the ADC input channel
+ *     and the simulated time of the conversion (see sim_wave.h).
+ *   - Software starts (HAL and LL polling, injected and asynchronous reads)
+ *     convert when the firmware next looks at the registers: the ADCx
+ *     accessors run the model, and deliver EOC / JEOC interrupts that are
+ *     enabled, outside PRIMASK sections.
+ *   - DMA does not run by itself. simHal_runBlocks() fills the next half of
+ *     the circular buffer and calls HAL_ADC_ConvHalfCpltCallback() /
+ *     HAL_ADC_ConvCpltCallback() as the DMA interrupt would; a normal-mode
+ *     capture is filled in one go.
+ *   - The analog watchdog compares every DMA sample and calls
+ *     HAL_ADC_LevelOutOfWindowCallback() while AWDIE is set.
+ *
+ * Time: a simulated microsecond clock. It advances by the DMA blocks'
+ * duration, by 1 us per HAL_GetTick() call (so poll loops with a timeout
+ * terminate), and through simHal_advanceUs(). TIM5 (timebase.c) counts it at
+ * 1 MHz, HAL_GetTick() is it / 1000. DWT->CYCCNT is host time instead.
+ *
+ * Faults: simHal_injectFault() arms a failure for the next count
+ * occurrences, e.g. 3 ConfigChannel errors or 10 missed DMA interrupts.
+ *
+ * Usage Example:
+ *   simHal_init();                      // CubeMX init as on the board
+ *   simHal_setSource(simWave_synth, &synth);
+ *   analogSensor_startTimedDMA(4000);
+ *   simHal_injectFault(SIM_FAULT_MISSED_IRQ, 1, 0);
+ *   simHal_runBlocks(8);                // 8 block callbacks, one missed
+ *
+ ******************************************************************************
+ */
+
+#ifndef SIM_HAL_H
+#define SIM_HAL_H
+
+#include "stm32f7xx_hal.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+
+/**
+ * @brief Clock tree of the BALANCED profile (clock_profile.h)
+ */
+#define SIM_HAL_HCLK_HZ 108000000UL
+#define SIM_HAL_PCLK1_HZ 54000000UL
+#define SIM_HAL_PCLK2_HZ 108000000UL
+
+/**
+ * @brief ADC input channels the source is asked for (0..18)
+ */
+#define SIM_HAL_ADC_INPUTS 19U
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief Sample source
+ *
+ * @param adc_channel ADC input channel, 0..SIM_HAL_ADC_INPUTS-1
+ * @param t_us        Simulated time of the conversion
+ * @param ctx         Context given to simHal_setSource()
+ *
+ * @return 12-bit code
+ */
+typedef uint16_t (*SimHal_Source_t)(uint32_t adc_channel, double t_us,
+                                    void *ctx);
+
+/**
+ * @brief Injectable faults
+ */
+typedef enum {
+  SIM_FAULT_CONFIG = 0, ///< HAL_ADC_ConfigChannel()/Injected...: HAL_ERROR
+  SIM_FAULT_START,      ///< HAL_ADC_Start(), HAL_ADCEx_InjectedStart*(): HAL_ERROR
+  SIM_FAULT_DMA_START,  ///< HAL_ADC_Start_DMA(), MultiModeStart_DMA(): HAL_ERROR
+  SIM_FAULT_TIMEOUT,    ///< A software conversion never ends (no EOC/JEOC)
+  SIM_FAULT_OVERRUN,    ///< Overrun after a DMA block, before its interrupt
+  SIM_FAULT_MISSED_IRQ, ///< A DMA block completes without its callback
+  SIM_FAULT_RAIL_HIGH,  ///< Samples of ADC channel arg read 4095
+  SIM_FAULT_RAIL_LOW,   ///< Samples of ADC channel arg read 0
+  SIM_FAULT_COUNT
+} SimHal_Fault_t;
+
+/**
+ * @brief Mock activity since simHal_init()
+ */
+typedef struct {
+  uint32_t conversions;       ///< Software (polled and injected) conversions
+  uint32_t dma_blocks;        ///< Half-buffers written
+  uint32_t dma_samples;       ///< Samples written by DMA
+  uint32_t callbacks;         ///< Block callbacks delivered
+  uint32_t watchdog_alarms;   ///< LevelOutOfWindow callbacks
+  uint32_t faults[SIM_FAULT_COUNT]; ///< Faults that took effect
+} SimHal_Stats_t;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief Reset registers, time and faults, then run the CubeMX ADC/DMA/TIM
+ *        initialisation (MX_ADC1..3_Init, MX_TIM2_Init)
+ */
+void simHal_init(void);
+
+/**
+ * @brief Select the sample source (NULL = mid-scale 2048 on every channel)
+ */
+void simHal_setSource(SimHal_Source_t source, void *ctx);
+
+/**
+ * @brief Deliver DMA half-transfers
+ *
+ * @param halves Half-buffers to complete
+ *
+ * @return Half-buffers completed, fewer if no DMA stream is running
+ */
+uint32_t simHal_runBlocks(uint32_t halves);
+
+/**
+ * @brief Arm a fault
+ *
+ * @param fault Fault kind
+ * @param count Occurrences before it disarms (0 = disarm)
+ * @param arg   ADC channel for the RAIL faults, unused otherwise
+ */
+void simHal_injectFault(SimHal_Fault_t fault, uint32_t count, uint32_t arg);
+
+/**
+ * @brief Advance the simulated clock
+ */
+void simHal_advanceUs(uint64_t us);
+
+/**
+ * @brief Simulated time since simHal_init()
+ */
+uint64_t simHal_getTimeUs(void);
+
+/**
+ * @brief Frame rate the DMA model runs at with the current registers
+ *        (0 = DMA stopped or timer trigger not running)
+ */
+double simHal_getFrameRate(void);
+
+/**
+ * @brief Copy the activity counters
+ */
+void simHal_getStats(SimHal_Stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SIM_HAL_H */
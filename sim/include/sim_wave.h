@@ -0,0 +1,106 @@
+/**
+ ******************************************************************************
+ * @file    sim_wave.h
+ * @brief   Sample sources for the mock HAL: synthetic signals and replay
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * Two SimHal_Source_t implementations:
+ *   - simWave_synth(): per ADC input, offset + amplitude * sin(2 pi f t +
+ *     phase) + uniform noise. The noise is a fixed-seed xorshift, so every
+ *     run converts the same codes.
+ *   - simWave_replay(): frames recorded from the board (telemetry dumps,
+ *     SD logs), one value per ADC_CHANNELS_TABLE() row in table order,
+ *     played back at a fixed frame rate and looped. ADC inputs not in the
+ *     table read mid-scale.
+ *
+ * Replay files are either raw little-endian uint16 frames or CSV with one
+ * frame per line (".csv" extension); lines that do not start with a digit
+ * are skipped, so a header row is fine.
+ *
+ * Usage Example:
+ *   SimWave_Synth_t synth;
+ *   simWave_synthDefaults(&synth);
+ *   synth.input[0].amplitude = 1500.0f;
+ *   simHal_setSource(simWave_synth, &synth);
+ *
+ *   SimWave_Replay_t replay;
+ *   if (simWave_replayLoad(&replay, "capture.csv", 4000.0) == 0)
+ *     simHal_setSource(simWave_replay, &replay);
+ *
+ ******************************************************************************
+ */
+
+#ifndef SIM_WAVE_H
+#define SIM_WAVE_H
+
+#include "sim_hal.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported types ------------------------------------------------------------*/
+
+/**
+ * @brief Synthetic signal of one ADC input
+ */
+typedef struct {
+  float offset;    ///< Codes
+  float amplitude; ///< Codes, peak
+  float freq_hz;
+  float phase_rad;
+  float noise;     ///< Codes, peak of the uniform noise
+} SimWave_Input_t;
+
+typedef struct {
+  SimWave_Input_t input[SIM_HAL_ADC_INPUTS];
+  uint32_t seed; ///< xorshift32 state, non-zero
+} SimWave_Synth_t;
+
+typedef struct {
+  uint16_t *frames;   ///< frame_count * channels values
+  uint32_t frame_count;
+  uint32_t channels;  ///< ADC_CHANNELS_COUNT
+  double rate_hz;     ///< Playback frame rate
+} SimWave_Replay_t;
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+ * @brief Mid-scale sine on every input: 600 codes peak, 50 + 17 * channel Hz,
+ *        4 codes of noise
+ */
+void simWave_synthDefaults(SimWave_Synth_t *synth);
+
+/**
+ * @brief SimHal_Source_t, ctx = SimWave_Synth_t
+ */
+uint16_t simWave_synth(uint32_t adc_channel, double t_us, void *ctx);
+
+/**
+ * @brief Load a recording
+ *
+ * @return 0 on success, -1 if the file cannot be read or holds no frame
+ */
+int simWave_replayLoad(SimWave_Replay_t *replay, const char *path,
+                       double rate_hz);
+
+/**
+ * @brief Release the frames of simWave_replayLoad()
+ */
+void simWave_replayFree(SimWave_Replay_t *replay);
+
+/**
+ * @brief SimHal_Source_t, ctx = SimWave_Replay_t
+ */
+uint16_t simWave_replay(uint32_t adc_channel, double t_us, void *ctx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SIM_WAVE_H */
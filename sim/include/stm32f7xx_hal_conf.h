@@ -0,0 +1,75 @@
+/**
+ ******************************************************************************
+ * @file    stm32f7xx_hal_conf.h
+ * @brief   Simulation build: firmware HAL configuration + RAM peripherals
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * Found before Core/Inc/stm32f7xx_hal_conf.h on the host include path. Pulls
+ * in the firmware configuration unchanged (same modules, same HAL headers),
+ * then points the peripheral instances the simulated sources use at RAM
+ * owned by sim_hal.c. ADC and TIM accesses go through accessor functions,
+ * so the mock can run its conversion model and clock on every register
+ * read, exactly where the hardware would have moved on.
+ *
+ ******************************************************************************
+ */
+
+#ifndef SIM_STM32F7XX_HAL_CONF_H
+#define SIM_STM32F7XX_HAL_CONF_H
+
+#include_next "stm32f7xx_hal_conf.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief ADC1..3 registers (index 0..2), after the conversion model ran
+ */
+ADC_TypeDef *simHal_adc(uint32_t index);
+
+/**
+ * @brief Common ADC registers
+ */
+ADC_Common_TypeDef *simHal_adcCommon(void);
+
+/**
+ * @brief TIM2 / TIM5 registers, CNT brought up to the simulated time
+ */
+TIM_TypeDef *simHal_tim(uint32_t index);
+
+extern RCC_TypeDef simHal_rcc;
+extern DMA_Stream_TypeDef simHal_dmaStream;
+extern DMA_TypeDef simHal_dmaFlags;
+
+#undef ADC1
+#undef ADC2
+#undef ADC3
+#undef ADC
+#undef ADC123_COMMON
+#undef TIM2
+#undef TIM5
+#undef RCC
+#undef DMA2_Stream0
+#undef DMA1
+#undef DMA2
+#define ADC1 (simHal_adc(0U))
+#define ADC2 (simHal_adc(1U))
+#define ADC3 (simHal_adc(2U))
+#define ADC (simHal_adcCommon())
+#define ADC123_COMMON (simHal_adcCommon())
+#define TIM2 (simHal_tim(2U))
+#define TIM5 (simHal_tim(5U))
+#define RCC (&simHal_rcc)
+#define DMA2_Stream0 (&simHal_dmaStream)
+#define DMA1 (&simHal_dmaFlags)
+#define DMA2 (&simHal_dmaFlags)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SIM_STM32F7XX_HAL_CONF_H */
@@ -0,0 +1,47 @@
+/**
+ ******************************************************************************
+ * @file    sim_bitreversal.c
+ * @brief   C versions of arm_bitreversal_32 and _16 for the host build
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ * @attention
+ *
+ * CMSIS-DSP ships the CFFT bit reversal only as arm_bitreversal2.S (Thumb
+ * assembly). Same table walk in C: each table pair holds the byte offsets
+ * of two complex values to swap (>> 2 gives the word index). The q15
+ * tables use the same offsets; a q15 complex value is one word, at half
+ * the byte offset, so >> 2 gives its first halfword.
+ *
+ ******************************************************************************
+ */
+
+#include <stdint.h>
+
+void arm_bitreversal_32(uint32_t *pSrc, const uint16_t bitRevLen,
+                        const uint16_t *pBitRevTab) {
+  for (uint32_t i = 0; i < bitRevLen; i += 2U) {
+    uint32_t a = pBitRevTab[i] >> 2;
+    uint32_t b = pBitRevTab[i + 1U] >> 2;
+    uint32_t tmp = pSrc[a];
+    pSrc[a] = pSrc[b];
+    pSrc[b] = tmp;
+    tmp = pSrc[a + 1U];
+    pSrc[a + 1U] = pSrc[b + 1U];
+    pSrc[b + 1U] = tmp;
+  }
+}
+
+void arm_bitreversal_16(uint16_t *pSrc, const uint16_t bitRevLen,
+                        const uint16_t *pBitRevTab) {
+  for (uint32_t i = 0; i < bitRevLen; i += 2U) {
+    uint32_t a = pBitRevTab[i] >> 2;
+    uint32_t b = pBitRevTab[i + 1U] >> 2;
+    uint16_t tmp = pSrc[a];
+    pSrc[a] = pSrc[b];
+    pSrc[b] = tmp;
+    tmp = pSrc[a + 1U];
+    pSrc[a + 1U] = pSrc[b + 1U];
+    pSrc[b + 1U] = tmp;
+  }
+}
@@ -0,0 +1,49 @@
+/**
+ ******************************************************************************
+ * @file    sim_core.c
+ * @brief   Cortex-M7 core registers and intrinsics state for the host build
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "stm32f7xx.h"
+#include <time.h>
+
+/* Private variables ---------------------------------------------------------*/
+volatile uint32_t simCore_primask = 0;
+uint32_t simCore_ge = 0;
+uint32_t simCore_exclusive = 0;
+SCB_Type simCore_scb;
+FPU_Type simCore_fpu;
+CoreDebug_Type simCore_coreDebug;
+
+static DWT_Type dwt_regs;
+static uint32_t cyccnt_written = 0; // CYCCNT as left by the last access
+static uint32_t cyccnt_host = 0;    // host cycles at the last access
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+ * @brief Host monotonic time in target cycles at SystemCoreClock
+ */
+static uint32_t simCore_hostCycles(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  uint64_t ns = (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+  return (uint32_t)(ns * (SystemCoreClock / 1000000U) / 1000U);
+}
+
+/* Public functions ----------------------------------------------------------*/
+
+DWT_Type *simCore_dwt(void) {
+  uint32_t host = simCore_hostCycles();
+  // A firmware store since the last access wins; otherwise count host time
+  if (dwt_regs.CYCCNT == cyccnt_written &&
+      (dwt_regs.CTRL & DWT_CTRL_CYCCNTENA_Msk)) {
+    dwt_regs.CYCCNT += host - cyccnt_host;
+  }
+  cyccnt_written = dwt_regs.CYCCNT;
+  cyccnt_host = host;
+  return &dwt_regs;
+}
@@ -0,0 +1,1043 @@
+/**
+ ******************************************************************************
+ * @file    sim_hal.c
+ * @brief   Mock ADC/DMA/TIM HAL and register model for the host build
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "sim_hal.h"
+#include "adc.h"
+#include "dma.h"
+#include "tim.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define SIM_HAL_ADC_COUNT 3U
+#define SIM_HAL_CONVERSION_CYCLES 12U
+#define SIM_HAL_MIDSCALE 2048U
+#define SIM_HAL_MAX_CODE 4095U
+#define SIM_HAL_TICK_STEP_US 1.0
+
+/* Private types -------------------------------------------------------------*/
+typedef struct {
+  uint32_t *buffer;       // as given to HAL_ADC_Start_DMA()
+  uint32_t length;        // transfers
+  uint8_t word;           // 32-bit transfers (capture, DMA mode 2)
+  uint8_t circular;
+  uint8_t running;
+  uint8_t next_half;      // 0 = first half (M0 target) completes next
+  uint8_t double_buffer;  // HAL_DMAEx_MultiBufferStart_IT(): one block per target
+  uint32_t target[2];     // M0AR / M1AR; -no-pie keeps them below 4 GB
+  uint32_t slot;          // scan slot the next transfer holds
+  ADC_HandleTypeDef *hadc;
+} SimHal_Dma_t;
+
+typedef struct {
+  uint32_t remaining;
+  uint32_t arg;
+} SimHal_FaultSlot_t;
+
+/* Private variables ---------------------------------------------------------*/
+uint32_t SystemCoreClock = SIM_HAL_HCLK_HZ;
+RCC_TypeDef simHal_rcc;
+DMA_Stream_TypeDef simHal_dmaStream;
+DMA_TypeDef simHal_dmaFlags; // both controllers' flag registers, write-only
+
+static ADC_TypeDef adc_regs[SIM_HAL_ADC_COUNT];
+static ADC_Common_TypeDef adc_common;
+static TIM_TypeDef tim2_regs;
+static TIM_TypeDef tim5_regs;
+
+static double now_us = 0.0;
+static SimHal_Dma_t dma = {0};
+static SimHal_FaultSlot_t faults[SIM_FAULT_COUNT];
+static SimHal_Stats_t stats = {0};
+static SimHal_Source_t source = NULL;
+static void *source_ctx = NULL;
+static uint8_t injected_armed[SIM_HAL_ADC_COUNT];
+static uint8_t injected_pending[SIM_HAL_ADC_COUNT];
+static uint8_t in_irq = 0;
+
+static const uint16_t sample_cycles[8] = {3, 15, 28, 56, 84, 112, 144, 480};
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+ * @brief Consume one occurrence of a fault, if armed
+ */
+static uint8_t simHal_takeFault(SimHal_Fault_t fault) {
+  if (faults[fault].remaining == 0U) {
+    return 0;
+  }
+  faults[fault].remaining--;
+  stats.faults[fault]++;
+  return 1;
+}
+
+static uint32_t simHal_indexOf(const ADC_TypeDef *regs) {
+  for (uint32_t k = 0; k < SIM_HAL_ADC_COUNT; k++) {
+    if (regs == &adc_regs[k]) {
+      return k;
+    }
+  }
+  return 0;
+}
+
+static ADC_HandleTypeDef *simHal_handleOf(uint32_t k) {
+  ADC_HandleTypeDef *const handles[SIM_HAL_ADC_COUNT] = {&hadc1, &hadc2,
+                                                          &hadc3};
+  return handles[k];
+}
+
+static uint8_t simHal_isMultimode(void) {
+  return (adc_common.CCR & ADC_CCR_MULTI) != 0U;
+}
+
+static uint32_t simHal_adcCount(void) {
+  uint32_t multi = adc_common.CCR & ADC_CCR_MULTI;
+  if (multi == 0U) {
+    return 1U;
+  }
+  return (multi & ADC_CCR_MULTI_4) ? 3U : 2U;
+}
+
+static uint32_t simHal_adcClockHz(void) {
+  uint32_t pre = (adc_common.CCR & ADC_CCR_ADCPRE) >> ADC_CCR_ADCPRE_Pos;
+  return SIM_HAL_PCLK2_HZ / ((pre + 1U) * 2U);
+}
+
+static uint32_t simHal_timerClockHz(void) {
+  uint32_t clk = SIM_HAL_PCLK1_HZ;
+  if ((simHal_rcc.CFGR & RCC_CFGR_PPRE1) != RCC_HCLK_DIV1) {
+    clk *= 2U;
+  }
+  return clk;
+}
+
+/**
+ * @brief Channel converted at a regular rank (1-based), from SQR1..3
+ */
+static uint32_t simHal_rankChannel(const ADC_TypeDef *r, uint32_t rank) {
+  if (rank <= 6U) {
+    return (r->SQR3 >> (5U * (rank - 1U))) & 0x1FU;
+  }
+  if (rank <= 12U) {
+    return (r->SQR2 >> (5U * (rank - 7U))) & 0x1FU;
+  }
+  return (r->SQR1 >> (5U * (rank - 13U))) & 0x1FU;
+}
+
+static uint32_t simHal_sampleCycles(const ADC_TypeDef *r, uint32_t channel) {
+  uint32_t smp = (channel >= 10U) ? (r->SMPR1 >> (3U * (channel - 10U)))
+                                  : (r->SMPR2 >> (3U * channel));
+  return sample_cycles[smp & 0x7U];
+}
+
+static uint32_t simHal_ranks(const ADC_TypeDef *r) {
+  return ((r->SQR1 & ADC_SQR1_L) >> ADC_SQR1_L_Pos) + 1U;
+}
+
+/**
+ * @brief Injected rank 1 channel (with JL = n - 1 it sits in JSQ(4 - n + 1))
+ */
+static uint32_t simHal_injectedChannel(const ADC_TypeDef *r) {
+  uint32_t jl = (r->JSQR & ADC_JSQR_JL) >> ADC_JSQR_JL_Pos;
+  return (r->JSQR >> (5U * (3U - jl))) & 0x1FU;
+}
+
+/**
+ * @brief One conversion result, faults applied
+ */
+static uint16_t simHal_sample(uint32_t channel, double t_us) {
+  uint16_t v = (source != NULL) ? source(channel, t_us, source_ctx)
+                                : SIM_HAL_MIDSCALE;
+  if (v > SIM_HAL_MAX_CODE) {
+    v = SIM_HAL_MAX_CODE;
+  }
+  if (faults[SIM_FAULT_RAIL_HIGH].remaining != 0U &&
+      faults[SIM_FAULT_RAIL_HIGH].arg == channel &&
+      simHal_takeFault(SIM_FAULT_RAIL_HIGH)) {
+    v = SIM_HAL_MAX_CODE;
+  }
+  if (faults[SIM_FAULT_RAIL_LOW].remaining != 0U &&
+      faults[SIM_FAULT_RAIL_LOW].arg == channel &&
+      simHal_takeFault(SIM_FAULT_RAIL_LOW)) {
+    v = 0U;
+  }
+  return v;
+}
+
+/**
+ * @brief A 12-bit result as ADC k converts it at its CR1 resolution
+ */
+static uint16_t simHal_quantize(uint32_t k, uint16_t v) {
+  // RES 0..3 = 12, 10, 8, 6 bits: two bits fewer per step
+  const uint32_t res = (adc_regs[k].CR1 & ADC_CR1_RES) >> ADC_CR1_RES_Pos;
+  return (uint16_t)(v >> (2U * res));
+}
+
+/**
+ * @brief Analog watchdog of ADC k on one regular sample
+ */
+static void simHal_watchdog(uint32_t k, uint32_t channel, uint16_t v) {
+  ADC_TypeDef *r = &adc_regs[k];
+  if (!(r->CR1 & ADC_CR1_AWDEN)) {
+    return;
+  }
+  if ((r->CR1 & ADC_CR1_AWDSGL) && (r->CR1 & ADC_CR1_AWDCH) != channel) {
+    return;
+  }
+  if (v <= r->HTR && v >= r->LTR) {
+    return;
+  }
+  r->SR |= ADC_SR_AWD;
+  if ((r->CR1 & ADC_CR1_AWDIE) && !in_irq) {
+    in_irq = 1;
+    stats.watchdog_alarms++;
+    HAL_ADC_LevelOutOfWindowCallback(simHal_handleOf(k));
+    in_irq = 0;
+  }
+}
+
+/**
+ * @brief Finish the software-started conversions of ADC k
+ */
+static void simHal_convert(uint32_t k) {
+  ADC_TypeDef *r = &adc_regs[k];
+
+  if (!(r->CR2 & ADC_CR2_ADON)) {
+    return;
+  }
+  if (r->CR2 & ADC_CR2_SWSTART) {
+    r->CR2 &= ~ADC_CR2_SWSTART;
+    if (!(dma.running && dma.hadc == simHal_handleOf(k)) &&
+        !simHal_takeFault(SIM_FAULT_TIMEOUT)) {
+      r->DR = simHal_quantize(k, simHal_sample(simHal_rankChannel(r, 1U),
+                                               now_us));
+      r->SR |= ADC_SR_EOC | ADC_SR_STRT;
+      stats.conversions++;
+    }
+  }
+  if (r->CR2 & ADC_CR2_JSWSTART) {
+    r->CR2 &= ~ADC_CR2_JSWSTART;
+    // Injected simultaneous: the master's JSWSTART converts every armed ADC
+    uint32_t first = k;
+    uint32_t last = k;
+    if (k == 0U && simHal_isMultimode()) {
+      last = simHal_adcCount() - 1U;
+    }
+    for (uint32_t j = first; j <= last; j++) {
+      ADC_TypeDef *rj = &adc_regs[j];
+      if (!(rj->CR2 & ADC_CR2_ADON) || (j != k && !injected_armed[j])) {
+        continue;
+      }
+      if (simHal_takeFault(SIM_FAULT_TIMEOUT)) {
+        continue;
+      }
+      rj->JDR1 =
+          simHal_quantize(j, simHal_sample(simHal_injectedChannel(rj), now_us));
+      rj->SR |= ADC_SR_JEOC | ADC_SR_JSTRT;
+      injected_pending[j] = 1;
+      stats.conversions++;
+    }
+  }
+}
+
+/**
+ * @brief Deliver pending ADC interrupts (EOC, JEOC), as the ADC IRQ would
+ */
+static void simHal_serviceIrq(void) {
+  for (uint32_t k = 0; k < SIM_HAL_ADC_COUNT; k++) {
+    simHal_convert(k);
+  }
+  if (simCore_primask || in_irq) {
+    return;
+  }
+  for (uint32_t k = 0; k < SIM_HAL_ADC_COUNT; k++) {
+    ADC_TypeDef *r = &adc_regs[k];
+    if ((r->SR & ADC_SR_EOC) && (r->CR1 & ADC_CR1_EOCIE)) {
+      // Single regular conversion: the HAL handler drops EOCIE first
+      r->CR1 &= ~ADC_CR1_EOCIE;
+      in_irq = 1;
+      HAL_ADC_ConvCpltCallback(simHal_handleOf(k));
+      in_irq = 0;
+      CLEAR_BIT(r->SR, ADC_SR_STRT | ADC_SR_EOC);
+    }
+    if (!injected_pending[k] || !(r->CR1 & ADC_CR1_JEOCIE)) {
+      continue;
+    }
+    injected_pending[k] = 0;
+    injected_armed[k] = 0;
+    // Single injected conversion: the HAL handler drops JEOCIE first
+    r->CR1 &= ~ADC_CR1_JEOCIE;
+    in_irq = 1;
+    HAL_ADCEx_InjectedConvCpltCallback(simHal_handleOf(k));
+    in_irq = 0;
+  }
+}
+
+/**
+ * @brief Fill one half (scan) or the whole buffer (capture)
+ *
+ * @return Transfers written
+ */
+static uint32_t simHal_fillScan(uint16_t *dst, uint32_t count, double rate) {
+  uint32_t adcs = simHal_adcCount();
+  uint32_t ranks = simHal_ranks(&adc_regs[0]);
+  uint32_t slots = adcs * ranks;
+
+  // A half may end inside a scan (discontinuous groups): the next one
+  // carries on from that slot, in the same frame
+  uint32_t first = dma.slot % slots;
+  for (uint32_t i = 0; i < count; i++) {
+    uint32_t slot = (first + i) % slots;
+    uint32_t k = slot % adcs;
+    uint32_t channel = simHal_rankChannel(&adc_regs[k], slot / adcs + 1U);
+    double t = now_us + (double)((first + i) / slots) * 1e6 / rate;
+    dst[i] = simHal_quantize(k, simHal_sample(channel, t));
+    simHal_watchdog(k, channel, dst[i]);
+  }
+  dma.slot = (first + count) % slots;
+  now_us += (double)((first + count) / slots) * 1e6 / rate;
+  return count;
+}
+
+static void simHal_fillCapture(void) {
+  uint16_t *dst = (uint16_t *)dma.buffer;
+  uint32_t samples = dma.length * 2U;
+  uint32_t channel = simHal_rankChannel(&adc_regs[0], 1U);
+  uint32_t delay = ((adc_common.CCR & ADC_CCR_DELAY) >> ADC_CCR_DELAY_Pos) + 5U;
+  double step_us = 1e6 * delay / simHal_adcClockHz();
+
+  for (uint32_t i = 0; i < samples; i++) {
+    dst[i] = simHal_sample(channel, now_us + i * step_us);
+  }
+  now_us += samples * step_us;
+  stats.dma_samples += samples;
+}
+
+/* Public functions: simulation control --------------------------------------*/
+
+ADC_TypeDef *simHal_adc(uint32_t index) {
+  simHal_convert(index);
+  return &adc_regs[index];
+}
+
+ADC_Common_TypeDef *simHal_adcCommon(void) { return &adc_common; }
+
+TIM_TypeDef *simHal_tim(uint32_t index) {
+  if (index != 5U) {
+    return &tim2_regs;
+  }
+  if (tim5_regs.CR1 & TIM_CR1_CEN) {
+    double tick_hz = (double)simHal_timerClockHz() / (tim5_regs.PSC + 1U);
+    tim5_regs.CNT = (uint32_t)(uint64_t)(now_us * 1e-6 * tick_hz);
+  }
+  return &tim5_regs;
+}
+
+void simHal_init(void) {
+  memset(adc_regs, 0, sizeof(adc_regs));
+  memset(&adc_common, 0, sizeof(adc_common));
+  memset(&tim2_regs, 0, sizeof(tim2_regs));
+  memset(&tim5_regs, 0, sizeof(tim5_regs));
+  memset(&simHal_rcc, 0, sizeof(simHal_rcc));
+  memset(&simHal_dmaStream, 0, sizeof(simHal_dmaStream));
+  memset(&simHal_dmaFlags, 0, sizeof(simHal_dmaFlags));
+  memset(&dma, 0, sizeof(dma));
+  memset(faults, 0, sizeof(faults));
+  memset(&stats, 0, sizeof(stats));
+  memset(injected_armed, 0, sizeof(injected_armed));
+  memset(injected_pending, 0, sizeof(injected_pending));
+  memset(&hadc1, 0, sizeof(hadc1));
+  memset(&hadc2, 0, sizeof(hadc2));
+  memset(&hadc3, 0, sizeof(hadc3));
+  memset(&htim2, 0, sizeof(htim2));
+  for (uint32_t k = 0; k < SIM_HAL_ADC_COUNT; k++) {
+    adc_regs[k].HTR = SIM_HAL_MAX_CODE;
+  }
+  now_us = 0.0;
+  in_irq = 0;
+  simCore_primask = 0;
+  SystemCoreClock = SIM_HAL_HCLK_HZ;
+  simHal_rcc.CFGR = RCC_HCLK_DIV2 | (RCC_HCLK_DIV1 << 3);
+
+  MX_DMA_Init();
+  MX_ADC1_Init();
+  MX_ADC2_Init();
+  MX_ADC3_Init();
+  MX_TIM2_Init();
+}
+
+void simHal_setSource(SimHal_Source_t fn, void *ctx) {
+  source = NULL;
+  source_ctx = ctx;
+  source = fn;
+}
+
+uint32_t simHal_runBlocks(uint32_t halves) {
+  uint32_t done = 0;
+
+  while (done < halves && dma.running) {
+    ADC_HandleTypeDef *hadc = dma.hadc;
+
+    if (dma.word) {
+      // Normal-mode capture: the one pass ends with half and full transfer
+      simHal_fillCapture();
+      dma.running = 0;
+      stats.dma_blocks++;
+      in_irq = 1;
+      HAL_ADC_ConvHalfCpltCallback(hadc);
+      HAL_ADC_ConvCpltCallback(hadc);
+      in_irq = 0;
+      stats.callbacks++;
+      done++;
+      break;
+    }
+
+    double rate = simHal_getFrameRate();
+    if (rate <= 0.0) {
+      break;
+    }
+    uint32_t half = dma.length / 2U;
+    uint16_t *dst = (uint16_t *)dma.buffer + (dma.next_half ? half : 0U);
+    if (dma.double_buffer) {
+      half = dma.length;
+      dst = (uint16_t *)(uintptr_t)dma.target[dma.next_half];
+    }
+    stats.dma_samples += simHal_fillScan(dst, half, rate);
+    stats.dma_blocks++;
+
+    // Overrun right after the block: its completion is still pending and
+    // the stream stands at the start of the next block
+    uint8_t taken = 0;
+    if (simHal_takeFault(SIM_FAULT_OVERRUN)) {
+      simHal_dmaStream.CR = DMA_SxCR_EN;
+      if (dma.double_buffer) {
+        simHal_dmaStream.NDTR = dma.length;
+        simHal_dmaStream.CR |= dma.next_half ? 0U : DMA_SxCR_CT;
+      } else {
+        simHal_dmaStream.NDTR = dma.next_half ? dma.length : dma.length / 2U;
+      }
+      simHal_dmaFlags.LIFCR = 0;
+      simHal_dmaFlags.HIFCR = 0;
+      hadc->Instance->SR |= ADC_SR_OVR;
+      hadc->ErrorCode |= HAL_ADC_ERROR_OVR;
+      in_irq = 1;
+      HAL_ADC_ErrorCallback(hadc);
+      in_irq = 0;
+      // Flags cleared: the driver restarted the stream and handed it off
+      taken = (simHal_dmaFlags.LIFCR | simHal_dmaFlags.HIFCR) != 0U;
+    }
+    if (taken) {
+      stats.callbacks++;
+    } else if (!simHal_takeFault(SIM_FAULT_MISSED_IRQ)) {
+      in_irq = 1;
+      if (dma.double_buffer) {
+        DMA_HandleTypeDef *hdma = hadc->DMA_Handle;
+        void (*done)(DMA_HandleTypeDef *) =
+            dma.next_half ? hdma->XferM1CpltCallback : hdma->XferCpltCallback;
+        if (done != NULL) {
+          done(hdma);
+        }
+      } else if (dma.next_half) {
+        HAL_ADC_ConvCpltCallback(hadc);
+      } else {
+        HAL_ADC_ConvHalfCpltCallback(hadc);
+      }
+      in_irq = 0;
+      stats.callbacks++;
+    }
+    dma.next_half ^= 1U;
+    if (!dma.next_half && !dma.circular) {
+      dma.running = 0;
+    }
+    simHal_serviceIrq();
+    done++;
+  }
+  return done;
+}
+
+void simHal_injectFault(SimHal_Fault_t fault, uint32_t count, uint32_t arg) {
+  if (fault >= SIM_FAULT_COUNT) {
+    return;
+  }
+  faults[fault].remaining = count;
+  faults[fault].arg = arg;
+}
+
+void simHal_advanceUs(uint64_t us) { now_us += (double)us; }
+
+uint64_t simHal_getTimeUs(void) { return (uint64_t)now_us; }
+
+double simHal_getFrameRate(void) {
+  const ADC_TypeDef *r = &adc_regs[0];
+
+  if (!dma.running || dma.word) {
+    return 0.0;
+  }
+  if (r->CR2 & ADC_CR2_EXTEN) {
+    // External trigger: one scan per TIM2 update, or one group of DISCNUM
+    // ranks in discontinuous mode
+    if (!(tim2_regs.CR1 & TIM_CR1_CEN)) {
+      return 0.0;
+    }
+    double groups = 1.0;
+    if (r->CR1 & ADC_CR1_DISCEN) {
+      uint32_t size = ((r->CR1 & ADC_CR1_DISCNUM) >> ADC_CR1_DISCNUM_Pos) + 1U;
+      groups = (double)simHal_ranks(r) / size;
+    }
+    return (double)simHal_timerClockHz() /
+           ((double)(tim2_regs.PSC + 1U) * (tim2_regs.ARR + 1U) * groups);
+  }
+  // Continuous: back-to-back scans of the master's sequence
+  uint32_t cycles = 0;
+  for (uint32_t rank = 1; rank <= simHal_ranks(r); rank++) {
+    cycles += simHal_sampleCycles(r, simHal_rankChannel(r, rank)) +
+              SIM_HAL_CONVERSION_CYCLES;
+  }
+  return (double)simHal_adcClockHz() / cycles;
+}
+
+void simHal_getStats(SimHal_Stats_t *out) {
+  if (out != NULL) {
+    *out = stats;
+  }
+}
+
+/* Mocked HAL: system --------------------------------------------------------*/
+
+uint32_t HAL_GetTick(void) {
+  now_us += SIM_HAL_TICK_STEP_US;
+  simHal_serviceIrq();
+  return (uint32_t)(uint64_t)(now_us / 1000.0);
+}
+
+void HAL_Delay(uint32_t delay) {
+  now_us += delay * 1000.0;
+  simHal_serviceIrq();
+}
+
+uint32_t HAL_RCC_GetHCLKFreq(void) { return SIM_HAL_HCLK_HZ; }
+uint32_t HAL_RCC_GetSysClockFreq(void) { return SIM_HAL_HCLK_HZ; }
+uint32_t HAL_RCC_GetPCLK1Freq(void) { return SIM_HAL_PCLK1_HZ; }
+uint32_t HAL_RCC_GetPCLK2Freq(void) { return SIM_HAL_PCLK2_HZ; }
+
+void HAL_NVIC_SetPriority(IRQn_Type irq, uint32_t pre, uint32_t sub) {
+  (void)irq;
+  (void)pre;
+  (void)sub;
+}
+void HAL_NVIC_EnableIRQ(IRQn_Type irq) { (void)irq; }
+void HAL_NVIC_DisableIRQ(IRQn_Type irq) { (void)irq; }
+
+void HAL_GPIO_Init(GPIO_TypeDef *port, GPIO_InitTypeDef *init) {
+  (void)port;
+  (void)init;
+}
+void HAL_GPIO_DeInit(GPIO_TypeDef *port, uint32_t pin) {
+  (void)port;
+  (void)pin;
+}
+
+HAL_StatusTypeDef HAL_DMA_Init(DMA_HandleTypeDef *hdma) {
+  if (hdma == NULL) {
+    return HAL_ERROR;
+  }
+  hdma->State = HAL_DMA_STATE_READY;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_DMA_Abort(DMA_HandleTypeDef *hdma) {
+  if (hdma == NULL) {
+    return HAL_ERROR;
+  }
+  if (dma.hadc != NULL && dma.hadc->DMA_Handle == hdma) {
+    dma.running = 0;
+    dma.double_buffer = 0;
+  }
+  hdma->State = HAL_DMA_STATE_READY;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_DMAEx_MultiBufferStart_IT(DMA_HandleTypeDef *hdma,
+                                                uint32_t SrcAddress,
+                                                uint32_t DstAddress,
+                                                uint32_t SecondMemAddress,
+                                                uint32_t DataLength) {
+  (void)SrcAddress;
+  if (hdma == NULL || dma.hadc == NULL || dma.hadc->DMA_Handle != hdma ||
+      hdma->XferCpltCallback == NULL || hdma->XferM1CpltCallback == NULL) {
+    return HAL_ERROR;
+  }
+  dma.target[0] = DstAddress;
+  dma.target[1] = SecondMemAddress;
+  dma.length = DataLength;
+  dma.double_buffer = 1;
+  dma.circular = 1;
+  dma.next_half = 0;
+  dma.slot = 0;
+  dma.running = 1;
+  hdma->State = HAL_DMA_STATE_BUSY;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_DMAEx_ChangeMemory(DMA_HandleTypeDef *hdma,
+                                         uint32_t Address,
+                                         HAL_DMA_MemoryTypeDef memory) {
+  (void)hdma;
+  dma.target[(memory == MEMORY1) ? 1U : 0U] = Address;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_DMA_DeInit(DMA_HandleTypeDef *hdma) {
+  if (hdma == NULL) {
+    return HAL_ERROR;
+  }
+  hdma->State = HAL_DMA_STATE_RESET;
+  return HAL_OK;
+}
+
+void Error_Handler(void) {
+  fprintf(stderr, "sim: Error_Handler() called\n");
+  abort();
+}
+
+/* Mocked HAL: ADC -----------------------------------------------------------*/
+
+HAL_StatusTypeDef HAL_ADC_Init(ADC_HandleTypeDef *hadc) {
+  if (hadc == NULL) {
+    return HAL_ERROR;
+  }
+  if (hadc->State == HAL_ADC_STATE_RESET) {
+    HAL_ADC_MspInit(hadc);
+  }
+
+  ADC_TypeDef *r = hadc->Instance;
+  ADC_InitTypeDef *init = &hadc->Init;
+  MODIFY_REG(adc_common.CCR, ADC_CCR_ADCPRE, init->ClockPrescaler);
+  MODIFY_REG(r->CR1, ADC_CR1_SCAN | ADC_CR1_RES,
+             ADC_CR1_SCANCONV(init->ScanConvMode) | init->Resolution);
+  if (init->DiscontinuousConvMode != DISABLE) {
+    MODIFY_REG(r->CR1, ADC_CR1_DISCEN | ADC_CR1_DISCNUM,
+               ADC_CR1_DISCEN |
+                   ADC_CR1_DISCONTINUOUS(init->NbrOfDiscConversion));
+  } else {
+    CLEAR_BIT(r->CR1, ADC_CR1_DISCEN | ADC_CR1_DISCNUM);
+  }
+  MODIFY_REG(r->CR2, ADC_CR2_ALIGN, init->DataAlign);
+  if (init->ExternalTrigConv != ADC_SOFTWARE_START) {
+    MODIFY_REG(r->CR2, ADC_CR2_EXTSEL | ADC_CR2_EXTEN,
+               init->ExternalTrigConv | init->ExternalTrigConvEdge);
+  } else {
+    CLEAR_BIT(r->CR2, ADC_CR2_EXTSEL | ADC_CR2_EXTEN);
+  }
+  MODIFY_REG(r->CR2, ADC_CR2_CONT,
+             ADC_CR2_CONTINUOUS((uint32_t)init->ContinuousConvMode));
+  MODIFY_REG(r->SQR1, ADC_SQR1_L, ADC_SQR1(init->NbrOfConversion));
+  MODIFY_REG(r->CR2, ADC_CR2_DDS,
+             ADC_CR2_DMAContReq((uint32_t)init->DMAContinuousRequests));
+  MODIFY_REG(r->CR2, ADC_CR2_EOCS, ADC_CR2_EOCSelection(init->EOCSelection));
+
+  hadc->ErrorCode = HAL_ADC_ERROR_NONE;
+  hadc->State = HAL_ADC_STATE_READY;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_ADC_ConfigChannel(ADC_HandleTypeDef *hadc,
+                                        ADC_ChannelConfTypeDef *config) {
+  if (simHal_takeFault(SIM_FAULT_CONFIG)) {
+    return HAL_ERROR;
+  }
+  ADC_TypeDef *r = hadc->Instance;
+  uint32_t ch = (uint16_t)config->Channel;
+
+  if (ch > 9U) {
+    MODIFY_REG(r->SMPR1, ADC_SMPR1(ADC_SMPR1_SMP10, ch),
+               ADC_SMPR1(config->SamplingTime, ch));
+  } else {
+    MODIFY_REG(r->SMPR2, ADC_SMPR2(ADC_SMPR2_SMP0, ch),
+               ADC_SMPR2(config->SamplingTime, ch));
+  }
+  if (config->Rank < 7U) {
+    MODIFY_REG(r->SQR3, ADC_SQR3_RK(ADC_SQR3_SQ1, config->Rank),
+               ADC_SQR3_RK(ch, config->Rank));
+  } else if (config->Rank < 13U) {
+    MODIFY_REG(r->SQR2, ADC_SQR2_RK(ADC_SQR2_SQ7, config->Rank),
+               ADC_SQR2_RK(ch, config->Rank));
+  } else {
+    MODIFY_REG(r->SQR1, ADC_SQR1_RK(ADC_SQR1_SQ13, config->Rank),
+               ADC_SQR1_RK(ch, config->Rank));
+  }
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_ADC_AnalogWDGConfig(ADC_HandleTypeDef *hadc,
+                                          ADC_AnalogWDGConfTypeDef *config) {
+  ADC_TypeDef *r = hadc->Instance;
+
+  if (config->ITMode == ENABLE) {
+    SET_BIT(r->CR1, ADC_CR1_AWDIE);
+  } else {
+    CLEAR_BIT(r->CR1, ADC_CR1_AWDIE);
+  }
+  MODIFY_REG(r->CR1, ADC_CR1_AWDSGL | ADC_CR1_JAWDEN | ADC_CR1_AWDEN,
+             config->WatchdogMode);
+  r->HTR = config->HighThreshold;
+  r->LTR = config->LowThreshold;
+  MODIFY_REG(r->CR1, ADC_CR1_AWDCH, (uint16_t)config->Channel);
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_ADC_Start(ADC_HandleTypeDef *hadc) {
+  if (simHal_takeFault(SIM_FAULT_START)) {
+    return HAL_ERROR;
+  }
+  ADC_TypeDef *r = hadc->Instance;
+  SET_BIT(r->CR2, ADC_CR2_ADON);
+  CLEAR_BIT(r->SR, ADC_SR_EOC | ADC_SR_OVR);
+  hadc->State = HAL_ADC_STATE_REG_BUSY;
+  // In multimode only the master starts; slaves follow it
+  if ((!simHal_isMultimode() || r == &adc_regs[0]) &&
+      !(r->CR2 & ADC_CR2_EXTEN)) {
+    SET_BIT(r->CR2, ADC_CR2_SWSTART);
+    // ADC2/3 are polled through their handle's Instance, not the macros
+    if (r != &adc_regs[0]) {
+      simHal_convert(simHal_indexOf(r));
+    }
+  }
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_ADC_Start_IT(ADC_HandleTypeDef *hadc) {
+  HAL_StatusTypeDef status = HAL_ADC_Start(hadc);
+  if (status == HAL_OK) {
+    SET_BIT(hadc->Instance->CR1, ADC_CR1_EOCIE | ADC_CR1_OVRIE);
+  }
+  return status;
+}
+
+HAL_StatusTypeDef HAL_ADC_Stop(ADC_HandleTypeDef *hadc) {
+  CLEAR_BIT(hadc->Instance->CR2, ADC_CR2_ADON);
+  hadc->State = HAL_ADC_STATE_READY;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_ADC_PollForConversion(ADC_HandleTypeDef *hadc,
+                                            uint32_t timeout) {
+  uint32_t k = simHal_indexOf(hadc->Instance);
+  simHal_convert(k);
+  if (!(adc_regs[k].SR & ADC_SR_EOC)) {
+    now_us += timeout * 1000.0;
+    return HAL_TIMEOUT;
+  }
+  CLEAR_BIT(adc_regs[k].SR, ADC_SR_STRT | ADC_SR_EOC);
+  return HAL_OK;
+}
+
+uint32_t HAL_ADC_GetValue(ADC_HandleTypeDef *hadc) {
+  return hadc->Instance->DR;
+}
+
+HAL_StatusTypeDef HAL_ADC_Start_DMA(ADC_HandleTypeDef *hadc, uint32_t *data,
+                                    uint32_t length) {
+  if (simHal_takeFault(SIM_FAULT_DMA_START)) {
+    return HAL_ERROR;
+  }
+  SET_BIT(hadc->Instance->CR2, ADC_CR2_ADON | ADC_CR2_DMA);
+  dma.buffer = data;
+  dma.length = length;
+  dma.word = (hadc->DMA_Handle->Init.MemDataAlignment == DMA_MDATAALIGN_WORD);
+  dma.circular = (hadc->DMA_Handle->Init.Mode == DMA_CIRCULAR);
+  dma.next_half = 0;
+  dma.double_buffer = 0;
+  dma.slot = 0;
+  dma.hadc = hadc;
+  dma.running = 1;
+  hadc->State = HAL_ADC_STATE_REG_BUSY;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_ADC_Stop_DMA(ADC_HandleTypeDef *hadc) {
+  CLEAR_BIT(hadc->Instance->CR2, ADC_CR2_ADON | ADC_CR2_DMA);
+  if (dma.hadc == hadc) {
+    dma.running = 0;
+  }
+  hadc->State = HAL_ADC_STATE_READY;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_ADCEx_MultiModeConfigChannel(
+    ADC_HandleTypeDef *hadc, ADC_MultiModeTypeDef *multimode) {
+  (void)hadc;
+  MODIFY_REG(adc_common.CCR, ADC_CCR_MULTI | ADC_CCR_DMA | ADC_CCR_DELAY,
+             multimode->Mode | multimode->DMAAccessMode |
+                 multimode->TwoSamplingDelay);
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_ADCEx_MultiModeStart_DMA(ADC_HandleTypeDef *hadc,
+                                               uint32_t *data,
+                                               uint32_t length) {
+  if (simHal_takeFault(SIM_FAULT_DMA_START)) {
+    return HAL_ERROR;
+  }
+  SET_BIT(hadc->Instance->CR2, ADC_CR2_ADON);
+  if (hadc->Init.DMAContinuousRequests) {
+    SET_BIT(adc_common.CCR, ADC_CCR_DDS);
+  } else {
+    CLEAR_BIT(adc_common.CCR, ADC_CCR_DDS);
+  }
+  dma.buffer = data;
+  dma.length = length;
+  dma.word = (hadc->DMA_Handle->Init.MemDataAlignment == DMA_MDATAALIGN_WORD);
+  dma.circular = (hadc->DMA_Handle->Init.Mode == DMA_CIRCULAR);
+  dma.next_half = 0;
+  dma.double_buffer = 0;
+  dma.slot = 0;
+  dma.hadc = hadc;
+  dma.running = 1;
+  hadc->State = HAL_ADC_STATE_REG_BUSY;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_ADCEx_MultiModeStop_DMA(ADC_HandleTypeDef *hadc) {
+  CLEAR_BIT(hadc->Instance->CR2, ADC_CR2_ADON);
+  CLEAR_BIT(adc_common.CCR, ADC_CCR_DMA | ADC_CCR_DDS);
+  if (dma.hadc == hadc) {
+    dma.running = 0;
+  }
+  hadc->State = HAL_ADC_STATE_READY;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_ADCEx_InjectedConfigChannel(
+    ADC_HandleTypeDef *hadc, ADC_InjectionConfTypeDef *config) {
+  if (simHal_takeFault(SIM_FAULT_CONFIG)) {
+    return HAL_ERROR;
+  }
+  ADC_TypeDef *r = hadc->Instance;
+  uint32_t ch = (uint16_t)config->InjectedChannel;
+  uint32_t n = config->InjectedNbrOfConversion;
+
+  if (ch > 9U) {
+    MODIFY_REG(r->SMPR1, ADC_SMPR1(ADC_SMPR1_SMP10, ch),
+               ADC_SMPR1(config->InjectedSamplingTime, ch));
+  } else {
+    MODIFY_REG(r->SMPR2, ADC_SMPR2(ADC_SMPR2_SMP0, ch),
+               ADC_SMPR2(config->InjectedSamplingTime, ch));
+  }
+  uint32_t shift = 5U * ((config->InjectedRank + 3U) - n);
+  MODIFY_REG(r->JSQR, ADC_JSQR_JL | (0x1FUL << shift),
+             ((n - 1U) << ADC_JSQR_JL_Pos) | (ch << shift));
+  if (config->ExternalTrigInjecConv == ADC_INJECTED_SOFTWARE_START) {
+    CLEAR_BIT(r->CR2, ADC_CR2_JEXTSEL | ADC_CR2_JEXTEN);
+  }
+  return HAL_OK;
+}
+
+/**
+ * @brief Shared body of InjectedStart / InjectedStart_IT
+ */
+static HAL_StatusTypeDef simHal_injectedStart(ADC_HandleTypeDef *hadc,
+                                              uint8_t interrupt) {
+  if (simHal_takeFault(SIM_FAULT_START)) {
+    return HAL_ERROR;
+  }
+  ADC_TypeDef *r = hadc->Instance;
+  uint32_t k = simHal_indexOf(r);
+
+  SET_BIT(r->CR2, ADC_CR2_ADON);
+  CLEAR_BIT(r->SR, ADC_SR_JEOC | ADC_SR_OVR);
+  if (interrupt) {
+    SET_BIT(r->CR1, ADC_CR1_JEOCIE);
+  }
+  injected_armed[k] = 1;
+  if (!simHal_isMultimode() || k == 0U) {
+    SET_BIT(r->CR2, ADC_CR2_JSWSTART);
+  }
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_ADCEx_InjectedStart(ADC_HandleTypeDef *hadc) {
+  return simHal_injectedStart(hadc, 0);
+}
+
+HAL_StatusTypeDef HAL_ADCEx_InjectedStart_IT(ADC_HandleTypeDef *hadc) {
+  return simHal_injectedStart(hadc, 1);
+}
+
+uint32_t HAL_ADCEx_InjectedGetValue(ADC_HandleTypeDef *hadc,
+                                    uint32_t injected_rank) {
+  ADC_TypeDef *r = hadc->Instance;
+  switch (injected_rank) {
+  case ADC_INJECTED_RANK_4:
+    return r->JDR4;
+  case ADC_INJECTED_RANK_3:
+    return r->JDR3;
+  case ADC_INJECTED_RANK_2:
+    return r->JDR2;
+  default:
+    return r->JDR1;
+  }
+}
+
+/* Mocked HAL: TIM -----------------------------------------------------------*/
+
+HAL_StatusTypeDef HAL_TIM_Base_Init(TIM_HandleTypeDef *htim) {
+  if (htim == NULL) {
+    return HAL_ERROR;
+  }
+  if (htim->State == HAL_TIM_STATE_RESET) {
+    HAL_TIM_Base_MspInit(htim);
+  }
+  htim->Instance->PSC = htim->Init.Prescaler;
+  htim->Instance->ARR = htim->Init.Period;
+  htim->State = HAL_TIM_STATE_READY;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_ConfigClockSource(
+    TIM_HandleTypeDef *htim, const TIM_ClockConfigTypeDef *config) {
+  (void)htim;
+  (void)config;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIMEx_MasterConfigSynchronization(
+    TIM_HandleTypeDef *htim, const TIM_MasterConfigTypeDef *config) {
+  (void)htim;
+  (void)config;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_IC_ConfigChannel(TIM_HandleTypeDef *htim,
+                                           const TIM_IC_InitTypeDef *config,
+                                           uint32_t channel) {
+  (void)htim;
+  (void)config;
+  (void)channel;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_GenerateEvent(TIM_HandleTypeDef *htim,
+                                        uint32_t source_mask) {
+  (void)htim;
+  (void)source_mask;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_Base_Start(TIM_HandleTypeDef *htim) {
+  SET_BIT(htim->Instance->CR1, TIM_CR1_CEN);
+  htim->State = HAL_TIM_STATE_BUSY;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_Base_Stop(TIM_HandleTypeDef *htim) {
+  CLEAR_BIT(htim->Instance->CR1, TIM_CR1_CEN);
+  htim->State = HAL_TIM_STATE_READY;
+  return HAL_OK;
+}
+
+/* Mocked HAL: FLASH ---------------------------------------------------------*/
+
+/* Stand-ins for the CALIB sector and the CONFIG sectors 1 and 2 (linker
+   symbols on target), erased at start */
+#define SIM_HAL_CALIB_WORDS 256U
+#define SIM_HAL_CONFIG_SECTOR_WORDS (32U * 1024U / 4U)
+uint32_t _scalib[SIM_HAL_CALIB_WORDS] = {[0 ... SIM_HAL_CALIB_WORDS - 1U] =
+                                             0xFFFFFFFFU};
+uint32_t _sconfig[2U * SIM_HAL_CONFIG_SECTOR_WORDS] = {
+    [0 ... 2U * SIM_HAL_CONFIG_SECTOR_WORDS - 1U] = 0xFFFFFFFFU};
+
+HAL_StatusTypeDef HAL_FLASH_Unlock(void) { return HAL_OK; }
+HAL_StatusTypeDef HAL_FLASH_Lock(void) { return HAL_OK; }
+
+HAL_StatusTypeDef HAL_FLASHEx_Erase(FLASH_EraseInitTypeDef *erase,
+                                    uint32_t *sector_error) {
+  if (erase->Sector == FLASH_SECTOR_1 || erase->Sector == FLASH_SECTOR_2) {
+    memset(&_sconfig[(erase->Sector - FLASH_SECTOR_1) *
+                     SIM_HAL_CONFIG_SECTOR_WORDS],
+           0xFF, SIM_HAL_CONFIG_SECTOR_WORDS * sizeof(uint32_t));
+  } else {
+    memset(_scalib, 0xFF, sizeof(_scalib));
+  }
+  *sector_error = 0xFFFFFFFFU;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FLASH_Program(uint32_t type, uint32_t address,
+                                    uint64_t data) {
+  uint32_t *word = (uint32_t *)(uintptr_t)address;
+  const uint8_t in_calib =
+      word >= _scalib && word < &_scalib[SIM_HAL_CALIB_WORDS];
+  const uint8_t in_config =
+      word >= _sconfig && word < &_sconfig[2U * SIM_HAL_CONFIG_SECTOR_WORDS];
+  if (type != FLASH_TYPEPROGRAM_WORD || !(in_calib || in_config)) {
+    return HAL_ERROR;
+  }
+  *word &= (uint32_t)data; // programming only clears bits
+  return HAL_OK;
+}
+
+/* Mocked HAL: PWR -----------------------------------------------------------*/
+
+/* No backup domain: the backup SRAM is not simulated */
+void HAL_PWR_EnableBkUpAccess(void) {}
+
+HAL_StatusTypeDef HAL_PWREx_EnableBkUpReg(void) { return HAL_TIMEOUT; }
+
+/* Mocked HAL: DMA2D ---------------------------------------------------------*/
+
+/* Memory-to-memory copy done at start, completion reported by the IRQ */
+static uint8_t dma2d_pending = 0;
+
+HAL_StatusTypeDef HAL_DMA2D_Init(DMA2D_HandleTypeDef *hdma2d) {
+  if (hdma2d->State == HAL_DMA2D_STATE_RESET) {
+    HAL_DMA2D_MspInit(hdma2d);
+  }
+  hdma2d->State = HAL_DMA2D_STATE_READY;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_DMA2D_ConfigLayer(DMA2D_HandleTypeDef *hdma2d,
+                                        uint32_t layer) {
+  (void)hdma2d;
+  return (layer < MAX_DMA2D_LAYER) ? HAL_OK : HAL_ERROR;
+}
+
+HAL_StatusTypeDef HAL_DMA2D_Start_IT(DMA2D_HandleTypeDef *hdma2d,
+                                     uint32_t src, uint32_t dst,
+                                     uint32_t width, uint32_t height) {
+  if (hdma2d->State != HAL_DMA2D_STATE_READY ||
+      hdma2d->Init.Mode != DMA2D_M2M) {
+    return HAL_BUSY;
+  }
+  // 16-bit pixels; each line advances by width + the layer/output offsets
+  const uint16_t *in = (const uint16_t *)(uintptr_t)src;
+  uint16_t *out = (uint16_t *)(uintptr_t)dst;
+  const uint32_t in_line =
+      width + hdma2d->LayerCfg[DMA2D_FOREGROUND_LAYER].InputOffset;
+  const uint32_t out_line = width + hdma2d->Init.OutputOffset;
+  for (uint32_t y = 0; y < height; y++) {
+    memcpy(&out[y * out_line], &in[y * in_line], width * sizeof(uint16_t));
+  }
+  hdma2d->State = HAL_DMA2D_STATE_BUSY;
+  dma2d_pending = 1;
+  return HAL_OK;
+}
+
+void HAL_DMA2D_IRQHandler(DMA2D_HandleTypeDef *hdma2d) {
+  if (!dma2d_pending) {
+    return;
+  }
+  dma2d_pending = 0;
+  hdma2d->State = HAL_DMA2D_STATE_READY;
+  if (hdma2d->XferCpltCallback != NULL) {
+    hdma2d->XferCpltCallback(hdma2d);
+  }
+}
@@ -0,0 +1,26 @@
+/**
+ ******************************************************************************
+ * @file    sim_telemetry.c
+ * @brief   Host stand-in for the UART telemetry queue: lines go to stdout
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "telemetry.h"
+#include <stdio.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define SIM_TELEMETRY_SLOTS 8U
+
+/* Public functions ----------------------------------------------------------*/
+
+HAL_StatusTypeDef telemetry_send(const uint8_t *data, uint16_t len) {
+  if (data == NULL || len == 0U) {
+    return HAL_ERROR;
+  }
+  fwrite(data, 1, len, stdout);
+  return HAL_OK;
+}
+
+uint32_t telemetry_getFreeSlots(void) { return SIM_TELEMETRY_SLOTS; }
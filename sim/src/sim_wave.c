@@ -0,0 +1,193 @@
+/**
+ ******************************************************************************
+ * @file    sim_wave.c
+ * @brief   Synthetic and replayed sample sources for the mock HAL
+ * @date    October 14, 2026
+ * @author  Elkana Molson
+ ******************************************************************************
+ */
+
+#include "sim_wave.h"
+#include "adc_channels.h"
+#include <ctype.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Private defines -----------------------------------------------------------*/
+#define SIM_WAVE_MIDSCALE 2048U
+#define SIM_WAVE_MAX_CODE 4095.0
+#define SIM_WAVE_TWO_PI 6.283185307179586
+
+#define SIM_WAVE_X_INPUT(name, channel, ohms, bits, adcs, slot) channel,
+
+/* Private variables ---------------------------------------------------------*/
+static const uint32_t table_inputs[ADC_CHANNELS_COUNT] = {
+    ADC_CHANNELS_TABLE(SIM_WAVE_X_INPUT)};
+
+/* Private functions ---------------------------------------------------------*/
+
+static uint32_t simWave_xorshift(uint32_t *state) {
+  uint32_t x = *state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *state = x;
+  return x;
+}
+
+static uint16_t simWave_clamp(double v) {
+  if (v < 0.0) {
+    return 0U;
+  }
+  if (v > SIM_WAVE_MAX_CODE) {
+    return (uint16_t)SIM_WAVE_MAX_CODE;
+  }
+  return (uint16_t)(v + 0.5);
+}
+
+/**
+ * @brief Table row of an ADC input, -1 if none
+ */
+static int simWave_rowOf(uint32_t adc_channel) {
+  for (uint32_t i = 0; i < ADC_CHANNELS_COUNT; i++) {
+    if ((uint16_t)table_inputs[i] == adc_channel) {
+      return (int)i;
+    }
+  }
+  return -1;
+}
+
+static uint8_t simWave_endsWith(const char *s, const char *suffix) {
+  size_t n = strlen(s);
+  size_t m = strlen(suffix);
+  return n >= m && strcmp(s + n - m, suffix) == 0;
+}
+
+static int simWave_loadCsv(FILE *f, SimWave_Replay_t *replay) {
+  char line[512];
+  uint32_t capacity = 0;
+
+  while (fgets(line, sizeof(line), f) != NULL) {
+    if (!isdigit((unsigned char)line[0])) {
+      continue;
+    }
+    if (replay->frame_count == capacity) {
+      capacity = capacity ? capacity * 2U : 1024U;
+      uint16_t *grown = realloc(replay->frames, (size_t)capacity *
+                                                    replay->channels *
+                                                    sizeof(uint16_t));
+      if (grown == NULL) {
+        return -1;
+      }
+      replay->frames = grown;
+    }
+    uint16_t *frame = replay->frames + replay->frame_count * replay->channels;
+    char *p = line;
+    for (uint32_t c = 0; c < replay->channels; c++) {
+      char *end;
+      unsigned long v = strtoul(p, &end, 10);
+      frame[c] = (end == p) ? SIM_WAVE_MIDSCALE : (uint16_t)v;
+      p = (*end == ',') ? end + 1 : end;
+    }
+    replay->frame_count++;
+  }
+  return 0;
+}
+
+static int simWave_loadRaw(FILE *f, SimWave_Replay_t *replay) {
+  if (fseek(f, 0, SEEK_END) != 0) {
+    return -1;
+  }
+  long size = ftell(f);
+  rewind(f);
+  size_t frame_bytes = replay->channels * sizeof(uint16_t);
+  if (size < (long)frame_bytes) {
+    return -1;
+  }
+  replay->frame_count = (uint32_t)((size_t)size / frame_bytes);
+  replay->frames = malloc(replay->frame_count * frame_bytes);
+  if (replay->frames == NULL) {
+    return -1;
+  }
+  uint8_t *bytes = (uint8_t *)replay->frames;
+  size_t total = replay->frame_count * frame_bytes;
+  if (fread(bytes, 1, total, f) != total) {
+    return -1;
+  }
+  // Little-endian on disk, whatever the host
+  for (size_t i = 0; i < total / 2U; i++) {
+    replay->frames[i] = (uint16_t)(bytes[2U * i] | (bytes[2U * i + 1U] << 8));
+  }
+  return 0;
+}
+
+/* Public functions ----------------------------------------------------------*/
+
+void simWave_synthDefaults(SimWave_Synth_t *synth) {
+  for (uint32_t ch = 0; ch < SIM_HAL_ADC_INPUTS; ch++) {
+    synth->input[ch] = (SimWave_Input_t){
+        .offset = (float)SIM_WAVE_MIDSCALE,
+        .amplitude = 600.0f,
+        .freq_hz = 50.0f + 17.0f * (float)ch,
+        .phase_rad = 0.0f,
+        .noise = 4.0f,
+    };
+  }
+  synth->seed = 0x2545F491U;
+}
+
+uint16_t simWave_synth(uint32_t adc_channel, double t_us, void *ctx) {
+  SimWave_Synth_t *synth = ctx;
+  if (adc_channel >= SIM_HAL_ADC_INPUTS) {
+    return SIM_WAVE_MIDSCALE;
+  }
+  const SimWave_Input_t *in = &synth->input[adc_channel];
+  double v = in->offset +
+             in->amplitude *
+                 sin(SIM_WAVE_TWO_PI * in->freq_hz * t_us * 1e-6 + in->phase_rad);
+  if (in->noise > 0.0f) {
+    double u = (double)simWave_xorshift(&synth->seed) / 4294967295.0;
+    v += (2.0 * u - 1.0) * in->noise;
+  }
+  return simWave_clamp(v);
+}
+
+int simWave_replayLoad(SimWave_Replay_t *replay, const char *path,
+                       double rate_hz) {
+  memset(replay, 0, sizeof(*replay));
+  replay->channels = ADC_CHANNELS_COUNT;
+  replay->rate_hz = rate_hz;
+
+  FILE *f = fopen(path, "rb");
+  if (f == NULL) {
+    return -1;
+  }
+  int rc = simWave_endsWith(path, ".csv") ? simWave_loadCsv(f, replay)
+                                          : simWave_loadRaw(f, replay);
+  fclose(f);
+  if (rc != 0 || replay->frame_count == 0U || rate_hz <= 0.0) {
+    simWave_replayFree(replay);
+    return -1;
+  }
+  return 0;
+}
+
+void simWave_replayFree(SimWave_Replay_t *replay) {
+  free(replay->frames);
+  replay->frames = NULL;
+  replay->frame_count = 0;
+}
+
+uint16_t simWave_replay(uint32_t adc_channel, double t_us, void *ctx) {
+  const SimWave_Replay_t *replay = ctx;
+  int row = simWave_rowOf(adc_channel);
+  if (row < 0 || replay->frame_count == 0U) {
+    return SIM_WAVE_MIDSCALE;
+  }
+  uint64_t frame = (uint64_t)(t_us * 1e-6 * replay->rate_hz);
+  frame %= replay->frame_count;
+  uint16_t v = replay->frames[frame * replay->channels + (uint32_t)row];
+  return (v > (uint16_t)SIM_WAVE_MAX_CODE) ? (uint16_t)SIM_WAVE_MAX_CODE : v;
+}
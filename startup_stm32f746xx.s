@@ -59,6 +59,20 @@ defined in linker script */
   .type  Reset_Handler, %function
 Reset_Handler:  
   ldr   sp, =_estack      /* set stack pointer */
+
+/* Paint the main stack for its high-water mark (MEM_BUDGET_STACK_PAINT) */
+  ldr r2, =_sstack
+  ldr r4, =_estack
+  ldr r3, =0xA5A5A5A5
+  b LoopPaintStack
+
+PaintStack:
+  str  r3, [r2]
+  adds r2, r2, #4
+
+LoopPaintStack:
+  cmp r2, r4
+  bcc PaintStack
   
 /* Call the clock system initialization function.*/
   bl  SystemInit   
@@ -93,6 +107,82 @@ FillZerobss:
 LoopFillZerobss:
   cmp r2, r4
   bcc FillZerobss
+
+/* Copy the DTCM data initializers from flash to DTCM */
+  ldr r0, =_sdtcm
+  ldr r1, =_edtcm
+  ldr r2, =_sidtcm
+  movs r3, #0
+  b LoopCopyDtcmInit
+
+CopyDtcmInit:
+  ldr r4, [r2, r3]
+  str r4, [r0, r3]
+  adds r3, r3, #4
+
+LoopCopyDtcmInit:
+  adds r4, r0, r3
+  cmp r4, r1
+  bcc CopyDtcmInit
+
+/* Zero fill the DTCM bss segment. */
+  ldr r2, =_sdtcm_bss
+  ldr r4, =_edtcm_bss
+  movs r3, #0
+  b LoopFillZeroDtcm
+
+FillZeroDtcm:
+  str  r3, [r2]
+  adds r2, r2, #4
+
+LoopFillZeroDtcm:
+  cmp r2, r4
+  bcc FillZeroDtcm
+
+/* Zero fill the SRAM1 and SRAM2 DMA buffer segments. */
+  ldr r2, =_ssram1_bss
+  ldr r4, =_esram1_bss
+  movs r3, #0
+  b LoopFillZeroSram1
+
+FillZeroSram1:
+  str  r3, [r2]
+  adds r2, r2, #4
+
+LoopFillZeroSram1:
+  cmp r2, r4
+  bcc FillZeroSram1
+
+  ldr r2, =_ssram2_bss
+  ldr r4, =_esram2_bss
+  b LoopFillZeroSram2
+
+FillZeroSram2:
+  str  r3, [r2]
+  adds r2, r2, #4
+
+LoopFillZeroSram2:
+  cmp r2, r4
+  bcc FillZeroSram2
+
+/* Copy the fast code from flash to ITCM */
+  ldr r0, =_sitcm
+  ldr r1, =_eitcm
+  ldr r2, =_siitcm
+  movs r3, #0
+  b LoopCopyItcmInit
+
+CopyItcmInit:
+  ldr r4, [r2, r3]
+  str r4, [r0, r3]
+  adds r3, r3, #4
+
+LoopCopyItcmInit:
+  adds r4, r0, r3
+  cmp r4, r1
+  bcc CopyItcmInit
+  dsb
+  isb
   
 /* Call static constructors */
     bl __libc_init_array